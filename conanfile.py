@@ -69,6 +69,7 @@ class OrbitConan(ConanFile):
         self.build_requires('protoc_installer/3.9.1@bincrafters/stable#0')
         self.build_requires('grpc_codegen/1.27.3@{}'.format(self._orbit_channel))
         self.build_requires('gtest/1.10.0#ef88ba8e54f5ffad7d706062d0731a40', force_host_context=True)
+        self.build_requires('benchmark/1.5.2', force_host_context=True)
         self.build_requires('nodejs/13.6.0@{}#d07f6d3db886419fa9d0f65495ca23eb'.format(self._orbit_channel))
 
     def requirements(self):
@@ -246,6 +247,8 @@ class OrbitConan(ConanFile):
                       dst="{}-{}/opt/developer/tools/".format(self.name, self._version()))
             self.copy("liborbit.so", src="lib/",
                       dst="{}-{}/opt/developer/tools/".format(self.name, self._version()))
+            self.copy("liborbituserspaceinstrumentation.so", src="lib/",
+                      dst="{}-{}/opt/developer/tools/".format(self.name, self._version()))
             self.copy("NOTICE",
                       dst="{}-{}/usr/share/doc/{}/".format(self.name, self._version(), self.name))
             self.copy("LICENSE",
@@ -295,6 +298,7 @@ chmod -v 4775 /opt/developer/tools/OrbitService
         self.copy("NOTICE.Chromium.csv")
         self.copy("LICENSE")
         self.copy("liborbit.so", src="lib/", dst="lib")
+        self.copy("liborbituserspaceinstrumentation.so", src="lib/", dst="lib")
         self.copy("libOrbitVulkanLayer.so", src="lib/", dst="lib")
         self.copy("VkLayer_Orbit_implicit.json", src="lib/", dst="lib")
         self.copy("LinuxTracingIntegrationTests", src="bin/", dst="bin")
@@ -7,11 +7,38 @@
 
 #include <absl/base/casts.h>
 
+#include <array>
+#include <cstdint>
+#include <string>
+
 #include "Api/EncodedEvent.h"
 #include "Api/LockFreeApiEventProducer.h"
 #include "OrbitBase/Profiling.h"
 #include "OrbitBase/ThreadUtils.h"
 
+// The names of the events are almost always string literals, so each thread caches the keys of the
+// names it has used most recently by address. As names don't have to be literals, a cached key is
+// only used if the name at that address hasn't changed.
+static uint64_t GetNameKey(orbit_api::LockFreeApiEventProducer* producer, const char* name) {
+  if (name == nullptr) return 0;
+
+  struct CachedName {
+    const char* address = nullptr;
+    std::string name;
+    uint64_t key = 0;
+  };
+  constexpr size_t kCachedNameCount = 64;
+  thread_local std::array<CachedName, kCachedNameCount> cached_names;
+
+  CachedName& cached_name = cached_names[reinterpret_cast<uintptr_t>(name) % kCachedNameCount];
+  if (cached_name.address != name || cached_name.name != name) {
+    cached_name.address = name;
+    cached_name.name = name;
+    cached_name.key = producer->InternName(cached_name.name);
+  }
+  return cached_name.key;
+}
+
 static void EnqueueApiEvent(orbit_api::EventType type, const char* name = nullptr,
                             uint64_t data = 0, orbit_api_color color = kOrbitColorAuto) {
   static orbit_api::LockFreeApiEventProducer producer;
@@ -19,10 +46,17 @@ static void EnqueueApiEvent(orbit_api::EventType type, const char* name = nullpt
 
   static pid_t pid = orbit_base::GetCurrentProcessId();
   thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
-  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  // Reading the time stamp counter is much cheaper than clock_gettime. OrbitService converts it.
+  uint64_t timestamp_ns = producer.UsesTscTimestamps() ? orbit_base::CaptureTimestampTsc()
+                                                       : orbit_base::CaptureTimestampNs();
+
+  // Each thread enqueues into its own sub-queue, so that heavily instrumented threads don't contend
+  // with each other. The token of the main thread is destroyed before the static producer.
+  thread_local moodycamel::ProducerToken producer_token = producer.CreateProducerToken();
 
-  orbit_api::ApiEvent api_event(pid, tid, timestamp_ns, type, name, data, color);
-  producer.EnqueueIntermediateEvent(api_event);
+  producer.EnqueueIntermediateEvent(
+      &producer_token, orbit_api::CompactApiEvent(pid, tid, timestamp_ns, type,
+                                                  GetNameKey(&producer, name), data, color));
 }
 
 extern "C" {
@@ -78,6 +112,19 @@ void orbit_api_async_string(const char* str, uint64_t id, orbit_api_color color)
   }
 }
 
+void orbit_api_fiber_switch_in(uint64_t id) {
+  EnqueueApiEvent(orbit_api::EventType::kFiberSwitchIn, /*name=*/nullptr, id);
+}
+
+void orbit_api_fiber_switch_out(uint64_t id) {
+  EnqueueApiEvent(orbit_api::EventType::kFiberSwitchOut, /*name=*/nullptr, id);
+}
+
+static void orbit_api_initialize_v1(orbit_api_v1* api) {
+  api->fiber_switch_in = &orbit_api_fiber_switch_in;
+  api->fiber_switch_out = &orbit_api_fiber_switch_out;
+}
+
 static void orbit_api_initialize_v0(orbit_api_v0* api) {
   // The api function table is accessed by user code using this pattern:
   //
@@ -118,6 +165,9 @@ void orbit_api_set_enabled(uint64_t address, uint64_t api_version, bool enabled)
   orbit_api_v0* api_v0 = absl::bit_cast<orbit_api_v0*>(address);
   if (!api_v0->initialized) {
     // Note: initialize any newer api version before v0, which sets "initialized" to 1.
+    if (api_version >= 1) {
+      orbit_api_initialize_v1(absl::bit_cast<orbit_api_v1*>(address));
+    }
     orbit_api_initialize_v0(api_v0);
   }
 
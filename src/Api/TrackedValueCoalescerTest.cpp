@@ -0,0 +1,96 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Api/EncodedEvent.h"
+#include "Api/TrackedValueCoalescer.h"
+
+namespace orbit_api {
+
+namespace {
+
+constexpr int32_t kPid = 1;
+constexpr int32_t kTid = 2;
+constexpr uint64_t kNameKey = 3;
+
+std::vector<CoalescedTrackedValue> Flush(TrackedValueCoalescer* coalescer) {
+  std::vector<CoalescedTrackedValue> values;
+  coalescer->Flush([&values](const CoalescedTrackedValue& value) { values.push_back(value); });
+  return values;
+}
+
+}  // namespace
+
+TEST(TrackedValueCoalescer, IgnoresEventsThatAreNotTrackedValues) {
+  TrackedValueCoalescer coalescer;
+  EXPECT_FALSE(coalescer.Add(CompactApiEvent{kPid, kTid, 100, kScopeStart, kNameKey}));
+  EXPECT_FALSE(coalescer.Add(CompactApiEvent{kPid, kTid, 100, kString, kNameKey}));
+  EXPECT_TRUE(coalescer.IsEmpty());
+}
+
+TEST(TrackedValueCoalescer, KeepsTheLatestTheSmallestAndTheLargestValue) {
+  TrackedValueCoalescer coalescer;
+  EXPECT_TRUE(coalescer.Add(
+      CompactApiEvent{kPid, kTid, 100, kTrackInt, kNameKey, Encode<uint64_t>(int32_t{-1})}));
+  EXPECT_TRUE(coalescer.Add(
+      CompactApiEvent{kPid, kTid, 200, kTrackInt, kNameKey, Encode<uint64_t>(int32_t{-5})}));
+  EXPECT_TRUE(coalescer.Add(
+      CompactApiEvent{kPid, kTid, 300, kTrackInt, kNameKey, Encode<uint64_t>(int32_t{4})}));
+  EXPECT_TRUE(coalescer.Add(
+      CompactApiEvent{kPid, kTid, 400, kTrackInt, kNameKey, Encode<uint64_t>(int32_t{2})}));
+  EXPECT_FALSE(coalescer.IsEmpty());
+
+  std::vector<CoalescedTrackedValue> values = Flush(&coalescer);
+  ASSERT_EQ(values.size(), 1);
+  EXPECT_EQ(values[0].count, 4);
+  EXPECT_EQ(values[0].latest.timestamp_ns, 400);
+  EXPECT_EQ(Decode<int32_t>(values[0].latest.data), 2);
+  EXPECT_EQ(values[0].min_timestamp_ns, 200);
+  EXPECT_EQ(Decode<int32_t>(values[0].min_data), -5);
+  EXPECT_EQ(values[0].max_timestamp_ns, 300);
+  EXPECT_EQ(Decode<int32_t>(values[0].max_data), 4);
+
+  EXPECT_TRUE(coalescer.IsEmpty());
+  EXPECT_TRUE(Flush(&coalescer).empty());
+}
+
+TEST(TrackedValueCoalescer, ComparesValuesAccordingToTheirType) {
+  TrackedValueCoalescer coalescer;
+  coalescer.Add(CompactApiEvent{kPid, kTid, 100, kTrackDouble, kNameKey, Encode<uint64_t>(-0.5)});
+  coalescer.Add(CompactApiEvent{kPid, kTid, 200, kTrackDouble, kNameKey, Encode<uint64_t>(0.25)});
+
+  std::vector<CoalescedTrackedValue> values = Flush(&coalescer);
+  ASSERT_EQ(values.size(), 1);
+  EXPECT_EQ(Decode<double>(values[0].min_data), -0.5);
+  EXPECT_EQ(Decode<double>(values[0].max_data), 0.25);
+}
+
+TEST(TrackedValueCoalescer, CoalescesPerProcessNameAndType) {
+  TrackedValueCoalescer coalescer;
+  coalescer.Add(CompactApiEvent{kPid, kTid, 100, kTrackInt, kNameKey, 1});
+  coalescer.Add(CompactApiEvent{kPid, kTid + 1, 200, kTrackInt, kNameKey, 2});
+  coalescer.Add(CompactApiEvent{kPid + 1, kTid, 300, kTrackInt, kNameKey, 3});
+  coalescer.Add(CompactApiEvent{kPid, kTid, 400, kTrackInt, kNameKey + 1, 4});
+  coalescer.Add(CompactApiEvent{kPid, kTid, 500, kTrackUint, kNameKey, 5});
+
+  std::vector<CoalescedTrackedValue> values = Flush(&coalescer);
+  EXPECT_EQ(values.size(), 4);
+  for (const CoalescedTrackedValue& value : values) {
+    EXPECT_EQ(value.count, value.latest.data == 2 ? 2 : 1);
+  }
+}
+
+TEST(TrackedValueCoalescer, ClearDropsTheCoalescedValues) {
+  TrackedValueCoalescer coalescer;
+  coalescer.Add(CompactApiEvent{kPid, kTid, 100, kTrackFloat, kNameKey, Encode<uint64_t>(1.f)});
+  coalescer.Clear();
+  EXPECT_TRUE(coalescer.IsEmpty());
+  EXPECT_TRUE(Flush(&coalescer).empty());
+}
+
+}  // namespace orbit_api
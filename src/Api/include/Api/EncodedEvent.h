@@ -28,6 +28,8 @@ enum EventType : uint8_t {
   kTrackFloat = 9,
   kTrackDouble = 10,
   kString = 11,
+  kFiberSwitchIn = 12,
+  kFiberSwitchOut = 13,
 };
 
 constexpr size_t kMaxEventStringSize = 34;
@@ -89,6 +91,32 @@ struct ApiEvent {
   uint64_t timestamp_ns;
 };
 
+// CompactApiEvent is what liborbit enqueues instead of ApiEvent. The name is interned and only its
+// key is stored, so that the name is neither copied for every event nor truncated.
+struct CompactApiEvent {
+  CompactApiEvent() = default;
+  CompactApiEvent(int32_t pid, int32_t tid, uint64_t timestamp_ns, orbit_api::EventType type,
+                  uint64_t name_key = 0, uint64_t data = 0, orbit_api_color color = kOrbitColorAuto)
+      : timestamp_ns(timestamp_ns),
+        name_key(name_key),
+        data(data),
+        pid(pid),
+        tid(tid),
+        color(color),
+        type(type) {
+    static_assert(sizeof(CompactApiEvent) == 40, "orbit_api::CompactApiEvent should be 40 bytes.");
+  }
+
+  // A value of orbit_base::CaptureTimestampTsc() if LockFreeApiEventProducer::UsesTscTimestamps().
+  uint64_t timestamp_ns;
+  uint64_t name_key;
+  uint64_t data;
+  int32_t pid;
+  int32_t tid;
+  orbit_api_color color;
+  orbit_api::EventType type;
+};
+
 template <typename Dest, typename Source>
 inline Dest Encode(const Source& source) {
   static_assert(sizeof(Source) <= sizeof(Dest), "orbit_api::Encode destination type is too small");
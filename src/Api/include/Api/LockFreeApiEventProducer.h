@@ -5,40 +5,179 @@
 #ifndef API_LOCK_FREE_API_EVENT_PRODUCER_H_
 #define API_LOCK_FREE_API_EVENT_PRODUCER_H_
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "Api/EncodedEvent.h"
+#include "Api/TrackedValueCoalescer.h"
 #include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "OrbitBase/Profiling.h"
 #include "ProducerSideChannel/ProducerSideChannel.h"
 
 namespace orbit_api {
 
-// This class is used to enqueue orbit_api::ApiEvent events from multiple threads and relay them to
-// OrbitService in the form of orbit_grpc_protos::ApiEvent events.
+// This class is used to enqueue orbit_api::CompactApiEvent events from multiple threads and relay
+// them to OrbitService in the form of orbit_grpc_protos::CompactApiEvent events.
+// The names of the events are interned with InternName. Each name is sent as an InternedString,
+// once per capture, before the first event that refers to it.
+// With CaptureOptions::api_track_value_coalescing_interval_ms, the events of tracked values are
+// coalesced by a TrackedValueCoalescer and only sent once per interval.
 class LockFreeApiEventProducer
-    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<orbit_api::ApiEvent> {
+    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<
+          orbit_api::CompactApiEvent> {
  public:
   LockFreeApiEventProducer() {
+    EnableSharedMemoryTransport(
+        orbit_producer_side_channel::kProducerSideSharedMemoryBufferCapacityBytes);
     BuildAndStart(orbit_producer_side_channel::CreateProducerSideChannel());
   }
 
   ~LockFreeApiEventProducer() { ShutdownAndWait(); }
 
+  // Returns the key of name, assigning a new one the first time name is passed. Keys are never
+  // zero. This can be called from any thread.
+  [[nodiscard]] uint64_t InternName(const std::string& name) {
+    absl::MutexLock lock{&interned_names_mutex_};
+    auto it = name_to_key_.find(name);
+    if (it != name_to_key_.end()) {
+      return it->second;
+    }
+    interned_names_.emplace_back(name);
+    const uint64_t key = interned_names_.size();
+    name_to_key_.emplace(interned_names_.back(), key);
+    return key;
+  }
+
+  // If true, the timestamps of the events are values of orbit_base::CaptureTimestampTsc() instead
+  // of orbit_base::CaptureTimestampNs(). This only changes at the start of a capture, before events
+  // are accepted.
+  [[nodiscard]] bool UsesTscTimestamps() const {
+    return uses_tsc_timestamps_.load(std::memory_order_relaxed);
+  }
+
  protected:
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
+    // OrbitService maps the keys of the InternedStrings anew in every capture, so names need to be
+    // sent again. Request this before the events of the new capture start being forwarded.
+    sent_name_keys_reset_requested_ = true;
+    coalescing_interval_ms_.store(capture_options.api_track_value_coalescing_interval_ms(),
+                                  std::memory_order_relaxed);
+    // OrbitService only calibrates the time stamp counter when the CPU has an invariant one.
+    uses_tsc_timestamps_.store(capture_options.use_tsc_for_api_timestamps() &&
+                                   orbit_base::IsTscUsableForCaptureTimestamps(),
+                               std::memory_order_relaxed);
+    LockFreeBufferCaptureEventProducer::OnCaptureStart(std::move(capture_options));
+  }
+
   [[nodiscard]] virtual orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
-      orbit_api::ApiEvent&& raw_api_event, google::protobuf::Arena* arena) override {
+      orbit_api::CompactApiEvent&& raw_api_event, google::protobuf::Arena* arena) override {
     auto* capture_event =
         google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
-    auto* api_event = capture_event->mutable_api_event();
-    api_event->set_timestamp_ns(raw_api_event.timestamp_ns);
+    auto* api_event = capture_event->mutable_compact_api_event();
     api_event->set_pid(raw_api_event.pid);
     api_event->set_tid(raw_api_event.tid);
-    api_event->set_r0(raw_api_event.encoded_event.args[0]);
-    api_event->set_r1(raw_api_event.encoded_event.args[1]);
-    api_event->set_r2(raw_api_event.encoded_event.args[2]);
-    api_event->set_r3(raw_api_event.encoded_event.args[3]);
-    api_event->set_r4(raw_api_event.encoded_event.args[4]);
-    api_event->set_r5(raw_api_event.encoded_event.args[5]);
+    if (UsesTscTimestamps()) {
+      api_event->set_timestamp_tsc(raw_api_event.timestamp_ns);
+    } else {
+      api_event->set_timestamp_ns(raw_api_event.timestamp_ns);
+    }
+    api_event->set_type(raw_api_event.type);
+    api_event->set_name_key(raw_api_event.name_key);
+    api_event->set_color(raw_api_event.color);
+    api_event->set_data(raw_api_event.data);
     return capture_event;
   }
+
+  void TranslateIntermediateEvents(
+      orbit_api::CompactApiEvent* raw_api_events, size_t raw_api_event_count,
+      google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    ResetForNewCaptureIfRequested();
+    const bool coalesce_tracked_values =
+        coalescing_interval_ms_.load(std::memory_order_relaxed) != 0;
+
+    for (size_t i = 0; i < raw_api_event_count; ++i) {
+      const uint64_t name_key = raw_api_events[i].name_key;
+      if (name_key != 0 && sent_name_keys_.insert(name_key).second) {
+        auto* capture_event =
+            google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+        orbit_grpc_protos::InternedString* interned_string =
+            capture_event->mutable_interned_string();
+        interned_string->set_key(name_key);
+        {
+          absl::MutexLock lock{&interned_names_mutex_};
+          interned_string->set_intern(interned_names_[name_key - 1]);
+        }
+        capture_events->AddAllocated(capture_event);
+      }
+      if (coalesce_tracked_values && tracked_value_coalescer_.Add(raw_api_events[i])) {
+        continue;
+      }
+      capture_events->AddAllocated(TranslateIntermediateEvent(std::move(raw_api_events[i]), arena));
+    }
+  }
+
+  [[nodiscard]] bool HasPendingEventsToSend(bool all_events) override {
+    ResetForNewCaptureIfRequested();
+    if (tracked_value_coalescer_.IsEmpty()) return false;
+    return all_events ||
+           absl::Now() - last_coalesced_values_sent_time_ >=
+               absl::Milliseconds(coalescing_interval_ms_.load(std::memory_order_relaxed));
+  }
+
+  void TranslatePendingEvents(
+      bool /*all_events*/, google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    tracked_value_coalescer_.Flush([this, arena,
+                                    capture_events](const CoalescedTrackedValue& value) {
+      orbit_grpc_protos::ProducerCaptureEvent* capture_event =
+          TranslateIntermediateEvent(CompactApiEvent{value.latest}, arena);
+      orbit_grpc_protos::CompactApiEvent* api_event = capture_event->mutable_compact_api_event();
+      api_event->set_coalesced_count(value.count);
+      api_event->set_coalesced_min_data(value.min_data);
+      api_event->set_coalesced_min_timestamp_ns(value.min_timestamp_ns);
+      api_event->set_coalesced_max_data(value.max_data);
+      api_event->set_coalesced_max_timestamp_ns(value.max_timestamp_ns);
+      capture_events->AddAllocated(capture_event);
+    });
+    last_coalesced_values_sent_time_ = absl::Now();
+  }
+
+ private:
+  // This is only called from the forwarding thread, which is the only one accessing
+  // sent_name_keys_ and tracked_value_coalescer_.
+  void ResetForNewCaptureIfRequested() {
+    if (!sent_name_keys_reset_requested_.exchange(false)) return;
+    sent_name_keys_.clear();
+    // Values coalesced in a previous capture that wasn't stopped regularly are dropped.
+    tracked_value_coalescer_.Clear();
+    last_coalesced_values_sent_time_ = absl::Now();
+  }
+
+  absl::Mutex interned_names_mutex_;
+  // The name with key k is interned_names_[k - 1]. Names are never removed, as the same key is used
+  // across captures.
+  std::vector<std::string> interned_names_ ABSL_GUARDED_BY(interned_names_mutex_);
+  absl::flat_hash_map<std::string, uint64_t> name_to_key_ ABSL_GUARDED_BY(interned_names_mutex_);
+
+  std::atomic<bool> sent_name_keys_reset_requested_ = false;
+  std::atomic<bool> uses_tsc_timestamps_ = false;
+  std::atomic<uint32_t> coalescing_interval_ms_ = 0;
+  // These are only accessed by the forwarding thread.
+  absl::flat_hash_set<uint64_t> sent_name_keys_;
+  TrackedValueCoalescer tracked_value_coalescer_;
+  absl::Time last_coalesced_values_sent_time_;
 };
 
 }  // namespace orbit_api
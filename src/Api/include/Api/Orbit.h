@@ -27,6 +27,7 @@
 // ORBIT_UINT64: Graph uint64_t values.
 // ORBIT_FLOAT: Graph float values.
 // ORBIT_DOUBLE: Graph double values.
+// ORBIT_FIBER_SWITCH_IN/ORBIT_FIBER_SWITCH_OUT: Attribute scopes to fibers or jobs.
 //
 // Colors:
 // Note that all of the macros above have a "_WITH_COLOR" variant that allow users to specify
@@ -190,6 +191,33 @@
 // name: [const char*] Name of the track that will display the graph in Orbit.
 // val: [int, int64_t, uint32_t, uint64_t, float, double] Value to be plotted.
 // col: [orbit_api_color] User-defined color for the current value (see orbit_api_color below).
+//
+//
+// =================================================================================================
+// ORBIT_FIBER_SWITCH_IN/ORBIT_FIBER_SWITCH_OUT: Attribute scopes to fibers or jobs.
+// =================================================================================================
+//
+// Overview:
+// Job systems and fibers run many logical tasks on few threads, and a task can be suspended on one
+// thread and resumed on another. Call ORBIT_FIBER_SWITCH_IN when the current thread starts or
+// resumes running the fiber (or job) "id", and ORBIT_FIBER_SWITCH_OUT when it stops or suspends it.
+// ORBIT_SCOPE, ORBIT_START and ORBIT_STOP called in between belong to the fiber rather than to the
+// thread: they are nested with the other scopes of the fiber, even across threads, and are
+// displayed on a track per fiber.
+//
+// Note:
+// A scope started on a fiber needs to be stopped on the same fiber, and a scope started outside of
+// any fiber needs to be stopped outside of any fiber.
+//
+// Example usage: Profile jobs that yield to the scheduler.
+// void RunJob(Job* job) {  // Called by any worker thread to start or resume a job.
+//   ORBIT_FIBER_SWITCH_IN(job->GetId());
+//   job->Resume();  // Scopes in the job can span several calls of RunJob.
+//   ORBIT_FIBER_SWITCH_OUT(job->GetId());
+// }
+//
+// Parameters:
+// id: [uint64_t] A user-provided unique, non-zero id of the fiber or job.
 
 // To disable manual instrumentation macros, define ORBIT_API_ENABLED as 0.
 #define ORBIT_API_ENABLED 1
@@ -211,6 +239,8 @@
 #define ORBIT_UINT64(name, value) ORBIT_CALL(track_uint64, name, value, kOrbitColorAuto)
 #define ORBIT_FLOAT(name, value) ORBIT_CALL(track_float, name, value, kOrbitColorAuto)
 #define ORBIT_DOUBLE(name, value) ORBIT_CALL(track_double, name, value, kOrbitColorAuto)
+#define ORBIT_FIBER_SWITCH_IN(id) ORBIT_CALL(fiber_switch_in, id)
+#define ORBIT_FIBER_SWITCH_OUT(id) ORBIT_CALL(fiber_switch_out, id)
 
 #define ORBIT_START_WITH_COLOR(name, color) ORBIT_CALL(start, name, color)
 #define ORBIT_START_ASYNC_WITH_COLOR(name, id, color) ORBIT_CALL(start_async, name, id, color)
@@ -240,6 +270,8 @@
 #define ORBIT_UINT64(name, value)
 #define ORBIT_FLOAT(name, value)
 #define ORBIT_DOUBLE(name, value)
+#define ORBIT_FIBER_SWITCH_IN(id)
+#define ORBIT_FIBER_SWITCH_OUT(id)
 
 #define ORBIT_START_WITH_COLOR(name, color)
 #define ORBIT_START_ASYNC_WITH_COLOR(name, id, color)
@@ -295,7 +327,7 @@ typedef enum {
   kOrbitColorBlueGrey = 0x607d8bff
 } orbit_api_color;
 
-enum { kOrbitApiVersion = 0 };
+enum { kOrbitApiVersion = 1 };
 
 struct orbit_api_v0 {
   uint32_t enabled;
@@ -313,24 +345,44 @@ struct orbit_api_v0 {
   void (*track_double)(const char* name, double value, orbit_api_color color);
 };
 
-extern struct orbit_api_v0 g_orbit_api_v0;
-extern ORBIT_EXPORT void* orbit_api_get_function_table_address_v0();
+// Starts with the same fields as orbit_api_v0, so that liborbit can access the "enabled" and
+// "initialized" flags of any version through the v0 layout.
+struct orbit_api_v1 {
+  uint32_t enabled;
+  uint32_t initialized;
+  void (*start)(const char* name, orbit_api_color color);
+  void (*stop)();
+  void (*start_async)(const char* name, uint64_t id, orbit_api_color color);
+  void (*stop_async)(uint64_t id);
+  void (*async_string)(const char* str, uint64_t id, orbit_api_color color);
+  void (*track_int)(const char* name, int value, orbit_api_color color);
+  void (*track_int64)(const char* name, int64_t value, orbit_api_color color);
+  void (*track_uint)(const char* name, uint32_t value, orbit_api_color color);
+  void (*track_uint64)(const char* name, uint64_t value, orbit_api_color color);
+  void (*track_float)(const char* name, float value, orbit_api_color color);
+  void (*track_double)(const char* name, double value, orbit_api_color color);
+  void (*fiber_switch_in)(uint64_t id);
+  void (*fiber_switch_out)(uint64_t id);
+};
+
+extern struct orbit_api_v1 g_orbit_api_v1;
+extern ORBIT_EXPORT void* orbit_api_get_function_table_address_v1();
 
 // User needs to place "ORBIT_API_INSTANTIATE" in an implementation file.
 #define ORBIT_API_INSTANTIATE         \
-  struct orbit_api_v0 g_orbit_api_v0; \
-  void* orbit_api_get_function_table_address_v0() { return &g_orbit_api_v0; }
+  struct orbit_api_v1 g_orbit_api_v1; \
+  void* orbit_api_get_function_table_address_v1() { return &g_orbit_api_v1; }
 
 inline bool orbit_api_active() {
-  bool initialized = g_orbit_api_v0.initialized;
+  bool initialized = g_orbit_api_v1.initialized;
   ORBIT_THREAD_FENCE_ACQUIRE();
-  return initialized && g_orbit_api_v0.enabled;
+  return initialized && g_orbit_api_v1.enabled;
 }
 
 #define ORBIT_CALL(function_name, ...)                      \
   do {                                                      \
-    if (orbit_api_active() && g_orbit_api_v0.function_name) \
-      g_orbit_api_v0.function_name(__VA_ARGS__);            \
+    if (orbit_api_active() && g_orbit_api_v1.function_name) \
+      g_orbit_api_v1.function_name(__VA_ARGS__);            \
   } while (0)
 
 #ifdef __cplusplus
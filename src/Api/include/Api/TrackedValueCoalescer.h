@@ -0,0 +1,97 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef API_TRACKED_VALUE_COALESCER_H_
+#define API_TRACKED_VALUE_COALESCER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <stdint.h>
+
+#include <tuple>
+#include <utility>
+
+#include "Api/EncodedEvent.h"
+
+namespace orbit_api {
+
+// The calls that tracked the same value, coalesced into one sample. `latest` is the event of the
+// latest call. The values are encoded like CompactApiEvent::data.
+struct CoalescedTrackedValue {
+  CompactApiEvent latest;
+  uint64_t count = 0;
+  uint64_t min_data = 0;
+  uint64_t min_timestamp_ns = 0;
+  uint64_t max_data = 0;
+  uint64_t max_timestamp_ns = 0;
+};
+
+// Coalesces the events of tracked values (kTrackInt to kTrackDouble) with the same process, name
+// and type, so that a value tracked every frame or every job costs one sample per flush instead of
+// one event per call. The smallest and the largest value since the last flush are kept together
+// with the latest one, so that spikes still show up in the graph.
+class TrackedValueCoalescer {
+ public:
+  [[nodiscard]] static bool IsTrackedValue(EventType type) {
+    return type >= kTrackInt && type <= kTrackDouble;
+  }
+
+  // Returns false, and ignores the event, if it's not a tracked value.
+  bool Add(const CompactApiEvent& event) {
+    if (!IsTrackedValue(event.type)) return false;
+    auto [it, inserted] = coalesced_values_.try_emplace(
+        std::make_tuple(event.pid, event.name_key, static_cast<uint8_t>(event.type)));
+    CoalescedTrackedValue& value = it->second;
+    if (inserted || IsLess(event.type, event.data, value.min_data)) {
+      value.min_data = event.data;
+      value.min_timestamp_ns = event.timestamp_ns;
+    }
+    if (inserted || IsLess(event.type, value.max_data, event.data)) {
+      value.max_data = event.data;
+      value.max_timestamp_ns = event.timestamp_ns;
+    }
+    value.latest = event;
+    ++value.count;
+    return true;
+  }
+
+  [[nodiscard]] bool IsEmpty() const { return coalesced_values_.empty(); }
+
+  // Calls `consumer` with each CoalescedTrackedValue since the last call, then forgets them.
+  template <typename Consumer>
+  void Flush(Consumer&& consumer) {
+    for (const auto& [unused_key, value] : coalesced_values_) {
+      consumer(value);
+    }
+    coalesced_values_.clear();
+  }
+
+  void Clear() { coalesced_values_.clear(); }
+
+ private:
+  [[nodiscard]] static bool IsLess(EventType type, uint64_t lhs, uint64_t rhs) {
+    switch (type) {
+      case kTrackInt:
+        return Decode<int32_t>(lhs) < Decode<int32_t>(rhs);
+      case kTrackInt64:
+        return Decode<int64_t>(lhs) < Decode<int64_t>(rhs);
+      case kTrackUint:
+        return Decode<uint32_t>(lhs) < Decode<uint32_t>(rhs);
+      case kTrackUint64:
+        return lhs < rhs;
+      case kTrackFloat:
+        return Decode<float>(lhs) < Decode<float>(rhs);
+      case kTrackDouble:
+        return Decode<double>(lhs) < Decode<double>(rhs);
+      default:
+        return false;
+    }
+  }
+
+  absl::flat_hash_map<std::tuple<int32_t, uint64_t, uint8_t>, CoalescedTrackedValue>
+      coalesced_values_;
+};
+
+}  // namespace orbit_api
+
+#endif  // API_TRACKED_VALUE_COALESCER_H_
@@ -4,12 +4,18 @@
 
 #include "CaptureClient/ApiEventProcessor.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
 #include "OrbitBase/Logging.h"
 
 namespace orbit_capture_client {
 
 using orbit_client_protos::TimerInfo;
 using orbit_grpc_protos::ApiEvent;
+using orbit_grpc_protos::CompactApiEvent;
 
 ApiEventProcessor::ApiEventProcessor(CaptureListener* listener) : capture_listener_(listener) {
   CHECK(listener != nullptr);
@@ -17,7 +23,8 @@ ApiEventProcessor::ApiEventProcessor(CaptureListener* listener) : capture_listen
 
 static inline TimerInfo TimerInfoFromEncodedEvent(const orbit_api::EncodedEvent& encoded_event,
                                                   uint64_t start, uint64_t end, int32_t pid,
-                                                  int32_t tid, uint32_t depth) {
+                                                  int32_t tid, uint32_t depth,
+                                                  uint64_t name_key) {
   TimerInfo timer_info;
   timer_info.set_start(start);
   timer_info.set_end(end);
@@ -25,6 +32,7 @@ static inline TimerInfo TimerInfoFromEncodedEvent(const orbit_api::EncodedEvent&
   timer_info.set_thread_id(tid);
   timer_info.set_depth(depth);
   timer_info.set_type(TimerInfo::kApiEvent);
+  timer_info.set_user_data_key(name_key);
   timer_info.mutable_registers()->Reserve(6);
   timer_info.add_registers(encoded_event.args[0]);
   timer_info.add_registers(encoded_event.args[1]);
@@ -46,24 +54,75 @@ void ApiEventProcessor::ProcessApiEvent(const orbit_grpc_protos::ApiEvent& grpc_
   api_event.encoded_event.args[3] = grpc_api_event.r3();
   api_event.encoded_event.args[4] = grpc_api_event.r4();
   api_event.encoded_event.args[5] = grpc_api_event.r5();
-  ProcessApiEvent(api_event);
+  ProcessApiEvent(ApiEventWithNameKey{api_event, /*name_key=*/0});
 }
 
-void ApiEventProcessor::ProcessApiEvent(const orbit_api::ApiEvent& api_event) {
-  orbit_api::EventType event_type = api_event.Type();
+void ApiEventProcessor::ProcessCompactApiEvent(
+    const CompactApiEvent& compact_api_event,
+    const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool) {
+  const char* name = nullptr;
+  uint64_t name_key = compact_api_event.name_key();
+  if (name_key != 0) {
+    auto it = string_intern_pool.find(name_key);
+    if (it != string_intern_pool.end()) {
+      name = it->second.c_str();
+    } else {
+      ERROR("Unknown name key %u of CompactApiEvent", name_key);
+      name_key = 0;
+    }
+  }
+
+  const auto type = static_cast<orbit_api::EventType>(compact_api_event.type());
+  const auto color = static_cast<orbit_api_color>(compact_api_event.color());
+  if (compact_api_event.coalesced_count() == 0) {
+    orbit_api::ApiEvent api_event{compact_api_event.pid(),
+                                  compact_api_event.tid(),
+                                  compact_api_event.timestamp_ns(),
+                                  type,
+                                  name,
+                                  compact_api_event.data(),
+                                  color};
+    ProcessApiEvent(ApiEventWithNameKey{api_event, name_key});
+    return;
+  }
+
+  // A coalesced tracked value becomes the samples of its smallest, largest and latest values, in
+  // the order of their calls, so that the graph keeps the range of the values of the interval.
+  std::array<std::pair<uint64_t, uint64_t>, 3> timestamps_and_data{
+      {{compact_api_event.coalesced_min_timestamp_ns(), compact_api_event.coalesced_min_data()},
+       {compact_api_event.coalesced_max_timestamp_ns(), compact_api_event.coalesced_max_data()},
+       {compact_api_event.timestamp_ns(), compact_api_event.data()}}};
+  std::sort(timestamps_and_data.begin(), timestamps_and_data.end());
+  for (size_t i = 0; i < timestamps_and_data.size(); ++i) {
+    const auto& [timestamp_ns, data] = timestamps_and_data[i];
+    // The same call can be the smallest, the largest and the latest.
+    if (i > 0 && timestamp_ns == timestamps_and_data[i - 1].first) continue;
+    orbit_api::ApiEvent api_event{compact_api_event.pid(),
+                                  compact_api_event.tid(),
+                                  timestamp_ns,
+                                  type,
+                                  name,
+                                  data,
+                                  color};
+    ProcessApiEvent(ApiEventWithNameKey{api_event, name_key});
+  }
+}
+
+void ApiEventProcessor::ProcessApiEvent(const ApiEventWithNameKey& event) {
+  orbit_api::EventType event_type = event.api_event.Type();
 
   switch (event_type) {
     case orbit_api::kScopeStart:
-      ProcessStartEvent(api_event);
+      ProcessStartEvent(event);
       break;
     case orbit_api::kScopeStop:
-      ProcessStopEvent(api_event);
+      ProcessStopEvent(event);
       break;
     case orbit_api::kScopeStartAsync:
-      ProcessAsyncStartEvent(api_event);
+      ProcessAsyncStartEvent(event);
       break;
     case orbit_api::kScopeStopAsync:
-      ProcessAsyncStopEvent(api_event);
+      ProcessAsyncStopEvent(event);
       break;
     case orbit_api::kTrackInt:
     case orbit_api::kTrackInt64:
@@ -72,39 +131,79 @@ void ApiEventProcessor::ProcessApiEvent(const orbit_api::ApiEvent& api_event) {
     case orbit_api::kTrackFloat:
     case orbit_api::kTrackDouble:
     case orbit_api::kString:
-      ProcessTrackingEvent(api_event);
+      ProcessTrackingEvent(event);
+      break;
+    case orbit_api::kFiberSwitchIn:
+      ProcessFiberSwitchInEvent(event);
+      break;
+    case orbit_api::kFiberSwitchOut:
+      ProcessFiberSwitchOutEvent(event);
       break;
     case orbit_api::kNone:
       UNREACHABLE();
   }
 }
 
-void ApiEventProcessor::ProcessStartEvent(const orbit_api::ApiEvent& api_event) {
-  synchronous_event_stack_by_tid_[api_event.tid].emplace_back(api_event);
+uint64_t ApiEventProcessor::GetCurrentFiberId(int32_t tid) const {
+  auto fiber_id_it = current_fiber_id_by_tid_.find(tid);
+  return fiber_id_it != current_fiber_id_by_tid_.end() ? fiber_id_it->second : 0;
 }
 
-void ApiEventProcessor::ProcessStopEvent(const orbit_api::ApiEvent& stop_event) {
-  std::vector<orbit_api::ApiEvent>& event_stack = synchronous_event_stack_by_tid_[stop_event.tid];
+std::vector<ApiEventProcessor::ApiEventWithNameKey>& ApiEventProcessor::GetSynchronousEventStack(
+    int32_t tid, uint64_t fiber_id) {
+  if (fiber_id != 0) return synchronous_event_stack_by_fiber_id_[fiber_id];
+  return synchronous_event_stack_by_tid_[tid];
+}
+
+void ApiEventProcessor::ProcessStartEvent(const ApiEventWithNameKey& event) {
+  const int32_t tid = event.api_event.tid;
+  GetSynchronousEventStack(tid, GetCurrentFiberId(tid)).emplace_back(event);
+}
+
+void ApiEventProcessor::ProcessStopEvent(const ApiEventWithNameKey& event) {
+  const orbit_api::ApiEvent& stop_event = event.api_event;
+  const uint64_t fiber_id = GetCurrentFiberId(stop_event.tid);
+  std::vector<ApiEventWithNameKey>& event_stack =
+      GetSynchronousEventStack(stop_event.tid, fiber_id);
   if (event_stack.empty()) {
     // We received a stop event with no matching start event, which is possible if the capture was
     // started between the event's start and stop times.
     return;
   }
 
-  const orbit_api::ApiEvent& start_event = event_stack.back();
+  const ApiEventWithNameKey& start_event = event_stack.back();
   TimerInfo timer_info = TimerInfoFromEncodedEvent(
-      start_event.encoded_event, start_event.timestamp_ns, stop_event.timestamp_ns, stop_event.pid,
-      stop_event.tid, /*depth=*/event_stack.size() - 1);
+      start_event.api_event.encoded_event, start_event.api_event.timestamp_ns,
+      stop_event.timestamp_ns, stop_event.pid, stop_event.tid,
+      /*depth=*/event_stack.size() - 1, start_event.name_key);
+  timer_info.set_fiber_id(fiber_id);
   capture_listener_->OnTimer(timer_info);
   event_stack.pop_back();
 }
 
-void ApiEventProcessor::ProcessAsyncStartEvent(const orbit_api::ApiEvent& start_event) {
-  const uint64_t event_id = start_event.encoded_event.event.data;
-  asynchronous_events_by_id_[event_id] = start_event;
+void ApiEventProcessor::ProcessFiberSwitchInEvent(const ApiEventWithNameKey& event) {
+  const orbit_api::ApiEvent& api_event = event.api_event;
+  const uint64_t fiber_id = api_event.encoded_event.event.data;
+  if (fiber_id == 0) {
+    ERROR("Switch of thread %d to fiber with invalid id 0", api_event.tid);
+    return;
+  }
+  current_fiber_id_by_tid_[api_event.tid] = fiber_id;
 }
 
-void ApiEventProcessor::ProcessAsyncStopEvent(const orbit_api::ApiEvent& stop_event) {
+void ApiEventProcessor::ProcessFiberSwitchOutEvent(const ApiEventWithNameKey& event) {
+  // The switch in might have happened before the capture started, and the switch out is only
+  // expected to be for the fiber the thread is on, so the thread leaves any fiber.
+  current_fiber_id_by_tid_.erase(event.api_event.tid);
+}
+
+void ApiEventProcessor::ProcessAsyncStartEvent(const ApiEventWithNameKey& event) {
+  const uint64_t event_id = event.api_event.encoded_event.event.data;
+  asynchronous_events_by_id_[event_id] = event;
+}
+
+void ApiEventProcessor::ProcessAsyncStopEvent(const ApiEventWithNameKey& event) {
+  const orbit_api::ApiEvent& stop_event = event.api_event;
   const uint64_t event_id = stop_event.encoded_event.event.data;
   if (asynchronous_events_by_id_.count(event_id) == 0) {
     // We received a stop event with no matching start event, which is possible if the capture was
@@ -112,19 +211,20 @@ void ApiEventProcessor::ProcessAsyncStopEvent(const orbit_api::ApiEvent& stop_ev
     return;
   }
 
-  orbit_api::ApiEvent& start_event = asynchronous_events_by_id_[event_id];
+  ApiEventWithNameKey& start_event = asynchronous_events_by_id_[event_id];
   TimerInfo timer_info = TimerInfoFromEncodedEvent(
-      start_event.encoded_event, start_event.timestamp_ns, stop_event.timestamp_ns, stop_event.pid,
-      stop_event.tid, /*depth=*/0);
+      start_event.api_event.encoded_event, start_event.api_event.timestamp_ns,
+      stop_event.timestamp_ns, stop_event.pid, stop_event.tid, /*depth=*/0, start_event.name_key);
   capture_listener_->OnTimer(timer_info);
 
   asynchronous_events_by_id_.erase(event_id);
 }
 
-void ApiEventProcessor::ProcessTrackingEvent(const orbit_api::ApiEvent& api_event) {
-  TimerInfo timer_info =
-      TimerInfoFromEncodedEvent(api_event.encoded_event, api_event.timestamp_ns,
-                                api_event.timestamp_ns, api_event.pid, api_event.tid, /*depth=*/0);
+void ApiEventProcessor::ProcessTrackingEvent(const ApiEventWithNameKey& event) {
+  const orbit_api::ApiEvent& api_event = event.api_event;
+  TimerInfo timer_info = TimerInfoFromEncodedEvent(
+      api_event.encoded_event, api_event.timestamp_ns, api_event.timestamp_ns, api_event.pid,
+      api_event.tid, /*depth=*/0, event.name_key);
   capture_listener_->OnTimer(timer_info);
 }
 
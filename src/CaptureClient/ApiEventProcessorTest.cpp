@@ -2,9 +2,14 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <absl/container/flat_hash_map.h>
+
 #include <algorithm>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "CaptureClient/ApiEventProcessor.h"
@@ -21,6 +26,7 @@ using orbit_client_protos::TimerInfo;
 
 using orbit_grpc_protos::ApiEvent;
 using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::CompactApiEvent;
 
 namespace {
 
@@ -36,9 +42,9 @@ class EmptyCaptureListener : public CaptureListener {
   void OnUniqueCallstack(uint64_t /*callstack_id*/, CallstackInfo /*callstack*/) override {}
   void OnCallstackEvent(orbit_client_protos::CallstackEvent /*callstack_event*/) override {}
   void OnThreadName(int32_t /*thread_id*/, std::string /*thread_name*/) override {}
-  void OnModuleUpdate(uint64_t /*timestamp_ns*/,
+  void OnModuleUpdate(int32_t /*pid*/, uint64_t /*timestamp_ns*/,
                       orbit_grpc_protos::ModuleInfo /*module_info*/) override {}
-  void OnModulesSnapshot(uint64_t /*timestamp_ns*/,
+  void OnModulesSnapshot(int32_t /*pid*/, uint64_t /*timestamp_ns*/,
                          std::vector<orbit_grpc_protos::ModuleInfo> /*module_infos*/) override {}
   void OnThreadStateSlice(
       orbit_client_protos::ThreadStateSliceInfo /*thread_state_slice*/) override {}
@@ -50,6 +56,8 @@ class EmptyCaptureListener : public CaptureListener {
   void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {}
   void OnClockResolutionEvent(
       orbit_grpc_protos::ClockResolutionEvent /*clock_resolution_event*/) override {}
+  void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent /*capture_start_latency_event*/) override {}
   void OnErrorsWithPerfEventOpenEvent(
       orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/)
       override {}
@@ -59,6 +67,12 @@ class EmptyCaptureListener : public CaptureListener {
       orbit_grpc_protos::LostPerfRecordsEvent /*lost_perf_records_event*/) override {}
   void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
                                         /*out_of_order_events_discarded_event*/) override {}
+  void OnSamplingPeriodChangedEvent(orbit_grpc_protos::SamplingPeriodChangedEvent
+                                    /*sampling_period_changed_event*/) override {}
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/) override {}
+  void OnFunctionStats(uint64_t /*function_id*/,
+                       orbit_client_protos::FunctionStats /*stats*/) override {}
 };
 
 // Test CaptureListener used to validate TimerInfo data produced by api events.
@@ -103,6 +117,14 @@ class ApiTester {
     EnqueueApiEvent(orbit_api::kTrackUint64, name, value, color);
     return *this;
   }
+  ApiTester& FiberSwitchIn(uint64_t id) {
+    EnqueueApiEvent(orbit_api::kFiberSwitchIn, /*name=*/nullptr, id);
+    return *this;
+  }
+  ApiTester& FiberSwitchOut(uint64_t id) {
+    EnqueueApiEvent(orbit_api::kFiberSwitchOut, /*name=*/nullptr, id);
+    return *this;
+  }
 
   ApiTester& ExpectNumTimers(size_t num_timers) {
     EXPECT_EQ(api_event_listener_.timers_.size(), num_timers);
@@ -132,6 +154,21 @@ class ApiTester {
     return *this;
   }
 
+  ApiTester& ExpectLastTimer(const char* name, uint64_t fiber_id, uint32_t depth) {
+    for (const std::vector<TimerInfo>* timers :
+         {&api_event_listener_.timers_, &capture_event_listener_.timers_}) {
+      if (timers->empty()) {
+        ADD_FAILURE() << "No timers";
+        continue;
+      }
+      const TimerInfo& timer_info = timers->back();
+      EXPECT_EQ(std::string(ApiEventFromTimerInfo(timer_info).name), name);
+      EXPECT_EQ(timer_info.fiber_id(), fiber_id);
+      EXPECT_EQ(timer_info.depth(), depth);
+    }
+    return *this;
+  }
+
  private:
   void EnqueueApiEvent(orbit_api::EventType type, const char* name = nullptr, uint64_t data = 0,
                        orbit_api_color color = kOrbitColorAuto) {
@@ -259,6 +296,135 @@ TEST(ApiEventProcessor, MixedEvents) {
   api.Stop().ExpectNumTimers(7).ExpectNumScopeTimers(3);
 }
 
+TEST(ApiEventProcessor, ScopesOnFibers) {
+  constexpr uint64_t kFiberA = 1;
+  constexpr uint64_t kFiberB = 2;
+  ApiTester api;
+  api.Start("ThreadScope").FiberSwitchIn(kFiberA);
+  api.Start("FiberAScope0").Start("FiberAScope1");
+  api.Stop().ExpectLastTimer("FiberAScope1", kFiberA, 1);
+  // Fiber A is suspended, in FiberAScope0, while the thread runs fiber B.
+  api.FiberSwitchOut(kFiberA).FiberSwitchIn(kFiberB);
+  api.Start("FiberBScope").Stop().ExpectLastTimer("FiberBScope", kFiberB, 0);
+  api.FiberSwitchOut(kFiberB).FiberSwitchIn(kFiberA);
+  api.Stop().ExpectLastTimer("FiberAScope0", kFiberA, 0).FiberSwitchOut(kFiberA);
+  // Outside of fibers, scopes are nested per thread again.
+  api.Stop().ExpectLastTimer("ThreadScope", 0, 0).ExpectNumTimers(4);
+}
+
+TEST(ApiEventProcessor, FiberSwitchInWithInvalidIdIsIgnored) {
+  ApiTester api;
+  api.FiberSwitchIn(0).Start("Scope").Stop().ExpectLastTimer("Scope", 0, 0);
+}
+
+TEST(ApiEventProcessor, CompactApiEventsWithInternedNames) {
+  constexpr uint64_t kNameKey = 42;
+  const std::string kLongName = "ALongScopeNameThatDoesNotFitInAnEncodedEvent";
+  ASSERT_GE(kLongName.size(), orbit_api::kMaxEventStringSize);
+  constexpr int32_t kPid = 1;
+  constexpr int32_t kTid = 2;
+  constexpr uint64_t kStartTimestampNs = 100;
+  constexpr uint64_t kStopTimestampNs = 200;
+
+  std::vector<ClientCaptureEvent> events(3);
+  events[0].mutable_interned_string()->set_key(kNameKey);
+  events[0].mutable_interned_string()->set_intern(kLongName);
+  CompactApiEvent* start_event = events[1].mutable_compact_api_event();
+  start_event->set_pid(kPid);
+  start_event->set_tid(kTid);
+  start_event->set_timestamp_ns(kStartTimestampNs);
+  start_event->set_type(orbit_api::kScopeStart);
+  start_event->set_name_key(kNameKey);
+  start_event->set_color(kOrbitColorRed);
+  CompactApiEvent* stop_event = events[2].mutable_compact_api_event();
+  stop_event->set_pid(kPid);
+  stop_event->set_tid(kTid);
+  stop_event->set_timestamp_ns(kStopTimestampNs);
+  stop_event->set_type(orbit_api::kScopeStop);
+
+  // ApiEventProcessor in isolation.
+  ApiEventCaptureListener api_event_listener;
+  ApiEventProcessor api_event_processor{&api_event_listener};
+  const absl::flat_hash_map<uint64_t, std::string> string_intern_pool{{kNameKey, kLongName}};
+  api_event_processor.ProcessCompactApiEvent(events[1].compact_api_event(), string_intern_pool);
+  api_event_processor.ProcessCompactApiEvent(events[2].compact_api_event(), string_intern_pool);
+
+  // ApiEventProcessor as part of a CaptureEventProcessor.
+  ApiEventCaptureListener capture_event_listener;
+  std::unique_ptr<CaptureEventProcessor> capture_event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&capture_event_listener, std::nullopt, {});
+  for (const ClientCaptureEvent& event : events) {
+    capture_event_processor->ProcessEvent(event);
+  }
+
+  for (const std::vector<TimerInfo>* timers :
+       {&api_event_listener.timers_, &capture_event_listener.timers_}) {
+    ASSERT_EQ(timers->size(), 1);
+    const TimerInfo& timer_info = timers->front();
+    EXPECT_EQ(timer_info.type(), TimerInfo::kApiEvent);
+    EXPECT_EQ(timer_info.process_id(), kPid);
+    EXPECT_EQ(timer_info.thread_id(), kTid);
+    EXPECT_EQ(timer_info.start(), kStartTimestampNs);
+    EXPECT_EQ(timer_info.end(), kStopTimestampNs);
+    EXPECT_EQ(timer_info.depth(), 0);
+    EXPECT_EQ(timer_info.user_data_key(), kNameKey);
+
+    ASSERT_EQ(timer_info.registers_size(), 6);
+    orbit_api::EncodedEvent encoded_event(
+        timer_info.registers(0), timer_info.registers(1), timer_info.registers(2),
+        timer_info.registers(3), timer_info.registers(4), timer_info.registers(5));
+    EXPECT_EQ(encoded_event.Type(), orbit_api::kScopeStart);
+    EXPECT_EQ(encoded_event.event.color, kOrbitColorRed);
+    // The name in the registers is truncated, the full name is the interned string.
+    EXPECT_EQ(std::string(encoded_event.event.name),
+              kLongName.substr(0, orbit_api::kMaxEventStringSize - 1));
+  }
+}
+
+TEST(ApiEventProcessor, CoalescedTrackedValueBecomesTheSamplesOfItsMinMaxAndLatestValues) {
+  constexpr uint64_t kNameKey = 42;
+  const absl::flat_hash_map<uint64_t, std::string> string_intern_pool{{kNameKey, "Value"}};
+  ApiEventCaptureListener api_event_listener;
+  ApiEventProcessor api_event_processor{&api_event_listener};
+
+  CompactApiEvent coalesced_event;
+  coalesced_event.set_pid(1);
+  coalesced_event.set_tid(2);
+  coalesced_event.set_type(orbit_api::kTrackInt);
+  coalesced_event.set_name_key(kNameKey);
+  coalesced_event.set_timestamp_ns(300);
+  coalesced_event.set_data(orbit_api::Encode<uint64_t>(5));
+  coalesced_event.set_coalesced_count(10);
+  coalesced_event.set_coalesced_min_timestamp_ns(200);
+  coalesced_event.set_coalesced_min_data(orbit_api::Encode<uint64_t>(-3));
+  coalesced_event.set_coalesced_max_timestamp_ns(100);
+  coalesced_event.set_coalesced_max_data(orbit_api::Encode<uint64_t>(7));
+  api_event_processor.ProcessCompactApiEvent(coalesced_event, string_intern_pool);
+
+  // The latest value is also the largest one.
+  coalesced_event.set_timestamp_ns(500);
+  coalesced_event.set_coalesced_min_timestamp_ns(400);
+  coalesced_event.set_coalesced_max_timestamp_ns(500);
+  coalesced_event.set_coalesced_max_data(orbit_api::Encode<uint64_t>(5));
+  api_event_processor.ProcessCompactApiEvent(coalesced_event, string_intern_pool);
+
+  using TimestampAndValue = std::pair<uint64_t, int32_t>;
+  std::vector<TimestampAndValue> timestamps_and_values;
+  for (const TimerInfo& timer_info : api_event_listener.timers_) {
+    orbit_api::EncodedEvent encoded_event(
+        timer_info.registers(0), timer_info.registers(1), timer_info.registers(2),
+        timer_info.registers(3), timer_info.registers(4), timer_info.registers(5));
+    EXPECT_EQ(encoded_event.Type(), orbit_api::kTrackInt);
+    EXPECT_EQ(timer_info.user_data_key(), kNameKey);
+    timestamps_and_values.emplace_back(timer_info.start(),
+                                       orbit_api::Decode<int32_t>(encoded_event.event.data));
+  }
+  EXPECT_THAT(timestamps_and_values,
+              testing::ElementsAre(TimestampAndValue{100, 7}, TimestampAndValue{200, -3},
+                                   TimestampAndValue{300, 5}, TimestampAndValue{400, -3},
+                                   TimestampAndValue{500, 5}));
+}
+
 }  // namespace
 
 }  // namespace orbit_capture_client
@@ -9,21 +9,32 @@
 #include <absl/flags/flag.h>
 #include <absl/strings/str_format.h>
 #include <absl/time/time.h>
+#include <google/protobuf/arena.h>
 
+#include <chrono>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
 #include <outcome.hpp>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureClient/CaptureListener.h"
+#include "CaptureClient/ClockOffset.h"
 #include "ClientData/FunctionUtils.h"
 #include "ClientData/ModuleData.h"
 #include "Introspection/Introspection.h"
 #include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/Profiling.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "capture.pb.h"
 #include "tracepoint.pb.h"
 
@@ -45,6 +56,109 @@ using orbit_grpc_protos::UnwindingMethod;
 
 using orbit_base::Future;
 
+namespace {
+
+// Number of integer parameter registers in the System V calling convention.
+constexpr uint32_t kIntegerArgumentCount = 6;
+
+// A CaptureResponse allocated in its own Arena, together with the first block of that Arena. The
+// gRPC stream parses the response into the Arena, so that its many small messages don't need a
+// heap allocation each. Resetting the Arena keeps the first block, so that the parsing of the next
+// response reuses the same memory.
+class ArenaCaptureResponse {
+ public:
+  ArenaCaptureResponse()
+      : arena_initial_block_{make_unique_for_overwrite<char[]>(kArenaInitialBlockSize)},
+        arena_{CreateArenaOptions(arena_initial_block_.get())},
+        response_{google::protobuf::Arena::CreateMessage<CaptureResponse>(&arena_)} {}
+
+  [[nodiscard]] CaptureResponse* response() { return response_; }
+
+  void Reset() {
+    arena_.Reset();
+    response_ = google::protobuf::Arena::CreateMessage<CaptureResponse>(&arena_);
+  }
+
+ private:
+  [[nodiscard]] static google::protobuf::ArenaOptions CreateArenaOptions(char* initial_block) {
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.initial_block = initial_block;
+    arena_options.initial_block_size = kArenaInitialBlockSize;
+    return arena_options;
+  }
+
+  static constexpr size_t kArenaInitialBlockSize = 1024 * 1024;
+
+  std::unique_ptr<char[]> arena_initial_block_;
+  google::protobuf::Arena arena_;
+  CaptureResponse* response_;
+};
+
+// Hands the CaptureResponses over from the thread reading them from the gRPC stream, which also
+// parses and possibly decompresses them, to the thread processing their events. Push blocks while
+// the queue is full, so that the flow control of the stream still applies when the processing
+// can't keep up. The processed responses are handed back with Recycle, so that only a bounded
+// number of ArenaCaptureResponses is ever allocated.
+class CaptureResponseQueue {
+ public:
+  // Returns an empty response to read the next CaptureResponse into.
+  [[nodiscard]] std::unique_ptr<ArenaCaptureResponse> Acquire() {
+    {
+      absl::MutexLock lock{&mutex_};
+      if (!recycled_responses_.empty()) {
+        std::unique_ptr<ArenaCaptureResponse> response = std::move(recycled_responses_.back());
+        recycled_responses_.pop_back();
+        return response;
+      }
+    }
+    return std::make_unique<ArenaCaptureResponse>();
+  }
+
+  void Push(std::unique_ptr<ArenaCaptureResponse> response) {
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(this, &CaptureResponseQueue::IsNotFull));
+    responses_.emplace_back(std::move(response));
+  }
+
+  // Returns nullptr once the queue is empty and closed.
+  [[nodiscard]] std::unique_ptr<ArenaCaptureResponse> Pop() {
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(this, &CaptureResponseQueue::IsNotEmptyOrClosed));
+    if (responses_.empty()) return nullptr;
+    std::unique_ptr<ArenaCaptureResponse> response = std::move(responses_.front());
+    responses_.pop_front();
+    return response;
+  }
+
+  void Recycle(std::unique_ptr<ArenaCaptureResponse> response) {
+    response->Reset();
+    absl::MutexLock lock{&mutex_};
+    recycled_responses_.emplace_back(std::move(response));
+  }
+
+  void Close() {
+    absl::MutexLock lock{&mutex_};
+    closed_ = true;
+  }
+
+ private:
+  [[nodiscard]] bool IsNotFull() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return responses_.size() < kMaxResponseCount;
+  }
+  [[nodiscard]] bool IsNotEmptyOrClosed() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !responses_.empty() || closed_;
+  }
+
+  static constexpr size_t kMaxResponseCount = 16;
+
+  absl::Mutex mutex_;
+  std::deque<std::unique_ptr<ArenaCaptureResponse>> responses_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<ArenaCaptureResponse>> recycled_responses_ ABSL_GUARDED_BY(mutex_);
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace
+
 InstrumentedFunction::FunctionType CaptureClient::InstrumentedFunctionTypeFromOrbitType(
     FunctionInfo::OrbitType orbit_type) {
   switch (orbit_type) {
@@ -186,9 +300,24 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
     instrumented_function->set_file_build_id(function.module_build_id());
     instrumented_function->set_function_id(function_id);
     instrumented_function->set_function_size(function.size());
-    instrumented_function->set_function_name(function.pretty_name());
+    instrumented_function->set_function_name(
+        orbit_client_data::function_utils::GetDisplayName(function));
     instrumented_function->set_function_type(
         InstrumentedFunctionTypeFromOrbitType(function.orbit_type()));
+    if (function.orbit_type() == FunctionInfo::kNone) {
+      *instrumented_function->mutable_recorded_argument_indices() =
+          function.recorded_argument_indices();
+      instrumented_function->set_record_return_value(function.record_return_value());
+      instrumented_function->set_aggregate_latency_in_kernel(
+          function.aggregate_latency_in_kernel());
+    } else {
+      // The deprecated manual instrumentation functions pass their data in all the arguments and
+      // the return value.
+      for (uint32_t argument_index = 0; argument_index < kIntegerArgumentCount; ++argument_index) {
+        instrumented_function->add_recorded_argument_indices(argument_index);
+      }
+      instrumented_function->set_record_return_value(true);
+    }
     instrumented_functions.insert_or_assign(function_id, *instrumented_function);
   }
 
@@ -198,6 +327,22 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
     instrumented_tracepoint->set_name(tracepoint.name());
   }
 
+  capture_options->set_capture_response_compression(capture_response_compression_);
+  capture_options->set_save_capture_file_on_service(save_capture_file_on_service_);
+  capture_options->set_flight_recorder_window_ns(flight_recorder_window_ns_);
+  capture_options->set_collect_gpu_pipeline_statistics(collect_gpu_pipeline_statistics_);
+  capture_options->set_sample_process_memory_with_perf_events(
+      sample_process_memory_with_perf_events_);
+  capture_options->set_collect_memory_callstacks(collect_memory_callstacks_);
+  capture_options->set_collect_kernel_callstacks(collect_kernel_callstacks_);
+  capture_options->set_pipeline_latency_probe_period(pipeline_latency_probe_period_);
+  capture_options->set_statistics_summary_interval_ns(statistics_summary_interval_ns_);
+  capture_options->set_api_track_value_coalescing_interval_ms(
+      api_track_value_coalescing_interval_ms_);
+  capture_options->set_compensate_instrumentation_overhead(compensate_instrumentation_overhead_);
+  // CaptureEventProcessor understands the batches, so always ask for them.
+  capture_options->set_send_columnar_event_batches(true);
+
   capture_options->set_enable_api(enable_api);
   capture_options->set_enable_introspection(enable_introspection);
   capture_options->set_enable_user_space_instrumentation(enable_user_space_instrumentation);
@@ -223,19 +368,41 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
   }
   LOG("Sent CaptureRequest on Capture's gRPC stream: asking to start capturing");
 
+  // The events are processed on a separate thread, so that reading the next CaptureResponses from
+  // the stream overlaps with processing the events of the previous ones.
+  CaptureResponseQueue response_queue;
+  std::thread processing_thread{[this, capture_event_processor, &response_queue] {
+    orbit_base::SetCurrentThreadName("CaptureEvents");
+    while (std::unique_ptr<ArenaCaptureResponse> response = response_queue.Pop()) {
+      ProcessEvents(capture_event_processor, response->response()->capture_events());
+      response_queue.Recycle(std::move(response));
+    }
+  }};
+
   while (!writes_done_failed_ && !try_abort_) {
-    CaptureResponse response;
+    std::unique_ptr<ArenaCaptureResponse> response = response_queue.Acquire();
     bool read_succeeded;
     {
       absl::ReaderMutexLock lock{&context_and_stream_mutex_};
-      read_succeeded = reader_writer_->Read(&response);
+      read_succeeded = reader_writer_->Read(response->response());
     }
     if (read_succeeded) {
-      ProcessEvents(capture_event_processor, response.capture_events());
+      if (pipeline_latency_probe_period_ != 0) {
+        const uint64_t received_timestamp_ns = orbit_base::CaptureTimestampNs();
+        for (ClientCaptureEvent& event : *response->response()->mutable_capture_events()) {
+          if (event.event_case() == ClientCaptureEvent::kPipelineLatencyProbe) {
+            event.mutable_pipeline_latency_probe()->set_received_timestamp_ns(
+                received_timestamp_ns);
+          }
+        }
+      }
+      response_queue.Push(std::move(response));
     } else {
       break;
     }
   }
+  response_queue.Close();
+  processing_thread.join();
 
   ErrorMessageOr<void> finish_result = FinishCapture();
   if (try_abort_) {
@@ -298,6 +465,36 @@ bool CaptureClient::StopCapture() {
   return true;
 }
 
+bool CaptureClient::RequestFlightRecorderSnapshot() {
+  if (!IsFlightRecorderEnabled()) {
+    ERROR("Flight recorder snapshot requested, but the flight recorder is not enabled");
+    return false;
+  }
+
+  // Keep holding state_mutex_ while writing, so that StopCapture can't call WritesDone
+  // concurrently with this Write.
+  absl::MutexLock state_lock(&state_mutex_);
+  if (state_ != State::kStarted) {
+    LOG("RequestFlightRecorderSnapshot ignored, because the capture is not started");
+    return false;
+  }
+
+  CaptureRequest request;
+  request.set_send_flight_recorder_snapshot(true);
+  bool write_succeeded;
+  {
+    absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+    CHECK(reader_writer_ != nullptr);
+    write_succeeded = reader_writer_->Write(request);
+  }
+  if (!write_succeeded) {
+    ERROR("Sending flight recorder snapshot request on Capture's gRPC stream");
+    return false;
+  }
+  LOG("Requested flight recorder snapshot");
+  return true;
+}
+
 bool CaptureClient::AbortCaptureAndWait(int64_t max_wait_ms) {
   {
     absl::ReaderMutexLock lock{&context_and_stream_mutex_};
@@ -322,6 +519,56 @@ bool CaptureClient::AbortCaptureAndWait(int64_t max_wait_ms) {
   return true;
 }
 
+ErrorMessageOr<ClockOffset> CaptureClient::EstimateClockOffset(int sample_count) {
+  constexpr uint64_t kClockSyncTimeoutMs = 1000;
+  std::vector<ClockSyncSample> samples;
+  samples.reserve(sample_count);
+  for (int i = 0; i < sample_count; ++i) {
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::milliseconds(kClockSyncTimeoutMs));
+    orbit_grpc_protos::GetCaptureTimestampRequest request;
+    orbit_grpc_protos::GetCaptureTimestampResponse response;
+    ClockSyncSample sample;
+    sample.client_send_timestamp_ns = orbit_base::CaptureTimestampNs();
+    grpc::Status status = capture_service_->GetCaptureTimestamp(&context, request, &response);
+    sample.client_receive_timestamp_ns = orbit_base::CaptureTimestampNs();
+    if (!status.ok()) {
+      ERROR("gRPC call to GetCaptureTimestamp failed: %s (error_code=%d)", status.error_message(),
+            status.error_code());
+      return ErrorMessage(status.error_message());
+    }
+    sample.service_timestamp_ns = response.timestamp_ns();
+    samples.push_back(sample);
+  }
+
+  std::optional<ClockOffset> clock_offset = orbit_capture_client::EstimateClockOffset(samples);
+  if (!clock_offset.has_value()) {
+    return ErrorMessage("Could not estimate the clock offset of the service.");
+  }
+  LOG("Estimated clock offset of the service: %d ns (+/- %u ns)", clock_offset->offset_ns,
+      clock_offset->max_error_ns);
+  return clock_offset.value();
+}
+
+ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>>
+CaptureClient::ListContinuousCaptureFiles() {
+  constexpr uint64_t kListContinuousCaptureFilesTimeoutMs = 5000;
+  grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() +
+                       std::chrono::milliseconds(kListContinuousCaptureFilesTimeoutMs));
+  orbit_grpc_protos::ListContinuousCaptureFilesRequest request;
+  orbit_grpc_protos::ListContinuousCaptureFilesResponse response;
+  grpc::Status status = capture_service_->ListContinuousCaptureFiles(&context, request, &response);
+  if (!status.ok()) {
+    ERROR("gRPC call to ListContinuousCaptureFiles failed: %s (error_code=%d)",
+          status.error_message(), status.error_code());
+    return ErrorMessage(status.error_message());
+  }
+  return std::vector<orbit_grpc_protos::ContinuousCaptureFile>(response.files().begin(),
+                                                               response.files().end());
+}
+
 ErrorMessageOr<void> CaptureClient::FinishCapture() {
   ORBIT_SCOPE_FUNCTION;
 
@@ -13,6 +13,7 @@
 
 #include "CaptureClient/ApiEventProcessor.h"
 #include "CaptureClient/GpuQueueSubmissionProcessor.h"
+#include "ClientData/FunctionStatsUtils.h"
 #include "GrpcProtos/Constants.h"
 #include "OrbitBase/Logging.h"
 #include "capture_data.pb.h"
@@ -28,14 +29,17 @@ using orbit_client_protos::TimerInfo;
 using orbit_grpc_protos::AddressInfo;
 using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CallstackSampleBatch;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallBatch;
 using orbit_grpc_protos::GpuJob;
 using orbit_grpc_protos::GpuQueueSubmission;
 using orbit_grpc_protos::InternedCallstack;
 using orbit_grpc_protos::InternedString;
 using orbit_grpc_protos::IntrospectionScope;
 using orbit_grpc_protos::SchedulingSlice;
+using orbit_grpc_protos::SchedulingSliceBatch;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadStateSlice;
 
@@ -57,9 +61,14 @@ class CaptureEventProcessorForListener : public CaptureEventProcessor {
   void ProcessCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture_started);
   void ProcessCaptureFinished(const orbit_grpc_protos::CaptureFinished& capture_finished);
   void ProcessSchedulingSlice(const orbit_grpc_protos::SchedulingSlice& scheduling_slice);
+  void ProcessSchedulingSliceBatch(
+      const orbit_grpc_protos::SchedulingSliceBatch& scheduling_slice_batch);
   void ProcessInternedCallstack(orbit_grpc_protos::InternedCallstack interned_callstack);
   void ProcessCallstackSample(const orbit_grpc_protos::CallstackSample& callstack_sample);
+  void ProcessCallstackSampleBatch(
+      const orbit_grpc_protos::CallstackSampleBatch& callstack_sample_batch);
   void ProcessFunctionCall(const orbit_grpc_protos::FunctionCall& function_call);
+  void ProcessFunctionCallBatch(const orbit_grpc_protos::FunctionCallBatch& function_call_batch);
   void ProcessIntrospectionScope(const orbit_grpc_protos::IntrospectionScope& introspection_scope);
   void ProcessInternedString(orbit_grpc_protos::InternedString interned_string);
   void ProcessModuleUpdate(orbit_grpc_protos::ModuleUpdateEvent module_update);
@@ -85,6 +94,13 @@ class CaptureEventProcessorForListener : public CaptureEventProcessor {
       const orbit_grpc_protos::LostPerfRecordsEvent& lost_perf_records_event);
   void ProcessOutOfOrderEventsDiscardedEvent(
       const orbit_grpc_protos::OutOfOrderEventsDiscardedEvent& out_of_order_events_discarded_event);
+  void ProcessSamplingPeriodChangedEvent(
+      const orbit_grpc_protos::SamplingPeriodChangedEvent& sampling_period_changed_event);
+  void ProcessPmuCountersSample(const orbit_grpc_protos::PmuCountersSample& pmu_counters_sample);
+  void ProcessServiceHealthEvent(
+      const orbit_grpc_protos::ServiceHealthEvent& service_health_event);
+  void ProcessCaptureStatisticsSummary(
+      const orbit_grpc_protos::CaptureStatisticsSummary& capture_statistics_summary);
 
   void ProcessMemoryUsageEvent(const orbit_grpc_protos::MemoryUsageEvent& memory_usage_event);
   void ExtractAndProcessSystemMemoryTrackingTimer(
@@ -125,15 +141,24 @@ void CaptureEventProcessorForListener::ProcessEvent(const ClientCaptureEvent& ev
     case ClientCaptureEvent::kSchedulingSlice:
       ProcessSchedulingSlice(event.scheduling_slice());
       break;
+    case ClientCaptureEvent::kSchedulingSliceBatch:
+      ProcessSchedulingSliceBatch(event.scheduling_slice_batch());
+      break;
     case ClientCaptureEvent::kInternedCallstack:
       ProcessInternedCallstack(event.interned_callstack());
       break;
     case ClientCaptureEvent::kCallstackSample:
       ProcessCallstackSample(event.callstack_sample());
       break;
+    case ClientCaptureEvent::kCallstackSampleBatch:
+      ProcessCallstackSampleBatch(event.callstack_sample_batch());
+      break;
     case ClientCaptureEvent::kFunctionCall:
       ProcessFunctionCall(event.function_call());
       break;
+    case ClientCaptureEvent::kFunctionCallBatch:
+      ProcessFunctionCallBatch(event.function_call_batch());
+      break;
     case ClientCaptureEvent::kIntrospectionScope:
       ProcessIntrospectionScope(event.introspection_scope());
       break;
@@ -161,6 +186,9 @@ void CaptureEventProcessorForListener::ProcessEvent(const ClientCaptureEvent& ev
     case ClientCaptureEvent::kGpuQueueSubmission:
       ProcessGpuQueueSubmission(event.gpu_queue_submission());
       break;
+    case ClientCaptureEvent::kGpuClockCalibration:
+      gpu_queue_submission_processor_.AddGpuClockCalibration(event.gpu_clock_calibration());
+      break;
     case ClientCaptureEvent::kModulesSnapshot:
       ProcessModulesSnapshot(event.modules_snapshot());
       break;
@@ -176,12 +204,18 @@ void CaptureEventProcessorForListener::ProcessEvent(const ClientCaptureEvent& ev
     case ClientCaptureEvent::kApiEvent:
       api_event_processor_.ProcessApiEvent(event.api_event());
       break;
+    case ClientCaptureEvent::kCompactApiEvent:
+      api_event_processor_.ProcessCompactApiEvent(event.compact_api_event(), string_intern_pool_);
+      break;
     case ClientCaptureEvent::kWarningEvent:
       ProcessWarningEvent(event.warning_event());
       break;
     case ClientCaptureEvent::kClockResolutionEvent:
       ProcessClockResolutionEvent(event.clock_resolution_event());
       break;
+    case ClientCaptureEvent::kCaptureStartLatencyEvent:
+      capture_listener_->OnCaptureStartLatencyEvent(event.capture_start_latency_event());
+      break;
     case ClientCaptureEvent::kErrorsWithPerfEventOpenEvent:
       ProcessErrorsWithPerfEventOpenEvent(event.errors_with_perf_event_open_event());
       break;
@@ -194,6 +228,21 @@ void CaptureEventProcessorForListener::ProcessEvent(const ClientCaptureEvent& ev
     case ClientCaptureEvent::kOutOfOrderEventsDiscardedEvent:
       ProcessOutOfOrderEventsDiscardedEvent(event.out_of_order_events_discarded_event());
       break;
+    case ClientCaptureEvent::kSamplingPeriodChangedEvent:
+      ProcessSamplingPeriodChangedEvent(event.sampling_period_changed_event());
+      break;
+    case ClientCaptureEvent::kPmuCountersSample:
+      ProcessPmuCountersSample(event.pmu_counters_sample());
+      break;
+    case ClientCaptureEvent::kServiceHealthEvent:
+      ProcessServiceHealthEvent(event.service_health_event());
+      break;
+    case ClientCaptureEvent::kPipelineLatencyProbe:
+      capture_listener_->OnPipelineLatencyProbe(event.pipeline_latency_probe());
+      break;
+    case ClientCaptureEvent::kCaptureStatisticsSummary:
+      ProcessCaptureStatisticsSummary(event.capture_statistics_summary());
+      break;
     case ClientCaptureEvent::kCaptureFinished:
       ProcessCaptureFinished(event.capture_finished());
       break;
@@ -232,6 +281,28 @@ void CaptureEventProcessorForListener::ProcessSchedulingSlice(
   capture_listener_->OnTimer(timer_info);
 }
 
+void CaptureEventProcessorForListener::ProcessSchedulingSliceBatch(
+    const SchedulingSliceBatch& scheduling_slice_batch) {
+  const int size = scheduling_slice_batch.pid_size();
+  if (scheduling_slice_batch.tid_size() != size || scheduling_slice_batch.core_size() != size ||
+      scheduling_slice_batch.duration_ns_size() != size ||
+      scheduling_slice_batch.out_timestamp_ns_delta_size() != size) {
+    ERROR("Discarding SchedulingSliceBatch with columns of different sizes");
+    return;
+  }
+  uint64_t out_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    out_timestamp_ns += static_cast<uint64_t>(scheduling_slice_batch.out_timestamp_ns_delta(i));
+    SchedulingSlice scheduling_slice;
+    scheduling_slice.set_pid(scheduling_slice_batch.pid(i));
+    scheduling_slice.set_tid(scheduling_slice_batch.tid(i));
+    scheduling_slice.set_core(scheduling_slice_batch.core(i));
+    scheduling_slice.set_duration_ns(scheduling_slice_batch.duration_ns(i));
+    scheduling_slice.set_out_timestamp_ns(out_timestamp_ns);
+    ProcessSchedulingSlice(scheduling_slice);
+  }
+}
+
 void CaptureEventProcessorForListener::ProcessInternedCallstack(
     InternedCallstack interned_callstack) {
   if (callstack_intern_pool.contains(interned_callstack.key())) {
@@ -253,12 +324,39 @@ void CaptureEventProcessorForListener::ProcessCallstackSample(
   callstack_event.set_callstack_id(callstack_id);
   // Note: callstack_sample.pid() is available, but currently dropped.
   callstack_event.set_thread_id(callstack_sample.tid());
+  callstack_event.set_off_cpu_duration_ns(callstack_sample.off_cpu_duration_ns());
+  callstack_event.set_memory_event_type(static_cast<CallstackEvent::MemoryEventType>(
+      callstack_sample.memory_event_type()));
+  callstack_event.set_memory_event_count(callstack_sample.memory_event_count());
 
   gpu_queue_submission_processor_.UpdateBeginCaptureTime(callstack_sample.timestamp_ns());
 
   capture_listener_->OnCallstackEvent(std::move(callstack_event));
 }
 
+void CaptureEventProcessorForListener::ProcessCallstackSampleBatch(
+    const CallstackSampleBatch& callstack_sample_batch) {
+  const int size = callstack_sample_batch.pid_size();
+  if (callstack_sample_batch.tid_size() != size ||
+      callstack_sample_batch.callstack_id_size() != size ||
+      callstack_sample_batch.timestamp_ns_delta_size() != size ||
+      callstack_sample_batch.off_cpu_duration_ns_size() != size) {
+    ERROR("Discarding CallstackSampleBatch with columns of different sizes");
+    return;
+  }
+  uint64_t timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    timestamp_ns += static_cast<uint64_t>(callstack_sample_batch.timestamp_ns_delta(i));
+    CallstackSample callstack_sample;
+    callstack_sample.set_pid(callstack_sample_batch.pid(i));
+    callstack_sample.set_tid(callstack_sample_batch.tid(i));
+    callstack_sample.set_callstack_id(callstack_sample_batch.callstack_id(i));
+    callstack_sample.set_timestamp_ns(timestamp_ns);
+    callstack_sample.set_off_cpu_duration_ns(callstack_sample_batch.off_cpu_duration_ns(i));
+    ProcessCallstackSample(callstack_sample);
+  }
+}
+
 void CaptureEventProcessorForListener::ProcessFunctionCall(const FunctionCall& function_call) {
   TimerInfo timer_info;
   timer_info.set_process_id(function_call.pid());
@@ -281,6 +379,31 @@ void CaptureEventProcessorForListener::ProcessFunctionCall(const FunctionCall& f
   capture_listener_->OnTimer(timer_info);
 }
 
+void CaptureEventProcessorForListener::ProcessFunctionCallBatch(
+    const FunctionCallBatch& function_call_batch) {
+  const int size = function_call_batch.pid_size();
+  if (function_call_batch.tid_size() != size || function_call_batch.function_id_size() != size ||
+      function_call_batch.duration_ns_size() != size ||
+      function_call_batch.end_timestamp_ns_delta_size() != size ||
+      function_call_batch.depth_size() != size || function_call_batch.return_value_size() != size) {
+    ERROR("Discarding FunctionCallBatch with columns of different sizes");
+    return;
+  }
+  uint64_t end_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    end_timestamp_ns += static_cast<uint64_t>(function_call_batch.end_timestamp_ns_delta(i));
+    FunctionCall function_call;
+    function_call.set_pid(function_call_batch.pid(i));
+    function_call.set_tid(function_call_batch.tid(i));
+    function_call.set_function_id(function_call_batch.function_id(i));
+    function_call.set_duration_ns(function_call_batch.duration_ns(i));
+    function_call.set_end_timestamp_ns(end_timestamp_ns);
+    function_call.set_depth(function_call_batch.depth(i));
+    function_call.set_return_value(function_call_batch.return_value(i));
+    ProcessFunctionCall(function_call);
+  }
+}
+
 void CaptureEventProcessorForListener::ProcessIntrospectionScope(
     const IntrospectionScope& introspection_scope) {
   TimerInfo timer_info;
@@ -311,14 +434,14 @@ void CaptureEventProcessorForListener::ProcessInternedString(InternedString inte
 
 void CaptureEventProcessorForListener::ProcessModuleUpdate(
     orbit_grpc_protos::ModuleUpdateEvent module_update) {
-  capture_listener_->OnModuleUpdate(module_update.timestamp_ns(),
+  capture_listener_->OnModuleUpdate(module_update.pid(), module_update.timestamp_ns(),
                                     std::move(*module_update.mutable_module()));
 }
 
 void CaptureEventProcessorForListener::ProcessModulesSnapshot(
     const orbit_grpc_protos::ModulesSnapshot& modules_snapshot) {
   capture_listener_->OnModulesSnapshot(
-      modules_snapshot.timestamp_ns(),
+      modules_snapshot.pid(), modules_snapshot.timestamp_ns(),
       {modules_snapshot.modules().begin(), modules_snapshot.modules().end()});
 }
 
@@ -566,6 +689,18 @@ void CaptureEventProcessorForListener::ProcessThreadStateSlice(
   slice_info.set_begin_timestamp_ns(thread_state_slice.end_timestamp_ns() -
                                     thread_state_slice.duration_ns());
   slice_info.set_end_timestamp_ns(thread_state_slice.end_timestamp_ns());
+  switch (thread_state_slice.wakeup_reason()) {
+    case ThreadStateSlice::kNotApplicable:
+      slice_info.set_wakeup_reason(ThreadStateSliceInfo::kNotApplicable);
+      break;
+    case ThreadStateSlice::kUnblocked:
+      slice_info.set_wakeup_reason(ThreadStateSliceInfo::kUnblocked);
+      slice_info.set_wakeup_tid(thread_state_slice.wakeup_tid());
+      slice_info.set_wakeup_pid(thread_state_slice.wakeup_pid());
+      break;
+    default:
+      UNREACHABLE();
+  }
 
   gpu_queue_submission_processor_.UpdateBeginCaptureTime(slice_info.begin_timestamp_ns());
 
@@ -643,6 +778,7 @@ void CaptureEventProcessorForListener::ProcessTracepointEvent(
   tracepoint_event_info.set_time(tracepoint_event.timestamp_ns());
   tracepoint_event_info.set_cpu(tracepoint_event.cpu());
   tracepoint_event_info.set_tracepoint_info_key(key);
+  *tracepoint_event_info.mutable_field_values() = tracepoint_event.field_values();
 
   gpu_queue_submission_processor_.UpdateBeginCaptureTime(tracepoint_event.timestamp_ns());
 
@@ -679,6 +815,104 @@ void CaptureEventProcessorForListener::ProcessOutOfOrderEventsDiscardedEvent(
   capture_listener_->OnOutOfOrderEventsDiscardedEvent(out_of_order_events_discarded_event);
 }
 
+void CaptureEventProcessorForListener::ProcessSamplingPeriodChangedEvent(
+    const orbit_grpc_protos::SamplingPeriodChangedEvent& sampling_period_changed_event) {
+  capture_listener_->OnSamplingPeriodChangedEvent(sampling_period_changed_event);
+}
+
+void CaptureEventProcessorForListener::ProcessPmuCountersSample(
+    const orbit_grpc_protos::PmuCountersSample& pmu_counters_sample) {
+  TimerInfo timer;
+  timer.set_type(TimerInfo::kPmuCounters);
+  timer.set_process_id(pmu_counters_sample.pid());
+  timer.set_thread_id(pmu_counters_sample.tid());
+  timer.set_start(pmu_counters_sample.end_timestamp_ns() - pmu_counters_sample.duration_ns());
+  timer.set_end(pmu_counters_sample.end_timestamp_ns());
+
+  std::vector<uint64_t> encoded_values(static_cast<size_t>(PmuCountersEncodingIndex::kEnd));
+  encoded_values[static_cast<size_t>(PmuCountersEncodingIndex::kCycles)] =
+      pmu_counters_sample.cycles();
+  encoded_values[static_cast<size_t>(PmuCountersEncodingIndex::kInstructions)] =
+      pmu_counters_sample.instructions();
+  encoded_values[static_cast<size_t>(PmuCountersEncodingIndex::kLlcMisses)] =
+      pmu_counters_sample.llc_misses();
+  encoded_values[static_cast<size_t>(PmuCountersEncodingIndex::kBranchMisses)] =
+      pmu_counters_sample.branch_misses();
+  *timer.mutable_registers() = {encoded_values.begin(), encoded_values.end()};
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessorForListener::ProcessServiceHealthEvent(
+    const orbit_grpc_protos::ServiceHealthEvent& service_health_event) {
+  TimerInfo timer;
+  timer.set_type(TimerInfo::kServiceHealth);
+  timer.set_start(service_health_event.end_timestamp_ns() - service_health_event.duration_ns());
+  timer.set_end(service_health_event.end_timestamp_ns());
+
+  // The records read are only shown in total, not per ring buffer.
+  uint64_t record_count = 0;
+  for (const auto& ring_buffer_record_count : service_health_event.ring_buffer_record_counts()) {
+    record_count += ring_buffer_record_count.record_count();
+  }
+
+  std::vector<uint64_t> encoded_values(static_cast<size_t>(ServiceHealthEncodingIndex::kEnd));
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kRecordCount)] = record_count;
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kPerfEventQueueSize)] =
+      service_health_event.perf_event_queue_size();
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kMaxDeferredEventCount)] =
+      service_health_event.max_deferred_event_count();
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kStackSampleLatencyP50Ns)] =
+      service_health_event.stack_sample_latency_p50_ns();
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kStackSampleLatencyP90Ns)] =
+      service_health_event.stack_sample_latency_p90_ns();
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kStackSampleLatencyP99Ns)] =
+      service_health_event.stack_sample_latency_p99_ns();
+  encoded_values[static_cast<size_t>(ServiceHealthEncodingIndex::kTotalBytesSent)] =
+      service_health_event.total_bytes_sent();
+  *timer.mutable_registers() = {encoded_values.begin(), encoded_values.end()};
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessorForListener::ProcessCaptureStatisticsSummary(
+    const orbit_grpc_protos::CaptureStatisticsSummary& capture_statistics_summary) {
+  for (const auto& function_call_statistics :
+       capture_statistics_summary.function_call_statistics()) {
+    orbit_client_protos::FunctionStats stats;
+    stats.set_count(function_call_statistics.count());
+    stats.set_total_time_ns(function_call_statistics.total_time_ns());
+    if (stats.count() > 0) {
+      stats.set_average_time_ns(stats.total_time_ns() / stats.count());
+    }
+    stats.set_min_ns(function_call_statistics.min_ns());
+    stats.set_max_ns(function_call_statistics.max_ns());
+    *stats.mutable_duration_histogram() = function_call_statistics.duration_histogram();
+    // The calls measured in the kernel only have power-of-two buckets.
+    orbit_client_data::AddLog2DurationHistogramToStats(
+        function_call_statistics.duration_log2_histogram(), &stats);
+    capture_listener_->OnFunctionStats(function_call_statistics.function_id(), std::move(stats));
+  }
+
+  // The sampling report is computed from individual CallstackEvents, so each counted sample becomes
+  // one again, spread evenly over the interval of the summary.
+  const uint64_t end_timestamp_ns = capture_statistics_summary.end_timestamp_ns();
+  const uint64_t begin_timestamp_ns = end_timestamp_ns - capture_statistics_summary.duration_ns();
+  for (const auto& callstack_sample_count : capture_statistics_summary.callstack_sample_counts()) {
+    const uint64_t callstack_id = callstack_sample_count.callstack_id();
+    SendCallstackToListenerIfNecessary(callstack_id, callstack_intern_pool[callstack_id]);
+    const uint64_t count = callstack_sample_count.count();
+    for (uint64_t i = 0; i < count; ++i) {
+      CallstackEvent callstack_event;
+      callstack_event.set_time(begin_timestamp_ns +
+                               capture_statistics_summary.duration_ns() * i / count);
+      callstack_event.set_callstack_id(callstack_id);
+      callstack_event.set_thread_id(callstack_sample_count.tid());
+      capture_listener_->OnCallstackEvent(std::move(callstack_event));
+    }
+  }
+}
+
 uint64_t CaptureEventProcessorForListener::GetStringHashAndSendToListenerIfNecessary(
     const std::string& str) {
   uint64_t hash = std::hash<std::string>{}(str);
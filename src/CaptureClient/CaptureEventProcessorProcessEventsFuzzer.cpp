@@ -51,13 +51,15 @@ class MyCaptureListener : public CaptureListener {
                               orbit_grpc_protos::TracepointInfo /*tracepoint_info*/) override {}
   void OnTracepointEvent(
       orbit_client_protos::TracepointEventInfo /*tracepoint_event_info*/) override {}
-  void OnModuleUpdate(uint64_t /*timestamp_ns*/,
+  void OnModuleUpdate(int32_t /*pid*/, uint64_t /*timestamp_ns*/,
                       orbit_grpc_protos::ModuleInfo /*module_info*/) override {}
-  void OnModulesSnapshot(uint64_t /*timestamp_ns*/,
+  void OnModulesSnapshot(int32_t /*pid*/, uint64_t /*timestamp_ns*/,
                          std::vector<orbit_grpc_protos::ModuleInfo> /*module_infos*/) override {}
   void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {}
   void OnClockResolutionEvent(
       orbit_grpc_protos::ClockResolutionEvent /*clock_resolution_event*/) override {}
+  void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent /*capture_start_latency_event*/) override {}
   void OnErrorsWithPerfEventOpenEvent(
       orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/)
       override {}
@@ -67,6 +69,12 @@ class MyCaptureListener : public CaptureListener {
       orbit_grpc_protos::LostPerfRecordsEvent /*lost_perf_records_event*/) override {}
   void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
                                         /*out_of_order_events_discarded_event*/) override {}
+  void OnSamplingPeriodChangedEvent(orbit_grpc_protos::SamplingPeriodChangedEvent
+                                    /*sampling_period_changed_event*/) override {}
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/) override {}
+  void OnFunctionStats(uint64_t /*function_id*/,
+                       orbit_client_protos::FunctionStats /*stats*/) override {}
 };
 }  // namespace
 
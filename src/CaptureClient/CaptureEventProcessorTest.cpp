@@ -13,6 +13,7 @@
 
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureClient/CaptureListener.h"
+#include "ClientData/FunctionStatsUtils.h"
 #include "ClientData/TracepointCustom.h"
 #include "capture.pb.h"
 #include "capture_data.pb.h"
@@ -22,6 +23,7 @@ namespace orbit_capture_client {
 
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::FunctionStats;
 using orbit_client_protos::LinuxAddressInfo;
 using orbit_client_protos::ThreadStateSliceInfo;
 using orbit_client_protos::TimerInfo;
@@ -30,6 +32,7 @@ using orbit_client_protos::TracepointEventInfo;
 using orbit_grpc_protos::AddressInfo;
 using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CallstackSampleBatch;
 using orbit_grpc_protos::CaptureFinished;
 using orbit_grpc_protos::CaptureStarted;
 using orbit_grpc_protos::CGroupMemoryUsage;
@@ -39,10 +42,13 @@ using orbit_grpc_protos::Color;
 using orbit_grpc_protos::ErrorEnablingOrbitApiEvent;
 using orbit_grpc_protos::ErrorsWithPerfEventOpenEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallBatch;
+using orbit_grpc_protos::GpuClockCalibration;
 using orbit_grpc_protos::GpuCommandBuffer;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuDebugMarkerBeginInfo;
 using orbit_grpc_protos::GpuJob;
+using orbit_grpc_protos::GpuPipelineStatistics;
 using orbit_grpc_protos::GpuQueueSubmission;
 using orbit_grpc_protos::GpuQueueSubmissionMetaInfo;
 using orbit_grpc_protos::GpuSubmitInfo;
@@ -55,7 +61,12 @@ using orbit_grpc_protos::MemoryUsageEvent;
 using orbit_grpc_protos::ModuleInfo;
 using orbit_grpc_protos::OutOfOrderEventsDiscardedEvent;
 using orbit_grpc_protos::ProcessMemoryUsage;
+using orbit_grpc_protos::PipelineLatencyProbe;
+using orbit_grpc_protos::PmuCountersSample;
+using orbit_grpc_protos::SamplingPeriodChangedEvent;
 using orbit_grpc_protos::SchedulingSlice;
+using orbit_grpc_protos::SchedulingSliceBatch;
+using orbit_grpc_protos::ServiceHealthEvent;
 using orbit_grpc_protos::SystemMemoryUsage;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadStateSlice;
@@ -65,6 +76,7 @@ using orbit_grpc_protos::WarningEvent;
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::Return;
 using ::testing::SaveArg;
 
@@ -88,14 +100,20 @@ class MockCaptureListener : public CaptureListener {
   MOCK_METHOD(void, OnUniqueTracepointInfo, (uint64_t /*key*/, TracepointInfo /*tracepoint_info*/),
               (override));
   MOCK_METHOD(void, OnTracepointEvent, (TracepointEventInfo), (override));
-  MOCK_METHOD(void, OnModuleUpdate, (uint64_t /*timestamp_ns*/, ModuleInfo /*module_info*/),
+  MOCK_METHOD(void, OnModuleUpdate,
+              (int32_t /*pid*/, uint64_t /*timestamp_ns*/, ModuleInfo /*module_info*/),
               (override));
   MOCK_METHOD(void, OnModulesSnapshot,
-              (uint64_t /*timestamp_ns*/, std::vector<ModuleInfo> /*module_infos*/), (override));
+              (int32_t /*pid*/, uint64_t /*timestamp_ns*/,
+               std::vector<ModuleInfo> /*module_infos*/),
+              (override));
   MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent /*warning_event*/),
               (override));
   MOCK_METHOD(void, OnClockResolutionEvent,
               (orbit_grpc_protos::ClockResolutionEvent /*clock_resolution_event*/), (override));
+  MOCK_METHOD(void, OnCaptureStartLatencyEvent,
+              (orbit_grpc_protos::CaptureStartLatencyEvent /*capture_start_latency_event*/),
+              (override));
   MOCK_METHOD(
       void, OnErrorsWithPerfEventOpenEvent,
       (orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/),
@@ -109,6 +127,14 @@ class MockCaptureListener : public CaptureListener {
       void, OnOutOfOrderEventsDiscardedEvent,
       (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent /*out_of_order_events_discarded_event*/),
       (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent,
+              (orbit_grpc_protos::SamplingPeriodChangedEvent /*sampling_period_changed_event*/),
+              (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe,
+              (orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/), (override));
+  MOCK_METHOD(void, OnFunctionStats,
+              (uint64_t /*function_id*/, orbit_client_protos::FunctionStats /*stats*/),
+              (override));
 };
 
 }  // namespace
@@ -140,6 +166,56 @@ TEST(CaptureEventProcessor, CanHandleSchedulingSlices) {
   EXPECT_EQ(actual_timer.type(), TimerInfo::kCoreActivity);
 }
 
+TEST(CaptureEventProcessor, CanHandleSchedulingSliceBatches) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  SchedulingSliceBatch* scheduling_slice_batch = event.mutable_scheduling_slice_batch();
+  for (int32_t tid : {24, 25}) {
+    scheduling_slice_batch->add_pid(42);
+    scheduling_slice_batch->add_tid(tid);
+    scheduling_slice_batch->add_core(2);
+    scheduling_slice_batch->add_duration_ns(97);
+  }
+  scheduling_slice_batch->add_out_timestamp_ns_delta(200);
+  scheduling_slice_batch->add_out_timestamp_ns_delta(-100);
+
+  std::vector<TimerInfo> actual_timers;
+  EXPECT_CALL(listener, OnTimer)
+      .Times(2)
+      .WillRepeatedly([&actual_timers](const TimerInfo& timer) { actual_timers.push_back(timer); });
+
+  event_processor->ProcessEvent(event);
+
+  ASSERT_EQ(actual_timers.size(), 2);
+  EXPECT_EQ(actual_timers[0].thread_id(), 24);
+  EXPECT_EQ(actual_timers[0].start(), 200 - 97);
+  EXPECT_EQ(actual_timers[0].end(), 200);
+  EXPECT_EQ(actual_timers[1].thread_id(), 25);
+  EXPECT_EQ(actual_timers[1].start(), 100 - 97);
+  EXPECT_EQ(actual_timers[1].end(), 100);
+  EXPECT_EQ(actual_timers[1].process_id(), 42);
+  EXPECT_EQ(actual_timers[1].processor(), 2);
+  EXPECT_EQ(actual_timers[1].type(), TimerInfo::kCoreActivity);
+}
+
+TEST(CaptureEventProcessor, DiscardsSchedulingSliceBatchesWithColumnsOfDifferentSizes) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  SchedulingSliceBatch* scheduling_slice_batch = event.mutable_scheduling_slice_batch();
+  scheduling_slice_batch->add_pid(42);
+  scheduling_slice_batch->add_tid(24);
+
+  EXPECT_CALL(listener, OnTimer).Times(0);
+
+  event_processor->ProcessEvent(event);
+}
+
 static InternedCallstack* AddAndInitializeInternedCallstack(ClientCaptureEvent& event) {
   InternedCallstack* interned_callstack = event.mutable_interned_callstack();
   interned_callstack->set_key(1);
@@ -165,6 +241,12 @@ static void ExpectCallstackSamplesEqual(const CallstackEvent& actual_callstack_e
                                         const Callstack* expected_callstack) {
   EXPECT_EQ(actual_callstack_event.time(), expected_callstack_sample->timestamp_ns());
   EXPECT_EQ(actual_callstack_event.thread_id(), expected_callstack_sample->tid());
+  EXPECT_EQ(actual_callstack_event.off_cpu_duration_ns(),
+            expected_callstack_sample->off_cpu_duration_ns());
+  EXPECT_EQ(static_cast<int>(actual_callstack_event.memory_event_type()),
+            static_cast<int>(expected_callstack_sample->memory_event_type()));
+  EXPECT_EQ(actual_callstack_event.memory_event_count(),
+            expected_callstack_sample->memory_event_count());
   EXPECT_EQ(actual_callstack_event.callstack_id(), actual_callstack_id);
   ASSERT_EQ(actual_callstack.frames_size(), expected_callstack->pcs_size());
   for (int i = 0; i < actual_callstack.frames_size(); ++i) {
@@ -236,6 +318,76 @@ TEST(CaptureEventProcessor, CanHandleOneCallstackSample) {
   CanHandleOneCallstackSampleOfType(Callstack::kComplete);
 }
 
+TEST(CaptureEventProcessor, CanHandleOneMemoryCallstackSample) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent interned_callstack_event;
+  InternedCallstack* interned_callstack =
+      AddAndInitializeInternedCallstack(interned_callstack_event);
+  event_processor->ProcessEvent(interned_callstack_event);
+
+  ClientCaptureEvent event;
+  CallstackSample* callstack_sample = AddAndInitializeCallstackSample(event);
+  callstack_sample->set_timestamp_ns(100);
+  callstack_sample->set_memory_event_type(CallstackSample::kPageFault);
+  callstack_sample->set_memory_event_count(100);
+
+  uint64_t actual_callstack_id = 0;
+  CallstackInfo actual_callstack;
+  EXPECT_CALL(listener, OnUniqueCallstack)
+      .Times(1)
+      .WillOnce(DoAll(SaveArg<0>(&actual_callstack_id), SaveArg<1>(&actual_callstack)));
+  CallstackEvent actual_callstack_event;
+  EXPECT_CALL(listener, OnCallstackEvent).Times(1).WillOnce(SaveArg<0>(&actual_callstack_event));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_callstack_event.memory_event_type(), CallstackEvent::kPageFault);
+  ExpectCallstackSamplesEqual(actual_callstack_event, actual_callstack_id, actual_callstack,
+                              callstack_sample, &interned_callstack->intern());
+}
+
+TEST(CaptureEventProcessor, CanHandleCallstackSampleBatches) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent interned_callstack_event;
+  AddAndInitializeInternedCallstack(interned_callstack_event);
+  event_processor->ProcessEvent(interned_callstack_event);
+
+  ClientCaptureEvent event;
+  CallstackSampleBatch* callstack_sample_batch = event.mutable_callstack_sample_batch();
+  for (uint64_t off_cpu_duration_ns : {0, 50}) {
+    callstack_sample_batch->add_pid(1);
+    callstack_sample_batch->add_tid(3);
+    callstack_sample_batch->add_callstack_id(1);
+    callstack_sample_batch->add_off_cpu_duration_ns(off_cpu_duration_ns);
+  }
+  callstack_sample_batch->add_timestamp_ns_delta(100);
+  callstack_sample_batch->add_timestamp_ns_delta(10);
+
+  EXPECT_CALL(listener, OnUniqueCallstack).Times(1);
+  std::vector<CallstackEvent> actual_callstack_events;
+  EXPECT_CALL(listener, OnCallstackEvent)
+      .Times(2)
+      .WillRepeatedly([&actual_callstack_events](CallstackEvent callstack_event) {
+        actual_callstack_events.push_back(std::move(callstack_event));
+      });
+
+  event_processor->ProcessEvent(event);
+
+  ASSERT_EQ(actual_callstack_events.size(), 2);
+  EXPECT_EQ(actual_callstack_events[0].time(), 100);
+  EXPECT_EQ(actual_callstack_events[0].off_cpu_duration_ns(), 0);
+  EXPECT_EQ(actual_callstack_events[1].time(), 110);
+  EXPECT_EQ(actual_callstack_events[1].off_cpu_duration_ns(), 50);
+  EXPECT_EQ(actual_callstack_events[1].thread_id(), 3);
+  EXPECT_EQ(actual_callstack_events[1].callstack_id(), 1);
+}
+
 TEST(CaptureEventProcessor, CanHandleOneNonCompleteCallstackSample) {
   CanHandleOneCallstackSampleOfType(Callstack::kDwarfUnwindingError);
   CanHandleOneCallstackSampleOfType(Callstack::kFramePointerUnwindingError);
@@ -262,6 +414,7 @@ TEST(CaptureEventProcessor, WillOnlyHandleUniqueCallstacksOnce) {
   ClientCaptureEvent event_2;
   CallstackSample* callstack_sample_2 = AddAndInitializeCallstackSample(event_2);
   callstack_sample_2->set_timestamp_ns(200);
+  callstack_sample_2->set_off_cpu_duration_ns(50);
 
   uint64_t actual_callstack_id = 0;
   CallstackInfo actual_callstack;
@@ -355,6 +508,37 @@ TEST(CaptureEventProcessor, CanHandleFunctionCalls) {
   EXPECT_EQ(actual_timer.type(), TimerInfo::kNone);
 }
 
+TEST(CaptureEventProcessor, CanHandleFunctionCallBatches) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  FunctionCallBatch* function_call_batch = event.mutable_function_call_batch();
+  function_call_batch->add_pid(42);
+  function_call_batch->add_tid(24);
+  function_call_batch->add_function_id(123);
+  function_call_batch->add_duration_ns(97);
+  function_call_batch->add_end_timestamp_ns_delta(100);
+  function_call_batch->add_depth(3);
+  function_call_batch->add_return_value(16);
+
+  TimerInfo actual_timer;
+  EXPECT_CALL(listener, OnTimer).Times(1).WillOnce(SaveArg<0>(&actual_timer));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_timer.process_id(), 42);
+  EXPECT_EQ(actual_timer.thread_id(), 24);
+  EXPECT_EQ(actual_timer.function_id(), 123);
+  EXPECT_EQ(actual_timer.start(), 100 - 97);
+  EXPECT_EQ(actual_timer.end(), 100);
+  EXPECT_EQ(actual_timer.depth(), 3);
+  EXPECT_EQ(actual_timer.user_data_key(), 16);
+  EXPECT_EQ(actual_timer.registers_size(), 0);
+  EXPECT_EQ(actual_timer.type(), TimerInfo::kNone);
+}
+
 TEST(CaptureEventProcessor, CanHandleIntrospectionScopes) {
   MockCaptureListener listener;
   auto event_processor =
@@ -497,6 +681,8 @@ TEST(CaptureEventProcessor, CanHandleInternedTracepointEvents) {
   tracepoint->set_timestamp_ns(100);
   tracepoint->set_cpu(2);
   tracepoint->set_tracepoint_info_key(interned_tracepoint->key());
+  tracepoint->add_field_values(-1);
+  tracepoint->add_field_values(4096);
 
   uint64_t actual_key;
   TracepointInfo actual_tracepoint_info;
@@ -517,6 +703,7 @@ TEST(CaptureEventProcessor, CanHandleInternedTracepointEvents) {
   EXPECT_EQ(actual_tracepoint_event.tid(), tracepoint->tid());
   EXPECT_EQ(actual_tracepoint_event.time(), tracepoint->timestamp_ns());
   EXPECT_EQ(actual_tracepoint_event.cpu(), tracepoint->cpu());
+  EXPECT_THAT(actual_tracepoint_event.field_values(), ElementsAre(-1, 4096));
 }
 
 static constexpr int32_t kGpuPid = 1;
@@ -865,6 +1052,149 @@ TEST(CaptureEventProcessor, CanHandleGpuSubmissionAfterGpuJob) {
                            kTimelineKey, actual_marker_key);
 }
 
+TEST(CaptureEventProcessor, EncodesPipelineStatisticsOfGpuDebugMarkersInRegisters) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent timeline_key_and_string =
+      CreateInternedStringEvent(kTimelineKey, kTimelineString);
+
+  ClientCaptureEvent gpu_job_event;
+  CreateGpuJob(&gpu_job_event, kTimelineKey, 10, 20, 30, 40);
+
+  ClientCaptureEvent queue_submission_event;
+  GpuQueueSubmission* submission = queue_submission_event.mutable_gpu_queue_submission();
+  GpuQueueSubmissionMetaInfo* meta_info = CreateGpuQueueSubmissionMetaInfo(submission, 9, 11);
+
+  GpuSubmitInfo* submit_info = submission->add_submit_infos();
+  AddGpuCommandBufferToGpuSubmitInfo(submit_info, 115, 119);
+  AddGpuDebugMarkerToGpuQueueSubmission(submission, meta_info, 42, 116, 118);
+  GpuPipelineStatistics* statistics = submission->mutable_completed_markers(0)
+                                          ->mutable_pipeline_statistics();
+  statistics->set_input_assembly_vertices(1);
+  statistics->set_input_assembly_primitives(2);
+  statistics->set_vertex_shader_invocations(3);
+  statistics->set_geometry_shader_invocations(4);
+  statistics->set_geometry_shader_primitives(5);
+  statistics->set_clipping_invocations(6);
+  statistics->set_clipping_primitives(7);
+  statistics->set_fragment_shader_invocations(8);
+  statistics->set_tessellation_control_shader_patches(9);
+  statistics->set_tessellation_evaluation_shader_invocations(10);
+  statistics->set_compute_shader_invocations(11);
+  submission->set_num_begin_markers(1);
+
+  EXPECT_CALL(listener, OnKeyAndString).Times(testing::AnyNumber());
+  EXPECT_CALL(listener, OnTimer).Times(3);
+  event_processor->ProcessEvent(timeline_key_and_string);
+  event_processor->ProcessEvent(gpu_job_event);
+  testing::Mock::VerifyAndClearExpectations(&listener);
+
+  EXPECT_CALL(listener, OnKeyAndString).Times(testing::AnyNumber());
+  TimerInfo command_buffer_timer;
+  TimerInfo debug_marker_timer;
+  EXPECT_CALL(listener, OnTimer)
+      .Times(2)
+      .WillOnce(SaveArg<0>(&command_buffer_timer))
+      .WillOnce(SaveArg<0>(&debug_marker_timer));
+  event_processor->ProcessEvent(queue_submission_event);
+
+  EXPECT_EQ(command_buffer_timer.registers_size(), 0);
+  ASSERT_EQ(debug_marker_timer.type(), TimerInfo::kGpuDebugMarker);
+  ASSERT_EQ(
+      debug_marker_timer.registers_size(),
+      static_cast<int>(CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex::kEnd));
+  EXPECT_EQ(debug_marker_timer.registers(static_cast<size_t>(
+                CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex::kInputAssemblyVertices)),
+            1);
+  EXPECT_EQ(debug_marker_timer.registers(static_cast<size_t>(
+                CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex::
+                    kFragmentShaderInvocations)),
+            8);
+  EXPECT_EQ(debug_marker_timer.registers(static_cast<size_t>(
+                CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex::
+                    kComputeShaderInvocations)),
+            11);
+}
+
+TEST(CaptureEventProcessor, UsesGpuClockCalibrationsToConvertGpuTimestamps) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent timeline_key_and_string =
+      CreateInternedStringEvent(kTimelineKey, kTimelineString);
+
+  // Each GPU nanosecond takes two CPU nanoseconds between the calibrations.
+  ClientCaptureEvent calibration_event_1;
+  GpuClockCalibration* calibration_1 = calibration_event_1.mutable_gpu_clock_calibration();
+  calibration_1->set_gpu_timestamp_ns(100);
+  calibration_1->set_cpu_timestamp_ns(1000);
+  ClientCaptureEvent calibration_event_2;
+  GpuClockCalibration* calibration_2 = calibration_event_2.mutable_gpu_clock_calibration();
+  calibration_2->set_gpu_timestamp_ns(200);
+  calibration_2->set_cpu_timestamp_ns(1200);
+
+  ClientCaptureEvent gpu_job_event;
+  GpuJob* gpu_job = CreateGpuJob(&gpu_job_event, kTimelineKey, 10, 20, 30, 40);
+
+  ClientCaptureEvent marker_string_event = CreateInternedStringEvent(42, "marker");
+
+  ClientCaptureEvent queue_submission_event;
+  GpuQueueSubmission* submission = queue_submission_event.mutable_gpu_queue_submission();
+  GpuQueueSubmissionMetaInfo* meta_info = CreateGpuQueueSubmissionMetaInfo(submission, 9, 11);
+
+  GpuSubmitInfo* submit_info = submission->add_submit_infos();
+  AddGpuCommandBufferToGpuSubmitInfo(submit_info, 115, 119);
+  AddGpuCommandBufferToGpuSubmitInfo(submit_info, 120, 124);
+  AddGpuDebugMarkerToGpuQueueSubmission(submission, meta_info, 42, 116, 121);
+  submission->set_num_begin_markers(1);
+
+  EXPECT_CALL(listener, OnKeyAndString(kTimelineKey, kTimelineString)).Times(1);
+  EXPECT_CALL(listener, OnKeyAndString(_, "sw queue")).Times(1);
+  EXPECT_CALL(listener, OnKeyAndString(_, "hw queue")).Times(1);
+  EXPECT_CALL(listener, OnKeyAndString(_, "hw execution")).Times(1);
+  EXPECT_CALL(listener, OnTimer).Times(3);
+
+  event_processor->ProcessEvent(timeline_key_and_string);
+  event_processor->ProcessEvent(calibration_event_1);
+  event_processor->ProcessEvent(calibration_event_2);
+  event_processor->ProcessEvent(gpu_job_event);
+
+  testing::Mock::VerifyAndClearExpectations(&listener);
+
+  uint64_t actual_marker_key;
+  EXPECT_CALL(listener, OnKeyAndString(_, "marker"))
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_marker_key));
+  uint64_t actual_command_buffer_key;
+  EXPECT_CALL(listener, OnKeyAndString(_, "command buffer"))
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_command_buffer_key));
+
+  TimerInfo command_buffer_timer_1;
+  TimerInfo command_buffer_timer_2;
+  TimerInfo debug_marker_timer;
+  EXPECT_CALL(listener, OnTimer)
+      .Times(3)
+      .WillOnce(SaveArg<0>(&command_buffer_timer_1))
+      .WillOnce(SaveArg<0>(&command_buffer_timer_2))
+      .WillOnce(SaveArg<0>(&debug_marker_timer));
+
+  event_processor->ProcessEvent(marker_string_event);
+  event_processor->ProcessEvent(queue_submission_event);
+
+  ExpectCommandBufferTimerEq(command_buffer_timer_1, *gpu_job, 1030, 1038, kTimelineKey,
+                             actual_command_buffer_key);
+
+  ExpectCommandBufferTimerEq(command_buffer_timer_2, *gpu_job, 1040, 1048, kTimelineKey,
+                             actual_command_buffer_key);
+
+  ExpectDebugMarkerTimerEq(debug_marker_timer, 1032, 1042, gpu_job->tid(), gpu_job->pid(), 1,
+                           kTimelineKey, actual_marker_key);
+}
+
 TEST(CaptureEventProcessor, CanHandleGpuSubmissionReceivedBeforeGpuJob) {
   MockCaptureListener listener;
   auto event_processor =
@@ -1227,6 +1557,37 @@ TEST(CaptureEventProcessor, CanHandleThreadStateSlices) {
   EXPECT_EQ(actual_dead_thread_state_slice_info.thread_state(), ThreadStateSliceInfo::kDead);
 }
 
+TEST(CaptureEventProcessor, CanHandleThreadStateSlicesEndedByWakeups) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  ThreadStateSlice* thread_state_slice = event.mutable_thread_state_slice();
+  thread_state_slice->set_duration_ns(100);
+  thread_state_slice->set_end_timestamp_ns(200);
+  thread_state_slice->set_pid(14);
+  thread_state_slice->set_tid(24);
+  thread_state_slice->set_thread_state(ThreadStateSlice::kInterruptibleSleep);
+  thread_state_slice->set_wakeup_reason(ThreadStateSlice::kUnblocked);
+  thread_state_slice->set_wakeup_tid(25);
+  thread_state_slice->set_wakeup_pid(15);
+
+  ThreadStateSliceInfo actual_thread_state_slice_info;
+  EXPECT_CALL(listener, OnThreadStateSlice)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_thread_state_slice_info));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_thread_state_slice_info.tid(), 24);
+  EXPECT_EQ(actual_thread_state_slice_info.thread_state(),
+            ThreadStateSliceInfo::kInterruptibleSleep);
+  EXPECT_EQ(actual_thread_state_slice_info.wakeup_reason(), ThreadStateSliceInfo::kUnblocked);
+  EXPECT_EQ(actual_thread_state_slice_info.wakeup_tid(), 25);
+  EXPECT_EQ(actual_thread_state_slice_info.wakeup_pid(), 15);
+}
+
 TEST(CaptureEventProcessor, CanHandleWarningEvents) {
   MockCaptureListener listener;
   auto event_processor =
@@ -1370,6 +1731,266 @@ TEST(CaptureEventProcessor, CanHandleOutOfOrderEventsDiscardedEvents) {
   EXPECT_EQ(actual_out_of_order_events_discarded_event.end_timestamp_ns(), kEndTimestampNs);
 }
 
+TEST(CaptureEventProcessor, CanHandleSamplingPeriodChangedEvents) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  SamplingPeriodChangedEvent* sampling_period_changed_event =
+      event.mutable_sampling_period_changed_event();
+  constexpr uint64_t kTimestampNs = 123;
+  sampling_period_changed_event->set_timestamp_ns(kTimestampNs);
+  constexpr int32_t kCpu = 3;
+  sampling_period_changed_event->set_cpu(kCpu);
+  constexpr uint64_t kSamplingPeriodNs = 2'000'000;
+  sampling_period_changed_event->set_sampling_period_ns(kSamplingPeriodNs);
+
+  SamplingPeriodChangedEvent actual_sampling_period_changed_event;
+  EXPECT_CALL(listener, OnSamplingPeriodChangedEvent)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_sampling_period_changed_event));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_sampling_period_changed_event.timestamp_ns(), kTimestampNs);
+  EXPECT_EQ(actual_sampling_period_changed_event.cpu(), kCpu);
+  EXPECT_EQ(actual_sampling_period_changed_event.sampling_period_ns(), kSamplingPeriodNs);
+}
+
+TEST(CaptureEventProcessor, CanHandlePipelineLatencyProbes) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  PipelineLatencyProbe* pipeline_latency_probe = event.mutable_pipeline_latency_probe();
+  pipeline_latency_probe->set_record_timestamp_ns(100);
+  pipeline_latency_probe->set_ring_buffer_read_timestamp_ns(200);
+  pipeline_latency_probe->set_processed_timestamp_ns(300);
+  pipeline_latency_probe->set_sent_timestamp_ns(400);
+  pipeline_latency_probe->set_received_timestamp_ns(500);
+
+  PipelineLatencyProbe actual_pipeline_latency_probe;
+  EXPECT_CALL(listener, OnPipelineLatencyProbe)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_pipeline_latency_probe));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_pipeline_latency_probe.SerializeAsString(),
+            pipeline_latency_probe->SerializeAsString());
+}
+
+TEST(CaptureEventProcessor, CanHandleCaptureStatisticsSummaries) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent interned_callstack_event;
+  AddAndInitializeInternedCallstack(interned_callstack_event);
+  event_processor->ProcessEvent(interned_callstack_event);
+
+  ClientCaptureEvent event;
+  orbit_grpc_protos::CaptureStatisticsSummary* summary =
+      event.mutable_capture_statistics_summary();
+  summary->set_duration_ns(1000);
+  summary->set_end_timestamp_ns(5000);
+  orbit_grpc_protos::FunctionCallStatistics* function_call_statistics =
+      summary->add_function_call_statistics();
+  function_call_statistics->set_function_id(42);
+  function_call_statistics->set_count(4);
+  function_call_statistics->set_total_time_ns(400);
+  function_call_statistics->set_min_ns(50);
+  function_call_statistics->set_max_ns(150);
+  function_call_statistics->add_duration_histogram(4);
+  orbit_grpc_protos::CallstackSampleCount* callstack_sample_count =
+      summary->add_callstack_sample_counts();
+  callstack_sample_count->set_pid(1);
+  callstack_sample_count->set_tid(3);
+  callstack_sample_count->set_callstack_id(1);
+  callstack_sample_count->set_count(2);
+
+  FunctionStats actual_stats;
+  EXPECT_CALL(listener, OnFunctionStats(42, _)).Times(1).WillOnce(SaveArg<1>(&actual_stats));
+  EXPECT_CALL(listener, OnUniqueCallstack(1, _)).Times(1);
+  std::vector<CallstackEvent> actual_callstack_events;
+  EXPECT_CALL(listener, OnCallstackEvent)
+      .Times(2)
+      .WillRepeatedly([&actual_callstack_events](CallstackEvent callstack_event) {
+        actual_callstack_events.emplace_back(std::move(callstack_event));
+      });
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_stats.count(), 4);
+  EXPECT_EQ(actual_stats.total_time_ns(), 400);
+  EXPECT_EQ(actual_stats.average_time_ns(), 100);
+  EXPECT_EQ(actual_stats.min_ns(), 50);
+  EXPECT_EQ(actual_stats.max_ns(), 150);
+  EXPECT_THAT(actual_stats.duration_histogram(), ElementsAre(4));
+
+  ASSERT_EQ(actual_callstack_events.size(), 2);
+  EXPECT_EQ(actual_callstack_events[0].time(), 4000);
+  EXPECT_EQ(actual_callstack_events[1].time(), 4500);
+  for (const CallstackEvent& callstack_event : actual_callstack_events) {
+    EXPECT_EQ(callstack_event.callstack_id(), 1);
+    EXPECT_EQ(callstack_event.thread_id(), 3);
+  }
+}
+
+TEST(CaptureEventProcessor, CanHandleCaptureStatisticsSummariesOfCallsMeasuredInTheKernel) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  orbit_grpc_protos::CaptureStatisticsSummary* summary =
+      event.mutable_capture_statistics_summary();
+  summary->set_duration_ns(1000);
+  summary->set_end_timestamp_ns(5000);
+  orbit_grpc_protos::FunctionCallStatistics* function_call_statistics =
+      summary->add_function_call_statistics();
+  function_call_statistics->set_function_id(42);
+  function_call_statistics->set_count(3);
+  function_call_statistics->set_total_time_ns(400);
+  function_call_statistics->set_min_ns(64);
+  function_call_statistics->set_max_ns(255);
+  for (uint64_t count : {0, 0, 0, 0, 0, 0, 1, 2}) {
+    function_call_statistics->add_duration_log2_histogram(count);
+  }
+
+  FunctionStats actual_stats;
+  EXPECT_CALL(listener, OnFunctionStats(42, _)).Times(1).WillOnce(SaveArg<1>(&actual_stats));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_stats.count(), 3);
+  EXPECT_EQ(actual_stats.average_time_ns(), 133);
+  EXPECT_EQ(actual_stats.min_ns(), 64);
+  EXPECT_EQ(actual_stats.max_ns(), 255);
+  ASSERT_EQ(actual_stats.duration_histogram_size(),
+            orbit_client_data::GetDurationHistogramBucketIndex(192) + 1);
+  EXPECT_EQ(actual_stats.duration_histogram(orbit_client_data::GetDurationHistogramBucketIndex(96)),
+            1);
+  EXPECT_EQ(
+      actual_stats.duration_histogram(orbit_client_data::GetDurationHistogramBucketIndex(192)), 2);
+}
+
+TEST(CaptureEventProcessor, CanHandleCaptureStartLatencyEvents) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  orbit_grpc_protos::CaptureStartLatencyEvent* capture_start_latency_event =
+      event.mutable_capture_start_latency_event();
+  capture_start_latency_event->set_timestamp_ns(1000);
+  capture_start_latency_event->set_total_duration_ns(300);
+  orbit_grpc_protos::CaptureStartLatencyEvent::Phase* phase =
+      capture_start_latency_event->add_phases();
+  phase->set_name("phase");
+  phase->set_duration_ns(200);
+
+  orbit_grpc_protos::CaptureStartLatencyEvent actual_capture_start_latency_event;
+  EXPECT_CALL(listener, OnCaptureStartLatencyEvent)
+      .Times(1)
+      .WillOnce(SaveArg<0>(&actual_capture_start_latency_event));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_capture_start_latency_event.SerializeAsString(),
+            capture_start_latency_event->SerializeAsString());
+}
+
+TEST(CaptureEventProcessor, CanHandlePmuCountersSamples) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  PmuCountersSample* pmu_counters_sample = event.mutable_pmu_counters_sample();
+  pmu_counters_sample->set_pid(42);
+  pmu_counters_sample->set_tid(43);
+  pmu_counters_sample->set_duration_ns(1000);
+  pmu_counters_sample->set_end_timestamp_ns(11000);
+  pmu_counters_sample->set_cycles(2000);
+  pmu_counters_sample->set_instructions(3000);
+  pmu_counters_sample->set_llc_misses(4);
+  pmu_counters_sample->set_branch_misses(5);
+
+  TimerInfo actual_timer;
+  EXPECT_CALL(listener, OnTimer).Times(1).WillOnce(SaveArg<0>(&actual_timer));
+
+  event_processor->ProcessEvent(event);
+
+  EXPECT_EQ(actual_timer.type(), TimerInfo::kPmuCounters);
+  EXPECT_EQ(actual_timer.process_id(), 42);
+  EXPECT_EQ(actual_timer.thread_id(), 43);
+  EXPECT_EQ(actual_timer.start(), 10000);
+  EXPECT_EQ(actual_timer.end(), 11000);
+  ASSERT_EQ(actual_timer.registers_size(),
+            static_cast<int>(CaptureEventProcessor::PmuCountersEncodingIndex::kEnd));
+  EXPECT_EQ(actual_timer.registers(
+                static_cast<size_t>(CaptureEventProcessor::PmuCountersEncodingIndex::kCycles)),
+            2000);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(
+                CaptureEventProcessor::PmuCountersEncodingIndex::kInstructions)),
+            3000);
+  EXPECT_EQ(actual_timer.registers(
+                static_cast<size_t>(CaptureEventProcessor::PmuCountersEncodingIndex::kLlcMisses)),
+            4);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(
+                CaptureEventProcessor::PmuCountersEncodingIndex::kBranchMisses)),
+            5);
+}
+
+TEST(CaptureEventProcessor, CanHandleServiceHealthEvents) {
+  MockCaptureListener listener;
+  auto event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, std::filesystem::path{}, {});
+
+  ClientCaptureEvent event;
+  ServiceHealthEvent* service_health_event = event.mutable_service_health_event();
+  service_health_event->set_duration_ns(1000);
+  service_health_event->set_end_timestamp_ns(11000);
+  ServiceHealthEvent::RingBufferRecordCount* ring_buffer_record_count =
+      service_health_event->add_ring_buffer_record_counts();
+  ring_buffer_record_count->set_ring_buffer_name("sampling_0");
+  ring_buffer_record_count->set_record_count(100);
+  ring_buffer_record_count = service_health_event->add_ring_buffer_record_counts();
+  ring_buffer_record_count->set_ring_buffer_name("sampling_1");
+  ring_buffer_record_count->set_record_count(20);
+  service_health_event->set_perf_event_queue_size(3000);
+  service_health_event->set_max_deferred_event_count(400);
+  service_health_event->set_stack_sample_latency_p50_ns(5);
+  service_health_event->set_stack_sample_latency_p90_ns(6);
+  service_health_event->set_stack_sample_latency_p99_ns(7);
+  service_health_event->set_total_bytes_sent(8000);
+
+  TimerInfo actual_timer;
+  EXPECT_CALL(listener, OnTimer).Times(1).WillOnce(SaveArg<0>(&actual_timer));
+
+  event_processor->ProcessEvent(event);
+
+  using EncodingIndex = CaptureEventProcessor::ServiceHealthEncodingIndex;
+  EXPECT_EQ(actual_timer.type(), TimerInfo::kServiceHealth);
+  EXPECT_EQ(actual_timer.start(), 10000);
+  EXPECT_EQ(actual_timer.end(), 11000);
+  ASSERT_EQ(actual_timer.registers_size(), static_cast<int>(EncodingIndex::kEnd));
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kRecordCount)), 120);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kPerfEventQueueSize)), 3000);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kMaxDeferredEventCount)),
+            400);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kStackSampleLatencyP50Ns)),
+            5);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kStackSampleLatencyP90Ns)),
+            6);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kStackSampleLatencyP99Ns)),
+            7);
+  EXPECT_EQ(actual_timer.registers(static_cast<size_t>(EncodingIndex::kTotalBytesSent)), 8000);
+}
+
 TEST(CaptureEventProcessor, CanHandleMultipleEvents) {
   MockCaptureListener listener;
   auto event_processor =
@@ -0,0 +1,32 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureClient/ClockOffset.h"
+
+namespace orbit_capture_client {
+
+std::optional<ClockOffset> EstimateClockOffset(absl::Span<const ClockSyncSample> samples) {
+  const ClockSyncSample* best_sample = nullptr;
+  for (const ClockSyncSample& sample : samples) {
+    if (sample.client_receive_timestamp_ns < sample.client_send_timestamp_ns) continue;
+    if (best_sample == nullptr ||
+        sample.client_receive_timestamp_ns - sample.client_send_timestamp_ns <
+            best_sample->client_receive_timestamp_ns - best_sample->client_send_timestamp_ns) {
+      best_sample = &sample;
+    }
+  }
+  if (best_sample == nullptr) return std::nullopt;
+
+  const uint64_t round_trip_ns =
+      best_sample->client_receive_timestamp_ns - best_sample->client_send_timestamp_ns;
+  const uint64_t client_midpoint_ns = best_sample->client_send_timestamp_ns + round_trip_ns / 2;
+  ClockOffset clock_offset;
+  // Unsigned subtraction wraps around, which gives the right negative offset after the cast.
+  clock_offset.offset_ns =
+      static_cast<int64_t>(client_midpoint_ns - best_sample->service_timestamp_ns);
+  clock_offset.max_error_ns = round_trip_ns - round_trip_ns / 2;
+  return clock_offset;
+}
+
+}  // namespace orbit_capture_client
@@ -0,0 +1,225 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "CaptureClient/CaptureEventProcessor.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_client {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::GpuQueueSubmissionMetaInfo;
+
+namespace {
+
+class ClockOffsetEventProcessor : public CaptureEventProcessor {
+ public:
+  explicit ClockOffsetEventProcessor(int64_t clock_offset_ns,
+                                     std::unique_ptr<CaptureEventProcessor> event_processor)
+      : clock_offset_ns_{clock_offset_ns}, event_processor_{std::move(event_processor)} {}
+
+  void ProcessEvent(const ClientCaptureEvent& event) override {
+    ClientCaptureEvent shifted_event = event;
+    ShiftTimestamps(&shifted_event);
+    event_processor_->ProcessEvent(shifted_event);
+  }
+
+ private:
+  [[nodiscard]] uint64_t Shift(uint64_t timestamp_ns) const {
+    return timestamp_ns + static_cast<uint64_t>(clock_offset_ns_);
+  }
+
+  void ShiftMetaInfo(GpuQueueSubmissionMetaInfo* meta_info) const {
+    meta_info->set_pre_submission_cpu_timestamp(Shift(meta_info->pre_submission_cpu_timestamp()));
+    meta_info->set_post_submission_cpu_timestamp(
+        Shift(meta_info->post_submission_cpu_timestamp()));
+  }
+
+  // The batches encode the first timestamp as a delta from zero.
+  template <typename Deltas>
+  void ShiftFirstDelta(Deltas* deltas) const {
+    if (deltas->empty()) return;
+    deltas->Set(0, deltas->Get(0) + clock_offset_ns_);
+  }
+
+  // Only the timestamps in the capture clock of the service are shifted. GPU timestamps, durations,
+  // and the timestamp the client sets in PipelineLatencyProbe are left as they are.
+  void ShiftTimestamps(ClientCaptureEvent* event) const {
+    switch (event->event_case()) {
+      case ClientCaptureEvent::kApiEvent: {
+        auto* api_event = event->mutable_api_event();
+        api_event->set_timestamp_ns(Shift(api_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kCallstackSample: {
+        auto* callstack_sample = event->mutable_callstack_sample();
+        callstack_sample->set_timestamp_ns(Shift(callstack_sample->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kCallstackSampleBatch:
+        ShiftFirstDelta(event->mutable_callstack_sample_batch()->mutable_timestamp_ns_delta());
+        break;
+      case ClientCaptureEvent::kCaptureStartLatencyEvent: {
+        auto* latency_event = event->mutable_capture_start_latency_event();
+        latency_event->set_timestamp_ns(Shift(latency_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kCaptureStarted: {
+        auto* capture_started = event->mutable_capture_started();
+        capture_started->set_capture_start_timestamp_ns(
+            Shift(capture_started->capture_start_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kCaptureStatisticsSummary: {
+        auto* summary = event->mutable_capture_statistics_summary();
+        summary->set_end_timestamp_ns(Shift(summary->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kClockResolutionEvent: {
+        auto* clock_resolution_event = event->mutable_clock_resolution_event();
+        clock_resolution_event->set_timestamp_ns(Shift(clock_resolution_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kCompactApiEvent: {
+        auto* compact_api_event = event->mutable_compact_api_event();
+        compact_api_event->set_timestamp_ns(Shift(compact_api_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kErrorEnablingOrbitApiEvent: {
+        auto* error_event = event->mutable_error_enabling_orbit_api_event();
+        error_event->set_timestamp_ns(Shift(error_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kErrorsWithPerfEventOpenEvent: {
+        auto* errors_event = event->mutable_errors_with_perf_event_open_event();
+        errors_event->set_timestamp_ns(Shift(errors_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kFunctionCall: {
+        auto* function_call = event->mutable_function_call();
+        function_call->set_end_timestamp_ns(Shift(function_call->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kFunctionCallBatch:
+        ShiftFirstDelta(event->mutable_function_call_batch()->mutable_end_timestamp_ns_delta());
+        break;
+      case ClientCaptureEvent::kGpuClockCalibration: {
+        auto* calibration = event->mutable_gpu_clock_calibration();
+        calibration->set_cpu_timestamp_ns(Shift(calibration->cpu_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kGpuJob: {
+        auto* gpu_job = event->mutable_gpu_job();
+        gpu_job->set_amdgpu_cs_ioctl_time_ns(Shift(gpu_job->amdgpu_cs_ioctl_time_ns()));
+        gpu_job->set_amdgpu_sched_run_job_time_ns(Shift(gpu_job->amdgpu_sched_run_job_time_ns()));
+        gpu_job->set_gpu_hardware_start_time_ns(Shift(gpu_job->gpu_hardware_start_time_ns()));
+        gpu_job->set_dma_fence_signaled_time_ns(Shift(gpu_job->dma_fence_signaled_time_ns()));
+      } break;
+      case ClientCaptureEvent::kGpuQueueSubmission: {
+        auto* gpu_queue_submission = event->mutable_gpu_queue_submission();
+        ShiftMetaInfo(gpu_queue_submission->mutable_meta_info());
+        for (auto& marker : *gpu_queue_submission->mutable_completed_markers()) {
+          if (marker.has_begin_marker()) {
+            ShiftMetaInfo(marker.mutable_begin_marker()->mutable_meta_info());
+          }
+        }
+      } break;
+      case ClientCaptureEvent::kIntrospectionScope: {
+        auto* introspection_scope = event->mutable_introspection_scope();
+        introspection_scope->set_end_timestamp_ns(Shift(introspection_scope->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kLostPerfRecordsEvent: {
+        auto* lost_event = event->mutable_lost_perf_records_event();
+        lost_event->set_end_timestamp_ns(Shift(lost_event->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kMemoryUsageEvent: {
+        auto* memory_usage_event = event->mutable_memory_usage_event();
+        memory_usage_event->set_timestamp_ns(Shift(memory_usage_event->timestamp_ns()));
+        if (memory_usage_event->has_system_memory_usage()) {
+          auto* usage = memory_usage_event->mutable_system_memory_usage();
+          usage->set_timestamp_ns(Shift(usage->timestamp_ns()));
+        }
+        if (memory_usage_event->has_process_memory_usage()) {
+          auto* usage = memory_usage_event->mutable_process_memory_usage();
+          usage->set_timestamp_ns(Shift(usage->timestamp_ns()));
+        }
+        if (memory_usage_event->has_cgroup_memory_usage()) {
+          auto* usage = memory_usage_event->mutable_cgroup_memory_usage();
+          usage->set_timestamp_ns(Shift(usage->timestamp_ns()));
+        }
+      } break;
+      case ClientCaptureEvent::kModulesSnapshot: {
+        auto* modules_snapshot = event->mutable_modules_snapshot();
+        modules_snapshot->set_timestamp_ns(Shift(modules_snapshot->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kModuleUpdateEvent: {
+        auto* module_update = event->mutable_module_update_event();
+        module_update->set_timestamp_ns(Shift(module_update->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kOutOfOrderEventsDiscardedEvent: {
+        auto* discarded_event = event->mutable_out_of_order_events_discarded_event();
+        discarded_event->set_end_timestamp_ns(Shift(discarded_event->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kPipelineLatencyProbe: {
+        auto* probe = event->mutable_pipeline_latency_probe();
+        probe->set_record_timestamp_ns(Shift(probe->record_timestamp_ns()));
+        probe->set_ring_buffer_read_timestamp_ns(Shift(probe->ring_buffer_read_timestamp_ns()));
+        probe->set_processed_timestamp_ns(Shift(probe->processed_timestamp_ns()));
+        probe->set_sent_timestamp_ns(Shift(probe->sent_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kPmuCountersSample: {
+        auto* pmu_counters_sample = event->mutable_pmu_counters_sample();
+        pmu_counters_sample->set_end_timestamp_ns(Shift(pmu_counters_sample->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kSamplingPeriodChangedEvent: {
+        auto* period_event = event->mutable_sampling_period_changed_event();
+        period_event->set_timestamp_ns(Shift(period_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kSchedulingSlice: {
+        auto* scheduling_slice = event->mutable_scheduling_slice();
+        scheduling_slice->set_out_timestamp_ns(Shift(scheduling_slice->out_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kSchedulingSliceBatch:
+        ShiftFirstDelta(
+            event->mutable_scheduling_slice_batch()->mutable_out_timestamp_ns_delta());
+        break;
+      case ClientCaptureEvent::kServiceHealthEvent: {
+        auto* health_event = event->mutable_service_health_event();
+        health_event->set_end_timestamp_ns(Shift(health_event->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kThreadName: {
+        auto* thread_name = event->mutable_thread_name();
+        thread_name->set_timestamp_ns(Shift(thread_name->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kThreadNamesSnapshot: {
+        auto* snapshot = event->mutable_thread_names_snapshot();
+        snapshot->set_timestamp_ns(Shift(snapshot->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kThreadStateSlice: {
+        auto* thread_state_slice = event->mutable_thread_state_slice();
+        thread_state_slice->set_end_timestamp_ns(Shift(thread_state_slice->end_timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kTracepointEvent: {
+        auto* tracepoint_event = event->mutable_tracepoint_event();
+        tracepoint_event->set_timestamp_ns(Shift(tracepoint_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kWarningEvent: {
+        auto* warning_event = event->mutable_warning_event();
+        warning_event->set_timestamp_ns(Shift(warning_event->timestamp_ns()));
+      } break;
+      case ClientCaptureEvent::kAddressInfo:
+      case ClientCaptureEvent::kCaptureFinished:
+      case ClientCaptureEvent::kInternedCallstack:
+      case ClientCaptureEvent::kInternedString:
+      case ClientCaptureEvent::kInternedTracepointInfo:
+      case ClientCaptureEvent::EVENT_NOT_SET:
+        break;
+    }
+  }
+
+  const int64_t clock_offset_ns_;
+  std::unique_ptr<CaptureEventProcessor> event_processor_;
+};
+
+}  // namespace
+
+std::unique_ptr<CaptureEventProcessor> CaptureEventProcessor::CreateClockOffsetProcessor(
+    int64_t clock_offset_ns, std::unique_ptr<CaptureEventProcessor> event_processor) {
+  if (clock_offset_ns == 0) return event_processor;
+  return std::make_unique<ClockOffsetEventProcessor>(clock_offset_ns, std::move(event_processor));
+}
+
+}  // namespace orbit_capture_client
@@ -0,0 +1,84 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "CaptureClient/CaptureEventProcessor.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_client {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+using ::testing::SaveArg;
+
+namespace {
+
+class MockEventProcessor : public CaptureEventProcessor {
+ public:
+  MOCK_METHOD(void, ProcessEvent, (const ClientCaptureEvent& event), (override));
+};
+
+constexpr int64_t kClockOffsetNs = -1000;
+
+ClientCaptureEvent ProcessWithClockOffset(const ClientCaptureEvent& event) {
+  auto mock_processor = std::make_unique<MockEventProcessor>();
+  ClientCaptureEvent processed_event;
+  EXPECT_CALL(*mock_processor, ProcessEvent).WillOnce(SaveArg<0>(&processed_event));
+  auto processor =
+      CaptureEventProcessor::CreateClockOffsetProcessor(kClockOffsetNs, std::move(mock_processor));
+  processor->ProcessEvent(event);
+  return processed_event;
+}
+
+}  // namespace
+
+TEST(ClockOffsetEventProcessor, ShiftsTheTimestampsOfEvents) {
+  ClientCaptureEvent event;
+  event.mutable_function_call()->set_end_timestamp_ns(5000);
+  event.mutable_function_call()->set_duration_ns(300);
+  ClientCaptureEvent processed_event = ProcessWithClockOffset(event);
+  EXPECT_EQ(processed_event.function_call().end_timestamp_ns(), 4000);
+  EXPECT_EQ(processed_event.function_call().duration_ns(), 300);
+}
+
+TEST(ClockOffsetEventProcessor, ShiftsOnlyTheFirstTimestampOfBatches) {
+  ClientCaptureEvent event;
+  event.mutable_callstack_sample_batch()->add_timestamp_ns_delta(5000);
+  event.mutable_callstack_sample_batch()->add_timestamp_ns_delta(100);
+  ClientCaptureEvent processed_event = ProcessWithClockOffset(event);
+  ASSERT_EQ(processed_event.callstack_sample_batch().timestamp_ns_delta_size(), 2);
+  EXPECT_EQ(processed_event.callstack_sample_batch().timestamp_ns_delta(0), 4000);
+  EXPECT_EQ(processed_event.callstack_sample_batch().timestamp_ns_delta(1), 100);
+}
+
+TEST(ClockOffsetEventProcessor, DoesNotShiftGpuTimestamps) {
+  ClientCaptureEvent event;
+  auto* gpu_queue_submission = event.mutable_gpu_queue_submission();
+  gpu_queue_submission->mutable_meta_info()->set_pre_submission_cpu_timestamp(5000);
+  gpu_queue_submission->mutable_meta_info()->set_post_submission_cpu_timestamp(6000);
+  auto* command_buffer = gpu_queue_submission->add_submit_infos()->add_command_buffers();
+  command_buffer->set_begin_gpu_timestamp_ns(7000);
+  command_buffer->set_end_gpu_timestamp_ns(8000);
+  ClientCaptureEvent processed_event = ProcessWithClockOffset(event);
+  const auto& processed_submission = processed_event.gpu_queue_submission();
+  EXPECT_EQ(processed_submission.meta_info().pre_submission_cpu_timestamp(), 4000);
+  EXPECT_EQ(processed_submission.meta_info().post_submission_cpu_timestamp(), 5000);
+  EXPECT_EQ(processed_submission.submit_infos(0).command_buffers(0).begin_gpu_timestamp_ns(),
+            7000);
+  EXPECT_EQ(processed_submission.submit_infos(0).command_buffers(0).end_gpu_timestamp_ns(), 8000);
+}
+
+TEST(ClockOffsetEventProcessor, DoesNotShiftTheTimestampOfTheClient) {
+  ClientCaptureEvent event;
+  event.mutable_pipeline_latency_probe()->set_sent_timestamp_ns(5000);
+  event.mutable_pipeline_latency_probe()->set_received_timestamp_ns(4500);
+  ClientCaptureEvent processed_event = ProcessWithClockOffset(event);
+  EXPECT_EQ(processed_event.pipeline_latency_probe().sent_timestamp_ns(), 4000);
+  EXPECT_EQ(processed_event.pipeline_latency_probe().received_timestamp_ns(), 4500);
+}
+
+}  // namespace orbit_capture_client
@@ -0,0 +1,47 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <vector>
+
+#include "CaptureClient/ClockOffset.h"
+
+namespace orbit_capture_client {
+
+TEST(ClockOffset, ReturnsNulloptWithoutSamples) {
+  EXPECT_FALSE(EstimateClockOffset({}).has_value());
+}
+
+TEST(ClockOffset, UsesTheMidpointOfTheRoundTrip) {
+  std::optional<ClockOffset> clock_offset = EstimateClockOffset({{1000, 5500, 1200}});
+  ASSERT_TRUE(clock_offset.has_value());
+  EXPECT_EQ(clock_offset->offset_ns, 1100 - 5500);
+  EXPECT_EQ(clock_offset->max_error_ns, 100);
+
+  clock_offset = EstimateClockOffset({{5000, 1040, 5100}});
+  ASSERT_TRUE(clock_offset.has_value());
+  EXPECT_EQ(clock_offset->offset_ns, 5050 - 1040);
+  EXPECT_EQ(clock_offset->max_error_ns, 50);
+}
+
+TEST(ClockOffset, UsesTheSampleWithTheShortestRoundTrip) {
+  std::vector<ClockSyncSample> samples{{1000, 2600, 1400}, {2000, 3520, 2040}, {3000, 4700, 3300}};
+  std::optional<ClockOffset> clock_offset = EstimateClockOffset(samples);
+  ASSERT_TRUE(clock_offset.has_value());
+  EXPECT_EQ(clock_offset->offset_ns, 2020 - 3520);
+  EXPECT_EQ(clock_offset->max_error_ns, 20);
+}
+
+TEST(ClockOffset, IgnoresSamplesReceivedBeforeBeingSent) {
+  std::vector<ClockSyncSample> samples{{1000, 2000, 900}, {3000, 4000, 3100}};
+  std::optional<ClockOffset> clock_offset = EstimateClockOffset(samples);
+  ASSERT_TRUE(clock_offset.has_value());
+  EXPECT_EQ(clock_offset->offset_ns, 3050 - 4000);
+
+  EXPECT_FALSE(EstimateClockOffset({{1000, 2000, 900}}).has_value());
+}
+
+}  // namespace orbit_capture_client
@@ -4,6 +4,11 @@
 
 #include "CaptureClient/GpuQueueSubmissionProcessor.h"
 
+#include <algorithm>
+#include <deque>
+#include <iterator>
+
+#include "CaptureClient/CaptureEventProcessor.h"
 #include "OrbitBase/Logging.h"
 
 namespace orbit_capture_client {
@@ -13,8 +18,55 @@ using orbit_client_protos::TimerInfo;
 
 using orbit_grpc_protos::GpuCommandBuffer;
 using orbit_grpc_protos::GpuJob;
+using orbit_grpc_protos::GpuPipelineStatistics;
 using orbit_grpc_protos::GpuQueueSubmission;
 
+namespace {
+
+constexpr auto kGetGpuJobTime = [](const auto& gpu_job) {
+  return gpu_job.amdgpu_cs_ioctl_time_ns;
+};
+
+constexpr auto kGetPostSubmissionTime = [](const GpuQueueSubmission& gpu_queue_submission) {
+  return gpu_queue_submission.meta_info().post_submission_cpu_timestamp();
+};
+
+// Returns the first event whose timestamp is not less than `timestamp`.
+template <typename Events, typename GetTimestamp>
+[[nodiscard]] auto LowerBound(Events& events, uint64_t timestamp, GetTimestamp get_timestamp) {
+  return std::lower_bound(events.begin(), events.end(), timestamp,
+                          [&get_timestamp](const auto& event, uint64_t value) {
+                            return get_timestamp(event) < value;
+                          });
+}
+
+// Events mostly arrive in order, in which case this appends `event`.
+template <typename Event, typename GetTimestamp>
+void InsertOrAssignSorted(std::deque<Event>* events, const Event& event,
+                          GetTimestamp get_timestamp) {
+  const uint64_t timestamp = get_timestamp(event);
+  if (events->empty() || get_timestamp(events->back()) < timestamp) {
+    events->push_back(event);
+    return;
+  }
+  auto it = LowerBound(*events, timestamp, get_timestamp);
+  if (it != events->end() && get_timestamp(*it) == timestamp) {
+    *it = event;
+    return;
+  }
+  events->insert(it, event);
+}
+
+template <typename Event, typename GetTimestamp>
+void EraseSorted(std::deque<Event>* events, uint64_t timestamp, GetTimestamp get_timestamp) {
+  auto it = LowerBound(*events, timestamp, get_timestamp);
+  if (it != events->end() && get_timestamp(*it) == timestamp) {
+    events->erase(it);
+  }
+}
+
+}  // namespace
+
 std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuQueueSubmission(
     const GpuQueueSubmission& gpu_queue_submission,
     const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool,
@@ -25,7 +77,8 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuQueueSubmission(
       gpu_queue_submission.meta_info().pre_submission_cpu_timestamp();
   uint64_t post_submission_cpu_timestamp =
       gpu_queue_submission.meta_info().post_submission_cpu_timestamp();
-  const GpuJob* matching_gpu_job =
+  DropUnmatchedEvents(thread_id, post_submission_cpu_timestamp);
+  const SavedGpuJob* matching_gpu_job =
       FindMatchingGpuJob(thread_id, pre_submission_cpu_timestamp, post_submission_cpu_timestamp);
 
   // If we haven't found the matching "GpuJob" or the submission contains "begin" markers (which
@@ -33,11 +86,12 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuQueueSubmission(
   // Note that as soon as all "begin" markers have been processed, the "GpuSubmission" will be
   // deleted again.
   if (matching_gpu_job == nullptr || gpu_queue_submission.num_begin_markers() > 0) {
-    tid_to_post_submission_time_to_gpu_submission_[thread_id][post_submission_cpu_timestamp] =
-        gpu_queue_submission;
+    InsertOrAssignSorted(&tid_to_thread_events_[thread_id].gpu_queue_submissions,
+                         gpu_queue_submission, kGetPostSubmissionTime);
   }
   if (gpu_queue_submission.num_begin_markers() > 0) {
-    tid_to_post_submission_time_to_num_begin_markers_[thread_id][post_submission_cpu_timestamp] =
+    tid_to_thread_events_[thread_id]
+        .post_submission_time_to_num_begin_markers[post_submission_cpu_timestamp] =
         gpu_queue_submission.num_begin_markers();
   }
   if (matching_gpu_job == nullptr) {
@@ -46,7 +100,7 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuQueueSubmission(
 
   // Save the timestamp now, as after the call to `ProcessGpuQueueSubmissionWithMatchingGpuJob`,
   // the matching_gpu_job may already be deleted.
-  uint64_t submission_cpu_timestamp = matching_gpu_job->amdgpu_cs_ioctl_time_ns();
+  uint64_t submission_cpu_timestamp = matching_gpu_job->amdgpu_cs_ioctl_time_ns;
 
   std::vector<TimerInfo> result = ProcessGpuQueueSubmissionWithMatchingGpuJob(
       gpu_queue_submission, *matching_gpu_job, string_intern_pool,
@@ -63,15 +117,23 @@ std::vector<orbit_client_protos::TimerInfo> GpuQueueSubmissionProcessor::Process
         get_string_hash_and_send_to_listener_if_necessary) {
   int32_t thread_id = gpu_job.tid();
   uint64_t amdgpu_cs_ioctl_time_ns = gpu_job.amdgpu_cs_ioctl_time_ns();
+  DropUnmatchedEvents(thread_id, amdgpu_cs_ioctl_time_ns);
   const GpuQueueSubmission* matching_gpu_submission =
       FindMatchingGpuQueueSubmission(thread_id, amdgpu_cs_ioctl_time_ns);
 
+  SavedGpuJob saved_gpu_job;
+  saved_gpu_job.amdgpu_cs_ioctl_time_ns = amdgpu_cs_ioctl_time_ns;
+  saved_gpu_job.gpu_hardware_start_time_ns = gpu_job.gpu_hardware_start_time_ns();
+  saved_gpu_job.timeline_key = gpu_job.timeline_key();
+  saved_gpu_job.depth = gpu_job.depth();
+
   // If we haven't found the matching "GpuSubmission" or the submission contains "begin" markers
   // (which might have the "end" markers in a later submission), we save the "GpuJob" for later.
   // Note that as soon as all "begin" markers have been processed, the "GpuJob" will be deleted
   // again.
   if (matching_gpu_submission == nullptr || matching_gpu_submission->num_begin_markers() > 0) {
-    tid_to_submission_time_to_gpu_job_[thread_id][amdgpu_cs_ioctl_time_ns] = gpu_job;
+    InsertOrAssignSorted(&tid_to_thread_events_[thread_id].gpu_jobs, saved_gpu_job,
+                         kGetGpuJobTime);
   }
   if (matching_gpu_submission == nullptr) {
     return {};
@@ -81,7 +143,7 @@ std::vector<orbit_client_protos::TimerInfo> GpuQueueSubmissionProcessor::Process
       matching_gpu_submission->meta_info().post_submission_cpu_timestamp();
 
   std::vector<TimerInfo> result = ProcessGpuQueueSubmissionWithMatchingGpuJob(
-      *matching_gpu_submission, gpu_job, string_intern_pool,
+      *matching_gpu_submission, saved_gpu_job, string_intern_pool,
       get_string_hash_and_send_to_listener_if_necessary);
 
   if (!HasUnprocessedBeginMarkers(thread_id, post_submission_cpu_timestamp)) {
@@ -92,25 +154,23 @@ std::vector<orbit_client_protos::TimerInfo> GpuQueueSubmissionProcessor::Process
 
 const GpuQueueSubmission* GpuQueueSubmissionProcessor::FindMatchingGpuQueueSubmission(
     int32_t thread_id, uint64_t submit_time) {
-  const auto& post_submission_time_to_gpu_submission_it =
-      tid_to_post_submission_time_to_gpu_submission_.find(thread_id);
-  if (post_submission_time_to_gpu_submission_it ==
-      tid_to_post_submission_time_to_gpu_submission_.end()) {
+  const auto& thread_events_it = tid_to_thread_events_.find(thread_id);
+  if (thread_events_it == tid_to_thread_events_.end()) {
     return nullptr;
   }
 
-  const auto& post_submission_time_to_gpu_submission =
-      post_submission_time_to_gpu_submission_it->second;
+  const std::deque<GpuQueueSubmission>& gpu_queue_submissions =
+      thread_events_it->second.gpu_queue_submissions;
 
   // Find the first Gpu submission with a "post submission" timestamp greater or equal to the Gpu
   // job's timestamp. If the "pre submission" timestamp is not greater (i.e. less or equal) than the
   // job's timestamp, we have found the matching submission.
   auto lower_bound_gpu_submission_it =
-      post_submission_time_to_gpu_submission.lower_bound(submit_time);
-  if (lower_bound_gpu_submission_it == post_submission_time_to_gpu_submission.end()) {
+      LowerBound(gpu_queue_submissions, submit_time, kGetPostSubmissionTime);
+  if (lower_bound_gpu_submission_it == gpu_queue_submissions.end()) {
     return nullptr;
   }
-  const GpuQueueSubmission* matching_gpu_submission = &lower_bound_gpu_submission_it->second;
+  const GpuQueueSubmission* matching_gpu_submission = &*lower_bound_gpu_submission_it;
 
   if (matching_gpu_submission->meta_info().pre_submission_cpu_timestamp() > submit_time) {
     return nullptr;
@@ -119,46 +179,46 @@ const GpuQueueSubmission* GpuQueueSubmissionProcessor::FindMatchingGpuQueueSubmi
   return matching_gpu_submission;
 }
 
-const GpuJob* GpuQueueSubmissionProcessor::FindMatchingGpuJob(
+const GpuQueueSubmissionProcessor::SavedGpuJob* GpuQueueSubmissionProcessor::FindMatchingGpuJob(
     int32_t thread_id, uint64_t pre_submission_cpu_timestamp,
     uint64_t post_submission_cpu_timestamp) {
-  const auto& submission_time_to_gpu_job_it = tid_to_submission_time_to_gpu_job_.find(thread_id);
-  if (submission_time_to_gpu_job_it == tid_to_submission_time_to_gpu_job_.end()) {
+  const auto& thread_events_it = tid_to_thread_events_.find(thread_id);
+  if (thread_events_it == tid_to_thread_events_.end()) {
     return nullptr;
   }
 
-  const auto& submission_time_to_gpu_job = submission_time_to_gpu_job_it->second;
+  const std::deque<SavedGpuJob>& gpu_jobs = thread_events_it->second.gpu_jobs;
 
   // Find the first Gpu job that has a timestamp greater or equal to the "pre submission" timestamp:
   auto gpu_job_matching_pre_submission_it =
-      submission_time_to_gpu_job.lower_bound(pre_submission_cpu_timestamp);
-  if (gpu_job_matching_pre_submission_it == submission_time_to_gpu_job.end()) {
+      LowerBound(gpu_jobs, pre_submission_cpu_timestamp, kGetGpuJobTime);
+  if (gpu_job_matching_pre_submission_it == gpu_jobs.end()) {
     return nullptr;
   }
 
   // Find the first Gpu job that has a timestamp greater to the "post submission" timestamp
   // (which would be the next job) and decrease the iterator by one.
   auto gpu_job_matching_post_submission_it =
-      submission_time_to_gpu_job.upper_bound(post_submission_cpu_timestamp);
-  if (gpu_job_matching_post_submission_it == submission_time_to_gpu_job.begin()) {
+      LowerBound(gpu_jobs, post_submission_cpu_timestamp + 1, kGetGpuJobTime);
+  if (gpu_job_matching_post_submission_it == gpu_jobs.begin()) {
     return nullptr;
   }
   --gpu_job_matching_post_submission_it;
 
-  if (&gpu_job_matching_pre_submission_it->second != &gpu_job_matching_post_submission_it->second) {
+  if (gpu_job_matching_pre_submission_it != gpu_job_matching_post_submission_it) {
     return nullptr;
   }
 
-  return &gpu_job_matching_pre_submission_it->second;
+  return &*gpu_job_matching_pre_submission_it;
 }
 
 std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuQueueSubmissionWithMatchingGpuJob(
-    const GpuQueueSubmission& gpu_queue_submission, const GpuJob& matching_gpu_job,
+    const GpuQueueSubmission& gpu_queue_submission, const SavedGpuJob& matching_gpu_job,
     const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool,
     const std::function<uint64_t(const std::string& str)>&
         get_string_hash_and_send_to_listener_if_necessary) {
   std::vector<TimerInfo> result;
-  uint64_t timeline_key = matching_gpu_job.timeline_key();
+  uint64_t timeline_key = matching_gpu_job.timeline_key;
   CHECK(string_intern_pool.contains(timeline_key));
   std::string timeline = string_intern_pool.at(timeline_key);
 
@@ -188,30 +248,32 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuQueueSubmissionWit
 
 bool GpuQueueSubmissionProcessor::HasUnprocessedBeginMarkers(
     int32_t thread_id, uint64_t post_submission_timestamp) const {
-  if (!tid_to_post_submission_time_to_num_begin_markers_.contains(thread_id)) {
+  const auto& thread_events_it = tid_to_thread_events_.find(thread_id);
+  if (thread_events_it == tid_to_thread_events_.end()) {
     return false;
   }
-  if (!tid_to_post_submission_time_to_num_begin_markers_.at(thread_id).contains(
-          post_submission_timestamp)) {
+  const auto& post_submission_time_to_num_begin_markers =
+      thread_events_it->second.post_submission_time_to_num_begin_markers;
+  const auto& num_begin_markers_it =
+      post_submission_time_to_num_begin_markers.find(post_submission_timestamp);
+  if (num_begin_markers_it == post_submission_time_to_num_begin_markers.end()) {
     return false;
   }
-  CHECK(tid_to_post_submission_time_to_num_begin_markers_.at(thread_id).at(
-            post_submission_timestamp) > 0);
+  CHECK(num_begin_markers_it->second > 0);
   return true;
 }
 
 void GpuQueueSubmissionProcessor::DecrementUnprocessedBeginMarkers(
     int32_t thread_id, uint64_t submission_timestamp, uint64_t post_submission_timestamp) {
-  CHECK(tid_to_post_submission_time_to_num_begin_markers_.contains(thread_id));
+  CHECK(tid_to_thread_events_.contains(thread_id));
   auto& post_submission_time_to_num_begin_markers =
-      tid_to_post_submission_time_to_num_begin_markers_.at(thread_id);
+      tid_to_thread_events_.at(thread_id).post_submission_time_to_num_begin_markers;
   CHECK(post_submission_time_to_num_begin_markers.contains(post_submission_timestamp));
   uint64_t new_num = post_submission_time_to_num_begin_markers.at(post_submission_timestamp) - 1;
   post_submission_time_to_num_begin_markers.at(post_submission_timestamp) = new_num;
   if (new_num == 0) {
     post_submission_time_to_num_begin_markers.erase(post_submission_timestamp);
     if (post_submission_time_to_num_begin_markers.empty()) {
-      tid_to_post_submission_time_to_num_begin_markers_.erase(thread_id);
       DeleteSavedGpuJob(thread_id, submission_timestamp);
       DeleteSavedGpuSubmission(thread_id, post_submission_timestamp);
     }
@@ -220,33 +282,75 @@ void GpuQueueSubmissionProcessor::DecrementUnprocessedBeginMarkers(
 
 void GpuQueueSubmissionProcessor::DeleteSavedGpuJob(int32_t thread_id,
                                                     uint64_t submission_timestamp) {
-  if (!tid_to_submission_time_to_gpu_job_.contains(thread_id)) {
-    return;
-  }
   // This method might be called even when the "capture start" falls directly inside a GpuJob, and
-  // we thus don't have the job present in the map.
-  // For simplicity we "erase" it anyways (insert and remove it again).
-  auto& submission_time_to_gpu_job = tid_to_submission_time_to_gpu_job_[thread_id];
-  submission_time_to_gpu_job.erase(submission_timestamp);
-  if (submission_time_to_gpu_job.empty()) {
-    tid_to_submission_time_to_gpu_job_.erase(thread_id);
+  // we thus don't have the job saved.
+  if (!tid_to_thread_events_.contains(thread_id)) {
+    return;
   }
+  EraseSorted(&tid_to_thread_events_.at(thread_id).gpu_jobs, submission_timestamp,
+              kGetGpuJobTime);
+  DeleteThreadEventsIfEmpty(thread_id);
 }
 void GpuQueueSubmissionProcessor::DeleteSavedGpuSubmission(int32_t thread_id,
                                                            uint64_t post_submission_timestamp) {
-  if (!tid_to_post_submission_time_to_gpu_submission_.contains(thread_id)) {
+  if (!tid_to_thread_events_.contains(thread_id)) {
     return;
   }
-  auto& post_submission_time_to_gpu_submission =
-      tid_to_post_submission_time_to_gpu_submission_.at(thread_id);
-  post_submission_time_to_gpu_submission.erase(post_submission_timestamp);
-  if (post_submission_time_to_gpu_submission.empty()) {
-    tid_to_post_submission_time_to_gpu_submission_.erase(thread_id);
+  EraseSorted(&tid_to_thread_events_.at(thread_id).gpu_queue_submissions,
+              post_submission_timestamp, kGetPostSubmissionTime);
+  DeleteThreadEventsIfEmpty(thread_id);
+}
+
+void GpuQueueSubmissionProcessor::DeleteThreadEventsIfEmpty(int32_t thread_id) {
+  const ThreadEvents& thread_events = tid_to_thread_events_.at(thread_id);
+  if (thread_events.gpu_jobs.empty() && thread_events.gpu_queue_submissions.empty() &&
+      thread_events.post_submission_time_to_num_begin_markers.empty()) {
+    tid_to_thread_events_.erase(thread_id);
+  }
+}
+
+void GpuQueueSubmissionProcessor::DropUnmatchedEvents(int32_t thread_id, uint64_t timestamp_ns) {
+  if (timestamp_ns < kMaxUnmatchedEventAgeNs) {
+    return;
+  }
+  const auto& thread_events_it = tid_to_thread_events_.find(thread_id);
+  if (thread_events_it == tid_to_thread_events_.end()) {
+    return;
+  }
+  ThreadEvents& thread_events = thread_events_it->second;
+  const uint64_t min_timestamp_ns = timestamp_ns - kMaxUnmatchedEventAgeNs;
+
+  // The deques are sorted, so only their beginning needs to be looked at. The submissions with
+  // unprocessed "begin" markers, and the jobs matching them, are still needed.
+  for (auto it = thread_events.gpu_jobs.begin();
+       it != thread_events.gpu_jobs.end() && it->amdgpu_cs_ioctl_time_ns < min_timestamp_ns;) {
+    const GpuQueueSubmission* matching_gpu_submission =
+        FindMatchingGpuQueueSubmission(thread_id, it->amdgpu_cs_ioctl_time_ns);
+    if (matching_gpu_submission != nullptr &&
+        HasUnprocessedBeginMarkers(thread_id, kGetPostSubmissionTime(*matching_gpu_submission))) {
+      ++it;
+      continue;
+    }
+    it = thread_events.gpu_jobs.erase(it);
+    ++dropped_gpu_job_count_;
+  }
+
+  for (auto it = thread_events.gpu_queue_submissions.begin();
+       it != thread_events.gpu_queue_submissions.end() &&
+       kGetPostSubmissionTime(*it) < min_timestamp_ns;) {
+    if (HasUnprocessedBeginMarkers(thread_id, kGetPostSubmissionTime(*it))) {
+      ++it;
+      continue;
+    }
+    it = thread_events.gpu_queue_submissions.erase(it);
+    ++dropped_gpu_queue_submission_count_;
   }
+
+  DeleteThreadEventsIfEmpty(thread_id);
 }
 
 std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuCommandBuffers(
-    const GpuQueueSubmission& gpu_queue_submission, const GpuJob& matching_gpu_job,
+    const GpuQueueSubmission& gpu_queue_submission, const SavedGpuJob& matching_gpu_job,
     const std::optional<GpuCommandBuffer>& first_command_buffer, uint64_t timeline_hash,
     const std::function<uint64_t(const std::string& str)>&
         get_string_hash_and_send_to_listener_if_necessary) {
@@ -264,17 +368,17 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuCommandBuffers(
       CHECK(first_command_buffer != std::nullopt);
       TimerInfo command_buffer_timer;
       if (command_buffer.begin_gpu_timestamp_ns() != 0) {
-        command_buffer_timer.set_start(command_buffer.begin_gpu_timestamp_ns() -
-                                       first_command_buffer->begin_gpu_timestamp_ns() +
-                                       matching_gpu_job.gpu_hardware_start_time_ns());
+        command_buffer_timer.set_start(ConvertGpuTimestampToCpu(
+            command_buffer.begin_gpu_timestamp_ns(), first_command_buffer->begin_gpu_timestamp_ns(),
+            matching_gpu_job));
       } else {
         command_buffer_timer.set_start(begin_capture_time_ns_);
       }
 
-      command_buffer_timer.set_end(command_buffer.end_gpu_timestamp_ns() -
-                                   first_command_buffer->begin_gpu_timestamp_ns() +
-                                   matching_gpu_job.gpu_hardware_start_time_ns());
-      command_buffer_timer.set_depth(matching_gpu_job.depth());
+      command_buffer_timer.set_end(ConvertGpuTimestampToCpu(
+          command_buffer.end_gpu_timestamp_ns(), first_command_buffer->begin_gpu_timestamp_ns(),
+          matching_gpu_job));
+      command_buffer_timer.set_depth(matching_gpu_job.depth);
       command_buffer_timer.set_timeline_hash(timeline_hash);
       command_buffer_timer.set_processor(-1);
       command_buffer_timer.set_thread_id(thread_id);
@@ -288,7 +392,7 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuCommandBuffers(
 }
 
 std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuDebugMarkers(
-    const GpuQueueSubmission& gpu_queue_submission, const GpuJob& matching_gpu_job,
+    const GpuQueueSubmission& gpu_queue_submission, const SavedGpuJob& matching_gpu_job,
     const std::optional<GpuCommandBuffer>& first_command_buffer) {
   if (gpu_queue_submission.completed_markers_size() == 0) {
     return {};
@@ -361,19 +465,20 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuDebugMarkers(
       }
       CHECK(begin_submission_first_command_buffer.has_value());
 
-      const GpuJob* matching_begin_job = FindMatchingGpuJob(
+      const SavedGpuJob* matching_begin_job = FindMatchingGpuJob(
           begin_marker_thread_id, begin_marker_meta_info.pre_submission_cpu_timestamp(),
           begin_marker_post_submission_cpu_timestamp);
 
       uint64_t begin_submission_time_ns = 0;
       if (matching_begin_job != nullptr) {
         // Convert the GPU time to CPU time, based on the CPU time of the HW execution begin and the
-        // GPU timestamp of the begin of the first command buffer. Note that we will assume that the
-        // first command buffer starts execution right away as an approximation.
-        marker_timer.set_start(completed_marker.begin_marker().gpu_timestamp_ns() +
-                               matching_begin_job->gpu_hardware_start_time_ns() -
-                               begin_submission_first_command_buffer->begin_gpu_timestamp_ns());
-        begin_submission_time_ns = matching_begin_job->amdgpu_cs_ioctl_time_ns();
+        // GPU timestamp of the begin of the first command buffer (unless we have calibrations).
+        // Note that we will assume that the first command buffer starts execution right away as an
+        // approximation.
+        marker_timer.set_start(ConvertGpuTimestampToCpu(
+            completed_marker.begin_marker().gpu_timestamp_ns(),
+            begin_submission_first_command_buffer->begin_gpu_timestamp_ns(), *matching_begin_job));
+        begin_submission_time_ns = matching_begin_job->amdgpu_cs_ioctl_time_ns;
       } else {
         // We might have bad luck and have captured the "begin" submission, but not the matching
         // job.
@@ -398,12 +503,12 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuDebugMarkers(
 
     marker_timer.set_process_id(submission_process_id);
     marker_timer.set_depth(completed_marker.depth());
-    marker_timer.set_timeline_hash(matching_gpu_job.timeline_key());
+    marker_timer.set_timeline_hash(matching_gpu_job.timeline_key);
     marker_timer.set_processor(-1);
     marker_timer.set_type(TimerInfo::kGpuDebugMarker);
-    marker_timer.set_end(completed_marker.end_gpu_timestamp_ns() -
-                         first_command_buffer->begin_gpu_timestamp_ns() +
-                         matching_gpu_job.gpu_hardware_start_time_ns());
+    marker_timer.set_end(ConvertGpuTimestampToCpu(completed_marker.end_gpu_timestamp_ns(),
+                                                  first_command_buffer->begin_gpu_timestamp_ns(),
+                                                  matching_gpu_job));
 
     if (completed_marker.has_color()) {
       Color* color = marker_timer.mutable_color();
@@ -412,6 +517,24 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuDebugMarkers(
       color->set_blue(static_cast<uint32_t>(completed_marker.color().blue() * 255.f));
       color->set_alpha(static_cast<uint32_t>(completed_marker.color().alpha() * 255.f));
     }
+    if (completed_marker.has_pipeline_statistics()) {
+      // Encoded in the order of CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex.
+      const GpuPipelineStatistics& statistics = completed_marker.pipeline_statistics();
+      marker_timer.add_registers(statistics.input_assembly_vertices());
+      marker_timer.add_registers(statistics.input_assembly_primitives());
+      marker_timer.add_registers(statistics.vertex_shader_invocations());
+      marker_timer.add_registers(statistics.geometry_shader_invocations());
+      marker_timer.add_registers(statistics.geometry_shader_primitives());
+      marker_timer.add_registers(statistics.clipping_invocations());
+      marker_timer.add_registers(statistics.clipping_primitives());
+      marker_timer.add_registers(statistics.fragment_shader_invocations());
+      marker_timer.add_registers(statistics.tessellation_control_shader_patches());
+      marker_timer.add_registers(statistics.tessellation_evaluation_shader_invocations());
+      marker_timer.add_registers(statistics.compute_shader_invocations());
+      CHECK(marker_timer.registers_size() ==
+            static_cast<int>(
+                CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex::kEnd));
+    }
     marker_timer.set_user_data_key(completed_marker.text_key());
     result.push_back(marker_timer);
   }
@@ -423,6 +546,31 @@ std::vector<TimerInfo> GpuQueueSubmissionProcessor::ProcessGpuDebugMarkers(
   return result;
 }
 
+uint64_t GpuQueueSubmissionProcessor::ConvertGpuTimestampToCpu(
+    uint64_t gpu_timestamp_ns, uint64_t first_command_buffer_begin_gpu_timestamp_ns,
+    const SavedGpuJob& gpu_job) const {
+  if (gpu_to_cpu_timestamp_ns_.empty()) {
+    return gpu_timestamp_ns - first_command_buffer_begin_gpu_timestamp_ns +
+           gpu_job.gpu_hardware_start_time_ns;
+  }
+
+  // Interpolate between the calibrations before and after the timestamp, or use the offset of the
+  // closest calibration if the timestamp is not between two calibrations.
+  auto next_it = gpu_to_cpu_timestamp_ns_.lower_bound(gpu_timestamp_ns);
+  if (next_it == gpu_to_cpu_timestamp_ns_.end()) {
+    --next_it;
+    return gpu_timestamp_ns - next_it->first + next_it->second;
+  }
+  if (next_it->first == gpu_timestamp_ns || next_it == gpu_to_cpu_timestamp_ns_.begin()) {
+    return next_it->second + gpu_timestamp_ns - next_it->first;
+  }
+  auto previous_it = std::prev(next_it);
+  const double fraction = static_cast<double>(gpu_timestamp_ns - previous_it->first) /
+                          static_cast<double>(next_it->first - previous_it->first);
+  const double cpu_duration_ns = static_cast<double>(next_it->second - previous_it->second);
+  return previous_it->second + static_cast<uint64_t>(fraction * cpu_duration_ns);
+}
+
 std::optional<GpuCommandBuffer> GpuQueueSubmissionProcessor::ExtractFirstCommandBuffer(
     const GpuQueueSubmission& gpu_queue_submission) {
   for (const auto& submit_info : gpu_queue_submission.submit_infos()) {
@@ -0,0 +1,157 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "CaptureClient/GpuQueueSubmissionProcessor.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+using orbit_grpc_protos::GpuCommandBuffer;
+using orbit_grpc_protos::GpuDebugMarker;
+using orbit_grpc_protos::GpuJob;
+using orbit_grpc_protos::GpuQueueSubmission;
+using orbit_grpc_protos::GpuQueueSubmissionMetaInfo;
+
+namespace orbit_capture_client {
+
+namespace {
+
+constexpr int32_t kPid = 1;
+constexpr int32_t kTid = 2;
+constexpr uint64_t kTimelineKey = 17;
+
+GpuJob CreateGpuJob(uint64_t amdgpu_cs_ioctl_time_ns) {
+  GpuJob gpu_job;
+  gpu_job.set_pid(kPid);
+  gpu_job.set_tid(kTid);
+  gpu_job.set_timeline_key(kTimelineKey);
+  gpu_job.set_depth(3);
+  gpu_job.set_amdgpu_cs_ioctl_time_ns(amdgpu_cs_ioctl_time_ns);
+  gpu_job.set_amdgpu_sched_run_job_time_ns(amdgpu_cs_ioctl_time_ns + 10);
+  gpu_job.set_gpu_hardware_start_time_ns(amdgpu_cs_ioctl_time_ns + 20);
+  gpu_job.set_dma_fence_signaled_time_ns(amdgpu_cs_ioctl_time_ns + 30);
+  return gpu_job;
+}
+
+// Creates a submission with a single command buffer, which matches the job created by
+// CreateGpuJob(amdgpu_cs_ioctl_time_ns).
+GpuQueueSubmission CreateGpuQueueSubmission(uint64_t amdgpu_cs_ioctl_time_ns) {
+  GpuQueueSubmission submission;
+  GpuQueueSubmissionMetaInfo* meta_info = submission.mutable_meta_info();
+  meta_info->set_tid(kTid);
+  meta_info->set_pid(kPid);
+  meta_info->set_pre_submission_cpu_timestamp(amdgpu_cs_ioctl_time_ns - 1);
+  meta_info->set_post_submission_cpu_timestamp(amdgpu_cs_ioctl_time_ns + 1);
+  GpuCommandBuffer* command_buffer = submission.add_submit_infos()->add_command_buffers();
+  command_buffer->set_begin_gpu_timestamp_ns(1000);
+  command_buffer->set_end_gpu_timestamp_ns(1005);
+  return submission;
+}
+
+class GpuQueueSubmissionProcessorTest : public ::testing::Test {
+ protected:
+  std::vector<TimerInfo> ProcessGpuJob(const GpuJob& gpu_job) {
+    return processor_.ProcessGpuJob(gpu_job, string_intern_pool_, get_string_hash_);
+  }
+
+  std::vector<TimerInfo> ProcessGpuQueueSubmission(const GpuQueueSubmission& submission) {
+    return processor_.ProcessGpuQueueSubmission(submission, string_intern_pool_,
+                                                get_string_hash_);
+  }
+
+  GpuQueueSubmissionProcessor processor_;
+
+ private:
+  absl::flat_hash_map<uint64_t, std::string> string_intern_pool_{{kTimelineKey, "timeline"}};
+  std::function<uint64_t(const std::string& str)> get_string_hash_ =
+      [](const std::string& /*str*/) -> uint64_t { return 42; };
+};
+
+}  // namespace
+
+TEST_F(GpuQueueSubmissionProcessorTest, MatchesGpuQueueSubmissionAfterGpuJob) {
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(100)).empty());
+  std::vector<TimerInfo> timers = ProcessGpuQueueSubmission(CreateGpuQueueSubmission(100));
+  ASSERT_EQ(timers.size(), 1);
+  EXPECT_EQ(timers[0].start(), 120);
+  EXPECT_EQ(timers[0].end(), 125);
+  EXPECT_EQ(timers[0].depth(), 3);
+}
+
+TEST_F(GpuQueueSubmissionProcessorTest, MatchesGpuJobAfterGpuQueueSubmission) {
+  EXPECT_TRUE(ProcessGpuQueueSubmission(CreateGpuQueueSubmission(100)).empty());
+  std::vector<TimerInfo> timers = ProcessGpuJob(CreateGpuJob(100));
+  ASSERT_EQ(timers.size(), 1);
+  EXPECT_EQ(timers[0].start(), 120);
+  EXPECT_EQ(timers[0].end(), 125);
+}
+
+TEST_F(GpuQueueSubmissionProcessorTest, MatchesEventsArrivingOutOfOrder) {
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(300)).empty());
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(100)).empty());
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(200)).empty());
+
+  std::vector<TimerInfo> timers = ProcessGpuQueueSubmission(CreateGpuQueueSubmission(200));
+  ASSERT_EQ(timers.size(), 1);
+  EXPECT_EQ(timers[0].start(), 220);
+  EXPECT_EQ(ProcessGpuQueueSubmission(CreateGpuQueueSubmission(100)).size(), 1);
+  EXPECT_EQ(ProcessGpuQueueSubmission(CreateGpuQueueSubmission(300)).size(), 1);
+  EXPECT_EQ(processor_.GetDroppedGpuJobCount(), 0);
+}
+
+TEST_F(GpuQueueSubmissionProcessorTest, DropsUnmatchedEventsAfterMaxAge) {
+  constexpr uint64_t kMaxAge = GpuQueueSubmissionProcessor::kMaxUnmatchedEventAgeNs;
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(100)).empty());
+  EXPECT_TRUE(ProcessGpuQueueSubmission(CreateGpuQueueSubmission(200)).empty());
+
+  // Not old enough yet.
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(100 + kMaxAge)).empty());
+  EXPECT_EQ(processor_.GetDroppedGpuJobCount(), 0);
+  EXPECT_EQ(processor_.GetDroppedGpuQueueSubmissionCount(), 0);
+
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(201 + kMaxAge + 1)).empty());
+  EXPECT_EQ(processor_.GetDroppedGpuJobCount(), 1);
+  EXPECT_EQ(processor_.GetDroppedGpuQueueSubmissionCount(), 1);
+
+  // The dropped job is not matched anymore, while the newer one still is.
+  EXPECT_TRUE(ProcessGpuQueueSubmission(CreateGpuQueueSubmission(100)).empty());
+  EXPECT_EQ(ProcessGpuQueueSubmission(CreateGpuQueueSubmission(100 + kMaxAge)).size(), 1);
+}
+
+TEST_F(GpuQueueSubmissionProcessorTest, KeepsEventsNeededForBeginMarkers) {
+  constexpr uint64_t kMaxAge = GpuQueueSubmissionProcessor::kMaxUnmatchedEventAgeNs;
+  GpuQueueSubmission begin_submission = CreateGpuQueueSubmission(100);
+  begin_submission.set_num_begin_markers(1);
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(100)).empty());
+  EXPECT_EQ(ProcessGpuQueueSubmission(begin_submission).size(), 1);
+
+  // Events of the thread much later than the "begin" submission don't drop it nor its job.
+  constexpr uint64_t kEndTime = 100 + 2 * kMaxAge;
+  EXPECT_TRUE(ProcessGpuJob(CreateGpuJob(kEndTime)).empty());
+  EXPECT_EQ(processor_.GetDroppedGpuJobCount(), 0);
+  EXPECT_EQ(processor_.GetDroppedGpuQueueSubmissionCount(), 0);
+
+  GpuQueueSubmission end_submission = CreateGpuQueueSubmission(kEndTime);
+  GpuDebugMarker* debug_marker = end_submission.add_completed_markers();
+  debug_marker->set_text_key(kTimelineKey);
+  debug_marker->set_end_gpu_timestamp_ns(1004);
+  debug_marker->mutable_begin_marker()->mutable_meta_info()->CopyFrom(
+      begin_submission.meta_info());
+  debug_marker->mutable_begin_marker()->set_gpu_timestamp_ns(1001);
+
+  std::vector<TimerInfo> timers = ProcessGpuQueueSubmission(end_submission);
+  ASSERT_EQ(timers.size(), 2);
+  EXPECT_EQ(timers[1].start(), 121);
+  EXPECT_EQ(timers[1].end(), kEndTime + 24);
+}
+
+}  // namespace orbit_capture_client
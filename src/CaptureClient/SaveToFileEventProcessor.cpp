@@ -10,6 +10,8 @@
 #include "capture_data.pb.h"
 
 using orbit_capture_file::CaptureFileOutputStream;
+using orbit_capture_file::CaptureFileWriteMode;
+using orbit_capture_file::CaptureSectionCompression;
 using orbit_client_protos::UserDefinedCaptureInfo;
 using orbit_grpc_protos::ClientCaptureEvent;
 
@@ -20,9 +22,11 @@ namespace {
 class SaveToFileEventProcessor : public CaptureEventProcessor {
  public:
   explicit SaveToFileEventProcessor(std::filesystem::path file_path,
-                                    std::function<void(const ErrorMessage&)> error_handler)
+                                    std::function<void(const ErrorMessage&)> error_handler,
+                                    CaptureSectionCompression compression)
       : file_path_{std::move(file_path)},
         error_handler_{std::move(error_handler)},
+        compression_{compression},
         state_{State::kProcessing} {}
   ~SaveToFileEventProcessor() override = default;
 
@@ -40,12 +44,16 @@ class SaveToFileEventProcessor : public CaptureEventProcessor {
 
   std::filesystem::path file_path_;
   std::function<void(const ErrorMessage&)> error_handler_;
+  CaptureSectionCompression compression_;
   std::unique_ptr<CaptureFileOutputStream> output_stream_;
   State state_;
 };
 
 ErrorMessageOr<void> SaveToFileEventProcessor::Initialize() {
-  auto stream_or_error = CaptureFileOutputStream::Create(file_path_);
+  // The events are processed on the thread receiving them from the service, which must not wait for
+  // the disk.
+  auto stream_or_error = CaptureFileOutputStream::Create(file_path_, compression_,
+                                                         CaptureFileWriteMode::kAsynchronous);
   if (stream_or_error.has_error()) {
     return ErrorMessage{absl::StrFormat("Failed to initialize CaptureSaveToFileProcessor: %s",
                                         stream_or_error.error().message())};
@@ -95,9 +103,10 @@ void SaveToFileEventProcessor::ProcessEvent(const ClientCaptureEvent& event) {
 
 ErrorMessageOr<std::unique_ptr<CaptureEventProcessor>>
 CaptureEventProcessor::CreateSaveToFileProcessor(
-    const std::filesystem::path& file_path,
-    std::function<void(const ErrorMessage&)> error_handler) {
-  auto processor = std::make_unique<SaveToFileEventProcessor>(file_path, std::move(error_handler));
+    const std::filesystem::path& file_path, std::function<void(const ErrorMessage&)> error_handler,
+    CaptureSectionCompression compression) {
+  auto processor =
+      std::make_unique<SaveToFileEventProcessor>(file_path, std::move(error_handler), compression);
   auto init_or_error = processor->Initialize();
   if (init_or_error.has_error()) {
     return init_or_error.error();
@@ -7,6 +7,10 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "Api/EncodedEvent.h"
 #include "CaptureClient/CaptureListener.h"
 #include "capture.pb.h"
@@ -18,23 +22,47 @@ namespace orbit_capture_client {
 // is maintained to cache "start" events until a corresponding "stop" event is received. The pair
 // is then used to create a single TimerInfo object. "Tracking" events don't need to be cached
 // however, they are translated to TImerInfo objects that are directly passed to the listener.
+// orbit_grpc_protos::CompactApiEvent events are processed the same way. Their name is looked up in
+// the interned strings, and the key of the full name is also stored in TimerInfo::user_data_key,
+// as the name encoded in the registers is truncated.
+// While a thread runs a fiber, between a "fiber switch in" and a "fiber switch out" event, the
+// synchronous scopes it starts and stops are matched on a stack per fiber rather than per thread,
+// so that scopes of fibers that were suspended and resumed, possibly on another thread, keep their
+// nesting. The TimerInfos of those scopes have TimerInfo::fiber_id set.
 class ApiEventProcessor {
  public:
   explicit ApiEventProcessor(CaptureListener* listener);
   void ProcessApiEvent(const orbit_grpc_protos::ApiEvent& event_buffer);
+  void ProcessCompactApiEvent(const orbit_grpc_protos::CompactApiEvent& compact_api_event,
+                              const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool);
 
  private:
-  void ProcessApiEvent(const orbit_api::ApiEvent& api_event);
-  void ProcessStartEvent(const orbit_api::ApiEvent& api_event);
-  void ProcessStopEvent(const orbit_api::ApiEvent& api_event);
-  void ProcessAsyncStartEvent(const orbit_api::ApiEvent& api_event);
-  void ProcessAsyncStopEvent(const orbit_api::ApiEvent& api_event);
-  void ProcessTrackingEvent(const orbit_api::ApiEvent& api_event);
+  struct ApiEventWithNameKey {
+    orbit_api::ApiEvent api_event;
+    uint64_t name_key;
+  };
+
+  void ProcessApiEvent(const ApiEventWithNameKey& event);
+  void ProcessStartEvent(const ApiEventWithNameKey& event);
+  void ProcessStopEvent(const ApiEventWithNameKey& event);
+  void ProcessAsyncStartEvent(const ApiEventWithNameKey& event);
+  void ProcessAsyncStopEvent(const ApiEventWithNameKey& event);
+  void ProcessTrackingEvent(const ApiEventWithNameKey& event);
+  void ProcessFiberSwitchInEvent(const ApiEventWithNameKey& event);
+  void ProcessFiberSwitchOutEvent(const ApiEventWithNameKey& event);
+
+  // Returns 0 if thread `tid` is currently not running a fiber.
+  [[nodiscard]] uint64_t GetCurrentFiberId(int32_t tid) const;
+  [[nodiscard]] std::vector<ApiEventWithNameKey>& GetSynchronousEventStack(int32_t tid,
+                                                                           uint64_t fiber_id);
 
  private:
   CaptureListener* capture_listener_ = nullptr;
-  absl::flat_hash_map<int32_t, std::vector<orbit_api::ApiEvent>> synchronous_event_stack_by_tid_;
-  absl::flat_hash_map<int32_t, orbit_api::ApiEvent> asynchronous_events_by_id_;
+  absl::flat_hash_map<int32_t, std::vector<ApiEventWithNameKey>> synchronous_event_stack_by_tid_;
+  absl::flat_hash_map<uint64_t, std::vector<ApiEventWithNameKey>>
+      synchronous_event_stack_by_fiber_id_;
+  absl::flat_hash_map<int32_t, uint64_t> current_fiber_id_by_tid_;
+  absl::flat_hash_map<int32_t, ApiEventWithNameKey> asynchronous_events_by_id_;
 };
 
 }  // namespace orbit_capture_client
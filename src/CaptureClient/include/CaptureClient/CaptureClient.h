@@ -14,9 +14,11 @@
 
 #include <atomic>
 #include <memory>
+#include <vector>
 
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureClient/CaptureListener.h"
+#include "CaptureClient/ClockOffset.h"
 #include "ClientData/ModuleManager.h"
 #include "ClientData/ProcessData.h"
 #include "ClientData/TracepointCustom.h"
@@ -35,8 +37,32 @@ class CaptureClient {
  public:
   enum class State { kStopped = 0, kStarting, kStarted, kStopping };
 
-  explicit CaptureClient(const std::shared_ptr<grpc::Channel>& channel)
-      : capture_service_{orbit_grpc_protos::CaptureService::NewStub(channel)} {}
+  explicit CaptureClient(const std::shared_ptr<grpc::Channel>& channel,
+                         orbit_grpc_protos::CaptureOptions::CaptureResponseCompression
+                             capture_response_compression =
+                                 orbit_grpc_protos::CaptureOptions::kNoCompression,
+                         bool save_capture_file_on_service = false,
+                         uint64_t flight_recorder_window_ns = 0,
+                         bool collect_gpu_pipeline_statistics = false,
+                         bool sample_process_memory_with_perf_events = false,
+                         bool collect_memory_callstacks = false,
+                         bool collect_kernel_callstacks = false,
+                         uint32_t pipeline_latency_probe_period = 0,
+                         uint64_t statistics_summary_interval_ns = 0,
+                         uint32_t api_track_value_coalescing_interval_ms = 0,
+                         bool compensate_instrumentation_overhead = false)
+      : capture_service_{orbit_grpc_protos::CaptureService::NewStub(channel)},
+        capture_response_compression_{capture_response_compression},
+        save_capture_file_on_service_{save_capture_file_on_service},
+        flight_recorder_window_ns_{flight_recorder_window_ns},
+        collect_gpu_pipeline_statistics_{collect_gpu_pipeline_statistics},
+        sample_process_memory_with_perf_events_{sample_process_memory_with_perf_events},
+        collect_memory_callstacks_{collect_memory_callstacks},
+        collect_kernel_callstacks_{collect_kernel_callstacks},
+        pipeline_latency_probe_period_{pipeline_latency_probe_period},
+        statistics_summary_interval_ns_{statistics_summary_interval_ns},
+        api_track_value_coalescing_interval_ms_{api_track_value_coalescing_interval_ms},
+        compensate_instrumentation_overhead_{compensate_instrumentation_overhead} {}
 
   orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> Capture(
       ThreadPool* thread_pool, int32_t process_id,
@@ -58,6 +84,13 @@ class CaptureClient {
   // it will wait until capture is started or failed to start.
   [[nodiscard]] bool StopCapture();
 
+  // Asks the service to send the events of the last flight_recorder_window_ns, if the capture was
+  // started in flight recorder mode. The events are then received like in a normal capture.
+  // Returns false if the request could not be sent, e.g., because the capture is not started.
+  [[nodiscard]] bool RequestFlightRecorderSnapshot();
+
+  [[nodiscard]] bool IsFlightRecorderEnabled() const { return flight_recorder_window_ns_ > 0; }
+
   [[nodiscard]] State state() const {
     absl::MutexLock lock(&state_mutex_);
     return state_;
@@ -70,6 +103,18 @@ class CaptureClient {
 
   bool AbortCaptureAndWait(int64_t max_wait_ms);
 
+  // Estimates the offset from the capture clock of the service to the one of the client with
+  // sample_count round trips of GetCaptureTimestamp (see EstimateClockOffset). Apply it to the
+  // events of the capture with CaptureEventProcessor::CreateClockOffsetProcessor, to merge the
+  // captures of several machines taken with one CaptureClient each in the same timeline. Can be
+  // called while capturing.
+  [[nodiscard]] ErrorMessageOr<ClockOffset> EstimateClockOffset(int sample_count = 16);
+
+  // Lists the capture files saved by the continuous profiling of the service, oldest first. They
+  // are loaded like the other captures saved on the instance.
+  [[nodiscard]] ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>>
+  ListContinuousCaptureFiles();
+
   [[nodiscard]] static orbit_grpc_protos::InstrumentedFunction::FunctionType
   InstrumentedFunctionTypeFromOrbitType(orbit_client_protos::FunctionInfo::OrbitType orbit_type);
 
@@ -91,6 +136,18 @@ class CaptureClient {
   [[nodiscard]] ErrorMessageOr<void> FinishCapture();
 
   std::unique_ptr<orbit_grpc_protos::CaptureService::Stub> capture_service_;
+  const orbit_grpc_protos::CaptureOptions::CaptureResponseCompression
+      capture_response_compression_;
+  const bool save_capture_file_on_service_;
+  const uint64_t flight_recorder_window_ns_;
+  const bool collect_gpu_pipeline_statistics_;
+  const bool sample_process_memory_with_perf_events_;
+  const bool collect_memory_callstacks_;
+  const bool collect_kernel_callstacks_;
+  const uint32_t pipeline_latency_probe_period_;
+  const uint64_t statistics_summary_interval_ns_;
+  const uint32_t api_track_value_coalescing_interval_ms_;
+  const bool compensate_instrumentation_overhead_;
   std::unique_ptr<grpc::ClientContext> client_context_;
   std::unique_ptr<grpc::ClientReaderWriter<orbit_grpc_protos::CaptureRequest,
                                            orbit_grpc_protos::CaptureResponse>>
@@ -12,6 +12,7 @@
 #include <string>
 
 #include "CaptureClient/CaptureListener.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "capture.pb.h"
 
 namespace orbit_capture_client {
@@ -29,11 +30,19 @@ class CaptureEventProcessor {
 
   static ErrorMessageOr<std::unique_ptr<CaptureEventProcessor>> CreateSaveToFileProcessor(
       const std::filesystem::path& file_path,
-      std::function<void(const ErrorMessage&)> error_handler);
+      std::function<void(const ErrorMessage&)> error_handler,
+      orbit_capture_file::CaptureSectionCompression compression =
+          orbit_capture_file::CaptureSectionCompression::kNone);
 
   static std::unique_ptr<CaptureEventProcessor> CreateCompositeProcessor(
       std::vector<std::unique_ptr<CaptureEventProcessor>> event_processors);
 
+  // Adds clock_offset_ns to the timestamps in the capture clock of the service before passing the
+  // events to event_processor. This brings the events of a capture of another machine to the clock
+  // of the client, so that captures of several machines can be merged (see EstimateClockOffset).
+  static std::unique_ptr<CaptureEventProcessor> CreateClockOffsetProcessor(
+      int64_t clock_offset_ns, std::unique_ptr<CaptureEventProcessor> event_processor);
+
   enum class SystemMemoryUsageEncodingIndex {
     kTotalKb = 0,
     kFreeKb = 1,
@@ -60,6 +69,37 @@ class CaptureEventProcessor {
     kProcessMajorPagefault = 6,
     kEnd = 7
   };
+  enum class PmuCountersEncodingIndex {
+    kCycles = 0,
+    kInstructions = 1,
+    kLlcMisses = 2,
+    kBranchMisses = 3,
+    kEnd = 4
+  };
+  enum class ServiceHealthEncodingIndex {
+    kRecordCount = 0,
+    kPerfEventQueueSize = 1,
+    kMaxDeferredEventCount = 2,
+    kStackSampleLatencyP50Ns = 3,
+    kStackSampleLatencyP90Ns = 4,
+    kStackSampleLatencyP99Ns = 5,
+    kTotalBytesSent = 6,
+    kEnd = 7
+  };
+  enum class GpuPipelineStatisticsEncodingIndex {
+    kInputAssemblyVertices = 0,
+    kInputAssemblyPrimitives = 1,
+    kVertexShaderInvocations = 2,
+    kGeometryShaderInvocations = 3,
+    kGeometryShaderPrimitives = 4,
+    kClippingInvocations = 5,
+    kClippingPrimitives = 6,
+    kFragmentShaderInvocations = 7,
+    kTessellationControlShaderPatches = 8,
+    kTessellationEvaluationShaderInvocations = 9,
+    kComputeShaderInvocations = 10,
+    kEnd = 11
+  };
 };
 
 }  // namespace orbit_capture_client
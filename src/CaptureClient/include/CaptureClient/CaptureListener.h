@@ -32,8 +32,9 @@ class CaptureListener {
                                  orbit_client_protos::CallstackInfo callstack) = 0;
   virtual void OnCallstackEvent(orbit_client_protos::CallstackEvent callstack_event) = 0;
   virtual void OnThreadName(int32_t thread_id, std::string thread_name) = 0;
-  virtual void OnModuleUpdate(uint64_t timestamp_ns, orbit_grpc_protos::ModuleInfo module_info) = 0;
-  virtual void OnModulesSnapshot(uint64_t timestamp_ns,
+  virtual void OnModuleUpdate(int32_t pid, uint64_t timestamp_ns,
+                              orbit_grpc_protos::ModuleInfo module_info) = 0;
+  virtual void OnModulesSnapshot(int32_t pid, uint64_t timestamp_ns,
                                  std::vector<orbit_grpc_protos::ModuleInfo> module_infos) = 0;
   virtual void OnThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo thread_state_slice) = 0;
   virtual void OnAddressInfo(orbit_client_protos::LinuxAddressInfo address_info) = 0;
@@ -44,6 +45,8 @@ class CaptureListener {
   virtual void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) = 0;
   virtual void OnClockResolutionEvent(
       orbit_grpc_protos::ClockResolutionEvent clock_resolution_event) = 0;
+  virtual void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent capture_start_latency_event) = 0;
   virtual void OnErrorsWithPerfEventOpenEvent(
       orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) = 0;
   virtual void OnErrorEnablingOrbitApiEvent(
@@ -52,6 +55,13 @@ class CaptureListener {
       orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) = 0;
   virtual void OnOutOfOrderEventsDiscardedEvent(
       orbit_grpc_protos::OutOfOrderEventsDiscardedEvent out_of_order_events_discarded_event) = 0;
+  virtual void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) = 0;
+  virtual void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) = 0;
+  // The statistics of the calls of an instrumented function that the service aggregated in
+  // statistics-only mode, to be added to the ones received before.
+  virtual void OnFunctionStats(uint64_t function_id, orbit_client_protos::FunctionStats stats) = 0;
 };
 
 }  // namespace orbit_capture_client
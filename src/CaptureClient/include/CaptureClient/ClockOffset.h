@@ -0,0 +1,40 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_CLIENT_CLOCK_OFFSET_H_
+#define CAPTURE_CLIENT_CLOCK_OFFSET_H_
+
+#include <absl/types/span.h>
+
+#include <cstdint>
+#include <optional>
+
+namespace orbit_capture_client {
+
+// One round trip of CaptureService.GetCaptureTimestamp: the capture clock of the client when the
+// request was sent and when the response was received, and the capture clock of the service in the
+// response.
+struct ClockSyncSample {
+  uint64_t client_send_timestamp_ns = 0;
+  uint64_t service_timestamp_ns = 0;
+  uint64_t client_receive_timestamp_ns = 0;
+};
+
+// offset_ns is to be added to a timestamp of the service to get the corresponding timestamp of the
+// client. The actual offset is within offset_ns +/- max_error_ns.
+struct ClockOffset {
+  int64_t offset_ns = 0;
+  uint64_t max_error_ns = 0;
+};
+
+// Estimates the offset like NTP does: assuming that the request and the response take the same
+// time, the service read its clock halfway through the round trip. Only the sample with the
+// shortest round trip is used, as the error is bounded by half of the round trip. Samples whose
+// client timestamps are not ordered are ignored. Returns nullopt if there is no valid sample.
+[[nodiscard]] std::optional<ClockOffset> EstimateClockOffset(
+    absl::Span<const ClockSyncSample> samples);
+
+}  // namespace orbit_capture_client
+
+#endif  // CAPTURE_CLIENT_CLOCK_OFFSET_H_
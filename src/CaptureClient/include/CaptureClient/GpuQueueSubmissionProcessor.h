@@ -9,7 +9,12 @@
 #include <absl/container/node_hash_map.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <limits>
+#include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -31,8 +36,18 @@ namespace orbit_capture_client {
 // Worth mentioning is the case of debug markers, where the "begin" marker originates from a
 // different submission than the "end" marker. In this case we store the "begin" marker's
 // `GpuQueueSubmission` and `GpuJob` until we have processed all corresponding "end" markers.
+//
+// If the Vulkan layer sends `GpuClockCalibration`s, GPU timestamps are converted using the closest
+// calibrations instead, which does not suffer from the drift between the clocks in long captures.
+//
+// Events that never get matched, e.g., because the capture started or stopped in between, are
+// dropped once they are kMaxUnmatchedEventAgeNs older than the latest event of their thread.
 class GpuQueueSubmissionProcessor {
  public:
+  // The `GpuJob` and the `GpuQueueSubmission` of a submission are produced within milliseconds of
+  // each other, so an event that is still unmatched after this long will never be matched.
+  static constexpr uint64_t kMaxUnmatchedEventAgeNs = 10'000'000'000;
+
   // If the matching `GpuJob` has already been processed, it converts the command buffer and debug
   // marker information from the `GpuQueueSubmission` event into `TimerInfo`s. Otherwise, it
   // returns an empty vector and stores the submission for later processing.
@@ -52,6 +67,13 @@ class GpuQueueSubmissionProcessor {
       const std::function<uint64_t(const std::string& str)>&
           get_string_hash_and_send_to_listener_if_necessary);
 
+  // Stores a correlation between the GPU and the CPU clock to be used for the conversion of all GPU
+  // timestamps processed afterwards.
+  void AddGpuClockCalibration(const orbit_grpc_protos::GpuClockCalibration& gpu_clock_calibration) {
+    gpu_to_cpu_timestamp_ns_[gpu_clock_calibration.gpu_timestamp_ns()] =
+        gpu_clock_calibration.cpu_timestamp_ns();
+  }
+
   // In case we have recored the submission containing the "begin" of a certain debug marker, we
   // use the `begin_capture_time_ns_` as an approximation for the begin CPU timestamp.
   // This method updates this timestamp with the minimum of the current value and the given value.
@@ -59,18 +81,43 @@ class GpuQueueSubmissionProcessor {
     begin_capture_time_ns_ = std::min(begin_capture_time_ns_, timestamp);
   }
 
+  // The number of events that were dropped because they were never matched.
+  [[nodiscard]] uint64_t GetDroppedGpuJobCount() const { return dropped_gpu_job_count_; }
+  [[nodiscard]] uint64_t GetDroppedGpuQueueSubmissionCount() const {
+    return dropped_gpu_queue_submission_count_;
+  }
+
  private:
+  // The parts of a `GpuJob` needed to convert the timestamps of its `GpuQueueSubmission`.
+  struct SavedGpuJob {
+    uint64_t amdgpu_cs_ioctl_time_ns = 0;
+    uint64_t gpu_hardware_start_time_ns = 0;
+    uint64_t timeline_key = 0;
+    int32_t depth = 0;
+  };
+
+  // The events of a thread that are waiting to be matched, or that are still needed for "begin"
+  // markers. As the events of a thread mostly arrive in order, they are kept in deques sorted by
+  // time, which are almost only modified at their ends.
+  struct ThreadEvents {
+    // Sorted by `amdgpu_cs_ioctl_time_ns`.
+    std::deque<SavedGpuJob> gpu_jobs;
+    // Sorted by `meta_info().post_submission_cpu_timestamp()`.
+    std::deque<orbit_grpc_protos::GpuQueueSubmission> gpu_queue_submissions;
+    absl::flat_hash_map<uint64_t, uint32_t> post_submission_time_to_num_begin_markers;
+  };
+
   [[nodiscard]] std::vector<orbit_client_protos::TimerInfo>
   ProcessGpuQueueSubmissionWithMatchingGpuJob(
       const orbit_grpc_protos::GpuQueueSubmission& gpu_queue_submission,
-      const orbit_grpc_protos::GpuJob& matching_gpu_job,
+      const SavedGpuJob& matching_gpu_job,
       const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool,
       const std::function<uint64_t(const std::string& str)>&
           get_string_hash_and_send_to_listener_if_necessary);
 
   [[nodiscard]] std::vector<orbit_client_protos::TimerInfo> ProcessGpuCommandBuffers(
       const orbit_grpc_protos::GpuQueueSubmission& gpu_queue_submission,
-      const orbit_grpc_protos::GpuJob& matching_gpu_job,
+      const SavedGpuJob& matching_gpu_job,
       const std::optional<orbit_grpc_protos::GpuCommandBuffer>& first_command_buffer,
       uint64_t timeline_hash,
       const std::function<uint64_t(const std::string& str)>&
@@ -78,15 +125,21 @@ class GpuQueueSubmissionProcessor {
 
   [[nodiscard]] std::vector<orbit_client_protos::TimerInfo> ProcessGpuDebugMarkers(
       const orbit_grpc_protos::GpuQueueSubmission& gpu_queue_submission,
-      const orbit_grpc_protos::GpuJob& matching_gpu_job,
+      const SavedGpuJob& matching_gpu_job,
       const std::optional<orbit_grpc_protos::GpuCommandBuffer>& first_command_buffer);
 
+  // Converts `gpu_timestamp_ns` to CPU time. Without calibrations, the first command buffer of the
+  // submission is assumed to start executing at the (CPU) hardware start time of `gpu_job`.
+  [[nodiscard]] uint64_t ConvertGpuTimestampToCpu(
+      uint64_t gpu_timestamp_ns, uint64_t first_command_buffer_begin_gpu_timestamp_ns,
+      const SavedGpuJob& gpu_job) const;
+
   [[nodiscard]] static std::optional<orbit_grpc_protos::GpuCommandBuffer> ExtractFirstCommandBuffer(
       const orbit_grpc_protos::GpuQueueSubmission& gpu_queue_submission);
 
   // Finds the GpuJob that is fully inside the given timestamps and happened on the given thread id.
   // Returns `nullptr` if there is no such job.
-  [[nodiscard]] const orbit_grpc_protos::GpuJob* FindMatchingGpuJob(
+  [[nodiscard]] const SavedGpuJob* FindMatchingGpuJob(
       int32_t thread_id, uint64_t pre_submission_cpu_timestamp,
       uint64_t post_submission_cpu_timestamp);
 
@@ -105,12 +158,19 @@ class GpuQueueSubmissionProcessor {
 
   void DeleteSavedGpuSubmission(int32_t thread_id, uint64_t post_submission_timestamp);
 
-  absl::node_hash_map<int32_t, std::map<uint64_t, orbit_grpc_protos::GpuJob>>
-      tid_to_submission_time_to_gpu_job_;
-  absl::node_hash_map<int32_t, std::map<uint64_t, orbit_grpc_protos::GpuQueueSubmission>>
-      tid_to_post_submission_time_to_gpu_submission_;
-  absl::flat_hash_map<int32_t, absl::flat_hash_map<uint64_t, uint32_t>>
-      tid_to_post_submission_time_to_num_begin_markers_;
+  void DeleteThreadEventsIfEmpty(int32_t thread_id);
+
+  // Drops the events of the thread that are older than kMaxUnmatchedEventAgeNs before
+  // `timestamp_ns` and not needed for "begin" markers. This must not be called while pointers to
+  // saved events are in use.
+  void DropUnmatchedEvents(int32_t thread_id, uint64_t timestamp_ns);
+
+  // A node_hash_map, so that the events of a thread stay in place when other threads are added.
+  absl::node_hash_map<int32_t, ThreadEvents> tid_to_thread_events_;
+  uint64_t dropped_gpu_job_count_ = 0;
+  uint64_t dropped_gpu_queue_submission_count_ = 0;
+
+  std::map<uint64_t, uint64_t> gpu_to_cpu_timestamp_ns_;
 
   uint64_t begin_capture_time_ns_ = std::numeric_limits<uint64_t>::max();
 };
@@ -6,12 +6,15 @@
 
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
+#include <unistd.h>
 
 #include <chrono>
+#include <utility>
 
 #include "OrbitBase/Logging.h"
 
 using orbit_grpc_protos::ProducerSideService;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
 using orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest;
 using orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse;
 
@@ -66,6 +69,13 @@ bool CaptureEventProducer::SendCaptureEvents(
     CHECK(!shutdown_requested_);
   }
 
+  {
+    absl::MutexLock lock{&shared_memory_buffer_mutex_};
+    if (shared_memory_buffer_in_use_) {
+      return WriteToSharedMemoryBuffer(send_events_request);
+    }
+  }
+
   bool write_succeeded;
   {
     absl::ReaderMutexLock lock{&context_and_stream_mutex_};
@@ -81,6 +91,32 @@ bool CaptureEventProducer::SendCaptureEvents(
   return write_succeeded;
 }
 
+bool CaptureEventProducer::WriteToSharedMemoryBuffer(
+    const orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest& send_events_request) {
+  CHECK(shared_memory_buffer_ != nullptr);
+  const size_t size = send_events_request.ByteSizeLong();
+  if (size > shared_memory_buffer_->GetMaxMessageSize()) {
+    ERROR("Sending BufferedCaptureEvents to ProducerSideService: %u bytes don't fit in the buffer",
+          size);
+    return false;
+  }
+
+  // Wait for OrbitService to make room, but not indefinitely in case it has stopped reading.
+  static constexpr absl::Duration kMaxWaitForRoom = absl::Seconds(1);
+  static constexpr std::chrono::microseconds kRetryInterval{100};
+  const absl::Time deadline = absl::Now() + kMaxWaitForRoom;
+  while (!shared_memory_buffer_->TryWrite(size, [&send_events_request](char* data) {
+    send_events_request.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data));
+  })) {
+    if (absl::Now() > deadline) {
+      ERROR("Sending BufferedCaptureEvents to ProducerSideService: shared memory buffer is full");
+      return false;
+    }
+    std::this_thread::sleep_for(kRetryInterval);
+  }
+  return true;
+}
+
 bool CaptureEventProducer::NotifyAllEventsSent() {
   CHECK(producer_side_service_stub_ != nullptr);
   {
@@ -107,6 +143,41 @@ bool CaptureEventProducer::NotifyAllEventsSent() {
   return write_succeeded;
 }
 
+void CaptureEventProducer::OfferSharedMemoryBuffer() {
+  const uint64_t capacity_bytes = shared_memory_buffer_capacity_bytes_;
+  if (capacity_bytes == 0) {
+    return;
+  }
+
+  ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> buffer_or_error =
+      SharedMemoryRingBuffer::Create(capacity_bytes);
+  if (buffer_or_error.has_error()) {
+    ERROR("Creating shared memory buffer for ProducerSideService: %s",
+          buffer_or_error.error().message());
+    return;
+  }
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = std::move(buffer_or_error.value());
+
+  ReceiveCommandsAndSendEventsRequest request;
+  request.mutable_shared_memory_buffer_created()->set_pid(getpid());
+  request.mutable_shared_memory_buffer_created()->set_fd(buffer->fd());
+  bool write_succeeded;
+  {
+    // The stream was only just created, so no capture has started yet and SendCaptureEvents and
+    // NotifyAllEventsSent are not writing to it.
+    absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+    write_succeeded = stream_->Write(request);
+  }
+  if (!write_succeeded) {
+    ERROR("Sending SharedMemoryBufferCreated to ProducerSideService");
+    return;
+  }
+  LOG("Sent SharedMemoryBufferCreated to ProducerSideService");
+
+  absl::MutexLock lock{&shared_memory_buffer_mutex_};
+  shared_memory_buffer_ = std::move(buffer);
+}
+
 void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
   CHECK(producer_side_service_stub_ != nullptr);
 
@@ -143,6 +214,7 @@ void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
       continue;
     }
     LOG("Called ReceiveCommandsAndSendEvents on ProducerSideService");
+    OfferSharedMemoryBuffer();
 
     while (true) {
       ReceiveCommandsAndSendEventsResponse response;
@@ -169,6 +241,12 @@ void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
           context_ = nullptr;
           stream_ = nullptr;
         }
+        {
+          absl::MutexLock lock{&shared_memory_buffer_mutex_};
+          shared_memory_buffer_.reset();
+          shared_memory_buffer_accepted_ = false;
+          shared_memory_buffer_in_use_ = false;
+        }
 
         // Wait to avoid continuously trying to reconnect when OrbitService is not reachable.
         shutdown_requested_mutex_.ReaderLockWhenWithTimeout(
@@ -183,6 +261,10 @@ void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
       switch (response.command_case()) {
         case ReceiveCommandsAndSendEventsResponse::kStartCaptureCommand: {
           LOG("ProducerSideService sent StartCaptureCommand");
+          {
+            absl::MutexLock lock{&shared_memory_buffer_mutex_};
+            shared_memory_buffer_in_use_ = shared_memory_buffer_accepted_;
+          }
           if (last_command_ == ReceiveCommandsAndSendEventsResponse::kCaptureFinishedCommand) {
             last_command_ = ReceiveCommandsAndSendEventsResponse::kStartCaptureCommand;
             OnCaptureStart(response.start_capture_command().capture_options());
@@ -221,6 +303,12 @@ void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
           }
         } break;
 
+        case ReceiveCommandsAndSendEventsResponse::kSharedMemoryBufferAcceptedCommand: {
+          LOG("ProducerSideService sent SharedMemoryBufferAcceptedCommand");
+          absl::MutexLock lock{&shared_memory_buffer_mutex_};
+          shared_memory_buffer_accepted_ = shared_memory_buffer_ != nullptr;
+        } break;
+
         case ReceiveCommandsAndSendEventsResponse::COMMAND_NOT_SET: {
           ERROR("ProducerSideService sent COMMAND_NOT_SET");
         } break;
@@ -7,14 +7,18 @@
 #include <grpcpp/support/channel_arguments.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include <chrono>
 #include <memory>
 #include <optional>
+#include <string>
 #include <thread>
 
 #include "CaptureEventProducer/CaptureEventProducer.h"
 #include "CaptureEventProducer/FakeProducerSideService.h"
+#include "OrbitBase/Result.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "grpcpp/grpcpp.h"
 #include "producer_side_services.pb.h"
 
@@ -384,5 +388,65 @@ TEST_F(CaptureEventProducerTest, DisconnectAndReconnect) {
   EXPECT_FALSE(producer_->IsCapturing());
 }
 
+TEST_F(CaptureEventProducerTest, SendCaptureEventsThroughSharedMemoryBuffer) {
+  // The buffer is only offered when connecting, so reconnect after enabling it.
+  static constexpr uint64_t kReconnectionDelayMs = 50;
+  producer_->SetReconnectionDelayMs(kReconnectionDelayMs);
+  producer_->EnableSharedMemoryTransport(4096);
+  fake_service_->FinishAndDisallowRpc();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  int32_t buffer_pid = 0;
+  int32_t buffer_fd = -1;
+  EXPECT_CALL(*fake_service_, OnSharedMemoryBufferCreatedReceived)
+      .WillOnce([&buffer_pid, &buffer_fd](int32_t pid, int32_t fd) {
+        buffer_pid = pid;
+        buffer_fd = fd;
+      });
+  fake_service_->ReAllowRpc();
+  std::this_thread::sleep_for(std::chrono::milliseconds{2 * kReconnectionDelayMs});
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_EQ(buffer_pid, getpid());
+  auto buffer_or_error =
+      orbit_producer_side_channel::SharedMemoryRingBuffer::OpenFromProcess(buffer_pid, buffer_fd);
+  ASSERT_TRUE(buffer_or_error.has_value()) << buffer_or_error.error().message();
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> buffer =
+      std::move(buffer_or_error.value());
+
+  fake_service_->SendSharedMemoryBufferAcceptedCommand();
+  EXPECT_CALL(*producer_, OnCaptureStart).Times(1);
+  fake_service_->SendStartCaptureCommand(kFakeCaptureOptions);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*producer_);
+
+  orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest send_events_request;
+  send_events_request.mutable_buffered_capture_events()->mutable_capture_events()->Add();
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  EXPECT_TRUE(producer_->SendCaptureEvents(send_events_request));
+  EXPECT_TRUE(producer_->SendCaptureEvents(send_events_request));
+  EXPECT_TRUE(producer_->NotifyAllEventsSent());
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  int read_count = 0;
+  while (buffer->TryRead([&read_count, &send_events_request](const char* data, uint64_t size) {
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
+    ASSERT_TRUE(request.ParseFromArray(data, static_cast<int>(size)));
+    EXPECT_EQ(request.SerializeAsString(), send_events_request.SerializeAsString());
+    ++read_count;
+  })) {
+  }
+  EXPECT_EQ(read_count, 2);
+
+  EXPECT_CALL(*producer_, OnCaptureStop).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+}
+
 }  // namespace
 }  // namespace orbit_capture_event_producer
@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <optional>
@@ -28,11 +29,45 @@ namespace {
 
 class LockFreeBufferCaptureEventProducerImpl
     : public LockFreeBufferCaptureEventProducer<std::string> {
+ public:
+  // If set, all events are held back until the capture is stopped.
+  void SetHoldBackEvents(bool hold_back_events) { hold_back_events_ = hold_back_events; }
+
  protected:
   orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
       std::string&& /*intermediate_event*/, google::protobuf::Arena* arena) override {
     return google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
   }
+
+  void TranslateIntermediateEvents(
+      std::string* intermediate_events, size_t intermediate_event_count,
+      google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    if (hold_back_events_) {
+      held_back_event_count_ += intermediate_event_count;
+      return;
+    }
+    LockFreeBufferCaptureEventProducer::TranslateIntermediateEvents(
+        intermediate_events, intermediate_event_count, arena, capture_events);
+  }
+
+  bool HasPendingEventsToSend(bool all_events) override {
+    return all_events && held_back_event_count_ > 0;
+  }
+
+  void TranslatePendingEvents(
+      bool /*all_events*/, google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    for (; held_back_event_count_ > 0; --held_back_event_count_) {
+      capture_events->AddAllocated(TranslateIntermediateEvent("", arena));
+    }
+  }
+
+ private:
+  std::atomic<bool> hold_back_events_ = false;
+  size_t held_back_event_count_ = 0;
 };
 
 class LockFreeBufferCaptureEventProducerTest : public ::testing::Test {
@@ -186,6 +221,112 @@ TEST_F(LockFreeBufferCaptureEventProducerTest, EnqueueIntermediateEvent) {
   buffer_producer_->EnqueueIntermediateEvent("");
 }
 
+TEST_F(LockFreeBufferCaptureEventProducerTest, PendingEventsAreSentBeforeAllEventsSent) {
+  buffer_producer_->SetHoldBackEvents(true);
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{});
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(0);
+  buffer_producer_->EnqueueIntermediateEvent("");
+  buffer_producer_->EnqueueIntermediateEvent("");
+  buffer_producer_->EnqueueIntermediateEvent("");
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  size_t capture_events_received_count = 0;
+  ::testing::InSequence in_sequence;
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived)
+      .WillOnce([&capture_events_received_count](
+                    const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events) {
+        capture_events_received_count += events.size();
+      });
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_EQ(capture_events_received_count, 3);
+}
+
+TEST_F(LockFreeBufferCaptureEventProducerTest, WakeUpEventCountAndMaxEventsPerRequest) {
+  // Without wake-ups, no event would be forwarded for the duration of the test.
+  buffer_producer_->SetForwardingIntervalUs(60'000'000);
+  buffer_producer_->SetWakeUpEventCount(1);
+  buffer_producer_->SetMaxEventsPerRequest(2);
+
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{});
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  size_t capture_events_received_count = 0;
+  ON_CALL(*fake_service_, OnCaptureEventsReceived)
+      .WillByDefault([&capture_events_received_count](
+                         const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events) {
+        EXPECT_LE(events.size(), 2);
+        capture_events_received_count += events.size();
+      });
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(::testing::Between(3, 5));
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(0);
+  for (int i = 0; i < 5; ++i) {
+    buffer_producer_->EnqueueIntermediateEvent("");
+  }
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_EQ(capture_events_received_count, 5);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  fake_service_->SendCaptureFinishedCommand();
+}
+
+TEST_F(LockFreeBufferCaptureEventProducerTest, EnqueueIntermediateEventWithProducerTokens) {
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{});
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  std::atomic<size_t> capture_events_received_count = 0;
+  ON_CALL(*fake_service_, OnCaptureEventsReceived)
+      .WillByDefault([&capture_events_received_count](
+                         const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events) {
+        capture_events_received_count += events.size();
+      });
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(::testing::AtLeast(1));
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(0);
+
+  constexpr size_t kThreadCount = 4;
+  constexpr size_t kEventCountPerThread = 1000;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([this] {
+      moodycamel::ProducerToken producer_token = buffer_producer_->CreateProducerToken();
+      for (size_t j = 0; j < kEventCountPerThread; ++j) {
+        buffer_producer_->EnqueueIntermediateEvent(&producer_token, "");
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_EQ(capture_events_received_count, kThreadCount * kEventCountPerThread);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  fake_service_->SendCaptureFinishedCommand();
+}
+
 TEST_F(LockFreeBufferCaptureEventProducerTest, DuplicatedCommands) {
   EXPECT_FALSE(buffer_producer_->IsCapturing());
 
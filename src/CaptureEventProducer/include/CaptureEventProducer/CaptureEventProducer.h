@@ -12,6 +12,7 @@
 #include <memory>
 #include <thread>
 
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "absl/synchronization/mutex.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
@@ -35,6 +36,14 @@ class CaptureEventProducer {
   // be attempted when the connection fails or is interrupted. The default is 4 seconds.
   void SetReconnectionDelayMs(uint64_t ms) { reconnection_delay_ms_ = ms; }
 
+  // This method allows to pass the CaptureEvents to OrbitService through a SharedMemoryRingBuffer
+  // of capacity_bytes, instead of through the gRPC stream, when OrbitService runs on the same
+  // machine and accepts the buffer. Like SetReconnectionDelayMs, call it before BuildAndStart.
+  // The buffer is offered on each (re)connection and used starting from the next capture.
+  void EnableSharedMemoryTransport(uint64_t capacity_bytes) {
+    shared_memory_buffer_capacity_bytes_ = capacity_bytes;
+  }
+
  protected:
   // This method establishes the connection with ProducerSideService. If a connection fails or
   // is interrupted, the class will keep trying to (re)connect, until ShutdownAndWait is called.
@@ -63,6 +72,10 @@ class CaptureEventProducer {
 
  private:
   void ConnectAndReceiveCommandsThread();
+  void OfferSharedMemoryBuffer();
+  [[nodiscard]] bool WriteToSharedMemoryBuffer(
+      const orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest& send_events_request)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shared_memory_buffer_mutex_);
 
  private:
   std::unique_ptr<orbit_grpc_protos::ProducerSideService::Stub> producer_side_service_stub_;
@@ -81,6 +94,16 @@ class CaptureEventProducer {
   absl::Mutex shutdown_requested_mutex_;
 
   std::atomic<uint64_t> reconnection_delay_ms_ = 4000;
+
+  std::atomic<uint64_t> shared_memory_buffer_capacity_bytes_ = 0;
+  // Recreated on each connection, so that a restarted OrbitService doesn't share a buffer with the
+  // previous instance.
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> shared_memory_buffer_
+      ABSL_GUARDED_BY(shared_memory_buffer_mutex_);
+  bool shared_memory_buffer_accepted_ ABSL_GUARDED_BY(shared_memory_buffer_mutex_) = false;
+  // Only changes when a capture starts, so that all the events of a capture take the same path.
+  bool shared_memory_buffer_in_use_ ABSL_GUARDED_BY(shared_memory_buffer_mutex_) = false;
+  absl::Mutex shared_memory_buffer_mutex_;
 };
 
 }  // namespace orbit_capture_event_producer
@@ -40,6 +40,10 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent:
           OnAllEventsSentReceived();
           break;
+        case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryBufferCreated:
+          OnSharedMemoryBufferCreatedReceived(request.shared_memory_buffer_created().pid(),
+                                              request.shared_memory_buffer_created().fd());
+          break;
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::EVENT_NOT_SET:
           break;
       }
@@ -75,6 +79,14 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
     EXPECT_TRUE(written);
   }
 
+  void SendSharedMemoryBufferAcceptedCommand() {
+    ASSERT_NE(stream_, nullptr);
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse command;
+    command.mutable_shared_memory_buffer_accepted_command();
+    bool written = stream_->Write(command);
+    EXPECT_TRUE(written);
+  }
+
   void FinishAndDisallowRpc() {
     rpc_allowed_ = false;
     if (context_ != nullptr) {
@@ -90,6 +102,7 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
   MOCK_METHOD(void, OnCaptureEventsReceived,
               (const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events), ());
   MOCK_METHOD(void, OnAllEventsSentReceived, (), ());
+  MOCK_METHOD(void, OnSharedMemoryBufferCreatedReceived, (int32_t pid, int32_t fd), ());
 
  private:
   grpc::ServerContext* context_ = nullptr;
@@ -5,12 +5,18 @@
 #ifndef CAPTURE_EVENT_PRODUCER_LOCK_FREE_BUFFER_CAPTURE_EVENT_PRODUCER_H_
 #define CAPTURE_EVENT_PRODUCER_LOCK_FREE_BUFFER_CAPTURE_EVENT_PRODUCER_H_
 
+#include <absl/time/time.h>
 #include <google/protobuf/arena.h>
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "CaptureEventProducer/CaptureEventProducer.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "OrbitBase/ThreadWakeUp.h"
 #include "concurrentqueue.h"
 
 namespace orbit_capture_event_producer {
@@ -31,6 +37,11 @@ namespace orbit_capture_event_producer {
 // In particular, when hundreds of thousands of events are produced per second, it is recommended
 // that IntermediateEventT not be a protobuf or another type that involves heap allocations, as the
 // cost of dynamic allocations and de-allocations can add up quickly.
+//
+// The thread forwards the queue every forwarding interval, in requests of up to a maximum number of
+// events, and without waiting in between as long as the queue holds more than that. So that a
+// long interval doesn't delay bursts of events, a thread that has enqueued a number of events
+// wakes up the forwarding thread early. These three values can be tuned using the Set... methods.
 template <typename IntermediateEventT>
 class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
  public:
@@ -42,6 +53,7 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
 
   void ShutdownAndWait() override {
     shutdown_requested_ = true;
+    forwarder_thread_wake_up_.WakeUp();
 
     CHECK(forwarder_thread_.joinable());
     forwarder_thread_.join();
@@ -49,18 +61,52 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
     CaptureEventProducer::ShutdownAndWait();
   }
 
+  // The maximum number of events in each ReceiveCommandsAndSendEventsRequest. The default is 10000.
+  void SetMaxEventsPerRequest(uint64_t max_events_per_request) {
+    CHECK(max_events_per_request > 0);
+    max_events_per_request_ = max_events_per_request;
+  }
+
+  // How long the forwarding thread waits for new events once it has emptied the queue. The default
+  // is 10 ms.
+  void SetForwardingIntervalUs(uint64_t us) { forwarding_interval_us_ = us; }
+
+  // Every time a thread has enqueued this many events, it wakes up the forwarding thread, if
+  // sleeping. Zero disables this. The default is 1000.
+  void SetWakeUpEventCount(uint64_t wake_up_event_count) {
+    wake_up_event_count_ = wake_up_event_count;
+  }
+
   void EnqueueIntermediateEvent(const IntermediateEventT& event) {
     lock_free_queue_.enqueue(event);
+    OnEventEnqueued();
   }
 
   void EnqueueIntermediateEvent(IntermediateEventT&& event) {
     lock_free_queue_.enqueue(std::move(event));
+    OnEventEnqueued();
+  }
+
+  // A thread that enqueues many events can use a ProducerToken, which it must destroy before this
+  // object, to enqueue into its own sub-queue of the lock-free queue. Unlike with the methods that
+  // don't take a token, this avoids looking up the calling thread's sub-queue on every call, and
+  // threads never write to the same cache lines. Events enqueued with the same token are forwarded
+  // in order.
+  [[nodiscard]] moodycamel::ProducerToken CreateProducerToken() {
+    return moodycamel::ProducerToken{lock_free_queue_};
+  }
+
+  void EnqueueIntermediateEvent(moodycamel::ProducerToken* producer_token,
+                                IntermediateEventT&& event) {
+    lock_free_queue_.enqueue(*producer_token, std::move(event));
+    OnEventEnqueued();
   }
 
   bool EnqueueIntermediateEventIfCapturing(
       const std::function<IntermediateEventT()>& event_builder_if_capturing) {
     if (IsCapturing()) {
       lock_free_queue_.enqueue(event_builder_if_capturing());
+      OnEventEnqueued();
       return true;
     }
     return false;
@@ -75,6 +121,8 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
   void OnCaptureStop() override {
     absl::MutexLock lock{&status_mutex_};
     status_ = ProducerStatus::kShouldNotifyAllEventsSent;
+    // Don't delay AllEventsSent by up to the forwarding interval.
+    forwarder_thread_wake_up_.WakeUp();
   }
 
   void OnCaptureFinished() override {
@@ -95,12 +143,55 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
   [[nodiscard]] virtual orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
       IntermediateEventT&& intermediate_event, google::protobuf::Arena* arena) = 0;
 
+  // Subclasses can override this method to translate all the events of a request at once, with the
+  // same requirements as for TranslateIntermediateEvent. The default implementation calls
+  // TranslateIntermediateEvent for each event.
+  virtual void TranslateIntermediateEvents(
+      IntermediateEventT* intermediate_events, size_t intermediate_event_count,
+      google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>*
+          capture_events) {
+    for (size_t i = 0; i < intermediate_event_count; ++i) {
+      capture_events->AddAllocated(
+          TranslateIntermediateEvent(std::move(intermediate_events[i]), arena));
+    }
+  }
+
+  // Subclasses that hold back some of the events they are passed, for example to coalesce them,
+  // can override these two methods. Whether HasPendingEventsToSend returns true is checked every
+  // time the forwarding thread wakes up, and if so, TranslatePendingEvents appends the events held
+  // back to the next request, with the same requirements as for TranslateIntermediateEvent. With
+  // `all_events`, both are about all the events held back, as AllEventsSent follows. Both are only
+  // called from the forwarding thread.
+  [[nodiscard]] virtual bool HasPendingEventsToSend(bool /*all_events*/) { return false; }
+
+  virtual void TranslatePendingEvents(
+      bool /*all_events*/, google::protobuf::Arena* /*arena*/,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>*
+      /*capture_events*/) {}
+
  private:
+  void OnEventEnqueued() {
+    const uint64_t wake_up_event_count = wake_up_event_count_.load(std::memory_order_relaxed);
+    if (wake_up_event_count == 0) {
+      return;
+    }
+    // Counting per thread avoids contention on a shared counter. Note that the count is shared by
+    // all instances with the same IntermediateEventT, which at worst causes an early wake-up.
+    thread_local uint64_t enqueued_event_count = 0;
+    if (++enqueued_event_count >= wake_up_event_count) {
+      enqueued_event_count = 0;
+      forwarder_thread_wake_up_.WakeUp();
+    }
+  }
+
   void ForwarderThread() {
     orbit_base::SetCurrentThreadName("ForwarderThread");
 
-    constexpr uint64_t kMaxEventsPerRequest = 10'000;
-    std::vector<IntermediateEventT> dequeued_events(kMaxEventsPerRequest);
+    std::vector<IntermediateEventT> dequeued_events;
+    // Taking the events from the sub-queue of one enqueuing thread at a time, rather than rotating
+    // between them, makes bulk dequeuing faster.
+    moodycamel::ConsumerToken consumer_token{lock_free_queue_};
 
     // Pre-allocate and always reuse the same 1 MB chunk of memory as the first block of each Arena
     // instance in the loop below. This is a small but measurable performance improvement.
@@ -111,10 +202,15 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
     arena_options.initial_block_size = kArenaInitialBlockSize;
 
     while (!shutdown_requested_) {
+      const uint64_t max_events_per_request = max_events_per_request_;
+      if (dequeued_events.size() != max_events_per_request) {
+        dequeued_events.resize(max_events_per_request);
+      }
+
       while (true) {
-        size_t dequeued_event_count =
-            lock_free_queue_.try_dequeue_bulk(dequeued_events.begin(), kMaxEventsPerRequest);
-        bool queue_was_emptied = dequeued_event_count < kMaxEventsPerRequest;
+        size_t dequeued_event_count = lock_free_queue_.try_dequeue_bulk(
+            consumer_token, dequeued_events.begin(), max_events_per_request);
+        bool queue_was_emptied = dequeued_event_count < max_events_per_request;
 
         ProducerStatus current_status;
         {
@@ -126,9 +222,13 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
           }
         }
 
-        if ((current_status == ProducerStatus::kShouldSendEvents ||
-             current_status == ProducerStatus::kShouldNotifyAllEventsSent) &&
-            dequeued_event_count > 0) {
+        const bool is_sending = current_status == ProducerStatus::kShouldSendEvents ||
+                                current_status == ProducerStatus::kShouldNotifyAllEventsSent;
+        // Before AllEventsSent, all the events held back have to be sent.
+        const bool is_last_request =
+            current_status == ProducerStatus::kShouldNotifyAllEventsSent && queue_was_emptied;
+        const bool has_pending_events = is_sending && HasPendingEventsToSend(is_last_request);
+        if (is_sending && (dequeued_event_count > 0 || has_pending_events)) {
           google::protobuf::Arena arena{arena_options};
           auto* send_request = google::protobuf::Arena::CreateMessage<
               orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>(&arena);
@@ -136,9 +236,10 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
               send_request->mutable_buffered_capture_events()->mutable_capture_events();
           capture_events->Reserve(dequeued_event_count);
 
-          for (size_t i = 0; i < dequeued_event_count; ++i) {
-            capture_events->AddAllocated(
-                TranslateIntermediateEvent(std::move(dequeued_events[i]), &arena));
+          TranslateIntermediateEvents(dequeued_events.data(), dequeued_event_count, &arena,
+                                      capture_events);
+          if (has_pending_events) {
+            TranslatePendingEvents(is_last_request, &arena, capture_events);
           }
 
           if (!SendCaptureEvents(*send_request)) {
@@ -164,9 +265,9 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
         }
       }
 
-      static constexpr std::chrono::duration kSleepOnEmptyQueue = std::chrono::microseconds{1000};
       // Wait for lock_free_queue_ to fill up with new CaptureEvents.
-      std::this_thread::sleep_for(kSleepOnEmptyQueue);
+      forwarder_thread_wake_up_.SleepFor(
+          absl::Microseconds(static_cast<int64_t>(forwarding_interval_us_.load())));
     }
   }
 
@@ -175,6 +276,11 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
 
   std::thread forwarder_thread_;
   std::atomic<bool> shutdown_requested_ = false;
+  orbit_base::ThreadWakeUp forwarder_thread_wake_up_;
+
+  std::atomic<uint64_t> max_events_per_request_ = 10'000;
+  std::atomic<uint64_t> forwarding_interval_us_ = 10'000;
+  std::atomic<uint64_t> wake_up_event_count_ = 1'000;
 
   enum class ProducerStatus { kShouldSendEvents, kShouldNotifyAllEventsSent, kShouldDropEvents };
   ProducerStatus status_ = ProducerStatus::kShouldDropEvents;
@@ -0,0 +1,82 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AsyncFileWriter.h"
+
+#include <utility>
+
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_capture_file_internal {
+
+AsyncFileWriter::AsyncFileWriter(const orbit_base::unique_fd& fd, size_t max_pending_bytes)
+    : fd_{fd}, max_pending_bytes_{max_pending_bytes} {
+  writer_thread_ = std::thread{[this] { WriterThread(); }};
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  writer_thread_.join();
+}
+
+void AsyncFileWriter::WriterThread() {
+  orbit_base::SetCurrentThreadName("CaptureWriter");
+
+  while (true) {
+    std::string buffer;
+    {
+      absl::MutexLock lock{&mutex_};
+      auto has_buffer_or_stop_requested = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+        return stop_requested_ || !pending_buffers_.empty();
+      };
+      mutex_.Await(absl::Condition(&has_buffer_or_stop_requested));
+      // The remaining buffers are still written after the stop request.
+      if (pending_buffers_.empty()) return;
+      buffer = std::move(pending_buffers_.front());
+      pending_buffers_.pop_front();
+    }
+
+    ErrorMessageOr<void> result = orbit_base::WriteFully(fd_, buffer);
+
+    absl::MutexLock lock{&mutex_};
+    pending_bytes_ -= buffer.size();
+    if (result.has_error()) {
+      error_ = result.error();
+      pending_buffers_.clear();
+      pending_bytes_ = 0;
+      return;
+    }
+  }
+}
+
+ErrorMessageOr<void> AsyncFileWriter::Write(std::string buffer) {
+  absl::MutexLock lock{&mutex_};
+  // A buffer larger than `max_pending_bytes_` is accepted once nothing else is pending.
+  auto has_room_or_error = [this, size = buffer.size()]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return error_.has_value() || pending_bytes_ == 0 ||
+           pending_bytes_ + size <= max_pending_bytes_;
+  };
+  mutex_.Await(absl::Condition(&has_room_or_error));
+  if (error_.has_value()) return error_.value();
+  if (buffer.empty()) return outcome::success();
+
+  pending_bytes_ += buffer.size();
+  pending_buffers_.push_back(std::move(buffer));
+  return outcome::success();
+}
+
+ErrorMessageOr<void> AsyncFileWriter::WaitForPendingWrites() {
+  absl::MutexLock lock{&mutex_};
+  auto nothing_pending = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return pending_bytes_ == 0;
+  };
+  mutex_.Await(absl::Condition(&nothing_pending));
+  if (error_.has_value()) return error_.value();
+  return outcome::success();
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,58 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_ASYNC_FILE_WRITER_H_
+#define CAPTURE_FILE_ASYNC_FILE_WRITER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// Writes buffers to a file descriptor, in order, from its current offset, on a dedicated thread, so
+// that the thread producing the buffers doesn't wait for the writes. `Write` only blocks when more
+// than `max_pending_bytes` would be waiting to be written, which bounds the memory used. After the
+// first failed write nothing else is written, and the error is returned by all following calls.
+// `fd` must outlive the writer.
+class AsyncFileWriter {
+ public:
+  AsyncFileWriter(const orbit_base::unique_fd& fd, size_t max_pending_bytes);
+  // Waits for the pending buffers to be written.
+  ~AsyncFileWriter();
+
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+  [[nodiscard]] ErrorMessageOr<void> Write(std::string buffer);
+  // Blocks until all the buffers passed to `Write` have been written.
+  [[nodiscard]] ErrorMessageOr<void> WaitForPendingWrites();
+
+ private:
+  void WriterThread();
+
+  const orbit_base::unique_fd& fd_;
+  size_t max_pending_bytes_;
+
+  absl::Mutex mutex_;
+  std::deque<std::string> pending_buffers_ ABSL_GUARDED_BY(mutex_);
+  // Includes the size of the buffer being written.
+  size_t pending_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::optional<ErrorMessage> error_ ABSL_GUARDED_BY(mutex_);
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::thread writer_thread_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_ASYNC_FILE_WRITER_H_
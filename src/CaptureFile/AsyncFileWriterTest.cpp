@@ -0,0 +1,73 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "AsyncFileWriter.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+
+TEST(AsyncFileWriter, WritesBuffersInOrder) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  auto fd_or_error = orbit_base::OpenNewFileForWriting(temporary_file.file_path());
+  ASSERT_THAT(fd_or_error, HasNoError());
+  orbit_base::unique_fd fd = std::move(fd_or_error.value());
+
+  std::string expected_content;
+  {
+    // Small enough for Write to block while the previous buffers are being written.
+    constexpr size_t kMaxPendingBytes = 64;
+    AsyncFileWriter writer{fd, kMaxPendingBytes};
+    for (int i = 0; i < 1000; ++i) {
+      std::string buffer = std::to_string(i) + ",";
+      expected_content.append(buffer);
+      EXPECT_THAT(writer.Write(std::move(buffer)), HasNoError());
+    }
+    // Larger than kMaxPendingBytes.
+    std::string large_buffer(1000, 'x');
+    expected_content.append(large_buffer);
+    EXPECT_THAT(writer.Write(std::move(large_buffer)), HasNoError());
+    EXPECT_THAT(writer.WaitForPendingWrites(), HasNoError());
+
+    // Written by the destructor.
+    EXPECT_THAT(writer.Write("end"), HasNoError());
+    expected_content.append("end");
+  }
+
+  ErrorMessageOr<std::string> content_or_error =
+      orbit_base::ReadFileToString(temporary_file.file_path());
+  ASSERT_THAT(content_or_error, HasNoError());
+  EXPECT_EQ(content_or_error.value(), expected_content);
+}
+
+TEST(AsyncFileWriter, ReturnsWriteError) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  auto fd_or_error = orbit_base::OpenFileForReading(temporary_file.file_path());
+  ASSERT_THAT(fd_or_error, HasNoError());
+  // Writing to a file opened for reading fails.
+  orbit_base::unique_fd fd = std::move(fd_or_error.value());
+
+  AsyncFileWriter writer{fd, 1024};
+  EXPECT_THAT(writer.Write("data"), HasNoError());
+  EXPECT_THAT(writer.WaitForPendingWrites(), HasError(""));
+  EXPECT_THAT(writer.Write("more data"), HasError(""));
+  EXPECT_THAT(writer.WaitForPendingWrites(), HasError(""));
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,94 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "BlockCompression.h"
+
+#include <absl/strings/str_format.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "OrbitBase/UniqueResource.h"
+
+namespace orbit_capture_file_internal {
+
+ErrorMessageOr<std::string> CompressBlock(std::string_view data) {
+  // Captures are written while they are taken, so we favor speed over compression ratio.
+  constexpr int kCompressionLevel = Z_BEST_SPEED;
+
+  uLongf compressed_size = compressBound(data.size());
+  std::string compressed_data(compressed_size, '\0');
+  int result = compress2(reinterpret_cast<Bytef*>(compressed_data.data()), &compressed_size,
+                         reinterpret_cast<const Bytef*>(data.data()), data.size(),
+                         kCompressionLevel);
+  if (result != Z_OK) {
+    return ErrorMessage{absl::StrFormat("Unable to compress block: zlib error %d", result)};
+  }
+  compressed_data.resize(compressed_size);
+  return compressed_data;
+}
+
+ErrorMessageOr<void> DecompressBlock(const void* compressed_data, size_t compressed_size,
+                                     void* data, size_t uncompressed_size) {
+  uLongf actual_uncompressed_size = uncompressed_size;
+  int result = uncompress(static_cast<Bytef*>(data), &actual_uncompressed_size,
+                          static_cast<const Bytef*>(compressed_data), compressed_size);
+  if (result != Z_OK) {
+    return ErrorMessage{absl::StrFormat(
+        "Unable to decompress block: zlib error %d. This means that the file is corrupted.",
+        result)};
+  }
+  if (actual_uncompressed_size != uncompressed_size) {
+    return ErrorMessage{absl::StrFormat(
+        "Block decompressed to %d bytes instead of %d. This means that the file is corrupted.",
+        actual_uncompressed_size, uncompressed_size)};
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<std::optional<CompressedBlockSizes>> DecompressBlockAtOffset(
+    const orbit_base::unique_fd& fd, uint64_t offset, uint64_t max_compressed_size,
+    uint64_t max_uncompressed_size, std::string* data) {
+  z_stream stream{};
+  if (inflateInit(&stream) != Z_OK) {
+    return ErrorMessage{absl::StrFormat("Unable to decompress block: %s", stream.msg)};
+  }
+  orbit_base::unique_resource stream_end{&stream, [](z_stream* stream) { inflateEnd(stream); }};
+
+  constexpr size_t kReadSize = 1024 * 1024;
+  std::string compressed_data(kReadSize, '\0');
+  uint64_t read_offset = offset;
+  data->clear();
+  int result = Z_OK;
+  while (result != Z_STREAM_END) {
+    if (stream.avail_in == 0) {
+      const uint64_t remaining_size = max_compressed_size - (read_offset - offset);
+      if (remaining_size == 0) return std::nullopt;
+      OUTCOME_TRY(bytes_read,
+                  orbit_base::ReadFullyAtOffset(fd, compressed_data.data(),
+                                                std::min<uint64_t>(kReadSize, remaining_size),
+                                                static_cast<off_t>(read_offset)));
+      if (bytes_read == 0) return std::nullopt;
+      read_offset += bytes_read;
+      stream.next_in = reinterpret_cast<Bytef*>(compressed_data.data());
+      stream.avail_in = static_cast<uInt>(bytes_read);
+    }
+    if (stream.avail_out == 0) {
+      const size_t decompressed_size = stream.total_out;
+      if (decompressed_size >= max_uncompressed_size) return std::nullopt;
+      data->resize(
+          std::min<uint64_t>(max_uncompressed_size, std::max(2 * decompressed_size, kReadSize)));
+      stream.next_out = reinterpret_cast<Bytef*>(data->data() + decompressed_size);
+      stream.avail_out = static_cast<uInt>(data->size() - decompressed_size);
+    }
+    result = inflate(&stream, Z_NO_FLUSH);
+    // Anything else than a complete valid block is treated as the end of the blocks.
+    if (result != Z_OK && result != Z_STREAM_END) return std::nullopt;
+  }
+
+  data->resize(stream.total_out);
+  return CompressedBlockSizes{stream.total_in, stream.total_out};
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,44 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_BLOCK_COMPRESSION_H_
+#define CAPTURE_FILE_BLOCK_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// Compresses `data` with zlib into a block that can be decompressed independently of any other.
+[[nodiscard]] ErrorMessageOr<std::string> CompressBlock(std::string_view data);
+
+// Decompresses a block created by `CompressBlock` into `data`, which needs to be exactly
+// `uncompressed_size` bytes large. Fails if the block doesn't decompress to that many bytes.
+[[nodiscard]] ErrorMessageOr<void> DecompressBlock(const void* compressed_data,
+                                                   size_t compressed_size, void* data,
+                                                   size_t uncompressed_size);
+
+struct CompressedBlockSizes {
+  uint64_t compressed_size;
+  uint64_t uncompressed_size;
+};
+
+// Decompresses the block created by `CompressBlock` that starts at `offset` in `fd` into `data`.
+// The end of the block is only known once it is decompressed, as the blocks are self-delimiting.
+// Returns std::nullopt if there is no complete valid block of at most `max_compressed_size` bytes
+// that decompresses to at most `max_uncompressed_size` bytes at `offset`, e.g., because the file is
+// truncated.
+[[nodiscard]] ErrorMessageOr<std::optional<CompressedBlockSizes>> DecompressBlockAtOffset(
+    const orbit_base::unique_fd& fd, uint64_t offset, uint64_t max_compressed_size,
+    uint64_t max_uncompressed_size, std::string* data);
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_BLOCK_COMPRESSION_H_
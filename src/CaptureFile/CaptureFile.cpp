@@ -4,9 +4,19 @@
 
 #include "CaptureFile/CaptureFile.h"
 
+#include <google/protobuf/io/coded_stream.h>
+
+#include "BlockCompression.h"
 #include "CaptureFileConstants.h"
+#include "CaptureSectionRecovery.h"
+#include "CompressedBlocksInputStream.h"
 #include "OrbitBase/File.h"
 #include "ProtoSectionInputStreamImpl.h"
+#include "capture_section_block_table.pb.h"
+
+#if defined(__linux)
+#include "MappedFileFragmentInputStream.h"
+#endif
 
 namespace orbit_capture_file {
 
@@ -47,6 +57,8 @@ class CaptureFileImpl : public CaptureFile {
                                        void* data, size_t size) override;
 
   std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() override;
+  std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStreamAtOffset(
+      uint64_t offset_in_section) override;
 
   [[nodiscard]] const std::filesystem::path& GetFilePath() const override;
 
@@ -57,7 +69,13 @@ class CaptureFileImpl : public CaptureFile {
   // Parse header and validate version/file-format
   ErrorMessageOr<void> ReadHeader();
   ErrorMessageOr<void> ReadSectionList();
+  // Makes a file whose writer didn't finish it, e.g., because it crashed, readable again. The
+  // incomplete data at the end of the capture section is removed and a CaptureFinished event is
+  // appended if needed. For a compressed capture section, the block table is rebuilt.
+  ErrorMessageOr<void> RecoverTruncatedCaptureSection();
+  ErrorMessageOr<void> RecoverTruncatedCompressedCaptureSection(uint64_t end_of_file);
   ErrorMessageOr<void> CalculateCaptureSectionSize();
+  ErrorMessageOr<void> ReadCaptureSectionBlockTable();
   ErrorMessageOr<void> WriteSectionList(const std::vector<CaptureFileSection>& section_list,
                                         uint64_t offset);
   [[nodiscard]] bool IsThereSectionWithOffsetAfterSectionList() const;
@@ -73,6 +91,10 @@ class CaptureFileImpl : public CaptureFile {
   // message to detect the last message for the capture section.
   uint64_t capture_section_size_ = 0;
 
+  // Only set in files of version kFileVersionWithCompressedCaptureSection.
+  std::optional<orbit_client_protos::CaptureSectionBlockTable> capture_section_block_table_;
+  uint64_t uncompressed_capture_section_size_ = 0;
+
   std::vector<CaptureFileSection> section_list_;
 };
 
@@ -101,9 +123,128 @@ ErrorMessageOr<void> CaptureFileImpl::Initialize() {
   fd_ = std::move(fd_or_error.value());
 
   OUTCOME_TRY(ReadHeader());
+  if (header_.section_list_offset == 0) {
+    OUTCOME_TRY(RecoverTruncatedCaptureSection());
+  }
   OUTCOME_TRY(ReadSectionList());
   OUTCOME_TRY(CalculateCaptureSectionSize());
+  if (header_.version == kFileVersionWithCompressedCaptureSection) {
+    OUTCOME_TRY(ReadCaptureSectionBlockTable());
+  }
+
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileImpl::RecoverTruncatedCaptureSection() {
+  OUTCOME_TRY(end_of_file, GetEndOfFileOffset(fd_));
+  if (end_of_file < header_.capture_section_offset) {
+    return ErrorMessage{"Unexpected EOF while reading the capture section"};
+  }
+
+  // A compressed capture section is always followed by its block table, so the file is truncated.
+  if (header_.version == kFileVersionWithCompressedCaptureSection) {
+    return RecoverTruncatedCompressedCaptureSection(end_of_file);
+  }
+
+  const uint64_t section_size = end_of_file - header_.capture_section_offset;
+  OUTCOME_TRY(scan_result, orbit_capture_file_internal::ScanUncompressedCaptureSection(
+                               fd_, header_.capture_section_offset, section_size));
+  // A capture section that ends with a complete message is left as is, even without
+  // CaptureFinished, in which case readers report an error after the last event.
+  if (scan_result.complete_size == section_size) return outcome::success();
+
+  LOG("Recovering truncated capture file \"%s\": %d of %d bytes of the capture section are "
+      "complete",
+      file_path_.string(), scan_result.complete_size, section_size);
+  const uint64_t complete_end = header_.capture_section_offset + scan_result.complete_size;
+  OUTCOME_TRY(orbit_base::ResizeFile(file_path_, complete_end));
+  if (!scan_result.ends_with_capture_finished) {
+    const std::string capture_finished =
+        orbit_capture_file_internal::CreateSerializedCaptureFinishedAfterTruncation();
+    OUTCOME_TRY(orbit_base::WriteFullyAtOffset(fd_, capture_finished.data(),
+                                               capture_finished.size(), complete_end));
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileImpl::RecoverTruncatedCompressedCaptureSection(
+    uint64_t end_of_file) {
+  OUTCOME_TRY(scan_result, orbit_capture_file_internal::ScanCompressedCaptureSection(
+                               fd_, header_.capture_section_offset,
+                               end_of_file - header_.capture_section_offset));
+  LOG("Recovering truncated capture file \"%s\": %d blocks of the capture section are complete",
+      file_path_.string(), scan_result.blocks.size());
+
+  uint64_t offset = header_.capture_section_offset + scan_result.complete_size;
+  OUTCOME_TRY(orbit_base::ResizeFile(file_path_, offset));
+
+  orbit_client_protos::CaptureSectionBlockTable block_table;
+  for (auto& block : scan_result.blocks) {
+    *block_table.add_blocks() = std::move(block);
+  }
+  if (!scan_result.ends_with_capture_finished) {
+    const std::string capture_finished =
+        orbit_capture_file_internal::CreateSerializedCaptureFinishedAfterTruncation();
+    OUTCOME_TRY(compressed_block, orbit_capture_file_internal::CompressBlock(capture_finished));
+    OUTCOME_TRY(orbit_base::WriteFullyAtOffset(fd_, compressed_block.data(),
+                                               compressed_block.size(), offset));
+    orbit_client_protos::CaptureSectionBlockTable::Block* block = block_table.add_blocks();
+    block->set_offset(offset - header_.capture_section_offset);
+    block->set_compressed_size(compressed_block.size());
+    block->set_uncompressed_size(capture_finished.size());
+    offset += compressed_block.size();
+  }
+
+  // Write the block table and a section list that only contains it, like the writer would have.
+  const uint64_t block_table_offset = AlignUp<8>(offset);
+  const size_t message_size = block_table.ByteSizeLong();
+  std::string block_table_section(
+      google::protobuf::io::CodedOutputStream::VarintSize32(message_size) + message_size, '\0');
+  uint8_t* message_start = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      message_size, reinterpret_cast<uint8_t*>(block_table_section.data()));
+  block_table.SerializeWithCachedSizesToArray(message_start);
+  OUTCOME_TRY(orbit_base::WriteFullyAtOffset(fd_, block_table_section.data(),
+                                             block_table_section.size(), block_table_offset));
+
+  const uint64_t section_list_offset =
+      AlignUp<8>(block_table_offset + block_table_section.size());
+  std::vector<CaptureFileSection> section_list{
+      CaptureFileSection{/*.type = */ kSectionTypeCaptureSectionBlockTable,
+                         /*.offset = */ block_table_offset,
+                         /*.size = */ block_table_section.size()}};
+  OUTCOME_TRY(WriteSectionList(section_list, section_list_offset));
+
+  uint64_t section_list_offset_field_offset = offsetof(CaptureFileHeader, section_list_offset);
+  OUTCOME_TRY(orbit_base::WriteFullyAtOffset(
+      fd_, &section_list_offset, sizeof(section_list_offset), section_list_offset_field_offset));
+  header_.section_list_offset = section_list_offset;
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileImpl::ReadCaptureSectionBlockTable() {
+  std::optional<uint64_t> section_number = FindSectionByType(kSectionTypeCaptureSectionBlockTable);
+  if (!section_number.has_value()) {
+    return ErrorMessage{"The capture section is compressed but the file has no block table"};
+  }
+
+  orbit_client_protos::CaptureSectionBlockTable block_table;
+  OUTCOME_TRY(CreateProtoSectionInputStream(section_number.value())->ReadMessage(&block_table));
 
+  uncompressed_capture_section_size_ = 0;
+  for (const auto& block : block_table.blocks()) {
+    if (block.compressed_size() > kMaxCompressedBlockSize ||
+        block.uncompressed_size() > kMaxCompressedBlockSize ||
+        block.offset() > capture_section_size_ ||
+        block.compressed_size() > capture_section_size_ - block.offset()) {
+      return ErrorMessage{absl::StrFormat(
+          "Invalid block in the capture section block table: offset=%d, compressed size=%d, "
+          "uncompressed size=%d",
+          block.offset(), block.compressed_size(), block.uncompressed_size())};
+    }
+    uncompressed_capture_section_size_ += block.uncompressed_size();
+  }
+
+  capture_section_block_table_ = std::move(block_table);
   return outcome::success();
 }
 
@@ -170,9 +311,11 @@ ErrorMessageOr<void> CaptureFileImpl::ReadHeader() {
     return ErrorMessage{"Invalid file signature"};
   }
 
-  if (header_.version != kFileVersion) {
-    return ErrorMessage{
-        absl::StrFormat("Incompatible version %d, expected %d", header_.version, kFileVersion)};
+  if (header_.version != kFileVersion &&
+      header_.version != kFileVersionWithCompressedCaptureSection) {
+    return ErrorMessage{absl::StrFormat("Incompatible version %d, expected %d or %d",
+                                        header_.version, kFileVersion,
+                                        kFileVersionWithCompressedCaptureSection)};
   }
 
   return outcome::success();
@@ -279,8 +422,39 @@ ErrorMessageOr<void> CaptureFileImpl::ReadFromSection(uint64_t section_number,
 }
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStream() {
+  return CreateCaptureSectionInputStreamAtOffset(0);
+}
+
+std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStreamAtOffset(
+    uint64_t offset_in_section) {
+  if (capture_section_block_table_.has_value()) {
+    // The offsets in the capture section refer to the uncompressed data.
+    CHECK(offset_in_section <= uncompressed_capture_section_size_);
+    std::vector<orbit_client_protos::CaptureSectionBlockTable::Block> blocks{
+        capture_section_block_table_->blocks().begin(),
+        capture_section_block_table_->blocks().end()};
+    return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
+        std::make_unique<orbit_capture_file_internal::CompressedBlocksInputStream>(
+            fd_, header_.capture_section_offset, std::move(blocks), offset_in_section));
+  }
+
+  CHECK(offset_in_section <= capture_section_size_);
+#if defined(__linux)
+  // Parsing directly from the mapped file avoids copying the (potentially huge) capture section.
+  auto mapped_input_stream_or_error =
+      orbit_capture_file_internal::MappedFileFragmentInputStream::Create(
+          fd_, header_.capture_section_offset + offset_in_section,
+          capture_section_size_ - offset_in_section);
+  if (mapped_input_stream_or_error.has_value()) {
+    return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
+        std::move(mapped_input_stream_or_error.value()));
+  }
+  ERROR("Reading the capture section without memory mapping: %s",
+        mapped_input_stream_or_error.error().message());
+#endif
   return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, header_.capture_section_offset, capture_section_size_);
+      fd_, header_.capture_section_offset + offset_in_section,
+      capture_section_size_ - offset_in_section);
 }
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInputStream(
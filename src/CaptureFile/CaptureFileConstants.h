@@ -17,5 +17,13 @@ constexpr std::string_view kFileSignature = "ORBT";
 static_assert(kFileSignature.size() == 4);
 
 constexpr uint32_t kFileVersion = 1;
+// In this version the capture section is stored in independently compressed blocks, which are
+// listed in the CAPTURE_SECTION_BLOCK_TABLE section.
+constexpr uint32_t kFileVersionWithCompressedCaptureSection = 2;
+
+// Since file input is not trusted, we limit the size of the messages, and of the compressed blocks
+// of the capture section, to avoid huge allocations when reading them.
+constexpr uint64_t kMaxMessageSize = 1024 * 1024;
+constexpr uint64_t kMaxCompressedBlockSize = 64 * 1024 * 1024;
 
 #endif  // CAPTURE_FILE_CONSTANTS_H_
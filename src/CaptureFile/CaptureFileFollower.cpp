@@ -0,0 +1,233 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureFile/CaptureFileFollower.h"
+
+#include <absl/strings/str_format.h>
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "BlockCompression.h"
+#include "CaptureFile/CaptureFileSection.h"
+#include "CaptureFileConstants.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_capture_file {
+
+namespace {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+// Bounds the data read by one call of ReadNewEvents. This needs to be more than the largest event.
+constexpr uint64_t kMaxReadSizePerCall = 16 * 1024 * 1024;
+static_assert(kMaxReadSizePerCall > 2 * kMaxMessageSize);
+
+constexpr uint64_t kMaxNumberOfSections = std::numeric_limits<uint16_t>::max();
+
+// Maximum size of a varint encoded uint32_t.
+constexpr size_t kMaxVarint32Size = 5;
+
+// The offsets of the fields of the header, see FORMAT.md.
+constexpr off_t kVersionOffset = kFileSignature.size();
+constexpr off_t kCaptureSectionOffsetOffset = kVersionOffset + sizeof(uint32_t);
+constexpr off_t kSectionListOffsetOffset = kCaptureSectionOffsetOffset + sizeof(uint64_t);
+
+using FileSignature = std::array<char, kFileSignature.size()>;
+
+class CaptureFileFollowerImpl final : public CaptureFileFollower {
+ public:
+  explicit CaptureFileFollowerImpl(orbit_base::unique_fd fd) : fd_{std::move(fd)} {}
+
+  [[nodiscard]] ErrorMessageOr<void> ReadHeader();
+
+  [[nodiscard]] ErrorMessageOr<std::vector<ClientCaptureEvent>> ReadNewEvents() override;
+  [[nodiscard]] bool IsCaptureFinished() const override { return capture_finished_; }
+
+ private:
+  // Returns the offset in the file of the end of the capture section, which is only known once the
+  // writer has finished the file and written the section list.
+  [[nodiscard]] ErrorMessageOr<std::optional<uint64_t>> ReadCaptureSectionEnd() const;
+  [[nodiscard]] ErrorMessageOr<void> ReadNewUncompressedEvents(
+      std::optional<uint64_t> capture_section_end, std::vector<ClientCaptureEvent>* events);
+  [[nodiscard]] ErrorMessageOr<void> ReadNewCompressedEvents(
+      std::optional<uint64_t> capture_section_end, std::vector<ClientCaptureEvent>* events);
+  // Parses the complete events at the start of `data`, up to CaptureFinished, and returns the size
+  // of the data they take.
+  [[nodiscard]] ErrorMessageOr<size_t> ParseEvents(std::string_view data,
+                                                   std::vector<ClientCaptureEvent>* events);
+
+  orbit_base::unique_fd fd_;
+  uint32_t version_ = 0;
+  // The offset in the file of the first event (or block) not returned yet.
+  uint64_t next_offset_ = 0;
+  bool capture_finished_ = false;
+};
+
+ErrorMessageOr<void> CaptureFileFollowerImpl::ReadHeader() {
+  OUTCOME_TRY(signature, orbit_base::ReadFullyAtOffset<FileSignature>(fd_, 0));
+  if (std::memcmp(signature.data(), kFileSignature.data(), kFileSignature.size()) != 0) {
+    return ErrorMessage{"Invalid file signature"};
+  }
+
+  OUTCOME_TRY(version, orbit_base::ReadFullyAtOffset<uint32_t>(fd_, kVersionOffset));
+  if (version != kFileVersion && version != kFileVersionWithCompressedCaptureSection) {
+    return ErrorMessage{absl::StrFormat("Incompatible version %d, expected %d or %d", version,
+                                        kFileVersion, kFileVersionWithCompressedCaptureSection)};
+  }
+  version_ = version;
+
+  OUTCOME_TRY(capture_section_offset,
+              orbit_base::ReadFullyAtOffset<uint64_t>(fd_, kCaptureSectionOffsetOffset));
+  next_offset_ = capture_section_offset;
+  return outcome::success();
+}
+
+ErrorMessageOr<std::optional<uint64_t>> CaptureFileFollowerImpl::ReadCaptureSectionEnd() const {
+  OUTCOME_TRY(section_list_offset,
+              orbit_base::ReadFullyAtOffset<uint64_t>(fd_, kSectionListOffsetOffset));
+  if (section_list_offset == 0) return std::nullopt;
+
+  OUTCOME_TRY(number_of_sections,
+              orbit_base::ReadFullyAtOffset<uint64_t>(fd_, section_list_offset));
+  if (number_of_sections > kMaxNumberOfSections) {
+    return ErrorMessage{absl::StrFormat("The section list is too large: %d entries",
+                                        number_of_sections)};
+  }
+
+  // The additional sections, if any, follow the capture section, and the section list follows
+  // the sections written with it.
+  uint64_t capture_section_end = section_list_offset;
+  for (uint64_t section_number = 0; section_number < number_of_sections; ++section_number) {
+    OUTCOME_TRY(section,
+                orbit_base::ReadFullyAtOffset<CaptureFileSection>(
+                    fd_, static_cast<off_t>(section_list_offset + sizeof(number_of_sections) +
+                                            section_number * sizeof(CaptureFileSection))));
+    capture_section_end = std::min(capture_section_end, section.offset);
+  }
+  return capture_section_end;
+}
+
+ErrorMessageOr<std::vector<ClientCaptureEvent>> CaptureFileFollowerImpl::ReadNewEvents() {
+  if (capture_finished_) return std::vector<ClientCaptureEvent>{};
+
+  // The header is updated after everything else has been written, so once it references a
+  // section list, the capture section is complete.
+  OUTCOME_TRY(capture_section_end, ReadCaptureSectionEnd());
+
+  std::vector<ClientCaptureEvent> events;
+  if (version_ == kFileVersionWithCompressedCaptureSection) {
+    OUTCOME_TRY(ReadNewCompressedEvents(capture_section_end, &events));
+  } else {
+    OUTCOME_TRY(ReadNewUncompressedEvents(capture_section_end, &events));
+  }
+
+  if (events.empty() && !capture_finished_ && capture_section_end.has_value()) {
+    return ErrorMessage{"The capture section ends without a CaptureFinished event"};
+  }
+  return events;
+}
+
+ErrorMessageOr<void> CaptureFileFollowerImpl::ReadNewUncompressedEvents(
+    std::optional<uint64_t> capture_section_end, std::vector<ClientCaptureEvent>* events) {
+  // Only what the writer has written so far is read, which is usually much less than
+  // kMaxReadSizePerCall when the file is polled regularly.
+  const off_t end_of_file = lseek(fd_.get(), 0, SEEK_END);
+  if (end_of_file == -1) return ErrorMessage{SafeStrerror(errno)};
+  uint64_t data_end = static_cast<uint64_t>(end_of_file);
+  if (capture_section_end.has_value()) {
+    data_end = std::min(data_end, capture_section_end.value());
+  }
+  const uint64_t read_size =
+      std::min(kMaxReadSizePerCall, std::max(data_end, next_offset_) - next_offset_);
+  if (read_size == 0) return outcome::success();
+
+  // The incomplete event at the end, if any, is read again by the next call.
+  std::string data(read_size, '\0');
+  OUTCOME_TRY(bytes_read, orbit_base::ReadFullyAtOffset(fd_, data.data(), read_size,
+                                                        static_cast<off_t>(next_offset_)));
+  data.resize(bytes_read);
+
+  OUTCOME_TRY(parsed_size, ParseEvents(data, events));
+  next_offset_ += parsed_size;
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileFollowerImpl::ReadNewCompressedEvents(
+    std::optional<uint64_t> capture_section_end, std::vector<ClientCaptureEvent>* events) {
+  std::string block_data;
+  uint64_t uncompressed_size_read = 0;
+  while (!capture_finished_ && uncompressed_size_read < kMaxReadSizePerCall) {
+    uint64_t max_compressed_size = kMaxCompressedBlockSize;
+    if (capture_section_end.has_value()) {
+      max_compressed_size = std::min(
+          max_compressed_size, std::max(capture_section_end.value(), next_offset_) - next_offset_);
+    }
+    // An incomplete block, which the writer is still writing, is read again by the next call.
+    OUTCOME_TRY(block_sizes, orbit_capture_file_internal::DecompressBlockAtOffset(
+                                 fd_, next_offset_, max_compressed_size, kMaxCompressedBlockSize,
+                                 &block_data));
+    if (!block_sizes.has_value()) break;
+
+    // A block only contains whole events.
+    OUTCOME_TRY(parsed_size, ParseEvents(block_data, events));
+    if (parsed_size != block_data.size() && !capture_finished_) {
+      return ErrorMessage{"A block of the capture section contains an incomplete event"};
+    }
+    next_offset_ += block_sizes->compressed_size;
+    uncompressed_size_read += block_sizes->uncompressed_size;
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<size_t> CaptureFileFollowerImpl::ParseEvents(
+    std::string_view data, std::vector<ClientCaptureEvent>* events) {
+  size_t parsed_size = 0;
+  while (!capture_finished_ && parsed_size < data.size()) {
+    const std::string_view remaining_data = data.substr(parsed_size);
+    google::protobuf::io::CodedInputStream input{
+        reinterpret_cast<const uint8_t*>(remaining_data.data()),
+        static_cast<int>(std::min(remaining_data.size(), kMaxVarint32Size))};
+    uint32_t message_size = 0;
+    if (!input.ReadVarint32(&message_size)) {
+      if (remaining_data.size() < kMaxVarint32Size) break;
+      return ErrorMessage{"Invalid event size in the capture section"};
+    }
+    // The writer never writes empty events.
+    if (message_size == 0 || message_size > kMaxMessageSize) {
+      return ErrorMessage{
+          absl::StrFormat("Invalid event size in the capture section: %d", message_size)};
+    }
+    const size_t size_with_message_size = input.CurrentPosition() + message_size;
+    if (size_with_message_size > remaining_data.size()) break;
+
+    ClientCaptureEvent& event = events->emplace_back();
+    if (!event.ParseFromArray(remaining_data.data() + input.CurrentPosition(),
+                              static_cast<int>(message_size))) {
+      return ErrorMessage{"Unable to parse an event of the capture section"};
+    }
+    capture_finished_ = event.event_case() == ClientCaptureEvent::kCaptureFinished;
+    parsed_size += size_with_message_size;
+  }
+  return parsed_size;
+}
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<CaptureFileFollower>> CaptureFileFollower::Open(
+    const std::filesystem::path& file_path) {
+  OUTCOME_TRY(fd, orbit_base::OpenFileForReading(file_path));
+  auto follower = std::make_unique<CaptureFileFollowerImpl>(std::move(fd));
+  OUTCOME_TRY(follower->ReadHeader());
+  return follower;
+}
+
+}  // namespace orbit_capture_file
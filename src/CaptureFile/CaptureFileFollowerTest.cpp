@@ -0,0 +1,208 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CaptureFile/CaptureFileFollower.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file {
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr uint64_t kNumInternedStrings = 1000;
+// The section list offset is the last field of the header, and is 0 until the writer finishes.
+constexpr size_t kSectionListOffsetOffset = 16;
+constexpr size_t kHeaderSize = 24;
+
+[[nodiscard]] ClientCaptureEvent CreateInternedStringCaptureEvent(uint64_t key) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::InternedString* interned_string = event.mutable_interned_string();
+  interned_string->set_key(key);
+  interned_string->set_intern(std::to_string(key));
+  return event;
+}
+
+[[nodiscard]] orbit_base::TemporaryFile CreateTemporaryFile() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  EXPECT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  return temporary_file;
+}
+
+// Returns the content of a finished capture file.
+[[nodiscard]] std::string CreateCaptureFileContent(CaptureSectionCompression compression,
+                                                   bool write_capture_finished) {
+  orbit_base::TemporaryFile temporary_file = CreateTemporaryFile();
+  auto output_stream_or_error =
+      CaptureFileOutputStream::Create(temporary_file.file_path(), compression);
+  EXPECT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  for (uint64_t key = 0; key < kNumInternedStrings; ++key) {
+    EXPECT_THAT(output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(key)),
+                HasNoError());
+  }
+  if (write_capture_finished) {
+    ClientCaptureEvent event;
+    event.mutable_capture_finished()->set_status(orbit_grpc_protos::CaptureFinished::kSuccessful);
+    EXPECT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  EXPECT_THAT(output_stream->Close(), HasNoError());
+
+  ErrorMessageOr<std::string> content_or_error =
+      orbit_base::ReadFileToString(temporary_file.file_path());
+  EXPECT_THAT(content_or_error, HasNoError());
+  return std::move(content_or_error.value());
+}
+
+// Writes `content` to a file in pieces of `piece_size` bytes, like a writer that hasn't finished
+// the file yet, i.e., with a section list offset of 0 in the header until the last piece.
+class GrowingFile {
+ public:
+  explicit GrowingFile(std::string content) : content_{std::move(content)} {
+    auto fd_or_error = orbit_base::OpenNewFileForWriting(temporary_file_.file_path());
+    EXPECT_THAT(fd_or_error, HasNoError());
+    fd_ = std::move(fd_or_error.value());
+
+    std::string header = content_.substr(0, kHeaderSize);
+    header.replace(kSectionListOffsetOffset, sizeof(uint64_t), sizeof(uint64_t), '\0');
+    EXPECT_THAT(orbit_base::WriteFully(fd_, header), HasNoError());
+    size_written_ = header.size();
+  }
+
+  [[nodiscard]] const std::filesystem::path& GetFilePath() const {
+    return temporary_file_.file_path();
+  }
+
+  [[nodiscard]] bool IsComplete() const { return size_written_ == content_.size(); }
+
+  void Append(size_t piece_size) {
+    const std::string_view piece = std::string_view{content_}.substr(size_written_, piece_size);
+    EXPECT_THAT(orbit_base::WriteFully(fd_, piece), HasNoError());
+    size_written_ += piece.size();
+    if (!IsComplete()) return;
+
+    EXPECT_THAT(orbit_base::WriteFullyAtOffset(fd_, content_.data() + kSectionListOffsetOffset,
+                                               sizeof(uint64_t), kSectionListOffsetOffset),
+                HasNoError());
+  }
+
+ private:
+  orbit_base::TemporaryFile temporary_file_ = CreateTemporaryFile();
+  std::string content_;
+  orbit_base::unique_fd fd_;
+  size_t size_written_ = 0;
+};
+
+void FollowGrowingFile(CaptureSectionCompression compression, size_t piece_size) {
+  GrowingFile file{CreateCaptureFileContent(compression, /*write_capture_finished=*/true)};
+  auto follower_or_error = CaptureFileFollower::Open(file.GetFilePath());
+  ASSERT_THAT(follower_or_error, HasNoError());
+  std::unique_ptr<CaptureFileFollower> follower = std::move(follower_or_error.value());
+
+  std::vector<ClientCaptureEvent> events;
+  while (!follower->IsCaptureFinished()) {
+    ASSERT_FALSE(file.IsComplete());
+    file.Append(piece_size);
+    ErrorMessageOr<std::vector<ClientCaptureEvent>> new_events_or_error = follower->ReadNewEvents();
+    ASSERT_THAT(new_events_or_error, HasNoError());
+    for (ClientCaptureEvent& event : new_events_or_error.value()) {
+      events.push_back(std::move(event));
+    }
+  }
+
+  ASSERT_EQ(events.size(), kNumInternedStrings + 1);
+  for (uint64_t key = 0; key < kNumInternedStrings; ++key) {
+    ASSERT_EQ(events[key].event_case(), ClientCaptureEvent::kInternedString);
+    EXPECT_EQ(events[key].interned_string().key(), key);
+  }
+  EXPECT_EQ(events.back().event_case(), ClientCaptureEvent::kCaptureFinished);
+
+  ErrorMessageOr<std::vector<ClientCaptureEvent>> events_after_finished_or_error =
+      follower->ReadNewEvents();
+  ASSERT_THAT(events_after_finished_or_error, HasNoError());
+  EXPECT_TRUE(events_after_finished_or_error.value().empty());
+}
+
+}  // namespace
+
+TEST(CaptureFileFollower, FollowsGrowingFile) {
+  // Pieces smaller than an event, so that the follower sees incomplete events.
+  FollowGrowingFile(CaptureSectionCompression::kNone, /*piece_size=*/3);
+  FollowGrowingFile(CaptureSectionCompression::kNone, /*piece_size=*/1000);
+}
+
+TEST(CaptureFileFollower, FollowsGrowingCompressedFile) {
+  FollowGrowingFile(CaptureSectionCompression::kCompressedBlocks, /*piece_size=*/100);
+}
+
+TEST(CaptureFileFollower, ReturnsNoEventsUntilTheyAreComplete) {
+  GrowingFile file{
+      CreateCaptureFileContent(CaptureSectionCompression::kNone, /*write_capture_finished=*/true)};
+  auto follower_or_error = CaptureFileFollower::Open(file.GetFilePath());
+  ASSERT_THAT(follower_or_error, HasNoError());
+  std::unique_ptr<CaptureFileFollower> follower = std::move(follower_or_error.value());
+
+  ErrorMessageOr<std::vector<ClientCaptureEvent>> events_or_error = follower->ReadNewEvents();
+  ASSERT_THAT(events_or_error, HasNoError());
+  EXPECT_TRUE(events_or_error.value().empty());
+
+  // The size of the first event and part of it.
+  file.Append(2);
+  events_or_error = follower->ReadNewEvents();
+  ASSERT_THAT(events_or_error, HasNoError());
+  EXPECT_TRUE(events_or_error.value().empty());
+  EXPECT_FALSE(follower->IsCaptureFinished());
+}
+
+TEST(CaptureFileFollower, FinishedFileWithoutCaptureFinished) {
+  // A compressed capture section is always followed by its block table, so the follower knows when
+  // the file is finished.
+  GrowingFile file{CreateCaptureFileContent(CaptureSectionCompression::kCompressedBlocks,
+                                            /*write_capture_finished=*/false)};
+  auto follower_or_error = CaptureFileFollower::Open(file.GetFilePath());
+  ASSERT_THAT(follower_or_error, HasNoError());
+  std::unique_ptr<CaptureFileFollower> follower = std::move(follower_or_error.value());
+
+  file.Append(std::numeric_limits<size_t>::max());
+  ASSERT_TRUE(file.IsComplete());
+  ErrorMessageOr<std::vector<ClientCaptureEvent>> events_or_error = follower->ReadNewEvents();
+  ASSERT_THAT(events_or_error, HasNoError());
+  EXPECT_EQ(events_or_error.value().size(), kNumInternedStrings);
+
+  EXPECT_THAT(follower->ReadNewEvents(), HasError("without a CaptureFinished event"));
+}
+
+TEST(CaptureFileFollower, OpenFileWithInvalidSignature) {
+  orbit_base::TemporaryFile temporary_file = CreateTemporaryFile();
+  auto fd_or_error = orbit_base::OpenNewFileForWriting(temporary_file.file_path());
+  ASSERT_THAT(fd_or_error, HasNoError());
+  ASSERT_THAT(orbit_base::WriteFully(fd_or_error.value(), std::string(kHeaderSize, 'x')),
+              HasNoError());
+
+  EXPECT_THAT(CaptureFileFollower::Open(temporary_file.file_path()),
+              HasError("Invalid file signature"));
+}
+
+}  // namespace orbit_capture_file
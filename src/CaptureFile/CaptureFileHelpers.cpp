@@ -39,4 +39,30 @@ ErrorMessageOr<void> WriteUserData(
   return outcome::success();
 }
 
+ErrorMessageOr<std::optional<orbit_client_protos::CaptureSectionIndex>> ReadCaptureSectionIndex(
+    CaptureFile& capture_file) {
+  std::optional<uint64_t> section_index =
+      capture_file.FindSectionByType(kSectionTypeCaptureSectionIndex);
+  if (!section_index.has_value()) return std::nullopt;
+
+  std::unique_ptr<ProtoSectionInputStream> input_stream =
+      capture_file.CreateProtoSectionInputStream(section_index.value());
+  orbit_client_protos::CaptureSectionIndex capture_section_index;
+  OUTCOME_TRY(input_stream->ReadMessage(&capture_section_index));
+  return capture_section_index;
+}
+
+ErrorMessageOr<std::optional<orbit_client_protos::CaptureSummary>> ReadCaptureSummary(
+    CaptureFile& capture_file) {
+  std::optional<uint64_t> section_index =
+      capture_file.FindSectionByType(kSectionTypeCaptureSummary);
+  if (!section_index.has_value()) return std::nullopt;
+
+  std::unique_ptr<ProtoSectionInputStream> input_stream =
+      capture_file.CreateProtoSectionInputStream(section_index.value());
+  orbit_client_protos::CaptureSummary capture_summary;
+  OUTCOME_TRY(input_stream->ReadMessage(&capture_summary));
+  return capture_summary;
+}
+
 }  // namespace orbit_capture_file
\ No newline at end of file
@@ -105,4 +105,185 @@ TEST(CaptureFileHelpers, CreateCaptureFileAndWriteUserData) {
   }
 }
 
+static ClientCaptureEvent CreateSchedulingSliceCaptureEvent(int32_t tid,
+                                                             uint64_t out_timestamp_ns) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+  scheduling_slice->set_tid(tid);
+  scheduling_slice->set_out_timestamp_ns(out_timestamp_ns);
+  scheduling_slice->set_duration_ns(1'000);
+  return event;
+}
+
+TEST(CaptureFileHelpers, ReadCaptureSectionIndexAndSeekToEntry) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(file_path);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  // The scheduling slices are too far apart to be in the same entry of the index.
+  constexpr uint64_t kTimestampDistanceNs = 1'000'000'000;
+  ASSERT_THAT(
+      output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString)),
+      HasNoError());
+  ASSERT_THAT(output_stream->WriteCaptureEvent(
+                  CreateSchedulingSliceCaptureEvent(1, kTimestampDistanceNs)),
+              HasNoError());
+  ASSERT_THAT(output_stream->WriteCaptureEvent(
+                  CreateSchedulingSliceCaptureEvent(2, 2 * kTimestampDistanceNs)),
+              HasNoError());
+  ASSERT_THAT(output_stream->WriteCaptureEvent(
+                  CreateSchedulingSliceCaptureEvent(1, 3 * kTimestampDistanceNs)),
+              HasNoError());
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+
+  // Adding the user data section must preserve the index section.
+  {
+    orbit_client_protos::UserDefinedCaptureInfo user_defined_capture_info;
+    user_defined_capture_info.mutable_frame_tracks_info()->add_frame_track_function_ids(1);
+    ASSERT_THAT(WriteUserData(file_path, user_defined_capture_info), HasNoError());
+  }
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  EXPECT_EQ(capture_file->GetSectionList().size(), 2);
+
+  auto index_or_error = ReadCaptureSectionIndex(*capture_file);
+  ASSERT_THAT(index_or_error, HasNoError());
+  ASSERT_TRUE(index_or_error.value().has_value());
+  const orbit_client_protos::CaptureSectionIndex& index = index_or_error.value().value();
+
+  ASSERT_EQ(index.entries_size(), 3);
+  EXPECT_EQ(index.entries(0).offset(), 0);
+  EXPECT_EQ(index.entries(0).first_event_index(), 0);
+  EXPECT_EQ(index.entries(0).event_count(), 2);
+  EXPECT_TRUE(index.entries(0).has_untimed_events());
+  EXPECT_EQ(index.entries(0).min_timestamp_ns(), kTimestampDistanceNs - 1'000);
+  EXPECT_EQ(index.entries(0).max_timestamp_ns(), kTimestampDistanceNs);
+  EXPECT_EQ(index.entries(2).first_event_index(), 3);
+  EXPECT_EQ(index.entries(2).event_count(), 1);
+  EXPECT_FALSE(index.entries(2).has_untimed_events());
+  EXPECT_EQ(index.entries(2).max_timestamp_ns(), 3 * kTimestampDistanceNs);
+
+  ASSERT_EQ(index.thread_entries_size(), 2);
+  EXPECT_EQ(index.thread_entries(0).tid(), 1);
+  EXPECT_THAT(index.thread_entries(0).entry_indices(), testing::ElementsAre(0, 2));
+  EXPECT_EQ(index.thread_entries(1).tid(), 2);
+  EXPECT_THAT(index.thread_entries(1).entry_indices(), testing::ElementsAre(1));
+
+  auto capture_section = capture_file->CreateCaptureSectionInputStreamAtOffset(
+      index.entries(1).offset());
+  ClientCaptureEvent event;
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kSchedulingSlice);
+  EXPECT_EQ(event.scheduling_slice().tid(), 2);
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kSchedulingSlice);
+  EXPECT_EQ(event.scheduling_slice().tid(), 1);
+}
+
+TEST(CaptureFileHelpers, ReadCaptureSectionIndexWithoutTimedEvents) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(file_path);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+  ASSERT_THAT(
+      output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString)),
+      HasNoError());
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  auto index_or_error = ReadCaptureSectionIndex(*capture_file_or_error.value());
+  ASSERT_THAT(index_or_error, HasNoError());
+  EXPECT_FALSE(index_or_error.value().has_value());
+}
+
+TEST(CaptureFileHelpers, ReadCaptureSummary) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(file_path);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+  ASSERT_THAT(
+      output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString)),
+      HasNoError());
+  {
+    ClientCaptureEvent event;
+    event.mutable_function_call()->set_function_id(1);
+    event.mutable_function_call()->set_duration_ns(100);
+    ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  {
+    ClientCaptureEvent event;
+    event.mutable_callstack_sample()->set_tid(2);
+    event.mutable_callstack_sample()->set_callstack_id(3);
+    ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+
+  // Adding the user data section must preserve the summary section.
+  ASSERT_THAT(WriteUserData(file_path, orbit_client_protos::UserDefinedCaptureInfo{}),
+              HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  auto summary_or_error = ReadCaptureSummary(*capture_file_or_error.value());
+  ASSERT_THAT(summary_or_error, HasNoError());
+  ASSERT_TRUE(summary_or_error.value().has_value());
+  const orbit_client_protos::CaptureSummary& summary = summary_or_error.value().value();
+
+  ASSERT_EQ(summary.function_stats().size(), 1);
+  EXPECT_EQ(summary.function_stats().at(1).count(), 1);
+  EXPECT_EQ(summary.function_stats().at(1).total_time_ns(), 100);
+  ASSERT_EQ(summary.thread_callstack_counts_size(), 1);
+  EXPECT_EQ(summary.thread_callstack_counts(0).tid(), 2);
+  EXPECT_EQ(summary.thread_callstack_counts(0).callstack_id_to_count().at(3), 1);
+  ASSERT_EQ(summary.strings().size(), 1);
+  EXPECT_EQ(summary.strings().at(kAnswerKey), kAnswerString);
+}
+
+TEST(CaptureFileHelpers, ReadCaptureSummaryWithoutFunctionCallsNorSamples) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(file_path);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  ASSERT_THAT(output_stream_or_error.value()->WriteCaptureEvent(
+                  CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString)),
+              HasNoError());
+  ASSERT_THAT(output_stream_or_error.value()->Close(), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  auto summary_or_error = ReadCaptureSummary(*capture_file_or_error.value());
+  ASSERT_THAT(summary_or_error, HasNoError());
+  EXPECT_FALSE(summary_or_error.value().has_value());
+}
+
 }  // namespace orbit_capture_file
\ No newline at end of file
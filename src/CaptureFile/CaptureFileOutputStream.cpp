@@ -8,21 +8,78 @@
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <array>
+#include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
+#include "AsyncFileWriter.h"
+#include "BlockCompression.h"
+#include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFileConstants.h"
+#include "CaptureSectionIndexBuilder.h"
+#include "CaptureSummaryBuilder.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
 #include "OrbitBase/SafeStrerror.h"
+#include "capture_section_block_table.pb.h"
 
 namespace orbit_capture_file {
 
 namespace {
 
+using orbit_capture_file_internal::AsyncFileWriter;
+using orbit_capture_file_internal::CaptureSectionIndexBuilder;
+using orbit_capture_file_internal::CaptureSummaryBuilder;
+using orbit_capture_file_internal::CompressBlock;
+using orbit_client_protos::CaptureSectionBlockTable;
+
+// An entry of the capture section index is started every this many nanoseconds of events, or every
+// this many events, whichever comes first.
+constexpr uint64_t kCaptureSectionIndexMaxEntryDurationNs = 10'000'000;
+constexpr uint64_t kCaptureSectionIndexMaxEventsPerEntry = 10'000;
+
+// With CaptureSectionCompression::kCompressedBlocks, a block is compressed as soon as it contains
+// at least this many bytes of events.
+constexpr size_t kCompressedBlockMinUncompressedSize = 4 * 1024 * 1024;
+
+// With CaptureFileWriteMode::kAsynchronous, uncompressed events are handed to the writer thread in
+// buffers of at least this many bytes, and the caller blocks when this many bytes are waiting to be
+// written.
+constexpr size_t kAsyncWriteMinBufferSize = 1024 * 1024;
+constexpr size_t kAsyncWriteMaxPendingBytes = 64 * 1024 * 1024;
+
+// The buffered events of the capture section are written to the file at least this often, so that
+// a capture file truncated by a crash of the writer still contains most of the capture. As checking
+// the time has a cost, this is only done every kCheckpointEventInterval events.
+constexpr uint64_t kCheckpointIntervalNs = 1'000'000'000;
+constexpr uint64_t kCheckpointEventInterval = 1024;
+
+// Appends `event`, preceded by its size as a varint, to `output`.
+[[nodiscard]] bool AppendEventWithSize(const orbit_grpc_protos::ClientCaptureEvent& event,
+                                       size_t message_size, std::string* output) {
+  // Maximum size of a varint encoded uint32_t.
+  constexpr size_t kMaxVarint32Size = 5;
+  std::array<uint8_t, kMaxVarint32Size> message_size_bytes{};
+  const uint8_t* message_size_end = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      message_size, message_size_bytes.data());
+  output->append(absl::bit_cast<const char*>(message_size_bytes.data()),
+                 message_size_end - message_size_bytes.data());
+  return event.AppendToString(output);
+}
+
 class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  public:
-  explicit CaptureFileOutputStreamImpl(std::filesystem::path path) : path_{std::move(path)} {}
+  explicit CaptureFileOutputStreamImpl(std::filesystem::path path,
+                                       CaptureSectionCompression compression,
+                                       CaptureFileWriteMode write_mode)
+      : path_{std::move(path)},
+        compression_{compression},
+        write_mode_{write_mode},
+        capture_section_index_builder_{kCaptureSectionIndexMaxEntryDurationNs,
+                                       kCaptureSectionIndexMaxEventsPerEntry} {}
   ~CaptureFileOutputStreamImpl() noexcept override;
 
   [[nodiscard]] ErrorMessageOr<void> Initialize();
@@ -34,6 +91,24 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  private:
   void Reset() noexcept;
   [[nodiscard]] ErrorMessageOr<void> WriteHeader();
+  // Compresses and writes the events that were buffered for the current block.
+  [[nodiscard]] ErrorMessageOr<void> WriteCompressedBlock();
+  // Hands `buffer` to async_writer_, to be written at the end of the capture section.
+  [[nodiscard]] ErrorMessageOr<void> WriteAsync(std::string buffer);
+  // Writes the buffered uncompressed events and waits for async_writer_ to write everything, then
+  // stops it, so that the additional sections can be written with coded_output_.
+  [[nodiscard]] ErrorMessageOr<void> FinishAsyncWrites();
+  // Writes the events buffered so far to the file if kCheckpointIntervalNs have passed since the
+  // last time. Only whole events (or blocks) are written, which is what recovery relies on.
+  [[nodiscard]] ErrorMessageOr<void> WriteCheckpointIfNeeded();
+  // Writes the CAPTURE_SECTION_INDEX, CAPTURE_SECTION_BLOCK_TABLE and CAPTURE_SUMMARY sections, as
+  // needed, and the section list after the capture section, and updates the header.
+  [[nodiscard]] ErrorMessageOr<void> WriteAdditionalSections();
+  [[nodiscard]] ErrorMessageOr<void> WriteProtoSection(const google::protobuf::Message& message,
+                                                       uint64_t section_type,
+                                                       const char* section_name,
+                                                       std::vector<CaptureFileSection>* sections);
+  void WritePaddingToAlignment();
   // Handles write error by cleaning up the file and generating error message.
   [[nodiscard]] ErrorMessage HandleWriteError(const char* section_name,
                                               std::string_view original_error);
@@ -41,10 +116,32 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
   void CloseAndTryRemoveFileAfterError();
 
   std::filesystem::path path_;
+  CaptureSectionCompression compression_;
+  CaptureFileWriteMode write_mode_;
   orbit_base::unique_fd fd_;
 
   std::optional<google::protobuf::io::FileOutputStream> file_output_stream_;
   std::optional<google::protobuf::io::CodedOutputStream> coded_output_;
+  uint64_t capture_section_offset_ = 0;
+  // The offset in the file of the next byte written to coded_output_. We can't rely on
+  // CodedOutputStream::ByteCount, which is an int.
+  uint64_t position_ = 0;
+  // The size of the capture section written so far, before compression.
+  uint64_t uncompressed_capture_section_size_ = 0;
+  CaptureSectionIndexBuilder capture_section_index_builder_;
+  CaptureSummaryBuilder capture_summary_builder_;
+
+  // Only used with CaptureSectionCompression::kCompressedBlocks.
+  std::string current_block_;
+  CaptureSectionBlockTable block_table_;
+
+  // Only used with CaptureFileWriteMode::kAsynchronous, while writing the capture section.
+  std::unique_ptr<AsyncFileWriter> async_writer_;
+  // The uncompressed events not handed to async_writer_ yet.
+  std::string async_buffer_;
+
+  uint64_t events_since_checkpoint_check_ = 0;
+  uint64_t last_checkpoint_timestamp_ns_ = 0;
 };
 
 CaptureFileOutputStreamImpl::~CaptureFileOutputStreamImpl() noexcept {
@@ -64,11 +161,26 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
   if (auto result = WriteHeader(); result.has_error()) {
     return result.error();
   }
+  last_checkpoint_timestamp_ns_ = orbit_base::CaptureTimestampNs();
 
   return outcome::success();
 }
 
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() noexcept {
+  if (!current_block_.empty()) {
+    OUTCOME_TRY(WriteCompressedBlock());
+  }
+  if (async_writer_ != nullptr) {
+    OUTCOME_TRY(FinishAsyncWrites());
+  }
+
+  // Without events with a timestamp the index would be of no use, while a compressed capture
+  // section can't be read without its block table.
+  if (capture_section_index_builder_.HasTimedEvents() || !capture_summary_builder_.IsEmpty() ||
+      compression_ == CaptureSectionCompression::kCompressedBlocks) {
+    OUTCOME_TRY(WriteAdditionalSections());
+  }
+
   coded_output_->Trim();
   if (coded_output_->HadError()) {
     return HandleWriteError("Unknown", SafeStrerror(file_output_stream_->GetErrno()));
@@ -79,6 +191,12 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() noexcept {
 }
 
 void CaptureFileOutputStreamImpl::Reset() noexcept {
+  // The writer thread uses fd_, and finishes the pending writes before it stops.
+  if (async_writer_ != nullptr && !async_buffer_.empty()) {
+    (void)async_writer_->Write(std::move(async_buffer_));
+  }
+  async_writer_.reset();
+  async_buffer_.clear();
   coded_output_.reset();
   file_output_stream_.reset();
   fd_.release();
@@ -104,8 +222,38 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteCaptureEvent(
     const orbit_grpc_protos::ClientCaptureEvent& event) {
   CHECK(coded_output_.has_value());
   CHECK(file_output_stream_.has_value());
+  OUTCOME_TRY(WriteCheckpointIfNeeded());
+  capture_section_index_builder_.AddEvent(event, uncompressed_capture_section_size_);
+  capture_summary_builder_.AddEvent(event);
   size_t message_size = event.ByteSizeLong();
+  const size_t size_with_message_size =
+      google::protobuf::io::CodedOutputStream::VarintSize32(message_size) + message_size;
+  uncompressed_capture_section_size_ += size_with_message_size;
+
+  if (compression_ == CaptureSectionCompression::kCompressedBlocks) {
+    if (!AppendEventWithSize(event, message_size, &current_block_)) {
+      return HandleWriteError("Capture", "Unable to serialize event");
+    }
+    if (current_block_.size() >= kCompressedBlockMinUncompressedSize) {
+      OUTCOME_TRY(WriteCompressedBlock());
+    }
+    return outcome::success();
+  }
+
+  if (async_writer_ != nullptr) {
+    if (!AppendEventWithSize(event, message_size, &async_buffer_)) {
+      return HandleWriteError("Capture", "Unable to serialize event");
+    }
+    position_ += size_with_message_size;
+    if (async_buffer_.size() >= kAsyncWriteMinBufferSize) {
+      OUTCOME_TRY(WriteAsync(std::move(async_buffer_)));
+      async_buffer_.clear();
+    }
+    return outcome::success();
+  }
+
   coded_output_->WriteVarint32(message_size);
+  position_ += size_with_message_size;
   if (!event.SerializeToCodedStream(&coded_output_.value())) {
     return HandleWriteError("Capture", SafeStrerror(file_output_stream_->GetErrno()));
   }
@@ -121,12 +269,15 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   CHECK(fd_.valid());
 
   std::string header{kFileSignature};
-  header.append(std::string_view(absl::bit_cast<char*>(&kFileVersion), sizeof(kFileVersion)));
+  const uint32_t version = compression_ == CaptureSectionCompression::kCompressedBlocks
+                               ? kFileVersionWithCompressedCaptureSection
+                               : kFileVersion;
+  header.append(std::string_view(absl::bit_cast<const char*>(&version), sizeof(version)));
   // signature - 4bytes, version - 4bytes
   // capture section offset - 8 bytes
   // additional section offset - 8 bytes
   uint64_t capture_section_offset =
-      kFileSignature.size() + sizeof(kFileVersion) + 2 * sizeof(uint64_t);
+      kFileSignature.size() + sizeof(version) + 2 * sizeof(uint64_t);
   header.append(std::string_view(absl::bit_cast<char*>(&capture_section_offset),
                                  sizeof(capture_section_offset)));
   uint64_t additional_section_list_offset =
@@ -135,6 +286,8 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
                                  sizeof(additional_section_list_offset)));
 
   CHECK(capture_section_offset == header.size());
+  capture_section_offset_ = capture_section_offset;
+  position_ = capture_section_offset;
 
   auto write_result = orbit_base::WriteFully(fd_, header);
   if (write_result.has_error()) {
@@ -145,14 +298,168 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   file_output_stream_.emplace(fd_.get());
   coded_output_.emplace(&file_output_stream_.value());
 
+  // Nothing is buffered in coded_output_ yet, so the writer thread starts writing right after the
+  // header.
+  if (write_mode_ == CaptureFileWriteMode::kAsynchronous) {
+    async_writer_ = std::make_unique<AsyncFileWriter>(fd_, kAsyncWriteMaxPendingBytes);
+  }
+
+  return outcome::success();
+}
+
+void CaptureFileOutputStreamImpl::WritePaddingToAlignment() {
+  // Sections start at offsets aligned to 8 bytes.
+  constexpr uint64_t kAlignment = 8;
+  static constexpr std::array<char, kAlignment> kPadding{};
+  const uint64_t padding_size = (kAlignment - position_ % kAlignment) % kAlignment;
+  coded_output_->WriteRaw(kPadding.data(), static_cast<int>(padding_size));
+  position_ += padding_size;
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteCompressedBlock() {
+  ErrorMessageOr<std::string> compressed_block_or_error = CompressBlock(current_block_);
+  if (compressed_block_or_error.has_error()) {
+    return HandleWriteError("Capture", compressed_block_or_error.error().message());
+  }
+  std::string& compressed_block = compressed_block_or_error.value();
+
+  CaptureSectionBlockTable::Block* block = block_table_.add_blocks();
+  block->set_offset(position_ - capture_section_offset_);
+  block->set_compressed_size(compressed_block.size());
+  block->set_uncompressed_size(current_block_.size());
+
+  position_ += compressed_block.size();
+  current_block_.clear();
+  if (async_writer_ != nullptr) {
+    return WriteAsync(std::move(compressed_block));
+  }
+
+  coded_output_->WriteRaw(compressed_block.data(), static_cast<int>(compressed_block.size()));
+  if (coded_output_->HadError()) {
+    return HandleWriteError("Capture", SafeStrerror(file_output_stream_->GetErrno()));
+  }
+
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteAsync(std::string buffer) {
+  CHECK(async_writer_ != nullptr);
+  ErrorMessageOr<void> write_result = async_writer_->Write(std::move(buffer));
+  if (write_result.has_error()) {
+    return HandleWriteError("Capture", write_result.error().message());
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::FinishAsyncWrites() {
+  CHECK(async_writer_ != nullptr);
+  if (!async_buffer_.empty()) {
+    OUTCOME_TRY(WriteAsync(std::move(async_buffer_)));
+    async_buffer_.clear();
+  }
+  ErrorMessageOr<void> wait_result = async_writer_->WaitForPendingWrites();
+  if (wait_result.has_error()) {
+    return HandleWriteError("Capture", wait_result.error().message());
+  }
+  async_writer_.reset();
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteCheckpointIfNeeded() {
+  if (++events_since_checkpoint_check_ < kCheckpointEventInterval) return outcome::success();
+  events_since_checkpoint_check_ = 0;
+  const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  if (timestamp_ns - last_checkpoint_timestamp_ns_ < kCheckpointIntervalNs) {
+    return outcome::success();
+  }
+  last_checkpoint_timestamp_ns_ = timestamp_ns;
+
+  if (compression_ == CaptureSectionCompression::kCompressedBlocks && !current_block_.empty()) {
+    OUTCOME_TRY(WriteCompressedBlock());
+  }
+  if (async_writer_ != nullptr) {
+    if (!async_buffer_.empty()) {
+      OUTCOME_TRY(WriteAsync(std::move(async_buffer_)));
+      async_buffer_.clear();
+    }
+    return outcome::success();
+  }
+
+  coded_output_->Trim();
+  if (coded_output_->HadError() || !file_output_stream_->Flush()) {
+    return HandleWriteError("Capture", SafeStrerror(file_output_stream_->GetErrno()));
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteProtoSection(
+    const google::protobuf::Message& message, uint64_t section_type, const char* section_name,
+    std::vector<CaptureFileSection>* sections) {
+  WritePaddingToAlignment();
+  const uint64_t section_offset = position_;
+  const size_t message_size = message.ByteSizeLong();
+  coded_output_->WriteVarint32(message_size);
+  if (!message.SerializeToCodedStream(&coded_output_.value())) {
+    return HandleWriteError(section_name, SafeStrerror(file_output_stream_->GetErrno()));
+  }
+  const uint64_t section_size =
+      google::protobuf::io::CodedOutputStream::VarintSize32(message_size) + message_size;
+  position_ += section_size;
+
+  sections->push_back(CaptureFileSection{/*.type = */ section_type,
+                                         /*.offset = */ section_offset,
+                                         /*.size = */ section_size});
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteAdditionalSections() {
+  std::vector<CaptureFileSection> sections;
+  if (capture_section_index_builder_.HasTimedEvents()) {
+    OUTCOME_TRY(WriteProtoSection(capture_section_index_builder_.Build(),
+                                  kSectionTypeCaptureSectionIndex, "CaptureSectionIndex",
+                                  &sections));
+  }
+  if (!capture_summary_builder_.IsEmpty()) {
+    OUTCOME_TRY(WriteProtoSection(capture_summary_builder_.Build(), kSectionTypeCaptureSummary,
+                                  "CaptureSummary", &sections));
+  }
+  if (compression_ == CaptureSectionCompression::kCompressedBlocks) {
+    OUTCOME_TRY(WriteProtoSection(block_table_, kSectionTypeCaptureSectionBlockTable,
+                                  "CaptureSectionBlockTable", &sections));
+  }
+
+  WritePaddingToAlignment();
+  const uint64_t section_list_offset = position_;
+  const uint64_t number_of_sections = sections.size();
+  coded_output_->WriteRaw(&number_of_sections, sizeof(number_of_sections));
+  coded_output_->WriteRaw(sections.data(),
+                          static_cast<int>(sections.size() * sizeof(CaptureFileSection)));
+  position_ += sizeof(number_of_sections) + sections.size() * sizeof(CaptureFileSection);
+
+  // Flush everything before updating the header.
+  coded_output_->Trim();
+  if (coded_output_->HadError() || !file_output_stream_->Flush()) {
+    return HandleWriteError("Section List", SafeStrerror(file_output_stream_->GetErrno()));
+  }
+
+  // The section list offset is the last field of the header.
+  const uint64_t section_list_offset_field_offset = capture_section_offset_ - sizeof(uint64_t);
+  auto write_result = orbit_base::WriteFullyAtOffset(
+      fd_, &section_list_offset, sizeof(section_list_offset), section_list_offset_field_offset);
+  if (write_result.has_error()) {
+    return HandleWriteError("Header", write_result.error().message());
+  }
+
   return outcome::success();
 }
 
 }  // namespace
 
 ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> CaptureFileOutputStream::Create(
-    std::filesystem::path path) {
-  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(std::move(path));
+    std::filesystem::path path, CaptureSectionCompression compression,
+    CaptureFileWriteMode write_mode) {
+  auto implementation =
+      std::make_unique<CaptureFileOutputStreamImpl>(std::move(path), compression, write_mode);
   auto init_result = implementation->Initialize();
   if (init_result.has_error()) {
     return init_result.error();
@@ -8,9 +8,13 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <filesystem>
+#include <string_view>
+
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFileConstants.h"
+#include "OrbitBase/File.h"
 #include "OrbitBase/TemporaryFile.h"
 #include "OrbitBase/TestUtils.h"
 
@@ -149,6 +153,102 @@ TEST(CaptureFile, CreateCaptureFileWriteAdditionalSectionAndReadMainSection) {
   }
 }
 
+TEST(CaptureFile, CreateCompressedCaptureFileAndReadMainSection) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(
+      temporary_file.file_path(), CaptureSectionCompression::kCompressedBlocks);
+  ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  // Enough events for more than one compressed block.
+  constexpr uint64_t kEventCount = 100'000;
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    auto write_result =
+        output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(key, kAnswerString));
+    ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+  }
+  auto close_result = output_stream->Close();
+  ASSERT_FALSE(close_result.has_error()) << close_result.error().message();
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  ASSERT_EQ(capture_file->GetSectionList().size(), 1);
+  EXPECT_EQ(capture_file->GetSectionList()[0].type, kSectionTypeCaptureSectionBlockTable);
+
+  const uintmax_t file_size = std::filesystem::file_size(temporary_file.file_path());
+  EXPECT_LT(file_size, kEventCount * std::string_view{kAnswerString}.size() / 10);
+
+  auto capture_section = capture_file->CreateCaptureSectionInputStream();
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    ClientCaptureEvent event;
+    ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+    ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+    ASSERT_EQ(event.interned_string().key(), key);
+    ASSERT_EQ(event.interned_string().intern(), kAnswerString);
+  }
+
+  // A user data section can be added to a compressed capture file as well.
+  auto section_number_or_error = capture_file->AddUserDataSection(333);
+  ASSERT_TRUE(section_number_or_error.has_value()) << section_number_or_error.error().message();
+  capture_file.reset();
+
+  capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  capture_file = std::move(capture_file_or_error.value());
+  ASSERT_EQ(capture_file->GetSectionList().size(), 2);
+
+  capture_section = capture_file->CreateCaptureSectionInputStream();
+  ClientCaptureEvent event;
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+  EXPECT_EQ(event.interned_string().key(), 0);
+}
+
+TEST(CaptureFile, CreateCaptureFileAsynchronouslyAndReadMainSection) {
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kNone, CaptureSectionCompression::kCompressedBlocks}) {
+    auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+    ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+    orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+    temporary_file.CloseAndRemove();
+
+    auto output_stream_or_error = CaptureFileOutputStream::Create(
+        temporary_file.file_path(), compression, CaptureFileWriteMode::kAsynchronous);
+    ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+    std::unique_ptr<CaptureFileOutputStream> output_stream =
+        std::move(output_stream_or_error.value());
+
+    // Enough events for more than one buffer handed to the writer thread.
+    constexpr uint64_t kEventCount = 100'000;
+    for (uint64_t key = 0; key < kEventCount; ++key) {
+      auto write_result =
+          output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(key, kAnswerString));
+      ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+    }
+    auto close_result = output_stream->Close();
+    ASSERT_FALSE(close_result.has_error()) << close_result.error().message();
+
+    auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+    ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+    std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+    auto capture_section = capture_file->CreateCaptureSectionInputStream();
+    for (uint64_t key = 0; key < kEventCount; ++key) {
+      ClientCaptureEvent event;
+      ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+      ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+      ASSERT_EQ(event.interned_string().key(), key);
+      ASSERT_EQ(event.interned_string().intern(), kAnswerString);
+    }
+  }
+}
+
 TEST(CaptureFile, CreateCaptureFileAndAddSection) {
   auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
   ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
@@ -256,6 +356,107 @@ TEST(CaptureFile, CreateCaptureFileAndAddSection) {
   }
 }
 
+TEST(CaptureFile, OpenTruncatedCaptureFile) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(temporary_file.file_path());
+  ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+  auto write_result =
+      output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString));
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+  write_result = output_stream->WriteCaptureEvent(
+      CreateInternedStringCaptureEvent(kNotAnAnswerKey, kNotAnAnswerString));
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+  auto close_result = output_stream->Close();
+  ASSERT_FALSE(close_result.has_error()) << close_result.error().message();
+
+  // Cut the second event in the middle.
+  const uintmax_t file_size = std::filesystem::file_size(temporary_file.file_path());
+  ASSERT_THAT(orbit_base::ResizeFile(temporary_file.file_path(), file_size - 3), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+  auto capture_section = capture_file->CreateCaptureSectionInputStream();
+  ClientCaptureEvent event;
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+  EXPECT_EQ(event.interned_string().key(), kAnswerKey);
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kCaptureFinished);
+  EXPECT_EQ(event.capture_finished().status(), orbit_grpc_protos::CaptureFinished::kFailed);
+}
+
+TEST(CaptureFile, OpenTruncatedCompressedCaptureFile) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error = CaptureFileOutputStream::Create(
+      temporary_file.file_path(), CaptureSectionCompression::kCompressedBlocks);
+  ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+  // Enough events for more than one compressed block.
+  constexpr uint64_t kEventCount = 100'000;
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    auto write_result =
+        output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(key, kAnswerString));
+    ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+  }
+  auto close_result = output_stream->Close();
+  ASSERT_FALSE(close_result.has_error()) << close_result.error().message();
+
+  // Make the file look like its writer stopped in the middle of the last block: without section
+  // list, and so without block table.
+  {
+    auto fd_or_error = orbit_base::OpenExistingFileForReadWrite(temporary_file.file_path());
+    ASSERT_THAT(fd_or_error, HasNoError());
+    constexpr uint64_t kNoSectionList = 0;
+    constexpr uint64_t kSectionListOffsetFieldOffset = 16;
+    ASSERT_THAT(orbit_base::WriteFullyAtOffset(fd_or_error.value(), &kNoSectionList,
+                                               sizeof(kNoSectionList),
+                                               kSectionListOffsetFieldOffset),
+                HasNoError());
+  }
+  const uintmax_t file_size = std::filesystem::file_size(temporary_file.file_path());
+  ASSERT_THAT(orbit_base::ResizeFile(temporary_file.file_path(), file_size * 3 / 4), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  ASSERT_EQ(capture_file->GetSectionList().size(), 1);
+  EXPECT_EQ(capture_file->GetSectionList()[0].type, kSectionTypeCaptureSectionBlockTable);
+
+  auto capture_section = capture_file->CreateCaptureSectionInputStream();
+  uint64_t key = 0;
+  ClientCaptureEvent event;
+  while (true) {
+    ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+    if (event.event_case() != ClientCaptureEvent::kInternedString) break;
+    ASSERT_EQ(event.interned_string().key(), key);
+    ++key;
+  }
+  EXPECT_GT(key, 0);
+  EXPECT_LT(key, kEventCount);
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kCaptureFinished);
+  EXPECT_EQ(event.capture_finished().status(), orbit_grpc_protos::CaptureFinished::kFailed);
+
+  // The recovered file can be opened again without changes.
+  const uintmax_t recovered_file_size = std::filesystem::file_size(temporary_file.file_path());
+  capture_file.reset();
+  capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  EXPECT_EQ(std::filesystem::file_size(temporary_file.file_path()), recovered_file_size);
+}
+
 TEST(CaptureFile, OpenCaptureFileInvalidSignature) {
   auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
   ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
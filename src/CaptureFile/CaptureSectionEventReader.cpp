@@ -0,0 +1,94 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureFile/CaptureSectionEventReader.h"
+
+#include <utility>
+
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_capture_file {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr size_t kEventsPerBatch = 1024;
+// Bounds the memory used by the events read ahead.
+constexpr size_t kMaxQueuedBatches = 64;
+
+}  // namespace
+
+CaptureSectionEventReader::CaptureSectionEventReader(
+    std::unique_ptr<ProtoSectionInputStream> input_stream)
+    : input_stream_{std::move(input_stream)} {
+  reader_thread_ = std::thread{[this] { ReaderThread(); }};
+}
+
+CaptureSectionEventReader::~CaptureSectionEventReader() {
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  reader_thread_.join();
+}
+
+void CaptureSectionEventReader::ReaderThread() {
+  orbit_base::SetCurrentThreadName("CaptureReader");
+
+  bool capture_finished = false;
+  while (!capture_finished) {
+    std::vector<ClientCaptureEvent> batch;
+    batch.reserve(kEventsPerBatch);
+    std::optional<ErrorMessage> error;
+    while (batch.size() < kEventsPerBatch) {
+      ClientCaptureEvent& event = batch.emplace_back();
+      ErrorMessageOr<void> result = input_stream_->ReadMessage(&event);
+      if (result.has_error()) {
+        batch.pop_back();
+        error = result.error();
+        break;
+      }
+      if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+        capture_finished = true;
+        break;
+      }
+    }
+
+    absl::MutexLock lock{&mutex_};
+    auto has_room_or_stop_requested = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return stop_requested_ || batches_.size() < kMaxQueuedBatches;
+    };
+    mutex_.Await(absl::Condition(&has_room_or_stop_requested));
+    if (stop_requested_) return;
+
+    if (!batch.empty()) batches_.push_back(std::move(batch));
+    if (error.has_value()) {
+      error_ = std::move(error);
+      reading_finished_ = true;
+      return;
+    }
+  }
+
+  absl::MutexLock lock{&mutex_};
+  reading_finished_ = true;
+}
+
+ErrorMessageOr<std::vector<ClientCaptureEvent>> CaptureSectionEventReader::ReadEventBatch() {
+  absl::MutexLock lock{&mutex_};
+  auto has_batch_or_reading_finished = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !batches_.empty() || reading_finished_;
+  };
+  mutex_.Await(absl::Condition(&has_batch_or_reading_finished));
+
+  if (!batches_.empty()) {
+    std::vector<ClientCaptureEvent> batch = std::move(batches_.front());
+    batches_.pop_front();
+    return batch;
+  }
+  if (error_.has_value()) return error_.value();
+  return std::vector<ClientCaptureEvent>{};
+}
+
+}  // namespace orbit_capture_file
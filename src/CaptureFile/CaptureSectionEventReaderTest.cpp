@@ -0,0 +1,125 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "CaptureFile/CaptureSectionEventReader.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file {
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr uint64_t kNumInternedStrings = 5000;
+
+[[nodiscard]] ClientCaptureEvent CreateInternedStringCaptureEvent(uint64_t key) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::InternedString* interned_string = event.mutable_interned_string();
+  interned_string->set_key(key);
+  interned_string->set_intern(std::to_string(key));
+  return event;
+}
+
+[[nodiscard]] std::unique_ptr<CaptureFile> CreateCaptureFile(
+    const orbit_base::TemporaryFile& temporary_file, bool write_capture_finished) {
+  auto output_stream_or_error = CaptureFileOutputStream::Create(temporary_file.file_path());
+  EXPECT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  for (uint64_t key = 0; key < kNumInternedStrings; ++key) {
+    EXPECT_THAT(output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(key)),
+                HasNoError());
+  }
+  if (write_capture_finished) {
+    ClientCaptureEvent event;
+    event.mutable_capture_finished()->set_status(orbit_grpc_protos::CaptureFinished::kSuccessful);
+    EXPECT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  EXPECT_THAT(output_stream->Close(), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  EXPECT_THAT(capture_file_or_error, HasNoError());
+  return std::move(capture_file_or_error.value());
+}
+
+[[nodiscard]] orbit_base::TemporaryFile CreateTemporaryFile() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  EXPECT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  return temporary_file;
+}
+
+}  // namespace
+
+TEST(CaptureSectionEventReader, ReadsAllEventsInOrderUntilCaptureFinished) {
+  orbit_base::TemporaryFile temporary_file = CreateTemporaryFile();
+  std::unique_ptr<CaptureFile> capture_file =
+      CreateCaptureFile(temporary_file, /*write_capture_finished=*/true);
+
+  CaptureSectionEventReader reader{capture_file->CreateCaptureSectionInputStream()};
+  std::vector<ClientCaptureEvent> events;
+  while (true) {
+    ErrorMessageOr<std::vector<ClientCaptureEvent>> batch_or_error = reader.ReadEventBatch();
+    ASSERT_THAT(batch_or_error, HasNoError());
+    if (batch_or_error.value().empty()) break;
+    for (ClientCaptureEvent& event : batch_or_error.value()) events.push_back(std::move(event));
+  }
+
+  ASSERT_EQ(events.size(), kNumInternedStrings + 1);
+  for (uint64_t key = 0; key < kNumInternedStrings; ++key) {
+    ASSERT_EQ(events[key].event_case(), ClientCaptureEvent::kInternedString);
+    EXPECT_EQ(events[key].interned_string().key(), key);
+    EXPECT_EQ(events[key].interned_string().intern(), std::to_string(key));
+  }
+  EXPECT_EQ(events.back().event_case(), ClientCaptureEvent::kCaptureFinished);
+
+  // Reading stays finished.
+  ErrorMessageOr<std::vector<ClientCaptureEvent>> batch_or_error = reader.ReadEventBatch();
+  ASSERT_THAT(batch_or_error, HasNoError());
+  EXPECT_TRUE(batch_or_error.value().empty());
+}
+
+TEST(CaptureSectionEventReader, ReturnsErrorAfterAllEventsWithoutCaptureFinished) {
+  orbit_base::TemporaryFile temporary_file = CreateTemporaryFile();
+  std::unique_ptr<CaptureFile> capture_file =
+      CreateCaptureFile(temporary_file, /*write_capture_finished=*/false);
+
+  CaptureSectionEventReader reader{capture_file->CreateCaptureSectionInputStream()};
+  uint64_t num_events = 0;
+  while (true) {
+    ErrorMessageOr<std::vector<ClientCaptureEvent>> batch_or_error = reader.ReadEventBatch();
+    if (batch_or_error.has_error()) break;
+    ASSERT_FALSE(batch_or_error.value().empty());
+    num_events += batch_or_error.value().size();
+  }
+  EXPECT_EQ(num_events, kNumInternedStrings);
+  EXPECT_THAT(reader.ReadEventBatch(), HasError(""));
+}
+
+TEST(CaptureSectionEventReader, CanBeDestroyedBeforeReadingAllEvents) {
+  orbit_base::TemporaryFile temporary_file = CreateTemporaryFile();
+  std::unique_ptr<CaptureFile> capture_file =
+      CreateCaptureFile(temporary_file, /*write_capture_finished=*/true);
+
+  CaptureSectionEventReader reader{capture_file->CreateCaptureSectionInputStream()};
+  ErrorMessageOr<std::vector<ClientCaptureEvent>> batch_or_error = reader.ReadEventBatch();
+  ASSERT_THAT(batch_or_error, HasNoError());
+  EXPECT_FALSE(batch_or_error.value().empty());
+}
+
+}  // namespace orbit_capture_file
@@ -0,0 +1,191 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureSectionIndexBuilder.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CaptureSectionIndex;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+void CaptureSectionIndexBuilder::AddEvent(const ClientCaptureEvent& event, uint64_t offset) {
+  time_ranges_.clear();
+  auto add_thread_time_range = [this](int32_t tid, uint64_t start_ns, uint64_t end_ns) {
+    time_ranges_.push_back(ThreadTimeRange{tid, true, start_ns, end_ns});
+  };
+  auto add_time_range = [this](uint64_t start_ns, uint64_t end_ns) {
+    time_ranges_.push_back(ThreadTimeRange{0, false, start_ns, end_ns});
+  };
+
+  // Only the events that are shown on the timeline count as timed events. The others are needed
+  // regardless of the time range that is read.
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kApiEvent:
+      add_thread_time_range(event.api_event().tid(), event.api_event().timestamp_ns(),
+                            event.api_event().timestamp_ns());
+      break;
+    case ClientCaptureEvent::kCallstackSample:
+      add_thread_time_range(event.callstack_sample().tid(),
+                            event.callstack_sample().timestamp_ns(),
+                            event.callstack_sample().timestamp_ns());
+      break;
+    case ClientCaptureEvent::kCallstackSampleBatch: {
+      const orbit_grpc_protos::CallstackSampleBatch& batch = event.callstack_sample_batch();
+      uint64_t timestamp_ns = 0;
+      const int size = std::min(batch.tid_size(), batch.timestamp_ns_delta_size());
+      for (int i = 0; i < size; ++i) {
+        timestamp_ns += static_cast<uint64_t>(batch.timestamp_ns_delta(i));
+        add_thread_time_range(batch.tid(i), timestamp_ns, timestamp_ns);
+      }
+    } break;
+    case ClientCaptureEvent::kCompactApiEvent:
+      add_thread_time_range(event.compact_api_event().tid(),
+                            event.compact_api_event().timestamp_ns(),
+                            event.compact_api_event().timestamp_ns());
+      break;
+    case ClientCaptureEvent::kFunctionCall: {
+      const orbit_grpc_protos::FunctionCall& function_call = event.function_call();
+      add_thread_time_range(function_call.tid(),
+                            function_call.end_timestamp_ns() - function_call.duration_ns(),
+                            function_call.end_timestamp_ns());
+    } break;
+    case ClientCaptureEvent::kFunctionCallBatch: {
+      const orbit_grpc_protos::FunctionCallBatch& batch = event.function_call_batch();
+      uint64_t end_timestamp_ns = 0;
+      const int size = std::min({batch.tid_size(), batch.end_timestamp_ns_delta_size(),
+                                 batch.duration_ns_size()});
+      for (int i = 0; i < size; ++i) {
+        end_timestamp_ns += static_cast<uint64_t>(batch.end_timestamp_ns_delta(i));
+        add_thread_time_range(batch.tid(i), end_timestamp_ns - batch.duration_ns(i),
+                              end_timestamp_ns);
+      }
+    } break;
+    case ClientCaptureEvent::kGpuJob:
+      add_thread_time_range(event.gpu_job().tid(), event.gpu_job().amdgpu_cs_ioctl_time_ns(),
+                            std::max(event.gpu_job().amdgpu_cs_ioctl_time_ns(),
+                                     event.gpu_job().dma_fence_signaled_time_ns()));
+      break;
+    case ClientCaptureEvent::kGpuQueueSubmission: {
+      const orbit_grpc_protos::GpuQueueSubmissionMetaInfo& meta_info =
+          event.gpu_queue_submission().meta_info();
+      add_thread_time_range(meta_info.tid(), meta_info.pre_submission_cpu_timestamp(),
+                            meta_info.post_submission_cpu_timestamp());
+    } break;
+    case ClientCaptureEvent::kIntrospectionScope: {
+      const orbit_grpc_protos::IntrospectionScope& scope = event.introspection_scope();
+      add_thread_time_range(scope.tid(), scope.end_timestamp_ns() - scope.duration_ns(),
+                            scope.end_timestamp_ns());
+    } break;
+    case ClientCaptureEvent::kMemoryUsageEvent:
+      add_time_range(event.memory_usage_event().timestamp_ns(),
+                     event.memory_usage_event().timestamp_ns());
+      break;
+    case ClientCaptureEvent::kPmuCountersSample: {
+      const orbit_grpc_protos::PmuCountersSample& sample = event.pmu_counters_sample();
+      add_thread_time_range(sample.tid(), sample.end_timestamp_ns() - sample.duration_ns(),
+                            sample.end_timestamp_ns());
+    } break;
+    case ClientCaptureEvent::kSchedulingSlice: {
+      const orbit_grpc_protos::SchedulingSlice& slice = event.scheduling_slice();
+      add_thread_time_range(slice.tid(), slice.out_timestamp_ns() - slice.duration_ns(),
+                            slice.out_timestamp_ns());
+    } break;
+    case ClientCaptureEvent::kSchedulingSliceBatch: {
+      const orbit_grpc_protos::SchedulingSliceBatch& batch = event.scheduling_slice_batch();
+      uint64_t out_timestamp_ns = 0;
+      const int size = std::min({batch.tid_size(), batch.out_timestamp_ns_delta_size(),
+                                 batch.duration_ns_size()});
+      for (int i = 0; i < size; ++i) {
+        out_timestamp_ns += static_cast<uint64_t>(batch.out_timestamp_ns_delta(i));
+        add_thread_time_range(batch.tid(i), out_timestamp_ns - batch.duration_ns(i),
+                              out_timestamp_ns);
+      }
+    } break;
+    case ClientCaptureEvent::kThreadStateSlice: {
+      const orbit_grpc_protos::ThreadStateSlice& slice = event.thread_state_slice();
+      add_thread_time_range(slice.tid(), slice.end_timestamp_ns() - slice.duration_ns(),
+                            slice.end_timestamp_ns());
+    } break;
+    case ClientCaptureEvent::kTracepointEvent:
+      add_thread_time_range(event.tracepoint_event().tid(),
+                            event.tracepoint_event().timestamp_ns(),
+                            event.tracepoint_event().timestamp_ns());
+      break;
+    default:
+      break;
+  }
+
+  const bool is_timed_event = !time_ranges_.empty();
+  if (entries_.empty() || entries_.back().event_count() >= max_events_per_entry_) {
+    StartEntry(offset);
+  } else if (is_timed_event && last_entry_has_timestamps_) {
+    uint64_t max_end_timestamp_ns = 0;
+    for (const ThreadTimeRange& time_range : time_ranges_) {
+      max_end_timestamp_ns = std::max(max_end_timestamp_ns, time_range.end_timestamp_ns);
+    }
+    if (max_end_timestamp_ns > entries_.back().min_timestamp_ns() + max_entry_duration_ns_) {
+      StartEntry(offset);
+    }
+  }
+
+  CaptureSectionIndex::Entry& entry = entries_.back();
+  const auto entry_index = static_cast<uint32_t>(entries_.size() - 1);
+  entry.set_event_count(entry.event_count() + 1);
+  ++event_count_;
+  if (!is_timed_event) {
+    entry.set_has_untimed_events(true);
+    return;
+  }
+
+  has_timed_events_ = true;
+  for (const ThreadTimeRange& time_range : time_ranges_) {
+    if (!last_entry_has_timestamps_) {
+      entry.set_min_timestamp_ns(time_range.start_timestamp_ns);
+      entry.set_max_timestamp_ns(time_range.end_timestamp_ns);
+      last_entry_has_timestamps_ = true;
+    } else {
+      entry.set_min_timestamp_ns(std::min(entry.min_timestamp_ns(), time_range.start_timestamp_ns));
+      entry.set_max_timestamp_ns(std::max(entry.max_timestamp_ns(), time_range.end_timestamp_ns));
+    }
+
+    if (!time_range.has_tid) continue;
+    std::vector<uint32_t>& entry_indices = entry_indices_by_tid_[time_range.tid];
+    if (entry_indices.empty() || entry_indices.back() != entry_index) {
+      entry_indices.push_back(entry_index);
+    }
+  }
+}
+
+void CaptureSectionIndexBuilder::StartEntry(uint64_t offset) {
+  CaptureSectionIndex::Entry& entry = entries_.emplace_back();
+  entry.set_offset(offset);
+  entry.set_first_event_index(event_count_);
+  last_entry_has_timestamps_ = false;
+}
+
+CaptureSectionIndex CaptureSectionIndexBuilder::Build() const {
+  CaptureSectionIndex index;
+  for (const CaptureSectionIndex::Entry& entry : entries_) {
+    *index.add_entries() = entry;
+  }
+
+  std::vector<int32_t> tids;
+  tids.reserve(entry_indices_by_tid_.size());
+  for (const auto& [tid, unused_entry_indices] : entry_indices_by_tid_) {
+    tids.push_back(tid);
+  }
+  std::sort(tids.begin(), tids.end());
+  for (int32_t tid : tids) {
+    CaptureSectionIndex::ThreadEntries* thread_entries = index.add_thread_entries();
+    thread_entries->set_tid(tid);
+    const std::vector<uint32_t>& entry_indices = entry_indices_by_tid_.at(tid);
+    *thread_entries->mutable_entry_indices() = {entry_indices.begin(), entry_indices.end()};
+  }
+  return index;
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,60 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_CAPTURE_SECTION_INDEX_BUILDER_H_
+#define CAPTURE_FILE_CAPTURE_SECTION_INDEX_BUILDER_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "capture.pb.h"
+#include "capture_section_index.pb.h"
+
+namespace orbit_capture_file_internal {
+
+// Builds the CaptureSectionIndex of a capture section from its events, in the order they are
+// written. A new entry is started when the current one has `max_events_per_entry` events, or when
+// an event ends more than `max_entry_duration_ns` after the earliest timestamp of the entry.
+class CaptureSectionIndexBuilder {
+ public:
+  explicit CaptureSectionIndexBuilder(uint64_t max_entry_duration_ns,
+                                      uint64_t max_events_per_entry)
+      : max_entry_duration_ns_{max_entry_duration_ns},
+        max_events_per_entry_{max_events_per_entry} {}
+
+  // `offset` is the offset of the event from the start of the capture section.
+  void AddEvent(const orbit_grpc_protos::ClientCaptureEvent& event, uint64_t offset);
+
+  // Without events with a timestamp the index doesn't allow skipping any part of the section.
+  [[nodiscard]] bool HasTimedEvents() const { return has_timed_events_; }
+
+  [[nodiscard]] orbit_client_protos::CaptureSectionIndex Build() const;
+
+ private:
+  struct ThreadTimeRange {
+    int32_t tid;
+    bool has_tid;
+    uint64_t start_timestamp_ns;
+    uint64_t end_timestamp_ns;
+  };
+
+  void StartEntry(uint64_t offset);
+
+  uint64_t max_entry_duration_ns_;
+  uint64_t max_events_per_entry_;
+  bool has_timed_events_ = false;
+  uint64_t event_count_ = 0;
+  std::vector<orbit_client_protos::CaptureSectionIndex::Entry> entries_;
+  // Whether the timestamps of the last entry have been set.
+  bool last_entry_has_timestamps_ = false;
+  absl::flat_hash_map<int32_t, std::vector<uint32_t>> entry_indices_by_tid_;
+  // Reused across calls of AddEvent.
+  std::vector<ThreadTimeRange> time_ranges_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_CAPTURE_SECTION_INDEX_BUILDER_H_
@@ -0,0 +1,128 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CaptureSectionIndexBuilder.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CaptureSectionIndex;
+using orbit_grpc_protos::ClientCaptureEvent;
+using testing::ElementsAre;
+
+namespace {
+
+constexpr uint64_t kMaxEntryDurationNs = 1'000;
+constexpr uint64_t kMaxEventsPerEntry = 3;
+
+[[nodiscard]] ClientCaptureEvent CreateFunctionCall(int32_t tid, uint64_t end_timestamp_ns,
+                                                    uint64_t duration_ns) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::FunctionCall* function_call = event.mutable_function_call();
+  function_call->set_tid(tid);
+  function_call->set_end_timestamp_ns(end_timestamp_ns);
+  function_call->set_duration_ns(duration_ns);
+  return event;
+}
+
+[[nodiscard]] ClientCaptureEvent CreateModuleUpdate() {
+  ClientCaptureEvent event;
+  event.mutable_module_update_event()->set_pid(1);
+  return event;
+}
+
+}  // namespace
+
+TEST(CaptureSectionIndexBuilder, EmptyIndex) {
+  CaptureSectionIndexBuilder builder{kMaxEntryDurationNs, kMaxEventsPerEntry};
+  EXPECT_FALSE(builder.HasTimedEvents());
+  CaptureSectionIndex index = builder.Build();
+  EXPECT_EQ(index.entries_size(), 0);
+  EXPECT_EQ(index.thread_entries_size(), 0);
+}
+
+TEST(CaptureSectionIndexBuilder, UntimedEventsOnly) {
+  CaptureSectionIndexBuilder builder{kMaxEntryDurationNs, kMaxEventsPerEntry};
+  builder.AddEvent(CreateModuleUpdate(), 0);
+  builder.AddEvent(CreateModuleUpdate(), 10);
+  EXPECT_FALSE(builder.HasTimedEvents());
+
+  CaptureSectionIndex index = builder.Build();
+  ASSERT_EQ(index.entries_size(), 1);
+  EXPECT_EQ(index.entries(0).event_count(), 2);
+  EXPECT_TRUE(index.entries(0).has_untimed_events());
+}
+
+TEST(CaptureSectionIndexBuilder, StartsNewEntryWhenDurationIsExceeded) {
+  CaptureSectionIndexBuilder builder{kMaxEntryDurationNs, kMaxEventsPerEntry};
+  builder.AddEvent(CreateFunctionCall(1, 1'100, 200), 0);
+  builder.AddEvent(CreateModuleUpdate(), 10);
+  builder.AddEvent(CreateFunctionCall(2, 1'500, 100), 20);
+  // Ends more than kMaxEntryDurationNs after the start of the first function call.
+  builder.AddEvent(CreateFunctionCall(1, 2'000, 100), 30);
+  EXPECT_TRUE(builder.HasTimedEvents());
+
+  CaptureSectionIndex index = builder.Build();
+  ASSERT_EQ(index.entries_size(), 2);
+  EXPECT_EQ(index.entries(0).offset(), 0);
+  EXPECT_EQ(index.entries(0).first_event_index(), 0);
+  EXPECT_EQ(index.entries(0).event_count(), 3);
+  EXPECT_EQ(index.entries(0).min_timestamp_ns(), 900);
+  EXPECT_EQ(index.entries(0).max_timestamp_ns(), 1'500);
+  EXPECT_TRUE(index.entries(0).has_untimed_events());
+
+  EXPECT_EQ(index.entries(1).offset(), 30);
+  EXPECT_EQ(index.entries(1).first_event_index(), 3);
+  EXPECT_EQ(index.entries(1).event_count(), 1);
+  EXPECT_EQ(index.entries(1).min_timestamp_ns(), 1'900);
+  EXPECT_EQ(index.entries(1).max_timestamp_ns(), 2'000);
+  EXPECT_FALSE(index.entries(1).has_untimed_events());
+
+  ASSERT_EQ(index.thread_entries_size(), 2);
+  EXPECT_EQ(index.thread_entries(0).tid(), 1);
+  EXPECT_THAT(index.thread_entries(0).entry_indices(), ElementsAre(0, 1));
+  EXPECT_EQ(index.thread_entries(1).tid(), 2);
+  EXPECT_THAT(index.thread_entries(1).entry_indices(), ElementsAre(0));
+}
+
+TEST(CaptureSectionIndexBuilder, StartsNewEntryWhenEventCountIsReached) {
+  CaptureSectionIndexBuilder builder{kMaxEntryDurationNs, kMaxEventsPerEntry};
+  for (uint64_t i = 0; i < 2 * kMaxEventsPerEntry + 1; ++i) {
+    builder.AddEvent(CreateFunctionCall(1, 100 + i, 1), i * 10);
+  }
+
+  CaptureSectionIndex index = builder.Build();
+  ASSERT_EQ(index.entries_size(), 3);
+  EXPECT_EQ(index.entries(1).offset(), 30);
+  EXPECT_EQ(index.entries(1).first_event_index(), 3);
+  EXPECT_EQ(index.entries(1).event_count(), 3);
+  EXPECT_EQ(index.entries(2).event_count(), 1);
+  ASSERT_EQ(index.thread_entries_size(), 1);
+  EXPECT_THAT(index.thread_entries(0).entry_indices(), ElementsAre(0, 1, 2));
+}
+
+TEST(CaptureSectionIndexBuilder, ExpandsBatches) {
+  CaptureSectionIndexBuilder builder{kMaxEntryDurationNs, kMaxEventsPerEntry};
+  ClientCaptureEvent event;
+  orbit_grpc_protos::SchedulingSliceBatch* batch = event.mutable_scheduling_slice_batch();
+  batch->add_tid(3);
+  batch->add_out_timestamp_ns_delta(500);
+  batch->add_duration_ns(100);
+  batch->add_tid(4);
+  batch->add_out_timestamp_ns_delta(200);
+  batch->add_duration_ns(50);
+  builder.AddEvent(event, 0);
+
+  CaptureSectionIndex index = builder.Build();
+  ASSERT_EQ(index.entries_size(), 1);
+  EXPECT_EQ(index.entries(0).min_timestamp_ns(), 400);
+  EXPECT_EQ(index.entries(0).max_timestamp_ns(), 700);
+  ASSERT_EQ(index.thread_entries_size(), 2);
+  EXPECT_EQ(index.thread_entries(0).tid(), 3);
+  EXPECT_EQ(index.thread_entries(1).tid(), 4);
+}
+
+}  // namespace orbit_capture_file_internal
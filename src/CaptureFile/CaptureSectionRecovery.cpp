@@ -0,0 +1,147 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureSectionRecovery.h"
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+
+#include "BlockCompression.h"
+#include "CaptureFileConstants.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CaptureSectionBlockTable;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+// Maximum size of a varint encoded uint32_t.
+constexpr size_t kMaxVarint32Size = 5;
+
+// Returns the size, including the size prefix, of the message at the start of `data`, or
+// std::nullopt if `data` doesn't start with a complete valid message.
+[[nodiscard]] std::optional<size_t> GetCompleteMessageSize(std::string_view data) {
+  google::protobuf::io::CodedInputStream input{
+      reinterpret_cast<const uint8_t*>(data.data()),
+      static_cast<int>(std::min<size_t>(data.size(), kMaxMessageSize + kMaxVarint32Size))};
+  uint32_t message_size = 0;
+  if (!input.ReadVarint32(&message_size)) return std::nullopt;
+  if (message_size == 0 || message_size > kMaxMessageSize) return std::nullopt;
+  const size_t size_with_message_size = input.CurrentPosition() + message_size;
+  if (size_with_message_size > data.size()) return std::nullopt;
+  return size_with_message_size;
+}
+
+// `data` is a complete message as returned by GetCompleteMessageSize.
+[[nodiscard]] bool IsCaptureFinished(std::string_view data) {
+  google::protobuf::io::CodedInputStream input{reinterpret_cast<const uint8_t*>(data.data()),
+                                               static_cast<int>(data.size())};
+  uint32_t message_size = 0;
+  if (!input.ReadVarint32(&message_size)) return false;
+  ClientCaptureEvent event;
+  const char* message_start = data.data() + input.CurrentPosition();
+  if (!event.ParseFromArray(message_start, static_cast<int>(message_size))) return false;
+  return event.event_case() == ClientCaptureEvent::kCaptureFinished;
+}
+
+}  // namespace
+
+ErrorMessageOr<CaptureSectionScanResult> ScanUncompressedCaptureSection(
+    const orbit_base::unique_fd& fd, uint64_t section_offset, uint64_t section_size) {
+  // Read in large chunks, and make sure a whole message is always in the buffer unless the section
+  // ends before.
+  constexpr uint64_t kReadSize = 16 * 1024 * 1024;
+  std::string buffer;
+  uint64_t buffer_offset = 0;
+  uint64_t offset = 0;
+  std::optional<uint64_t> last_message_offset;
+  uint64_t last_message_size = 0;
+  while (offset < section_size) {
+    const uint64_t buffer_end = buffer_offset + buffer.size();
+    if (offset + kMaxMessageSize + kMaxVarint32Size > buffer_end && buffer_end < section_size) {
+      const uint64_t read_size = std::min(kReadSize, section_size - offset);
+      buffer.resize(read_size);
+      OUTCOME_TRY(bytes_read,
+                  orbit_base::ReadFullyAtOffset(fd, buffer.data(), read_size,
+                                                static_cast<off_t>(section_offset + offset)));
+      buffer.resize(bytes_read);
+      buffer_offset = offset;
+      if (bytes_read < read_size) section_size = offset + bytes_read;
+    }
+
+    std::optional<size_t> message_size =
+        GetCompleteMessageSize(std::string_view{buffer}.substr(offset - buffer_offset));
+    if (!message_size.has_value()) break;
+    last_message_offset = offset;
+    last_message_size = message_size.value();
+    offset += message_size.value();
+  }
+
+  CaptureSectionScanResult result;
+  result.complete_size = offset;
+  if (last_message_offset.has_value()) {
+    std::string last_message(last_message_size, '\0');
+    OUTCOME_TRY(orbit_base::ReadFullyAtOffset(
+        fd, last_message.data(), last_message_size,
+        static_cast<off_t>(section_offset + last_message_offset.value())));
+    result.ends_with_capture_finished = IsCaptureFinished(last_message);
+  }
+  return result;
+}
+
+ErrorMessageOr<CaptureSectionScanResult> ScanCompressedCaptureSection(
+    const orbit_base::unique_fd& fd, uint64_t section_offset, uint64_t section_size) {
+  CaptureSectionScanResult result;
+  std::string block_data;
+  while (result.complete_size < section_size) {
+    OUTCOME_TRY(block_sizes,
+                DecompressBlockAtOffset(
+                    fd, section_offset + result.complete_size,
+                    std::min(kMaxCompressedBlockSize, section_size - result.complete_size),
+                    kMaxCompressedBlockSize, &block_data));
+    if (!block_sizes.has_value()) break;
+
+    // A block only contains whole messages.
+    std::string_view remaining_data{block_data};
+    std::string_view last_message;
+    while (!remaining_data.empty()) {
+      std::optional<size_t> message_size = GetCompleteMessageSize(remaining_data);
+      if (!message_size.has_value()) break;
+      last_message = remaining_data.substr(0, message_size.value());
+      remaining_data.remove_prefix(message_size.value());
+    }
+    if (!remaining_data.empty() || last_message.empty()) break;
+
+    CaptureSectionBlockTable::Block& block = result.blocks.emplace_back();
+    block.set_offset(result.complete_size);
+    block.set_compressed_size(block_sizes->compressed_size);
+    block.set_uncompressed_size(block_sizes->uncompressed_size);
+    result.complete_size += block_sizes->compressed_size;
+    result.ends_with_capture_finished = IsCaptureFinished(last_message);
+  }
+  return result;
+}
+
+std::string CreateSerializedCaptureFinishedAfterTruncation() {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::CaptureFinished* capture_finished = event.mutable_capture_finished();
+  capture_finished->set_status(orbit_grpc_protos::CaptureFinished::kFailed);
+  capture_finished->set_error_message(
+      "The capture file was truncated, the events after the truncation were lost.");
+
+  const size_t message_size = event.ByteSizeLong();
+  std::string data(
+      google::protobuf::io::CodedOutputStream::VarintSize32(message_size) + message_size, '\0');
+  uint8_t* message_start = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      message_size, reinterpret_cast<uint8_t*>(data.data()));
+  event.SerializeWithCachedSizesToArray(message_start);
+  return data;
+}
+
+}  // namespace orbit_capture_file_internal
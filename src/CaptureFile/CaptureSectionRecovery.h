@@ -0,0 +1,49 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_CAPTURE_SECTION_RECOVERY_H_
+#define CAPTURE_FILE_CAPTURE_SECTION_RECOVERY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "capture_section_block_table.pb.h"
+
+namespace orbit_capture_file_internal {
+
+// What survived of a capture section that extends to the end of the file and might have been
+// truncated, e.g., because the process writing it crashed.
+struct CaptureSectionScanResult {
+  // The size, from the start of the capture section, of the complete messages (or, for a
+  // compressed capture section, of the complete blocks).
+  uint64_t complete_size = 0;
+  // Whether the last complete message is CaptureFinished, in which case nothing was lost.
+  bool ends_with_capture_finished = false;
+  // Only for a compressed capture section, the complete blocks.
+  std::vector<orbit_client_protos::CaptureSectionBlockTable::Block> blocks;
+};
+
+// Finds the complete messages at the start of the uncompressed capture section at
+// `section_offset` in `fd`, of at most `section_size` bytes, without parsing them (except the
+// last). The messages end at the first incomplete or invalid message, e.g., an empty one, as the
+// writer never writes empty events.
+[[nodiscard]] ErrorMessageOr<CaptureSectionScanResult> ScanUncompressedCaptureSection(
+    const orbit_base::unique_fd& fd, uint64_t section_offset, uint64_t section_size);
+
+// Finds the complete blocks at the start of the compressed capture section at `section_offset` in
+// `fd`, of at most `section_size` bytes, by decompressing them, as the blocks are self-delimiting.
+// This rebuilds the block table of a file whose CAPTURE_SECTION_BLOCK_TABLE was never written.
+[[nodiscard]] ErrorMessageOr<CaptureSectionScanResult> ScanCompressedCaptureSection(
+    const orbit_base::unique_fd& fd, uint64_t section_offset, uint64_t section_size);
+
+// Returns the CaptureFinished event that ends a recovered capture section, serialized as in the
+// capture section, i.e., prefixed by its size.
+[[nodiscard]] std::string CreateSerializedCaptureFinishedAfterTruncation();
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_CAPTURE_SECTION_RECOVERY_H_
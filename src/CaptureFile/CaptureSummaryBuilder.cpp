@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureSummaryBuilder.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "ClientData/FunctionStatsUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::CaptureSummary;
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+void CaptureSummaryBuilder::AddEvent(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kFunctionCall:
+      AddFunctionCall(event.function_call().function_id(), event.function_call().duration_ns());
+      break;
+    case ClientCaptureEvent::kFunctionCallBatch: {
+      const orbit_grpc_protos::FunctionCallBatch& batch = event.function_call_batch();
+      // Like the client, ignore batches with columns of different sizes.
+      const int size = batch.pid_size();
+      if (batch.tid_size() != size || batch.function_id_size() != size ||
+          batch.duration_ns_size() != size || batch.end_timestamp_ns_delta_size() != size ||
+          batch.depth_size() != size || batch.return_value_size() != size) {
+        break;
+      }
+      for (int i = 0; i < size; ++i) {
+        AddFunctionCall(batch.function_id(i), batch.duration_ns(i));
+      }
+    } break;
+    case ClientCaptureEvent::kCallstackSample: {
+      const CallstackSample& sample = event.callstack_sample();
+      if (sample.off_cpu_duration_ns() != 0 ||
+          sample.memory_event_type() != CallstackSample::kNoMemoryEvent) {
+        break;
+      }
+      AddCallstackSample(sample.tid(), sample.callstack_id());
+    } break;
+    case ClientCaptureEvent::kCallstackSampleBatch: {
+      const orbit_grpc_protos::CallstackSampleBatch& batch = event.callstack_sample_batch();
+      // Like the client, ignore batches with columns of different sizes.
+      const int size = batch.pid_size();
+      if (batch.tid_size() != size || batch.callstack_id_size() != size ||
+          batch.timestamp_ns_delta_size() != size || batch.off_cpu_duration_ns_size() != size) {
+        break;
+      }
+      for (int i = 0; i < size; ++i) {
+        if (batch.off_cpu_duration_ns(i) != 0) continue;
+        AddCallstackSample(batch.tid(i), batch.callstack_id(i));
+      }
+    } break;
+    case ClientCaptureEvent::kInternedCallstack: {
+      const orbit_grpc_protos::Callstack& callstack = event.interned_callstack().intern();
+      CallstackInfo callstack_info;
+      *callstack_info.mutable_frames() = {callstack.pcs().begin(), callstack.pcs().end()};
+      // The values of CallstackInfo::CallstackType are kept in sync with Callstack::CallstackType.
+      callstack_info.set_type(static_cast<CallstackInfo::CallstackType>(callstack.type()));
+      (*interned_.mutable_callstacks())[event.interned_callstack().key()] =
+          std::move(callstack_info);
+    } break;
+    case ClientCaptureEvent::kInternedString:
+      (*interned_.mutable_strings())[event.interned_string().key()] =
+          event.interned_string().intern();
+      break;
+    default:
+      break;
+  }
+}
+
+void CaptureSummaryBuilder::AddFunctionCall(uint64_t function_id, uint64_t duration_ns) {
+  // Same as the client, which only keeps statistics for valid function ids.
+  if (function_id == 0) return;
+  is_empty_ = false;
+
+  orbit_client_data::AddFunctionCallToStats(duration_ns, &function_stats_[function_id]);
+}
+
+void CaptureSummaryBuilder::AddCallstackSample(int32_t tid, uint64_t callstack_id) {
+  is_empty_ = false;
+  ++thread_callstack_counts_[tid][callstack_id];
+}
+
+CaptureSummary CaptureSummaryBuilder::Build() const {
+  CaptureSummary summary = interned_;
+  summary.mutable_function_stats()->insert(function_stats_.begin(), function_stats_.end());
+
+  std::vector<int32_t> tids;
+  tids.reserve(thread_callstack_counts_.size());
+  for (const auto& [tid, unused_counts] : thread_callstack_counts_) {
+    tids.push_back(tid);
+  }
+  std::sort(tids.begin(), tids.end());
+  for (int32_t tid : tids) {
+    CaptureSummary::ThreadCallstackCounts* thread_counts = summary.add_thread_callstack_counts();
+    thread_counts->set_tid(tid);
+    const absl::flat_hash_map<uint64_t, uint64_t>& counts = thread_callstack_counts_.at(tid);
+    thread_counts->mutable_callstack_id_to_count()->insert(counts.begin(), counts.end());
+  }
+  return summary;
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,42 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_CAPTURE_SUMMARY_BUILDER_H_
+#define CAPTURE_FILE_CAPTURE_SUMMARY_BUILDER_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+#include "capture_summary.pb.h"
+
+namespace orbit_capture_file_internal {
+
+// Builds the CaptureSummary of a capture section from its events, in the order they are written.
+class CaptureSummaryBuilder {
+ public:
+  void AddEvent(const orbit_grpc_protos::ClientCaptureEvent& event);
+
+  // Whether there are no function calls nor samples to summarize. The interned callstacks and
+  // strings alone don't need a summary.
+  [[nodiscard]] bool IsEmpty() const { return is_empty_; }
+
+  [[nodiscard]] orbit_client_protos::CaptureSummary Build() const;
+
+ private:
+  void AddFunctionCall(uint64_t function_id, uint64_t duration_ns);
+  void AddCallstackSample(int32_t tid, uint64_t callstack_id);
+
+  bool is_empty_ = true;
+  absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionStats> function_stats_;
+  absl::flat_hash_map<int32_t, absl::flat_hash_map<uint64_t, uint64_t>> thread_callstack_counts_;
+  // Only the interned callstacks and strings.
+  orbit_client_protos::CaptureSummary interned_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_CAPTURE_SUMMARY_BUILDER_H_
@@ -0,0 +1,152 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "CaptureSummaryBuilder.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::CaptureSummary;
+using orbit_client_protos::FunctionStats;
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::ClientCaptureEvent;
+using testing::ElementsAre;
+using testing::Pair;
+using testing::UnorderedElementsAre;
+
+namespace {
+
+[[nodiscard]] ClientCaptureEvent CreateFunctionCall(uint64_t function_id, uint64_t duration_ns) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::FunctionCall* function_call = event.mutable_function_call();
+  function_call->set_function_id(function_id);
+  function_call->set_duration_ns(duration_ns);
+  return event;
+}
+
+[[nodiscard]] ClientCaptureEvent CreateCallstackSample(int32_t tid, uint64_t callstack_id) {
+  ClientCaptureEvent event;
+  CallstackSample* callstack_sample = event.mutable_callstack_sample();
+  callstack_sample->set_tid(tid);
+  callstack_sample->set_callstack_id(callstack_id);
+  return event;
+}
+
+}  // namespace
+
+TEST(CaptureSummaryBuilder, EmptySummary) {
+  CaptureSummaryBuilder builder;
+  ClientCaptureEvent event;
+  event.mutable_module_update_event()->set_pid(1);
+  builder.AddEvent(event);
+  EXPECT_TRUE(builder.IsEmpty());
+
+  CaptureSummary summary = builder.Build();
+  EXPECT_TRUE(summary.function_stats().empty());
+  EXPECT_EQ(summary.thread_callstack_counts_size(), 0);
+  EXPECT_TRUE(summary.callstacks().empty());
+  EXPECT_TRUE(summary.strings().empty());
+}
+
+TEST(CaptureSummaryBuilder, ComputesFunctionStats) {
+  CaptureSummaryBuilder builder;
+  builder.AddEvent(CreateFunctionCall(1, 30));
+  builder.AddEvent(CreateFunctionCall(1, 10));
+  builder.AddEvent(CreateFunctionCall(2, 5));
+  // Function calls without function id don't have statistics.
+  builder.AddEvent(CreateFunctionCall(0, 5));
+
+  ClientCaptureEvent batch_event;
+  orbit_grpc_protos::FunctionCallBatch* batch = batch_event.mutable_function_call_batch();
+  batch->add_pid(1);
+  batch->add_tid(1);
+  batch->add_function_id(1);
+  batch->add_duration_ns(20);
+  batch->add_end_timestamp_ns_delta(100);
+  batch->add_depth(0);
+  batch->add_return_value(0);
+  builder.AddEvent(batch_event);
+  EXPECT_FALSE(builder.IsEmpty());
+
+  CaptureSummary summary = builder.Build();
+  ASSERT_EQ(summary.function_stats().size(), 2);
+  const FunctionStats& stats1 = summary.function_stats().at(1);
+  EXPECT_EQ(stats1.count(), 3);
+  EXPECT_EQ(stats1.total_time_ns(), 60);
+  EXPECT_EQ(stats1.average_time_ns(), 20);
+  EXPECT_EQ(stats1.min_ns(), 10);
+  EXPECT_EQ(stats1.max_ns(), 30);
+  const FunctionStats& stats2 = summary.function_stats().at(2);
+  EXPECT_EQ(stats2.count(), 1);
+  EXPECT_EQ(stats2.min_ns(), 5);
+  EXPECT_EQ(stats2.max_ns(), 5);
+}
+
+TEST(CaptureSummaryBuilder, CountsRegularSamplesPerThread) {
+  CaptureSummaryBuilder builder;
+  builder.AddEvent(CreateCallstackSample(2, 10));
+  builder.AddEvent(CreateCallstackSample(1, 10));
+  builder.AddEvent(CreateCallstackSample(1, 10));
+  builder.AddEvent(CreateCallstackSample(1, 11));
+
+  ClientCaptureEvent off_cpu_sample = CreateCallstackSample(1, 12);
+  off_cpu_sample.mutable_callstack_sample()->set_off_cpu_duration_ns(1000);
+  builder.AddEvent(off_cpu_sample);
+  ClientCaptureEvent memory_sample = CreateCallstackSample(1, 13);
+  memory_sample.mutable_callstack_sample()->set_memory_event_type(CallstackSample::kPageFault);
+  builder.AddEvent(memory_sample);
+
+  ClientCaptureEvent batch_event;
+  orbit_grpc_protos::CallstackSampleBatch* batch = batch_event.mutable_callstack_sample_batch();
+  for (uint64_t off_cpu_duration_ns : {0, 1000}) {
+    batch->add_pid(1);
+    batch->add_tid(2);
+    batch->add_callstack_id(11);
+    batch->add_timestamp_ns_delta(100);
+    batch->add_off_cpu_duration_ns(off_cpu_duration_ns);
+  }
+  builder.AddEvent(batch_event);
+
+  CaptureSummary summary = builder.Build();
+  ASSERT_EQ(summary.thread_callstack_counts_size(), 2);
+  EXPECT_EQ(summary.thread_callstack_counts(0).tid(), 1);
+  EXPECT_THAT(summary.thread_callstack_counts(0).callstack_id_to_count(),
+              UnorderedElementsAre(Pair(10, 2), Pair(11, 1)));
+  EXPECT_EQ(summary.thread_callstack_counts(1).tid(), 2);
+  EXPECT_THAT(summary.thread_callstack_counts(1).callstack_id_to_count(),
+              UnorderedElementsAre(Pair(10, 1), Pair(11, 1)));
+}
+
+TEST(CaptureSummaryBuilder, KeepsInternedCallstacksAndStrings) {
+  CaptureSummaryBuilder builder;
+
+  ClientCaptureEvent callstack_event;
+  orbit_grpc_protos::InternedCallstack* interned_callstack =
+      callstack_event.mutable_interned_callstack();
+  interned_callstack->set_key(10);
+  interned_callstack->mutable_intern()->add_pcs(0x100);
+  interned_callstack->mutable_intern()->add_pcs(0x200);
+  interned_callstack->mutable_intern()->set_type(
+      orbit_grpc_protos::Callstack::kFramePointerUnwindingError);
+  builder.AddEvent(callstack_event);
+
+  ClientCaptureEvent string_event;
+  string_event.mutable_interned_string()->set_key(20);
+  string_event.mutable_interned_string()->set_intern("string");
+  builder.AddEvent(string_event);
+  EXPECT_TRUE(builder.IsEmpty());
+
+  CaptureSummary summary = builder.Build();
+  ASSERT_EQ(summary.callstacks().size(), 1);
+  const CallstackInfo& callstack = summary.callstacks().at(10);
+  EXPECT_THAT(callstack.frames(), ElementsAre(0x100, 0x200));
+  EXPECT_EQ(callstack.type(), CallstackInfo::kFramePointerUnwindingError);
+  ASSERT_EQ(summary.strings().size(), 1);
+  EXPECT_EQ(summary.strings().at(20), "string");
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,154 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CompressedBlocksInputStream.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "BlockCompression.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_client_protos::CaptureSectionBlockTable;
+
+namespace {
+
+// Each pending block holds its decompressed data, so this also bounds the memory used for reading
+// ahead.
+constexpr size_t kMaxPendingBlocks = 8;
+
+[[nodiscard]] ErrorMessageOr<void> ReadAndDecompressBlock(const orbit_base::unique_fd& fd,
+                                                          uint64_t file_offset,
+                                                          uint64_t compressed_size,
+                                                          std::vector<uint8_t>* data) {
+  auto compressed_data = make_unique_for_overwrite<uint8_t[]>(compressed_size);
+  OUTCOME_TRY(bytes_read,
+              orbit_base::ReadFullyAtOffset(fd, compressed_data.get(), compressed_size,
+                                            file_offset));
+  if (bytes_read < compressed_size) {
+    return ErrorMessage{absl::StrFormat(
+        "Unexpected EOF while reading compressed block at offset %d: This means that the file "
+        "is corrupted.",
+        file_offset)};
+  }
+  return DecompressBlock(compressed_data.get(), compressed_size, data->data(), data->size());
+}
+
+}  // namespace
+
+CompressedBlocksInputStream::CompressedBlocksInputStream(
+    const orbit_base::unique_fd& fd, uint64_t capture_section_offset,
+    std::vector<CaptureSectionBlockTable::Block> blocks, uint64_t start_offset)
+    : fd_{fd}, capture_section_offset_{capture_section_offset}, blocks_{std::move(blocks)} {
+  // Skip the blocks before `start_offset`.
+  uint64_t block_start_offset = 0;
+  while (next_block_to_schedule_ < blocks_.size() &&
+         block_start_offset + blocks_[next_block_to_schedule_].uncompressed_size() <=
+             start_offset) {
+    block_start_offset += blocks_[next_block_to_schedule_].uncompressed_size();
+    ++next_block_to_schedule_;
+  }
+  start_offset_in_first_block_ = start_offset - block_start_offset;
+
+  const size_t thread_count =
+      std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxPendingBlocks);
+  thread_pool_ = ThreadPool::Create(/*thread_pool_min_size=*/1,
+                                    /*thread_pool_max_size=*/thread_count,
+                                    /*thread_ttl=*/absl::Seconds(1));
+  SchedulePendingBlocks();
+}
+
+CompressedBlocksInputStream::~CompressedBlocksInputStream() {
+  // The pending tasks refer to fd_.
+  thread_pool_->ShutdownAndWait();
+}
+
+void CompressedBlocksInputStream::SchedulePendingBlocks() {
+  while (pending_blocks_.size() < kMaxPendingBlocks && next_block_to_schedule_ < blocks_.size()) {
+    const CaptureSectionBlockTable::Block& block = blocks_[next_block_to_schedule_];
+    ++next_block_to_schedule_;
+
+    auto data = std::make_shared<std::vector<uint8_t>>(block.uncompressed_size());
+    orbit_base::Future<ErrorMessageOr<void>> decompressed = thread_pool_->Schedule(
+        [&fd = fd_, file_offset = capture_section_offset_ + block.offset(),
+         compressed_size = block.compressed_size(), data]() {
+          return ReadAndDecompressBlock(fd, file_offset, compressed_size, data.get());
+        });
+    pending_blocks_.push_back(PendingBlock{std::move(data), std::move(decompressed)});
+  }
+}
+
+bool CompressedBlocksInputStream::MoveToNextBlock() {
+  if (pending_blocks_.empty()) return false;
+
+  PendingBlock block = std::move(pending_blocks_.front());
+  pending_blocks_.pop_front();
+  const ErrorMessageOr<void>& result = block.decompressed.Get();
+  if (result.has_error()) {
+    last_error_ = result.error();
+    return false;
+  }
+
+  current_block_ = std::move(block.data);
+  position_in_current_block_ =
+      std::min<size_t>(std::exchange(start_offset_in_first_block_, 0), current_block_->size());
+  SchedulePendingBlocks();
+  return true;
+}
+
+bool CompressedBlocksInputStream::Next(const void** data, int* size) {
+  CHECK(data != nullptr);
+  CHECK(size != nullptr);
+
+  if (last_error_.has_value()) return false;
+
+  while (current_block_ == nullptr || position_in_current_block_ == current_block_->size()) {
+    if (!MoveToNextBlock()) return false;
+  }
+
+  const size_t bytes_available = current_block_->size() - position_in_current_block_;
+  (*data) = current_block_->data() + position_in_current_block_;
+  (*size) = static_cast<int>(bytes_available);
+  position_in_current_block_ += bytes_available;
+  byte_count_ += bytes_available;
+
+  return true;
+}
+
+void CompressedBlocksInputStream::BackUp(int count) {
+  CHECK(count >= 0);
+  // ZeroCopyInputStream only allows backing up into the buffer returned by the last call to Next.
+  CHECK(static_cast<size_t>(count) <= position_in_current_block_);
+  position_in_current_block_ -= count;
+  byte_count_ -= count;
+}
+
+bool CompressedBlocksInputStream::Skip(int count) {
+  CHECK(count >= 0);
+
+  if (last_error_.has_value()) return false;
+
+  size_t bytes_to_skip = count;
+  while (true) {
+    const size_t bytes_available =
+        current_block_ == nullptr ? 0 : current_block_->size() - position_in_current_block_;
+    const size_t bytes_skipped = std::min(bytes_to_skip, bytes_available);
+    position_in_current_block_ += bytes_skipped;
+    byte_count_ += bytes_skipped;
+    bytes_to_skip -= bytes_skipped;
+    if (bytes_to_skip == 0) return true;
+    if (!MoveToNextBlock()) return false;
+  }
+}
+
+google::protobuf::int64 CompressedBlocksInputStream::ByteCount() const { return byte_count_; }
+
+}  // namespace orbit_capture_file_internal
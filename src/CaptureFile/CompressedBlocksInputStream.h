@@ -0,0 +1,73 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_COMPRESSED_BLOCKS_INPUT_STREAM_H_
+#define CAPTURE_FILE_COMPRESSED_BLOCKS_INPUT_STREAM_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "ErrorReportingInputStream.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
+#include "capture_section_block_table.pb.h"
+
+namespace orbit_capture_file_internal {
+
+// Reads the uncompressed content of a capture section made of compressed blocks (see
+// orbit_client_protos::CaptureSectionBlockTable). The blocks following the one being read are read
+// and decompressed ahead in parallel, on a thread pool owned by the stream.
+class CompressedBlocksInputStream : public ErrorReportingInputStream {
+ public:
+  // `blocks` are the blocks of the capture section at `capture_section_offset` in the file.
+  // Reading starts at `start_offset` in the uncompressed capture section.
+  explicit CompressedBlocksInputStream(
+      const orbit_base::unique_fd& fd, uint64_t capture_section_offset,
+      std::vector<orbit_client_protos::CaptureSectionBlockTable::Block> blocks,
+      uint64_t start_offset = 0);
+  ~CompressedBlocksInputStream() override;
+
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  google::protobuf::int64 ByteCount() const override;
+
+  [[nodiscard]] std::optional<ErrorMessage> GetLastError() const override { return last_error_; }
+
+ private:
+  struct PendingBlock {
+    std::shared_ptr<std::vector<uint8_t>> data;
+    orbit_base::Future<ErrorMessageOr<void>> decompressed;
+  };
+
+  // Schedules the next blocks for decompression, until `kMaxPendingBlocks` are pending.
+  void SchedulePendingBlocks();
+  // Makes the next pending block the current one. Returns false at the end of the section or on
+  // error.
+  bool MoveToNextBlock();
+
+  const orbit_base::unique_fd& fd_;
+  const uint64_t capture_section_offset_;
+  const std::vector<orbit_client_protos::CaptureSectionBlockTable::Block> blocks_;
+  size_t next_block_to_schedule_ = 0;
+  // The position in the first block read at which reading starts.
+  uint64_t start_offset_in_first_block_ = 0;
+
+  std::deque<PendingBlock> pending_blocks_;
+  std::shared_ptr<std::vector<uint8_t>> current_block_;
+  size_t position_in_current_block_ = 0;
+  google::protobuf::int64 byte_count_ = 0;
+  std::optional<ErrorMessage> last_error_{};
+
+  std::shared_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_COMPRESSED_BLOCKS_INPUT_STREAM_H_
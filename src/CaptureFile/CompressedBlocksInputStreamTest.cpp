@@ -0,0 +1,141 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "CompressedBlocksInputStream.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_base::HasError;
+using orbit_client_protos::CaptureSectionBlockTable;
+
+namespace {
+
+constexpr uint64_t kCaptureSectionOffset = 8;
+
+// Writes one compressed block for each of `uncompressed_blocks` after kCaptureSectionOffset bytes
+// of padding, and returns the corresponding block table entries.
+[[nodiscard]] std::vector<CaptureSectionBlockTable::Block> WriteBlocks(
+    const orbit_base::unique_fd& fd, const std::vector<std::string>& uncompressed_blocks) {
+  std::string content(kCaptureSectionOffset, '\0');
+  std::vector<CaptureSectionBlockTable::Block> blocks;
+  for (const std::string& uncompressed_block : uncompressed_blocks) {
+    ErrorMessageOr<std::string> compressed_block = CompressBlock(uncompressed_block);
+    CHECK(compressed_block.has_value());
+    CaptureSectionBlockTable::Block& block = blocks.emplace_back();
+    block.set_offset(content.size() - kCaptureSectionOffset);
+    block.set_compressed_size(compressed_block.value().size());
+    block.set_uncompressed_size(uncompressed_block.size());
+    content.append(compressed_block.value());
+  }
+  CHECK(orbit_base::WriteFully(fd, content).has_value());
+  return blocks;
+}
+
+[[nodiscard]] std::string ReadAll(google::protobuf::io::ZeroCopyInputStream& input_stream) {
+  std::string result;
+  const void* data = nullptr;
+  int size = 0;
+  while (input_stream.Next(&data, &size)) {
+    result.append(static_cast<const char*>(data), size);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(BlockCompression, CompressAndDecompress) {
+  const std::string data(10'000, 'a');
+  ErrorMessageOr<std::string> compressed_data = CompressBlock(data);
+  ASSERT_TRUE(compressed_data.has_value()) << compressed_data.error().message();
+  EXPECT_LT(compressed_data.value().size(), data.size());
+
+  std::string decompressed_data(data.size(), '\0');
+  ASSERT_FALSE(DecompressBlock(compressed_data.value().data(), compressed_data.value().size(),
+                               decompressed_data.data(), decompressed_data.size())
+                   .has_error());
+  EXPECT_EQ(decompressed_data, data);
+
+  std::string too_large_buffer(data.size() + 1, '\0');
+  EXPECT_THAT(DecompressBlock(compressed_data.value().data(), compressed_data.value().size(),
+                              too_large_buffer.data(), too_large_buffer.size()),
+              HasError("instead of"));
+}
+
+TEST(CompressedBlocksInputStream, ReadsAllBlocks) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  // More blocks than can be pending at once.
+  std::vector<std::string> uncompressed_blocks;
+  std::string expected_content;
+  for (int i = 0; i < 20; ++i) {
+    uncompressed_blocks.push_back(absl::StrFormat("Block %d.", i));
+    expected_content.append(uncompressed_blocks.back());
+  }
+  std::vector<CaptureSectionBlockTable::Block> blocks =
+      WriteBlocks(temporary_file.fd(), uncompressed_blocks);
+
+  CompressedBlocksInputStream input_stream{temporary_file.fd(), kCaptureSectionOffset, blocks};
+  EXPECT_EQ(ReadAll(input_stream), expected_content);
+  EXPECT_EQ(input_stream.ByteCount(), expected_content.size());
+  EXPECT_FALSE(input_stream.GetLastError().has_value());
+}
+
+TEST(CompressedBlocksInputStream, StartsAtOffsetAndSkipsAndBacksUp) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::vector<CaptureSectionBlockTable::Block> blocks =
+      WriteBlocks(temporary_file.fd(), {"0123456789", "abcdefghij", "ABCDEFGHIJ"});
+
+  CompressedBlocksInputStream input_stream{temporary_file.fd(), kCaptureSectionOffset, blocks,
+                                           /*start_offset=*/13};
+  const void* data = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ((std::string_view{static_cast<const char*>(data), static_cast<size_t>(size)}),
+            "defghij");
+  input_stream.BackUp(2);
+  EXPECT_EQ(input_stream.ByteCount(), 5);
+
+  // Skips across the end of the second block.
+  ASSERT_TRUE(input_stream.Skip(4));
+  EXPECT_EQ(input_stream.ByteCount(), 9);
+  EXPECT_EQ(ReadAll(input_stream), "CDEFGHIJ");
+
+  EXPECT_FALSE(input_stream.Skip(1));
+}
+
+TEST(CompressedBlocksInputStream, ReportsCorruptedBlock) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::vector<CaptureSectionBlockTable::Block> blocks =
+      WriteBlocks(temporary_file.fd(), {"0123456789"});
+  blocks[0].set_uncompressed_size(5);
+
+  CompressedBlocksInputStream input_stream{temporary_file.fd(), kCaptureSectionOffset, blocks};
+  const void* data = nullptr;
+  int size = 0;
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  ASSERT_TRUE(input_stream.GetLastError().has_value());
+  EXPECT_THAT(input_stream.GetLastError().value().message(),
+              testing::HasSubstr("file is corrupted"));
+}
+
+}  // namespace orbit_capture_file_internal
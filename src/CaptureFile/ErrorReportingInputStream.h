@@ -0,0 +1,25 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ERROR_REPORTING_INPUT_STREAM_H_
+#define ERROR_REPORTING_INPUT_STREAM_H_
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include <optional>
+
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// A ZeroCopyInputStream that keeps the reason why it stopped returning data, which
+// ZeroCopyInputStream::Next on its own doesn't provide.
+class ErrorReportingInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  [[nodiscard]] virtual std::optional<ErrorMessage> GetLastError() const = 0;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // ERROR_REPORTING_INPUT_STREAM_H_
@@ -5,10 +5,9 @@
 #ifndef FILE_FRAGMENT_INPUT_STREAM_H_
 #define FILE_FRAGMENT_INPUT_STREAM_H_
 
-#include <google/protobuf/io/zero_copy_stream.h>
-
 #include <optional>
 
+#include "ErrorReportingInputStream.h"
 #include "OrbitBase/File.h"
 
 namespace orbit_capture_file_internal {
@@ -17,7 +16,7 @@ namespace orbit_capture_file_internal {
 // This class is used to read protos from capture file sections and makes sure
 // we do not overread into other sections of the file.
 // https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream
-class FileFragmentInputStream : public google::protobuf::io::ZeroCopyInputStream {
+class FileFragmentInputStream : public ErrorReportingInputStream {
  public:
   explicit FileFragmentInputStream(const orbit_base::unique_fd& fd, uint64_t file_offset,
                                    uint64_t size, size_t block_size = 1 << 16)
@@ -41,7 +40,7 @@ class FileFragmentInputStream : public google::protobuf::io::ZeroCopyInputStream
   bool Skip(int count) override;
   google::protobuf::int64 ByteCount() const override;
 
-  [[nodiscard]] std::optional<ErrorMessage> GetLastError() const { return last_error_; }
+  [[nodiscard]] std::optional<ErrorMessage> GetLastError() const override { return last_error_; }
 
  private:
   const orbit_base::unique_fd& fd_;
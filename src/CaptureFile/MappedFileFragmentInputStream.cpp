@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MappedFileFragmentInputStream.h"
+
+#include <absl/strings/str_format.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_capture_file_internal {
+
+ErrorMessageOr<std::unique_ptr<MappedFileFragmentInputStream>>
+MappedFileFragmentInputStream::Create(const orbit_base::unique_fd& fd, uint64_t file_offset,
+                                      uint64_t size, size_t chunk_size) {
+  CHECK(size > 0);
+  CHECK(chunk_size > 0);
+
+  // Accessing a mapping past the end of the file raises SIGBUS.
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to stat file: %s", SafeStrerror(errno))};
+  }
+  const auto file_size = static_cast<uint64_t>(file_stat.st_size);
+  if (file_offset >= file_size) {
+    return ErrorMessage{absl::StrFormat(
+        "Fragment at offset %d is past the end of the file (file size is %d)", file_offset,
+        file_size)};
+  }
+  const uint64_t fragment_end = std::min(file_offset + size, file_size);
+
+  const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t mapping_offset = file_offset - file_offset % page_size;
+  const uint64_t mapping_size = fragment_end - mapping_offset;
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd.get(),
+                       static_cast<off_t>(mapping_offset));
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("Unable to map file: %s", SafeStrerror(errno))};
+  }
+  if (madvise(mapping, mapping_size, MADV_SEQUENTIAL) != 0) {
+    ERROR("Calling madvise with MADV_SEQUENTIAL: %s", SafeStrerror(errno));
+  }
+
+  const uint64_t rounded_chunk_size = (chunk_size + page_size - 1) / page_size * page_size;
+  CHECK(rounded_chunk_size <= std::numeric_limits<int>::max());
+  std::unique_ptr<MappedFileFragmentInputStream> input_stream{new MappedFileFragmentInputStream{
+      static_cast<const uint8_t*>(mapping), mapping_size, file_offset - mapping_offset,
+      rounded_chunk_size}};
+  input_stream->ReadAhead(input_stream->fragment_start_);
+  return input_stream;
+}
+
+MappedFileFragmentInputStream::~MappedFileFragmentInputStream() {
+  if (munmap(const_cast<uint8_t*>(mapping_), mapping_size_) != 0) {
+    ERROR("Unmapping file fragment: %s", SafeStrerror(errno));
+  }
+}
+
+void MappedFileFragmentInputStream::ReadAhead(size_t position) const {
+  if (position >= mapping_size_) return;
+  // Chunks start at multiples of chunk_size_ from the start of the mapping, so they are page
+  // aligned as required by madvise.
+  const size_t chunk_start = position - position % chunk_size_;
+  const size_t chunk_length = std::min(chunk_size_, mapping_size_ - chunk_start);
+  // This is only a hint, so we don't report errors.
+  (void)madvise(const_cast<uint8_t*>(mapping_ + chunk_start), chunk_length, MADV_WILLNEED);
+}
+
+bool MappedFileFragmentInputStream::Next(const void** data, int* size) {
+  CHECK(data != nullptr);
+  CHECK(size != nullptr);
+
+  if (current_position_ >= mapping_size_) return false;
+
+  const size_t chunk_end =
+      std::min(current_position_ - current_position_ % chunk_size_ + chunk_size_, mapping_size_);
+  (*data) = mapping_ + current_position_;
+  (*size) = static_cast<int>(chunk_end - current_position_);
+  current_position_ = chunk_end;
+  ReadAhead(chunk_end);
+
+  return true;
+}
+
+void MappedFileFragmentInputStream::BackUp(int count) {
+  CHECK(count >= 0);
+  // As FileFragmentInputStream, we don't back up past the start of the fragment.
+  current_position_ -= std::min<size_t>(count, current_position_ - fragment_start_);
+}
+
+bool MappedFileFragmentInputStream::Skip(int count) {
+  CHECK(count >= 0);
+
+  current_position_ = std::min(mapping_size_, current_position_ + count);
+  return current_position_ < mapping_size_;
+}
+
+google::protobuf::int64 MappedFileFragmentInputStream::ByteCount() const {
+  return current_position_ - fragment_start_;
+}
+
+}  // namespace orbit_capture_file_internal
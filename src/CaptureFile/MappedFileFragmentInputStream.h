@@ -0,0 +1,66 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MAPPED_FILE_FRAGMENT_INPUT_STREAM_H_
+#define MAPPED_FILE_FRAGMENT_INPUT_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "ErrorReportingInputStream.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// Same as FileFragmentInputStream, but the fragment is memory mapped, so that Next returns data
+// directly from the page cache instead of copying it into a buffer with a read syscall each time.
+// The kernel is advised that the mapping is read sequentially, and told to read ahead the chunk
+// after the one returned by Next. Only available on Linux.
+class MappedFileFragmentInputStream : public ErrorReportingInputStream {
+ public:
+  // `chunk_size` is the maximum size returned by Next, and is rounded up to the page size. The
+  // fragment is truncated at the end of the file.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<MappedFileFragmentInputStream>> Create(
+      const orbit_base::unique_fd& fd, uint64_t file_offset, uint64_t size,
+      size_t chunk_size = 16 * 1024 * 1024);
+  ~MappedFileFragmentInputStream() override;
+
+  MappedFileFragmentInputStream(const MappedFileFragmentInputStream&) = delete;
+  MappedFileFragmentInputStream& operator=(const MappedFileFragmentInputStream&) = delete;
+
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  google::protobuf::int64 ByteCount() const override;
+
+  // Mapping errors are reported by Create, and reading from the mapping can't fail otherwise.
+  [[nodiscard]] std::optional<ErrorMessage> GetLastError() const override { return std::nullopt; }
+
+ private:
+  MappedFileFragmentInputStream(const uint8_t* mapping, size_t mapping_size,
+                                size_t fragment_start, size_t chunk_size)
+      : mapping_{mapping},
+        mapping_size_{mapping_size},
+        fragment_start_{fragment_start},
+        chunk_size_{chunk_size},
+        current_position_{fragment_start} {}
+
+  // Tells the kernel to read the chunk containing `position` ahead.
+  void ReadAhead(size_t position) const;
+
+  // The mapping starts at the page containing the start of the fragment and ends at the end of the
+  // fragment. Positions are relative to the start of the mapping.
+  const uint8_t* mapping_;
+  const size_t mapping_size_;
+  const size_t fragment_start_;
+  const size_t chunk_size_;
+  size_t current_position_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // MAPPED_FILE_FRAGMENT_INPUT_STREAM_H_
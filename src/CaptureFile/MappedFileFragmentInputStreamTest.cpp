@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+
+#include "MappedFileFragmentInputStream.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_base::HasError;
+
+TEST(MappedFileFragmentInputStream, ReadChunksOfOnePage) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  std::string content;
+  for (size_t i = 0; i < 3 * page_size; ++i) {
+    content.push_back(static_cast<char>('a' + i % 26));
+  }
+  auto write_result = orbit_base::WriteFully(temporary_file.fd(), content);
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+
+  // The fragment starts in the middle of the first page and ends in the middle of the third.
+  const size_t fragment_offset = page_size / 2;
+  const size_t fragment_size = 2 * page_size;
+  auto input_stream_or_error = MappedFileFragmentInputStream::Create(
+      temporary_file.fd(), fragment_offset, fragment_size, /*chunk_size=*/1);
+  ASSERT_TRUE(input_stream_or_error.has_value()) << input_stream_or_error.error().message();
+  MappedFileFragmentInputStream& input_stream = *input_stream_or_error.value();
+  EXPECT_EQ(input_stream.ByteCount(), 0);
+
+  // The chunks end at page boundaries.
+  const void* data = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ((std::string_view{static_cast<const char*>(data), static_cast<size_t>(size)}),
+            std::string_view(content).substr(fragment_offset, page_size - fragment_offset));
+
+  input_stream.BackUp(10);
+  EXPECT_EQ(input_stream.ByteCount(), page_size - fragment_offset - 10);
+  ASSERT_TRUE(input_stream.Skip(20));
+  EXPECT_EQ(input_stream.ByteCount(), page_size - fragment_offset + 10);
+
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ((std::string_view{static_cast<const char*>(data), static_cast<size_t>(size)}),
+            std::string_view(content).substr(page_size + 10, page_size - 10));
+
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ((std::string_view{static_cast<const char*>(data), static_cast<size_t>(size)}),
+            std::string_view(content).substr(2 * page_size, fragment_offset));
+  EXPECT_EQ(input_stream.ByteCount(), fragment_size);
+
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  EXPECT_FALSE(input_stream.Skip(1));
+  EXPECT_FALSE(input_stream.GetLastError().has_value());
+}
+
+TEST(MappedFileFragmentInputStream, TruncatesFragmentAtEndOfFile) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  auto write_result = orbit_base::WriteFully(temporary_file.fd(), "0123456789");
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+
+  auto input_stream_or_error = MappedFileFragmentInputStream::Create(temporary_file.fd(), 4, 100);
+  ASSERT_TRUE(input_stream_or_error.has_value()) << input_stream_or_error.error().message();
+  const void* data = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream_or_error.value()->Next(&data, &size));
+  EXPECT_EQ((std::string_view{static_cast<const char*>(data), static_cast<size_t>(size)}),
+            "456789");
+  EXPECT_FALSE(input_stream_or_error.value()->Next(&data, &size));
+
+  EXPECT_THAT(MappedFileFragmentInputStream::Create(temporary_file.fd(), 10, 1),
+              HasError("past the end of the file"));
+}
+
+}  // namespace orbit_capture_file_internal
@@ -5,7 +5,10 @@
 #ifndef PROTO_SECTION_INPUT_STREAM_IMPL_H_
 #define PROTO_SECTION_INPUT_STREAM_IMPL_H_
 
+#include <memory>
+
 #include "CaptureFile/ProtoSectionInputStream.h"
+#include "ErrorReportingInputStream.h"
 #include "FileFragmentInputStream.h"
 #include "OrbitBase/File.h"
 
@@ -16,15 +19,15 @@ class ProtoSectionInputStreamImpl : public orbit_capture_file::ProtoSectionInput
  public:
   explicit ProtoSectionInputStreamImpl(orbit_base::unique_fd& fd, uint64_t capture_section_offset,
                                        uint64_t capture_section_size)
-      : fd_{fd},
-        file_fragment_input_stream_{fd_, capture_section_offset, capture_section_size},
-        coded_input_stream_(&file_fragment_input_stream_) {}
+      : ProtoSectionInputStreamImpl{std::make_unique<FileFragmentInputStream>(
+            fd, capture_section_offset, capture_section_size)} {}
+  explicit ProtoSectionInputStreamImpl(std::unique_ptr<ErrorReportingInputStream> input_stream)
+      : input_stream_{std::move(input_stream)}, coded_input_stream_(input_stream_.get()) {}
 
   ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) override;
 
  private:
-  orbit_base::unique_fd& fd_;
-  FileFragmentInputStream file_fragment_input_stream_;
+  std::unique_ptr<ErrorReportingInputStream> input_stream_;
   google::protobuf::io::CodedInputStream coded_input_stream_;
 };
 
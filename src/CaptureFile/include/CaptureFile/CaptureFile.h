@@ -65,6 +65,11 @@ class CaptureFile {
 
   virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() = 0;
 
+  // Creates an input stream that starts reading the capture section at `offset_in_section`, which
+  // needs to be the offset of an event, for example from the CAPTURE_SECTION_INDEX section.
+  virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStreamAtOffset(
+      uint64_t offset_in_section) = 0;
+
   static ErrorMessageOr<std::unique_ptr<CaptureFile>> OpenForReadWrite(
       const std::filesystem::path& file_path);
 };
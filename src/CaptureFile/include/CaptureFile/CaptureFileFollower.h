@@ -0,0 +1,55 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_CAPTURE_FILE_FOLLOWER_H_
+#define CAPTURE_FILE_CAPTURE_FILE_FOLLOWER_H_
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file {
+
+// Reads the capture section of a capture file while a CaptureFileOutputStream, possibly in another
+// process, is still writing it, so that a capture can be followed live from the file instead of
+// streaming its events a second time. The writer writes whole events (or blocks) to the file at
+// least once per second and only updates the header once the capture section is complete, which
+// is what this class relies on. The file is only read: an in-progress file must not be opened with
+// CaptureFile::OpenForReadWrite, which would treat it as truncated and recover it.
+//
+// Usage example:
+//
+// auto follower_or_error = CaptureFileFollower::Open("path/to/file.capture");
+// ...
+// while (!follower->IsCaptureFinished()) {
+//   auto events_or_error = follower->ReadNewEvents();
+//   // Handle the error, process the events, and wait a bit if there were none.
+// }
+class CaptureFileFollower {
+ public:
+  virtual ~CaptureFileFollower() = default;
+
+  // Returns, in order, the complete events appended to the capture section since the previous
+  // call, which can be none if the writer hasn't written anything since. The last event returned
+  // is CaptureFinished, after which nothing is returned anymore. Returns an error if the file is
+  // corrupted, or if the writer has finished the file without a CaptureFinished event. The events
+  // read by one call are bounded, so that a call for a file that is already large doesn't read all
+  // of it at once. Note that a finished file of version 1 without additional sections can't be
+  // told apart from one still being written, which only matters if it lacks CaptureFinished.
+  [[nodiscard]] virtual ErrorMessageOr<std::vector<orbit_grpc_protos::ClientCaptureEvent>>
+  ReadNewEvents() = 0;
+
+  // Whether the CaptureFinished event has been returned by ReadNewEvents.
+  [[nodiscard]] virtual bool IsCaptureFinished() const = 0;
+
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<CaptureFileFollower>> Open(
+      const std::filesystem::path& file_path);
+};
+
+}  // namespace orbit_capture_file
+
+#endif  // CAPTURE_FILE_CAPTURE_FILE_FOLLOWER_H_
@@ -6,13 +6,26 @@
 #define CAPTURE_FILE_CAPTURE_FILE_HELPERS_H_
 
 #include <filesystem>
+#include <optional>
 
+#include "CaptureFile/CaptureFile.h"
 #include "OrbitBase/Result.h"
+#include "capture_section_index.pb.h"
+#include "capture_summary.pb.h"
 #include "user_defined_capture_info.pb.h"
 
 namespace orbit_capture_file {
 ErrorMessageOr<void> WriteUserData(
     const std::filesystem::path& capture_file_path,
     const orbit_client_protos::UserDefinedCaptureInfo& user_defined_capture_info);
+
+// Reads the CAPTURE_SECTION_INDEX section of the file, if it has one. The offsets of the entries
+// can be passed to CaptureFile::CreateCaptureSectionInputStreamAtOffset.
+ErrorMessageOr<std::optional<orbit_client_protos::CaptureSectionIndex>> ReadCaptureSectionIndex(
+    CaptureFile& capture_file);
+
+// Reads the CAPTURE_SUMMARY section of the file, if it has one.
+ErrorMessageOr<std::optional<orbit_client_protos::CaptureSummary>> ReadCaptureSummary(
+    CaptureFile& capture_file);
 }  // namespace orbit_capture_file
 #endif  // CAPTURE_FILE_CAPTURE_FILE_HELPERS_H_
\ No newline at end of file
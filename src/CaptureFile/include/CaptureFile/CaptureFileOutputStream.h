@@ -15,6 +15,24 @@
 
 namespace orbit_capture_file {
 
+enum class CaptureSectionCompression {
+  // The capture section is written as is, in a file of version 1.
+  kNone,
+  // The capture section is written in blocks of a few MB compressed independently with zlib, in a
+  // file of version 2. See src/CaptureFile/FORMAT.md.
+  kCompressedBlocks,
+};
+
+enum class CaptureFileWriteMode {
+  // The events are written to the file by the thread calling WriteCaptureEvent.
+  kSynchronous,
+  // The events are serialized (and compressed) by the thread calling WriteCaptureEvent, but written
+  // to the file by a dedicated thread, so that slow writes don't block the caller as long as the
+  // memory used by the events waiting to be written stays below a bound. A write error is returned
+  // by a later call to WriteCaptureEvent, or by Close.
+  kAsynchronous,
+};
+
 // This class in used for creating new capture file from
 // a stream of ClientCaptureEvents. If the file already exists
 // it is going to be overwritten. Appending to the existing file
@@ -53,7 +71,9 @@ class CaptureFileOutputStream {
   // Create new capture file output stream. If the file exists it is going to be
   // overwritten.
   [[nodiscard]] static ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> Create(
-      std::filesystem::path path);
+      std::filesystem::path path,
+      CaptureSectionCompression compression = CaptureSectionCompression::kNone,
+      CaptureFileWriteMode write_mode = CaptureFileWriteMode::kSynchronous);
 };
 
 }  // namespace orbit_capture_file
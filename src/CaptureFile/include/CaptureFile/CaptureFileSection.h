@@ -10,6 +10,12 @@
 namespace orbit_capture_file {
 
 constexpr uint64_t kSectionTypeUserData = 1;
+// The content is an orbit_client_protos::CaptureSectionIndex.
+constexpr uint64_t kSectionTypeCaptureSectionIndex = 2;
+// The content is an orbit_client_protos::CaptureSectionBlockTable. Only in files of version 2.
+constexpr uint64_t kSectionTypeCaptureSectionBlockTable = 3;
+// The content is an orbit_client_protos::CaptureSummary.
+constexpr uint64_t kSectionTypeCaptureSummary = 4;
 
 struct CaptureFileSection {
   uint64_t type;
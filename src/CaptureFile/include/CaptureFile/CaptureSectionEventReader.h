@@ -0,0 +1,58 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_CAPTURE_SECTION_EVENT_READER_H_
+#define CAPTURE_FILE_CAPTURE_SECTION_EVENT_READER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file {
+
+// Reads and parses the events of a capture section on a dedicated thread, ahead of the thread that
+// processes them, so that reading (and decompressing) the file and parsing the events overlap with
+// the processing. The events are returned in batches, in the order of the capture section. Reading
+// stops after the CaptureFinished event, as reading past it is not allowed (see
+// ProtoSectionInputStream::ReadMessage), or on the first error.
+class CaptureSectionEventReader {
+ public:
+  explicit CaptureSectionEventReader(std::unique_ptr<ProtoSectionInputStream> input_stream);
+  // Stops reading, without waiting for the remaining events to be read.
+  ~CaptureSectionEventReader();
+
+  CaptureSectionEventReader(const CaptureSectionEventReader&) = delete;
+  CaptureSectionEventReader& operator=(const CaptureSectionEventReader&) = delete;
+
+  // Blocks until the next batch of events has been read. Returns an empty batch once the batch
+  // ending with the CaptureFinished event has been returned, and the error that stopped the reading
+  // once all the batches before it have been returned.
+  [[nodiscard]] ErrorMessageOr<std::vector<orbit_grpc_protos::ClientCaptureEvent>> ReadEventBatch();
+
+ private:
+  void ReaderThread();
+
+  std::unique_ptr<ProtoSectionInputStream> input_stream_;
+
+  absl::Mutex mutex_;
+  std::deque<std::vector<orbit_grpc_protos::ClientCaptureEvent>> batches_ ABSL_GUARDED_BY(mutex_);
+  std::optional<ErrorMessage> error_ ABSL_GUARDED_BY(mutex_);
+  bool reading_finished_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::thread reader_thread_;
+};
+
+}  // namespace orbit_capture_file
+
+#endif  // CAPTURE_FILE_CAPTURE_SECTION_EVENT_READER_H_
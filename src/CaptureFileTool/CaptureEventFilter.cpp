@@ -0,0 +1,262 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureEventFilter.h"
+
+#include <absl/strings/str_format.h>
+#include <google/protobuf/descriptor.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_grpc_protos::CallstackSampleBatch;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FunctionCallBatch;
+using orbit_grpc_protos::SchedulingSliceBatch;
+
+namespace {
+
+struct TimeRange {
+  uint64_t start_timestamp_ns;
+  uint64_t end_timestamp_ns;
+};
+
+// Returns the time range of the events that are shown on the timeline, except for the batches.
+[[nodiscard]] std::optional<TimeRange> GetTimeRange(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kApiEvent:
+      return TimeRange{event.api_event().timestamp_ns(), event.api_event().timestamp_ns()};
+    case ClientCaptureEvent::kCallstackSample:
+      return TimeRange{event.callstack_sample().timestamp_ns(),
+                       event.callstack_sample().timestamp_ns()};
+    case ClientCaptureEvent::kCompactApiEvent:
+      return TimeRange{event.compact_api_event().timestamp_ns(),
+                       event.compact_api_event().timestamp_ns()};
+    case ClientCaptureEvent::kFunctionCall: {
+      const orbit_grpc_protos::FunctionCall& function_call = event.function_call();
+      return TimeRange{function_call.end_timestamp_ns() - function_call.duration_ns(),
+                       function_call.end_timestamp_ns()};
+    }
+    case ClientCaptureEvent::kGpuJob:
+      return TimeRange{event.gpu_job().amdgpu_cs_ioctl_time_ns(),
+                       std::max(event.gpu_job().amdgpu_cs_ioctl_time_ns(),
+                                event.gpu_job().dma_fence_signaled_time_ns())};
+    case ClientCaptureEvent::kGpuQueueSubmission: {
+      const orbit_grpc_protos::GpuQueueSubmissionMetaInfo& meta_info =
+          event.gpu_queue_submission().meta_info();
+      return TimeRange{meta_info.pre_submission_cpu_timestamp(),
+                       meta_info.post_submission_cpu_timestamp()};
+    }
+    case ClientCaptureEvent::kIntrospectionScope: {
+      const orbit_grpc_protos::IntrospectionScope& scope = event.introspection_scope();
+      return TimeRange{scope.end_timestamp_ns() - scope.duration_ns(), scope.end_timestamp_ns()};
+    }
+    case ClientCaptureEvent::kMemoryUsageEvent:
+      return TimeRange{event.memory_usage_event().timestamp_ns(),
+                       event.memory_usage_event().timestamp_ns()};
+    case ClientCaptureEvent::kPmuCountersSample: {
+      const orbit_grpc_protos::PmuCountersSample& sample = event.pmu_counters_sample();
+      return TimeRange{sample.end_timestamp_ns() - sample.duration_ns(), sample.end_timestamp_ns()};
+    }
+    case ClientCaptureEvent::kSchedulingSlice: {
+      const orbit_grpc_protos::SchedulingSlice& slice = event.scheduling_slice();
+      return TimeRange{slice.out_timestamp_ns() - slice.duration_ns(), slice.out_timestamp_ns()};
+    }
+    case ClientCaptureEvent::kThreadStateSlice: {
+      const orbit_grpc_protos::ThreadStateSlice& slice = event.thread_state_slice();
+      return TimeRange{slice.end_timestamp_ns() - slice.duration_ns(), slice.end_timestamp_ns()};
+    }
+    case ClientCaptureEvent::kTracepointEvent:
+      return TimeRange{event.tracepoint_event().timestamp_ns(),
+                       event.tracepoint_event().timestamp_ns()};
+    default:
+      return std::nullopt;
+  }
+}
+
+[[nodiscard]] ClientCaptureEvent::EventCase GetBatchedEventCase(
+    ClientCaptureEvent::EventCase event_case) {
+  switch (event_case) {
+    case ClientCaptureEvent::kCallstackSample:
+      return ClientCaptureEvent::kCallstackSampleBatch;
+    case ClientCaptureEvent::kFunctionCall:
+      return ClientCaptureEvent::kFunctionCallBatch;
+    case ClientCaptureEvent::kSchedulingSlice:
+      return ClientCaptureEvent::kSchedulingSliceBatch;
+    default:
+      return ClientCaptureEvent::EVENT_NOT_SET;
+  }
+}
+
+[[nodiscard]] uint64_t SaturatingAdd(uint64_t a, uint64_t b) {
+  return a > std::numeric_limits<uint64_t>::max() - b ? std::numeric_limits<uint64_t>::max()
+                                                      : a + b;
+}
+
+}  // namespace
+
+ErrorMessageOr<ClientCaptureEvent::EventCase> ParseEventCase(std::string_view name) {
+  const google::protobuf::OneofDescriptor* oneof_descriptor =
+      ClientCaptureEvent::descriptor()->FindOneofByName("event");
+  CHECK(oneof_descriptor != nullptr);
+  for (int i = 0; i < oneof_descriptor->field_count(); ++i) {
+    const google::protobuf::FieldDescriptor* field = oneof_descriptor->field(i);
+    if (field->name() == name) {
+      // The values of the EventCase enum are the field numbers.
+      return static_cast<ClientCaptureEvent::EventCase>(field->number());
+    }
+  }
+  return ErrorMessage{absl::StrFormat("Unknown event type \"%s\"", name)};
+}
+
+CaptureEventFilter::CaptureEventFilter(CaptureEventFilterOptions options)
+    : options_{std::move(options)} {
+  CHECK(!options_.dropped_event_cases.contains(ClientCaptureEvent::kCaptureStarted));
+  CHECK(!options_.dropped_event_cases.contains(ClientCaptureEvent::kCaptureFinished));
+  CHECK(options_.callstack_sample_period > 0);
+
+  std::vector<ClientCaptureEvent::EventCase> batched_event_cases;
+  for (ClientCaptureEvent::EventCase event_case : options_.dropped_event_cases) {
+    ClientCaptureEvent::EventCase batched_event_case = GetBatchedEventCase(event_case);
+    if (batched_event_case != ClientCaptureEvent::EVENT_NOT_SET) {
+      batched_event_cases.push_back(batched_event_case);
+    }
+  }
+  options_.dropped_event_cases.insert(batched_event_cases.begin(), batched_event_cases.end());
+}
+
+bool CaptureEventFilter::IsInTimeRange(uint64_t start_timestamp_ns,
+                                       uint64_t end_timestamp_ns) const {
+  if (options_.min_relative_timestamp_ns > 0 &&
+      end_timestamp_ns <
+          SaturatingAdd(capture_start_timestamp_ns_, options_.min_relative_timestamp_ns)) {
+    return false;
+  }
+  return start_timestamp_ns <=
+             SaturatingAdd(capture_start_timestamp_ns_, options_.max_relative_timestamp_ns);
+}
+
+bool CaptureEventFilter::KeepCallstackSample() {
+  return callstack_sample_count_++ % options_.callstack_sample_period == 0;
+}
+
+bool CaptureEventFilter::Filter(ClientCaptureEvent* event) {
+  if (options_.dropped_event_cases.contains(event->event_case())) return false;
+
+  switch (event->event_case()) {
+    case ClientCaptureEvent::kCaptureStarted:
+      capture_start_timestamp_ns_ = event->capture_started().capture_start_timestamp_ns();
+      return true;
+    case ClientCaptureEvent::kCallstackSample:
+      return IsInTimeRange(event->callstack_sample().timestamp_ns(),
+                           event->callstack_sample().timestamp_ns()) &&
+             KeepCallstackSample();
+    case ClientCaptureEvent::kCallstackSampleBatch:
+      return FilterCallstackSampleBatch(event->mutable_callstack_sample_batch());
+    case ClientCaptureEvent::kFunctionCallBatch:
+      return FilterFunctionCallBatch(event->mutable_function_call_batch());
+    case ClientCaptureEvent::kSchedulingSliceBatch:
+      return FilterSchedulingSliceBatch(event->mutable_scheduling_slice_batch());
+    default:
+      break;
+  }
+
+  std::optional<TimeRange> time_range = GetTimeRange(*event);
+  if (!time_range.has_value()) return true;
+  return IsInTimeRange(time_range->start_timestamp_ns, time_range->end_timestamp_ns);
+}
+
+// The batches with columns of different sizes are kept as they are, as the client discards them
+// anyway.
+
+bool CaptureEventFilter::FilterCallstackSampleBatch(CallstackSampleBatch* batch) {
+  const int size = batch->pid_size();
+  if (batch->tid_size() != size || batch->callstack_id_size() != size ||
+      batch->timestamp_ns_delta_size() != size || batch->off_cpu_duration_ns_size() != size) {
+    return true;
+  }
+
+  CallstackSampleBatch filtered_batch;
+  uint64_t timestamp_ns = 0;
+  uint64_t last_kept_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    timestamp_ns += static_cast<uint64_t>(batch->timestamp_ns_delta(i));
+    if (!IsInTimeRange(timestamp_ns, timestamp_ns) || !KeepCallstackSample()) continue;
+    filtered_batch.add_pid(batch->pid(i));
+    filtered_batch.add_tid(batch->tid(i));
+    filtered_batch.add_callstack_id(batch->callstack_id(i));
+    filtered_batch.add_timestamp_ns_delta(
+        static_cast<int64_t>(timestamp_ns - last_kept_timestamp_ns));
+    filtered_batch.add_off_cpu_duration_ns(batch->off_cpu_duration_ns(i));
+    last_kept_timestamp_ns = timestamp_ns;
+  }
+
+  if (filtered_batch.pid_size() != size) *batch = std::move(filtered_batch);
+  return batch->pid_size() > 0;
+}
+
+bool CaptureEventFilter::FilterFunctionCallBatch(FunctionCallBatch* batch) {
+  const int size = batch->pid_size();
+  if (batch->tid_size() != size || batch->function_id_size() != size ||
+      batch->duration_ns_size() != size || batch->end_timestamp_ns_delta_size() != size ||
+      batch->depth_size() != size || batch->return_value_size() != size) {
+    return true;
+  }
+
+  FunctionCallBatch filtered_batch;
+  uint64_t end_timestamp_ns = 0;
+  uint64_t last_kept_end_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    end_timestamp_ns += static_cast<uint64_t>(batch->end_timestamp_ns_delta(i));
+    if (!IsInTimeRange(end_timestamp_ns - batch->duration_ns(i), end_timestamp_ns)) continue;
+    filtered_batch.add_pid(batch->pid(i));
+    filtered_batch.add_tid(batch->tid(i));
+    filtered_batch.add_function_id(batch->function_id(i));
+    filtered_batch.add_duration_ns(batch->duration_ns(i));
+    filtered_batch.add_end_timestamp_ns_delta(
+        static_cast<int64_t>(end_timestamp_ns - last_kept_end_timestamp_ns));
+    filtered_batch.add_depth(batch->depth(i));
+    filtered_batch.add_return_value(batch->return_value(i));
+    last_kept_end_timestamp_ns = end_timestamp_ns;
+  }
+
+  if (filtered_batch.pid_size() != size) *batch = std::move(filtered_batch);
+  return batch->pid_size() > 0;
+}
+
+bool CaptureEventFilter::FilterSchedulingSliceBatch(SchedulingSliceBatch* batch) {
+  const int size = batch->pid_size();
+  if (batch->tid_size() != size || batch->core_size() != size ||
+      batch->duration_ns_size() != size || batch->out_timestamp_ns_delta_size() != size) {
+    return true;
+  }
+
+  SchedulingSliceBatch filtered_batch;
+  uint64_t out_timestamp_ns = 0;
+  uint64_t last_kept_out_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    out_timestamp_ns += static_cast<uint64_t>(batch->out_timestamp_ns_delta(i));
+    if (!IsInTimeRange(out_timestamp_ns - batch->duration_ns(i), out_timestamp_ns)) continue;
+    filtered_batch.add_pid(batch->pid(i));
+    filtered_batch.add_tid(batch->tid(i));
+    filtered_batch.add_core(batch->core(i));
+    filtered_batch.add_duration_ns(batch->duration_ns(i));
+    filtered_batch.add_out_timestamp_ns_delta(
+        static_cast<int64_t>(out_timestamp_ns - last_kept_out_timestamp_ns));
+    last_kept_out_timestamp_ns = out_timestamp_ns;
+  }
+
+  if (filtered_batch.pid_size() != size) *batch = std::move(filtered_batch);
+  return batch->pid_size() > 0;
+}
+
+}  // namespace orbit_capture_file_tool
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_TOOL_CAPTURE_EVENT_FILTER_H_
+#define CAPTURE_FILE_TOOL_CAPTURE_EVENT_FILTER_H_
+
+#include <absl/container/flat_hash_set.h>
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file_tool {
+
+struct CaptureEventFilterOptions {
+  // Only the events shown on the timeline that overlap this range, relative to the start of the
+  // capture, are kept. All the other events, e.g., interned strings and callstacks or module
+  // updates, are always kept, as any of the events in the range can refer to them. With a minimum
+  // of zero, the events that end before the start of the capture are kept as well.
+  uint64_t min_relative_timestamp_ns = 0;
+  uint64_t max_relative_timestamp_ns = std::numeric_limits<uint64_t>::max();
+  // The events of these types are dropped, together with their batched form, e.g., dropping
+  // kSchedulingSlice also drops kSchedulingSliceBatch. CaptureStarted and CaptureFinished can't be
+  // dropped.
+  absl::flat_hash_set<orbit_grpc_protos::ClientCaptureEvent::EventCase> dropped_event_cases;
+  // Only one in this many callstack samples in the time range is kept.
+  uint64_t callstack_sample_period = 1;
+};
+
+// Returns the event case with the field name `name` in the ClientCaptureEvent oneof, e.g.,
+// kSchedulingSlice for "scheduling_slice".
+[[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ClientCaptureEvent::EventCase> ParseEventCase(
+    std::string_view name);
+
+// Decides which events of a capture section, in the order they were written, to keep in a derived
+// capture. The rows of the batched events are filtered individually.
+class CaptureEventFilter {
+ public:
+  explicit CaptureEventFilter(CaptureEventFilterOptions options);
+
+  // Returns whether `event` is to be kept. A batch that is kept can have been modified to only
+  // contain the rows to keep.
+  [[nodiscard]] bool Filter(orbit_grpc_protos::ClientCaptureEvent* event);
+
+ private:
+  [[nodiscard]] bool IsInTimeRange(uint64_t start_timestamp_ns, uint64_t end_timestamp_ns) const;
+  // Counts a callstack sample in the time range and returns whether it is kept.
+  [[nodiscard]] bool KeepCallstackSample();
+  [[nodiscard]] bool FilterCallstackSampleBatch(orbit_grpc_protos::CallstackSampleBatch* batch);
+  [[nodiscard]] bool FilterFunctionCallBatch(orbit_grpc_protos::FunctionCallBatch* batch);
+  [[nodiscard]] bool FilterSchedulingSliceBatch(orbit_grpc_protos::SchedulingSliceBatch* batch);
+
+  CaptureEventFilterOptions options_;
+  uint64_t capture_start_timestamp_ns_ = 0;
+  uint64_t callstack_sample_count_ = 0;
+};
+
+}  // namespace orbit_capture_file_tool
+
+#endif  // CAPTURE_FILE_TOOL_CAPTURE_EVENT_FILTER_H_
@@ -0,0 +1,192 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "CaptureEventFilter.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_base::HasError;
+using orbit_base::HasValue;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr uint64_t kCaptureStartTimestampNs = 1'000'000;
+
+[[nodiscard]] ClientCaptureEvent CreateCaptureStartedEvent() {
+  ClientCaptureEvent event;
+  event.mutable_capture_started()->set_capture_start_timestamp_ns(kCaptureStartTimestampNs);
+  return event;
+}
+
+[[nodiscard]] ClientCaptureEvent CreateCallstackSampleEvent(uint64_t timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_callstack_sample()->set_timestamp_ns(timestamp_ns);
+  return event;
+}
+
+[[nodiscard]] ClientCaptureEvent CreateSchedulingSliceEvent(uint64_t out_timestamp_ns,
+                                                            uint64_t duration_ns) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(out_timestamp_ns);
+  event.mutable_scheduling_slice()->set_duration_ns(duration_ns);
+  return event;
+}
+
+[[nodiscard]] ClientCaptureEvent CreateInternedStringEvent(uint64_t key) {
+  ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(key);
+  return event;
+}
+
+}  // namespace
+
+TEST(CaptureEventFilter, ParseEventCase) {
+  ErrorMessageOr<ClientCaptureEvent::EventCase> event_case_or_error =
+      ParseEventCase("scheduling_slice");
+  ASSERT_THAT(event_case_or_error, HasValue());
+  EXPECT_EQ(event_case_or_error.value(), ClientCaptureEvent::kSchedulingSlice);
+  event_case_or_error = ParseEventCase("callstack_sample_batch");
+  ASSERT_THAT(event_case_or_error, HasValue());
+  EXPECT_EQ(event_case_or_error.value(), ClientCaptureEvent::kCallstackSampleBatch);
+  EXPECT_THAT(ParseEventCase("scheduling"), HasError("Unknown event type"));
+}
+
+TEST(CaptureEventFilter, KeepsEverythingByDefault) {
+  CaptureEventFilter filter{CaptureEventFilterOptions{}};
+  ClientCaptureEvent event = CreateCaptureStartedEvent();
+  EXPECT_TRUE(filter.Filter(&event));
+  event = CreateCallstackSampleEvent(0);
+  EXPECT_TRUE(filter.Filter(&event));
+  event = CreateSchedulingSliceEvent(kCaptureStartTimestampNs + 100, 200);
+  EXPECT_TRUE(filter.Filter(&event));
+  event = CreateInternedStringEvent(1);
+  EXPECT_TRUE(filter.Filter(&event));
+}
+
+TEST(CaptureEventFilter, KeepsTimedEventsOverlappingTheTimeRange) {
+  CaptureEventFilterOptions options;
+  options.min_relative_timestamp_ns = 100;
+  options.max_relative_timestamp_ns = 200;
+  CaptureEventFilter filter{options};
+  ClientCaptureEvent event = CreateCaptureStartedEvent();
+  EXPECT_TRUE(filter.Filter(&event));
+
+  event = CreateCallstackSampleEvent(kCaptureStartTimestampNs + 99);
+  EXPECT_FALSE(filter.Filter(&event));
+  event = CreateCallstackSampleEvent(kCaptureStartTimestampNs + 100);
+  EXPECT_TRUE(filter.Filter(&event));
+  event = CreateCallstackSampleEvent(kCaptureStartTimestampNs + 200);
+  EXPECT_TRUE(filter.Filter(&event));
+  event = CreateCallstackSampleEvent(kCaptureStartTimestampNs + 201);
+  EXPECT_FALSE(filter.Filter(&event));
+
+  // From 50 to 150.
+  event = CreateSchedulingSliceEvent(kCaptureStartTimestampNs + 150, 100);
+  EXPECT_TRUE(filter.Filter(&event));
+  // From 210 to 250.
+  event = CreateSchedulingSliceEvent(kCaptureStartTimestampNs + 250, 40);
+  EXPECT_FALSE(filter.Filter(&event));
+
+  event = CreateInternedStringEvent(1);
+  EXPECT_TRUE(filter.Filter(&event));
+}
+
+TEST(CaptureEventFilter, DropsEventTypesAndTheirBatches) {
+  CaptureEventFilterOptions options;
+  options.dropped_event_cases.insert(ClientCaptureEvent::kSchedulingSlice);
+  CaptureEventFilter filter{options};
+
+  ClientCaptureEvent event = CreateSchedulingSliceEvent(100, 10);
+  EXPECT_FALSE(filter.Filter(&event));
+  event.mutable_scheduling_slice_batch()->add_pid(1);
+  EXPECT_FALSE(filter.Filter(&event));
+  event = CreateCallstackSampleEvent(100);
+  EXPECT_TRUE(filter.Filter(&event));
+}
+
+TEST(CaptureEventFilter, DownsamplesCallstackSamplesAcrossBatches) {
+  CaptureEventFilterOptions options;
+  options.callstack_sample_period = 3;
+  CaptureEventFilter filter{options};
+
+  std::vector<bool> kept;
+  ClientCaptureEvent event;
+  for (uint64_t timestamp_ns = 10; timestamp_ns <= 40; timestamp_ns += 10) {
+    event = CreateCallstackSampleEvent(timestamp_ns);
+    kept.push_back(filter.Filter(&event));
+  }
+  EXPECT_THAT(kept, testing::ElementsAre(true, false, false, true));
+
+  // Samples at 50, 60, 70, 80, 90, 100. The next kept samples are the third and the sixth.
+  orbit_grpc_protos::CallstackSampleBatch* batch = event.mutable_callstack_sample_batch();
+  for (uint64_t callstack_id = 1; callstack_id <= 6; ++callstack_id) {
+    batch->add_pid(1);
+    batch->add_tid(2);
+    batch->add_callstack_id(callstack_id);
+    batch->add_timestamp_ns_delta(callstack_id == 1 ? 50 : 10);
+    batch->add_off_cpu_duration_ns(0);
+  }
+  ASSERT_TRUE(filter.Filter(&event));
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kCallstackSampleBatch);
+  EXPECT_THAT(event.callstack_sample_batch().callstack_id(), testing::ElementsAre(3, 6));
+  // The timestamps are still 70 and 100.
+  EXPECT_THAT(event.callstack_sample_batch().timestamp_ns_delta(), testing::ElementsAre(70, 30));
+  EXPECT_THAT(event.callstack_sample_batch().pid(), testing::ElementsAre(1, 1));
+  EXPECT_THAT(event.callstack_sample_batch().off_cpu_duration_ns(), testing::ElementsAre(0, 0));
+}
+
+TEST(CaptureEventFilter, FiltersTheRowsOfBatches) {
+  CaptureEventFilterOptions options;
+  options.min_relative_timestamp_ns = 100;
+  options.max_relative_timestamp_ns = 200;
+  CaptureEventFilter filter{options};
+  ClientCaptureEvent event = CreateCaptureStartedEvent();
+  EXPECT_TRUE(filter.Filter(&event));
+
+  // Function calls ending at 90, 150 and 300 after the start of the capture, lasting 20 each.
+  orbit_grpc_protos::FunctionCallBatch* batch = event.mutable_function_call_batch();
+  const std::vector<int64_t> end_timestamp_ns_deltas{
+      static_cast<int64_t>(kCaptureStartTimestampNs) + 90, 60, 150};
+  for (size_t i = 0; i < end_timestamp_ns_deltas.size(); ++i) {
+    const int64_t end_timestamp_ns_delta = end_timestamp_ns_deltas[i];
+    batch->add_pid(1);
+    batch->add_tid(2);
+    batch->add_function_id(i);
+    batch->add_duration_ns(20);
+    batch->add_end_timestamp_ns_delta(end_timestamp_ns_delta);
+    batch->add_depth(0);
+    batch->add_return_value(0);
+  }
+  ASSERT_TRUE(filter.Filter(&event));
+  ASSERT_EQ(event.function_call_batch().pid_size(), 1);
+  EXPECT_EQ(event.function_call_batch().function_id(0), 1);
+  EXPECT_EQ(event.function_call_batch().end_timestamp_ns_delta(0), kCaptureStartTimestampNs + 150);
+  EXPECT_EQ(event.function_call_batch().duration_ns(0), 20);
+
+  // No row in the range.
+  orbit_grpc_protos::SchedulingSliceBatch* scheduling_slice_batch =
+      event.mutable_scheduling_slice_batch();
+  scheduling_slice_batch->add_pid(1);
+  scheduling_slice_batch->add_tid(2);
+  scheduling_slice_batch->add_core(3);
+  scheduling_slice_batch->add_duration_ns(10);
+  scheduling_slice_batch->add_out_timestamp_ns_delta(kCaptureStartTimestampNs + 50);
+  EXPECT_FALSE(filter.Filter(&event));
+
+  // Batches with columns of different sizes are kept as they are.
+  scheduling_slice_batch->add_pid(1);
+  scheduling_slice_batch->add_pid(4);
+  EXPECT_TRUE(filter.Filter(&event));
+  EXPECT_EQ(event.scheduling_slice_batch().pid_size(), 2);
+}
+
+}  // namespace orbit_capture_file_tool
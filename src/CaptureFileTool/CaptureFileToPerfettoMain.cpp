@@ -0,0 +1,41 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include "ExportCaptureFileToPerfetto.h"
+#include "OrbitBase/Logging.h"
+
+ABSL_FLAG(std::string, input, "", "Path of the capture file to read");
+ABSL_FLAG(std::string, output, "", "Path of the Perfetto trace to write");
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Writes the function calls, scheduling slices, GPU jobs and memory usage of a capture file "
+      "as a Perfetto trace, which the Perfetto UI (ui.perfetto.dev) opens");
+  absl::ParseCommandLine(argc, argv);
+
+  const std::filesystem::path input_path = absl::GetFlag(FLAGS_input);
+  const std::filesystem::path output_path = absl::GetFlag(FLAGS_output);
+  FAIL_IF(input_path.empty(), "Input capture file not specified");
+  FAIL_IF(output_path.empty(), "Output trace file not specified");
+  // Opening the output would truncate the input.
+  std::error_code error_code;
+  FAIL_IF(std::filesystem::equivalent(input_path, output_path, error_code),
+          "The output trace file must be different from the input");
+
+  ErrorMessageOr<orbit_capture_file_tool::ExportCaptureFileToPerfettoStats> stats_or_error =
+      orbit_capture_file_tool::ExportCaptureFileToPerfetto(input_path, output_path);
+  FAIL_IF(stats_or_error.has_error(), "%s", stats_or_error.error().message());
+  LOG("Exported %u of the %u events of \"%s\" to \"%s\"",
+      stats_or_error.value().exported_event_count, stats_or_error.value().read_event_count,
+      input_path.string(), output_path.string());
+  return 0;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventFilter.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "FilterCaptureFile.h"
+#include "OrbitBase/Logging.h"
+#include "capture.pb.h"
+
+ABSL_FLAG(std::string, input, "", "Path of the capture file to read");
+ABSL_FLAG(std::string, output, "", "Path of the capture file to write");
+ABSL_FLAG(uint64_t, start_ms, 0,
+          "Only keep the events shown on the timeline that end after this many milliseconds from "
+          "the start of the capture");
+ABSL_FLAG(uint64_t, end_ms, std::numeric_limits<uint64_t>::max(),
+          "Only keep the events shown on the timeline that start before this many milliseconds "
+          "from the start of the capture");
+ABSL_FLAG(std::vector<std::string>, drop_events, {},
+          "Comma-separated list of the types of events to drop, as the field names in the "
+          "ClientCaptureEvent message, e.g., \"scheduling_slice,thread_state_slice\"");
+ABSL_FLAG(uint64_t, callstack_sample_period, 1,
+          "Only keep one callstack sample out of this many");
+ABSL_FLAG(bool, compress, false, "Write the capture section in compressed blocks");
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Writes a smaller capture file from a time range and a subset of the events of a capture "
+      "file");
+  absl::ParseCommandLine(argc, argv);
+
+  const std::filesystem::path input_path = absl::GetFlag(FLAGS_input);
+  const std::filesystem::path output_path = absl::GetFlag(FLAGS_output);
+  FAIL_IF(input_path.empty(), "Input capture file not specified");
+  FAIL_IF(output_path.empty(), "Output capture file not specified");
+  // Opening the output would truncate the input.
+  std::error_code error_code;
+  FAIL_IF(std::filesystem::equivalent(input_path, output_path, error_code),
+          "The output capture file must be different from the input");
+
+  orbit_capture_file_tool::CaptureEventFilterOptions options;
+  constexpr uint64_t kNsPerMs = 1'000'000;
+  const uint64_t start_ms = absl::GetFlag(FLAGS_start_ms);
+  const uint64_t end_ms = absl::GetFlag(FLAGS_end_ms);
+  FAIL_IF(start_ms > end_ms, "The start of the time range is after its end");
+  options.min_relative_timestamp_ns = start_ms * kNsPerMs;
+  options.max_relative_timestamp_ns = end_ms > std::numeric_limits<uint64_t>::max() / kNsPerMs
+                                          ? std::numeric_limits<uint64_t>::max()
+                                          : end_ms * kNsPerMs;
+
+  for (const std::string& event_name : absl::GetFlag(FLAGS_drop_events)) {
+    ErrorMessageOr<orbit_grpc_protos::ClientCaptureEvent::EventCase> event_case_or_error =
+        orbit_capture_file_tool::ParseEventCase(event_name);
+    FAIL_IF(event_case_or_error.has_error(), "%s", event_case_or_error.error().message());
+    FAIL_IF(event_case_or_error.value() == orbit_grpc_protos::ClientCaptureEvent::kCaptureStarted ||
+                event_case_or_error.value() ==
+                    orbit_grpc_protos::ClientCaptureEvent::kCaptureFinished,
+            "\"%s\" events can't be dropped", event_name);
+    options.dropped_event_cases.insert(event_case_or_error.value());
+  }
+
+  options.callstack_sample_period = absl::GetFlag(FLAGS_callstack_sample_period);
+  FAIL_IF(options.callstack_sample_period == 0, "The callstack sample period must be positive");
+
+  const orbit_capture_file::CaptureSectionCompression compression =
+      absl::GetFlag(FLAGS_compress)
+          ? orbit_capture_file::CaptureSectionCompression::kCompressedBlocks
+          : orbit_capture_file::CaptureSectionCompression::kNone;
+
+  ErrorMessageOr<orbit_capture_file_tool::FilterCaptureFileStats> stats_or_error =
+      orbit_capture_file_tool::FilterCaptureFile(input_path, output_path, std::move(options),
+                                                 compression);
+  FAIL_IF(stats_or_error.has_error(), "%s", stats_or_error.error().message());
+  LOG("Wrote %u of the %u events of \"%s\" to \"%s\"", stats_or_error.value().written_event_count,
+      stats_or_error.value().read_event_count, input_path.string(), output_path.string());
+  return 0;
+}
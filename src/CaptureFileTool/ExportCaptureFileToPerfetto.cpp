@@ -0,0 +1,493 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ExportCaptureFileToPerfetto.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureSectionEventReader.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/ThreadPool.h"
+#include "PerfettoTraceEncoder.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureSectionEventReader;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+// Each pending chunk holds a batch of events and its encoding, so this also bounds the memory used.
+constexpr size_t kMaxPendingChunks = 16;
+
+// The uuid of a track has the type of the track in the top byte and the pid, tid, core, etc. in
+// the other bytes, so that the tracks are identified the same in every chunk.
+enum class TrackType : uint64_t {
+  kProcess = 1,
+  kThread = 2,
+  kCore = 3,
+  kGpuQueue = 4,
+  kSystemMemoryCounter = 5,
+  kProcessMemoryCounter = 6,
+};
+
+[[nodiscard]] uint64_t MakeTrackUuid(TrackType type, uint64_t id) {
+  constexpr uint64_t kIdMask = (uint64_t{1} << 56) - 1;
+  return (static_cast<uint64_t>(type) << 56) | (id & kIdMask);
+}
+
+[[nodiscard]] uint64_t GetProcessTrackUuid(int32_t pid) {
+  return MakeTrackUuid(TrackType::kProcess, static_cast<uint32_t>(pid));
+}
+
+[[nodiscard]] uint64_t GetThreadTrackUuid(int32_t tid) {
+  return MakeTrackUuid(TrackType::kThread, static_cast<uint32_t>(tid));
+}
+
+[[nodiscard]] uint64_t GetCoreTrackUuid(int32_t core) {
+  return MakeTrackUuid(TrackType::kCore, static_cast<uint32_t>(core));
+}
+
+[[nodiscard]] uint64_t GetGpuQueueTrackUuid(uint64_t timeline_key, int32_t depth) {
+  return MakeTrackUuid(TrackType::kGpuQueue, (timeline_key << 8) | static_cast<uint8_t>(depth));
+}
+
+[[nodiscard]] uint64_t GetProcessMemoryTrackUuid(int32_t pid) {
+  return MakeTrackUuid(TrackType::kProcessMemoryCounter, static_cast<uint32_t>(pid));
+}
+
+const uint64_t kSystemMemoryTrackUuid = MakeTrackUuid(TrackType::kSystemMemoryCounter, 0);
+
+// The names the events refer to by id. They are copied on write, so that each chunk keeps the
+// names that were known when it was scheduled while the next chunks are read.
+struct CaptureNames {
+  int32_t pid = 0;
+  std::string process_name;
+  absl::flat_hash_map<uint64_t, std::string> function_names;
+  absl::flat_hash_map<int32_t, std::string> thread_names;
+  absl::flat_hash_map<uint64_t, std::string> interned_strings;
+};
+
+// The encoded events of a batch, and the tracks they are on, for which the track descriptors are
+// written before the events.
+struct EncodedChunk {
+  std::string packets;
+  uint64_t exported_event_count = 0;
+  // Pairs of pid and tid.
+  absl::flat_hash_set<std::pair<int32_t, int32_t>> threads;
+  absl::flat_hash_set<int32_t> cores;
+  // Pairs of timeline key and depth.
+  absl::flat_hash_set<std::pair<uint64_t, int32_t>> gpu_queues;
+  absl::flat_hash_set<int32_t> process_memory_pids;
+  bool has_system_memory = false;
+};
+
+[[nodiscard]] std::string GetThreadDisplayName(const CaptureNames& names, int32_t tid) {
+  auto it = names.thread_names.find(tid);
+  if (it == names.thread_names.end() || it->second.empty()) return absl::StrFormat("[%d]", tid);
+  return absl::StrFormat("%s [%d]", it->second, tid);
+}
+
+[[nodiscard]] std::string GetFunctionName(const CaptureNames& names, uint64_t function_id) {
+  auto it = names.function_names.find(function_id);
+  if (it == names.function_names.end()) return absl::StrFormat("[function %u]", function_id);
+  return it->second;
+}
+
+[[nodiscard]] std::string GetGpuQueueName(const CaptureNames& names, uint64_t timeline_key,
+                                          int32_t depth) {
+  auto it = names.interned_strings.find(timeline_key);
+  std::string timeline =
+      it != names.interned_strings.end() ? it->second : absl::StrFormat("[%u]", timeline_key);
+  if (depth == 0) return timeline;
+  return absl::StrFormat("%s (%d)", timeline, depth);
+}
+
+// Collects the slices of a chunk to write their begins and ends in timestamp order.
+class SliceEncoder {
+ public:
+  void AddSlice(uint64_t start_timestamp_ns, uint64_t end_timestamp_ns, uint64_t track_uuid,
+                int32_t depth, std::string name) {
+    if (end_timestamp_ns < start_timestamp_ns) return;
+    names_.push_back(std::move(name));
+    events_.push_back(
+        SliceEvent{start_timestamp_ns, /*is_begin=*/true, depth, track_uuid, names_.size() - 1});
+    events_.push_back(SliceEvent{end_timestamp_ns, /*is_begin=*/false, depth, track_uuid, 0});
+  }
+
+  // The end of a slice closes the last slice begun on the track, so at equal timestamps the ends
+  // come first, and the outer slices begin first. The trace processor keeps the events with equal
+  // timestamps in file order, which only leaves improperly nested the rare parent and child that
+  // begin at the same time in different chunks.
+  void Encode(PerfettoTraceEncoder* encoder) {
+    std::stable_sort(events_.begin(), events_.end(), [](const SliceEvent& lhs,
+                                                        const SliceEvent& rhs) {
+      if (lhs.timestamp_ns != rhs.timestamp_ns) return lhs.timestamp_ns < rhs.timestamp_ns;
+      if (lhs.is_begin != rhs.is_begin) return !lhs.is_begin;
+      return lhs.is_begin ? lhs.depth < rhs.depth : lhs.depth > rhs.depth;
+    });
+    for (const SliceEvent& event : events_) {
+      if (event.is_begin) {
+        encoder->AddSliceBegin(event.timestamp_ns, event.track_uuid, names_[event.name_index]);
+      } else {
+        encoder->AddSliceEnd(event.timestamp_ns, event.track_uuid);
+      }
+    }
+  }
+
+ private:
+  struct SliceEvent {
+    uint64_t timestamp_ns;
+    bool is_begin;
+    int32_t depth;
+    uint64_t track_uuid;
+    size_t name_index;
+  };
+  std::vector<SliceEvent> events_;
+  std::vector<std::string> names_;
+};
+
+void EncodeFunctionCall(const CaptureNames& names, int32_t pid, int32_t tid, uint64_t function_id,
+                        uint64_t duration_ns, uint64_t end_timestamp_ns, int32_t depth,
+                        SliceEncoder* slices, EncodedChunk* chunk) {
+  slices->AddSlice(end_timestamp_ns - duration_ns, end_timestamp_ns, GetThreadTrackUuid(tid),
+                   depth, GetFunctionName(names, function_id));
+  chunk->threads.emplace(pid, tid);
+  ++chunk->exported_event_count;
+}
+
+void EncodeSchedulingSlice(const CaptureNames& names, int32_t tid, int32_t core,
+                           uint64_t duration_ns, uint64_t out_timestamp_ns, SliceEncoder* slices,
+                           EncodedChunk* chunk) {
+  slices->AddSlice(out_timestamp_ns - duration_ns, out_timestamp_ns, GetCoreTrackUuid(core),
+                   /*depth=*/0, GetThreadDisplayName(names, tid));
+  chunk->cores.insert(core);
+  ++chunk->exported_event_count;
+}
+
+void EncodeGpuJob(const orbit_grpc_protos::GpuJob& gpu_job, SliceEncoder* slices,
+                  EncodedChunk* chunk) {
+  const uint64_t track_uuid = GetGpuQueueTrackUuid(gpu_job.timeline_key(), gpu_job.depth());
+  slices->AddSlice(gpu_job.amdgpu_cs_ioctl_time_ns(), gpu_job.amdgpu_sched_run_job_time_ns(),
+                   track_uuid, 0, "sw queue");
+  slices->AddSlice(gpu_job.amdgpu_sched_run_job_time_ns(), gpu_job.gpu_hardware_start_time_ns(),
+                   track_uuid, 0, "hw queue");
+  slices->AddSlice(gpu_job.gpu_hardware_start_time_ns(), gpu_job.dma_fence_signaled_time_ns(),
+                   track_uuid, 0, "hw execution");
+  chunk->gpu_queues.emplace(gpu_job.timeline_key(), gpu_job.depth());
+  ++chunk->exported_event_count;
+}
+
+void EncodeMemoryUsageEvent(const orbit_grpc_protos::MemoryUsageEvent& memory_usage_event,
+                            PerfettoTraceEncoder* encoder, EncodedChunk* chunk) {
+  // Missing values are negative.
+  if (memory_usage_event.has_system_memory_usage() &&
+      memory_usage_event.system_memory_usage().available_kb() >= 0) {
+    encoder->AddCounterValue(memory_usage_event.timestamp_ns(), kSystemMemoryTrackUuid,
+                             memory_usage_event.system_memory_usage().available_kb());
+    chunk->has_system_memory = true;
+  }
+  if (memory_usage_event.has_process_memory_usage() &&
+      memory_usage_event.process_memory_usage().rss_anon_kb() >= 0) {
+    const int32_t pid = memory_usage_event.process_memory_usage().pid();
+    encoder->AddCounterValue(memory_usage_event.timestamp_ns(), GetProcessMemoryTrackUuid(pid),
+                             memory_usage_event.process_memory_usage().rss_anon_kb());
+    chunk->process_memory_pids.insert(pid);
+  }
+  ++chunk->exported_event_count;
+}
+
+void EncodeFunctionCallBatch(const CaptureNames& names,
+                             const orbit_grpc_protos::FunctionCallBatch& batch,
+                             SliceEncoder* slices, EncodedChunk* chunk) {
+  const int size = batch.pid_size();
+  if (batch.tid_size() != size || batch.function_id_size() != size ||
+      batch.duration_ns_size() != size || batch.end_timestamp_ns_delta_size() != size ||
+      batch.depth_size() != size) {
+    return;
+  }
+  uint64_t end_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    end_timestamp_ns += static_cast<uint64_t>(batch.end_timestamp_ns_delta(i));
+    EncodeFunctionCall(names, batch.pid(i), batch.tid(i), batch.function_id(i),
+                       batch.duration_ns(i), end_timestamp_ns, batch.depth(i), slices, chunk);
+  }
+}
+
+void EncodeSchedulingSliceBatch(const CaptureNames& names,
+                                const orbit_grpc_protos::SchedulingSliceBatch& batch,
+                                SliceEncoder* slices, EncodedChunk* chunk) {
+  const int size = batch.pid_size();
+  if (batch.tid_size() != size || batch.core_size() != size ||
+      batch.duration_ns_size() != size || batch.out_timestamp_ns_delta_size() != size) {
+    return;
+  }
+  uint64_t out_timestamp_ns = 0;
+  for (int i = 0; i < size; ++i) {
+    out_timestamp_ns += static_cast<uint64_t>(batch.out_timestamp_ns_delta(i));
+    EncodeSchedulingSlice(names, batch.tid(i), batch.core(i), batch.duration_ns(i),
+                          out_timestamp_ns, slices, chunk);
+  }
+}
+
+[[nodiscard]] EncodedChunk EncodeChunk(const std::vector<ClientCaptureEvent>& events,
+                                       const CaptureNames& names) {
+  EncodedChunk chunk;
+  PerfettoTraceEncoder encoder;
+  SliceEncoder slices;
+  for (const ClientCaptureEvent& event : events) {
+    switch (event.event_case()) {
+      case ClientCaptureEvent::kFunctionCall: {
+        const orbit_grpc_protos::FunctionCall& function_call = event.function_call();
+        EncodeFunctionCall(names, function_call.pid(), function_call.tid(),
+                           function_call.function_id(), function_call.duration_ns(),
+                           function_call.end_timestamp_ns(), function_call.depth(), &slices,
+                           &chunk);
+        break;
+      }
+      case ClientCaptureEvent::kFunctionCallBatch:
+        EncodeFunctionCallBatch(names, event.function_call_batch(), &slices, &chunk);
+        break;
+      case ClientCaptureEvent::kSchedulingSlice: {
+        const orbit_grpc_protos::SchedulingSlice& scheduling_slice = event.scheduling_slice();
+        EncodeSchedulingSlice(names, scheduling_slice.tid(), scheduling_slice.core(),
+                              scheduling_slice.duration_ns(), scheduling_slice.out_timestamp_ns(),
+                              &slices, &chunk);
+        break;
+      }
+      case ClientCaptureEvent::kSchedulingSliceBatch:
+        EncodeSchedulingSliceBatch(names, event.scheduling_slice_batch(), &slices, &chunk);
+        break;
+      case ClientCaptureEvent::kGpuJob:
+        EncodeGpuJob(event.gpu_job(), &slices, &chunk);
+        break;
+      case ClientCaptureEvent::kMemoryUsageEvent:
+        EncodeMemoryUsageEvent(event.memory_usage_event(), &encoder, &chunk);
+        break;
+      default:
+        break;
+    }
+  }
+  slices.Encode(&encoder);
+  chunk.packets = encoder.TakeEncodedPackets();
+  return chunk;
+}
+
+// Reads the names from the events of a batch into `names`, which is copied first if it is shared
+// with a pending chunk.
+void UpdateNames(const std::vector<ClientCaptureEvent>& events,
+                 std::shared_ptr<const CaptureNames>* names) {
+  std::shared_ptr<CaptureNames> updated_names;
+  auto get_updated_names = [&]() -> CaptureNames& {
+    if (updated_names == nullptr) updated_names = std::make_shared<CaptureNames>(**names);
+    return *updated_names;
+  };
+
+  for (const ClientCaptureEvent& event : events) {
+    switch (event.event_case()) {
+      case ClientCaptureEvent::kCaptureStarted: {
+        const orbit_grpc_protos::CaptureStarted& capture_started = event.capture_started();
+        CaptureNames& capture_names = get_updated_names();
+        capture_names.pid = capture_started.process_id();
+        capture_names.process_name =
+            std::filesystem::path{capture_started.executable_path()}.filename().string();
+        for (const auto& function : capture_started.capture_options().instrumented_functions()) {
+          capture_names.function_names[function.function_id()] = function.function_name();
+        }
+        break;
+      }
+      case ClientCaptureEvent::kThreadName:
+        get_updated_names().thread_names[event.thread_name().tid()] = event.thread_name().name();
+        break;
+      case ClientCaptureEvent::kThreadNamesSnapshot:
+        for (const orbit_grpc_protos::ThreadName& thread_name :
+             event.thread_names_snapshot().thread_names()) {
+          get_updated_names().thread_names[thread_name.tid()] = thread_name.name();
+        }
+        break;
+      case ClientCaptureEvent::kInternedString:
+        get_updated_names().interned_strings[event.interned_string().key()] =
+            event.interned_string().intern();
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (updated_names != nullptr) *names = std::move(updated_names);
+}
+
+// Encodes the batches of events on a thread pool and writes the encoded chunks in order, each
+// after the descriptors of the tracks that appear for the first time in it.
+class PerfettoTraceWriter {
+ public:
+  explicit PerfettoTraceWriter(orbit_base::unique_fd fd) : fd_{std::move(fd)} {
+    const size_t thread_count =
+        std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxPendingChunks);
+    thread_pool_ = ThreadPool::Create(/*thread_pool_min_size=*/1,
+                                      /*thread_pool_max_size=*/thread_count,
+                                      /*thread_ttl=*/absl::Seconds(1));
+  }
+
+  ~PerfettoTraceWriter() {
+    // The pending tasks refer to the events and the chunks they own.
+    thread_pool_->ShutdownAndWait();
+  }
+
+  PerfettoTraceWriter(const PerfettoTraceWriter&) = delete;
+  PerfettoTraceWriter& operator=(const PerfettoTraceWriter&) = delete;
+
+  [[nodiscard]] ErrorMessageOr<void> AddEvents(std::vector<ClientCaptureEvent> events) {
+    if (pending_chunks_.size() >= kMaxPendingChunks) {
+      OUTCOME_TRY(WriteNextChunk());
+    }
+
+    UpdateNames(events, &names_);
+    auto shared_events = std::make_shared<const std::vector<ClientCaptureEvent>>(std::move(events));
+    auto chunk = std::make_shared<EncodedChunk>();
+    orbit_base::Future<void> encoded =
+        thread_pool_->Schedule([shared_events, names = names_, chunk]() {
+          *chunk = EncodeChunk(*shared_events, *names);
+        });
+    pending_chunks_.push_back(PendingChunk{names_, std::move(chunk), std::move(encoded)});
+    return outcome::success();
+  }
+
+  [[nodiscard]] ErrorMessageOr<uint64_t> Finish() {
+    while (!pending_chunks_.empty()) {
+      OUTCOME_TRY(WriteNextChunk());
+    }
+    return exported_event_count_;
+  }
+
+ private:
+  struct PendingChunk {
+    std::shared_ptr<const CaptureNames> names;
+    std::shared_ptr<EncodedChunk> chunk;
+    orbit_base::Future<void> encoded;
+  };
+
+  [[nodiscard]] ErrorMessageOr<void> WriteNextChunk() {
+    PendingChunk pending_chunk = std::move(pending_chunks_.front());
+    pending_chunks_.pop_front();
+    pending_chunk.encoded.Wait();
+    const CaptureNames& names = *pending_chunk.names;
+    const EncodedChunk& chunk = *pending_chunk.chunk;
+
+    PerfettoTraceEncoder descriptors;
+    for (const auto& [pid, tid] : chunk.threads) {
+      AddProcessTrackDescriptorIfNew(names, pid, &descriptors);
+      // The thread is described again when its name changes.
+      auto name_it = names.thread_names.find(tid);
+      const std::string& thread_name =
+          name_it != names.thread_names.end() ? name_it->second : kEmptyName;
+      auto [emitted_it, inserted] = emitted_thread_names_.try_emplace(tid, thread_name);
+      if (!inserted && emitted_it->second == thread_name) continue;
+      emitted_it->second = thread_name;
+      descriptors.AddThreadTrackDescriptor(GetThreadTrackUuid(tid), GetProcessTrackUuid(pid), pid,
+                                           tid, thread_name);
+    }
+    for (int32_t core : chunk.cores) {
+      if (!emitted_tracks_.insert(GetCoreTrackUuid(core)).second) continue;
+      descriptors.AddTrackDescriptor(GetCoreTrackUuid(core), 0, absl::StrFormat("CPU %d", core));
+    }
+    for (const auto& [timeline_key, depth] : chunk.gpu_queues) {
+      const uint64_t uuid = GetGpuQueueTrackUuid(timeline_key, depth);
+      if (!emitted_tracks_.insert(uuid).second) continue;
+      descriptors.AddTrackDescriptor(uuid, 0, GetGpuQueueName(names, timeline_key, depth));
+    }
+    if (chunk.has_system_memory && emitted_tracks_.insert(kSystemMemoryTrackUuid).second) {
+      descriptors.AddCounterTrackDescriptor(kSystemMemoryTrackUuid, 0,
+                                            "System memory available (kB)");
+    }
+    for (int32_t pid : chunk.process_memory_pids) {
+      AddProcessTrackDescriptorIfNew(names, pid, &descriptors);
+      if (!emitted_tracks_.insert(GetProcessMemoryTrackUuid(pid)).second) continue;
+      descriptors.AddCounterTrackDescriptor(GetProcessMemoryTrackUuid(pid),
+                                            GetProcessTrackUuid(pid), "RssAnon (kB)");
+    }
+
+    OUTCOME_TRY(orbit_base::WriteFully(fd_, descriptors.GetEncodedPackets()));
+    OUTCOME_TRY(orbit_base::WriteFully(fd_, chunk.packets));
+    exported_event_count_ += chunk.exported_event_count;
+    return outcome::success();
+  }
+
+  void AddProcessTrackDescriptorIfNew(const CaptureNames& names, int32_t pid,
+                                      PerfettoTraceEncoder* descriptors) {
+    if (!emitted_tracks_.insert(GetProcessTrackUuid(pid)).second) return;
+    descriptors->AddProcessTrackDescriptor(GetProcessTrackUuid(pid), pid,
+                                           pid == names.pid ? names.process_name : kEmptyName);
+  }
+
+  inline static const std::string kEmptyName;
+
+  orbit_base::unique_fd fd_;
+  std::shared_ptr<ThreadPool> thread_pool_;
+  std::shared_ptr<const CaptureNames> names_ = std::make_shared<const CaptureNames>();
+  std::deque<PendingChunk> pending_chunks_;
+  absl::flat_hash_set<uint64_t> emitted_tracks_;
+  absl::flat_hash_map<int32_t, std::string> emitted_thread_names_;
+  uint64_t exported_event_count_ = 0;
+};
+
+}  // namespace
+
+ErrorMessageOr<ExportCaptureFileToPerfettoStats> ExportCaptureFileToPerfetto(
+    const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
+  OUTCOME_TRY(input_file, CaptureFile::OpenForReadWrite(input_path));
+  CaptureSectionEventReader event_reader{input_file->CreateCaptureSectionInputStream()};
+  OUTCOME_TRY(output_fd, orbit_base::OpenFileForWriting(output_path));
+  auto writer = std::make_unique<PerfettoTraceWriter>(std::move(output_fd));
+
+  ExportCaptureFileToPerfettoStats stats;
+  auto remove_output_and_return = [&](const std::string& message) -> ErrorMessage {
+    // Don't leave an incomplete output file behind.
+    writer.reset();
+    (void)orbit_base::RemoveFile(output_path);
+    return ErrorMessage{message};
+  };
+  while (true) {
+    ErrorMessageOr<std::vector<ClientCaptureEvent>> events_or_error =
+        event_reader.ReadEventBatch();
+    if (events_or_error.has_error()) {
+      return remove_output_and_return(absl::StrFormat(
+          R"(Unable to read "%s": %s)", input_path.string(), events_or_error.error().message()));
+    }
+    // The last batch ends with the CaptureFinished event.
+    if (events_or_error.value().empty()) break;
+    stats.read_event_count += events_or_error.value().size();
+    ErrorMessageOr<void> result = writer->AddEvents(std::move(events_or_error.value()));
+    if (result.has_error()) {
+      return remove_output_and_return(absl::StrFormat(
+          R"(Unable to write "%s": %s)", output_path.string(), result.error().message()));
+    }
+  }
+
+  ErrorMessageOr<uint64_t> exported_event_count_or_error = writer->Finish();
+  if (exported_event_count_or_error.has_error()) {
+    return remove_output_and_return(
+        absl::StrFormat(R"(Unable to write "%s": %s)", output_path.string(),
+                        exported_event_count_or_error.error().message()));
+  }
+  stats.exported_event_count = exported_event_count_or_error.value();
+  return stats;
+}
+
+}  // namespace orbit_capture_file_tool
@@ -0,0 +1,34 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_TOOL_EXPORT_CAPTURE_FILE_TO_PERFETTO_H_
+#define CAPTURE_FILE_TOOL_EXPORT_CAPTURE_FILE_TO_PERFETTO_H_
+
+#include <cstdint>
+#include <filesystem>
+
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_tool {
+
+struct ExportCaptureFileToPerfettoStats {
+  uint64_t read_event_count = 0;
+  uint64_t exported_event_count = 0;
+};
+
+// Writes the capture section of the capture file at `input_path` as a Perfetto protobuf trace at
+// `output_path`, which the Perfetto UI and trace processor open, as does chrome://tracing.
+//
+// The function calls are exported as slices on the tracks of their threads, the scheduling slices
+// on a track per CPU core, the GPU jobs on a track per GPU timeline and depth, and the memory
+// usage as counters. The other events, e.g., the callstack samples, are not exported.
+//
+// The events are streamed: the capture is never loaded in a CaptureData, and the memory used does
+// not depend on the size of the capture. The batches of events are encoded in parallel.
+[[nodiscard]] ErrorMessageOr<ExportCaptureFileToPerfettoStats> ExportCaptureFileToPerfetto(
+    const std::filesystem::path& input_path, const std::filesystem::path& output_path);
+
+}  // namespace orbit_capture_file_tool
+
+#endif  // CAPTURE_FILE_TOOL_EXPORT_CAPTURE_FILE_TO_PERFETTO_H_
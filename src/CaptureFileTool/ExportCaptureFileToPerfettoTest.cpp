@@ -0,0 +1,258 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <gmock/gmock.h>
+#include <google/protobuf/unknown_field_set.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "ExportCaptureFileToPerfetto.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+#include "PerfettoTraceEncoder.h"
+
+namespace orbit_capture_file_tool {
+
+using google::protobuf::UnknownField;
+using google::protobuf::UnknownFieldSet;
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+using orbit_capture_file::CaptureFileOutputStream;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr int32_t kPid = 10;
+constexpr int32_t kTid = 11;
+constexpr int32_t kCore = 2;
+constexpr uint64_t kFooFunctionId = 1;
+constexpr uint64_t kBarFunctionId = 2;
+
+[[nodiscard]] orbit_base::TemporaryFile CreateTemporaryFile() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  EXPECT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  return temporary_file;
+}
+
+// Writes a capture where Foo calls Bar on the main thread, while the thread runs on one core.
+void WriteCaptureFile(const std::filesystem::path& path, bool write_capture_finished) {
+  auto output_stream_or_error = CaptureFileOutputStream::Create(path);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  ClientCaptureEvent event;
+  orbit_grpc_protos::CaptureStarted* capture_started = event.mutable_capture_started();
+  capture_started->set_process_id(kPid);
+  capture_started->set_executable_path("/path/to/game");
+  orbit_grpc_protos::InstrumentedFunction* foo =
+      capture_started->mutable_capture_options()->add_instrumented_functions();
+  foo->set_function_id(kFooFunctionId);
+  foo->set_function_name("Foo");
+  orbit_grpc_protos::InstrumentedFunction* bar =
+      capture_started->mutable_capture_options()->add_instrumented_functions();
+  bar->set_function_id(kBarFunctionId);
+  bar->set_function_name("Bar");
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+
+  orbit_grpc_protos::ThreadName* thread_name = event.mutable_thread_name();
+  thread_name->set_pid(kPid);
+  thread_name->set_tid(kTid);
+  thread_name->set_name("main");
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+
+  // The calls are written when they end, so the callee comes first.
+  orbit_grpc_protos::FunctionCall* function_call = event.mutable_function_call();
+  function_call->set_pid(kPid);
+  function_call->set_tid(kTid);
+  function_call->set_function_id(kBarFunctionId);
+  function_call->set_end_timestamp_ns(200);
+  function_call->set_duration_ns(50);
+  function_call->set_depth(1);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  function_call->set_function_id(kFooFunctionId);
+  function_call->set_end_timestamp_ns(300);
+  function_call->set_duration_ns(200);
+  function_call->set_depth(0);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+
+  orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+  scheduling_slice->set_pid(kPid);
+  scheduling_slice->set_tid(kTid);
+  scheduling_slice->set_core(kCore);
+  scheduling_slice->set_out_timestamp_ns(350);
+  scheduling_slice->set_duration_ns(300);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+
+  orbit_grpc_protos::MemoryUsageEvent* memory_usage_event = event.mutable_memory_usage_event();
+  memory_usage_event->set_timestamp_ns(400);
+  memory_usage_event->mutable_system_memory_usage()->set_available_kb(1000);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+
+  if (write_capture_finished) {
+    event.mutable_capture_finished();
+    ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+}
+
+[[nodiscard]] const UnknownField* FindField(const UnknownFieldSet& message, int number) {
+  for (int i = 0; i < message.field_count(); ++i) {
+    if (message.field(i).number() == number) return &message.field(i);
+  }
+  return nullptr;
+}
+
+[[nodiscard]] bool ParseMessageField(const UnknownFieldSet& message, int number,
+                                     UnknownFieldSet* nested_message) {
+  const UnknownField* field = FindField(message, number);
+  if (field == nullptr || field->type() != UnknownField::TYPE_LENGTH_DELIMITED) return false;
+  return nested_message->ParseFromString(field->length_delimited());
+}
+
+[[nodiscard]] uint64_t GetVarintField(const UnknownFieldSet& message, int number) {
+  const UnknownField* field = FindField(message, number);
+  return field != nullptr && field->type() == UnknownField::TYPE_VARINT ? field->varint() : 0;
+}
+
+[[nodiscard]] std::string GetStringField(const UnknownFieldSet& message, int number) {
+  const UnknownField* field = FindField(message, number);
+  return field != nullptr && field->type() == UnknownField::TYPE_LENGTH_DELIMITED
+             ? field->length_delimited()
+             : "";
+}
+
+// The fields of the TracePackets that the exporter writes.
+struct Trace {
+  // The names of the tracks by uuid: the process, thread or track name.
+  absl::flat_hash_map<uint64_t, std::string> track_names;
+  absl::flat_hash_map<uint64_t, uint64_t> track_parents;
+
+  struct TrackEvent {
+    uint64_t timestamp_ns;
+    uint64_t type;
+    uint64_t track_uuid;
+    std::string name;
+    uint64_t counter_value;
+  };
+  std::vector<TrackEvent> track_events;
+};
+
+[[nodiscard]] Trace ParseTrace(const std::string& bytes) {
+  Trace trace;
+  UnknownFieldSet trace_message;
+  EXPECT_TRUE(trace_message.ParseFromString(bytes));
+  for (int i = 0; i < trace_message.field_count(); ++i) {
+    EXPECT_EQ(trace_message.field(i).number(), 1);
+    UnknownFieldSet packet;
+    EXPECT_TRUE(packet.ParseFromString(trace_message.field(i).length_delimited()));
+    EXPECT_EQ(GetVarintField(packet, 10), PerfettoTraceEncoder::kTrustedPacketSequenceId);
+
+    UnknownFieldSet descriptor;
+    UnknownFieldSet track_event;
+    if (ParseMessageField(packet, 60, &descriptor)) {
+      const uint64_t uuid = GetVarintField(descriptor, 1);
+      std::string name = GetStringField(descriptor, 2);
+      UnknownFieldSet process;
+      if (ParseMessageField(descriptor, 3, &process)) name = GetStringField(process, 6);
+      UnknownFieldSet thread;
+      if (ParseMessageField(descriptor, 4, &thread)) {
+        EXPECT_EQ(GetVarintField(thread, 1), kPid);
+        EXPECT_EQ(GetVarintField(thread, 2), kTid);
+        name = GetStringField(thread, 5);
+      }
+      trace.track_names[uuid] = name;
+      trace.track_parents[uuid] = GetVarintField(descriptor, 5);
+    } else if (ParseMessageField(packet, 11, &track_event)) {
+      trace.track_events.push_back({GetVarintField(packet, 8), GetVarintField(track_event, 9),
+                                    GetVarintField(track_event, 11),
+                                    GetStringField(track_event, 23),
+                                    GetVarintField(track_event, 30)});
+    } else {
+      ADD_FAILURE() << "Unexpected packet";
+    }
+  }
+  return trace;
+}
+
+constexpr uint64_t kSliceBegin = 1;
+constexpr uint64_t kSliceEnd = 2;
+constexpr uint64_t kCounter = 4;
+
+}  // namespace
+
+TEST(ExportCaptureFileToPerfetto, WritesTracksAndEvents) {
+  orbit_base::TemporaryFile input_file = CreateTemporaryFile();
+  orbit_base::TemporaryFile output_file = CreateTemporaryFile();
+  ASSERT_NO_FATAL_FAILURE(WriteCaptureFile(input_file.file_path(), true));
+
+  ErrorMessageOr<ExportCaptureFileToPerfettoStats> stats_or_error =
+      ExportCaptureFileToPerfetto(input_file.file_path(), output_file.file_path());
+  ASSERT_THAT(stats_or_error, HasNoError());
+  EXPECT_EQ(stats_or_error.value().read_event_count, 7);
+  EXPECT_EQ(stats_or_error.value().exported_event_count, 4);
+
+  ErrorMessageOr<std::string> bytes_or_error =
+      orbit_base::ReadFileToString(output_file.file_path());
+  ASSERT_THAT(bytes_or_error, HasNoError());
+  Trace trace = ParseTrace(bytes_or_error.value());
+
+  // The counter is encoded before the slices, which are sorted by time.
+  const std::vector<Trace::TrackEvent>& events = trace.track_events;
+  ASSERT_EQ(events.size(), 7);
+  EXPECT_EQ(events[0].type, kCounter);
+  EXPECT_EQ(events[0].timestamp_ns, 400);
+  EXPECT_EQ(events[0].counter_value, 1000);
+  EXPECT_EQ(trace.track_names[events[0].track_uuid], "System memory available (kB)");
+
+  EXPECT_EQ(events[1].type, kSliceBegin);
+  EXPECT_EQ(events[1].timestamp_ns, 50);
+  EXPECT_EQ(events[1].name, "main [11]");
+  const uint64_t core_track_uuid = events[1].track_uuid;
+  EXPECT_EQ(trace.track_names[core_track_uuid], "CPU 2");
+
+  EXPECT_EQ(events[2].type, kSliceBegin);
+  EXPECT_EQ(events[2].timestamp_ns, 100);
+  EXPECT_EQ(events[2].name, "Foo");
+  const uint64_t thread_track_uuid = events[2].track_uuid;
+  EXPECT_EQ(trace.track_names[thread_track_uuid], "main");
+  EXPECT_EQ(trace.track_names[trace.track_parents[thread_track_uuid]], "game");
+
+  EXPECT_EQ(events[3].type, kSliceBegin);
+  EXPECT_EQ(events[3].timestamp_ns, 150);
+  EXPECT_EQ(events[3].name, "Bar");
+  EXPECT_EQ(events[3].track_uuid, thread_track_uuid);
+
+  EXPECT_EQ(events[4].type, kSliceEnd);
+  EXPECT_EQ(events[4].timestamp_ns, 200);
+  EXPECT_EQ(events[4].track_uuid, thread_track_uuid);
+  EXPECT_EQ(events[5].type, kSliceEnd);
+  EXPECT_EQ(events[5].timestamp_ns, 300);
+  EXPECT_EQ(events[5].track_uuid, thread_track_uuid);
+  EXPECT_EQ(events[6].type, kSliceEnd);
+  EXPECT_EQ(events[6].timestamp_ns, 350);
+  EXPECT_EQ(events[6].track_uuid, core_track_uuid);
+}
+
+TEST(ExportCaptureFileToPerfetto, RemovesTheOutputOnReadError) {
+  orbit_base::TemporaryFile input_file = CreateTemporaryFile();
+  orbit_base::TemporaryFile output_file = CreateTemporaryFile();
+  ASSERT_NO_FATAL_FAILURE(WriteCaptureFile(input_file.file_path(), false));
+
+  EXPECT_THAT(ExportCaptureFileToPerfetto(input_file.file_path(), output_file.file_path()),
+              HasError("Unable to read"));
+  EXPECT_FALSE(std::filesystem::exists(output_file.file_path()));
+}
+
+}  // namespace orbit_capture_file_tool
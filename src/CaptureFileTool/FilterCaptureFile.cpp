@@ -0,0 +1,63 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FilterCaptureFile.h"
+
+#include <absl/strings/str_format.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureSectionEventReader.h"
+#include "OrbitBase/File.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureFileOutputStream;
+using orbit_capture_file::CaptureFileWriteMode;
+using orbit_capture_file::CaptureSectionCompression;
+using orbit_capture_file::CaptureSectionEventReader;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+ErrorMessageOr<FilterCaptureFileStats> FilterCaptureFile(const std::filesystem::path& input_path,
+                                                         const std::filesystem::path& output_path,
+                                                         CaptureEventFilterOptions options,
+                                                         CaptureSectionCompression compression) {
+  OUTCOME_TRY(input_file, CaptureFile::OpenForReadWrite(input_path));
+  // Reading and parsing the input overlaps with filtering, and writing the output happens on yet
+  // another thread.
+  CaptureSectionEventReader event_reader{input_file->CreateCaptureSectionInputStream()};
+  OUTCOME_TRY(output_stream, CaptureFileOutputStream::Create(output_path, compression,
+                                                             CaptureFileWriteMode::kAsynchronous));
+
+  CaptureEventFilter filter{std::move(options)};
+  FilterCaptureFileStats stats;
+  while (true) {
+    ErrorMessageOr<std::vector<ClientCaptureEvent>> events_or_error =
+        event_reader.ReadEventBatch();
+    if (events_or_error.has_error()) {
+      // Don't leave an incomplete output file behind.
+      output_stream.reset();
+      (void)orbit_base::RemoveFile(output_path);
+      return ErrorMessage{absl::StrFormat(R"(Unable to read "%s": %s)", input_path.string(),
+                                          events_or_error.error().message())};
+    }
+    // The last batch ends with the CaptureFinished event.
+    if (events_or_error.value().empty()) break;
+    for (ClientCaptureEvent& event : events_or_error.value()) {
+      ++stats.read_event_count;
+      if (!filter.Filter(&event)) continue;
+      OUTCOME_TRY(output_stream->WriteCaptureEvent(event));
+      ++stats.written_event_count;
+    }
+  }
+
+  OUTCOME_TRY(output_stream->Close());
+  return stats;
+}
+
+}  // namespace orbit_capture_file_tool
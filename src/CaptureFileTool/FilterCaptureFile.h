@@ -0,0 +1,34 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_TOOL_FILTER_CAPTURE_FILE_H_
+#define CAPTURE_FILE_TOOL_FILTER_CAPTURE_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+
+#include "CaptureEventFilter.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_tool {
+
+struct FilterCaptureFileStats {
+  uint64_t read_event_count = 0;
+  uint64_t written_event_count = 0;
+};
+
+// Writes a new capture file at `output_path` with the events of the capture section of the capture
+// file at `input_path` that `CaptureEventFilter` keeps with `options`. The events are streamed from
+// one file to the other, so the capture is never entirely in memory. The other sections of the
+// input file, e.g., the user data, are not copied.
+[[nodiscard]] ErrorMessageOr<FilterCaptureFileStats> FilterCaptureFile(
+    const std::filesystem::path& input_path, const std::filesystem::path& output_path,
+    CaptureEventFilterOptions options,
+    orbit_capture_file::CaptureSectionCompression compression =
+        orbit_capture_file::CaptureSectionCompression::kNone);
+
+}  // namespace orbit_capture_file_tool
+
+#endif  // CAPTURE_FILE_TOOL_FILTER_CAPTURE_FILE_H_
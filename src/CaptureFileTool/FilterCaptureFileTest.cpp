@@ -0,0 +1,121 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "FilterCaptureFile.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureFileOutputStream;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr uint64_t kCaptureStartTimestampNs = 1'000'000;
+constexpr uint64_t kSampleCount = 100;
+
+[[nodiscard]] orbit_base::TemporaryFile CreateTemporaryFile() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  EXPECT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  return temporary_file;
+}
+
+// Writes a capture with an interned string and a callstack sample every 10 ns.
+void WriteCaptureFile(const std::filesystem::path& path, bool write_capture_finished) {
+  auto output_stream_or_error = CaptureFileOutputStream::Create(path);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  ClientCaptureEvent event;
+  event.mutable_capture_started()->set_capture_start_timestamp_ns(kCaptureStartTimestampNs);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  event.mutable_interned_string()->set_key(1);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  for (uint64_t i = 0; i < kSampleCount; ++i) {
+    event.mutable_callstack_sample()->set_callstack_id(i);
+    event.mutable_callstack_sample()->set_timestamp_ns(kCaptureStartTimestampNs + i * 10);
+    ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  if (write_capture_finished) {
+    event.mutable_capture_finished();
+    ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+}
+
+[[nodiscard]] std::vector<ClientCaptureEvent> ReadCaptureSection(
+    const std::filesystem::path& path) {
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(path);
+  EXPECT_THAT(capture_file_or_error, HasNoError());
+  if (capture_file_or_error.has_error()) return {};
+  auto capture_section = capture_file_or_error.value()->CreateCaptureSectionInputStream();
+  std::vector<ClientCaptureEvent> events;
+  while (events.empty() || events.back().event_case() != ClientCaptureEvent::kCaptureFinished) {
+    ClientCaptureEvent& event = events.emplace_back();
+    ErrorMessageOr<void> result = capture_section->ReadMessage(&event);
+    EXPECT_THAT(result, HasNoError());
+    if (result.has_error()) break;
+  }
+  return events;
+}
+
+}  // namespace
+
+TEST(FilterCaptureFile, WritesTheFilteredEvents) {
+  orbit_base::TemporaryFile input_file = CreateTemporaryFile();
+  orbit_base::TemporaryFile output_file = CreateTemporaryFile();
+  ASSERT_NO_FATAL_FAILURE(WriteCaptureFile(input_file.file_path(), true));
+
+  CaptureEventFilterOptions options;
+  options.min_relative_timestamp_ns = 200;
+  options.max_relative_timestamp_ns = 399;
+  options.callstack_sample_period = 2;
+  ErrorMessageOr<FilterCaptureFileStats> stats_or_error =
+      FilterCaptureFile(input_file.file_path(), output_file.file_path(), options,
+                        orbit_capture_file::CaptureSectionCompression::kCompressedBlocks);
+  ASSERT_THAT(stats_or_error, HasNoError());
+  EXPECT_EQ(stats_or_error.value().read_event_count, kSampleCount + 3);
+  // CaptureStarted, the interned string, 10 of the 20 samples in the time range, CaptureFinished.
+  EXPECT_EQ(stats_or_error.value().written_event_count, 13);
+
+  std::vector<ClientCaptureEvent> events = ReadCaptureSection(output_file.file_path());
+  ASSERT_EQ(events.size(), 13);
+  EXPECT_EQ(events[0].event_case(), ClientCaptureEvent::kCaptureStarted);
+  EXPECT_EQ(events[1].event_case(), ClientCaptureEvent::kInternedString);
+  for (size_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(events[i + 2].event_case(), ClientCaptureEvent::kCallstackSample);
+    EXPECT_EQ(events[i + 2].callstack_sample().callstack_id(), 20 + 2 * i);
+  }
+  EXPECT_EQ(events[12].event_case(), ClientCaptureEvent::kCaptureFinished);
+}
+
+TEST(FilterCaptureFile, RemovesTheOutputOnReadError) {
+  orbit_base::TemporaryFile input_file = CreateTemporaryFile();
+  orbit_base::TemporaryFile output_file = CreateTemporaryFile();
+  ASSERT_NO_FATAL_FAILURE(WriteCaptureFile(input_file.file_path(), false));
+
+  EXPECT_THAT(FilterCaptureFile(input_file.file_path(), output_file.file_path(),
+                                CaptureEventFilterOptions{}),
+              HasError("Unable to read"));
+  EXPECT_FALSE(std::filesystem::exists(output_file.file_path()));
+}
+
+}  // namespace orbit_capture_file_tool
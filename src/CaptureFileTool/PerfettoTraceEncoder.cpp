@@ -0,0 +1,175 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerfettoTraceEncoder.h"
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_file_tool {
+
+namespace {
+
+// The field numbers of the Perfetto protos.
+constexpr uint32_t kTracePacketField = 1;
+
+constexpr uint32_t kTracePacketTimestampField = 8;
+constexpr uint32_t kTracePacketTrustedPacketSequenceIdField = 10;
+constexpr uint32_t kTracePacketTrackEventField = 11;
+constexpr uint32_t kTracePacketTrackDescriptorField = 60;
+
+constexpr uint32_t kTrackDescriptorUuidField = 1;
+constexpr uint32_t kTrackDescriptorNameField = 2;
+constexpr uint32_t kTrackDescriptorProcessField = 3;
+constexpr uint32_t kTrackDescriptorThreadField = 4;
+constexpr uint32_t kTrackDescriptorParentUuidField = 5;
+constexpr uint32_t kTrackDescriptorCounterField = 8;
+
+constexpr uint32_t kProcessDescriptorPidField = 1;
+constexpr uint32_t kProcessDescriptorProcessNameField = 6;
+
+constexpr uint32_t kThreadDescriptorPidField = 1;
+constexpr uint32_t kThreadDescriptorTidField = 2;
+constexpr uint32_t kThreadDescriptorThreadNameField = 5;
+
+constexpr uint32_t kTrackEventTypeField = 9;
+constexpr uint32_t kTrackEventTrackUuidField = 11;
+constexpr uint32_t kTrackEventNameField = 23;
+constexpr uint32_t kTrackEventCounterValueField = 30;
+
+// TrackEvent.Type
+constexpr uint64_t kTypeSliceBegin = 1;
+constexpr uint64_t kTypeSliceEnd = 2;
+constexpr uint64_t kTypeCounter = 4;
+
+enum WireType : uint32_t { kVarint = 0, kLengthDelimited = 2 };
+
+void AppendVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+void AppendVarintField(uint32_t field_number, uint64_t value, std::string* output) {
+  AppendVarint((static_cast<uint64_t>(field_number) << 3) | kVarint, output);
+  AppendVarint(value, output);
+}
+
+void AppendLengthDelimitedField(uint32_t field_number, std::string_view bytes,
+                                std::string* output) {
+  AppendVarint((static_cast<uint64_t>(field_number) << 3) | kLengthDelimited, output);
+  AppendVarint(bytes.size(), output);
+  output->append(bytes);
+}
+
+// Negative int32 fields are sign-extended to 64 bits in the wire format.
+[[nodiscard]] uint64_t Int32ToVarint(int32_t value) {
+  return static_cast<uint64_t>(static_cast<int64_t>(value));
+}
+
+}  // namespace
+
+void PerfettoTraceEncoder::AddProcessTrackDescriptor(uint64_t uuid, int32_t pid,
+                                                     std::string_view process_name) {
+  CHECK(uuid != 0);
+  std::string process_descriptor;
+  AppendVarintField(kProcessDescriptorPidField, Int32ToVarint(pid), &process_descriptor);
+  AppendLengthDelimitedField(kProcessDescriptorProcessNameField, process_name,
+                             &process_descriptor);
+
+  std::string track_descriptor;
+  AppendVarintField(kTrackDescriptorUuidField, uuid, &track_descriptor);
+  AppendLengthDelimitedField(kTrackDescriptorProcessField, process_descriptor, &track_descriptor);
+  AddTrackDescriptorPacket(track_descriptor);
+}
+
+void PerfettoTraceEncoder::AddThreadTrackDescriptor(uint64_t uuid, uint64_t parent_uuid,
+                                                    int32_t pid, int32_t tid,
+                                                    std::string_view thread_name) {
+  CHECK(uuid != 0);
+  std::string thread_descriptor;
+  AppendVarintField(kThreadDescriptorPidField, Int32ToVarint(pid), &thread_descriptor);
+  AppendVarintField(kThreadDescriptorTidField, Int32ToVarint(tid), &thread_descriptor);
+  if (!thread_name.empty()) {
+    AppendLengthDelimitedField(kThreadDescriptorThreadNameField, thread_name, &thread_descriptor);
+  }
+
+  std::string track_descriptor;
+  AppendVarintField(kTrackDescriptorUuidField, uuid, &track_descriptor);
+  if (parent_uuid != 0) {
+    AppendVarintField(kTrackDescriptorParentUuidField, parent_uuid, &track_descriptor);
+  }
+  AppendLengthDelimitedField(kTrackDescriptorThreadField, thread_descriptor, &track_descriptor);
+  AddTrackDescriptorPacket(track_descriptor);
+}
+
+void PerfettoTraceEncoder::AddTrackDescriptor(uint64_t uuid, uint64_t parent_uuid,
+                                              std::string_view name) {
+  CHECK(uuid != 0);
+  std::string track_descriptor;
+  AppendVarintField(kTrackDescriptorUuidField, uuid, &track_descriptor);
+  AppendLengthDelimitedField(kTrackDescriptorNameField, name, &track_descriptor);
+  if (parent_uuid != 0) {
+    AppendVarintField(kTrackDescriptorParentUuidField, parent_uuid, &track_descriptor);
+  }
+  AddTrackDescriptorPacket(track_descriptor);
+}
+
+void PerfettoTraceEncoder::AddCounterTrackDescriptor(uint64_t uuid, uint64_t parent_uuid,
+                                                     std::string_view name) {
+  CHECK(uuid != 0);
+  std::string track_descriptor;
+  AppendVarintField(kTrackDescriptorUuidField, uuid, &track_descriptor);
+  AppendLengthDelimitedField(kTrackDescriptorNameField, name, &track_descriptor);
+  if (parent_uuid != 0) {
+    AppendVarintField(kTrackDescriptorParentUuidField, parent_uuid, &track_descriptor);
+  }
+  // An empty CounterDescriptor makes this a counter track.
+  AppendLengthDelimitedField(kTrackDescriptorCounterField, "", &track_descriptor);
+  AddTrackDescriptorPacket(track_descriptor);
+}
+
+void PerfettoTraceEncoder::AddSliceBegin(uint64_t timestamp_ns, uint64_t track_uuid,
+                                         std::string_view name) {
+  std::string track_event;
+  AppendVarintField(kTrackEventTypeField, kTypeSliceBegin, &track_event);
+  AppendVarintField(kTrackEventTrackUuidField, track_uuid, &track_event);
+  AppendLengthDelimitedField(kTrackEventNameField, name, &track_event);
+  AddTrackEventPacket(timestamp_ns, track_event);
+}
+
+void PerfettoTraceEncoder::AddSliceEnd(uint64_t timestamp_ns, uint64_t track_uuid) {
+  std::string track_event;
+  AppendVarintField(kTrackEventTypeField, kTypeSliceEnd, &track_event);
+  AppendVarintField(kTrackEventTrackUuidField, track_uuid, &track_event);
+  AddTrackEventPacket(timestamp_ns, track_event);
+}
+
+void PerfettoTraceEncoder::AddCounterValue(uint64_t timestamp_ns, uint64_t track_uuid,
+                                           int64_t value) {
+  std::string track_event;
+  AppendVarintField(kTrackEventTypeField, kTypeCounter, &track_event);
+  AppendVarintField(kTrackEventTrackUuidField, track_uuid, &track_event);
+  AppendVarintField(kTrackEventCounterValueField, static_cast<uint64_t>(value), &track_event);
+  AddTrackEventPacket(timestamp_ns, track_event);
+}
+
+void PerfettoTraceEncoder::AddTrackDescriptorPacket(const std::string& track_descriptor) {
+  std::string packet;
+  AppendVarintField(kTracePacketTrustedPacketSequenceIdField, kTrustedPacketSequenceId, &packet);
+  AppendLengthDelimitedField(kTracePacketTrackDescriptorField, track_descriptor, &packet);
+  AppendLengthDelimitedField(kTracePacketField, packet, &encoded_packets_);
+}
+
+void PerfettoTraceEncoder::AddTrackEventPacket(uint64_t timestamp_ns,
+                                               const std::string& track_event) {
+  std::string packet;
+  AppendVarintField(kTracePacketTimestampField, timestamp_ns, &packet);
+  AppendVarintField(kTracePacketTrustedPacketSequenceIdField, kTrustedPacketSequenceId, &packet);
+  AppendLengthDelimitedField(kTracePacketTrackEventField, track_event, &packet);
+  AppendLengthDelimitedField(kTracePacketField, packet, &encoded_packets_);
+}
+
+}  // namespace orbit_capture_file_tool
@@ -0,0 +1,53 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_TOOL_PERFETTO_TRACE_ENCODER_H_
+#define CAPTURE_FILE_TOOL_PERFETTO_TRACE_ENCODER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace orbit_capture_file_tool {
+
+// Encodes the TracePackets of a Perfetto trace (see protos/perfetto/trace/trace.proto in the
+// Perfetto repository) with track descriptors and track events. The Perfetto protos are not a
+// dependency of Orbit, so the few fields needed are encoded by hand in the protobuf wire format.
+//
+// A trace file is a Trace message, i.e., a sequence of `packet` fields, so the outputs of several
+// encoders can simply be concatenated. All packets use the same packet sequence, and the
+// timestamps are written in the default trace clock. A track uuid must not be 0.
+class PerfettoTraceEncoder {
+ public:
+  void AddProcessTrackDescriptor(uint64_t uuid, int32_t pid, std::string_view process_name);
+  void AddThreadTrackDescriptor(uint64_t uuid, uint64_t parent_uuid, int32_t pid, int32_t tid,
+                                std::string_view thread_name);
+  // A track that is neither a process nor a thread, e.g., a CPU core or a GPU queue.
+  // `parent_uuid` is 0 for a top-level track.
+  void AddTrackDescriptor(uint64_t uuid, uint64_t parent_uuid, std::string_view name);
+  void AddCounterTrackDescriptor(uint64_t uuid, uint64_t parent_uuid, std::string_view name);
+
+  // Slices on the same track have to be properly nested, and the end of a slice closes the last
+  // slice that was begun on the track.
+  void AddSliceBegin(uint64_t timestamp_ns, uint64_t track_uuid, std::string_view name);
+  void AddSliceEnd(uint64_t timestamp_ns, uint64_t track_uuid);
+  void AddCounterValue(uint64_t timestamp_ns, uint64_t track_uuid, int64_t value);
+
+  [[nodiscard]] const std::string& GetEncodedPackets() const { return encoded_packets_; }
+  [[nodiscard]] std::string TakeEncodedPackets() { return std::move(encoded_packets_); }
+
+  // The packet sequence of all packets, which is otherwise set by the tracing service.
+  static constexpr uint32_t kTrustedPacketSequenceId = 1;
+
+ private:
+  void AddTrackDescriptorPacket(const std::string& track_descriptor);
+  void AddTrackEventPacket(uint64_t timestamp_ns, const std::string& track_event);
+
+  std::string encoded_packets_;
+};
+
+}  // namespace orbit_capture_file_tool
+
+#endif  // CAPTURE_FILE_TOOL_PERFETTO_TRACE_ENCODER_H_
@@ -0,0 +1,287 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SyntheticCapture.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_capture_file::CaptureFileOutputStream;
+using orbit_capture_file::CaptureFileWriteMode;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr int32_t kPid = 10'000;
+constexpr uint64_t kCaptureStartTimestampNs = 1'000'000'000'000;
+constexpr const char* kExecutablePath = "/synthetic/bin/synthetic_app";
+constexpr const char* kModulePath = "/synthetic/lib/libsynthetic.so";
+constexpr uint64_t kModuleBaseAddress = 0x7f00'0000'0000;
+constexpr uint64_t kFunctionSize = 0x1000;
+// The sampled instruction of each function.
+constexpr uint64_t kOffsetInFunction = 0x10;
+constexpr uint64_t kModuleNameKey = 1;
+// The events are generated one window of time after the other, so that they are roughly in order.
+constexpr uint64_t kWindowNs = 1'000'000;
+
+[[nodiscard]] uint64_t GetFunctionNameKey(uint32_t function_index) { return 2 + function_index; }
+[[nodiscard]] uint64_t GetFunctionAddress(uint32_t function_index) {
+  return kModuleBaseAddress + function_index * kFunctionSize;
+}
+[[nodiscard]] int32_t GetTid(uint32_t thread_index) {
+  return kPid + static_cast<int32_t>(thread_index);
+}
+
+class SyntheticCaptureWriter {
+ public:
+  SyntheticCaptureWriter(CaptureFileOutputStream* output_stream,
+                         const SyntheticCaptureOptions& options)
+      : output_stream_{output_stream}, options_{options}, random_engine_{options.seed} {}
+
+  [[nodiscard]] ErrorMessageOr<SyntheticCaptureStats> Write() {
+    OUTCOME_TRY(WriteCaptureStarted());
+    OUTCOME_TRY(WriteSymbolsAndCallstacks());
+    OUTCOME_TRY(WriteThreadNames());
+
+    const uint64_t sample_period_ns =
+        options_.samples_per_second_per_thread == 0
+            ? 0
+            : 1'000'000'000 / options_.samples_per_second_per_thread;
+    const uint64_t function_call_period_ns =
+        options_.function_calls_per_second_per_thread == 0 ||
+                options_.instrumented_function_count == 0
+            ? 0
+            : 1'000'000'000 / options_.function_calls_per_second_per_thread;
+    const uint64_t scheduling_slice_duration_ns = options_.scheduling_slice_duration_us * 1'000;
+
+    // Streams are staggered, so that they don't all produce an event at the same time.
+    std::vector<uint64_t> next_sample_ns(options_.thread_count);
+    std::vector<uint64_t> next_function_call_ns(options_.thread_count);
+    for (uint32_t thread_index = 0; thread_index < options_.thread_count; ++thread_index) {
+      next_sample_ns[thread_index] =
+          kCaptureStartTimestampNs + sample_period_ns * thread_index / options_.thread_count;
+      next_function_call_ns[thread_index] =
+          kCaptureStartTimestampNs + function_call_period_ns * thread_index / options_.thread_count;
+    }
+    std::vector<uint64_t> next_scheduling_slice_end_ns(options_.core_count);
+    for (uint32_t core = 0; core < options_.core_count; ++core) {
+      next_scheduling_slice_end_ns[core] = kCaptureStartTimestampNs + scheduling_slice_duration_ns;
+    }
+
+    const uint64_t capture_end_ns = kCaptureStartTimestampNs + options_.duration_ms * 1'000'000;
+    for (uint64_t window_end_ns = kCaptureStartTimestampNs + kWindowNs;
+         window_end_ns <= capture_end_ns; window_end_ns += kWindowNs) {
+      if (scheduling_slice_duration_ns != 0 && options_.thread_count != 0) {
+        for (uint32_t core = 0; core < options_.core_count; ++core) {
+          while (next_scheduling_slice_end_ns[core] <= window_end_ns) {
+            OUTCOME_TRY(WriteSchedulingSlice(core, next_scheduling_slice_end_ns[core],
+                                             scheduling_slice_duration_ns));
+            next_scheduling_slice_end_ns[core] += scheduling_slice_duration_ns;
+          }
+        }
+      }
+
+      for (uint32_t thread_index = 0; thread_index < options_.thread_count; ++thread_index) {
+        if (function_call_period_ns != 0) {
+          while (next_function_call_ns[thread_index] + function_call_period_ns <= window_end_ns) {
+            OUTCOME_TRY(WriteNestedFunctionCalls(thread_index, next_function_call_ns[thread_index],
+                                                 function_call_period_ns * 3 / 4));
+            next_function_call_ns[thread_index] += function_call_period_ns;
+          }
+        }
+
+        if (sample_period_ns != 0 && options_.unique_callstack_count != 0) {
+          while (next_sample_ns[thread_index] < window_end_ns) {
+            OUTCOME_TRY(WriteCallstackSample(thread_index, next_sample_ns[thread_index]));
+            next_sample_ns[thread_index] += sample_period_ns;
+          }
+        }
+      }
+    }
+
+    ClientCaptureEvent event;
+    event.mutable_capture_finished()->set_status(orbit_grpc_protos::CaptureFinished::kSuccessful);
+    OUTCOME_TRY(WriteEvent(event));
+    return stats_;
+  }
+
+ private:
+  [[nodiscard]] ErrorMessageOr<void> WriteEvent(const ClientCaptureEvent& event) {
+    ++stats_.event_count;
+    return output_stream_->WriteCaptureEvent(event);
+  }
+
+  [[nodiscard]] ErrorMessageOr<void> WriteCaptureStarted() {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::CaptureStarted* capture_started = event.mutable_capture_started();
+    capture_started->set_process_id(kPid);
+    capture_started->set_executable_path(kExecutablePath);
+    capture_started->set_capture_start_timestamp_ns(kCaptureStartTimestampNs);
+    orbit_grpc_protos::CaptureOptions* capture_options = capture_started->mutable_capture_options();
+    capture_options->set_pid(kPid);
+    capture_options->set_samples_per_second(
+        static_cast<double>(options_.samples_per_second_per_thread));
+    capture_options->set_unwinding_method(orbit_grpc_protos::CaptureOptions::kDwarf);
+    capture_options->set_trace_context_switches(true);
+    // The instrumented functions are the first sampled functions.
+    for (uint32_t i = 0; i < options_.instrumented_function_count; ++i) {
+      orbit_grpc_protos::InstrumentedFunction* function =
+          capture_options->add_instrumented_functions();
+      function->set_function_id(1 + i);
+      function->set_file_path(kModulePath);
+      function->set_file_offset(i * kFunctionSize);
+      function->set_function_size(kFunctionSize);
+      function->set_function_name(absl::StrFormat("synthetic_function_%u", i));
+    }
+    return WriteEvent(event);
+  }
+
+  [[nodiscard]] ErrorMessageOr<void> WriteSymbolsAndCallstacks() {
+    ClientCaptureEvent event;
+    event.mutable_interned_string()->set_key(kModuleNameKey);
+    event.mutable_interned_string()->set_intern(kModulePath);
+    OUTCOME_TRY(WriteEvent(event));
+
+    const uint32_t function_count =
+        std::max(options_.sampled_function_count, options_.instrumented_function_count);
+    for (uint32_t function_index = 0; function_index < function_count; ++function_index) {
+      event.mutable_interned_string()->set_key(GetFunctionNameKey(function_index));
+      event.mutable_interned_string()->set_intern(
+          absl::StrFormat("synthetic_function_%u", function_index));
+      OUTCOME_TRY(WriteEvent(event));
+
+      orbit_grpc_protos::AddressInfo* address_info = event.mutable_address_info();
+      address_info->set_absolute_address(GetFunctionAddress(function_index) + kOffsetInFunction);
+      address_info->set_offset_in_function(kOffsetInFunction);
+      address_info->set_function_name_key(GetFunctionNameKey(function_index));
+      address_info->set_module_name_key(kModuleNameKey);
+      OUTCOME_TRY(WriteEvent(event));
+    }
+
+    // The outermost frame is always the same function, like main, and each other frame is picked
+    // among a subset of the functions depending on the frame above it, so that the callstacks share
+    // their outer frames as in a real call tree.
+    if (function_count == 0) return outcome::success();
+    for (uint32_t callstack_id = 0; callstack_id < options_.unique_callstack_count;
+         ++callstack_id) {
+      const uint32_t depth =
+          1 + static_cast<uint32_t>(random_engine_() % std::max(options_.max_callstack_depth, 1u));
+      std::vector<uint64_t> outermost_first_pcs;
+      uint32_t function_index = 0;
+      for (uint32_t frame = 0; frame < depth; ++frame) {
+        outermost_first_pcs.push_back(GetFunctionAddress(function_index) + kOffsetInFunction);
+        constexpr uint32_t kCalleesPerFunction = 4;
+        function_index = (function_index * kCalleesPerFunction + 1 +
+                          static_cast<uint32_t>(random_engine_() % kCalleesPerFunction)) %
+                         function_count;
+      }
+      orbit_grpc_protos::InternedCallstack* interned_callstack =
+          event.mutable_interned_callstack();
+      interned_callstack->set_key(callstack_id);
+      orbit_grpc_protos::Callstack* callstack = interned_callstack->mutable_intern();
+      callstack->set_type(orbit_grpc_protos::Callstack::kComplete);
+      callstack->clear_pcs();
+      for (auto it = outermost_first_pcs.rbegin(); it != outermost_first_pcs.rend(); ++it) {
+        callstack->add_pcs(*it);
+      }
+      OUTCOME_TRY(WriteEvent(event));
+    }
+    return outcome::success();
+  }
+
+  [[nodiscard]] ErrorMessageOr<void> WriteThreadNames() {
+    ClientCaptureEvent event;
+    for (uint32_t thread_index = 0; thread_index < options_.thread_count; ++thread_index) {
+      orbit_grpc_protos::ThreadName* thread_name = event.mutable_thread_name();
+      thread_name->set_pid(kPid);
+      thread_name->set_tid(GetTid(thread_index));
+      thread_name->set_name(absl::StrFormat("synthetic_%u", thread_index));
+      thread_name->set_timestamp_ns(kCaptureStartTimestampNs);
+      OUTCOME_TRY(WriteEvent(event));
+    }
+    return outcome::success();
+  }
+
+  [[nodiscard]] ErrorMessageOr<void> WriteSchedulingSlice(uint32_t core, uint64_t out_timestamp_ns,
+                                                          uint64_t duration_ns) {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+    scheduling_slice->set_pid(kPid);
+    scheduling_slice->set_tid(
+        GetTid(static_cast<uint32_t>(random_engine_() % options_.thread_count)));
+    scheduling_slice->set_core(static_cast<int32_t>(core));
+    scheduling_slice->set_duration_ns(duration_ns);
+    scheduling_slice->set_out_timestamp_ns(out_timestamp_ns);
+    ++stats_.scheduling_slice_count;
+    return WriteEvent(event);
+  }
+
+  // The call at each depth is nested in the one above it. The calls are produced in order of end
+  // timestamp, as the service would, so the innermost one first.
+  [[nodiscard]] ErrorMessageOr<void> WriteNestedFunctionCalls(uint32_t thread_index,
+                                                              uint64_t start_ns,
+                                                              uint64_t duration_ns) {
+    const uint32_t depth_count = std::max(options_.function_call_depth, 1u);
+    const uint64_t shrink_ns = duration_ns / (2 * depth_count);
+    ClientCaptureEvent event;
+    for (uint32_t depth = depth_count; depth-- > 0;) {
+      orbit_grpc_protos::FunctionCall* function_call = event.mutable_function_call();
+      function_call->set_pid(kPid);
+      function_call->set_tid(GetTid(thread_index));
+      function_call->set_function_id(
+          1 + random_engine_() % options_.instrumented_function_count);
+      function_call->set_duration_ns(duration_ns - 2 * depth * shrink_ns);
+      function_call->set_end_timestamp_ns(start_ns + duration_ns - depth * shrink_ns);
+      function_call->set_depth(static_cast<int32_t>(depth));
+      ++stats_.function_call_count;
+      OUTCOME_TRY(WriteEvent(event));
+    }
+    return outcome::success();
+  }
+
+  // Some callstacks are much more frequent than others, as in real captures.
+  [[nodiscard]] ErrorMessageOr<void> WriteCallstackSample(uint32_t thread_index,
+                                                          uint64_t timestamp_ns) {
+    const uint64_t callstack_count = options_.unique_callstack_count;
+    const uint64_t uniform = random_engine_() % callstack_count;
+    ClientCaptureEvent event;
+    orbit_grpc_protos::CallstackSample* callstack_sample = event.mutable_callstack_sample();
+    callstack_sample->set_pid(kPid);
+    callstack_sample->set_tid(GetTid(thread_index));
+    callstack_sample->set_callstack_id(uniform * uniform / callstack_count);
+    callstack_sample->set_timestamp_ns(timestamp_ns);
+    ++stats_.callstack_sample_count;
+    return WriteEvent(event);
+  }
+
+  CaptureFileOutputStream* output_stream_;
+  const SyntheticCaptureOptions& options_;
+  std::mt19937_64 random_engine_;
+  SyntheticCaptureStats stats_;
+};
+
+}  // namespace
+
+ErrorMessageOr<SyntheticCaptureStats> WriteSyntheticCaptureFile(
+    const std::filesystem::path& output_path, const SyntheticCaptureOptions& options,
+    orbit_capture_file::CaptureSectionCompression compression) {
+  OUTCOME_TRY(output_stream, CaptureFileOutputStream::Create(output_path, compression,
+                                                             CaptureFileWriteMode::kAsynchronous));
+  SyntheticCaptureWriter writer{output_stream.get(), options};
+  OUTCOME_TRY(stats, writer.Write());
+  OUTCOME_TRY(output_stream->Close());
+  return stats;
+}
+
+}  // namespace orbit_capture_file_tool
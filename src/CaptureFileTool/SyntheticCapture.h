@@ -0,0 +1,57 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_TOOL_SYNTHETIC_CAPTURE_H_
+#define CAPTURE_FILE_TOOL_SYNTHETIC_CAPTURE_H_
+
+#include <cstdint>
+#include <filesystem>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_tool {
+
+// Describes a synthetic capture of a single process, with the kinds of events that dominate the
+// size of real captures: callstack samples, calls to instrumented functions and scheduling slices.
+struct SyntheticCaptureOptions {
+  uint64_t duration_ms = 10'000;
+  uint32_t thread_count = 16;
+  uint32_t core_count = 8;
+
+  uint64_t samples_per_second_per_thread = 1'000;
+  uint32_t unique_callstack_count = 2'000;
+  // The sampled functions, from which the frames of the unique callstacks are picked.
+  uint32_t sampled_function_count = 500;
+  uint32_t max_callstack_depth = 32;
+
+  uint32_t instrumented_function_count = 20;
+  uint64_t function_calls_per_second_per_thread = 1'000;
+  // Each call at depth 0 contains a call at depth 1, and so on, up to this depth.
+  uint32_t function_call_depth = 3;
+
+  uint64_t scheduling_slice_duration_us = 2'000;
+
+  // The same seed always produces the same capture.
+  uint64_t seed = 0;
+};
+
+struct SyntheticCaptureStats {
+  uint64_t event_count = 0;
+  uint64_t callstack_sample_count = 0;
+  uint64_t function_call_count = 0;
+  uint64_t scheduling_slice_count = 0;
+};
+
+// Writes a capture file at `output_path` with a capture section generated from `options`, ending
+// with a successful CaptureFinished event. The events are generated in order of time and streamed
+// to the file, so that arbitrarily large captures can be generated, e.g., for benchmarks.
+[[nodiscard]] ErrorMessageOr<SyntheticCaptureStats> WriteSyntheticCaptureFile(
+    const std::filesystem::path& output_path, const SyntheticCaptureOptions& options,
+    orbit_capture_file::CaptureSectionCompression compression =
+        orbit_capture_file::CaptureSectionCompression::kNone);
+
+}  // namespace orbit_capture_file_tool
+
+#endif  // CAPTURE_FILE_TOOL_SYNTHETIC_CAPTURE_H_
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/Logging.h"
+#include "SyntheticCapture.h"
+
+namespace {
+const orbit_capture_file_tool::SyntheticCaptureOptions kDefaultOptions;
+}  // namespace
+
+ABSL_FLAG(std::string, output, "", "Path of the capture file to write");
+ABSL_FLAG(uint64_t, duration_ms, kDefaultOptions.duration_ms, "Duration of the capture");
+ABSL_FLAG(uint32_t, threads, kDefaultOptions.thread_count, "Number of threads of the process");
+ABSL_FLAG(uint32_t, cores, kDefaultOptions.core_count,
+          "Number of cores the threads are scheduled on");
+ABSL_FLAG(uint64_t, samples_per_second, kDefaultOptions.samples_per_second_per_thread,
+          "Callstack samples per second for each thread");
+ABSL_FLAG(uint32_t, unique_callstacks, kDefaultOptions.unique_callstack_count,
+          "Number of distinct callstacks the samples are taken from");
+ABSL_FLAG(uint32_t, sampled_functions, kDefaultOptions.sampled_function_count,
+          "Number of functions the frames of the callstacks are taken from");
+ABSL_FLAG(uint32_t, max_callstack_depth, kDefaultOptions.max_callstack_depth,
+          "Maximum number of frames of a callstack");
+ABSL_FLAG(uint32_t, instrumented_functions, kDefaultOptions.instrumented_function_count,
+          "Number of instrumented functions");
+ABSL_FLAG(uint64_t, function_calls_per_second, kDefaultOptions.function_calls_per_second_per_thread,
+          "Outermost calls to instrumented functions per second for each thread");
+ABSL_FLAG(uint32_t, function_call_depth, kDefaultOptions.function_call_depth,
+          "Number of nested calls to instrumented functions in each outermost call");
+ABSL_FLAG(uint64_t, scheduling_slice_duration_us, kDefaultOptions.scheduling_slice_duration_us,
+          "Duration of each scheduling slice, or 0 for no scheduling slices");
+ABSL_FLAG(uint64_t, seed, kDefaultOptions.seed, "Seed of the generated capture");
+ABSL_FLAG(bool, compress, false, "Write the capture section in compressed blocks");
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Writes a capture file of a synthetic process with the given amount of callstack samples, "
+      "calls to instrumented functions and scheduling slices, e.g., to benchmark capture loading");
+  absl::ParseCommandLine(argc, argv);
+
+  const std::filesystem::path output_path = absl::GetFlag(FLAGS_output);
+  FAIL_IF(output_path.empty(), "Output capture file not specified");
+
+  orbit_capture_file_tool::SyntheticCaptureOptions options;
+  options.duration_ms = absl::GetFlag(FLAGS_duration_ms);
+  options.thread_count = absl::GetFlag(FLAGS_threads);
+  options.core_count = absl::GetFlag(FLAGS_cores);
+  options.samples_per_second_per_thread = absl::GetFlag(FLAGS_samples_per_second);
+  options.unique_callstack_count = absl::GetFlag(FLAGS_unique_callstacks);
+  options.sampled_function_count = absl::GetFlag(FLAGS_sampled_functions);
+  options.max_callstack_depth = absl::GetFlag(FLAGS_max_callstack_depth);
+  options.instrumented_function_count = absl::GetFlag(FLAGS_instrumented_functions);
+  options.function_calls_per_second_per_thread = absl::GetFlag(FLAGS_function_calls_per_second);
+  options.function_call_depth = absl::GetFlag(FLAGS_function_call_depth);
+  options.scheduling_slice_duration_us = absl::GetFlag(FLAGS_scheduling_slice_duration_us);
+  options.seed = absl::GetFlag(FLAGS_seed);
+  FAIL_IF(options.thread_count == 0, "The number of threads must be positive");
+  FAIL_IF(options.samples_per_second_per_thread > 1'000'000'000 ||
+              options.function_calls_per_second_per_thread > 1'000'000'000,
+          "At most one event per nanosecond can be generated for each thread");
+  FAIL_IF(options.unique_callstack_count != 0 && options.sampled_function_count == 0 &&
+              options.instrumented_function_count == 0,
+          "Callstacks require at least one function");
+
+  const orbit_capture_file::CaptureSectionCompression compression =
+      absl::GetFlag(FLAGS_compress)
+          ? orbit_capture_file::CaptureSectionCompression::kCompressedBlocks
+          : orbit_capture_file::CaptureSectionCompression::kNone;
+
+  ErrorMessageOr<orbit_capture_file_tool::SyntheticCaptureStats> stats_or_error =
+      orbit_capture_file_tool::WriteSyntheticCaptureFile(output_path, options, compression);
+  FAIL_IF(stats_or_error.has_error(), "%s", stats_or_error.error().message());
+  const orbit_capture_file_tool::SyntheticCaptureStats& stats = stats_or_error.value();
+  LOG("Wrote %u events to \"%s\": %u callstack samples, %u function calls, %u scheduling slices",
+      stats.event_count, output_path.string(), stats.callstack_sample_count,
+      stats.function_call_count, stats.scheduling_slice_count);
+  return 0;
+}
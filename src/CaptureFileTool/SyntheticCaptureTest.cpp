@@ -0,0 +1,137 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+#include "SyntheticCapture.h"
+
+namespace orbit_capture_file_tool {
+
+using orbit_base::HasNoError;
+using orbit_capture_file::CaptureFile;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+[[nodiscard]] orbit_base::TemporaryFile CreateTemporaryFile() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  EXPECT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  return temporary_file;
+}
+
+[[nodiscard]] SyntheticCaptureOptions CreateSmallOptions() {
+  SyntheticCaptureOptions options;
+  options.duration_ms = 10;
+  options.thread_count = 2;
+  options.core_count = 1;
+  options.samples_per_second_per_thread = 1'000;
+  options.unique_callstack_count = 10;
+  options.sampled_function_count = 5;
+  options.max_callstack_depth = 4;
+  options.instrumented_function_count = 2;
+  options.function_calls_per_second_per_thread = 1'000;
+  options.function_call_depth = 2;
+  options.scheduling_slice_duration_us = 500;
+  return options;
+}
+
+[[nodiscard]] std::vector<ClientCaptureEvent> ReadCaptureSection(
+    const std::filesystem::path& path) {
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(path);
+  EXPECT_THAT(capture_file_or_error, HasNoError());
+  if (capture_file_or_error.has_error()) return {};
+  auto capture_section = capture_file_or_error.value()->CreateCaptureSectionInputStream();
+  std::vector<ClientCaptureEvent> events;
+  while (events.empty() || events.back().event_case() != ClientCaptureEvent::kCaptureFinished) {
+    ClientCaptureEvent& event = events.emplace_back();
+    ErrorMessageOr<void> result = capture_section->ReadMessage(&event);
+    EXPECT_THAT(result, HasNoError());
+    if (result.has_error()) break;
+  }
+  return events;
+}
+
+}  // namespace
+
+TEST(SyntheticCapture, WritesTheRequestedEvents) {
+  orbit_base::TemporaryFile file = CreateTemporaryFile();
+  ErrorMessageOr<SyntheticCaptureStats> stats_or_error =
+      WriteSyntheticCaptureFile(file.file_path(), CreateSmallOptions());
+  ASSERT_THAT(stats_or_error, HasNoError());
+  const SyntheticCaptureStats& stats = stats_or_error.value();
+  // One sample per millisecond for each thread.
+  EXPECT_EQ(stats.callstack_sample_count, 20u);
+  // Two nested calls per millisecond for each thread, except for the last call of the second
+  // thread, which would end after the capture.
+  EXPECT_EQ(stats.function_call_count, 38u);
+  EXPECT_EQ(stats.scheduling_slice_count, 20u);
+  // CaptureStarted, 1 + 5 interned strings, 5 address infos, 10 callstacks, 2 thread names, the
+  // samples, calls and slices, and CaptureFinished.
+  EXPECT_EQ(stats.event_count, 103u);
+
+  std::vector<ClientCaptureEvent> events = ReadCaptureSection(file.file_path());
+  ASSERT_EQ(events.size(), stats.event_count);
+  ASSERT_EQ(events.front().event_case(), ClientCaptureEvent::kCaptureStarted);
+  EXPECT_EQ(events.front().capture_started().capture_options().instrumented_functions_size(), 2);
+  EXPECT_EQ(events.back().capture_finished().status(),
+            orbit_grpc_protos::CaptureFinished::kSuccessful);
+
+  uint64_t callstack_count = 0;
+  uint64_t previous_sample_timestamp_ns = 0;
+  for (const ClientCaptureEvent& event : events) {
+    if (event.event_case() == ClientCaptureEvent::kInternedCallstack) {
+      ++callstack_count;
+      EXPECT_GE(event.interned_callstack().intern().pcs_size(), 1);
+      EXPECT_LE(event.interned_callstack().intern().pcs_size(), 4);
+    } else if (event.event_case() == ClientCaptureEvent::kCallstackSample) {
+      EXPECT_LT(event.callstack_sample().callstack_id(), 10u);
+      EXPECT_GE(event.callstack_sample().timestamp_ns(), previous_sample_timestamp_ns);
+      previous_sample_timestamp_ns = event.callstack_sample().timestamp_ns();
+    } else if (event.event_case() == ClientCaptureEvent::kFunctionCall) {
+      EXPECT_GE(event.function_call().function_id(), 1u);
+      EXPECT_LE(event.function_call().function_id(), 2u);
+    }
+  }
+  EXPECT_EQ(callstack_count, 10u);
+}
+
+TEST(SyntheticCapture, SameSeedWritesTheSameCapture) {
+  orbit_base::TemporaryFile file0 = CreateTemporaryFile();
+  orbit_base::TemporaryFile file1 = CreateTemporaryFile();
+  orbit_base::TemporaryFile file2 = CreateTemporaryFile();
+  SyntheticCaptureOptions options = CreateSmallOptions();
+  ASSERT_THAT(WriteSyntheticCaptureFile(file0.file_path(), options), HasNoError());
+  ASSERT_THAT(
+      WriteSyntheticCaptureFile(file1.file_path(), options,
+                                orbit_capture_file::CaptureSectionCompression::kCompressedBlocks),
+      HasNoError());
+  options.seed = 1;
+  ASSERT_THAT(WriteSyntheticCaptureFile(file2.file_path(), options), HasNoError());
+
+  std::vector<ClientCaptureEvent> events0 = ReadCaptureSection(file0.file_path());
+  std::vector<ClientCaptureEvent> events1 = ReadCaptureSection(file1.file_path());
+  std::vector<ClientCaptureEvent> events2 = ReadCaptureSection(file2.file_path());
+  ASSERT_EQ(events0.size(), events1.size());
+  ASSERT_EQ(events0.size(), events2.size());
+  bool differs_with_other_seed = false;
+  for (size_t i = 0; i < events0.size(); ++i) {
+    EXPECT_EQ(events0[i].SerializeAsString(), events1[i].SerializeAsString());
+    if (events0[i].SerializeAsString() != events2[i].SerializeAsString()) {
+      differs_with_other_seed = true;
+    }
+  }
+  EXPECT_TRUE(differs_with_other_seed);
+}
+
+}  // namespace orbit_capture_file_tool
@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "ClientData/AppendOnlyIntervalIndex.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace orbit_client_data {
+
+namespace {
+
+struct Interval {
+  uint64_t begin = 0;
+  uint64_t end = 0;
+};
+
+struct IntervalTraits {
+  static uint64_t GetBegin(const Interval& interval) { return interval.begin; }
+  static uint64_t GetEnd(const Interval& interval) { return interval.end; }
+};
+
+using Index = AppendOnlyIntervalIndex<Interval, IntervalTraits>;
+
+std::vector<uint64_t> GetBeginsOfIntervalsInTimeRange(const Index& index, uint64_t min,
+                                                      uint64_t max) {
+  std::vector<uint64_t> begins;
+  index.ForEachIntervalIntersectingTimeRange(
+      min, max, [&begins](const Interval& interval) { begins.push_back(interval.begin); });
+  return begins;
+}
+
+}  // namespace
+
+TEST(AppendOnlyIntervalIndex, Empty) {
+  Index index;
+  EXPECT_TRUE(index.empty());
+  EXPECT_THAT(GetBeginsOfIntervalsInTimeRange(index, 0, 100), IsEmpty());
+}
+
+TEST(AppendOnlyIntervalIndex, ForEachIntervalIntersectingTimeRange) {
+  // Many chunks. Interval i covers [10 * i, 10 * i + 5].
+  static constexpr uint64_t kIntervalCount = 10'000;
+  Index index;
+  for (uint64_t i = 0; i < kIntervalCount; ++i) index.Append({10 * i, 10 * i + 5});
+  EXPECT_EQ(index.size(), kIntervalCount);
+
+  EXPECT_THAT(GetBeginsOfIntervalsInTimeRange(index, 0, 1), ElementsAre(0));
+  EXPECT_THAT(GetBeginsOfIntervalsInTimeRange(index, 16, 31), ElementsAre(20, 30));
+  // Which intervals are included at the bounds: those ending at `min` and not those beginning at
+  // `max`.
+  EXPECT_THAT(GetBeginsOfIntervalsInTimeRange(index, 50'005, 50'020), ElementsAre(50'000, 50'010));
+  EXPECT_THAT(GetBeginsOfIntervalsInTimeRange(index, 10 * kIntervalCount, 20 * kIntervalCount),
+              IsEmpty());
+  EXPECT_EQ(GetBeginsOfIntervalsInTimeRange(index, 0, 10 * kIntervalCount).size(), kIntervalCount);
+}
+
+TEST(AppendOnlyIntervalIndex, LongIntervalIsFoundFromLaterChunks) {
+  Index index;
+  index.Append({0, 1'000'000});
+  for (uint64_t i = 1; i < 5000; ++i) index.Append({10 * i, 10 * i + 5});
+  EXPECT_THAT(GetBeginsOfIntervalsInTimeRange(index, 40'006, 40'007), ElementsAre(0));
+}
+
+TEST(AppendOnlyIntervalIndex, ReadWhileAppending) {
+  static constexpr uint64_t kIntervalCount = 100'000;
+  Index index;
+  std::atomic<bool> done = false;
+
+  std::thread reader([&index, &done] {
+    while (!done) {
+      size_t size_before = index.size();
+      uint64_t expected_begin = 0;
+      size_t count = 0;
+      index.ForEachIntervalIntersectingTimeRange(
+          0, std::numeric_limits<uint64_t>::max(),
+          [&expected_begin, &count](const Interval& interval) {
+            EXPECT_EQ(interval.begin, expected_begin);
+            EXPECT_EQ(interval.end, expected_begin + 1);
+            expected_begin += 2;
+            ++count;
+          });
+      EXPECT_GE(count, size_before);
+    }
+  });
+
+  for (uint64_t i = 0; i < kIntervalCount; ++i) index.Append({2 * i, 2 * i + 1});
+  done = true;
+  reader.join();
+  EXPECT_EQ(index.size(), kIntervalCount);
+}
+
+}  // namespace orbit_client_data
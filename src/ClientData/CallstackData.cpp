@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <utility>
 
@@ -23,8 +24,11 @@ void CallstackData::AddCallstackEvent(CallstackEvent callstack_event) {
   std::lock_guard lock(mutex_);
   CHECK(unique_callstacks_.contains(callstack_event.callstack_id()));
   RegisterTime(callstack_event.time());
-  callstack_events_by_tid_[callstack_event.thread_id()][callstack_event.time()] =
-      std::move(callstack_event);
+  GetOrCreateCallstackEventsOfTid(callstack_event.thread_id()).Add(callstack_event);
+}
+
+CallstackEventColumns& CallstackData::GetOrCreateCallstackEventsOfTid(int32_t thread_id) {
+  return callstack_events_by_tid_.try_emplace(thread_id, thread_id).first->second;
 }
 
 void CallstackData::RegisterTime(uint64_t time) {
@@ -52,16 +56,11 @@ std::vector<orbit_client_protos::CallstackEvent> CallstackData::GetCallstackEven
     uint64_t time_begin, uint64_t time_end) const {
   std::lock_guard lock(mutex_);
   std::vector<CallstackEvent> callstack_events;
-  for (const auto& tid_and_events : callstack_events_by_tid_) {
-    const std::map<uint64_t, CallstackEvent>& events = tid_and_events.second;
-    for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-      uint64_t time = event_it->first;
-      if (time < time_end) {
-        callstack_events.push_back(event_it->second);
-      } else {
-        break;
-      }
-    }
+  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
+    const size_t begin_index = events.LowerBound(time_begin);
+    events.ForEachEventInIndexRange(
+        begin_index, std::max(begin_index, events.LowerBound(time_end)),
+        [&callstack_events](const CallstackEvent& event) { callstack_events.push_back(event); });
   }
   return callstack_events;
 }
@@ -75,6 +74,18 @@ absl::flat_hash_map<int32_t, uint32_t> CallstackData::GetCallstackEventsCountsPe
   return counts;
 }
 
+absl::flat_hash_map<int32_t, uint32_t> CallstackData::GetCallstackEventsCountsPerTidInTimeRange(
+    uint64_t time_begin, uint64_t time_end) const {
+  std::lock_guard lock(mutex_);
+  absl::flat_hash_map<int32_t, uint32_t> counts;
+  for (const auto& [tid, events] : callstack_events_by_tid_) {
+    const size_t begin_index = events.LowerBound(time_begin);
+    const size_t end_index = events.LowerBound(time_end);
+    if (end_index > begin_index) counts.emplace(tid, end_index - begin_index);
+  }
+  return counts;
+}
+
 uint32_t CallstackData::GetCallstackEventsOfTidCount(int32_t thread_id) const {
   std::lock_guard lock(mutex_);
   const auto& tid_and_events_it = callstack_events_by_tid_.find(thread_id);
@@ -94,25 +105,54 @@ std::vector<CallstackEvent> CallstackData::GetCallstackEventsOfTidInTimeRange(
     return callstack_events;
   }
 
-  const std::map<uint64_t, CallstackEvent>& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-    uint64_t time = event_it->first;
-    if (time < time_end) {
-      callstack_events.push_back(event_it->second);
-    } else {
-      break;
-    }
-  }
+  const CallstackEventColumns& events = tid_and_events_it->second;
+  const size_t begin_index = events.LowerBound(time_begin);
+  events.ForEachEventInIndexRange(
+      begin_index, std::max(begin_index, events.LowerBound(time_end)),
+      [&callstack_events](const CallstackEvent& event) { callstack_events.push_back(event); });
   return callstack_events;
 }
 
+namespace {
+void AddCallstackEventCountsPerBucket(const CallstackEventColumns& events, uint64_t min_timestamp,
+                                      uint64_t bucket_width_ns, std::vector<uint32_t>* counts) {
+  size_t begin_index = events.LowerBound(min_timestamp);
+  for (size_t bucket = 0; bucket < counts->size() && begin_index < events.size(); ++bucket) {
+    const size_t end_index = events.LowerBound(min_timestamp + (bucket + 1) * bucket_width_ns);
+    (*counts)[bucket] += end_index - begin_index;
+    begin_index = end_index;
+  }
+}
+}  // namespace
+
+std::vector<uint32_t> CallstackData::GetCallstackEventCountsPerBucket(uint64_t min_timestamp,
+                                                                      uint64_t bucket_width_ns,
+                                                                      size_t bucket_count) const {
+  std::lock_guard lock(mutex_);
+  std::vector<uint32_t> counts(bucket_count, 0);
+  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
+    AddCallstackEventCountsPerBucket(events, min_timestamp, bucket_width_ns, &counts);
+  }
+  return counts;
+}
+
+std::vector<uint32_t> CallstackData::GetCallstackEventOfTidCountsPerBucket(
+    int32_t tid, uint64_t min_timestamp, uint64_t bucket_width_ns, size_t bucket_count) const {
+  std::lock_guard lock(mutex_);
+  std::vector<uint32_t> counts(bucket_count, 0);
+  const auto& tid_and_events_it = callstack_events_by_tid_.find(tid);
+  if (tid_and_events_it != callstack_events_by_tid_.end()) {
+    AddCallstackEventCountsPerBucket(tid_and_events_it->second, min_timestamp, bucket_width_ns,
+                                     &counts);
+  }
+  return counts;
+}
+
 void CallstackData::ForEachCallstackEvent(
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
   std::lock_guard lock(mutex_);
   for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
-    for (const auto& [unused_timestamp, event] : events) {
-      action(event);
-    }
+    events.ForEachEvent(action);
   }
 }
 
@@ -122,10 +162,8 @@ void CallstackData::ForEachCallstackEventInTimeRange(
   std::lock_guard lock(mutex_);
   CHECK(min_timestamp <= max_timestamp);
   for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
-    for (auto event_it = events.lower_bound(min_timestamp);
-         event_it != events.upper_bound(max_timestamp); ++event_it) {
-      action(event_it->second);
-    }
+    events.ForEachEventInIndexRange(events.LowerBound(min_timestamp),
+                                    events.UpperBound(max_timestamp), action);
   }
 }
 
@@ -138,11 +176,9 @@ void CallstackData::ForEachCallstackEventOfTidInTimeRange(
   if (tid_and_events_it == callstack_events_by_tid_.end()) {
     return;
   }
-  const auto& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(min_timestamp);
-       event_it != events.upper_bound(max_timestamp); ++event_it) {
-    action(event_it->second);
-  }
+  const CallstackEventColumns& events = tid_and_events_it->second;
+  events.ForEachEventInIndexRange(events.LowerBound(min_timestamp),
+                                  events.UpperBound(max_timestamp), action);
 }
 
 void CallstackData::AddCallstackFromKnownCallstackData(const CallstackEvent& event,
@@ -157,7 +193,7 @@ void CallstackData::AddCallstackFromKnownCallstackData(const CallstackEvent& eve
 
   // The insertion only happens if the hash isn't already present.
   unique_callstacks_.emplace(callstack_id, std::move(unique_callstack));
-  callstack_events_by_tid_[event.thread_id()][event.time()] = CallstackEvent(event);
+  GetOrCreateCallstackEventsOfTid(event.thread_id()).Add(event);
 }
 
 const orbit_client_protos::CallstackInfo* CallstackData::GetCallstack(uint64_t callstack_id) const {
@@ -211,13 +247,13 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
 
   absl::flat_hash_set<uint64_t> callstack_ids_to_filter;
 
-  for (auto& [tid, timestamps_and_callstack_events] : callstack_events_by_tid_) {
+  for (const auto& [tid, events] : callstack_events_by_tid_) {
     uint64_t count_for_this_thread = 0;
 
     // Count the number of occurrences of each outer frame for this thread.
     absl::flat_hash_map<uint64_t, uint64_t> count_by_outer_frame;
-    for (const auto& [unused_timestamp_ns, event] : timestamps_and_callstack_events) {
-      const CallstackInfo& callstack = *unique_callstacks_.at(event.callstack_id());
+    for (uint64_t callstack_id : events.callstack_ids()) {
+      const CallstackInfo& callstack = *unique_callstacks_.at(callstack_id);
       CHECK(callstack.type() != CallstackInfo::kFilteredByMajorityOutermostFrame);
       if (callstack.type() != CallstackInfo::kComplete) {
         continue;
@@ -258,17 +294,17 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
     // doesn't match the (super)majority outer frame.
     // Note that if a CallstackEvent from another thread references a filtered CallstackInfo, that
     // CallstackEvent will also be affected.
-    for (const auto& [unused_timestamp_ns, event] : timestamps_and_callstack_events) {
-      const CallstackInfo& callstack = *unique_callstacks_.at(event.callstack_id());
+    for (uint64_t callstack_id : events.callstack_ids()) {
+      const CallstackInfo& callstack = *unique_callstacks_.at(callstack_id);
       CHECK(callstack.type() != CallstackInfo::kFilteredByMajorityOutermostFrame);
       if (callstack.type() != CallstackInfo::kComplete) {
         continue;
       }
 
-      const auto& frames = unique_callstacks_.at(event.callstack_id())->frames();
+      const auto& frames = callstack.frames();
       CHECK(!frames.empty());
       if (*frames.rbegin() != majority_outer_frame) {
-        callstack_ids_to_filter.insert(event.callstack_id());
+        callstack_ids_to_filter.insert(callstack_id);
       }
     }
   }
@@ -282,9 +318,9 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
 
   // Count how many CallstackEvents had their CallstackInfo affected by the type change.
   uint64_t affected_event_count = 0;
-  for (auto& [tid, timestamps_and_callstack_events] : callstack_events_by_tid_) {
-    for (const auto& [unused_timestamp_ns, event] : timestamps_and_callstack_events) {
-      if (unique_callstacks_.at(event.callstack_id())->type() ==
+  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
+    for (uint64_t callstack_id : events.callstack_ids()) {
+      if (unique_callstacks_.at(callstack_id)->type() ==
           CallstackInfo::kFilteredByMajorityOutermostFrame) {
         ++affected_event_count;
       }
@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <limits>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "ClientData/CallstackData.h"
@@ -162,4 +163,36 @@ TEST(CallstackData, FilterCallstackEventsBasedOnMajorityStart) {
       testing::Pointwise(CallstackEventEq(), std::vector<CallstackEvent>{event8, event9, event10}));
 }
 
+TEST(CallstackData, GetCallstackEventCountsPerBucket) {
+  CallstackData callstack_data;
+  constexpr uint64_t kCallstackId = 12;
+  callstack_data.AddUniqueCallstack(kCallstackId, CallstackInfo{});
+
+  constexpr int32_t kTid = 42;
+  constexpr int32_t kOtherTid = 43;
+  for (const auto& [tid, time] : std::vector<std::pair<int32_t, uint64_t>>{
+           {kTid, 95}, {kTid, 100}, {kTid, 105}, {kTid, 109}, {kTid, 130}, {kOtherTid, 110}}) {
+    CallstackEvent event;
+    event.set_time(time);
+    event.set_thread_id(tid);
+    event.set_callstack_id(kCallstackId);
+    callstack_data.AddCallstackEvent(event);
+  }
+
+  EXPECT_THAT(callstack_data.GetCallstackEventOfTidCountsPerBucket(kTid, 100, 10, 4),
+              testing::ElementsAre(3, 0, 0, 1));
+  EXPECT_THAT(callstack_data.GetCallstackEventCountsPerBucket(100, 10, 4),
+              testing::ElementsAre(3, 1, 0, 1));
+  EXPECT_THAT(callstack_data.GetCallstackEventOfTidCountsPerBucket(kTid, 131, 10, 2),
+              testing::ElementsAre(0, 0));
+  EXPECT_THAT(callstack_data.GetCallstackEventOfTidCountsPerBucket(44, 100, 10, 2),
+              testing::ElementsAre(0, 0));
+
+  EXPECT_THAT(callstack_data.GetCallstackEventsCountsPerTidInTimeRange(100, 130),
+              testing::UnorderedElementsAre(testing::Pair(kTid, 3), testing::Pair(kOtherTid, 1)));
+  EXPECT_THAT(callstack_data.GetCallstackEventsCountsPerTidInTimeRange(111, 131),
+              testing::UnorderedElementsAre(testing::Pair(kTid, 1)));
+  EXPECT_TRUE(callstack_data.GetCallstackEventsCountsPerTidInTimeRange(131, 200).empty());
+}
+
 }  // namespace orbit_client_data
@@ -0,0 +1,100 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/CallstackEventColumns.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::CallstackEvent;
+
+namespace orbit_client_data {
+
+namespace {
+
+// Columns that are empty as long as all their values are the default one.
+template <typename T>
+void SetSparseColumnValue(std::vector<T>* column, size_t size, size_t index, T value) {
+  if (column->empty()) {
+    if (value == T{}) return;
+    column->resize(size);
+  }
+  (*column)[index] = value;
+}
+
+template <typename T>
+void InsertIntoSparseColumn(std::vector<T>* column, size_t index) {
+  if (column->empty()) return;
+  column->insert(column->begin() + index, T{});
+}
+
+template <typename T>
+[[nodiscard]] T GetSparseColumnValue(const std::vector<T>& column, size_t index) {
+  return column.empty() ? T{} : column[index];
+}
+
+}  // namespace
+
+void CallstackEventColumns::Add(const CallstackEvent& event) {
+  CHECK(event.thread_id() == thread_id_);
+  const uint64_t timestamp_ns = event.time();
+  if (timestamps_ns_.empty() || timestamps_ns_.back() < timestamp_ns) {
+    Insert(size(), event);
+    return;
+  }
+
+  const size_t index = LowerBound(timestamp_ns);
+  if (timestamps_ns_[index] == timestamp_ns) {
+    Assign(index, event);
+  } else {
+    Insert(index, event);
+  }
+}
+
+void CallstackEventColumns::Insert(size_t index, const CallstackEvent& event) {
+  timestamps_ns_.insert(timestamps_ns_.begin() + index, 0);
+  callstack_ids_.insert(callstack_ids_.begin() + index, 0);
+  InsertIntoSparseColumn(&off_cpu_durations_ns_, index);
+  InsertIntoSparseColumn(&memory_event_types_, index);
+  InsertIntoSparseColumn(&memory_event_counts_, index);
+  Assign(index, event);
+}
+
+void CallstackEventColumns::Assign(size_t index, const CallstackEvent& event) {
+  timestamps_ns_[index] = event.time();
+  callstack_ids_[index] = event.callstack_id();
+  SetSparseColumnValue(&off_cpu_durations_ns_, size(), index, event.off_cpu_duration_ns());
+  SetSparseColumnValue(&memory_event_types_, size(), index, event.memory_event_type());
+  SetSparseColumnValue(&memory_event_counts_, size(), index, event.memory_event_count());
+}
+
+size_t CallstackEventColumns::LowerBound(uint64_t timestamp_ns) const {
+  return std::lower_bound(timestamps_ns_.begin(), timestamps_ns_.end(), timestamp_ns) -
+         timestamps_ns_.begin();
+}
+
+size_t CallstackEventColumns::UpperBound(uint64_t timestamp_ns) const {
+  return std::upper_bound(timestamps_ns_.begin(), timestamps_ns_.end(), timestamp_ns) -
+         timestamps_ns_.begin();
+}
+
+void CallstackEventColumns::ForEachEventInIndexRange(
+    size_t begin_index, size_t end_index,
+    const std::function<void(const CallstackEvent&)>& action) const {
+  CHECK(begin_index <= end_index && end_index <= size());
+  // Reuse the same message, which only has scalar fields, for all the events.
+  CallstackEvent event;
+  event.set_thread_id(thread_id_);
+  for (size_t index = begin_index; index < end_index; ++index) {
+    event.set_time(timestamps_ns_[index]);
+    event.set_callstack_id(callstack_ids_[index]);
+    event.set_off_cpu_duration_ns(GetSparseColumnValue(off_cpu_durations_ns_, index));
+    event.set_memory_event_type(GetSparseColumnValue(memory_event_types_, index));
+    event.set_memory_event_count(GetSparseColumnValue(memory_event_counts_, index));
+    action(event);
+  }
+}
+
+}  // namespace orbit_client_data
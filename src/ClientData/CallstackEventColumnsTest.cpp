@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ClientData/CallstackEventColumns.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::CallstackEvent;
+using ::testing::ElementsAre;
+
+namespace orbit_client_data {
+
+namespace {
+
+constexpr int32_t kThreadId = 42;
+
+CallstackEvent CreateCallstackEvent(uint64_t time, uint64_t callstack_id) {
+  CallstackEvent event;
+  event.set_time(time);
+  event.set_callstack_id(callstack_id);
+  event.set_thread_id(kThreadId);
+  return event;
+}
+
+std::vector<uint64_t> GetCallstackIdsInIndexRange(const CallstackEventColumns& columns,
+                                                  size_t begin_index, size_t end_index) {
+  std::vector<uint64_t> callstack_ids;
+  columns.ForEachEventInIndexRange(begin_index, end_index,
+                                   [&callstack_ids](const CallstackEvent& event) {
+                                     EXPECT_EQ(event.thread_id(), kThreadId);
+                                     callstack_ids.push_back(event.callstack_id());
+                                   });
+  return callstack_ids;
+}
+
+}  // namespace
+
+TEST(CallstackEventColumns, AddKeepsEventsSortedByTimestamp) {
+  CallstackEventColumns columns{kThreadId};
+  EXPECT_TRUE(columns.empty());
+
+  columns.Add(CreateCallstackEvent(10, 1));
+  columns.Add(CreateCallstackEvent(30, 3));
+  columns.Add(CreateCallstackEvent(20, 2));
+  columns.Add(CreateCallstackEvent(5, 0));
+  // Replaces the event at the same timestamp.
+  columns.Add(CreateCallstackEvent(30, 4));
+
+  EXPECT_EQ(columns.size(), 4);
+  EXPECT_THAT(columns.timestamps_ns(), ElementsAre(5, 10, 20, 30));
+  EXPECT_THAT(columns.callstack_ids(), ElementsAre(0, 1, 2, 4));
+}
+
+TEST(CallstackEventColumns, TimeRangeQueries) {
+  CallstackEventColumns columns{kThreadId};
+  for (uint64_t i = 1; i <= 5; ++i) {
+    columns.Add(CreateCallstackEvent(i * 10, i));
+  }
+
+  EXPECT_EQ(columns.LowerBound(0), 0);
+  EXPECT_EQ(columns.LowerBound(20), 1);
+  EXPECT_EQ(columns.UpperBound(20), 2);
+  EXPECT_EQ(columns.LowerBound(25), 2);
+  EXPECT_EQ(columns.UpperBound(50), 5);
+  EXPECT_EQ(columns.LowerBound(51), 5);
+
+  EXPECT_THAT(GetCallstackIdsInIndexRange(columns, columns.LowerBound(20), columns.UpperBound(40)),
+              ElementsAre(2, 3, 4));
+  EXPECT_THAT(GetCallstackIdsInIndexRange(columns, columns.LowerBound(60), columns.UpperBound(70)),
+              ElementsAre());
+}
+
+TEST(CallstackEventColumns, KeepsOffCpuAndMemoryFields) {
+  CallstackEventColumns columns{kThreadId};
+  columns.Add(CreateCallstackEvent(10, 1));
+
+  CallstackEvent off_cpu_event = CreateCallstackEvent(30, 2);
+  off_cpu_event.set_off_cpu_duration_ns(100);
+  columns.Add(off_cpu_event);
+
+  CallstackEvent memory_event = CreateCallstackEvent(20, 3);
+  memory_event.set_memory_event_type(CallstackEvent::kPageFault);
+  memory_event.set_memory_event_count(7);
+  columns.Add(memory_event);
+
+  std::vector<CallstackEvent> events;
+  columns.ForEachEvent([&events](const CallstackEvent& event) { events.push_back(event); });
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(events[0].time(), 10);
+  EXPECT_EQ(events[0].off_cpu_duration_ns(), 0);
+  EXPECT_EQ(events[0].memory_event_type(), CallstackEvent::kNoMemoryEvent);
+  EXPECT_EQ(events[1].time(), 20);
+  EXPECT_EQ(events[1].callstack_id(), 3);
+  EXPECT_EQ(events[1].off_cpu_duration_ns(), 0);
+  EXPECT_EQ(events[1].memory_event_type(), CallstackEvent::kPageFault);
+  EXPECT_EQ(events[1].memory_event_count(), 7);
+  EXPECT_EQ(events[2].time(), 30);
+  EXPECT_EQ(events[2].off_cpu_duration_ns(), 100);
+  EXPECT_EQ(events[2].memory_event_type(), CallstackEvent::kNoMemoryEvent);
+  EXPECT_EQ(events[2].memory_event_count(), 0);
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,35 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/CallstackPool.h"
+
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+void CallstackPool::Add(uint64_t callstack_id, absl::Span<const uint64_t> frames,
+                        orbit_client_protos::CallstackInfo::CallstackType type) {
+  CHECK(frames.size() <= std::numeric_limits<uint32_t>::max());
+  auto [unused_it, inserted] = entries_.try_emplace(
+      callstack_id, Entry{frames_.size(), static_cast<uint32_t>(frames.size()), type});
+  CHECK(inserted);
+  frames_.insert(frames_.end(), frames.begin(), frames.end());
+}
+
+CallstackView CallstackPool::Get(uint64_t callstack_id) const {
+  auto it = entries_.find(callstack_id);
+  CHECK(it != entries_.end());
+  return GetView(it->second);
+}
+
+void CallstackPool::ForEach(
+    const std::function<void(uint64_t callstack_id, CallstackView callstack)>& action) const {
+  for (const auto& [callstack_id, entry] : entries_) {
+    action(callstack_id, GetView(entry));
+  }
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ClientData/CallstackPool.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::CallstackInfo;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+namespace orbit_client_data {
+
+TEST(CallstackPool, AddAndGet) {
+  CallstackPool pool;
+  EXPECT_TRUE(pool.empty());
+
+  pool.Add(1, std::vector<uint64_t>{0x10, 0x20, 0x30}, CallstackInfo::kComplete);
+  pool.Add(2, std::vector<uint64_t>{0x40}, CallstackInfo::kDwarfUnwindingError);
+  pool.Add(3, std::vector<uint64_t>{}, CallstackInfo::kComplete);
+
+  EXPECT_EQ(pool.size(), 3);
+  EXPECT_EQ(pool.GetTotalFrameCount(), 4);
+  EXPECT_TRUE(pool.Contains(2));
+  EXPECT_FALSE(pool.Contains(4));
+
+  CallstackView callstack_1 = pool.Get(1);
+  EXPECT_THAT(callstack_1.frames(), ElementsAre(0x10, 0x20, 0x30));
+  EXPECT_EQ(callstack_1.frames(0), 0x10);
+  EXPECT_EQ(callstack_1.type(), CallstackInfo::kComplete);
+
+  CallstackView callstack_2 = pool.Get(2);
+  EXPECT_THAT(callstack_2.frames(), ElementsAre(0x40));
+  EXPECT_EQ(callstack_2.type(), CallstackInfo::kDwarfUnwindingError);
+
+  EXPECT_THAT(pool.Get(3).frames(), IsEmpty());
+
+  EXPECT_DEATH((void)pool.Get(4), "Check failed");
+  EXPECT_DEATH(pool.Add(1, std::vector<uint64_t>{0x50}, CallstackInfo::kComplete),
+               "Check failed");
+
+  std::vector<std::pair<uint64_t, std::vector<uint64_t>>> all_callstacks;
+  pool.ForEach([&all_callstacks](uint64_t callstack_id, CallstackView callstack) {
+    all_callstacks.emplace_back(
+        callstack_id, std::vector<uint64_t>{callstack.frames().begin(), callstack.frames().end()});
+  });
+  EXPECT_THAT(all_callstacks,
+              UnorderedElementsAre(std::make_pair(1, std::vector<uint64_t>{0x10, 0x20, 0x30}),
+                                   std::make_pair(2, std::vector<uint64_t>{0x40}),
+                                   std::make_pair(3, std::vector<uint64_t>{})));
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,118 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/CoreUtilizationIndex.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+namespace {
+CoreUtilization operator-(const CoreUtilization& lhs, const CoreUtilization& rhs) {
+  return {lhs.time_on_core_ns - rhs.time_on_core_ns,
+          lhs.target_process_time_on_core_ns - rhs.target_process_time_on_core_ns};
+}
+}  // namespace
+
+void CoreUtilizationIndex::AddSlice(uint32_t core, uint64_t start_ns, uint64_t end_ns,
+                                    bool is_target_process) {
+  CHECK(start_ns <= end_ns);
+  absl::MutexLock lock{&mutex_};
+  if (core >= slices_by_core_.size()) slices_by_core_.resize(core + 1);
+  CoreSlices& slices = slices_by_core_[core];
+
+  // As the slices of a core don't overlap, sorting them by end also sorts them by start.
+  const size_t index =
+      std::upper_bound(slices.ends_ns.begin(), slices.ends_ns.end(), end_ns) -
+      slices.ends_ns.begin();
+  slices.starts_ns.insert(slices.starts_ns.begin() + index, start_ns);
+  slices.ends_ns.insert(slices.ends_ns.begin() + index, end_ns);
+  slices.is_target_process.insert(slices.is_target_process.begin() + index, is_target_process);
+  slices.prefix_time_on_core_ns.insert(slices.prefix_time_on_core_ns.begin() + index, 0);
+  slices.prefix_target_process_time_on_core_ns.insert(
+      slices.prefix_target_process_time_on_core_ns.begin() + index, 0);
+  slices.RecomputePrefixSumsFrom(index);
+}
+
+void CoreUtilizationIndex::CoreSlices::RecomputePrefixSumsFrom(size_t index) {
+  uint64_t time_on_core_ns = index == 0 ? 0 : prefix_time_on_core_ns[index - 1];
+  uint64_t target_process_time_on_core_ns =
+      index == 0 ? 0 : prefix_target_process_time_on_core_ns[index - 1];
+  for (size_t i = index; i < starts_ns.size(); ++i) {
+    const uint64_t duration_ns = ends_ns[i] - starts_ns[i];
+    time_on_core_ns += duration_ns;
+    if (is_target_process[i]) target_process_time_on_core_ns += duration_ns;
+    prefix_time_on_core_ns[i] = time_on_core_ns;
+    prefix_target_process_time_on_core_ns[i] = target_process_time_on_core_ns;
+  }
+}
+
+CoreUtilization CoreUtilizationIndex::CoreSlices::GetUtilizationBefore(uint64_t time_ns) const {
+  // The slices before `index` end before `time_ns`, the slice at `index` may contain it.
+  const size_t index = std::upper_bound(ends_ns.begin(), ends_ns.end(), time_ns) - ends_ns.begin();
+  CoreUtilization utilization;
+  if (index > 0) {
+    utilization.time_on_core_ns = prefix_time_on_core_ns[index - 1];
+    utilization.target_process_time_on_core_ns = prefix_target_process_time_on_core_ns[index - 1];
+  }
+  if (index < starts_ns.size() && starts_ns[index] < time_ns) {
+    const uint64_t partial_duration_ns = time_ns - starts_ns[index];
+    utilization.time_on_core_ns += partial_duration_ns;
+    if (is_target_process[index]) {
+      utilization.target_process_time_on_core_ns += partial_duration_ns;
+    }
+  }
+  return utilization;
+}
+
+uint32_t CoreUtilizationIndex::GetCoreCount() const {
+  absl::ReaderMutexLock lock{&mutex_};
+  return slices_by_core_.size();
+}
+
+CoreUtilization CoreUtilizationIndex::GetCoreUtilization(uint32_t core, uint64_t min_ns,
+                                                         uint64_t max_ns) const {
+  absl::ReaderMutexLock lock{&mutex_};
+  if (core >= slices_by_core_.size() || max_ns <= min_ns) return {};
+  const CoreSlices& slices = slices_by_core_[core];
+  return slices.GetUtilizationBefore(max_ns) - slices.GetUtilizationBefore(min_ns);
+}
+
+std::vector<CoreUtilization> CoreUtilizationIndex::GetCoreUtilizationPerBucket(
+    uint32_t core, uint64_t min_ns, uint64_t bucket_width_ns, size_t bucket_count) const {
+  std::vector<CoreUtilization> utilization_per_bucket(bucket_count);
+  absl::ReaderMutexLock lock{&mutex_};
+  if (core >= slices_by_core_.size() || slices_by_core_[core].ends_ns.empty()) {
+    return utilization_per_bucket;
+  }
+  const CoreSlices& slices = slices_by_core_[core];
+  const uint64_t last_end_ns = slices.ends_ns.back();
+  CoreUtilization utilization_before_bucket = slices.GetUtilizationBefore(min_ns);
+  for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+    const uint64_t bucket_min_ns = min_ns + bucket * bucket_width_ns;
+    if (bucket_min_ns >= last_end_ns) break;
+    const CoreUtilization utilization_before_next_bucket =
+        slices.GetUtilizationBefore(bucket_min_ns + bucket_width_ns);
+    utilization_per_bucket[bucket] = utilization_before_next_bucket - utilization_before_bucket;
+    utilization_before_bucket = utilization_before_next_bucket;
+  }
+  return utilization_per_bucket;
+}
+
+size_t CoreUtilizationIndex::GetSliceCount(uint32_t core, uint64_t min_ns, uint64_t max_ns) const {
+  absl::ReaderMutexLock lock{&mutex_};
+  if (core >= slices_by_core_.size()) return 0;
+  const CoreSlices& slices = slices_by_core_[core];
+  const size_t first_index =
+      std::upper_bound(slices.ends_ns.begin(), slices.ends_ns.end(), min_ns) -
+      slices.ends_ns.begin();
+  const size_t end_index =
+      std::lower_bound(slices.starts_ns.begin(), slices.starts_ns.end(), max_ns) -
+      slices.starts_ns.begin();
+  return end_index > first_index ? end_index - first_index : 0;
+}
+
+}  // namespace orbit_client_data
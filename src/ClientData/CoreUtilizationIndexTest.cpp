@@ -0,0 +1,95 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "ClientData/CoreUtilizationIndex.h"
+
+namespace orbit_client_data {
+
+TEST(CoreUtilizationIndex, Empty) {
+  CoreUtilizationIndex index;
+  EXPECT_EQ(index.GetCoreCount(), 0);
+  EXPECT_EQ(index.GetCoreUtilization(0, 0, 100).time_on_core_ns, 0);
+  EXPECT_EQ(index.GetSliceCount(0, 0, 100), 0);
+  EXPECT_EQ(index.GetCoreUtilizationPerBucket(0, 0, 10, 3).size(), 3);
+}
+
+TEST(CoreUtilizationIndex, ClipsTheSlicesToTheTimeRange) {
+  CoreUtilizationIndex index;
+  index.AddSlice(1, 10, 20, true);
+  index.AddSlice(1, 30, 50, false);
+  index.AddSlice(1, 50, 60, true);
+  EXPECT_EQ(index.GetCoreCount(), 2);
+
+  CoreUtilization utilization = index.GetCoreUtilization(1, 0, 100);
+  EXPECT_EQ(utilization.time_on_core_ns, 40);
+  EXPECT_EQ(utilization.target_process_time_on_core_ns, 20);
+
+  utilization = index.GetCoreUtilization(1, 15, 55);
+  EXPECT_EQ(utilization.time_on_core_ns, 30);
+  EXPECT_EQ(utilization.target_process_time_on_core_ns, 10);
+
+  utilization = index.GetCoreUtilization(1, 20, 30);
+  EXPECT_EQ(utilization.time_on_core_ns, 0);
+
+  utilization = index.GetCoreUtilization(0, 0, 100);
+  EXPECT_EQ(utilization.time_on_core_ns, 0);
+
+  EXPECT_EQ(index.GetSliceCount(1, 0, 100), 3);
+  EXPECT_EQ(index.GetSliceCount(1, 20, 30), 0);
+  EXPECT_EQ(index.GetSliceCount(1, 19, 31), 2);
+}
+
+TEST(CoreUtilizationIndex, GetCoreUtilizationPerBucket) {
+  CoreUtilizationIndex index;
+  index.AddSlice(0, 5, 25, true);
+  index.AddSlice(0, 32, 34, false);
+
+  std::vector<CoreUtilization> buckets = index.GetCoreUtilizationPerBucket(0, 0, 10, 5);
+  ASSERT_EQ(buckets.size(), 5);
+  EXPECT_EQ(buckets[0].time_on_core_ns, 5);
+  EXPECT_EQ(buckets[1].time_on_core_ns, 10);
+  EXPECT_EQ(buckets[2].time_on_core_ns, 5);
+  EXPECT_EQ(buckets[2].target_process_time_on_core_ns, 5);
+  EXPECT_EQ(buckets[3].time_on_core_ns, 2);
+  EXPECT_EQ(buckets[3].target_process_time_on_core_ns, 0);
+  EXPECT_EQ(buckets[4].time_on_core_ns, 0);
+}
+
+TEST(CoreUtilizationIndex, SlicesOutOfOrderGiveTheSameUtilizationAsSortedSlices) {
+  std::vector<std::pair<uint64_t, bool>> slices;
+  for (uint64_t i = 0; i < 1000; ++i) slices.emplace_back(10 * i, i % 3 == 0);
+
+  CoreUtilizationIndex sorted_index;
+  for (const auto& [start, is_target_process] : slices) {
+    sorted_index.AddSlice(0, start, start + 7, is_target_process);
+  }
+
+  std::shuffle(slices.begin(), slices.end(), std::mt19937{42});
+  CoreUtilizationIndex shuffled_index;
+  for (const auto& [start, is_target_process] : slices) {
+    shuffled_index.AddSlice(0, start, start + 7, is_target_process);
+  }
+
+  for (uint64_t min = 0; min < 10'000; min += 1234) {
+    for (uint64_t max = min; max < 10'000; max += 567) {
+      const CoreUtilization expected = sorted_index.GetCoreUtilization(0, min, max);
+      const CoreUtilization actual = shuffled_index.GetCoreUtilization(0, min, max);
+      EXPECT_EQ(actual.time_on_core_ns, expected.time_on_core_ns);
+      EXPECT_EQ(actual.target_process_time_on_core_ns, expected.target_process_time_on_core_ns);
+    }
+  }
+  EXPECT_EQ(sorted_index.GetCoreUtilization(0, 0, 10'000).time_on_core_ns, 7000);
+  EXPECT_EQ(sorted_index.GetCoreUtilization(0, 0, 10'000).target_process_time_on_core_ns,
+            334 * 7);
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,34 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/DemanglingCache.h"
+
+#include <llvm/Demangle/Demangle.h>
+
+#include <utility>
+
+namespace orbit_client_data {
+
+const std::string& DemanglingCache::Demangle(const std::string& mangled_name) {
+  {
+    absl::ReaderMutexLock lock{&mutex_};
+    auto it = demangled_names_.find(mangled_name);
+    if (it != demangled_names_.end()) return it->second;
+  }
+
+  // Demangle without holding the lock, so that other threads can look up names in the meantime.
+  // Names that are not mangled are not stored, as they would only be copies.
+  std::string demangled_name = llvm::demangle(mangled_name);
+  if (demangled_name == mangled_name) return mangled_name;
+
+  absl::MutexLock lock{&mutex_};
+  return demangled_names_.try_emplace(mangled_name, std::move(demangled_name)).first->second;
+}
+
+size_t DemanglingCache::size() const {
+  absl::ReaderMutexLock lock{&mutex_};
+  return demangled_names_.size();
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,57 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ClientData/DemanglingCache.h"
+
+namespace orbit_client_data {
+
+TEST(DemanglingCache, DemanglesAndCachesMangledNames) {
+  DemanglingCache cache;
+  const std::string mangled_name = "_Z3fooi";
+  const std::string& demangled_name = cache.Demangle(mangled_name);
+  EXPECT_EQ(demangled_name, "foo(int)");
+  EXPECT_EQ(cache.size(), 1);
+
+  // The second lookup returns the cached name.
+  EXPECT_EQ(&cache.Demangle(mangled_name), &demangled_name);
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(DemanglingCache, ReturnsNamesThatAreNotMangled) {
+  DemanglingCache cache;
+  const std::string name = "main";
+  EXPECT_EQ(&cache.Demangle(name), &name);
+  EXPECT_EQ(cache.size(), 0);
+
+  const std::string empty_name;
+  EXPECT_EQ(cache.Demangle(empty_name), "");
+}
+
+TEST(DemanglingCache, DemanglesFromSeveralThreads) {
+  DemanglingCache cache;
+  const std::vector<std::string> mangled_names = {"_Z3fooi", "_Z3barv", "_ZN2ns3bazEd"};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&cache, &mangled_names] {
+      for (const std::string& mangled_name : mangled_names) {
+        (void)cache.Demangle(mangled_name);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_EQ(cache.Demangle("_Z3barv"), "bar()");
+  EXPECT_EQ(cache.Demangle("_ZN2ns3bazEd"), "ns::baz(double)");
+}
+
+}  // namespace orbit_client_data
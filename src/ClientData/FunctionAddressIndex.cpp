@@ -0,0 +1,50 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/FunctionAddressIndex.h"
+
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+FunctionAddressIndex::FunctionAddressIndex(std::vector<uint64_t> start_addresses,
+                                           const std::vector<uint64_t>& sizes)
+    : start_addresses_{std::move(start_addresses)} {
+  CHECK(start_addresses_.size() == sizes.size());
+  end_addresses_.reserve(start_addresses_.size());
+  for (size_t i = 0; i < start_addresses_.size(); ++i) {
+    CHECK(i == 0 || start_addresses_[i - 1] < start_addresses_[i]);
+    end_addresses_.push_back(start_addresses_[i] + sizes[i]);
+  }
+}
+
+size_t FunctionAddressIndex::CountStartAddressesUpTo(uint64_t address) const {
+  if (start_addresses_.empty()) return 0;
+  // Each step halves the range by moving `base` or not, which compiles to a conditional move
+  // instead of a branch the processor would mispredict half of the time.
+  const uint64_t* base = start_addresses_.data();
+  size_t length = start_addresses_.size();
+  while (length > 1) {
+    const size_t half = length / 2;
+    base += (base[half - 1] <= address) ? half : 0;
+    length -= half;
+  }
+  return static_cast<size_t>(base - start_addresses_.data()) + (*base <= address ? 1 : 0);
+}
+
+std::optional<size_t> FunctionAddressIndex::FindExact(uint64_t address) const {
+  const size_t count = CountStartAddressesUpTo(address);
+  if (count == 0 || start_addresses_[count - 1] != address) return std::nullopt;
+  return count - 1;
+}
+
+std::optional<size_t> FunctionAddressIndex::FindContaining(uint64_t address) const {
+  const size_t count = CountStartAddressesUpTo(address);
+  if (count == 0 || end_addresses_[count - 1] < address) return std::nullopt;
+  return count - 1;
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "ClientData/FunctionAddressIndex.h"
+
+namespace orbit_client_data {
+
+TEST(FunctionAddressIndex, Empty) {
+  FunctionAddressIndex index;
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.FindExact(0), std::nullopt);
+  EXPECT_EQ(index.FindContaining(42), std::nullopt);
+}
+
+TEST(FunctionAddressIndex, FindExact) {
+  FunctionAddressIndex index{{10, 20, 40}, {5, 10, 0}};
+  EXPECT_EQ(index.size(), 3);
+  EXPECT_EQ(index.FindExact(10), 0);
+  EXPECT_EQ(index.FindExact(20), 1);
+  EXPECT_EQ(index.FindExact(40), 2);
+  EXPECT_EQ(index.FindExact(9), std::nullopt);
+  EXPECT_EQ(index.FindExact(11), std::nullopt);
+  EXPECT_EQ(index.FindExact(41), std::nullopt);
+}
+
+TEST(FunctionAddressIndex, FindContaining) {
+  FunctionAddressIndex index{{10, 20, 40}, {5, 10, 0}};
+  EXPECT_EQ(index.FindContaining(0), std::nullopt);
+  EXPECT_EQ(index.FindContaining(9), std::nullopt);
+  EXPECT_EQ(index.FindContaining(10), 0);
+  EXPECT_EQ(index.FindContaining(14), 0);
+  // The end address counts as part of the function.
+  EXPECT_EQ(index.FindContaining(15), 0);
+  EXPECT_EQ(index.FindContaining(16), std::nullopt);
+  EXPECT_EQ(index.FindContaining(20), 1);
+  EXPECT_EQ(index.FindContaining(30), 1);
+  EXPECT_EQ(index.FindContaining(31), std::nullopt);
+  EXPECT_EQ(index.FindContaining(40), 2);
+  EXPECT_EQ(index.FindContaining(41), std::nullopt);
+}
+
+TEST(FunctionAddressIndex, MatchesLinearSearch) {
+  std::vector<uint64_t> start_addresses;
+  std::vector<uint64_t> sizes;
+  for (uint64_t i = 0; i < 100; ++i) {
+    start_addresses.push_back(i * i + 3);
+    sizes.push_back(i % 7);
+  }
+  FunctionAddressIndex index{start_addresses, sizes};
+
+  for (uint64_t address = 0; address < 100 * 100 + 10; ++address) {
+    std::optional<size_t> expected_exact;
+    std::optional<size_t> expected_containing;
+    for (size_t i = 0; i < start_addresses.size(); ++i) {
+      if (start_addresses[i] == address) expected_exact = i;
+      if (start_addresses[i] <= address) {
+        expected_containing = address <= start_addresses[i] + sizes[i]
+                                  ? std::optional<size_t>{i}
+                                  : std::nullopt;
+      }
+    }
+    EXPECT_EQ(index.FindExact(address), expected_exact) << address;
+    EXPECT_EQ(index.FindContaining(address), expected_containing) << address;
+  }
+}
+
+}  // namespace orbit_client_data
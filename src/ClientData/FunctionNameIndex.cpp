@@ -0,0 +1,102 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/FunctionNameIndex.h"
+
+#include <absl/types/span.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+constexpr size_t kTrigramLength = 3;
+
+// Replaces the content of `trigrams` with the distinct trigrams of `name`, sorted.
+void GetTrigrams(std::string_view name, std::vector<uint32_t>* trigrams) {
+  trigrams->clear();
+  if (name.size() < kTrigramLength) return;
+  for (size_t i = 0; i + kTrigramLength <= name.size(); ++i) {
+    trigrams->push_back(static_cast<uint32_t>(static_cast<uint8_t>(name[i])) << 16 |
+                        static_cast<uint32_t>(static_cast<uint8_t>(name[i + 1])) << 8 |
+                        static_cast<uint32_t>(static_cast<uint8_t>(name[i + 2])));
+  }
+  std::sort(trigrams->begin(), trigrams->end());
+  trigrams->erase(std::unique(trigrams->begin(), trigrams->end()), trigrams->end());
+}
+
+}  // namespace
+
+FunctionNameIndex::FunctionNameIndex(const std::vector<std::string>& lowercase_names)
+    : size_{lowercase_names.size()} {
+  CHECK(lowercase_names.size() <= std::numeric_limits<uint32_t>::max());
+
+  // Count the names that contain each trigram first, so that the positions of all the trigrams fit
+  // into a single vector, without the overhead of a vector per trigram.
+  std::vector<uint32_t> trigrams;
+  absl::flat_hash_map<uint32_t, uint32_t> trigram_to_count;
+  for (const std::string& name : lowercase_names) {
+    GetTrigrams(name, &trigrams);
+    for (uint32_t trigram : trigrams) {
+      ++trigram_to_count[trigram];
+    }
+  }
+
+  uint32_t offset = 0;
+  trigram_to_positions_range_.reserve(trigram_to_count.size());
+  for (const auto& [trigram, count] : trigram_to_count) {
+    // The end of each range is where the next position goes until all of them are in place.
+    trigram_to_positions_range_.try_emplace(trigram, offset, offset);
+    offset += count;
+  }
+  positions_.resize(offset);
+
+  for (uint32_t position = 0; position < lowercase_names.size(); ++position) {
+    GetTrigrams(lowercase_names[position], &trigrams);
+    for (uint32_t trigram : trigrams) {
+      positions_[trigram_to_positions_range_.at(trigram).second++] = position;
+    }
+  }
+}
+
+std::optional<std::vector<uint32_t>> FunctionNameIndex::FindCandidates(
+    std::string_view lowercase_substring) const {
+  std::vector<uint32_t> trigrams;
+  GetTrigrams(lowercase_substring, &trigrams);
+  if (trigrams.empty()) return std::nullopt;
+
+  std::vector<absl::Span<const uint32_t>> positions_per_trigram;
+  positions_per_trigram.reserve(trigrams.size());
+  for (uint32_t trigram : trigrams) {
+    auto it = trigram_to_positions_range_.find(trigram);
+    if (it == trigram_to_positions_range_.end()) return std::vector<uint32_t>{};
+    const auto [begin, end] = it->second;
+    positions_per_trigram.emplace_back(positions_.data() + begin, end - begin);
+  }
+
+  // Starting from the rarest trigram keeps the intermediate results small.
+  std::sort(positions_per_trigram.begin(), positions_per_trigram.end(),
+            [](absl::Span<const uint32_t> lhs, absl::Span<const uint32_t> rhs) {
+              return lhs.size() < rhs.size();
+            });
+
+  std::vector<uint32_t> candidates{positions_per_trigram[0].begin(),
+                                   positions_per_trigram[0].end()};
+  std::vector<uint32_t> intersection;
+  for (size_t i = 1; i < positions_per_trigram.size() && !candidates.empty(); ++i) {
+    intersection.clear();
+    std::set_intersection(candidates.begin(), candidates.end(), positions_per_trigram[i].begin(),
+                          positions_per_trigram[i].end(), std::back_inserter(intersection));
+    std::swap(candidates, intersection);
+  }
+  return candidates;
+}
+
+}  // namespace orbit_client_data
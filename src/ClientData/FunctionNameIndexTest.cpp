@@ -0,0 +1,47 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ClientData/FunctionNameIndex.h"
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace orbit_client_data {
+
+TEST(FunctionNameIndex, ShortSubstringsCanMatchAnyName) {
+  FunctionNameIndex index{{"foo", "bar"}};
+  EXPECT_EQ(index.size(), 2);
+  EXPECT_EQ(index.FindCandidates(""), std::nullopt);
+  EXPECT_EQ(index.FindCandidates("fo"), std::nullopt);
+}
+
+TEST(FunctionNameIndex, FindsTheNamesWithAllTrigramsOfTheSubstring) {
+  FunctionNameIndex index{
+      {"void foo()", "foobar(int)", "bar::baz", "ab", "barfoo", "foo", "barfoobar"}};
+
+  EXPECT_THAT(index.FindCandidates("foo").value(), ElementsAre(0, 1, 4, 5, 6));
+  EXPECT_THAT(index.FindCandidates("bar").value(), ElementsAre(1, 2, 4, 6));
+  EXPECT_THAT(index.FindCandidates("foobar").value(), ElementsAre(1, 6));
+  EXPECT_THAT(index.FindCandidates("qux").value(), IsEmpty());
+  EXPECT_EQ(index.FindCandidates("ab"), std::nullopt);
+
+  // Candidates contain all the trigrams of the substring, but not necessarily the substring.
+  EXPECT_THAT(index.FindCandidates("foobarfoo").value(), ElementsAre(6));
+}
+
+TEST(FunctionNameIndex, HandlesNonAsciiCharacters) {
+  FunctionNameIndex index{{"operator\xe2\x9c\x93", "\xff\xff\xff"}};
+  EXPECT_THAT(index.FindCandidates("\xe2\x9c\x93").value(), ElementsAre(0));
+  EXPECT_THAT(index.FindCandidates("\xff\xff\xff").value(), ElementsAre(1));
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,134 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/FunctionStatsUtils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::FunctionStats;
+
+namespace orbit_client_data {
+
+namespace {
+
+constexpr uint32_t kSubBucketCountLog2 = 4;
+static_assert(kDurationHistogramSubBucketCount == 1u << kSubBucketCountLog2);
+
+[[nodiscard]] uint32_t FloorLog2(uint64_t value) {
+  uint32_t result = 0;
+  for (uint32_t shift = 32; shift > 0; shift /= 2) {
+    if (value >= (uint64_t{1} << shift)) {
+      value >>= shift;
+      result += shift;
+    }
+  }
+  return result;
+}
+
+[[nodiscard]] uint64_t GetBucketWidthNs(uint32_t index) {
+  if (index < kDurationHistogramSubBucketCount) return 1;
+  const uint32_t exponent = index / kDurationHistogramSubBucketCount + kSubBucketCountLog2 - 1;
+  return uint64_t{1} << (exponent - kSubBucketCountLog2);
+}
+
+}  // namespace
+
+uint32_t GetDurationHistogramBucketIndex(uint64_t duration_ns) {
+  if (duration_ns < kDurationHistogramSubBucketCount) return static_cast<uint32_t>(duration_ns);
+  const uint32_t exponent = FloorLog2(duration_ns);
+  const auto mantissa = static_cast<uint32_t>(duration_ns >> (exponent - kSubBucketCountLog2));
+  const uint32_t sub_bucket = mantissa - kDurationHistogramSubBucketCount;
+  return kDurationHistogramSubBucketCount * (exponent - kSubBucketCountLog2 + 1) + sub_bucket;
+}
+
+uint64_t GetDurationHistogramBucketLowerBoundNs(uint32_t index) {
+  if (index < kDurationHistogramSubBucketCount) return index;
+  const uint32_t exponent = index / kDurationHistogramSubBucketCount + kSubBucketCountLog2 - 1;
+  CHECK(exponent < 64);
+  const uint64_t mantissa =
+      kDurationHistogramSubBucketCount + index % kDurationHistogramSubBucketCount;
+  return mantissa << (exponent - kSubBucketCountLog2);
+}
+
+void AddFunctionCallToStats(uint64_t duration_ns, FunctionStats* stats) {
+  stats->set_count(stats->count() + 1);
+  stats->set_total_time_ns(stats->total_time_ns() + duration_ns);
+  stats->set_average_time_ns(stats->total_time_ns() / stats->count());
+
+  if (duration_ns > stats->max_ns()) {
+    stats->set_max_ns(duration_ns);
+  }
+
+  if (stats->min_ns() == 0 || duration_ns < stats->min_ns()) {
+    stats->set_min_ns(duration_ns);
+  }
+
+  const uint32_t index = GetDurationHistogramBucketIndex(duration_ns);
+  auto* histogram = stats->mutable_duration_histogram();
+  while (static_cast<uint32_t>(histogram->size()) <= index) histogram->Add(0);
+  histogram->Set(index, histogram->Get(index) + 1);
+}
+
+void AddLog2DurationHistogramToStats(
+    const google::protobuf::RepeatedField<uint64_t>& log2_histogram, FunctionStats* stats) {
+  auto* histogram = stats->mutable_duration_histogram();
+  for (int log2_index = 0; log2_index < log2_histogram.size(); ++log2_index) {
+    const uint64_t count = log2_histogram.Get(log2_index);
+    if (count == 0) continue;
+    const uint64_t lower_bound_ns = log2_index == 0 ? 0 : uint64_t{1} << log2_index;
+    const uint64_t midpoint_ns = log2_index == 0 ? 1 : lower_bound_ns + lower_bound_ns / 2;
+    const uint32_t index = GetDurationHistogramBucketIndex(midpoint_ns);
+    while (static_cast<uint32_t>(histogram->size()) <= index) histogram->Add(0);
+    histogram->Set(index, histogram->Get(index) + count);
+  }
+}
+
+void MergeFunctionStats(const FunctionStats& other, FunctionStats* stats) {
+  if (other.count() == 0) return;
+  const bool was_empty = stats->count() == 0;
+  stats->set_count(stats->count() + other.count());
+  stats->set_total_time_ns(stats->total_time_ns() + other.total_time_ns());
+  stats->set_average_time_ns(stats->total_time_ns() / stats->count());
+  stats->set_max_ns(std::max(stats->max_ns(), other.max_ns()));
+  if (was_empty || other.min_ns() < stats->min_ns()) {
+    stats->set_min_ns(other.min_ns());
+  }
+
+  auto* histogram = stats->mutable_duration_histogram();
+  while (histogram->size() < other.duration_histogram_size()) histogram->Add(0);
+  for (int i = 0; i < other.duration_histogram_size(); ++i) {
+    histogram->Set(i, histogram->Get(i) + other.duration_histogram(i));
+  }
+}
+
+std::optional<uint64_t> GetDurationPercentileNs(const FunctionStats& stats, double percentile) {
+  if (stats.duration_histogram_size() == 0) return std::nullopt;
+  CHECK(percentile >= 0 && percentile <= 1);
+
+  uint64_t count = 0;
+  for (uint64_t bucket_count : stats.duration_histogram()) count += bucket_count;
+  // The rank (starting from 1) of the call whose duration to return.
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(count))));
+  // The extremes are known exactly.
+  if (rank == 1) return stats.min_ns();
+  if (rank >= count) return stats.max_ns();
+
+  uint64_t calls_so_far = 0;
+  for (int index = 0; index < stats.duration_histogram_size(); ++index) {
+    calls_so_far += stats.duration_histogram(index);
+    if (calls_so_far < rank) continue;
+
+    // Report the middle of the bucket, but never outside the exact extremes.
+    const uint64_t lower_bound = GetDurationHistogramBucketLowerBoundNs(index);
+    const uint64_t estimate = lower_bound + (GetBucketWidthNs(index) - 1) / 2;
+    return std::clamp(estimate, stats.min_ns(), std::max(stats.min_ns(), stats.max_ns()));
+  }
+  return stats.max_ns();
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,127 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+#include "ClientData/FunctionStatsUtils.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::FunctionStats;
+
+namespace orbit_client_data {
+
+TEST(FunctionStatsUtils, BucketIndexAndLowerBoundAreConsistent) {
+  EXPECT_EQ(GetDurationHistogramBucketIndex(0), 0);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(15), 15);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(16), 16);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(31), 31);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(32), 32);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(33), 32);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(34), 33);
+
+  uint32_t previous_index = 0;
+  for (uint64_t duration_ns = 1; duration_ns < 1'000'000; duration_ns += duration_ns / 7 + 1) {
+    const uint32_t index = GetDurationHistogramBucketIndex(duration_ns);
+    EXPECT_GE(index, previous_index);
+    EXPECT_LE(GetDurationHistogramBucketLowerBoundNs(index), duration_ns);
+    EXPECT_GT(GetDurationHistogramBucketLowerBoundNs(index + 1), duration_ns);
+    previous_index = index;
+  }
+
+  const uint32_t max_index = GetDurationHistogramBucketIndex(std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(max_index, 975);
+  EXPECT_EQ(GetDurationHistogramBucketIndex(GetDurationHistogramBucketLowerBoundNs(max_index)),
+            max_index);
+}
+
+TEST(FunctionStatsUtils, AddFunctionCallToStats) {
+  FunctionStats stats;
+  AddFunctionCallToStats(100, &stats);
+  AddFunctionCallToStats(300, &stats);
+  AddFunctionCallToStats(20, &stats);
+
+  EXPECT_EQ(stats.count(), 3);
+  EXPECT_EQ(stats.total_time_ns(), 420);
+  EXPECT_EQ(stats.average_time_ns(), 140);
+  EXPECT_EQ(stats.min_ns(), 20);
+  EXPECT_EQ(stats.max_ns(), 300);
+
+  ASSERT_EQ(stats.duration_histogram_size(), GetDurationHistogramBucketIndex(300) + 1);
+  uint64_t histogram_count = 0;
+  for (uint64_t bucket_count : stats.duration_histogram()) histogram_count += bucket_count;
+  EXPECT_EQ(histogram_count, 3);
+  EXPECT_EQ(stats.duration_histogram(GetDurationHistogramBucketIndex(100)), 1);
+}
+
+TEST(FunctionStatsUtils, AddLog2DurationHistogramToStats) {
+  google::protobuf::RepeatedField<uint64_t> log2_histogram;
+  log2_histogram.Add(2);  // [0, 1]
+  log2_histogram.Add(0);  // [2, 3]
+  log2_histogram.Add(0);  // [4, 7]
+  log2_histogram.Add(0);  // [8, 15]
+  log2_histogram.Add(0);  // [16, 31]
+  log2_histogram.Add(3);  // [32, 63]
+
+  FunctionStats stats;
+  AddLog2DurationHistogramToStats(log2_histogram, &stats);
+  AddLog2DurationHistogramToStats(log2_histogram, &stats);
+
+  EXPECT_EQ(stats.count(), 0);
+  ASSERT_EQ(stats.duration_histogram_size(), GetDurationHistogramBucketIndex(48) + 1);
+  EXPECT_EQ(stats.duration_histogram(GetDurationHistogramBucketIndex(1)), 4);
+  EXPECT_EQ(stats.duration_histogram(GetDurationHistogramBucketIndex(48)), 6);
+  uint64_t histogram_count = 0;
+  for (uint64_t bucket_count : stats.duration_histogram()) histogram_count += bucket_count;
+  EXPECT_EQ(histogram_count, 10);
+}
+
+TEST(FunctionStatsUtils, MergeFunctionStatsEqualsAddingAllCalls) {
+  FunctionStats all;
+  FunctionStats first;
+  FunctionStats second;
+  for (uint64_t duration_ns = 1; duration_ns < 100'000; duration_ns *= 3) {
+    AddFunctionCallToStats(duration_ns, &all);
+    AddFunctionCallToStats(duration_ns, duration_ns % 2 == 0 ? &first : &second);
+  }
+
+  FunctionStats merged;
+  MergeFunctionStats(first, &merged);
+  MergeFunctionStats(FunctionStats{}, &merged);
+  MergeFunctionStats(second, &merged);
+  EXPECT_EQ(merged.SerializeAsString(), all.SerializeAsString());
+}
+
+TEST(FunctionStatsUtils, GetDurationPercentileNs) {
+  EXPECT_EQ(GetDurationPercentileNs(FunctionStats{}, 0.5), std::nullopt);
+
+  FunctionStats stats;
+  for (uint64_t duration_ns = 1'000; duration_ns <= 100'000; duration_ns += 1'000) {
+    AddFunctionCallToStats(duration_ns, &stats);
+  }
+
+  const auto expect_near = [&stats](double percentile, uint64_t expected_ns) {
+    std::optional<uint64_t> result = GetDurationPercentileNs(stats, percentile);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_NEAR(static_cast<double>(result.value()), static_cast<double>(expected_ns),
+                expected_ns / static_cast<double>(kDurationHistogramSubBucketCount));
+  };
+  expect_near(0.5, 50'000);
+  expect_near(0.95, 95'000);
+  expect_near(0.99, 99'000);
+
+  EXPECT_EQ(GetDurationPercentileNs(stats, 0), 1'000);
+  EXPECT_EQ(GetDurationPercentileNs(stats, 1), 100'000);
+}
+
+TEST(FunctionStatsUtils, GetDurationPercentileNsIsClampedToMinAndMax) {
+  FunctionStats stats;
+  AddFunctionCallToStats(1'000'001, &stats);
+  EXPECT_EQ(GetDurationPercentileNs(stats, 0.5), 1'000'001);
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,119 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/FunctionTimerIndex.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+[[nodiscard]] bool EndsBefore(const TextBox* lhs, const TextBox* rhs) {
+  return lhs->End() < rhs->End();
+}
+
+}  // namespace
+
+void FunctionTimerIndex::Add(const TextBox* text_box) {
+  CHECK(text_box != nullptr);
+  absl::MutexLock lock(&mutex_);
+  FunctionTimers& timers = function_timers_[text_box->GetPackedTimerInfo().function_id()];
+  // Timers mostly arrive by end timestamp, so the position is usually the end of the vector, and
+  // otherwise close to it.
+  timers.by_end.insert(
+      std::upper_bound(timers.by_end.begin(), timers.by_end.end(), text_box, EndsBefore),
+      text_box);
+  timers.by_duration.clear();
+}
+
+size_t FunctionTimerIndex::GetCount(uint64_t function_id) const {
+  absl::MutexLock lock(&mutex_);
+  auto it = function_timers_.find(function_id);
+  if (it == function_timers_.end()) return 0;
+  return it->second.by_end.size();
+}
+
+const TextBox* FunctionTimerIndex::FindPrevious(uint64_t function_id, uint64_t time,
+                                                std::optional<int32_t> thread_id) const {
+  absl::MutexLock lock(&mutex_);
+  auto timers_it = function_timers_.find(function_id);
+  if (timers_it == function_timers_.end()) return nullptr;
+  const std::vector<const TextBox*>& by_end = timers_it->second.by_end;
+
+  // The first timer that doesn't end before `time`.
+  auto it = std::lower_bound(
+      by_end.begin(), by_end.end(), time,
+      [](const TextBox* box, uint64_t timestamp) { return box->End() < timestamp; });
+  while (it != by_end.begin()) {
+    --it;
+    if (!thread_id.has_value() || (*it)->GetPackedTimerInfo().thread_id() == thread_id.value()) {
+      return *it;
+    }
+  }
+  return nullptr;
+}
+
+const TextBox* FunctionTimerIndex::FindNext(uint64_t function_id, uint64_t time,
+                                            std::optional<int32_t> thread_id) const {
+  absl::MutexLock lock(&mutex_);
+  auto timers_it = function_timers_.find(function_id);
+  if (timers_it == function_timers_.end()) return nullptr;
+  const std::vector<const TextBox*>& by_end = timers_it->second.by_end;
+
+  // The first timer that ends after `time`.
+  auto it = std::upper_bound(
+      by_end.begin(), by_end.end(), time,
+      [](uint64_t timestamp, const TextBox* box) { return timestamp < box->End(); });
+  for (; it != by_end.end(); ++it) {
+    if (!thread_id.has_value() || (*it)->GetPackedTimerInfo().thread_id() == thread_id.value()) {
+      return *it;
+    }
+  }
+  return nullptr;
+}
+
+const TextBox* FunctionTimerIndex::FindNthLongest(uint64_t function_id, size_t n) const {
+  absl::MutexLock lock(&mutex_);
+  auto timers_it = function_timers_.find(function_id);
+  if (timers_it == function_timers_.end()) return nullptr;
+  FunctionTimers& timers = timers_it->second;
+  if (n >= timers.by_end.size()) return nullptr;
+
+  SortByDurationIfNeeded(&timers);
+  return timers.by_duration[n];
+}
+
+std::vector<const TextBox*> FunctionTimerIndex::GetLongestCalls(uint64_t function_id,
+                                                                uint64_t min_duration_ns,
+                                                                size_t max_count) const {
+  absl::MutexLock lock(&mutex_);
+  auto timers_it = function_timers_.find(function_id);
+  if (timers_it == function_timers_.end()) return {};
+  FunctionTimers& timers = timers_it->second;
+
+  SortByDurationIfNeeded(&timers);
+  // The first call that is shorter than `min_duration_ns`.
+  auto end = std::partition_point(
+      timers.by_duration.begin(), timers.by_duration.end(),
+      [min_duration_ns](const TextBox* box) { return box->Duration() >= min_duration_ns; });
+  if (static_cast<size_t>(end - timers.by_duration.begin()) > max_count) {
+    end = timers.by_duration.begin() + max_count;
+  }
+  return {timers.by_duration.begin(), end};
+}
+
+void FunctionTimerIndex::SortByDurationIfNeeded(FunctionTimers* timers) {
+  if (!timers->by_duration.empty()) return;
+  timers->by_duration = timers->by_end;
+  // Stable, so that calls of the same duration stay ordered by end timestamp.
+  std::stable_sort(timers->by_duration.begin(), timers->by_duration.end(),
+                   [](const TextBox* lhs, const TextBox* rhs) {
+                     return lhs->Duration() > rhs->Duration();
+                   });
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "ClientData/FunctionTimerIndex.h"
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+using testing::ElementsAre;
+
+namespace orbit_client_data {
+
+namespace {
+
+constexpr uint64_t kFunctionId = 1;
+constexpr uint64_t kOtherFunctionId = 2;
+constexpr int32_t kThreadId = 10;
+constexpr int32_t kOtherThreadId = 11;
+
+const TextBox* AddTimer(TimerChain* chain, uint64_t function_id, int32_t thread_id, uint64_t start,
+                        uint64_t end) {
+  TimerInfo timer_info;
+  timer_info.set_function_id(function_id);
+  timer_info.set_thread_id(thread_id);
+  timer_info.set_start(start);
+  timer_info.set_end(end);
+  return &chain->emplace_back(timer_info);
+}
+
+}  // namespace
+
+TEST(FunctionTimerIndex, FindsPreviousAndNextCalls) {
+  TimerChain chain;
+  FunctionTimerIndex index;
+  // Out of order, as timers of different threads can arrive.
+  const TextBox* second = AddTimer(&chain, kFunctionId, kThreadId, 20, 30);
+  const TextBox* first = AddTimer(&chain, kFunctionId, kOtherThreadId, 0, 10);
+  const TextBox* third = AddTimer(&chain, kFunctionId, kOtherThreadId, 40, 50);
+  const TextBox* other_function = AddTimer(&chain, kOtherFunctionId, kThreadId, 30, 35);
+  for (const TextBox* text_box : {second, first, third, other_function}) {
+    index.Add(text_box);
+  }
+
+  EXPECT_EQ(index.GetCount(kFunctionId), 3);
+  EXPECT_EQ(index.GetCount(kOtherFunctionId), 1);
+  EXPECT_EQ(index.GetCount(3), 0);
+
+  EXPECT_EQ(index.FindNext(kFunctionId, 0), first);
+  EXPECT_EQ(index.FindNext(kFunctionId, 10), second);
+  EXPECT_EQ(index.FindNext(kFunctionId, 30), third);
+  EXPECT_EQ(index.FindNext(kFunctionId, 50), nullptr);
+  EXPECT_EQ(index.FindNext(kFunctionId, 0, kThreadId), second);
+  EXPECT_EQ(index.FindNext(kFunctionId, 30, kThreadId), nullptr);
+
+  EXPECT_EQ(index.FindPrevious(kFunctionId, 60), third);
+  EXPECT_EQ(index.FindPrevious(kFunctionId, 50), second);
+  EXPECT_EQ(index.FindPrevious(kFunctionId, 30), first);
+  EXPECT_EQ(index.FindPrevious(kFunctionId, 10), nullptr);
+  EXPECT_EQ(index.FindPrevious(kFunctionId, 60, kOtherThreadId), third);
+  EXPECT_EQ(index.FindPrevious(kFunctionId, 50, kOtherThreadId), first);
+
+  EXPECT_EQ(index.FindNext(3, 0), nullptr);
+  EXPECT_EQ(index.FindPrevious(3, 100), nullptr);
+}
+
+TEST(FunctionTimerIndex, FindsNthLongestCall) {
+  TimerChain chain;
+  FunctionTimerIndex index;
+  const TextBox* short_call = AddTimer(&chain, kFunctionId, kThreadId, 0, 5);
+  const TextBox* long_call = AddTimer(&chain, kFunctionId, kThreadId, 10, 30);
+  const TextBox* medium_call = AddTimer(&chain, kFunctionId, kThreadId, 40, 50);
+  for (const TextBox* text_box : {short_call, long_call, medium_call}) {
+    index.Add(text_box);
+  }
+
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 0), long_call);
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 1), medium_call);
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 2), short_call);
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 3), nullptr);
+  EXPECT_EQ(index.FindNthLongest(kOtherFunctionId, 0), nullptr);
+
+  // Adding a call invalidates the order by duration. Of equal durations, earlier calls come first.
+  const TextBox* other_long_call = AddTimer(&chain, kFunctionId, kThreadId, 60, 80);
+  index.Add(other_long_call);
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 0), long_call);
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 1), other_long_call);
+  EXPECT_EQ(index.FindNthLongest(kFunctionId, 3), short_call);
+
+  EXPECT_THAT(index.GetLongestCalls(kFunctionId, /*min_duration_ns=*/10, /*max_count=*/10),
+              ElementsAre(long_call, other_long_call, medium_call));
+  EXPECT_THAT(index.GetLongestCalls(kFunctionId, /*min_duration_ns=*/10, /*max_count=*/1),
+              ElementsAre(long_call));
+  EXPECT_TRUE(index.GetLongestCalls(kOtherFunctionId, 0, 10).empty());
+}
+
+}  // namespace orbit_client_data
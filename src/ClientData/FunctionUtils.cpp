@@ -6,10 +6,12 @@
 
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_join.h>
+#include <llvm/Demangle/Demangle.h>
 
 #include <filesystem>
 #include <utility>
 
+#include "ClientData/DemanglingCache.h"
 #include "OrbitBase/Logging.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/match.h"
@@ -21,6 +23,14 @@ namespace {
 uint64_t StringHash(const std::string& string) {
   return XXH64(string.data(), string.size(), 0xBADDCAFEDEAD10CC);
 }
+
+DemanglingCache& GetDemanglingCache() {
+  static DemanglingCache demangling_cache;
+  return demangling_cache;
+}
+
+// The prefix of the mangled names of the functions in the orbit_api namespace.
+constexpr const char* kOrbitApiMangledNamePrefix = "_ZN9orbit_api";
 }  // namespace
 
 namespace function_utils {
@@ -36,7 +46,17 @@ std::string GetLoadedModuleNameByPath(std::string_view module_path) {
   return std::filesystem::path(module_path).filename().string();
 }
 
-uint64_t GetHash(const FunctionInfo& func) { return StringHash(func.pretty_name()); }
+const std::string& GetDisplayName(const FunctionInfo& func) {
+  if (!func.pretty_name().empty()) return func.pretty_name();
+  return GetDemanglingCache().Demangle(func.name());
+}
+
+std::string GetDisplayNameWithoutCaching(const FunctionInfo& func) {
+  if (!func.pretty_name().empty()) return func.pretty_name();
+  return llvm::demangle(func.name());
+}
+
+uint64_t GetHash(const FunctionInfo& func) { return StringHash(GetDisplayName(func)); }
 uint64_t GetHash(std::string_view function_name) { return StringHash(std::string(function_name)); }
 
 uint64_t Offset(const FunctionInfo& func, const ModuleData& module) {
@@ -116,8 +136,13 @@ FunctionInfo::OrbitType GetOrbitTypeByName(const std::string& function_name) {
 }
 
 // Detect Orbit API functions by looking for special function names part of the
-// orbit_api namespace. On a match, set the corresponding function type.
+// orbit_api namespace. On a match, set the corresponding function type. Only names that can be in
+// the orbit_api namespace are demangled, so that loading symbols doesn't demangle all names.
 void SetOrbitTypeFromName(FunctionInfo* func) {
+  if (func->pretty_name().empty() && !absl::StartsWith(func->name(), kOrbitApiMangledNamePrefix)) {
+    func->set_orbit_type(GetOrbitTypeByName(func->name()));
+    return;
+  }
   func->set_orbit_type(GetOrbitTypeByName(GetDisplayName(*func)));
 }
 
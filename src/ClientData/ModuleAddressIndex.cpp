@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/ModuleAddressIndex.h"
+
+#include <atomic>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+std::atomic<uint64_t> next_generation{1};
+
+struct LastFoundModule {
+  uint64_t generation = 0;
+  size_t position = 0;
+};
+
+thread_local LastFoundModule last_found_module;
+
+}  // namespace
+
+ModuleAddressIndex::ModuleAddressIndex(
+    const std::map<uint64_t, ModuleInMemory>& start_address_to_module)
+    : generation_{next_generation.fetch_add(1, std::memory_order_relaxed)} {
+  start_addresses_.reserve(start_address_to_module.size());
+  end_addresses_.reserve(start_address_to_module.size());
+  modules_.reserve(start_address_to_module.size());
+  for (const auto& [unused_start_address, module_in_memory] : start_address_to_module) {
+    CHECK(end_addresses_.empty() || end_addresses_.back() <= module_in_memory.start());
+    start_addresses_.push_back(module_in_memory.start());
+    end_addresses_.push_back(module_in_memory.end());
+    modules_.push_back(module_in_memory);
+  }
+}
+
+const ModuleInMemory* ModuleAddressIndex::Find(uint64_t absolute_address) const {
+  if (modules_.empty()) return nullptr;
+  if (last_found_module.generation == generation_ &&
+      Contains(last_found_module.position, absolute_address)) {
+    return &modules_[last_found_module.position];
+  }
+
+  // Branchless search for the number of modules starting at or before `absolute_address`.
+  const uint64_t* base = start_addresses_.data();
+  size_t length = start_addresses_.size();
+  while (length > 1) {
+    const size_t half = length / 2;
+    base += (base[half - 1] <= absolute_address) ? half : 0;
+    length -= half;
+  }
+  const size_t count =
+      static_cast<size_t>(base - start_addresses_.data()) + (*base <= absolute_address ? 1 : 0);
+  if (count == 0) return nullptr;
+  const size_t position = count - 1;
+  if (!Contains(position, absolute_address)) return nullptr;
+
+  last_found_module = {generation_, position};
+  return &modules_[position];
+}
+
+std::vector<const ModuleInMemory*> ModuleAddressIndex::FindAll(
+    absl::Span<const uint64_t> absolute_addresses) const {
+  std::vector<const ModuleInMemory*> result;
+  result.reserve(absolute_addresses.size());
+  for (uint64_t absolute_address : absolute_addresses) {
+    result.push_back(Find(absolute_address));
+  }
+  return result;
+}
+
+}  // namespace orbit_client_data
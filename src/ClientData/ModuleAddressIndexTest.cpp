@@ -0,0 +1,82 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "ClientData/ModuleAddressIndex.h"
+#include "ClientData/ModuleInMemory.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+std::map<uint64_t, ModuleInMemory> CreateModules() {
+  std::map<uint64_t, ModuleInMemory> modules;
+  modules.emplace(0x1000, ModuleInMemory{0x1000, 0x2000, "/path/to/a", "build_id_a"});
+  modules.emplace(0x2000, ModuleInMemory{0x2000, 0x2800, "/path/to/b", "build_id_b"});
+  modules.emplace(0x5000, ModuleInMemory{0x5000, 0x6000, "/path/to/c", "build_id_c"});
+  return modules;
+}
+
+}  // namespace
+
+TEST(ModuleAddressIndex, Empty) {
+  ModuleAddressIndex index;
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.Find(0x1000), nullptr);
+}
+
+TEST(ModuleAddressIndex, Find) {
+  ModuleAddressIndex index{CreateModules()};
+  EXPECT_EQ(index.size(), 3);
+
+  EXPECT_EQ(index.Find(0), nullptr);
+  EXPECT_EQ(index.Find(0xfff), nullptr);
+  ASSERT_NE(index.Find(0x1000), nullptr);
+  EXPECT_EQ(index.Find(0x1000)->file_path(), "/path/to/a");
+  EXPECT_EQ(index.Find(0x1fff)->file_path(), "/path/to/a");
+  // The end address is not part of the module, but may be the start of the next one.
+  EXPECT_EQ(index.Find(0x2000)->file_path(), "/path/to/b");
+  EXPECT_EQ(index.Find(0x27ff)->file_path(), "/path/to/b");
+  EXPECT_EQ(index.Find(0x2800), nullptr);
+  EXPECT_EQ(index.Find(0x4fff), nullptr);
+  EXPECT_EQ(index.Find(0x5000)->build_id(), "build_id_c");
+  EXPECT_EQ(index.Find(0x6000), nullptr);
+  EXPECT_EQ(index.Find(UINT64_MAX), nullptr);
+}
+
+TEST(ModuleAddressIndex, FindAfterLastFoundModule) {
+  // The module found last is checked first, which must not return it for addresses outside of it,
+  // also when it was found in another index.
+  ModuleAddressIndex index{CreateModules()};
+  ASSERT_NE(index.Find(0x1800), nullptr);
+  EXPECT_EQ(index.Find(0x1900)->file_path(), "/path/to/a");
+  EXPECT_EQ(index.Find(0x5800)->file_path(), "/path/to/c");
+  EXPECT_EQ(index.Find(0x2800), nullptr);
+
+  std::map<uint64_t, ModuleInMemory> other_modules;
+  other_modules.emplace(0x5000, ModuleInMemory{0x5000, 0x5100, "/path/to/d", "build_id_d"});
+  ModuleAddressIndex other_index{other_modules};
+  EXPECT_EQ(other_index.Find(0x5800), nullptr);
+  EXPECT_EQ(other_index.Find(0x5000)->file_path(), "/path/to/d");
+  EXPECT_EQ(index.Find(0x5000)->file_path(), "/path/to/c");
+}
+
+TEST(ModuleAddressIndex, FindAll) {
+  ModuleAddressIndex index{CreateModules()};
+  const std::vector<uint64_t> addresses{0x5010, 0x1010, 0x1020, 0x3000, 0x2010};
+  const std::vector<const ModuleInMemory*> modules = index.FindAll(addresses);
+  ASSERT_EQ(modules.size(), addresses.size());
+  EXPECT_EQ(modules[0]->file_path(), "/path/to/c");
+  EXPECT_EQ(modules[1]->file_path(), "/path/to/a");
+  EXPECT_EQ(modules[2]->file_path(), "/path/to/a");
+  EXPECT_EQ(modules[3], nullptr);
+  EXPECT_EQ(modules[4]->file_path(), "/path/to/b");
+}
+
+}  // namespace orbit_client_data
@@ -5,6 +5,8 @@
 #include "ClientData/ModuleData.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/strings/ascii.h>
+#include <absl/strings/match.h>
 
 #include <algorithm>
 
@@ -29,6 +31,13 @@ bool ModuleData::NeedsUpdate(const orbit_grpc_protos::ModuleInfo& info) const {
          load_bias() != info.load_bias();
 }
 
+void ModuleData::OnFunctionsChanged() {
+  function_name_index_.reset();
+  function_address_index_is_outdated_ = true;
+  name_maps_are_outdated_ = true;
+  ++functions_generation_;
+}
+
 bool ModuleData::UpdateIfChangedAndUnload(ModuleInfo info) {
   absl::MutexLock lock(&mutex_);
 
@@ -50,7 +59,7 @@ bool ModuleData::UpdateIfChangedAndUnload(ModuleInfo info) {
   LOG("Module %s contained symbols. Because the module changed, those are now removed.",
       file_path());
   functions_.clear();
-  hash_to_function_map_.clear();
+  OnFunctionsChanged();
   is_loaded_ = false;
 
   return true;
@@ -82,23 +91,46 @@ const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionByOffset(uint64
 const FunctionInfo* ModuleData::FindFunctionByElfAddress(uint64_t elf_address,
                                                          bool is_exact) const {
   absl::MutexLock lock(&mutex_);
-  if (functions_.empty()) return nullptr;
+  return FindFunctionByElfAddressLocked(elf_address, is_exact);
+}
 
-  if (is_exact) {
-    auto it = functions_.find(elf_address);
-    return (it != functions_.end()) ? it->second.get() : nullptr;
+std::vector<const FunctionInfo*> ModuleData::FindFunctionsByOffsets(
+    absl::Span<const uint64_t> offsets, bool is_exact) const {
+  std::vector<const FunctionInfo*> functions;
+  functions.reserve(offsets.size());
+  absl::MutexLock lock(&mutex_);
+  for (uint64_t offset : offsets) {
+    functions.push_back(FindFunctionByElfAddressLocked(offset + load_bias(), is_exact));
   }
+  return functions;
+}
 
-  auto it = functions_.upper_bound(elf_address);
-  if (it == functions_.begin()) return nullptr;
-
-  --it;
-  FunctionInfo* function = it->second.get();
-  CHECK(function->address() <= elf_address);
+const FunctionInfo* ModuleData::FindFunctionByElfAddressLocked(uint64_t elf_address,
+                                                               bool is_exact) const {
+  if (functions_.empty()) return nullptr;
+  UpdateFunctionAddressIndex();
 
-  if (function->address() + function->size() < elf_address) return nullptr;
+  std::optional<size_t> position = is_exact ? function_address_index_.FindExact(elf_address)
+                                            : function_address_index_.FindContaining(elf_address);
+  if (!position.has_value()) return nullptr;
+  return functions_by_address_[position.value()];
+}
 
-  return function;
+void ModuleData::UpdateFunctionAddressIndex() const {
+  if (!function_address_index_is_outdated_) return;
+  functions_by_address_.clear();
+  functions_by_address_.reserve(functions_.size());
+  std::vector<uint64_t> start_addresses;
+  start_addresses.reserve(functions_.size());
+  std::vector<uint64_t> sizes;
+  sizes.reserve(functions_.size());
+  for (const auto& [address, function] : functions_) {
+    functions_by_address_.push_back(function.get());
+    start_addresses.push_back(address);
+    sizes.push_back(function->size());
+  }
+  function_address_index_ = FunctionAddressIndex{std::move(start_addresses), sizes};
+  function_address_index_is_outdated_ = false;
 }
 
 void ModuleData::AddFunctionInfoWithBuildId(const FunctionInfo& function_info,
@@ -108,6 +140,7 @@ void ModuleData::AddFunctionInfoWithBuildId(const FunctionInfo& function_info,
   auto value = std::make_unique<FunctionInfo>(function_info);
   value->set_module_build_id(module_build_id);
   functions_.insert_or_assign(function_info.address(), std::move(value));
+  OnFunctionsChanged();
   is_loaded_ = true;
 }
 
@@ -116,12 +149,7 @@ void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbo
   CHECK(!is_loaded_);
 
   uint32_t address_reuse_counter = 0;
-  uint32_t name_reuse_counter = 0;
   for (const orbit_grpc_protos::SymbolInfo& symbol_info : module_symbols.symbol_infos()) {
-    auto [inserted_it, success_functions] = functions_.try_emplace(
-        symbol_info.address(),
-        function_utils::CreateFunctionInfo(symbol_info, file_path(), build_id()));
-    FunctionInfo* function = inserted_it->second.get();
     // It happens that the same address has multiple symbol names associated
     // with it. For example: (all the same address)
     // __cxxabiv1::__enum_type_info::~__enum_type_info()
@@ -129,46 +157,95 @@ void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbo
     // __cxxabiv1::__array_type_info::~__array_type_info()
     // __cxxabiv1::__class_type_info::~__class_type_info()
     // __cxxabiv1::__pbase_type_info::~__pbase_type_info()
-    if (success_functions) {
-      CHECK(!function->pretty_name().empty());
-      // Be careful about the scope, the key is a string_view. This is done to avoid name
-      // duplication.
-      bool success_function_name =
-          name_to_function_info_map_.try_emplace(function->pretty_name(), function).second;
-      if (!success_function_name) {
-        name_reuse_counter++;
-      }
-
-      hash_to_function_map_.try_emplace(function_utils::GetHash(*function), function);
-    } else {
+    bool success_functions =
+        functions_
+            .try_emplace(symbol_info.address(),
+                         function_utils::CreateFunctionInfo(symbol_info, file_path(), build_id()))
+            .second;
+    if (!success_functions) {
       address_reuse_counter++;
     }
   }
   if (address_reuse_counter != 0) {
     LOG("Warning: %d absolute addresses are used by more than one symbol", address_reuse_counter);
   }
+
+  OnFunctionsChanged();
+  is_loaded_ = true;
+}
+
+void ModuleData::UpdateNameMaps() const {
+  if (!name_maps_are_outdated_) return;
+  name_to_function_info_map_.clear();
+  hash_to_function_map_.clear();
+  uint32_t name_reuse_counter = 0;
+  for (const auto& [unused_address, function] : functions_) {
+    // Be careful about the scope, the key is a string_view. This is done to avoid name
+    // duplication. The display name is either owned by the function or cached forever.
+    bool success_function_name =
+        name_to_function_info_map_
+            .try_emplace(function_utils::GetDisplayName(*function), function.get())
+            .second;
+    if (!success_function_name) {
+      name_reuse_counter++;
+    }
+
+    hash_to_function_map_.try_emplace(function_utils::GetHash(*function), function.get());
+  }
   if (name_reuse_counter != 0) {
     LOG("Warning: %d function name collisions happened (functions with the same demangled name). "
         "This is currently not supported by presets, since the presets are based on the demangled "
         "name.",
         name_reuse_counter);
   }
-
-  is_loaded_ = true;
+  name_maps_are_outdated_ = false;
 }
 
 const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionFromHash(uint64_t hash) const {
   absl::MutexLock lock(&mutex_);
+  UpdateNameMaps();
   return hash_to_function_map_.contains(hash) ? hash_to_function_map_.at(hash) : nullptr;
 }
 
 const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionFromPrettyName(
     std::string_view pretty_name) const {
   absl::MutexLock lock(&mutex_);
+  UpdateNameMaps();
   auto it = name_to_function_info_map_.find(pretty_name);
   return it != name_to_function_info_map_.end() ? it->second : nullptr;
 }
 
+std::vector<const FunctionInfo*> ModuleData::FindFunctionsFromHashes(
+    absl::Span<const uint64_t> hashes) const {
+  std::vector<const FunctionInfo*> functions;
+  functions.reserve(hashes.size());
+  absl::MutexLock lock(&mutex_);
+  UpdateNameMaps();
+  for (uint64_t hash : hashes) {
+    auto it = hash_to_function_map_.find(hash);
+    functions.push_back(it != hash_to_function_map_.end() ? it->second : nullptr);
+  }
+  return functions;
+}
+
+std::vector<const FunctionInfo*> ModuleData::FindFunctionsFromPrettyNames(
+    absl::Span<const std::string> pretty_names) const {
+  std::vector<const FunctionInfo*> functions;
+  functions.reserve(pretty_names.size());
+  absl::MutexLock lock(&mutex_);
+  UpdateNameMaps();
+  for (const std::string& pretty_name : pretty_names) {
+    auto it = name_to_function_info_map_.find(pretty_name);
+    functions.push_back(it != name_to_function_info_map_.end() ? it->second : nullptr);
+  }
+  return functions;
+}
+
+void ModuleData::BuildNameMaps() const {
+  absl::MutexLock lock(&mutex_);
+  UpdateNameMaps();
+}
+
 std::vector<const FunctionInfo*> ModuleData::GetFunctions() const {
   absl::MutexLock lock(&mutex_);
   std::vector<const FunctionInfo*> result;
@@ -179,6 +256,62 @@ std::vector<const FunctionInfo*> ModuleData::GetFunctions() const {
   return result;
 }
 
+std::vector<const FunctionInfo*> ModuleData::FindFunctionsByNameSubstring(
+    std::string_view substring) const {
+  std::string lowercase_substring{substring};
+  absl::AsciiStrToLower(&lowercase_substring);
+  absl::MutexLock lock(&mutex_);
+  std::optional<std::vector<uint32_t>> candidates;
+  if (function_name_index_ != nullptr) {
+    candidates = function_name_index_->FindCandidates(lowercase_substring);
+  }
+
+  std::vector<const FunctionInfo*> result;
+  size_t next_candidate = 0;
+  uint32_t position = 0;
+  for (const auto& [unused_address, function] : functions_) {
+    const uint32_t function_position = position++;
+    if (candidates.has_value()) {
+      if (next_candidate == candidates->size()) break;
+      if ((*candidates)[next_candidate] != function_position) continue;
+      ++next_candidate;
+    }
+    if (absl::StrContains(
+            absl::AsciiStrToLower(function_utils::GetDisplayNameWithoutCaching(*function)),
+            lowercase_substring)) {
+      result.push_back(function.get());
+    }
+  }
+  return result;
+}
+
+void ModuleData::BuildFunctionNameIndex() {
+  std::vector<std::string> lowercase_names;
+  uint64_t functions_generation;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (function_name_index_ != nullptr) return;
+    // Copy the names, so that the index can be built without holding the lock.
+    lowercase_names.reserve(functions_.size());
+    for (const auto& [unused_address, function] : functions_) {
+      lowercase_names.push_back(
+          absl::AsciiStrToLower(function_utils::GetDisplayNameWithoutCaching(*function)));
+    }
+    functions_generation = functions_generation_;
+  }
+
+  auto function_name_index = std::make_shared<const FunctionNameIndex>(lowercase_names);
+
+  absl::MutexLock lock(&mutex_);
+  if (functions_generation != functions_generation_) return;
+  function_name_index_ = std::move(function_name_index);
+}
+
+std::shared_ptr<const FunctionNameIndex> ModuleData::GetFunctionNameIndex() const {
+  absl::MutexLock lock(&mutex_);
+  return function_name_index_;
+}
+
 std::vector<FunctionInfo> ModuleData::GetOrbitFunctions() const {
   absl::MutexLock lock(&mutex_);
   CHECK(is_loaded_);
@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/strings/str_format.h>
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
 
@@ -161,6 +163,54 @@ TEST(ModuleData, FindFunctionByOffset) {
   }
 }
 
+TEST(ModuleData, FindFunctionsByOffsets) {
+  ModuleSymbols symbols;
+  SymbolInfo* symbol1 = symbols.add_symbol_infos();
+  symbol1->set_name("Name 1");
+  symbol1->set_demangled_name("Pretty Name 1");
+  symbol1->set_address(0x1100);
+  symbol1->set_size(0x10);
+  SymbolInfo* symbol2 = symbols.add_symbol_infos();
+  symbol2->set_name("Name 2");
+  symbol2->set_demangled_name("Pretty Name 2");
+  symbol2->set_address(0x1200);
+  symbol2->set_size(0x10);
+
+  ModuleInfo module_info{};
+  module_info.set_load_bias(0x1000);
+  ModuleData module{module_info};
+  EXPECT_THAT(module.FindFunctionsByOffsets({1, 2}, false), testing::ElementsAre(nullptr, nullptr));
+
+  module.AddSymbols(symbols);
+
+  // The offsets are the ELF addresses minus the load bias.
+  std::vector<const FunctionInfo*> functions =
+      module.FindFunctionsByOffsets({0x205, 0x105, 0x250}, false);
+  ASSERT_EQ(functions.size(), 3);
+  ASSERT_NE(functions[0], nullptr);
+  EXPECT_EQ(functions[0]->name(), "Name 2");
+  ASSERT_NE(functions[1], nullptr);
+  EXPECT_EQ(functions[1]->name(), "Name 1");
+  EXPECT_EQ(functions[2], nullptr);
+
+  functions = module.FindFunctionsByOffsets({0x100, 0x105}, true);
+  ASSERT_EQ(functions.size(), 2);
+  ASSERT_NE(functions[0], nullptr);
+  EXPECT_EQ(functions[0]->name(), "Name 1");
+  EXPECT_EQ(functions[1], nullptr);
+
+  // Functions added later are found too.
+  FunctionInfo function;
+  function.set_name("Name 3");
+  function.set_address(0x1300);
+  function.set_size(0x10);
+  module.AddFunctionInfoWithBuildId(function, "");
+  functions = module.FindFunctionsByOffsets({0x305}, false);
+  ASSERT_EQ(functions.size(), 1);
+  ASSERT_NE(functions[0], nullptr);
+  EXPECT_EQ(functions[0]->name(), "Name 3");
+}
+
 TEST(ModuleData, FindFunctionFromHash) {
   ModuleSymbols symbols;
 
@@ -188,6 +238,51 @@ TEST(ModuleData, FindFunctionFromHash) {
   }
 }
 
+TEST(ModuleData, FindFunctionsFromHashesAndPrettyNames) {
+  ModuleSymbols symbols;
+  for (uint64_t i = 0; i < 3; ++i) {
+    SymbolInfo* symbol = symbols.add_symbol_infos();
+    symbol->set_name(absl::StrFormat("symbol_%u", i));
+    symbol->set_demangled_name(absl::StrFormat("function_%u", i));
+    symbol->set_address(0x1000 * (i + 1));
+  }
+
+  ModuleData module{ModuleInfo{}};
+  module.AddSymbols(symbols);
+  module.BuildNameMaps();
+  const std::vector<const FunctionInfo*> functions = module.GetFunctions();
+  ASSERT_EQ(functions.size(), 3);
+
+  EXPECT_THAT(module.FindFunctionsFromPrettyNames({"function_2", "unknown", "function_0"}),
+              testing::ElementsAre(functions[2], nullptr, functions[0]));
+
+  const uint64_t hash = function_utils::GetHash(*functions[1]);
+  EXPECT_THAT(module.FindFunctionsFromHashes({hash, hash + 1}),
+              testing::ElementsAre(functions[1], nullptr));
+  EXPECT_TRUE(module.FindFunctionsFromHashes({}).empty());
+}
+
+TEST(ModuleData, DemanglesNamesOfSymbolsWithoutDemangledName) {
+  ModuleSymbols symbols;
+
+  SymbolInfo* symbol = symbols.add_symbol_infos();
+  symbol->set_name("_Z11deferred_fni");
+  symbol->set_address(0x1000);
+
+  ModuleData module{ModuleInfo{}};
+  module.AddSymbols(symbols);
+
+  ASSERT_EQ(module.GetFunctions().size(), 1);
+  const FunctionInfo* function = module.GetFunctions()[0];
+  EXPECT_EQ(function->pretty_name(), "");
+  EXPECT_EQ(function_utils::GetDisplayName(*function), "deferred_fn(int)");
+
+  EXPECT_EQ(module.FindFunctionFromPrettyName("deferred_fn(int)"), function);
+  EXPECT_EQ(module.FindFunctionFromHash(function_utils::GetHash("deferred_fn(int)")), function);
+  EXPECT_EQ(module.FindFunctionsByNameSubstring("DEFERRED_FN"),
+            std::vector<const FunctionInfo*>{function});
+}
+
 TEST(ModuleData, UpdateIfChanged) {
   std::string name = "Example Name";
   std::string file_path = "/test/file/path";
@@ -332,4 +427,48 @@ TEST(ModuleData, UpdateIfChangedWithBuildId) {
   EXPECT_TRUE(module.is_loaded());
 }
 
+TEST(ModuleData, FindFunctionsByNameSubstring) {
+  ModuleSymbols symbols;
+  uint64_t address = 0x100;
+  for (const char* demangled_name : {"void Foo()", "FooBar(int)", "bar::baz", "Ab"}) {
+    SymbolInfo* symbol = symbols.add_symbol_infos();
+    symbol->set_name(demangled_name);
+    symbol->set_demangled_name(demangled_name);
+    symbol->set_address(address);
+    symbol->set_size(0x10);
+    address += 0x10;
+  }
+
+  ModuleData module{ModuleInfo{}};
+  module.AddSymbols(symbols);
+  const std::vector<const FunctionInfo*> functions = module.GetFunctions();
+  ASSERT_EQ(functions.size(), 4);
+
+  // Without and with the index, the results are the same.
+  for (bool build_index : {false, true}) {
+    if (build_index) {
+      EXPECT_EQ(module.GetFunctionNameIndex(), nullptr);
+      module.BuildFunctionNameIndex();
+      ASSERT_NE(module.GetFunctionNameIndex(), nullptr);
+      EXPECT_EQ(module.GetFunctionNameIndex()->size(), functions.size());
+    }
+
+    EXPECT_THAT(module.FindFunctionsByNameSubstring("foo"),
+                testing::ElementsAre(functions[0], functions[1]));
+    EXPECT_THAT(module.FindFunctionsByNameSubstring("BAR"),
+                testing::ElementsAre(functions[1], functions[2]));
+    EXPECT_THAT(module.FindFunctionsByNameSubstring("b"),
+                testing::ElementsAre(functions[1], functions[2], functions[3]));
+    EXPECT_THAT(module.FindFunctionsByNameSubstring("foobarbaz"), testing::IsEmpty());
+  }
+
+  // Adding functions drops the index, which would be outdated.
+  FunctionInfo function_info;
+  function_info.set_pretty_name("foo_too");
+  function_info.set_address(0x1000);
+  module.AddFunctionInfoWithBuildId(function_info, "");
+  EXPECT_EQ(module.GetFunctionNameIndex(), nullptr);
+  EXPECT_EQ(module.FindFunctionsByNameSubstring("foo").size(), 3);
+}
+
 }  // namespace orbit_client_data
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -21,82 +22,89 @@ using orbit_client_protos::FunctionInfo;
 
 namespace orbit_client_data {
 
-std::vector<ModuleData*> ModuleManager::AddOrUpdateModules(
-    absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos) {
+std::shared_ptr<const ModuleManager::ModuleMap> ModuleManager::GetModuleMap() const {
   absl::MutexLock lock(&mutex_);
+  return module_map_;
+}
 
-  std::vector<ModuleData*> unloaded_modules;
+std::vector<ModuleData*> ModuleManager::AddModulesAndUpdateExisting(
+    absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos,
+    absl::FunctionRef<bool(ModuleData*, const orbit_grpc_protos::ModuleInfo&)>
+        update_existing_module) {
+  absl::MutexLock update_lock(&update_mutex_);
+  std::shared_ptr<const ModuleMap> module_map = GetModuleMap();
+  // Only copied if a module is added.
+  std::shared_ptr<ModuleMap> new_module_map;
+
+  std::vector<ModuleData*> updated_modules;
 
   for (const auto& module_info : module_infos) {
     auto module_id = std::make_pair(module_info.file_path(), module_info.build_id());
-    auto module_it = module_map_.find(module_id);
-    if (module_it == module_map_.end()) {
-      const bool success = module_map_.try_emplace(module_id, module_info).second;
+    const ModuleMap& current_module_map = new_module_map != nullptr ? *new_module_map : *module_map;
+    auto module_it = current_module_map.find(module_id);
+    if (module_it == current_module_map.end()) {
+      if (new_module_map == nullptr) new_module_map = std::make_shared<ModuleMap>(*module_map);
+      ModuleData* module = modules_.emplace_back(std::make_unique<ModuleData>(module_info)).get();
+      const bool success = new_module_map->try_emplace(std::move(module_id), module).second;
       CHECK(success);
-    } else {
-      ModuleData& module = module_it->second;
-      if (module.UpdateIfChangedAndUnload(module_info)) {
-        unloaded_modules.push_back(&module);
-      }
+    } else if (update_existing_module(module_it->second, module_info)) {
+      updated_modules.push_back(module_it->second);
     }
   }
 
-  return unloaded_modules;
+  if (new_module_map != nullptr) {
+    absl::MutexLock lock(&mutex_);
+    module_map_ = std::move(new_module_map);
+  }
+  return updated_modules;
 }
 
-std::vector<ModuleData*> ModuleManager::AddOrUpdateNotLoadedModules(
+std::vector<ModuleData*> ModuleManager::AddOrUpdateModules(
     absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos) {
-  absl::MutexLock lock(&mutex_);
-
-  std::vector<ModuleData*> not_updated_modules;
-
-  for (const auto& module_info : module_infos) {
-    auto module_id = std::make_pair(module_info.file_path(), module_info.build_id());
-    auto module_it = module_map_.find(module_id);
-    if (module_it == module_map_.end()) {
-      const bool success = module_map_.try_emplace(module_id, module_info).second;
-      CHECK(success);
-    } else {
-      ModuleData& module = module_it->second;
-      if (!module.UpdateIfChangedAndNotLoaded(module_info)) {
-        not_updated_modules.push_back(&module);
-      }
-    }
-  }
+  return AddModulesAndUpdateExisting(
+      module_infos, [](ModuleData* module, const orbit_grpc_protos::ModuleInfo& module_info) {
+        return module->UpdateIfChangedAndUnload(module_info);
+      });
+}
 
-  return not_updated_modules;
+std::vector<ModuleData*> ModuleManager::AddOrUpdateNotLoadedModules(
+    absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos) {
+  return AddModulesAndUpdateExisting(
+      module_infos, [](ModuleData* module, const orbit_grpc_protos::ModuleInfo& module_info) {
+        return !module->UpdateIfChangedAndNotLoaded(module_info);
+      });
 }
 
 const ModuleData* ModuleManager::GetModuleByPathAndBuildId(const std::string& path,
                                                            const std::string& build_id) const {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModuleMap> module_map = GetModuleMap();
 
-  auto it = module_map_.find(std::make_pair(path, build_id));
-  if (it == module_map_.end()) return nullptr;
+  auto it = module_map->find(std::make_pair(path, build_id));
+  if (it == module_map->end()) return nullptr;
 
-  return &it->second;
+  return it->second;
 }
 
 ModuleData* ModuleManager::GetMutableModuleByPathAndBuildId(const std::string& path,
                                                             const std::string& build_id) {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModuleMap> module_map = GetModuleMap();
 
-  auto it = module_map_.find(std::make_pair(path, build_id));
-  if (it == module_map_.end()) return nullptr;
+  auto it = module_map->find(std::make_pair(path, build_id));
+  if (it == module_map->end()) return nullptr;
 
-  return &it->second;
+  return it->second;
 }
 
 std::vector<FunctionInfo> ModuleManager::GetOrbitFunctionsOfProcess(
     const ProcessData& process) const {
   auto module_keys = process.GetUniqueModulesPathAndBuildId();
 
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModuleMap> module_map = GetModuleMap();
   std::vector<FunctionInfo> result;
   for (const auto& module_key : module_keys) {
-    auto it = module_map_.find(module_key);
-    CHECK(it != module_map_.end());
-    const ModuleData* module = &it->second;
+    auto it = module_map->find(module_key);
+    CHECK(it != module_map->end());
+    const ModuleData* module = it->second;
     CHECK(module != nullptr);
     if (!module->is_loaded()) continue;
 
@@ -107,22 +115,23 @@ std::vector<FunctionInfo> ModuleManager::GetOrbitFunctionsOfProcess(
 }
 
 std::vector<const ModuleData*> ModuleManager::GetAllModuleData() const {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModuleMap> module_map = GetModuleMap();
   std::vector<const ModuleData*> result;
-  for (const auto& [unused_pair, module_data] : module_map_) {
-    result.push_back(&module_data);
+  result.reserve(module_map->size());
+  for (const auto& [unused_pair, module_data] : *module_map) {
+    result.push_back(module_data);
   }
   return result;
 }
 
 std::vector<const ModuleData*> ModuleManager::GetModulesByFilename(
     const std::string& filename) const {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModuleMap> module_map = GetModuleMap();
   std::vector<const ModuleData*> result;
-  for (const auto& [path_build_id_pair, module_data] : module_map_) {
+  for (const auto& [path_build_id_pair, module_data] : *module_map) {
     const std::string& file_path = path_build_id_pair.first;
     if (std::filesystem::path(file_path).filename().string() == filename) {
-      result.push_back(&module_data);
+      result.push_back(module_data);
     }
   }
   return result;
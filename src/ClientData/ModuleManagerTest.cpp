@@ -7,6 +7,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "ClientData/FunctionUtils.h"
@@ -390,4 +391,42 @@ TEST(ModuleManager, GetModulesByFilename) {
   }
 }
 
+TEST(ModuleManager, ReadWhileModulesAreAdded) {
+  constexpr int kNumModules = 1000;
+  std::vector<ModuleInfo> module_infos(kNumModules);
+  for (int i = 0; i < kNumModules; ++i) {
+    module_infos[i].set_name(absl::StrFormat("name_%d", i));
+    module_infos[i].set_file_path(absl::StrFormat("path/to/file_%d", i));
+    module_infos[i].set_build_id(absl::StrFormat("build_id_%d", i));
+  }
+
+  ModuleManager module_manager;
+  std::thread adding_thread{[&module_manager, &module_infos] {
+    for (const ModuleInfo& module_info : module_infos) {
+      EXPECT_TRUE(module_manager.AddOrUpdateModules({module_info}).empty());
+    }
+  }};
+
+  // The modules are added in order, and a module once found stays at the same address.
+  size_t num_modules_found = 0;
+  std::vector<const ModuleData*> found_modules;
+  while (num_modules_found < kNumModules) {
+    const ModuleInfo& module_info = module_infos[num_modules_found];
+    const ModuleData* module =
+        module_manager.GetModuleByPathAndBuildId(module_info.file_path(), module_info.build_id());
+    if (module == nullptr) continue;
+    EXPECT_EQ(module->name(), module_info.name());
+    found_modules.push_back(module);
+    ++num_modules_found;
+    EXPECT_GE(module_manager.GetAllModuleData().size(), num_modules_found);
+  }
+  adding_thread.join();
+
+  for (int i = 0; i < kNumModules; ++i) {
+    EXPECT_EQ(module_manager.GetModuleByPathAndBuildId(module_infos[i].file_path(),
+                                                       module_infos[i].build_id()),
+              found_modules[i]);
+  }
+}
+
 }  // namespace orbit_client_data
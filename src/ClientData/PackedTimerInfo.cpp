@@ -0,0 +1,66 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/PackedTimerInfo.h"
+
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace orbit_client_data {
+
+PackedTimerInfo::PackedTimerInfo(const TimerInfo& timer_info)
+    : start_{timer_info.start()},
+      end_{timer_info.end()},
+      function_id_{timer_info.function_id()},
+      process_id_{timer_info.process_id()},
+      thread_id_{timer_info.thread_id()},
+      processor_{timer_info.processor()},
+      depth_{timer_info.depth()},
+      type_{static_cast<uint32_t>(timer_info.type())} {
+  CHECK(timer_info.depth() <= kMaxDepth);
+  CHECK(timer_info.type() >= 0 && timer_info.type() <= std::numeric_limits<uint8_t>::max());
+}
+
+std::unique_ptr<RareTimerInfoFields> CreateRareTimerInfoFields(const TimerInfo& timer_info) {
+  if (timer_info.callstack_id() == 0 && timer_info.user_data_key() == 0 &&
+      timer_info.timeline_hash() == 0 && timer_info.registers_size() == 0 &&
+      !timer_info.has_color() && timer_info.fiber_id() == 0) {
+    return nullptr;
+  }
+
+  auto rare_fields = std::make_unique<RareTimerInfoFields>();
+  rare_fields->callstack_id = timer_info.callstack_id();
+  rare_fields->user_data_key = timer_info.user_data_key();
+  rare_fields->timeline_hash = timer_info.timeline_hash();
+  rare_fields->registers.assign(timer_info.registers().begin(), timer_info.registers().end());
+  if (timer_info.has_color()) rare_fields->color = timer_info.color();
+  rare_fields->fiber_id = timer_info.fiber_id();
+  return rare_fields;
+}
+
+TimerInfo CreateTimerInfo(const PackedTimerInfo& packed, const RareTimerInfoFields* rare_fields) {
+  TimerInfo timer_info;
+  timer_info.set_start(packed.start());
+  timer_info.set_end(packed.end());
+  timer_info.set_function_id(packed.function_id());
+  timer_info.set_process_id(packed.process_id());
+  timer_info.set_thread_id(packed.thread_id());
+  timer_info.set_processor(packed.processor());
+  timer_info.set_depth(packed.depth());
+  timer_info.set_type(packed.type());
+  if (rare_fields == nullptr) return timer_info;
+
+  timer_info.set_callstack_id(rare_fields->callstack_id);
+  timer_info.set_user_data_key(rare_fields->user_data_key);
+  timer_info.set_timeline_hash(rare_fields->timeline_hash);
+  for (uint64_t value : rare_fields->registers) timer_info.add_registers(value);
+  if (rare_fields->color.has_value()) *timer_info.mutable_color() = rare_fields->color.value();
+  timer_info.set_fiber_id(rare_fields->fiber_id);
+  return timer_info;
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,107 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "ClientData/PackedTimerInfo.h"
+#include "ClientData/TextBox.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace orbit_client_data {
+
+namespace {
+
+MATCHER_P(TimerInfoEq, expected, "") {
+  return arg.SerializeAsString() == expected.SerializeAsString();
+}
+
+TimerInfo CreateCommonTimerInfo() {
+  TimerInfo timer_info;
+  timer_info.set_start(100);
+  timer_info.set_end(200);
+  timer_info.set_function_id(42);
+  timer_info.set_process_id(1);
+  timer_info.set_thread_id(2);
+  timer_info.set_processor(-1);
+  timer_info.set_depth(3);
+  timer_info.set_type(TimerInfo::kApiEvent);
+  return timer_info;
+}
+
+}  // namespace
+
+TEST(PackedTimerInfo, CommonFields) {
+  const TimerInfo timer_info = CreateCommonTimerInfo();
+  PackedTimerInfo packed{timer_info};
+  EXPECT_EQ(packed.start(), 100);
+  EXPECT_EQ(packed.end(), 200);
+  EXPECT_EQ(packed.function_id(), 42);
+  EXPECT_EQ(packed.process_id(), 1);
+  EXPECT_EQ(packed.thread_id(), 2);
+  EXPECT_EQ(packed.processor(), -1);
+  EXPECT_EQ(packed.depth(), 3);
+  EXPECT_EQ(packed.type(), TimerInfo::kApiEvent);
+
+  EXPECT_EQ(CreateRareTimerInfoFields(timer_info), nullptr);
+  EXPECT_THAT(CreateTimerInfo(packed, nullptr), TimerInfoEq(timer_info));
+
+  TimerInfo too_deep = timer_info;
+  too_deep.set_depth(PackedTimerInfo::kMaxDepth + 1);
+  EXPECT_DEATH((void)PackedTimerInfo{too_deep}, "Check failed");
+}
+
+TEST(PackedTimerInfo, RareFields) {
+  TimerInfo timer_info = CreateCommonTimerInfo();
+  timer_info.set_callstack_id(7);
+  timer_info.set_user_data_key(8);
+  timer_info.set_timeline_hash(9);
+  timer_info.add_registers(10);
+  timer_info.add_registers(11);
+  timer_info.mutable_color()->set_red(255);
+  timer_info.set_fiber_id(12);
+
+  std::unique_ptr<RareTimerInfoFields> rare_fields = CreateRareTimerInfoFields(timer_info);
+  ASSERT_NE(rare_fields, nullptr);
+  EXPECT_THAT(CreateTimerInfo(PackedTimerInfo{timer_info}, rare_fields.get()),
+              TimerInfoEq(timer_info));
+
+  TimerInfo only_color = CreateCommonTimerInfo();
+  only_color.mutable_color();
+  rare_fields = CreateRareTimerInfoFields(only_color);
+  ASSERT_NE(rare_fields, nullptr);
+  EXPECT_THAT(CreateTimerInfo(PackedTimerInfo{only_color}, rare_fields.get()),
+              TimerInfoEq(only_color));
+
+  TimerInfo only_fiber_id = CreateCommonTimerInfo();
+  only_fiber_id.set_fiber_id(12);
+  rare_fields = CreateRareTimerInfoFields(only_fiber_id);
+  ASSERT_NE(rare_fields, nullptr);
+  EXPECT_THAT(CreateTimerInfo(PackedTimerInfo{only_fiber_id}, rare_fields.get()),
+              TimerInfoEq(only_fiber_id));
+}
+
+TEST(PackedTimerInfo, TextBoxKeepsAllFields) {
+  TimerInfo timer_info = CreateCommonTimerInfo();
+  timer_info.set_user_data_key(8);
+  timer_info.add_registers(10);
+
+  TextBox text_box{timer_info};
+  EXPECT_EQ(text_box.Start(), 100);
+  EXPECT_EQ(text_box.End(), 200);
+  EXPECT_EQ(text_box.GetPackedTimerInfo().function_id(), 42);
+  EXPECT_THAT(text_box.GetTimerInfo(), TimerInfoEq(timer_info));
+
+  TextBox copy{text_box};
+  EXPECT_THAT(copy.GetTimerInfo(), TimerInfoEq(timer_info));
+
+  TextBox empty;
+  EXPECT_THAT(empty.GetTimerInfo(), TimerInfoEq(TimerInfo{}));
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "ClientData/PerThreadShards.h"
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+namespace orbit_client_data {
+
+TEST(PerThreadShards, WriteAndRead) {
+  PerThreadShards<std::vector<int>> shards;
+  EXPECT_FALSE(shards.Contains(1));
+  EXPECT_FALSE(shards.Read(1, [](const std::vector<int>& /*shard*/) { FAIL(); }));
+
+  shards.Write(1, [](std::vector<int>& shard) { shard.push_back(10); });
+  shards.Write(2, [](std::vector<int>& shard) { shard.push_back(20); });
+  shards.Write(1, [](std::vector<int>& shard) { shard.push_back(11); });
+  EXPECT_TRUE(shards.Contains(1));
+  EXPECT_TRUE(shards.Contains(2));
+  EXPECT_FALSE(shards.Contains(3));
+
+  std::vector<int> values;
+  EXPECT_TRUE(shards.Read(1, [&values](const std::vector<int>& shard) { values = shard; }));
+  EXPECT_THAT(values, ElementsAre(10, 11));
+
+  std::vector<std::pair<int32_t, std::vector<int>>> all_shards;
+  shards.ForEach([&all_shards](int32_t thread_id, const std::vector<int>& shard) {
+    all_shards.emplace_back(thread_id, shard);
+  });
+  EXPECT_THAT(all_shards, UnorderedElementsAre(std::make_pair(1, std::vector<int>{10, 11}),
+                                               std::make_pair(2, std::vector<int>{20})));
+}
+
+TEST(PerThreadShards, ConcurrentWritesAndReads) {
+  static constexpr int32_t kWriterCount = 4;
+  static constexpr int32_t kThreadIdsPerWriter = 8;
+  static constexpr uint64_t kValuesPerThreadId = 1000;
+  PerThreadShards<std::vector<uint64_t>> shards;
+
+  std::vector<std::thread> writers;
+  for (int32_t writer_index = 0; writer_index < kWriterCount; ++writer_index) {
+    writers.emplace_back([&shards, writer_index] {
+      for (uint64_t value = 0; value < kValuesPerThreadId; ++value) {
+        for (int32_t i = 0; i < kThreadIdsPerWriter; ++i) {
+          shards.Write(writer_index * kThreadIdsPerWriter + i,
+                       [value](std::vector<uint64_t>& shard) { shard.push_back(value); });
+        }
+      }
+    });
+  }
+
+  // Each shard is always seen in a consistent state while it's being appended to.
+  std::thread reader{[&shards] {
+    for (int iteration = 0; iteration < 100; ++iteration) {
+      shards.ForEach([](int32_t /*thread_id*/, const std::vector<uint64_t>& shard) {
+        for (uint64_t i = 0; i < shard.size(); ++i) {
+          ASSERT_EQ(shard[i], i);
+        }
+      });
+    }
+  }};
+
+  for (std::thread& writer : writers) writer.join();
+  reader.join();
+
+  int32_t shard_count = 0;
+  shards.ForEach([&shard_count](int32_t /*thread_id*/, const std::vector<uint64_t>& shard) {
+    ++shard_count;
+    EXPECT_EQ(shard.size(), kValuesPerThreadId);
+  });
+  EXPECT_EQ(shard_count, kWriterCount * kThreadIdsPerWriter);
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,102 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/PipelineLatencyStats.h"
+
+#include "ClientData/FunctionStatsUtils.h"
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::FunctionStats;
+using orbit_grpc_protos::PipelineLatencyProbe;
+
+namespace orbit_client_data {
+
+namespace {
+
+// Timestamps of the same clock are only expected to be out of order by the resolution of the clock.
+[[nodiscard]] uint64_t ComputeLatencyNs(uint64_t begin_timestamp_ns, uint64_t end_timestamp_ns) {
+  return end_timestamp_ns > begin_timestamp_ns ? end_timestamp_ns - begin_timestamp_ns : 0;
+}
+
+}  // namespace
+
+const char* PipelineLatencyStats::GetStageName(Stage stage) {
+  switch (stage) {
+    case Stage::kRingBufferRead:
+      return "Read from ring buffer";
+    case Stage::kProcessed:
+      return "Processed";
+    case Stage::kSent:
+      return "Sent";
+    case Stage::kReceived:
+      return "Received (relative)";
+    case Stage::kInserted:
+      return "Inserted";
+    case Stage::kEnd:
+      break;
+  }
+  UNREACHABLE();
+}
+
+void PipelineLatencyStats::AddProbe(const PipelineLatencyProbe& probe,
+                                    uint64_t inserted_timestamp_ns) {
+  absl::MutexLock lock{&mutex_};
+  ++probe_count_;
+  AddLatency(Stage::kRingBufferRead,
+             ComputeLatencyNs(probe.record_timestamp_ns(), probe.ring_buffer_read_timestamp_ns()));
+  AddLatency(Stage::kProcessed, ComputeLatencyNs(probe.ring_buffer_read_timestamp_ns(),
+                                                 probe.processed_timestamp_ns()));
+  if (probe.sent_timestamp_ns() == 0) return;
+  AddLatency(Stage::kSent,
+             ComputeLatencyNs(probe.processed_timestamp_ns(), probe.sent_timestamp_ns()));
+  if (probe.received_timestamp_ns() == 0) return;
+
+  const int64_t offset_ns = static_cast<int64_t>(probe.received_timestamp_ns()) -
+                            static_cast<int64_t>(probe.sent_timestamp_ns());
+  received_minus_sent_offsets_ns_.push_back(offset_ns);
+  if (received_minus_sent_offsets_ns_.size() == 1 ||
+      offset_ns < min_received_minus_sent_offset_ns_) {
+    min_received_minus_sent_offset_ns_ = offset_ns;
+    FunctionStats& received_stats = stage_latency_stats_[static_cast<size_t>(Stage::kReceived)];
+    received_stats.Clear();
+    for (int64_t previous_offset_ns : received_minus_sent_offsets_ns_) {
+      AddFunctionCallToStats(
+          static_cast<uint64_t>(previous_offset_ns - min_received_minus_sent_offset_ns_),
+          &received_stats);
+    }
+  } else {
+    AddLatency(Stage::kReceived,
+               static_cast<uint64_t>(offset_ns - min_received_minus_sent_offset_ns_));
+  }
+
+  AddLatency(Stage::kInserted,
+             ComputeLatencyNs(probe.received_timestamp_ns(), inserted_timestamp_ns));
+}
+
+void PipelineLatencyStats::AddLatency(Stage stage, uint64_t latency_ns) {
+  AddFunctionCallToStats(latency_ns, &stage_latency_stats_[static_cast<size_t>(stage)]);
+}
+
+void PipelineLatencyStats::Clear() {
+  absl::MutexLock lock{&mutex_};
+  probe_count_ = 0;
+  for (FunctionStats& stats : stage_latency_stats_) {
+    stats.Clear();
+  }
+  received_minus_sent_offsets_ns_.clear();
+  min_received_minus_sent_offset_ns_ = 0;
+}
+
+uint64_t PipelineLatencyStats::GetProbeCount() const {
+  absl::MutexLock lock{&mutex_};
+  return probe_count_;
+}
+
+FunctionStats PipelineLatencyStats::GetStageLatencyStats(Stage stage) const {
+  CHECK(stage != Stage::kEnd);
+  absl::MutexLock lock{&mutex_};
+  return stage_latency_stats_[static_cast<size_t>(stage)];
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,95 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+#include "ClientData/PipelineLatencyStats.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::FunctionStats;
+using orbit_grpc_protos::PipelineLatencyProbe;
+using Stage = orbit_client_data::PipelineLatencyStats::Stage;
+
+namespace orbit_client_data {
+
+namespace {
+
+PipelineLatencyProbe CreateProbe(uint64_t record_timestamp_ns, uint64_t sent_timestamp_ns,
+                                 uint64_t received_timestamp_ns) {
+  PipelineLatencyProbe probe;
+  probe.set_record_timestamp_ns(record_timestamp_ns);
+  probe.set_ring_buffer_read_timestamp_ns(record_timestamp_ns + 100);
+  probe.set_processed_timestamp_ns(record_timestamp_ns + 300);
+  probe.set_sent_timestamp_ns(sent_timestamp_ns);
+  probe.set_received_timestamp_ns(received_timestamp_ns);
+  return probe;
+}
+
+}  // namespace
+
+TEST(PipelineLatencyStats, AddProbeAddsTheLatencyOfEachStage) {
+  PipelineLatencyStats stats;
+  stats.AddProbe(CreateProbe(1000, 1700, 5000), 5050);
+  EXPECT_EQ(stats.GetProbeCount(), 1u);
+
+  const FunctionStats ring_buffer_read_stats = stats.GetStageLatencyStats(Stage::kRingBufferRead);
+  EXPECT_EQ(ring_buffer_read_stats.count(), 1u);
+  EXPECT_EQ(ring_buffer_read_stats.max_ns(), 100u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kProcessed).max_ns(), 200u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kSent).max_ns(), 400u);
+  // The only offset between sent and received is also the smallest.
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kReceived).count(), 1u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kReceived).max_ns(), 0u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kInserted).max_ns(), 50u);
+}
+
+TEST(PipelineLatencyStats, ReceivedLatencyIsRelativeToTheSmallestOffset) {
+  PipelineLatencyStats stats;
+  // The clock of the client is behind the clock of the service.
+  stats.AddProbe(CreateProbe(1000, 2000, 1500), 1500);
+  stats.AddProbe(CreateProbe(3000, 4000, 3200), 3200);
+  stats.AddProbe(CreateProbe(5000, 6000, 5800), 5800);
+
+  const FunctionStats received_stats = stats.GetStageLatencyStats(Stage::kReceived);
+  EXPECT_EQ(received_stats.count(), 3u);
+  EXPECT_EQ(received_stats.max_ns(), 600u);
+  EXPECT_EQ(received_stats.total_time_ns(), 300u + 0u + 600u);
+}
+
+TEST(PipelineLatencyStats, StagesWithMissingTimestampsAreSkipped) {
+  PipelineLatencyStats stats;
+  stats.AddProbe(CreateProbe(1000, 0, 0), 2000);
+  stats.AddProbe(CreateProbe(1000, 1500, 0), 2000);
+
+  EXPECT_EQ(stats.GetProbeCount(), 2u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kRingBufferRead).count(), 2u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kProcessed).count(), 2u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kSent).count(), 1u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kReceived).count(), 0u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kInserted).count(), 0u);
+}
+
+TEST(PipelineLatencyStats, Clear) {
+  PipelineLatencyStats stats;
+  stats.AddProbe(CreateProbe(1000, 2000, 1500), 1500);
+  stats.Clear();
+  EXPECT_EQ(stats.GetProbeCount(), 0u);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kRingBufferRead).count(), 0u);
+
+  // The smallest offset seen before clearing doesn't apply anymore.
+  stats.AddProbe(CreateProbe(1000, 2000, 2500), 2500);
+  EXPECT_EQ(stats.GetStageLatencyStats(Stage::kReceived).max_ns(), 0u);
+}
+
+TEST(PipelineLatencyStats, GetStageName) {
+  for (size_t i = 0; i < PipelineLatencyStats::kStageCount; ++i) {
+    EXPECT_NE(std::string(PipelineLatencyStats::GetStageName(static_cast<Stage>(i))), "");
+  }
+}
+
+}  // namespace orbit_client_data
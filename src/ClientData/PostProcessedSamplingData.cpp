@@ -23,13 +23,32 @@ uint32_t ThreadSampleData::GetCountForAddress(uint64_t address) const {
   return it->second;
 }
 
-const orbit_client_protos::CallstackInfo& PostProcessedSamplingData::GetResolvedCallstack(
-    uint64_t sampled_callstack_id) const {
+std::vector<std::pair<uint64_t, uint32_t>> ThreadSampleData::GetSampledAddressesAndCountsInRange(
+    uint64_t begin, uint64_t end) const {
+  std::vector<std::pair<uint64_t, uint32_t>> addresses_and_counts;
+  if (begin >= end) return addresses_and_counts;
+
+  if (end - begin <= sampled_address_to_count.size()) {
+    for (uint64_t address = begin; address < end; ++address) {
+      auto it = sampled_address_to_count.find(address);
+      if (it == sampled_address_to_count.end()) continue;
+      addresses_and_counts.emplace_back(address, it->second);
+    }
+    return addresses_and_counts;
+  }
+
+  for (const auto& [address, count] : sampled_address_to_count) {
+    if (address < begin || address >= end) continue;
+    addresses_and_counts.emplace_back(address, count);
+  }
+  std::sort(addresses_and_counts.begin(), addresses_and_counts.end());
+  return addresses_and_counts;
+}
+
+CallstackView PostProcessedSamplingData::GetResolvedCallstack(uint64_t sampled_callstack_id) const {
   auto resolved_callstack_id_it = original_id_to_resolved_callstack_id_.find(sampled_callstack_id);
   CHECK(resolved_callstack_id_it != original_id_to_resolved_callstack_id_.end());
-  auto resolved_callstack_it = id_to_resolved_callstack_.find(resolved_callstack_id_it->second);
-  CHECK(resolved_callstack_it != id_to_resolved_callstack_.end());
-  return resolved_callstack_it->second;
+  return resolved_callstacks_.Get(resolved_callstack_id_it->second);
 }
 
 static std::multimap<int, uint64_t> SortCallstacksByCount(const ThreadSampleData& data,
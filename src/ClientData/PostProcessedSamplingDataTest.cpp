@@ -0,0 +1,53 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+
+#include "ClientData/PostProcessedSamplingData.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+namespace orbit_client_data {
+
+namespace {
+
+ThreadSampleData CreateThreadSampleData() {
+  ThreadSampleData thread_sample_data;
+  thread_sample_data.sampled_address_to_count[0x100] = 1;
+  thread_sample_data.sampled_address_to_count[0x104] = 2;
+  thread_sample_data.sampled_address_to_count[0x108] = 3;
+  thread_sample_data.sampled_address_to_count[0x200] = 4;
+  return thread_sample_data;
+}
+
+}  // namespace
+
+TEST(ThreadSampleData, GetSampledAddressesAndCountsInSmallRange) {
+  const ThreadSampleData thread_sample_data = CreateThreadSampleData();
+  EXPECT_THAT(thread_sample_data.GetSampledAddressesAndCountsInRange(0x104, 0x106),
+              ElementsAre(Pair(0x104u, 2u)));
+  EXPECT_THAT(thread_sample_data.GetSampledAddressesAndCountsInRange(0x101, 0x104), IsEmpty());
+}
+
+TEST(ThreadSampleData, GetSampledAddressesAndCountsInLargeRange) {
+  const ThreadSampleData thread_sample_data = CreateThreadSampleData();
+  EXPECT_THAT(thread_sample_data.GetSampledAddressesAndCountsInRange(0x100, 0x200),
+              ElementsAre(Pair(0x100u, 1u), Pair(0x104u, 2u), Pair(0x108u, 3u)));
+  EXPECT_THAT(thread_sample_data.GetSampledAddressesAndCountsInRange(0, 0x1000),
+              ElementsAre(Pair(0x100u, 1u), Pair(0x104u, 2u), Pair(0x108u, 3u), Pair(0x200u, 4u)));
+}
+
+TEST(ThreadSampleData, GetSampledAddressesAndCountsInEmptyRange) {
+  const ThreadSampleData thread_sample_data = CreateThreadSampleData();
+  EXPECT_THAT(thread_sample_data.GetSampledAddressesAndCountsInRange(0x100, 0x100), IsEmpty());
+  EXPECT_THAT(thread_sample_data.GetSampledAddressesAndCountsInRange(0x200, 0x100), IsEmpty());
+}
+
+}  // namespace orbit_client_data
@@ -6,7 +6,12 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
 #include <vector>
 
 #include "OrbitBase/Result.h"
@@ -70,26 +75,43 @@ static bool IsModuleMapValid(const std::map<uint64_t, ModuleInMemory>& module_ma
   return true;
 }
 
-void ProcessData::UpdateModuleInfos(absl::Span<const ModuleInfo> module_infos) {
+std::shared_ptr<const ProcessData::ModulesSnapshot> ProcessData::GetModulesSnapshot() const {
+  absl::MutexLock lock(&mutex_);
+  return modules_;
+}
+
+void ProcessData::PublishModules(
+    std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory) {
+  CHECK(IsModuleMapValid(start_address_to_module_in_memory));
+  std::shared_ptr<const ModulesSnapshot> modules =
+      std::make_shared<const ModulesSnapshot>(std::move(start_address_to_module_in_memory));
+
   absl::MutexLock lock(&mutex_);
-  start_address_to_module_in_memory_.clear();
+  modules_.swap(modules);
+  // The previous snapshot is released after unlocking, in case this was its last reference.
+}
+
+void ProcessData::UpdateModuleInfos(absl::Span<const ModuleInfo> module_infos) {
+  absl::MutexLock update_lock(&update_mutex_);
+  std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory;
 
   for (const auto& module_info : module_infos) {
-    const auto [unused_it, success] = start_address_to_module_in_memory_.try_emplace(
+    const auto [unused_it, success] = start_address_to_module_in_memory.try_emplace(
         module_info.address_start(), module_info.address_start(), module_info.address_end(),
         module_info.file_path(), module_info.build_id());
     CHECK(success);
   }
 
-  CHECK(IsModuleMapValid(start_address_to_module_in_memory_));
+  PublishModules(std::move(start_address_to_module_in_memory));
 }
 
 std::vector<std::string> ProcessData::FindModuleBuildIdsByPath(
     const std::string& module_path) const {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
   std::set<std::string> build_ids;
 
-  for (const auto& [unused_address, module_in_memory] : start_address_to_module_in_memory_) {
+  for (const auto& [unused_address, module_in_memory] :
+       modules->start_address_to_module_in_memory) {
     if (module_in_memory.file_path() == module_path) {
       build_ids.insert(module_in_memory.build_id());
     }
@@ -99,60 +121,66 @@ std::vector<std::string> ProcessData::FindModuleBuildIdsByPath(
 }
 
 void ProcessData::AddOrUpdateModuleInfo(const ModuleInfo& module_info) {
-  absl::MutexLock lock(&mutex_);
+  absl::MutexLock update_lock(&update_mutex_);
+  std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory =
+      GetModulesSnapshot()->start_address_to_module_in_memory;
   ModuleInMemory module_in_memory{module_info.address_start(), module_info.address_end(),
                                   module_info.file_path(), module_info.build_id()};
 
-  auto it = start_address_to_module_in_memory_.upper_bound(module_in_memory.start());
-  if (it != start_address_to_module_in_memory_.begin()) {
+  auto it = start_address_to_module_in_memory.upper_bound(module_in_memory.start());
+  if (it != start_address_to_module_in_memory.begin()) {
     --it;
     if (it->second.end() > module_in_memory.start()) {
-      it = start_address_to_module_in_memory_.erase(it);
+      it = start_address_to_module_in_memory.erase(it);
     } else {
       ++it;
     }
   }
 
-  while (it != start_address_to_module_in_memory_.end() &&
+  while (it != start_address_to_module_in_memory.end() &&
          it->second.start() < module_in_memory.end()) {
-    it = start_address_to_module_in_memory_.erase(it);
+    it = start_address_to_module_in_memory.erase(it);
   }
 
-  start_address_to_module_in_memory_.insert_or_assign(module_info.address_start(),
-                                                      module_in_memory);
+  start_address_to_module_in_memory.insert_or_assign(module_info.address_start(),
+                                                     module_in_memory);
 
-  CHECK(IsModuleMapValid(start_address_to_module_in_memory_));
+  PublishModules(std::move(start_address_to_module_in_memory));
 }
 
 ErrorMessageOr<ModuleInMemory> ProcessData::FindModuleByAddress(uint64_t absolute_address) const {
-  absl::MutexLock lock(&mutex_);
-  if (start_address_to_module_in_memory_.empty()) {
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
+  if (modules->start_address_to_module_in_memory.empty()) {
     return ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
                                         ": No modules loaded by process %s",
-                                        absolute_address, process_info_.name()));
+                                        absolute_address, name()));
   }
 
-  ErrorMessage not_found_error =
-      ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
-                                   ": No module loaded at this address by process %s",
-                                   absolute_address, process_info_.name()));
-
-  auto it = start_address_to_module_in_memory_.upper_bound(absolute_address);
-  if (it == start_address_to_module_in_memory_.begin()) return not_found_error;
+  // Only formatted when needed, as the callstacks of a capture contain many addresses that are not
+  // in any module.
+  auto not_found_error = [&] {
+    return ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
+                                        ": No module loaded at this address by process %s",
+                                        absolute_address, name()));
+  };
 
-  --it;
-  const ModuleInMemory& module_in_memory = it->second;
-  CHECK(absolute_address >= module_in_memory.start());
-  if (absolute_address >= module_in_memory.end()) return not_found_error;
+  const ModuleInMemory* module_in_memory = modules->module_address_index.Find(absolute_address);
+  if (module_in_memory == nullptr) return not_found_error();
+  return *module_in_memory;
+}
 
-  return module_in_memory;
+std::shared_ptr<const ModuleAddressIndex> ProcessData::GetModuleAddressIndex() const {
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
+  const ModuleAddressIndex* module_address_index = &modules->module_address_index;
+  return {std::move(modules), module_address_index};
 }
 
 std::vector<uint64_t> ProcessData::GetModuleBaseAddresses(const std::string& module_path,
                                                           const std::string& build_id) const {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
   std::vector<uint64_t> result;
-  for (const auto& [start_address, module_in_memory] : start_address_to_module_in_memory_) {
+  for (const auto& [start_address, module_in_memory] :
+       modules->start_address_to_module_in_memory) {
     if (module_in_memory.file_path() == module_path && module_in_memory.build_id() == build_id) {
       result.emplace_back(start_address);
     }
@@ -160,15 +188,21 @@ std::vector<uint64_t> ProcessData::GetModuleBaseAddresses(const std::string& mod
   return result;
 }
 
+std::shared_ptr<const std::map<uint64_t, ModuleInMemory>> ProcessData::GetMemoryMap() const {
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
+  const std::map<uint64_t, ModuleInMemory>* start_address_to_module_in_memory =
+      &modules->start_address_to_module_in_memory;
+  return {std::move(modules), start_address_to_module_in_memory};
+}
+
 std::map<uint64_t, ModuleInMemory> ProcessData::GetMemoryMapCopy() const {
-  absl::MutexLock lock(&mutex_);
-  return start_address_to_module_in_memory_;
+  return GetModulesSnapshot()->start_address_to_module_in_memory;
 }
 
 bool ProcessData::IsModuleLoadedByProcess(const ModuleData* module) const {
-  absl::MutexLock lock(&mutex_);
-  return std::any_of(start_address_to_module_in_memory_.begin(),
-                     start_address_to_module_in_memory_.end(), [module](const auto& it) {
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
+  return std::any_of(modules->start_address_to_module_in_memory.begin(),
+                     modules->start_address_to_module_in_memory.end(), [module](const auto& it) {
                        return it.second.file_path() == module->file_path() &&
                               it.second.build_id() == module->build_id();
                      });
@@ -176,9 +210,10 @@ bool ProcessData::IsModuleLoadedByProcess(const ModuleData* module) const {
 
 std::vector<std::pair<std::string, std::string>> ProcessData::GetUniqueModulesPathAndBuildId()
     const {
-  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<const ModulesSnapshot> modules = GetModulesSnapshot();
   std::set<std::pair<std::string, std::string>> module_keys;
-  for (const auto& [unused_address, module_in_memory] : start_address_to_module_in_memory_) {
+  for (const auto& [unused_address, module_in_memory] :
+       modules->start_address_to_module_in_memory) {
     module_keys.insert(std::make_pair(module_in_memory.file_path(), module_in_memory.build_id()));
   }
 
@@ -7,6 +7,8 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <map>
+#include <memory>
 #include <outcome.hpp>
 #include <string>
 #include <utility>
@@ -144,6 +146,40 @@ TEST(ProcessData, MemorySpace) {
   }
 }
 
+TEST(ProcessData, ModuleSnapshotsAreNotChangedByUpdates) {
+  ModuleInfo module_info_1;
+  module_info_1.set_file_path("path/to/file_1");
+  module_info_1.set_build_id("build_id_1");
+  module_info_1.set_address_start(100);
+  module_info_1.set_address_end(200);
+
+  ModuleInfo module_info_2;
+  module_info_2.set_file_path("path/to/file_2");
+  module_info_2.set_build_id("build_id_2");
+  module_info_2.set_address_start(150);
+  module_info_2.set_address_end(300);
+
+  ProcessData process;
+  process.UpdateModuleInfos({module_info_1});
+  std::shared_ptr<const std::map<uint64_t, ModuleInMemory>> memory_map = process.GetMemoryMap();
+  std::shared_ptr<const ModuleAddressIndex> module_address_index = process.GetModuleAddressIndex();
+
+  // Replaces the first module, which intersects the second.
+  process.AddOrUpdateModuleInfo(module_info_2);
+
+  ASSERT_EQ(memory_map->size(), 1);
+  EXPECT_EQ(memory_map->at(100).file_path(), module_info_1.file_path());
+  const ModuleInMemory* module_in_memory = module_address_index->Find(120);
+  ASSERT_NE(module_in_memory, nullptr);
+  EXPECT_EQ(module_in_memory->file_path(), module_info_1.file_path());
+
+  std::shared_ptr<const std::map<uint64_t, ModuleInMemory>> updated_memory_map =
+      process.GetMemoryMap();
+  ASSERT_EQ(updated_memory_map->size(), 1);
+  EXPECT_EQ(updated_memory_map->at(150).file_path(), module_info_2.file_path());
+  EXPECT_EQ(process.GetModuleAddressIndex()->Find(120), nullptr);
+}
+
 TEST(ProcessData, FindModuleBuildIdsByPath) {
   constexpr const char* kFilePath1 = "filepath1";
   constexpr const char* kBuildId1 = "buildid1";
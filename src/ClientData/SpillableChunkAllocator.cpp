@@ -0,0 +1,146 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/SpillableChunkAllocator.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+#if defined(__linux)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace orbit_client_data {
+
+namespace {
+
+[[nodiscard]] size_t GetPageSize() {
+#if defined(__linux)
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 4096;
+#endif
+}
+
+[[nodiscard]] size_t RoundUpToPageSize(size_t size) {
+  const size_t page_size = GetPageSize();
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+[[nodiscard]] orbit_base::unique_fd CreateUnlinkedTemporaryFile() {
+#if defined(__linux)
+  std::error_code error;
+  std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+  if (error) {
+    ERROR("Getting the temporary directory to spill timers to: %s", error.message());
+    return orbit_base::unique_fd{};
+  }
+  orbit_base::unique_fd fd{open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600)};
+  if (!fd.valid()) {
+    ERROR("Creating a temporary file in \"%s\" to spill timers to: %s", directory.string(),
+          SafeStrerror(errno));
+  }
+  return fd;
+#else
+  return orbit_base::unique_fd{};
+#endif
+}
+
+}  // namespace
+
+SpillableChunkAllocator::SpillableChunkAllocator(size_t chunk_size)
+    : chunk_size_{RoundUpToPageSize(chunk_size)}, file_fd_{CreateUnlinkedTemporaryFile()} {}
+
+SpillableChunkAllocator::~SpillableChunkAllocator() {
+  absl::MutexLock lock{&mutex_};
+  CHECK(allocated_chunk_count_ == 0);
+}
+
+void* SpillableChunkAllocator::Allocate() {
+  absl::MutexLock lock{&mutex_};
+  ++allocated_chunk_count_;
+#if defined(__linux)
+  if (file_fd_.valid()) {
+    uint64_t offset = file_size_;
+    if (!free_file_offsets_.empty()) {
+      offset = free_file_offsets_.back();
+      free_file_offsets_.pop_back();
+    } else if (ftruncate(file_fd_.get(), static_cast<off_t>(file_size_ + chunk_size_)) == 0) {
+      file_size_ += chunk_size_;
+    } else {
+      ERROR("Extending the file timers are spilled to: %s", SafeStrerror(errno));
+      return std::malloc(chunk_size_);
+    }
+
+    void* chunk = mmap(nullptr, chunk_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_fd_.get(),
+                       static_cast<off_t>(offset));
+    if (chunk == MAP_FAILED) {
+      ERROR("Mapping the file timers are spilled to: %s", SafeStrerror(errno));
+      free_file_offsets_.push_back(offset);
+      return std::malloc(chunk_size_);
+    }
+    file_offsets_by_chunk_.emplace(chunk, offset);
+    return chunk;
+  }
+#endif
+  return std::malloc(chunk_size_);
+}
+
+void SpillableChunkAllocator::Free(void* chunk) {
+  if (chunk == nullptr) return;
+  absl::MutexLock lock{&mutex_};
+  CHECK(allocated_chunk_count_ > 0);
+  --allocated_chunk_count_;
+  auto it = file_offsets_by_chunk_.find(chunk);
+  if (it == file_offsets_by_chunk_.end()) {
+    std::free(chunk);
+    return;
+  }
+#if defined(__linux)
+  const uint64_t offset = it->second;
+  file_offsets_by_chunk_.erase(it);
+  munmap(chunk, chunk_size_);
+  // Release the disk space of the chunk until it is reused.
+  (void)fallocate(file_fd_.get(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  static_cast<off_t>(offset), static_cast<off_t>(chunk_size_));
+  free_file_offsets_.push_back(offset);
+#endif
+}
+
+void SpillableChunkAllocator::Spill(void* chunk) {
+#if defined(__linux)
+  uint64_t offset;
+  {
+    absl::MutexLock lock{&mutex_};
+    auto it = file_offsets_by_chunk_.find(chunk);
+    if (it == file_offsets_by_chunk_.end()) return;
+    offset = it->second;
+  }
+  // Write the chunk to the file, unmap its pages, and drop them from the page cache. As the
+  // mapping is shared, a write to the chunk in between goes to the page cache and is not lost: the
+  // page just stays in memory.
+  if (msync(chunk, chunk_size_, MS_SYNC) != 0) {
+    ERROR("Writing timers to the file they are spilled to: %s", SafeStrerror(errno));
+    return;
+  }
+  (void)madvise(chunk, chunk_size_, MADV_DONTNEED);
+  (void)posix_fadvise(file_fd_.get(), static_cast<off_t>(offset), static_cast<off_t>(chunk_size_),
+                      POSIX_FADV_DONTNEED);
+#else
+  (void)chunk;
+#endif
+}
+
+uint64_t SpillableChunkAllocator::allocated_bytes() const {
+  absl::MutexLock lock{&mutex_};
+  return allocated_chunk_count_ * chunk_size_;
+}
+
+}  // namespace orbit_client_data
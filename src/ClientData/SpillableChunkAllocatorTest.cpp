@@ -0,0 +1,63 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "ClientData/SpillableChunkAllocator.h"
+
+namespace orbit_client_data {
+
+TEST(SpillableChunkAllocator, RoundsChunkSizeUpToPages) {
+  SpillableChunkAllocator allocator{1000};
+  EXPECT_GE(allocator.chunk_size(), 1000);
+  EXPECT_EQ(allocator.chunk_size() % 4096, 0);
+}
+
+TEST(SpillableChunkAllocator, KeepsTheContentOfSpilledChunks) {
+  SpillableChunkAllocator allocator{10000};
+  std::vector<void*> chunks;
+  for (int i = 0; i < 4; ++i) {
+    void* chunk = allocator.Allocate();
+    ASSERT_NE(chunk, nullptr);
+    std::memset(chunk, 'a' + i, allocator.chunk_size());
+    chunks.push_back(chunk);
+  }
+  EXPECT_EQ(allocator.allocated_bytes(), 4 * allocator.chunk_size());
+
+  for (void* chunk : chunks) {
+    allocator.Spill(chunk);
+  }
+  for (int i = 0; i < 4; ++i) {
+    const auto* bytes = static_cast<const char*>(chunks[i]);
+    EXPECT_EQ(bytes[0], 'a' + i);
+    EXPECT_EQ(bytes[allocator.chunk_size() - 1], 'a' + i);
+  }
+
+  for (void* chunk : chunks) {
+    allocator.Free(chunk);
+  }
+  EXPECT_EQ(allocator.allocated_bytes(), 0);
+}
+
+TEST(SpillableChunkAllocator, ReusesFreedChunks) {
+  SpillableChunkAllocator allocator{4096};
+  void* first_chunk = allocator.Allocate();
+  ASSERT_NE(first_chunk, nullptr);
+  allocator.Free(first_chunk);
+
+  void* second_chunk = allocator.Allocate();
+  ASSERT_NE(second_chunk, nullptr);
+  // A reused chunk of the file is not guaranteed to be mapped at the same address, but its content
+  // must be usable like the one of a new chunk.
+  std::memset(second_chunk, 'x', allocator.chunk_size());
+  allocator.Spill(second_chunk);
+  EXPECT_EQ(static_cast<const char*>(second_chunk)[42], 'x');
+  allocator.Free(second_chunk);
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,78 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/ThreadUtilizationIndex.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+void ThreadUtilizationIndex::AddSlice(int32_t process_id, int32_t thread_id, uint64_t start_ns,
+                                      uint64_t end_ns) {
+  CHECK(start_ns <= end_ns);
+  absl::MutexLock lock{&mutex_};
+  ThreadSlices& slices = slices_by_thread_id_[thread_id];
+  slices.process_id = process_id;
+
+  // As the slices of a thread don't overlap, sorting them by end also sorts them by start.
+  const size_t index =
+      std::upper_bound(slices.ends_ns.begin(), slices.ends_ns.end(), end_ns) -
+      slices.ends_ns.begin();
+  slices.starts_ns.insert(slices.starts_ns.begin() + index, start_ns);
+  slices.ends_ns.insert(slices.ends_ns.begin() + index, end_ns);
+  slices.prefix_time_on_core_ns.insert(slices.prefix_time_on_core_ns.begin() + index, 0);
+  slices.RecomputePrefixSumsFrom(index);
+}
+
+void ThreadUtilizationIndex::ThreadSlices::RecomputePrefixSumsFrom(size_t index) {
+  uint64_t time_on_core_ns = index == 0 ? 0 : prefix_time_on_core_ns[index - 1];
+  for (size_t i = index; i < starts_ns.size(); ++i) {
+    time_on_core_ns += ends_ns[i] - starts_ns[i];
+    prefix_time_on_core_ns[i] = time_on_core_ns;
+  }
+}
+
+uint64_t ThreadUtilizationIndex::ThreadSlices::GetTimeOnCoreNsBefore(uint64_t time_ns) const {
+  // The slices before `index` end before `time_ns`, the slice at `index` may contain it.
+  const size_t index = std::upper_bound(ends_ns.begin(), ends_ns.end(), time_ns) - ends_ns.begin();
+  uint64_t time_on_core_ns = index == 0 ? 0 : prefix_time_on_core_ns[index - 1];
+  if (index < starts_ns.size() && starts_ns[index] < time_ns) {
+    time_on_core_ns += time_ns - starts_ns[index];
+  }
+  return time_on_core_ns;
+}
+
+absl::flat_hash_map<int32_t, int32_t> ThreadUtilizationIndex::GetProcessIdsByThreadId() const {
+  absl::ReaderMutexLock lock{&mutex_};
+  absl::flat_hash_map<int32_t, int32_t> process_ids_by_thread_id;
+  process_ids_by_thread_id.reserve(slices_by_thread_id_.size());
+  for (const auto& [thread_id, slices] : slices_by_thread_id_) {
+    process_ids_by_thread_id.emplace(thread_id, slices.process_id);
+  }
+  return process_ids_by_thread_id;
+}
+
+ThreadUtilization ThreadUtilizationIndex::GetThreadUtilization(int32_t thread_id, uint64_t min_ns,
+                                                               uint64_t max_ns) const {
+  absl::ReaderMutexLock lock{&mutex_};
+  auto slices_it = slices_by_thread_id_.find(thread_id);
+  if (slices_it == slices_by_thread_id_.end() || max_ns <= min_ns) return {};
+  const ThreadSlices& slices = slices_it->second;
+
+  ThreadUtilization utilization;
+  utilization.time_on_core_ns =
+      slices.GetTimeOnCoreNsBefore(max_ns) - slices.GetTimeOnCoreNsBefore(min_ns);
+  const size_t first_index =
+      std::upper_bound(slices.ends_ns.begin(), slices.ends_ns.end(), min_ns) -
+      slices.ends_ns.begin();
+  const size_t end_index =
+      std::lower_bound(slices.starts_ns.begin(), slices.starts_ns.end(), max_ns) -
+      slices.starts_ns.begin();
+  utilization.slice_count = end_index > first_index ? end_index - first_index : 0;
+  return utilization;
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "ClientData/ThreadUtilizationIndex.h"
+
+namespace orbit_client_data {
+
+TEST(ThreadUtilizationIndex, Empty) {
+  ThreadUtilizationIndex index;
+  EXPECT_TRUE(index.GetProcessIdsByThreadId().empty());
+  EXPECT_EQ(index.GetThreadUtilization(1, 0, 100).time_on_core_ns, 0);
+  EXPECT_EQ(index.GetThreadUtilization(1, 0, 100).slice_count, 0);
+}
+
+TEST(ThreadUtilizationIndex, ClipsTheSlicesToTheTimeRange) {
+  ThreadUtilizationIndex index;
+  index.AddSlice(/*process_id=*/10, /*thread_id=*/11, 10, 20);
+  index.AddSlice(/*process_id=*/10, /*thread_id=*/11, 30, 50);
+  index.AddSlice(/*process_id=*/10, /*thread_id=*/11, 50, 60);
+  index.AddSlice(/*process_id=*/20, /*thread_id=*/21, 0, 100);
+  EXPECT_THAT(index.GetProcessIdsByThreadId(),
+              testing::UnorderedElementsAre(testing::Pair(11, 10), testing::Pair(21, 20)));
+
+  ThreadUtilization utilization = index.GetThreadUtilization(11, 0, 100);
+  EXPECT_EQ(utilization.time_on_core_ns, 40);
+  EXPECT_EQ(utilization.slice_count, 3);
+
+  utilization = index.GetThreadUtilization(11, 15, 55);
+  EXPECT_EQ(utilization.time_on_core_ns, 30);
+  EXPECT_EQ(utilization.slice_count, 3);
+
+  utilization = index.GetThreadUtilization(11, 20, 30);
+  EXPECT_EQ(utilization.time_on_core_ns, 0);
+  EXPECT_EQ(utilization.slice_count, 0);
+
+  utilization = index.GetThreadUtilization(21, 15, 55);
+  EXPECT_EQ(utilization.time_on_core_ns, 40);
+  EXPECT_EQ(utilization.slice_count, 1);
+
+  EXPECT_EQ(index.GetThreadUtilization(11, 55, 55).time_on_core_ns, 0);
+}
+
+TEST(ThreadUtilizationIndex, SlicesOutOfOrderGiveTheSameUtilizationAsSortedSlices) {
+  std::vector<uint64_t> starts;
+  for (uint64_t i = 0; i < 1000; ++i) starts.push_back(10 * i);
+
+  ThreadUtilizationIndex sorted_index;
+  for (uint64_t start : starts) sorted_index.AddSlice(1, 2, start, start + 7);
+
+  std::shuffle(starts.begin(), starts.end(), std::mt19937{42});
+  ThreadUtilizationIndex shuffled_index;
+  for (uint64_t start : starts) shuffled_index.AddSlice(1, 2, start, start + 7);
+
+  for (uint64_t min = 0; min < 10'000; min += 1234) {
+    for (uint64_t max = min; max < 10'000; max += 567) {
+      const ThreadUtilization expected = sorted_index.GetThreadUtilization(2, min, max);
+      const ThreadUtilization actual = shuffled_index.GetThreadUtilization(2, min, max);
+      EXPECT_EQ(actual.time_on_core_ns, expected.time_on_core_ns);
+      EXPECT_EQ(actual.slice_count, expected.slice_count);
+    }
+  }
+  EXPECT_EQ(sorted_index.GetThreadUtilization(2, 0, 10'000).time_on_core_ns, 7000);
+  EXPECT_EQ(sorted_index.GetThreadUtilization(2, 0, 10'000).slice_count, 1000);
+}
+
+}  // namespace orbit_client_data
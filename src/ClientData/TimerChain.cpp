@@ -5,44 +5,106 @@
 #include "ClientData/TimerChain.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <limits>
 
+#include "ClientData/SpillableChunkAllocator.h"
 #include "ClientData/TextBox.h"
 #include "capture_data.pb.h"
 
+orbit_client_data::TimerBlock::TimerBlock(TimerBlock* prev)
+    : prev_(prev),
+      data_(static_cast<TextBox*>(TimerChain::GetBlockAllocator().Allocate())),
+      min_timestamp_(std::numeric_limits<uint64_t>::max()),
+      max_timestamp_(std::numeric_limits<uint64_t>::min()) {
+  CHECK(data_ != nullptr);
+}
+
+orbit_client_data::TimerBlock::~TimerBlock() {
+  for (size_t i = 0; i < size_; ++i) {
+    data_[i].~TextBox();
+  }
+  TimerChain::GetBlockAllocator().Free(data_);
+}
+
 bool orbit_client_data::TimerBlock::Intersects(uint64_t min, uint64_t max) const {
   return (min <= max_timestamp_ && max >= min_timestamp_);
 }
 
-orbit_client_data::TimerChain::~TimerChain() {
-  // Find last block in chain
-  while (current_->next_ != nullptr) {
-    current_ = current_->next_;
+size_t orbit_client_data::TimerBlock::FindNextTimerIntersecting(size_t index, uint64_t min,
+                                                                uint64_t max, uint64_t covered_min,
+                                                                uint64_t covered_max) const {
+  const size_t size = size_;
+  // Only the packed start and end timestamps are read, and the conditions are combined without
+  // short-circuiting, which keeps the loop short for long runs of skipped timers.
+  while (index < size) {
+    const PackedTimerInfo& timer_info = data_[index].GetPackedTimerInfo();
+    const uint64_t start = timer_info.start();
+    const uint64_t end = timer_info.end();
+    const bool intersects = (min <= end) & (max >= start);
+    const bool covered = (start >= covered_min) & (end <= covered_max);
+    if (intersects & !covered) break;
+    ++index;
   }
+  return index;
+}
+
+orbit_client_data::TimerChain::TimerChain() {
+  absl::MutexLock lock{&index_mutex_};
+  root_ = &blocks_.emplace_back(/*prev=*/nullptr);
+  current_ = root_;
+  // The elements of a block never move, as its storage is reserved when the block is created.
+  blocks_by_address_.emplace_back(root_->data_, root_);
+}
 
-  orbit_client_data::TimerBlock* prev = current_;
-  while (prev != nullptr) {
-    prev = current_->prev_;
-    delete current_;
-    current_ = prev;
+void orbit_client_data::TimerChain::AllocateNewBlock() {
+  CHECK(current_->next_ == nullptr);
+  absl::MutexLock lock{&index_mutex_};
+
+  // Index the block that just became full.
+  const uint64_t max_timestamp = current_->max_timestamp_;
+  prefix_max_timestamps_.push_back(prefix_max_timestamps_.empty()
+                                       ? max_timestamp
+                                       : std::max(prefix_max_timestamps_.back(), max_timestamp));
+  const uint64_t min_timestamp = current_->min_timestamp_;
+  suffix_min_timestamps_.push_back(min_timestamp);
+  // Timers are mostly added in order, so this rarely goes back more than a few blocks.
+  for (auto it = suffix_min_timestamps_.rbegin() + 1;
+       it != suffix_min_timestamps_.rend() && *it > min_timestamp; ++it) {
+    *it = min_timestamp;
+  }
+  for (size_t i = 0; i < current_->size(); ++i) {
+    pyramid_.Add((*current_)[i]);
   }
+
+  TimerBlock* new_block = &blocks_.emplace_back(current_);
+  const TextBox* new_block_begin = new_block->data_;
+  blocks_by_address_.insert(
+      std::upper_bound(blocks_by_address_.begin(), blocks_by_address_.end(), new_block_begin,
+                       [](const TextBox* address, const std::pair<const TextBox*, TimerBlock*>& b) {
+                         return address < b.first;
+                       }),
+      std::make_pair(new_block_begin, new_block));
+
+  current_->next_ = new_block;
+  current_ = new_block;
 }
 
 orbit_client_data::TimerBlock* orbit_client_data::TimerChain::GetBlockContaining(
     const orbit_client_data::TextBox* element) const {
-  orbit_client_data::TimerBlock* block = root_;
-  while (block != nullptr) {
-    uint32_t size = block->size();
-    if (size != 0) {
-      orbit_client_data::TextBox* begin = &block->data_[0];
-      orbit_client_data::TextBox* end = &block->data_[size - 1];
-      if (begin <= element && end >= element) {
-        return block;
-      }
-    }
-    block = block->next_;
-  }
+  absl::ReaderMutexLock lock{&index_mutex_};
+  // The last block starting at or before `element`.
+  auto it = std::upper_bound(
+      blocks_by_address_.begin(), blocks_by_address_.end(), element,
+      [](const TextBox* address, const std::pair<const TextBox*, TimerBlock*>& block) {
+        return address < block.first;
+      });
+  if (it == blocks_by_address_.begin()) return nullptr;
+  --it;
 
-  return nullptr;
+  orbit_client_data::TimerBlock* block = it->second;
+  if (element >= it->first + block->size()) return nullptr;
+  return block;
 }
 
 orbit_client_data::TextBox* orbit_client_data::TimerChain::GetElementAfter(
@@ -76,3 +138,69 @@ orbit_client_data::TextBox* orbit_client_data::TimerChain::GetElementBefore(
   }
   return nullptr;
 }
+
+orbit_client_data::TimerChain::BlockRange orbit_client_data::TimerChain::GetBlocksInTimeRange(
+    uint64_t min, uint64_t max) {
+  absl::ReaderMutexLock lock{&index_mutex_};
+  // Only the current block, the last one, is not indexed.
+  TimerBlock* current = current_;
+  const uint64_t current_min_timestamp = current->min_timestamp_;
+
+  // The first block with a timer ending at or after `min`: all the timers in the blocks before end
+  // before `min`.
+  const size_t begin_index =
+      std::lower_bound(prefix_max_timestamps_.begin(), prefix_max_timestamps_.end(), min) -
+      prefix_max_timestamps_.begin();
+  // The first block such that all timers in that block and the blocks after start after `max`.
+  const size_t end_index =
+      std::upper_bound(suffix_min_timestamps_.begin(), suffix_min_timestamps_.end(), max,
+                       [current_min_timestamp](uint64_t value, uint64_t suffix_min_timestamp) {
+                         return value < std::min(suffix_min_timestamp, current_min_timestamp);
+                       }) -
+      suffix_min_timestamps_.begin();
+
+  if (begin_index >= end_index && end_index < suffix_min_timestamps_.size()) {
+    return BlockRange{nullptr, nullptr};
+  }
+  TimerBlock* begin = begin_index < prefix_max_timestamps_.size() ? &blocks_[begin_index] : current;
+  TimerBlock* end = end_index < suffix_min_timestamps_.size() ? &blocks_[end_index] : nullptr;
+  return BlockRange{begin, end};
+}
+
+std::optional<std::vector<orbit_client_data::TimerBucket>>
+orbit_client_data::TimerChain::GetTimerBucketsInTimeRange(uint64_t min, uint64_t max,
+                                                          uint64_t resolution_ns) {
+  std::optional<uint32_t> level = TimerPyramid::GetLevelForResolution(resolution_ns);
+  if (!level.has_value()) return std::nullopt;
+
+  std::vector<TimerBucket> buckets;
+  absl::ReaderMutexLock lock{&index_mutex_};
+  pyramid_.ForEachBucketInTimeRange(
+      level.value(), min, max,
+      [&buckets](const TimerBucket& bucket) { buckets.push_back(bucket); });
+
+  for (size_t i = 0; i < current_->size(); ++i) {
+    TextBox& text_box = (*current_)[i];
+    if (text_box.End() < min || text_box.Start() > max) continue;
+    buckets.push_back(TimerBucket{text_box.Start(), text_box.End(), 1, &text_box});
+  }
+  return buckets;
+}
+
+void orbit_client_data::TimerChain::SpillBlocksOutsideTimeRange(uint64_t min, uint64_t max) const {
+  absl::ReaderMutexLock lock{&index_mutex_};
+  // Only the full blocks are indexed, and they are the first ones of blocks_. The current block is
+  // still being appended to.
+  const size_t full_block_count = prefix_max_timestamps_.size();
+  for (size_t i = 0; i < full_block_count; ++i) {
+    const TimerBlock& block = blocks_[i];
+    if (block.Intersects(min, max)) continue;
+    GetBlockAllocator().Spill(block.data_);
+  }
+}
+
+orbit_client_data::SpillableChunkAllocator& orbit_client_data::TimerChain::GetBlockAllocator() {
+  // Never destroyed, as TimerChains can outlive static objects.
+  static auto* allocator = new SpillableChunkAllocator(TimerBlock::kBlockSize * sizeof(TextBox));
+  return *allocator;
+}
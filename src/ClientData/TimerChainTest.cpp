@@ -0,0 +1,158 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace orbit_client_data {
+
+namespace {
+
+// More than one block.
+constexpr uint64_t kTimerCount = 3000;
+
+TimerInfo CreateTimer(uint64_t start, uint64_t end) {
+  TimerInfo timer_info;
+  timer_info.set_start(start);
+  timer_info.set_end(end);
+  return timer_info;
+}
+
+// Timer i covers [10 * i, 10 * i + 5].
+void AddTimers(TimerChain* chain) {
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    chain->emplace_back(CreateTimer(10 * i, 10 * i + 5));
+  }
+}
+
+// The start timestamps of the timers of `chain` that intersect [min, max].
+std::vector<uint64_t> GetStartsOfTimersInTimeRange(TimerChain* chain, uint64_t min, uint64_t max) {
+  std::vector<uint64_t> starts;
+  for (const TimerBlock& block : chain->GetBlocksInTimeRange(min, max)) {
+    if (!block.Intersects(min, max)) continue;
+    for (size_t i = 0; i < block.size(); ++i) {
+      const PackedTimerInfo& timer_info = block[i].GetPackedTimerInfo();
+      if (timer_info.start() <= max && timer_info.end() >= min) {
+        starts.push_back(timer_info.start());
+      }
+    }
+  }
+  return starts;
+}
+
+}  // namespace
+
+TEST(TimerChain, ElementBeforeAndAfterAcrossBlocks) {
+  TimerChain chain;
+  EXPECT_TRUE(chain.empty());
+  AddTimers(&chain);
+  EXPECT_EQ(chain.size(), kTimerCount);
+
+  std::vector<const TextBox*> text_boxes;
+  for (const TimerBlock& block : chain) {
+    for (size_t i = 0; i < block.size(); ++i) text_boxes.push_back(&block[i]);
+  }
+  ASSERT_EQ(text_boxes.size(), kTimerCount);
+
+  for (size_t i = 0; i < text_boxes.size(); ++i) {
+    ASSERT_NE(chain.GetBlockContaining(text_boxes[i]), nullptr);
+    EXPECT_EQ(chain.GetElementBefore(text_boxes[i]), i > 0 ? text_boxes[i - 1] : nullptr);
+    EXPECT_EQ(chain.GetElementAfter(text_boxes[i]),
+              i + 1 < text_boxes.size() ? text_boxes[i + 1] : nullptr);
+  }
+
+  TextBox not_in_chain;
+  EXPECT_EQ(chain.GetBlockContaining(&not_in_chain), nullptr);
+  EXPECT_EQ(chain.GetElementAfter(&not_in_chain), nullptr);
+}
+
+TEST(TimerChain, GetBlocksInTimeRange) {
+  TimerChain chain;
+  EXPECT_EQ(GetStartsOfTimersInTimeRange(&chain, 0, 100), std::vector<uint64_t>{});
+
+  AddTimers(&chain);
+
+  EXPECT_EQ(GetStartsOfTimersInTimeRange(&chain, 12, 31), (std::vector<uint64_t>{10, 20, 30}));
+  // In the middle of the chain, across two blocks.
+  EXPECT_EQ(GetStartsOfTimersInTimeRange(&chain, 10235, 10250),
+            (std::vector<uint64_t>{10230, 10240, 10250}));
+  // In the current block.
+  EXPECT_EQ(GetStartsOfTimersInTimeRange(&chain, 29986, 100'000),
+            (std::vector<uint64_t>{29990}));
+  EXPECT_EQ(GetStartsOfTimersInTimeRange(&chain, 100'000, 200'000), std::vector<uint64_t>{});
+
+  // Only the blocks that can intersect are visited.
+  size_t block_count = 0;
+  for (const TimerBlock& block : chain.GetBlocksInTimeRange(12, 31)) {
+    (void)block;
+    ++block_count;
+  }
+  EXPECT_EQ(block_count, 1);
+
+  // A timer that is added out of order, covering everything, makes all blocks candidates.
+  chain.emplace_back(CreateTimer(0, 100'000));
+  std::vector<uint64_t> starts = GetStartsOfTimersInTimeRange(&chain, 12, 12);
+  EXPECT_EQ(starts, (std::vector<uint64_t>{10, 0}));
+}
+
+TEST(TimerChain, FindNextTimerIntersecting) {
+  TimerChain chain;
+  AddTimers(&chain);
+  const TimerBlock& block = *chain.begin();
+  // Nothing is contained in [kNoneCoveredMin, kNoneCoveredMax].
+  constexpr uint64_t kNoneCoveredMin = std::numeric_limits<uint64_t>::max();
+  constexpr uint64_t kNoneCoveredMax = 0;
+
+  EXPECT_EQ(block.FindNextTimerIntersecting(0, 12, 31, kNoneCoveredMin, kNoneCoveredMax), 1);
+  // The timer at index 1 itself is returned.
+  EXPECT_EQ(block.FindNextTimerIntersecting(1, 12, 31, kNoneCoveredMin, kNoneCoveredMax), 1);
+  EXPECT_EQ(block.FindNextTimerIntersecting(2, 12, 31, kNoneCoveredMin, kNoneCoveredMax), 2);
+  EXPECT_EQ(block.FindNextTimerIntersecting(4, 12, 31, kNoneCoveredMin, kNoneCoveredMax),
+            block.size());
+
+  // Timers 1 to 99 are contained in [10, 995].
+  EXPECT_EQ(block.FindNextTimerIntersecting(1, 0, 100'000, 10, 995), 100);
+  // Timer 100 covers [1000, 1005], so it is not contained in [10, 1004].
+  EXPECT_EQ(block.FindNextTimerIntersecting(1, 0, 100'000, 10, 1004), 100);
+  EXPECT_EQ(block.FindNextTimerIntersecting(1, 0, 100'000, 10, 1005), 101);
+
+  EXPECT_EQ(block.FindNextTimerIntersecting(block.size(), 0, 100'000, kNoneCoveredMin,
+                                            kNoneCoveredMax),
+            block.size());
+}
+
+TEST(TimerChain, SpillBlocksOutsideTimeRangeKeepsTimers) {
+  TimerChain chain;
+  AddTimers(&chain);
+  std::vector<const TextBox*> text_boxes;
+  for (const TimerBlock& block : chain) {
+    for (size_t i = 0; i < block.size(); ++i) text_boxes.push_back(&block[i]);
+  }
+
+  chain.SpillBlocksOutsideTimeRange(10 * 2500, 10 * 2600);
+
+  // The timers didn't move and are read back from disk.
+  size_t index = 0;
+  for (const TimerBlock& block : chain) {
+    for (size_t i = 0; i < block.size(); ++i) {
+      EXPECT_EQ(&block[i], text_boxes[index]);
+      EXPECT_EQ(block[i].Start(), 10 * index);
+      EXPECT_EQ(block[i].End(), 10 * index + 5);
+      ++index;
+    }
+  }
+  EXPECT_EQ(index, kTimerCount);
+  EXPECT_EQ(GetStartsOfTimersInTimeRange(&chain, 5, 10).size(), 2);
+}
+
+}  // namespace orbit_client_data
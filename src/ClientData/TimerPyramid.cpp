@@ -0,0 +1,80 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/TimerPyramid.h"
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace orbit_client_data {
+
+void TimerPyramid::Add(TextBox& text_box) {
+  const uint64_t start = text_box.Start();
+  const uint64_t end = text_box.End();
+  const TimerInfo::Type type = text_box.GetPackedTimerInfo().type();
+
+  for (uint32_t level = 0; level < kLevelCount; ++level) {
+    std::vector<IndexedBucket>& buckets = levels_[level];
+    const uint64_t index = start >> (kMinBucketWidthLog2 + kLevelStrideLog2 * level);
+
+    const std::tuple<uint64_t, TimerInfo::Type> key{index, type};
+    // Timers mostly arrive in order, so the bucket is usually the last one or a new last one.
+    auto it = buckets.end();
+    if (!buckets.empty() && std::make_tuple(buckets.back().index, buckets.back().type) >= key) {
+      it = std::lower_bound(buckets.begin(), buckets.end(), key,
+                            [](const IndexedBucket& bucket, const auto& index_and_type) {
+                              return std::make_tuple(bucket.index, bucket.type) < index_and_type;
+                            });
+    }
+
+    if (it == buckets.end() || it->index != index || it->type != type) {
+      buckets.insert(it, IndexedBucket{index, type, TimerBucket{start, end, 1, &text_box}});
+      continue;
+    }
+
+    TimerBucket& bucket = it->bucket;
+    bucket.min_start = std::min(bucket.min_start, start);
+    bucket.max_end = std::max(bucket.max_end, end);
+    ++bucket.timer_count;
+  }
+}
+
+std::optional<uint32_t> TimerPyramid::GetLevelForResolution(uint64_t resolution_ns) {
+  if (resolution_ns < GetBucketWidth(0)) return std::nullopt;
+  uint32_t level = 0;
+  while (level + 1 < kLevelCount && GetBucketWidth(level + 1) <= resolution_ns) ++level;
+  return level;
+}
+
+void TimerPyramid::ForEachBucketInTimeRange(
+    uint32_t level, uint64_t min, uint64_t max,
+    const std::function<void(const TimerBucket&)>& action) const {
+  CHECK(level < kLevelCount);
+  const std::vector<IndexedBucket>& buckets = levels_[level];
+  const uint32_t shift = kMinBucketWidthLog2 + kLevelStrideLog2 * level;
+  const uint64_t min_index = min >> shift;
+  const uint64_t max_index = max >> shift;
+
+  auto it = std::lower_bound(
+      buckets.begin(), buckets.end(), min_index,
+      [](const IndexedBucket& bucket, uint64_t index) { return bucket.index < index; });
+  if (it != buckets.begin()) {
+    // Go back to the first of the buckets (of any type) that have the previous index.
+    const uint64_t previous_index = std::prev(it)->index;
+    while (it != buckets.begin() && std::prev(it)->index == previous_index) --it;
+  }
+
+  for (; it != buckets.end() && it->index <= max_index; ++it) {
+    const TimerBucket& bucket = it->bucket;
+    if (bucket.max_end < min || bucket.min_start > max) continue;
+    action(bucket);
+  }
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,121 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "ClientData/TimerPyramid.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace orbit_client_data {
+
+namespace {
+
+TimerInfo CreateTimer(uint64_t start, uint64_t end,
+                      TimerInfo::Type type = TimerInfo::kGpuActivity) {
+  TimerInfo timer_info;
+  timer_info.set_start(start);
+  timer_info.set_end(end);
+  timer_info.set_type(type);
+  return timer_info;
+}
+
+std::vector<TimerBucket> GetBuckets(const TimerPyramid& pyramid, uint32_t level, uint64_t min,
+                                    uint64_t max) {
+  std::vector<TimerBucket> buckets;
+  pyramid.ForEachBucketInTimeRange(level, min, max,
+                                   [&buckets](const TimerBucket& bucket) {
+                                     buckets.push_back(bucket);
+                                   });
+  return buckets;
+}
+
+}  // namespace
+
+TEST(TimerPyramid, GetLevelForResolution) {
+  const uint64_t finest_width = TimerPyramid::GetBucketWidth(0);
+  EXPECT_EQ(finest_width, uint64_t{1} << TimerPyramid::kMinBucketWidthLog2);
+  EXPECT_EQ(TimerPyramid::GetLevelForResolution(finest_width - 1), std::nullopt);
+  EXPECT_EQ(TimerPyramid::GetLevelForResolution(finest_width), 0);
+  EXPECT_EQ(TimerPyramid::GetLevelForResolution(TimerPyramid::GetBucketWidth(1) - 1), 0);
+  EXPECT_EQ(TimerPyramid::GetLevelForResolution(TimerPyramid::GetBucketWidth(1)), 1);
+  EXPECT_EQ(TimerPyramid::GetLevelForResolution(std::numeric_limits<uint64_t>::max()),
+            TimerPyramid::kLevelCount - 1);
+}
+
+TEST(TimerPyramid, MergesTimersPerBucket) {
+  static constexpr uint64_t kWidth = uint64_t{1} << TimerPyramid::kMinBucketWidthLog2;
+  // Elements of a std::deque don't move when appending.
+  std::deque<TextBox> text_boxes;
+  TimerPyramid pyramid;
+  EXPECT_TRUE(pyramid.empty());
+
+  // Three timers in bucket 0, one in bucket 1 of another type, one long one in bucket 3.
+  for (const TimerInfo& timer_info :
+       {CreateTimer(0, 10), CreateTimer(20, 30), CreateTimer(kWidth - 10, kWidth + 5),
+        CreateTimer(kWidth + 10, kWidth + 20, TimerInfo::kGpuCommandBuffer),
+        CreateTimer(3 * kWidth, 10 * kWidth)}) {
+    pyramid.Add(text_boxes.emplace_back(timer_info));
+  }
+  // Added out of order, into bucket 2.
+  pyramid.Add(text_boxes.emplace_back(CreateTimer(2 * kWidth, 2 * kWidth + 1)));
+  EXPECT_FALSE(pyramid.empty());
+
+  std::vector<TimerBucket> buckets = GetBuckets(pyramid, 0, 0, 20 * kWidth);
+  ASSERT_EQ(buckets.size(), 4);
+  EXPECT_EQ(buckets[0].min_start, 0);
+  EXPECT_EQ(buckets[0].max_end, kWidth + 5);
+  EXPECT_EQ(buckets[0].timer_count, 3);
+  EXPECT_EQ(buckets[0].first_text_box, &text_boxes[0]);
+  EXPECT_EQ(buckets[1].timer_count, 1);
+  EXPECT_EQ(buckets[1].first_text_box, &text_boxes[3]);
+  EXPECT_EQ(buckets[2].first_text_box, &text_boxes[5]);
+  EXPECT_EQ(buckets[3].max_end, 10 * kWidth);
+
+  // The long timer starting before the range is found.
+  buckets = GetBuckets(pyramid, 0, 5 * kWidth, 6 * kWidth);
+  ASSERT_EQ(buckets.size(), 1);
+  EXPECT_EQ(buckets[0].first_text_box, &text_boxes[4]);
+
+  EXPECT_TRUE(GetBuckets(pyramid, 0, 11 * kWidth, 12 * kWidth).empty());
+
+  // On the next level, the first four timers fall into the same bucket, but the one of another
+  // type is kept separate.
+  buckets = GetBuckets(pyramid, 1, 0, 20 * kWidth);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0].timer_count, 5);
+  EXPECT_EQ(buckets[0].max_end, 10 * kWidth);
+  EXPECT_EQ(buckets[1].timer_count, 1);
+}
+
+TEST(TimerPyramid, TimerChainGetTimerBucketsInTimeRange) {
+  static constexpr uint64_t kTimerCount = 3000;
+  static constexpr uint64_t kTimerDistance = 1000;
+  TimerChain chain;
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    chain.emplace_back(CreateTimer(i * kTimerDistance, i * kTimerDistance + 10));
+  }
+
+  EXPECT_EQ(chain.GetTimerBucketsInTimeRange(0, kTimerCount * kTimerDistance, 1), std::nullopt);
+
+  std::optional<std::vector<TimerBucket>> buckets = chain.GetTimerBucketsInTimeRange(
+      0, kTimerCount * kTimerDistance, TimerPyramid::GetBucketWidth(0));
+  ASSERT_TRUE(buckets.has_value());
+  uint64_t timer_count = 0;
+  for (const TimerBucket& bucket : buckets.value()) timer_count += bucket.timer_count;
+  EXPECT_EQ(timer_count, kTimerCount);
+  // The timers of the full blocks are merged, those of the current block are not.
+  EXPECT_LT(buckets->size(), kTimerCount);
+}
+
+}  // namespace orbit_client_data
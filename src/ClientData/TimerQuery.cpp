@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/TimerQuery.h"
+
+#include <absl/strings/ascii.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_split.h>
+#include <absl/time/time.h>
+
+#include <algorithm>
+
+namespace orbit_client_data {
+
+namespace {
+
+// The order of the heap: the "greatest" timer, which ends up at the front, is the shortest, and of
+// the timers of the same duration, the one that ends last.
+[[nodiscard]] bool IsLonger(const TextBox* lhs, const TextBox* rhs) {
+  if (lhs->Duration() != rhs->Duration()) return lhs->Duration() > rhs->Duration();
+  return lhs->End() < rhs->End();
+}
+
+}  // namespace
+
+ErrorMessageOr<TimerQuery> ParseTimerQuery(std::string_view text) {
+  TimerQuery query;
+  std::vector<std::string> tokens = absl::StrSplit(std::string(text), ' ', absl::SkipWhitespace());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    std::string& token = tokens[i];
+    if (token[0] == '>') {
+      absl::Duration min_duration;
+      if (!absl::ParseDuration(token.substr(1), &min_duration) ||
+          min_duration < absl::ZeroDuration()) {
+        return ErrorMessage{absl::StrFormat(
+            "\"%s\" is not a duration with a unit, like \"5ms\".", token.substr(1))};
+      }
+      query.min_duration_ns = absl::ToInt64Nanoseconds(min_duration);
+    } else if (absl::AsciiStrToLower(token) == "top") {
+      if (i + 1 == tokens.size() || !absl::SimpleAtoi(tokens[i + 1], &query.max_result_count) ||
+          query.max_result_count == 0) {
+        return ErrorMessage{"\"top\" needs to be followed by a positive number of results."};
+      }
+      ++i;
+    } else {
+      absl::AsciiStrToLower(&token);
+      query.name_tokens.push_back(std::move(token));
+    }
+  }
+  return query;
+}
+
+bool TimerQueryResults::IsLongEnough(uint64_t duration_ns) const {
+  if (duration_ns < min_duration_ns_) return false;
+  return heap_.size() < max_result_count_ || duration_ns > heap_.front()->Duration();
+}
+
+void TimerQueryResults::Add(const TextBox* text_box) {
+  if (max_result_count_ == 0 || !IsLongEnough(text_box->Duration())) return;
+  if (heap_.size() == max_result_count_) {
+    std::pop_heap(heap_.begin(), heap_.end(), IsLonger);
+    heap_.pop_back();
+  }
+  heap_.push_back(text_box);
+  std::push_heap(heap_.begin(), heap_.end(), IsLonger);
+  ++added_count_;
+}
+
+void TimerQueryResults::AddTimersOf(TimerChain* chain, const std::atomic<bool>* cancelled) {
+  for (const TimerBlock& block : *chain) {
+    if (cancelled != nullptr && *cancelled) return;
+    if (max_result_count_ == 0 || !IsLongEnough(block.max_duration())) continue;
+    for (size_t i = 0; i < block.size(); ++i) {
+      Add(&block[i]);
+    }
+  }
+}
+
+std::vector<const TextBox*> TimerQueryResults::GetLongestFirst() const {
+  std::vector<const TextBox*> results = heap_;
+  std::sort(results.begin(), results.end(), IsLonger);
+  return results;
+}
+
+}  // namespace orbit_client_data
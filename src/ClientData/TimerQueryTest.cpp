@@ -0,0 +1,97 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "ClientData/TimerQuery.h"
+#include "OrbitBase/Result.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+namespace orbit_client_data {
+
+namespace {
+
+// More than one block.
+constexpr uint64_t kTimerCount = 3000;
+
+// Timer i covers [10 * i, 10 * i + (i % 7)], except for three long timers in the second block.
+void AddTimers(TimerChain* chain) {
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    uint64_t duration = i % 7;
+    if (i == 1500) duration = 9;
+    if (i == 1600 || i == 1700) duration = 8;
+    TimerInfo timer_info;
+    timer_info.set_start(10 * i);
+    timer_info.set_end(10 * i + duration);
+    chain->emplace_back(timer_info);
+  }
+}
+
+std::vector<uint64_t> GetStarts(const std::vector<const TextBox*>& text_boxes) {
+  std::vector<uint64_t> starts;
+  for (const TextBox* text_box : text_boxes) starts.push_back(text_box->Start());
+  return starts;
+}
+
+}  // namespace
+
+TEST(TimerQuery, ParsesQueries) {
+  ErrorMessageOr<TimerQuery> query = ParseTimerQuery(" >5ms  top 100 Render Frame ");
+  ASSERT_TRUE(query.has_value()) << query.error().message();
+  EXPECT_EQ(query.value().min_duration_ns, 5'000'000);
+  EXPECT_EQ(query.value().max_result_count, 100);
+  EXPECT_THAT(query.value().name_tokens, ElementsAre("render", "frame"));
+
+  query = ParseTimerQuery("");
+  ASSERT_TRUE(query.has_value());
+  EXPECT_EQ(query.value().min_duration_ns, 0);
+  EXPECT_EQ(query.value().max_result_count, TimerQuery::kDefaultMaxResultCount);
+  EXPECT_TRUE(query.value().name_tokens.empty());
+
+  query = ParseTimerQuery(">1.5us");
+  ASSERT_TRUE(query.has_value());
+  EXPECT_EQ(query.value().min_duration_ns, 1'500);
+
+  EXPECT_THAT(ParseTimerQuery(">5").error().message(), HasSubstr("duration"));
+  EXPECT_THAT(ParseTimerQuery("top").error().message(), HasSubstr("top"));
+  EXPECT_THAT(ParseTimerQuery("top x").error().message(), HasSubstr("top"));
+}
+
+TEST(TimerQueryResults, KeepsTheLongestTimersLongestFirst) {
+  TimerChain chain;
+  AddTimers(&chain);
+  TimerBlock& first_block = *chain.begin();
+  EXPECT_EQ(first_block.max_duration(), 6);
+
+  TimerQueryResults results{/*min_duration_ns=*/0, /*max_result_count=*/3};
+  results.AddTimersOf(&chain);
+  EXPECT_EQ(results.size(), 3);
+  EXPECT_GT(results.added_count(), 3);
+  EXPECT_THAT(GetStarts(results.GetLongestFirst()), ElementsAre(15000, 16000, 17000));
+}
+
+TEST(TimerQueryResults, KeepsTheTimersOfAtLeastTheMinimumDuration) {
+  TimerChain chain;
+  AddTimers(&chain);
+
+  TimerQueryResults results{/*min_duration_ns=*/8, TimerQuery::kDefaultMaxResultCount};
+  results.AddTimersOf(&chain);
+  EXPECT_THAT(GetStarts(results.GetLongestFirst()), ElementsAre(15000, 16000, 17000));
+
+  TimerQueryResults no_results{/*min_duration_ns=*/10, TimerQuery::kDefaultMaxResultCount};
+  no_results.AddTimersOf(&chain);
+  EXPECT_EQ(no_results.size(), 0);
+}
+
+}  // namespace orbit_client_data
@@ -18,9 +18,6 @@ namespace orbit_client_data {
 void TracepointData::EmplaceTracepointEvent(uint64_t time, uint64_t tracepoint_hash,
                                             int32_t process_id, int32_t thread_id, int32_t cpu,
                                             bool is_same_pid_as_target) {
-  absl::MutexLock lock(&mutex_);
-  num_total_tracepoint_events_++;
-
   orbit_client_protos::TracepointEventInfo event;
   event.set_time(time);
   CHECK(HasTracepointKey(tracepoint_hash));
@@ -32,25 +29,30 @@ void TracepointData::EmplaceTracepointEvent(uint64_t time, uint64_t tracepoint_h
   int32_t insertion_thread_id =
       (is_same_pid_as_target) ? thread_id : orbit_base::kNotTargetProcessTid;
 
-  auto [event_map_iterator, unused_inserted] =
-      thread_id_to_time_to_tracepoint_.try_emplace(insertion_thread_id);
-  auto [unused_iterator, event_inserted] =
-      event_map_iterator->second.try_emplace(time, std::move(event));
+  bool event_inserted = false;
+  thread_id_to_time_to_tracepoint_.Write(
+      insertion_thread_id,
+      [&](std::map<uint64_t, TracepointEventInfo>& time_to_tracepoint) {
+        event_inserted = time_to_tracepoint.try_emplace(time, std::move(event)).second;
+      });
   if (!event_inserted) {
     ERROR(
         "Tracepoint event was not inserted as there was already an event on this time and "
         "thread.");
+    return;
   }
+  ++num_total_tracepoint_events_;
 }
 
 void TracepointData::ForEachTracepointEvent(
     const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const {
-  absl::MutexLock lock(&mutex_);
-  for (auto const& entry : thread_id_to_time_to_tracepoint_) {
-    for (auto const& time_to_tracepoint_event : entry.second) {
-      action(time_to_tracepoint_event.second);
-    }
-  }
+  thread_id_to_time_to_tracepoint_.ForEach(
+      [&action](int32_t /*thread_id*/,
+                const std::map<uint64_t, TracepointEventInfo>& time_to_tracepoint) {
+        for (const auto& [unused_time, tracepoint_event] : time_to_tracepoint) {
+          action(tracepoint_event);
+        }
+      });
 }
 
 namespace {
@@ -67,49 +69,77 @@ void ForEachTracepointEventInRange(
 }
 }  // namespace
 
+void TracepointData::ForEachTimeToTracepointEventsOfThread(
+    int32_t thread_id,
+    const std::function<void(const std::map<uint64_t, TracepointEventInfo>&)>& action) const {
+  if (thread_id != orbit_base::kAllThreadsOfAllProcessesTid &&
+      thread_id != orbit_base::kAllProcessThreadsTid) {
+    thread_id_to_time_to_tracepoint_.Read(thread_id, action);
+    return;
+  }
+
+  thread_id_to_time_to_tracepoint_.ForEach(
+      [&](int32_t tracepoint_thread_id,
+          const std::map<uint64_t, TracepointEventInfo>& time_to_tracepoint) {
+        if (thread_id == orbit_base::kAllProcessThreadsTid &&
+            tracepoint_thread_id == orbit_base::kNotTargetProcessTid) {
+          return;
+        }
+        action(time_to_tracepoint);
+      });
+}
+
 void TracepointData::ForEachTracepointEventOfThreadInTimeRange(
     int32_t thread_id, uint64_t min_tick, uint64_t max_tick_exclusive,
     const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const {
-  absl::MutexLock lock(&mutex_);
-  if (thread_id == orbit_base::kAllThreadsOfAllProcessesTid) {
-    for (const auto& [unused_thread_id, time_to_tracepoint] : thread_id_to_time_to_tracepoint_) {
-      ForEachTracepointEventInRange(min_tick, max_tick_exclusive, time_to_tracepoint, action);
-    }
-  } else if (thread_id == orbit_base::kAllProcessThreadsTid) {
-    for (const auto& [thread_id, time_to_tracepoint] : thread_id_to_time_to_tracepoint_) {
-      if (thread_id == orbit_base::kNotTargetProcessTid) {
-        continue;
-      }
-      ForEachTracepointEventInRange(min_tick, max_tick_exclusive, time_to_tracepoint, action);
-    }
-  } else {
-    const auto& it = thread_id_to_time_to_tracepoint_.find(thread_id);
-    if (it == thread_id_to_time_to_tracepoint_.end()) {
-      return;
-    }
-    ForEachTracepointEventInRange(min_tick, max_tick_exclusive, it->second, action);
-  }
+  ForEachTimeToTracepointEventsOfThread(
+      thread_id, [&](const std::map<uint64_t, TracepointEventInfo>& time_to_tracepoint) {
+        ForEachTracepointEventInRange(min_tick, max_tick_exclusive, time_to_tracepoint, action);
+      });
+}
+
+std::vector<uint32_t> TracepointData::GetTracepointEventCountsOfThreadPerBucket(
+    int32_t thread_id, uint64_t min_tick, uint64_t bucket_width_ns, size_t bucket_count,
+    uint32_t max_count_per_bucket) const {
+  std::vector<uint32_t> counts(bucket_count, 0);
+  ForEachTimeToTracepointEventsOfThread(
+      thread_id, [&](const std::map<uint64_t, TracepointEventInfo>& time_to_tracepoint) {
+        auto it = time_to_tracepoint.lower_bound(min_tick);
+        for (size_t bucket = 0; bucket < bucket_count && it != time_to_tracepoint.end();
+             ++bucket) {
+          const uint64_t bucket_end = min_tick + (bucket + 1) * bucket_width_ns;
+          uint32_t& count = counts[bucket];
+          while (it != time_to_tracepoint.end() && it->first < bucket_end &&
+                 count < max_count_per_bucket) {
+            ++count;
+            ++it;
+          }
+          if (it != time_to_tracepoint.end() && it->first < bucket_end) {
+            it = time_to_tracepoint.lower_bound(bucket_end);
+          }
+        }
+      });
+  return counts;
 }
 
 uint32_t TracepointData::GetNumTracepointEventsForThreadId(int32_t thread_id) const {
-  absl::MutexLock lock(&mutex_);
   if (thread_id == orbit_base::kAllThreadsOfAllProcessesTid) {
     return num_total_tracepoint_events_;
   }
-  if (thread_id == orbit_base::kAllProcessThreadsTid) {
-    const auto not_target_process_tracepoints_it =
-        thread_id_to_time_to_tracepoint_.find(orbit_base::kNotTargetProcessTid);
-    if (not_target_process_tracepoints_it == thread_id_to_time_to_tracepoint_.end()) {
-      return num_total_tracepoint_events_;
-    }
-    return num_total_tracepoint_events_ - not_target_process_tracepoints_it->second.size();
-  }
 
-  const auto& it = thread_id_to_time_to_tracepoint_.find(thread_id);
-  if (it == thread_id_to_time_to_tracepoint_.end()) {
-    return 0;
+  const auto get_event_count_of_thread = [this](int32_t tid) {
+    uint32_t event_count = 0;
+    thread_id_to_time_to_tracepoint_.Read(
+        tid, [&event_count](const std::map<uint64_t, TracepointEventInfo>& time_to_tracepoint) {
+          event_count = time_to_tracepoint.size();
+        });
+    return event_count;
+  };
+  if (thread_id == orbit_base::kAllProcessThreadsTid) {
+    return num_total_tracepoint_events_ -
+           get_event_count_of_thread(orbit_base::kNotTargetProcessTid);
   }
-  return it->second.size();
+  return get_event_count_of_thread(thread_id);
 }
 
 bool TracepointData::AddUniqueTracepointInfo(uint64_t key,
@@ -71,6 +71,28 @@ TEST(TracepointData, AddAndGetTracepointEvents) {
   EXPECT_THAT(all_tracepoint_events_target_process, UnorderedElementsAre(0, 1, 3));
 }
 
+TEST(TracepointData, GetTracepointEventCountsOfThreadPerBucket) {
+  TracepointData tracepoint_data;
+  tracepoint_data.AddUniqueTracepointInfo(0, {});
+
+  for (uint64_t time : {5, 10, 11, 12, 13, 14, 19, 35}) {
+    tracepoint_data.EmplaceTracepointEvent(time, 0, 2, 1, 0, true);
+  }
+  tracepoint_data.EmplaceTracepointEvent(20, 0, 2, 3, 0, true);
+  tracepoint_data.EmplaceTracepointEvent(21, 0, 4, 5, 0, false);
+
+  EXPECT_THAT(tracepoint_data.GetTracepointEventCountsOfThreadPerBucket(1, 10, 10, 3, 100),
+              testing::ElementsAre(6, 0, 1));
+  EXPECT_THAT(tracepoint_data.GetTracepointEventCountsOfThreadPerBucket(1, 10, 10, 3, 4),
+              testing::ElementsAre(4, 0, 1));
+  EXPECT_THAT(tracepoint_data.GetTracepointEventCountsOfThreadPerBucket(
+                  orbit_base::kAllProcessThreadsTid, 10, 10, 3, 100),
+              testing::ElementsAre(6, 1, 1));
+  EXPECT_THAT(tracepoint_data.GetTracepointEventCountsOfThreadPerBucket(
+                  orbit_base::kAllThreadsOfAllProcessesTid, 10, 10, 3, 100),
+              testing::ElementsAre(6, 2, 1));
+}
+
 TEST(TracepointData, Contains) {
   TracepointData tracepoint_data;
 
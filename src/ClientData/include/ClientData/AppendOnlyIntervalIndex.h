@@ -0,0 +1,127 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_APPEND_ONLY_INTERVAL_INDEX_H_
+#define CLIENT_DATA_APPEND_ONLY_INTERVAL_INDEX_H_
+
+#include <absl/synchronization/mutex.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace orbit_client_data {
+
+// An append-only sequence of intervals, e.g., thread state slices, sorted by begin timestamp, that
+// can be read without locking while it's being appended to. `IntervalTraits` needs to provide
+// `static uint64_t GetBegin(const Interval&)` and `static uint64_t GetEnd(const Interval&)`.
+//
+// Intervals are stored in chunks of fixed size that never move once allocated, and each chunk
+// keeps a checkpoint: the maximum end timestamp of all the intervals up to and including that
+// chunk. Finding the intervals intersecting a time range is a binary search over the checkpoints
+// followed by a scan that stops at the first interval beginning after the range. Appending an
+// interval only publishes it (with a release store of the size) once it is fully written, so a
+// reader always sees a consistent prefix of the sequence.
+//
+// Thread-Safety: Append can be called concurrently with itself and with the read methods; appends
+// are serialized by a mutex that readers never take.
+template <typename Interval, typename IntervalTraits>
+class AppendOnlyIntervalIndex {
+ public:
+  AppendOnlyIntervalIndex() = default;
+  AppendOnlyIntervalIndex(const AppendOnlyIntervalIndex&) = delete;
+  AppendOnlyIntervalIndex& operator=(const AppendOnlyIntervalIndex&) = delete;
+
+  // `interval` must not begin before the interval that was appended last.
+  void Append(Interval interval) {
+    absl::MutexLock lock{&append_mutex_};
+    const size_t size = size_.load(std::memory_order_relaxed);
+    const size_t chunk_index = size / kChunkSize;
+    if (chunk_index == chunks_.size()) AllocateChunk();
+
+    Chunk* chunk = chunks_[chunk_index].get();
+    const uint64_t end = IntervalTraits::GetEnd(interval);
+    chunk->intervals[size % kChunkSize] = std::move(interval);
+    if (end > chunk->max_end.load(std::memory_order_relaxed)) {
+      chunk->max_end.store(end, std::memory_order_relaxed);
+    }
+
+    size_.store(size + 1, std::memory_order_release);
+  }
+
+  [[nodiscard]] size_t size() const { return size_.load(std::memory_order_acquire); }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  // Calls `action` for the intervals that end at or after `min_timestamp` and begin before
+  // `max_timestamp`, in order. Only the intervals appended before the call are visited.
+  template <typename Action>
+  void ForEachIntervalIntersectingTimeRange(uint64_t min_timestamp, uint64_t max_timestamp,
+                                            Action&& action) const {
+    // Loading the size first guarantees that the directory loaded next contains all its chunks.
+    const size_t size = size_.load(std::memory_order_acquire);
+    if (size == 0) return;
+    Chunk* const* directory = directory_.load(std::memory_order_acquire);
+    const size_t chunk_count = (size + kChunkSize - 1) / kChunkSize;
+
+    // The checkpoints are non-decreasing: find the first chunk that has an interval ending at or
+    // after `min_timestamp`.
+    Chunk* const* first_chunk =
+        std::partition_point(directory, directory + chunk_count, [min_timestamp](const Chunk* c) {
+          return c->max_end.load(std::memory_order_relaxed) < min_timestamp;
+        });
+
+    for (size_t index = (first_chunk - directory) * kChunkSize; index < size; ++index) {
+      const Interval& interval = directory[index / kChunkSize]->intervals[index % kChunkSize];
+      if (IntervalTraits::GetBegin(interval) >= max_timestamp) break;
+      if (IntervalTraits::GetEnd(interval) < min_timestamp) continue;
+      action(interval);
+    }
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 1024;
+
+  struct Chunk {
+    explicit Chunk(uint64_t previous_max_end) : max_end{previous_max_end} {}
+    std::array<Interval, kChunkSize> intervals;
+    std::atomic<uint64_t> max_end;
+  };
+
+  void AllocateChunk() ABSL_EXCLUSIVE_LOCKS_REQUIRED(append_mutex_) {
+    const uint64_t previous_max_end =
+        chunks_.empty() ? 0 : chunks_.back()->max_end.load(std::memory_order_relaxed);
+    chunks_.push_back(std::make_unique<Chunk>(previous_max_end));
+
+    // Readers only use the slots of the directory that were filled before they loaded the size, so
+    // the new chunk can be added to a free slot of the current directory. When it is full, readers
+    // can still be using it, so a larger copy is published instead, and the old directories are
+    // only freed with this object.
+    if (chunks_.size() <= directory_capacity_) {
+      directories_.back()[chunks_.size() - 1] = chunks_.back().get();
+      return;
+    }
+    directory_capacity_ = std::max<size_t>(16, 2 * directory_capacity_);
+    directories_.push_back(std::make_unique<Chunk*[]>(directory_capacity_));
+    Chunk** directory = directories_.back().get();
+    for (size_t i = 0; i < chunks_.size(); ++i) directory[i] = chunks_[i].get();
+    directory_.store(directory, std::memory_order_release);
+  }
+
+  absl::Mutex append_mutex_;
+  std::vector<std::unique_ptr<Chunk>> chunks_ ABSL_GUARDED_BY(append_mutex_);
+  std::vector<std::unique_ptr<Chunk*[]>> directories_ ABSL_GUARDED_BY(append_mutex_);
+  size_t directory_capacity_ ABSL_GUARDED_BY(append_mutex_) = 0;
+
+  std::atomic<Chunk**> directory_{nullptr};
+  std::atomic<size_t> size_{0};
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_APPEND_ONLY_INTERVAL_INDEX_H_
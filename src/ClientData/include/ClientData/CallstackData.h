@@ -5,15 +5,16 @@
 #ifndef CLIENT_DATA_CALLSTACK_DATA_H_
 #define CLIENT_DATA_CALLSTACK_DATA_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <functional>
 #include <limits>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
 
+#include "CallstackEventColumns.h"
 #include "CallstackTypes.h"
 #include "absl/container/flat_hash_map.h"
 #include "capture_data.pb.h"
@@ -38,12 +39,6 @@ class CallstackData {
   void AddCallstackFromKnownCallstackData(const orbit_client_protos::CallstackEvent& event,
                                           const CallstackData* known_callstack_data);
 
-  [[nodiscard]] const absl::flat_hash_map<int32_t,
-                                          std::map<uint64_t, orbit_client_protos::CallstackEvent>>&
-  callstack_events_by_tid() const {
-    return callstack_events_by_tid_;
-  }
-
   [[nodiscard]] uint32_t GetCallstackEventsCount() const;
 
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsInTimeRange(
@@ -51,11 +46,25 @@ class CallstackData {
 
   [[nodiscard]] absl::flat_hash_map<int32_t, uint32_t> GetCallstackEventsCountsPerTid() const;
 
+  // Takes time proportional to the number of threads, not to the number of events, as the events
+  // of each thread are sorted by time.
+  [[nodiscard]] absl::flat_hash_map<int32_t, uint32_t> GetCallstackEventsCountsPerTidInTimeRange(
+      uint64_t time_begin, uint64_t time_end) const;
+
   [[nodiscard]] uint32_t GetCallstackEventsOfTidCount(int32_t thread_id) const;
 
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsOfTidInTimeRange(
       int32_t tid, uint64_t time_begin, uint64_t time_end) const;
 
+  // The number of callstack events in each of the `bucket_count` consecutive buckets of
+  // `bucket_width_ns` starting at `min_timestamp`. Takes time proportional to the number of
+  // buckets, not to the number of events, as the events are sorted by time.
+  [[nodiscard]] std::vector<uint32_t> GetCallstackEventCountsPerBucket(uint64_t min_timestamp,
+                                                                       uint64_t bucket_width_ns,
+                                                                       size_t bucket_count) const;
+  [[nodiscard]] std::vector<uint32_t> GetCallstackEventOfTidCountsPerBucket(
+      int32_t tid, uint64_t min_timestamp, uint64_t bucket_width_ns, size_t bucket_count) const;
+
   void ForEachCallstackEvent(
       const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const;
 
@@ -102,14 +111,14 @@ class CallstackData {
       uint64_t callstack_id) const;
 
   void RegisterTime(uint64_t time);
+  [[nodiscard]] CallstackEventColumns& GetOrCreateCallstackEventsOfTid(int32_t thread_id);
 
   // Use a reentrant mutex so that calls to the ForEach... methods can be nested.
   // E.g., one might want to nest ForEachCallstackEvent and ForEachFrameInCallstack.
   mutable std::recursive_mutex mutex_;
   absl::flat_hash_map<uint64_t, std::shared_ptr<orbit_client_protos::CallstackInfo>>
       unique_callstacks_;
-  absl::flat_hash_map<int32_t, std::map<uint64_t, orbit_client_protos::CallstackEvent>>
-      callstack_events_by_tid_;
+  absl::flat_hash_map<int32_t, CallstackEventColumns> callstack_events_by_tid_;
 
   uint64_t max_time_ = 0;
   uint64_t min_time_ = std::numeric_limits<uint64_t>::max();
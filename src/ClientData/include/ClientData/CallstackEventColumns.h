@@ -0,0 +1,70 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_CALLSTACK_EVENT_COLUMNS_H_
+#define CLIENT_DATA_CALLSTACK_EVENT_COLUMNS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// Stores the CallstackEvents of one thread in columns sorted by timestamp: one array of timestamps
+// and one of callstack ids, i.e., 16 bytes per event instead of a map node holding a protobuf.
+// The columns for the fields only set for off-CPU and memory callstacks are only allocated once an
+// event sets them.
+//
+// As for a std::map keyed by timestamp, an event with the same timestamp as an existing one
+// replaces it. Events are expected to be added mostly in order, which only appends to the arrays.
+//
+// Thread-Safety: This class is not thread-safe.
+class CallstackEventColumns {
+ public:
+  explicit CallstackEventColumns(int32_t thread_id) : thread_id_{thread_id} {}
+
+  void Add(const orbit_client_protos::CallstackEvent& event);
+
+  [[nodiscard]] int32_t thread_id() const { return thread_id_; }
+  [[nodiscard]] size_t size() const { return timestamps_ns_.size(); }
+  [[nodiscard]] bool empty() const { return timestamps_ns_.empty(); }
+
+  [[nodiscard]] const std::vector<uint64_t>& timestamps_ns() const { return timestamps_ns_; }
+  [[nodiscard]] const std::vector<uint64_t>& callstack_ids() const { return callstack_ids_; }
+
+  // The index of the first event with a timestamp not less than (resp. greater than)
+  // `timestamp_ns`, or size() if there is none.
+  [[nodiscard]] size_t LowerBound(uint64_t timestamp_ns) const;
+  [[nodiscard]] size_t UpperBound(uint64_t timestamp_ns) const;
+
+  // Calls `action` on the events with index in [begin_index, end_index), in order. The event passed
+  // to `action` is only valid for the duration of the call.
+  void ForEachEventInIndexRange(
+      size_t begin_index, size_t end_index,
+      const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const;
+
+  void ForEachEvent(
+      const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
+    ForEachEventInIndexRange(0, size(), action);
+  }
+
+ private:
+  void Insert(size_t index, const orbit_client_protos::CallstackEvent& event);
+  void Assign(size_t index, const orbit_client_protos::CallstackEvent& event);
+
+  int32_t thread_id_;
+  std::vector<uint64_t> timestamps_ns_;
+  std::vector<uint64_t> callstack_ids_;
+  // Either empty or of size(), see above.
+  std::vector<uint64_t> off_cpu_durations_ns_;
+  std::vector<orbit_client_protos::CallstackEvent::MemoryEventType> memory_event_types_;
+  std::vector<uint64_t> memory_event_counts_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_CALLSTACK_EVENT_COLUMNS_H_
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_CALLSTACK_POOL_H_
+#define CLIENT_DATA_CALLSTACK_POOL_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/types/span.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// A callstack stored in a CallstackPool: its frames, innermost first, and its type. The accessors
+// mirror the ones of orbit_client_protos::CallstackInfo.
+class CallstackView {
+ public:
+  CallstackView(absl::Span<const uint64_t> frames,
+                orbit_client_protos::CallstackInfo::CallstackType type)
+      : frames_{frames}, type_{type} {}
+
+  [[nodiscard]] absl::Span<const uint64_t> frames() const { return frames_; }
+  [[nodiscard]] uint64_t frames(size_t index) const { return frames_[index]; }
+  [[nodiscard]] orbit_client_protos::CallstackInfo::CallstackType type() const { return type_; }
+
+ private:
+  absl::Span<const uint64_t> frames_;
+  orbit_client_protos::CallstackInfo::CallstackType type_;
+};
+
+// Stores callstacks by id with the frames of all callstacks in one contiguous array, instead of
+// one CallstackInfo (and one heap-allocated array of frames) per callstack. This saves memory for
+// captures with many unique callstacks, and walking the frames of many callstacks, e.g., when
+// building the top-down and bottom-up views, touches mostly sequential memory.
+//
+// A CallstackView returned by Get or ForEach is only valid until the next call to Add.
+//
+// Thread-Safety: This class is not thread-safe.
+class CallstackPool {
+ public:
+  // `callstack_id` must not be in the pool yet.
+  void Add(uint64_t callstack_id, absl::Span<const uint64_t> frames,
+           orbit_client_protos::CallstackInfo::CallstackType type);
+
+  [[nodiscard]] bool Contains(uint64_t callstack_id) const {
+    return entries_.contains(callstack_id);
+  }
+  // `callstack_id` must be in the pool.
+  [[nodiscard]] CallstackView Get(uint64_t callstack_id) const;
+
+  void ForEach(const std::function<void(uint64_t callstack_id, CallstackView callstack)>& action)
+      const;
+
+  [[nodiscard]] size_t size() const { return entries_.size(); }
+  [[nodiscard]] bool empty() const { return entries_.empty(); }
+  [[nodiscard]] size_t GetTotalFrameCount() const { return frames_.size(); }
+
+ private:
+  struct Entry {
+    uint64_t frames_offset;
+    uint32_t frame_count;
+    orbit_client_protos::CallstackInfo::CallstackType type;
+  };
+
+  [[nodiscard]] CallstackView GetView(const Entry& entry) const {
+    return CallstackView{absl::MakeConstSpan(frames_.data() + entry.frames_offset,
+                                             entry.frame_count),
+                         entry.type};
+  }
+
+  std::vector<uint64_t> frames_;
+  absl::flat_hash_map<uint64_t, Entry> entries_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_CALLSTACK_POOL_H_
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_CORE_UTILIZATION_INDEX_H_
+#define CLIENT_DATA_CORE_UTILIZATION_INDEX_H_
+
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace orbit_client_data {
+
+// The time a core spent running any thread, and running threads of the target process, in some
+// time range.
+struct CoreUtilization {
+  uint64_t time_on_core_ns = 0;
+  uint64_t target_process_time_on_core_ns = 0;
+};
+
+// Indexes the scheduling slices of each core by time, together with prefix sums of their durations,
+// so that the utilization of a core in any time range is computed in logarithmic time instead of by
+// visiting the slices in the range. This is what the heatmap of the SchedulerTrack and the
+// utilization of the cores in selection statistics are computed from.
+//
+// The slices of a core don't overlap. They are mostly added in order, in constant time; a slice
+// added out of order costs time linear in the number of slices of its core that end after it.
+//
+// Thread-Safety: This class is thread-safe.
+class CoreUtilizationIndex {
+ public:
+  void AddSlice(uint32_t core, uint64_t start_ns, uint64_t end_ns, bool is_target_process);
+
+  [[nodiscard]] uint32_t GetCoreCount() const;
+
+  // The utilization of `core` in [min_ns, max_ns).
+  [[nodiscard]] CoreUtilization GetCoreUtilization(uint32_t core, uint64_t min_ns,
+                                                   uint64_t max_ns) const;
+
+  // The utilization of `core` in each of the `bucket_count` consecutive buckets of
+  // `bucket_width_ns` starting at `min_ns`.
+  [[nodiscard]] std::vector<CoreUtilization> GetCoreUtilizationPerBucket(
+      uint32_t core, uint64_t min_ns, uint64_t bucket_width_ns, size_t bucket_count) const;
+
+  // The number of slices of `core` that intersect [min_ns, max_ns).
+  [[nodiscard]] size_t GetSliceCount(uint32_t core, uint64_t min_ns, uint64_t max_ns) const;
+
+ private:
+  struct CoreSlices {
+    // The time on core, resp. of the target process, before `time_ns`.
+    [[nodiscard]] CoreUtilization GetUtilizationBefore(uint64_t time_ns) const;
+    void RecomputePrefixSumsFrom(size_t index);
+
+    // Sorted by time. The prefix sums include the slice at the same index.
+    std::vector<uint64_t> starts_ns;
+    std::vector<uint64_t> ends_ns;
+    std::vector<bool> is_target_process;
+    std::vector<uint64_t> prefix_time_on_core_ns;
+    std::vector<uint64_t> prefix_target_process_time_on_core_ns;
+  };
+
+  mutable absl::Mutex mutex_;
+  std::vector<CoreSlices> slices_by_core_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_CORE_UTILIZATION_INDEX_H_
@@ -0,0 +1,35 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_DEMANGLING_CACHE_H_
+#define CLIENT_DATA_DEMANGLING_CACHE_H_
+
+#include <absl/container/node_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <string>
+
+namespace orbit_client_data {
+
+// A cache of demangled function names that can be used from several threads. Symbols are loaded
+// with their mangled names only, as most of the functions of a module are never displayed, and
+// the names are demangled the first time they are needed. Demangled names are never evicted, so
+// the returned references stay valid as long as the cache.
+class DemanglingCache {
+ public:
+  // Returns the demangled `mangled_name`, or `mangled_name` itself if it is not a mangled name.
+  [[nodiscard]] const std::string& Demangle(const std::string& mangled_name);
+
+  // The number of demangled names in the cache.
+  [[nodiscard]] size_t size() const;
+
+ private:
+  mutable absl::Mutex mutex_;
+  absl::node_hash_map<std::string, std::string> demangled_names_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_DEMANGLING_CACHE_H_
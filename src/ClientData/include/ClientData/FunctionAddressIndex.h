@@ -0,0 +1,43 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
+#define CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace orbit_client_data {
+
+// An index of the address ranges of the functions of a module, to find the function containing an
+// address. The start addresses are stored in a sorted contiguous array, which is searched with a
+// branchless binary search, and the end addresses in a parallel array. Functions are referred to by
+// their position in the index, i.e., in the order of their start addresses.
+class FunctionAddressIndex {
+ public:
+  FunctionAddressIndex() = default;
+  // `start_addresses` must be sorted and unique, and `sizes` has the size of each function.
+  FunctionAddressIndex(std::vector<uint64_t> start_addresses, const std::vector<uint64_t>& sizes);
+
+  [[nodiscard]] size_t size() const { return start_addresses_.size(); }
+
+  // Returns the position of the function starting at `address`.
+  [[nodiscard]] std::optional<size_t> FindExact(uint64_t address) const;
+  // Returns the position of the last function starting at or before `address`, if `address` is
+  // not past its end (the end address itself counts as part of the function).
+  [[nodiscard]] std::optional<size_t> FindContaining(uint64_t address) const;
+
+ private:
+  // The number of start addresses less than or equal to `address`.
+  [[nodiscard]] size_t CountStartAddressesUpTo(uint64_t address) const;
+
+  std::vector<uint64_t> start_addresses_;
+  std::vector<uint64_t> end_addresses_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
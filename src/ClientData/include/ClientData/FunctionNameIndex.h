@@ -0,0 +1,48 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_FUNCTION_NAME_INDEX_H_
+#define CLIENT_DATA_FUNCTION_NAME_INDEX_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace orbit_client_data {
+
+// A trigram index of lowercase names, e.g., of the functions of a module, to find the names that
+// contain a substring without going through all of them: only the names that contain all the
+// trigrams (sequences of three characters) of the substring can contain it.
+//
+// For each trigram, the index stores the positions of the names that contain it in ascending
+// order, so looking up a substring is an intersection of sorted lists.
+class FunctionNameIndex {
+ public:
+  // The index refers to `lowercase_names` by position, and doesn't keep them.
+  explicit FunctionNameIndex(const std::vector<std::string>& lowercase_names);
+
+  [[nodiscard]] size_t size() const { return size_; }
+
+  // Returns the positions, in ascending order, of the names that can contain `lowercase_substring`,
+  // which are a superset of the names that contain it. Returns std::nullopt if the substring is
+  // shorter than a trigram, as then any name can contain it.
+  [[nodiscard]] std::optional<std::vector<uint32_t>> FindCandidates(
+      std::string_view lowercase_substring) const;
+
+ private:
+  size_t size_;
+  // The begin and end offsets in `positions_` of the positions of the names containing a trigram.
+  absl::flat_hash_map<uint32_t, std::pair<uint32_t, uint32_t>> trigram_to_positions_range_;
+  std::vector<uint32_t> positions_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_FUNCTION_NAME_INDEX_H_
@@ -0,0 +1,48 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_FUNCTION_STATS_UTILS_H_
+#define CLIENT_DATA_FUNCTION_STATS_UTILS_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// FunctionStats::duration_histogram uses log-linear buckets: durations below kSubBucketCount
+// nanoseconds have a bucket each, and every larger power of two is split into kSubBucketCount
+// buckets of equal width. A bucket is thus never wider than 1/kSubBucketCount of its lower bound,
+// which bounds the relative error of the percentiles computed from the histogram, while a duration
+// of any length only needs a few hundred buckets.
+constexpr uint32_t kDurationHistogramSubBucketCount = 16;
+
+[[nodiscard]] uint32_t GetDurationHistogramBucketIndex(uint64_t duration_ns);
+// The smallest duration that falls into the bucket at `index`.
+[[nodiscard]] uint64_t GetDurationHistogramBucketLowerBoundNs(uint32_t index);
+
+// Adds a call of `duration_ns` to all the fields of `stats`, including the histogram.
+void AddFunctionCallToStats(uint64_t duration_ns, orbit_client_protos::FunctionStats* stats);
+
+// Adds to the duration histogram of `stats`, and only to it, the calls counted by a histogram with
+// power-of-two buckets, where `log2_histogram[i]` counts the durations from 2^i to 2^(i+1) - 1 ns.
+// As the durations within a power of two are unknown, the calls of each bucket are added to the
+// bucket of its midpoint.
+void AddLog2DurationHistogramToStats(
+    const google::protobuf::RepeatedField<uint64_t>& log2_histogram,
+    orbit_client_protos::FunctionStats* stats);
+
+// Adds the calls of `other` to `stats`, as if they had been added to `stats` one by one.
+void MergeFunctionStats(const orbit_client_protos::FunctionStats& other,
+                        orbit_client_protos::FunctionStats* stats);
+
+// Returns an estimate of the duration that `percentile` (in [0, 1]) of the calls don't exceed, or
+// std::nullopt if `stats` has no histogram, e.g., because it was loaded from an old capture.
+[[nodiscard]] std::optional<uint64_t> GetDurationPercentileNs(
+    const orbit_client_protos::FunctionStats& stats, double percentile);
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_FUNCTION_STATS_UTILS_H_
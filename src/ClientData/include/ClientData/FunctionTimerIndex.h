@@ -0,0 +1,72 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_FUNCTION_TIMER_INDEX_H_
+#define CLIENT_DATA_FUNCTION_TIMER_INDEX_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+
+namespace orbit_client_data {
+
+// An index of the timers of each function, so that finding the previous or next call of a function,
+// or its n-th longest call, doesn't require going through the timers of all the tracks.
+//
+// The timers of each function are kept sorted by end timestamp as they are added. As timers mostly
+// arrive in that order, adding one is usually an append. The order by duration is only computed
+// when requested, and kept until further timers of that function are added.
+//
+// The index refers to the text boxes, which need to outlive it; see TimerChain, whose elements
+// don't move. Thread-safe.
+class FunctionTimerIndex {
+ public:
+  void Add(const TextBox* text_box);
+
+  [[nodiscard]] size_t GetCount(uint64_t function_id) const;
+
+  // Returns the call of the function that ends last before `time`, optionally only on thread
+  // `thread_id`, or nullptr if there is none.
+  [[nodiscard]] const TextBox* FindPrevious(uint64_t function_id, uint64_t time,
+                                            std::optional<int32_t> thread_id = std::nullopt) const;
+  // Returns the call of the function that ends first after `time`, optionally only on thread
+  // `thread_id`, or nullptr if there is none.
+  [[nodiscard]] const TextBox* FindNext(uint64_t function_id, uint64_t time,
+                                        std::optional<int32_t> thread_id = std::nullopt) const;
+
+  // Returns the `n`-th longest call of the function, starting from zero, or nullptr if the function
+  // has no more than `n` calls. Of the calls with the same duration, the earlier ones come first.
+  [[nodiscard]] const TextBox* FindNthLongest(uint64_t function_id, size_t n) const;
+
+  // Returns the longest calls of the function that take at least `min_duration_ns`, at most
+  // `max_count` of them, longest first.
+  [[nodiscard]] std::vector<const TextBox*> GetLongestCalls(uint64_t function_id,
+                                                            uint64_t min_duration_ns,
+                                                            size_t max_count) const;
+
+ private:
+  struct FunctionTimers {
+    std::vector<const TextBox*> by_end;
+    // Empty, or the same timers as `by_end`, by decreasing duration.
+    std::vector<const TextBox*> by_duration;
+  };
+
+  // Computes the order by duration of `timers` if it is out of date.
+  static void SortByDurationIfNeeded(FunctionTimers* timers);
+
+  mutable absl::Mutex mutex_;
+  // Mutable, as the order by duration is computed by the queries.
+  mutable absl::flat_hash_map<uint64_t, FunctionTimers> function_timers_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_FUNCTION_TIMER_INDEX_H_
@@ -20,10 +20,13 @@ namespace orbit_client_data {
 
 namespace function_utils {
 
-[[nodiscard]] inline const std::string& GetDisplayName(
-    const orbit_client_protos::FunctionInfo& func) {
-  return func.pretty_name().empty() ? func.name() : func.pretty_name();
-}
+// Returns the pretty name of the function if it has one, and its demangled name otherwise. The
+// demangled names are computed on first use and cached for the lifetime of the process.
+[[nodiscard]] const std::string& GetDisplayName(const orbit_client_protos::FunctionInfo& func);
+// Like GetDisplayName, but without adding the demangled name to the cache, for going through the
+// names of all the functions of a module once.
+[[nodiscard]] std::string GetDisplayNameWithoutCaching(
+    const orbit_client_protos::FunctionInfo& func);
 
 [[nodiscard]] std::string GetLoadedModuleNameByPath(std::string_view module_path);
 [[nodiscard]] std::string GetLoadedModuleName(const orbit_client_protos::FunctionInfo& func);
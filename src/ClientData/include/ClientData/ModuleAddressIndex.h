@@ -0,0 +1,55 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_MODULE_ADDRESS_INDEX_H_
+#define CLIENT_DATA_MODULE_ADDRESS_INDEX_H_
+
+#include <absl/types/span.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "ClientData/ModuleInMemory.h"
+
+namespace orbit_client_data {
+
+// An immutable index of the address ranges of the modules of a process, to find the module
+// containing an address. The start and end addresses are stored in sorted contiguous arrays. As
+// the addresses of a callstack or of a sampled thread tend to stay in the same module, each thread
+// remembers the module it found last and checks it before searching.
+class ModuleAddressIndex {
+ public:
+  ModuleAddressIndex() = default;
+  // The address ranges of the modules must not overlap.
+  explicit ModuleAddressIndex(const std::map<uint64_t, ModuleInMemory>& start_address_to_module);
+
+  [[nodiscard]] size_t size() const { return modules_.size(); }
+  [[nodiscard]] const std::vector<ModuleInMemory>& modules() const { return modules_; }
+
+  // Returns the module containing `absolute_address`, or nullptr. The end address of a module is
+  // not part of it.
+  [[nodiscard]] const ModuleInMemory* Find(uint64_t absolute_address) const;
+  // Returns the module containing each of `absolute_addresses`, or nullptr.
+  [[nodiscard]] std::vector<const ModuleInMemory*> FindAll(
+      absl::Span<const uint64_t> absolute_addresses) const;
+
+ private:
+  [[nodiscard]] bool Contains(size_t position, uint64_t absolute_address) const {
+    return start_addresses_[position] <= absolute_address &&
+           absolute_address < end_addresses_[position];
+  }
+
+  std::vector<uint64_t> start_addresses_;
+  std::vector<uint64_t> end_addresses_;
+  std::vector<ModuleInMemory> modules_;
+  // Tells the indexes apart in the per-thread cache of the last module found, even if an index is
+  // created at the address of a destroyed one.
+  uint64_t generation_ = 0;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_MODULE_ADDRESS_INDEX_H_
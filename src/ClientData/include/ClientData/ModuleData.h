@@ -10,12 +10,16 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "ClientData/FunctionAddressIndex.h"
+#include "ClientData/FunctionNameIndex.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "capture_data.pb.h"
 #include "module.pb.h"
 #include "symbol.pb.h"
@@ -49,29 +53,74 @@ class ModuleData final {
                                                                               bool is_exact) const;
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByElfAddress(
       uint64_t elf_address, bool is_exact) const;
+  // Like FindFunctionByOffset for each of `offsets`, but taking the lock only once, which matters
+  // when resolving the many addresses of the callstacks of a capture.
+  [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsByOffsets(
+      absl::Span<const uint64_t> offsets, bool is_exact) const;
   void AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbols);
   void AddFunctionInfoWithBuildId(const orbit_client_protos::FunctionInfo& function_info,
                                   const std::string& module_build_id);
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionFromHash(uint64_t hash) const;
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionFromPrettyName(
       std::string_view pretty_name) const;
+  // Like FindFunctionFromHash and FindFunctionFromPrettyName for each of the arguments, with
+  // nullptr for the ones not found, but taking the lock only once, which matters when applying
+  // presets of thousands of functions.
+  [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsFromHashes(
+      absl::Span<const uint64_t> hashes) const;
+  [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsFromPrettyNames(
+      absl::Span<const std::string> pretty_names) const;
+  // Builds the maps used by the lookups by hash and by name, which need the demangled names of all
+  // functions, so this is meant to be called on a background thread after AddSymbols. Otherwise
+  // the first lookup builds them.
+  void BuildNameMaps() const;
   [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> GetFunctions() const;
+  // Returns the functions whose display name contains `substring`, ignoring case, in the order of
+  // GetFunctions. Uses the function name index once it is built.
+  [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsByNameSubstring(
+      std::string_view substring) const;
+  // Builds the index of the lowercase display names of the functions, which takes long for big
+  // modules, so this is meant to be called on a background thread after AddSymbols. Does nothing
+  // if the index is already built.
+  void BuildFunctionNameIndex();
+  // Returns nullptr until BuildFunctionNameIndex completed, and after the functions changed. The
+  // positions in the index are the positions of the functions in GetFunctions.
+  [[nodiscard]] std::shared_ptr<const FunctionNameIndex> GetFunctionNameIndex() const;
   [[nodiscard]] std::vector<orbit_client_protos::FunctionInfo> GetOrbitFunctions() const;
 
  private:
   [[nodiscard]] bool NeedsUpdate(const orbit_grpc_protos::ModuleInfo& info) const;
+  void OnFunctionsChanged() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByElfAddressLocked(
+      uint64_t elf_address, bool is_exact) const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void UpdateFunctionAddressIndex() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void UpdateNameMaps() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   mutable absl::Mutex mutex_;
   orbit_grpc_protos::ModuleInfo module_info_;
   bool is_loaded_;
   std::map<uint64_t, std::unique_ptr<orbit_client_protos::FunctionInfo>> functions_;
-  absl::flat_hash_map<std::string_view, orbit_client_protos::FunctionInfo*>
+  // The maps by name are built by the first lookup after the functions changed, as they need the
+  // demangled names of all functions, which are otherwise only computed when displayed.
+  mutable absl::flat_hash_map<std::string_view, orbit_client_protos::FunctionInfo*>
       name_to_function_info_map_;
 
   // TODO(b/168799822) This is a map of hash to function used for preset loading. Currently presets
   // are based on a hash of the functions pretty name. This should be changed to not use hashes
   // anymore.
-  absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo*> hash_to_function_map_;
+  mutable absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo*> hash_to_function_map_;
+  mutable bool name_maps_are_outdated_ = true;
+
+  // The functions in the order of their addresses, which are the positions in
+  // `function_address_index_`. Both are rebuilt by the first lookup after the functions changed, as
+  // the functions are sometimes added one by one.
+  mutable std::vector<const orbit_client_protos::FunctionInfo*> functions_by_address_;
+  mutable FunctionAddressIndex function_address_index_;
+  mutable bool function_address_index_is_outdated_ = true;
+
+  std::shared_ptr<const FunctionNameIndex> function_name_index_;
+  // Incremented whenever `functions_` changes, so that an index built in the meantime is dropped.
+  uint64_t functions_generation_ = 0;
 };
 
 }  // namespace orbit_client_data
@@ -0,0 +1,43 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_MODULE_IN_MEMORY_H_
+#define CLIENT_DATA_MODULE_IN_MEMORY_H_
+
+#include <absl/strings/str_format.h>
+#include <inttypes.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+
+namespace orbit_client_data {
+
+// Small struct to model a space in memory occupied by a module.
+class ModuleInMemory {
+ public:
+  explicit ModuleInMemory(uint64_t start, uint64_t end, std::string file_path, std::string build_id)
+      : start_(start),
+        end_(end),
+        file_path_{std::move(file_path)},
+        build_id_{std::move(build_id)} {}
+
+  [[nodiscard]] uint64_t start() const { return start_; }
+  [[nodiscard]] uint64_t end() const { return end_; }
+  [[nodiscard]] const std::string& file_path() const { return file_path_; }
+  [[nodiscard]] const std::string& build_id() const { return build_id_; }
+  [[nodiscard]] std::string FormattedAddressRange() const {
+    return absl::StrFormat("[%016" PRIx64 " - %016" PRIx64 "]", start_, end_);
+  }
+
+ private:
+  uint64_t start_;
+  uint64_t end_;
+  std::string file_path_;
+  std::string build_id_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_MODULE_IN_MEMORY_H_
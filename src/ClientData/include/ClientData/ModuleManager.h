@@ -5,18 +5,24 @@
 #ifndef CLIENT_DATA_MODULE_MANAGER_H_
 #define CLIENT_DATA_MODULE_MANAGER_H_
 
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "ClientData/ModuleData.h"
 #include "ClientData/ProcessData.h"
-#include "absl/container/node_hash_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/synchronization/mutex.h"
 #include "capture_data.pb.h"
 #include "module.pb.h"
 
 namespace orbit_client_data {
 
+// Lookups work on an immutable snapshot of the map of modules, which adding a module replaces as a
+// whole. They only lock to take a reference to the current snapshot, and never wait for modules to
+// be added. Changes to the modules themselves are synchronized by ModuleData.
 class ModuleManager final {
  public:
   explicit ModuleManager() = default;
@@ -46,10 +52,24 @@ class ModuleManager final {
       const std::string& filename) const;
 
  private:
-  mutable absl::Mutex mutex_;
-  // We are sharing pointers to that entries and ensure reference stability by using node_hash_map
   // Map of <path, build_id> -> ModuleData
-  absl::node_hash_map<std::pair<std::string, std::string>, ModuleData> module_map_;
+  using ModuleMap = absl::flat_hash_map<std::pair<std::string, std::string>, ModuleData*>;
+
+  [[nodiscard]] std::shared_ptr<const ModuleMap> GetModuleMap() const;
+  // Adds the modules of `module_infos` that don't exist yet, and calls `update_existing_module` for
+  // the others. Returns those for which it returned true.
+  [[nodiscard]] std::vector<ModuleData*> AddModulesAndUpdateExisting(
+      absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos,
+      absl::FunctionRef<bool(ModuleData*, const orbit_grpc_protos::ModuleInfo&)>
+          update_existing_module);
+
+  // Serializes adding modules. Always acquired before `mutex_`, which only guards `module_map_`.
+  absl::Mutex update_mutex_;
+  // Owns the modules, which are never removed, so the pointers to them we share stay valid.
+  std::vector<std::unique_ptr<ModuleData>> modules_ GUARDED_BY(update_mutex_);
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<const ModuleMap> module_map_ GUARDED_BY(mutex_) =
+      std::make_shared<const ModuleMap>();
 };
 
 }  // namespace orbit_client_data
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_PACKED_TIMER_INFO_H_
+#define CLIENT_DATA_PACKED_TIMER_INFO_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// The fields of an orbit_client_protos::TimerInfo that are needed for (almost) every timer, e.g.,
+// to draw it or to search for other calls of the same function, packed into five words. The
+// accessors mirror the ones of TimerInfo, so that code only reading these fields can use either.
+class PackedTimerInfo {
+ public:
+  PackedTimerInfo() : PackedTimerInfo(orbit_client_protos::TimerInfo{}) {}
+  explicit PackedTimerInfo(const orbit_client_protos::TimerInfo& timer_info);
+
+  [[nodiscard]] uint64_t start() const { return start_; }
+  [[nodiscard]] uint64_t end() const { return end_; }
+  [[nodiscard]] uint64_t function_id() const { return function_id_; }
+  [[nodiscard]] int32_t process_id() const { return process_id_; }
+  [[nodiscard]] int32_t thread_id() const { return thread_id_; }
+  [[nodiscard]] int32_t processor() const { return processor_; }
+  [[nodiscard]] uint32_t depth() const { return depth_; }
+  [[nodiscard]] orbit_client_protos::TimerInfo::Type type() const {
+    return static_cast<orbit_client_protos::TimerInfo::Type>(type_);
+  }
+
+  static constexpr uint32_t kMaxDepth = (1u << 24) - 1;
+
+ private:
+  uint64_t start_;
+  uint64_t end_;
+  uint64_t function_id_;
+  int32_t process_id_;
+  int32_t thread_id_;
+  int32_t processor_;
+  uint32_t depth_ : 24;
+  uint32_t type_ : 8;
+};
+
+static_assert(std::is_trivially_copyable_v<PackedTimerInfo>);
+static_assert(sizeof(PackedTimerInfo) == 5 * sizeof(uint64_t));
+
+// The fields of an orbit_client_protos::TimerInfo that only few timers have, e.g., the registers of
+// functions instrumented with argument capturing, or the color of manual instrumentation scopes.
+struct RareTimerInfoFields {
+  uint64_t callstack_id = 0;
+  uint64_t user_data_key = 0;
+  uint64_t timeline_hash = 0;
+  std::vector<uint64_t> registers;
+  std::optional<orbit_client_protos::Color> color;
+  uint64_t fiber_id = 0;
+};
+
+// Returns nullptr if `timer_info` has none of the fields of RareTimerInfoFields set.
+[[nodiscard]] std::unique_ptr<RareTimerInfoFields> CreateRareTimerInfoFields(
+    const orbit_client_protos::TimerInfo& timer_info);
+
+// Reassembles the TimerInfo that `packed` and `rare_fields` were created from. `rare_fields` can be
+// nullptr.
+[[nodiscard]] orbit_client_protos::TimerInfo CreateTimerInfo(
+    const PackedTimerInfo& packed, const RareTimerInfoFields* rare_fields);
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_PACKED_TIMER_INFO_H_
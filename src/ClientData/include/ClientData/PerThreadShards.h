@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_PER_THREAD_SHARDS_H_
+#define CLIENT_DATA_PER_THREAD_SHARDS_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace orbit_client_data {
+
+// Stores one `Shard` (for example a vector of events sorted by timestamp) per thread id, each with
+// its own lock, so that the data of different threads can be appended concurrently, e.g., by
+// several capture processing threads, and read while it's being appended to.
+//
+// A reader only ever holds the lock of the shard it is reading, and shared, so it sees a consistent
+// snapshot of that shard but never blocks the writers of the other threads. Iterating over all the
+// shards visits the threads that have a shard when the iteration starts; shards are never removed.
+//
+// Thread-Safety: This class is thread-safe.
+template <typename Shard>
+class PerThreadShards {
+ public:
+  // Calls `writer` with the shard of `thread_id`, created if needed, while holding its lock
+  // exclusively.
+  template <typename Writer>
+  void Write(int32_t thread_id, Writer&& writer) {
+    ShardWithMutex* shard = GetOrCreateShard(thread_id);
+    absl::MutexLock lock{&shard->mutex};
+    std::forward<Writer>(writer)(shard->shard);
+  }
+
+  // Calls `reader` with the shard of `thread_id`, if there is one, while holding its lock shared.
+  // Returns whether there was a shard.
+  template <typename Reader>
+  bool Read(int32_t thread_id, Reader&& reader) const {
+    const ShardWithMutex* shard = FindShard(thread_id);
+    if (shard == nullptr) return false;
+    absl::ReaderMutexLock lock{&shard->mutex};
+    std::forward<Reader>(reader)(shard->shard);
+    return true;
+  }
+
+  // Calls `reader` with the thread id and the shard of each thread, in no particular order, each
+  // time holding only the lock of that shard.
+  template <typename Reader>
+  void ForEach(Reader&& reader) const {
+    std::vector<std::pair<int32_t, const ShardWithMutex*>> shards;
+    {
+      absl::ReaderMutexLock lock{&shards_mutex_};
+      shards.reserve(shards_.size());
+      for (const auto& [thread_id, shard] : shards_) {
+        shards.emplace_back(thread_id, shard.get());
+      }
+    }
+    for (const auto& [thread_id, shard] : shards) {
+      absl::ReaderMutexLock lock{&shard->mutex};
+      reader(thread_id, shard->shard);
+    }
+  }
+
+  [[nodiscard]] bool Contains(int32_t thread_id) const { return FindShard(thread_id) != nullptr; }
+
+ private:
+  struct ShardWithMutex {
+    mutable absl::Mutex mutex;
+    Shard shard ABSL_GUARDED_BY(mutex);
+  };
+
+  [[nodiscard]] const ShardWithMutex* FindShard(int32_t thread_id) const {
+    absl::ReaderMutexLock lock{&shards_mutex_};
+    auto it = shards_.find(thread_id);
+    return it != shards_.end() ? it->second.get() : nullptr;
+  }
+
+  [[nodiscard]] ShardWithMutex* GetOrCreateShard(int32_t thread_id) {
+    {
+      absl::ReaderMutexLock lock{&shards_mutex_};
+      auto it = shards_.find(thread_id);
+      if (it != shards_.end()) return it->second.get();
+    }
+    absl::MutexLock lock{&shards_mutex_};
+    std::unique_ptr<ShardWithMutex>& shard = shards_[thread_id];
+    if (shard == nullptr) shard = std::make_unique<ShardWithMutex>();
+    return shard.get();
+  }
+
+  // A shard is only ever accessed through its own mutex, shards_mutex_ only protects the map. As
+  // shards are never removed, a shard can be used after releasing shards_mutex_.
+  mutable absl::Mutex shards_mutex_;
+  absl::flat_hash_map<int32_t, std::unique_ptr<ShardWithMutex>> shards_
+      ABSL_GUARDED_BY(shards_mutex_);
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_PER_THREAD_SHARDS_H_
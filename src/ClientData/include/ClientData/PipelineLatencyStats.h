@@ -0,0 +1,68 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_PIPELINE_LATENCY_STATS_H_
+#define CLIENT_DATA_PIPELINE_LATENCY_STATS_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// Accumulates, for each stage of the capture pipeline, the distribution of the time that the
+// PipelineLatencyProbes spent in that stage, i.e., between the timestamp of the previous stage and
+// the one of the stage itself. The distributions are FunctionStats, so that the percentiles can be
+// computed with GetDurationPercentileNs. This class is thread-safe.
+class PipelineLatencyStats {
+ public:
+  enum class Stage {
+    // From the generation of the perf_event_open record to it being read from the ring buffer.
+    kRingBufferRead = 0,
+    // From being read to being processed in order by PerfEventProcessor.
+    kProcessed,
+    // From being processed to being sent to the client by the service.
+    kSent,
+    // From being sent to being received by the client. As the service and the client can run on
+    // different machines, whose clocks are not synchronized, this is relative to the smallest
+    // latency seen, which is assumed to be close to zero.
+    kReceived,
+    // From being received to the events that preceded it being inserted into the capture data.
+    kInserted,
+    kEnd
+  };
+  static constexpr size_t kStageCount = static_cast<size_t>(Stage::kEnd);
+
+  [[nodiscard]] static const char* GetStageName(Stage stage);
+
+  // Stages of which either timestamp is missing, e.g., kSent and kReceived when the service saved
+  // the capture to a file instead of sending it, are skipped.
+  void AddProbe(const orbit_grpc_protos::PipelineLatencyProbe& probe,
+                uint64_t inserted_timestamp_ns);
+  void Clear();
+
+  [[nodiscard]] uint64_t GetProbeCount() const;
+  [[nodiscard]] orbit_client_protos::FunctionStats GetStageLatencyStats(Stage stage) const;
+
+ private:
+  void AddLatency(Stage stage, uint64_t latency_ns) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  uint64_t probe_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::array<orbit_client_protos::FunctionStats, kStageCount> stage_latency_stats_
+      ABSL_GUARDED_BY(mutex_);
+  // The stats of kReceived are recomputed from these whenever a smaller offset is added.
+  std::vector<int64_t> received_minus_sent_offsets_ns_ ABSL_GUARDED_BY(mutex_);
+  int64_t min_received_minus_sent_offset_ns_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_PIPELINE_LATENCY_STATS_H_
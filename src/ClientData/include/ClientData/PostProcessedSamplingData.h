@@ -13,6 +13,7 @@
 #include <utility>
 #include <vector>
 
+#include "ClientData/CallstackPool.h"
 #include "ClientData/CallstackTypes.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -25,6 +26,8 @@ struct SampledFunction {
 
   std::string name;
   std::string module_path;
+  // The file name of `module_path`, computed once so that sorting and filtering by module is cheap.
+  std::string module_name;
   uint32_t exclusive = 0;
   float exclusive_percent = 0.f;
   uint32_t inclusive = 0;
@@ -35,6 +38,21 @@ struct SampledFunction {
   const orbit_client_protos::FunctionInfo* function = nullptr;
 };
 
+// The samples of all the functions of a module, where each sample counts at most once towards the
+// inclusive count of a module, no matter how many of its functions are in the callstack.
+struct SampledModule {
+  SampledModule() = default;
+
+  std::string module_path;
+  std::string module_name;
+  uint32_t exclusive = 0;
+  float exclusive_percent = 0.f;
+  uint32_t inclusive = 0;
+  float inclusive_percent = 0.f;
+  uint32_t unwind_errors = 0;
+  float unwind_errors_percent = 0.f;
+};
+
 struct ThreadSampleData {
   ThreadSampleData() = default;
 
@@ -45,10 +63,20 @@ struct ThreadSampleData {
   absl::flat_hash_map<uint64_t, uint32_t> resolved_address_to_count;
   absl::flat_hash_map<uint64_t, uint32_t> resolved_address_to_exclusive_count;
   absl::flat_hash_map<uint64_t, uint32_t> resolved_address_to_error_count;
+  absl::flat_hash_map<std::string, uint32_t> resolved_module_path_to_count;
+  absl::flat_hash_map<std::string, uint32_t> resolved_module_path_to_exclusive_count;
+  absl::flat_hash_map<std::string, uint32_t> resolved_module_path_to_error_count;
   std::multimap<uint32_t, uint64_t> sorted_count_to_resolved_address;
   std::vector<SampledFunction> sampled_functions;
+  // Sorted by decreasing inclusive count.
+  std::vector<SampledModule> sampled_modules;
 
   [[nodiscard]] uint32_t GetCountForAddress(uint64_t address) const;
+  // Returns the sampled addresses in [begin, end), with their counts, sorted by address. This
+  // iterates either over the addresses in the range or over all the sampled addresses, whichever
+  // are fewer, so that it is cheap both for large functions and for large captures.
+  [[nodiscard]] std::vector<std::pair<uint64_t, uint32_t>> GetSampledAddressesAndCountsInRange(
+      uint64_t begin, uint64_t end) const;
 };
 
 struct CallstackCount {
@@ -70,13 +98,13 @@ class PostProcessedSamplingData {
   PostProcessedSamplingData() = default;
   PostProcessedSamplingData(
       absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data,
-      absl::flat_hash_map<uint64_t, orbit_client_protos::CallstackInfo> id_to_resolved_callstack,
+      CallstackPool resolved_callstacks,
       absl::flat_hash_map<uint64_t, uint64_t> original_id_to_resolved_callstack_id,
       absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
           function_address_to_sampled_callstack_ids,
       std::vector<ThreadSampleData> sorted_thread_sample_data)
       : thread_id_to_sample_data_{std::move(thread_id_to_sample_data)},
-        id_to_resolved_callstack_{std::move(id_to_resolved_callstack)},
+        resolved_callstacks_{std::move(resolved_callstacks)},
         original_id_to_resolved_callstack_id_{std::move(original_id_to_resolved_callstack_id)},
         function_address_to_sampled_callstack_ids_{
             std::move(function_address_to_sampled_callstack_ids)},
@@ -89,8 +117,7 @@ class PostProcessedSamplingData {
   PostProcessedSamplingData(PostProcessedSamplingData&& other) = default;
   PostProcessedSamplingData& operator=(PostProcessedSamplingData&& other) = default;
 
-  [[nodiscard]] const orbit_client_protos::CallstackInfo& GetResolvedCallstack(
-      uint64_t sampled_callstack_id) const;
+  [[nodiscard]] CallstackView GetResolvedCallstack(uint64_t sampled_callstack_id) const;
 
   [[nodiscard]] std::unique_ptr<SortedCallstackReport>
   GetSortedCallstackReportFromFunctionAddresses(const std::vector<uint64_t>& function_addresses,
@@ -109,7 +136,7 @@ class PostProcessedSamplingData {
       const std::vector<uint64_t>& function_addresses, ThreadID thread_id) const;
 
   absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
-  absl::flat_hash_map<uint64_t, orbit_client_protos::CallstackInfo> id_to_resolved_callstack_;
+  CallstackPool resolved_callstacks_;
   absl::flat_hash_map<uint64_t, uint64_t> original_id_to_resolved_callstack_id_;
   absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
       function_address_to_sampled_callstack_ids_;
@@ -17,7 +17,9 @@
 #include <utility>
 #include <vector>
 
+#include "ClientData/ModuleAddressIndex.h"
 #include "ClientData/ModuleData.h"
+#include "ClientData/ModuleInMemory.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 #include "module.pb.h"
@@ -26,31 +28,9 @@
 
 namespace orbit_client_data {
 
-// Small struct to model a space in memory occupied by a module.
-class ModuleInMemory {
- public:
-  explicit ModuleInMemory(uint64_t start, uint64_t end, std::string file_path, std::string build_id)
-      : start_(start),
-        end_(end),
-        file_path_{std::move(file_path)},
-        build_id_{std::move(build_id)} {}
-
-  [[nodiscard]] uint64_t start() const { return start_; }
-  [[nodiscard]] uint64_t end() const { return end_; }
-  [[nodiscard]] const std::string& file_path() const { return file_path_; }
-  [[nodiscard]] const std::string& build_id() const { return build_id_; }
-  [[nodiscard]] std::string FormattedAddressRange() const {
-    return absl::StrFormat("[%016" PRIx64 " - %016" PRIx64 "]", start_, end_);
-  }
-
- private:
-  uint64_t start_;
-  uint64_t end_;
-  std::string file_path_;
-  std::string build_id_;
-};
-
-// Contains current information about process
+// Contains current information about process. The modules are published as immutable snapshots,
+// replaced as a whole by each update, so that readers only ever lock to take a reference to the
+// current snapshot and never wait for an update to be applied.
 class ProcessData final {
  public:
   ProcessData();
@@ -78,11 +58,18 @@ class ProcessData final {
 
   [[nodiscard]] ErrorMessageOr<ModuleInMemory> FindModuleByAddress(uint64_t absolute_address) const;
 
+  // Returns the index of the modules as they are now. It stays valid, and unchanged, when the
+  // modules of the process are updated, so that many addresses can be looked up without locking.
+  [[nodiscard]] std::shared_ptr<const ModuleAddressIndex> GetModuleAddressIndex() const;
+
   // Returns module base addresses. Note that the same module could be mapped twice in which case
   // this function returns two base addresses. If no module found the function returns empty vector.
   [[nodiscard]] std::vector<uint64_t> GetModuleBaseAddresses(const std::string& module_path,
                                                              const std::string& build_id) const;
 
+  // Returns the modules by start address as they are now. Like the index above, the map stays valid
+  // and unchanged when the modules are updated, so prefer this to copying it.
+  [[nodiscard]] std::shared_ptr<const std::map<uint64_t, ModuleInMemory>> GetMemoryMap() const;
   [[nodiscard]] std::map<uint64_t, ModuleInMemory> GetMemoryMapCopy() const;
   [[nodiscard]] std::vector<std::pair<std::string, std::string>> GetUniqueModulesPathAndBuildId()
       const;
@@ -97,10 +84,27 @@ class ProcessData final {
   [[nodiscard]] bool IsModuleLoadedByProcess(const ModuleData* module) const;
 
  private:
+  struct ModulesSnapshot {
+    ModulesSnapshot() = default;
+    explicit ModulesSnapshot(std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory)
+        : start_address_to_module_in_memory{std::move(start_address_to_module_in_memory)},
+          module_address_index{this->start_address_to_module_in_memory} {}
+
+    std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory;
+    ModuleAddressIndex module_address_index;
+  };
+
+  [[nodiscard]] std::shared_ptr<const ModulesSnapshot> GetModulesSnapshot() const;
+  // Builds the snapshot for `start_address_to_module_in_memory` and publishes it. Must be called
+  // with `update_mutex_` held, but not `mutex_`, which is only taken to swap the snapshots.
+  void PublishModules(std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory);
+
+  // Serializes the updates of the modules, which are computed from the current snapshot without
+  // holding `mutex_`. Always acquired before `mutex_`.
+  absl::Mutex update_mutex_;
   mutable absl::Mutex mutex_;
   orbit_grpc_protos::ProcessInfo process_info_;
-
-  std::map<uint64_t, ModuleInMemory> start_address_to_module_in_memory_;
+  std::shared_ptr<const ModulesSnapshot> modules_ = std::make_shared<const ModulesSnapshot>();
 };
 
 }  // namespace orbit_client_data
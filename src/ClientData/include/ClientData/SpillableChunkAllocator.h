@@ -0,0 +1,66 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_SPILLABLE_CHUNK_ALLOCATOR_H_
+#define CLIENT_DATA_SPILLABLE_CHUNK_ALLOCATOR_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "OrbitBase/File.h"
+
+namespace orbit_client_data {
+
+// Allocates chunks of memory of a fixed size that can be spilled to disk. On Linux, the chunks are
+// mapped from an unlinked temporary file in the directory returned by
+// std::filesystem::temp_directory_path() (i.e., $TMPDIR or /tmp). Spill writes a chunk to that file
+// and drops it from memory; accessing the chunk again reads it back transparently, at the same
+// address, so that pointers into it stay valid. On other platforms, or if the temporary file can't
+// be created or extended, the chunks are allocated on the heap and Spill does nothing.
+//
+// Note that spilling only saves memory if the temporary directory is not on a tmpfs.
+//
+// Thread-Safety: This class is thread-safe. A chunk can be spilled while it is being accessed, but
+// not while it is being freed.
+class SpillableChunkAllocator {
+ public:
+  // `chunk_size` is rounded up to a multiple of the page size.
+  explicit SpillableChunkAllocator(size_t chunk_size);
+  ~SpillableChunkAllocator();
+  SpillableChunkAllocator(const SpillableChunkAllocator&) = delete;
+  SpillableChunkAllocator& operator=(const SpillableChunkAllocator&) = delete;
+  SpillableChunkAllocator(SpillableChunkAllocator&&) = delete;
+  SpillableChunkAllocator& operator=(SpillableChunkAllocator&&) = delete;
+
+  // The memory returned is aligned to the page size, or as malloc aligns it on the heap.
+  [[nodiscard]] void* Allocate();
+  void Free(void* chunk);
+  void Spill(void* chunk);
+
+  [[nodiscard]] size_t chunk_size() const { return chunk_size_; }
+  // The size of the chunks that are currently allocated, whether they are spilled or not.
+  [[nodiscard]] uint64_t allocated_bytes() const;
+  [[nodiscard]] bool IsBackedByFile() const { return file_fd_.valid(); }
+
+ private:
+  const size_t chunk_size_;
+  orbit_base::unique_fd file_fd_;
+
+  mutable absl::Mutex mutex_;
+  // The offset in the file of each chunk mapped from the file. Chunks that are not in this map are
+  // allocated on the heap.
+  absl::flat_hash_map<void*, uint64_t> file_offsets_by_chunk_ ABSL_GUARDED_BY(mutex_);
+  // The offsets of the freed chunks, reused before the file is extended.
+  std::vector<uint64_t> free_file_offsets_ ABSL_GUARDED_BY(mutex_);
+  uint64_t file_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t allocated_chunk_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_SPILLABLE_CHUNK_ALLOCATOR_H_
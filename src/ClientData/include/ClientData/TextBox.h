@@ -5,21 +5,34 @@
 #ifndef CLIENT_DATA_TEXT_BOX_H_
 #define CLIENT_DATA_TEXT_BOX_H_
 
+#include <memory>
+#include <string>
 #include <utility>
 
+#include "ClientData/PackedTimerInfo.h"
 #include "capture_data.pb.h"
 
 namespace orbit_client_data {
 class TextBox {
  public:
   TextBox() = default;
-  explicit TextBox(orbit_client_protos::TimerInfo timer_info)
-      : timer_info_{std::move(timer_info)} {}
+  explicit TextBox(const orbit_client_protos::TimerInfo& timer_info)
+      : packed_timer_info_{timer_info},
+        rare_timer_info_fields_{CreateRareTimerInfoFields(timer_info)} {}
 
   // Delete the copy- and move-assignment operators, while keeping the copy- and move- constructors.
   // This is so that an element in TimerChain cannot just be re-assigned, which would break the
   // invariance on TimerBlock::min_timestamp_ and max_timestamp_.
-  TextBox(const TextBox& other) = default;
+  TextBox(const TextBox& other)
+      : packed_timer_info_{other.packed_timer_info_},
+        rare_timer_info_fields_{other.rare_timer_info_fields_ != nullptr
+                                    ? std::make_unique<RareTimerInfoFields>(
+                                          *other.rare_timer_info_fields_)
+                                    : nullptr},
+        pos_{other.pos_},
+        size_{other.size_},
+        text_{other.text_},
+        elapsed_time_text_length_{other.elapsed_time_text_length_} {}
   TextBox& operator=(const TextBox& other) = delete;
   TextBox(TextBox&& other) = default;
   TextBox& operator=(TextBox&& other) = delete;
@@ -33,18 +46,27 @@ class TextBox {
   [[nodiscard]] const std::string& GetText() const { return text_; }
   void SetText(std::string text) { text_ = std::move(text); }
 
-  [[nodiscard]] const orbit_client_protos::TimerInfo& GetTimerInfo() const { return timer_info_; }
+  // Reassembles the full TimerInfo of this timer. Prefer GetPackedTimerInfo() for the fields it
+  // has, in particular in code that runs for many timers.
+  [[nodiscard]] orbit_client_protos::TimerInfo GetTimerInfo() const {
+    return CreateTimerInfo(packed_timer_info_, rare_timer_info_fields_.get());
+  }
+  [[nodiscard]] const PackedTimerInfo& GetPackedTimerInfo() const { return packed_timer_info_; }
 
   void SetElapsedTimeTextLength(size_t length) { elapsed_time_text_length_ = length; }
   [[nodiscard]] size_t GetElapsedTimeTextLength() const { return elapsed_time_text_length_; }
 
   // Start() and End() are required in order to be used as node in a ScopeTree.
-  [[nodiscard]] uint64_t Start() const { return timer_info_.start(); }
-  [[nodiscard]] uint64_t End() const { return timer_info_.end(); }
+  [[nodiscard]] uint64_t Start() const { return packed_timer_info_.start(); }
+  [[nodiscard]] uint64_t End() const { return packed_timer_info_.end(); }
   [[nodiscard]] uint64_t Duration() const { return End() - Start(); }
 
  protected:
-  orbit_client_protos::TimerInfo timer_info_;
+  // Instead of a full TimerInfo per timer, which is large even if most of its fields are not set,
+  // only the commonly used fields are stored inline, and the others only for the timers that have
+  // them. This matters for captures with tens of millions of timers.
+  PackedTimerInfo packed_timer_info_;
+  std::unique_ptr<RareTimerInfoFields> rare_timer_info_fields_;
   std::pair<float, float> pos_ = {0, 0};
   std::pair<float, float> size_ = {0, 0};
   std::string text_;
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_THREAD_UTILIZATION_INDEX_H_
+#define CLIENT_DATA_THREAD_UTILIZATION_INDEX_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace orbit_client_data {
+
+// The time a thread spent on any core in some time range, and the number of times it was scheduled
+// in, i.e., of its scheduling slices that intersect the time range.
+struct ThreadUtilization {
+  uint64_t time_on_core_ns = 0;
+  size_t slice_count = 0;
+};
+
+// Indexes the scheduling slices of each thread by time, together with prefix sums of their
+// durations, so that the utilization of a thread in any time range is computed in logarithmic time
+// instead of by visiting the slices in the range. This is the counterpart by thread of
+// CoreUtilizationIndex, and what the per-process and per-thread selection statistics are computed
+// from.
+//
+// The slices of a thread don't overlap, as a thread runs on at most one core at a time. They are
+// mostly added in order, in constant time; a slice added out of order costs time linear in the
+// number of slices of its thread that end after it.
+//
+// Thread-Safety: This class is thread-safe.
+class ThreadUtilizationIndex {
+ public:
+  void AddSlice(int32_t process_id, int32_t thread_id, uint64_t start_ns, uint64_t end_ns);
+
+  // The threads that have slices, with the process each belongs to.
+  [[nodiscard]] absl::flat_hash_map<int32_t, int32_t> GetProcessIdsByThreadId() const;
+
+  // The utilization of `thread_id` in [min_ns, max_ns).
+  [[nodiscard]] ThreadUtilization GetThreadUtilization(int32_t thread_id, uint64_t min_ns,
+                                                       uint64_t max_ns) const;
+
+ private:
+  struct ThreadSlices {
+    // The time on core before `time_ns`.
+    [[nodiscard]] uint64_t GetTimeOnCoreNsBefore(uint64_t time_ns) const;
+    void RecomputePrefixSumsFrom(size_t index);
+
+    int32_t process_id = -1;
+    // Sorted by time. The prefix sums include the slice at the same index.
+    std::vector<uint64_t> starts_ns;
+    std::vector<uint64_t> ends_ns;
+    std::vector<uint64_t> prefix_time_on_core_ns;
+  };
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<int32_t, ThreadSlices> slices_by_thread_id_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_THREAD_UTILIZATION_INDEX_H_
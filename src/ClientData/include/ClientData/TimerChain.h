@@ -5,13 +5,22 @@
 #ifndef CLIENT_DATA_TIMER_CHAIN_H_
 #define CLIENT_DATA_TIMER_CHAIN_H_
 
+#include <absl/synchronization/mutex.h>
+
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <deque>
 #include <iosfwd>
 #include <limits>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
 
+#include "ClientData/SpillableChunkAllocator.h"
 #include "ClientData/TextBox.h"
+#include "ClientData/TimerPyramid.h"
 #include "OrbitBase/Logging.h"
 
 namespace orbit_client_data {
@@ -21,26 +30,31 @@ namespace orbit_client_data {
 // trivial rejection of an entire block by using the Intersects(t_min, t_max) method. This
 // effectively tests if any of the timers stored in this block intersects with the [t_min, t_max]
 // interval.
+//
+// The storage of the timers of a block is allocated from a SpillableChunkAllocator, so that the
+// blocks outside of the time range the user looks at can be spilled to disk (see
+// TimerChain::SpillBlocksOutsideTimeRange). Their timers never move, also when spilled.
 class TimerBlock {
   friend class TimerChain;
   friend class TimerChainIterator;
 
  public:
-  explicit TimerBlock(TimerBlock* prev)
-      : prev_(prev),
-        next_(nullptr),
-        min_timestamp_(std::numeric_limits<uint64_t>::max()),
-        max_timestamp_(std::numeric_limits<uint64_t>::min()) {
-    data_.reserve(kBlockSize);
-  }
+  explicit TimerBlock(TimerBlock* prev);
+  ~TimerBlock();
+  TimerBlock(const TimerBlock&) = delete;
+  TimerBlock& operator=(const TimerBlock&) = delete;
+  TimerBlock(TimerBlock&&) = delete;
+  TimerBlock& operator=(TimerBlock&&) = delete;
 
   // Append a new element to the end of the block using placement-new.
   template <class... Args>
   TextBox& emplace_back(Args&&... args) {
     CHECK(size() < kBlockSize);
-    TextBox& text_box = data_.emplace_back(std::forward<Args>(args)...);
-    min_timestamp_ = std::min(text_box.GetTimerInfo().start(), min_timestamp_);
-    max_timestamp_ = std::max(text_box.GetTimerInfo().end(), max_timestamp_);
+    TextBox& text_box = *new (&data_[size_]) TextBox(std::forward<Args>(args)...);
+    ++size_;
+    min_timestamp_ = std::min(text_box.Start(), min_timestamp_);
+    max_timestamp_ = std::max(text_box.End(), max_timestamp_);
+    max_duration_ = std::max(text_box.Duration(), max_duration_);
     return text_box;
   }
 
@@ -49,7 +63,19 @@ class TimerBlock {
   // that have so far been added to this block.
   [[nodiscard]] bool Intersects(uint64_t min, uint64_t max) const;
 
-  [[nodiscard]] size_t size() const { return data_.size(); }
+  // Returns the index of the first timer, starting at `index`, that intersects [min, max] and that
+  // is not contained in [covered_min, covered_max], or size() if there is none. This allows
+  // skipping runs of timers that don't need to be looked at, e.g., when drawing, the ones outside
+  // of the visible time range or covered by a line that was already drawn, without going through
+  // them one by one.
+  [[nodiscard]] size_t FindNextTimerIntersecting(size_t index, uint64_t min, uint64_t max,
+                                                 uint64_t covered_min, uint64_t covered_max) const;
+
+  // The duration of the longest timer of the block, which allows skipping the blocks without any
+  // timer of at least some duration.
+  [[nodiscard]] uint64_t max_duration() const { return max_duration_; }
+
+  [[nodiscard]] size_t size() const { return size_; }
   [[nodiscard]] bool at_capacity() const { return size() == kBlockSize; }
 
   TextBox& operator[](std::size_t idx) { return data_[idx]; }
@@ -59,11 +85,14 @@ class TimerBlock {
   static constexpr size_t kBlockSize = 1024;
 
   TimerBlock* prev_;
-  TimerBlock* next_;
-  std::vector<TextBox> data_;
+  TimerBlock* next_ = nullptr;
+  // Storage for kBlockSize TextBoxes, of which the first size_ are constructed.
+  TextBox* data_;
+  size_t size_ = 0;
 
   uint64_t min_timestamp_;
   uint64_t max_timestamp_;
+  uint64_t max_duration_ = 0;
 };  // TimerChainIterator iterates over all *blocks* of the chain, not the
 // individual items (TextBox instances) that are stored in the blocks (this is
 // different from the BlockIterator in BlockChain.h).
@@ -97,9 +126,26 @@ class TimerChainIterator {
 // is a difference compared with BlockChain in how the iterators work: Here,
 // the iterator runs over blocks, in BlockChain the iterator runs over the
 // individually stored elements.
+//
+// The blocks are allocated in chunks (by a std::deque) instead of one by one, and indexed so that
+// finding the block containing an element and finding the blocks that can intersect a time range
+// are logarithmic in the number of blocks. The index only covers the blocks that are full; the
+// current block, the only one that is still being appended to, is always considered.
 class TimerChain {
  public:
-  ~TimerChain();
+  // The blocks of the chain from `begin` (included) to `end` (excluded), see GetBlocksInTimeRange.
+  class BlockRange {
+   public:
+    BlockRange(TimerBlock* begin, TimerBlock* end) : begin_{begin}, end_{end} {}
+    [[nodiscard]] TimerChainIterator begin() const { return TimerChainIterator(begin_); }
+    [[nodiscard]] TimerChainIterator end() const { return TimerChainIterator(end_); }
+
+   private:
+    TimerBlock* begin_;
+    TimerBlock* end_;
+  };
+
+  TimerChain();
 
   // Append an item to the end of the current block. If capacity of the current block is reached, a
   // new blocked is allocated and the item is added to the new block.
@@ -124,17 +170,44 @@ class TimerChain {
 
   [[nodiscard]] TimerChainIterator end() { return TimerChainIterator(nullptr); }
 
- private:
-  void AllocateNewBlock() {
-    CHECK(current_->next_ == nullptr);
-    current_->next_ = new TimerBlock(current_);
-    current_ = current_->next_;
-    ++num_blocks_;
-  }
+  // Returns the blocks that can contain timers intersecting [min, max]: all the blocks before the
+  // returned range and after it don't. The blocks in the range still need to be tested with
+  // TimerBlock::Intersects.
+  [[nodiscard]] BlockRange GetBlocksInTimeRange(uint64_t min, uint64_t max);
+
+  // Returns the timers intersecting [min, max] merged into buckets not wider than `resolution_ns`,
+  // see TimerPyramid. The timers of the current block are returned as buckets of one timer each.
+  // Returns std::nullopt if `resolution_ns` is finer than the finest level of the pyramid, in which
+  // case the timers need to be visited individually (see GetBlocksInTimeRange).
+  [[nodiscard]] std::optional<std::vector<TimerBucket>> GetTimerBucketsInTimeRange(
+      uint64_t min, uint64_t max, uint64_t resolution_ns);
 
-  TimerBlock* root_ = new TimerBlock(/*prev=*/nullptr);
-  TimerBlock* current_ = root_;
-  uint64_t num_blocks_ = 1;
+  // Spills the full blocks that don't intersect [min, max] to disk, see SpillableChunkAllocator.
+  // The timers of those blocks stay accessible, they are read back from disk when accessed. Can be
+  // called while timers are added and accessed on other threads.
+  void SpillBlocksOutsideTimeRange(uint64_t min, uint64_t max) const;
+
+  // The allocator of the storage of the blocks of all TimerChains.
+  [[nodiscard]] static SpillableChunkAllocator& GetBlockAllocator();
+
+ private:
+  void AllocateNewBlock();
+
+  mutable absl::Mutex index_mutex_;
+  std::deque<TimerBlock> blocks_ ABSL_GUARDED_BY(index_mutex_);
+  // For each full block, the maximum of the max_timestamp_ of that block and all the blocks before,
+  // and the minimum of the min_timestamp_ of that block and all the full blocks after. Both are
+  // non-decreasing, which allows binary searches.
+  std::vector<uint64_t> prefix_max_timestamps_ ABSL_GUARDED_BY(index_mutex_);
+  std::vector<uint64_t> suffix_min_timestamps_ ABSL_GUARDED_BY(index_mutex_);
+  // The address of the first element of each block, sorted, and the block.
+  std::vector<std::pair<const TextBox*, TimerBlock*>> blocks_by_address_
+      ABSL_GUARDED_BY(index_mutex_);
+  // The timers of the full blocks.
+  TimerPyramid pyramid_ ABSL_GUARDED_BY(index_mutex_);
+
+  TimerBlock* root_ = nullptr;
+  TimerBlock* current_ = nullptr;
   uint64_t num_items_ = 0;
 };
 }  // namespace orbit_client_data
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_TIMER_PYRAMID_H_
+#define CLIENT_DATA_TIMER_PYRAMID_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// The timers of the same type whose start falls into the same bucket of a TimerPyramid level,
+// merged: the hull of their time spans, their number, and the first of them that was added.
+struct TimerBucket {
+  uint64_t min_start = 0;
+  uint64_t max_end = 0;
+  uint64_t timer_count = 0;
+  TextBox* first_text_box = nullptr;
+};
+
+// A multi-resolution summary of a sequence of non-overlapping timers, e.g., those of one depth of a
+// TimerChain. Level `l` divides time into buckets of 2^(kMinBucketWidthLog2 + kLevelStrideLog2 * l)
+// nanoseconds and merges the timers per bucket. When zoomed out so that a pixel spans at least one
+// bucket, drawing the buckets of the matching level instead of the individual timers takes time
+// proportional to the number of pixels instead of to the number of timers.
+//
+// Timers are added one by one and, as they mostly arrive in order, in amortized constant time per
+// level.
+//
+// Thread-Safety: This class is not thread-safe.
+class TimerPyramid {
+ public:
+  static constexpr uint32_t kMinBucketWidthLog2 = 20;
+  static constexpr uint32_t kLevelStrideLog2 = 2;
+  static constexpr uint32_t kLevelCount = 11;
+
+  // `text_box` needs to outlive this object, as buckets keep a pointer to it.
+  void Add(TextBox& text_box);
+
+  [[nodiscard]] static uint64_t GetBucketWidth(uint32_t level) {
+    return uint64_t{1} << (kMinBucketWidthLog2 + kLevelStrideLog2 * level);
+  }
+  // The coarsest level whose buckets are not wider than `resolution_ns`, or std::nullopt if even
+  // the buckets of the finest level are wider.
+  [[nodiscard]] static std::optional<uint32_t> GetLevelForResolution(uint64_t resolution_ns);
+
+  // Calls `action` for the buckets of `level` that intersect [min, max], ordered by start. As the
+  // timers don't overlap, the only timer starting before `min` that can intersect the range is the
+  // last one starting before it, so the bucket containing it is also considered.
+  void ForEachBucketInTimeRange(uint32_t level, uint64_t min, uint64_t max,
+                                const std::function<void(const TimerBucket&)>& action) const;
+
+  [[nodiscard]] bool empty() const { return levels_[0].empty(); }
+
+ private:
+  struct IndexedBucket {
+    uint64_t index;
+    orbit_client_protos::TimerInfo::Type type;
+    TimerBucket bucket;
+  };
+
+  // Per level, the buckets sorted by index and then type.
+  std::array<std::vector<IndexedBucket>, kLevelCount> levels_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_TIMER_PYRAMID_H_
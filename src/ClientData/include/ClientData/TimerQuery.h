@@ -0,0 +1,69 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_TIMER_QUERY_H_
+#define CLIENT_DATA_TIMER_QUERY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_client_data {
+
+// A search for the longest timers, e.g., "all calls of function X longer than 5 ms", or "the 100
+// longest timers of any kind".
+struct TimerQuery {
+  static constexpr size_t kDefaultMaxResultCount = 10'000;
+
+  uint64_t min_duration_ns = 0;
+  // Only the longest matching timers are kept.
+  size_t max_result_count = kDefaultMaxResultCount;
+  // Lowercase. If not empty, only the timers whose (function) name contains all of them match.
+  std::vector<std::string> name_tokens;
+};
+
+// Parses a query of the form "[>DURATION] [top COUNT] [NAME...]", e.g., ">5ms render" or
+// "top 100", in any order. The duration has a unit (ns, us, ms, s, ...).
+[[nodiscard]] ErrorMessageOr<TimerQuery> ParseTimerQuery(std::string_view text);
+
+// The longest timers of at least some duration seen so far, e.g., while going through the timers
+// of all the tracks: a min-heap of at most `max_result_count` timers. Once the heap is full, only
+// the timers longer than the shortest of them matter, so that whole blocks of timers can be
+// skipped based on their longest timer.
+class TimerQueryResults {
+ public:
+  explicit TimerQueryResults(uint64_t min_duration_ns, size_t max_result_count)
+      : min_duration_ns_{min_duration_ns}, max_result_count_{max_result_count} {}
+
+  void Add(const TextBox* text_box);
+  // Stops early, block by block, if `cancelled` becomes true.
+  void AddTimersOf(TimerChain* chain, const std::atomic<bool>* cancelled = nullptr);
+
+  [[nodiscard]] size_t size() const { return heap_.size(); }
+  // The number of timers added so far, including those that longer ones replaced since, which
+  // tells whether the results changed.
+  [[nodiscard]] uint64_t added_count() const { return added_count_; }
+  // Returns the results so far, longest first.
+  [[nodiscard]] std::vector<const TextBox*> GetLongestFirst() const;
+
+ private:
+  // Whether a timer of `duration_ns` would be added.
+  [[nodiscard]] bool IsLongEnough(uint64_t duration_ns) const;
+
+  uint64_t min_duration_ns_;
+  size_t max_result_count_;
+  std::vector<const TextBox*> heap_;
+  uint64_t added_count_ = 0;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_TIMER_QUERY_H_
@@ -9,12 +9,14 @@
 #include <absl/synchronization/mutex.h>
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <map>
 #include <vector>
 
+#include "ClientData/PerThreadShards.h"
 #include "capture_data.pb.h"
 #include "tracepoint.pb.h"
 
@@ -32,7 +34,7 @@ namespace orbit_client_data {
  * to compress the wire format of events. The events contain an identifier rather than the full
  * description of the tracepoint they correspond to.
  *
- * Thread-Safety: This class is thread-safe.
+ * Thread-Safety: This class is thread-safe. Events of different threads can be added concurrently.
  */
 class TracepointData {
  public:
@@ -44,6 +46,14 @@ class TracepointData {
       int32_t thread_id, uint64_t min_tick, uint64_t max_tick_exclusive,
       const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const;
 
+  // The number of tracepoint events of `thread_id`, selected as in
+  // ForEachTracepointEventOfThreadInTimeRange, in each of the `bucket_count` consecutive buckets of
+  // `bucket_width_ns` starting at `min_tick`. Counting stops at `max_count_per_bucket` and skips
+  // the rest of the bucket, so that dense buckets don't cost a visit of each of their events.
+  [[nodiscard]] std::vector<uint32_t> GetTracepointEventCountsOfThreadPerBucket(
+      int32_t thread_id, uint64_t min_tick, uint64_t bucket_width_ns, size_t bucket_count,
+      uint32_t max_count_per_bucket) const;
+
   void ForEachTracepointEvent(
       const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const;
 
@@ -58,12 +68,16 @@ class TracepointData {
       const std::function<void(const orbit_client_protos::TracepointInfo&)>& action) const;
 
  private:
-  int32_t num_total_tracepoint_events_ = 0;
+  void ForEachTimeToTracepointEventsOfThread(
+      int32_t thread_id,
+      const std::function<void(
+          const std::map<uint64_t, orbit_client_protos::TracepointEventInfo>&)>& action) const;
+
+  std::atomic<uint32_t> num_total_tracepoint_events_ = 0;
 
-  mutable absl::Mutex mutex_;
   mutable absl::Mutex unique_tracepoints_mutex_;
 
-  absl::flat_hash_map<int32_t, std::map<uint64_t, orbit_client_protos::TracepointEventInfo> >
+  PerThreadShards<std::map<uint64_t, orbit_client_protos::TracepointEventInfo>>
       thread_id_to_time_to_tracepoint_;
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo> unique_tracepoints_;
 };
@@ -0,0 +1,139 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientModel/CaptureComparison.h"
+
+#include <absl/container/flat_hash_map.h>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "ClientData/FunctionStatsUtils.h"
+
+using orbit_client_data::PostProcessedSamplingData;
+using orbit_client_data::SampledFunction;
+using orbit_client_data::ThreadSampleData;
+
+namespace orbit_client_model {
+
+namespace {
+
+// Function name and module build id.
+using FunctionKey = std::pair<std::string, std::string>;
+
+template <typename Comparison>
+[[nodiscard]] std::vector<Comparison> SortByFunctionNameAndModuleBuildId(
+    absl::flat_hash_map<FunctionKey, Comparison> comparisons) {
+  std::vector<Comparison> sorted_comparisons;
+  sorted_comparisons.reserve(comparisons.size());
+  for (auto& [unused_key, comparison] : comparisons) {
+    sorted_comparisons.push_back(std::move(comparison));
+  }
+  std::sort(sorted_comparisons.begin(), sorted_comparisons.end(),
+            [](const Comparison& lhs, const Comparison& rhs) {
+              return std::tie(lhs.function_name, lhs.module_build_id) <
+                     std::tie(rhs.function_name, rhs.module_build_id);
+            });
+  return sorted_comparisons;
+}
+
+// Calls `add_sampled_function(key, sampled_function)` for each sampled function of the summary
+// of `sampling_data` whose name is known.
+template <typename AddSampledFunction>
+void ForEachSampledFunction(const PostProcessedSamplingData& sampling_data,
+                            const CaptureData& capture_data,
+                            AddSampledFunction&& add_sampled_function) {
+  const ThreadSampleData* summary = sampling_data.GetSummary();
+  if (summary == nullptr) return;
+  for (const SampledFunction& sampled_function : summary->sampled_functions) {
+    if (sampled_function.name == CaptureData::kUnknownFunctionOrModuleName) continue;
+    add_sampled_function(
+        FunctionKey{sampled_function.name,
+                    capture_data.FindModuleBuildIdByAddress(sampled_function.absolute_address)
+                        .value_or("")},
+        sampled_function);
+  }
+}
+
+}  // namespace
+
+std::vector<SampledFunctionComparison> CompareSampledFunctions(
+    const PostProcessedSamplingData& baseline_sampling_data,
+    const CaptureData& baseline_capture_data,
+    const PostProcessedSamplingData& comparison_sampling_data,
+    const CaptureData& comparison_capture_data) {
+  absl::flat_hash_map<FunctionKey, SampledFunctionComparison> comparisons;
+  auto get_or_create_comparison = [&comparisons](const FunctionKey& key,
+                                                 const SampledFunction& sampled_function) {
+    auto [it, inserted] = comparisons.try_emplace(key);
+    if (inserted) {
+      it->second.function_name = key.first;
+      it->second.module_path = sampled_function.module_path;
+      it->second.module_build_id = key.second;
+    }
+    return &it->second;
+  };
+
+  // Addresses that resolve to the same function, e.g., in a module that is loaded twice, add up.
+  ForEachSampledFunction(
+      baseline_sampling_data, baseline_capture_data,
+      [&get_or_create_comparison](const FunctionKey& key, const SampledFunction& sampled_function) {
+        SampledFunctionComparison* comparison = get_or_create_comparison(key, sampled_function);
+        comparison->baseline_inclusive_percent += sampled_function.inclusive_percent;
+        comparison->baseline_exclusive_percent += sampled_function.exclusive_percent;
+      });
+  ForEachSampledFunction(
+      comparison_sampling_data, comparison_capture_data,
+      [&get_or_create_comparison](const FunctionKey& key, const SampledFunction& sampled_function) {
+        SampledFunctionComparison* comparison = get_or_create_comparison(key, sampled_function);
+        comparison->comparison_inclusive_percent += sampled_function.inclusive_percent;
+        comparison->comparison_exclusive_percent += sampled_function.exclusive_percent;
+      });
+
+  return SortByFunctionNameAndModuleBuildId(std::move(comparisons));
+}
+
+std::optional<int64_t> FunctionStatsComparison::GetDurationPercentileDeltaNs(
+    double percentile) const {
+  if (baseline_stats.count() == 0 || comparison_stats.count() == 0) return std::nullopt;
+  std::optional<uint64_t> baseline_percentile_ns =
+      orbit_client_data::GetDurationPercentileNs(baseline_stats, percentile);
+  std::optional<uint64_t> comparison_percentile_ns =
+      orbit_client_data::GetDurationPercentileNs(comparison_stats, percentile);
+  if (!baseline_percentile_ns.has_value() || !comparison_percentile_ns.has_value()) {
+    return std::nullopt;
+  }
+  return static_cast<int64_t>(comparison_percentile_ns.value()) -
+         static_cast<int64_t>(baseline_percentile_ns.value());
+}
+
+std::vector<FunctionStatsComparison> CompareFunctionStats(
+    const CaptureData& baseline_capture_data, const CaptureData& comparison_capture_data) {
+  absl::flat_hash_map<FunctionKey, FunctionStatsComparison> comparisons;
+  auto add_function_stats = [&comparisons](const CaptureData& capture_data, bool is_baseline) {
+    for (const auto& [function_id, instrumented_function] :
+         capture_data.instrumented_functions()) {
+      const FunctionKey key{instrumented_function.function_name(),
+                            instrumented_function.file_build_id()};
+      auto [it, inserted] = comparisons.try_emplace(key);
+      FunctionStatsComparison& comparison = it->second;
+      if (inserted) {
+        comparison.function_name = key.first;
+        comparison.module_path = instrumented_function.file_path();
+        comparison.module_build_id = key.second;
+      }
+      // The same function can be instrumented more than once, e.g., if the module is loaded twice.
+      orbit_client_data::MergeFunctionStats(
+          capture_data.GetFunctionStatsOrDefault(function_id),
+          is_baseline ? &comparison.baseline_stats : &comparison.comparison_stats);
+    }
+  };
+  add_function_stats(baseline_capture_data, /*is_baseline=*/true);
+  add_function_stats(comparison_capture_data, /*is_baseline=*/false);
+
+  return SortByFunctionNameAndModuleBuildId(std::move(comparisons));
+}
+
+}  // namespace orbit_client_model
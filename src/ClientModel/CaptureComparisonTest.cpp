@@ -0,0 +1,147 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ClientData/PostProcessedSamplingData.h"
+#include "ClientModel/CaptureComparison.h"
+#include "ClientModel/CaptureData.h"
+#include "ClientModel/SamplingDataPostProcessor.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_data::PostProcessedSamplingData;
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::LinuxAddressInfo;
+using orbit_grpc_protos::CaptureStarted;
+using orbit_grpc_protos::InstrumentedFunction;
+
+namespace orbit_client_model {
+
+namespace {
+
+constexpr int32_t kThreadId = 42;
+constexpr const char* kModulePath = "/path/to/module";
+constexpr const char* kModuleBuildId = "build_id";
+
+[[nodiscard]] CaptureStarted CreateCaptureStarted(
+    const std::vector<std::pair<uint64_t, std::string>>& instrumented_function_ids_and_names) {
+  CaptureStarted capture_started;
+  for (const auto& [function_id, function_name] : instrumented_function_ids_and_names) {
+    InstrumentedFunction* instrumented_function =
+        capture_started.mutable_capture_options()->add_instrumented_functions();
+    instrumented_function->set_function_id(function_id);
+    instrumented_function->set_function_name(function_name);
+    instrumented_function->set_file_path(kModulePath);
+    instrumented_function->set_file_build_id(kModuleBuildId);
+  }
+  return capture_started;
+}
+
+void AddFunction(CaptureData* capture_data, uint64_t address, const std::string& name) {
+  LinuxAddressInfo address_info;
+  address_info.set_absolute_address(address);
+  address_info.set_offset_in_function(0);
+  address_info.set_function_name(name);
+  address_info.set_module_path(kModulePath);
+  capture_data->InsertAddressInfo(address_info);
+}
+
+// `frames` are from the innermost frame to the outermost frame.
+void AddSamples(CaptureData* capture_data, uint64_t callstack_id,
+                const std::vector<uint64_t>& frames, uint64_t count) {
+  CallstackInfo callstack_info;
+  *callstack_info.mutable_frames() = {frames.begin(), frames.end()};
+  callstack_info.set_type(CallstackInfo::kComplete);
+  capture_data->AddUniqueCallstack(callstack_id, std::move(callstack_info));
+  for (uint64_t i = 0; i < count; ++i) {
+    CallstackEvent callstack_event;
+    callstack_event.set_callstack_id(callstack_id);
+    callstack_event.set_thread_id(kThreadId);
+    // Callstack events are identified by timestamp.
+    callstack_event.set_time(callstack_id * 1000 + i);
+    capture_data->AddCallstackEvent(std::move(callstack_event));
+  }
+}
+
+[[nodiscard]] PostProcessedSamplingData PostProcess(const CaptureData& capture_data) {
+  return CreatePostProcessedSamplingData(*capture_data.GetCallstackData(), capture_data);
+}
+
+}  // namespace
+
+TEST(CaptureComparison, CompareSampledFunctionsMatchesFunctionsByName) {
+  CaptureData baseline{nullptr, CaptureStarted{}, std::nullopt, {}};
+  AddFunction(&baseline, 0x100, "foo");
+  AddFunction(&baseline, 0x200, "bar");
+  AddSamples(&baseline, 1, {0x100}, 3);
+  AddSamples(&baseline, 2, {0x200, 0x100}, 1);
+
+  // The same function is at a different address in the other capture.
+  CaptureData comparison{nullptr, CaptureStarted{}, std::nullopt, {}};
+  AddFunction(&comparison, 0x1100, "foo");
+  AddFunction(&comparison, 0x1300, "baz");
+  AddSamples(&comparison, 1, {0x1100}, 1);
+  AddSamples(&comparison, 2, {0x1300, 0x1100}, 1);
+  // Functions without name are not compared.
+  AddSamples(&comparison, 3, {0x5000}, 2);
+
+  std::vector<SampledFunctionComparison> comparisons = CompareSampledFunctions(
+      PostProcess(baseline), baseline, PostProcess(comparison), comparison);
+  ASSERT_EQ(comparisons.size(), 3);
+
+  EXPECT_EQ(comparisons[0].function_name, "bar");
+  EXPECT_EQ(comparisons[0].module_path, kModulePath);
+  EXPECT_FLOAT_EQ(comparisons[0].baseline_inclusive_percent, 25.f);
+  EXPECT_FLOAT_EQ(comparisons[0].baseline_exclusive_percent, 25.f);
+  EXPECT_FLOAT_EQ(comparisons[0].comparison_inclusive_percent, 0.f);
+  EXPECT_FLOAT_EQ(comparisons[0].GetInclusivePercentDelta(), -25.f);
+
+  EXPECT_EQ(comparisons[1].function_name, "baz");
+  EXPECT_FLOAT_EQ(comparisons[1].baseline_inclusive_percent, 0.f);
+  EXPECT_FLOAT_EQ(comparisons[1].comparison_inclusive_percent, 25.f);
+  EXPECT_FLOAT_EQ(comparisons[1].GetExclusivePercentDelta(), 25.f);
+
+  EXPECT_EQ(comparisons[2].function_name, "foo");
+  EXPECT_FLOAT_EQ(comparisons[2].baseline_inclusive_percent, 100.f);
+  EXPECT_FLOAT_EQ(comparisons[2].baseline_exclusive_percent, 75.f);
+  EXPECT_FLOAT_EQ(comparisons[2].comparison_inclusive_percent, 50.f);
+  EXPECT_FLOAT_EQ(comparisons[2].comparison_exclusive_percent, 25.f);
+  EXPECT_FLOAT_EQ(comparisons[2].GetInclusivePercentDelta(), -50.f);
+  EXPECT_FLOAT_EQ(comparisons[2].GetExclusivePercentDelta(), -50.f);
+}
+
+TEST(CaptureComparison, CompareFunctionStatsMatchesFunctionsByName) {
+  CaptureData baseline{nullptr, CreateCaptureStarted({{1, "foo"}}), std::nullopt, {}};
+  for (int i = 0; i < 10; ++i) baseline.UpdateFunctionStats(1, 100);
+
+  CaptureData comparison{nullptr, CreateCaptureStarted({{7, "foo"}, {8, "qux"}}), std::nullopt,
+                         {}};
+  for (int i = 0; i < 10; ++i) comparison.UpdateFunctionStats(7, 200);
+  comparison.UpdateFunctionStats(8, 50);
+
+  std::vector<FunctionStatsComparison> comparisons = CompareFunctionStats(baseline, comparison);
+  ASSERT_EQ(comparisons.size(), 2);
+
+  EXPECT_EQ(comparisons[0].function_name, "foo");
+  EXPECT_EQ(comparisons[0].module_build_id, kModuleBuildId);
+  EXPECT_EQ(comparisons[0].baseline_stats.count(), 10);
+  EXPECT_EQ(comparisons[0].comparison_stats.count(), 10);
+  EXPECT_EQ(comparisons[0].GetDurationPercentileDeltaNs(0.5), 100);
+  EXPECT_EQ(comparisons[0].GetDurationPercentileDeltaNs(0.99), 100);
+
+  EXPECT_EQ(comparisons[1].function_name, "qux");
+  EXPECT_EQ(comparisons[1].baseline_stats.count(), 0);
+  EXPECT_EQ(comparisons[1].comparison_stats.count(), 1);
+  EXPECT_EQ(comparisons[1].GetDurationPercentileDeltaNs(0.5), std::nullopt);
+}
+
+}  // namespace orbit_client_model
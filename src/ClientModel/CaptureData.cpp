@@ -8,14 +8,18 @@
 
 #include <algorithm>
 #include <memory>
+#include <numeric>
 #include <outcome.hpp>
 #include <vector>
 
+#include "ClientData/FunctionStatsUtils.h"
 #include "ClientData/FunctionUtils.h"
 #include "ClientData/ModuleData.h"
 
 using orbit_client_data::CallstackData;
+using orbit_client_data::ModuleAddressIndex;
 using orbit_client_data::ModuleData;
+using orbit_client_data::ModuleInMemory;
 using orbit_client_data::TracepointData;
 
 using orbit_client_protos::FunctionInfo;
@@ -36,8 +40,12 @@ CaptureData::CaptureData(orbit_client_data::ModuleManager* module_manager,
     : module_manager_{module_manager},
       callstack_data_(std::make_unique<CallstackData>()),
       selection_callstack_data_(std::make_unique<CallstackData>()),
+      off_cpu_callstack_data_(std::make_unique<CallstackData>()),
+      memory_callstack_data_(std::make_unique<CallstackData>()),
       tracepoint_data_(std::make_unique<TracepointData>()),
       frame_track_function_ids_{std::move(frame_track_function_ids)},
+      additional_pids_{capture_started.capture_options().additional_pids().begin(),
+                       capture_started.capture_options().additional_pids().end()},
       file_path_{std::move(file_path)} {
   ProcessInfo process_info;
   process_info.set_pid(capture_started.process_id());
@@ -56,27 +64,30 @@ CaptureData::CaptureData(orbit_client_data::ModuleManager* module_manager,
   }
 }
 
+CaptureData::ThreadStateSliceIndex* CaptureData::FindThreadStateSlices(int32_t tid) const {
+  absl::ReaderMutexLock lock{&thread_state_slices_mutex_};
+  auto it = thread_state_slices_.find(tid);
+  return it != thread_state_slices_.end() ? it->second.get() : nullptr;
+}
+
+void CaptureData::AddThreadStateSlice(ThreadStateSliceInfo state_slice) {
+  const int32_t tid = state_slice.tid();
+  ThreadStateSliceIndex* slices = FindThreadStateSlices(tid);
+  if (slices == nullptr) {
+    absl::MutexLock lock{&thread_state_slices_mutex_};
+    std::unique_ptr<ThreadStateSliceIndex>& tid_slices = thread_state_slices_[tid];
+    if (tid_slices == nullptr) tid_slices = std::make_unique<ThreadStateSliceIndex>();
+    slices = tid_slices.get();
+  }
+  slices->Append(std::move(state_slice));
+}
+
 void CaptureData::ForEachThreadStateSliceIntersectingTimeRange(
     int32_t thread_id, uint64_t min_timestamp, uint64_t max_timestamp,
     const std::function<void(const ThreadStateSliceInfo&)>& action) const {
-  absl::MutexLock lock{thread_state_slices_mutex_.get()};
-  auto tid_thread_state_slices_it = thread_state_slices_.find(thread_id);
-  if (tid_thread_state_slices_it == thread_state_slices_.end()) {
-    return;
-  }
-
-  const std::vector<ThreadStateSliceInfo>& tid_thread_state_slices =
-      tid_thread_state_slices_it->second;
-  auto slice_it = std::lower_bound(tid_thread_state_slices.begin(), tid_thread_state_slices.end(),
-                                   min_timestamp,
-                                   [](const ThreadStateSliceInfo& slice, uint64_t min_timestamp) {
-                                     return slice.end_timestamp_ns() < min_timestamp;
-                                   });
-  while (slice_it != tid_thread_state_slices.end() &&
-         slice_it->begin_timestamp_ns() < max_timestamp) {
-    action(*slice_it);
-    ++slice_it;
-  }
+  const ThreadStateSliceIndex* slices = FindThreadStateSlices(thread_id);
+  if (slices == nullptr) return;
+  slices->ForEachIntervalIntersectingTimeRange(min_timestamp, max_timestamp, action);
 }
 
 const FunctionStats& CaptureData::GetFunctionStatsOrDefault(
@@ -90,18 +101,13 @@ const FunctionStats& CaptureData::GetFunctionStatsOrDefault(
 }
 
 void CaptureData::UpdateFunctionStats(uint64_t instrumented_function_id, uint64_t elapsed_nanos) {
-  FunctionStats& stats = functions_stats_[instrumented_function_id];
-  stats.set_count(stats.count() + 1);
-  stats.set_total_time_ns(stats.total_time_ns() + elapsed_nanos);
-  stats.set_average_time_ns(stats.total_time_ns() / stats.count());
-
-  if (elapsed_nanos > stats.max_ns()) {
-    stats.set_max_ns(elapsed_nanos);
-  }
+  orbit_client_data::AddFunctionCallToStats(elapsed_nanos,
+                                            &functions_stats_[instrumented_function_id]);
+}
 
-  if (stats.min_ns() == 0 || elapsed_nanos < stats.min_ns()) {
-    stats.set_min_ns(elapsed_nanos);
-  }
+void CaptureData::MergeFunctionStats(uint64_t instrumented_function_id,
+                                     const orbit_client_protos::FunctionStats& stats) {
+  orbit_client_data::MergeFunctionStats(stats, &functions_stats_[instrumented_function_id]);
 }
 
 const InstrumentedFunction* CaptureData::GetInstrumentedFunctionById(uint64_t function_id) const {
@@ -183,6 +189,66 @@ std::optional<uint64_t> CaptureData::FindFunctionAbsoluteAddressByInstructionAbs
   return FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddressInfo(absolute_address);
 }
 
+std::vector<std::optional<uint64_t>>
+CaptureData::FindFunctionAbsoluteAddressesByInstructionAbsoluteAddresses(
+    absl::Span<const uint64_t> absolute_addresses) const {
+  std::vector<std::optional<uint64_t>> results(absolute_addresses.size());
+
+  // In the order of the addresses, the addresses of a module are consecutive.
+  std::vector<size_t> sorted_indices(absolute_addresses.size());
+  std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+  std::sort(sorted_indices.begin(), sorted_indices.end(),
+            [&absolute_addresses](size_t a, size_t b) {
+              return absolute_addresses[a] < absolute_addresses[b];
+            });
+
+  const std::shared_ptr<const ModuleAddressIndex> module_address_index =
+      process_.GetModuleAddressIndex();
+  std::vector<uint64_t> offsets;
+  size_t begin = 0;
+  while (begin < sorted_indices.size()) {
+    const ModuleInMemory* module_in_memory_or_null =
+        module_address_index->Find(absolute_addresses[sorted_indices[begin]]);
+    if (module_in_memory_or_null == nullptr) {
+      ++begin;
+      continue;
+    }
+    const ModuleInMemory& module_in_memory = *module_in_memory_or_null;
+    size_t end = begin + 1;
+    while (end < sorted_indices.size() &&
+           absolute_addresses[sorted_indices[end]] < module_in_memory.end()) {
+      ++end;
+    }
+
+    const ModuleData* module = module_manager_->GetModuleByPathAndBuildId(
+        module_in_memory.file_path(), module_in_memory.build_id());
+    if (module != nullptr) {
+      const uint64_t module_base_address = module_in_memory.start();
+      offsets.clear();
+      for (size_t i = begin; i < end; ++i) {
+        offsets.push_back(absolute_addresses[sorted_indices[i]] - module_base_address +
+                          module->executable_segment_offset());
+      }
+      const std::vector<const FunctionInfo*> functions =
+          module->FindFunctionsByOffsets(offsets, false);
+      for (size_t i = begin; i < end; ++i) {
+        const FunctionInfo* function_info = functions[i - begin];
+        if (function_info == nullptr) continue;
+        results[sorted_indices[i]] = module_base_address - module->load_bias() -
+                                     module->executable_segment_offset() + function_info->address();
+      }
+    }
+    begin = end;
+  }
+
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    if (results[i].has_value()) continue;
+    results[i] = FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddressInfo(
+        absolute_addresses[i]);
+  }
+  return results;
+}
+
 std::optional<uint64_t>
 CaptureData::FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddressInfo(
     uint64_t absolute_address) const {
@@ -195,11 +261,13 @@ CaptureData::FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddress
 std::optional<uint64_t>
 CaptureData::FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingModulesInMemory(
     uint64_t absolute_address) const {
-  const auto module_or_error = process_.FindModuleByAddress(absolute_address);
-  if (module_or_error.has_error()) return std::nullopt;
-  const std::string& module_path = module_or_error.value().file_path();
-  const std::string& module_build_id = module_or_error.value().build_id();
-  const uint64_t module_base_address = module_or_error.value().start();
+  const std::shared_ptr<const ModuleAddressIndex> module_address_index =
+      process_.GetModuleAddressIndex();
+  const ModuleInMemory* module_in_memory = module_address_index->Find(absolute_address);
+  if (module_in_memory == nullptr) return std::nullopt;
+  const std::string& module_path = module_in_memory->file_path();
+  const std::string& module_build_id = module_in_memory->build_id();
+  const uint64_t module_base_address = module_in_memory->start();
 
   const ModuleData* module =
       module_manager_->GetModuleByPathAndBuildId(module_path, module_build_id);
@@ -254,12 +322,13 @@ const std::string& CaptureData::GetModulePathByAddress(uint64_t absolute_address
 
 const FunctionInfo* CaptureData::FindFunctionByAddress(uint64_t absolute_address,
                                                        bool is_exact) const {
-  const auto module_or_error = process_.FindModuleByAddress(absolute_address);
-  if (module_or_error.has_error()) return nullptr;
-  const auto& module_in_memory = module_or_error.value();
-  const std::string& module_path = module_in_memory.file_path();
-  const std::string& module_build_id = module_in_memory.build_id();
-  const uint64_t module_base_address = module_in_memory.start();
+  const std::shared_ptr<const ModuleAddressIndex> module_address_index =
+      process_.GetModuleAddressIndex();
+  const ModuleInMemory* module_in_memory = module_address_index->Find(absolute_address);
+  if (module_in_memory == nullptr) return nullptr;
+  const std::string& module_path = module_in_memory->file_path();
+  const std::string& module_build_id = module_in_memory->build_id();
+  const uint64_t module_base_address = module_in_memory->start();
 
   const ModuleData* module =
       module_manager_->GetModuleByPathAndBuildId(module_path, module_build_id);
@@ -271,10 +340,12 @@ const FunctionInfo* CaptureData::FindFunctionByAddress(uint64_t absolute_address
 }
 
 [[nodiscard]] ModuleData* CaptureData::FindModuleByAddress(uint64_t absolute_address) const {
-  const auto result = process_.FindModuleByAddress(absolute_address);
-  if (result.has_error()) return nullptr;
-  return module_manager_->GetMutableModuleByPathAndBuildId(result.value().file_path(),
-                                                           result.value().build_id());
+  const std::shared_ptr<const ModuleAddressIndex> module_address_index =
+      process_.GetModuleAddressIndex();
+  const ModuleInMemory* module_in_memory = module_address_index->Find(absolute_address);
+  if (module_in_memory == nullptr) return nullptr;
+  return module_manager_->GetMutableModuleByPathAndBuildId(module_in_memory->file_path(),
+                                                           module_in_memory->build_id());
 }
 
 int32_t CaptureData::process_id() const { return process_.pid(); }
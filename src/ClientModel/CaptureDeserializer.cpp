@@ -175,7 +175,8 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCaptureInfo(
   for (const auto& function : capture_info.instrumented_functions()) {
     orbit_grpc_protos::InstrumentedFunction instrumented_function;
     instrumented_function.set_function_id(function.first);
-    instrumented_function.set_function_name(function.second.pretty_name());
+    instrumented_function.set_function_name(
+        orbit_client_data::function_utils::GetDisplayName(function.second));
     instrumented_function.set_file_path(function.second.module_path());
     ModuleData* module_data = module_manager->GetMutableModuleByPathAndBuildId(
         function.second.module_path(), function.second.module_build_id());
@@ -74,10 +74,13 @@ class MockCaptureListener : public CaptureListener {
   MOCK_METHOD(void, OnUniqueCallstack, (uint64_t /*callstack_id*/, CallstackInfo /*callstack*/),
               (override));
   MOCK_METHOD(void, OnCallstackEvent, (CallstackEvent /*callstack_event*/), (override));
-  MOCK_METHOD(void, OnModuleUpdate, (uint64_t /*timestamp_ns*/, ModuleInfo /*module_info*/),
+  MOCK_METHOD(void, OnModuleUpdate,
+              (int32_t /*pid*/, uint64_t /*timestamp_ns*/, ModuleInfo /*module_info*/),
               (override));
   MOCK_METHOD(void, OnModulesSnapshot,
-              (uint64_t /*timestamp_ns*/, std::vector<ModuleInfo> /*module_infos*/), (override));
+              (int32_t /*pid*/, uint64_t /*timestamp_ns*/,
+               std::vector<ModuleInfo> /*module_infos*/),
+              (override));
   MOCK_METHOD(void, OnThreadName, (int32_t /*thread_id*/, std::string /*thread_name*/), (override));
   MOCK_METHOD(void, OnThreadStateSlice, (ThreadStateSliceInfo), (override));
   MOCK_METHOD(void, OnAddressInfo, (LinuxAddressInfo), (override));
@@ -88,6 +91,9 @@ class MockCaptureListener : public CaptureListener {
               (override));
   MOCK_METHOD(void, OnClockResolutionEvent,
               (orbit_grpc_protos::ClockResolutionEvent /*clock_resolution_event*/), (override));
+  MOCK_METHOD(void, OnCaptureStartLatencyEvent,
+              (orbit_grpc_protos::CaptureStartLatencyEvent /*capture_start_latency_event*/),
+              (override));
   MOCK_METHOD(
       void, OnErrorsWithPerfEventOpenEvent,
       (orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/),
@@ -101,6 +107,14 @@ class MockCaptureListener : public CaptureListener {
       void, OnOutOfOrderEventsDiscardedEvent,
       (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent /*out_of_order_events_discarded_event*/),
       (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent,
+              (orbit_grpc_protos::SamplingPeriodChangedEvent /*sampling_period_changed_event*/),
+              (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe,
+              (orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/), (override));
+  MOCK_METHOD(void, OnFunctionStats,
+              (uint64_t /*function_id*/, orbit_client_protos::FunctionStats /*stats*/),
+              (override));
 };
 
 TEST(CaptureDeserializer, LoadFileNotExists) {
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientModel/CriticalPath.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "capture_data.pb.h"
+
+using orbit_client_protos::ThreadStateSliceInfo;
+
+namespace orbit_client_model {
+
+namespace {
+
+// Guards against long chains of wakeups, e.g., of threads that keep waking each other up.
+constexpr size_t kMaxSegmentCount = 10'000;
+
+// Returns the wakeup of `thread_id` by another thread with known thread states that is the latest
+// one in (begin_timestamp_ns, end_timestamp_ns), if any, as the slice that the wakeup ended.
+[[nodiscard]] std::optional<ThreadStateSliceInfo> FindLatestWakeupByOtherThread(
+    const CaptureData& capture_data, int32_t thread_id, uint64_t begin_timestamp_ns,
+    uint64_t end_timestamp_ns) {
+  std::optional<ThreadStateSliceInfo> latest_wakeup;
+  capture_data.ForEachThreadStateSliceIntersectingTimeRange(
+      thread_id, begin_timestamp_ns, end_timestamp_ns,
+      [&](const ThreadStateSliceInfo& slice) {
+        if (slice.end_timestamp_ns() <= begin_timestamp_ns ||
+            slice.end_timestamp_ns() >= end_timestamp_ns) {
+          return;
+        }
+        if (slice.wakeup_reason() != ThreadStateSliceInfo::kUnblocked ||
+            slice.wakeup_tid() == thread_id ||
+            !capture_data.HasThreadStatesForThread(slice.wakeup_tid())) {
+          return;
+        }
+        // Slices are visited in order.
+        latest_wakeup = slice;
+      });
+  return latest_wakeup;
+}
+
+}  // namespace
+
+std::vector<CriticalPathSegment> ComputeCriticalPath(const CaptureData& capture_data,
+                                                     int32_t thread_id, uint64_t begin_timestamp_ns,
+                                                     uint64_t end_timestamp_ns) {
+  std::vector<CriticalPathSegment> segments;
+  int32_t current_thread_id = thread_id;
+  uint64_t current_end_timestamp_ns = end_timestamp_ns;
+  // The wakeups found are strictly earlier each time, so this terminates.
+  while (current_end_timestamp_ns > begin_timestamp_ns && segments.size() < kMaxSegmentCount) {
+    std::optional<ThreadStateSliceInfo> wakeup = FindLatestWakeupByOtherThread(
+        capture_data, current_thread_id, begin_timestamp_ns, current_end_timestamp_ns);
+    if (!wakeup.has_value()) {
+      segments.push_back({current_thread_id, begin_timestamp_ns, current_end_timestamp_ns});
+      break;
+    }
+    segments.push_back(
+        {current_thread_id, wakeup->end_timestamp_ns(), current_end_timestamp_ns});
+    current_thread_id = wakeup->wakeup_tid();
+    current_end_timestamp_ns = wakeup->end_timestamp_ns();
+  }
+  std::reverse(segments.begin(), segments.end());
+  return segments;
+}
+
+}  // namespace orbit_client_model
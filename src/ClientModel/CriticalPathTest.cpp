@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ClientModel/CaptureData.h"
+#include "ClientModel/CriticalPath.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::ThreadStateSliceInfo;
+using orbit_grpc_protos::CaptureStarted;
+using testing::ElementsAre;
+
+namespace orbit_client_model {
+
+namespace {
+
+constexpr int32_t kMainThreadId = 1;
+constexpr int32_t kWorkerThreadId = 2;
+constexpr int32_t kProducerThreadId = 3;
+constexpr int32_t kBusyThreadId = 4;
+constexpr int32_t kIdleTaskThreadId = 0;
+
+void AddSlice(CaptureData* capture_data, int32_t tid, ThreadStateSliceInfo::ThreadState state,
+              uint64_t begin_timestamp_ns, uint64_t end_timestamp_ns,
+              std::optional<int32_t> wakeup_tid = std::nullopt) {
+  ThreadStateSliceInfo slice;
+  slice.set_tid(tid);
+  slice.set_thread_state(state);
+  slice.set_begin_timestamp_ns(begin_timestamp_ns);
+  slice.set_end_timestamp_ns(end_timestamp_ns);
+  if (wakeup_tid.has_value()) {
+    slice.set_wakeup_reason(ThreadStateSliceInfo::kUnblocked);
+    slice.set_wakeup_tid(wakeup_tid.value());
+  }
+  capture_data->AddThreadStateSlice(std::move(slice));
+}
+
+// The main thread waits on the worker thread, which waits on the producer thread, while another
+// thread is busy all along.
+void AddWaitChain(CaptureData* capture_data) {
+  AddSlice(capture_data, kMainThreadId, ThreadStateSliceInfo::kRunning, 0, 100);
+  AddSlice(capture_data, kMainThreadId, ThreadStateSliceInfo::kInterruptibleSleep, 100, 800,
+           kWorkerThreadId);
+  AddSlice(capture_data, kMainThreadId, ThreadStateSliceInfo::kRunning, 800, 1000);
+
+  AddSlice(capture_data, kWorkerThreadId, ThreadStateSliceInfo::kInterruptibleSleep, 0, 300,
+           kProducerThreadId);
+  AddSlice(capture_data, kWorkerThreadId, ThreadStateSliceInfo::kRunnable, 300, 350);
+  AddSlice(capture_data, kWorkerThreadId, ThreadStateSliceInfo::kRunning, 350, 1000);
+
+  AddSlice(capture_data, kProducerThreadId, ThreadStateSliceInfo::kRunning, 0, 1000);
+  AddSlice(capture_data, kBusyThreadId, ThreadStateSliceInfo::kRunning, 0, 1000);
+}
+
+}  // namespace
+
+TEST(CriticalPath, FollowsWakeupsAcrossThreads) {
+  CaptureData capture_data{nullptr, CaptureStarted{}, std::nullopt, {}};
+  AddWaitChain(&capture_data);
+
+  EXPECT_THAT(ComputeCriticalPath(capture_data, kMainThreadId, 0, 1000),
+              ElementsAre(CriticalPathSegment{kProducerThreadId, 0, 300},
+                          CriticalPathSegment{kWorkerThreadId, 300, 800},
+                          CriticalPathSegment{kMainThreadId, 800, 1000}));
+}
+
+TEST(CriticalPath, StopsAtBeginTimestamp) {
+  CaptureData capture_data{nullptr, CaptureStarted{}, std::nullopt, {}};
+  AddWaitChain(&capture_data);
+
+  EXPECT_THAT(ComputeCriticalPath(capture_data, kMainThreadId, 500, 1000),
+              ElementsAre(CriticalPathSegment{kWorkerThreadId, 500, 800},
+                          CriticalPathSegment{kMainThreadId, 800, 1000}));
+  EXPECT_THAT(ComputeCriticalPath(capture_data, kMainThreadId, 850, 900),
+              ElementsAre(CriticalPathSegment{kMainThreadId, 850, 900}));
+}
+
+TEST(CriticalPath, KeepsBlockingWithoutWakeupByKnownThreadOnThread) {
+  CaptureData capture_data{nullptr, CaptureStarted{}, std::nullopt, {}};
+  AddSlice(&capture_data, kMainThreadId, ThreadStateSliceInfo::kRunning, 0, 100);
+  AddSlice(&capture_data, kMainThreadId, ThreadStateSliceInfo::kInterruptibleSleep, 100, 300,
+           kIdleTaskThreadId);
+  AddSlice(&capture_data, kMainThreadId, ThreadStateSliceInfo::kRunning, 300, 400);
+  // The waking thread has no thread states, e.g., because it belongs to another process.
+  AddSlice(&capture_data, kMainThreadId, ThreadStateSliceInfo::kUninterruptibleSleep, 400, 600,
+           42);
+  AddSlice(&capture_data, kMainThreadId, ThreadStateSliceInfo::kRunning, 600, 1000);
+
+  EXPECT_THAT(ComputeCriticalPath(capture_data, kMainThreadId, 0, 1000),
+              ElementsAre(CriticalPathSegment{kMainThreadId, 0, 1000}));
+}
+
+TEST(CriticalPath, IsEmptyForEmptyTimeRange) {
+  CaptureData capture_data{nullptr, CaptureStarted{}, std::nullopt, {}};
+  AddWaitChain(&capture_data);
+
+  EXPECT_TRUE(ComputeCriticalPath(capture_data, kMainThreadId, 1000, 1000).empty());
+}
+
+}  // namespace orbit_client_model
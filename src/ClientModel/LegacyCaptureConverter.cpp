@@ -0,0 +1,462 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientModel/LegacyCaptureConverter.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/map.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CaptureClient/CaptureListener.h"
+#include "CaptureFile/CaptureFileHelpers.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "ClientData/ModuleManager.h"
+#include "ClientModel/CaptureDeserializer.h"
+#include "GrpcProtos/Constants.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/JoinFutures.h"
+#include "OrbitBase/Logging.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+#include "module.pb.h"
+
+namespace orbit_client_model::legacy_capture_converter {
+
+namespace {
+
+using orbit_capture_client::CaptureListener;
+using orbit_capture_file::CaptureFileOutputStream;
+using orbit_client_protos::CaptureHeader;
+using orbit_client_protos::CaptureInfo;
+using orbit_client_protos::TimerInfo;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+// Writes the events that the legacy capture is loaded as, which LoadCaptureInfo passes to a
+// CaptureListener, to a capture file as the ClientCaptureEvents they would have been created from.
+// After an error writing the file, which the output stream has then already removed, nothing more
+// is written.
+class CaptureFileWritingListener : public CaptureListener {
+ public:
+  explicit CaptureFileWritingListener(
+      CaptureFileOutputStream* output_stream, const CaptureInfo& capture_info,
+      const google::protobuf::Map<uint64_t, std::string>* legacy_string_keys)
+      : output_stream_{output_stream},
+        capture_info_{capture_info},
+        legacy_string_keys_{legacy_string_keys} {}
+
+  [[nodiscard]] const std::optional<ErrorMessage>& GetError() const { return error_; }
+  [[nodiscard]] uint64_t GetSkippedTimerCount() const { return skipped_timer_count_; }
+
+  void OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture_started,
+                        std::optional<std::filesystem::path> /*file_path*/,
+                        absl::flat_hash_set<uint64_t> /*frame_track_function_ids*/) override {
+    ClientCaptureEvent event;
+    *event.mutable_capture_started() = capture_started;
+    Write(event);
+
+    // The legacy format only has the modules loaded at the end of the capture.
+    ClientCaptureEvent modules_snapshot_event;
+    orbit_grpc_protos::ModulesSnapshot* modules_snapshot =
+        modules_snapshot_event.mutable_modules_snapshot();
+    modules_snapshot->set_pid(capture_info_.process().pid());
+    for (const orbit_client_protos::ModuleInfo& module : capture_info_.modules()) {
+      orbit_grpc_protos::ModuleInfo* module_info = modules_snapshot->add_modules();
+      module_info->set_name(module.name());
+      module_info->set_file_path(module.file_path());
+      module_info->set_file_size(module.file_size());
+      module_info->set_address_start(module.address_start());
+      module_info->set_address_end(module.address_end());
+      module_info->set_build_id(module.build_id());
+      module_info->set_load_bias(module.load_bias());
+    }
+    Write(modules_snapshot_event);
+  }
+
+  void OnCaptureFinished(const orbit_grpc_protos::CaptureFinished& capture_finished) override {
+    ClientCaptureEvent event;
+    *event.mutable_capture_finished() = capture_finished;
+    Write(event);
+  }
+
+  void OnTimer(const TimerInfo& timer_info) override {
+    ClientCaptureEvent event;
+    const uint64_t duration_ns = timer_info.end() - timer_info.start();
+    switch (timer_info.type()) {
+      case TimerInfo::kNone: {
+        if (timer_info.function_id() == orbit_grpc_protos::kInvalidFunctionId) break;
+        orbit_grpc_protos::FunctionCall* function_call = event.mutable_function_call();
+        function_call->set_pid(timer_info.process_id());
+        function_call->set_tid(timer_info.thread_id());
+        function_call->set_function_id(timer_info.function_id());
+        function_call->set_duration_ns(duration_ns);
+        function_call->set_end_timestamp_ns(timer_info.end());
+        function_call->set_depth(static_cast<int32_t>(timer_info.depth()));
+        function_call->set_return_value(timer_info.user_data_key());
+        *function_call->mutable_registers() = timer_info.registers();
+        break;
+      }
+      case TimerInfo::kCoreActivity: {
+        orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+        scheduling_slice->set_pid(timer_info.process_id());
+        scheduling_slice->set_tid(timer_info.thread_id());
+        scheduling_slice->set_core(timer_info.processor());
+        scheduling_slice->set_duration_ns(duration_ns);
+        scheduling_slice->set_out_timestamp_ns(timer_info.end());
+        break;
+      }
+      case TimerInfo::kIntrospection: {
+        orbit_grpc_protos::IntrospectionScope* introspection_scope =
+            event.mutable_introspection_scope();
+        introspection_scope->set_pid(timer_info.process_id());
+        introspection_scope->set_tid(timer_info.thread_id());
+        introspection_scope->set_duration_ns(duration_ns);
+        introspection_scope->set_end_timestamp_ns(timer_info.end());
+        introspection_scope->set_depth(static_cast<int32_t>(timer_info.depth()));
+        *introspection_scope->mutable_registers() = timer_info.registers();
+        break;
+      }
+      default:
+        break;
+    }
+
+    if (event.event_case() == ClientCaptureEvent::EVENT_NOT_SET) {
+      ++skipped_timer_count_;
+      return;
+    }
+    Write(event);
+  }
+
+  void OnKeyAndString(uint64_t key, std::string str) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::InternedString* interned_string = event.mutable_interned_string();
+    interned_string->set_key(key);
+    interned_string->set_intern(std::move(str));
+    Write(event);
+  }
+
+  void OnUniqueCallstack(uint64_t callstack_id,
+                         orbit_client_protos::CallstackInfo callstack) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::InternedCallstack* interned_callstack = event.mutable_interned_callstack();
+    interned_callstack->set_key(callstack_id);
+    orbit_grpc_protos::Callstack* intern = interned_callstack->mutable_intern();
+    *intern->mutable_pcs() = std::move(*callstack.mutable_frames());
+    // The types that the client adds, like kFilteredByMajorityOutermostFrame, are computed again
+    // when the capture is loaded.
+    if (orbit_grpc_protos::Callstack::CallstackType_IsValid(callstack.type())) {
+      intern->set_type(static_cast<orbit_grpc_protos::Callstack::CallstackType>(callstack.type()));
+    }
+    Write(event);
+  }
+
+  void OnCallstackEvent(orbit_client_protos::CallstackEvent callstack_event) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::CallstackSample* callstack_sample = event.mutable_callstack_sample();
+    callstack_sample->set_pid(capture_info_.process().pid());
+    callstack_sample->set_tid(callstack_event.thread_id());
+    callstack_sample->set_callstack_id(callstack_event.callstack_id());
+    callstack_sample->set_timestamp_ns(callstack_event.time());
+    callstack_sample->set_off_cpu_duration_ns(callstack_event.off_cpu_duration_ns());
+    callstack_sample->set_memory_event_type(
+        static_cast<orbit_grpc_protos::CallstackSample::MemoryEventType>(
+            callstack_event.memory_event_type()));
+    callstack_sample->set_memory_event_count(callstack_event.memory_event_count());
+    Write(event);
+  }
+
+  void OnThreadName(int32_t thread_id, std::string thread_name) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::ThreadName* thread_name_event = event.mutable_thread_name();
+    thread_name_event->set_pid(capture_info_.process().pid());
+    thread_name_event->set_tid(thread_id);
+    thread_name_event->set_name(std::move(thread_name));
+    Write(event);
+  }
+
+  void OnModuleUpdate(int32_t pid, uint64_t timestamp_ns,
+                      orbit_grpc_protos::ModuleInfo module_info) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::ModuleUpdateEvent* module_update = event.mutable_module_update_event();
+    module_update->set_pid(pid);
+    module_update->set_timestamp_ns(timestamp_ns);
+    *module_update->mutable_module() = std::move(module_info);
+    Write(event);
+  }
+
+  void OnModulesSnapshot(int32_t pid, uint64_t timestamp_ns,
+                         std::vector<orbit_grpc_protos::ModuleInfo> module_infos) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::ModulesSnapshot* modules_snapshot = event.mutable_modules_snapshot();
+    modules_snapshot->set_pid(pid);
+    modules_snapshot->set_timestamp_ns(timestamp_ns);
+    for (orbit_grpc_protos::ModuleInfo& module_info : module_infos) {
+      *modules_snapshot->add_modules() = std::move(module_info);
+    }
+    Write(event);
+  }
+
+  void OnThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo thread_state_slice) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::ThreadStateSlice* slice = event.mutable_thread_state_slice();
+    slice->set_tid(thread_state_slice.tid());
+    slice->set_thread_state(static_cast<orbit_grpc_protos::ThreadStateSlice::ThreadState>(
+        thread_state_slice.thread_state()));
+    slice->set_duration_ns(thread_state_slice.end_timestamp_ns() -
+                           thread_state_slice.begin_timestamp_ns());
+    slice->set_end_timestamp_ns(thread_state_slice.end_timestamp_ns());
+    slice->set_wakeup_reason(static_cast<orbit_grpc_protos::ThreadStateSlice::WakeupReason>(
+        thread_state_slice.wakeup_reason()));
+    slice->set_wakeup_tid(thread_state_slice.wakeup_tid());
+    slice->set_wakeup_pid(thread_state_slice.wakeup_pid());
+    Write(event);
+  }
+
+  void OnAddressInfo(orbit_client_protos::LinuxAddressInfo address_info) override {
+    // The strings need to be interned before the AddressInfo that references them.
+    const uint64_t function_name_key = InternString(address_info.function_name());
+    const uint64_t module_name_key = InternString(address_info.module_path());
+
+    ClientCaptureEvent event;
+    orbit_grpc_protos::AddressInfo* address_info_event = event.mutable_address_info();
+    address_info_event->set_absolute_address(address_info.absolute_address());
+    address_info_event->set_offset_in_function(address_info.offset_in_function());
+    address_info_event->set_function_name_key(function_name_key);
+    address_info_event->set_module_name_key(module_name_key);
+    Write(event);
+  }
+
+  void OnUniqueTracepointInfo(uint64_t key,
+                              orbit_grpc_protos::TracepointInfo tracepoint_info) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::InternedTracepointInfo* interned_tracepoint_info =
+        event.mutable_interned_tracepoint_info();
+    interned_tracepoint_info->set_key(key);
+    *interned_tracepoint_info->mutable_intern() = std::move(tracepoint_info);
+    Write(event);
+  }
+
+  void OnTracepointEvent(orbit_client_protos::TracepointEventInfo tracepoint_event_info) override {
+    ClientCaptureEvent event;
+    orbit_grpc_protos::TracepointEvent* tracepoint_event = event.mutable_tracepoint_event();
+    tracepoint_event->set_pid(tracepoint_event_info.pid());
+    tracepoint_event->set_tid(tracepoint_event_info.tid());
+    tracepoint_event->set_timestamp_ns(static_cast<uint64_t>(tracepoint_event_info.time()));
+    tracepoint_event->set_cpu(tracepoint_event_info.cpu());
+    tracepoint_event->set_tracepoint_info_key(tracepoint_event_info.tracepoint_info_key());
+    *tracepoint_event->mutable_field_values() =
+        std::move(*tracepoint_event_info.mutable_field_values());
+    Write(event);
+  }
+
+  // The legacy format has none of the following events, which are written as is in case it ever
+  // does.
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_warning_event() = std::move(warning_event);
+    Write(event);
+  }
+  void OnClockResolutionEvent(
+      orbit_grpc_protos::ClockResolutionEvent clock_resolution_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_clock_resolution_event() = std::move(clock_resolution_event);
+    Write(event);
+  }
+  void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent capture_start_latency_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_capture_start_latency_event() = std::move(capture_start_latency_event);
+    Write(event);
+  }
+  void OnErrorsWithPerfEventOpenEvent(
+      orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_errors_with_perf_event_open_event() =
+        std::move(errors_with_perf_event_open_event);
+    Write(event);
+  }
+  void OnErrorEnablingOrbitApiEvent(
+      orbit_grpc_protos::ErrorEnablingOrbitApiEvent error_enabling_orbit_api_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_error_enabling_orbit_api_event() = std::move(error_enabling_orbit_api_event);
+    Write(event);
+  }
+  void OnLostPerfRecordsEvent(
+      orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_lost_perf_records_event() = std::move(lost_perf_records_event);
+    Write(event);
+  }
+  void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
+                                            out_of_order_events_discarded_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_out_of_order_events_discarded_event() =
+        std::move(out_of_order_events_discarded_event);
+    Write(event);
+  }
+  void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) override {
+    ClientCaptureEvent event;
+    *event.mutable_sampling_period_changed_event() = std::move(sampling_period_changed_event);
+    Write(event);
+  }
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) override {
+    ClientCaptureEvent event;
+    *event.mutable_pipeline_latency_probe() = std::move(pipeline_latency_probe);
+    Write(event);
+  }
+  // These statistics are only ever computed from the function calls.
+  void OnFunctionStats(uint64_t /*function_id*/,
+                       orbit_client_protos::FunctionStats /*stats*/) override {}
+
+ private:
+  void Write(const ClientCaptureEvent& event) {
+    if (error_.has_value()) return;
+    ErrorMessageOr<void> result = output_stream_->WriteCaptureEvent(event);
+    if (result.has_error()) error_ = result.error();
+  }
+
+  // Returns the key of `str`, writing an InternedString for it the first time. The keys don't
+  // collide with those of the strings the legacy capture interned itself.
+  uint64_t InternString(const std::string& str) {
+    auto it = string_keys_.find(str);
+    if (it != string_keys_.end()) return it->second;
+
+    do {
+      ++last_string_key_;
+    } while (legacy_string_keys_->count(last_string_key_) != 0);
+    string_keys_.emplace(str, last_string_key_);
+    OnKeyAndString(last_string_key_, str);
+    return last_string_key_;
+  }
+
+  CaptureFileOutputStream* output_stream_;
+  const CaptureInfo& capture_info_;
+  const google::protobuf::Map<uint64_t, std::string>* legacy_string_keys_;
+  absl::flat_hash_map<std::string, uint64_t> string_keys_;
+  uint64_t last_string_key_ = 0;
+  uint64_t skipped_timer_count_ = 0;
+  std::optional<ErrorMessage> error_;
+};
+
+[[nodiscard]] ErrorMessageOr<CaptureInfo> ReadCaptureInfo(
+    const std::filesystem::path& legacy_file_path,
+    google::protobuf::io::CodedInputStream* coded_input) {
+  CaptureHeader header;
+  if (!capture_deserializer::internal::ReadMessage(&header, coded_input) ||
+      header.version().empty()) {
+    return ErrorMessage{
+        absl::StrFormat("Error parsing the capture from \"%s\"", legacy_file_path.string())};
+  }
+  if (header.version() != capture_deserializer::internal::kRequiredCaptureVersion) {
+    return ErrorMessage{absl::StrFormat(
+        "The format of capture \"%s\" is no longer supported but could be opened with Orbit "
+        "version %s.",
+        legacy_file_path.string(), header.version())};
+  }
+
+  CaptureInfo capture_info;
+  if (!capture_deserializer::internal::ReadMessage(&capture_info, coded_input)) {
+    return ErrorMessage{
+        absl::StrFormat("Error parsing the capture from \"%s\"", legacy_file_path.string())};
+  }
+  return capture_info;
+}
+
+void TryRemoveFile(const std::filesystem::path& file_path) {
+  ErrorMessageOr<bool> remove_result = orbit_base::RemoveFile(file_path);
+  if (remove_result.has_error()) {
+    ERROR("Unable to remove \"%s\": %s", file_path.string(), remove_result.error().message());
+  }
+}
+
+}  // namespace
+
+ErrorMessageOr<void> ConvertToCaptureFile(const std::filesystem::path& legacy_file_path,
+                                          const std::filesystem::path& capture_file_path,
+                                          std::atomic<bool>* cancellation_requested) {
+  SCOPED_TIMED_LOG("Converting legacy capture \"%s\" to \"%s\"", legacy_file_path.string(),
+                   capture_file_path.string());
+  std::atomic<bool> never_cancelled = false;
+  if (cancellation_requested == nullptr) cancellation_requested = &never_cancelled;
+
+  OUTCOME_TRY(fd, orbit_base::OpenFileForReading(legacy_file_path));
+  google::protobuf::io::FileInputStream input_stream{fd.get()};
+  google::protobuf::io::CodedInputStream coded_input{&input_stream};
+  OUTCOME_TRY(capture_info, ReadCaptureInfo(legacy_file_path, &coded_input));
+
+  OUTCOME_TRY(output_stream,
+              CaptureFileOutputStream::Create(
+                  capture_file_path,
+                  orbit_capture_file::CaptureSectionCompression::kCompressedBlocks));
+  CaptureFileWritingListener listener{output_stream.get(), capture_info,
+                                      &capture_info.key_to_string()};
+
+  // The modules and functions only need to be known while the CaptureStarted event is created.
+  orbit_client_data::ModuleManager module_manager;
+  ErrorMessageOr<CaptureListener::CaptureOutcome> outcome_or_error =
+      capture_deserializer::internal::LoadCaptureInfo(capture_info, &listener, &module_manager,
+                                                      &coded_input, cancellation_requested);
+  if (listener.GetError().has_value()) return listener.GetError().value();
+  if (outcome_or_error.has_error() ||
+      outcome_or_error.value() == CaptureListener::CaptureOutcome::kCancelled) {
+    (void)output_stream->Close();
+    TryRemoveFile(capture_file_path);
+    if (outcome_or_error.has_error()) return outcome_or_error.error();
+    return ErrorMessage{"The conversion was cancelled"};
+  }
+
+  orbit_grpc_protos::CaptureFinished capture_finished;
+  capture_finished.set_status(orbit_grpc_protos::CaptureFinished::kSuccessful);
+  listener.OnCaptureFinished(capture_finished);
+  if (listener.GetError().has_value()) return listener.GetError().value();
+  OUTCOME_TRY(output_stream->Close());
+
+  if (capture_info.user_defined_capture_info().frame_tracks_info().frame_track_function_ids_size() >
+      0) {
+    ErrorMessageOr<void> write_result = orbit_capture_file::WriteUserData(
+        capture_file_path, capture_info.user_defined_capture_info());
+    if (write_result.has_error()) {
+      TryRemoveFile(capture_file_path);
+      return write_result.error();
+    }
+  }
+
+  if (listener.GetSkippedTimerCount() > 0) {
+    LOG("Skipped %u timers of \"%s\" that are not created from the events of a capture file",
+        listener.GetSkippedTimerCount(), legacy_file_path.string());
+  }
+  return outcome::success();
+}
+
+std::vector<ErrorMessageOr<void>> ConvertToCaptureFiles(
+    absl::Span<const LegacyCaptureConversion> conversions, ThreadPool* thread_pool,
+    std::atomic<bool>* cancellation_requested) {
+  std::vector<ErrorMessageOr<void>> results(conversions.size(), outcome::success());
+  std::vector<orbit_base::Future<void>> futures;
+  futures.reserve(conversions.size());
+  for (size_t index = 0; index < conversions.size(); ++index) {
+    // Each action only writes its own result.
+    futures.emplace_back(thread_pool->Schedule(
+        [&conversion = conversions[index], result = &results[index], cancellation_requested] {
+          *result = ConvertToCaptureFile(conversion.legacy_file_path,
+                                         conversion.capture_file_path, cancellation_requested);
+        }));
+  }
+  orbit_base::JoinFutures(absl::MakeConstSpan(futures)).Wait();
+  return results;
+}
+
+}  // namespace orbit_client_model::legacy_capture_converter
@@ -0,0 +1,312 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/base/casts.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileHelpers.h"
+#include "ClientModel/CaptureDeserializer.h"
+#include "ClientModel/LegacyCaptureConverter.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitBase/WriteStringToFile.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+namespace orbit_client_model::legacy_capture_converter {
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+using orbit_client_protos::CaptureHeader;
+using orbit_client_protos::CaptureInfo;
+using orbit_client_protos::TimerInfo;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+constexpr int32_t kPid = 42;
+constexpr int32_t kTid = 43;
+constexpr uint64_t kFunctionId = 1;
+constexpr uint64_t kCallstackId = 7;
+// The key the converter would use first for the strings of the address infos.
+constexpr uint64_t kLegacyStringKey = 1;
+constexpr const char* kModulePath = "path/to/module";
+constexpr const char* kModuleBuildId = "build_id";
+
+void AppendMessage(const google::protobuf::Message& message, std::string* buffer) {
+  std::string serialized_message;
+  message.SerializeToString(&serialized_message);
+  const auto message_size = static_cast<uint32_t>(serialized_message.size());
+  buffer->append(absl::bit_cast<const char*>(&message_size), sizeof(message_size));
+  buffer->append(serialized_message);
+}
+
+[[nodiscard]] std::string CreateLegacyCapture() {
+  std::string buffer;
+  CaptureHeader header;
+  header.set_version(capture_deserializer::internal::kRequiredCaptureVersion);
+  AppendMessage(header, &buffer);
+
+  CaptureInfo capture_info;
+  capture_info.mutable_process()->set_pid(kPid);
+  capture_info.mutable_process()->set_full_path("path/to/executable");
+
+  orbit_client_protos::ModuleInfo* module_info = capture_info.add_modules();
+  module_info->set_name("module");
+  module_info->set_file_path(kModulePath);
+  module_info->set_build_id(kModuleBuildId);
+  module_info->set_address_start(0x1000);
+  module_info->set_address_end(0x2000);
+
+  orbit_client_protos::FunctionInfo function;
+  function.set_name("foo");
+  function.set_pretty_name("void foo()");
+  function.set_module_path(kModulePath);
+  function.set_module_build_id(kModuleBuildId);
+  function.set_address(0x1100);
+  function.set_size(12);
+  (*capture_info.mutable_instrumented_functions())[kFunctionId] = function;
+  capture_info.mutable_user_defined_capture_info()
+      ->mutable_frame_tracks_info()
+      ->add_frame_track_function_ids(kFunctionId);
+
+  (*capture_info.mutable_thread_names())[kTid] = "thread";
+  (*capture_info.mutable_key_to_string())[kLegacyStringKey] = "legacy string";
+
+  orbit_client_protos::LinuxAddressInfo* address_info = capture_info.add_address_infos();
+  address_info->set_absolute_address(0x1104);
+  address_info->set_module_path(kModulePath);
+  address_info->set_function_name("foo");
+  address_info->set_offset_in_function(4);
+
+  orbit_client_protos::CallstackInfo callstack;
+  callstack.add_frames(0x1104);
+  callstack.set_type(orbit_client_protos::CallstackInfo::kFilteredByMajorityOutermostFrame);
+  (*capture_info.mutable_callstacks())[kCallstackId] = callstack;
+  orbit_client_protos::CallstackEvent* callstack_event = capture_info.add_callstack_events();
+  callstack_event->set_time(150);
+  callstack_event->set_callstack_id(kCallstackId);
+  callstack_event->set_thread_id(kTid);
+  AppendMessage(capture_info, &buffer);
+
+  TimerInfo function_call;
+  function_call.set_start(100);
+  function_call.set_end(200);
+  function_call.set_process_id(kPid);
+  function_call.set_thread_id(kTid);
+  function_call.set_function_id(kFunctionId);
+  function_call.set_type(TimerInfo::kNone);
+  AppendMessage(function_call, &buffer);
+
+  TimerInfo scheduling_slice;
+  scheduling_slice.set_start(90);
+  scheduling_slice.set_end(210);
+  scheduling_slice.set_process_id(kPid);
+  scheduling_slice.set_thread_id(kTid);
+  scheduling_slice.set_processor(3);
+  scheduling_slice.set_type(TimerInfo::kCoreActivity);
+  AppendMessage(scheduling_slice, &buffer);
+
+  TimerInfo gpu_activity;
+  gpu_activity.set_start(120);
+  gpu_activity.set_end(130);
+  gpu_activity.set_type(TimerInfo::kGpuActivity);
+  AppendMessage(gpu_activity, &buffer);
+
+  return buffer;
+}
+
+[[nodiscard]] orbit_base::TemporaryFile CreateTemporaryFile() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  EXPECT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+  return temporary_file;
+}
+
+[[nodiscard]] std::vector<ClientCaptureEvent> ReadCaptureSection(
+    orbit_capture_file::CaptureFile* capture_file) {
+  std::unique_ptr<orbit_capture_file::ProtoSectionInputStream> input_stream =
+      capture_file->CreateCaptureSectionInputStream();
+  std::vector<ClientCaptureEvent> events;
+  while (events.empty() ||
+         events.back().event_case() != ClientCaptureEvent::kCaptureFinished) {
+    ClientCaptureEvent& event = events.emplace_back();
+    EXPECT_THAT(input_stream->ReadMessage(&event), HasNoError());
+    if (event.event_case() == ClientCaptureEvent::EVENT_NOT_SET) break;
+  }
+  return events;
+}
+
+[[nodiscard]] const ClientCaptureEvent* FindEvent(const std::vector<ClientCaptureEvent>& events,
+                                                  ClientCaptureEvent::EventCase event_case) {
+  for (const ClientCaptureEvent& event : events) {
+    if (event.event_case() == event_case) return &event;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(LegacyCaptureConverter, ConvertToCaptureFile) {
+  orbit_base::TemporaryFile legacy_file = CreateTemporaryFile();
+  ASSERT_THAT(orbit_base::WriteStringToFile(legacy_file.file_path(), CreateLegacyCapture()),
+              HasNoError());
+  orbit_base::TemporaryFile capture_file_path = CreateTemporaryFile();
+
+  ASSERT_THAT(ConvertToCaptureFile(legacy_file.file_path(), capture_file_path.file_path()),
+              HasNoError());
+
+  auto capture_file_or_error =
+      orbit_capture_file::CaptureFile::OpenForReadWrite(capture_file_path.file_path());
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<orbit_capture_file::CaptureFile> capture_file =
+      std::move(capture_file_or_error.value());
+  const std::vector<ClientCaptureEvent> events = ReadCaptureSection(capture_file.get());
+  ASSERT_GE(events.size(), 2);
+
+  ASSERT_EQ(events.front().event_case(), ClientCaptureEvent::kCaptureStarted);
+  const orbit_grpc_protos::CaptureStarted& capture_started = events.front().capture_started();
+  EXPECT_EQ(capture_started.process_id(), kPid);
+  ASSERT_EQ(capture_started.capture_options().instrumented_functions_size(), 1);
+  EXPECT_EQ(capture_started.capture_options().instrumented_functions(0).function_id(),
+            kFunctionId);
+  EXPECT_EQ(events.back().event_case(), ClientCaptureEvent::kCaptureFinished);
+
+  const ClientCaptureEvent* modules_snapshot =
+      FindEvent(events, ClientCaptureEvent::kModulesSnapshot);
+  ASSERT_NE(modules_snapshot, nullptr);
+  ASSERT_EQ(modules_snapshot->modules_snapshot().modules_size(), 1);
+  EXPECT_EQ(modules_snapshot->modules_snapshot().modules(0).build_id(), kModuleBuildId);
+
+  const ClientCaptureEvent* thread_name = FindEvent(events, ClientCaptureEvent::kThreadName);
+  ASSERT_NE(thread_name, nullptr);
+  EXPECT_EQ(thread_name->thread_name().tid(), kTid);
+  EXPECT_EQ(thread_name->thread_name().name(), "thread");
+
+  // The strings of the address info don't replace the one of the legacy capture.
+  const ClientCaptureEvent* address_info = FindEvent(events, ClientCaptureEvent::kAddressInfo);
+  ASSERT_NE(address_info, nullptr);
+  EXPECT_NE(address_info->address_info().function_name_key(), kLegacyStringKey);
+  EXPECT_NE(address_info->address_info().module_name_key(), kLegacyStringKey);
+  absl::flat_hash_map<uint64_t, std::string> interned_strings;
+  for (const ClientCaptureEvent& event : events) {
+    if (event.event_case() != ClientCaptureEvent::kInternedString) continue;
+    EXPECT_TRUE(
+        interned_strings.emplace(event.interned_string().key(), event.interned_string().intern())
+            .second);
+  }
+  EXPECT_EQ(interned_strings[kLegacyStringKey], "legacy string");
+  EXPECT_EQ(interned_strings[address_info->address_info().function_name_key()], "foo");
+  EXPECT_EQ(interned_strings[address_info->address_info().module_name_key()], kModulePath);
+
+  const ClientCaptureEvent* interned_callstack =
+      FindEvent(events, ClientCaptureEvent::kInternedCallstack);
+  ASSERT_NE(interned_callstack, nullptr);
+  EXPECT_EQ(interned_callstack->interned_callstack().key(), kCallstackId);
+  EXPECT_EQ(interned_callstack->interned_callstack().intern().type(),
+            orbit_grpc_protos::Callstack::kComplete);
+  const ClientCaptureEvent* callstack_sample =
+      FindEvent(events, ClientCaptureEvent::kCallstackSample);
+  ASSERT_NE(callstack_sample, nullptr);
+  EXPECT_EQ(callstack_sample->callstack_sample().pid(), kPid);
+  EXPECT_EQ(callstack_sample->callstack_sample().timestamp_ns(), 150);
+
+  const ClientCaptureEvent* function_call = FindEvent(events, ClientCaptureEvent::kFunctionCall);
+  ASSERT_NE(function_call, nullptr);
+  EXPECT_EQ(function_call->function_call().function_id(), kFunctionId);
+  EXPECT_EQ(function_call->function_call().end_timestamp_ns(), 200);
+  EXPECT_EQ(function_call->function_call().duration_ns(), 100);
+
+  const ClientCaptureEvent* scheduling_slice =
+      FindEvent(events, ClientCaptureEvent::kSchedulingSlice);
+  ASSERT_NE(scheduling_slice, nullptr);
+  EXPECT_EQ(scheduling_slice->scheduling_slice().core(), 3);
+  EXPECT_EQ(scheduling_slice->scheduling_slice().out_timestamp_ns(), 210);
+  EXPECT_EQ(scheduling_slice->scheduling_slice().duration_ns(), 120);
+
+  // The GPU timer is skipped.
+  EXPECT_EQ(FindEvent(events, ClientCaptureEvent::kGpuJob), nullptr);
+
+  ErrorMessageOr<std::optional<orbit_client_protos::CaptureSummary>> summary_or_error =
+      orbit_capture_file::ReadCaptureSummary(*capture_file);
+  ASSERT_THAT(summary_or_error, HasNoError());
+  ASSERT_TRUE(summary_or_error.value().has_value());
+  ASSERT_EQ(summary_or_error.value()->function_stats().count(kFunctionId), 1);
+  EXPECT_EQ(summary_or_error.value()->function_stats().at(kFunctionId).count(), 1);
+
+  ErrorMessageOr<std::optional<orbit_client_protos::CaptureSectionIndex>> index_or_error =
+      orbit_capture_file::ReadCaptureSectionIndex(*capture_file);
+  ASSERT_THAT(index_or_error, HasNoError());
+  EXPECT_TRUE(index_or_error.value().has_value());
+
+  EXPECT_TRUE(capture_file->FindSectionByType(orbit_capture_file::kSectionTypeUserData));
+}
+
+TEST(LegacyCaptureConverter, ConvertUnsupportedVersion) {
+  CaptureHeader header;
+  header.set_version("1.51");
+  std::string buffer;
+  AppendMessage(header, &buffer);
+  orbit_base::TemporaryFile legacy_file = CreateTemporaryFile();
+  ASSERT_THAT(orbit_base::WriteStringToFile(legacy_file.file_path(), buffer), HasNoError());
+  orbit_base::TemporaryFile capture_file = CreateTemporaryFile();
+
+  EXPECT_THAT(ConvertToCaptureFile(legacy_file.file_path(), capture_file.file_path()),
+              HasError("no longer supported"));
+  EXPECT_FALSE(std::filesystem::exists(capture_file.file_path()));
+}
+
+TEST(LegacyCaptureConverter, ConvertCancelled) {
+  orbit_base::TemporaryFile legacy_file = CreateTemporaryFile();
+  ASSERT_THAT(orbit_base::WriteStringToFile(legacy_file.file_path(), CreateLegacyCapture()),
+              HasNoError());
+  orbit_base::TemporaryFile capture_file = CreateTemporaryFile();
+
+  std::atomic<bool> cancellation_requested = true;
+  EXPECT_THAT(ConvertToCaptureFile(legacy_file.file_path(), capture_file.file_path(),
+                                   &cancellation_requested),
+              HasError("cancelled"));
+  EXPECT_FALSE(std::filesystem::exists(capture_file.file_path()));
+}
+
+TEST(LegacyCaptureConverter, ConvertToCaptureFiles) {
+  orbit_base::TemporaryFile legacy_file = CreateTemporaryFile();
+  ASSERT_THAT(orbit_base::WriteStringToFile(legacy_file.file_path(), CreateLegacyCapture()),
+              HasNoError());
+  std::vector<orbit_base::TemporaryFile> capture_files;
+  std::vector<LegacyCaptureConversion> conversions;
+  for (int i = 0; i < 4; ++i) {
+    orbit_base::TemporaryFile& capture_file = capture_files.emplace_back(CreateTemporaryFile());
+    conversions.push_back({legacy_file.file_path(), capture_file.file_path()});
+  }
+  conversions.push_back({"not/an/existing/file", capture_files.front().file_path()});
+
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(4, 4, absl::Milliseconds(50));
+  const std::vector<ErrorMessageOr<void>> results =
+      ConvertToCaptureFiles(conversions, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+
+  ASSERT_EQ(results.size(), conversions.size());
+  for (size_t i = 0; i < capture_files.size(); ++i) {
+    EXPECT_THAT(results[i], HasNoError());
+    EXPECT_TRUE(std::filesystem::exists(capture_files[i].file_path()));
+  }
+  EXPECT_THAT(results.back(), HasError("not/an/existing/file"));
+}
+
+}  // namespace orbit_client_model::legacy_capture_converter
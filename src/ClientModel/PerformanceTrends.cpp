@@ -0,0 +1,331 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientModel/PerformanceTrends.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileHelpers.h"
+#include "ClientData/FunctionStatsUtils.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/WriteStringToFile.h"
+
+using orbit_client_protos::CaptureSummary;
+using orbit_client_protos::FunctionStats;
+using orbit_client_protos::PerformanceTrendIndex;
+using orbit_grpc_protos::CaptureStarted;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::InstrumentedFunction;
+
+namespace orbit_client_model {
+
+namespace {
+
+// Module build id and function name, the key of PerformanceTrendIndex::Function.
+using IndexedFunctionKey = std::pair<std::string, std::string>;
+// Function name and module file name, the key of the trends.
+using TrendKey = std::pair<std::string, std::string>;
+
+[[nodiscard]] std::optional<int> FindCaptureByFilePath(const PerformanceTrendIndex& index,
+                                                       const std::string& file_path) {
+  for (int i = 0; i < index.captures_size(); ++i) {
+    if (index.captures(i).file_path() == file_path) return i;
+  }
+  return std::nullopt;
+}
+
+void RemoveStatsOfCapture(uint32_t capture_index, PerformanceTrendIndex* index) {
+  for (PerformanceTrendIndex::Function& function : *index->mutable_functions()) {
+    auto* stats = function.mutable_stats();
+    stats->erase(std::remove_if(stats->begin(), stats->end(),
+                                [capture_index](const auto& stats_in_capture) {
+                                  return stats_in_capture.capture_index() == capture_index;
+                                }),
+                 stats->end());
+  }
+}
+
+[[nodiscard]] ErrorMessageOr<CaptureStarted> ReadCaptureStarted(
+    orbit_capture_file::CaptureFile* capture_file) {
+  std::unique_ptr<orbit_capture_file::ProtoSectionInputStream> input_stream =
+      capture_file->CreateCaptureSectionInputStream();
+  // CaptureStarted is the first event of the capture files written by Orbit.
+  while (true) {
+    ClientCaptureEvent event;
+    OUTCOME_TRY(input_stream->ReadMessage(&event));
+    if (event.event_case() == ClientCaptureEvent::kCaptureStarted) {
+      return std::move(*event.mutable_capture_started());
+    }
+    if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+      return ErrorMessage{"The capture section has no CaptureStarted event"};
+    }
+  }
+}
+
+[[nodiscard]] double ComputeMedian(std::vector<uint64_t> values) {
+  CHECK(!values.empty());
+  std::sort(values.begin(), values.end());
+  const size_t middle = values.size() / 2;
+  if (values.size() % 2 == 1) return static_cast<double>(values[middle]);
+  return (static_cast<double>(values[middle - 1]) + static_cast<double>(values[middle])) / 2;
+}
+
+// The relative change of the percentile of the last point from the median of the previous ones,
+// with the points of too few calls left out.
+[[nodiscard]] std::optional<double> ComputeChangeOfLastPoint(
+    const std::vector<PerformanceTrendPoint>& points,
+    std::optional<uint64_t> PerformanceTrendPoint::*percentile_ns,
+    const RegressionDetectionOptions& options) {
+  if (points.empty()) return std::nullopt;
+  const PerformanceTrendPoint& last_point = points.back();
+  if (last_point.call_count < options.min_call_count || !(last_point.*percentile_ns).has_value()) {
+    return std::nullopt;
+  }
+
+  std::vector<uint64_t> baseline_values;
+  for (auto it = std::next(points.rbegin());
+       it != points.rend() && baseline_values.size() < options.baseline_capture_count; ++it) {
+    if (it->call_count < options.min_call_count || !((*it).*percentile_ns).has_value()) continue;
+    baseline_values.push_back(((*it).*percentile_ns).value());
+  }
+  if (baseline_values.empty() || baseline_values.size() < options.min_baseline_capture_count) {
+    return std::nullopt;
+  }
+  const double baseline_ns = ComputeMedian(std::move(baseline_values));
+  if (baseline_ns == 0) return std::nullopt;
+  return static_cast<double>((last_point.*percentile_ns).value()) / baseline_ns - 1;
+}
+
+[[nodiscard]] double GetLargestChange(const FunctionPerformanceTrend& trend) {
+  return std::max(trend.p50_change.value_or(0), trend.p95_change.value_or(0));
+}
+
+}  // namespace
+
+ErrorMessageOr<PerformanceTrendIndex> LoadPerformanceTrendIndex(
+    const std::filesystem::path& file_path) {
+  OUTCOME_TRY(exists, orbit_base::FileExists(file_path));
+  if (!exists) return PerformanceTrendIndex{};
+
+  OUTCOME_TRY(content, orbit_base::ReadFileToString(file_path));
+  PerformanceTrendIndex index;
+  if (!index.ParseFromString(content)) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to parse performance trend index \"%s\"", file_path.string())};
+  }
+  return index;
+}
+
+ErrorMessageOr<void> SavePerformanceTrendIndex(const PerformanceTrendIndex& index,
+                                               const std::filesystem::path& file_path) {
+  std::string content;
+  if (!index.SerializeToString(&content)) {
+    return ErrorMessage{"Unable to serialize performance trend index"};
+  }
+  // Writing to another file first keeps the previous index intact if this is interrupted.
+  std::filesystem::path temporary_file_path = file_path;
+  temporary_file_path += ".tmp";
+  OUTCOME_TRY(orbit_base::WriteStringToFile(temporary_file_path, content));
+  OUTCOME_TRY(orbit_base::MoveFile(temporary_file_path, file_path));
+  return outcome::success();
+}
+
+void AddCaptureToPerformanceTrendIndex(PerformanceTrendIndex::Capture capture,
+                                       const CaptureStarted& capture_started,
+                                       const CaptureSummary& capture_summary,
+                                       PerformanceTrendIndex* index) {
+  CHECK(index != nullptr);
+  capture.set_executable_path(capture_started.executable_path());
+  capture.set_executable_build_id(capture_started.executable_build_id());
+
+  uint32_t capture_index = 0;
+  if (std::optional<int> indexed_capture_index = FindCaptureByFilePath(*index, capture.file_path());
+      indexed_capture_index.has_value()) {
+    capture_index = indexed_capture_index.value();
+    RemoveStatsOfCapture(capture_index, index);
+    *index->mutable_captures(indexed_capture_index.value()) = std::move(capture);
+  } else {
+    capture_index = index->captures_size();
+    *index->add_captures() = std::move(capture);
+  }
+
+  absl::flat_hash_map<IndexedFunctionKey, PerformanceTrendIndex::Function*> functions;
+  for (PerformanceTrendIndex::Function& function : *index->mutable_functions()) {
+    functions.emplace(IndexedFunctionKey{function.module_build_id(), function.function_name()},
+                      &function);
+  }
+
+  for (const InstrumentedFunction& instrumented_function :
+       capture_started.capture_options().instrumented_functions()) {
+    auto stats_it = capture_summary.function_stats().find(instrumented_function.function_id());
+    if (stats_it == capture_summary.function_stats().end() || stats_it->second.count() == 0) {
+      continue;
+    }
+
+    auto [function_it, inserted] = functions.try_emplace(IndexedFunctionKey{
+        instrumented_function.file_build_id(), instrumented_function.function_name()});
+    if (inserted) {
+      PerformanceTrendIndex::Function* function = index->add_functions();
+      function->set_module_path(instrumented_function.file_path());
+      function->set_module_build_id(instrumented_function.file_build_id());
+      function->set_function_name(instrumented_function.function_name());
+      function_it->second = function;
+    }
+    PerformanceTrendIndex::Function* function = function_it->second;
+
+    // The same function can be instrumented more than once, e.g., if the module is loaded twice.
+    if (function->stats_size() == 0 ||
+        function->stats(function->stats_size() - 1).capture_index() != capture_index) {
+      function->add_stats()->set_capture_index(capture_index);
+    }
+    orbit_client_data::MergeFunctionStats(
+        stats_it->second, function->mutable_stats(function->stats_size() - 1)->mutable_stats());
+  }
+}
+
+ErrorMessageOr<bool> AddCaptureFileToPerformanceTrendIndex(const std::filesystem::path& file_path,
+                                                           PerformanceTrendIndex* index) {
+  CHECK(index != nullptr);
+  std::error_code error;
+  const uintmax_t file_size = std::filesystem::file_size(file_path, error);
+  if (error) {
+    return ErrorMessage{absl::StrFormat("Unable to get size of \"%s\": %s", file_path.string(),
+                                        error.message())};
+  }
+  const std::filesystem::file_time_type last_write_time =
+      std::filesystem::last_write_time(file_path, error);
+  if (error) {
+    return ErrorMessage{absl::StrFormat("Unable to get modification time of \"%s\": %s",
+                                        file_path.string(), error.message())};
+  }
+
+  PerformanceTrendIndex::Capture capture;
+  capture.set_file_path(file_path.string());
+  capture.set_file_size(file_size);
+  capture.set_file_modification_time_ns(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(last_write_time.time_since_epoch())
+          .count());
+  if (std::optional<int> capture_index = FindCaptureByFilePath(*index, capture.file_path());
+      capture_index.has_value()) {
+    const PerformanceTrendIndex::Capture& indexed_capture = index->captures(capture_index.value());
+    if (indexed_capture.file_size() == capture.file_size() &&
+        indexed_capture.file_modification_time_ns() == capture.file_modification_time_ns()) {
+      return false;
+    }
+  }
+
+  OUTCOME_TRY(capture_file, orbit_capture_file::CaptureFile::OpenForReadWrite(file_path));
+  OUTCOME_TRY(capture_summary, orbit_capture_file::ReadCaptureSummary(*capture_file));
+  if (!capture_summary.has_value()) {
+    return ErrorMessage{absl::StrFormat(
+        "Capture file \"%s\" has no summary section, as it was saved by an older version of Orbit",
+        file_path.string())};
+  }
+  ErrorMessageOr<CaptureStarted> capture_started = ReadCaptureStarted(capture_file.get());
+  if (capture_started.has_error()) {
+    return ErrorMessage{absl::StrFormat("Reading capture file \"%s\": %s", file_path.string(),
+                                        capture_started.error().message())};
+  }
+
+  AddCaptureToPerformanceTrendIndex(std::move(capture), capture_started.value(),
+                                    capture_summary.value(), index);
+  return true;
+}
+
+std::vector<FunctionPerformanceTrend> ComputeFunctionPerformanceTrends(
+    const PerformanceTrendIndex& index, const RegressionDetectionOptions& options) {
+  // The chronological position of each capture.
+  std::vector<uint32_t> capture_indices(index.captures_size());
+  for (uint32_t i = 0; i < capture_indices.size(); ++i) capture_indices[i] = i;
+  std::stable_sort(capture_indices.begin(), capture_indices.end(),
+                   [&index](uint32_t lhs, uint32_t rhs) {
+                     return index.captures(lhs).file_modification_time_ns() <
+                            index.captures(rhs).file_modification_time_ns();
+                   });
+  std::vector<size_t> capture_positions(capture_indices.size());
+  for (size_t position = 0; position < capture_indices.size(); ++position) {
+    capture_positions[capture_indices[position]] = position;
+  }
+
+  struct StatsOfTrend {
+    std::string function_name;
+    // By capture index.
+    absl::flat_hash_map<uint32_t, std::pair<std::string, FunctionStats>> build_id_and_stats;
+    // The module of the most recent capture, and its position.
+    std::string module_path;
+    size_t module_path_capture_position = 0;
+  };
+  absl::flat_hash_map<TrendKey, StatsOfTrend> stats_by_trend;
+  for (const PerformanceTrendIndex::Function& function : index.functions()) {
+    const TrendKey key{function.function_name(),
+                       std::filesystem::path{function.module_path()}.filename().string()};
+    StatsOfTrend& stats_of_trend = stats_by_trend[key];
+    stats_of_trend.function_name = function.function_name();
+    for (const PerformanceTrendIndex::FunctionStatsInCapture& stats_in_capture : function.stats()) {
+      if (stats_in_capture.capture_index() >= capture_positions.size()) continue;
+      auto [it, inserted] =
+          stats_of_trend.build_id_and_stats.try_emplace(stats_in_capture.capture_index());
+      if (inserted) it->second.first = function.module_build_id();
+      orbit_client_data::MergeFunctionStats(stats_in_capture.stats(), &it->second.second);
+
+      const size_t position = capture_positions[stats_in_capture.capture_index()];
+      if (stats_of_trend.module_path.empty() ||
+          position >= stats_of_trend.module_path_capture_position) {
+        stats_of_trend.module_path = function.module_path();
+        stats_of_trend.module_path_capture_position = position;
+      }
+    }
+  }
+
+  std::vector<FunctionPerformanceTrend> trends;
+  trends.reserve(stats_by_trend.size());
+  for (auto& [unused_key, stats_of_trend] : stats_by_trend) {
+    if (stats_of_trend.build_id_and_stats.empty()) continue;
+    FunctionPerformanceTrend& trend = trends.emplace_back();
+    trend.function_name = std::move(stats_of_trend.function_name);
+    trend.module_path = std::move(stats_of_trend.module_path);
+    for (auto& [capture_index, build_id_and_stats] : stats_of_trend.build_id_and_stats) {
+      PerformanceTrendPoint& point = trend.points.emplace_back();
+      point.capture_index = capture_index;
+      point.module_build_id = std::move(build_id_and_stats.first);
+      point.call_count = build_id_and_stats.second.count();
+      point.p50_ns = orbit_client_data::GetDurationPercentileNs(build_id_and_stats.second, 0.5);
+      point.p95_ns = orbit_client_data::GetDurationPercentileNs(build_id_and_stats.second, 0.95);
+    }
+    std::sort(trend.points.begin(), trend.points.end(),
+              [&capture_positions](const PerformanceTrendPoint& lhs,
+                                   const PerformanceTrendPoint& rhs) {
+                return capture_positions[lhs.capture_index] < capture_positions[rhs.capture_index];
+              });
+
+    trend.p50_change = ComputeChangeOfLastPoint(trend.points, &PerformanceTrendPoint::p50_ns,
+                                                options);
+    trend.p95_change = ComputeChangeOfLastPoint(trend.points, &PerformanceTrendPoint::p95_ns,
+                                                options);
+    trend.is_regression = GetLargestChange(trend) > options.regression_threshold;
+  }
+
+  std::sort(trends.begin(), trends.end(),
+            [](const FunctionPerformanceTrend& lhs, const FunctionPerformanceTrend& rhs) {
+              if (lhs.is_regression != rhs.is_regression) return lhs.is_regression;
+              if (lhs.is_regression && GetLargestChange(lhs) != GetLargestChange(rhs)) {
+                return GetLargestChange(lhs) > GetLargestChange(rhs);
+              }
+              return std::tie(lhs.function_name, lhs.module_path) <
+                     std::tie(rhs.function_name, rhs.module_path);
+            });
+  return trends;
+}
+
+}  // namespace orbit_client_model
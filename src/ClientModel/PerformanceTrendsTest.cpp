@@ -0,0 +1,285 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "ClientData/FunctionStatsUtils.h"
+#include "ClientModel/PerformanceTrends.h"
+#include "OrbitBase/Result.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+#include "capture_summary.pb.h"
+#include "performance_trend_index.pb.h"
+
+using orbit_client_protos::CaptureSummary;
+using orbit_client_protos::FunctionStats;
+using orbit_client_protos::PerformanceTrendIndex;
+using orbit_grpc_protos::CaptureStarted;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::InstrumentedFunction;
+using testing::ElementsAre;
+
+namespace orbit_client_model {
+
+namespace {
+
+constexpr const char* kModulePath = "/path/to/module.so";
+constexpr uint64_t kFunctionId = 1;
+constexpr uint64_t kOtherFunctionId = 2;
+constexpr const char* kFunctionName = "Update";
+constexpr const char* kOtherFunctionName = "Render";
+
+[[nodiscard]] CaptureStarted CreateCaptureStarted(const std::string& build_id) {
+  CaptureStarted capture_started;
+  capture_started.set_executable_path("/path/to/game");
+  capture_started.set_executable_build_id(build_id);
+  for (const auto& [function_id, function_name] :
+       {std::pair{kFunctionId, kFunctionName}, std::pair{kOtherFunctionId, kOtherFunctionName}}) {
+    InstrumentedFunction* instrumented_function =
+        capture_started.mutable_capture_options()->add_instrumented_functions();
+    instrumented_function->set_function_id(function_id);
+    instrumented_function->set_function_name(function_name);
+    instrumented_function->set_file_path(kModulePath);
+    instrumented_function->set_file_build_id(build_id);
+  }
+  return capture_started;
+}
+
+[[nodiscard]] CaptureSummary CreateCaptureSummary(uint64_t function_id, uint64_t call_count,
+                                                  uint64_t duration_ns) {
+  CaptureSummary capture_summary;
+  FunctionStats& stats = (*capture_summary.mutable_function_stats())[function_id];
+  for (uint64_t i = 0; i < call_count; ++i) {
+    orbit_client_data::AddFunctionCallToStats(duration_ns, &stats);
+  }
+  return capture_summary;
+}
+
+void AddCapture(const std::string& file_path, int64_t modification_time_ns,
+                const std::string& build_id, uint64_t call_count, uint64_t duration_ns,
+                PerformanceTrendIndex* index) {
+  PerformanceTrendIndex::Capture capture;
+  capture.set_file_path(file_path);
+  capture.set_file_modification_time_ns(modification_time_ns);
+  AddCaptureToPerformanceTrendIndex(std::move(capture), CreateCaptureStarted(build_id),
+                                    CreateCaptureSummary(kFunctionId, call_count, duration_ns),
+                                    index);
+}
+
+[[nodiscard]] std::vector<uint32_t> GetCaptureIndices(const FunctionPerformanceTrend& trend) {
+  std::vector<uint32_t> capture_indices;
+  for (const PerformanceTrendPoint& point : trend.points) {
+    capture_indices.push_back(point.capture_index);
+  }
+  return capture_indices;
+}
+
+}  // namespace
+
+TEST(PerformanceTrends, AddCaptureToPerformanceTrendIndexKeysFunctionsByBuildId) {
+  PerformanceTrendIndex index;
+  AddCapture("/captures/1.orbit", 1, "build_1", 10, 1000, &index);
+  AddCapture("/captures/2.orbit", 2, "build_1", 20, 1000, &index);
+  AddCapture("/captures/3.orbit", 3, "build_2", 30, 1000, &index);
+
+  ASSERT_EQ(index.captures_size(), 3);
+  EXPECT_EQ(index.captures(0).file_path(), "/captures/1.orbit");
+  EXPECT_EQ(index.captures(2).executable_build_id(), "build_2");
+  EXPECT_EQ(index.captures(2).executable_path(), "/path/to/game");
+
+  // The other function is not called, so it is left out.
+  ASSERT_EQ(index.functions_size(), 2);
+  EXPECT_EQ(index.functions(0).function_name(), kFunctionName);
+  EXPECT_EQ(index.functions(0).module_build_id(), "build_1");
+  EXPECT_EQ(index.functions(0).module_path(), kModulePath);
+  ASSERT_EQ(index.functions(0).stats_size(), 2);
+  EXPECT_EQ(index.functions(0).stats(0).capture_index(), 0);
+  EXPECT_EQ(index.functions(0).stats(0).stats().count(), 10);
+  EXPECT_EQ(index.functions(0).stats(1).capture_index(), 1);
+  EXPECT_EQ(index.functions(0).stats(1).stats().count(), 20);
+  EXPECT_EQ(index.functions(1).module_build_id(), "build_2");
+  ASSERT_EQ(index.functions(1).stats_size(), 1);
+  EXPECT_EQ(index.functions(1).stats(0).capture_index(), 2);
+}
+
+TEST(PerformanceTrends, AddCaptureToPerformanceTrendIndexReplacesCaptureWithSameFilePath) {
+  PerformanceTrendIndex index;
+  AddCapture("/captures/1.orbit", 1, "build_1", 10, 1000, &index);
+  AddCapture("/captures/2.orbit", 2, "build_1", 20, 1000, &index);
+  AddCapture("/captures/1.orbit", 3, "build_1", 30, 1000, &index);
+
+  ASSERT_EQ(index.captures_size(), 2);
+  EXPECT_EQ(index.captures(0).file_modification_time_ns(), 3);
+  ASSERT_EQ(index.functions_size(), 1);
+  ASSERT_EQ(index.functions(0).stats_size(), 2);
+  EXPECT_EQ(index.functions(0).stats(0).capture_index(), 1);
+  EXPECT_EQ(index.functions(0).stats(1).capture_index(), 0);
+  EXPECT_EQ(index.functions(0).stats(1).stats().count(), 30);
+}
+
+TEST(PerformanceTrends, ComputeFunctionPerformanceTrendsFollowsFunctionAcrossBuilds) {
+  PerformanceTrendIndex index;
+  // Indexed out of chronological order.
+  AddCapture("/captures/2.orbit", 200, "build_2", 10, 1000, &index);
+  AddCapture("/captures/1.orbit", 100, "build_1", 10, 1000, &index);
+  AddCapture("/captures/3.orbit", 300, "build_3", 10, 1000, &index);
+
+  std::vector<FunctionPerformanceTrend> trends = ComputeFunctionPerformanceTrends(index);
+  ASSERT_EQ(trends.size(), 1);
+  const FunctionPerformanceTrend& trend = trends[0];
+  EXPECT_EQ(trend.function_name, kFunctionName);
+  EXPECT_EQ(trend.module_path, kModulePath);
+  EXPECT_THAT(GetCaptureIndices(trend), ElementsAre(1, 0, 2));
+  EXPECT_EQ(trend.points[0].module_build_id, "build_1");
+  EXPECT_EQ(trend.points[2].module_build_id, "build_3");
+  EXPECT_EQ(trend.points[0].call_count, 10);
+  EXPECT_EQ(trend.points[0].p50_ns, 1000);
+  EXPECT_EQ(trend.points[0].p95_ns, 1000);
+  // Only two captures before the last one.
+  EXPECT_FALSE(trend.p50_change.has_value());
+  EXPECT_FALSE(trend.p95_change.has_value());
+  EXPECT_FALSE(trend.is_regression);
+}
+
+TEST(PerformanceTrends, ComputeFunctionPerformanceTrendsDetectsRegressions) {
+  PerformanceTrendIndex index;
+  AddCapture("/captures/1.orbit", 1, "build_1", 10, 1000, &index);
+  AddCapture("/captures/2.orbit", 2, "build_2", 10, 1000, &index);
+  // A noisy capture is outweighed by the median.
+  AddCapture("/captures/3.orbit", 3, "build_3", 10, 4000, &index);
+  AddCapture("/captures/4.orbit", 4, "build_4", 10, 1000, &index);
+  AddCapture("/captures/5.orbit", 5, "build_5", 10, 2000, &index);
+
+  std::vector<FunctionPerformanceTrend> trends = ComputeFunctionPerformanceTrends(index);
+  ASSERT_EQ(trends.size(), 1);
+  ASSERT_TRUE(trends[0].p50_change.has_value());
+  EXPECT_DOUBLE_EQ(trends[0].p50_change.value(), 1.0);
+  ASSERT_TRUE(trends[0].p95_change.has_value());
+  EXPECT_DOUBLE_EQ(trends[0].p95_change.value(), 1.0);
+  EXPECT_TRUE(trends[0].is_regression);
+
+  RegressionDetectionOptions options;
+  options.regression_threshold = 1.5;
+  EXPECT_FALSE(ComputeFunctionPerformanceTrends(index, options)[0].is_regression);
+}
+
+TEST(PerformanceTrends, ComputeFunctionPerformanceTrendsIgnoresCapturesWithFewCalls) {
+  PerformanceTrendIndex index;
+  AddCapture("/captures/1.orbit", 1, "build_1", 10, 1000, &index);
+  AddCapture("/captures/2.orbit", 2, "build_1", 1, 5000, &index);
+  AddCapture("/captures/3.orbit", 3, "build_1", 10, 1000, &index);
+  AddCapture("/captures/4.orbit", 4, "build_1", 10, 1000, &index);
+  AddCapture("/captures/5.orbit", 5, "build_1", 10, 1050, &index);
+
+  std::vector<FunctionPerformanceTrend> trends = ComputeFunctionPerformanceTrends(index);
+  ASSERT_EQ(trends.size(), 1);
+  EXPECT_EQ(trends[0].points.size(), 5);
+  ASSERT_TRUE(trends[0].p50_change.has_value());
+  EXPECT_FALSE(trends[0].is_regression);
+
+  AddCapture("/captures/6.orbit", 6, "build_1", 1, 5000, &index);
+  trends = ComputeFunctionPerformanceTrends(index);
+  EXPECT_FALSE(trends[0].p50_change.has_value());
+  EXPECT_FALSE(trends[0].is_regression);
+}
+
+TEST(PerformanceTrends, ComputeFunctionPerformanceTrendsSortsRegressionsFirst) {
+  PerformanceTrendIndex index;
+  for (int64_t i = 0; i < 4; ++i) {
+    PerformanceTrendIndex::Capture capture;
+    capture.set_file_path(std::to_string(i));
+    capture.set_file_modification_time_ns(i);
+    CaptureSummary capture_summary = CreateCaptureSummary(kFunctionId, 10, 1000);
+    (*capture_summary.mutable_function_stats())[kOtherFunctionId] =
+        CreateCaptureSummary(kOtherFunctionId, 10, i == 3 ? 3000 : 1000)
+            .function_stats()
+            .at(kOtherFunctionId);
+    AddCaptureToPerformanceTrendIndex(std::move(capture), CreateCaptureStarted("build"),
+                                      capture_summary, &index);
+  }
+
+  std::vector<FunctionPerformanceTrend> trends = ComputeFunctionPerformanceTrends(index);
+  ASSERT_EQ(trends.size(), 2);
+  EXPECT_EQ(trends[0].function_name, kOtherFunctionName);
+  EXPECT_TRUE(trends[0].is_regression);
+  EXPECT_EQ(trends[1].function_name, kFunctionName);
+  EXPECT_FALSE(trends[1].is_regression);
+}
+
+TEST(PerformanceTrends, AddCaptureFileToPerformanceTrendIndexReadsSummary) {
+  ErrorMessageOr<orbit_base::TemporaryFile> temporary_file_or_error =
+      orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  const std::filesystem::path file_path = temporary_file_or_error.value().file_path();
+  temporary_file_or_error.value().CloseAndRemove();
+
+  {
+    ErrorMessageOr<std::unique_ptr<orbit_capture_file::CaptureFileOutputStream>>
+        output_stream_or_error = orbit_capture_file::CaptureFileOutputStream::Create(file_path);
+    ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+    orbit_capture_file::CaptureFileOutputStream& output_stream = *output_stream_or_error.value();
+    ClientCaptureEvent capture_started_event;
+    *capture_started_event.mutable_capture_started() = CreateCaptureStarted("build_1");
+    ASSERT_FALSE(output_stream.WriteCaptureEvent(capture_started_event).has_error());
+    for (uint64_t duration_ns : {100, 200}) {
+      ClientCaptureEvent event;
+      event.mutable_function_call()->set_function_id(kFunctionId);
+      event.mutable_function_call()->set_duration_ns(duration_ns);
+      ASSERT_FALSE(output_stream.WriteCaptureEvent(event).has_error());
+    }
+    ClientCaptureEvent capture_finished_event;
+    capture_finished_event.mutable_capture_finished();
+    ASSERT_FALSE(output_stream.WriteCaptureEvent(capture_finished_event).has_error());
+    ASSERT_FALSE(output_stream.Close().has_error());
+  }
+
+  PerformanceTrendIndex index;
+  ErrorMessageOr<bool> added_or_error = AddCaptureFileToPerformanceTrendIndex(file_path, &index);
+  ASSERT_TRUE(added_or_error.has_value()) << added_or_error.error().message();
+  EXPECT_TRUE(added_or_error.value());
+  ASSERT_EQ(index.captures_size(), 1);
+  EXPECT_EQ(index.captures(0).file_path(), file_path.string());
+  EXPECT_EQ(index.captures(0).file_size(), std::filesystem::file_size(file_path));
+  EXPECT_EQ(index.captures(0).executable_build_id(), "build_1");
+  ASSERT_EQ(index.functions_size(), 1);
+  EXPECT_EQ(index.functions(0).function_name(), kFunctionName);
+  ASSERT_EQ(index.functions(0).stats_size(), 1);
+  EXPECT_EQ(index.functions(0).stats(0).stats().count(), 2);
+  EXPECT_EQ(index.functions(0).stats(0).stats().total_time_ns(), 300);
+
+  // The file didn't change.
+  added_or_error = AddCaptureFileToPerformanceTrendIndex(file_path, &index);
+  ASSERT_TRUE(added_or_error.has_value()) << added_or_error.error().message();
+  EXPECT_FALSE(added_or_error.value());
+
+  std::filesystem::path index_file_path = file_path;
+  index_file_path += ".index";
+  ASSERT_FALSE(SavePerformanceTrendIndex(index, index_file_path).has_error());
+  ErrorMessageOr<PerformanceTrendIndex> loaded_index_or_error =
+      LoadPerformanceTrendIndex(index_file_path);
+  ASSERT_TRUE(loaded_index_or_error.has_value()) << loaded_index_or_error.error().message();
+  EXPECT_EQ(loaded_index_or_error.value().SerializeAsString(), index.SerializeAsString());
+
+  std::filesystem::remove(file_path);
+  std::filesystem::remove(index_file_path);
+}
+
+TEST(PerformanceTrends, LoadPerformanceTrendIndexReturnsEmptyIndexWithoutFile) {
+  ErrorMessageOr<PerformanceTrendIndex> index_or_error =
+      LoadPerformanceTrendIndex("/non/existent/performance_trends.index");
+  ASSERT_TRUE(index_or_error.has_value()) << index_or_error.error().message();
+  EXPECT_EQ(index_or_error.value().captures_size(), 0);
+}
+
+}  // namespace orbit_client_model
@@ -4,10 +4,10 @@
 
 #include "ClientModel/SamplingDataPostProcessor.h"
 
-#include <absl/hash/hash.h>
-
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
@@ -15,6 +15,8 @@
 #include <vector>
 
 #include "ClientData/CallstackTypes.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/JoinFutures.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadConstants.h"
 #include "absl/container/flat_hash_map.h"
@@ -22,242 +24,430 @@
 #include "capture_data.pb.h"
 
 using orbit_client_data::CallstackData;
+using orbit_client_data::CallstackPool;
+using orbit_client_data::CallstackView;
 using orbit_client_data::PostProcessedSamplingData;
 using orbit_client_data::SampledFunction;
+using orbit_client_data::SampledModule;
 using orbit_client_data::ThreadID;
 using orbit_client_data::ThreadSampleData;
 
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::CallstackInfo;
 
+using orbit_client_model::internal::CallstackInfoAsClass;
+using orbit_client_model::internal::CallstackInfoAsPairWithLvalueRefToFrames;
+
 namespace orbit_client_model {
 
 namespace {
 
-// class equivalent of orbit_client_protos::CallstackInfo for use as key of absl::flat_hash_map.
-class CallstackInfoAsClass {
- public:
-  CallstackInfoAsClass(std::vector<uint64_t> frames, CallstackInfo::CallstackType type)
-      : frames_(std::move(frames)), type_(type) {}
+void FillSortedCountToResolvedAddress(ThreadSampleData* thread_sample_data) {
+  // For each thread, sort resolved (function) addresses by inclusive count.
+  for (const auto& [address, count] : thread_sample_data->resolved_address_to_count) {
+    thread_sample_data->sorted_count_to_resolved_address.insert(std::make_pair(count, address));
+  }
+}
 
-  [[nodiscard]] const std::vector<uint64_t>& frames() const { return frames_; }
-  [[nodiscard]] CallstackInfo::CallstackType type() const { return type_; }
+void FillSampledFunctions(ThreadSampleData* thread_sample_data, const CaptureData& capture_data) {
+  std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_functions;
+  sampled_functions->reserve(thread_sample_data->sorted_count_to_resolved_address.size());
 
- private:
-  std::vector<uint64_t> frames_;
-  CallstackInfo::CallstackType type_;
-};
+  for (auto sorted_it = thread_sample_data->sorted_count_to_resolved_address.rbegin();
+       sorted_it != thread_sample_data->sorted_count_to_resolved_address.rend(); ++sorted_it) {
+    uint32_t num_occurrences = sorted_it->first;
+    uint64_t absolute_address = sorted_it->second;
 
-template <typename H>
-H AbslHashValue(H h, const CallstackInfoAsClass& o) {
-  return H::combine(std::move(h), o.frames(), o.type());
-}
+    SampledFunction function;
+    function.name = capture_data.GetFunctionNameByAddress(absolute_address);
 
-using CallstackInfoAsPairWithLvalueRefToFrames =
-    std::pair<const std::vector<uint64_t>&, CallstackInfo::CallstackType>;
+    function.inclusive = num_occurrences;
+    function.inclusive_percent = 100.f * num_occurrences / thread_sample_data->samples_count;
 
-// CallstackInfoHash and CallstackInfoEq allow heterogeneous lookup in
-// SamplingDataPostProcessor::resolved_callstack_to_id_;
-struct CallstackInfoHash {
-  using is_transparent = void;  // Makes this functor transparent, enabling heterogeneous lookup.
+    function.exclusive = 0;
+    function.exclusive_percent = 0.f;
 
-  size_t operator()(const CallstackInfoAsClass& o) const {
-    return absl::Hash<CallstackInfoAsClass>{}(o);
-  }
+    if (auto it = thread_sample_data->resolved_address_to_exclusive_count.find(absolute_address);
+        it != thread_sample_data->resolved_address_to_exclusive_count.end()) {
+      function.exclusive = it->second;
+      function.exclusive_percent = 100.f * it->second / thread_sample_data->samples_count;
+    }
+
+    function.unwind_errors = 0;
+    function.unwind_errors_percent = 0.f;
+    if (auto it = thread_sample_data->resolved_address_to_error_count.find(absolute_address);
+        it != thread_sample_data->resolved_address_to_error_count.end()) {
+      function.unwind_errors = it->second;
+      function.unwind_errors_percent = 100.f * it->second / thread_sample_data->samples_count;
+    }
+    function.absolute_address = absolute_address;
+    function.module_path = capture_data.GetModulePathByAddress(absolute_address);
+    function.module_name = std::filesystem::path(function.module_path).filename().string();
 
-  size_t operator()(const CallstackInfoAsPairWithLvalueRefToFrames& p) const {
-    return absl::Hash<CallstackInfoAsPairWithLvalueRefToFrames>{}(p);
+    sampled_functions->push_back(function);
   }
-};
+}
 
-struct CallstackInfoEq {
-  using is_transparent = void;  // Makes this functor transparent, enabling heterogeneous lookup.
+void FillSampledModules(ThreadSampleData* thread_sample_data) {
+  std::vector<SampledModule>* sampled_modules = &thread_sample_data->sampled_modules;
+  sampled_modules->reserve(thread_sample_data->resolved_module_path_to_count.size());
 
-  bool operator()(const CallstackInfoAsClass& lhs, const CallstackInfoAsClass& rhs) const {
-    return std::equal(lhs.frames().begin(), lhs.frames().end(), rhs.frames().begin(),
-                      rhs.frames().end()) &&
-           lhs.type() == rhs.type();
-  }
+  auto find_count = [](const absl::flat_hash_map<std::string, uint32_t>& module_path_to_count,
+                       const std::string& module_path) -> uint32_t {
+    auto it = module_path_to_count.find(module_path);
+    return it != module_path_to_count.end() ? it->second : 0;
+  };
 
-  bool operator()(const CallstackInfoAsClass& lhs,
-                  const CallstackInfoAsPairWithLvalueRefToFrames& rhs) const {
-    return std::equal(lhs.frames().begin(), lhs.frames().end(), rhs.first.begin(),
-                      rhs.first.end()) &&
-           lhs.type() == rhs.second;
-  }
-};
+  for (const auto& [module_path, count] : thread_sample_data->resolved_module_path_to_count) {
+    SampledModule module;
+    module.module_path = module_path;
+    module.module_name = std::filesystem::path(module_path).filename().string();
 
-class SamplingDataPostProcessor {
- public:
-  explicit SamplingDataPostProcessor() = default;
-  SamplingDataPostProcessor& operator=(const SamplingDataPostProcessor& other) = default;
-  SamplingDataPostProcessor(const SamplingDataPostProcessor& other) = default;
+    module.inclusive = count;
+    module.inclusive_percent = 100.f * count / thread_sample_data->samples_count;
 
-  SamplingDataPostProcessor(SamplingDataPostProcessor&& other) = default;
-  SamplingDataPostProcessor& operator=(SamplingDataPostProcessor&& other) = default;
+    module.exclusive =
+        find_count(thread_sample_data->resolved_module_path_to_exclusive_count, module_path);
+    module.exclusive_percent = 100.f * module.exclusive / thread_sample_data->samples_count;
 
-  PostProcessedSamplingData ProcessSamples(const CallstackData& callstack_data,
-                                           const CaptureData& capture_data, bool generate_summary);
+    module.unwind_errors =
+        find_count(thread_sample_data->resolved_module_path_to_error_count, module_path);
+    module.unwind_errors_percent = 100.f * module.unwind_errors / thread_sample_data->samples_count;
 
- private:
-  void SortByThreadUsage();
+    sampled_modules->push_back(std::move(module));
+  }
 
-  void ResolveCallstacks(const CallstackData& callstack_data, const CaptureData& capture_data);
+  std::sort(sampled_modules->begin(), sampled_modules->end(),
+            [](const SampledModule& a, const SampledModule& b) {
+              if (a.inclusive != b.inclusive) return a.inclusive > b.inclusive;
+              return a.module_path < b.module_path;
+            });
+}
 
-  void MapAddressToFunctionAddress(uint64_t absolute_address, const CaptureData& capture_data);
+// Only sorts and formats the counts that IncrementalSamplingDataPostProcessor keeps up to date.
+PostProcessedSamplingData BuildPostProcessedSamplingData(
+    absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data,
+    CallstackPool resolved_callstacks,
+    absl::flat_hash_map<uint64_t, uint64_t> original_id_to_resolved_callstack_id,
+    absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
+        function_address_to_sampled_callstack_ids,
+    const CaptureData& capture_data) {
+  std::vector<ThreadSampleData> sorted_thread_sample_data;
+  sorted_thread_sample_data.reserve(thread_id_to_sample_data.size());
+
+  for (auto& [thread_id, thread_sample_data] : thread_id_to_sample_data) {
+    thread_sample_data.thread_id = thread_id;
+    FillSortedCountToResolvedAddress(&thread_sample_data);
+    FillSampledFunctions(&thread_sample_data, capture_data);
+    FillSampledModules(&thread_sample_data);
+    sorted_thread_sample_data.push_back(thread_sample_data);
+  }
 
-  void FillThreadSampleDataSampleReports(const CaptureData& capture_data);
+  std::sort(sorted_thread_sample_data.begin(), sorted_thread_sample_data.end(),
+            [](const ThreadSampleData& a, const ThreadSampleData& b) {
+              return a.samples_count > b.samples_count;
+            });
 
-  // Filled by ProcessSamples.
-  absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
-  absl::flat_hash_map<uint64_t, CallstackInfo> id_to_resolved_callstack_;
-  absl::flat_hash_map<CallstackInfoAsClass, uint64_t, CallstackInfoHash, CallstackInfoEq>
-      resolved_callstack_to_id_;
-  absl::flat_hash_map<uint64_t, uint64_t> original_id_to_resolved_callstack_id_;
-  absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
-      function_address_to_sampled_callstack_ids_;
-  absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
-  std::vector<ThreadSampleData> sorted_thread_sample_data_;
-};
+  return PostProcessedSamplingData(
+      std::move(thread_id_to_sample_data), std::move(resolved_callstacks),
+      std::move(original_id_to_resolved_callstack_id),
+      std::move(function_address_to_sampled_callstack_ids), std::move(sorted_thread_sample_data));
+}
 
 }  // namespace
 
 PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
                                                           const CaptureData& capture_data,
                                                           bool generate_summary) {
-  return SamplingDataPostProcessor{}.ProcessSamples(callstack_data, capture_data, generate_summary);
-}
-
-namespace {
-PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
-    const CallstackData& callstack_data, const CaptureData& capture_data, bool generate_summary) {
-  // Unique call stacks and per thread data
+  IncrementalSamplingDataPostProcessor post_processor{generate_summary};
   callstack_data.ForEachCallstackEvent(
-      [this, &callstack_data, generate_summary](const CallstackEvent& event) {
+      [&post_processor, &callstack_data](const CallstackEvent& event) {
         CHECK(callstack_data.HasCallstack(event.callstack_id()));
-        const orbit_client_protos::CallstackInfo* callstack_info =
-            callstack_data.GetCallstack(event.callstack_id());
-
-        // For non-kComplete callstacks, only use the innermost frame for statistics, as it's the
-        // only one known to be correct. Note that, in the vast majority of cases, the innermost
-        // frame is also the only one available.
-        absl::flat_hash_set<uint64_t> unique_frames;
-        CHECK(!callstack_info->frames().empty());
-        if (callstack_info->type() == CallstackInfo::kComplete) {
-          for (uint64_t frame : callstack_info->frames()) {
-            unique_frames.insert(frame);
-          }
-        } else {
-          unique_frames.insert(callstack_info->frames(0));
-        }
-
-        ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[event.thread_id()];
-        thread_sample_data->samples_count++;
-        thread_sample_data->sampled_callstack_id_to_count[event.callstack_id()]++;
-        for (uint64_t frame : unique_frames) {
-          thread_sample_data->sampled_address_to_count[frame]++;
-        }
-
-        if (!generate_summary) {
-          return;
-        }
-        ThreadSampleData* all_thread_sample_data =
-            &thread_id_to_sample_data_[orbit_base::kAllProcessThreadsTid];
-        all_thread_sample_data->samples_count++;
-        all_thread_sample_data->sampled_callstack_id_to_count[event.callstack_id()]++;
-        for (uint64_t frame : unique_frames) {
-          all_thread_sample_data->sampled_address_to_count[frame]++;
-        }
+        post_processor.AddCallstackEvent(event, *callstack_data.GetCallstack(event.callstack_id()));
       });
+  return std::move(post_processor).CreatePostProcessedSamplingData(callstack_data, capture_data);
+}
 
-  ResolveCallstacks(callstack_data, capture_data);
-
-  for (auto& sample_data_it : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &sample_data_it.second;
-
-    // Address count per sample per thread
-    for (const auto& [sampled_callstack_id, callstack_count] :
-         thread_sample_data->sampled_callstack_id_to_count) {
-      uint64_t resolved_callstack_id = original_id_to_resolved_callstack_id_[sampled_callstack_id];
-      const CallstackInfo& resolved_callstack = id_to_resolved_callstack_[resolved_callstack_id];
+PostProcessedSamplingData CreatePostProcessedSamplingDataFromCallstackCounts(
+    const CallstackData& callstack_data,
+    const absl::flat_hash_map<ThreadID, absl::flat_hash_map<uint64_t, uint32_t>>&
+        thread_id_to_callstack_id_to_count,
+    const CaptureData& capture_data, bool generate_summary) {
+  IncrementalSamplingDataPostProcessor post_processor{generate_summary};
+  for (const auto& [thread_id, callstack_id_to_count] : thread_id_to_callstack_id_to_count) {
+    for (const auto& [callstack_id, count] : callstack_id_to_count) {
+      const orbit_client_protos::CallstackInfo* callstack_info =
+          callstack_data.GetCallstack(callstack_id);
+      if (callstack_info == nullptr) {
+        ERROR("Ignoring samples of unknown callstack %u", callstack_id);
+        continue;
+      }
+      post_processor.AddCallstackCount(thread_id, callstack_id, *callstack_info, count);
+    }
+  }
+  return std::move(post_processor).CreatePostProcessedSamplingData(callstack_data, capture_data);
+}
 
-      // "Exclusive" stat.
-      CHECK(!resolved_callstack.frames().empty());
-      thread_sample_data->resolved_address_to_exclusive_count[resolved_callstack.frames(0)] +=
-          callstack_count;
+std::optional<PostProcessedSamplingData> CreatePostProcessedSamplingDataInParallel(
+    absl::Span<const CallstackEvent> callstack_events, const CallstackData& callstack_data,
+    const CaptureData& capture_data, ThreadPool* thread_pool, bool generate_summary,
+    const std::atomic<bool>* cancelled) {
+  auto is_cancelled = [cancelled] {
+    return cancelled != nullptr && cancelled->load(std::memory_order_relaxed);
+  };
+
+  const size_t number_of_threads_available = thread_pool->GetPoolSize();
+  constexpr size_t kNumberOfTasksPerThread = 4;
+  const size_t target_number_of_tasks = kNumberOfTasksPerThread * number_of_threads_available;
+
+  // Below this, scheduling and merging costs more than counting on the calling thread.
+  constexpr size_t kMinimumNumberOfEventsPerTask = 16 * 1024;
+  const size_t number_of_events_per_task =
+      std::max(kMinimumNumberOfEventsPerTask, callstack_events.size() / target_number_of_tasks);
+  const size_t number_of_tasks_needed =
+      callstack_events.size() / number_of_events_per_task +
+      ((callstack_events.size() % number_of_events_per_task) > 0 ? 1 : 0);
+
+  // Each task only writes to its own post-processor.
+  std::vector<IncrementalSamplingDataPostProcessor> post_processors(
+      std::max<size_t>(number_of_tasks_needed, 1),
+      IncrementalSamplingDataPostProcessor{generate_summary});
+  auto count_events = [&callstack_events, &callstack_data, &is_cancelled](
+                          size_t begin, size_t end,
+                          IncrementalSamplingDataPostProcessor* post_processor) {
+    for (size_t index = begin; index < end; ++index) {
+      if (is_cancelled()) return;
+      const CallstackEvent& event = callstack_events[index];
+      const CallstackInfo* callstack_info = callstack_data.GetCallstack(event.callstack_id());
+      CHECK(callstack_info != nullptr);
+      post_processor->AddCallstackEvent(event, *callstack_info);
+    }
+  };
+
+  if (number_of_tasks_needed <= 1) {
+    count_events(0, callstack_events.size(), &post_processors[0]);
+  } else {
+    std::vector<orbit_base::Future<void>> task_futures;
+    task_futures.reserve(number_of_tasks_needed);
+    for (size_t task_idx = 0; task_idx < number_of_tasks_needed; ++task_idx) {
+      const size_t begin = task_idx * number_of_events_per_task;
+      const size_t end =
+          std::min((task_idx + 1) * number_of_events_per_task, callstack_events.size());
+      IncrementalSamplingDataPostProcessor* post_processor = &post_processors[task_idx];
+      task_futures.emplace_back(thread_pool->Schedule([&count_events, begin, end, post_processor] {
+        count_events(begin, end, post_processor);
+      }));
+    }
+    orbit_base::JoinFutures(absl::MakeConstSpan(task_futures)).Wait();
+  }
+  if (is_cancelled()) return std::nullopt;
 
-      absl::flat_hash_set<uint64_t> unique_resolved_addresses;
-      if (resolved_callstack.type() == CallstackInfo::kComplete) {
-        for (uint64_t resolved_address : resolved_callstack.frames()) {
-          unique_resolved_addresses.insert(resolved_address);
-        }
-      } else {
-        // For non-kComplete callstacks, only use the innermost frame for statistics.
-        unique_resolved_addresses.insert(resolved_callstack.frames(0));
-      }
+  for (size_t i = 1; i < post_processors.size(); ++i) {
+    post_processors[0].MergeSamplesFrom(post_processors[i]);
+  }
+  if (is_cancelled()) return std::nullopt;
+  return std::move(post_processors[0]).CreatePostProcessedSamplingData(callstack_data,
+                                                                       capture_data);
+}
 
-      // "Inclusive" stat.
-      for (uint64_t resolved_address : unique_resolved_addresses) {
-        thread_sample_data->resolved_address_to_count[resolved_address] += callstack_count;
-      }
+void IncrementalSamplingDataPostProcessor::AddCallstackEvent(const CallstackEvent& event,
+                                                             const CallstackInfo& callstack_info) {
+  constexpr uint64_t kNsPerOffCpuCount = 1000;
+  uint32_t count = 1;
+  if (event.off_cpu_duration_ns() != 0) {
+    count = static_cast<uint32_t>(
+        std::max<uint64_t>(event.off_cpu_duration_ns() / kNsPerOffCpuCount, 1));
+  } else if (event.memory_event_count() != 0) {
+    count = static_cast<uint32_t>(event.memory_event_count());
+  }
+  AddCallstackCount(event.thread_id(), event.callstack_id(), callstack_info, count);
+}
 
-      // "Unwind errors" stat.
-      if (resolved_callstack.type() != CallstackInfo::kComplete) {
-        thread_sample_data->resolved_address_to_error_count[resolved_callstack.frames(0)] +=
-            callstack_count;
-      }
+void IncrementalSamplingDataPostProcessor::AddCallstackCount(ThreadID thread_id,
+                                                             uint64_t callstack_id,
+                                                             const CallstackInfo& callstack_info,
+                                                             uint32_t count) {
+  // For non-kComplete callstacks, only use the innermost frame for statistics, as it's the only one
+  // known to be correct. Note that, in the vast majority of cases, the innermost frame is also the
+  // only one available.
+  absl::flat_hash_set<uint64_t> unique_frames;
+  CHECK(!callstack_info.frames().empty());
+  if (callstack_info.type() == CallstackInfo::kComplete) {
+    for (uint64_t frame : callstack_info.frames()) {
+      unique_frames.insert(frame);
     }
+  } else {
+    unique_frames.insert(callstack_info.frames(0));
+  }
 
-    // For each thread, sort resolved (function) addresses by inclusive count.
-    for (const auto& address_count_it : thread_sample_data->resolved_address_to_count) {
-      const uint64_t address = address_count_it.first;
-      const uint32_t count = address_count_it.second;
-      thread_sample_data->sorted_count_to_resolved_address.insert(std::make_pair(count, address));
+  auto add_to_thread = [this, callstack_id, count, &unique_frames](ThreadID tid) {
+    ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[tid];
+    thread_sample_data->samples_count += count;
+    thread_sample_data->sampled_callstack_id_to_count[callstack_id] += count;
+    for (uint64_t frame : unique_frames) {
+      thread_sample_data->sampled_address_to_count[frame] += count;
     }
+    pending_thread_id_to_callstack_id_to_count_[tid][callstack_id] += count;
+  };
+
+  add_to_thread(thread_id);
+  if (generate_summary_) {
+    add_to_thread(orbit_base::kAllProcessThreadsTid);
   }
+}
 
-  FillThreadSampleDataSampleReports(capture_data);
+void IncrementalSamplingDataPostProcessor::MergeSamplesFrom(
+    const IncrementalSamplingDataPostProcessor& other) {
+  CHECK(generate_summary_ == other.generate_summary_);
+  for (const auto& [thread_id, other_thread_sample_data] : other.thread_id_to_sample_data_) {
+    ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[thread_id];
+    thread_sample_data->samples_count += other_thread_sample_data.samples_count;
+    absl::flat_hash_map<uint64_t, uint32_t>* pending_callstack_id_to_count =
+        &pending_thread_id_to_callstack_id_to_count_[thread_id];
+    for (const auto& [callstack_id, count] :
+         other_thread_sample_data.sampled_callstack_id_to_count) {
+      thread_sample_data->sampled_callstack_id_to_count[callstack_id] += count;
+      (*pending_callstack_id_to_count)[callstack_id] += count;
+    }
+    for (const auto& [address, count] : other_thread_sample_data.sampled_address_to_count) {
+      thread_sample_data->sampled_address_to_count[address] += count;
+    }
+  }
+}
 
-  SortByThreadUsage();
+PostProcessedSamplingData IncrementalSamplingDataPostProcessor::CreatePostProcessedSamplingData(
+    const CallstackData& callstack_data, const CaptureData& capture_data) & {
+  UpdateResolvedCounts(callstack_data, capture_data);
+  return BuildPostProcessedSamplingData(thread_id_to_sample_data_, resolved_callstacks_,
+                                        original_id_to_resolved_callstack_id_,
+                                        function_address_to_sampled_callstack_ids_, capture_data);
+}
 
-  return PostProcessedSamplingData(
-      std::move(thread_id_to_sample_data_), std::move(id_to_resolved_callstack_),
+PostProcessedSamplingData IncrementalSamplingDataPostProcessor::CreatePostProcessedSamplingData(
+    const CallstackData& callstack_data, const CaptureData& capture_data) && {
+  UpdateResolvedCounts(callstack_data, capture_data);
+  return BuildPostProcessedSamplingData(
+      std::move(thread_id_to_sample_data_), std::move(resolved_callstacks_),
       std::move(original_id_to_resolved_callstack_id_),
-      std::move(function_address_to_sampled_callstack_ids_), std::move(sorted_thread_sample_data_));
+      std::move(function_address_to_sampled_callstack_ids_), capture_data);
+}
+
+void IncrementalSamplingDataPostProcessor::InvalidateResolvedCallstacks() {
+  resolved_callstacks_ = CallstackPool{};
+  resolved_callstack_to_id_.clear();
+  original_id_to_resolved_callstack_id_.clear();
+  function_address_to_sampled_callstack_ids_.clear();
+  exact_address_to_function_address_.clear();
+  resolved_address_to_module_index_.clear();
+  module_paths_.clear();
+  module_path_to_index_.clear();
+
+  // All the samples need to be aggregated again by resolved address.
+  pending_thread_id_to_callstack_id_to_count_.clear();
+  for (auto& [thread_id, thread_sample_data] : thread_id_to_sample_data_) {
+    thread_sample_data.resolved_address_to_count.clear();
+    thread_sample_data.resolved_address_to_exclusive_count.clear();
+    thread_sample_data.resolved_address_to_error_count.clear();
+    thread_sample_data.resolved_module_path_to_count.clear();
+    thread_sample_data.resolved_module_path_to_exclusive_count.clear();
+    thread_sample_data.resolved_module_path_to_error_count.clear();
+    pending_thread_id_to_callstack_id_to_count_[thread_id] =
+        thread_sample_data.sampled_callstack_id_to_count;
+  }
 }
 
-void SamplingDataPostProcessor::SortByThreadUsage() {
-  sorted_thread_sample_data_.reserve(thread_id_to_sample_data_.size());
+void IncrementalSamplingDataPostProcessor::UpdateResolvedCounts(
+    const CallstackData& callstack_data, const CaptureData& capture_data) {
+  ResolveCallstacks(callstack_data, capture_data);
 
-  for (auto& pair : thread_id_to_sample_data_) {
-    ThreadSampleData& data = pair.second;
-    data.thread_id = pair.first;
-    sorted_thread_sample_data_.push_back(data);
+  for (const auto& [thread_id, callstack_id_to_count] :
+       pending_thread_id_to_callstack_id_to_count_) {
+    ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[thread_id];
+    for (const auto& [callstack_id, count] : callstack_id_to_count) {
+      AddResolvedCallstackCount(thread_sample_data, callstack_id, count);
+    }
+  }
+  pending_thread_id_to_callstack_id_to_count_.clear();
+}
+
+void IncrementalSamplingDataPostProcessor::AddResolvedCallstackCount(
+    ThreadSampleData* thread_sample_data, uint64_t callstack_id, uint32_t count) {
+  auto resolved_callstack_id_it = original_id_to_resolved_callstack_id_.find(callstack_id);
+  CHECK(resolved_callstack_id_it != original_id_to_resolved_callstack_id_.end());
+  const CallstackView resolved_callstack =
+      resolved_callstacks_.Get(resolved_callstack_id_it->second);
+
+  // "Exclusive" stat.
+  CHECK(!resolved_callstack.frames().empty());
+  thread_sample_data->resolved_address_to_exclusive_count[resolved_callstack.frames(0)] += count;
+  const std::string& innermost_module_path =
+      module_paths_[GetResolvedModuleIndex(resolved_callstack.frames(0))];
+  thread_sample_data->resolved_module_path_to_exclusive_count[innermost_module_path] += count;
+
+  absl::flat_hash_set<uint64_t> unique_resolved_addresses;
+  if (resolved_callstack.type() == CallstackInfo::kComplete) {
+    for (uint64_t resolved_address : resolved_callstack.frames()) {
+      unique_resolved_addresses.insert(resolved_address);
+    }
+  } else {
+    // For non-kComplete callstacks, only use the innermost frame for statistics.
+    unique_resolved_addresses.insert(resolved_callstack.frames(0));
   }
 
-  sort(sorted_thread_sample_data_.begin(), sorted_thread_sample_data_.end(),
-       [](const ThreadSampleData& a, const ThreadSampleData& b) {
-         return a.samples_count > b.samples_count;
-       });
+  // "Inclusive" stat. A module counts once per callstack, however many of its functions are in it.
+  absl::flat_hash_set<size_t> unique_module_indices;
+  for (uint64_t resolved_address : unique_resolved_addresses) {
+    thread_sample_data->resolved_address_to_count[resolved_address] += count;
+    unique_module_indices.insert(GetResolvedModuleIndex(resolved_address));
+  }
+  for (size_t module_index : unique_module_indices) {
+    thread_sample_data->resolved_module_path_to_count[module_paths_[module_index]] += count;
+  }
+
+  // "Unwind errors" stat.
+  if (resolved_callstack.type() != CallstackInfo::kComplete) {
+    thread_sample_data->resolved_address_to_error_count[resolved_callstack.frames(0)] += count;
+    thread_sample_data->resolved_module_path_to_error_count[innermost_module_path] += count;
+  }
+}
+
+size_t IncrementalSamplingDataPostProcessor::GetResolvedModuleIndex(
+    uint64_t resolved_address) const {
+  auto it = resolved_address_to_module_index_.find(resolved_address);
+  CHECK(it != resolved_address_to_module_index_.end());
+  return it->second;
 }
 
-void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data,
-                                                  const CaptureData& capture_data) {
+void IncrementalSamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data,
+                                                             const CaptureData& capture_data) {
+  MapAddressesToFunctionAddresses(callstack_data, capture_data);
+
   callstack_data.ForEachUniqueCallstack([this, &capture_data](uint64_t callstack_id,
                                                               const CallstackInfo& callstack) {
+    // Callstacks resolved for a previous report keep their resolution.
+    if (original_id_to_resolved_callstack_id_.contains(callstack_id)) return;
+
     // A "resolved callstack" is a callstack where every address is replaced by the start address of
     // the function (if known).
     std::vector<uint64_t> resolved_callstack_frames;
 
     for (uint64_t address : callstack.frames()) {
-      if (!exact_address_to_function_address_.contains(address)) {
-        MapAddressToFunctionAddress(address, capture_data);
-      }
       auto function_address_it = exact_address_to_function_address_.find(address);
       CHECK(function_address_it != exact_address_to_function_address_.end());
       resolved_callstack_frames.push_back(function_address_it->second);
     }
 
+    // The module of each function is looked up once, so that the per-module counts can be updated
+    // with a hash map lookup per frame.
+    for (uint64_t function_address : resolved_callstack_frames) {
+      if (resolved_address_to_module_index_.contains(function_address)) continue;
+      const std::string& module_path = capture_data.GetModulePathByAddress(function_address);
+      auto [module_it, inserted] =
+          module_path_to_index_.try_emplace(module_path, module_paths_.size());
+      if (inserted) module_paths_.push_back(module_path);
+      resolved_address_to_module_index_.emplace(function_address, module_it->second);
+    }
+
     if (callstack.type() == CallstackInfo::kComplete) {
       for (uint64_t function_address : resolved_callstack_frames) {
         // Create a new entry if it doesn't exist.
@@ -279,13 +469,8 @@ void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack
         resolved_callstack_frames, resolved_callstack_type});
     if (it == resolved_callstack_to_id_.end()) {
       resolved_callstack_id = callstack_id;
-      CHECK(!id_to_resolved_callstack_.contains(resolved_callstack_id));
-
-      CallstackInfo resolved_callstack;
-      *resolved_callstack.mutable_frames() = {resolved_callstack_frames.begin(),
-                                              resolved_callstack_frames.end()};
-      resolved_callstack.set_type(resolved_callstack_type);
-      id_to_resolved_callstack_.insert_or_assign(resolved_callstack_id, resolved_callstack);
+      resolved_callstacks_.Add(resolved_callstack_id, resolved_callstack_frames,
+                               resolved_callstack_type);
 
       resolved_callstack_to_id_.emplace(
           CallstackInfoAsClass{resolved_callstack_frames, resolved_callstack_type},
@@ -298,58 +483,31 @@ void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack
   });
 }
 
-void SamplingDataPostProcessor::MapAddressToFunctionAddress(uint64_t absolute_address,
-                                                            const CaptureData& capture_data) {
-  // SamplingDataPostProcessor relies heavily on the association between address and function
-  // address held by exact_address_to_function_address_, otherwise each address is considered a
-  // different function. We are storing this mapping for faster lookup.
-  std::optional<uint64_t> absolute_function_address_option =
-      capture_data.FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(absolute_address);
-  uint64_t absolute_function_address = absolute_function_address_option.value_or(absolute_address);
-
-  exact_address_to_function_address_[absolute_address] = absolute_function_address;
-}
-
-void SamplingDataPostProcessor::FillThreadSampleDataSampleReports(const CaptureData& capture_data) {
-  for (auto& data : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &data.second;
-    std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_functions;
-
-    for (auto sorted_it = thread_sample_data->sorted_count_to_resolved_address.rbegin();
-         sorted_it != thread_sample_data->sorted_count_to_resolved_address.rend(); ++sorted_it) {
-      uint32_t num_occurrences = sorted_it->first;
-      uint64_t absolute_address = sorted_it->second;
-
-      SampledFunction function;
-      function.name = capture_data.GetFunctionNameByAddress(absolute_address);
-
-      function.inclusive = num_occurrences;
-      function.inclusive_percent = 100.f * num_occurrences / thread_sample_data->samples_count;
-
-      function.exclusive = 0;
-      function.exclusive_percent = 0.f;
-
-      if (auto it = thread_sample_data->resolved_address_to_exclusive_count.find(absolute_address);
-          it != thread_sample_data->resolved_address_to_exclusive_count.end()) {
-        function.exclusive = it->second;
-        function.exclusive_percent = 100.f * it->second / thread_sample_data->samples_count;
-      }
-
-      function.unwind_errors = 0;
-      function.unwind_errors_percent = 0.f;
-      if (auto it = thread_sample_data->resolved_address_to_error_count.find(absolute_address);
-          it != thread_sample_data->resolved_address_to_error_count.end()) {
-        function.unwind_errors = it->second;
-        function.unwind_errors_percent = 100.f * it->second / thread_sample_data->samples_count;
-      }
-      function.absolute_address = absolute_address;
-      function.module_path = capture_data.GetModulePathByAddress(absolute_address);
+void IncrementalSamplingDataPostProcessor::MapAddressesToFunctionAddresses(
+    const CallstackData& callstack_data, const CaptureData& capture_data) {
+  // IncrementalSamplingDataPostProcessor relies heavily on the association between address and
+  // function address held by exact_address_to_function_address_, otherwise each address is
+  // considered a different function. We are storing this mapping for faster lookup. The new
+  // addresses are resolved all at once, which is much faster than one by one.
+  std::vector<uint64_t> absolute_addresses;
+  callstack_data.ForEachUniqueCallstack(
+      [this, &absolute_addresses](uint64_t callstack_id, const CallstackInfo& callstack) {
+        if (original_id_to_resolved_callstack_id_.contains(callstack_id)) return;
+        for (uint64_t address : callstack.frames()) {
+          // Each address is unresolved, i.e., mapped to itself, until resolved below.
+          if (exact_address_to_function_address_.try_emplace(address, address).second) {
+            absolute_addresses.push_back(address);
+          }
+        }
+      });
 
-      sampled_functions->push_back(function);
-    }
+  std::vector<std::optional<uint64_t>> absolute_function_addresses =
+      capture_data.FindFunctionAbsoluteAddressesByInstructionAbsoluteAddresses(absolute_addresses);
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    if (!absolute_function_addresses[i].has_value()) continue;
+    exact_address_to_function_address_[absolute_addresses[i]] =
+        absolute_function_addresses[i].value();
   }
 }
 
-}  // namespace
-
 }  // namespace orbit_client_model
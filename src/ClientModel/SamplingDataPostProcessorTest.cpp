@@ -2,23 +2,32 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "ClientData/ModuleManager.h"
 #include "ClientModel/CaptureData.h"
 #include "ClientModel/SamplingDataPostProcessor.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
 #include "capture_data.pb.h"
 
 using orbit_client_data::CallstackCount;
 using orbit_client_data::ModuleManager;
 using orbit_client_data::PostProcessedSamplingData;
 using orbit_client_data::SampledFunction;
+using orbit_client_data::SampledModule;
 using orbit_client_data::SortedCallstackReport;
+using orbit_client_data::ThreadID;
 using orbit_client_data::ThreadSampleData;
 
 using orbit_client_protos::CallstackEvent;
@@ -42,6 +51,7 @@ SampledFunction MakeSampledFunction(std::string name, std::string module_path, u
                                     float unwind_errors_percent, uint64_t absolute_address) {
   SampledFunction sampled_function;
   sampled_function.name = std::move(name);
+  sampled_function.module_name = std::filesystem::path(module_path).filename().string();
   sampled_function.module_path = std::move(module_path);
   sampled_function.exclusive = exclusive;
   sampled_function.exclusive_percent = exclusive_percent;
@@ -56,7 +66,8 @@ SampledFunction MakeSampledFunction(std::string name, std::string module_path, u
 
 bool SampledFunctionsAreEqual(const SampledFunction& lhs, const SampledFunction& rhs) {
   return lhs.name == rhs.name && lhs.module_path == rhs.module_path &&
-         lhs.exclusive == rhs.exclusive && lhs.exclusive_percent == rhs.exclusive_percent &&
+         lhs.module_name == rhs.module_name && lhs.exclusive == rhs.exclusive &&
+         lhs.exclusive_percent == rhs.exclusive_percent &&
          lhs.inclusive == rhs.inclusive && lhs.inclusive_percent == rhs.inclusive_percent &&
          lhs.unwind_errors == rhs.unwind_errors &&
          lhs.unwind_errors_percent == rhs.unwind_errors_percent &&
@@ -69,6 +80,36 @@ MATCHER_P(SampledFunctionEq, that, "") {
   return SampledFunctionsAreEqual(lhs, rhs);
 }
 
+bool SampledModulesAreEqual(const SampledModule& lhs, const SampledModule& rhs) {
+  return lhs.module_path == rhs.module_path && lhs.module_name == rhs.module_name &&
+         lhs.exclusive == rhs.exclusive && lhs.exclusive_percent == rhs.exclusive_percent &&
+         lhs.inclusive == rhs.inclusive && lhs.inclusive_percent == rhs.inclusive_percent &&
+         lhs.unwind_errors == rhs.unwind_errors &&
+         lhs.unwind_errors_percent == rhs.unwind_errors_percent;
+}
+
+MATCHER_P(SampledModuleEq, that, "") {
+  const SampledModule& lhs = arg;
+  const SampledModule& rhs = that;
+  return SampledModulesAreEqual(lhs, rhs);
+}
+
+SampledModule MakeSampledModule(std::string module_path, std::string module_name,
+                                uint32_t exclusive, float exclusive_percent, uint32_t inclusive,
+                                float inclusive_percent, uint32_t unwind_errors,
+                                float unwind_errors_percent) {
+  SampledModule sampled_module;
+  sampled_module.module_path = std::move(module_path);
+  sampled_module.module_name = std::move(module_name);
+  sampled_module.exclusive = exclusive;
+  sampled_module.exclusive_percent = exclusive_percent;
+  sampled_module.inclusive = inclusive;
+  sampled_module.inclusive_percent = inclusive_percent;
+  sampled_module.unwind_errors = unwind_errors;
+  sampled_module.unwind_errors_percent = unwind_errors_percent;
+  return sampled_module;
+}
+
 MATCHER_P(ThreadSampleDataEq, that, "") {
   const ThreadSampleData& lhs = arg;
   const ThreadSampleData& rhs = that;
@@ -77,10 +118,17 @@ MATCHER_P(ThreadSampleDataEq, that, "") {
          lhs.sampled_address_to_count == rhs.sampled_address_to_count &&
          lhs.resolved_address_to_count == rhs.resolved_address_to_count &&
          lhs.resolved_address_to_exclusive_count == rhs.resolved_address_to_exclusive_count &&
+         lhs.resolved_module_path_to_count == rhs.resolved_module_path_to_count &&
+         lhs.resolved_module_path_to_exclusive_count ==
+             rhs.resolved_module_path_to_exclusive_count &&
+         lhs.resolved_module_path_to_error_count == rhs.resolved_module_path_to_error_count &&
          lhs.sorted_count_to_resolved_address == rhs.sorted_count_to_resolved_address &&
          std::equal(lhs.sampled_functions.begin(), lhs.sampled_functions.end(),
                     rhs.sampled_functions.begin(), rhs.sampled_functions.end(),
-                    SampledFunctionsAreEqual);
+                    SampledFunctionsAreEqual) &&
+         std::equal(lhs.sampled_modules.begin(), lhs.sampled_modules.end(),
+                    rhs.sampled_modules.begin(), rhs.sampled_modules.end(),
+                    SampledModulesAreEqual);
 }
 
 SortedCallstackReport MakeSortedCallstackReport(
@@ -146,11 +194,16 @@ class SamplingDataPostProcessorTest : public ::testing::Test {
   }
 
   void AddCallstackEvent(uint64_t callstack_id, int32_t thread_id) {
-    current_callstack_timestamp_ns_ += 100;
     CallstackEvent callstack_event;
-    callstack_event.set_time(current_callstack_timestamp_ns_);
     callstack_event.set_callstack_id(callstack_id);
     callstack_event.set_thread_id(thread_id);
+    AddCallstackEvent(std::move(callstack_event));
+  }
+
+  // Sets the time of `callstack_event`, after the one of the previous event.
+  void AddCallstackEvent(CallstackEvent callstack_event) {
+    current_callstack_timestamp_ns_ += 100;
+    callstack_event.set_time(current_callstack_timestamp_ns_);
     capture_data_.AddCallstackEvent(std::move(callstack_event));
   }
 
@@ -363,28 +416,28 @@ class SamplingDataPostProcessorTest : public ::testing::Test {
 
   void VerifyAllCallstackInfos(CallstackInfo::CallstackType expected_callstack_type) {
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_1 =
+      const orbit_client_data::CallstackView resolved_callstack_1 =
           ppsd_.GetResolvedCallstack(kCallstack1Id);
       EXPECT_THAT(resolved_callstack_1.frames(), Pointwise(Eq(), kCallstack1ResolvedFrames));
       EXPECT_EQ(resolved_callstack_1.type(), expected_callstack_type);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_2 =
+      const orbit_client_data::CallstackView resolved_callstack_2 =
           ppsd_.GetResolvedCallstack(kCallstack2Id);
       EXPECT_THAT(resolved_callstack_2.frames(), Pointwise(Eq(), kCallstack2ResolvedFrames));
       EXPECT_EQ(resolved_callstack_2.type(), expected_callstack_type);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_3 =
+      const orbit_client_data::CallstackView resolved_callstack_3 =
           ppsd_.GetResolvedCallstack(kCallstack3Id);
       EXPECT_THAT(resolved_callstack_3.frames(), Pointwise(Eq(), kCallstack3ResolvedFrames));
       EXPECT_EQ(resolved_callstack_3.type(), expected_callstack_type);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_4 =
+      const orbit_client_data::CallstackView resolved_callstack_4 =
           ppsd_.GetResolvedCallstack(kCallstack4Id);
       EXPECT_THAT(resolved_callstack_4.frames(), Pointwise(Eq(), kCallstack4ResolvedFrames));
       EXPECT_EQ(resolved_callstack_4.type(), expected_callstack_type);
@@ -393,28 +446,28 @@ class SamplingDataPostProcessorTest : public ::testing::Test {
 
   void VerifyAllCallstackInfosWithMixedCallstackTypes() {
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_1 =
+      const orbit_client_data::CallstackView resolved_callstack_1 =
           ppsd_.GetResolvedCallstack(kCallstack1Id);
       EXPECT_THAT(resolved_callstack_1.frames(), Pointwise(Eq(), kCallstack1ResolvedFrames));
       EXPECT_EQ(resolved_callstack_1.type(), CallstackInfo::kDwarfUnwindingError);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_2 =
+      const orbit_client_data::CallstackView resolved_callstack_2 =
           ppsd_.GetResolvedCallstack(kCallstack2Id);
       EXPECT_THAT(resolved_callstack_2.frames(), Pointwise(Eq(), kCallstack2ResolvedFrames));
       EXPECT_EQ(resolved_callstack_2.type(), CallstackInfo::kComplete);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_3 =
+      const orbit_client_data::CallstackView resolved_callstack_3 =
           ppsd_.GetResolvedCallstack(kCallstack3Id);
       EXPECT_THAT(resolved_callstack_3.frames(), Pointwise(Eq(), kCallstack3ResolvedFrames));
       EXPECT_EQ(resolved_callstack_3.type(), CallstackInfo::kComplete);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_4 =
+      const orbit_client_data::CallstackView resolved_callstack_4 =
           ppsd_.GetResolvedCallstack(kCallstack4Id);
       EXPECT_THAT(resolved_callstack_4.frames(), Pointwise(Eq(), kCallstack4ResolvedFrames));
       EXPECT_EQ(resolved_callstack_4.type(), CallstackInfo::kFilteredByMajorityOutermostFrame);
@@ -424,28 +477,28 @@ class SamplingDataPostProcessorTest : public ::testing::Test {
   void VerifyAllCallstackInfoWithoutAddressInfos(
       CallstackInfo::CallstackType expected_callstack_type) {
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_1 =
+      const orbit_client_data::CallstackView resolved_callstack_1 =
           ppsd_.GetResolvedCallstack(kCallstack1Id);
       EXPECT_THAT(resolved_callstack_1.frames(), Pointwise(Eq(), kCallstack1Frames));
       EXPECT_EQ(resolved_callstack_1.type(), expected_callstack_type);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_2 =
+      const orbit_client_data::CallstackView resolved_callstack_2 =
           ppsd_.GetResolvedCallstack(kCallstack2Id);
       EXPECT_THAT(resolved_callstack_2.frames(), Pointwise(Eq(), kCallstack2Frames));
       EXPECT_EQ(resolved_callstack_2.type(), expected_callstack_type);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_3 =
+      const orbit_client_data::CallstackView resolved_callstack_3 =
           ppsd_.GetResolvedCallstack(kCallstack3Id);
       EXPECT_THAT(resolved_callstack_3.frames(), Pointwise(Eq(), kCallstack3Frames));
       EXPECT_EQ(resolved_callstack_3.type(), expected_callstack_type);
     }
 
     {
-      const orbit_client_protos::CallstackInfo& resolved_callstack_4 =
+      const orbit_client_data::CallstackView resolved_callstack_4 =
           ppsd_.GetResolvedCallstack(kCallstack4Id);
       EXPECT_THAT(resolved_callstack_4.frames(), Pointwise(Eq(), kCallstack4Frames));
       EXPECT_EQ(resolved_callstack_4.type(), expected_callstack_type);
@@ -1697,4 +1750,356 @@ TEST_F(SamplingDataPostProcessorTest, TwoThreadsWithSummaryWithMixedCallstackTyp
   VerifyEmptySortedCallstackReport(kThreadIdNotSampled);
 }
 
+TEST_F(SamplingDataPostProcessorTest, CallstackCountsGiveTheSameResultAsCallstackEvents) {
+  AddAllCallstackInfosWithMixedCallstackTypes();
+  AddAllAddressInfos();
+
+  AddCallstackEventsInThreadId1And2();
+
+  absl::flat_hash_map<ThreadID, absl::flat_hash_map<uint64_t, uint32_t>>
+      thread_id_to_callstack_id_to_count;
+  capture_data_.GetCallstackData()->ForEachCallstackEvent(
+      [&thread_id_to_callstack_id_to_count](const CallstackEvent& event) {
+        ++thread_id_to_callstack_id_to_count[event.thread_id()][event.callstack_id()];
+      });
+  // Counts of unknown callstacks are ignored.
+  constexpr uint64_t kUnknownCallstackId = 99;
+  thread_id_to_callstack_id_to_count[kThreadId1][kUnknownCallstackId] = 10;
+
+  CreatePostProcessedSamplingDataWithSummary();
+  PostProcessedSamplingData ppsd_from_counts = CreatePostProcessedSamplingDataFromCallstackCounts(
+      *capture_data_.GetCallstackData(), thread_id_to_callstack_id_to_count, capture_data_);
+
+  // Only the order of the addresses with the same count can differ.
+  auto expect_same_counts = [](const ThreadSampleData* actual, const ThreadSampleData* expected) {
+    ASSERT_NE(actual, nullptr);
+    ASSERT_NE(expected, nullptr);
+    EXPECT_EQ(actual->samples_count, expected->samples_count);
+    EXPECT_EQ(actual->sampled_callstack_id_to_count, expected->sampled_callstack_id_to_count);
+    EXPECT_EQ(actual->sampled_address_to_count, expected->sampled_address_to_count);
+    EXPECT_EQ(actual->resolved_address_to_count, expected->resolved_address_to_count);
+    EXPECT_EQ(actual->resolved_address_to_exclusive_count,
+              expected->resolved_address_to_exclusive_count);
+    EXPECT_EQ(actual->resolved_address_to_error_count, expected->resolved_address_to_error_count);
+    EXPECT_EQ(actual->sampled_functions.size(), expected->sampled_functions.size());
+  };
+  expect_same_counts(ppsd_from_counts.GetSummary(), ppsd_.GetSummary());
+  for (ThreadID thread_id : {kThreadId1, kThreadId2}) {
+    expect_same_counts(ppsd_from_counts.GetThreadSampleDataByThreadId(thread_id),
+                       ppsd_.GetThreadSampleDataByThreadId(thread_id));
+  }
+  EXPECT_EQ(ppsd_from_counts.GetThreadSampleData().size(), ppsd_.GetThreadSampleData().size());
+
+  ppsd_ = std::move(ppsd_from_counts);
+  VerifyAllCallstackInfosWithMixedCallstackTypes();
+  VerifyGetCountOfFunctionWithMixedCallstackTypes();
+}
+
+TEST_F(SamplingDataPostProcessorTest, OffCpuCallstackEventsAreWeightedByTheirDuration) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+
+  // One regular sample, which is kept apart from the off-CPU callstacks.
+  AddCallstackEvent(kCallstack1Id, kThreadId1);
+
+  auto add_off_cpu_callstack_event = [this](uint64_t callstack_id, uint64_t duration_ns) {
+    CallstackEvent callstack_event;
+    callstack_event.set_callstack_id(callstack_id);
+    callstack_event.set_thread_id(kThreadId1);
+    callstack_event.set_off_cpu_duration_ns(duration_ns);
+    AddCallstackEvent(std::move(callstack_event));
+  };
+  add_off_cpu_callstack_event(kCallstack1Id, 3'000'000);
+  add_off_cpu_callstack_event(kCallstack2Id, 1'000'000);
+  // Shorter than a microsecond, still counted once.
+  add_off_cpu_callstack_event(kCallstack2Id, 10);
+
+  EXPECT_EQ(capture_data_.GetCallstackData()->GetCallstackEventsCount(), 1);
+  EXPECT_EQ(capture_data_.GetOffCpuCallstackData()->GetCallstackEventsCount(), 3);
+
+  ppsd_ = CreatePostProcessedSamplingData(*capture_data_.GetOffCpuCallstackData(), capture_data_,
+                                          /*generate_summary=*/false);
+
+  const ThreadSampleData* thread_sample_data = ppsd_.GetThreadSampleDataByThreadId(kThreadId1);
+  ASSERT_NE(thread_sample_data, nullptr);
+  EXPECT_EQ(thread_sample_data->samples_count, 4001);
+  EXPECT_THAT(thread_sample_data->sampled_callstack_id_to_count,
+              UnorderedElementsAre(std::make_pair(kCallstack1Id, 3000),
+                                   std::make_pair(kCallstack2Id, 1001)));
+  EXPECT_EQ(thread_sample_data->resolved_address_to_exclusive_count.at(
+                kFunction3StartAbsoluteAddress),
+            3000);
+  EXPECT_EQ(thread_sample_data->resolved_address_to_exclusive_count.at(
+                kFunction4StartAbsoluteAddress),
+            1001);
+  EXPECT_EQ(thread_sample_data->resolved_address_to_count.at(kFunction1StartAbsoluteAddress),
+            4001);
+}
+
+TEST_F(SamplingDataPostProcessorTest, MemoryCallstackEventsAreWeightedByTheirEventCount) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+
+  // One regular sample, which is kept apart from the memory callstacks.
+  AddCallstackEvent(kCallstack1Id, kThreadId1);
+
+  auto add_memory_callstack_event = [this](uint64_t callstack_id,
+                                           CallstackEvent::MemoryEventType memory_event_type,
+                                           uint64_t memory_event_count) {
+    CallstackEvent callstack_event;
+    callstack_event.set_callstack_id(callstack_id);
+    callstack_event.set_thread_id(kThreadId1);
+    callstack_event.set_memory_event_type(memory_event_type);
+    callstack_event.set_memory_event_count(memory_event_count);
+    AddCallstackEvent(std::move(callstack_event));
+  };
+  add_memory_callstack_event(kCallstack1Id, CallstackEvent::kPageFault, 100);
+  add_memory_callstack_event(kCallstack2Id, CallstackEvent::kMmap, 1);
+  add_memory_callstack_event(kCallstack2Id, CallstackEvent::kBrk, 1);
+
+  EXPECT_EQ(capture_data_.GetCallstackData()->GetCallstackEventsCount(), 1);
+  EXPECT_EQ(capture_data_.GetOffCpuCallstackData()->GetCallstackEventsCount(), 0);
+  EXPECT_EQ(capture_data_.GetMemoryCallstackData()->GetCallstackEventsCount(), 3);
+
+  ppsd_ = CreatePostProcessedSamplingData(*capture_data_.GetMemoryCallstackData(), capture_data_,
+                                          /*generate_summary=*/false);
+
+  const ThreadSampleData* thread_sample_data = ppsd_.GetThreadSampleDataByThreadId(kThreadId1);
+  ASSERT_NE(thread_sample_data, nullptr);
+  EXPECT_EQ(thread_sample_data->samples_count, 102);
+  EXPECT_THAT(thread_sample_data->sampled_callstack_id_to_count,
+              UnorderedElementsAre(std::make_pair(kCallstack1Id, 100),
+                                   std::make_pair(kCallstack2Id, 2)));
+  EXPECT_EQ(thread_sample_data->resolved_address_to_count.at(kFunction1StartAbsoluteAddress),
+            102);
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalPostProcessingGivesTheSameResultAsAllAtOnce) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+
+  AddCallstackEventsAllInThreadId1();
+
+  std::vector<CallstackEvent> events;
+  capture_data_.GetCallstackData()->ForEachCallstackEvent(
+      [&events](const CallstackEvent& event) { events.push_back(event); });
+  ASSERT_EQ(events.size(), 5);
+
+  const orbit_client_data::CallstackData& callstack_data = *capture_data_.GetCallstackData();
+  IncrementalSamplingDataPostProcessor post_processor{/*generate_summary=*/true};
+  auto add_events = [&post_processor, &callstack_data, &events](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      post_processor.AddCallstackEvent(events[i],
+                                       *callstack_data.GetCallstack(events[i].callstack_id()));
+    }
+  };
+
+  add_events(0, 2);
+  ppsd_ = post_processor.CreatePostProcessedSamplingData(callstack_data, capture_data_);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  EXPECT_EQ(ppsd_.GetThreadSampleDataByThreadId(kThreadId1)->samples_count, 2);
+  EXPECT_EQ(ppsd_.GetCountOfFunction(kFunction4StartAbsoluteAddress), 0);
+
+  add_events(2, events.size());
+  ppsd_ = post_processor.CreatePostProcessedSamplingData(callstack_data, capture_data_);
+
+  VerifyAllCallstackInfos(CallstackInfo::kComplete);
+  ASSERT_NE(ppsd_.GetSummary(), nullptr);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(*ppsd_.GetSummary(),
+                                                             orbit_base::kAllProcessThreadsTid);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1), kThreadId1);
+  VerifyGetCountOfFunction();
+  VerifySortedCallstackReportForCallstackEventsAllInTheSameThread(kThreadId1);
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalPostProcessingAfterInvalidation) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+
+  AddCallstackEventsAllInThreadId1();
+
+  const orbit_client_data::CallstackData& callstack_data = *capture_data_.GetCallstackData();
+  IncrementalSamplingDataPostProcessor post_processor{/*generate_summary=*/true};
+  callstack_data.ForEachCallstackEvent(
+      [&post_processor, &callstack_data](const CallstackEvent& event) {
+        post_processor.AddCallstackEvent(event, *callstack_data.GetCallstack(event.callstack_id()));
+      });
+
+  ppsd_ = post_processor.CreatePostProcessedSamplingData(callstack_data, capture_data_);
+  VerifyAllCallstackInfoWithoutAddressInfos(CallstackInfo::kComplete);
+  VerifyGetCountOfFunctionWithoutAddressInfos();
+
+  // Symbols become available: the callstacks need to be resolved again.
+  AddAllAddressInfos();
+  post_processor.InvalidateResolvedCallstacks();
+  ppsd_ = std::move(post_processor).CreatePostProcessedSamplingData(callstack_data, capture_data_);
+
+  VerifyAllCallstackInfos(CallstackInfo::kComplete);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1), kThreadId1);
+  VerifyGetCountOfFunction();
+}
+
+TEST_F(SamplingDataPostProcessorTest, SamplesAreAggregatedByModule) {
+  static const std::string kModuleAPath = "/path/to/module_a";
+  static const std::string kModuleBPath = "/path/to/module_b";
+  AddAddressInfo(kModuleAPath, kFunction1Name, kFunction1Instruction1AbsoluteAddress,
+                 kFunction1Instruction1OffsetInFunction);
+  AddAddressInfo(kModuleAPath, kFunction2Name, kFunction2Instruction1AbsoluteAddress,
+                 kFunction2Instruction1OffsetInFunction);
+  AddAddressInfo(kModuleBPath, kFunction3Name, kFunction3Instruction1AbsoluteAddress,
+                 kFunction3Instruction1OffsetInFunction);
+  AddAddressInfo(kModuleBPath, kFunction3Name, kFunction3Instruction2AbsoluteAddress,
+                 kFunction3Instruction2OffsetInFunction);
+  AddAddressInfo(kModuleBPath, kFunction4Name, kFunction4Instruction1AbsoluteAddress,
+                 kFunction4Instruction1OffsetInFunction);
+  AddAllCallstackInfosWithMixedCallstackTypes();
+
+  AddCallstackEventsAllInThreadId1();
+
+  CreatePostProcessedSamplingDataWithSummary();
+
+  // See AddCallstackEventsAllInThreadId1: module_b is in all the (effective) callstacks, and always
+  // as the innermost frame, while module_a is only in the callstacks 2 and 3.
+  for (ThreadID thread_id : {orbit_base::kAllProcessThreadsTid, kThreadId1}) {
+    const ThreadSampleData* thread_sample_data = ppsd_.GetThreadSampleDataByThreadId(thread_id);
+    ASSERT_NE(thread_sample_data, nullptr);
+    EXPECT_THAT(thread_sample_data->resolved_module_path_to_count,
+                UnorderedElementsAre(std::make_pair(kModuleAPath, 2),
+                                     std::make_pair(kModuleBPath, 5)));
+    EXPECT_THAT(thread_sample_data->resolved_module_path_to_exclusive_count,
+                UnorderedElementsAre(std::make_pair(kModuleBPath, 5)));
+    EXPECT_THAT(thread_sample_data->resolved_module_path_to_error_count,
+                UnorderedElementsAre(std::make_pair(kModuleBPath, 3)));
+    EXPECT_THAT(
+        thread_sample_data->sampled_modules,
+        ElementsAre(SampledModuleEq(MakeSampledModule(kModuleBPath, "module_b", 5, 100.0f, 5,
+                                                      100.0f, 3, 60.0f)),
+                    SampledModuleEq(MakeSampledModule(kModuleAPath, "module_a", 0, 0.0f, 2, 40.0f,
+                                                      0, 0.0f))));
+    for (const SampledFunction& sampled_function : thread_sample_data->sampled_functions) {
+      EXPECT_EQ(sampled_function.module_name,
+                std::filesystem::path(sampled_function.module_path).filename().string());
+    }
+  }
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalPostProcessingUpdatesTheModuleCounts) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+
+  AddCallstackEventsAllInThreadId1();
+
+  std::vector<CallstackEvent> events;
+  capture_data_.GetCallstackData()->ForEachCallstackEvent(
+      [&events](const CallstackEvent& event) { events.push_back(event); });
+  ASSERT_EQ(events.size(), 5);
+
+  const orbit_client_data::CallstackData& callstack_data = *capture_data_.GetCallstackData();
+  IncrementalSamplingDataPostProcessor post_processor{/*generate_summary=*/false};
+  auto add_events = [&post_processor, &callstack_data, &events](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      post_processor.AddCallstackEvent(events[i],
+                                       *callstack_data.GetCallstack(events[i].callstack_id()));
+    }
+  };
+
+  add_events(0, 2);
+  ppsd_ = post_processor.CreatePostProcessedSamplingData(callstack_data, capture_data_);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  EXPECT_THAT(ppsd_.GetThreadSampleDataByThreadId(kThreadId1)->sampled_modules,
+              ElementsAre(SampledModuleEq(
+                  MakeSampledModule(kModulePath, "module", 2, 100.0f, 2, 100.0f, 0, 0.0f))));
+
+  add_events(2, events.size());
+  ppsd_ = post_processor.CreatePostProcessedSamplingData(callstack_data, capture_data_);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  EXPECT_THAT(ppsd_.GetThreadSampleDataByThreadId(kThreadId1)->sampled_modules,
+              ElementsAre(SampledModuleEq(
+                  MakeSampledModule(kModulePath, "module", 5, 100.0f, 5, 100.0f, 0, 0.0f))));
+
+  post_processor.InvalidateResolvedCallstacks();
+  ppsd_ = post_processor.CreatePostProcessedSamplingData(callstack_data, capture_data_);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  EXPECT_THAT(ppsd_.GetThreadSampleDataByThreadId(kThreadId1)->sampled_modules,
+              ElementsAre(SampledModuleEq(
+                  MakeSampledModule(kModulePath, "module", 5, 100.0f, 5, 100.0f, 0, 0.0f))));
+}
+
+TEST_F(SamplingDataPostProcessorTest, ParallelPostProcessingGivesTheSameResultAsSequential) {
+  AddAllCallstackInfosWithMixedCallstackTypes();
+  AddAllAddressInfos();
+
+  // Enough events to be split into several tasks.
+  static constexpr uint64_t kRepetitions = 10'000;
+  std::vector<CallstackEvent> events;
+  for (uint64_t i = 0; i < kRepetitions; ++i) {
+    for (const auto& [callstack_id, thread_id] :
+         std::vector<std::pair<uint64_t, int32_t>>{{kCallstack1Id, kThreadId1},
+                                                   {kCallstack2Id, kThreadId1},
+                                                   {kCallstack1Id, kThreadId2},
+                                                   {kCallstack3Id, kThreadId2},
+                                                   {kCallstack4Id, kThreadId2}}) {
+      CallstackEvent event;
+      event.set_time(events.size());
+      event.set_callstack_id(callstack_id);
+      event.set_thread_id(thread_id);
+      events.push_back(std::move(event));
+    }
+  }
+
+  const orbit_client_data::CallstackData& callstack_data = *capture_data_.GetCallstackData();
+  IncrementalSamplingDataPostProcessor sequential_post_processor{/*generate_summary=*/true};
+  for (const CallstackEvent& event : events) {
+    sequential_post_processor.AddCallstackEvent(
+        event, *callstack_data.GetCallstack(event.callstack_id()));
+  }
+  PostProcessedSamplingData sequential_ppsd =
+      std::move(sequential_post_processor)
+          .CreatePostProcessedSamplingData(callstack_data, capture_data_);
+
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Milliseconds(50));
+  std::optional<PostProcessedSamplingData> parallel_ppsd =
+      CreatePostProcessedSamplingDataInParallel(events, callstack_data, capture_data_,
+                                                thread_pool.get());
+  thread_pool->ShutdownAndWait();
+  ASSERT_TRUE(parallel_ppsd.has_value());
+
+  EXPECT_EQ(parallel_ppsd->GetThreadSampleData().size(), 3);
+  for (ThreadID thread_id : {orbit_base::kAllProcessThreadsTid, kThreadId1, kThreadId2}) {
+    const ThreadSampleData* actual = parallel_ppsd->GetThreadSampleDataByThreadId(thread_id);
+    const ThreadSampleData* expected = sequential_ppsd.GetThreadSampleDataByThreadId(thread_id);
+    ASSERT_NE(actual, nullptr);
+    ASSERT_NE(expected, nullptr);
+    EXPECT_EQ(actual->samples_count, expected->samples_count);
+    EXPECT_EQ(actual->sampled_callstack_id_to_count, expected->sampled_callstack_id_to_count);
+    EXPECT_EQ(actual->sampled_address_to_count, expected->sampled_address_to_count);
+    EXPECT_EQ(actual->resolved_address_to_count, expected->resolved_address_to_count);
+    EXPECT_EQ(actual->resolved_address_to_exclusive_count,
+              expected->resolved_address_to_exclusive_count);
+    EXPECT_EQ(actual->resolved_address_to_error_count, expected->resolved_address_to_error_count);
+  }
+  EXPECT_EQ(parallel_ppsd->GetSummary()->samples_count, 5 * kRepetitions);
+}
+
+TEST_F(SamplingDataPostProcessorTest, ParallelPostProcessingCanBeCancelled) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+  AddCallstackEventsAllInThreadId1();
+
+  std::vector<CallstackEvent> events;
+  capture_data_.GetCallstackData()->ForEachCallstackEvent(
+      [&events](const CallstackEvent& event) { events.push_back(event); });
+
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(1, 1, absl::Milliseconds(50));
+  std::atomic<bool> cancelled = true;
+  EXPECT_FALSE(CreatePostProcessedSamplingDataInParallel(events, *capture_data_.GetCallstackData(),
+                                                         capture_data_, thread_pool.get(),
+                                                         /*generate_summary=*/true, &cancelled)
+                   .has_value());
+  thread_pool->ShutdownAndWait();
+}
+
 }  // namespace orbit_client_model
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_MODEL_CAPTURE_COMPARISON_H_
+#define CLIENT_MODEL_CAPTURE_COMPARISON_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ClientData/PostProcessedSamplingData.h"
+#include "ClientModel/CaptureData.h"
+#include "capture_data.pb.h"
+
+// Comparisons of a baseline capture with another capture of the same program, e.g., for A/B
+// performance comparisons. Addresses and function ids differ between runs, so functions are matched
+// by function name and module build id.
+namespace orbit_client_model {
+
+struct SampledFunctionComparison {
+  std::string function_name;
+  std::string module_path;
+  std::string module_build_id;
+  // In percent of all the samples of the capture, zero if the function was not sampled.
+  float baseline_inclusive_percent = 0.f;
+  float baseline_exclusive_percent = 0.f;
+  float comparison_inclusive_percent = 0.f;
+  float comparison_exclusive_percent = 0.f;
+
+  [[nodiscard]] float GetInclusivePercentDelta() const {
+    return comparison_inclusive_percent - baseline_inclusive_percent;
+  }
+  [[nodiscard]] float GetExclusivePercentDelta() const {
+    return comparison_exclusive_percent - baseline_exclusive_percent;
+  }
+};
+
+// Compares the summaries (see PostProcessedSamplingData::GetSummary) of the sampling data of two
+// captures, so the sampling data need to be created with `generate_summary`. Functions whose name
+// is not known are left out, as they can't be matched. The result is sorted by function name and
+// module build id.
+[[nodiscard]] std::vector<SampledFunctionComparison> CompareSampledFunctions(
+    const orbit_client_data::PostProcessedSamplingData& baseline_sampling_data,
+    const CaptureData& baseline_capture_data,
+    const orbit_client_data::PostProcessedSamplingData& comparison_sampling_data,
+    const CaptureData& comparison_capture_data);
+
+struct FunctionStatsComparison {
+  std::string function_name;
+  std::string module_path;
+  std::string module_build_id;
+  // Empty if the function was not instrumented or not called in that capture.
+  orbit_client_protos::FunctionStats baseline_stats;
+  orbit_client_protos::FunctionStats comparison_stats;
+
+  // The difference between the durations that `percentile` (in [0, 1]) of the calls don't exceed,
+  // or std::nullopt if either capture has no calls or no duration histogram for the function.
+  [[nodiscard]] std::optional<int64_t> GetDurationPercentileDeltaNs(double percentile) const;
+};
+
+// Compares the statistics of the calls of the instrumented functions of two captures. The result
+// is sorted by function name and module build id.
+[[nodiscard]] std::vector<FunctionStatsComparison> CompareFunctionStats(
+    const CaptureData& baseline_capture_data, const CaptureData& comparison_capture_data);
+
+}  // namespace orbit_client_model
+
+#endif  // CLIENT_MODEL_CAPTURE_COMPARISON_H_
@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
 #include <chrono>
@@ -20,6 +21,7 @@
 #include <utility>
 #include <vector>
 
+#include "ClientData/AppendOnlyIntervalIndex.h"
 #include "ClientData/CallstackData.h"
 #include "ClientData/FunctionInfoSet.h"
 #include "ClientData/ModuleData.h"
@@ -62,6 +64,10 @@ class CaptureData {
       const orbit_client_protos::FunctionInfo& function) const;
 
   [[nodiscard]] int32_t process_id() const;
+  // Returns whether `pid` is the target process or one of the additional processes of the capture.
+  [[nodiscard]] bool IsCapturedProcess(int32_t pid) const {
+    return pid == process_id() || additional_pids_.contains(pid);
+  }
 
   [[nodiscard]] std::string process_name() const;
 
@@ -82,6 +88,12 @@ class CaptureData {
   [[nodiscard]] const std::string& GetFunctionNameByAddress(uint64_t absolute_address) const;
   [[nodiscard]] std::optional<uint64_t> FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(
       uint64_t absolute_address) const;
+  // Like FindFunctionAbsoluteAddressByInstructionAbsoluteAddress for each of `absolute_addresses`.
+  // The addresses are grouped by module, so that each module is found once and resolves all its
+  // addresses at once.
+  [[nodiscard]] std::vector<std::optional<uint64_t>>
+  FindFunctionAbsoluteAddressesByInstructionAbsoluteAddresses(
+      absl::Span<const uint64_t> absolute_addresses) const;
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByModulePathBuildIdAndOffset(
       const std::string& module_path, const std::string& build_id, uint64_t offset) const;
   [[nodiscard]] const std::string& GetModulePathByAddress(uint64_t absolute_address) const;
@@ -112,24 +124,16 @@ class CaptureData {
     thread_names_.insert_or_assign(thread_id, std::move(thread_name));
   }
 
-  [[nodiscard]] const absl::flat_hash_map<int32_t,
-                                          std::vector<orbit_client_protos::ThreadStateSliceInfo>>&
-  thread_state_slices() const {
-    return thread_state_slices_;
-  }
-
   [[nodiscard]] bool HasThreadStatesForThread(int32_t tid) const {
-    absl::MutexLock lock{thread_state_slices_mutex_.get()};
-    return thread_state_slices_.count(tid) > 0;
+    return FindThreadStateSlices(tid) != nullptr;
   }
 
-  void AddThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo state_slice) {
-    absl::MutexLock lock{thread_state_slices_mutex_.get()};
-    thread_state_slices_[state_slice.tid()].emplace_back(std::move(state_slice));
-  }
+  // Slices can be added concurrently, also to the same thread, and while they are being read.
+  void AddThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo state_slice);
 
-  // Allows the caller to iterate `action` over all the thread state slices of the specified thread
-  // in the time range while holding for the whole time the internal mutex, acquired only once.
+  // Calls `action` for the thread state slices of the specified thread in the time range, in
+  // order. This doesn't lock, so slices (also of the same thread) can be added in the meantime;
+  // those are not visited.
   void ForEachThreadStateSliceIntersectingTimeRange(
       int32_t thread_id, uint64_t min_timestamp, uint64_t max_timestamp,
       const std::function<void(const orbit_client_protos::ThreadStateSliceInfo&)>& action) const;
@@ -143,11 +147,36 @@ class CaptureData {
       uint64_t instrumented_function_id) const;
 
   void UpdateFunctionStats(uint64_t instrumented_function_id, uint64_t elapsed_nanos);
+  // Adds the calls of `stats`, e.g., aggregated by the service, to the function statistics.
+  void MergeFunctionStats(uint64_t instrumented_function_id,
+                          const orbit_client_protos::FunctionStats& stats);
+
+  // Replaces the function statistics with the final ones of a capture being loaded, for example
+  // from the CaptureSummary section of the capture file, so that they are available before all the
+  // timers have been loaded. UpdateFunctionStats must not be called after this.
+  void SetPrecomputedFunctionStats(
+      absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionStats> functions_stats) {
+    functions_stats_ = std::move(functions_stats);
+    has_precomputed_function_stats_ = true;
+  }
+  [[nodiscard]] bool has_precomputed_function_stats() const {
+    return has_precomputed_function_stats_;
+  }
 
   [[nodiscard]] const orbit_client_data::CallstackData* GetCallstackData() const {
     return callstack_data_.get();
   };
 
+  // The callstacks recorded when threads blocked, each with how long the thread stayed off-CPU.
+  [[nodiscard]] const orbit_client_data::CallstackData* GetOffCpuCallstackData() const {
+    return off_cpu_callstack_data_.get();
+  };
+
+  // The callstacks recorded on page faults, mmap and brk, each with how many events it stands for.
+  [[nodiscard]] const orbit_client_data::CallstackData* GetMemoryCallstackData() const {
+    return memory_callstack_data_.get();
+  };
+
   [[nodiscard]] orbit_grpc_protos::TracepointInfo GetTracepointInfo(uint64_t key) const {
     return tracepoint_data_->GetTracepointInfo(key);
   }
@@ -174,6 +203,19 @@ class CaptureData {
   }
 
   void AddCallstackEvent(orbit_client_protos::CallstackEvent callstack_event) {
+    // Off-CPU and memory callstacks refer to the unique callstacks of callstack_data_, but are kept
+    // apart so that they are neither drawn nor aggregated as regular samples.
+    if (callstack_event.off_cpu_duration_ns() != 0) {
+      off_cpu_callstack_data_->AddCallstackFromKnownCallstackData(callstack_event,
+                                                                  callstack_data_.get());
+      return;
+    }
+    if (callstack_event.memory_event_type() !=
+        orbit_client_protos::CallstackEvent::kNoMemoryEvent) {
+      memory_callstack_data_->AddCallstackFromKnownCallstackData(callstack_event,
+                                                                 callstack_data_.get());
+      return;
+    }
     callstack_data_->AddCallstackEvent(std::move(callstack_event));
   }
 
@@ -252,6 +294,10 @@ class CaptureData {
   std::unique_ptr<orbit_client_data::CallstackData> callstack_data_;
   // selection_callstack_data_ is subset of callstack_data_
   std::unique_ptr<orbit_client_data::CallstackData> selection_callstack_data_;
+  // off_cpu_callstack_data_ only holds events, its callstacks are in callstack_data_.
+  std::unique_ptr<orbit_client_data::CallstackData> off_cpu_callstack_data_;
+  // Same for memory_callstack_data_.
+  std::unique_ptr<orbit_client_data::CallstackData> memory_callstack_data_;
 
   std::unique_ptr<orbit_client_data::TracepointData> tracepoint_data_;
 
@@ -260,12 +306,30 @@ class CaptureData {
   absl::flat_hash_map<uint64_t, orbit_client_protos::LinuxAddressInfo> address_infos_;
 
   absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionStats> functions_stats_;
+  bool has_precomputed_function_stats_ = false;
 
   absl::flat_hash_map<int32_t, std::string> thread_names_;
 
-  absl::flat_hash_map<int32_t, std::vector<orbit_client_protos::ThreadStateSliceInfo>>
-      thread_state_slices_;  // For each thread, assume sorted by timestamp and not overlapping.
-  mutable std::unique_ptr<absl::Mutex> thread_state_slices_mutex_ = std::make_unique<absl::Mutex>();
+  struct ThreadStateSliceTraits {
+    static uint64_t GetBegin(const orbit_client_protos::ThreadStateSliceInfo& slice) {
+      return slice.begin_timestamp_ns();
+    }
+    static uint64_t GetEnd(const orbit_client_protos::ThreadStateSliceInfo& slice) {
+      return slice.end_timestamp_ns();
+    }
+  };
+  using ThreadStateSliceIndex =
+      orbit_client_data::AppendOnlyIntervalIndex<orbit_client_protos::ThreadStateSliceInfo,
+                                                 ThreadStateSliceTraits>;
+
+  // Appending to the returned index is thread-safe, hence the non-const pointer.
+  [[nodiscard]] ThreadStateSliceIndex* FindThreadStateSlices(int32_t tid) const;
+
+  // For each thread, assume sorted by timestamp and not overlapping. Indices are never removed, so
+  // they can be used after releasing the mutex, which only protects the map.
+  mutable absl::Mutex thread_state_slices_mutex_;
+  absl::flat_hash_map<int32_t, std::unique_ptr<ThreadStateSliceIndex>> thread_state_slices_
+      ABSL_GUARDED_BY(thread_state_slices_mutex_);
 
   // Only access this field from the main thread.
   orbit_client_data::TimestampIntervalSet incomplete_data_intervals_;
@@ -273,6 +337,7 @@ class CaptureData {
   absl::Time capture_start_time_ = absl::Now();
 
   absl::flat_hash_set<uint64_t> frame_track_function_ids_;
+  absl::flat_hash_set<int32_t> additional_pids_;
 
   std::optional<std::filesystem::path> file_path_;
 };
@@ -0,0 +1,42 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_MODEL_CRITICAL_PATH_H_
+#define CLIENT_MODEL_CRITICAL_PATH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "ClientModel/CaptureData.h"
+
+namespace orbit_client_model {
+
+// The time in [begin_timestamp_ns, end_timestamp_ns] that the critical path spends on a thread.
+struct CriticalPathSegment {
+  int32_t thread_id;
+  uint64_t begin_timestamp_ns;
+  uint64_t end_timestamp_ns;
+
+  friend bool operator==(const CriticalPathSegment& lhs, const CriticalPathSegment& rhs) {
+    return lhs.thread_id == rhs.thread_id && lhs.begin_timestamp_ns == rhs.begin_timestamp_ns &&
+           lhs.end_timestamp_ns == rhs.end_timestamp_ns;
+  }
+};
+
+// Computes the chain of work, across threads, that determined when thread `thread_id` reached
+// `end_timestamp_ns`, e.g., the end of a frame or of a scope, going back to `begin_timestamp_ns`.
+// The thread state slices are followed backwards: when the thread was blocked and then woken up by
+// another thread (see ThreadStateSliceInfo::kUnblocked), the path continues on the waking thread
+// from the moment of the wakeup, so threads that are busy with work nobody waits on are not on it.
+// Blocking that didn't end with a wakeup by a thread with known thread states (e.g., a sleep or an
+// interrupt, which the idle task wakes up from) is attributed to the thread itself.
+// The segments are in chronological order and consecutive segments are on different threads.
+[[nodiscard]] std::vector<CriticalPathSegment> ComputeCriticalPath(const CaptureData& capture_data,
+                                                                   int32_t thread_id,
+                                                                   uint64_t begin_timestamp_ns,
+                                                                   uint64_t end_timestamp_ns);
+
+}  // namespace orbit_client_model
+
+#endif  // CLIENT_MODEL_CRITICAL_PATH_H_
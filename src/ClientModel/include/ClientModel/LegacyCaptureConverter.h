@@ -0,0 +1,46 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_MODEL_LEGACY_CAPTURE_CONVERTER_H_
+#define CLIENT_MODEL_LEGACY_CAPTURE_CONVERTER_H_
+
+#include <absl/types/span.h>
+
+#include <atomic>
+#include <filesystem>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
+
+// Converts captures saved in the legacy format read by capture_deserializer::Load to capture files
+// (see src/CaptureFile/FORMAT.md), which are loaded in parallel and have summary and index
+// sections. The legacy captures otherwise need to be loaded entirely into memory on one thread.
+namespace orbit_client_model::legacy_capture_converter {
+
+// Writes the capture at `legacy_file_path` as a capture file with a compressed capture section at
+// `capture_file_path`, overwriting it if it exists. Only the CaptureInfo message is kept in memory,
+// the timers are streamed from one file to the other. Timers that the client creates itself from
+// other events, like frame tracks, are not written, as are the GPU timers, which can't be turned
+// back into the events they were created from. Fails, without leaving a capture file behind, if the
+// legacy capture can't be read or if `cancellation_requested` is set during the conversion.
+[[nodiscard]] ErrorMessageOr<void> ConvertToCaptureFile(
+    const std::filesystem::path& legacy_file_path, const std::filesystem::path& capture_file_path,
+    std::atomic<bool>* cancellation_requested = nullptr);
+
+struct LegacyCaptureConversion {
+  std::filesystem::path legacy_file_path;
+  std::filesystem::path capture_file_path;
+};
+
+// Converts each of `conversions` as above, one per action scheduled on `thread_pool`, e.g., for an
+// archive of legacy captures. Blocks until all of them are done, and returns their results in the
+// order of `conversions`.
+[[nodiscard]] std::vector<ErrorMessageOr<void>> ConvertToCaptureFiles(
+    absl::Span<const LegacyCaptureConversion> conversions, ThreadPool* thread_pool,
+    std::atomic<bool>* cancellation_requested = nullptr);
+
+}  // namespace orbit_client_model::legacy_capture_converter
+
+#endif  // CLIENT_MODEL_LEGACY_CAPTURE_CONVERTER_H_
@@ -0,0 +1,94 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_MODEL_PERFORMANCE_TRENDS_H_
+#define CLIENT_MODEL_PERFORMANCE_TRENDS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+#include "capture_summary.pb.h"
+#include "performance_trend_index.pb.h"
+
+// Trends of the durations of the instrumented functions across many captures of the same program,
+// e.g., nightly captures, to find the performance regressions between builds. The statistics come
+// from the summary sections of the capture files, collected in a PerformanceTrendIndex, so that
+// hundreds of captures can be compared without loading any of them.
+namespace orbit_client_model {
+
+// Returns an empty index if there is no file at `file_path` yet.
+[[nodiscard]] ErrorMessageOr<orbit_client_protos::PerformanceTrendIndex> LoadPerformanceTrendIndex(
+    const std::filesystem::path& file_path);
+
+[[nodiscard]] ErrorMessageOr<void> SavePerformanceTrendIndex(
+    const orbit_client_protos::PerformanceTrendIndex& index,
+    const std::filesystem::path& file_path);
+
+// Adds the statistics of `capture_summary` to `index`, with the functions of `capture_started`,
+// replacing those of a capture with the same file path if `index` has one.
+void AddCaptureToPerformanceTrendIndex(orbit_client_protos::PerformanceTrendIndex::Capture capture,
+                                       const orbit_grpc_protos::CaptureStarted& capture_started,
+                                       const orbit_client_protos::CaptureSummary& capture_summary,
+                                       orbit_client_protos::PerformanceTrendIndex* index);
+
+// Adds the capture file at `file_path` to `index` as above. Only the CaptureStarted event at the
+// start of the capture section and the CAPTURE_SUMMARY section are read, so the time this takes
+// doesn't depend on the length of the capture. Returns false, without reading the file, if `index`
+// already has it with the same size and modification time. Fails for files without a summary
+// section, saved by older versions of Orbit.
+[[nodiscard]] ErrorMessageOr<bool> AddCaptureFileToPerformanceTrendIndex(
+    const std::filesystem::path& file_path, orbit_client_protos::PerformanceTrendIndex* index);
+
+struct PerformanceTrendPoint {
+  // The index in PerformanceTrendIndex::captures.
+  uint32_t capture_index = 0;
+  std::string module_build_id;
+  uint64_t call_count = 0;
+  // std::nullopt if the statistics have no duration histogram.
+  std::optional<uint64_t> p50_ns;
+  std::optional<uint64_t> p95_ns;
+};
+
+struct FunctionPerformanceTrend {
+  std::string function_name;
+  // The module of the most recent capture.
+  std::string module_path;
+  // The captures in which the function was called, oldest first.
+  std::vector<PerformanceTrendPoint> points;
+  // The relative changes of the percentiles of the most recent capture from their baseline (see
+  // RegressionDetectionOptions), e.g., 0.2 for 20% slower, or std::nullopt if there are not enough
+  // captures to compare with.
+  std::optional<double> p50_change;
+  std::optional<double> p95_change;
+  // Whether either change exceeds RegressionDetectionOptions::regression_threshold.
+  bool is_regression = false;
+};
+
+struct RegressionDetectionOptions {
+  // The baseline of a percentile is its median over up to this many of the most recent captures
+  // before the last one, which tolerates a few noisy captures.
+  size_t baseline_capture_count = 5;
+  size_t min_baseline_capture_count = 3;
+  double regression_threshold = 0.1;
+  // Captures with fewer calls of a function are too noisy for its percentiles to be compared.
+  uint64_t min_call_count = 10;
+};
+
+// Computes the trend of each function of `index`, matching functions across captures by function
+// name and module file name, as the build ids change with every build. Captures are ordered by the
+// modification time of their files. The result has the regressions first, largest change first,
+// then the other functions by name.
+[[nodiscard]] std::vector<FunctionPerformanceTrend> ComputeFunctionPerformanceTrends(
+    const orbit_client_protos::PerformanceTrendIndex& index,
+    const RegressionDetectionOptions& options = {});
+
+}  // namespace orbit_client_model
+
+#endif  // CLIENT_MODEL_PERFORMANCE_TRENDS_H_
@@ -5,14 +5,188 @@
 #ifndef CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 #define CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/hash/hash.h>
+#include <absl/types/span.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "ClientData/CallstackData.h"
+#include "ClientData/CallstackPool.h"
+#include "ClientData/CallstackTypes.h"
 #include "ClientData/PostProcessedSamplingData.h"
 #include "ClientModel/CaptureData.h"
+#include "OrbitBase/ThreadPool.h"
+#include "capture_data.pb.h"
 
 namespace orbit_client_model {
+
+namespace internal {
+
+// class equivalent of orbit_client_protos::CallstackInfo for use as key of absl::flat_hash_map.
+class CallstackInfoAsClass {
+ public:
+  CallstackInfoAsClass(std::vector<uint64_t> frames,
+                       orbit_client_protos::CallstackInfo::CallstackType type)
+      : frames_(std::move(frames)), type_(type) {}
+
+  [[nodiscard]] const std::vector<uint64_t>& frames() const { return frames_; }
+  [[nodiscard]] orbit_client_protos::CallstackInfo::CallstackType type() const { return type_; }
+
+ private:
+  std::vector<uint64_t> frames_;
+  orbit_client_protos::CallstackInfo::CallstackType type_;
+};
+
+template <typename H>
+H AbslHashValue(H h, const CallstackInfoAsClass& o) {
+  return H::combine(std::move(h), o.frames(), o.type());
+}
+
+using CallstackInfoAsPairWithLvalueRefToFrames =
+    std::pair<const std::vector<uint64_t>&, orbit_client_protos::CallstackInfo::CallstackType>;
+
+// CallstackInfoHash and CallstackInfoEq allow heterogeneous lookup in
+// IncrementalSamplingDataPostProcessor::resolved_callstack_to_id_;
+struct CallstackInfoHash {
+  using is_transparent = void;  // Makes this functor transparent, enabling heterogeneous lookup.
+
+  size_t operator()(const CallstackInfoAsClass& o) const {
+    return absl::Hash<CallstackInfoAsClass>{}(o);
+  }
+
+  size_t operator()(const CallstackInfoAsPairWithLvalueRefToFrames& p) const {
+    return absl::Hash<CallstackInfoAsPairWithLvalueRefToFrames>{}(p);
+  }
+};
+
+struct CallstackInfoEq {
+  using is_transparent = void;  // Makes this functor transparent, enabling heterogeneous lookup.
+
+  bool operator()(const CallstackInfoAsClass& lhs, const CallstackInfoAsClass& rhs) const {
+    return std::equal(lhs.frames().begin(), lhs.frames().end(), rhs.frames().begin(),
+                      rhs.frames().end()) &&
+           lhs.type() == rhs.type();
+  }
+
+  bool operator()(const CallstackInfoAsClass& lhs,
+                  const CallstackInfoAsPairWithLvalueRefToFrames& rhs) const {
+    return std::equal(lhs.frames().begin(), lhs.frames().end(), rhs.first.begin(),
+                      rhs.first.end()) &&
+           lhs.type() == rhs.second;
+  }
+};
+
+}  // namespace internal
+
+// Builds PostProcessedSamplingData from callstack samples that are added over time, e.g., while a
+// capture is running, without going over all the samples again each time a report is created.
+// The per-thread counts are updated as samples are added; creating a report only resolves the
+// callstacks that are new since the previous report, applies the counts added in the meantime to
+// the per-function and per-module counts, and sorts.
+//
+// Callstacks are resolved to functions with the modules and symbols of `capture_data` known when
+// they are first resolved. Call InvalidateResolvedCallstacks when these change (e.g., after
+// loading symbols), or when the callstacks themselves change (e.g., after filtering broken
+// callstacks), so that the next report resolves all callstacks again.
+//
+// Thread-Safety: This class is not thread-safe.
+class IncrementalSamplingDataPostProcessor {
+ public:
+  explicit IncrementalSamplingDataPostProcessor(bool generate_summary = true)
+      : generate_summary_{generate_summary} {}
+
+  // Counts a callstack sample. A callstack recorded when the thread blocked counts once per
+  // microsecond off-CPU, and a callstack recorded on a memory event counts once per event it
+  // stands for.
+  void AddCallstackEvent(const orbit_client_protos::CallstackEvent& event,
+                         const orbit_client_protos::CallstackInfo& callstack_info);
+
+  // Counts `count` samples of the callstack `callstack_id` in thread `thread_id`.
+  void AddCallstackCount(orbit_client_data::ThreadID thread_id, uint64_t callstack_id,
+                         const orbit_client_protos::CallstackInfo& callstack_info, uint32_t count);
+
+  // Adds the samples that were added to `other`, which must have the same `generate_summary`. This
+  // allows counting disjoint sets of samples on different threads and combining the results.
+  void MergeSamplesFrom(const IncrementalSamplingDataPostProcessor& other);
+
+  // `callstack_data` must contain the callstacks of all the samples added so far.
+  [[nodiscard]] orbit_client_data::PostProcessedSamplingData CreatePostProcessedSamplingData(
+      const orbit_client_data::CallstackData& callstack_data, const CaptureData& capture_data) &;
+  // Same as above, but moves the accumulated data into the result instead of copying it, for when
+  // no more samples will be added.
+  [[nodiscard]] orbit_client_data::PostProcessedSamplingData CreatePostProcessedSamplingData(
+      const orbit_client_data::CallstackData& callstack_data, const CaptureData& capture_data) &&;
+
+  void InvalidateResolvedCallstacks();
+
+ private:
+  void UpdateResolvedCounts(const orbit_client_data::CallstackData& callstack_data,
+                            const CaptureData& capture_data);
+  void ResolveCallstacks(const orbit_client_data::CallstackData& callstack_data,
+                         const CaptureData& capture_data);
+  void MapAddressesToFunctionAddresses(const orbit_client_data::CallstackData& callstack_data,
+                                       const CaptureData& capture_data);
+  void AddResolvedCallstackCount(orbit_client_data::ThreadSampleData* thread_sample_data,
+                                 uint64_t callstack_id, uint32_t count);
+  [[nodiscard]] size_t GetResolvedModuleIndex(uint64_t resolved_address) const;
+
+  bool generate_summary_;
+
+  // Raw sample counts, and counts per resolved (function) address up to the last report.
+  absl::flat_hash_map<orbit_client_data::ThreadID, orbit_client_data::ThreadSampleData>
+      thread_id_to_sample_data_;
+  // Samples added since the last report, not yet reflected in the counts per resolved address.
+  absl::flat_hash_map<orbit_client_data::ThreadID, absl::flat_hash_map<uint64_t, uint32_t>>
+      pending_thread_id_to_callstack_id_to_count_;
+
+  orbit_client_data::CallstackPool resolved_callstacks_;
+  absl::flat_hash_map<internal::CallstackInfoAsClass, uint64_t, internal::CallstackInfoHash,
+                      internal::CallstackInfoEq>
+      resolved_callstack_to_id_;
+  absl::flat_hash_map<uint64_t, uint64_t> original_id_to_resolved_callstack_id_;
+  absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
+      function_address_to_sampled_callstack_ids_;
+  absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
+  // The module of each resolved address, for the per-module counts, as an index into
+  // `module_paths_`, so that the modules of a callstack are deduplicated without comparing paths.
+  absl::flat_hash_map<uint64_t, size_t> resolved_address_to_module_index_;
+  std::vector<std::string> module_paths_;
+  absl::flat_hash_map<std::string, size_t> module_path_to_index_;
+};
+
 orbit_client_data::PostProcessedSamplingData CreatePostProcessedSamplingData(
     const orbit_client_data::CallstackData& callstack_data, const CaptureData& capture_data,
     bool generate_summary = true);
+
+// Same as above, but from the number of samples of each callstack of each thread, for example from
+// the CaptureSummary section of a capture file, instead of from the callstack events. Only the
+// unique callstacks of `callstack_data` are used.
+orbit_client_data::PostProcessedSamplingData CreatePostProcessedSamplingDataFromCallstackCounts(
+    const orbit_client_data::CallstackData& callstack_data,
+    const absl::flat_hash_map<orbit_client_data::ThreadID,
+                              absl::flat_hash_map<uint64_t, uint32_t>>&
+        thread_id_to_callstack_id_to_count,
+    const CaptureData& capture_data, bool generate_summary = true);
+
+// Same as CreatePostProcessedSamplingData, but for the given `callstack_events`, whose callstacks
+// must be in `callstack_data`. The events are counted in chunks on `thread_pool`, and the partial
+// counts are merged before resolving the callstacks. The calling thread blocks until the result is
+// ready, or returns std::nullopt as soon as possible once `*cancelled` becomes true, e.g., because
+// the data is no longer needed.
+std::optional<orbit_client_data::PostProcessedSamplingData>
+CreatePostProcessedSamplingDataInParallel(
+    absl::Span<const orbit_client_protos::CallstackEvent> callstack_events,
+    const orbit_client_data::CallstackData& callstack_data, const CaptureData& capture_data,
+    ThreadPool* thread_pool, bool generate_summary = true,
+    const std::atomic<bool>* cancelled = nullptr);
 }  // namespace orbit_client_model
 
 #endif  // CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
@@ -4,15 +4,20 @@
 
 #include "ClientServices/ProcessClient.h"
 
+#include <absl/strings/str_format.h>
 #include <grpcpp/grpcpp.h>
+#include <zlib.h>
 
 #include <chrono>
 #include <memory>
+#include <optional>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "Introspection/Introspection.h"
+#include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "services.grpc.pb.h"
 #include "services.pb.h"
@@ -20,6 +25,8 @@
 namespace orbit_client_services {
 namespace {
 
+using orbit_grpc_protos::GetDebugInfoFileContentsRequest;
+using orbit_grpc_protos::GetDebugInfoFileContentsResponse;
 using orbit_grpc_protos::GetDebugInfoFileRequest;
 using orbit_grpc_protos::GetDebugInfoFileResponse;
 using orbit_grpc_protos::GetModuleListRequest;
@@ -32,6 +39,9 @@ using orbit_grpc_protos::ModuleInfo;
 using orbit_grpc_protos::ProcessInfo;
 
 constexpr uint64_t kGrpcDefaultTimeoutMilliseconds = 3000;
+// Debug info files are often hundreds of megabytes, which take minutes over a slow link.
+constexpr uint64_t kDebugInfoFileTransferTimeoutMilliseconds = 60 * 60 * 1000;
+constexpr int kMaxDebugInfoFileTransferAttempts = 3;
 
 std::unique_ptr<grpc::ClientContext> CreateContext(
     uint64_t timeout_milliseconds = kGrpcDefaultTimeoutMilliseconds) {
@@ -47,7 +57,11 @@ std::unique_ptr<grpc::ClientContext> CreateContext(
 
 ErrorMessageOr<std::vector<orbit_grpc_protos::ProcessInfo>> ProcessClient::GetProcessList() {
   ORBIT_SCOPE_FUNCTION;
+  // Held for the whole call, so that concurrent calls apply their changes in order.
+  absl::MutexLock lock(&process_list_mutex_);
   GetProcessListRequest request;
+  request.set_known_process_list_id(process_list_id_);
+  request.set_known_process_list_generation(process_list_generation_);
   GetProcessListResponse response;
   std::unique_ptr<grpc::ClientContext> context = CreateContext();
 
@@ -58,9 +72,24 @@ ErrorMessageOr<std::vector<orbit_grpc_protos::ProcessInfo>> ProcessClient::GetPr
     return ErrorMessage(status.error_message());
   }
 
-  const auto& processes = response.processes();
+  if (!response.contains_only_changes()) {
+    pid_to_process_.clear();
+  }
+  for (int32_t pid : response.removed_pids()) {
+    pid_to_process_.erase(pid);
+  }
+  for (const ProcessInfo& process : response.processes()) {
+    pid_to_process_.insert_or_assign(process.pid(), process);
+  }
+  process_list_id_ = response.process_list_id();
+  process_list_generation_ = response.process_list_generation();
 
-  return std::vector<ProcessInfo>(processes.begin(), processes.end());
+  std::vector<ProcessInfo> processes;
+  processes.reserve(pid_to_process_.size());
+  for (const auto& [unused_pid, process] : pid_to_process_) {
+    processes.push_back(process);
+  }
+  return processes;
 }
 
 ErrorMessageOr<std::vector<ModuleInfo>> ProcessClient::LoadModuleList(int32_t pid) {
@@ -69,6 +98,11 @@ ErrorMessageOr<std::vector<ModuleInfo>> ProcessClient::LoadModuleList(int32_t pi
   GetModuleListResponse response;
   request.set_process_id(pid);
 
+  absl::MutexLock lock(&module_list_mutex_);
+  if (module_list_pid_ == pid) {
+    request.set_known_modules_fingerprint(module_list_fingerprint_);
+  }
+
   std::unique_ptr<grpc::ClientContext> context = CreateContext();
   grpc::Status status = process_service_->GetModuleList(context.get(), request, &response);
 
@@ -77,9 +111,14 @@ ErrorMessageOr<std::vector<ModuleInfo>> ProcessClient::LoadModuleList(int32_t pi
     return ErrorMessage(status.error_message());
   }
 
-  const auto& modules = response.modules();
+  if (!response.modules_unchanged()) {
+    const auto& modules = response.modules();
+    module_list_pid_ = pid;
+    module_list_fingerprint_ = response.modules_fingerprint();
+    module_list_.assign(modules.begin(), modules.end());
+  }
 
-  return std::vector<ModuleInfo>(modules.begin(), modules.end());
+  return module_list_;
 }
 
 ErrorMessageOr<std::string> ProcessClient::FindDebugInfoFile(const std::string& module_path) {
@@ -100,6 +139,101 @@ ErrorMessageOr<std::string> ProcessClient::FindDebugInfoFile(const std::string&
   return response.debug_info_file_path();
 }
 
+ErrorMessageOr<void> ProcessClient::CopyDebugInfoFile(const std::string& module_path,
+                                                     const std::string& build_id,
+                                                     const std::filesystem::path& local_file_path) {
+  ORBIT_SCOPE_FUNCTION;
+  std::filesystem::path partial_file_path = local_file_path;
+  partial_file_path += absl::StrFormat(".%s.part", build_id);
+  // Without a build id, the partial file could belong to another version of the module.
+  if (build_id.empty()) {
+    OUTCOME_TRY(orbit_base::RemoveFile(partial_file_path));
+  }
+
+  ErrorMessage last_error;
+  for (int attempt = 0; attempt < kMaxDebugInfoFileTransferAttempts; ++attempt) {
+    ErrorMessageOr<void> result = ContinueDebugInfoFileTransfer(module_path, partial_file_path);
+    if (result.has_value()) return orbit_base::MoveFile(partial_file_path, local_file_path);
+    ERROR("Transfer of the debug info file of \"%s\" failed: %s", module_path,
+          result.error().message());
+    last_error = result.error();
+  }
+  return last_error;
+}
+
+ErrorMessageOr<void> ProcessClient::ContinueDebugInfoFileTransfer(
+    const std::string& module_path, const std::filesystem::path& partial_file_path) {
+  OUTCOME_TRY(partial_file_exists, orbit_base::FileExists(partial_file_path));
+  uint64_t offset = 0;
+  if (partial_file_exists) {
+    std::error_code error;
+    offset = std::filesystem::file_size(partial_file_path, error);
+    if (error) {
+      return ErrorMessage(absl::StrFormat("Unable to get the size of \"%s\": %s",
+                                          partial_file_path.string(), error.message()));
+    }
+  }
+  OUTCOME_TRY(fd, partial_file_exists ? orbit_base::OpenExistingFileForReadWrite(partial_file_path)
+                                      : orbit_base::OpenNewFileForReadWrite(partial_file_path));
+
+  GetDebugInfoFileContentsRequest request;
+  request.set_module_path(module_path);
+  request.set_offset(offset);
+
+  std::unique_ptr<grpc::ClientContext> context =
+      CreateContext(kDebugInfoFileTransferTimeoutMilliseconds);
+  std::unique_ptr<grpc::ClientReader<GetDebugInfoFileContentsResponse>> reader =
+      process_service_->GetDebugInfoFileContents(context.get(), request);
+  auto cancel_transfer = [&context, &reader](std::string message) {
+    context->TryCancel();
+    (void)reader->Finish();
+    return ErrorMessage(std::move(message));
+  };
+
+  std::optional<uint64_t> file_size;
+  std::string uncompressed_chunk;
+  GetDebugInfoFileContentsResponse response;
+  while (reader->Read(&response)) {
+    if (response.offset() != offset) {
+      return cancel_transfer(absl::StrFormat("Received a chunk at offset %u instead of %u",
+                                             response.offset(), offset));
+    }
+    file_size = response.file_size();
+
+    std::string_view data = response.data();
+    if (response.uncompressed_size() != 0) {
+      uncompressed_chunk.resize(response.uncompressed_size());
+      uLongf uncompressed_size = uncompressed_chunk.size();
+      if (uncompress(reinterpret_cast<Bytef*>(uncompressed_chunk.data()), &uncompressed_size,
+                     reinterpret_cast<const Bytef*>(data.data()), data.size()) != Z_OK ||
+          uncompressed_size != uncompressed_chunk.size()) {
+        return cancel_transfer(absl::StrFormat("Received a corrupted chunk at offset %u", offset));
+      }
+      data = uncompressed_chunk;
+    }
+
+    auto write_result =
+        orbit_base::WriteFullyAtOffset(fd, data.data(), data.size(), static_cast<off_t>(offset));
+    if (write_result.has_error()) return cancel_transfer(write_result.error().message());
+    offset += data.size();
+  }
+
+  grpc::Status status = reader->Finish();
+  fd.release();
+  if (status.error_code() == grpc::StatusCode::OUT_OF_RANGE) {
+    // The file on the instance is smaller than the partial file, so it has changed since.
+    OUTCOME_TRY(orbit_base::RemoveFile(partial_file_path));
+  }
+  if (!status.ok()) {
+    return ErrorMessage(status.error_message());
+  }
+  if (file_size.has_value() && offset != file_size.value()) {
+    return ErrorMessage(absl::StrFormat("Received %u of the %u bytes of the debug info file",
+                                        offset, file_size.value()));
+  }
+  return outcome::success();
+}
+
 ErrorMessageOr<std::string> ProcessClient::LoadProcessMemory(int32_t pid, uint64_t address,
                                                              uint64_t size) {
   ORBIT_SCOPE_FUNCTION;
@@ -48,6 +48,10 @@ class ProcessManagerImpl final : public ProcessManager {
 
   ErrorMessageOr<std::string> FindDebugInfoFile(const std::string& module_path) override;
 
+  ErrorMessageOr<void> CopyDebugInfoFile(const std::string& module_path,
+                                         const std::string& build_id,
+                                         const std::filesystem::path& local_file_path) override;
+
   void Start();
   void ShutdownAndWait() noexcept override;
 
@@ -86,6 +90,12 @@ ErrorMessageOr<std::string> ProcessManagerImpl::FindDebugInfoFile(const std::str
   return process_client_->FindDebugInfoFile(module_path);
 }
 
+ErrorMessageOr<void> ProcessManagerImpl::CopyDebugInfoFile(
+    const std::string& module_path, const std::string& build_id,
+    const std::filesystem::path& local_file_path) {
+  return process_client_->CopyDebugInfoFile(module_path, build_id, local_file_path);
+}
+
 void ProcessManagerImpl::Start() {
   CHECK(!worker_thread_.joinable());
   worker_thread_ = std::thread([this] { WorkerFunction(); });
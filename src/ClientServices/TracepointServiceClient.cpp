@@ -8,6 +8,7 @@
 #include <grpcpp/grpcpp.h>
 
 #include <string>
+#include <string_view>
 
 #include "OrbitBase/Logging.h"
 #include "services.pb.h"
@@ -22,8 +23,10 @@ using orbit_grpc_protos::TracepointService;
 TracepointServiceClient::TracepointServiceClient(const std::shared_ptr<grpc::Channel>& channel)
     : tracepoint_service_(TracepointService::NewStub(channel)) {}
 
-ErrorMessageOr<std::vector<TracepointInfo>> TracepointServiceClient::GetTracepointList() const {
+ErrorMessageOr<std::vector<TracepointInfo>> TracepointServiceClient::GetTracepointList(
+    std::string_view filter) const {
   GetTracepointListRequest request;
+  request.set_filter(std::string{filter});
   GetTracepointListResponse response;
 
   std::unique_ptr<grpc::ClientContext> context = std::make_unique<grpc::ClientContext>();
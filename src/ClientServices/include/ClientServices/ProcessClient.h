@@ -5,9 +5,13 @@
 #ifndef CLIENT_SERVICES_PROCESS_CLIENT_H_
 #define CLIENT_SERVICES_PROCESS_CLIENT_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
 #include <chrono>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <utility>
@@ -27,18 +31,44 @@ class ProcessClient {
   explicit ProcessClient(const std::shared_ptr<grpc::Channel>& channel)
       : process_service_(orbit_grpc_protos::ProcessService::NewStub(channel)) {}
 
+  // The list of processes is cached, so that the service only needs to send what changed since the
+  // previous call.
   [[nodiscard]] ErrorMessageOr<std::vector<orbit_grpc_protos::ProcessInfo>> GetProcessList();
 
+  // The modules of the last process are cached, so that the service doesn't need to create and send
+  // them again when they didn't change.
   [[nodiscard]] ErrorMessageOr<std::vector<orbit_grpc_protos::ModuleInfo>> LoadModuleList(
       int32_t pid);
 
   [[nodiscard]] ErrorMessageOr<std::string> FindDebugInfoFile(const std::string& module_path);
 
+  // Streams the debug info file of `module_path` to a partial file next to `local_file_path`, which
+  // is moved to `local_file_path` once complete. If the stream breaks, the transfer is resumed
+  // from the end of the partial file, also on a later call with the same `build_id`.
+  [[nodiscard]] ErrorMessageOr<void> CopyDebugInfoFile(
+      const std::string& module_path, const std::string& build_id,
+      const std::filesystem::path& local_file_path);
+
   [[nodiscard]] ErrorMessageOr<std::string> LoadProcessMemory(int32_t pid, uint64_t address,
                                                               uint64_t size);
 
  private:
+  // Appends the rest of the debug info file to the partial file, in a single stream.
+  [[nodiscard]] ErrorMessageOr<void> ContinueDebugInfoFileTransfer(
+      const std::string& module_path, const std::filesystem::path& partial_file_path);
+
   std::unique_ptr<orbit_grpc_protos::ProcessService::Stub> process_service_;
+
+  absl::Mutex process_list_mutex_;
+  absl::flat_hash_map<int32_t, orbit_grpc_protos::ProcessInfo> pid_to_process_
+      ABSL_GUARDED_BY(process_list_mutex_);
+  uint64_t process_list_id_ ABSL_GUARDED_BY(process_list_mutex_) = 0;
+  uint64_t process_list_generation_ ABSL_GUARDED_BY(process_list_mutex_) = 0;
+
+  absl::Mutex module_list_mutex_;
+  int32_t module_list_pid_ ABSL_GUARDED_BY(module_list_mutex_) = 0;
+  uint64_t module_list_fingerprint_ ABSL_GUARDED_BY(module_list_mutex_) = 0;
+  std::vector<orbit_grpc_protos::ModuleInfo> module_list_ ABSL_GUARDED_BY(module_list_mutex_);
 };
 
 }  // namespace orbit_client_services
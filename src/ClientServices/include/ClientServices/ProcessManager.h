@@ -8,6 +8,7 @@
 #include <absl/time/time.h>
 #include <stdint.h>
 
+#include <filesystem>
 #include <functional>
 #include <memory>
 #include <string>
@@ -58,6 +59,12 @@ class ProcessManager {
 
   virtual ErrorMessageOr<std::string> FindDebugInfoFile(const std::string& module_path) = 0;
 
+  // Copies the debug info file of `module_path` to `local_file_path`. An interrupted transfer is
+  // resumed from a partial file next to `local_file_path`, as long as `build_id` is the same.
+  virtual ErrorMessageOr<void> CopyDebugInfoFile(const std::string& module_path,
+                                                 const std::string& build_id,
+                                                 const std::filesystem::path& local_file_path) = 0;
+
   // Note that this method waits for the worker thread to stop, which could
   // take up to refresh_timeout.
   virtual void ShutdownAndWait() = 0;
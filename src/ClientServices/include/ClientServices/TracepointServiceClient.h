@@ -6,6 +6,7 @@
 #define CLIENT_SERVICES_TRACEPOINT_SERVICE_CLIENT_H_
 
 #include <memory>
+#include <string_view>
 #include <vector>
 
 #include "OrbitBase/Result.h"
@@ -20,7 +21,10 @@ class TracepointServiceClient {
   static std::unique_ptr<TracepointServiceClient> Create(
       const std::shared_ptr<grpc::Channel>& channel);
 
-  ErrorMessageOr<std::vector<orbit_grpc_protos::TracepointInfo>> GetTracepointList() const;
+  // If `filter` is not empty, only the tracepoints whose "category:name" contains it, ignoring
+  // case, are returned. The filtering happens on the service.
+  ErrorMessageOr<std::vector<orbit_grpc_protos::TracepointInfo>> GetTracepointList(
+      std::string_view filter = "") const;
 
  private:
   explicit TracepointServiceClient(const std::shared_ptr<grpc::Channel>& channel);
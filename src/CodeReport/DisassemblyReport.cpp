@@ -4,8 +4,48 @@
 
 #include "CodeReport/DisassemblyReport.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace orbit_code_report {
 
+DisassemblyReport::DisassemblyReport(Disassembler disasm, uint64_t absolute_function_address,
+                                     const orbit_client_data::ThreadSampleData& thread_sample_data,
+                                     uint32_t function_count, uint32_t samples_count)
+    : disasm_{std::move(disasm)},
+      num_samples_per_line_(disasm_.GetNumLines(), 0),
+      function_count_{function_count},
+      samples_count_(samples_count),
+      absolute_function_address_{absolute_function_address} {
+  if (function_count_ == 0) return;
+
+  // On calls the address sampled might not be the address of the beginning of the instruction, but
+  // instead at the end. Thus, we attribute the samples of all the addresses that fall into an
+  // instruction to that instruction. As the last instruction can not be a call, only the address
+  // of its beginning is considered for it.
+  std::vector<std::pair<uint64_t, size_t>> instruction_address_to_line;
+  for (size_t line = 0; line < disasm_.GetNumLines(); ++line) {
+    const uint64_t address = disasm_.GetAddressAtLine(line);
+    if (address == 0) continue;
+    instruction_address_to_line.emplace_back(address, line);
+  }
+  if (instruction_address_to_line.empty()) return;
+  std::sort(instruction_address_to_line.begin(), instruction_address_to_line.end());
+
+  const uint64_t begin = instruction_address_to_line.front().first;
+  const uint64_t end = instruction_address_to_line.back().first + 1;
+  for (const auto& [address, count] :
+       thread_sample_data.GetSampledAddressesAndCountsInRange(begin, end)) {
+    // The instruction containing `address` is the last one starting at or before it.
+    auto it = std::upper_bound(
+        instruction_address_to_line.begin(), instruction_address_to_line.end(), address,
+        [](uint64_t sampled_address, const std::pair<uint64_t, size_t>& address_and_line) {
+          return sampled_address < address_and_line.first;
+        });
+    num_samples_per_line_[std::prev(it)->second] += count;
+  }
+}
+
 std::optional<uint32_t> DisassemblyReport::GetNumSamplesAtLine(size_t line) const {
   // The given line number will be 1-indexed, but `Disassembler` works with 0-indexed line numbers.
   line -= 1;
@@ -17,32 +57,11 @@ std::optional<uint32_t> DisassemblyReport::GetNumSamplesAtLine(size_t line) cons
     return std::nullopt;
   }
 
-  if (function_count_ == 0) {
-    return 0;
-  }
-
-  // On calls the address sampled might not be the address of the
-  // beginning of the instruction, but instead at the end. Thus, we
-  // iterate over all addresses that fall into this instruction.
-  uint64_t next_address = disasm_.GetAddressAtLine(line + 1);
-
-  // If the current instruction is the last one (next address is 0), it
-  // can not be a call, thus we can only consider this address.
-  if (next_address == 0) {
-    next_address = address + 1;
-  }
-  if (!thread_sample_data_.has_value()) {
-    return 0.0;
-  }
-  uint32_t count = 0;
-  while (address < next_address) {
-    count += thread_sample_data_->GetCountForAddress(address);
-    address++;
-  }
-  return count;
+  if (line >= num_samples_per_line_.size()) return 0;
+  return num_samples_per_line_[line];
 }
 
 std::optional<size_t> DisassemblyReport::GetLineAtAddress(uint64_t address) const {
   return disasm_.GetLineAtAddress(address);
 }
-}  // namespace orbit_code_report
\ No newline at end of file
+}  // namespace orbit_code_report
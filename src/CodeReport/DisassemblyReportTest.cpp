@@ -104,4 +104,36 @@ TEST(DisassemblyReport, Simple) {
     EXPECT_EQ(disassembly_report.GetNumSamplesAtLine(line_number).value(), 0);
   }
 }
-}  // namespace orbit_code_report
\ No newline at end of file
+
+TEST(DisassemblyReport, SamplesInsideInstructionsAreAttributedToTheInstruction) {
+  orbit_code_report::Disassembler disassembler{};
+  disassembler.Disassemble(static_cast<const void*>(kFibonacciAssembly.data()),
+                           kFibonacciAssembly.size(), kFibonacciAbsoluteAddress, true);
+
+  constexpr size_t kFunctionCount = 7;
+  constexpr size_t kTotalCount = 42;
+
+  orbit_client_data::ThreadSampleData thread_sample_data{};
+  thread_sample_data.samples_count = kTotalCount;
+
+  // Address 0x40104a is the last byte of the call at 0x401046, line 17.
+  thread_sample_data.sampled_address_to_count[kFibonacciAbsoluteAddress + 0x2a] = 3;
+  thread_sample_data.sampled_address_to_count[kFibonacciAbsoluteAddress + 0x26] = 1;
+  // Samples outside of the function are ignored, and so are the ones after the beginning of the
+  // last instruction at 0x40105c, line 27.
+  thread_sample_data.sampled_address_to_count[kFibonacciAbsoluteAddress - 1] = 5;
+  thread_sample_data.sampled_address_to_count[kFibonacciAbsoluteAddress + 0x3d] = 6;
+
+  orbit_code_report::DisassemblyReport disassembly_report{
+      disassembler, kFibonacciAbsoluteAddress, thread_sample_data, kFunctionCount, kTotalCount};
+
+  ASSERT_TRUE(disassembly_report.GetNumSamplesAtLine(17).has_value());
+  EXPECT_EQ(disassembly_report.GetNumSamplesAtLine(17).value(), 4);
+
+  for (int line_number = 2; line_number < 28; ++line_number) {
+    if (line_number == 17) continue;
+    ASSERT_TRUE(disassembly_report.GetNumSamplesAtLine(line_number).has_value()) << line_number;
+    EXPECT_EQ(disassembly_report.GetNumSamplesAtLine(line_number).value(), 0) << line_number;
+  }
+}
+}  // namespace orbit_code_report
@@ -8,6 +8,7 @@
 #include <limits>
 #include <optional>
 
+#include "ClientData/FunctionUtils.h"
 #include "ClientData/PostProcessedSamplingData.h"
 #include "OrbitBase/Logging.h"
 
@@ -19,11 +20,10 @@ SourceCodeReport::SourceCodeReport(std::string_view source_file,
                                    const orbit_client_data::ThreadSampleData& thread_sample_data,
                                    uint32_t total_samples_in_capture)
     : total_samples_in_capture_(total_samples_in_capture) {
-  for (size_t offset = 0; offset < function.size(); ++offset) {
-    const uint32_t current_samples =
-        thread_sample_data.GetCountForAddress(absolute_address + offset);
-    if (current_samples == 0) continue;
-
+  for (const auto& [sampled_address, current_samples] :
+       thread_sample_data.GetSampledAddressesAndCountsInRange(absolute_address,
+                                                              absolute_address + function.size())) {
+    const uint64_t offset = sampled_address - absolute_address;
     const auto maybe_current_line_info = elf_file->GetLineInfo(function.address() + offset);
     if (!maybe_current_line_info.has_value()) continue;
 
@@ -32,7 +32,7 @@ SourceCodeReport::SourceCodeReport(std::string_view source_file,
       ERROR(
           "Was trying to gather sampling data for function \"%s\" but the debug information "
           "tells me the function address %#x is defined in a different source file.",
-          function.pretty_name(), function.address() + offset);
+          orbit_client_data::function_utils::GetDisplayName(function), function.address() + offset);
       ERROR("Expected: %s", source_file);
       ERROR("Actual: %s", current_line_info.source_file());
       continue;
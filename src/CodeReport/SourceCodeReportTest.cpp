@@ -27,6 +27,8 @@ class MockElfFile : public orbit_object_utils::ElfFile {
   MOCK_METHOD(std::string, GetSoname, (), (const, override));
   MOCK_METHOD(std::string, GetBuildId, (), (const, override));
   MOCK_METHOD(ErrorMessageOr<orbit_grpc_protos::LineInfo>, GetLineInfo, (uint64_t), (override));
+  MOCK_METHOD(ErrorMessageOr<std::vector<orbit_grpc_protos::LineInfo>>, GetInlinedLineInfos,
+              (uint64_t), (override));
   MOCK_METHOD(ErrorMessageOr<orbit_grpc_protos::LineInfo>, GetDeclarationLocationOfFunction,
               (uint64_t), (override));
   MOCK_METHOD(std::optional<orbit_object_utils::GnuDebugLinkInfo>, GetGnuDebugLinkInfo, (),
@@ -21,6 +21,7 @@ class Disassembler {
   void AddLine(std::string, std::optional<uint64_t> address = std::nullopt);
 
   [[nodiscard]] const std::string& GetResult() const { return result_; }
+  [[nodiscard]] size_t GetNumLines() const { return line_to_address_.size(); }
   [[nodiscard]] uint64_t GetAddressAtLine(size_t line) const;
   [[nodiscard]] std::optional<size_t> GetLineAtAddress(uint64_t address) const;
 
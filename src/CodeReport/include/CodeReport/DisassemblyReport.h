@@ -10,6 +10,7 @@
 
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "ClientData/PostProcessedSamplingData.h"
 #include "CodeReport/CodeReport.h"
@@ -18,14 +19,12 @@
 namespace orbit_code_report {
 class DisassemblyReport : public orbit_code_report::CodeReport {
  public:
+  // The number of samples of each instruction is computed here once, so that neither the
+  // ThreadSampleData needs to be kept nor GetNumSamplesAtLine has to look up each of the bytes of
+  // the instruction every time the view is painted.
   DisassemblyReport(Disassembler disasm, uint64_t absolute_function_address,
-                    orbit_client_data::ThreadSampleData thread_sample_data, uint32_t function_count,
-                    uint32_t samples_count)
-      : disasm_{std::move(disasm)},
-        thread_sample_data_{std::move(thread_sample_data)},
-        function_count_{function_count},
-        samples_count_(samples_count),
-        absolute_function_address_{absolute_function_address} {}
+                    const orbit_client_data::ThreadSampleData& thread_sample_data,
+                    uint32_t function_count, uint32_t samples_count);
 
   explicit DisassemblyReport(Disassembler disasm, uint64_t absolute_function_address)
       : disasm_{std::move(disasm)},
@@ -43,7 +42,8 @@ class DisassemblyReport : public orbit_code_report::CodeReport {
 
  private:
   Disassembler disasm_;
-  std::optional<orbit_client_data::ThreadSampleData> thread_sample_data_;
+  // Indexed by the 0-indexed line number of `disasm_`.
+  std::vector<uint32_t> num_samples_per_line_;
   uint32_t function_count_;
   uint32_t samples_count_;
   uint64_t absolute_function_address_;
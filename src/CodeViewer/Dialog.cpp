@@ -8,7 +8,6 @@
 #include <QHBoxLayout>
 #include <QPushButton>
 #include <QSizePolicy>
-#include <QSyntaxHighlighter>
 
 #include "ui_Dialog.h"
 
@@ -28,16 +27,16 @@ Dialog::Dialog(QWidget* parent) : QDialog{parent}, ui_{std::make_unique<Ui::Code
 Dialog::~Dialog() noexcept = default;
 
 void Dialog::SetMainContent(const QString& code) {
+  ui_->viewer->SetSyntaxHighlighter(nullptr);
   ui_->viewer->setPlainText(code);
-  syntax_highlighter_.reset();
   ui_->viewer->document()->setDefaultFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 }
 
-void Dialog::SetMainContent(const QString& code,
-                            std::unique_ptr<QSyntaxHighlighter> syntax_highlighter) {
+void Dialog::SetMainContent(
+    const QString& code,
+    std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> syntax_highlighter) {
   SetMainContent(code);
-  syntax_highlighter_ = std::move(syntax_highlighter);
-  syntax_highlighter_->setDocument(ui_->viewer->document());
+  ui_->viewer->SetSyntaxHighlighter(std::move(syntax_highlighter));
 }
 
 void Dialog::SetHeatmap(FontSizeInEm heatmap_bar_width,
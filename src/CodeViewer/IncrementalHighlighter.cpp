@@ -0,0 +1,150 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CodeViewer/IncrementalHighlighter.h"
+
+#include <QElapsedTimer>
+#include <QTextCharFormat>
+#include <QTextLayout>
+#include <QVector>
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_code_viewer {
+
+// Long enough to highlight a few hundred lines per time slice, short enough for the UI to stay
+// responsive in between.
+constexpr qint64 kBackgroundTimeSliceMs = 10;
+
+constexpr int kNotHighlightedState = -1;
+
+IncrementalHighlighter::IncrementalHighlighter(
+    QTextDocument* document,
+    std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> block_highlighter)
+    : document_{document}, block_highlighter_{std::move(block_highlighter)} {
+  CHECK(document_ != nullptr);
+  CHECK(block_highlighter_ != nullptr);
+
+  // The states might have been set by a previous highlighter.
+  for (QTextBlock block = document_->begin(); block.isValid(); block = block.next()) {
+    block.setUserState(kNotHighlightedState);
+  }
+
+  QObject::connect(document_, &QTextDocument::contentsChange, &background_timer_,
+                   [this](int position, int chars_removed, int chars_added) {
+                     OnContentsChange(position, chars_removed, chars_added);
+                   });
+  QObject::connect(&background_timer_, &QTimer::timeout, &background_timer_,
+                   [this]() { HighlightNextBlocks(); });
+  background_timer_.setInterval(0);
+  background_timer_.start();
+}
+
+void IncrementalHighlighter::SetVisibleBlocks(int first_block_number, int last_block_number) {
+  first_visible_block_number_ = first_block_number;
+  last_visible_block_number_ = last_block_number;
+  HighlightVisibleBlocks();
+}
+
+void IncrementalHighlighter::HighlightRemainingBlocks() {
+  if (document_ == nullptr) return;
+
+  for (QTextBlock block = document_->findBlockByNumber(next_block_number_); block.isValid();
+       block = block.next()) {
+    HighlightBlock(block);
+    ++next_block_number_;
+  }
+  background_timer_.stop();
+}
+
+bool IncrementalHighlighter::IsComplete() const {
+  return document_ == nullptr || next_block_number_ >= document_->blockCount();
+}
+
+void IncrementalHighlighter::OnContentsChange(int position, int /*chars_removed*/,
+                                              int chars_added) {
+  if (is_applying_formats_) return;
+
+  QTextBlock first_changed_block = document_->findBlock(position);
+  if (!first_changed_block.isValid()) first_changed_block = document_->lastBlock();
+  const QTextBlock last_changed_block = document_->findBlock(position + chars_added);
+
+  // The changed blocks, including the ones inserted, are highlighted again even if they are
+  // visible and ahead of the background highlighting.
+  for (QTextBlock block = first_changed_block; block.isValid(); block = block.next()) {
+    block.setUserState(kNotHighlightedState);
+    if (block == last_changed_block) break;
+  }
+
+  next_block_number_ = std::min(next_block_number_, first_changed_block.blockNumber());
+  background_timer_.start();
+  HighlightVisibleBlocks();
+}
+
+void IncrementalHighlighter::HighlightVisibleBlocks() {
+  if (document_ == nullptr) return;
+
+  for (QTextBlock block = document_->findBlockByNumber(first_visible_block_number_);
+       block.isValid() && block.blockNumber() <= last_visible_block_number_;
+       block = block.next()) {
+    if (block.blockNumber() < next_block_number_) continue;
+    if (block.userState() != kNotHighlightedState) continue;
+    HighlightBlock(block);
+  }
+}
+
+void IncrementalHighlighter::HighlightNextBlocks() {
+  if (document_ == nullptr) {
+    background_timer_.stop();
+    return;
+  }
+
+  QElapsedTimer time_slice;
+  time_slice.start();
+
+  QTextBlock block = document_->findBlockByNumber(next_block_number_);
+  for (; block.isValid() && !time_slice.hasExpired(kBackgroundTimeSliceMs); block = block.next()) {
+    HighlightBlock(block);
+    ++next_block_number_;
+  }
+
+  if (!block.isValid()) background_timer_.stop();
+}
+
+void IncrementalHighlighter::HighlightBlock(QTextBlock block) {
+  // Like QSyntaxHighlighter, we record the format of each character first, as later formats paint
+  // over earlier ones, and merge them into ranges afterwards.
+  const int length = block.text().length();
+  QVector<QTextCharFormat> formats(length);
+  const int state = block_highlighter_->HighlightBlock(
+      block, block.previous().userState(),
+      [&formats, length](int start, int count, const QTextCharFormat& format) {
+        const int end = std::min(start + count, length);
+        for (int i = std::max(start, 0); i < end; ++i) formats[i] = format;
+      });
+  block.setUserState(state);
+
+  QVector<QTextLayout::FormatRange> ranges;
+  for (int start = 0; start < length;) {
+    int end = start + 1;
+    while (end < length && formats[end] == formats[start]) ++end;
+    if (formats[start] != QTextCharFormat{}) {
+      ranges.push_back(QTextLayout::FormatRange{start, end - start, formats[start]});
+    }
+    start = end;
+  }
+
+  QTextLayout* layout = block.layout();
+  // Relayouting is what is expensive, so we skip it whenever highlighting a block again doesn't
+  // change it, which is the case for most blocks highlighted twice.
+  if (layout->formats() == ranges) return;
+
+  is_applying_formats_ = true;
+  layout->setFormats(ranges);
+  document_->markContentsDirty(block.position(), block.length());
+  is_applying_formats_ = false;
+}
+
+}  // namespace orbit_code_viewer
@@ -0,0 +1,142 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <QApplication>
+#include <QColor>
+#include <QString>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <array>
+#include <memory>
+#include <optional>
+
+#include "CodeViewer/IncrementalHighlighter.h"
+#include "SyntaxHighlighter/BlockHighlighter.h"
+#include "gtest/gtest.h"
+
+namespace orbit_code_viewer {
+
+namespace {
+const QColor kCodeColor{Qt::white};
+const QColor kCommentColor{Qt::gray};
+
+// Highlights lines as comments from a line "/*" to a line "*/", and everything else as code.
+class FakeHighlighter : public orbit_syntax_highlighter::BlockHighlighter {
+ public:
+  enum State { kCodeState, kCommentState };
+
+  [[nodiscard]] int HighlightBlock(const QTextBlock& block, int previous_block_state,
+                                   const SetFormatFunction& set_format) const override {
+    const QString code = block.text();
+    const bool is_comment =
+        previous_block_state == kCommentState || code == "/*" || code == "*/";
+
+    QTextCharFormat format{};
+    format.setForeground(is_comment ? kCommentColor : kCodeColor);
+    set_format(0, code.length(), format);
+
+    if (code == "/*") return kCommentState;
+    if (code == "*/") return kCodeState;
+    return previous_block_state == kCommentState ? kCommentState : kCodeState;
+  }
+};
+
+[[nodiscard]] std::optional<QColor> GetForegroundColor(const QTextBlock& block) {
+  const QVector<QTextLayout::FormatRange> formats = block.layout()->formats();
+  if (formats.isEmpty()) return std::nullopt;
+  return formats.front().format.foreground().color();
+}
+
+[[nodiscard]] QString GenerateCode(int number_of_lines) {
+  QStringList lines;
+  for (int i = 0; i < number_of_lines; ++i) lines.push_back(QString{"line %1"}.arg(i));
+  return lines.join('\n');
+}
+}  // namespace
+
+TEST(IncrementalHighlighter, HighlightRemainingBlocks) {
+  QTextDocument document{};
+  document.setPlainText("first line\n/*\ncomment\n*/\nlast line");
+
+  IncrementalHighlighter highlighter{&document, std::make_unique<FakeHighlighter>()};
+  EXPECT_FALSE(highlighter.IsComplete());
+
+  highlighter.HighlightRemainingBlocks();
+  EXPECT_TRUE(highlighter.IsComplete());
+
+  const std::array expected_colors{kCodeColor, kCommentColor, kCommentColor, kCommentColor,
+                                   kCodeColor};
+  int block_number = 0;
+  for (QTextBlock block = document.begin(); block.isValid(); block = block.next()) {
+    EXPECT_EQ(GetForegroundColor(block), expected_colors[block_number]);
+    EXPECT_NE(block.userState(), -1);
+    ++block_number;
+  }
+}
+
+TEST(IncrementalHighlighter, HighlightsVisibleBlocksRightAway) {
+  QTextDocument document{};
+  document.setPlainText(GenerateCode(10'000));
+
+  IncrementalHighlighter highlighter{&document, std::make_unique<FakeHighlighter>()};
+  highlighter.SetVisibleBlocks(5'000, 5'009);
+
+  EXPECT_FALSE(GetForegroundColor(document.findBlockByNumber(4'999)).has_value());
+  for (int block_number = 5'000; block_number <= 5'009; ++block_number) {
+    EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(block_number)), kCodeColor);
+  }
+  EXPECT_FALSE(GetForegroundColor(document.findBlockByNumber(5'010)).has_value());
+  EXPECT_FALSE(highlighter.IsComplete());
+}
+
+TEST(IncrementalHighlighter, HighlightsAllBlocksInTheBackground) {
+  QTextDocument document{};
+  document.setPlainText(GenerateCode(10'000));
+
+  IncrementalHighlighter highlighter{&document, std::make_unique<FakeHighlighter>()};
+  while (!highlighter.IsComplete()) QApplication::processEvents();
+
+  for (QTextBlock block = document.begin(); block.isValid(); block = block.next()) {
+    EXPECT_EQ(GetForegroundColor(block), kCodeColor);
+  }
+}
+
+TEST(IncrementalHighlighter, CorrectsVisibleBlocksWithUnknownPreviousState) {
+  QTextDocument document{};
+  document.setPlainText("/*\ncomment\n*/");
+
+  IncrementalHighlighter highlighter{&document, std::make_unique<FakeHighlighter>()};
+
+  // The state of the first block is unknown when the second one is highlighted.
+  highlighter.SetVisibleBlocks(1, 1);
+  EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(1)), kCodeColor);
+
+  highlighter.HighlightRemainingBlocks();
+  EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(1)), kCommentColor);
+}
+
+TEST(IncrementalHighlighter, HighlightsChangedBlocksAgain) {
+  QTextDocument document{};
+  document.setPlainText("first line\nsecond line\nthird line");
+
+  IncrementalHighlighter highlighter{&document, std::make_unique<FakeHighlighter>()};
+  highlighter.HighlightRemainingBlocks();
+  ASSERT_TRUE(highlighter.IsComplete());
+
+  QTextCursor cursor{document.findBlockByNumber(1)};
+  cursor.insertText("/*\n");
+  EXPECT_FALSE(highlighter.IsComplete());
+
+  highlighter.HighlightRemainingBlocks();
+  EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(0)), kCodeColor);
+  EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(1)), kCommentColor);
+  EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(2)), kCommentColor);
+  EXPECT_EQ(GetForegroundColor(document.findBlockByNumber(3)), kCommentColor);
+}
+
+}  // namespace orbit_code_viewer
@@ -111,6 +111,10 @@ Viewer::Viewer(QWidget* parent)
   };
   QObject::connect(this, &QPlainTextEdit::updateRequest, this, update_viewport_area);
 
+  QObject::connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+                   &Viewer::UpdateVisibleBlocks);
+  QObject::connect(this, &QPlainTextEdit::blockCountChanged, this, &Viewer::UpdateVisibleBlocks);
+
   constexpr int kTabStopInWhitespaces = 4;
   setTabStopDistance(fontMetrics().horizontalAdvance(' ') * kTabStopInWhitespaces);
 
@@ -126,6 +130,7 @@ void Viewer::resizeEvent(QResizeEvent* ev) {
   QPlainTextEdit::resizeEvent(ev);
 
   UpdateBarsPosition();
+  UpdateVisibleBlocks();
 }
 
 void Viewer::wheelEvent(QWheelEvent* ev) {
@@ -141,6 +146,7 @@ void Viewer::wheelEvent(QWheelEvent* ev) {
 
   UpdateBarsSize();
   UpdateBarsPosition();
+  UpdateVisibleBlocks();
 }
 
 void Viewer::DrawTopWidget(QPaintEvent* event) {
@@ -493,6 +499,32 @@ void Viewer::HighlightCurrentLine() {
   setExtraSelections({selection});
 }
 
+void Viewer::SetSyntaxHighlighter(
+    std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> block_highlighter) {
+  syntax_highlighter_.reset();
+  if (block_highlighter == nullptr) return;
+
+  syntax_highlighter_ =
+      std::make_unique<IncrementalHighlighter>(document(), std::move(block_highlighter));
+  UpdateVisibleBlocks();
+}
+
+void Viewer::UpdateVisibleBlocks() {
+  if (syntax_highlighter_ == nullptr) return;
+
+  QTextBlock block = firstVisibleBlock();
+  const int first_block_number = block.blockNumber();
+  int last_block_number = first_block_number;
+  const int viewport_height = viewport()->height();
+  for (; block.isValid() && blockBoundingGeometry(block).translated(contentOffset()).top() <=
+                                viewport_height;
+       block = block.next()) {
+    last_block_number = block.blockNumber();
+  }
+
+  syntax_highlighter_->SetVisibleBlocks(first_block_number, last_block_number);
+}
+
 int Viewer::WidthPercentageColumn() const {
   const QString kWidestPercentage = "100.00 %";
   return StringWidthInPixels(fontMetrics(), kWidestPercentage);
@@ -518,6 +550,11 @@ void Viewer::SetAnnotatingContent(
 
 LargestOccurringLineNumbers SetAnnotatingContentInDocument(
     QTextDocument* document, absl::Span<const orbit_code_report::AnnotatingLine> annotating_lines) {
+  // All the changes are done in one edit block, so that the document is laid out and the syntax
+  // highlighting is notified only once, instead of once per annotating line.
+  QTextCursor edit_block_cursor{document};
+  edit_block_cursor.beginEditBlock();
+
   // Lets first go through the main content and save line numbers as metadata.
   // If previously extra annotating content had been added, let's remove it now.
   for (auto current_block = document->begin(); current_block != document->end();) {
@@ -593,6 +630,7 @@ LargestOccurringLineNumbers SetAnnotatingContentInDocument(
     }
   }
 
+  edit_block_cursor.endEditBlock();
   return largest_occuring_line_numbers;
 }
 
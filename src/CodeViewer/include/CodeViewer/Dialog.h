@@ -6,7 +6,6 @@
 #define CODE_VIEWER_DIALOG_H_
 
 #include <QDialog>
-#include <QSyntaxHighlighter>
 #include <memory>
 #include <optional>
 
@@ -14,6 +13,7 @@
 #include "CodeReport/CodeReport.h"
 #include "CodeViewer/FontSizeInEm.h"
 #include "CodeViewer/Viewer.h"
+#include "SyntaxHighlighter/BlockHighlighter.h"
 
 namespace Ui {
 class CodeViewerDialog;  // IWYU pragma: keep
@@ -52,7 +52,9 @@ class Dialog : public QDialog {
   ~Dialog() noexcept override;
 
   void SetMainContent(const QString& code);
-  void SetMainContent(const QString& code, std::unique_ptr<QSyntaxHighlighter> syntax_highlighter);
+  void SetMainContent(
+      const QString& code,
+      std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> syntax_highlighter);
 
   void SetAnnotatingContent(absl::Span<const orbit_code_report::AnnotatingLine> annotating_lines);
 
@@ -80,7 +82,6 @@ class Dialog : public QDialog {
 
  private:
   std::unique_ptr<Ui::CodeViewerDialog> ui_;
-  std::unique_ptr<QSyntaxHighlighter> syntax_highlighter_;
 };
 }  // namespace orbit_code_viewer
 
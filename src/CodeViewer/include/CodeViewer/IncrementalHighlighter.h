@@ -0,0 +1,76 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CODE_VIEWER_INCREMENTAL_HIGHLIGHTER_H_
+#define CODE_VIEWER_INCREMENTAL_HIGHLIGHTER_H_
+
+#include <QPointer>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+#include <memory>
+
+#include "SyntaxHighlighter/BlockHighlighter.h"
+
+namespace orbit_code_viewer {
+
+/*
+  IncrementalHighlighter applies a BlockHighlighter to a document without blocking the UI, no
+  matter how large the document is. QSyntaxHighlighter highlights the whole document at once, which
+  takes seconds for generated source files or the disassembly of huge functions.
+
+  The visible blocks, as set by `SetVisibleBlocks`, are highlighted right away. All blocks are
+  highlighted in order in the background, in short time slices on the event loop. A visible block
+  which the background highlighting hasn't reached yet is highlighted with the state of the block
+  before it, if known, and highlighted again once the background highlighting reaches it, so
+  multi-line constructs like comments are eventually correct everywhere.
+
+  The state each block ends in is cached in QTextBlock::userState, with -1 for blocks which
+  haven't been highlighted yet. Changes of the document rewind the background highlighting to the
+  first changed block.
+
+  Usage example:
+
+  IncrementalHighlighter highlighter{viewer.document(),
+                                     std::make_unique<orbit_syntax_highlighter::Cpp>()};
+  highlighter.SetVisibleBlocks(0, 40);
+*/
+class IncrementalHighlighter {
+ public:
+  explicit IncrementalHighlighter(
+      QTextDocument* document,
+      std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> block_highlighter);
+
+  IncrementalHighlighter(const IncrementalHighlighter&) = delete;
+  IncrementalHighlighter& operator=(const IncrementalHighlighter&) = delete;
+
+  // Both block numbers are inclusive.
+  void SetVisibleBlocks(int first_block_number, int last_block_number);
+
+  // Synchronously highlights all blocks the background highlighting hasn't reached yet.
+  void HighlightRemainingBlocks();
+
+  // Whether the background highlighting has reached the end of the document.
+  [[nodiscard]] bool IsComplete() const;
+
+ private:
+  void OnContentsChange(int position, int chars_removed, int chars_added);
+  void HighlightVisibleBlocks();
+  void HighlightNextBlocks();
+  void HighlightBlock(QTextBlock block);
+
+  QPointer<QTextDocument> document_;
+  std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> block_highlighter_;
+  QTimer background_timer_;
+  bool is_applying_formats_ = false;
+
+  // All blocks before this one are highlighted with their correct states.
+  int next_block_number_ = 0;
+  int first_visible_block_number_ = 0;
+  int last_visible_block_number_ = -1;
+};
+
+}  // namespace orbit_code_viewer
+
+#endif  // CODE_VIEWER_INCREMENTAL_HIGHLIGHTER_H_
@@ -12,11 +12,14 @@
 #include <QResizeEvent>
 #include <QWheelEvent>
 #include <functional>
+#include <memory>
 
 #include "CodeReport/AnnotatingLine.h"
 #include "CodeReport/CodeReport.h"
 #include "CodeViewer/FontSizeInEm.h"
+#include "CodeViewer/IncrementalHighlighter.h"
 #include "CodeViewer/PlaceHolderWidget.h"
+#include "SyntaxHighlighter/BlockHighlighter.h"
 
 namespace orbit_code_viewer {
 
@@ -72,6 +75,12 @@ class Viewer : public QPlainTextEdit {
 
   void SetAnnotatingContent(absl::Span<const orbit_code_report::AnnotatingLine> annotating_lines);
 
+  // The visible lines are highlighted right away, all others in the background (see
+  // IncrementalHighlighter). Passing nullptr stops highlighting, the formats applied so far stay
+  // until the content is replaced.
+  void SetSyntaxHighlighter(
+      std::unique_ptr<orbit_syntax_highlighter::BlockHighlighter> block_highlighter);
+
   void SetTopBarTitle(const QString& title) { top_bar_title_ = title; }
   [[nodiscard]] const QString& GetTopBarTitle() const { return top_bar_title_; }
 
@@ -85,6 +94,7 @@ class Viewer : public QPlainTextEdit {
   void UpdateBarsSize();
   void UpdateBarsPosition();
   void HighlightCurrentLine();
+  void UpdateVisibleBlocks();
   [[nodiscard]] int WidthPercentageColumn() const;
   [[nodiscard]] int WidthSampleCounterColumn() const;
   [[nodiscard]] int WidthMarginBetweenColumns() const;
@@ -110,6 +120,8 @@ class Viewer : public QPlainTextEdit {
   [[nodiscard]] uint64_t LargestOccurringLineNumber() const;
 
   QString top_bar_title_;
+
+  std::unique_ptr<IncrementalHighlighter> syntax_highlighter_;
 };
 
 // Determine how many pixels are needed to draw all possible line numbers for the given font
@@ -4,8 +4,10 @@
 
 #include "DataViews/DataView.h"
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/str_replace.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "OrbitBase/File.h"
@@ -57,6 +59,12 @@ void DataView::OnFilter(const std::string& filter) {
   OnSort(sorting_column_, {});
 }
 
+orbit_base::Future<bool> DataView::OnFilterAsync(const std::string& filter,
+                                                 orbit_base::Executor* /*main_thread_executor*/) {
+  OnFilter(filter);
+  return true;
+}
+
 void DataView::SetUiFilterString(const std::string& filter) {
   if (filter_callback_) {
     filter_callback_(filter);
@@ -68,6 +76,34 @@ void DataView::OnDataChanged() {
   OnSort(sorting_column_, std::optional<SortingOrder>{});
 }
 
+DataView::RowChanges DataView::TakeRowChanges() {
+  RowChanges changes;
+  changes.previous_num_rows = previous_indices_.size();
+  changes.only_appended =
+      indices_.size() >= previous_indices_.size() &&
+      std::equal(previous_indices_.begin(), previous_indices_.end(), indices_.begin());
+
+  if (!changes.only_appended) {
+    absl::flat_hash_map<uint64_t, int> index_to_row;
+    index_to_row.reserve(indices_.size());
+    for (size_t row = 0; row < indices_.size(); ++row) {
+      index_to_row.emplace(indices_[row], static_cast<int>(row));
+    }
+    changes.previous_row_to_row.reserve(previous_indices_.size());
+    for (uint64_t index : previous_indices_) {
+      auto it = index_to_row.find(index);
+      if (it == index_to_row.end()) {
+        changes.previous_row_to_row.emplace_back(std::nullopt);
+      } else {
+        changes.previous_row_to_row.emplace_back(it->second);
+      }
+    }
+  }
+
+  previous_indices_ = indices_;
+  return changes;
+}
+
 const std::string DataView::kMenuActionCopySelection = "Copy Selection";
 const std::string DataView::kMenuActionExportToCsv = "Export to CSV";
 
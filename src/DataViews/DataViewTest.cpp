@@ -2,14 +2,22 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "DataViews/DataView.h"
+#include "DataViews/DataViewType.h"
 
+using orbit_data_views::DataView;
 using orbit_data_views::FormatValueForCsv;
+using ::testing::ElementsAre;
 
 TEST(DataView, FormatValueForCsvQuotesEmptyString) { EXPECT_EQ("\"\"", FormatValueForCsv("")); }
 
@@ -22,3 +30,50 @@ TEST(DataView, FormatValueForCsvEscapesQuotesInString) {
   constexpr std::string_view kExpectedResult("\"string\"\"with\"\"quotes\"");
   EXPECT_EQ(kExpectedResult, FormatValueForCsv(kInput));
 }
+
+namespace {
+
+class TestDataView : public orbit_data_views::DataView {
+ public:
+  TestDataView() : DataView(orbit_data_views::DataViewType::kInvalid, nullptr) {}
+
+  const std::vector<Column>& GetColumns() override {
+    static const std::vector<Column> kColumns{{"Value", .0f, SortingOrder::kAscending}};
+    return kColumns;
+  }
+
+  void SetIndices(std::vector<uint64_t> indices) { indices_ = std::move(indices); }
+};
+
+}  // namespace
+
+TEST(DataView, TakeRowChangesReportsAppendedRows) {
+  TestDataView data_view;
+  data_view.SetIndices({3, 1});
+  DataView::RowChanges changes = data_view.TakeRowChanges();
+  EXPECT_EQ(changes.previous_num_rows, 0);
+  EXPECT_TRUE(changes.only_appended);
+
+  data_view.SetIndices({3, 1, 2});
+  changes = data_view.TakeRowChanges();
+  EXPECT_EQ(changes.previous_num_rows, 2);
+  EXPECT_TRUE(changes.only_appended);
+  EXPECT_TRUE(changes.previous_row_to_row.empty());
+
+  changes = data_view.TakeRowChanges();
+  EXPECT_EQ(changes.previous_num_rows, 3);
+  EXPECT_TRUE(changes.only_appended);
+}
+
+TEST(DataView, TakeRowChangesMapsMovedAndRemovedRows) {
+  TestDataView data_view;
+  data_view.SetIndices({3, 1, 2});
+  (void)data_view.TakeRowChanges();
+
+  // 1 moved to the front, 3 was filtered out, 2 stayed in place, and 4 was added.
+  data_view.SetIndices({1, 2, 4});
+  const DataView::RowChanges changes = data_view.TakeRowChanges();
+  EXPECT_EQ(changes.previous_num_rows, 3);
+  EXPECT_FALSE(changes.only_appended);
+  EXPECT_THAT(changes.previous_row_to_row, ElementsAre(std::nullopt, 0, 1));
+}
@@ -6,15 +6,20 @@
 
 #include <absl/flags/declare.h>
 #include <absl/flags/flag.h>
+#include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
 #include <stddef.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <numeric>
+#include <optional>
 
 #include "ClientData/FunctionUtils.h"
 #include "ClientData/ModuleData.h"
@@ -38,6 +43,9 @@ namespace orbit_data_views {
 FunctionsDataView::FunctionsDataView(AppInterface* app, ThreadPool* thread_pool)
     : DataView(DataViewType::kFunctions, app), thread_pool_{thread_pool} {}
 
+// Cancels the asynchronous filters in progress, so that they don't update the destroyed view.
+FunctionsDataView::~FunctionsDataView() { ++*filter_generation_; }
+
 const std::string FunctionsDataView::kUnselectedFunctionString = "";
 const std::string FunctionsDataView::kSelectedFunctionString = "✓";
 const std::string FunctionsDataView::kFrameTrackString = "F";
@@ -115,30 +123,25 @@ std::string FunctionsDataView::GetValue(int row, int column) {
   }
 }
 
-#define ORBIT_FUNC_SORT(Member)                                                                   \
-  [&](int a, int b) {                                                                             \
-    return CompareAscendingOrDescending(functions_[a]->Member, functions_[b]->Member, ascending); \
+#define ORBIT_FUNC_SORT(Member)                                                                 \
+  [&](uint64_t a, uint64_t b) {                                                                 \
+    return CompareAscendingOrDescending(functions[a]->Member, functions[b]->Member, ascending); \
   }
 
-#define ORBIT_CUSTOM_FUNC_SORT(Func)                                                            \
-  [&](int a, int b) {                                                                           \
-    return CompareAscendingOrDescending(Func(*functions_[a]), Func(*functions_[b]), ascending); \
+#define ORBIT_CUSTOM_FUNC_SORT(Func)                                                          \
+  [&](uint64_t a, uint64_t b) {                                                               \
+    return CompareAscendingOrDescending(Func(*functions[a]), Func(*functions[b]), ascending); \
   }
 
-void FunctionsDataView::DoSort() {
-  // TODO(antonrohr): This sorting function can take a lot of time when a large
-  // number of functions is used (several seconds). This function is currently
-  // executed on the main thread and therefore freezes the UI and interrupts the
-  // ssh watchdog signals that are sent to the service. Therefore this should
-  // not be called on the main thread and as soon as this is done the watchdog
-  // timeout should be rolled back from 25 seconds to 10 seconds in
-  // OrbitService.h
-  bool ascending = sorting_orders_[sorting_column_] == SortingOrder::kAscending;
-  std::function<bool(int a, int b)> sorter = nullptr;
+// Only sorting by kColumnSelected uses `app`, so the other columns can be sorted on any thread.
+void FunctionsDataView::SortIndices(AppInterface* app,
+                                    const std::vector<const FunctionInfo*>& functions, int column,
+                                    bool ascending, std::vector<uint64_t>* indices) {
+  std::function<bool(uint64_t a, uint64_t b)> sorter = nullptr;
 
-  switch (sorting_column_) {
+  switch (column) {
     case kColumnSelected:
-      sorter = ORBIT_CUSTOM_FUNC_SORT(app_->IsFunctionSelected);
+      sorter = ORBIT_CUSTOM_FUNC_SORT(app->IsFunctionSelected);
       break;
     case kColumnName:
       sorter = ORBIT_CUSTOM_FUNC_SORT(orbit_client_data::function_utils::GetDisplayName);
@@ -157,10 +160,22 @@ void FunctionsDataView::DoSort() {
   }
 
   if (sorter) {
-    std::stable_sort(indices_.begin(), indices_.end(), sorter);
+    std::stable_sort(indices->begin(), indices->end(), sorter);
   }
 }
 
+void FunctionsDataView::DoSort() {
+  // TODO(antonrohr): This sorting function can take a lot of time when a large
+  // number of functions is used (several seconds). This function is currently
+  // executed on the main thread and therefore freezes the UI and interrupts the
+  // ssh watchdog signals that are sent to the service. Therefore this should
+  // not be called on the main thread and as soon as this is done the watchdog
+  // timeout should be rolled back from 25 seconds to 10 seconds in
+  // OrbitService.h
+  bool ascending = sorting_orders_[sorting_column_] == SortingOrder::kAscending;
+  SortIndices(app_, functions_, sorting_column_, ascending, &indices_);
+}
+
 const std::string FunctionsDataView::kMenuActionSelect = "Hook";
 const std::string FunctionsDataView::kMenuActionUnselect = "Unhook";
 const std::string FunctionsDataView::kMenuActionEnableFrameTrack = "Enable frame track(s)";
@@ -241,32 +256,83 @@ void FunctionsDataView::OnContextMenu(const std::string& action, int menu_index,
   }
 }
 
-void FunctionsDataView::DoFilter() {
-  filter_tokens_ = absl::StrSplit(absl::AsciiStrToLower(filter_), ' ');
+namespace {
+
+// What the tasks matching the functions against a filter share. For asynchronous filters, this
+// outlives the state of the view it was created from.
+struct FilterInput {
+  std::vector<const FunctionInfo*> functions;
+  // The indices of the functions to match, or std::nullopt to match all of them.
+  std::optional<std::vector<uint64_t>> candidate_indices;
+  std::vector<std::string> tokens;
+  // Asynchronous filters are cancelled once `*current_generation` is no longer `generation`.
+  std::shared_ptr<const std::atomic<uint64_t>> current_generation;
+  uint64_t generation = 0;
+
+  [[nodiscard]] size_t GetCandidateCount() const {
+    return candidate_indices.has_value() ? candidate_indices->size() : functions.size();
+  }
+  [[nodiscard]] uint64_t GetCandidate(size_t i) const {
+    return candidate_indices.has_value() ? (*candidate_indices)[i] : i;
+  }
+  [[nodiscard]] bool IsCancelled() const {
+    return current_generation != nullptr && current_generation->load() != generation;
+  }
+};
+
+[[nodiscard]] std::vector<std::string> TokenizeFilter(const std::string& filter) {
+  return absl::StrSplit(absl::AsciiStrToLower(filter), ' ');
+}
+
+// A function that contains all the tokens of a filter also contains all the tokens of
+// `previous_tokens` if each of them is part of one of the tokens of the filter.
+[[nodiscard]] bool IsRefinement(const std::vector<std::string>& tokens,
+                                const std::vector<std::string>& previous_tokens) {
+  return std::all_of(previous_tokens.begin(), previous_tokens.end(),
+                     [&tokens](const std::string& previous_token) {
+                       return std::any_of(tokens.begin(), tokens.end(),
+                                          [&previous_token](const std::string& token) {
+                                            return absl::StrContains(token, previous_token);
+                                          });
+                     });
+}
 
-  const size_t number_of_threads_available = thread_pool_->GetPoolSize();
+// Matches chunks of the candidates in parallel. The matches of each task are in the order of the
+// candidates.
+[[nodiscard]] std::vector<orbit_base::Future<std::vector<uint64_t>>> ScheduleMatching(
+    ThreadPool* thread_pool, std::shared_ptr<const FilterInput> input) {
+  const size_t candidate_count = input->GetCandidateCount();
+  const size_t number_of_threads_available = thread_pool->GetPoolSize();
   constexpr size_t kNumberOfTasksPerThread = 7;
   const size_t target_number_of_tasks = kNumberOfTasksPerThread * number_of_threads_available;
 
   constexpr size_t kMinimumNumberOfFunctionsPerTask = 512;
   const size_t number_of_functions_per_task =
-      std::max(kMinimumNumberOfFunctionsPerTask, functions_.size() / target_number_of_tasks);
+      std::max(kMinimumNumberOfFunctionsPerTask, candidate_count / target_number_of_tasks);
   const size_t number_of_tasks_needed =
-      functions_.size() / number_of_functions_per_task +
-      ((functions_.size() % number_of_functions_per_task) > 0 ? 1 : 0);
+      candidate_count / number_of_functions_per_task +
+      ((candidate_count % number_of_functions_per_task) > 0 ? 1 : 0);
 
   std::vector<orbit_base::Future<std::vector<uint64_t>>> filtered_indices_per_thread;
   filtered_indices_per_thread.reserve(number_of_tasks_needed);
 
   for (size_t task_idx = 0; task_idx < number_of_tasks_needed; ++task_idx) {
     const size_t begin = task_idx * number_of_functions_per_task;
-    const size_t end = std::min((task_idx + 1) * number_of_functions_per_task, functions_.size());
+    const size_t end = std::min((task_idx + 1) * number_of_functions_per_task, candidate_count);
 
-    filtered_indices_per_thread.emplace_back(thread_pool_->Schedule([begin, end, this]() {
+    filtered_indices_per_thread.emplace_back(thread_pool->Schedule([begin, end, input]() {
       std::vector<uint64_t> indices_of_matches;
+      if (input->IsCancelled()) return indices_of_matches;
+
+      constexpr size_t kNumberOfFunctionsBetweenCancellationChecks = 1024;
+      for (size_t i = begin; i < end; ++i) {
+        if ((i - begin + 1) % kNumberOfFunctionsBetweenCancellationChecks == 0 &&
+            input->IsCancelled()) {
+          break;
+        }
 
-      for (size_t index = begin; index < end; ++index) {
-        const FunctionInfo* function = functions_[index];
+        const uint64_t index = input->GetCandidate(i);
+        const FunctionInfo* function = input->functions[index];
         std::string name =
             absl::AsciiStrToLower(orbit_client_data::function_utils::GetDisplayName(*function));
         std::string module = orbit_client_data::function_utils::GetLoadedModuleName(*function);
@@ -275,7 +341,7 @@ void FunctionsDataView::DoFilter() {
           return name.find(token) != std::string::npos || module.find(token) != std::string::npos;
         };
 
-        if (std::all_of(filter_tokens_.begin(), filter_tokens_.end(), is_token_found)) {
+        if (std::all_of(input->tokens.begin(), input->tokens.end(), is_token_found)) {
           indices_of_matches.push_back(index);
         }
       }
@@ -284,19 +350,159 @@ void FunctionsDataView::DoFilter() {
     }));
   }
 
-  std::vector<std::vector<uint64_t>> filtered_indices =
-      orbit_base::JoinFutures(absl::MakeConstSpan(filtered_indices_per_thread)).Get();
+  return filtered_indices_per_thread;
+}
 
+[[nodiscard]] std::vector<uint64_t> Concatenate(
+    const std::vector<std::vector<uint64_t>>& filtered_indices) {
   std::vector<uint64_t> indices;
   for (const auto& indices_from_one_thread : filtered_indices) {
     indices.insert(indices.end(), indices_from_one_thread.begin(), indices_from_one_thread.end());
   }
-  indices_ = std::move(indices);
+  return indices;
+}
+
+[[nodiscard]] std::shared_ptr<FilterInput> CreateFilterInput(
+    const std::vector<const FunctionInfo*>& functions, const std::vector<uint64_t>& indices,
+    bool indices_match_filter_tokens, const std::vector<std::string>& filter_tokens,
+    const std::string& filter) {
+  auto input = std::make_shared<FilterInput>();
+  input->functions = functions;
+  input->tokens = TokenizeFilter(filter);
+  // Only the functions that match the current filter can match a refinement of it.
+  if (indices_match_filter_tokens && IsRefinement(input->tokens, filter_tokens)) {
+    input->candidate_indices = indices;
+  }
+  return input;
+}
+
+}  // namespace
+
+std::optional<std::vector<uint64_t>> FunctionsDataView::FindCandidatesInFunctionNameIndices(
+    const std::vector<std::string>& filter_tokens) const {
+  std::vector<uint64_t> candidates;
+  bool is_narrowed_down = false;
+  for (const AddedFunctions& added_functions : added_functions_) {
+    std::shared_ptr<const orbit_client_data::FunctionNameIndex> index =
+        added_functions.module != nullptr ? added_functions.module->GetFunctionNameIndex()
+                                          : nullptr;
+    std::optional<std::vector<uint32_t>> module_candidates;
+    // The index is built in the background after the symbols are loaded, so it may not be there
+    // yet, or be from symbols that were loaded again.
+    if (index != nullptr && index->size() == added_functions.size && added_functions.size > 0) {
+      const std::string module_name = orbit_client_data::function_utils::GetLoadedModuleName(
+          *functions_[added_functions.begin]);
+      for (const std::string& token : filter_tokens) {
+        // All the functions of the module match a token in the module name.
+        if (module_name.find(token) != std::string::npos) continue;
+        std::optional<std::vector<uint32_t>> token_candidates = index->FindCandidates(token);
+        if (!token_candidates.has_value()) continue;
+        if (module_candidates.has_value()) {
+          std::vector<uint32_t> intersection;
+          std::set_intersection(module_candidates->begin(), module_candidates->end(),
+                                token_candidates->begin(), token_candidates->end(),
+                                std::back_inserter(intersection));
+          module_candidates = std::move(intersection);
+        } else {
+          module_candidates = std::move(token_candidates);
+        }
+      }
+    }
+
+    if (module_candidates.has_value()) {
+      is_narrowed_down = true;
+      for (uint32_t position : module_candidates.value()) {
+        candidates.push_back(added_functions.begin + position);
+      }
+    } else {
+      for (size_t i = 0; i < added_functions.size; ++i) {
+        candidates.push_back(added_functions.begin + i);
+      }
+    }
+  }
+
+  if (!is_narrowed_down) return std::nullopt;
+  return candidates;
+}
+
+void FunctionsDataView::DoFilter() {
+  std::shared_ptr<FilterInput> input = CreateFilterInput(
+      functions_, indices_, indices_match_filter_tokens_, filter_tokens_, filter_);
+  if (!input->candidate_indices.has_value()) {
+    input->candidate_indices = FindCandidatesInFunctionNameIndices(input->tokens);
+  }
+  std::vector<orbit_base::Future<std::vector<uint64_t>>> filtered_indices_per_thread =
+      ScheduleMatching(thread_pool_, input);
+
+  std::vector<std::vector<uint64_t>> filtered_indices =
+      orbit_base::JoinFutures(absl::MakeConstSpan(filtered_indices_per_thread)).Get();
+
+  indices_ = Concatenate(filtered_indices);
+  filter_tokens_ = std::move(input->tokens);
+  indices_match_filter_tokens_ = true;
+}
+
+orbit_base::Future<bool> FunctionsDataView::OnFilterAsync(
+    const std::string& filter, orbit_base::Executor* main_thread_executor) {
+  if (sorting_orders_.empty()) {
+    InitSortingOrders();
+  }
+
+  std::shared_ptr<FilterInput> input = CreateFilterInput(
+      functions_, indices_, indices_match_filter_tokens_, filter_tokens_, filter);
+  input->current_generation = filter_generation_;
+  input->generation = ++*filter_generation_;
+
+  // The candidates of a refinement are the functions shown, so the matches are already sorted.
+  const bool is_sorted = input->candidate_indices.has_value();
+  if (!is_sorted) {
+    input->candidate_indices = FindCandidatesInFunctionNameIndices(input->tokens);
+  }
+  const int column = sorting_column_;
+  const bool ascending = sorting_orders_[column] == SortingOrder::kAscending;
+  // Whether a function is hooked is only known on the main thread.
+  const bool sort_in_background = !is_sorted && column != kColumnSelected;
+
+  std::vector<orbit_base::Future<std::vector<uint64_t>>> filtered_indices_per_thread =
+      ScheduleMatching(thread_pool_, input);
+  orbit_base::Future<std::vector<std::vector<uint64_t>>> filtered_indices =
+      orbit_base::JoinFutures(absl::MakeConstSpan(filtered_indices_per_thread));
+
+  orbit_base::Future<std::vector<uint64_t>> indices = thread_pool_->ScheduleAfter(
+      filtered_indices, [input, sort_in_background, column,
+                         ascending](const std::vector<std::vector<uint64_t>>& filtered_indices) {
+        std::vector<uint64_t> indices = Concatenate(filtered_indices);
+        if (sort_in_background && !input->IsCancelled()) {
+          SortIndices(nullptr, input->functions, column, ascending, &indices);
+        }
+        return indices;
+      });
+
+  return main_thread_executor->ScheduleAfter(
+      indices, [this, input, filter, is_sorted = is_sorted || sort_in_background, column,
+                ascending](const std::vector<uint64_t>& indices) {
+        // This also guards against the view being destroyed in the meantime.
+        if (input->IsCancelled()) return false;
+
+        filter_ = filter;
+        filter_tokens_ = input->tokens;
+        indices_ = indices;
+        indices_match_filter_tokens_ = true;
+        // The sorting can have changed during the filtering.
+        if (!is_sorted || sorting_column_ != column ||
+            (sorting_orders_[column] == SortingOrder::kAscending) != ascending) {
+          DoSort();
+        }
+        return true;
+      });
 }
 
 void FunctionsDataView::AddFunctions(
-    std::vector<const orbit_client_protos::FunctionInfo*> functions) {
+    std::vector<const orbit_client_protos::FunctionInfo*> functions, const ModuleData* module) {
+  added_functions_.push_back({functions_.size(), functions.size(), module});
   functions_.insert(functions_.end(), functions.begin(), functions.end());
+  ++*filter_generation_;
+  indices_match_filter_tokens_ = false;
   indices_.resize(functions_.size());
   for (size_t i = 0; i < indices_.size(); ++i) {
     indices_[i] = i;
@@ -306,6 +512,9 @@ void FunctionsDataView::AddFunctions(
 
 void FunctionsDataView::ClearFunctions() {
   functions_.clear();
+  added_functions_.clear();
+  ++*filter_generation_;
+  indices_match_filter_tokens_ = false;
   OnDataChanged();
 }
 
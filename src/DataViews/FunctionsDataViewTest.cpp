@@ -20,7 +20,9 @@
 #include "DataViews/DataView.h"
 #include "DataViews/FunctionsDataView.h"
 #include "MockAppInterface.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/SimpleExecutor.h"
 #include "OrbitBase/TemporaryFile.h"
 #include "OrbitBase/TestUtils.h"
 #include "OrbitBase/ThreadPool.h"
@@ -111,11 +113,21 @@ struct FunctionsDataViewTest : public testing::Test {
 
  protected:
   std::shared_ptr<ThreadPool> thread_pool_;
+  std::shared_ptr<orbit_base::SimpleExecutor> main_thread_executor_ =
+      orbit_base::SimpleExecutor::Create();
   orbit_data_views::MockAppInterface app_;
   orbit_data_views::FunctionsDataView view_;
   std::vector<orbit_client_protos::FunctionInfo> functions_;
   std::vector<orbit_grpc_protos::ModuleInfo> module_infos_;
 
+  // Runs what the filter schedules on the main thread until `future` completes.
+  [[nodiscard]] bool WaitForAsyncFilter(const orbit_base::Future<bool>& future) {
+    while (!future.IsFinished()) {
+      main_thread_executor_->ExecuteScheduledTasks();
+    }
+    return future.Get();
+  }
+
   [[nodiscard]] std::optional<size_t> IndexOfFunction(
       const orbit_client_protos::FunctionInfo& function) const {
     const auto it = std::find_if(functions_.begin(), functions_.end(),
@@ -794,4 +806,113 @@ TEST_F(FunctionsDataViewTest, FilteringByFunctionAndModuleName) {
   // No results when joining the tokens
   view_.OnFilter("ffindfoomodule");
   EXPECT_EQ(view_.GetNumElements(), 0);
-}
\ No newline at end of file
+}
+
+TEST_F(FunctionsDataViewTest, FilteringAsynchronously) {
+  view_.AddFunctions(
+      {&functions_[0], &functions_[1], &functions_[2], &functions_[3], &functions_[4]});
+
+  // The token `f` only appears in function 0 (foo) and 3 (ffind).
+  EXPECT_TRUE(WaitForAsyncFilter(view_.OnFilterAsync("f", main_thread_executor_.get())));
+  EXPECT_EQ(view_.GetNumElements(), 2);
+  EXPECT_THAT(
+      (std::array{view_.GetValue(0, 1), view_.GetValue(1, 1)}),
+      testing::UnorderedElementsAre(functions_[0].pretty_name(), functions_[3].pretty_name()));
+
+  // A refinement of the filter.
+  EXPECT_TRUE(WaitForAsyncFilter(view_.OnFilterAsync("ff", main_thread_executor_.get())));
+  EXPECT_EQ(view_.GetNumElements(), 1);
+  EXPECT_EQ(view_.GetValue(0, 1), functions_[3].pretty_name());
+
+  // Not a refinement, so functions that were filtered out need to show up again.
+  EXPECT_TRUE(WaitForAsyncFilter(view_.OnFilterAsync("bar", main_thread_executor_.get())));
+  EXPECT_EQ(view_.GetNumElements(), 1);
+  EXPECT_EQ(view_.GetValue(0, 1), functions_[4].pretty_name());
+
+  // Functions added since the last filter are matched too.
+  view_.ClearFunctions();
+  view_.AddFunctions({&functions_[0], &functions_[4]});
+  EXPECT_TRUE(WaitForAsyncFilter(view_.OnFilterAsync("bar", main_thread_executor_.get())));
+  EXPECT_EQ(view_.GetNumElements(), 1);
+  EXPECT_EQ(view_.GetValue(0, 1), functions_[4].pretty_name());
+}
+
+TEST_F(FunctionsDataViewTest, FilteringAsynchronouslyKeepsTheSorting) {
+  view_.AddFunctions(
+      {&functions_[0], &functions_[1], &functions_[2], &functions_[3], &functions_[4]});
+  constexpr int kColumnName = 1;
+  view_.OnSort(kColumnName, orbit_data_views::DataView::SortingOrder::kDescending);
+
+  // The functions are sorted in the background.
+  EXPECT_TRUE(WaitForAsyncFilter(view_.OnFilterAsync("", main_thread_executor_.get())));
+  ASSERT_EQ(view_.GetNumElements(), 5);
+  EXPECT_EQ(view_.GetValue(0, kColumnName), functions_[0].pretty_name());
+  EXPECT_EQ(view_.GetValue(1, kColumnName), functions_[2].pretty_name());
+  EXPECT_EQ(view_.GetValue(2, kColumnName), functions_[1].pretty_name());
+  EXPECT_EQ(view_.GetValue(3, kColumnName), functions_[3].pretty_name());
+  EXPECT_EQ(view_.GetValue(4, kColumnName), functions_[4].pretty_name());
+
+  // The token `a` appears in function 1 (main), 2 (operator==(A const&, A const&)) and in the
+  // module of function 4 (barmodule). A refinement keeps the order of the functions shown.
+  EXPECT_TRUE(WaitForAsyncFilter(view_.OnFilterAsync("a", main_thread_executor_.get())));
+  ASSERT_EQ(view_.GetNumElements(), 3);
+  EXPECT_EQ(view_.GetValue(0, kColumnName), functions_[2].pretty_name());
+  EXPECT_EQ(view_.GetValue(1, kColumnName), functions_[1].pretty_name());
+  EXPECT_EQ(view_.GetValue(2, kColumnName), functions_[4].pretty_name());
+}
+
+TEST_F(FunctionsDataViewTest, FilteringAsynchronouslyCancelsThePreviousFilter) {
+  view_.AddFunctions(
+      {&functions_[0], &functions_[1], &functions_[2], &functions_[3], &functions_[4]});
+
+  orbit_base::Future<bool> first_filter = view_.OnFilterAsync("foo", main_thread_executor_.get());
+  orbit_base::Future<bool> second_filter = view_.OnFilterAsync("bar", main_thread_executor_.get());
+  EXPECT_FALSE(WaitForAsyncFilter(first_filter));
+  EXPECT_TRUE(WaitForAsyncFilter(second_filter));
+  EXPECT_EQ(view_.GetNumElements(), 1);
+  EXPECT_EQ(view_.GetValue(0, 1), functions_[4].pretty_name());
+}
+
+TEST_F(FunctionsDataViewTest, FilteringUsesTheFunctionNameIndexOfTheModule) {
+  orbit_grpc_protos::ModuleInfo module_info;
+  module_info.set_file_path("/path/to/testmodule");
+  orbit_client_data::ModuleData module{module_info};
+  orbit_grpc_protos::ModuleSymbols symbols;
+  uint64_t address = 0x100;
+  for (const char* demangled_name : {"void foo()", "FooBar(int)", "bar::baz"}) {
+    orbit_grpc_protos::SymbolInfo* symbol = symbols.add_symbol_infos();
+    symbol->set_name(demangled_name);
+    symbol->set_demangled_name(demangled_name);
+    symbol->set_address(address);
+    symbol->set_size(0x10);
+    address += 0x10;
+  }
+  module.AddSymbols(symbols);
+
+  // Functions of other modules are still matched one by one.
+  view_.AddFunctions({&functions_[0], &functions_[3]});
+  view_.AddFunctions(module.GetFunctions(), &module);
+
+  // The results are the same before and after the index is built.
+  for (bool build_index : {false, true}) {
+    if (build_index) module.BuildFunctionNameIndex();
+
+    view_.OnFilter("xyz");
+    EXPECT_EQ(view_.GetNumElements(), 0);
+
+    view_.OnFilter("foo");
+    EXPECT_EQ(view_.GetNumElements(), 4);
+
+    view_.OnFilter("bar foo");
+    ASSERT_EQ(view_.GetNumElements(), 1);
+    EXPECT_EQ(view_.GetValue(0, 1), "FooBar(int)");
+
+    // All the functions of the module match a token that is part of the name of the module.
+    view_.OnFilter("testmod bar");
+    EXPECT_EQ(view_.GetNumElements(), 2);
+
+    // Tokens shorter than a trigram can't use the index.
+    view_.OnFilter("b");
+    EXPECT_EQ(view_.GetNumElements(), 2);
+  }
+}
@@ -19,6 +19,8 @@
 
 #include "DataViews/AppInterface.h"
 #include "DataViews/DataViewType.h"
+#include "OrbitBase/Executor.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 
@@ -48,6 +50,19 @@ class DataView {
     SortingOrder initial_order;
   };
 
+  // How the rows changed since the previous call to TakeRowChanges. A row is identified by its
+  // element in `indices_`, so the values shown in any row might have changed regardless.
+  struct RowChanges {
+    // The number of rows at the previous call to TakeRowChanges.
+    size_t previous_num_rows = 0;
+    // Whether the previous rows still show the same elements in the same order, in which case rows
+    // were at most appended after them.
+    bool only_appended = true;
+    // Unless `only_appended`, the row that shows the element of each previous row now, or
+    // std::nullopt if that element is no longer shown, e.g., because it was filtered out.
+    std::vector<std::optional<int>> previous_row_to_row;
+  };
+
   explicit DataView(DataViewType type, AppInterface* app)
       : update_period_ms_(-1), type_(type), app_{app} {}
 
@@ -66,6 +81,12 @@ class DataView {
 
   // Called from UI layer.
   void OnFilter(const std::string& filter);
+  // Like OnFilter, but views that can hold a lot of elements override this to filter (and sort)
+  // in the background. The returned future completes on `main_thread_executor` once the view is
+  // updated, or with false if a later call superseded this one, in which case the view is left as
+  // is. Called on the main thread.
+  virtual orbit_base::Future<bool> OnFilterAsync(const std::string& filter,
+                                                 orbit_base::Executor* main_thread_executor);
   // Called internally to set the filter string programmatically in the UI.
   void SetUiFilterString(const std::string& filter);
   // Filter callback set from UI layer.
@@ -102,7 +123,12 @@ class DataView {
 
   int GetUpdatePeriodMs() const { return update_period_ms_; }
   [[nodiscard]] DataViewType GetType() const { return type_; }
-  [[nodiscard]] virtual bool ResetOnRefresh() const { return true; }
+  // Whether the UI selects the rows of `selected_indices_` again on every refresh, and not only
+  // after filtering or sorting.
+  [[nodiscard]] virtual bool RestoreSelectionOnRefresh() const { return true; }
+  // Lets the UI update only what changed when refreshing, instead of resetting the whole view. The
+  // UI layer calls this each time it refreshes, so that each call compares with the rows it shows.
+  [[nodiscard]] RowChanges TakeRowChanges();
 
  protected:
   void InitSortingOrders();
@@ -117,6 +143,8 @@ class DataView {
   int update_period_ms_;
   absl::flat_hash_set<int> selected_indices_;
   DataViewType type_;
+  // The rows at the previous call to TakeRowChanges.
+  std::vector<uint64_t> previous_indices_;
 
   static const std::string kMenuActionCopySelection;
   static const std::string kMenuActionExportToCsv;
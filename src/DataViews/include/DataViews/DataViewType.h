@@ -16,6 +16,7 @@ enum class DataViewType {
   kSampling,
   kPresets,
   kTracepoints,
+  kTimerQueryResults,
   kAll,
 };
 
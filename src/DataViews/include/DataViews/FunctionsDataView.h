@@ -5,11 +5,18 @@
 #ifndef DATA_VIEWS_FUNCTIONS_DATA_VIEW_H_
 #define DATA_VIEWS_FUNCTIONS_DATA_VIEW_H_
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "ClientData/ModuleData.h"
 #include "DataViews/AppInterface.h"
 #include "DataViews/DataView.h"
+#include "OrbitBase/Executor.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/ThreadPool.h"
 #include "capture_data.pb.h"
 
@@ -17,6 +24,7 @@ namespace orbit_data_views {
 class FunctionsDataView : public DataView {
  public:
   explicit FunctionsDataView(AppInterface* app, ThreadPool* thread_pool);
+  ~FunctionsDataView() override;
 
   static const std::string kUnselectedFunctionString;
   static const std::string kSelectedFunctionString;
@@ -33,7 +41,16 @@ class FunctionsDataView : public DataView {
 
   void OnContextMenu(const std::string& action, int menu_index,
                      const std::vector<int>& item_indices) override;
-  void AddFunctions(std::vector<const orbit_client_protos::FunctionInfo*> functions);
+  // Matches the functions on the thread pool, and sorts them there unless they are sorted by
+  // whether they are hooked. A filter that refines the current one, e.g., after typing another
+  // character, only goes through the functions shown.
+  orbit_base::Future<bool> OnFilterAsync(const std::string& filter,
+                                         orbit_base::Executor* main_thread_executor) override;
+  // If `module` is not nullptr, all the `functions` need to be the functions of `module`, in the
+  // order of ModuleData::GetFunctions, so that filtering can use the function name index of the
+  // module.
+  void AddFunctions(std::vector<const orbit_client_protos::FunctionInfo*> functions,
+                    const orbit_client_data::ModuleData* module = nullptr);
   void ClearFunctions();
 
  protected:
@@ -44,6 +61,9 @@ class FunctionsDataView : public DataView {
   }
 
   std::vector<std::string> filter_tokens_;
+  // Whether `indices_` are the functions that match `filter_tokens_`, which is what allows
+  // refining a filter incrementally. Not the case after the functions changed.
+  bool indices_match_filter_tokens_ = false;
 
   enum ColumnIndex {
     kColumnSelected,
@@ -66,9 +86,28 @@ class FunctionsDataView : public DataView {
                                              const orbit_client_protos::FunctionInfo& function);
   static bool ShouldShowFrameTrackIcon(AppInterface* app,
                                        const orbit_client_protos::FunctionInfo& function);
+  // Returns the indices, in ascending order, of the functions that can match all `filter_tokens`
+  // according to the function name indices of the modules, or std::nullopt if that can be any.
+  [[nodiscard]] std::optional<std::vector<uint64_t>> FindCandidatesInFunctionNameIndices(
+      const std::vector<std::string>& filter_tokens) const;
+  static void SortIndices(AppInterface* app,
+                          const std::vector<const orbit_client_protos::FunctionInfo*>& functions,
+                          int column, bool ascending, std::vector<uint64_t>* indices);
+
   std::vector<const orbit_client_protos::FunctionInfo*> functions_;
+  // The ranges of `functions_` added together, and their module if known.
+  struct AddedFunctions {
+    size_t begin;
+    size_t size;
+    const orbit_client_data::ModuleData* module;
+  };
+  std::vector<AddedFunctions> added_functions_;
 
   ThreadPool* thread_pool_;
+  // Incremented by every asynchronous filter, which cancels the ones in progress, and whenever the
+  // functions change. Shared with the tasks of the filters, which can outlive the view.
+  std::shared_ptr<std::atomic<uint64_t>> filter_generation_ =
+      std::make_shared<std::atomic<uint64_t>>(0);
 };
 
 }  // namespace orbit_data_views
@@ -8,51 +8,109 @@
 #include <stddef.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <ios>
 #include <iterator>
+#include <string>
+#include <thread>
 #include <utility>
 
 #include "FramePointerValidator/FunctionFramePointerValidator.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "OrbitBase/UniqueResource.h"
 
 using orbit_grpc_protos::CodeBlock;
 
-std::optional<std::vector<CodeBlock>> FramePointerValidator::GetFpoFunctions(
-    const std::vector<CodeBlock>& functions, const std::filesystem::path& file_name,
-    bool is_64_bit) {
-  std::vector<CodeBlock> result;
+namespace {
+
+// Functions are taken by the threads in batches, as most functions are disassembled in far less
+// time than it takes to contend for the shared index.
+constexpr size_t kFunctionBatchSize = 256;
 
+[[nodiscard]] std::optional<orbit_base::unique_resource<csh, void (*)(csh)>> OpenCapstone(
+    bool is_64_bit) {
   cs_mode mode = is_64_bit ? CS_MODE_64 : CS_MODE_32;
   csh temp_handle;
   if (cs_open(CS_ARCH_X86, mode, &temp_handle) != CS_ERR_OK) {
     ERROR("Unable to open capstone.");
-    return {};
+    return std::nullopt;
   }
-  orbit_base::unique_resource handle{temp_handle, [](csh handle) { cs_close(&handle); }};
-
+  orbit_base::unique_resource<csh, void (*)(csh)> handle{temp_handle,
+                                                         [](csh handle) { cs_close(&handle); }};
   cs_option(handle.get(), CS_OPT_DETAIL, CS_OPT_ON);
+  return handle;
+}
+
+}  // namespace
 
+// Disassembling the functions takes most of the time for large modules, so the functions are
+// validated by several threads. A capstone handle must not be used by several threads at the same
+// time, hence each thread opens its own. The result is in the order of `functions`, as if they
+// were validated by a single thread.
+std::optional<std::vector<CodeBlock>> FramePointerValidator::GetFpoFunctions(
+    const std::vector<CodeBlock>& functions, const std::filesystem::path& file_name,
+    bool is_64_bit) {
   ErrorMessageOr<std::string> binary_or_error = orbit_base::ReadFileToString(file_name);
   if (binary_or_error.has_error()) {
     ERROR("%s", binary_or_error.error().message());
     return {};
   }
+  const std::string& content = binary_or_error.value();
+
+  const size_t batch_count = (functions.size() + kFunctionBatchSize - 1) / kFunctionBatchSize;
+  const size_t thread_count =
+      std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(batch_count, 1));
+
+  std::vector<std::optional<orbit_base::unique_resource<csh, void (*)(csh)>>> handles;
+  handles.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    handles.push_back(OpenCapstone(is_64_bit));
+    if (!handles.back().has_value()) return {};
+  }
+
+  // std::vector<bool> packs its elements, so threads writing to neighboring elements would race.
+  std::vector<char> is_fpo_function(functions.size(), 0);
+  std::atomic<size_t> next_batch_index = 0;
+  auto validate_remaining_batches = [&](csh handle) {
+    for (size_t batch_index = next_batch_index++; batch_index < batch_count;
+         batch_index = next_batch_index++) {
+      const size_t end_index = std::min((batch_index + 1) * kFunctionBatchSize, functions.size());
+      for (size_t index = batch_index * kFunctionBatchSize; index < end_index; ++index) {
+        const CodeBlock& function = functions[index];
+        if (function.size() == 0) continue;
+        if (function.offset() > content.size() ||
+            function.size() > content.size() - function.offset()) {
+          ERROR("Function at offset %#x with size %u exceeds the size of \"%s\"",
+                function.offset(), function.size(), file_name.string());
+          continue;
+        }
 
-  for (const auto& function : functions) {
-    uint64_t function_size = function.size();
-    if (function_size == 0) {
-      continue;
+        FunctionFramePointerValidator validator{handle, content.data() + function.offset(),
+                                                static_cast<size_t>(function.size())};
+        is_fpo_function[index] = validator.Validate() ? 0 : 1;
+      }
     }
+  };
 
-    const std::string& content = binary_or_error.value();
-    FunctionFramePointerValidator validator{handle.get(), content.data() + function.offset(),
-                                            static_cast<size_t>(function.size())};
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back([&validate_remaining_batches, handle = handles[i]->get()] {
+      orbit_base::SetCurrentThreadName("FpValidator");
+      validate_remaining_batches(handle);
+    });
+  }
+  validate_remaining_batches(handles[0]->get());
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
 
-    if (!validator.Validate()) {
-      result.push_back(function);
+  std::vector<CodeBlock> result;
+  for (size_t index = 0; index < functions.size(); ++index) {
+    if (is_fpo_function[index] != 0) {
+      result.push_back(functions[index]);
     }
   }
   return result;
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <outcome.hpp>
@@ -75,3 +76,62 @@ TEST(FramePointerValidator, GetFpoFunctions) {
   EXPECT_THAT(fpo_function_names,
               testing::UnorderedElementsAre("_start", "main", "__libc_csu_init"));
 }
+
+TEST(FramePointerValidator, GetFpoFunctionsKeepsTheOrderOfManyFunctions) {
+  const std::filesystem::path executable_dir = orbit_base::GetExecutableDir();
+  const std::filesystem::path test_elf_file = executable_dir / "testdata" / "hello_world_elf";
+
+  auto elf_file = orbit_object_utils::CreateElfFile(test_elf_file);
+  ASSERT_FALSE(elf_file.has_error()) << elf_file.error().message();
+
+  const auto symbols_result = elf_file.value()->LoadDebugSymbols();
+  ASSERT_FALSE(symbols_result.has_error()) << symbols_result.error().message();
+  uint64_t load_bias = symbols_result.value().load_bias();
+
+  std::vector<CodeBlock> module_functions;
+  for (const SymbolInfo& symbol_info : symbols_result.value().symbol_infos()) {
+    CodeBlock& function = module_functions.emplace_back();
+    function.set_offset(symbol_info.address() - load_bias);
+    function.set_size(symbol_info.size());
+  }
+
+  std::optional<std::vector<CodeBlock>> module_fpo_functions =
+      FramePointerValidator::GetFpoFunctions(module_functions, test_elf_file, true);
+  ASSERT_TRUE(module_fpo_functions.has_value());
+  ASSERT_FALSE(module_fpo_functions->empty());
+
+  // Enough functions to be validated in many batches, by several threads.
+  constexpr size_t kRepetitions = 1000;
+  std::vector<CodeBlock> functions;
+  std::vector<uint64_t> expected_fpo_function_offsets;
+  for (size_t i = 0; i < kRepetitions; ++i) {
+    functions.insert(functions.end(), module_functions.begin(), module_functions.end());
+    for (const CodeBlock& fpo_function : module_fpo_functions.value()) {
+      expected_fpo_function_offsets.push_back(fpo_function.offset());
+    }
+  }
+
+  std::optional<std::vector<CodeBlock>> fpo_functions =
+      FramePointerValidator::GetFpoFunctions(functions, test_elf_file, true);
+  ASSERT_TRUE(fpo_functions.has_value());
+
+  std::vector<uint64_t> fpo_function_offsets;
+  for (const CodeBlock& fpo_function : fpo_functions.value()) {
+    fpo_function_offsets.push_back(fpo_function.offset());
+  }
+  EXPECT_EQ(fpo_function_offsets, expected_fpo_function_offsets);
+}
+
+TEST(FramePointerValidator, GetFpoFunctionsSkipsFunctionsOutsideOfTheFile) {
+  const std::filesystem::path executable_dir = orbit_base::GetExecutableDir();
+  const std::filesystem::path test_elf_file = executable_dir / "testdata" / "hello_world_elf";
+
+  CodeBlock function;
+  function.set_offset(std::numeric_limits<uint64_t>::max() - 1);
+  function.set_size(16);
+
+  std::optional<std::vector<CodeBlock>> fpo_functions =
+      FramePointerValidator::GetFpoFunctions({function}, test_elf_file, true);
+  ASSERT_TRUE(fpo_functions.has_value());
+  EXPECT_TRUE(fpo_functions->empty());
+}
@@ -15,7 +15,8 @@ class FramePointerValidator {
  public:
   // Checks all given functions if they were compiled with frame pointers and
   // returns the functions, where validation failed. If there was an error
-  // during validation, nullopt will be return.
+  // during validation, nullopt will be return. The functions are validated by
+  // several threads.
   static std::optional<std::vector<orbit_grpc_protos::CodeBlock>> GetFpoFunctions(
       const std::vector<orbit_grpc_protos::CodeBlock>& functions,
       const std::filesystem::path& file_name, bool is_64_bit);
@@ -10,13 +10,13 @@
 #include <absl/time/time.h>
 #include <string.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
-#include "OrbitBase/ThreadPool.h"
 #include "OrbitBase/ThreadUtils.h"
 
 using orbit_introspection::TracingListener;
@@ -24,10 +24,85 @@ using orbit_introspection::TracingScope;
 using orbit_introspection::TracingTimerCallback;
 
 ABSL_CONST_INIT static absl::Mutex global_tracing_mutex(absl::kConstInit);
-ABSL_CONST_INIT static TracingListener* global_tracing_listener = nullptr;
 
 // Tracing uses the same function table used by the Orbit API, but specifies its own functions.
-orbit_api_v0 g_orbit_api_v0;
+orbit_api_v1 g_orbit_api_v1;
+
+namespace {
+
+// Single-producer single-consumer ring buffer of the scopes recorded by one thread. The producer is
+// the thread the buffer belongs to, the consumer is the drain thread of the TracingListener.
+class ThreadScopeBuffer {
+ public:
+  ThreadScopeBuffer() : scopes_(kCapacity, TracingScope(orbit_api::kNone)) {}
+
+  bool TryPush(const TracingScope& scope) {
+    const uint64_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (write_index - read_index_.load(std::memory_order_acquire) == kCapacity) {
+      num_dropped_scopes_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    scopes_[write_index % kCapacity] = scope;
+    write_index_.store(write_index + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Calls consumer on all scopes currently in the buffer, then releases their slots at once.
+  template <typename Consumer>
+  void Drain(Consumer&& consumer) {
+    const uint64_t read_index = read_index_.load(std::memory_order_relaxed);
+    const uint64_t write_index = write_index_.load(std::memory_order_acquire);
+    for (uint64_t index = read_index; index < write_index; ++index) {
+      consumer(scopes_[index % kCapacity]);
+    }
+    read_index_.store(write_index, std::memory_order_release);
+  }
+
+  // Discards the scopes currently in the buffer. Like Drain, this must only be called by the
+  // consumer.
+  void Clear() {
+    read_index_.store(write_index_.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  [[nodiscard]] uint64_t TakeNumDroppedScopes() {
+    return num_dropped_scopes_.exchange(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint64_t kCapacity = 4096;
+  std::vector<TracingScope> scopes_;
+  alignas(64) std::atomic<uint64_t> write_index_ = 0;
+  alignas(64) std::atomic<uint64_t> read_index_ = 0;
+  std::atomic<uint64_t> num_dropped_scopes_ = 0;
+};
+
+ABSL_CONST_INIT absl::Mutex global_thread_buffers_mutex(absl::kConstInit);
+
+// The buffers are shared between the threads they belong to and this list, which keeps them alive
+// until they have been drained one last time after their thread exited. The list is intentionally
+// leaked so that it outlives the thread_local buffers of threads that exit during static
+// destruction.
+std::vector<std::shared_ptr<ThreadScopeBuffer>>& GetThreadBuffers()
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(global_thread_buffers_mutex) {
+  static auto* thread_buffers = new std::vector<std::shared_ptr<ThreadScopeBuffer>>();
+  return *thread_buffers;
+}
+
+ThreadScopeBuffer* GetThreadLocalScopeBuffer() {
+  thread_local std::shared_ptr<ThreadScopeBuffer> thread_local_buffer = [] {
+    auto buffer = std::make_shared<ThreadScopeBuffer>();
+    absl::MutexLock lock(&global_thread_buffers_mutex);
+    GetThreadBuffers().push_back(buffer);
+    return buffer;
+  }();
+  return thread_local_buffer.get();
+}
+
+// Set on the drain thread to prevent the scopes recorded by the user callback from being fed back
+// to it.
+thread_local bool is_internal_update = false;
+
+}  // namespace
 
 namespace orbit_introspection {
 
@@ -37,89 +112,149 @@ TracingScope::TracingScope(orbit_api::EventType type, const char* name, uint64_t
                            orbit_api_color color)
     : encoded_event(type, name, data, color) {}
 
-TracingListener::TracingListener(TracingTimerCallback callback) {
-  constexpr size_t kMinNumThreads = 1;
-  constexpr size_t kMaxNumThreads = 1;
-  thread_pool_ = ThreadPool::Create(kMinNumThreads, kMaxNumThreads, absl::Milliseconds(500));
+TracingListener::TracingListener(TracingTimerCallback callback, uint32_t sampling_period) {
   user_callback_ = std::move(callback);
 
   // Activate listener (only one listener instance is supported).
   absl::MutexLock lock(&global_tracing_mutex);
   CHECK(!IsActive());
   InitializeTracing();
-  global_tracing_listener = this;
-  active_ = true;
-  shutdown_initiated_ = false;
+
+  // Scopes recorded after the previous listener drained the buffers for the last time are stale.
+  // No drain thread is running, so it is safe to discard them from here.
+  {
+    absl::MutexLock buffers_lock(&global_thread_buffers_mutex);
+    for (const std::shared_ptr<ThreadScopeBuffer>& buffer : GetThreadBuffers()) {
+      buffer->Clear();
+    }
+  }
+
+  sampling_period_.store(std::max<uint32_t>(sampling_period, 1), std::memory_order_relaxed);
+  drain_thread_ = std::thread([this] { DrainThreadMain(); });
+  active_.store(true, std::memory_order_release);
+  shutdown_initiated_.store(false, std::memory_order_release);
 }
 
 TracingListener::~TracingListener() {
-  // Communicate that the thread pool will be shut down before shutting down
-  // the thread pool itself.
-  // Note that this is required, as otherwise, we might allow scheduling
-  // new events on the already shut down thread pool.
+  // Stop accepting new scopes before stopping the drain thread, which drains the buffers one last
+  // time before exiting.
   {
     absl::MutexLock lock(&global_tracing_mutex);
     CHECK(IsActive());
-    shutdown_initiated_ = true;
+    shutdown_initiated_.store(true, std::memory_order_release);
   }
-  // Purge deferred scopes.
-  thread_pool_->Shutdown();
-  thread_pool_->Wait();
+  {
+    absl::MutexLock lock(&drain_thread_mutex_);
+    drain_thread_exit_requested_ = true;
+  }
+  drain_thread_.join();
 
-  // Deactivate and destroy the listener.
+  if (num_dropped_scopes_ > 0) {
+    LOG("Introspection dropped %lu scopes because of full thread buffers", num_dropped_scopes_);
+  }
+
+  // Deactivate the listener.
   absl::MutexLock lock(&global_tracing_mutex);
-  active_ = false;
-  global_tracing_listener = nullptr;
+  active_.store(false, std::memory_order_release);
 }
 
-}  // namespace orbit_introspection
+void TracingListener::DrainThreadMain() {
+  orbit_base::SetCurrentThreadName("IntrospectDrain");
+  is_internal_update = true;
+
+  constexpr absl::Duration kDrainPeriod = absl::Milliseconds(10);
+  bool exit_requested = false;
+  while (!exit_requested) {
+    {
+      absl::MutexLock lock(&drain_thread_mutex_);
+      drain_thread_mutex_.AwaitWithTimeout(absl::Condition(&drain_thread_exit_requested_),
+                                           kDrainPeriod);
+      exit_requested = drain_thread_exit_requested_;
+    }
+    DrainThreadBuffers();
+  }
+}
 
-namespace {
-struct ScopeToggle {
-  ScopeToggle() = delete;
-  ScopeToggle(bool* value, bool initial_value) : toggle(value) { *toggle = initial_value; }
-  ~ScopeToggle() { *toggle = !*toggle; }
-  bool* toggle = nullptr;
-};
-}  // namespace
+void TracingListener::DrainThreadBuffers() {
+  std::vector<std::shared_ptr<ThreadScopeBuffer>> buffers;
+  {
+    absl::MutexLock lock(&global_thread_buffers_mutex);
+    std::vector<std::shared_ptr<ThreadScopeBuffer>>& thread_buffers = GetThreadBuffers();
+    buffers = thread_buffers;
+    // The buffers only referenced by the list (and now by the copy) belong to threads that have
+    // exited: drain them one last time below and then let them be destroyed.
+    thread_buffers.erase(std::remove_if(thread_buffers.begin(), thread_buffers.end(),
+                                        [](const std::shared_ptr<ThreadScopeBuffer>& buffer) {
+                                          return buffer.use_count() == 2;
+                                        }),
+                         thread_buffers.end());
+  }
+
+  for (const std::shared_ptr<ThreadScopeBuffer>& buffer : buffers) {
+    buffer->Drain([this](const TracingScope& scope) { user_callback_(scope); });
+    num_dropped_scopes_ += buffer->TakeNumDroppedScopes();
+  }
+}
+
+}  // namespace orbit_introspection
 
 void TracingListener::DeferScopeProcessing(const TracingScope& scope) {
   // Prevent reentry to avoid feedback loop.
-  thread_local bool is_internal_update = false;
   if (is_internal_update) return;
-
-  // User callback is called from a worker thread to minimize contention on instrumented threads.
-  absl::MutexLock lock(&global_tracing_mutex);
   if (IsShutdownInitiated()) return;
-  global_tracing_listener->thread_pool_->Schedule([scope]() {
-    ScopeToggle scope_toggle(&is_internal_update, true);
-    absl::MutexLock lock(&global_tracing_mutex);
-    if (!IsActive()) return;
-    global_tracing_listener->user_callback_(scope);
-  });
+
+  // The user callback is called from the drain thread, so the instrumented threads only push the
+  // scope into their own buffer.
+  GetThreadLocalScopeBuffer()->TryPush(scope);
 }
 
-static std::vector<TracingScope>& GetThreadLocalScopes() {
-  thread_local std::vector<TracingScope> thread_local_scopes;
+namespace {
+struct ThreadLocalScopes {
+  std::vector<TracingScope> scopes;
+  // Number of currently open scopes that belong to a top-level scope that was not sampled. These
+  // are not pushed to scopes, which also avoids reading the clock for them.
+  uint32_t num_open_unsampled_scopes = 0;
+  uint64_t num_top_level_scopes = 0;
+};
+}  // namespace
+
+static ThreadLocalScopes& GetThreadLocalScopes() {
+  thread_local ThreadLocalScopes thread_local_scopes;
   return thread_local_scopes;
 }
 
 void orbit_api_start(const char* name, orbit_api_color color) {
-  GetThreadLocalScopes().emplace_back(
+  ThreadLocalScopes& thread_local_scopes = GetThreadLocalScopes();
+  if (thread_local_scopes.num_open_unsampled_scopes > 0) {
+    ++thread_local_scopes.num_open_unsampled_scopes;
+    return;
+  }
+  if (thread_local_scopes.scopes.empty() &&
+      thread_local_scopes.num_top_level_scopes++ % TracingListener::GetSamplingPeriod() != 0) {
+    thread_local_scopes.num_open_unsampled_scopes = 1;
+    return;
+  }
+
+  thread_local_scopes.scopes.emplace_back(
       TracingScope(orbit_api::kScopeStart, name, /*data*/ 0, color));
-  auto& scope = GetThreadLocalScopes().back();
+  auto& scope = thread_local_scopes.scopes.back();
   scope.begin = orbit_base::CaptureTimestampNs();
 }
 
 void orbit_api_stop() {
-  std::vector<TracingScope>& thread_local_scopes = GetThreadLocalScopes();
-  if (thread_local_scopes.size() == 0) return;
-  auto& scope = thread_local_scopes.back();
+  ThreadLocalScopes& thread_local_scopes = GetThreadLocalScopes();
+  if (thread_local_scopes.num_open_unsampled_scopes > 0) {
+    --thread_local_scopes.num_open_unsampled_scopes;
+    return;
+  }
+  std::vector<TracingScope>& scopes = thread_local_scopes.scopes;
+  if (scopes.size() == 0) return;
+  auto& scope = scopes.back();
   scope.end = orbit_base::CaptureTimestampNs();
-  scope.depth = GetThreadLocalScopes().size() - 1;
+  scope.depth = scopes.size() - 1;
   scope.tid = static_cast<uint32_t>(orbit_base::GetCurrentThreadId());
   TracingListener::DeferScopeProcessing(scope);
-  GetThreadLocalScopes().pop_back();
+  scopes.pop_back();
 }
 
 void orbit_api_start_async(const char* name, uint64_t id, orbit_api_color color) {
@@ -187,21 +322,21 @@ void orbit_api_track_double(const char* name, double value, orbit_api_color colo
 namespace orbit_introspection {
 
 void InitializeTracing() {
-  if (g_orbit_api_v0.initialized != 0) return;
-  g_orbit_api_v0.start = &orbit_api_start;
-  g_orbit_api_v0.stop = &orbit_api_stop;
-  g_orbit_api_v0.start_async = &orbit_api_start_async;
-  g_orbit_api_v0.stop_async = &orbit_api_stop_async;
-  g_orbit_api_v0.async_string = &orbit_api_async_string;
-  g_orbit_api_v0.track_int = &orbit_api_track_int;
-  g_orbit_api_v0.track_int64 = &orbit_api_track_int64;
-  g_orbit_api_v0.track_uint = &orbit_api_track_uint;
-  g_orbit_api_v0.track_uint64 = &orbit_api_track_uint64;
-  g_orbit_api_v0.track_float = &orbit_api_track_float;
-  g_orbit_api_v0.track_double = &orbit_api_track_double;
+  if (g_orbit_api_v1.initialized != 0) return;
+  g_orbit_api_v1.start = &orbit_api_start;
+  g_orbit_api_v1.stop = &orbit_api_stop;
+  g_orbit_api_v1.start_async = &orbit_api_start_async;
+  g_orbit_api_v1.stop_async = &orbit_api_stop_async;
+  g_orbit_api_v1.async_string = &orbit_api_async_string;
+  g_orbit_api_v1.track_int = &orbit_api_track_int;
+  g_orbit_api_v1.track_int64 = &orbit_api_track_int64;
+  g_orbit_api_v1.track_uint = &orbit_api_track_uint;
+  g_orbit_api_v1.track_uint64 = &orbit_api_track_uint64;
+  g_orbit_api_v1.track_float = &orbit_api_track_float;
+  g_orbit_api_v1.track_double = &orbit_api_track_double;
   std::atomic_thread_fence(std::memory_order_release);
-  g_orbit_api_v0.initialized = 1;
-  g_orbit_api_v0.enabled = 1;
+  g_orbit_api_v1.initialized = 1;
+  g_orbit_api_v1.enabled = 1;
 }
 
 }  // namespace orbit_introspection
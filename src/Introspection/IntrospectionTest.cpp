@@ -22,6 +22,13 @@ static void TestScopes() {
   ORBIT_STOP();
 }
 
+static void TestTopLevelScopes(size_t num_top_level_scopes) {
+  for (size_t i = 0; i < num_top_level_scopes; ++i) {
+    ORBIT_SCOPE("TEST_ORBIT_SCOPE_TOP_LEVEL");
+    ORBIT_SCOPE("TEST_ORBIT_SCOPE_NESTED");
+  }
+}
+
 namespace orbit_introspection {
 
 TEST(Tracing, Scopes) {
@@ -58,4 +65,61 @@ TEST(Tracing, Scopes) {
   }
 }
 
+TEST(Tracing, SamplingKeepsOneInNTopLevelScopesWithTheirNestedScopes) {
+  constexpr size_t kNumThreads = 10;
+  constexpr uint32_t kSamplingPeriod = 3;
+  constexpr size_t kNumTopLevelScopesPerThread = 10;
+  // The first top-level scope of each thread is sampled.
+  constexpr size_t kNumExpectedTopLevelScopesPerThread = 4;
+
+  absl::flat_hash_map<uint32_t, std::vector<TracingScope>> scopes_by_thread_id;
+  {
+    TracingListener tracing_listener(
+        [&scopes_by_thread_id](const TracingScope& scope) {
+          scopes_by_thread_id[scope.tid].emplace_back(scope);
+        },
+        kSamplingPeriod);
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back(
+          std::make_unique<std::thread>([] { TestTopLevelScopes(kNumTopLevelScopesPerThread); }));
+    }
+
+    for (auto& thread : threads) {
+      thread->join();
+    }
+  }
+
+  EXPECT_EQ(scopes_by_thread_id.size(), kNumThreads);
+  for (const auto& [unused_tid, scopes] : scopes_by_thread_id) {
+    ASSERT_EQ(scopes.size(), 2 * kNumExpectedTopLevelScopesPerThread);
+    for (size_t i = 0; i < scopes.size(); i += 2) {
+      // Nested scopes are recorded when they stop, so before their parent.
+      EXPECT_EQ(scopes[i].depth, 1u);
+      EXPECT_EQ(scopes[i + 1].depth, 0u);
+      EXPECT_GE(scopes[i].begin, scopes[i + 1].begin);
+      EXPECT_LE(scopes[i].end, scopes[i + 1].end);
+    }
+  }
+}
+
+TEST(Tracing, ScopesOfExitedThreadsAreNotReportedToTheNextListener) {
+  std::vector<TracingScope> scopes;
+  {
+    TracingListener tracing_listener(
+        [&scopes](const TracingScope& scope) { scopes.emplace_back(scope); });
+    std::thread thread([] { TestScopes(); });
+    thread.join();
+  }
+  EXPECT_EQ(scopes.size(), 4u);
+
+  scopes.clear();
+  {
+    TracingListener tracing_listener(
+        [&scopes](const TracingScope& scope) { scopes.emplace_back(scope); });
+  }
+  EXPECT_TRUE(scopes.empty());
+}
+
 }  // namespace orbit_introspection
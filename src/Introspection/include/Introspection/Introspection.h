@@ -5,14 +5,17 @@
 #ifndef INTROSPECTION_INTROSPECTION_H_
 #define INTROSPECTION_INTROSPECTION_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <thread>
 
 #include "Api/EncodedEvent.h"
 #include "Api/Orbit.h"
-#include "OrbitBase/ThreadPool.h"
 #include "OrbitBase/ThreadUtils.h"
 
 #define ORBIT_SCOPE_FUNCTION ORBIT_SCOPE(__FUNCTION__)
@@ -31,20 +34,39 @@ struct TracingScope {
 
 using TracingTimerCallback = std::function<void(const TracingScope& scope)>;
 
+// Each instrumented thread records its scopes into its own lock-free buffer. A single worker
+// thread of the listener drains all these buffers in batches and calls the callback for each scope,
+// so the instrumented threads never take a lock nor wait for the callback. Scopes recorded while
+// the buffer of a thread is full are dropped.
+// If sampling_period is greater than 1, only one in sampling_period top-level scopes of each thread
+// is recorded, together with all the scopes nested in it. Async scopes, strings and tracked values
+// are always recorded.
 class TracingListener {
  public:
-  explicit TracingListener(TracingTimerCallback callback);
+  explicit TracingListener(TracingTimerCallback callback, uint32_t sampling_period = 1);
   ~TracingListener();
 
   static void DeferScopeProcessing(const TracingScope& scope);
-  [[nodiscard]] inline static bool IsActive() { return active_; }
-  [[nodiscard]] inline static bool IsShutdownInitiated() { return shutdown_initiated_; }
+  [[nodiscard]] inline static bool IsActive() { return active_.load(std::memory_order_acquire); }
+  [[nodiscard]] inline static bool IsShutdownInitiated() {
+    return shutdown_initiated_.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] inline static uint32_t GetSamplingPeriod() {
+    return sampling_period_.load(std::memory_order_relaxed);
+  }
 
  private:
+  void DrainThreadMain();
+  void DrainThreadBuffers();
+
   TracingTimerCallback user_callback_ = nullptr;
-  std::shared_ptr<ThreadPool> thread_pool_ = {};
-  inline static bool active_ = false;
-  inline static bool shutdown_initiated_ = true;
+  std::thread drain_thread_;
+  absl::Mutex drain_thread_mutex_;
+  bool drain_thread_exit_requested_ ABSL_GUARDED_BY(drain_thread_mutex_) = false;
+  uint64_t num_dropped_scopes_ = 0;
+  inline static std::atomic<bool> active_ = false;
+  inline static std::atomic<bool> shutdown_initiated_ = true;
+  inline static std::atomic<uint32_t> sampling_period_ = 1;
 };
 
 }  // namespace orbit_introspection
@@ -0,0 +1,86 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AdaptiveSamplingPeriodController.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+AdaptiveSamplingPeriodController::AdaptiveSamplingPeriodController(
+    uint64_t base_sampling_period_ns, const std::vector<int32_t>& cpus,
+    uint64_t lost_records_threshold, uint64_t max_period_multiplier,
+    uint32_t quiet_updates_before_decrease)
+    : base_sampling_period_ns_{base_sampling_period_ns},
+      max_sampling_period_ns_{base_sampling_period_ns * max_period_multiplier},
+      lost_records_threshold_{lost_records_threshold},
+      quiet_updates_before_decrease_{quiet_updates_before_decrease} {
+  CHECK(base_sampling_period_ns_ > 0);
+  CHECK(max_period_multiplier >= 1);
+  for (int32_t cpu : cpus) {
+    cpu_states_.emplace(cpu, CpuState{base_sampling_period_ns_});
+  }
+}
+
+void AdaptiveSamplingPeriodController::OnLostRecords(int32_t cpu, uint64_t lost_count) {
+  absl::MutexLock lock{&mutex_};
+  auto it = cpu_states_.find(cpu);
+  if (it == cpu_states_.end()) {
+    return;
+  }
+  it->second.lost_count_since_update += lost_count;
+}
+
+void AdaptiveSamplingPeriodController::OnThrottle(int32_t cpu) {
+  absl::MutexLock lock{&mutex_};
+  auto it = cpu_states_.find(cpu);
+  if (it == cpu_states_.end()) {
+    return;
+  }
+  it->second.throttled_since_update = true;
+}
+
+std::vector<AdaptiveSamplingPeriodController::SamplingPeriodChange>
+AdaptiveSamplingPeriodController::UpdateSamplingPeriods() {
+  std::vector<SamplingPeriodChange> changes;
+  absl::MutexLock lock{&mutex_};
+  for (auto& [cpu, state] : cpu_states_) {
+    const bool under_pressure =
+        state.throttled_since_update || state.lost_count_since_update > lost_records_threshold_;
+    state.lost_count_since_update = 0;
+    state.throttled_since_update = false;
+
+    uint64_t new_sampling_period_ns = state.sampling_period_ns;
+    if (under_pressure) {
+      state.quiet_update_count = 0;
+      new_sampling_period_ns = std::min(2 * state.sampling_period_ns, max_sampling_period_ns_);
+    } else if (state.sampling_period_ns > base_sampling_period_ns_ &&
+               ++state.quiet_update_count >= quiet_updates_before_decrease_) {
+      state.quiet_update_count = 0;
+      new_sampling_period_ns = std::max(state.sampling_period_ns / 2, base_sampling_period_ns_);
+    }
+
+    if (new_sampling_period_ns != state.sampling_period_ns) {
+      state.sampling_period_ns = new_sampling_period_ns;
+      changes.push_back({cpu, new_sampling_period_ns});
+    }
+  }
+
+  std::sort(changes.begin(), changes.end(),
+            [](const SamplingPeriodChange& lhs, const SamplingPeriodChange& rhs) {
+              return lhs.cpu < rhs.cpu;
+            });
+  return changes;
+}
+
+uint64_t AdaptiveSamplingPeriodController::GetSamplingPeriodNs(int32_t cpu) const {
+  absl::MutexLock lock{&mutex_};
+  auto it = cpu_states_.find(cpu);
+  CHECK(it != cpu_states_.end());
+  return it->second.sampling_period_ns;
+}
+
+}  // namespace orbit_linux_tracing
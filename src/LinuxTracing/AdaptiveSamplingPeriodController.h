@@ -0,0 +1,69 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_ADAPTIVE_SAMPLING_PERIOD_CONTROLLER_H_
+#define LINUX_TRACING_ADAPTIVE_SAMPLING_PERIOD_CONTROLLER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+// AdaptiveSamplingPeriodController decides the sampling period to use on each CPU depending on the
+// pressure that sampling puts on that CPU, that is, on how many records were lost from the
+// sampling ring buffer of the CPU and on whether sampling was throttled on the CPU.
+// OnLostRecords and OnThrottle can be called from any thread. UpdateSamplingPeriods is expected to
+// be called at regular intervals: if the pressure on a CPU since the previous call exceeded the
+// threshold, the sampling period on that CPU is doubled, up to max_period_multiplier times the
+// base period; if there was no pressure for quiet_updates_before_decrease consecutive calls, the
+// period is halved, down to the base period.
+class AdaptiveSamplingPeriodController {
+ public:
+  struct SamplingPeriodChange {
+    int32_t cpu;
+    uint64_t sampling_period_ns;
+  };
+
+  AdaptiveSamplingPeriodController(uint64_t base_sampling_period_ns,
+                                   const std::vector<int32_t>& cpus,
+                                   uint64_t lost_records_threshold = kDefaultLostRecordsThreshold,
+                                   uint64_t max_period_multiplier = kDefaultMaxPeriodMultiplier,
+                                   uint32_t quiet_updates_before_decrease =
+                                       kDefaultQuietUpdatesBeforeDecrease);
+
+  void OnLostRecords(int32_t cpu, uint64_t lost_count);
+  void OnThrottle(int32_t cpu);
+
+  // Returns the CPUs whose sampling period has changed, together with the new period.
+  [[nodiscard]] std::vector<SamplingPeriodChange> UpdateSamplingPeriods();
+
+  [[nodiscard]] uint64_t GetSamplingPeriodNs(int32_t cpu) const;
+
+  static constexpr uint64_t kDefaultLostRecordsThreshold = 0;
+  static constexpr uint64_t kDefaultMaxPeriodMultiplier = 16;
+  static constexpr uint32_t kDefaultQuietUpdatesBeforeDecrease = 2;
+
+ private:
+  struct CpuState {
+    uint64_t sampling_period_ns;
+    uint64_t lost_count_since_update = 0;
+    bool throttled_since_update = false;
+    uint32_t quiet_update_count = 0;
+  };
+
+  const uint64_t base_sampling_period_ns_;
+  const uint64_t max_sampling_period_ns_;
+  const uint64_t lost_records_threshold_;
+  const uint32_t quiet_updates_before_decrease_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<int32_t, CpuState> cpu_states_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_ADAPTIVE_SAMPLING_PERIOD_CONTROLLER_H_
@@ -0,0 +1,97 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "AdaptiveSamplingPeriodController.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr uint64_t kBasePeriodNs = 1'000'000;
+
+}  // namespace
+
+TEST(AdaptiveSamplingPeriodController, NoPressureKeepsBasePeriod) {
+  AdaptiveSamplingPeriodController controller{kBasePeriodNs, {0, 1}};
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+  EXPECT_EQ(controller.GetSamplingPeriodNs(0), kBasePeriodNs);
+  EXPECT_EQ(controller.GetSamplingPeriodNs(1), kBasePeriodNs);
+}
+
+TEST(AdaptiveSamplingPeriodController, LostRecordsAboveThresholdDoublePeriodOnlyOnThatCpu) {
+  AdaptiveSamplingPeriodController controller{kBasePeriodNs, {0, 1}, /*lost_records_threshold=*/10};
+
+  controller.OnLostRecords(1, 10);
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+
+  controller.OnLostRecords(1, 5);
+  controller.OnLostRecords(1, 6);
+  std::vector<AdaptiveSamplingPeriodController::SamplingPeriodChange> changes =
+      controller.UpdateSamplingPeriods();
+  ASSERT_EQ(changes.size(), 1);
+  EXPECT_EQ(changes[0].cpu, 1);
+  EXPECT_EQ(changes[0].sampling_period_ns, 2 * kBasePeriodNs);
+  EXPECT_EQ(controller.GetSamplingPeriodNs(0), kBasePeriodNs);
+  EXPECT_EQ(controller.GetSamplingPeriodNs(1), 2 * kBasePeriodNs);
+}
+
+TEST(AdaptiveSamplingPeriodController, ThrottleDoublesPeriodUpToMax) {
+  AdaptiveSamplingPeriodController controller{kBasePeriodNs, {3}, /*lost_records_threshold=*/0,
+                                              /*max_period_multiplier=*/4};
+
+  controller.OnThrottle(3);
+  ASSERT_EQ(controller.UpdateSamplingPeriods().size(), 1);
+  EXPECT_EQ(controller.GetSamplingPeriodNs(3), 2 * kBasePeriodNs);
+
+  controller.OnThrottle(3);
+  ASSERT_EQ(controller.UpdateSamplingPeriods().size(), 1);
+  EXPECT_EQ(controller.GetSamplingPeriodNs(3), 4 * kBasePeriodNs);
+
+  controller.OnThrottle(3);
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+  EXPECT_EQ(controller.GetSamplingPeriodNs(3), 4 * kBasePeriodNs);
+}
+
+TEST(AdaptiveSamplingPeriodController, PeriodDecreasesBackToBaseAfterQuietUpdates) {
+  AdaptiveSamplingPeriodController controller{kBasePeriodNs, {0}, /*lost_records_threshold=*/0,
+                                              /*max_period_multiplier=*/16,
+                                              /*quiet_updates_before_decrease=*/2};
+
+  controller.OnLostRecords(0, 1);
+  (void)controller.UpdateSamplingPeriods();
+  controller.OnLostRecords(0, 1);
+  (void)controller.UpdateSamplingPeriods();
+  ASSERT_EQ(controller.GetSamplingPeriodNs(0), 4 * kBasePeriodNs);
+
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+  std::vector<AdaptiveSamplingPeriodController::SamplingPeriodChange> changes =
+      controller.UpdateSamplingPeriods();
+  ASSERT_EQ(changes.size(), 1);
+  EXPECT_EQ(changes[0].sampling_period_ns, 2 * kBasePeriodNs);
+
+  // New pressure resets the count of quiet updates.
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+  controller.OnThrottle(0);
+  ASSERT_EQ(controller.UpdateSamplingPeriods().size(), 1);
+  EXPECT_EQ(controller.GetSamplingPeriodNs(0), 4 * kBasePeriodNs);
+
+  for (int i = 0; i < 10; ++i) {
+    (void)controller.UpdateSamplingPeriods();
+  }
+  EXPECT_EQ(controller.GetSamplingPeriodNs(0), kBasePeriodNs);
+}
+
+TEST(AdaptiveSamplingPeriodController, UnknownCpusAreIgnored) {
+  AdaptiveSamplingPeriodController controller{kBasePeriodNs, {0}};
+  controller.OnLostRecords(5, 100);
+  controller.OnThrottle(5);
+  EXPECT_TRUE(controller.UpdateSamplingPeriods().empty());
+}
+
+}  // namespace orbit_linux_tracing
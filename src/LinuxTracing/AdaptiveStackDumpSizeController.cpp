@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AdaptiveStackDumpSizeController.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+AdaptiveStackDumpSizeController::AdaptiveStackDumpSizeController(
+    std::vector<uint16_t> stack_dump_sizes, double max_truncated_sample_ratio,
+    uint64_t min_samples_per_update, uint32_t quiet_updates_before_decrease)
+    : stack_dump_sizes_{[&stack_dump_sizes] {
+        std::sort(stack_dump_sizes.begin(), stack_dump_sizes.end());
+        stack_dump_sizes.erase(std::unique(stack_dump_sizes.begin(), stack_dump_sizes.end()),
+                               stack_dump_sizes.end());
+        return std::move(stack_dump_sizes);
+      }()},
+      max_truncated_sample_ratio_{max_truncated_sample_ratio},
+      min_samples_per_update_{min_samples_per_update},
+      quiet_updates_before_decrease_{quiet_updates_before_decrease} {
+  CHECK(!stack_dump_sizes_.empty());
+  stack_dump_size_index_ = stack_dump_sizes_.size() - 1;
+}
+
+void AdaptiveStackDumpSizeController::OnStackSampleUnwound(
+    pid_t tid, uint64_t stack_dump_size, std::optional<uint64_t> used_stack_bytes) {
+  absl::MutexLock lock{&mutex_};
+  ++sample_count_since_update_;
+  if (!used_stack_bytes.has_value()) {
+    // Samples taken before an increase have a smaller stack dump and don't count as truncated.
+    if (stack_dump_size >= stack_dump_sizes_[stack_dump_size_index_]) {
+      ++truncated_sample_count_since_update_;
+    }
+    return;
+  }
+  uint64_t& max_used_stack_bytes = max_used_stack_bytes_by_tid_[tid];
+  max_used_stack_bytes = std::max(max_used_stack_bytes, used_stack_bytes.value());
+}
+
+std::optional<uint16_t> AdaptiveStackDumpSizeController::UpdateStackDumpSize() {
+  absl::MutexLock lock{&mutex_};
+  const uint64_t sample_count = sample_count_since_update_;
+  const uint64_t truncated_sample_count = truncated_sample_count_since_update_;
+  sample_count_since_update_ = 0;
+  truncated_sample_count_since_update_ = 0;
+
+  size_t new_index = stack_dump_size_index_;
+  if (truncated_sample_count > 0 &&
+      static_cast<double>(truncated_sample_count) >
+          max_truncated_sample_ratio_ * static_cast<double>(sample_count)) {
+    quiet_update_count_ = 0;
+    new_index = std::min(stack_dump_size_index_ + 1, stack_dump_sizes_.size() - 1);
+  } else if (sample_count < min_samples_per_update_) {
+    return std::nullopt;
+  } else if (stack_dump_size_index_ > 0 &&
+             ++quiet_update_count_ >= quiet_updates_before_decrease_) {
+    quiet_update_count_ = 0;
+    uint64_t max_used_stack_bytes = 0;
+    for (const auto& [unused_tid, thread_max_used_stack_bytes] : max_used_stack_bytes_by_tid_) {
+      max_used_stack_bytes = std::max(max_used_stack_bytes, thread_max_used_stack_bytes);
+    }
+    const uint64_t required_stack_dump_size = max_used_stack_bytes + kHeadroomBytes;
+    new_index = std::lower_bound(stack_dump_sizes_.begin(),
+                                 stack_dump_sizes_.begin() + stack_dump_size_index_,
+                                 required_stack_dump_size) -
+                stack_dump_sizes_.begin();
+  }
+
+  if (new_index == stack_dump_size_index_) {
+    return std::nullopt;
+  }
+  stack_dump_size_index_ = new_index;
+  max_used_stack_bytes_by_tid_.clear();
+  return stack_dump_sizes_[stack_dump_size_index_];
+}
+
+uint16_t AdaptiveStackDumpSizeController::GetStackDumpSize() const {
+  absl::MutexLock lock{&mutex_};
+  return stack_dump_sizes_[stack_dump_size_index_];
+}
+
+}  // namespace orbit_linux_tracing
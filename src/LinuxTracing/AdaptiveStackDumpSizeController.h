@@ -0,0 +1,77 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_ADAPTIVE_STACK_DUMP_SIZE_CONTROLLER_H_
+#define LINUX_TRACING_ADAPTIVE_STACK_DUMP_SIZE_CONTROLLER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+// AdaptiveStackDumpSizeController decides how many bytes of the user stack are copied with each
+// stack sample, choosing among the stack_dump_sizes passed to the constructor, from the largest of
+// which it starts. OnStackSampleUnwound can be called from any thread. UpdateStackDumpSize is
+// expected to be called at regular intervals: if more than max_truncated_sample_ratio of the
+// samples since the previous call failed to unwind even though their stack dump was full, which
+// means that the stack dump was most likely too small, the next larger size is chosen; if the
+// deepest stack of any thread, over quiet_updates_before_decrease consecutive calls with at least
+// min_samples_per_update samples each, fits with some headroom in a smaller size, the smallest such
+// size is chosen.
+// As the stack dump size is a property of the perf_event_open file descriptors, which sample all
+// threads of a cpu, a single size is used for all threads.
+class AdaptiveStackDumpSizeController {
+ public:
+  explicit AdaptiveStackDumpSizeController(
+      std::vector<uint16_t> stack_dump_sizes,
+      double max_truncated_sample_ratio = kDefaultMaxTruncatedSampleRatio,
+      uint64_t min_samples_per_update = kDefaultMinSamplesPerUpdate,
+      uint32_t quiet_updates_before_decrease = kDefaultQuietUpdatesBeforeDecrease);
+
+  // stack_dump_size is the number of bytes of stack that came with the sample and used_stack_bytes
+  // is the distance from the stack pointer of the innermost frame to the stack pointer of the
+  // outermost frame, or std::nullopt if the sample couldn't be unwound.
+  void OnStackSampleUnwound(pid_t tid, uint64_t stack_dump_size,
+                            std::optional<uint64_t> used_stack_bytes);
+
+  // Returns the new stack dump size if it has changed.
+  [[nodiscard]] std::optional<uint16_t> UpdateStackDumpSize();
+
+  [[nodiscard]] uint16_t GetStackDumpSize() const;
+  [[nodiscard]] const std::vector<uint16_t>& GetStackDumpSizes() const {
+    return stack_dump_sizes_;
+  }
+
+  static constexpr double kDefaultMaxTruncatedSampleRatio = 0.01;
+  static constexpr uint64_t kDefaultMinSamplesPerUpdate = 100;
+  static constexpr uint32_t kDefaultQuietUpdatesBeforeDecrease = 4;
+  // Unwinding reads a little past the stack pointer of the outermost frame, and unwound samples
+  // don't necessarily include the deepest stack of a thread.
+  static constexpr uint64_t kHeadroomBytes = 1024;
+
+ private:
+  // Sorted in ascending order.
+  const std::vector<uint16_t> stack_dump_sizes_;
+  const double max_truncated_sample_ratio_;
+  const uint64_t min_samples_per_update_;
+  const uint32_t quiet_updates_before_decrease_;
+
+  mutable absl::Mutex mutex_;
+  size_t stack_dump_size_index_ ABSL_GUARDED_BY(mutex_);
+  uint64_t sample_count_since_update_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t truncated_sample_count_since_update_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Deepest stack observed for each thread since the last decrease or increase.
+  absl::flat_hash_map<pid_t, uint64_t> max_used_stack_bytes_by_tid_ ABSL_GUARDED_BY(mutex_);
+  uint32_t quiet_update_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_ADAPTIVE_STACK_DUMP_SIZE_CONTROLLER_H_
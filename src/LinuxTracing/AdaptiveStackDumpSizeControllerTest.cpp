@@ -0,0 +1,92 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <optional>
+
+#include "AdaptiveStackDumpSizeController.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr pid_t kTid = 42;
+
+void AddSamples(AdaptiveStackDumpSizeController* controller, pid_t tid, uint64_t count,
+                uint64_t stack_dump_size, std::optional<uint64_t> used_stack_bytes) {
+  for (uint64_t i = 0; i < count; ++i) {
+    controller->OnStackSampleUnwound(tid, stack_dump_size, used_stack_bytes);
+  }
+}
+
+}  // namespace
+
+TEST(AdaptiveStackDumpSizeController, StartsFromLargestSize) {
+  AdaptiveStackDumpSizeController controller{{8192, 32768, 16384}};
+  EXPECT_EQ(controller.GetStackDumpSize(), 32768);
+  EXPECT_EQ(controller.GetStackDumpSizes(), (std::vector<uint16_t>{8192, 16384, 32768}));
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+}
+
+TEST(AdaptiveStackDumpSizeController, ShallowStacksDecreaseSizeAfterQuietUpdates) {
+  AdaptiveStackDumpSizeController controller{{4096, 8192, 16384, 32768},
+                                             /*max_truncated_sample_ratio=*/0.01,
+                                             /*min_samples_per_update=*/10,
+                                             /*quiet_updates_before_decrease=*/2};
+
+  AddSamples(&controller, kTid, 10, 32768, 2000);
+  AddSamples(&controller, kTid + 1, 10, 32768, 6000);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+
+  // Updates with too few samples don't count.
+  AddSamples(&controller, kTid, 9, 32768, 2000);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+
+  // The deepest thread, with headroom, fits in 8192 bytes but not in 4096.
+  AddSamples(&controller, kTid, 10, 32768, 2000);
+  EXPECT_EQ(controller.UpdateStackDumpSize(), 8192);
+  EXPECT_EQ(controller.GetStackDumpSize(), 8192);
+
+  AddSamples(&controller, kTid, 10, 8192, 2000);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+  AddSamples(&controller, kTid, 10, 8192, 2000);
+  EXPECT_EQ(controller.UpdateStackDumpSize(), 4096);
+}
+
+TEST(AdaptiveStackDumpSizeController, TruncatedSamplesIncreaseSize) {
+  AdaptiveStackDumpSizeController controller{{4096, 8192, 16384},
+                                             /*max_truncated_sample_ratio=*/0.1,
+                                             /*min_samples_per_update=*/10,
+                                             /*quiet_updates_before_decrease=*/1};
+  AddSamples(&controller, kTid, 100, 16384, 1000);
+  EXPECT_EQ(controller.UpdateStackDumpSize(), 4096);
+
+  // Unwinding errors with a stack dump that wasn't full are not caused by the size.
+  AddSamples(&controller, kTid, 100, 4096, 1000);
+  AddSamples(&controller, kTid, 50, 2000, std::nullopt);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+
+  // Few truncated samples are tolerated.
+  AddSamples(&controller, kTid, 100, 4096, 1000);
+  AddSamples(&controller, kTid, 10, 4096, std::nullopt);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+
+  AddSamples(&controller, kTid, 100, 4096, 1000);
+  AddSamples(&controller, kTid, 12, 4096, std::nullopt);
+  EXPECT_EQ(controller.UpdateStackDumpSize(), 8192);
+
+  // Samples taken with the previous size are not considered truncated anymore.
+  AddSamples(&controller, kTid, 11, 4096, std::nullopt);
+  AddSamples(&controller, kTid + 1, 100, 8192, 6000);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+
+  AddSamples(&controller, kTid, 100, 8192, std::nullopt);
+  EXPECT_EQ(controller.UpdateStackDumpSize(), 16384);
+  AddSamples(&controller, kTid, 100, 16384, std::nullopt);
+  EXPECT_FALSE(controller.UpdateStackDumpSize().has_value());
+  EXPECT_EQ(controller.GetStackDumpSize(), 16384);
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,149 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "BatchingTracerListener.h"
+
+#include <utility>
+
+namespace orbit_linux_tracing {
+
+void BatchingTracerListener::Flush() {
+  // Moved-from vectors are left empty, but we want to be sure.
+  if (!scheduling_slices_.empty()) {
+    listener_->OnSchedulingSlices(std::move(scheduling_slices_));
+    scheduling_slices_.clear();
+  }
+  if (!callstack_samples_.empty()) {
+    listener_->OnCallstackSamples(std::move(callstack_samples_));
+    callstack_samples_.clear();
+  }
+  if (!function_calls_.empty()) {
+    listener_->OnFunctionCalls(std::move(function_calls_));
+    function_calls_.clear();
+  }
+  if (!thread_state_slices_.empty()) {
+    listener_->OnThreadStateSlices(std::move(thread_state_slices_));
+    thread_state_slices_.clear();
+  }
+}
+
+void BatchingTracerListener::OnSchedulingSlice(
+    orbit_grpc_protos::SchedulingSlice scheduling_slice) {
+  scheduling_slices_.emplace_back(std::move(scheduling_slice));
+}
+
+void BatchingTracerListener::OnCallstackSample(
+    orbit_grpc_protos::FullCallstackSample callstack_sample) {
+  callstack_samples_.emplace_back(std::move(callstack_sample));
+}
+
+void BatchingTracerListener::OnFunctionCall(orbit_grpc_protos::FunctionCall function_call) {
+  function_calls_.emplace_back(std::move(function_call));
+}
+
+void BatchingTracerListener::OnThreadStateSlice(
+    orbit_grpc_protos::ThreadStateSlice thread_state_slice) {
+  thread_state_slices_.emplace_back(std::move(thread_state_slice));
+}
+
+void BatchingTracerListener::OnIntrospectionScope(
+    orbit_grpc_protos::IntrospectionScope introspection_scope) {
+  Flush();
+  listener_->OnIntrospectionScope(std::move(introspection_scope));
+}
+
+void BatchingTracerListener::OnGpuJob(orbit_grpc_protos::FullGpuJob gpu_job) {
+  Flush();
+  listener_->OnGpuJob(std::move(gpu_job));
+}
+
+void BatchingTracerListener::OnThreadName(orbit_grpc_protos::ThreadName thread_name) {
+  Flush();
+  listener_->OnThreadName(std::move(thread_name));
+}
+
+void BatchingTracerListener::OnThreadNamesSnapshot(
+    orbit_grpc_protos::ThreadNamesSnapshot thread_names_snapshot) {
+  Flush();
+  listener_->OnThreadNamesSnapshot(std::move(thread_names_snapshot));
+}
+
+void BatchingTracerListener::OnAddressInfo(orbit_grpc_protos::FullAddressInfo full_address_info) {
+  Flush();
+  listener_->OnAddressInfo(std::move(full_address_info));
+}
+
+void BatchingTracerListener::OnTracepointEvent(
+    orbit_grpc_protos::FullTracepointEvent tracepoint_event) {
+  Flush();
+  listener_->OnTracepointEvent(std::move(tracepoint_event));
+}
+
+void BatchingTracerListener::OnModulesSnapshot(
+    orbit_grpc_protos::ModulesSnapshot modules_snapshot) {
+  Flush();
+  listener_->OnModulesSnapshot(std::move(modules_snapshot));
+}
+
+void BatchingTracerListener::OnModuleUpdate(
+    orbit_grpc_protos::ModuleUpdateEvent module_update_event) {
+  Flush();
+  listener_->OnModuleUpdate(std::move(module_update_event));
+}
+
+void BatchingTracerListener::OnErrorsWithPerfEventOpenEvent(
+    orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) {
+  Flush();
+  listener_->OnErrorsWithPerfEventOpenEvent(std::move(errors_with_perf_event_open_event));
+}
+
+void BatchingTracerListener::OnLostPerfRecordsEvent(
+    orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) {
+  Flush();
+  listener_->OnLostPerfRecordsEvent(std::move(lost_perf_records_event));
+}
+
+void BatchingTracerListener::OnOutOfOrderEventsDiscardedEvent(
+    orbit_grpc_protos::OutOfOrderEventsDiscardedEvent out_of_order_events_discarded_event) {
+  Flush();
+  listener_->OnOutOfOrderEventsDiscardedEvent(std::move(out_of_order_events_discarded_event));
+}
+
+void BatchingTracerListener::OnSamplingPeriodChangedEvent(
+    orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) {
+  Flush();
+  listener_->OnSamplingPeriodChangedEvent(std::move(sampling_period_changed_event));
+}
+
+void BatchingTracerListener::OnPmuCountersSample(
+    orbit_grpc_protos::PmuCountersSample pmu_counters_sample) {
+  Flush();
+  listener_->OnPmuCountersSample(std::move(pmu_counters_sample));
+}
+
+void BatchingTracerListener::OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) {
+  Flush();
+  listener_->OnWarningEvent(std::move(warning_event));
+}
+
+void BatchingTracerListener::OnServiceHealthEvent(
+    orbit_grpc_protos::ServiceHealthEvent service_health_event) {
+  Flush();
+  listener_->OnServiceHealthEvent(std::move(service_health_event));
+}
+
+void BatchingTracerListener::OnPipelineLatencyProbe(
+    orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) {
+  // The probe must follow the events produced before it, including the buffered ones.
+  Flush();
+  listener_->OnPipelineLatencyProbe(std::move(pipeline_latency_probe));
+}
+
+void BatchingTracerListener::OnCaptureStatisticsSummary(
+    orbit_grpc_protos::CaptureStatisticsSummary capture_statistics_summary) {
+  Flush();
+  listener_->OnCaptureStatisticsSummary(std::move(capture_statistics_summary));
+}
+
+}  // namespace orbit_linux_tracing
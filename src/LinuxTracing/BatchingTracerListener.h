@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_BATCHING_TRACER_LISTENER_H_
+#define LINUX_TRACING_BATCHING_TRACER_LISTENER_H_
+
+#include <vector>
+
+#include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/Logging.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+// BatchingTracerListener buffers the most frequent events (scheduling slices, callstack samples,
+// function calls and thread state slices) and forwards them to the wrapped TracerListener with the
+// batched On*s methods when Flush is called, e.g., after each round of event processing. All other
+// events are forwarded immediately, after flushing the buffered events, so that the wrapped
+// listener still receives all events in the order in which they were produced, except for the
+// relative order of the buffered events of different types.
+// This class is not thread safe: all methods must be called from the same thread.
+class BatchingTracerListener : public TracerListener {
+ public:
+  explicit BatchingTracerListener(TracerListener* listener) : listener_{listener} {
+    CHECK(listener_ != nullptr);
+  }
+
+  ~BatchingTracerListener() override { CHECK(IsEmpty()); }
+
+  BatchingTracerListener(const BatchingTracerListener&) = delete;
+  BatchingTracerListener& operator=(const BatchingTracerListener&) = delete;
+  BatchingTracerListener(BatchingTracerListener&&) = delete;
+  BatchingTracerListener& operator=(BatchingTracerListener&&) = delete;
+
+  void Flush();
+
+  void OnSchedulingSlice(orbit_grpc_protos::SchedulingSlice scheduling_slice) override;
+  void OnCallstackSample(orbit_grpc_protos::FullCallstackSample callstack_sample) override;
+  void OnFunctionCall(orbit_grpc_protos::FunctionCall function_call) override;
+  void OnIntrospectionScope(orbit_grpc_protos::IntrospectionScope introspection_scope) override;
+  void OnGpuJob(orbit_grpc_protos::FullGpuJob gpu_job) override;
+  void OnThreadName(orbit_grpc_protos::ThreadName thread_name) override;
+  void OnThreadNamesSnapshot(orbit_grpc_protos::ThreadNamesSnapshot thread_names_snapshot) override;
+  void OnThreadStateSlice(orbit_grpc_protos::ThreadStateSlice thread_state_slice) override;
+  void OnAddressInfo(orbit_grpc_protos::FullAddressInfo full_address_info) override;
+  void OnTracepointEvent(orbit_grpc_protos::FullTracepointEvent tracepoint_event) override;
+  void OnModulesSnapshot(orbit_grpc_protos::ModulesSnapshot modules_snapshot) override;
+  void OnModuleUpdate(orbit_grpc_protos::ModuleUpdateEvent module_update_event) override;
+  void OnErrorsWithPerfEventOpenEvent(
+      orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) override;
+  void OnLostPerfRecordsEvent(
+      orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) override;
+  void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
+                                            out_of_order_events_discarded_event) override;
+  void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) override;
+  void OnPmuCountersSample(orbit_grpc_protos::PmuCountersSample pmu_counters_sample) override;
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) override;
+  void OnServiceHealthEvent(
+      orbit_grpc_protos::ServiceHealthEvent service_health_event) override;
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) override;
+  void OnCaptureStatisticsSummary(
+      orbit_grpc_protos::CaptureStatisticsSummary capture_statistics_summary) override;
+
+ private:
+  [[nodiscard]] bool IsEmpty() const {
+    return scheduling_slices_.empty() && callstack_samples_.empty() && function_calls_.empty() &&
+           thread_state_slices_.empty();
+  }
+
+  TracerListener* listener_;
+
+  std::vector<orbit_grpc_protos::SchedulingSlice> scheduling_slices_;
+  std::vector<orbit_grpc_protos::FullCallstackSample> callstack_samples_;
+  std::vector<orbit_grpc_protos::FunctionCall> function_calls_;
+  std::vector<orbit_grpc_protos::ThreadStateSlice> thread_state_slices_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_BATCHING_TRACER_LISTENER_H_
@@ -0,0 +1,154 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "BatchingTracerListener.h"
+#include "LinuxTracing/TracerListener.h"
+#include "capture.pb.h"
+
+using ::testing::ElementsAre;
+using ::testing::InSequence;
+using ::testing::Property;
+using ::testing::SaveArg;
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class MockTracerListener : public TracerListener {
+ public:
+  MOCK_METHOD(void, OnSchedulingSlice, (orbit_grpc_protos::SchedulingSlice), (override));
+  MOCK_METHOD(void, OnCallstackSample, (orbit_grpc_protos::FullCallstackSample), (override));
+  MOCK_METHOD(void, OnFunctionCall, (orbit_grpc_protos::FunctionCall), (override));
+  MOCK_METHOD(void, OnIntrospectionScope, (orbit_grpc_protos::IntrospectionScope), (override));
+  MOCK_METHOD(void, OnGpuJob, (orbit_grpc_protos::FullGpuJob full_gpu_job), (override));
+  MOCK_METHOD(void, OnThreadName, (orbit_grpc_protos::ThreadName), (override));
+  MOCK_METHOD(void, OnThreadNamesSnapshot, (orbit_grpc_protos::ThreadNamesSnapshot), (override));
+  MOCK_METHOD(void, OnThreadStateSlice, (orbit_grpc_protos::ThreadStateSlice), (override));
+  MOCK_METHOD(void, OnAddressInfo, (orbit_grpc_protos::FullAddressInfo), (override));
+  MOCK_METHOD(void, OnTracepointEvent, (orbit_grpc_protos::FullTracepointEvent), (override));
+  MOCK_METHOD(void, OnModuleUpdate, (orbit_grpc_protos::ModuleUpdateEvent), (override));
+  MOCK_METHOD(void, OnModulesSnapshot, (orbit_grpc_protos::ModulesSnapshot), (override));
+  MOCK_METHOD(void, OnErrorsWithPerfEventOpenEvent,
+              (orbit_grpc_protos::ErrorsWithPerfEventOpenEvent), (override));
+  MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
+  MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
+              (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent, (orbit_grpc_protos::SamplingPeriodChangedEvent),
+              (override));
+  MOCK_METHOD(void, OnPmuCountersSample, (orbit_grpc_protos::PmuCountersSample), (override));
+  MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
+  MOCK_METHOD(void, OnServiceHealthEvent, (orbit_grpc_protos::ServiceHealthEvent), (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe, (orbit_grpc_protos::PipelineLatencyProbe),
+              (override));
+  MOCK_METHOD(void, OnCaptureStatisticsSummary, (orbit_grpc_protos::CaptureStatisticsSummary),
+              (override));
+
+  MOCK_METHOD(void, OnSchedulingSlices, (std::vector<orbit_grpc_protos::SchedulingSlice>),
+              (override));
+  MOCK_METHOD(void, OnCallstackSamples, (std::vector<orbit_grpc_protos::FullCallstackSample>),
+              (override));
+  MOCK_METHOD(void, OnFunctionCalls, (std::vector<orbit_grpc_protos::FunctionCall>), (override));
+  MOCK_METHOD(void, OnThreadStateSlices, (std::vector<orbit_grpc_protos::ThreadStateSlice>),
+              (override));
+};
+
+orbit_grpc_protos::SchedulingSlice CreateSchedulingSlice(uint64_t timestamp_ns) {
+  orbit_grpc_protos::SchedulingSlice scheduling_slice;
+  scheduling_slice.set_out_timestamp_ns(timestamp_ns);
+  return scheduling_slice;
+}
+
+orbit_grpc_protos::FunctionCall CreateFunctionCall(uint64_t timestamp_ns) {
+  orbit_grpc_protos::FunctionCall function_call;
+  function_call.set_end_timestamp_ns(timestamp_ns);
+  return function_call;
+}
+
+}  // namespace
+
+TEST(BatchingTracerListener, BufferedEventsAreForwardedOnFlush) {
+  MockTracerListener mock_listener;
+  BatchingTracerListener batching_listener{&mock_listener};
+
+  std::vector<orbit_grpc_protos::SchedulingSlice> scheduling_slices;
+  std::vector<orbit_grpc_protos::FunctionCall> function_calls;
+  EXPECT_CALL(mock_listener, OnSchedulingSlices).Times(0);
+  EXPECT_CALL(mock_listener, OnFunctionCalls).Times(0);
+  batching_listener.OnSchedulingSlice(CreateSchedulingSlice(1));
+  batching_listener.OnFunctionCall(CreateFunctionCall(2));
+  batching_listener.OnSchedulingSlice(CreateSchedulingSlice(3));
+  ::testing::Mock::VerifyAndClearExpectations(&mock_listener);
+
+  EXPECT_CALL(mock_listener, OnSchedulingSlices).WillOnce(SaveArg<0>(&scheduling_slices));
+  EXPECT_CALL(mock_listener, OnFunctionCalls).WillOnce(SaveArg<0>(&function_calls));
+  EXPECT_CALL(mock_listener, OnCallstackSamples).Times(0);
+  EXPECT_CALL(mock_listener, OnThreadStateSlices).Times(0);
+  batching_listener.Flush();
+  ::testing::Mock::VerifyAndClearExpectations(&mock_listener);
+
+  EXPECT_THAT(scheduling_slices,
+              ElementsAre(Property(&orbit_grpc_protos::SchedulingSlice::out_timestamp_ns, 1),
+                          Property(&orbit_grpc_protos::SchedulingSlice::out_timestamp_ns, 3)));
+  EXPECT_THAT(function_calls,
+              ElementsAre(Property(&orbit_grpc_protos::FunctionCall::end_timestamp_ns, 2)));
+
+  // Nothing is left to forward.
+  EXPECT_CALL(mock_listener, OnSchedulingSlices).Times(0);
+  EXPECT_CALL(mock_listener, OnFunctionCalls).Times(0);
+  batching_listener.Flush();
+}
+
+TEST(BatchingTracerListener, OtherEventsAreForwardedImmediatelyAfterBufferedEvents) {
+  MockTracerListener mock_listener;
+  BatchingTracerListener batching_listener{&mock_listener};
+
+  batching_listener.OnSchedulingSlice(CreateSchedulingSlice(1));
+  {
+    InSequence sequence;
+    EXPECT_CALL(mock_listener, OnSchedulingSlices).Times(1);
+    EXPECT_CALL(mock_listener, OnThreadName).Times(1);
+  }
+  batching_listener.OnThreadName(orbit_grpc_protos::ThreadName{});
+}
+
+TEST(BatchingTracerListener, PipelineLatencyProbesFollowBufferedEvents) {
+  MockTracerListener mock_listener;
+  BatchingTracerListener batching_listener{&mock_listener};
+
+  batching_listener.OnSchedulingSlice(CreateSchedulingSlice(1));
+  {
+    InSequence sequence;
+    EXPECT_CALL(mock_listener, OnSchedulingSlices).Times(1);
+    EXPECT_CALL(mock_listener, OnPipelineLatencyProbe).Times(1);
+  }
+  batching_listener.OnPipelineLatencyProbe(orbit_grpc_protos::PipelineLatencyProbe{});
+}
+
+TEST(BatchingTracerListener, CaptureStatisticsSummariesFollowBufferedEvents) {
+  MockTracerListener mock_listener;
+  BatchingTracerListener batching_listener{&mock_listener};
+
+  batching_listener.OnSchedulingSlice(CreateSchedulingSlice(1));
+  {
+    InSequence sequence;
+    EXPECT_CALL(mock_listener, OnSchedulingSlices).Times(1);
+    EXPECT_CALL(mock_listener, OnCaptureStatisticsSummary).Times(1);
+  }
+  batching_listener.OnCaptureStatisticsSummary(orbit_grpc_protos::CaptureStatisticsSummary{});
+}
+
+TEST(BatchingTracerListener, DefaultBatchedMethodsForwardEachEvent) {
+  MockTracerListener mock_listener;
+  // Call the default implementation of TracerListener::OnSchedulingSlices.
+  EXPECT_CALL(mock_listener, OnSchedulingSlice).Times(2);
+  mock_listener.TracerListener::OnSchedulingSlices(
+      {CreateSchedulingSlice(1), CreateSchedulingSlice(2)});
+}
+
+}  // namespace orbit_linux_tracing
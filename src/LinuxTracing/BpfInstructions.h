@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_BPF_INSTRUCTIONS_H_
+#define LINUX_TRACING_BPF_INSTRUCTIONS_H_
+
+#include <linux/bpf.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+namespace orbit_linux_tracing {
+
+// libbpf is not a dependency, so eBPF programs are assembled by hand with these helpers, which
+// correspond to the macros in the kernel's include/linux/filter.h.
+inline bpf_insn Instruction(uint8_t code, uint8_t dst_reg, uint8_t src_reg, int16_t off,
+                            int32_t imm) {
+  bpf_insn instruction{};
+  instruction.code = code;
+  instruction.dst_reg = dst_reg;
+  instruction.src_reg = src_reg;
+  instruction.off = off;
+  instruction.imm = imm;
+  return instruction;
+}
+
+inline bpf_insn MovRegister(uint8_t dst_reg, uint8_t src_reg) {
+  return Instruction(BPF_ALU64 | BPF_MOV | BPF_X, dst_reg, src_reg, 0, 0);
+}
+
+inline bpf_insn MovImmediate(uint8_t dst_reg, int32_t imm) {
+  return Instruction(BPF_ALU64 | BPF_MOV | BPF_K, dst_reg, 0, 0, imm);
+}
+
+inline bpf_insn AddRegister(uint8_t dst_reg, uint8_t src_reg) {
+  return Instruction(BPF_ALU64 | BPF_ADD | BPF_X, dst_reg, src_reg, 0, 0);
+}
+
+inline bpf_insn AddImmediate(uint8_t dst_reg, int32_t imm) {
+  return Instruction(BPF_ALU64 | BPF_ADD | BPF_K, dst_reg, 0, 0, imm);
+}
+
+inline bpf_insn SubtractRegister(uint8_t dst_reg, uint8_t src_reg) {
+  return Instruction(BPF_ALU64 | BPF_SUB | BPF_X, dst_reg, src_reg, 0, 0);
+}
+
+inline bpf_insn LeftShiftImmediate(uint8_t dst_reg, int32_t imm) {
+  return Instruction(BPF_ALU64 | BPF_LSH | BPF_K, dst_reg, 0, 0, imm);
+}
+
+inline bpf_insn RightShiftImmediate(uint8_t dst_reg, int32_t imm) {
+  return Instruction(BPF_ALU64 | BPF_RSH | BPF_K, dst_reg, 0, 0, imm);
+}
+
+inline bpf_insn LoadWord(uint8_t dst_reg, uint8_t src_reg, int16_t off) {
+  return Instruction(BPF_LDX | BPF_W | BPF_MEM, dst_reg, src_reg, off, 0);
+}
+
+inline bpf_insn LoadDoubleWord(uint8_t dst_reg, uint8_t src_reg, int16_t off) {
+  return Instruction(BPF_LDX | BPF_DW | BPF_MEM, dst_reg, src_reg, off, 0);
+}
+
+inline bpf_insn StoreWord(uint8_t dst_reg, int16_t off, uint8_t src_reg) {
+  return Instruction(BPF_STX | BPF_W | BPF_MEM, dst_reg, src_reg, off, 0);
+}
+
+inline bpf_insn StoreDoubleWord(uint8_t dst_reg, int16_t off, uint8_t src_reg) {
+  return Instruction(BPF_STX | BPF_DW | BPF_MEM, dst_reg, src_reg, off, 0);
+}
+
+inline bpf_insn StoreImmediateWord(uint8_t dst_reg, int16_t off, int32_t imm) {
+  return Instruction(BPF_ST | BPF_W | BPF_MEM, dst_reg, 0, off, imm);
+}
+
+// Atomically adds src_reg to the 64-bit value at dst_reg + off.
+inline bpf_insn AtomicAddDoubleWord(uint8_t dst_reg, int16_t off, uint8_t src_reg) {
+  return Instruction(BPF_STX | BPF_DW | BPF_XADD, dst_reg, src_reg, off, 0);
+}
+
+// Loading a map file descriptor takes two instructions.
+inline bpf_insn LoadMapFd(uint8_t dst_reg, int map_fd) {
+  return Instruction(BPF_LD | BPF_DW | BPF_IMM, dst_reg, BPF_PSEUDO_MAP_FD, 0, map_fd);
+}
+
+inline bpf_insn LoadMapFdSecondHalf() { return Instruction(0, 0, 0, 0, 0); }
+
+inline bpf_insn JumpIfEqualImmediate(uint8_t dst_reg, int32_t imm, int16_t off) {
+  return Instruction(BPF_JMP | BPF_JEQ | BPF_K, dst_reg, 0, off, imm);
+}
+
+inline bpf_insn JumpIfNotEqualImmediate(uint8_t dst_reg, int32_t imm, int16_t off) {
+  return Instruction(BPF_JMP | BPF_JNE | BPF_K, dst_reg, 0, off, imm);
+}
+
+inline bpf_insn JumpIfGreaterImmediate(uint8_t dst_reg, int32_t imm, int16_t off) {
+  return Instruction(BPF_JMP | BPF_JGT | BPF_K, dst_reg, 0, off, imm);
+}
+
+inline bpf_insn Call(int32_t helper) { return Instruction(BPF_JMP | BPF_CALL, 0, 0, 0, helper); }
+
+inline bpf_insn Exit() { return Instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0); }
+
+inline long Bpf(int cmd, bpf_attr* attr) { return syscall(__NR_bpf, cmd, attr, sizeof(*attr)); }
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_BPF_INSTRUCTIONS_H_
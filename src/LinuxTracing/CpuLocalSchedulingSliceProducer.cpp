@@ -0,0 +1,60 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CpuLocalSchedulingSliceProducer.h"
+
+#include <optional>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+using orbit_grpc_protos::SchedulingSlice;
+
+void CpuLocalSchedulingSliceProducer::ProcessInitialTidToPidAssociation(pid_t tid, pid_t pid) {
+  tid_to_pid_association_.insert_or_assign(tid, pid);
+}
+
+void CpuLocalSchedulingSliceProducer::ProcessSchedSwitch(uint16_t cpu,
+                                                         pid_t prev_pid_or_minus_one,
+                                                         pid_t prev_tid, pid_t next_tid,
+                                                         uint64_t timestamp_ns) {
+  // Note that context switches with tid 0 are associated with idle CPU, so we never consider them.
+  if (prev_tid != 0) {
+    pid_t prev_pid = prev_pid_or_minus_one;
+    if (prev_pid != -1) {
+      tid_to_pid_association_.insert_or_assign(prev_tid, prev_pid);
+    } else if (auto tid_to_pid_it = tid_to_pid_association_.find(prev_tid);
+               tid_to_pid_it != tid_to_pid_association_.end()) {
+      prev_pid = tid_to_pid_it->second;
+    }
+
+    std::optional<SchedulingSlice> scheduling_slice =
+        switch_manager_.ProcessContextSwitchOut(prev_pid, prev_tid, cpu, timestamp_ns);
+    if (scheduling_slice.has_value()) {
+      if (scheduling_slice->pid() == -1) {
+        ERROR("SchedulingSlice with unknown pid");
+      }
+      scheduling_slices_.emplace_back(std::move(scheduling_slice.value()));
+    }
+  }
+
+  if (next_tid != 0) {
+    std::optional<pid_t> next_pid;
+    if (auto tid_to_pid_it = tid_to_pid_association_.find(next_tid);
+        tid_to_pid_it != tid_to_pid_association_.end()) {
+      next_pid = tid_to_pid_it->second;
+    }
+    switch_manager_.ProcessContextSwitchIn(next_pid, next_tid, cpu, timestamp_ns);
+  }
+}
+
+std::vector<SchedulingSlice> CpuLocalSchedulingSliceProducer::TakeSchedulingSlices() {
+  std::vector<SchedulingSlice> scheduling_slices = std::move(scheduling_slices_);
+  scheduling_slices_.clear();
+  return scheduling_slices;
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,45 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_CPU_LOCAL_SCHEDULING_SLICE_PRODUCER_H_
+#define LINUX_TRACING_CPU_LOCAL_SCHEDULING_SLICE_PRODUCER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ContextSwitchManager.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+// Produces SchedulingSlices from the sched:sched_switch events of a set of cpus as soon as they are
+// read from the ring buffers, without ordering them with the events of the other cpus.
+// A SchedulingSlice only depends on consecutive context switches on the same cpu, and the events
+// of the same ring buffer come in order, so each thread reading from a disjoint set of ring buffers
+// can use its own CpuLocalSchedulingSliceProducer without synchronization. Only thread states,
+// which involve context switches and wakeups on different cpus, need the events in global order.
+// The pid of a thread being switched out is -1 when the thread is exiting. In such cases, the pid
+// is taken from the initial association between tids and pids, or from the last time the thread
+// was switched out on one of these cpus. If neither is available, the pid is -1.
+// This class is not thread safe.
+class CpuLocalSchedulingSliceProducer {
+ public:
+  void ProcessInitialTidToPidAssociation(pid_t tid, pid_t pid);
+  void ProcessSchedSwitch(uint16_t cpu, pid_t prev_pid_or_minus_one, pid_t prev_tid,
+                          pid_t next_tid, uint64_t timestamp_ns);
+  [[nodiscard]] bool HasSchedulingSlices() const { return !scheduling_slices_.empty(); }
+  [[nodiscard]] std::vector<orbit_grpc_protos::SchedulingSlice> TakeSchedulingSlices();
+
+ private:
+  ContextSwitchManager switch_manager_;
+  absl::flat_hash_map<pid_t, pid_t> tid_to_pid_association_;
+  std::vector<orbit_grpc_protos::SchedulingSlice> scheduling_slices_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_CPU_LOCAL_SCHEDULING_SLICE_PRODUCER_H_
@@ -0,0 +1,79 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <sys/types.h>
+
+#include <vector>
+
+#include "CpuLocalSchedulingSliceProducer.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+using orbit_grpc_protos::SchedulingSlice;
+
+TEST(CpuLocalSchedulingSliceProducer, ProducesSlicesOfEachCpuIndependently) {
+  CpuLocalSchedulingSliceProducer producer;
+  producer.ProcessSchedSwitch(/*cpu=*/0, /*prev_pid_or_minus_one=*/0, /*prev_tid=*/0,
+                              /*next_tid=*/11, 100);
+  producer.ProcessSchedSwitch(/*cpu=*/1, 0, 0, /*next_tid=*/21, 150);
+  producer.ProcessSchedSwitch(/*cpu=*/1, /*prev_pid_or_minus_one=*/20, /*prev_tid=*/21, 0, 170);
+  producer.ProcessSchedSwitch(/*cpu=*/0, /*prev_pid_or_minus_one=*/10, /*prev_tid=*/11, 0, 200);
+
+  ASSERT_TRUE(producer.HasSchedulingSlices());
+  std::vector<SchedulingSlice> scheduling_slices = producer.TakeSchedulingSlices();
+  EXPECT_FALSE(producer.HasSchedulingSlices());
+  ASSERT_EQ(scheduling_slices.size(), 2);
+
+  EXPECT_EQ(scheduling_slices[0].pid(), 20);
+  EXPECT_EQ(scheduling_slices[0].tid(), 21);
+  EXPECT_EQ(scheduling_slices[0].core(), 1);
+  EXPECT_EQ(scheduling_slices[0].duration_ns(), 20);
+  EXPECT_EQ(scheduling_slices[0].out_timestamp_ns(), 170);
+
+  EXPECT_EQ(scheduling_slices[1].pid(), 10);
+  EXPECT_EQ(scheduling_slices[1].tid(), 11);
+  EXPECT_EQ(scheduling_slices[1].core(), 0);
+  EXPECT_EQ(scheduling_slices[1].duration_ns(), 100);
+  EXPECT_EQ(scheduling_slices[1].out_timestamp_ns(), 200);
+}
+
+TEST(CpuLocalSchedulingSliceProducer, PidOfExitingThreadComesFromInitialAssociation) {
+  CpuLocalSchedulingSliceProducer producer;
+  producer.ProcessInitialTidToPidAssociation(/*tid=*/11, /*pid=*/10);
+  producer.ProcessSchedSwitch(/*cpu=*/0, 0, 0, /*next_tid=*/11, 100);
+  producer.ProcessSchedSwitch(/*cpu=*/0, /*prev_pid_or_minus_one=*/-1, /*prev_tid=*/11, 0, 200);
+
+  std::vector<SchedulingSlice> scheduling_slices = producer.TakeSchedulingSlices();
+  ASSERT_EQ(scheduling_slices.size(), 1);
+  EXPECT_EQ(scheduling_slices[0].pid(), 10);
+  EXPECT_EQ(scheduling_slices[0].tid(), 11);
+}
+
+TEST(CpuLocalSchedulingSliceProducer, PidOfExitingThreadComesFromPreviousSwitchOut) {
+  CpuLocalSchedulingSliceProducer producer;
+  producer.ProcessSchedSwitch(/*cpu=*/0, 0, 0, /*next_tid=*/11, 100);
+  producer.ProcessSchedSwitch(/*cpu=*/0, /*prev_pid_or_minus_one=*/10, /*prev_tid=*/11, 0, 200);
+  producer.ProcessSchedSwitch(/*cpu=*/1, 0, 0, /*next_tid=*/11, 300);
+  producer.ProcessSchedSwitch(/*cpu=*/1, /*prev_pid_or_minus_one=*/-1, /*prev_tid=*/11, 0, 400);
+
+  std::vector<SchedulingSlice> scheduling_slices = producer.TakeSchedulingSlices();
+  ASSERT_EQ(scheduling_slices.size(), 2);
+  EXPECT_EQ(scheduling_slices[1].pid(), 10);
+  EXPECT_EQ(scheduling_slices[1].core(), 1);
+  EXPECT_EQ(scheduling_slices[1].duration_ns(), 100);
+}
+
+TEST(CpuLocalSchedulingSliceProducer, PidOfExitingUnknownThreadIsMinusOne) {
+  CpuLocalSchedulingSliceProducer producer;
+  producer.ProcessSchedSwitch(/*cpu=*/0, 0, 0, /*next_tid=*/11, 100);
+  producer.ProcessSchedSwitch(/*cpu=*/0, /*prev_pid_or_minus_one=*/-1, /*prev_tid=*/11, 0, 200);
+
+  std::vector<SchedulingSlice> scheduling_slices = producer.TakeSchedulingSlices();
+  ASSERT_EQ(scheduling_slices.size(), 1);
+  EXPECT_EQ(scheduling_slices[0].pid(), -1);
+}
+
+}  // namespace orbit_linux_tracing
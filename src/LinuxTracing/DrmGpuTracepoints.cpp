@@ -0,0 +1,115 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DrmGpuTracepoints.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+[[nodiscard]] std::optional<TracepointField> FindField(const std::vector<TracepointField>& fields,
+                                                       std::string_view name) {
+  auto it = std::find_if(fields.begin(), fields.end(),
+                         [name](const TracepointField& field) { return field.name == name; });
+  if (it == fields.end()) return std::nullopt;
+  return *it;
+}
+
+[[nodiscard]] ErrorMessageOr<TracepointField> FindRequiredField(
+    const std::vector<TracepointField>& fields, std::string_view name) {
+  std::optional<TracepointField> field = FindField(fields, name);
+  if (!field.has_value()) {
+    return ErrorMessage{absl::StrFormat("Tracepoint format has no field \"%s\"", name)};
+  }
+  return field.value();
+}
+
+}  // namespace
+
+ErrorMessageOr<DrmSchedTracepointLayout> ParseDrmSchedTracepointLayout(std::string_view format) {
+  OUTCOME_TRY(numeric_fields, ParseTracepointNumericFields(format));
+  OUTCOME_TRY(data_loc_fields, ParseTracepointDataLocFields(format));
+
+  OUTCOME_TRY(fence, FindRequiredField(numeric_fields, "fence"));
+  return DrmSchedTracepointLayout{fence, FindField(numeric_fields, "id"),
+                                  FindField(data_loc_fields, "name")};
+}
+
+ErrorMessageOr<DrmSchedTracepointLayout> ReadDrmSchedTracepointLayout(
+    const std::string& tracepoint_name) {
+  OUTCOME_TRY(format, ReadTracepointFormat("gpu_scheduler", tracepoint_name));
+  return ParseDrmSchedTracepointLayout(format);
+}
+
+std::optional<DrmSchedTracepointData> DecodeDrmSchedTracepoint(
+    const DrmSchedTracepointLayout& layout, const char* raw_data, size_t raw_data_size) {
+  std::optional<int64_t> fence = DecodeTracepointField(layout.fence, raw_data, raw_data_size);
+  if (!fence.has_value()) return std::nullopt;
+
+  DrmSchedTracepointData data;
+  data.fence = static_cast<uint64_t>(fence.value());
+  if (layout.id.has_value()) {
+    data.id = static_cast<uint64_t>(
+        DecodeTracepointField(layout.id.value(), raw_data, raw_data_size).value_or(0));
+  }
+  if (layout.name.has_value()) {
+    data.timeline = DecodeTracepointDataLocString(layout.name.value(), raw_data, raw_data_size)
+                        .value_or(std::string{kDrmSchedUnnamedTimeline});
+  }
+  return data;
+}
+
+ErrorMessageOr<I915RequestTracepointLayout> ParseI915RequestTracepointLayout(
+    std::string_view format) {
+  OUTCOME_TRY(fields, ParseTracepointNumericFields(format));
+
+  OUTCOME_TRY(context, FindRequiredField(fields, "ctx"));
+  OUTCOME_TRY(seqno, FindRequiredField(fields, "seqno"));
+  OUTCOME_TRY(engine_class, FindRequiredField(fields, "class"));
+  OUTCOME_TRY(engine_instance, FindRequiredField(fields, "instance"));
+  return I915RequestTracepointLayout{context, seqno, engine_class, engine_instance};
+}
+
+ErrorMessageOr<I915RequestTracepointLayout> ReadI915RequestTracepointLayout(
+    const std::string& tracepoint_name) {
+  OUTCOME_TRY(format, ReadTracepointFormat("i915", tracepoint_name));
+  return ParseI915RequestTracepointLayout(format);
+}
+
+std::optional<I915RequestTracepointData> DecodeI915RequestTracepoint(
+    const I915RequestTracepointLayout& layout, const char* raw_data, size_t raw_data_size) {
+  std::optional<int64_t> context = DecodeTracepointField(layout.context, raw_data, raw_data_size);
+  std::optional<int64_t> seqno = DecodeTracepointField(layout.seqno, raw_data, raw_data_size);
+  std::optional<int64_t> engine_class =
+      DecodeTracepointField(layout.engine_class, raw_data, raw_data_size);
+  std::optional<int64_t> engine_instance =
+      DecodeTracepointField(layout.engine_instance, raw_data, raw_data_size);
+  if (!context.has_value() || !seqno.has_value() || !engine_class.has_value() ||
+      !engine_instance.has_value()) {
+    return std::nullopt;
+  }
+
+  I915RequestTracepointData data;
+  data.context = static_cast<uint32_t>(context.value());
+  data.seqno = static_cast<uint32_t>(seqno.value());
+  data.timeline = GetI915EngineName(engine_class.value(), engine_instance.value());
+  return data;
+}
+
+std::string GetI915EngineName(uint64_t engine_class, uint64_t engine_instance) {
+  // Indexed by enum drm_i915_gem_engine_class of include/uapi/drm/i915_drm.h.
+  static constexpr std::array<const char*, 5> kEngineClassNames{"rcs", "bcs", "vcs", "vecs", "ccs"};
+  if (engine_class >= kEngineClassNames.size()) {
+    return absl::StrFormat("i915_class%u_%u", engine_class, engine_instance);
+  }
+  return absl::StrFormat("%s%u", kEngineClassNames[engine_class], engine_instance);
+}
+
+}  // namespace orbit_linux_tracing
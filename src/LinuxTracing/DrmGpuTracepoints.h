@@ -0,0 +1,90 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_DRM_GPU_TRACEPOINTS_H_
+#define LINUX_TRACING_DRM_GPU_TRACEPOINTS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "OrbitBase/Result.h"
+#include "TracepointFormat.h"
+
+namespace orbit_linux_tracing {
+
+// The GPU tracepoints of the generic DRM GPU scheduler (category "gpu_scheduler") and of the i915
+// driver. Unlike the layouts of the amdgpu tracepoints in KernelTracepoints.h, the layouts of these
+// tracepoints changed between kernel versions, so the offsets of their fields are read from their
+// format files.
+
+// The name of the timeline of the DRM GPU scheduler jobs when the tracepoints don't record the name
+// of the scheduler.
+inline constexpr std::string_view kDrmSchedUnnamedTimeline = "gpu_scheduler";
+
+// The layout of gpu_scheduler:drm_sched_job, gpu_scheduler:drm_run_job, and
+// gpu_scheduler:drm_sched_process_job. The address of the "finished" fence of a job identifies the
+// job in all three tracepoints.
+struct DrmSchedTracepointLayout {
+  TracepointField fence;
+  // drm_sched_process_job doesn't record the id of the job.
+  std::optional<TracepointField> id;
+  // The "__data_loc" of the name of the scheduler, i.e., of the ring. Older kernels only record the
+  // address of the name, which can't be read, and drm_sched_process_job doesn't record it.
+  std::optional<TracepointField> name;
+};
+
+[[nodiscard]] ErrorMessageOr<DrmSchedTracepointLayout> ParseDrmSchedTracepointLayout(
+    std::string_view format);
+// Reads the format file of gpu_scheduler:<tracepoint_name>.
+[[nodiscard]] ErrorMessageOr<DrmSchedTracepointLayout> ReadDrmSchedTracepointLayout(
+    const std::string& tracepoint_name);
+
+struct DrmSchedTracepointData {
+  uint64_t fence = 0;
+  uint64_t id = 0;
+  // Empty if the layout has no name.
+  std::string timeline;
+};
+
+[[nodiscard]] std::optional<DrmSchedTracepointData> DecodeDrmSchedTracepoint(
+    const DrmSchedTracepointLayout& layout, const char* raw_data, size_t raw_data_size);
+
+// The name of the driver of the fences of the i915 requests in dma_fence:dma_fence_signaled.
+inline constexpr std::string_view kI915DriverName = "i915";
+
+// The layout of i915:i915_request_add and i915:i915_request_in. The context and seqno are the ones
+// of the fence of the request, which dma_fence:dma_fence_signaled records as well.
+struct I915RequestTracepointLayout {
+  TracepointField context;
+  TracepointField seqno;
+  TracepointField engine_class;
+  TracepointField engine_instance;
+};
+
+[[nodiscard]] ErrorMessageOr<I915RequestTracepointLayout> ParseI915RequestTracepointLayout(
+    std::string_view format);
+// Reads the format file of i915:<tracepoint_name>.
+[[nodiscard]] ErrorMessageOr<I915RequestTracepointLayout> ReadI915RequestTracepointLayout(
+    const std::string& tracepoint_name);
+
+struct I915RequestTracepointData {
+  // The fence context and seqno are truncated to 32 bits, as by dma_fence_signaled.
+  uint32_t context = 0;
+  uint32_t seqno = 0;
+  // The name of the engine the request is submitted to, e.g., "rcs0".
+  std::string timeline;
+};
+
+[[nodiscard]] std::optional<I915RequestTracepointData> DecodeI915RequestTracepoint(
+    const I915RequestTracepointLayout& layout, const char* raw_data, size_t raw_data_size);
+
+// Returns the name that i915 gives to an engine, e.g., "rcs0" for the first render engine.
+[[nodiscard]] std::string GetI915EngineName(uint64_t engine_class, uint64_t engine_instance);
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_DRM_GPU_TRACEPOINTS_H_
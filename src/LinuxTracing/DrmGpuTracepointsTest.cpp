@@ -0,0 +1,152 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "DrmGpuTracepoints.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr const char* kCommonFields =
+    "format:\n"
+    "\tfield:unsigned short common_type;\toffset:0;\tsize:2;\tsigned:0;\n"
+    "\tfield:unsigned char common_flags;\toffset:2;\tsize:1;\tsigned:0;\n"
+    "\tfield:unsigned char common_preempt_count;\toffset:3;\tsize:1;\tsigned:0;\n"
+    "\tfield:int common_pid;\toffset:4;\tsize:4;\tsigned:1;\n"
+    "\n";
+
+// The format of gpu_scheduler:drm_sched_job since Linux 6.2, which records the name of the
+// scheduler as a string.
+const std::string kDrmSchedJobFormat =
+    std::string{"name: drm_sched_job\nID: 1200\n"} + kCommonFields +
+    "\tfield:struct drm_sched_entity * entity;\toffset:8;\tsize:8;\tsigned:0;\n"
+    "\tfield:struct dma_fence * fence;\toffset:16;\tsize:8;\tsigned:0;\n"
+    "\tfield:__data_loc char[] name;\toffset:24;\tsize:4;\tsigned:1;\n"
+    "\tfield:uint64_t id;\toffset:32;\tsize:8;\tsigned:0;\n"
+    "\tfield:u32 job_count;\toffset:40;\tsize:4;\tsigned:0;\n"
+    "\tfield:int hw_job_count;\toffset:44;\tsize:4;\tsigned:1;\n";
+
+// The format of gpu_scheduler:drm_sched_job before Linux 6.2, which records the address of the
+// name.
+const std::string kOldDrmSchedJobFormat =
+    std::string{"name: drm_sched_job\nID: 1200\n"} + kCommonFields +
+    "\tfield:struct drm_sched_entity * entity;\toffset:8;\tsize:8;\tsigned:0;\n"
+    "\tfield:struct dma_fence * fence;\toffset:16;\tsize:8;\tsigned:0;\n"
+    "\tfield:const char * name;\toffset:24;\tsize:8;\tsigned:0;\n"
+    "\tfield:uint64_t id;\toffset:32;\tsize:8;\tsigned:0;\n"
+    "\tfield:u32 job_count;\toffset:40;\tsize:4;\tsigned:0;\n"
+    "\tfield:int hw_job_count;\toffset:44;\tsize:4;\tsigned:1;\n";
+
+const std::string kDrmSchedProcessJobFormat =
+    std::string{"name: drm_sched_process_job\nID: 1202\n"} + kCommonFields +
+    "\tfield:struct dma_fence * fence;\toffset:8;\tsize:8;\tsigned:0;\n";
+
+const std::string kI915RequestAddFormat =
+    std::string{"name: i915_request_add\nID: 1300\n"} + kCommonFields +
+    "\tfield:u32 dev;\toffset:8;\tsize:4;\tsigned:0;\n"
+    "\tfield:u64 ctx;\toffset:16;\tsize:8;\tsigned:0;\n"
+    "\tfield:u16 class;\toffset:24;\tsize:2;\tsigned:0;\n"
+    "\tfield:u16 instance;\toffset:26;\tsize:2;\tsigned:0;\n"
+    "\tfield:u32 seqno;\toffset:28;\tsize:4;\tsigned:0;\n"
+    "\tfield:u32 tail;\toffset:32;\tsize:4;\tsigned:0;\n";
+
+template <typename T>
+void WriteAt(char* raw_data, size_t offset, T value) {
+  memcpy(raw_data + offset, &value, sizeof(value));
+}
+
+}  // namespace
+
+TEST(DrmGpuTracepoints, ParseAndDecodeDrmSchedTracepoint) {
+  ErrorMessageOr<DrmSchedTracepointLayout> layout_or_error =
+      ParseDrmSchedTracepointLayout(kDrmSchedJobFormat);
+  ASSERT_FALSE(layout_or_error.has_error()) << layout_or_error.error().message();
+  const DrmSchedTracepointLayout& layout = layout_or_error.value();
+  EXPECT_EQ(layout.fence.offset, 16);
+  ASSERT_TRUE(layout.id.has_value());
+  EXPECT_EQ(layout.id->offset, 32);
+  ASSERT_TRUE(layout.name.has_value());
+  EXPECT_EQ(layout.name->offset, 24);
+
+  std::array<char, 56> raw_data{};
+  WriteAt<uint64_t>(raw_data.data(), 16, 0xFFFF888812345678);
+  WriteAt<uint32_t>(raw_data.data(), 24, (4 << 16) | 48);
+  WriteAt<uint64_t>(raw_data.data(), 32, 42);
+  memcpy(raw_data.data() + 48, "gfx", 4);
+  std::optional<DrmSchedTracepointData> data =
+      DecodeDrmSchedTracepoint(layout, raw_data.data(), raw_data.size());
+  ASSERT_TRUE(data.has_value());
+  EXPECT_EQ(data->fence, 0xFFFF888812345678);
+  EXPECT_EQ(data->id, 42);
+  EXPECT_EQ(data->timeline, "gfx");
+
+  EXPECT_FALSE(DecodeDrmSchedTracepoint(layout, raw_data.data(), 20).has_value());
+}
+
+TEST(DrmGpuTracepoints, DrmSchedTracepointWithoutNameHasEmptyTimeline) {
+  ErrorMessageOr<DrmSchedTracepointLayout> layout_or_error =
+      ParseDrmSchedTracepointLayout(kOldDrmSchedJobFormat);
+  ASSERT_FALSE(layout_or_error.has_error()) << layout_or_error.error().message();
+  EXPECT_FALSE(layout_or_error.value().name.has_value());
+
+  layout_or_error = ParseDrmSchedTracepointLayout(kDrmSchedProcessJobFormat);
+  ASSERT_FALSE(layout_or_error.has_error()) << layout_or_error.error().message();
+  const DrmSchedTracepointLayout& layout = layout_or_error.value();
+  EXPECT_EQ(layout.fence.offset, 8);
+  EXPECT_FALSE(layout.id.has_value());
+  EXPECT_FALSE(layout.name.has_value());
+
+  std::array<char, 16> raw_data{};
+  WriteAt<uint64_t>(raw_data.data(), 8, 0xFFFF888812345678);
+  std::optional<DrmSchedTracepointData> data =
+      DecodeDrmSchedTracepoint(layout, raw_data.data(), raw_data.size());
+  ASSERT_TRUE(data.has_value());
+  EXPECT_EQ(data->fence, 0xFFFF888812345678);
+  EXPECT_EQ(data->id, 0);
+  EXPECT_EQ(data->timeline, "");
+}
+
+TEST(DrmGpuTracepoints, ParseDrmSchedTracepointLayoutFailsWithoutFence) {
+  EXPECT_TRUE(ParseDrmSchedTracepointLayout(kI915RequestAddFormat).has_error());
+}
+
+TEST(DrmGpuTracepoints, ParseAndDecodeI915RequestTracepoint) {
+  ErrorMessageOr<I915RequestTracepointLayout> layout_or_error =
+      ParseI915RequestTracepointLayout(kI915RequestAddFormat);
+  ASSERT_FALSE(layout_or_error.has_error()) << layout_or_error.error().message();
+  const I915RequestTracepointLayout& layout = layout_or_error.value();
+
+  std::array<char, 40> raw_data{};
+  WriteAt<uint64_t>(raw_data.data(), 16, 7);
+  WriteAt<uint16_t>(raw_data.data(), 24, 2);
+  WriteAt<uint16_t>(raw_data.data(), 26, 1);
+  WriteAt<uint32_t>(raw_data.data(), 28, 1000);
+  std::optional<I915RequestTracepointData> data =
+      DecodeI915RequestTracepoint(layout, raw_data.data(), raw_data.size());
+  ASSERT_TRUE(data.has_value());
+  EXPECT_EQ(data->context, 7);
+  EXPECT_EQ(data->seqno, 1000);
+  EXPECT_EQ(data->timeline, "vcs1");
+
+  EXPECT_FALSE(DecodeI915RequestTracepoint(layout, raw_data.data(), 28).has_value());
+  EXPECT_TRUE(ParseI915RequestTracepointLayout(kDrmSchedJobFormat).has_error());
+}
+
+TEST(DrmGpuTracepoints, GetI915EngineName) {
+  EXPECT_EQ(GetI915EngineName(0, 0), "rcs0");
+  EXPECT_EQ(GetI915EngineName(1, 0), "bcs0");
+  EXPECT_EQ(GetI915EngineName(3, 2), "vecs2");
+  EXPECT_EQ(GetI915EngineName(4, 1), "ccs1");
+  EXPECT_EQ(GetI915EngineName(9, 1), "i915_class9_1");
+}
+
+}  // namespace orbit_linux_tracing
@@ -9,16 +9,34 @@
 
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace orbit_linux_tracing {
 class Function {
  public:
-  Function(uint64_t function_id, std::string file_path, uint64_t file_offset)
-      : function_id_{function_id}, file_path_{std::move(file_path)}, file_offset_{file_offset} {}
+  Function(uint64_t function_id, std::string file_path, uint64_t file_offset,
+           std::vector<uint32_t> recorded_argument_indices = {}, bool record_return_value = false,
+           bool aggregate_latency_in_kernel = false)
+      : function_id_{function_id},
+        file_path_{std::move(file_path)},
+        file_offset_{file_offset},
+        recorded_argument_indices_{std::move(recorded_argument_indices)},
+        record_return_value_{record_return_value},
+        aggregate_latency_in_kernel_{aggregate_latency_in_kernel} {}
 
   [[nodiscard]] uint64_t function_id() const { return function_id_; }
   [[nodiscard]] const std::string& file_path() const { return file_path_; }
   [[nodiscard]] uint64_t file_offset() const { return file_offset_; }
+  // Indices into the integer parameter registers (rdi, rsi, rdx, rcx, r8, r9) of the arguments
+  // recorded at every call, see InstrumentedFunction.
+  [[nodiscard]] const std::vector<uint32_t>& recorded_argument_indices() const {
+    return recorded_argument_indices_;
+  }
+  [[nodiscard]] bool record_return_value() const { return record_return_value_; }
+  // Whether the durations of the calls are only measured in the kernel with
+  // FunctionLatencyBpfAggregator, instead of producing FunctionCalls.
+  [[nodiscard]] bool aggregate_latency_in_kernel() const { return aggregate_latency_in_kernel_; }
 
   bool operator==(const Function& other) {
     return (this->file_offset_ == other.file_offset_) && (this->file_path_ == other.file_path_);
@@ -28,6 +46,9 @@ class Function {
   uint64_t function_id_;
   std::string file_path_;
   uint64_t file_offset_;
+  std::vector<uint32_t> recorded_argument_indices_;
+  bool record_return_value_;
+  bool aggregate_latency_in_kernel_;
 };
 
 template <typename H>
@@ -0,0 +1,328 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FunctionLatencyBpfAggregator.h"
+
+#include <absl/strings/str_format.h>
+#include <linux/perf_event.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+
+#include "BpfInstructions.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// The maximum number of threads of the target that can be in a call of an instrumented function at
+// the same time.
+constexpr uint32_t kMaxThreadCount = 1 << 16;
+
+// The map values are the histograms themselves.
+static_assert(sizeof(FunctionLatencyHistogram) ==
+              (FunctionLatencyHistogram::kBucketCount + 1) * sizeof(uint64_t));
+
+ErrorMessageOr<int> CreateMap(bpf_map_type map_type, uint32_t key_size, uint32_t value_size,
+                              uint32_t max_entries) {
+  bpf_attr attr{};
+  attr.map_type = map_type;
+  attr.key_size = key_size;
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  int map_fd = static_cast<int>(Bpf(BPF_MAP_CREATE, &attr));
+  if (map_fd == -1) {
+    return ErrorMessage{absl::StrFormat("Creating eBPF map: %s", SafeStrerror(errno))};
+  }
+  return map_fd;
+}
+
+// Before Linux 5.0, kprobe programs, which also include uprobe programs, are only loaded if they
+// declare the version of the running kernel.
+uint32_t GetKernelVersionCode() {
+  utsname utsname{};
+  if (uname(&utsname) != 0) return 0;
+  uint32_t major = 0;
+  uint32_t minor = 0;
+  uint32_t patch = 0;
+  if (sscanf(utsname.release, "%u.%u.%u", &major, &minor, &patch) < 2) return 0;
+  return (major << 16) + (minor << 8) + std::min(patch, 255u);
+}
+
+ErrorMessageOr<int> LoadUprobeProgram(const std::vector<bpf_insn>& instructions,
+                                      const char* name) {
+  static constexpr const char* kLicense = "BSD";
+  bpf_attr attr{};
+  attr.prog_type = BPF_PROG_TYPE_KPROBE;
+  attr.insns = reinterpret_cast<uint64_t>(instructions.data());
+  attr.insn_cnt = instructions.size();
+  attr.license = reinterpret_cast<uint64_t>(kLicense);
+  attr.kern_version = GetKernelVersionCode();
+  int program_fd = static_cast<int>(Bpf(BPF_PROG_LOAD, &attr));
+  if (program_fd == -1) {
+    return ErrorMessage{
+        absl::StrFormat("Loading eBPF program for %s: %s", name, SafeStrerror(errno))};
+  }
+  return program_fd;
+}
+
+// Builds a program in which several jumps go to the common exit, which returns 0 to drop the event.
+class ProgramBuilder {
+ public:
+  void Add(std::initializer_list<bpf_insn> instructions) {
+    instructions_.insert(instructions_.end(), instructions);
+  }
+
+  void AddJumpToExit(bpf_insn jump) {
+    jumps_to_exit_.push_back(instructions_.size());
+    instructions_.push_back(jump);
+  }
+
+  [[nodiscard]] std::vector<bpf_insn> Build() && {
+    for (size_t jump_index : jumps_to_exit_) {
+      instructions_[jump_index].off = static_cast<int16_t>(instructions_.size() - jump_index - 1);
+    }
+    Add({MovImmediate(BPF_REG_0, 0), Exit()});
+    return std::move(instructions_);
+  }
+
+ private:
+  std::vector<bpf_insn> instructions_;
+  std::vector<size_t> jumps_to_exit_;
+};
+
+// Stores the entry timestamp of the current thread, if it belongs to the target.
+std::vector<bpf_insn> CreateUprobeProgram(pid_t target_pid, int entry_timestamps_map_fd) {
+  ProgramBuilder builder;
+  builder.Add({
+      Call(BPF_FUNC_get_current_pid_tgid),
+      MovRegister(BPF_REG_6, BPF_REG_0),
+      RightShiftImmediate(BPF_REG_0, 32),
+  });
+  builder.AddJumpToExit(JumpIfNotEqualImmediate(BPF_REG_0, target_pid, 0));
+  builder.Add({
+      StoreDoubleWord(BPF_REG_10, -8, BPF_REG_6),
+      Call(BPF_FUNC_ktime_get_ns),
+      StoreDoubleWord(BPF_REG_10, -16, BPF_REG_0),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -8),
+      MovRegister(BPF_REG_3, BPF_REG_10),
+      AddImmediate(BPF_REG_3, -16),
+      LoadMapFd(BPF_REG_1, entry_timestamps_map_fd),
+      LoadMapFdSecondHalf(),
+      MovImmediate(BPF_REG_4, BPF_ANY),
+      Call(BPF_FUNC_map_update_elem),
+  });
+  return std::move(builder).Build();
+}
+
+// Takes the entry timestamp of the current thread, if any, and adds the duration of the call to the
+// histogram of the function at `function_index`.
+std::vector<bpf_insn> CreateUretprobeProgram(int entry_timestamps_map_fd, int histograms_map_fd,
+                                             uint32_t function_index) {
+  ProgramBuilder builder;
+  builder.Add({
+      Call(BPF_FUNC_get_current_pid_tgid),
+      StoreDoubleWord(BPF_REG_10, -8, BPF_REG_0),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -8),
+      LoadMapFd(BPF_REG_1, entry_timestamps_map_fd),
+      LoadMapFdSecondHalf(),
+      Call(BPF_FUNC_map_lookup_elem),
+  });
+  builder.AddJumpToExit(JumpIfEqualImmediate(BPF_REG_0, 0, 0));
+
+  // r7 = duration of the call.
+  builder.Add({
+      LoadDoubleWord(BPF_REG_6, BPF_REG_0, 0),
+      Call(BPF_FUNC_ktime_get_ns),
+      MovRegister(BPF_REG_7, BPF_REG_0),
+      SubtractRegister(BPF_REG_7, BPF_REG_6),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -8),
+      LoadMapFd(BPF_REG_1, entry_timestamps_map_fd),
+      LoadMapFdSecondHalf(),
+      Call(BPF_FUNC_map_delete_elem),
+  });
+
+  // r8 = floor(log2(r7)), or 0 if r7 is 0, by shifting the remaining high bits in r9.
+  builder.Add({
+      MovImmediate(BPF_REG_8, 0),
+      MovRegister(BPF_REG_9, BPF_REG_7),
+  });
+  for (int32_t shift : {32, 16, 8, 4, 2, 1}) {
+    builder.Add({
+        MovRegister(BPF_REG_1, BPF_REG_9),
+        RightShiftImmediate(BPF_REG_1, shift),
+        JumpIfEqualImmediate(BPF_REG_1, 0, 2),
+        MovRegister(BPF_REG_9, BPF_REG_1),
+        AddImmediate(BPF_REG_8, shift),
+        // The jump above lands here.
+    });
+  }
+
+  builder.Add({
+      StoreImmediateWord(BPF_REG_10, -12, static_cast<int32_t>(function_index)),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -12),
+      LoadMapFd(BPF_REG_1, histograms_map_fd),
+      LoadMapFdSecondHalf(),
+      Call(BPF_FUNC_map_lookup_elem),
+  });
+  builder.AddJumpToExit(JumpIfEqualImmediate(BPF_REG_0, 0, 0));
+  // This lets the verifier know that the bucket is within the histogram.
+  builder.AddJumpToExit(
+      JumpIfGreaterImmediate(BPF_REG_8, FunctionLatencyHistogram::kBucketCount - 1, 0));
+  builder.Add({
+      LeftShiftImmediate(BPF_REG_8, 3),
+      MovRegister(BPF_REG_1, BPF_REG_0),
+      AddRegister(BPF_REG_1, BPF_REG_8),
+      MovImmediate(BPF_REG_2, 1),
+      AtomicAddDoubleWord(BPF_REG_1, 0, BPF_REG_2),
+      AtomicAddDoubleWord(BPF_REG_0, offsetof(FunctionLatencyHistogram, total_ns), BPF_REG_7),
+  });
+  return std::move(builder).Build();
+}
+
+ErrorMessageOr<void> AttachProgram(int probe_fd, int program_fd) {
+  if (ioctl(probe_fd, PERF_EVENT_IOC_SET_BPF, program_fd) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Attaching eBPF program to u(ret)probe: %s", SafeStrerror(errno))};
+  }
+  return outcome::success();
+}
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<FunctionLatencyBpfAggregator>> FunctionLatencyBpfAggregator::Create(
+    pid_t target_pid, size_t function_count) {
+  if (function_count == 0) {
+    return ErrorMessage{"No function to measure with eBPF"};
+  }
+
+  OUTCOME_TRY(entry_timestamps_map_fd,
+              CreateMap(BPF_MAP_TYPE_HASH, sizeof(uint64_t), sizeof(uint64_t), kMaxThreadCount));
+  ErrorMessageOr<int> histograms_map_fd_or_error =
+      CreateMap(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t), sizeof(FunctionLatencyHistogram),
+                static_cast<uint32_t>(function_count));
+  if (histograms_map_fd_or_error.has_error()) {
+    close(entry_timestamps_map_fd);
+    return histograms_map_fd_or_error.error();
+  }
+  const int histograms_map_fd = histograms_map_fd_or_error.value();
+
+  std::vector<int> program_fds;
+  auto close_all = [&] {
+    for (int program_fd : program_fds) {
+      close(program_fd);
+    }
+    close(histograms_map_fd);
+    close(entry_timestamps_map_fd);
+  };
+
+  ErrorMessageOr<int> uprobe_program_fd_or_error =
+      LoadUprobeProgram(CreateUprobeProgram(target_pid, entry_timestamps_map_fd), "uprobes");
+  if (uprobe_program_fd_or_error.has_error()) {
+    close_all();
+    return uprobe_program_fd_or_error.error();
+  }
+  const int uprobe_program_fd = uprobe_program_fd_or_error.value();
+  program_fds.push_back(uprobe_program_fd);
+
+  std::vector<int> uretprobe_program_fds;
+  for (size_t function_index = 0; function_index < function_count; ++function_index) {
+    ErrorMessageOr<int> program_fd_or_error = LoadUprobeProgram(
+        CreateUretprobeProgram(entry_timestamps_map_fd, histograms_map_fd,
+                               static_cast<uint32_t>(function_index)),
+        "uretprobes");
+    if (program_fd_or_error.has_error()) {
+      close_all();
+      return program_fd_or_error.error();
+    }
+    program_fds.push_back(program_fd_or_error.value());
+    uretprobe_program_fds.push_back(program_fd_or_error.value());
+  }
+
+  return std::unique_ptr<FunctionLatencyBpfAggregator>(
+      new FunctionLatencyBpfAggregator{entry_timestamps_map_fd, histograms_map_fd,
+                                       uprobe_program_fd, std::move(uretprobe_program_fds)});
+}
+
+FunctionLatencyBpfAggregator::~FunctionLatencyBpfAggregator() {
+  // The u(ret)probe file descriptors keep their own reference to the programs.
+  for (int program_fd : uretprobe_program_fds_) {
+    close(program_fd);
+  }
+  close(uprobe_program_fd_);
+  close(histograms_map_fd_);
+  close(entry_timestamps_map_fd_);
+}
+
+ErrorMessageOr<void> FunctionLatencyBpfAggregator::AttachToUprobe(int uprobe_fd) const {
+  return AttachProgram(uprobe_fd, uprobe_program_fd_);
+}
+
+ErrorMessageOr<void> FunctionLatencyBpfAggregator::AttachToUretprobe(int uretprobe_fd,
+                                                                     size_t function_index) const {
+  CHECK(function_index < uretprobe_program_fds_.size());
+  return AttachProgram(uretprobe_fd, uretprobe_program_fds_[function_index]);
+}
+
+ErrorMessageOr<std::vector<FunctionLatencyHistogram>>
+FunctionLatencyBpfAggregator::ReadHistograms() const {
+  std::vector<FunctionLatencyHistogram> histograms(uretprobe_program_fds_.size());
+  for (size_t function_index = 0; function_index < histograms.size(); ++function_index) {
+    uint32_t key = function_index;
+    bpf_attr attr{};
+    attr.map_fd = histograms_map_fd_;
+    attr.key = reinterpret_cast<uint64_t>(&key);
+    attr.value = reinterpret_cast<uint64_t>(&histograms[function_index]);
+    if (Bpf(BPF_MAP_LOOKUP_ELEM, &attr) != 0) {
+      return ErrorMessage{
+          absl::StrFormat("Reading latency histograms from eBPF map: %s", SafeStrerror(errno))};
+    }
+  }
+  return histograms;
+}
+
+orbit_grpc_protos::FunctionCallStatistics CreateFunctionCallStatistics(
+    uint64_t function_id, const FunctionLatencyHistogram& histogram,
+    const FunctionLatencyHistogram& previous_histogram) {
+  orbit_grpc_protos::FunctionCallStatistics statistics;
+  statistics.set_function_id(function_id);
+  statistics.set_total_time_ns(histogram.total_ns - previous_histogram.total_ns);
+  std::optional<size_t> min_bucket;
+  size_t max_bucket = 0;
+  for (size_t bucket = 0; bucket < FunctionLatencyHistogram::kBucketCount; ++bucket) {
+    const uint64_t count = histogram.counts[bucket] - previous_histogram.counts[bucket];
+    if (count == 0) continue;
+    if (!min_bucket.has_value()) min_bucket = bucket;
+    max_bucket = bucket;
+    statistics.set_count(statistics.count() + count);
+  }
+  if (!min_bucket.has_value()) return statistics;
+
+  // Trailing empty buckets are not stored.
+  for (size_t bucket = 0; bucket <= max_bucket; ++bucket) {
+    statistics.add_duration_log2_histogram(histogram.counts[bucket] -
+                                           previous_histogram.counts[bucket]);
+  }
+  statistics.set_min_ns(min_bucket.value() == 0 ? 0 : uint64_t{1} << min_bucket.value());
+  statistics.set_max_ns(max_bucket == FunctionLatencyHistogram::kBucketCount - 1
+                            ? std::numeric_limits<uint64_t>::max()
+                            : (uint64_t{2} << max_bucket) - 1);
+  return statistics;
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_FUNCTION_LATENCY_BPF_AGGREGATOR_H_
+#define LINUX_TRACING_FUNCTION_LATENCY_BPF_AGGREGATOR_H_
+
+#include <sys/types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+// The durations of the calls of a function measured in the kernel. counts[b] is the number of
+// calls that took between 2^b and 2^(b+1) - 1 nanoseconds, where counts[0] also includes the calls
+// that took 0 nanoseconds.
+struct FunctionLatencyHistogram {
+  static constexpr size_t kBucketCount = 64;
+
+  std::array<uint64_t, kBucketCount> counts{};
+  uint64_t total_ns = 0;
+};
+
+// FunctionLatencyBpfAggregator measures the durations of the calls of instrumented functions
+// without any perf_event_open record reaching the ring buffers. This is done with eBPF programs
+// attached to the uprobe and the uretprobe file descriptors of the functions: the program attached
+// to uprobes stores the entry timestamp per thread, while the program attached to the uretprobes
+// of a function computes the duration of the call and adds it to the histogram of the function in
+// an eBPF map. Both programs drop the event, so that the cost of a call is only the one of the
+// probes themselves. ReadHistograms returns the histograms accumulated since the creation.
+// Only the calls of the target process are measured. As a single entry timestamp is stored per
+// thread, only the innermost of recursive calls is measured.
+class FunctionLatencyBpfAggregator {
+ public:
+  // The functions are identified by their index, from 0 to function_count - 1.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<FunctionLatencyBpfAggregator>> Create(
+      pid_t target_pid, size_t function_count);
+
+  ~FunctionLatencyBpfAggregator();
+  FunctionLatencyBpfAggregator(const FunctionLatencyBpfAggregator&) = delete;
+  FunctionLatencyBpfAggregator& operator=(const FunctionLatencyBpfAggregator&) = delete;
+  FunctionLatencyBpfAggregator(FunctionLatencyBpfAggregator&&) = delete;
+  FunctionLatencyBpfAggregator& operator=(FunctionLatencyBpfAggregator&&) = delete;
+
+  // These attach the corresponding program to a file descriptor opened with
+  // uprobes_retaddr_event_open or with uretprobes_event_open, respectively.
+  [[nodiscard]] ErrorMessageOr<void> AttachToUprobe(int uprobe_fd) const;
+  [[nodiscard]] ErrorMessageOr<void> AttachToUretprobe(int uretprobe_fd,
+                                                       size_t function_index) const;
+
+  // Returns one histogram per function, indexed like the functions.
+  [[nodiscard]] ErrorMessageOr<std::vector<FunctionLatencyHistogram>> ReadHistograms() const;
+
+ private:
+  FunctionLatencyBpfAggregator(int entry_timestamps_map_fd, int histograms_map_fd,
+                               int uprobe_program_fd, std::vector<int> uretprobe_program_fds)
+      : entry_timestamps_map_fd_{entry_timestamps_map_fd},
+        histograms_map_fd_{histograms_map_fd},
+        uprobe_program_fd_{uprobe_program_fd},
+        uretprobe_program_fds_{std::move(uretprobe_program_fds)} {}
+
+  const int entry_timestamps_map_fd_;
+  const int histograms_map_fd_;
+  const int uprobe_program_fd_;
+  // One program per function, as the index of the function is an immediate of the program.
+  const std::vector<int> uretprobe_program_fds_;
+};
+
+// Returns the statistics of the calls of the function with `function_id` that were added to
+// `histogram` since `previous_histogram`, which were both returned by ReadHistograms, with a
+// FunctionCallStatistics::duration_log2_histogram. As only the bucket of each call is known, min_ns
+// and max_ns are the bounds of the lowest and of the highest bucket that got calls.
+[[nodiscard]] orbit_grpc_protos::FunctionCallStatistics CreateFunctionCallStatistics(
+    uint64_t function_id, const FunctionLatencyHistogram& histogram,
+    const FunctionLatencyHistogram& previous_histogram);
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_FUNCTION_LATENCY_BPF_AGGREGATOR_H_
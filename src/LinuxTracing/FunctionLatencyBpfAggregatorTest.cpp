@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "FunctionLatencyBpfAggregator.h"
+#include "capture.pb.h"
+
+using ::testing::ElementsAre;
+
+namespace orbit_linux_tracing {
+
+TEST(FunctionLatencyBpfAggregator, ProgramsAreAcceptedByTheVerifier) {
+  auto aggregator_or_error = FunctionLatencyBpfAggregator::Create(getpid(), 3);
+  if (aggregator_or_error.has_error()) {
+    // Loading eBPF programs requires root or CAP_BPF.
+    GTEST_SKIP() << aggregator_or_error.error().message();
+  }
+  std::unique_ptr<FunctionLatencyBpfAggregator> aggregator = std::move(aggregator_or_error.value());
+
+  ErrorMessageOr<std::vector<FunctionLatencyHistogram>> histograms_or_error =
+      aggregator->ReadHistograms();
+  ASSERT_FALSE(histograms_or_error.has_error()) << histograms_or_error.error().message();
+  ASSERT_EQ(histograms_or_error.value().size(), 3);
+  for (const FunctionLatencyHistogram& histogram : histograms_or_error.value()) {
+    EXPECT_EQ(histogram.total_ns, 0);
+    for (uint64_t count : histogram.counts) {
+      EXPECT_EQ(count, 0);
+    }
+  }
+}
+
+TEST(FunctionLatencyBpfAggregator, CreateFailsWithoutFunctions) {
+  EXPECT_TRUE(FunctionLatencyBpfAggregator::Create(getpid(), 0).has_error());
+}
+
+TEST(FunctionLatencyBpfAggregator, CreateFunctionCallStatisticsOnlyCountsNewCalls) {
+  FunctionLatencyHistogram previous_histogram;
+  previous_histogram.counts[3] = 5;
+  previous_histogram.total_ns = 50;
+  FunctionLatencyHistogram histogram = previous_histogram;
+  histogram.counts[2] += 1;
+  histogram.counts[4] += 2;
+  histogram.total_ns += 5 + 20 + 30;
+
+  orbit_grpc_protos::FunctionCallStatistics statistics =
+      CreateFunctionCallStatistics(42, histogram, previous_histogram);
+  EXPECT_EQ(statistics.function_id(), 42);
+  EXPECT_EQ(statistics.count(), 3);
+  EXPECT_EQ(statistics.total_time_ns(), 55);
+  EXPECT_EQ(statistics.min_ns(), 4);
+  EXPECT_EQ(statistics.max_ns(), 31);
+  EXPECT_THAT(statistics.duration_log2_histogram(), ElementsAre(0, 0, 1, 0, 2));
+  EXPECT_TRUE(statistics.duration_histogram().empty());
+}
+
+TEST(FunctionLatencyBpfAggregator, CreateFunctionCallStatisticsOfExtremeBuckets) {
+  FunctionLatencyHistogram histogram;
+  histogram.counts[0] = 1;
+  histogram.counts[FunctionLatencyHistogram::kBucketCount - 1] = 1;
+
+  orbit_grpc_protos::FunctionCallStatistics statistics =
+      CreateFunctionCallStatistics(42, histogram, FunctionLatencyHistogram{});
+  EXPECT_EQ(statistics.count(), 2);
+  EXPECT_EQ(statistics.min_ns(), 0);
+  EXPECT_EQ(statistics.max_ns(), std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(statistics.duration_log2_histogram_size(), FunctionLatencyHistogram::kBucketCount);
+}
+
+TEST(FunctionLatencyBpfAggregator, CreateFunctionCallStatisticsWithoutNewCalls) {
+  FunctionLatencyHistogram histogram;
+  histogram.counts[5] = 3;
+  histogram.total_ns = 100;
+
+  orbit_grpc_protos::FunctionCallStatistics statistics =
+      CreateFunctionCallStatistics(42, histogram, histogram);
+  EXPECT_EQ(statistics.count(), 0);
+  EXPECT_TRUE(statistics.duration_log2_histogram().empty());
+}
+
+}  // namespace orbit_linux_tracing
@@ -14,6 +14,7 @@
 #include <utility>
 #include <vector>
 
+#include "DrmGpuTracepoints.h"
 #include "OrbitBase/Logging.h"
 #include "capture.pb.h"
 
@@ -59,10 +60,19 @@ void GpuTracepointVisitor::CreateGpuJobAndSendToListenerIfComplete(const Key& ke
     return;
   }
 
-  std::string timeline = cs_it->second.timeline;
-  pid_t pid = cs_it->second.pid;
-  pid_t tid = cs_it->second.tid;
+  CreateGpuJobAndSendToListener(cs_it->second.pid, cs_it->second.tid, cs_it->second.context,
+                                cs_it->second.seqno, cs_it->second.timeline,
+                                cs_it->second.timestamp_ns, sched_it->second.timestamp_ns,
+                                dma_it->second.timestamp_ns);
 
+  amdgpu_cs_ioctl_events_.erase(key);
+  amdgpu_sched_run_job_events_.erase(key);
+  dma_fence_signaled_events_.erase(key);
+}
+
+void GpuTracepointVisitor::CreateGpuJobAndSendToListener(
+    pid_t pid, pid_t tid, uint32_t context, uint32_t seqno, const std::string& timeline,
+    uint64_t submit_timestamp_ns, uint64_t run_timestamp_ns, uint64_t signaled_timestamp_ns) {
   // We assume that GPU jobs (command buffer submissions) immediately
   // start running on the hardware when they are scheduled by the
   // driver (this is the best we can do), *unless* there is already a
@@ -84,35 +94,67 @@ void GpuTracepointVisitor::CreateGpuJobAndSendToListenerIfComplete(const Key& ke
   // scheduled by the driver. Otherwise, we assume it starts exactly
   // when the previous job has signaled that it is done. Since we do
   // not have an explicit signal here, this is the best we can do.
-  uint64_t hw_start_time = sched_it->second.timestamp_ns;
+  uint64_t hw_start_time = run_timestamp_ns;
   if (hw_start_time < latest_dma_it->second) {
     hw_start_time = latest_dma_it->second;
   }
 
-  int depth =
-      ComputeDepthForGpuJob(timeline, cs_it->second.timestamp_ns, dma_it->second.timestamp_ns);
+  int depth = ComputeDepthForGpuJob(timeline, submit_timestamp_ns, signaled_timestamp_ns);
   FullGpuJob gpu_job;
   gpu_job.set_pid(pid);
   gpu_job.set_tid(tid);
-  gpu_job.set_context(cs_it->second.context);
-  gpu_job.set_seqno(cs_it->second.seqno);
+  gpu_job.set_context(context);
+  gpu_job.set_seqno(seqno);
   gpu_job.set_depth(depth);
-  gpu_job.set_amdgpu_cs_ioctl_time_ns(cs_it->second.timestamp_ns);
-  gpu_job.set_amdgpu_sched_run_job_time_ns(sched_it->second.timestamp_ns);
+  gpu_job.set_amdgpu_cs_ioctl_time_ns(submit_timestamp_ns);
+  gpu_job.set_amdgpu_sched_run_job_time_ns(run_timestamp_ns);
   gpu_job.set_gpu_hardware_start_time_ns(hw_start_time);
-  gpu_job.set_dma_fence_signaled_time_ns(dma_it->second.timestamp_ns);
-  gpu_job.set_timeline(cs_it->second.timeline);
+  gpu_job.set_dma_fence_signaled_time_ns(signaled_timestamp_ns);
+  gpu_job.set_timeline(timeline);
 
   CHECK(listener_ != nullptr);
   listener_->OnGpuJob(std::move(gpu_job));
 
   // We need to update the timestamp when the last GPU job so far seen
   // finishes on this timeline.
-  latest_dma_it->second = std::max(latest_dma_it->second, dma_it->second.timestamp_ns);
+  latest_dma_it->second = std::max(latest_dma_it->second, signaled_timestamp_ns);
+}
 
-  amdgpu_cs_ioctl_events_.erase(key);
-  amdgpu_sched_run_job_events_.erase(key);
-  dma_fence_signaled_events_.erase(key);
+void GpuTracepointVisitor::CreateDrmSchedGpuJobAndSendToListenerIfComplete(uint64_t fence) {
+  auto job_it = drm_sched_jobs_.find(fence);
+  CHECK(job_it != drm_sched_jobs_.end());
+  const PartialGpuJob& job = job_it->second;
+  if (!job.submit_timestamp_ns.has_value() || !job.run_timestamp_ns.has_value() ||
+      !job.signaled_timestamp_ns.has_value()) {
+    return;
+  }
+
+  CreateGpuJobAndSendToListener(
+      job.pid, job.tid, job.context, job.seqno,
+      job.timeline.empty() ? std::string{kDrmSchedUnnamedTimeline} : job.timeline,
+      job.submit_timestamp_ns.value(), job.run_timestamp_ns.value(),
+      job.signaled_timestamp_ns.value());
+  drm_sched_jobs_.erase(job_it);
+}
+
+void GpuTracepointVisitor::CreateI915GpuJobAndSendToListenerIfComplete(
+    const std::pair<uint32_t, uint32_t>& key) {
+  auto request_it = i915_requests_.find(key);
+  CHECK(request_it != i915_requests_.end());
+  const PartialGpuJob& request = request_it->second;
+  if (!request.submit_timestamp_ns.has_value() || !request.signaled_timestamp_ns.has_value()) {
+    return;
+  }
+
+  // i915_request_in is only available in kernels built with
+  // CONFIG_DRM_I915_LOW_LEVEL_TRACEPOINTS. Without it, the request is assumed to be submitted to
+  // the hardware when it is added.
+  CreateGpuJobAndSendToListener(
+      request.pid, request.tid, request.context, request.seqno, request.timeline,
+      request.submit_timestamp_ns.value(),
+      request.run_timestamp_ns.value_or(request.submit_timestamp_ns.value()),
+      request.signaled_timestamp_ns.value());
+  i915_requests_.erase(request_it);
 }
 
 // The following three overloaded PushEvent methods handle the three different
@@ -149,6 +191,16 @@ void GpuTracepointVisitor::Visit(AmdgpuSchedRunJobPerfEvent* event) {
 }
 
 void GpuTracepointVisitor::Visit(DmaFenceSignaledPerfEvent* event) {
+  // The fences of i915 requests have the context and seqno of the requests, but their timeline is
+  // not the engine.
+  if (event->ExtractDriverString() == kI915DriverName) {
+    std::pair<uint32_t, uint32_t> key{event->GetContext(), event->GetSeqno()};
+    PartialGpuJob& request = i915_requests_[key];
+    request.signaled_timestamp_ns = event->GetTimestamp();
+    CreateI915GpuJobAndSendToListenerIfComplete(key);
+    return;
+  }
+
   DmaFenceSignaledEvent internal_event{event->GetTimestamp(), event->GetContext(),
                                        event->GetSeqno(), event->ExtractTimelineString()};
   Key key = std::make_tuple(event->GetContext(), event->GetSeqno(), event->ExtractTimelineString());
@@ -157,4 +209,54 @@ void GpuTracepointVisitor::Visit(DmaFenceSignaledPerfEvent* event) {
   CreateGpuJobAndSendToListenerIfComplete(key);
 }
 
+// The DRM GPU scheduler jobs and the i915 requests are handled in the same way, but all events of a
+// job are accumulated in a single map. The three gpu_scheduler tracepoints identify the job by its
+// "finished" fence. As drm_sched_process_job doesn't record the job id, the seqno of the FullGpuJob
+// is the lower 32 bits of the job id of drm_sched_job, and the context is 0.
+
+void GpuTracepointVisitor::Visit(DrmSchedJobPerfEvent* event) {
+  PartialGpuJob& job = drm_sched_jobs_[event->GetFence()];
+  job.pid = event->GetPid();
+  job.tid = event->GetTid();
+  job.seqno = static_cast<uint32_t>(event->GetJobId());
+  if (!event->GetTimeline().empty()) job.timeline = event->GetTimeline();
+  job.submit_timestamp_ns = event->GetTimestamp();
+  CreateDrmSchedGpuJobAndSendToListenerIfComplete(event->GetFence());
+}
+
+void GpuTracepointVisitor::Visit(DrmRunJobPerfEvent* event) {
+  PartialGpuJob& job = drm_sched_jobs_[event->GetFence()];
+  if (job.timeline.empty()) job.timeline = event->GetTimeline();
+  job.run_timestamp_ns = event->GetTimestamp();
+  CreateDrmSchedGpuJobAndSendToListenerIfComplete(event->GetFence());
+}
+
+void GpuTracepointVisitor::Visit(DrmSchedProcessJobPerfEvent* event) {
+  PartialGpuJob& job = drm_sched_jobs_[event->GetFence()];
+  job.signaled_timestamp_ns = event->GetTimestamp();
+  CreateDrmSchedGpuJobAndSendToListenerIfComplete(event->GetFence());
+}
+
+void GpuTracepointVisitor::Visit(I915RequestAddPerfEvent* event) {
+  std::pair<uint32_t, uint32_t> key{event->GetContext(), event->GetSeqno()};
+  PartialGpuJob& request = i915_requests_[key];
+  request.pid = event->GetPid();
+  request.tid = event->GetTid();
+  request.context = event->GetContext();
+  request.seqno = event->GetSeqno();
+  request.timeline = event->GetTimeline();
+  request.submit_timestamp_ns = event->GetTimestamp();
+  CreateI915GpuJobAndSendToListenerIfComplete(key);
+}
+
+void GpuTracepointVisitor::Visit(I915RequestInPerfEvent* event) {
+  // As requests are completed without i915_request_in, this event is dropped if it arrives after
+  // the request was completed, or before it was added, instead of starting a new request.
+  auto request_it = i915_requests_.find(std::make_pair(event->GetContext(), event->GetSeqno()));
+  if (request_it == i915_requests_.end() || !request_it->second.submit_timestamp_ns.has_value()) {
+    return;
+  }
+  request_it->second.run_timestamp_ns = event->GetTimestamp();
+}
+
 }  // namespace orbit_linux_tracing
@@ -10,8 +10,10 @@
 #include <sys/types.h>
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "LinuxTracing/TracerListener.h"
@@ -30,6 +32,15 @@ class GpuTracepointVisitor : public PerfEventVisitor {
   void Visit(AmdgpuSchedRunJobPerfEvent* event) override;
   void Visit(DmaFenceSignaledPerfEvent* event) override;
 
+  // The jobs of the generic DRM GPU scheduler and the requests of i915 are turned into the same
+  // FullGpuJobs as the ones of amdgpu: the times of amdgpu_cs_ioctl and amdgpu_sched_run_job are
+  // the ones of drm_sched_job and drm_run_job, or of i915_request_add and i915_request_in.
+  void Visit(DrmSchedJobPerfEvent* event) override;
+  void Visit(DrmRunJobPerfEvent* event) override;
+  void Visit(DrmSchedProcessJobPerfEvent* event) override;
+  void Visit(I915RequestAddPerfEvent* event) override;
+  void Visit(I915RequestInPerfEvent* event) override;
+
  private:
   // Keys are context, seqno, and timeline.
   using Key = std::tuple<uint32_t, uint32_t, std::string>;
@@ -39,6 +50,26 @@ class GpuTracepointVisitor : public PerfEventVisitor {
 
   void CreateGpuJobAndSendToListenerIfComplete(const Key& key);
 
+  void CreateGpuJobAndSendToListener(pid_t pid, pid_t tid, uint32_t context, uint32_t seqno,
+                                     const std::string& timeline, uint64_t submit_timestamp_ns,
+                                     uint64_t run_timestamp_ns, uint64_t signaled_timestamp_ns);
+
+  // The events of a job of the DRM GPU scheduler or of an i915 request received so far, which can
+  // also arrive out-of-order.
+  struct PartialGpuJob {
+    pid_t pid = 0;
+    pid_t tid = 0;
+    uint32_t context = 0;
+    uint32_t seqno = 0;
+    std::string timeline;
+    std::optional<uint64_t> submit_timestamp_ns;
+    std::optional<uint64_t> run_timestamp_ns;
+    std::optional<uint64_t> signaled_timestamp_ns;
+  };
+
+  void CreateDrmSchedGpuJobAndSendToListenerIfComplete(uint64_t fence);
+  void CreateI915GpuJobAndSendToListenerIfComplete(const std::pair<uint32_t, uint32_t>& key);
+
   TracerListener* listener_;
 
   struct AmdgpuCsIoctlEvent {
@@ -67,6 +98,11 @@ class GpuTracepointVisitor : public PerfEventVisitor {
   };
   absl::flat_hash_map<Key, DmaFenceSignaledEvent> dma_fence_signaled_events_;
 
+  // Keys are the addresses of the "finished" fences of the jobs.
+  absl::flat_hash_map<uint64_t, PartialGpuJob> drm_sched_jobs_;
+  // Keys are context and seqno.
+  absl::flat_hash_map<std::pair<uint32_t, uint32_t>, PartialGpuJob> i915_requests_;
+
   absl::flat_hash_map<std::string, uint64_t> timeline_to_latest_dma_signal_;
 
   absl::flat_hash_map<std::string, std::vector<uint64_t>> timeline_to_latest_timestamp_per_depth_;
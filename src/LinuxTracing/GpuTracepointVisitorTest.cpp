@@ -13,6 +13,7 @@
 #include <string>
 #include <utility>
 
+#include "DrmGpuTracepoints.h"
 #include "GpuTracepointVisitor.h"
 #include "KernelTracepoints.h"
 #include "LinuxTracing/TracerListener.h"
@@ -44,6 +45,15 @@ class MockTracerListener : public TracerListener {
   MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
   MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
               (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent, (orbit_grpc_protos::SamplingPeriodChangedEvent),
+              (override));
+  MOCK_METHOD(void, OnPmuCountersSample, (orbit_grpc_protos::PmuCountersSample), (override));
+  MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
+  MOCK_METHOD(void, OnServiceHealthEvent, (orbit_grpc_protos::ServiceHealthEvent), (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe, (orbit_grpc_protos::PipelineLatencyProbe),
+              (override));
+  MOCK_METHOD(void, OnCaptureStatisticsSummary, (orbit_grpc_protos::CaptureStatisticsSummary),
+              (override));
 };
 
 class GpuTracepointVisitorTest : public ::testing::Test {
@@ -96,19 +106,25 @@ std::unique_ptr<AmdgpuSchedRunJobPerfEvent> MakeFakeAmdgpuSchedRunJobPerfEvent(
 }
 
 std::unique_ptr<DmaFenceSignaledPerfEvent> MakeFakeDmaFenceSignaledPerfEvent(
-    uint64_t timestamp_ns, uint32_t context, uint32_t seqno, const std::string& timeline) {
-  auto event = std::make_unique<DmaFenceSignaledPerfEvent>(
-      static_cast<uint32_t>(sizeof(dma_fence_signaled_tracepoint) + timeline.length() + 1));
+    uint64_t timestamp_ns, uint32_t context, uint32_t seqno, const std::string& timeline,
+    const std::string& driver = "amdgpu") {
+  auto event = std::make_unique<DmaFenceSignaledPerfEvent>(static_cast<uint32_t>(
+      sizeof(dma_fence_signaled_tracepoint) + driver.length() + 1 + timeline.length() + 1));
   event->ring_buffer_record.sample_id.time = timestamp_ns;
   CHECK(event->GetTimestamp() == timestamp_ns);
   reinterpret_cast<dma_fence_signaled_tracepoint*>(event->tracepoint_data.get())->context = context;
   CHECK(event->GetContext() == context);
   reinterpret_cast<dma_fence_signaled_tracepoint*>(event->tracepoint_data.get())->seqno = seqno;
   CHECK(event->GetSeqno() == seqno);
+  reinterpret_cast<dma_fence_signaled_tracepoint*>(event->tracepoint_data.get())->driver =
+      ((driver.length() + 1) << 16) | sizeof(dma_fence_signaled_tracepoint);
+  memcpy(event->tracepoint_data.get() + sizeof(dma_fence_signaled_tracepoint), driver.c_str(),
+         driver.length() + 1);
+  CHECK(event->ExtractDriverString() == driver);
+  const size_t timeline_offset = sizeof(dma_fence_signaled_tracepoint) + driver.length() + 1;
   reinterpret_cast<dma_fence_signaled_tracepoint*>(event->tracepoint_data.get())->timeline =
-      ((timeline.length() + 1) << 16) | sizeof(dma_fence_signaled_tracepoint);
-  memcpy(event->tracepoint_data.get() + sizeof(dma_fence_signaled_tracepoint), timeline.c_str(),
-         timeline.length() + 1);
+      ((timeline.length() + 1) << 16) | timeline_offset;
+  memcpy(event->tracepoint_data.get() + timeline_offset, timeline.c_str(), timeline.length() + 1);
   CHECK(event->ExtractTimelineString() == timeline);
   return event;
 }
@@ -590,4 +606,82 @@ TEST_F(GpuTracepointVisitorTest,
   EXPECT_THAT(actual_gpu_job2, GpuJobEq(expected_gpu_job2));
 }
 
+TEST_F(GpuTracepointVisitorTest, DrmSchedJobCreatedWithAllThreePerfEvents) {
+  static constexpr pid_t kPid = 41;
+  static constexpr pid_t kTid = 42;
+  static constexpr uint64_t kFence = 0xFFFF888812345678;
+  static constexpr uint64_t kJobId = 0x100000007;
+  static const std::string kTimeline = "gfx";
+  static constexpr uint64_t kTimestampA = 100;
+  static constexpr uint64_t kTimestampB = 200;
+  static constexpr uint64_t kTimestampD = 300;
+
+  orbit_grpc_protos::FullGpuJob expected_gpu_job =
+      MakeGpuJob(kPid, kTid, 0, 7, kTimeline, 0, kTimestampA, kTimestampB, kTimestampB,
+                 kTimestampD);
+  orbit_grpc_protos::FullGpuJob actual_gpu_job;
+  EXPECT_CALL(mock_listener_, OnGpuJob).Times(1).WillOnce(::testing::SaveArg<0>(&actual_gpu_job));
+  // The events can also arrive out-of-order.
+  DrmSchedProcessJobPerfEvent{kTimestampD, 0, 0, kFence, 0, ""}.Accept(&visitor_);
+  DrmSchedJobPerfEvent{kTimestampA, kPid, kTid, kFence, kJobId, kTimeline}.Accept(&visitor_);
+  // Another job, which doesn't complete.
+  DrmRunJobPerfEvent{kTimestampB, 0, 0, kFence + 1, kJobId + 1, kTimeline}.Accept(&visitor_);
+  DrmRunJobPerfEvent{kTimestampB, 0, 0, kFence, kJobId, kTimeline}.Accept(&visitor_);
+  EXPECT_THAT(actual_gpu_job, GpuJobEq(expected_gpu_job));
+}
+
+TEST_F(GpuTracepointVisitorTest, DrmSchedJobWithoutSchedulerNameUsesDefaultTimeline) {
+  orbit_grpc_protos::FullGpuJob actual_gpu_job;
+  EXPECT_CALL(mock_listener_, OnGpuJob).Times(1).WillOnce(::testing::SaveArg<0>(&actual_gpu_job));
+  DrmSchedJobPerfEvent{100, 41, 42, 1, 7, ""}.Accept(&visitor_);
+  DrmRunJobPerfEvent{200, 0, 0, 1, 7, ""}.Accept(&visitor_);
+  DrmSchedProcessJobPerfEvent{300, 0, 0, 1, 0, ""}.Accept(&visitor_);
+  EXPECT_EQ(actual_gpu_job.timeline(), kDrmSchedUnnamedTimeline);
+}
+
+TEST_F(GpuTracepointVisitorTest, I915JobCreatedWithRequestAddAndDmaFenceSignaled) {
+  static constexpr pid_t kPid = 41;
+  static constexpr pid_t kTid = 42;
+  static constexpr uint32_t kContext = 1;
+  static constexpr uint32_t kSeqno = 10;
+  static const std::string kTimeline = "rcs0";
+  static constexpr uint64_t kTimestampA = 100;
+  static constexpr uint64_t kTimestampD = 300;
+
+  orbit_grpc_protos::FullGpuJob expected_gpu_job =
+      MakeGpuJob(kPid, kTid, kContext, kSeqno, kTimeline, 0, kTimestampA, kTimestampA, kTimestampA,
+                 kTimestampD);
+  orbit_grpc_protos::FullGpuJob actual_gpu_job;
+  EXPECT_CALL(mock_listener_, OnGpuJob).Times(1).WillOnce(::testing::SaveArg<0>(&actual_gpu_job));
+  I915RequestAddPerfEvent{kTimestampA, kPid, kTid, kContext, kSeqno, kTimeline}.Accept(&visitor_);
+  // The timeline of the fence is not the engine, and is ignored.
+  MakeFakeDmaFenceSignaledPerfEvent(kTimestampD, kContext, kSeqno, "[game]", "i915")
+      ->Accept(&visitor_);
+  EXPECT_THAT(actual_gpu_job, GpuJobEq(expected_gpu_job));
+}
+
+TEST_F(GpuTracepointVisitorTest, I915JobUsesRequestInAsHardwareSubmission) {
+  static constexpr pid_t kPid = 41;
+  static constexpr pid_t kTid = 42;
+  static constexpr uint32_t kContext = 1;
+  static constexpr uint32_t kSeqno = 10;
+  static const std::string kTimeline = "vcs0";
+  static constexpr uint64_t kTimestampA = 100;
+  static constexpr uint64_t kTimestampB = 200;
+  static constexpr uint64_t kTimestampD = 300;
+
+  orbit_grpc_protos::FullGpuJob expected_gpu_job =
+      MakeGpuJob(kPid, kTid, kContext, kSeqno, kTimeline, 0, kTimestampA, kTimestampB, kTimestampB,
+                 kTimestampD);
+  orbit_grpc_protos::FullGpuJob actual_gpu_job;
+  EXPECT_CALL(mock_listener_, OnGpuJob).Times(1).WillOnce(::testing::SaveArg<0>(&actual_gpu_job));
+  I915RequestAddPerfEvent{kTimestampA, kPid, kTid, kContext, kSeqno, kTimeline}.Accept(&visitor_);
+  I915RequestInPerfEvent{kTimestampB, 0, 0, kContext, kSeqno, kTimeline}.Accept(&visitor_);
+  // A fence of another driver with the same context and seqno doesn't complete the request.
+  MakeFakeDmaFenceSignaledPerfEvent(kTimestampD, kContext, kSeqno, kTimeline)->Accept(&visitor_);
+  MakeFakeDmaFenceSignaledPerfEvent(kTimestampD, kContext, kSeqno, kTimeline, "i915")
+      ->Accept(&visitor_);
+  EXPECT_THAT(actual_gpu_job, GpuJobEq(expected_gpu_job));
+}
+
 }  // namespace orbit_linux_tracing
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "KernelSymbols.h"
+
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_split.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ReadFileToString.h"
+
+namespace orbit_linux_tracing {
+
+KernelSymbols KernelSymbols::Parse(std::string_view kallsyms) {
+  KernelSymbols kernel_symbols;
+  for (std::string_view line : absl::StrSplit(kallsyms, '\n', absl::SkipEmpty())) {
+    // Each line is "<address> <type> <name>", followed by "\t[<module>]" for the symbols of
+    // modules, e.g., "ffffffffc0a01000 t amdgpu_init\t[amdgpu]".
+    std::vector<std::string_view> tokens = absl::StrSplit(line, absl::ByAnyChar(" \t"),
+                                                          absl::SkipEmpty());
+    if (tokens.size() < 3 || tokens[1].size() != 1) continue;
+
+    // Text (code) symbols, including weak ones.
+    const char type = tokens[1][0];
+    if (type != 't' && type != 'T' && type != 'w' && type != 'W') continue;
+
+    uint64_t address = 0;
+    if (!absl::SimpleHexAtoi(tokens[0], &address) || address == 0) continue;
+
+    std::string module_name =
+        tokens.size() > 3 ? std::string{tokens[3]} : std::string{kKernelModuleName};
+    kernel_symbols.symbols_.push_back({address, std::string{tokens[2]}, std::move(module_name)});
+  }
+
+  // The symbols of the modules come after the ones of the kernel image and aren't sorted.
+  std::stable_sort(
+      kernel_symbols.symbols_.begin(), kernel_symbols.symbols_.end(),
+      [](const Symbol& lhs, const Symbol& rhs) { return lhs.address < rhs.address; });
+  return kernel_symbols;
+}
+
+const KernelSymbols& KernelSymbols::GetProcessWideSymbols() {
+  static const KernelSymbols* kernel_symbols = [] {
+    ErrorMessageOr<std::string> kallsyms_or_error = orbit_base::ReadFileToString("/proc/kallsyms");
+    if (kallsyms_or_error.has_error()) {
+      ERROR("Reading kernel symbols: %s", kallsyms_or_error.error().message());
+      return new KernelSymbols{};
+    }
+    auto* symbols = new KernelSymbols{Parse(kallsyms_or_error.value())};
+    if (symbols->IsEmpty()) {
+      ERROR("No kernel symbols in /proc/kallsyms, kernel frames won't be symbolized");
+    }
+    return symbols;
+  }();
+  return *kernel_symbols;
+}
+
+const KernelSymbols::Symbol* KernelSymbols::FindSymbol(uint64_t address) const {
+  auto it = std::upper_bound(
+      symbols_.begin(), symbols_.end(), address,
+      [](uint64_t address, const Symbol& symbol) { return address < symbol.address; });
+  if (it == symbols_.begin()) return nullptr;
+  return &*std::prev(it);
+}
+
+}  // namespace orbit_linux_tracing
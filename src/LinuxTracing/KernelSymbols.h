@@ -0,0 +1,51 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_KERNEL_SYMBOLS_H_
+#define LINUX_TRACING_KERNEL_SYMBOLS_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+// KernelSymbols symbolizes the kernel addresses of callchains with the symbols of the code of the
+// kernel and of its modules, as listed in /proc/kallsyms.
+class KernelSymbols {
+ public:
+  // The module name of the symbols of the kernel image, as used by perf.
+  static constexpr std::string_view kKernelModuleName = "[kernel.kallsyms]";
+
+  struct Symbol {
+    uint64_t address;
+    std::string name;
+    // kKernelModuleName, or the name of the kernel module in square brackets, e.g., "[amdgpu]".
+    std::string module_name;
+  };
+
+  // Parses the content of /proc/kallsyms, keeping the symbols of code. When kptr_restrict hides the
+  // addresses, all addresses are zero and no symbol is kept.
+  [[nodiscard]] static KernelSymbols Parse(std::string_view kallsyms);
+
+  // The symbols read from /proc/kallsyms the first time this is called. Reading and parsing the
+  // file takes a while, hence it's only done once per process. The symbols of the kernel modules
+  // loaded later are missing.
+  [[nodiscard]] static const KernelSymbols& GetProcessWideSymbols();
+
+  // Returns the symbol with the largest address not greater than `address`, or nullptr if there is
+  // no such symbol.
+  [[nodiscard]] const Symbol* FindSymbol(uint64_t address) const;
+
+  [[nodiscard]] bool IsEmpty() const { return symbols_.empty(); }
+
+ private:
+  // Sorted by address.
+  std::vector<Symbol> symbols_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_KERNEL_SYMBOLS_H_
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "KernelSymbols.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr const char* kKallsyms =
+    "ffffffff81000000 T _text\n"
+    "ffffffff81001000 T do_syscall_64\n"
+    "ffffffff81002000 t __do_sys_futex\n"
+    "ffffffff81003000 D some_data\n"
+    "ffffffff81004000 W weak_function\n"
+    "ffffffffc0a02000 t amdgpu_cs_ioctl\t[amdgpu]\n"
+    "ffffffffc0a01000 t amdgpu_init\t[amdgpu]\n";
+
+}  // namespace
+
+TEST(KernelSymbols, FindSymbolReturnsTheSymbolContainingTheAddress) {
+  KernelSymbols kernel_symbols = KernelSymbols::Parse(kKallsyms);
+  ASSERT_FALSE(kernel_symbols.IsEmpty());
+
+  const KernelSymbols::Symbol* symbol = kernel_symbols.FindSymbol(0xffffffff81002010);
+  ASSERT_NE(symbol, nullptr);
+  EXPECT_EQ(symbol->address, 0xffffffff81002000);
+  EXPECT_EQ(symbol->name, "__do_sys_futex");
+  EXPECT_EQ(symbol->module_name, KernelSymbols::kKernelModuleName);
+
+  symbol = kernel_symbols.FindSymbol(0xffffffff81001000);
+  ASSERT_NE(symbol, nullptr);
+  EXPECT_EQ(symbol->name, "do_syscall_64");
+
+  EXPECT_EQ(kernel_symbols.FindSymbol(0xffffffff80000000), nullptr);
+}
+
+TEST(KernelSymbols, DataSymbolsAreSkipped) {
+  KernelSymbols kernel_symbols = KernelSymbols::Parse(kKallsyms);
+
+  const KernelSymbols::Symbol* symbol = kernel_symbols.FindSymbol(0xffffffff81003010);
+  ASSERT_NE(symbol, nullptr);
+  EXPECT_EQ(symbol->name, "__do_sys_futex");
+
+  symbol = kernel_symbols.FindSymbol(0xffffffff81004010);
+  ASSERT_NE(symbol, nullptr);
+  EXPECT_EQ(symbol->name, "weak_function");
+}
+
+TEST(KernelSymbols, SymbolsOfModulesAreSorted) {
+  KernelSymbols kernel_symbols = KernelSymbols::Parse(kKallsyms);
+
+  const KernelSymbols::Symbol* symbol = kernel_symbols.FindSymbol(0xffffffffc0a01100);
+  ASSERT_NE(symbol, nullptr);
+  EXPECT_EQ(symbol->name, "amdgpu_init");
+  EXPECT_EQ(symbol->module_name, "[amdgpu]");
+
+  symbol = kernel_symbols.FindSymbol(0xffffffffc0a02100);
+  ASSERT_NE(symbol, nullptr);
+  EXPECT_EQ(symbol->name, "amdgpu_cs_ioctl");
+}
+
+TEST(KernelSymbols, HiddenAddressesAreSkipped) {
+  KernelSymbols kernel_symbols = KernelSymbols::Parse(
+      "0000000000000000 T _text\n"
+      "0000000000000000 T do_syscall_64\n");
+  EXPECT_TRUE(kernel_symbols.IsEmpty());
+  EXPECT_EQ(kernel_symbols.FindSymbol(0xffffffff81001000), nullptr);
+}
+
+}  // namespace orbit_linux_tracing
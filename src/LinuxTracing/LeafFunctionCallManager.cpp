@@ -6,6 +6,8 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
@@ -49,6 +51,24 @@ Callstack::CallstackType LeafFunctionCallManager::PatchCallerOfLeafFunction(
     return Callstack::kStackTopForDwarfUnwindingTooSmall;
   }
 
+  // Only the part of the slice from $rsp to $rbp that was actually dumped can be read.
+  const uint64_t readable_stack_size = std::min(stack_size, event->GetStackSize());
+  const std::pair<pid_t, uint64_t> leaf_frame_key{event->GetPid(),
+                                                  event->GetRegisters()[PERF_REG_X86_IP]};
+  if (auto it = leaf_frames_.find(leaf_frame_key); it != leaf_frames_.end()) {
+    const LeafFrame& leaf_frame = it->second;
+    if (leaf_frame.has_frame_pointer) {
+      return Callstack::kComplete;
+    }
+    // If the return address is not in the stack slice, fall back to libunwindstack for the errors.
+    if (leaf_frame.return_address_offset + sizeof(uint64_t) <= readable_stack_size) {
+      uint64_t return_address;
+      std::memcpy(&return_address, event->GetStackData() + leaf_frame.return_address_offset,
+                  sizeof(return_address));
+      return InsertCallerOfLeafFunction(event, current_maps, return_address);
+    }
+  }
+
   const LibunwindstackResult& libunwindstack_result =
       unwinder->Unwind(event->GetPid(), current_maps->Get(), event->GetRegisters(),
                        event->GetStackData(), stack_size, true);
@@ -65,6 +85,7 @@ Callstack::CallstackType LeafFunctionCallManager::PatchCallerOfLeafFunction(
   // of the current frame, and NOT the return address. Thus, unwinding will only report one frame
   // (the instruction pointer) and we know that the original callchain is already correct.
   if (libunwindstack_callstack.size() == 1) {
+    leaf_frames_.try_emplace(leaf_frame_key, LeafFrame{true, 0});
     return Callstack::kComplete;
   }
 
@@ -74,7 +95,46 @@ Callstack::CallstackType LeafFunctionCallManager::PatchCallerOfLeafFunction(
     return Callstack::kFramePointerUnwindingError;
   }
 
-  const std::vector<uint64_t> original_callchain = event->ips;
+  CHECK(libunwindstack_callstack.size() == 2);
+  // perf_event_open's callstack always contains the return address. Libunwindstack has already
+  // decreased the address by one. To not mix them, increase the address again.
+  const uint64_t return_address = libunwindstack_callstack[1].pc + 1;
+
+  // The return address is right below the stack pointer of the caller. Only remember where it is if
+  // it's actually there, as the stack slice is what later samples are patched from.
+  const uint64_t caller_sp = libunwindstack_callstack[1].sp;
+  if (caller_sp >= rsp + sizeof(uint64_t) && caller_sp - rsp <= readable_stack_size) {
+    const uint64_t return_address_offset = caller_sp - rsp - sizeof(uint64_t);
+    uint64_t return_address_in_stack;
+    std::memcpy(&return_address_in_stack, event->GetStackData() + return_address_offset,
+                sizeof(return_address_in_stack));
+    if (return_address_in_stack == return_address) {
+      leaf_frames_.try_emplace(leaf_frame_key, LeafFrame{false, return_address_offset});
+    }
+  }
+
+  return InsertCallerOfLeafFunction(event, current_maps, return_address);
+}
+
+void LeafFunctionCallManager::InvalidateLeafFrames(pid_t pid) {
+  for (auto it = leaf_frames_.begin(); it != leaf_frames_.end();) {
+    if (it->first.first == pid) {
+      leaf_frames_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+Callstack::CallstackType LeafFunctionCallManager::InsertCallerOfLeafFunction(
+    CallchainSamplePerfEvent* event, LibunwindstackMaps* current_maps, uint64_t return_address) {
+  // If the caller is not executable, we have an unwinding error.
+  unwindstack::MapInfo* map_info = current_maps->Find(return_address - 1);
+  if (map_info == nullptr || (map_info->flags & PROT_EXEC) == 0) {
+    return Callstack::kStackTopDwarfUnwindingError;
+  }
+
+  const std::vector<uint64_t>& original_callchain = event->ips;
   CHECK(original_callchain.size() > 2);
 
   std::vector<uint64_t> result;
@@ -82,22 +142,113 @@ Callstack::CallstackType LeafFunctionCallManager::PatchCallerOfLeafFunction(
   for (size_t i = 0; i < 2; ++i) {
     result.push_back(original_callchain[i]);
   }
+  result.push_back(return_address);
+  for (size_t i = 2; i < original_callchain.size(); ++i) {
+    result.push_back(original_callchain[i]);
+  }
 
-  CHECK(libunwindstack_callstack.size() == 2);
-  uint64_t libunwindstack_leaf_caller_pc = libunwindstack_callstack[1].pc;
+  event->ring_buffer_record.nr = result.size();
+  event->ips = std::move(result);
 
-  // If the caller is not executable, we have an unwinding error.
-  unwindstack::MapInfo* map_info = current_maps->Find(libunwindstack_leaf_caller_pc);
-  if (map_info == nullptr || (map_info->flags & PROT_EXEC) == 0) {
+  return Callstack::kComplete;
+}
+
+bool LeafFunctionCallManager::IsInModuleWithoutFramePointers(LibunwindstackMaps* current_maps,
+                                                             uint64_t address) const {
+  unwindstack::MapInfo* map_info = current_maps->Find(address);
+  return map_info != nullptr && modules_without_frame_pointers_.contains(map_info->name);
+}
+
+// The callchain from perf_event_open is only wrong after a non-leaf function that doesn't keep
+// frame pointers. If such a function leaves $rbp untouched, the callchain only misses its caller
+// and continues correctly from the caller of the caller. Libunwindstack, on the stack slice, can
+// compute the missing frames, as long as they are within the slice. We walk the callchain and,
+// for every frame in a module without frame pointers, take the subsequent frames from
+// libunwindstack until one of them is in the rest of the callchain, where we continue.
+// To compare the two, the addresses computed by libunwindstack (but the innermost) are increased
+// by one, to match the return addresses in perf_event_open's callchain.
+Callstack::CallstackType LeafFunctionCallManager::PatchCallersOfFramesInModulesWithoutFramePointers(
+    CallchainSamplePerfEvent* event, LibunwindstackMaps* current_maps,
+    LibunwindstackUnwinder* unwinder) {
+  CHECK(event != nullptr);
+  CHECK(current_maps != nullptr);
+  CHECK(unwinder != nullptr);
+  CHECK(event->GetCallchainSize() > 2);
+
+  if (modules_without_frame_pointers_.empty()) {
+    return Callstack::kComplete;
+  }
+
+  const std::vector<uint64_t>& original_callchain = event->ips;
+  // The first frame is in the kernel and the second is the leaf function, whose caller has already
+  // been patched, if needed.
+  bool goes_through_module_without_frame_pointers = false;
+  for (size_t i = 2; i < original_callchain.size(); ++i) {
+    if (IsInModuleWithoutFramePointers(current_maps, original_callchain[i])) {
+      goes_through_module_without_frame_pointers = true;
+      break;
+    }
+  }
+  if (!goes_through_module_without_frame_pointers) {
+    return Callstack::kComplete;
+  }
+
+  const LibunwindstackResult& libunwindstack_result =
+      unwinder->Unwind(event->GetPid(), current_maps->Get(), event->GetRegisters(),
+                       event->GetStackData(), event->GetStackSize(), true);
+  const std::vector<unwindstack::FrameData>& libunwindstack_callstack =
+      libunwindstack_result.frames();
+  if (libunwindstack_callstack.empty()) {
+    ERROR("Discarding sample as DWARF-based unwinding resulted in empty callstack (error: %s)",
+          LibunwindstackUnwinder::LibunwindstackErrorString(libunwindstack_result.error_code()));
     return Callstack::kStackTopDwarfUnwindingError;
   }
 
-  // perf_event_open's callstack always contains the return address. Libunwindstack has already
-  // decreased the address by one. To not mix them, increase the address again.
-  result.push_back(libunwindstack_leaf_caller_pc + 1);
+  std::vector<uint64_t> unwound_return_addresses;
+  unwound_return_addresses.reserve(libunwindstack_callstack.size());
+  unwound_return_addresses.push_back(libunwindstack_callstack[0].pc);
+  for (size_t i = 1; i < libunwindstack_callstack.size(); ++i) {
+    unwound_return_addresses.push_back(libunwindstack_callstack[i].pc + 1);
+  }
 
-  for (size_t i = 2; i < original_callchain.size(); ++i) {
-    result.push_back(original_callchain[i]);
+  std::vector<uint64_t> result;
+  result.reserve(original_callchain.size() + unwound_return_addresses.size());
+  result.push_back(original_callchain[0]);
+  result.push_back(original_callchain[1]);
+  auto unwound_it = unwound_return_addresses.begin();
+  size_t callchain_index = 2;
+  while (callchain_index < original_callchain.size()) {
+    const uint64_t return_address = original_callchain[callchain_index];
+    result.push_back(return_address);
+    if (!IsInModuleWithoutFramePointers(current_maps, return_address)) {
+      ++callchain_index;
+      continue;
+    }
+
+    unwound_it = std::find(unwound_it, unwound_return_addresses.end(), return_address);
+    if (unwound_it == unwound_return_addresses.end()) {
+      return Callstack::kStackTopForDwarfUnwindingTooSmall;
+    }
+
+    // Take the frames from libunwindstack until we find one that is also in the callchain.
+    auto resume_it = original_callchain.end();
+    for (++unwound_it; unwound_it != unwound_return_addresses.end(); ++unwound_it) {
+      resume_it = std::find(original_callchain.begin() + callchain_index + 1,
+                            original_callchain.end(), *unwound_it);
+      if (resume_it != original_callchain.end()) {
+        break;
+      }
+      // If the caller is not executable, we have an unwinding error.
+      unwindstack::MapInfo* map_info = current_maps->Find(*unwound_it - 1);
+      if (map_info == nullptr || (map_info->flags & PROT_EXEC) == 0) {
+        return Callstack::kStackTopDwarfUnwindingError;
+      }
+      result.push_back(*unwound_it);
+    }
+    if (resume_it == original_callchain.end()) {
+      return Callstack::kStackTopForDwarfUnwindingTooSmall;
+    }
+    callchain_index = resume_it - original_callchain.begin();
   }
 
   event->ring_buffer_record.nr = result.size();
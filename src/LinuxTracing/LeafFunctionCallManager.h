@@ -5,7 +5,14 @@
 #ifndef LINUX_TRACING_LEAF_FUNCTION_CALL_MANAGER_H_
 #define LINUX_TRACING_LEAF_FUNCTION_CALL_MANAGER_H_
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <capture.pb.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
 
 #include "LibunwindstackMaps.h"
 #include "LibunwindstackUnwinder.h"
@@ -16,9 +23,15 @@ namespace orbit_linux_tracing {
 // This class provides the `PatchCallerOfLeafFunction` method to fix a frame-pointer based
 // callchain, where the leaf function does not have frame-pointers. Note that this is wrapped in a
 // class to allow tests to mock this implementation.
+// It also provides `PatchCallersOfFramesInModulesWithoutFramePointers`, which uses the same stack
+// slice to fix the callchain where it goes through modules that are known to not have frame
+// pointers.
 class LeafFunctionCallManager {
  public:
-  explicit LeafFunctionCallManager(uint16_t stack_dump_size) : stack_dump_size_{stack_dump_size} {}
+  explicit LeafFunctionCallManager(
+      uint16_t stack_dump_size, absl::flat_hash_set<std::string> modules_without_frame_pointers = {})
+      : stack_dump_size_{stack_dump_size},
+        modules_without_frame_pointers_{std::move(modules_without_frame_pointers)} {}
   virtual ~LeafFunctionCallManager() = default;
 
   // Computes the actual caller of a leaf function (that may not have frame-pointers) based on
@@ -32,12 +45,51 @@ class LeafFunctionCallManager {
   // `kComplete` will be returned.
   // Note that the address of the caller address is computed by decreasing the return address by
   // one in libunwindstack, to match the format of perf_event_open.
+  // The outcome of unwinding only depends on the instruction pointer of the leaf function, so it is
+  // cached per process and instruction pointer: later samples at the same address are patched by
+  // reading the return address from the stack slice, without unwinding.
   virtual orbit_grpc_protos::Callstack::CallstackType PatchCallerOfLeafFunction(
       CallchainSamplePerfEvent* event, LibunwindstackMaps* current_maps,
       LibunwindstackUnwinder* unwinder);
 
+  // Drops what was cached by `PatchCallerOfLeafFunction` for the process, whose code might have
+  // changed. To be called when the maps of the process change.
+  void InvalidateLeafFrames(pid_t pid);
+
+  // Fixes the frames of the (already leaf-patched) callchain event that follow a non-leaf frame in
+  // one of `modules_without_frame_pointers`, by DWARF-unwinding the stack slice carried by the
+  // event. If the callchain doesn't go through such a module, or no such module was given, this
+  // function returns `kComplete` without unwinding.
+  // A function without frame pointers that preserves $rbp causes its caller to be missing from the
+  // callchain, as for leaf functions. The missing frames are taken from libunwindstack until it
+  // reaches a frame of the original callchain again. If that doesn't happen within the stack slice,
+  // e.g., because $rbp was used as a general purpose register and the rest of the callchain is
+  // garbage, the respective error is returned and the event remains untouched.
+  virtual orbit_grpc_protos::Callstack::CallstackType
+  PatchCallersOfFramesInModulesWithoutFramePointers(CallchainSamplePerfEvent* event,
+                                                    LibunwindstackMaps* current_maps,
+                                                    LibunwindstackUnwinder* unwinder);
+
  private:
+  // How a leaf function's frame looks like at one of its instructions.
+  struct LeafFrame {
+    // Whether $rbp points to the frame of the leaf function, in which case the callchain is
+    // already correct.
+    bool has_frame_pointer;
+    // Otherwise, the offset from $rsp of the return address to the caller.
+    uint64_t return_address_offset;
+  };
+
+  [[nodiscard]] orbit_grpc_protos::Callstack::CallstackType InsertCallerOfLeafFunction(
+      CallchainSamplePerfEvent* event, LibunwindstackMaps* current_maps, uint64_t return_address);
+
+  [[nodiscard]] bool IsInModuleWithoutFramePointers(LibunwindstackMaps* current_maps,
+                                                    uint64_t address) const;
+
   uint16_t stack_dump_size_;
+  absl::flat_hash_set<std::string> modules_without_frame_pointers_;
+  // Keyed by pid and instruction pointer of the leaf function.
+  absl::flat_hash_map<std::pair<pid_t, uint64_t>, LeafFrame> leaf_frames_;
 };
 
 }  //  namespace orbit_linux_tracing
@@ -6,6 +6,8 @@
 #include <gtest/gtest.h>
 #include <sys/mman.h>
 
+#include <cstring>
+
 #include "LeafFunctionCallManager.h"
 
 using ::testing::_;
@@ -27,7 +29,10 @@ class MockLibunwindstackMaps : public LibunwindstackMaps {
   MOCK_METHOD(unwindstack::MapInfo*, Find, (uint64_t), (override));
   MOCK_METHOD(unwindstack::Maps*, Get, (), (override));
   MOCK_METHOD(void, AddAndSort,
-              (uint64_t, uint64_t, uint64_t, uint64_t, const std::string&, uint64_t), (override));
+              (uint64_t, uint64_t, uint64_t, uint64_t, const std::string&, uint64_t,
+               const std::string&),
+              (override));
+  MOCK_METHOD(void, SetBuildIdOfFile, (const std::string&, const std::string&), (override));
 };
 
 class MockLibunwindstackUnwinder : public LibunwindstackUnwinder {
@@ -115,6 +120,25 @@ class LeafFunctionCallManagerTest : public ::testing::Test {
       .function_offset = 0,
       .map_name = kNonExecutableName,
   };
+
+  // A sample in a leaf function without frame pointers called by kTargetAddress3, whose return
+  // address to its caller is in the middle of the stack slice from $rsp to $rbp.
+  static CallchainSamplePerfEvent CreateLeafFunctionSample(uint64_t leaf_ip,
+                                                           uint64_t caller_return_address) {
+    constexpr uint64_t kRsp = 1000;
+    std::vector<uint64_t> callchain{kKernelAddress, leaf_ip, kTargetAddress3 + 1};
+    CallchainSamplePerfEvent event{callchain.size(), kStackDumpSize};
+    event.ring_buffer_record.sample_id.pid = 10;
+    event.ips = callchain;
+    event.regs.sp = kRsp;
+    event.regs.bp = kRsp + kStackDumpSize;
+    event.regs.ip = leaf_ip;
+    std::memcpy(event.GetStackData() + kReturnAddressOffset, &caller_return_address,
+                sizeof(caller_return_address));
+    return event;
+  }
+
+  static constexpr uint64_t kReturnAddressOffset = kStackDumpSize / 2;
 };
 
 }  // namespace
@@ -338,4 +362,164 @@ TEST_F(LeafFunctionCallManagerTest,
                                      kTargetAddress3 + 1));
   EXPECT_EQ(event.GetCallchainSize(), callchain.size() + 1);
 }
-}  // namespace orbit_linux_tracing
\ No newline at end of file
+
+TEST_F(LeafFunctionCallManagerTest, PatchCallerOfLeafFunctionReusesTheReturnAddressOffsetOfTheIp) {
+  constexpr uint64_t kFirstCallerReturnAddress = kTargetAddress2 + 1;
+  constexpr uint64_t kSecondCallerReturnAddress = kTargetAddress1 + 51;
+
+  CallchainSamplePerfEvent event =
+      CreateLeafFunctionSample(kTargetAddress1, kFirstCallerReturnAddress);
+  unwindstack::FrameData caller_frame = kFrame2;
+  caller_frame.sp = event.regs.sp + kReturnAddressOffset + sizeof(uint64_t);
+
+  EXPECT_CALL(maps_, Get).WillRepeatedly(Return(nullptr));
+  EXPECT_CALL(unwinder_, Unwind)
+      .Times(1)
+      .WillOnce(Return(LibunwindstackResult{{kFrame1, caller_frame},
+                                            unwindstack::ErrorCode::ERROR_INVALID_MAP}));
+  EXPECT_CALL(maps_, Find(_)).WillRepeatedly(Return(&kTargetMapInfo));
+
+  EXPECT_EQ(Callstack::kComplete,
+            leaf_function_call_manager_.PatchCallerOfLeafFunction(&event, &maps_, &unwinder_));
+  EXPECT_THAT(event.ips, ElementsAre(kKernelAddress, kTargetAddress1, kFirstCallerReturnAddress,
+                                     kTargetAddress3 + 1));
+
+  // The caller is read from the stack slice without unwinding again.
+  CallchainSamplePerfEvent other_event =
+      CreateLeafFunctionSample(kTargetAddress1, kSecondCallerReturnAddress);
+  EXPECT_EQ(Callstack::kComplete, leaf_function_call_manager_.PatchCallerOfLeafFunction(
+                                      &other_event, &maps_, &unwinder_));
+  EXPECT_THAT(other_event.ips, ElementsAre(kKernelAddress, kTargetAddress1,
+                                           kSecondCallerReturnAddress, kTargetAddress3 + 1));
+}
+
+TEST_F(LeafFunctionCallManagerTest, PatchCallerOfLeafFunctionUnwindsAgainAfterInvalidation) {
+  CallchainSamplePerfEvent event =
+      CreateLeafFunctionSample(kTargetAddress1, kTargetAddress2 + 1);
+
+  // The innermost function has frame pointers at this ip.
+  EXPECT_CALL(maps_, Get).WillRepeatedly(Return(nullptr));
+  EXPECT_CALL(unwinder_, Unwind)
+      .Times(2)
+      .WillRepeatedly(
+          Return(LibunwindstackResult{{kFrame1}, unwindstack::ErrorCode::ERROR_INVALID_MAP}));
+
+  EXPECT_EQ(Callstack::kComplete,
+            leaf_function_call_manager_.PatchCallerOfLeafFunction(&event, &maps_, &unwinder_));
+  EXPECT_EQ(Callstack::kComplete,
+            leaf_function_call_manager_.PatchCallerOfLeafFunction(&event, &maps_, &unwinder_));
+
+  leaf_function_call_manager_.InvalidateLeafFrames(event.GetPid());
+  EXPECT_EQ(Callstack::kComplete,
+            leaf_function_call_manager_.PatchCallerOfLeafFunction(&event, &maps_, &unwinder_));
+  EXPECT_EQ(event.GetCallchainSize(), 3);
+}
+
+namespace {
+
+class LeafFunctionCallManagerWithModulesWithoutFramePointersTest
+    : public LeafFunctionCallManagerTest {
+ protected:
+  void SetUp() override {
+    LeafFunctionCallManagerTest::SetUp();
+    EXPECT_CALL(maps_, Find(AllOf(Ge(kNoFramePointersMapsStart), Lt(kNoFramePointersMapsEnd))))
+        .WillRepeatedly(Return(&kNoFramePointersMapInfo));
+    EXPECT_CALL(maps_, Get).WillRepeatedly(Return(nullptr));
+  }
+
+  CallchainSamplePerfEvent CreateEvent(const std::vector<uint64_t>& callchain) {
+    CallchainSamplePerfEvent event{callchain.size(), kStackDumpSize};
+    event.ring_buffer_record.sample_id.pid = kPid;
+    event.ring_buffer_record.sample_id.tid = kPid;
+    event.ips = callchain;
+    return event;
+  }
+
+  static unwindstack::FrameData CreateFrame(uint64_t pc) {
+    return unwindstack::FrameData{.pc = pc, .function_name = "", .function_offset = 0};
+  }
+
+  static constexpr uint32_t kPid = 10;
+
+  static constexpr uint64_t kNoFramePointersMapsStart = 700;
+  static constexpr uint64_t kNoFramePointersMapsEnd = 800;
+
+  static inline const std::string kNoFramePointersName = "no_frame_pointers";
+
+  static inline unwindstack::MapInfo kNoFramePointersMapInfo{
+      nullptr, kNoFramePointersMapsStart, kNoFramePointersMapsEnd, 0, PROT_EXEC | PROT_READ,
+      kNoFramePointersName};
+
+  LeafFunctionCallManager hybrid_leaf_function_call_manager_{kStackDumpSize,
+                                                             {kNoFramePointersName}};
+};
+
+}  // namespace
+
+TEST_F(LeafFunctionCallManagerWithModulesWithoutFramePointersTest,
+       PatchCallersOfFramesInModulesWithoutFramePointersDoesNothingWithoutSuchModules) {
+  std::vector<uint64_t> callchain{kKernelAddress, 110, 711, 131};
+  CallchainSamplePerfEvent event = CreateEvent(callchain);
+
+  EXPECT_CALL(unwinder_, Unwind).Times(0);
+  EXPECT_EQ(Callstack::kComplete,
+            leaf_function_call_manager_.PatchCallersOfFramesInModulesWithoutFramePointers(
+                &event, &maps_, &unwinder_));
+  EXPECT_THAT(event.ips, ElementsAreArray(callchain));
+}
+
+TEST_F(LeafFunctionCallManagerWithModulesWithoutFramePointersTest,
+       PatchCallersOfFramesInModulesWithoutFramePointersDoesNotUnwindOtherCallchains) {
+  // Only the leaf function is in the module without frame pointers, which is already handled by
+  // PatchCallerOfLeafFunction.
+  std::vector<uint64_t> callchain{kKernelAddress, 710, 121, 131};
+  CallchainSamplePerfEvent event = CreateEvent(callchain);
+
+  EXPECT_CALL(unwinder_, Unwind).Times(0);
+  EXPECT_EQ(Callstack::kComplete,
+            hybrid_leaf_function_call_manager_.PatchCallersOfFramesInModulesWithoutFramePointers(
+                &event, &maps_, &unwinder_));
+  EXPECT_THAT(event.ips, ElementsAreArray(callchain));
+}
+
+TEST_F(LeafFunctionCallManagerWithModulesWithoutFramePointersTest,
+       PatchCallersOfFramesInModulesWithoutFramePointersPatchesMissingCallers) {
+  // The caller of the function at 711 (the frame at 121) is missing, twice.
+  std::vector<uint64_t> callchain{kKernelAddress, 110, 711, 131, 721, 151, 161};
+  CallchainSamplePerfEvent event = CreateEvent(callchain);
+
+  std::vector<unwindstack::FrameData> libunwindstack_callstack{
+      CreateFrame(110), CreateFrame(710), CreateFrame(120), CreateFrame(130),
+      CreateFrame(720), CreateFrame(140), CreateFrame(150)};
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, _, _, _))
+      .Times(1)
+      .WillOnce(Return(LibunwindstackResult{libunwindstack_callstack,
+                                            unwindstack::ErrorCode::ERROR_MEMORY_INVALID}));
+
+  EXPECT_EQ(Callstack::kComplete,
+            hybrid_leaf_function_call_manager_.PatchCallersOfFramesInModulesWithoutFramePointers(
+                &event, &maps_, &unwinder_));
+  EXPECT_THAT(event.ips, ElementsAre(kKernelAddress, 110, 711, 121, 131, 721, 141, 151, 161));
+  EXPECT_EQ(event.GetCallchainSize(), 9);
+}
+
+TEST_F(LeafFunctionCallManagerWithModulesWithoutFramePointersTest,
+       PatchCallersOfFramesInModulesWithoutFramePointersReturnsErrorOnSmallStackSlice) {
+  std::vector<uint64_t> callchain{kKernelAddress, 110, 711, 131, 141};
+  CallchainSamplePerfEvent event = CreateEvent(callchain);
+
+  // Libunwindstack doesn't get back to the callchain within the stack slice.
+  std::vector<unwindstack::FrameData> libunwindstack_callstack{CreateFrame(110), CreateFrame(710),
+                                                               CreateFrame(120)};
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, _, _, _))
+      .Times(1)
+      .WillOnce(Return(LibunwindstackResult{libunwindstack_callstack,
+                                            unwindstack::ErrorCode::ERROR_MEMORY_INVALID}));
+
+  EXPECT_EQ(Callstack::kStackTopForDwarfUnwindingTooSmall,
+            hybrid_leaf_function_call_manager_.PatchCallersOfFramesInModulesWithoutFramePointers(
+                &event, &maps_, &unwinder_));
+  EXPECT_THAT(event.ips, ElementsAreArray(callchain));
+}
+
+}  // namespace orbit_linux_tracing
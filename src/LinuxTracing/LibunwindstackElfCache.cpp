@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "LibunwindstackElfCache.h"
+
+#include <filesystem>
+#include <system_error>
+
+namespace orbit_linux_tracing {
+
+namespace {
+uint64_t EstimateElfSizeBytes(const unwindstack::MapInfo& map_info) {
+  std::error_code error;
+  uintmax_t file_size = std::filesystem::file_size(map_info.name, error);
+  if (error) {
+    return map_info.end - map_info.start;
+  }
+  return file_size;
+}
+}  // namespace
+
+void LibunwindstackElfCache::Add(const std::string& build_id,
+                                 const unwindstack::MapInfo& map_info) {
+  if (build_id.empty() || map_info.elf == nullptr) {
+    return;
+  }
+
+  absl::MutexLock lock{&mutex_};
+  auto [it, inserted] = files_.try_emplace(build_id);
+  File& file = it->second;
+  if (inserted) {
+    file.size_bytes = EstimateElfSizeBytes(map_info);
+    lru_build_ids_.push_front(build_id);
+    file.lru_position = lru_build_ids_.begin();
+    stats_.size_bytes += file.size_bytes;
+    ++stats_.file_count;
+  } else {
+    lru_build_ids_.splice(lru_build_ids_.begin(), lru_build_ids_, file.lru_position);
+  }
+
+  // As in Elf::CacheAdd, also cache the Elf for the whole file when it starts at the beginning of
+  // the file, so that other maps of the same file can use it.
+  if (map_info.offset == 0 || map_info.elf_offset != 0) {
+    file.entries_by_offset.insert_or_assign(0, Entry{map_info.elf, true});
+  }
+  if (map_info.offset != 0) {
+    file.entries_by_offset.insert_or_assign(map_info.offset,
+                                            Entry{map_info.elf, map_info.elf_offset != 0});
+  }
+
+  EvictLeastRecentlyUsedFiles();
+}
+
+bool LibunwindstackElfCache::Get(const std::string& build_id, unwindstack::MapInfo* map_info) {
+  if (build_id.empty()) {
+    return false;
+  }
+
+  absl::MutexLock lock{&mutex_};
+  auto file_it = files_.find(build_id);
+  if (file_it == files_.end()) {
+    ++stats_.miss_count;
+    return false;
+  }
+  File& file = file_it->second;
+  auto entry_it = file.entries_by_offset.find(map_info->offset);
+  if (entry_it == file.entries_by_offset.end()) {
+    ++stats_.miss_count;
+    return false;
+  }
+
+  map_info->elf = entry_it->second.elf;
+  if (entry_it->second.set_elf_offset_to_offset) {
+    map_info->elf_offset = map_info->offset;
+  }
+  lru_build_ids_.splice(lru_build_ids_.begin(), lru_build_ids_, file.lru_position);
+  ++stats_.hit_count;
+  return true;
+}
+
+void LibunwindstackElfCache::EvictLeastRecentlyUsedFiles() {
+  while (stats_.size_bytes > max_size_bytes_ && !lru_build_ids_.empty()) {
+    auto file_it = files_.find(lru_build_ids_.back());
+    stats_.size_bytes -= file_it->second.size_bytes;
+    --stats_.file_count;
+    ++stats_.eviction_count;
+    files_.erase(file_it);
+    lru_build_ids_.pop_back();
+  }
+}
+
+LibunwindstackElfCache::Stats LibunwindstackElfCache::GetStats() const {
+  absl::MutexLock lock{&mutex_};
+  return stats_;
+}
+
+LibunwindstackElfCache& LibunwindstackElfCache::GetProcessWideCache() {
+  // Large enough for the main binaries and libraries of a few games.
+  static constexpr uint64_t kMaxSizeBytes = 4ul * 1024 * 1024 * 1024;
+  static LibunwindstackElfCache* cache = new LibunwindstackElfCache{kMaxSizeBytes};
+  return *cache;
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,80 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_LIBUNWINDSTACK_ELF_CACHE_H_
+#define LINUX_TRACING_LIBUNWINDSTACK_ELF_CACHE_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <unwindstack/Elf.h>
+#include <unwindstack/MapInfo.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+
+namespace orbit_linux_tracing {
+
+// LibunwindstackElfCache keeps the unwindstack::Elfs that libunwindstack created for the maps of
+// the target, keyed by build ID and file offset, so that later maps of the same file, including in
+// later captures, can reuse them. Creating an unwindstack::Elf means reading and parsing the file
+// and, on the first unwinding, indexing its .eh_frame and .debug_frame, which is expensive for
+// large binaries.
+// This follows libunwindstack's own Elf::CacheAdd and Elf::CacheGet, which are however keyed by
+// file name and can't detect that a file has been replaced.
+// The size of a file is used as an estimate of the memory used by its unwindstack::Elfs. When the
+// total estimated size exceeds max_size_bytes, the least recently used files are evicted.
+class LibunwindstackElfCache {
+ public:
+  explicit LibunwindstackElfCache(uint64_t max_size_bytes) : max_size_bytes_{max_size_bytes} {}
+
+  // Adds the unwindstack::Elf of map_info, if it has been created. Whether the Elf is worth
+  // caching, e.g., whether it's valid, is up to the caller.
+  void Add(const std::string& build_id, const unwindstack::MapInfo& map_info);
+  // If an unwindstack::Elf for build_id and the offset of map_info is cached, assigns it to
+  // map_info and returns true.
+  bool Get(const std::string& build_id, unwindstack::MapInfo* map_info);
+
+  struct Stats {
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t eviction_count = 0;
+    uint64_t file_count = 0;
+    uint64_t size_bytes = 0;
+  };
+  [[nodiscard]] Stats GetStats() const;
+
+  // The cache shared by all captures of this process. It's never destroyed.
+  [[nodiscard]] static LibunwindstackElfCache& GetProcessWideCache();
+
+ private:
+  struct Entry {
+    std::shared_ptr<unwindstack::Elf> elf;
+    // Corresponds to the second element of the pairs in libunwindstack's Elf cache.
+    bool set_elf_offset_to_offset;
+  };
+
+  // All the entries for the file with a given build ID.
+  struct File {
+    // An offset of zero also identifies the Elf that spans the whole file.
+    absl::flat_hash_map<uint64_t, Entry> entries_by_offset;
+    uint64_t size_bytes;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  void EvictLeastRecentlyUsedFiles() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const uint64_t max_size_bytes_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, File> files_ ABSL_GUARDED_BY(mutex_);
+  // Build IDs from the most to the least recently used.
+  std::list<std::string> lru_build_ids_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_LIBUNWINDSTACK_ELF_CACHE_H_
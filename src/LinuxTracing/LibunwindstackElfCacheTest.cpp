@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unwindstack/Elf.h>
+#include <unwindstack/MapInfo.h>
+
+#include <memory>
+#include <string>
+
+#include "LibunwindstackElfCache.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// The files don't exist, so the estimated size of each Elf is the size of its map.
+constexpr uint64_t kMapSize = 0x1000;
+
+std::unique_ptr<unwindstack::MapInfo> CreateMapInfo(uint64_t start, uint64_t offset,
+                                                    const std::string& name) {
+  return std::make_unique<unwindstack::MapInfo>(nullptr, nullptr, start, start + kMapSize, offset,
+                                                PROT_READ | PROT_EXEC, name);
+}
+
+std::unique_ptr<unwindstack::MapInfo> CreateMapInfoWithElf(uint64_t start, uint64_t offset,
+                                                           const std::string& name) {
+  std::unique_ptr<unwindstack::MapInfo> map_info = CreateMapInfo(start, offset, name);
+  map_info->elf = std::make_shared<unwindstack::Elf>(nullptr);
+  return map_info;
+}
+
+}  // namespace
+
+TEST(LibunwindstackElfCache, CachedElfIsReusedForTheSameBuildIdAndOffset) {
+  LibunwindstackElfCache cache{16 * kMapSize};
+
+  std::unique_ptr<unwindstack::MapInfo> map_info = CreateMapInfoWithElf(0x1000, 0, "/not/a/file");
+  cache.Add("abcd", *map_info);
+  EXPECT_EQ(cache.GetStats().file_count, 1);
+  EXPECT_EQ(cache.GetStats().size_bytes, kMapSize);
+
+  // The file name doesn't matter, only the build ID does.
+  std::unique_ptr<unwindstack::MapInfo> same_file = CreateMapInfo(0x5000, 0, "/other/name");
+  EXPECT_TRUE(cache.Get("abcd", same_file.get()));
+  EXPECT_EQ(same_file->elf, map_info->elf);
+
+  std::unique_ptr<unwindstack::MapInfo> other_build_id = CreateMapInfo(0x5000, 0, "/not/a/file");
+  EXPECT_FALSE(cache.Get("ef01", other_build_id.get()));
+  EXPECT_EQ(other_build_id->elf, nullptr);
+
+  std::unique_ptr<unwindstack::MapInfo> other_offset = CreateMapInfo(0x5000, 0x2000, "/other");
+  EXPECT_FALSE(cache.Get("abcd", other_offset.get()));
+
+  EXPECT_EQ(cache.GetStats().hit_count, 1);
+  EXPECT_EQ(cache.GetStats().miss_count, 2);
+}
+
+TEST(LibunwindstackElfCache, ElfOfMapWithElfOffsetIsAlsoCachedForTheWholeFile) {
+  LibunwindstackElfCache cache{16 * kMapSize};
+
+  std::unique_ptr<unwindstack::MapInfo> map_info =
+      CreateMapInfoWithElf(0x1000, 0x3000, "/not/a/file");
+  map_info->elf_offset = 0x3000;
+  cache.Add("abcd", *map_info);
+
+  std::unique_ptr<unwindstack::MapInfo> same_offset = CreateMapInfo(0x8000, 0x3000, "/not/a/file");
+  ASSERT_TRUE(cache.Get("abcd", same_offset.get()));
+  EXPECT_EQ(same_offset->elf, map_info->elf);
+  EXPECT_EQ(same_offset->elf_offset, 0x3000);
+
+  std::unique_ptr<unwindstack::MapInfo> whole_file = CreateMapInfo(0x8000, 0, "/not/a/file");
+  ASSERT_TRUE(cache.Get("abcd", whole_file.get()));
+  EXPECT_EQ(whole_file->elf, map_info->elf);
+  EXPECT_EQ(whole_file->elf_offset, 0);
+  EXPECT_EQ(cache.GetStats().file_count, 1);
+}
+
+TEST(LibunwindstackElfCache, MapsWithoutElfOrBuildIdAreNotCached) {
+  LibunwindstackElfCache cache{16 * kMapSize};
+  cache.Add("abcd", *CreateMapInfo(0x1000, 0, "/not/a/file"));
+  cache.Add("", *CreateMapInfoWithElf(0x1000, 0, "/not/a/file"));
+  EXPECT_EQ(cache.GetStats().file_count, 0);
+  EXPECT_EQ(cache.GetStats().size_bytes, 0);
+}
+
+TEST(LibunwindstackElfCache, LeastRecentlyUsedFilesAreEvicted) {
+  LibunwindstackElfCache cache{2 * kMapSize};
+
+  cache.Add("first", *CreateMapInfoWithElf(0x1000, 0, "/not/a/file"));
+  cache.Add("second", *CreateMapInfoWithElf(0x2000, 0, "/not/a/file"));
+  // Using "first" makes "second" the least recently used file.
+  std::unique_ptr<unwindstack::MapInfo> map_info = CreateMapInfo(0x5000, 0, "/not/a/file");
+  ASSERT_TRUE(cache.Get("first", map_info.get()));
+
+  cache.Add("third", *CreateMapInfoWithElf(0x3000, 0, "/not/a/file"));
+
+  LibunwindstackElfCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.eviction_count, 1);
+  EXPECT_EQ(stats.file_count, 2);
+  EXPECT_EQ(stats.size_bytes, 2 * kMapSize);
+  EXPECT_TRUE(cache.Get("first", CreateMapInfo(0x5000, 0, "/not/a/file").get()));
+  EXPECT_FALSE(cache.Get("second", CreateMapInfo(0x5000, 0, "/not/a/file").get()));
+  EXPECT_TRUE(cache.Get("third", CreateMapInfo(0x5000, 0, "/not/a/file").get()));
+}
+
+}  // namespace orbit_linux_tracing
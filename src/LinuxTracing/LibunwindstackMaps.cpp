@@ -4,36 +4,199 @@
 
 #include "LibunwindstackMaps.h"
 
+#include <absl/container/flat_hash_map.h>
+
+#include <algorithm>
+#include <vector>
+
 namespace orbit_linux_tracing {
 
 namespace {
 
+// unwindstack::BufferMaps that gives access to its sorted vector of maps, so that maps can be
+// inserted and removed in place instead of adding them at the end and calling Sort.
+class IncrementalBufferMaps : public unwindstack::BufferMaps {
+ public:
+  explicit IncrementalBufferMaps(const char* buffer) : unwindstack::BufferMaps{buffer} {}
+
+  std::vector<std::unique_ptr<unwindstack::MapInfo>>& GetMapInfos() { return maps_; }
+
+  // Sets prev_map and prev_real_map of the maps from index begin in the same way as Maps::Sort,
+  // stopping as soon as the following maps are known to be already linked correctly, that is, after
+  // the first map that is not blank from index end.
+  void UpdateLinks(size_t begin, size_t end) {
+    unwindstack::MapInfo* prev_map = (begin == 0) ? nullptr : maps_[begin - 1].get();
+    unwindstack::MapInfo* prev_real_map = nullptr;
+    if (prev_map != nullptr) {
+      prev_real_map = prev_map->IsBlank() ? prev_map->prev_real_map : prev_map;
+    }
+    for (size_t index = begin; index < maps_.size(); ++index) {
+      unwindstack::MapInfo* map_info = maps_[index].get();
+      map_info->prev_map = prev_map;
+      map_info->prev_real_map = prev_real_map;
+      prev_map = map_info;
+      if (!map_info->IsBlank()) {
+        prev_real_map = map_info;
+        if (index >= end) {
+          break;
+        }
+      }
+    }
+  }
+};
+
 class LibunwindstackMapsImpl : public LibunwindstackMaps {
  public:
-  explicit LibunwindstackMapsImpl(std::unique_ptr<unwindstack::BufferMaps> maps)
-      : maps_{std::move(maps)} {}
+  explicit LibunwindstackMapsImpl(std::unique_ptr<IncrementalBufferMaps> maps,
+                                  LibunwindstackElfCache* elf_cache)
+      : maps_{std::move(maps)}, elf_cache_{elf_cache} {}
+
+  ~LibunwindstackMapsImpl() override {
+    for (const std::unique_ptr<unwindstack::MapInfo>& map_info : maps_->GetMapInfos()) {
+      AddElfToCache(*map_info);
+    }
+  }
+
+  LibunwindstackMapsImpl(const LibunwindstackMapsImpl&) = delete;
+  LibunwindstackMapsImpl& operator=(const LibunwindstackMapsImpl&) = delete;
+  LibunwindstackMapsImpl(LibunwindstackMapsImpl&&) = delete;
+  LibunwindstackMapsImpl& operator=(LibunwindstackMapsImpl&&) = delete;
 
   unwindstack::MapInfo* Find(uint64_t pc) override { return maps_->Find(pc); }
 
   unwindstack::Maps* Get() override { return maps_.get(); }
 
   void AddAndSort(uint64_t start, uint64_t end, uint64_t offset, uint64_t flags,
-                  const std::string& name, uint64_t load_bias) override {
-    maps_->Add(start, end, offset, flags, name, load_bias);
-    maps_->Sort();
-  }
+                  const std::string& name, uint64_t load_bias,
+                  const std::string& build_id) override;
+
+  void SetBuildIdOfFile(const std::string& name, const std::string& build_id) override;
 
  private:
-  std::unique_ptr<unwindstack::BufferMaps> maps_;
+  std::unique_ptr<unwindstack::MapInfo> CreateMapInfo(uint64_t start, uint64_t end,
+                                                      uint64_t offset, uint64_t flags,
+                                                      const std::string& name, uint64_t load_bias,
+                                                      const std::string& build_id);
+  void AddElfToCache(const unwindstack::MapInfo& map_info);
+
+  std::unique_ptr<IncrementalBufferMaps> maps_;
+  LibunwindstackElfCache* elf_cache_;
+  absl::flat_hash_map<const unwindstack::MapInfo*, std::string> build_ids_;
 };
+
+void LibunwindstackMapsImpl::AddAndSort(uint64_t start, uint64_t end, uint64_t offset,
+                                        uint64_t flags, const std::string& name,
+                                        uint64_t load_bias, const std::string& build_id) {
+  std::vector<std::unique_ptr<unwindstack::MapInfo>>& map_infos = maps_->GetMapInfos();
+
+  // The maps are sorted and don't overlap, so their ends are also sorted. Find the range of maps
+  // that overlap [start, end).
+  auto first_overlapping = std::upper_bound(
+      map_infos.begin(), map_infos.end(), start,
+      [](uint64_t address, const std::unique_ptr<unwindstack::MapInfo>& map_info) {
+        return address < map_info->end;
+      });
+  auto last_overlapping = first_overlapping;
+  while (last_overlapping != map_infos.end() && (*last_overlapping)->start < end) {
+    ++last_overlapping;
+  }
+
+  // The same map was already known, e.g., from /proc/<pid>/maps: keep it, together with the Elf
+  // that might have already been loaded for it.
+  if (last_overlapping - first_overlapping == 1) {
+    unwindstack::MapInfo& existing = **first_overlapping;
+    if (existing.start == start && existing.end == end && existing.offset == offset &&
+        existing.name == name) {
+      if (!build_id.empty()) {
+        build_ids_.insert_or_assign(&existing, build_id);
+      }
+      return;
+    }
+  }
+
+  // Like mmap, the new map replaces the overlapped parts of existing maps.
+  std::vector<std::unique_ptr<unwindstack::MapInfo>> replacements;
+  if (first_overlapping != last_overlapping && (*first_overlapping)->start < start) {
+    const unwindstack::MapInfo& overlapped = **first_overlapping;
+    auto it = build_ids_.find(&overlapped);
+    replacements.emplace_back(CreateMapInfo(overlapped.start, start, overlapped.offset,
+                                            overlapped.flags, overlapped.name,
+                                            overlapped.load_bias,
+                                            it != build_ids_.end() ? it->second : ""));
+  }
+  replacements.emplace_back(CreateMapInfo(start, end, offset, flags, name, load_bias, build_id));
+  if (first_overlapping != last_overlapping && (*(last_overlapping - 1))->end > end) {
+    const unwindstack::MapInfo& overlapped = **(last_overlapping - 1);
+    auto it = build_ids_.find(&overlapped);
+    replacements.emplace_back(CreateMapInfo(
+        end, overlapped.end, overlapped.offset + (end - overlapped.start), overlapped.flags,
+        overlapped.name, overlapped.load_bias, it != build_ids_.end() ? it->second : ""));
+  }
+
+  for (auto it = first_overlapping; it != last_overlapping; ++it) {
+    AddElfToCache(**it);
+    build_ids_.erase(it->get());
+  }
+  const size_t begin_index = first_overlapping - map_infos.begin();
+  map_infos.erase(first_overlapping, last_overlapping);
+  map_infos.insert(map_infos.begin() + begin_index, std::make_move_iterator(replacements.begin()),
+                   std::make_move_iterator(replacements.end()));
+  maps_->UpdateLinks(begin_index, begin_index + replacements.size());
+}
+
+void LibunwindstackMapsImpl::SetBuildIdOfFile(const std::string& name,
+                                              const std::string& build_id) {
+  if (build_id.empty()) {
+    return;
+  }
+  for (const std::unique_ptr<unwindstack::MapInfo>& map_info : maps_->GetMapInfos()) {
+    if (map_info->name != name) {
+      continue;
+    }
+    build_ids_.insert_or_assign(map_info.get(), build_id);
+    if (elf_cache_ != nullptr && map_info->elf == nullptr) {
+      elf_cache_->Get(build_id, map_info.get());
+    }
+  }
+}
+
+std::unique_ptr<unwindstack::MapInfo> LibunwindstackMapsImpl::CreateMapInfo(
+    uint64_t start, uint64_t end, uint64_t offset, uint64_t flags, const std::string& name,
+    uint64_t load_bias, const std::string& build_id) {
+  // The links to the previous maps are set by IncrementalBufferMaps::UpdateLinks.
+  auto map_info = std::make_unique<unwindstack::MapInfo>(nullptr, nullptr, start, end, offset,
+                                                         flags, name);
+  map_info->load_bias = load_bias;
+  if (!build_id.empty()) {
+    build_ids_.emplace(map_info.get(), build_id);
+    if (elf_cache_ != nullptr) {
+      elf_cache_->Get(build_id, map_info.get());
+    }
+  }
+  return map_info;
+}
+
+void LibunwindstackMapsImpl::AddElfToCache(const unwindstack::MapInfo& map_info) {
+  // Elfs read from the memory of the target instead of from the file are only valid for this
+  // process, and invalid Elfs are cheap to recreate.
+  if (elf_cache_ == nullptr || map_info.elf == nullptr || !map_info.elf->valid() ||
+      map_info.memory_backed_elf) {
+    return;
+  }
+  if (auto it = build_ids_.find(&map_info); it != build_ids_.end()) {
+    elf_cache_->Add(it->second, map_info);
+  }
+}
+
 }  // namespace
 
-std::unique_ptr<LibunwindstackMaps> LibunwindstackMaps::ParseMaps(const std::string& maps_buffer) {
-  auto maps = std::make_unique<unwindstack::BufferMaps>(maps_buffer.c_str());
+std::unique_ptr<LibunwindstackMaps> LibunwindstackMaps::ParseMaps(
+    const std::string& maps_buffer, LibunwindstackElfCache* elf_cache) {
+  auto maps = std::make_unique<IncrementalBufferMaps>(maps_buffer.c_str());
   if (!maps->Parse()) {
     return nullptr;
   }
-  return std::make_unique<LibunwindstackMapsImpl>(std::move(maps));
+  return std::make_unique<LibunwindstackMapsImpl>(std::move(maps), elf_cache);
 }
 
-}  // namespace orbit_linux_tracing
\ No newline at end of file
+}  // namespace orbit_linux_tracing
@@ -8,6 +8,11 @@
 #include <unwindstack/MapInfo.h>
 #include <unwindstack/Maps.h>
 
+#include <memory>
+#include <string>
+
+#include "LibunwindstackElfCache.h"
+
 namespace orbit_linux_tracing {
 
 class LibunwindstackMaps {
@@ -16,10 +21,21 @@ class LibunwindstackMaps {
 
   virtual unwindstack::MapInfo* Find(uint64_t pc) = 0;
   virtual unwindstack::Maps* Get() = 0;
+  // Adds a map while keeping the maps sorted, without sorting them again. Like a new mmap does,
+  // the new map replaces the parts of existing maps that it overlaps. If build_id is not empty and
+  // elf_cache contains the ELF file with that build ID, the map reuses it instead of reading and
+  // parsing the file again.
   virtual void AddAndSort(uint64_t start, uint64_t end, uint64_t offset, uint64_t flags,
-                          const std::string& name, uint64_t load_bias) = 0;
-
-  static std::unique_ptr<LibunwindstackMaps> ParseMaps(const std::string& maps_buffer);
+                          const std::string& name, uint64_t load_bias,
+                          const std::string& build_id) = 0;
+  // Associates build_id to all the maps of the file name, see AddAndSort.
+  virtual void SetBuildIdOfFile(const std::string& name, const std::string& build_id) = 0;
+
+  // When the maps are removed or destroyed, the ELF files that were loaded for them and whose build
+  // ID is known are added to elf_cache, if not nullptr, so that later maps and later captures can
+  // reuse them.
+  static std::unique_ptr<LibunwindstackMaps> ParseMaps(const std::string& maps_buffer,
+                                                       LibunwindstackElfCache* elf_cache = nullptr);
 };
 
 }  // namespace orbit_linux_tracing
@@ -0,0 +1,131 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+
+#include <memory>
+#include <string>
+
+#include "LibunwindstackElfCache.h"
+#include "LibunwindstackMaps.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+const std::string kMapsBuffer =
+    "1000-2000 r--p 00000000 00:00 0 /path/to/file\n"
+    "2000-4000 r-xp 00001000 00:00 0 /path/to/file\n"
+    "4000-5000 ---p 00000000 00:00 0 \n"
+    "6000-9000 r-xp 00000000 00:00 0 /path/to/other\n";
+
+void ExpectMapsAreSortedAndLinked(unwindstack::Maps* maps) {
+  unwindstack::MapInfo* prev_map = nullptr;
+  unwindstack::MapInfo* prev_real_map = nullptr;
+  for (size_t index = 0; index < maps->Total(); ++index) {
+    unwindstack::MapInfo* map_info = maps->Get(index);
+    if (prev_map != nullptr) {
+      EXPECT_LE(prev_map->end, map_info->start);
+    }
+    EXPECT_EQ(map_info->prev_map, prev_map);
+    EXPECT_EQ(map_info->prev_real_map, prev_real_map);
+    prev_map = map_info;
+    if (!map_info->IsBlank()) {
+      prev_real_map = map_info;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(LibunwindstackMaps, AddAndSortInsertsNonOverlappingMapAtSortedPosition) {
+  std::unique_ptr<LibunwindstackMaps> maps = LibunwindstackMaps::ParseMaps(kMapsBuffer);
+  ASSERT_NE(maps, nullptr);
+  ASSERT_EQ(maps->Get()->Total(), 4);
+
+  maps->AddAndSort(0x5000, 0x6000, 0, PROT_READ | PROT_EXEC, "/path/to/new", 0, "");
+
+  ASSERT_EQ(maps->Get()->Total(), 5);
+  ExpectMapsAreSortedAndLinked(maps->Get());
+  unwindstack::MapInfo* map_info = maps->Find(0x5800);
+  ASSERT_NE(map_info, nullptr);
+  EXPECT_EQ(map_info->name, "/path/to/new");
+  EXPECT_EQ(maps->Find(0x5000)->start, 0x5000);
+  EXPECT_EQ(maps->Find(0x6000)->name, "/path/to/other");
+}
+
+TEST(LibunwindstackMaps, AddAndSortSplitsOverlappedMap) {
+  std::unique_ptr<LibunwindstackMaps> maps = LibunwindstackMaps::ParseMaps(kMapsBuffer);
+  ASSERT_NE(maps, nullptr);
+
+  maps->AddAndSort(0x7000, 0x8000, 0x3000, PROT_READ | PROT_EXEC, "/path/to/new", 0, "");
+
+  ASSERT_EQ(maps->Get()->Total(), 6);
+  ExpectMapsAreSortedAndLinked(maps->Get());
+
+  unwindstack::MapInfo* left = maps->Find(0x6000);
+  ASSERT_NE(left, nullptr);
+  EXPECT_EQ(left->start, 0x6000);
+  EXPECT_EQ(left->end, 0x7000);
+  EXPECT_EQ(left->offset, 0);
+  EXPECT_EQ(left->name, "/path/to/other");
+
+  unwindstack::MapInfo* middle = maps->Find(0x7000);
+  ASSERT_NE(middle, nullptr);
+  EXPECT_EQ(middle->end, 0x8000);
+  EXPECT_EQ(middle->offset, 0x3000);
+  EXPECT_EQ(middle->name, "/path/to/new");
+
+  unwindstack::MapInfo* right = maps->Find(0x8fff);
+  ASSERT_NE(right, nullptr);
+  EXPECT_EQ(right->start, 0x8000);
+  EXPECT_EQ(right->end, 0x9000);
+  EXPECT_EQ(right->offset, 0x2000);
+  EXPECT_EQ(right->name, "/path/to/other");
+}
+
+TEST(LibunwindstackMaps, AddAndSortReplacesAllOverlappedMaps) {
+  std::unique_ptr<LibunwindstackMaps> maps = LibunwindstackMaps::ParseMaps(kMapsBuffer);
+  ASSERT_NE(maps, nullptr);
+
+  maps->AddAndSort(0x1800, 0x6800, 0, PROT_READ | PROT_EXEC, "/path/to/new", 0, "");
+
+  ASSERT_EQ(maps->Get()->Total(), 3);
+  ExpectMapsAreSortedAndLinked(maps->Get());
+  EXPECT_EQ(maps->Find(0x1000)->end, 0x1800);
+  EXPECT_EQ(maps->Find(0x3000)->name, "/path/to/new");
+  EXPECT_EQ(maps->Find(0x4800)->name, "/path/to/new");
+  unwindstack::MapInfo* right = maps->Find(0x6800);
+  ASSERT_NE(right, nullptr);
+  EXPECT_EQ(right->start, 0x6800);
+  EXPECT_EQ(right->offset, 0x800);
+  EXPECT_EQ(right->name, "/path/to/other");
+}
+
+TEST(LibunwindstackMaps, AddAndSortKeepsIdenticalMap) {
+  std::unique_ptr<LibunwindstackMaps> maps = LibunwindstackMaps::ParseMaps(kMapsBuffer);
+  ASSERT_NE(maps, nullptr);
+  unwindstack::MapInfo* existing = maps->Find(0x2000);
+
+  maps->AddAndSort(0x2000, 0x4000, 0x1000, PROT_READ | PROT_EXEC, "/path/to/file", 0, "abcd");
+
+  ASSERT_EQ(maps->Get()->Total(), 4);
+  EXPECT_EQ(maps->Find(0x2000), existing);
+  ExpectMapsAreSortedAndLinked(maps->Get());
+}
+
+TEST(LibunwindstackMaps, MapsWithoutLoadedElfAreNotCached) {
+  LibunwindstackElfCache elf_cache{/*max_size_bytes=*/1024 * 1024};
+  {
+    std::unique_ptr<LibunwindstackMaps> maps =
+        LibunwindstackMaps::ParseMaps(kMapsBuffer, &elf_cache);
+    ASSERT_NE(maps, nullptr);
+    maps->SetBuildIdOfFile("/path/to/file", "abcd");
+    maps->AddAndSort(0x1000, 0x3000, 0, PROT_READ | PROT_EXEC, "/path/to/new", 0, "ef01");
+  }
+  EXPECT_EQ(elf_cache.GetStats().file_count, 0);
+}
+
+}  // namespace orbit_linux_tracing
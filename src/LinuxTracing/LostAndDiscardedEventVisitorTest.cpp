@@ -39,6 +39,15 @@ class MockTracerListener : public TracerListener {
   MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
   MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
               (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent, (orbit_grpc_protos::SamplingPeriodChangedEvent),
+              (override));
+  MOCK_METHOD(void, OnPmuCountersSample, (orbit_grpc_protos::PmuCountersSample), (override));
+  MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
+  MOCK_METHOD(void, OnServiceHealthEvent, (orbit_grpc_protos::ServiceHealthEvent), (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe, (orbit_grpc_protos::PipelineLatencyProbe),
+              (override));
+  MOCK_METHOD(void, OnCaptureStatisticsSummary, (orbit_grpc_protos::CaptureStatisticsSummary),
+              (override));
 };
 
 [[nodiscard]] std::unique_ptr<LostPerfEvent> MakeFakeLostPerfEvent(uint64_t previous_timestamp_ns,
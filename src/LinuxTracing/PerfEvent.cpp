@@ -4,6 +4,8 @@
 
 #include "PerfEvent.h"
 
+#include <algorithm>
+
 #include "PerfEventVisitor.h"
 
 namespace orbit_linux_tracing {
@@ -55,6 +57,16 @@ void StackSamplePerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(th
 
 void CallchainSamplePerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
+void CallchainSamplePerfEvent::MoveKernelFramesOutOfCallchain() {
+  if (ips.empty() || ips[0] != PERF_CONTEXT_KERNEL) return;
+  auto user_context = std::find(ips.begin(), ips.end(), PERF_CONTEXT_USER);
+  kernel_ips.assign(ips.begin() + 1, user_context);
+  ips.erase(ips.begin(), user_context);
+  ring_buffer_record.nr = ips.size();
+}
+
+void PmuCountersSamplePerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
 void UprobesPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
 void UretprobesPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
@@ -63,6 +75,8 @@ void LostPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
 void DiscardedPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
+void PipelineLatencyProbePerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
 void MmapPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
 void TaskNewtaskPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
@@ -79,6 +93,16 @@ void AmdgpuSchedRunJobPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Vi
 
 void DmaFenceSignaledPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
+void DrmSchedJobPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
+void DrmRunJobPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
+void DrmSchedProcessJobPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
+void I915RequestAddPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
+void I915RequestInPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
+
 void GenericTracepointPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->Visit(this); }
 
 }  // namespace orbit_linux_tracing
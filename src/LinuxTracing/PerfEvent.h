@@ -21,6 +21,8 @@
 #include "KernelTracepoints.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "PerfEventRecords.h"
+#include "SizeClassMemoryPool.h"
+#include "capture.pb.h"
 
 namespace orbit_linux_tracing {
 
@@ -35,6 +37,16 @@ class PerfEventVisitor;
 class PerfEvent {
  public:
   virtual ~PerfEvent() = default;
+
+  // PerfEvents are created and destroyed at a high rate by different threads, so recycle their
+  // memory instead of always going through malloc and free.
+  static void* operator new(size_t size) {
+    return SizeClassMemoryPool::GetPerfEventPool().Allocate(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    SizeClassMemoryPool::GetPerfEventPool().Deallocate(ptr, size);
+  }
+
   virtual uint64_t GetTimestamp() const = 0;
   virtual void Accept(PerfEventVisitor* visitor) = 0;
 
@@ -184,12 +196,34 @@ class DiscardedPerfEvent : public PerfEvent {
   uint64_t end_timestamp_ns_;
 };
 
+// This class doesn't correspond to any event generated by perf_event_open either. TracerThread
+// inserts one right after one in CaptureOptions::pipeline_latency_probe_period of the records it
+// reads, with the same timestamp and file descriptor, so that it's processed right after the event
+// of that record.
+class PipelineLatencyProbePerfEvent : public PerfEvent {
+ public:
+  PipelineLatencyProbePerfEvent(uint64_t record_timestamp_ns,
+                                uint64_t ring_buffer_read_timestamp_ns)
+      : record_timestamp_ns_{record_timestamp_ns},
+        ring_buffer_read_timestamp_ns_{ring_buffer_read_timestamp_ns} {}
+
+  uint64_t GetTimestamp() const override { return record_timestamp_ns_; }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  uint64_t GetRingBufferReadTimestampNs() const { return ring_buffer_read_timestamp_ns_; }
+
+ private:
+  uint64_t record_timestamp_ns_;
+  uint64_t ring_buffer_read_timestamp_ns_;
+};
+
 struct dynamically_sized_perf_event_sample_stack_user {
   uint64_t dyn_size;
-  std::unique_ptr<char[]> data;
+  PooledBuffer data;
 
   explicit dynamically_sized_perf_event_sample_stack_user(uint64_t dyn_size)
-      : dyn_size{dyn_size}, data{make_unique_for_overwrite<char[]>(dyn_size)} {}
+      : dyn_size{dyn_size}, data{MakePooledBuffer(dyn_size)} {}
 };
 
 struct dynamically_sized_perf_event_stack_sample {
@@ -231,6 +265,7 @@ class CallchainSamplePerfEvent : public PerfEvent {
  public:
   perf_event_callchain_sample_fixed ring_buffer_record;
   std::vector<uint64_t> ips;
+  std::vector<uint64_t> kernel_ips;
   perf_event_sample_regs_user_all regs;
   dynamically_sized_perf_event_sample_stack_user stack;
 
@@ -255,6 +290,12 @@ class CallchainSamplePerfEvent : public PerfEvent {
 
   uint64_t GetCallchainSize() const { return ring_buffer_record.nr; }
 
+  // If the callchain was recorded with the kernel frames, moves them, from the innermost, to
+  // kernel_ips, so that the callchain only has PERF_CONTEXT_USER and the user-space frames, as
+  // without the kernel frames. The callchain is empty if the callchain has no user-space frames.
+  void MoveKernelFramesOutOfCallchain();
+  [[nodiscard]] const std::vector<uint64_t>& GetKernelCallchain() const { return kernel_ips; }
+
   [[nodiscard]] std::array<uint64_t, PERF_REG_X86_64_MAX> GetRegisters() const {
     return perf_event_sample_regs_user_all_to_register_array(regs);
   }
@@ -262,6 +303,28 @@ class CallchainSamplePerfEvent : public PerfEvent {
   [[nodiscard]] const char* GetStackData() const { return stack.data.get(); }
   [[nodiscard]] char* GetStackData() { return stack.data.get(); }
   [[nodiscard]] uint64_t GetStackSize() const { return stack.dyn_size; }
+
+  // Whether the callchain was recorded when the thread blocked, rather than by the cpu-clock.
+  [[nodiscard]] bool IsOffCpu() const { return is_off_cpu_; }
+  void SetIsOffCpu(bool is_off_cpu) { is_off_cpu_ = is_off_cpu; }
+
+  // Whether the callchain was recorded on a page fault, mmap or brk, rather than by the cpu-clock,
+  // and how many such events the sample stands for.
+  [[nodiscard]] orbit_grpc_protos::CallstackSample::MemoryEventType GetMemoryEventType() const {
+    return memory_event_type_;
+  }
+  [[nodiscard]] uint64_t GetMemoryEventCount() const { return memory_event_count_; }
+  void SetMemoryEvent(orbit_grpc_protos::CallstackSample::MemoryEventType memory_event_type,
+                      uint64_t memory_event_count) {
+    memory_event_type_ = memory_event_type;
+    memory_event_count_ = memory_event_count;
+  }
+
+ private:
+  bool is_off_cpu_ = false;
+  orbit_grpc_protos::CallstackSample::MemoryEventType memory_event_type_ =
+      orbit_grpc_protos::CallstackSample::kNoMemoryEvent;
+  uint64_t memory_event_count_ = 0;
 };
 
 class AbstractUprobesPerfEvent {
@@ -273,6 +336,26 @@ class AbstractUprobesPerfEvent {
   const Function* function_ = nullptr;
 };
 
+class PmuCountersSamplePerfEvent : public PerfEvent {
+ public:
+  perf_event_pmu_counters_sample ring_buffer_record;
+
+  uint64_t GetTimestamp() const override { return ring_buffer_record.sample_id.time; }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
+  uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
+
+  // These are cumulative since the group was enabled.
+  uint64_t GetTimeEnabled() const { return ring_buffer_record.time_enabled; }
+  uint64_t GetTimeRunning() const { return ring_buffer_record.time_running; }
+  uint64_t GetCounterValue(PmuCounterIndex index) const {
+    return ring_buffer_record.values[index];
+  }
+};
+
 class UprobesPerfEvent : public PerfEvent, public AbstractUprobesPerfEvent {
  public:
   perf_event_sp_ip_arguments_8bytes_sample ring_buffer_record;
@@ -343,6 +426,8 @@ class MmapPerfEvent : public PerfEvent {
 class GenericTracepointPerfEvent : public PerfEvent {
  public:
   perf_event_raw_sample_fixed ring_buffer_record;
+  // Only filled when the fields of the raw data need to be decoded.
+  std::vector<char> raw_data;
 
   void Accept(PerfEventVisitor* visitor) override;
 
@@ -443,8 +528,17 @@ class GpuPerfEvent : public VariableSizeTracepointPerfEvent {
   explicit GpuPerfEvent(uint32_t tracepoint_size)
       : VariableSizeTracepointPerfEvent{tracepoint_size} {}
 
-  std::string ExtractTimelineString() const {
-    int32_t data_loc = GetTimeline();
+  std::string ExtractTimelineString() const { return ExtractDataLocString(GetTimeline()); }
+
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
+
+  uint32_t GetContext() const { return GetTypedTracepointData<TracepointDataT>().context; }
+  uint32_t GetSeqno() const { return GetTypedTracepointData<TracepointDataT>().seqno; }
+
+ protected:
+  std::string ExtractDataLocString(int32_t data_loc) const {
     int16_t data_loc_size = static_cast<int16_t>(data_loc >> 16);
     int16_t data_loc_offset = static_cast<int16_t>(data_loc & 0x00ff);
 
@@ -460,13 +554,6 @@ class GpuPerfEvent : public VariableSizeTracepointPerfEvent {
     return std::string(&data_loc_data[0]);
   }
 
-  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
-
-  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
-
-  uint32_t GetContext() const { return GetTypedTracepointData<TracepointDataT>().context; }
-  uint32_t GetSeqno() const { return GetTypedTracepointData<TracepointDataT>().seqno; }
-
  private:
   int32_t GetTimeline() const { return GetTypedTracepointData<TracepointDataT>().timeline; }
 };
@@ -493,6 +580,111 @@ class DmaFenceSignaledPerfEvent : public GpuPerfEvent<dma_fence_signaled_tracepo
       : GpuPerfEvent<dma_fence_signaled_tracepoint>{tracepoint_size} {}
 
   void Accept(PerfEventVisitor* visitor) override;
+
+  // The name of the driver that owns the fence, e.g., "i915".
+  std::string ExtractDriverString() const {
+    return ExtractDataLocString(GetTypedTracepointData<dma_fence_signaled_tracepoint>().driver);
+  }
+};
+
+// The events of the gpu_scheduler tracepoints, whose raw data is decoded when the event is read
+// from the ring buffer (see DrmGpuTracepoints.h). `fence` is the address of the "finished" fence of
+// the job, which identifies the job across the three tracepoints.
+class DrmSchedPerfEvent : public PerfEvent {
+ public:
+  DrmSchedPerfEvent(uint64_t timestamp, pid_t pid, pid_t tid, uint64_t fence, uint64_t job_id,
+                    std::string timeline)
+      : timestamp_{timestamp},
+        pid_{pid},
+        tid_{tid},
+        fence_{fence},
+        job_id_{job_id},
+        timeline_{std::move(timeline)} {}
+
+  uint64_t GetTimestamp() const override { return timestamp_; }
+
+  pid_t GetPid() const { return pid_; }
+  pid_t GetTid() const { return tid_; }
+  uint64_t GetFence() const { return fence_; }
+  uint64_t GetJobId() const { return job_id_; }
+  // Empty if the tracepoint doesn't record the name of the scheduler.
+  const std::string& GetTimeline() const { return timeline_; }
+
+ private:
+  uint64_t timestamp_;
+  pid_t pid_;
+  pid_t tid_;
+  uint64_t fence_;
+  uint64_t job_id_;
+  std::string timeline_;
+};
+
+// A job is queued, in the thread that submits it.
+class DrmSchedJobPerfEvent : public DrmSchedPerfEvent {
+ public:
+  using DrmSchedPerfEvent::DrmSchedPerfEvent;
+  void Accept(PerfEventVisitor* visitor) override;
+};
+
+// A job is scheduled to run on the hardware.
+class DrmRunJobPerfEvent : public DrmSchedPerfEvent {
+ public:
+  using DrmSchedPerfEvent::DrmSchedPerfEvent;
+  void Accept(PerfEventVisitor* visitor) override;
+};
+
+// The hardware is done with a job.
+class DrmSchedProcessJobPerfEvent : public DrmSchedPerfEvent {
+ public:
+  using DrmSchedPerfEvent::DrmSchedPerfEvent;
+  void Accept(PerfEventVisitor* visitor) override;
+};
+
+// The events of the i915 request tracepoints, decoded like the ones of gpu_scheduler. A request is
+// identified by the context and seqno of its fence, and completed by the dma_fence_signaled event
+// of that fence.
+class I915RequestPerfEvent : public PerfEvent {
+ public:
+  I915RequestPerfEvent(uint64_t timestamp, pid_t pid, pid_t tid, uint32_t context, uint32_t seqno,
+                       std::string timeline)
+      : timestamp_{timestamp},
+        pid_{pid},
+        tid_{tid},
+        context_{context},
+        seqno_{seqno},
+        timeline_{std::move(timeline)} {}
+
+  uint64_t GetTimestamp() const override { return timestamp_; }
+
+  pid_t GetPid() const { return pid_; }
+  pid_t GetTid() const { return tid_; }
+  uint32_t GetContext() const { return context_; }
+  uint32_t GetSeqno() const { return seqno_; }
+  // The name of the engine, e.g., "rcs0".
+  const std::string& GetTimeline() const { return timeline_; }
+
+ private:
+  uint64_t timestamp_;
+  pid_t pid_;
+  pid_t tid_;
+  uint32_t context_;
+  uint32_t seqno_;
+  std::string timeline_;
+};
+
+// A request is added, in the thread that submits it.
+class I915RequestAddPerfEvent : public I915RequestPerfEvent {
+ public:
+  using I915RequestPerfEvent::I915RequestPerfEvent;
+  void Accept(PerfEventVisitor* visitor) override;
+};
+
+// A request is submitted to the hardware. This tracepoint only exists in kernels built with
+// CONFIG_DRM_I915_LOW_LEVEL_TRACEPOINTS.
+class I915RequestInPerfEvent : public I915RequestPerfEvent {
+ public:
+  using I915RequestPerfEvent::I915RequestPerfEvent;
+  void Accept(PerfEventVisitor* visitor) override;
 };
 
 }  // namespace orbit_linux_tracing
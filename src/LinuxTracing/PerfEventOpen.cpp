@@ -9,12 +9,16 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 
+#include <array>
 #include <cerrno>
+#include <utility>
+#include <vector>
 
 #include "LinuxTracingUtils.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
 #include "OrbitBase/SafeStrerror.h"
+#include "PerfEventRecords.h"
 
 namespace orbit_linux_tracing {
 namespace {
@@ -27,6 +31,9 @@ perf_event_attr generic_event_attr() {
   pe.sample_id_all = 1;  // Also include timestamps for lost events.
   pe.disabled = 1;
   pe.sample_type = SAMPLE_TYPE_TID_TIME_STREAMID_CPU;
+  // Wake up pollers based on the number of bytes written rather than on the number of events.
+  pe.watermark = 1;
+  pe.wakeup_watermark = kRingBufferWakeupWatermarkBytes;
 
   return pe;
 }
@@ -84,7 +91,7 @@ int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t
 }
 
 int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
-                                uint16_t stack_dump_size) {
+                                uint16_t stack_dump_size, bool include_kernel_callchain) {
   perf_event_attr pe = generic_event_attr();
   pe.type = PERF_TYPE_SOFTWARE;
   pe.config = PERF_COUNT_SW_CPU_CLOCK;
@@ -92,10 +99,12 @@ int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
   pe.sample_type |= PERF_SAMPLE_CALLCHAIN;
   // TODO(kuebler): Read this from /proc/sys/kernel/perf_event_max_stack
   pe.sample_max_stack = 127;
-  pe.exclude_callchain_kernel = true;
-  // Exclude all samples that fall into the kernel. In particular this will discard samples falling
-  // into the int3 triggered uprobe code, which we could otherwise not really detect.
-  pe.exclude_kernel = true;
+  pe.exclude_callchain_kernel = !include_kernel_callchain;
+  // Unless the kernel frames are wanted, exclude all samples that fall into the kernel. In
+  // particular this will discard samples falling into the int3 triggered uprobe code, which we
+  // could otherwise not really detect. With the kernel frames, these samples have the uprobe
+  // handlers as kernel frames and the instrumented function as the innermost user-space frame.
+  pe.exclude_kernel = !include_kernel_callchain;
 
   // Also capture a small part of the stack and the registers to allow patching the callers of
   // leaf functions. This is done by unwinding the first two frame using DWARF.
@@ -106,6 +115,73 @@ int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
   return generic_event_open(&pe, pid, cpu);
 }
 
+int page_faults_callchain_sample_event_open(uint64_t period, pid_t pid, int32_t cpu,
+                                            uint16_t stack_dump_size,
+                                            bool include_kernel_callchain) {
+  perf_event_attr pe = generic_event_attr();
+  pe.type = PERF_TYPE_SOFTWARE;
+  pe.config = PERF_COUNT_SW_PAGE_FAULTS;
+  pe.sample_period = period;
+  pe.sample_type |= PERF_SAMPLE_CALLCHAIN;
+  pe.sample_max_stack = 127;
+  // Page faults are always handled in the kernel, hence kernel samples can't be excluded, but the
+  // kernel part of the callchain is only recorded on request.
+  pe.exclude_callchain_kernel = !include_kernel_callchain;
+
+  pe.sample_type |= PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+  pe.sample_regs_user = SAMPLE_REGS_USER_ALL;
+  pe.sample_stack_user = stack_dump_size;
+
+  return generic_event_open(&pe, pid, cpu);
+}
+
+int pmu_counters_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
+                                   std::vector<int>* counter_fds) {
+  perf_event_attr leader_pe = generic_event_attr();
+  leader_pe.type = PERF_TYPE_SOFTWARE;
+  leader_pe.config = PERF_COUNT_SW_CPU_CLOCK;
+  leader_pe.sample_period = period_ns;
+  leader_pe.sample_type |= PERF_SAMPLE_READ;
+  leader_pe.read_format =
+      PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  int leader_fd = generic_event_open(&leader_pe, pid, cpu);
+  if (leader_fd == -1) {
+    return -1;
+  }
+
+  // The order of the members of the group must correspond to PmuCounterIndex.
+  constexpr std::array<std::pair<uint32_t, uint64_t>, kPmuCounterCount - 1> kCounters{{
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  }};
+  std::vector<int> fds;
+  for (const auto& [type, config] : kCounters) {
+    perf_event_attr pe{};
+    pe.size = sizeof(struct perf_event_attr);
+    pe.type = type;
+    pe.config = config;
+    // Only count the execution of user space code.
+    pe.exclude_kernel = true;
+    // Members of a group are enabled and disabled with the group leader.
+    pe.disabled = 0;
+    int fd = perf_event_open(&pe, pid, cpu, leader_fd, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1) {
+      ERROR("perf_event_open for counter %u:%u: %s", type, config, SafeStrerror(errno));
+      for (int opened_fd : fds) {
+        close(opened_fd);
+      }
+      close(leader_fd);
+      return -1;
+    }
+    fds.push_back(fd);
+  }
+
+  counter_fds->insert(counter_fds->end(), fds.begin(), fds.end());
+  return leader_fd;
+}
+
 int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid,
                                int32_t cpu) {
   perf_event_attr pe = uprobe_event_attr(module, function_offset);
@@ -163,4 +239,25 @@ int tracepoint_event_open(const char* tracepoint_category, const char* tracepoin
   return generic_event_open(&pe, pid, cpu);
 }
 
+int tracepoint_callchain_event_open(const char* tracepoint_category, const char* tracepoint_name,
+                                    pid_t pid, int32_t cpu, uint16_t stack_dump_size,
+                                    bool include_kernel_callchain) {
+  int tp_id = GetTracepointId(tracepoint_category, tracepoint_name);
+  if (tp_id == -1) {
+    return -1;
+  }
+  perf_event_attr pe = generic_event_attr();
+  pe.type = PERF_TYPE_TRACEPOINT;
+  pe.config = tp_id;
+  pe.sample_type |= PERF_SAMPLE_CALLCHAIN;
+  pe.sample_max_stack = 127;
+  pe.exclude_callchain_kernel = !include_kernel_callchain;
+
+  pe.sample_type |= PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+  pe.sample_regs_user = SAMPLE_REGS_USER_ALL;
+  pe.sample_stack_user = stack_dump_size;
+
+  return generic_event_open(&pe, pid, cpu);
+}
+
 }  // namespace orbit_linux_tracing
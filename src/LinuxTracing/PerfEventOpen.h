@@ -13,6 +13,7 @@
 
 #include <cerrno>
 #include <cstdint>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/SafeStrerror.h"
@@ -45,6 +46,13 @@ inline void perf_event_disable(int file_descriptor) {
   }
 }
 
+inline void perf_event_set_period(int file_descriptor, uint64_t period) {
+  int ret = ioctl(file_descriptor, PERF_EVENT_IOC_PERIOD, &period);
+  if (ret != 0) {
+    ERROR("PERF_EVENT_IOC_PERIOD: %s", SafeStrerror(errno));
+  }
+}
+
 inline void perf_event_redirect(int from_fd, int to_fd) {
   int ret = ioctl(from_fd, PERF_EVENT_IOC_SET_OUTPUT, to_fd);
   if (ret != 0) {
@@ -52,6 +60,12 @@ inline void perf_event_redirect(int from_fd, int to_fd) {
   }
 }
 
+// Sets the filter of a tracepoint event, e.g., "prev_state & 3". Unlike the functions above, a
+// failure is expected on kernels that don't support the filter, and it's up to the caller.
+inline bool perf_event_set_filter(int file_descriptor, const char* filter) {
+  return ioctl(file_descriptor, PERF_EVENT_IOC_SET_FILTER, filter) == 0;
+}
+
 inline uint64_t perf_event_get_id(int file_descriptor) {
   uint64_t id;
   int ret = ioctl(file_descriptor, PERF_EVENT_IOC_ID, &id);
@@ -94,6 +108,12 @@ static constexpr uint64_t SAMPLE_REGS_USER_SP_IP_ARGUMENTS =
 static_assert(sizeof(void*) == 8);
 static constexpr uint16_t SAMPLE_STACK_USER_SIZE_8BYTES = 8;
 
+// A thread polling a ring buffer (e.g., with epoll_wait) is woken up every time at least this
+// many bytes have been written to the ring buffer since the last wakeup. This keeps the number of
+// wakeups low at high event rates, while still waking up long before a ring buffer is full. If a
+// ring buffer is smaller than twice this value, the kernel reduces it to half the ring buffer size.
+static constexpr uint32_t kRingBufferWakeupWatermarkBytes = 16 * 1024;
+
 // Max to pass to perf_event_open without getting an error is (1u << 16u) - 8,
 // because the kernel stores this in a short and because of alignment reasons.
 // But the size the kernel actually returns is smaller, because the maximum size
@@ -112,9 +132,24 @@ int mmap_task_event_open(pid_t pid, int32_t cpu);
 // perf_event_open for stack sampling.
 int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size);
 
-// perf_event_open for stack sampling using frame pointers.
+// perf_event_open for stack sampling using frame pointers. If include_kernel_callchain is true, the
+// samples falling into the kernel are also recorded, and the callchain has the kernel frames,
+// after PERF_CONTEXT_KERNEL, before the user-space frames, after PERF_CONTEXT_USER.
 int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
-                                uint16_t stack_dump_size);
+                                uint16_t stack_dump_size, bool include_kernel_callchain);
+
+// perf_event_open for page faults, sampled every `period` page faults, recording the user-space
+// callchain, and optionally the kernel one, with the same layout as callchain_sample_event_open.
+int page_faults_callchain_sample_event_open(uint64_t period, pid_t pid, int32_t cpu,
+                                            uint16_t stack_dump_size,
+                                            bool include_kernel_callchain);
+
+// perf_event_open for a group of hardware counters, read with each sample of a cpu-clock event. The
+// file descriptors of the counters other than the group leader are appended to counter_fds. Returns
+// the file descriptor of the group leader, or -1 if any of the events couldn't be opened, e.g.,
+// because the cpu doesn't have enough programmable counters.
+int pmu_counters_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
+                                   std::vector<int>* counter_fds);
 
 // perf_event_open for uprobes and uretprobes.
 int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid,
@@ -132,6 +167,13 @@ void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
 int tracepoint_event_open(const char* tracepoint_category, const char* tracepoint_name, pid_t pid,
                           int32_t cpu);
 
+// perf_event_open for a tracepoint that records the user-space callchain, and optionally the kernel
+// one, the registers and a small part of the stack of the current thread, with the same layout as
+// callchain_sample_event_open and without the raw tracepoint data.
+int tracepoint_callchain_event_open(const char* tracepoint_category, const char* tracepoint_name,
+                                    pid_t pid, int32_t cpu, uint16_t stack_dump_size,
+                                    bool include_kernel_callchain);
+
 }  // namespace orbit_linux_tracing
 
 #endif  // LINUX_TRACING_PERF_EVENT_OPEN_H_
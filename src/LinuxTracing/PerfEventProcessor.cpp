@@ -87,14 +87,16 @@ void PerfEventProcessor::ProcessAllEvents() {
 }
 
 void PerfEventProcessor::ProcessOldEvents() {
+  // Do not read the most recent events as out-of-order events could (and will) arrive.
+  ProcessEventsOlderThan(orbit_base::CaptureTimestampNs() - kProcessingDelayMs * 1'000'000);
+}
+
+void PerfEventProcessor::ProcessEventsOlderThan(uint64_t timestamp_ns) {
   CHECK(!visitors_.empty());
-  uint64_t current_timestamp_ns = orbit_base::CaptureTimestampNs();
 
   while (event_queue_.HasEvent()) {
     PerfEvent* event = event_queue_.TopEvent();
-
-    // Do not read the most recent events as out-of-order events could (and will) arrive.
-    if (event->GetTimestamp() + kProcessingDelayMs * 1'000'000 >= current_timestamp_ns) {
+    if (event->GetTimestamp() >= timestamp_ns) {
       break;
     }
     // Events are guaranteed to be processed in order of timestamp
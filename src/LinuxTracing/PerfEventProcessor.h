@@ -33,10 +33,17 @@ class PerfEventProcessor {
 
   void ProcessOldEvents();
 
+  // Processes the events with a timestamp lower than timestamp_ns. This is for when the caller knows
+  // that no older event can be added anymore, e.g., when replaying recorded events.
+  void ProcessEventsOlderThan(uint64_t timestamp_ns);
+
   void AddVisitor(PerfEventVisitor* visitor) { visitors_.push_back(visitor); }
 
   void ClearVisitors() { visitors_.clear(); }
 
+  // The number of events added and not processed yet.
+  [[nodiscard]] size_t GetEventCount() const { return event_queue_.GetEventCount(); }
+
   void SetDiscardedOutOfOrderCounter(std::atomic<uint64_t>* discarded_out_of_order_counter) {
     discarded_out_of_order_counter_ = discarded_out_of_order_counter;
   }
@@ -4,7 +4,6 @@
 
 #include "PerfEventQueue.h"
 
-#include <absl/meta/type_traits.h>
 #include <stddef.h>
 
 #include <algorithm>
@@ -14,35 +13,56 @@
 
 namespace orbit_linux_tracing {
 
+void PerfEventQueue::EventRun::push_back(TimestampAndEvent entry) {
+  if (size_ == entries_.size()) {
+    // Grow, moving the entries so that the run starts again at index 0.
+    std::vector<TimestampAndEvent> new_entries(std::max<size_t>(2 * entries_.size(), 16));
+    for (size_t i = 0; i < size_; ++i) {
+      new_entries[i] = std::move(entries_[(head_ + i) & (entries_.size() - 1)]);
+    }
+    entries_ = std::move(new_entries);
+    head_ = 0;
+  }
+  entries_[(head_ + size_) & (entries_.size() - 1)] = std::move(entry);
+  ++size_;
+}
+
+PerfEventQueue::TimestampAndEvent PerfEventQueue::EventRun::pop_front() {
+  CHECK(size_ > 0);
+  TimestampAndEvent entry = std::move(entries_[head_]);
+  head_ = (head_ + 1) & (entries_.size() - 1);
+  --size_;
+  return entry;
+}
+
 void PerfEventQueue::PushEvent(std::unique_ptr<PerfEvent> event) {
   int origin_fd = event->GetOrderedInFileDescriptor();
   if (origin_fd == PerfEvent::kNotOrderedInAnyFileDescriptor) {
     priority_queue_of_events_not_ordered_by_fd_.push(std::move(event));
+    return;
+  }
 
-  } else if (auto queue_it = queues_of_events_ordered_by_fd_.find(origin_fd);
-             queue_it != queues_of_events_ordered_by_fd_.end()) {
-    const std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>& queue = queue_it->second;
-
-    CHECK(!queue->empty());
-    // Fundamental assumption: events from the same file descriptor come already in order.
-    CHECK(event->GetTimestamp() >= queue->back()->GetTimestamp());
-    queue->push(std::move(event));
-
+  uint32_t run_index = GetOrCreateRunIndex(origin_fd);
+  EventRun& run = runs_[run_index];
+  uint64_t timestamp = event->GetTimestamp();
+  if (run.empty()) {
+    run.push_back({timestamp, std::move(event)});
+    front_timestamps_[run_index] = timestamp;
+    ReplayTournament(run_index);
   } else {
-    queue_it = queues_of_events_ordered_by_fd_
-                   .emplace(origin_fd, std::make_unique<std::queue<std::unique_ptr<PerfEvent>>>())
-                   .first;
-    const std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>& queue = queue_it->second;
-
-    queue->push(std::move(event));
-    heap_of_queues_of_events_ordered_by_fd_.emplace_back(queue.get());
-    MoveUpBackOfHeapOfQueues();
+    // Fundamental assumption: events from the same file descriptor come already in order.
+    CHECK(timestamp >= run.back().timestamp);
+    run.push_back({timestamp, std::move(event)});
   }
+  ++ordered_event_count_;
 }
 
 bool PerfEventQueue::HasEvent() const {
-  return !heap_of_queues_of_events_ordered_by_fd_.empty() ||
-         !priority_queue_of_events_not_ordered_by_fd_.empty();
+  return ordered_event_count_ > 0 || !priority_queue_of_events_not_ordered_by_fd_.empty();
+}
+
+size_t PerfEventQueue::GetEventCount() const {
+  return ordered_event_count_ + priority_queue_of_events_not_ordered_by_fd_.size();
 }
 
 PerfEvent* PerfEventQueue::TopEvent() {
@@ -53,11 +73,9 @@ PerfEvent* PerfEventQueue::TopEvent() {
   if (!priority_queue_of_events_not_ordered_by_fd_.empty()) {
     top_event = priority_queue_of_events_not_ordered_by_fd_.top().get();
   }
-  if (!heap_of_queues_of_events_ordered_by_fd_.empty() &&
-      (top_event == nullptr ||
-       heap_of_queues_of_events_ordered_by_fd_.front()->front()->GetTimestamp() <
-           top_event->GetTimestamp())) {
-    top_event = heap_of_queues_of_events_ordered_by_fd_.front()->front().get();
+  if (ordered_event_count_ > 0 &&
+      (top_event == nullptr || GetOldestRunTimestamp() < top_event->GetTimestamp())) {
+    top_event = runs_[GetOldestRunIndex()].front().event.get();
   }
   CHECK(top_event != nullptr);
   return top_event;
@@ -65,84 +83,79 @@ PerfEvent* PerfEventQueue::TopEvent() {
 
 std::unique_ptr<PerfEvent> PerfEventQueue::PopEvent() {
   if (!priority_queue_of_events_not_ordered_by_fd_.empty() &&
-      (heap_of_queues_of_events_ordered_by_fd_.empty() ||
+      (ordered_event_count_ == 0 ||
        priority_queue_of_events_not_ordered_by_fd_.top()->GetTimestamp() <=
-           heap_of_queues_of_events_ordered_by_fd_.front()->front()->GetTimestamp())) {
+           GetOldestRunTimestamp())) {
     // The oldest event is at the top of the priority queue holding the events that cannot be
     // assumed sorted in any ring buffer. Note in particular that we return and pop this event even
-    // if the event at the top of heap_of_queues_of_events_ordered_by_fd_ has the exact same
-    // timestamp, as we need to be consistent with TopEvent.
+    // if the oldest event in the runs has the exact same timestamp, as we need to be consistent
+    // with TopEvent.
     std::unique_ptr<PerfEvent> top_event = std::move(
         const_cast<std::unique_ptr<PerfEvent>&>(priority_queue_of_events_not_ordered_by_fd_.top()));
     priority_queue_of_events_not_ordered_by_fd_.pop();
     return top_event;
   }
 
-  std::queue<std::unique_ptr<PerfEvent>>* top_queue =
-      heap_of_queues_of_events_ordered_by_fd_.front();
-  std::unique_ptr<PerfEvent> top_event = std::move(top_queue->front());
-  top_queue->pop();
-
-  if (top_queue->empty()) {
-    int top_fd = top_event->GetOrderedInFileDescriptor();
-    queues_of_events_ordered_by_fd_.erase(top_fd);
-    std::swap(heap_of_queues_of_events_ordered_by_fd_.front(),
-              heap_of_queues_of_events_ordered_by_fd_.back());
-    heap_of_queues_of_events_ordered_by_fd_.pop_back();
-    MoveDownFrontOfHeapOfQueues();
-  } else {
-    MoveDownFrontOfHeapOfQueues();
-  }
-
+  CHECK(ordered_event_count_ > 0);
+  uint32_t oldest_run_index = GetOldestRunIndex();
+  EventRun& oldest_run = runs_[oldest_run_index];
+  std::unique_ptr<PerfEvent> top_event = oldest_run.pop_front().event;
+  front_timestamps_[oldest_run_index] =
+      oldest_run.empty() ? kEmptyRunTimestamp : oldest_run.front().timestamp;
+  ReplayTournament(oldest_run_index);
+  --ordered_event_count_;
   return top_event;
 }
 
-void PerfEventQueue::MoveDownFrontOfHeapOfQueues() {
-  if (heap_of_queues_of_events_ordered_by_fd_.empty()) {
-    return;
+uint32_t PerfEventQueue::GetOrCreateRunIndex(int origin_fd) {
+  if (auto run_index_it = fds_to_run_indices_.find(origin_fd);
+      run_index_it != fds_to_run_indices_.end()) {
+    return run_index_it->second;
   }
 
-  size_t current_index = 0;
-  size_t new_index;
-  while (true) {
-    new_index = current_index;
-    size_t left_index = current_index * 2 + 1;
-    size_t right_index = current_index * 2 + 2;
-    if (left_index < heap_of_queues_of_events_ordered_by_fd_.size() &&
-        heap_of_queues_of_events_ordered_by_fd_[left_index]->front()->GetTimestamp() <
-            heap_of_queues_of_events_ordered_by_fd_[new_index]->front()->GetTimestamp()) {
-      new_index = left_index;
-    }
-    if (right_index < heap_of_queues_of_events_ordered_by_fd_.size() &&
-        heap_of_queues_of_events_ordered_by_fd_[right_index]->front()->GetTimestamp() <
-            heap_of_queues_of_events_ordered_by_fd_[new_index]->front()->GetTimestamp()) {
-      new_index = right_index;
-    }
-    if (new_index != current_index) {
-      std::swap(heap_of_queues_of_events_ordered_by_fd_[new_index],
-                heap_of_queues_of_events_ordered_by_fd_[current_index]);
-      current_index = new_index;
-    } else {
-      break;
-    }
+  auto run_index = static_cast<uint32_t>(runs_.size());
+  runs_.emplace_back();
+  front_timestamps_.push_back(kEmptyRunTimestamp);
+  fds_to_run_indices_.emplace(origin_fd, run_index);
+
+  if (runs_.size() > leaf_count_) {
+    RebuildTournament();
+  } else {
+    tournament_tree_[leaf_count_ + run_index] = run_index;
+    ReplayTournament(run_index);
   }
+  return run_index;
 }
 
-void PerfEventQueue::MoveUpBackOfHeapOfQueues() {
-  if (heap_of_queues_of_events_ordered_by_fd_.empty()) {
-    return;
+uint32_t PerfEventQueue::GetWinner(uint32_t lhs_run_index, uint32_t rhs_run_index) const {
+  if (rhs_run_index == kNoRun) {
+    return lhs_run_index;
   }
+  if (lhs_run_index == kNoRun) {
+    return rhs_run_index;
+  }
+  return front_timestamps_[rhs_run_index] < front_timestamps_[lhs_run_index] ? rhs_run_index
+                                                                               : lhs_run_index;
+}
 
-  size_t current_index = heap_of_queues_of_events_ordered_by_fd_.size() - 1;
-  while (current_index > 0) {
-    size_t parent_index = (current_index - 1) / 2;
-    if (heap_of_queues_of_events_ordered_by_fd_[parent_index]->front()->GetTimestamp() <=
-        heap_of_queues_of_events_ordered_by_fd_[current_index]->front()->GetTimestamp()) {
-      break;
-    }
-    std::swap(heap_of_queues_of_events_ordered_by_fd_[parent_index],
-              heap_of_queues_of_events_ordered_by_fd_[current_index]);
-    current_index = parent_index;
+void PerfEventQueue::ReplayTournament(uint32_t run_index) {
+  for (size_t node = (leaf_count_ + run_index) / 2; node >= 1; node /= 2) {
+    tournament_tree_[node] = GetWinner(tournament_tree_[2 * node], tournament_tree_[2 * node + 1]);
+  }
+}
+
+void PerfEventQueue::RebuildTournament() {
+  leaf_count_ = std::max<size_t>(2 * leaf_count_, 1);
+  while (leaf_count_ < runs_.size()) {
+    leaf_count_ *= 2;
+  }
+  // With a single leaf, node 1 is both the root and the leaf.
+  tournament_tree_.assign(std::max<size_t>(2 * leaf_count_, 2), kNoRun);
+  for (size_t run_index = 0; run_index < runs_.size(); ++run_index) {
+    tournament_tree_[leaf_count_ + run_index] = static_cast<uint32_t>(run_index);
+  }
+  for (size_t node = leaf_count_ - 1; node >= 1; --node) {
+    tournament_tree_[node] = GetWinner(tournament_tree_[2 * node], tournament_tree_[2 * node + 1]);
   }
 }
 
@@ -8,6 +8,9 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
 
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <queue>
 #include <vector>
@@ -21,13 +24,22 @@ namespace orbit_linux_tracing {
 //
 // Instead of keeping a single priority queue with all the events to process, on which push/pop
 // operations would be logarithmic in the number of events, we leverage the fact that events coming
-// from the same perf_event_open ring buffer are already sorted. We then keep a priority queue of
-// queues, where the events in each queue come from the same ring buffer. Whenever an event is
-// removed from a queue, we need to move such queue down the priority queue.
+// from the same perf_event_open ring buffer are already sorted. We keep one sorted "run" of events
+// per ring buffer and merge the runs with a tournament tree (a "winner tree") whose leaves are the
+// runs and whose internal nodes hold the index of the run with the oldest front event in their
+// subtree. Only popping an event, or pushing an event to an empty run, changes the front of a run
+// and requires replaying the path from that leaf to the root; pushing an event to a non-empty run
+// is constant time.
 //
-// In order to be able to add an event to a queue, we also need to maintain the association between
-// a queue and its ring buffer, which is what the map is for. We use the file descriptor used to
-// read from the ring buffer as identifier for a ring buffer.
+// To keep this cache-friendly even with thousands of ring buffers, each run is a contiguous
+// circular array of (timestamp, event) pairs, the timestamp at the front of every run is stored in
+// a separate contiguous array, and the tree is an implicit binary tree of run indices. This way,
+// the comparisons never need to follow the pointer to a PerfEvent nor call the virtual
+// PerfEvent::GetTimestamp.
+//
+// We use the file descriptor used to read from the ring buffer as identifier for a ring buffer,
+// and maintain the association between a file descriptor and its run in a map. Runs are never
+// removed, an empty run simply has a front timestamp larger than any event.
 //
 // Some events, though, are known to come out of order even in relation to other events in the same
 // ring buffer (e.g., dma_fence_signaled). For those cases, use an additional single
@@ -36,23 +48,60 @@ class PerfEventQueue {
  public:
   void PushEvent(std::unique_ptr<PerfEvent> event);
   [[nodiscard]] bool HasEvent() const;
+  [[nodiscard]] size_t GetEventCount() const;
   [[nodiscard]] PerfEvent* TopEvent();
   std::unique_ptr<PerfEvent> PopEvent();
 
  private:
-  // Floats down the element at the top of the ordered_queues_heap_ to its correct place. Used when
-  // the key of the top element changes, or as part of the process of removing the top element.
-  void MoveDownFrontOfHeapOfQueues();
-  // Floats up an element that it is know should be further up in the heap. Used on insertion.
-  void MoveUpBackOfHeapOfQueues();
+  struct TimestampAndEvent {
+    uint64_t timestamp;
+    std::unique_ptr<PerfEvent> event;
+  };
+
+  // A FIFO queue stored in a contiguous circular array whose capacity is a power of two.
+  class EventRun {
+   public:
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] const TimestampAndEvent& front() const { return entries_[head_]; }
+    [[nodiscard]] const TimestampAndEvent& back() const {
+      return entries_[(head_ + size_ - 1) & (entries_.size() - 1)];
+    }
+    void push_back(TimestampAndEvent entry);
+    [[nodiscard]] TimestampAndEvent pop_front();
+
+   private:
+    std::vector<TimestampAndEvent> entries_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+  };
+
+  static constexpr uint64_t kEmptyRunTimestamp = std::numeric_limits<uint64_t>::max();
+  static constexpr uint32_t kNoRun = std::numeric_limits<uint32_t>::max();
+
+  [[nodiscard]] uint32_t GetOrCreateRunIndex(int origin_fd);
+  // Recomputes the winners on the path from the leaf of run_index to the root, after the front of
+  // that run changed.
+  void ReplayTournament(uint32_t run_index);
+  // Rebuilds the whole tree, used when the number of leaves needs to grow.
+  void RebuildTournament();
+  [[nodiscard]] uint32_t GetWinner(uint32_t lhs_run_index, uint32_t rhs_run_index) const;
+  [[nodiscard]] uint32_t GetOldestRunIndex() const {
+    return tournament_tree_.empty() ? kNoRun : tournament_tree_[1];
+  }
+  [[nodiscard]] uint64_t GetOldestRunTimestamp() const {
+    uint32_t oldest_run_index = GetOldestRunIndex();
+    return oldest_run_index == kNoRun ? kEmptyRunTimestamp : front_timestamps_[oldest_run_index];
+  }
 
-  // This vector holds the heap of the queues each of which holds events coming from the same ring
-  // buffer and assumes them already in order by timestamp.
-  std::vector<std::queue<std::unique_ptr<PerfEvent>>*> heap_of_queues_of_events_ordered_by_fd_;
-  // This map keeps the association between a file descriptor and the ordered queue of events coming
-  // from the ring buffer corresponding to that file descriptor.
-  absl::flat_hash_map<int, std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>>
-      queues_of_events_ordered_by_fd_;
+  std::vector<EventRun> runs_;
+  // front_timestamps_[i] is the timestamp of the front event of runs_[i], or kEmptyRunTimestamp.
+  std::vector<uint64_t> front_timestamps_;
+  // Implicit binary tree: the leaves, at indices [leaf_count_, 2 * leaf_count_), are the run
+  // indices (or kNoRun for padding), and node i is the winner between nodes 2 * i and 2 * i + 1.
+  std::vector<uint32_t> tournament_tree_;
+  size_t leaf_count_ = 0;
+  size_t ordered_event_count_ = 0;
+  absl::flat_hash_map<int, uint32_t> fds_to_run_indices_;
 
   static constexpr auto kPerfEventReverseTimestampCompare =
       [](const std::unique_ptr<PerfEvent>& lhs, const std::unique_ptr<PerfEvent>& rhs) {
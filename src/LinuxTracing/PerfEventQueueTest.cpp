@@ -5,7 +5,10 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <memory>
+#include <random>
+#include <vector>
 
 #include "PerfEvent.h"
 #include "PerfEventQueue.h"
@@ -251,6 +254,24 @@ TEST(PerfEventQueue, OrderedFdsAndNotOrderedInAnyFileDescriptor) {
   EXPECT_DEATH(event_queue.PopEvent(), "");
 }
 
+TEST(PerfEventQueue, GetEventCountCountsEventsOrderedByFdAndNotOrderedInAnyFileDescriptor) {
+  PerfEventQueue event_queue;
+  EXPECT_EQ(event_queue.GetEventCount(), 0);
+
+  event_queue.PushEvent(MakeTestEvent(11, 103));
+  event_queue.PushEvent(MakeTestEvent(22, 102));
+  event_queue.PushEvent(MakeTestEvent(PerfEvent::kNotOrderedInAnyFileDescriptor, 101));
+  event_queue.PushEvent(MakeTestEvent(11, 104));
+  EXPECT_EQ(event_queue.GetEventCount(), 4);
+
+  event_queue.PopEvent();
+  event_queue.PopEvent();
+  EXPECT_EQ(event_queue.GetEventCount(), 2);
+  event_queue.PopEvent();
+  event_queue.PopEvent();
+  EXPECT_EQ(event_queue.GetEventCount(), 0);
+}
+
 TEST(
     PerfEventQueue,
     TopEventAndPopEventReturnTheSameWhenAnEventOrderedByFdAndAnEventNotOrderedInAnyFdHaveTheSameTimestamp) {
@@ -269,4 +290,43 @@ TEST(
   EXPECT_EQ(popped_event->GetOrderedInFileDescriptor(), 11);
 }
 
+TEST(PerfEventQueue, ManyFdsInterleavedWithPopsReturnAllEventsInOrder) {
+  PerfEventQueue event_queue;
+  constexpr int kFdCount = 1000;
+  constexpr int kEventCount = 100'000;
+
+  std::mt19937 random_engine{42};
+  std::uniform_int_distribution<int> fd_distribution{0, kFdCount - 1};
+  std::uniform_int_distribution<uint64_t> timestamp_increment_distribution{0, 10};
+  std::bernoulli_distribution pop_distribution{0.4};
+
+  std::vector<uint64_t> last_timestamp_per_fd(kFdCount, 0);
+  std::vector<uint64_t> pushed_timestamps;
+  std::vector<uint64_t> popped_timestamps;
+  uint64_t last_popped_timestamp = 0;
+  for (int i = 0; i < kEventCount; ++i) {
+    int fd = fd_distribution(random_engine);
+    // Only push events that are not older than the last popped event, as in PerfEventProcessor.
+    uint64_t timestamp = std::max(last_timestamp_per_fd[fd], last_popped_timestamp) +
+                         timestamp_increment_distribution(random_engine);
+    last_timestamp_per_fd[fd] = timestamp;
+    event_queue.PushEvent(MakeTestEvent(fd, timestamp));
+    pushed_timestamps.push_back(timestamp);
+
+    if (pop_distribution(random_engine)) {
+      uint64_t top_timestamp = event_queue.TopEvent()->GetTimestamp();
+      last_popped_timestamp = event_queue.PopEvent()->GetTimestamp();
+      EXPECT_EQ(last_popped_timestamp, top_timestamp);
+      popped_timestamps.push_back(last_popped_timestamp);
+    }
+  }
+  while (event_queue.HasEvent()) {
+    popped_timestamps.push_back(event_queue.PopEvent()->GetTimestamp());
+  }
+
+  EXPECT_TRUE(std::is_sorted(popped_timestamps.begin(), popped_timestamps.end()));
+  std::sort(pushed_timestamps.begin(), pushed_timestamps.end());
+  EXPECT_EQ(popped_timestamps, pushed_timestamps);
+}
+
 }  // namespace orbit_linux_tracing
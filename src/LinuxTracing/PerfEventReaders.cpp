@@ -4,6 +4,8 @@
 
 #include "PerfEventReaders.h"
 
+#include <string.h>
+
 #include <string>
 #include <utility>
 #include <vector>
@@ -14,6 +16,39 @@
 
 namespace orbit_linux_tracing {
 
+namespace {
+// Reads fields of the record at the tail of a PerfEventRingBuffer. When the record doesn't wrap
+// around the end of the ring buffer, which is the common case, the fields are copied directly from
+// the mmapped region, without going through the checks of PerfEventRingBuffer::ReadRawAtOffset
+// (and the acquire load of data_head) for every single field.
+class RecordReader {
+ public:
+  explicit RecordReader(PerfEventRingBuffer* ring_buffer, const perf_event_header& header)
+      : ring_buffer_{ring_buffer},
+        record_{ring_buffer->GetRecordAtTailIfContiguous(header)},
+        record_size_{header.size} {}
+
+  void ReadRawAtOffset(void* dest, uint64_t offset, uint64_t count) {
+    if (record_ == nullptr) {
+      ring_buffer_->ReadRawAtOffset(dest, offset, count);
+      return;
+    }
+    CHECK(offset + count <= record_size_);
+    memcpy(dest, record_ + offset, count);
+  }
+
+  template <typename T>
+  void ReadValueAtOffset(T* value, uint64_t offset) {
+    ReadRawAtOffset(value, offset, sizeof(T));
+  }
+
+ private:
+  PerfEventRingBuffer* ring_buffer_;
+  const char* record_;
+  uint64_t record_size_;
+};
+}  // namespace
+
 void ReadPerfSampleIdAll(PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
                          perf_event_sample_id_tid_time_streamid_cpu* sample_id) {
   CHECK(sample_id != nullptr);
@@ -84,8 +119,10 @@ std::unique_ptr<MmapPerfEvent> ConsumeMmapPerfEvent(PerfEventRingBuffer* ring_bu
   perf_event_sample_id_tid_time_streamid_cpu sample_id;
   ReadPerfSampleIdAll(ring_buffer, header, &sample_id);
 
+  RecordReader record_reader{ring_buffer, header};
+
   perf_event_mmap_up_to_pgoff mmap_event;
-  ring_buffer->ReadValueAtOffset(&mmap_event, 0);
+  record_reader.ReadValueAtOffset(&mmap_event, 0);
 
   // read filename
   size_t filename_offset = sizeof(perf_event_mmap_up_to_pgoff);
@@ -94,7 +131,7 @@ std::unique_ptr<MmapPerfEvent> ConsumeMmapPerfEvent(PerfEventRingBuffer* ring_bu
   size_t filename_size =
       header.size - filename_offset - sizeof(perf_event_sample_id_tid_time_streamid_cpu);
   std::vector<char> filename_vector(filename_size);
-  ring_buffer->ReadRawAtOffset(&filename_vector[0], filename_offset, filename_size);
+  record_reader.ReadRawAtOffset(&filename_vector[0], filename_offset, filename_size);
   // This is a bit paranoid but you never know
   filename_vector[filename_size - 1] = '\0';
   std::string filename(filename_vector.data());
@@ -128,34 +165,38 @@ std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(PerfEventRingB
   // Unfortunately, the value of `size` is not constant, so we need to compute the offsets by hand,
   // rather than relying on a struct.
 
+  RecordReader record_reader{ring_buffer, header};
+
   size_t offset_of_size =
       offsetof(perf_event_stack_sample_fixed, regs) + sizeof(perf_event_sample_regs_user_all);
   size_t offset_of_data = offset_of_size + sizeof(uint64_t);
 
   uint64_t size = 0;
-  ring_buffer->ReadValueAtOffset(&size, offset_of_size);
+  record_reader.ReadValueAtOffset(&size, offset_of_size);
 
   size_t offset_of_dyn_size = offset_of_data + (size * sizeof(char));
 
   uint64_t dyn_size = 0;
-  ring_buffer->ReadValueAtOffset(&dyn_size, offset_of_dyn_size);
+  record_reader.ReadValueAtOffset(&dyn_size, offset_of_dyn_size);
 
   auto event = std::make_unique<StackSamplePerfEvent>(dyn_size);
   event->ring_buffer_record.header = header;
-  ring_buffer->ReadValueAtOffset(&event->ring_buffer_record.sample_id,
-                                 offsetof(perf_event_stack_sample_fixed, sample_id));
-  ring_buffer->ReadValueAtOffset(&event->ring_buffer_record.regs,
-                                 offsetof(perf_event_stack_sample_fixed, regs));
-  ring_buffer->ReadRawAtOffset(event->ring_buffer_record.stack.data.get(), offset_of_data,
-                               dyn_size);
+  record_reader.ReadValueAtOffset(&event->ring_buffer_record.sample_id,
+                                  offsetof(perf_event_stack_sample_fixed, sample_id));
+  record_reader.ReadValueAtOffset(&event->ring_buffer_record.regs,
+                                  offsetof(perf_event_stack_sample_fixed, regs));
+  record_reader.ReadRawAtOffset(event->ring_buffer_record.stack.data.get(), offset_of_data,
+                                dyn_size);
   ring_buffer->SkipRecord(header);
   return event;
 }
 
 std::unique_ptr<CallchainSamplePerfEvent> ConsumeCallchainSamplePerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+  RecordReader record_reader{ring_buffer, header};
+
   uint64_t nr = 0;
-  ring_buffer->ReadValueAtOffset(&nr, offsetof(perf_event_callchain_sample_fixed, nr));
+  record_reader.ReadValueAtOffset(&nr, offsetof(perf_event_callchain_sample_fixed, nr));
 
   uint64_t size_of_ips_in_bytes = nr * sizeof(uint64_t) / sizeof(char);
 
@@ -185,30 +226,40 @@ std::unique_ptr<CallchainSamplePerfEvent> ConsumeCallchainSamplePerfEvent(
   size_t offset_of_data = offset_of_size + sizeof(uint64_t);
 
   uint64_t size = 0;
-  ring_buffer->ReadRawAtOffset(&size, offset_of_size, sizeof(uint64_t));
+  record_reader.ReadRawAtOffset(&size, offset_of_size, sizeof(uint64_t));
 
   size_t offset_of_dyn_size = offset_of_data + (size * sizeof(char));
 
   uint64_t dyn_size = 0;
-  ring_buffer->ReadRawAtOffset(&dyn_size, offset_of_dyn_size, sizeof(uint64_t));
+  record_reader.ReadRawAtOffset(&dyn_size, offset_of_dyn_size, sizeof(uint64_t));
   auto event = std::make_unique<CallchainSamplePerfEvent>(nr, dyn_size);
   event->ring_buffer_record.header = header;
-  ring_buffer->ReadValueAtOffset(&event->ring_buffer_record.sample_id,
-                                 offsetof(perf_event_callchain_sample_fixed, sample_id));
+  record_reader.ReadValueAtOffset(&event->ring_buffer_record.sample_id,
+                                  offsetof(perf_event_callchain_sample_fixed, sample_id));
 
-  ring_buffer->ReadRawAtOffset(event->ips.data(), offset_of_ips, size_of_ips_in_bytes);
+  record_reader.ReadRawAtOffset(event->ips.data(), offset_of_ips, size_of_ips_in_bytes);
+  event->MoveKernelFramesOutOfCallchain();
 
-  ring_buffer->ReadRawAtOffset(&event->regs, offset_of_regs_user_struct,
-                               sizeof(perf_event_sample_regs_user_all));
-  ring_buffer->ReadRawAtOffset(event->stack.data.get(), offset_of_data, dyn_size);
+  record_reader.ReadRawAtOffset(&event->regs, offset_of_regs_user_struct,
+                                sizeof(perf_event_sample_regs_user_all));
+  record_reader.ReadRawAtOffset(event->stack.data.get(), offset_of_data, dyn_size);
   ring_buffer->SkipRecord(header);
   return event;
 }
 
 std::unique_ptr<GenericTracepointPerfEvent> ConsumeGenericTracepointPerfEvent(
-    PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header, bool copy_raw_data) {
   auto event = std::make_unique<GenericTracepointPerfEvent>();
-  ring_buffer->ReadRawAtOffset(&event->ring_buffer_record, 0, sizeof(perf_event_raw_sample_fixed));
+  RecordReader record_reader{ring_buffer, header};
+  record_reader.ReadRawAtOffset(&event->ring_buffer_record, 0, sizeof(perf_event_raw_sample_fixed));
+  if (copy_raw_data) {
+    // The size of the raw data includes the padding that aligns the record to 8 bytes.
+    uint32_t raw_data_size = event->ring_buffer_record.size;
+    CHECK(sizeof(perf_event_raw_sample_fixed) + raw_data_size <= header.size);
+    event->raw_data.resize(raw_data_size);
+    record_reader.ReadRawAtOffset(event->raw_data.data(), sizeof(perf_event_raw_sample_fixed),
+                                  raw_data_size);
+  }
   ring_buffer->SkipRecord(header);
   return event;
 }
@@ -11,8 +11,11 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <optional>
 #include <type_traits>
+#include <utility>
 
+#include "DrmGpuTracepoints.h"
 #include "PerfEvent.h"
 #include "PerfEventRecords.h"
 #include "PerfEventRingBuffer.h"
@@ -41,8 +44,10 @@ std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(PerfEventRingB
 std::unique_ptr<CallchainSamplePerfEvent> ConsumeCallchainSamplePerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
 
+// The raw data of the tracepoint is only copied into the event if `copy_raw_data` is set, as most
+// tracepoints are only interested in the fixed part of the record.
 std::unique_ptr<GenericTracepointPerfEvent> ConsumeGenericTracepointPerfEvent(
-    PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header, bool copy_raw_data);
 
 std::unique_ptr<MmapPerfEvent> ConsumeMmapPerfEvent(PerfEventRingBuffer* ring_buffer,
                                                     const perf_event_header& header);
@@ -62,6 +67,34 @@ std::unique_ptr<T> ConsumeVariableSizeTracepointPerfEvent(PerfEventRingBuffer* r
   return event;
 }
 
+// Returns nullptr if the raw data of the record doesn't match `layout`.
+template <typename T, typename = std::enable_if_t<std::is_base_of_v<DrmSchedPerfEvent, T>>>
+std::unique_ptr<T> ConsumeDrmSchedPerfEvent(PerfEventRingBuffer* ring_buffer,
+                                            const perf_event_header& header,
+                                            const DrmSchedTracepointLayout& layout) {
+  std::unique_ptr<GenericTracepointPerfEvent> raw_event =
+      ConsumeGenericTracepointPerfEvent(ring_buffer, header, /*copy_raw_data=*/true);
+  std::optional<DrmSchedTracepointData> data = DecodeDrmSchedTracepoint(
+      layout, raw_event->raw_data.data(), raw_event->raw_data.size());
+  if (!data.has_value()) return nullptr;
+  return std::make_unique<T>(raw_event->GetTimestamp(), raw_event->GetPid(), raw_event->GetTid(),
+                             data->fence, data->id, std::move(data->timeline));
+}
+
+// Returns nullptr if the raw data of the record doesn't match `layout`.
+template <typename T, typename = std::enable_if_t<std::is_base_of_v<I915RequestPerfEvent, T>>>
+std::unique_ptr<T> ConsumeI915RequestPerfEvent(PerfEventRingBuffer* ring_buffer,
+                                               const perf_event_header& header,
+                                               const I915RequestTracepointLayout& layout) {
+  std::unique_ptr<GenericTracepointPerfEvent> raw_event =
+      ConsumeGenericTracepointPerfEvent(ring_buffer, header, /*copy_raw_data=*/true);
+  std::optional<I915RequestTracepointData> data = DecodeI915RequestTracepoint(
+      layout, raw_event->raw_data.data(), raw_event->raw_data.size());
+  if (!data.has_value()) return nullptr;
+  return std::make_unique<T>(raw_event->GetTimestamp(), raw_event->GetPid(), raw_event->GetTid(),
+                             data->context, data->seqno, std::move(data->timeline));
+}
+
 }  // namespace orbit_linux_tracing
 
 #endif  // LINUX_TRACING_PERF_EVENT_READERS_H_
@@ -168,6 +168,29 @@ struct __attribute__((__packed__)) perf_event_throttle_unthrottle {
   perf_event_sample_id_tid_time_streamid_cpu sample_id;
 };
 
+// The counters of a group opened by pmu_counters_sample_event_open, in the order in which they are
+// read with PERF_FORMAT_GROUP. The group leader, whose value comes first, is the cpu-clock event
+// that triggers the samples.
+enum PmuCounterIndex : size_t {
+  kPmuCounterCpuClock = 0,
+  kPmuCounterCycles,
+  kPmuCounterInstructions,
+  kPmuCounterLlcMisses,
+  kPmuCounterBranchMisses,
+  kPmuCounterCount,
+};
+
+struct __attribute__((__packed__)) perf_event_pmu_counters_sample {
+  perf_event_header header;
+  perf_event_sample_id_tid_time_streamid_cpu sample_id;
+  // PERF_SAMPLE_READ with PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+  // PERF_FORMAT_TOTAL_TIME_RUNNING.
+  uint64_t nr;
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t values[kPmuCounterCount];
+};
+
 }  // namespace orbit_linux_tracing
 
 #endif  // LINUX_TRACING_PERF_EVENT_RECORDS_H_
@@ -9,7 +9,9 @@
 #include <string.h>
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <memory>
 #include <utility>
 
 #include "LinuxTracingUtils.h"
@@ -56,6 +58,8 @@ PerfEventRingBuffer::PerfEventRingBuffer(int perf_event_fd, uint64_t size_kb, st
   ring_buffer_size_log2_ = __builtin_ffsl(ring_buffer_size_) - 1;
   mmap_length_ = GetPageSize() + ring_buffer_size_;
 
+  // The kernel allocates the pages of the ring buffer of a per-CPU event on the NUMA node of that
+  // CPU, where the records are written, so only the reads by the tracer thread can be remote.
   void* mmap_address = perf_event_open_mmap_ring_buffer(perf_event_fd, mmap_length_);
   if (mmap_address == nullptr) {
     return;
@@ -75,8 +79,11 @@ PerfEventRingBuffer::PerfEventRingBuffer(PerfEventRingBuffer&& o) noexcept {
   std::swap(ring_buffer_, o.ring_buffer_);
   std::swap(ring_buffer_size_, o.ring_buffer_size_);
   std::swap(ring_buffer_size_log2_, o.ring_buffer_size_log2_);
+  std::swap(max_used_bytes_, o.max_used_bytes_);
   std::swap(file_descriptor_, o.file_descriptor_);
   std::swap(name_, o.name_);
+  std::swap(owned_metadata_page_, o.owned_metadata_page_);
+  std::swap(owned_ring_buffer_, o.owned_ring_buffer_);
 }
 
 PerfEventRingBuffer& PerfEventRingBuffer::operator=(PerfEventRingBuffer&& o) noexcept {
@@ -86,14 +93,42 @@ PerfEventRingBuffer& PerfEventRingBuffer::operator=(PerfEventRingBuffer&& o) noe
     std::swap(ring_buffer_, o.ring_buffer_);
     std::swap(ring_buffer_size_, o.ring_buffer_size_);
     std::swap(ring_buffer_size_log2_, o.ring_buffer_size_log2_);
+    std::swap(max_used_bytes_, o.max_used_bytes_);
     std::swap(file_descriptor_, o.file_descriptor_);
     std::swap(name_, o.name_);
+    std::swap(owned_metadata_page_, o.owned_metadata_page_);
+    std::swap(owned_ring_buffer_, o.owned_ring_buffer_);
   }
   return *this;
 }
 
+PerfEventRingBuffer PerfEventRingBuffer::CreateFromRecords(std::string_view records,
+                                                           int file_descriptor, std::string name) {
+  PerfEventRingBuffer ring_buffer;
+  ring_buffer.file_descriptor_ = file_descriptor;
+  ring_buffer.name_ = std::move(name);
+
+  // As for the real ring buffers, the size must be a power of two.
+  ring_buffer.ring_buffer_size_ = GetPageSize();
+  while (ring_buffer.ring_buffer_size_ < records.size()) {
+    ring_buffer.ring_buffer_size_ *= 2;
+  }
+  ring_buffer.ring_buffer_size_log2_ = __builtin_ffsl(ring_buffer.ring_buffer_size_) - 1;
+
+  ring_buffer.owned_ring_buffer_ = std::make_unique<char[]>(ring_buffer.ring_buffer_size_);
+  memcpy(ring_buffer.owned_ring_buffer_.get(), records.data(), records.size());
+  ring_buffer.ring_buffer_ = ring_buffer.owned_ring_buffer_.get();
+
+  ring_buffer.owned_metadata_page_ = std::make_unique<perf_event_mmap_page>();
+  ring_buffer.metadata_page_ = ring_buffer.owned_metadata_page_.get();
+  ring_buffer.metadata_page_->data_size = ring_buffer.ring_buffer_size_;
+  ring_buffer.metadata_page_->data_head = records.size();
+  ring_buffer.metadata_page_->data_tail = 0;
+  return ring_buffer;
+}
+
 PerfEventRingBuffer::~PerfEventRingBuffer() {
-  if (metadata_page_ != nullptr) {
+  if (metadata_page_ != nullptr && owned_metadata_page_ == nullptr) {
     int munmap_ret = munmap(metadata_page_, mmap_length_);
     if (munmap_ret != 0) {
       ERROR("munmap: %s", SafeStrerror(errno));
@@ -106,6 +141,7 @@ bool PerfEventRingBuffer::HasNewData() {
   uint64_t head = ReadRingBufferHead(metadata_page_);
   DCHECK((metadata_page_->data_tail == head) ||
          (head >= metadata_page_->data_tail + sizeof(perf_event_header)));
+  max_used_bytes_ = std::max(max_used_bytes_, head - metadata_page_->data_tail);
   return head > metadata_page_->data_tail;
 }
 
@@ -121,6 +157,16 @@ void PerfEventRingBuffer::SkipRecord(const perf_event_header& header) {
   WriteRingBufferTail(metadata_page_, new_tail);
 }
 
+const char* PerfEventRingBuffer::GetRecordAtTailIfContiguous(const perf_event_header& header) {
+  DCHECK(IsOpen());
+  DCHECK(metadata_page_->data_tail + header.size <= ReadRingBufferHead(metadata_page_));
+  const uint64_t tail_mod_size = metadata_page_->data_tail & (ring_buffer_size_ - 1);
+  if (tail_mod_size + header.size > ring_buffer_size_) {
+    return nullptr;
+  }
+  return ring_buffer_ + tail_mod_size;
+}
+
 void PerfEventRingBuffer::ConsumeRawRecord(const perf_event_header& header, void* record) {
   ReadAtTail(static_cast<uint8_t*>(record), header.size);
   SkipRecord(header);
@@ -8,7 +8,9 @@
 #include <linux/perf_event.h>
 #include <stdint.h>
 
+#include <memory>
 #include <string>
+#include <string_view>
 
 #include "OrbitBase/Logging.h"
 
@@ -19,6 +21,13 @@ class PerfEventRingBuffer {
   explicit PerfEventRingBuffer(int perf_event_fd, uint64_t size_kb, std::string name);
   ~PerfEventRingBuffer();
 
+  // Creates a ring buffer that is not backed by a perf_event_open file descriptor, but that
+  // contains the given records, as if they had been written by the kernel and not read yet. This is
+  // used to replay perf record corpora. file_descriptor is only returned by GetFileDescriptor.
+  [[nodiscard]] static PerfEventRingBuffer CreateFromRecords(std::string_view records,
+                                                             int file_descriptor,
+                                                             std::string name);
+
   PerfEventRingBuffer(PerfEventRingBuffer&&) noexcept;
   PerfEventRingBuffer& operator=(PerfEventRingBuffer&&) noexcept;
 
@@ -28,6 +37,12 @@ class PerfEventRingBuffer {
   bool IsOpen() const { return ring_buffer_ != nullptr; }
   int GetFileDescriptor() const { return file_descriptor_; }
   const std::string& GetName() const { return name_; }
+  uint64_t GetSizeKb() const { return ring_buffer_size_ / 1024; }
+
+  // The most bytes that were waiting to be read when HasNewData was called, or the whole size once
+  // records were lost, as reported with OnRecordsLost.
+  uint64_t GetMaxUsedBytes() const { return max_used_bytes_; }
+  void OnRecordsLost() { max_used_bytes_ = ring_buffer_size_; }
 
   bool HasNewData();
   void ReadHeader(perf_event_header* header);
@@ -48,6 +63,13 @@ class PerfEventRingBuffer {
     ReadAtOffsetFromTail(dest, offset, count);
   }
 
+  // Returns a pointer to the record at the tail, directly inside the mmapped ring buffer, if the
+  // record doesn't wrap around the end of the ring buffer. Returns nullptr otherwise, in which case
+  // the record needs to be read with the functions above. This allows parsing a record in place,
+  // without copying every field out of the ring buffer separately. The pointer is only valid until
+  // the record is skipped with SkipRecord.
+  [[nodiscard]] const char* GetRecordAtTailIfContiguous(const perf_event_header& header);
+
  private:
   uint64_t mmap_length_ = 0;
   perf_event_mmap_page* metadata_page_ = nullptr;
@@ -56,8 +78,14 @@ class PerfEventRingBuffer {
   // The buffer length needs to be a power of 2, hence we can use shifting for
   // division.
   uint32_t ring_buffer_size_log2_ = 0;
+  uint64_t max_used_bytes_ = 0;
   int file_descriptor_ = -1;
   std::string name_;
+  // Only set for the ring buffers created with CreateFromRecords, which are not mmapped.
+  std::unique_ptr<perf_event_mmap_page> owned_metadata_page_;
+  std::unique_ptr<char[]> owned_ring_buffer_;
+
+  PerfEventRingBuffer() = default;
 
   // ConsumeRawRecord reads header.size bytes into record buffer and then skips the record.
   void ConsumeRawRecord(const perf_event_header& header, void* record);
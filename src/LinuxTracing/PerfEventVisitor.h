@@ -19,10 +19,12 @@ class PerfEventVisitor {
   virtual void Visit(SystemWideContextSwitchPerfEvent* /*event*/) {}
   virtual void Visit(StackSamplePerfEvent* /*event*/) {}
   virtual void Visit(CallchainSamplePerfEvent* /*event*/) {}
+  virtual void Visit(PmuCountersSamplePerfEvent* /*event*/) {}
   virtual void Visit(UprobesPerfEvent* /*event*/) {}
   virtual void Visit(UretprobesPerfEvent* /*event*/) {}
   virtual void Visit(LostPerfEvent* /*event*/) {}
   virtual void Visit(DiscardedPerfEvent* /*event*/) {}
+  virtual void Visit(PipelineLatencyProbePerfEvent* /*event*/) {}
   virtual void Visit(MmapPerfEvent* /*event*/) {}
   virtual void Visit(TaskNewtaskPerfEvent* /*event*/) {}
   virtual void Visit(TaskRenamePerfEvent* /*event*/) {}
@@ -31,6 +33,11 @@ class PerfEventVisitor {
   virtual void Visit(AmdgpuCsIoctlPerfEvent* /*event*/) {}
   virtual void Visit(AmdgpuSchedRunJobPerfEvent* /*event*/) {}
   virtual void Visit(DmaFenceSignaledPerfEvent* /*event*/) {}
+  virtual void Visit(DrmSchedJobPerfEvent* /*event*/) {}
+  virtual void Visit(DrmRunJobPerfEvent* /*event*/) {}
+  virtual void Visit(DrmSchedProcessJobPerfEvent* /*event*/) {}
+  virtual void Visit(I915RequestAddPerfEvent* /*event*/) {}
+  virtual void Visit(I915RequestInPerfEvent* /*event*/) {}
   virtual void Visit(GenericTracepointPerfEvent* /*event*/) {}
 };
 
@@ -0,0 +1,138 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerfRecordCorpus.h"
+
+#include <absl/strings/str_format.h>
+#include <string.h>
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "OrbitBase/ReadFileToString.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr size_t kSignatureSize = sizeof(kPerfRecordCorpusSignature) - 1;
+
+template <typename T>
+void AppendValue(std::string* buffer, const T& value) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+[[nodiscard]] bool ReadValue(std::string_view* content, T* value) {
+  if (content->size() < sizeof(T)) return false;
+  memcpy(value, content->data(), sizeof(T));
+  content->remove_prefix(sizeof(T));
+  return true;
+}
+
+[[nodiscard]] ErrorMessage CreateCorpusError(const std::filesystem::path& file_path,
+                                             std::string_view problem) {
+  return ErrorMessage{absl::StrFormat("Perf record corpus \"%s\" %s", file_path.string(), problem)};
+}
+
+}  // namespace
+
+ErrorMessageOr<PerfRecordCorpus> ReadPerfRecordCorpus(const std::filesystem::path& file_path) {
+  OUTCOME_TRY(file_content, orbit_base::ReadFileToString(file_path));
+  std::string_view content = file_content;
+
+  if (content.substr(0, kSignatureSize) != std::string_view{kPerfRecordCorpusSignature}) {
+    return CreateCorpusError(file_path, "has an invalid signature");
+  }
+  content.remove_prefix(kSignatureSize);
+
+  uint32_t version = 0;
+  uint64_t header_size = 0;
+  if (!ReadValue(&content, &version) || !ReadValue(&content, &header_size)) {
+    return CreateCorpusError(file_path, "is truncated");
+  }
+  if (version != kPerfRecordCorpusVersion) {
+    return CreateCorpusError(file_path, absl::StrFormat("has unsupported version %u", version));
+  }
+
+  PerfRecordCorpus corpus;
+  if (header_size > content.size() ||
+      !corpus.header.ParseFromArray(content.data(), static_cast<int>(header_size))) {
+    return CreateCorpusError(file_path, "has an invalid header");
+  }
+  content.remove_prefix(header_size);
+
+  corpus.records_by_ring_buffer.resize(corpus.header.ring_buffers_size());
+  while (!content.empty()) {
+    uint32_t ring_buffer_index = 0;
+    perf_event_header header{};
+    if (!ReadValue(&content, &ring_buffer_index) ||
+        content.size() < sizeof(perf_event_header)) {
+      return CreateCorpusError(file_path, "is truncated");
+    }
+    memcpy(&header, content.data(), sizeof(perf_event_header));
+    if (ring_buffer_index >= corpus.records_by_ring_buffer.size() ||
+        header.size < sizeof(perf_event_header) || header.size > content.size()) {
+      return CreateCorpusError(file_path, "is corrupted");
+    }
+    corpus.records_by_ring_buffer[ring_buffer_index].append(content.data(), header.size);
+    content.remove_prefix(header.size);
+  }
+  return corpus;
+}
+
+ErrorMessageOr<std::unique_ptr<PerfRecordCorpusWriter>> PerfRecordCorpusWriter::Create(
+    const std::filesystem::path& file_path,
+    const orbit_grpc_protos::PerfRecordCorpusHeader& header) {
+  OUTCOME_TRY(fd, orbit_base::OpenFileForWriting(file_path));
+  std::unique_ptr<PerfRecordCorpusWriter> writer{new PerfRecordCorpusWriter{std::move(fd)}};
+
+  absl::MutexLock lock{&writer->mutex_};
+  writer->buffer_.append(kPerfRecordCorpusSignature, kSignatureSize);
+  AppendValue(&writer->buffer_, kPerfRecordCorpusVersion);
+  const std::string serialized_header = header.SerializeAsString();
+  AppendValue(&writer->buffer_, static_cast<uint64_t>(serialized_header.size()));
+  writer->buffer_.append(serialized_header);
+  writer->WriteBuffer();
+  if (writer->error_.has_value()) {
+    return writer->error_.value();
+  }
+  return writer;
+}
+
+void PerfRecordCorpusWriter::AppendRecord(uint32_t ring_buffer_index, const void* record) {
+  perf_event_header header;
+  memcpy(&header, record, sizeof(perf_event_header));
+
+  absl::MutexLock lock{&mutex_};
+  if (error_.has_value()) return;
+  AppendValue(&buffer_, ring_buffer_index);
+  buffer_.append(static_cast<const char*>(record), header.size);
+  if (buffer_.size() >= kBufferSizeBytes) {
+    WriteBuffer();
+  }
+}
+
+ErrorMessageOr<void> PerfRecordCorpusWriter::Finish() {
+  absl::MutexLock lock{&mutex_};
+  WriteBuffer();
+  if (error_.has_value()) {
+    return error_.value();
+  }
+  return outcome::success();
+}
+
+void PerfRecordCorpusWriter::WriteBuffer() {
+  if (!error_.has_value() && !buffer_.empty()) {
+    if (auto result = orbit_base::WriteFully(fd_, buffer_); result.has_error()) {
+      error_ = ErrorMessage{
+          absl::StrFormat("Writing perf record corpus: %s", result.error().message())};
+    }
+  }
+  buffer_.clear();
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,72 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PERF_RECORD_CORPUS_H_
+#define LINUX_TRACING_PERF_RECORD_CORPUS_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <linux/perf_event.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "perf_record_corpus.pb.h"
+
+namespace orbit_linux_tracing {
+
+// A perf record corpus file starts with kPerfRecordCorpusSignature, the version as a uint32_t, the
+// size of the serialized PerfRecordCorpusHeader as a uint64_t and the header itself. Then follow
+// the records, each prefixed with the index of its ring buffer in the header as a uint32_t. As
+// each record starts with its perf_event_header, the size of a record doesn't need to be stored.
+inline constexpr char kPerfRecordCorpusSignature[] = "ORBITPRC";
+inline constexpr uint32_t kPerfRecordCorpusVersion = 1;
+
+// The content of a perf record corpus file, with the records grouped by ring buffer, in the order
+// in which they were read.
+struct PerfRecordCorpus {
+  orbit_grpc_protos::PerfRecordCorpusHeader header;
+  // Indexed like header.ring_buffers().
+  std::vector<std::string> records_by_ring_buffer;
+};
+
+[[nodiscard]] ErrorMessageOr<PerfRecordCorpus> ReadPerfRecordCorpus(
+    const std::filesystem::path& file_path);
+
+// Writes a perf record corpus file. The records are buffered and written in large chunks.
+// AppendRecord can be called concurrently, as it is by the threads reading from the ring buffers.
+class PerfRecordCorpusWriter {
+ public:
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<PerfRecordCorpusWriter>> Create(
+      const std::filesystem::path& file_path,
+      const orbit_grpc_protos::PerfRecordCorpusHeader& header);
+
+  // record points to the perf_event_header of the record, followed by the rest of the record.
+  void AppendRecord(uint32_t ring_buffer_index, const void* record);
+
+  // Writes the remaining buffered records and returns the first error encountered, if any.
+  [[nodiscard]] ErrorMessageOr<void> Finish();
+
+ private:
+  explicit PerfRecordCorpusWriter(orbit_base::unique_fd fd) : fd_{std::move(fd)} {}
+  void WriteBuffer() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  static constexpr size_t kBufferSizeBytes = 4 * 1024 * 1024;
+
+  absl::Mutex mutex_;
+  orbit_base::unique_fd fd_ ABSL_GUARDED_BY(mutex_);
+  std::string buffer_ ABSL_GUARDED_BY(mutex_);
+  // Once an error occurs, no more records are written.
+  std::optional<ErrorMessage> error_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PERF_RECORD_CORPUS_H_
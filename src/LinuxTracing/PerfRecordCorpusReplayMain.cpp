@@ -0,0 +1,200 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/Logging.h"
+#include "PerfRecordCorpus.h"
+#include "TracerThread.h"
+#include "capture.pb.h"
+
+ABSL_FLAG(std::string, corpus, "", "Path of the perf record corpus to replay");
+ABSL_FLAG(uint32_t, repetitions, 1,
+          "How many times to replay the corpus. The number of events produced is compared across "
+          "repetitions, as replaying is deterministic");
+
+namespace {
+
+// Only counts the events produced by the TracerThread, so that the time measured is the time spent
+// in LinuxTracing.
+class CountingTracerListener : public orbit_linux_tracing::TracerListener {
+ public:
+  void OnSchedulingSlice(orbit_grpc_protos::SchedulingSlice /*scheduling_slice*/) override {
+    ++scheduling_slice_count_;
+  }
+  void OnCallstackSample(orbit_grpc_protos::FullCallstackSample /*callstack_sample*/) override {
+    ++callstack_sample_count_;
+  }
+  void OnFunctionCall(orbit_grpc_protos::FunctionCall /*function_call*/) override {
+    ++function_call_count_;
+  }
+  void OnIntrospectionScope(
+      orbit_grpc_protos::IntrospectionScope /*introspection_scope*/) override {
+    ++other_event_count_;
+  }
+  void OnGpuJob(orbit_grpc_protos::FullGpuJob /*gpu_job*/) override { ++gpu_job_count_; }
+  void OnThreadName(orbit_grpc_protos::ThreadName /*thread_name*/) override {
+    ++other_event_count_;
+  }
+  void OnThreadNamesSnapshot(
+      orbit_grpc_protos::ThreadNamesSnapshot /*thread_names_snapshot*/) override {
+    ++other_event_count_;
+  }
+  void OnThreadStateSlice(orbit_grpc_protos::ThreadStateSlice /*thread_state_slice*/) override {
+    ++thread_state_slice_count_;
+  }
+  void OnAddressInfo(orbit_grpc_protos::FullAddressInfo /*full_address_info*/) override {
+    ++other_event_count_;
+  }
+  void OnTracepointEvent(orbit_grpc_protos::FullTracepointEvent /*tracepoint_event*/) override {
+    ++other_event_count_;
+  }
+  void OnModulesSnapshot(orbit_grpc_protos::ModulesSnapshot /*modules_snapshot*/) override {
+    ++other_event_count_;
+  }
+  void OnModuleUpdate(orbit_grpc_protos::ModuleUpdateEvent /*module_update_event*/) override {
+    ++other_event_count_;
+  }
+  void OnErrorsWithPerfEventOpenEvent(
+      orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/)
+      override {
+    ++other_event_count_;
+  }
+  void OnLostPerfRecordsEvent(
+      orbit_grpc_protos::LostPerfRecordsEvent /*lost_perf_records_event*/) override {
+    ++other_event_count_;
+  }
+  void OnOutOfOrderEventsDiscardedEvent(
+      orbit_grpc_protos::OutOfOrderEventsDiscardedEvent /*out_of_order_events_discarded_event*/)
+      override {
+    ++other_event_count_;
+  }
+  void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent /*sampling_period_changed_event*/) override {
+    ++other_event_count_;
+  }
+  void OnPmuCountersSample(orbit_grpc_protos::PmuCountersSample /*pmu_counters_sample*/) override {
+    ++other_event_count_;
+  }
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {
+    ++other_event_count_;
+  }
+  void OnServiceHealthEvent(
+      orbit_grpc_protos::ServiceHealthEvent /*service_health_event*/) override {
+    ++other_event_count_;
+  }
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/) override {
+    ++other_event_count_;
+  }
+  void OnCaptureStatisticsSummary(
+      orbit_grpc_protos::CaptureStatisticsSummary /*capture_statistics_summary*/) override {
+    ++other_event_count_;
+  }
+
+  [[nodiscard]] uint64_t GetTotalEventCount() const {
+    return scheduling_slice_count_ + callstack_sample_count_ + function_call_count_ +
+           gpu_job_count_ + thread_state_slice_count_ + other_event_count_;
+  }
+
+  void PrintCounts() const {
+    LOG("  scheduling slices: %u", scheduling_slice_count_);
+    LOG("  callstack samples: %u", callstack_sample_count_);
+    LOG("  function calls: %u", function_call_count_);
+    LOG("  GPU jobs: %u", gpu_job_count_);
+    LOG("  thread state slices: %u", thread_state_slice_count_);
+    LOG("  other events: %u", other_event_count_);
+  }
+
+ private:
+  uint64_t scheduling_slice_count_ = 0;
+  uint64_t callstack_sample_count_ = 0;
+  uint64_t function_call_count_ = 0;
+  uint64_t gpu_job_count_ = 0;
+  uint64_t thread_state_slice_count_ = 0;
+  uint64_t other_event_count_ = 0;
+};
+
+[[nodiscard]] uint64_t CountRecords(const orbit_linux_tracing::PerfRecordCorpus& corpus) {
+  uint64_t record_count = 0;
+  for (std::string_view records : corpus.records_by_ring_buffer) {
+    while (!records.empty()) {
+      perf_event_header header;
+      memcpy(&header, records.data(), sizeof(perf_event_header));
+      records.remove_prefix(header.size);
+      ++record_count;
+    }
+  }
+  return record_count;
+}
+
+[[nodiscard]] std::chrono::nanoseconds GetProcessCpuTime() {
+  timespec ts{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Replays the processing of the perf_event_open records of a perf record corpus by "
+      "LinuxTracing, and reports how long it took");
+  absl::ParseCommandLine(argc, argv);
+
+  const std::filesystem::path corpus_path = absl::GetFlag(FLAGS_corpus);
+  FAIL_IF(corpus_path.empty(), "Perf record corpus not specified");
+  const uint32_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  FAIL_IF(repetitions == 0, "The number of repetitions must be positive");
+
+  ErrorMessageOr<orbit_linux_tracing::PerfRecordCorpus> corpus_or_error =
+      orbit_linux_tracing::ReadPerfRecordCorpus(corpus_path);
+  FAIL_IF(corpus_or_error.has_error(), "%s", corpus_or_error.error().message());
+  const orbit_linux_tracing::PerfRecordCorpus& corpus = corpus_or_error.value();
+  const uint64_t record_count = CountRecords(corpus);
+  LOG("Replaying %u records from %u ring buffers", record_count, corpus.header.ring_buffers_size());
+
+  std::optional<uint64_t> first_total_event_count;
+  for (uint32_t repetition = 0; repetition < repetitions; ++repetition) {
+    CountingTracerListener listener;
+    orbit_linux_tracing::TracerThread tracer_thread{corpus.header.capture_options()};
+    tracer_thread.SetListener(&listener);
+
+    const auto wall_begin = std::chrono::steady_clock::now();
+    const std::chrono::nanoseconds cpu_begin = GetProcessCpuTime();
+    tracer_thread.Replay(corpus);
+    const std::chrono::duration<double> wall_duration =
+        std::chrono::steady_clock::now() - wall_begin;
+    const std::chrono::duration<double> cpu_duration = GetProcessCpuTime() - cpu_begin;
+
+    LOG("Repetition %u: %.3f s wall time, %.3f s CPU time, %.0f records/s, %u events", repetition,
+        wall_duration.count(), cpu_duration.count(), record_count / wall_duration.count(),
+        listener.GetTotalEventCount());
+    listener.PrintCounts();
+
+    if (!first_total_event_count.has_value()) {
+      first_total_event_count = listener.GetTotalEventCount();
+    } else if (first_total_event_count.value() != listener.GetTotalEventCount()) {
+      ERROR("Repetition %u produced %u events instead of %u", repetition,
+            listener.GetTotalEventCount(), first_total_event_count.value());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <linux/perf_event.h>
+#include <string.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "PerfEventRingBuffer.h"
+#include "PerfRecordCorpus.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// A fake record of the given size, made of its perf_event_header followed by filler bytes.
+std::string CreateRecord(uint16_t size, char filler) {
+  CHECK(size >= sizeof(perf_event_header));
+  perf_event_header header{};
+  header.type = PERF_RECORD_SAMPLE;
+  header.size = size;
+  std::string record(size, filler);
+  memcpy(record.data(), &header, sizeof(perf_event_header));
+  return record;
+}
+
+orbit_grpc_protos::PerfRecordCorpusHeader CreateHeaderWithRingBuffers(int ring_buffer_count) {
+  orbit_grpc_protos::PerfRecordCorpusHeader header;
+  header.mutable_capture_options()->set_pid(42);
+  header.set_effective_capture_start_timestamp_ns(1234);
+  for (int i = 0; i < ring_buffer_count; ++i) {
+    orbit_grpc_protos::PerfRecordCorpusHeader::RingBuffer* ring_buffer =
+        header.add_ring_buffers();
+    ring_buffer->set_name(absl::StrFormat("ring_buffer_%d", i));
+    ring_buffer->set_file_descriptor(100 + i);
+  }
+  header.add_stack_sampling_ids(7);
+  return header;
+}
+
+}  // namespace
+
+TEST(PerfRecordCorpus, WriteAndRead) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  const std::string record0 = CreateRecord(16, 'a');
+  const std::string record1 = CreateRecord(24, 'b');
+  const std::string record2 = CreateRecord(32, 'c');
+  {
+    auto writer_or_error =
+        PerfRecordCorpusWriter::Create(temporary_file.file_path(), CreateHeaderWithRingBuffers(2));
+    ASSERT_TRUE(writer_or_error.has_value()) << writer_or_error.error().message();
+    std::unique_ptr<PerfRecordCorpusWriter> writer = std::move(writer_or_error.value());
+    writer->AppendRecord(0, record0.data());
+    writer->AppendRecord(1, record1.data());
+    writer->AppendRecord(0, record2.data());
+    ASSERT_FALSE(writer->Finish().has_error());
+  }
+
+  auto corpus_or_error = ReadPerfRecordCorpus(temporary_file.file_path());
+  ASSERT_TRUE(corpus_or_error.has_value()) << corpus_or_error.error().message();
+  const PerfRecordCorpus& corpus = corpus_or_error.value();
+  EXPECT_EQ(corpus.header.capture_options().pid(), 42);
+  EXPECT_EQ(corpus.header.effective_capture_start_timestamp_ns(), 1234u);
+  ASSERT_EQ(corpus.header.ring_buffers_size(), 2);
+  EXPECT_EQ(corpus.header.ring_buffers(1).name(), "ring_buffer_1");
+  EXPECT_EQ(corpus.header.ring_buffers(1).file_descriptor(), 101);
+  EXPECT_THAT(corpus.header.stack_sampling_ids(), testing::ElementsAre(7));
+  ASSERT_EQ(corpus.records_by_ring_buffer.size(), 2u);
+  EXPECT_EQ(corpus.records_by_ring_buffer[0], record0 + record2);
+  EXPECT_EQ(corpus.records_by_ring_buffer[1], record1);
+}
+
+TEST(PerfRecordCorpus, ReadFailsOnInvalidSignature) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  ASSERT_FALSE(orbit_base::WriteFully(temporary_file.fd(), "NOTACORPUS").has_error());
+
+  auto corpus_or_error = ReadPerfRecordCorpus(temporary_file.file_path());
+  ASSERT_TRUE(corpus_or_error.has_error());
+  EXPECT_THAT(corpus_or_error.error().message(), testing::HasSubstr("invalid signature"));
+}
+
+TEST(PerfRecordCorpus, ReadFailsOnTruncatedRecord) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  {
+    auto writer_or_error =
+        PerfRecordCorpusWriter::Create(temporary_file.file_path(), CreateHeaderWithRingBuffers(1));
+    ASSERT_TRUE(writer_or_error.has_value()) << writer_or_error.error().message();
+    writer_or_error.value()->AppendRecord(0, CreateRecord(64, 'a').data());
+    ASSERT_FALSE(writer_or_error.value()->Finish().has_error());
+  }
+  std::filesystem::resize_file(temporary_file.file_path(),
+                               std::filesystem::file_size(temporary_file.file_path()) - 1);
+
+  auto corpus_or_error = ReadPerfRecordCorpus(temporary_file.file_path());
+  ASSERT_TRUE(corpus_or_error.has_error());
+  EXPECT_THAT(corpus_or_error.error().message(), testing::HasSubstr("corrupted"));
+}
+
+TEST(PerfEventRingBuffer, CreateFromRecordsReturnsTheRecords) {
+  const std::string record0 = CreateRecord(16, 'a');
+  const std::string record1 = CreateRecord(40, 'b');
+  PerfEventRingBuffer ring_buffer =
+      PerfEventRingBuffer::CreateFromRecords(record0 + record1, 11, "replayed");
+  EXPECT_TRUE(ring_buffer.IsOpen());
+  EXPECT_EQ(ring_buffer.GetFileDescriptor(), 11);
+  EXPECT_EQ(ring_buffer.GetName(), "replayed");
+
+  for (const std::string& expected_record : {record0, record1}) {
+    ASSERT_TRUE(ring_buffer.HasNewData());
+    perf_event_header header;
+    ring_buffer.ReadHeader(&header);
+    ASSERT_EQ(header.size, expected_record.size());
+    const char* record = ring_buffer.GetRecordAtTailIfContiguous(header);
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(std::string(record, header.size), expected_record);
+    std::string copy(header.size, '\0');
+    ring_buffer.ReadRawAtOffset(copy.data(), 0, header.size);
+    EXPECT_EQ(copy, expected_record);
+    ring_buffer.SkipRecord(header);
+  }
+  EXPECT_FALSE(ring_buffer.HasNewData());
+}
+
+TEST(PerfEventRingBuffer, CreateFromRecordsWithNoRecords) {
+  PerfEventRingBuffer ring_buffer = PerfEventRingBuffer::CreateFromRecords("", 11, "empty");
+  EXPECT_TRUE(ring_buffer.IsOpen());
+  EXPECT_FALSE(ring_buffer.HasNewData());
+
+  PerfEventRingBuffer moved_ring_buffer = std::move(ring_buffer);
+  EXPECT_TRUE(moved_ring_buffer.IsOpen());
+  EXPECT_FALSE(moved_ring_buffer.HasNewData());
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,44 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PIPELINE_LATENCY_PROBE_VISITOR_H_
+#define LINUX_TRACING_PIPELINE_LATENCY_PROBE_VISITOR_H_
+
+#include <utility>
+
+#include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+#include "PerfEvent.h"
+#include "PerfEventVisitor.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+// This class processes PipelineLatencyProbePerfEvents and sends the corresponding
+// PipelineLatencyProbes, with the time at which they were processed, to the TracerListener.
+class PipelineLatencyProbeVisitor : public PerfEventVisitor {
+ public:
+  explicit PipelineLatencyProbeVisitor(TracerListener* listener) : listener_{listener} {
+    CHECK(listener_ != nullptr);
+  }
+
+  void Visit(PipelineLatencyProbePerfEvent* event) override {
+    orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe;
+    pipeline_latency_probe.set_record_timestamp_ns(event->GetTimestamp());
+    pipeline_latency_probe.set_ring_buffer_read_timestamp_ns(
+        event->GetRingBufferReadTimestampNs());
+    pipeline_latency_probe.set_processed_timestamp_ns(orbit_base::CaptureTimestampNs());
+
+    CHECK(listener_ != nullptr);
+    listener_->OnPipelineLatencyProbe(std::move(pipeline_latency_probe));
+  }
+
+ private:
+  TracerListener* listener_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PIPELINE_LATENCY_PROBE_VISITOR_H_
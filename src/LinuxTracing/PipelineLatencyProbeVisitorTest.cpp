@@ -0,0 +1,79 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/Profiling.h"
+#include "PerfEvent.h"
+#include "PipelineLatencyProbeVisitor.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class MockTracerListener : public TracerListener {
+ public:
+  MOCK_METHOD(void, OnSchedulingSlice, (orbit_grpc_protos::SchedulingSlice), (override));
+  MOCK_METHOD(void, OnCallstackSample, (orbit_grpc_protos::FullCallstackSample), (override));
+  MOCK_METHOD(void, OnFunctionCall, (orbit_grpc_protos::FunctionCall), (override));
+  MOCK_METHOD(void, OnIntrospectionScope, (orbit_grpc_protos::IntrospectionScope), (override));
+  MOCK_METHOD(void, OnGpuJob, (orbit_grpc_protos::FullGpuJob full_gpu_job), (override));
+  MOCK_METHOD(void, OnThreadName, (orbit_grpc_protos::ThreadName), (override));
+  MOCK_METHOD(void, OnThreadNamesSnapshot, (orbit_grpc_protos::ThreadNamesSnapshot), (override));
+  MOCK_METHOD(void, OnThreadStateSlice, (orbit_grpc_protos::ThreadStateSlice), (override));
+  MOCK_METHOD(void, OnAddressInfo, (orbit_grpc_protos::FullAddressInfo), (override));
+  MOCK_METHOD(void, OnTracepointEvent, (orbit_grpc_protos::FullTracepointEvent), (override));
+  MOCK_METHOD(void, OnModuleUpdate, (orbit_grpc_protos::ModuleUpdateEvent), (override));
+  MOCK_METHOD(void, OnModulesSnapshot, (orbit_grpc_protos::ModulesSnapshot), (override));
+  MOCK_METHOD(void, OnErrorsWithPerfEventOpenEvent,
+              (orbit_grpc_protos::ErrorsWithPerfEventOpenEvent), (override));
+  MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
+  MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
+              (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent, (orbit_grpc_protos::SamplingPeriodChangedEvent),
+              (override));
+  MOCK_METHOD(void, OnPmuCountersSample, (orbit_grpc_protos::PmuCountersSample), (override));
+  MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
+  MOCK_METHOD(void, OnServiceHealthEvent, (orbit_grpc_protos::ServiceHealthEvent), (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe, (orbit_grpc_protos::PipelineLatencyProbe),
+              (override));
+  MOCK_METHOD(void, OnCaptureStatisticsSummary, (orbit_grpc_protos::CaptureStatisticsSummary),
+              (override));
+};
+
+}  // namespace
+
+TEST(PipelineLatencyProbeVisitor, NeedsVisitor) {
+  EXPECT_DEATH(PipelineLatencyProbeVisitor{nullptr}, "listener_ != nullptr");
+}
+
+TEST(PipelineLatencyProbeVisitor, VisitPipelineLatencyProbePerfEventCallsOnPipelineLatencyProbe) {
+  MockTracerListener mock_listener;
+  PipelineLatencyProbeVisitor visitor{&mock_listener};
+  orbit_grpc_protos::PipelineLatencyProbe actual_pipeline_latency_probe;
+  EXPECT_CALL(mock_listener, OnPipelineLatencyProbe)
+      .Times(1)
+      .WillOnce(::testing::SaveArg<0>(&actual_pipeline_latency_probe));
+
+  constexpr uint64_t kRecordTimestampNs = 1111;
+  constexpr uint64_t kRingBufferReadTimestampNs = 1234;
+  const uint64_t timestamp_before_ns = orbit_base::CaptureTimestampNs();
+  PipelineLatencyProbePerfEvent event{kRecordTimestampNs, kRingBufferReadTimestampNs};
+  EXPECT_EQ(event.GetTimestamp(), kRecordTimestampNs);
+  event.Accept(&visitor);
+
+  EXPECT_EQ(actual_pipeline_latency_probe.record_timestamp_ns(), kRecordTimestampNs);
+  EXPECT_EQ(actual_pipeline_latency_probe.ring_buffer_read_timestamp_ns(),
+            kRingBufferReadTimestampNs);
+  EXPECT_GE(actual_pipeline_latency_probe.processed_timestamp_ns(), timestamp_before_ns);
+  EXPECT_LE(actual_pipeline_latency_probe.processed_timestamp_ns(),
+            orbit_base::CaptureTimestampNs());
+  EXPECT_EQ(actual_pipeline_latency_probe.sent_timestamp_ns(), 0u);
+}
+
+}  // namespace orbit_linux_tracing
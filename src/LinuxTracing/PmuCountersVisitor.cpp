@@ -0,0 +1,52 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PmuCountersVisitor.h"
+
+#include <utility>
+
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+void PmuCountersVisitor::Visit(PmuCountersSamplePerfEvent* event) {
+  PreviousSample current{event->GetTid(), event->GetTimestamp(), event->GetTimeEnabled(),
+                         event->GetTimeRunning(), {}};
+  for (size_t index = 0; index < kPmuCounterCount; ++index) {
+    current.values[index] = event->GetCounterValue(static_cast<PmuCounterIndex>(index));
+  }
+
+  auto [it, inserted] = previous_sample_by_cpu_.try_emplace(event->GetCpu(), current);
+  if (inserted) {
+    return;
+  }
+  PreviousSample previous = std::exchange(it->second, current);
+
+  if (!target_pids_.contains(event->GetPid()) || previous.tid != current.tid ||
+      current.timestamp_ns <= previous.timestamp_ns) {
+    return;
+  }
+  uint64_t time_enabled = current.time_enabled - previous.time_enabled;
+  uint64_t time_running = current.time_running - previous.time_running;
+  if (time_running == 0 || time_running != time_enabled) {
+    return;
+  }
+
+  orbit_grpc_protos::PmuCountersSample pmu_counters_sample;
+  pmu_counters_sample.set_pid(event->GetPid());
+  pmu_counters_sample.set_tid(current.tid);
+  pmu_counters_sample.set_duration_ns(current.timestamp_ns - previous.timestamp_ns);
+  pmu_counters_sample.set_end_timestamp_ns(current.timestamp_ns);
+  pmu_counters_sample.set_cycles(current.values[kPmuCounterCycles] -
+                                 previous.values[kPmuCounterCycles]);
+  pmu_counters_sample.set_instructions(current.values[kPmuCounterInstructions] -
+                                       previous.values[kPmuCounterInstructions]);
+  pmu_counters_sample.set_llc_misses(current.values[kPmuCounterLlcMisses] -
+                                     previous.values[kPmuCounterLlcMisses]);
+  pmu_counters_sample.set_branch_misses(current.values[kPmuCounterBranchMisses] -
+                                        previous.values[kPmuCounterBranchMisses]);
+  listener_->OnPmuCountersSample(std::move(pmu_counters_sample));
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,58 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PMU_COUNTERS_VISITOR_H_
+#define LINUX_TRACING_PMU_COUNTERS_VISITOR_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <sys/types.h>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/Logging.h"
+#include "PerfEvent.h"
+#include "PerfEventRecords.h"
+#include "PerfEventVisitor.h"
+
+namespace orbit_linux_tracing {
+
+// This class processes the PmuCountersSamplePerfEvents of the groups opened by
+// pmu_counters_sample_event_open and sends PmuCountersSamples to the TracerListener.
+// The counters are cumulative and count everything that runs on a cpu, so the values of a sample
+// are only attributed to a thread when the previous sample on the same cpu was also of that
+// thread. Threads that are briefly scheduled in between the two samples are counted as well.
+// Intervals during which the group has been multiplexed with other events are dropped instead of
+// being scaled, as the counters wouldn't refer to the same time.
+// As only the samples of the same cpu are related, this visitor can be used by the ring buffer
+// reader of those cpus, before events are ordered, and it receives the samples of all processes.
+class PmuCountersVisitor : public PerfEventVisitor {
+ public:
+  explicit PmuCountersVisitor(TracerListener* listener, absl::flat_hash_set<pid_t> target_pids)
+      : listener_{listener}, target_pids_{std::move(target_pids)} {
+    CHECK(listener_ != nullptr);
+  }
+
+  void Visit(PmuCountersSamplePerfEvent* event) override;
+
+ private:
+  struct PreviousSample {
+    pid_t tid;
+    uint64_t timestamp_ns;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    std::array<uint64_t, kPmuCounterCount> values;
+  };
+
+  TracerListener* listener_;
+  absl::flat_hash_set<pid_t> target_pids_;
+  absl::flat_hash_map<uint32_t, PreviousSample> previous_sample_by_cpu_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PMU_COUNTERS_VISITOR_H_
@@ -0,0 +1,127 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <memory>
+
+#include "LinuxTracing/TracerListener.h"
+#include "PerfEvent.h"
+#include "PerfEventRecords.h"
+#include "PmuCountersVisitor.h"
+#include "capture.pb.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class MockTracerListener : public TracerListener {
+ public:
+  MOCK_METHOD(void, OnSchedulingSlice, (orbit_grpc_protos::SchedulingSlice), (override));
+  MOCK_METHOD(void, OnCallstackSample, (orbit_grpc_protos::FullCallstackSample), (override));
+  MOCK_METHOD(void, OnFunctionCall, (orbit_grpc_protos::FunctionCall), (override));
+  MOCK_METHOD(void, OnIntrospectionScope, (orbit_grpc_protos::IntrospectionScope), (override));
+  MOCK_METHOD(void, OnGpuJob, (orbit_grpc_protos::FullGpuJob full_gpu_job), (override));
+  MOCK_METHOD(void, OnThreadName, (orbit_grpc_protos::ThreadName), (override));
+  MOCK_METHOD(void, OnThreadNamesSnapshot, (orbit_grpc_protos::ThreadNamesSnapshot), (override));
+  MOCK_METHOD(void, OnThreadStateSlice, (orbit_grpc_protos::ThreadStateSlice), (override));
+  MOCK_METHOD(void, OnAddressInfo, (orbit_grpc_protos::FullAddressInfo), (override));
+  MOCK_METHOD(void, OnTracepointEvent, (orbit_grpc_protos::FullTracepointEvent), (override));
+  MOCK_METHOD(void, OnModuleUpdate, (orbit_grpc_protos::ModuleUpdateEvent), (override));
+  MOCK_METHOD(void, OnModulesSnapshot, (orbit_grpc_protos::ModulesSnapshot), (override));
+  MOCK_METHOD(void, OnErrorsWithPerfEventOpenEvent,
+              (orbit_grpc_protos::ErrorsWithPerfEventOpenEvent), (override));
+  MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
+  MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
+              (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent, (orbit_grpc_protos::SamplingPeriodChangedEvent),
+              (override));
+  MOCK_METHOD(void, OnPmuCountersSample, (orbit_grpc_protos::PmuCountersSample), (override));
+  MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
+  MOCK_METHOD(void, OnServiceHealthEvent, (orbit_grpc_protos::ServiceHealthEvent), (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe, (orbit_grpc_protos::PipelineLatencyProbe),
+              (override));
+  MOCK_METHOD(void, OnCaptureStatisticsSummary, (orbit_grpc_protos::CaptureStatisticsSummary),
+              (override));
+};
+
+constexpr pid_t kTargetPid = 42;
+constexpr pid_t kTargetTid = 43;
+constexpr uint32_t kCpu = 1;
+
+// Each sample of thread tid after the one at timestamp_ns - 1000 has run for 1000 ns, retired
+// 2 instructions per cycle and missed the cache and branch predictor once per 1000 instructions.
+[[nodiscard]] std::unique_ptr<PmuCountersSamplePerfEvent> MakeFakePmuCountersSample(
+    pid_t pid, pid_t tid, uint32_t cpu, uint64_t timestamp_ns, uint64_t time_running) {
+  auto event = std::make_unique<PmuCountersSamplePerfEvent>();
+  event->ring_buffer_record.sample_id.pid = pid;
+  event->ring_buffer_record.sample_id.tid = tid;
+  event->ring_buffer_record.sample_id.cpu = cpu;
+  event->ring_buffer_record.sample_id.time = timestamp_ns;
+  event->ring_buffer_record.nr = kPmuCounterCount;
+  event->ring_buffer_record.time_enabled = timestamp_ns;
+  event->ring_buffer_record.time_running = time_running;
+  event->ring_buffer_record.values[kPmuCounterCpuClock] = timestamp_ns;
+  event->ring_buffer_record.values[kPmuCounterCycles] = timestamp_ns;
+  event->ring_buffer_record.values[kPmuCounterInstructions] = 2 * timestamp_ns;
+  event->ring_buffer_record.values[kPmuCounterLlcMisses] = 2 * timestamp_ns / 1000;
+  event->ring_buffer_record.values[kPmuCounterBranchMisses] = 2 * timestamp_ns / 1000;
+  return event;
+}
+
+class PmuCountersVisitorTest : public ::testing::Test {
+ protected:
+  MockTracerListener mock_listener_;
+  PmuCountersVisitor visitor_{&mock_listener_, {kTargetPid}};
+};
+
+}  // namespace
+
+TEST_F(PmuCountersVisitorTest, ConsecutiveSamplesOfTheSameThreadProduceDifferences) {
+  orbit_grpc_protos::PmuCountersSample actual_pmu_counters_sample;
+  EXPECT_CALL(mock_listener_, OnPmuCountersSample)
+      .Times(1)
+      .WillOnce(::testing::SaveArg<0>(&actual_pmu_counters_sample));
+
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 10000, 10000)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 11000, 11000)->Accept(&visitor_);
+
+  EXPECT_EQ(actual_pmu_counters_sample.pid(), kTargetPid);
+  EXPECT_EQ(actual_pmu_counters_sample.tid(), kTargetTid);
+  EXPECT_EQ(actual_pmu_counters_sample.duration_ns(), 1000);
+  EXPECT_EQ(actual_pmu_counters_sample.end_timestamp_ns(), 11000);
+  EXPECT_EQ(actual_pmu_counters_sample.cycles(), 1000);
+  EXPECT_EQ(actual_pmu_counters_sample.instructions(), 2000);
+  EXPECT_EQ(actual_pmu_counters_sample.llc_misses(), 2);
+  EXPECT_EQ(actual_pmu_counters_sample.branch_misses(), 2);
+}
+
+TEST_F(PmuCountersVisitorTest, SamplesOfDifferentThreadsOrCpusProduceNothing) {
+  EXPECT_CALL(mock_listener_, OnPmuCountersSample).Times(0);
+
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 10000, 10000)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu + 1, 10500, 10500)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid + 1, kCpu, 11000, 11000)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 12000, 12000)->Accept(&visitor_);
+}
+
+TEST_F(PmuCountersVisitorTest, SamplesOfOtherProcessesProduceNothing) {
+  EXPECT_CALL(mock_listener_, OnPmuCountersSample).Times(0);
+
+  MakeFakePmuCountersSample(kTargetPid + 1, kTargetTid, kCpu, 10000, 10000)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid + 1, kTargetTid, kCpu, 11000, 11000)->Accept(&visitor_);
+}
+
+TEST_F(PmuCountersVisitorTest, MultiplexedIntervalsProduceNothing) {
+  EXPECT_CALL(mock_listener_, OnPmuCountersSample).Times(1);
+
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 10000, 10000)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 11000, 10500)->Accept(&visitor_);
+  MakeFakePmuCountersSample(kTargetPid, kTargetTid, kCpu, 12000, 11500)->Accept(&visitor_);
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,177 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "RingBufferSizes.h"
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// Ring buffers need to be the size of a power of two of pages.
+[[nodiscard]] uint64_t RoundUpToRingBufferSizeKb(uint64_t size_kb) {
+  uint64_t rounded_size_kb = RingBufferSizes::kMinSizeKb;
+  while (rounded_size_kb < size_kb) {
+    rounded_size_kb *= 2;
+  }
+  return rounded_size_kb;
+}
+
+class PreviousCaptureFillStatistics {
+ public:
+  [[nodiscard]] RingBufferFillStatistics Get() const {
+    absl::MutexLock lock{&mutex_};
+    return fill_statistics_;
+  }
+
+  void Set(RingBufferFillStatistics fill_statistics) {
+    absl::MutexLock lock{&mutex_};
+    fill_statistics_ = std::move(fill_statistics);
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  RingBufferFillStatistics fill_statistics_ ABSL_GUARDED_BY(mutex_);
+};
+
+[[nodiscard]] PreviousCaptureFillStatistics& GetPreviousCaptureFillStatistics() {
+  static auto* previous_capture_fill_statistics = new PreviousCaptureFillStatistics{};
+  return *previous_capture_fill_statistics;
+}
+
+}  // namespace
+
+void RingBufferFillStatistics::Add(RingBufferCategory category, int32_t cpu, uint64_t size_kb,
+                                   uint64_t max_used_bytes) {
+  auto [it, inserted] = fills_.try_emplace({category, cpu}, Fill{size_kb, max_used_bytes});
+  if (!inserted && max_used_bytes > it->second.max_used_bytes) {
+    it->second = Fill{size_kb, max_used_bytes};
+  }
+}
+
+RingBufferFillStatistics RingBufferFillStatistics::GetOfPreviousCapture() {
+  return GetPreviousCaptureFillStatistics().Get();
+}
+
+void RingBufferFillStatistics::SetOfPreviousCapture(RingBufferFillStatistics fill_statistics) {
+  GetPreviousCaptureFillStatistics().Set(std::move(fill_statistics));
+}
+
+RingBufferSizes RingBufferSizes::Create(
+    const orbit_grpc_protos::CaptureOptions& capture_options,
+    const RingBufferFillStatistics& previous_capture_fill_statistics) {
+  RingBufferSizes ring_buffer_sizes;
+  for (const orbit_grpc_protos::CaptureOptions::RingBufferSize& ring_buffer_size :
+       capture_options.ring_buffer_sizes()) {
+    if (ring_buffer_size.category() == orbit_grpc_protos::CaptureOptions::RingBufferSize::
+                                           kUnknownCategory ||
+        ring_buffer_size.size_kb() == 0) {
+      continue;
+    }
+    ring_buffer_sizes.size_kb_by_category_.insert_or_assign(
+        ring_buffer_size.category(), RoundUpToRingBufferSizeKb(ring_buffer_size.size_kb()));
+  }
+
+  if (capture_options.automatic_ring_buffer_sizes_budget_kb() != 0) {
+    ring_buffer_sizes.FitToFillStatistics(previous_capture_fill_statistics,
+                                          capture_options.automatic_ring_buffer_sizes_budget_kb());
+  }
+  return ring_buffer_sizes;
+}
+
+uint64_t RingBufferSizes::GetSizeKb(RingBufferCategory category, int32_t cpu) const {
+  if (auto it = size_kb_by_category_and_cpu_.find({category, cpu});
+      it != size_kb_by_category_and_cpu_.end()) {
+    return it->second;
+  }
+  return GetSizeKb(category);
+}
+
+uint64_t RingBufferSizes::GetSizeKb(RingBufferCategory category) const {
+  if (auto it = size_kb_by_category_.find(category); it != size_kb_by_category_.end()) {
+    return it->second;
+  }
+  return GetDefaultSizeKb(category);
+}
+
+uint64_t RingBufferSizes::GetDefaultSizeKb(RingBufferCategory category) {
+  switch (category) {
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kUprobes:
+      return 8 * 1024;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kMmapTask:
+      return 64;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kSampling:
+      return 16 * 1024;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kPmuCounters:
+      return 512;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kOffCpuCallstacks:
+      return 8 * 1024;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kMemoryCallstacks:
+      return 8 * 1024;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kThreadNames:
+      return 64;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kContextSwitchesAndThreadState:
+      return 2 * 1024;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kGpuTracing:
+      return 256;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kInstrumentedTracepoints:
+      return 8 * 1024;
+    case orbit_grpc_protos::CaptureOptions::RingBufferSize::kUnknownCategory:
+    default:
+      UNREACHABLE();
+  }
+}
+
+// Each ring buffer gets twice its peak fill, so that one that got full doubles, but at most four
+// times its usual size. If that exceeds the budget, the largest ring buffers are halved until it
+// doesn't, or until all are at kMinSizeKb.
+void RingBufferSizes::FitToFillStatistics(const RingBufferFillStatistics& fill_statistics,
+                                          uint64_t budget_kb) {
+  struct SizedRingBuffer {
+    std::pair<RingBufferCategory, int32_t> category_and_cpu;
+    uint64_t size_kb;
+  };
+  std::vector<SizedRingBuffer> sized_ring_buffers;
+  uint64_t total_size_kb = 0;
+  for (const auto& [category_and_cpu, fill] : fill_statistics.GetFills()) {
+    const uint64_t max_size_kb = 4 * GetSizeKb(category_and_cpu.first);
+    const uint64_t size_kb =
+        std::min(RoundUpToRingBufferSizeKb((2 * fill.max_used_bytes + 1023) / 1024), max_size_kb);
+    sized_ring_buffers.push_back({category_and_cpu, size_kb});
+    total_size_kb += size_kb;
+  }
+
+  // Sorted so that the result doesn't depend on the order of the hash map.
+  std::sort(sized_ring_buffers.begin(), sized_ring_buffers.end(),
+            [](const SizedRingBuffer& lhs, const SizedRingBuffer& rhs) {
+              return lhs.category_and_cpu < rhs.category_and_cpu;
+            });
+  while (total_size_kb > budget_kb) {
+    auto largest_it =
+        std::max_element(sized_ring_buffers.begin(), sized_ring_buffers.end(),
+                         [](const SizedRingBuffer& lhs, const SizedRingBuffer& rhs) {
+                           return lhs.size_kb < rhs.size_kb;
+                         });
+    if (largest_it == sized_ring_buffers.end() || largest_it->size_kb <= kMinSizeKb) {
+      ERROR("Ring buffers don't fit in a budget of %lu KB, even at their smallest", budget_kb);
+      break;
+    }
+    largest_it->size_kb /= 2;
+    total_size_kb -= largest_it->size_kb;
+  }
+
+  for (const SizedRingBuffer& sized_ring_buffer : sized_ring_buffers) {
+    size_kb_by_category_and_cpu_.insert_or_assign(sized_ring_buffer.category_and_cpu,
+                                                  sized_ring_buffer.size_kb);
+  }
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_RING_BUFFER_SIZES_H_
+#define LINUX_TRACING_RING_BUFFER_SIZES_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <capture.pb.h>
+
+#include <cstdint>
+#include <utility>
+
+namespace orbit_linux_tracing {
+
+using RingBufferCategory = orbit_grpc_protos::CaptureOptions::RingBufferSize::Category;
+
+// How full the perf_event_open ring buffers got during a capture, by category and cpu.
+class RingBufferFillStatistics {
+ public:
+  struct Fill {
+    uint64_t size_kb;
+    // The most bytes waiting to be read at once. A ring buffer that lost records counts as full.
+    uint64_t max_used_bytes;
+  };
+
+  // When a category has more than one ring buffer on a cpu, the fullest one is kept.
+  void Add(RingBufferCategory category, int32_t cpu, uint64_t size_kb, uint64_t max_used_bytes);
+
+  [[nodiscard]] const absl::flat_hash_map<std::pair<RingBufferCategory, int32_t>, Fill>& GetFills()
+      const {
+    return fills_;
+  }
+
+  [[nodiscard]] bool IsEmpty() const { return fills_.empty(); }
+
+  // The statistics of the previous capture of this process, i.e., of OrbitService, used to size the
+  // ring buffers of the next capture. They are kept in memory, as the service runs across captures.
+  [[nodiscard]] static RingBufferFillStatistics GetOfPreviousCapture();
+  static void SetOfPreviousCapture(RingBufferFillStatistics fill_statistics);
+
+ private:
+  absl::flat_hash_map<std::pair<RingBufferCategory, int32_t>, Fill> fills_;
+};
+
+// The sizes of the perf_event_open ring buffers that TracerThread opens, by category and cpu.
+class RingBufferSizes {
+ public:
+  // The smallest ring buffer, well above kRingBufferWakeupWatermarkBytes.
+  static constexpr uint64_t kMinSizeKb = 64;
+
+  // Takes the sizes in `capture_options.ring_buffer_sizes`, and the default size for the other
+  // categories. If `capture_options.automatic_ring_buffer_sizes_budget_kb` is not zero, then sizes
+  // the ring buffers in `previous_capture_fill_statistics` from their fill.
+  [[nodiscard]] static RingBufferSizes Create(
+      const orbit_grpc_protos::CaptureOptions& capture_options,
+      const RingBufferFillStatistics& previous_capture_fill_statistics);
+
+  [[nodiscard]] uint64_t GetSizeKb(RingBufferCategory category, int32_t cpu) const;
+
+  [[nodiscard]] static uint64_t GetDefaultSizeKb(RingBufferCategory category);
+
+ private:
+  [[nodiscard]] uint64_t GetSizeKb(RingBufferCategory category) const;
+  void FitToFillStatistics(const RingBufferFillStatistics& fill_statistics, uint64_t budget_kb);
+
+  absl::flat_hash_map<RingBufferCategory, uint64_t> size_kb_by_category_;
+  absl::flat_hash_map<std::pair<RingBufferCategory, int32_t>, uint64_t>
+      size_kb_by_category_and_cpu_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_RING_BUFFER_SIZES_H_
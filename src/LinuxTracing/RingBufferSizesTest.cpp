@@ -0,0 +1,110 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "RingBufferSizes.h"
+
+namespace orbit_linux_tracing {
+
+using orbit_grpc_protos::CaptureOptions;
+using RingBufferSize = orbit_grpc_protos::CaptureOptions::RingBufferSize;
+
+namespace {
+
+void AddRingBufferSize(CaptureOptions* capture_options, RingBufferCategory category,
+                       uint64_t size_kb) {
+  RingBufferSize* ring_buffer_size = capture_options->add_ring_buffer_sizes();
+  ring_buffer_size->set_category(category);
+  ring_buffer_size->set_size_kb(size_kb);
+}
+
+}  // namespace
+
+TEST(RingBufferSizes, DefaultSizesAreUsedWithoutOptions) {
+  RingBufferSizes ring_buffer_sizes =
+      RingBufferSizes::Create(CaptureOptions{}, RingBufferFillStatistics{});
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kUprobes, 0), 8 * 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kMmapTask, 3), 64);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 1), 16 * 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kGpuTracing, 2), 256);
+}
+
+TEST(RingBufferSizes, ExplicitSizesAreRoundedUpToAPowerOfTwo) {
+  CaptureOptions capture_options;
+  AddRingBufferSize(&capture_options, RingBufferSize::kSampling, 3000);
+  AddRingBufferSize(&capture_options, RingBufferSize::kThreadNames, 1);
+  AddRingBufferSize(&capture_options, RingBufferSize::kUprobes, 0);
+
+  RingBufferSizes ring_buffer_sizes =
+      RingBufferSizes::Create(capture_options, RingBufferFillStatistics{});
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 0), 4096);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kThreadNames, 0),
+            RingBufferSizes::kMinSizeKb);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kUprobes, 0), 8 * 1024);
+}
+
+TEST(RingBufferSizes, FillStatisticsAreIgnoredWithoutBudget) {
+  RingBufferFillStatistics fill_statistics;
+  fill_statistics.Add(RingBufferSize::kSampling, 0, 16 * 1024, 1024);
+
+  RingBufferSizes ring_buffer_sizes = RingBufferSizes::Create(CaptureOptions{}, fill_statistics);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 0), 16 * 1024);
+}
+
+TEST(RingBufferSizes, AutomaticSizesAreTwiceTheFillAndAtMostFourTimesTheUsualSize) {
+  CaptureOptions capture_options;
+  capture_options.set_automatic_ring_buffer_sizes_budget_kb(1024 * 1024);
+
+  RingBufferFillStatistics fill_statistics;
+  // Twice 300 KB, rounded up.
+  fill_statistics.Add(RingBufferSize::kSampling, 0, 16 * 1024, 300 * 1024);
+  // Full, so it would double, but at most four times 2 MB.
+  fill_statistics.Add(RingBufferSize::kContextSwitchesAndThreadState, 0, 8 * 1024,
+                      8 * 1024 * 1024);
+  // Barely used.
+  fill_statistics.Add(RingBufferSize::kUprobes, 1, 8 * 1024, 100);
+
+  RingBufferSizes ring_buffer_sizes = RingBufferSizes::Create(capture_options, fill_statistics);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 0), 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kContextSwitchesAndThreadState, 0),
+            8 * 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kUprobes, 1), RingBufferSizes::kMinSizeKb);
+
+  // Ring buffers that weren't open in the previous capture keep their usual size.
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 1), 16 * 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kUprobes, 0), 8 * 1024);
+}
+
+TEST(RingBufferSizes, LargestAutomaticSizesAreHalvedToFitTheBudget) {
+  CaptureOptions capture_options;
+  capture_options.set_automatic_ring_buffer_sizes_budget_kb(12 * 1024);
+
+  RingBufferFillStatistics fill_statistics;
+  fill_statistics.Add(RingBufferSize::kSampling, 0, 16 * 1024, 8 * 1024 * 1024);
+  fill_statistics.Add(RingBufferSize::kSampling, 1, 16 * 1024, 2 * 1024 * 1024);
+  fill_statistics.Add(RingBufferSize::kMmapTask, 0, 64, 64 * 1024);
+
+  // 16 MB + 4 MB + 128 KB is halved to 8 MB + 4 MB + 128 KB, then to 4 MB + 4 MB + 128 KB.
+  RingBufferSizes ring_buffer_sizes = RingBufferSizes::Create(capture_options, fill_statistics);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 0), 4 * 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kSampling, 1), 4 * 1024);
+  EXPECT_EQ(ring_buffer_sizes.GetSizeKb(RingBufferSize::kMmapTask, 0), 128);
+}
+
+TEST(RingBufferFillStatistics, AddKeepsTheFullestRingBuffer) {
+  RingBufferFillStatistics fill_statistics;
+  EXPECT_TRUE(fill_statistics.IsEmpty());
+
+  fill_statistics.Add(RingBufferSize::kGpuTracing, 0, 256, 1000);
+  fill_statistics.Add(RingBufferSize::kGpuTracing, 0, 256, 5000);
+  fill_statistics.Add(RingBufferSize::kGpuTracing, 0, 256, 2000);
+  fill_statistics.Add(RingBufferSize::kGpuTracing, 1, 256, 10);
+
+  ASSERT_EQ(fill_statistics.GetFills().size(), 2);
+  EXPECT_EQ(fill_statistics.GetFills().at({RingBufferSize::kGpuTracing, 0}).max_used_bytes, 5000);
+  EXPECT_EQ(fill_statistics.GetFills().at({RingBufferSize::kGpuTracing, 1}).max_used_bytes, 10);
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,92 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SizeClassMemoryPool.h"
+
+#include <new>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+SizeClassMemoryPool::SizeClassMemoryPool(size_t max_cached_bytes_per_size_class)
+    : max_cached_bytes_per_size_class_{max_cached_bytes_per_size_class} {}
+
+SizeClassMemoryPool::~SizeClassMemoryPool() {
+  for (SizeClass& size_class : size_classes_) {
+    absl::MutexLock lock{&size_class.mutex};
+    for (void* block : size_class.free_blocks) {
+      ::operator delete(block);
+    }
+    size_class.free_blocks.clear();
+  }
+}
+
+size_t SizeClassMemoryPool::GetSizeClassIndex(size_t size) {
+  if (size <= (1ul << kMinSizeClassLog2)) {
+    return 0;
+  }
+  // Position of the highest set bit of (size - 1), plus one, is log2 of the next power of two.
+  size_t size_class_log2 = 64 - __builtin_clzl(size - 1);
+  return size_class_log2 - kMinSizeClassLog2;
+}
+
+void* SizeClassMemoryPool::Allocate(size_t size) {
+  size_t size_class_index = GetSizeClassIndex(size);
+  if (size_class_index >= size_classes_.size()) {
+    return ::operator new(size);
+  }
+
+  SizeClass& size_class = size_classes_[size_class_index];
+  {
+    absl::MutexLock lock{&size_class.mutex};
+    if (!size_class.free_blocks.empty()) {
+      void* block = size_class.free_blocks.back();
+      size_class.free_blocks.pop_back();
+      return block;
+    }
+  }
+  return ::operator new(1ul << (size_class_index + kMinSizeClassLog2));
+}
+
+void SizeClassMemoryPool::Deallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+  size_t size_class_index = GetSizeClassIndex(size);
+  if (size_class_index >= size_classes_.size()) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  const size_t block_size = 1ul << (size_class_index + kMinSizeClassLog2);
+  SizeClass& size_class = size_classes_[size_class_index];
+  {
+    absl::MutexLock lock{&size_class.mutex};
+    if ((size_class.free_blocks.size() + 1) * block_size <= max_cached_bytes_per_size_class_) {
+      size_class.free_blocks.push_back(ptr);
+      return;
+    }
+  }
+  ::operator delete(ptr);
+}
+
+size_t SizeClassMemoryPool::GetCachedBlockCount(size_t size) {
+  size_t size_class_index = GetSizeClassIndex(size);
+  if (size_class_index >= size_classes_.size()) {
+    return 0;
+  }
+  SizeClass& size_class = size_classes_[size_class_index];
+  absl::MutexLock lock{&size_class.mutex};
+  return size_class.free_blocks.size();
+}
+
+SizeClassMemoryPool& SizeClassMemoryPool::GetPerfEventPool() {
+  // Enough for about one second of 64 KiB stack dumps at 1 kHz on a few cores.
+  static constexpr size_t kMaxCachedBytesPerSizeClass = 256 * 1024 * 1024;
+  static SizeClassMemoryPool* pool = new SizeClassMemoryPool{kMaxCachedBytesPerSizeClass};
+  return *pool;
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_SIZE_CLASS_MEMORY_POOL_H_
+#define LINUX_TRACING_SIZE_CLASS_MEMORY_POOL_H_
+
+#include <absl/synchronization/mutex.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+// SizeClassMemoryPool hands out blocks of memory whose sizes are rounded up to the next power of
+// two (the "size class"), and keeps blocks that are deallocated in a free list per size class, so
+// that they can be reused by later allocations of the same size class.
+// PerfEvents (and the stack dumps they contain) are allocated by the threads reading from the
+// ring buffers and freed by the thread processing them, at a very high rate. Recycling their
+// memory avoids most calls to malloc and free, and the contention between those threads inside
+// the system allocator.
+// Allocations larger than the largest size class are forwarded to the system allocator. At most
+// max_cached_bytes_per_size_class bytes are kept in each free list, the rest is freed.
+class SizeClassMemoryPool {
+ public:
+  explicit SizeClassMemoryPool(size_t max_cached_bytes_per_size_class);
+  ~SizeClassMemoryPool();
+
+  SizeClassMemoryPool(const SizeClassMemoryPool&) = delete;
+  SizeClassMemoryPool& operator=(const SizeClassMemoryPool&) = delete;
+  SizeClassMemoryPool(SizeClassMemoryPool&&) = delete;
+  SizeClassMemoryPool& operator=(SizeClassMemoryPool&&) = delete;
+
+  [[nodiscard]] void* Allocate(size_t size);
+  // size must be the same that was passed to Allocate.
+  void Deallocate(void* ptr, size_t size);
+
+  [[nodiscard]] size_t GetCachedBlockCount(size_t size);
+
+  // The pool used for all PerfEvents and stack dumps. It's never destroyed, so that PerfEvents can
+  // be freed at any time, including during static destruction.
+  [[nodiscard]] static SizeClassMemoryPool& GetPerfEventPool();
+
+  static constexpr size_t kMinSizeClassLog2 = 5;
+  // Large enough for the largest stack dumps (see kMaxStackSampleUserSize).
+  static constexpr size_t kMaxSizeClassLog2 = 16;
+
+ private:
+  [[nodiscard]] static size_t GetSizeClassIndex(size_t size);
+
+  struct SizeClass {
+    absl::Mutex mutex;
+    std::vector<void*> free_blocks ABSL_GUARDED_BY(mutex);
+  };
+
+  std::array<SizeClass, kMaxSizeClassLog2 - kMinSizeClassLog2 + 1> size_classes_;
+  size_t max_cached_bytes_per_size_class_;
+};
+
+// Deleter for buffers allocated with MakePooledBuffer, which returns them to the PerfEvent pool.
+class PooledBufferDeleter {
+ public:
+  PooledBufferDeleter() = default;
+  explicit PooledBufferDeleter(size_t size) : size_{size} {}
+
+  void operator()(char* buffer) const {
+    SizeClassMemoryPool::GetPerfEventPool().Deallocate(buffer, size_);
+  }
+
+ private:
+  size_t size_ = 0;
+};
+
+using PooledBuffer = std::unique_ptr<char[], PooledBufferDeleter>;
+
+// Allocates an uninitialized buffer of size bytes from the PerfEvent pool.
+[[nodiscard]] inline PooledBuffer MakePooledBuffer(size_t size) {
+  return PooledBuffer{static_cast<char*>(SizeClassMemoryPool::GetPerfEventPool().Allocate(size)),
+                      PooledBufferDeleter{size}};
+}
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_SIZE_CLASS_MEMORY_POOL_H_
@@ -0,0 +1,119 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "PerfEvent.h"
+#include "SizeClassMemoryPool.h"
+
+namespace orbit_linux_tracing {
+
+TEST(SizeClassMemoryPool, DeallocatedBlocksAreReusedForTheSameSizeClass) {
+  SizeClassMemoryPool pool{1024 * 1024};
+
+  void* block = pool.Allocate(100);
+  ASSERT_NE(block, nullptr);
+  // The whole size class (128 bytes) is usable.
+  memset(block, 0xAB, 128);
+  pool.Deallocate(block, 100);
+  EXPECT_EQ(pool.GetCachedBlockCount(100), 1);
+  EXPECT_EQ(pool.GetCachedBlockCount(128), 1);
+  EXPECT_EQ(pool.GetCachedBlockCount(64), 0);
+
+  void* reused_block = pool.Allocate(120);
+  EXPECT_EQ(reused_block, block);
+  EXPECT_EQ(pool.GetCachedBlockCount(100), 0);
+
+  void* other_block = pool.Allocate(200);
+  EXPECT_NE(other_block, block);
+
+  pool.Deallocate(reused_block, 120);
+  pool.Deallocate(other_block, 200);
+  EXPECT_EQ(pool.GetCachedBlockCount(128), 1);
+  EXPECT_EQ(pool.GetCachedBlockCount(256), 1);
+}
+
+TEST(SizeClassMemoryPool, SmallAndZeroSizesUseTheSmallestSizeClass) {
+  SizeClassMemoryPool pool{1024 * 1024};
+
+  void* zero_size_block = pool.Allocate(0);
+  ASSERT_NE(zero_size_block, nullptr);
+  void* one_byte_block = pool.Allocate(1);
+  ASSERT_NE(one_byte_block, nullptr);
+  pool.Deallocate(zero_size_block, 0);
+  pool.Deallocate(one_byte_block, 1);
+  EXPECT_EQ(pool.GetCachedBlockCount(1ul << SizeClassMemoryPool::kMinSizeClassLog2), 2);
+}
+
+TEST(SizeClassMemoryPool, LargeBlocksAreNotCached) {
+  SizeClassMemoryPool pool{16 * 1024 * 1024};
+  constexpr size_t kLargeSize = (1ul << SizeClassMemoryPool::kMaxSizeClassLog2) + 1;
+
+  void* block = pool.Allocate(kLargeSize);
+  ASSERT_NE(block, nullptr);
+  memset(block, 0xAB, kLargeSize);
+  pool.Deallocate(block, kLargeSize);
+  EXPECT_EQ(pool.GetCachedBlockCount(kLargeSize), 0);
+}
+
+TEST(SizeClassMemoryPool, AtMostMaxCachedBytesAreKeptPerSizeClass) {
+  SizeClassMemoryPool pool{3 * 1024};
+
+  std::vector<void*> blocks;
+  for (int i = 0; i < 5; ++i) {
+    blocks.push_back(pool.Allocate(1024));
+  }
+  for (void* block : blocks) {
+    pool.Deallocate(block, 1024);
+  }
+  EXPECT_EQ(pool.GetCachedBlockCount(1024), 3);
+}
+
+TEST(SizeClassMemoryPool, ConcurrentAllocationsAndDeallocations) {
+  SizeClassMemoryPool pool{1024 * 1024};
+  constexpr int kThreadCount = 4;
+  constexpr int kIterationCount = 10000;
+
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&pool, thread_index] {
+      for (int i = 0; i < kIterationCount; ++i) {
+        size_t size = 16 + (i % 1000);
+        auto* block = static_cast<char*>(pool.Allocate(size));
+        memset(block, thread_index, size);
+        for (size_t byte = 0; byte < size; ++byte) {
+          ASSERT_EQ(block[byte], thread_index);
+        }
+        pool.Deallocate(block, size);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(SizeClassMemoryPool, PerfEventsAndStackDumpsUseThePerfEventPool) {
+  SizeClassMemoryPool& pool = SizeClassMemoryPool::GetPerfEventPool();
+  constexpr uint64_t kStackSize = 60000;
+
+  auto event = std::make_unique<StackSamplePerfEvent>(kStackSize);
+  memset(event->GetStackData(), 0xAB, kStackSize);
+  size_t cached_events_before = pool.GetCachedBlockCount(sizeof(StackSamplePerfEvent));
+  size_t cached_stacks_before = pool.GetCachedBlockCount(kStackSize);
+  event.reset();
+  EXPECT_EQ(pool.GetCachedBlockCount(sizeof(StackSamplePerfEvent)), cached_events_before + 1);
+  EXPECT_EQ(pool.GetCachedBlockCount(kStackSize), cached_stacks_before + 1);
+
+  auto other_event = std::make_unique<StackSamplePerfEvent>(kStackSize);
+  EXPECT_EQ(pool.GetCachedBlockCount(sizeof(StackSamplePerfEvent)), cached_events_before);
+  EXPECT_EQ(pool.GetCachedBlockCount(kStackSize), cached_stacks_before);
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,119 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "StackUnwindingWorkerPool.h"
+
+#include <optional>
+#include <utility>
+
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_linux_tracing {
+
+StackUnwindingWorkerPool::StackUnwindingWorkerPool(
+    std::vector<std::unique_ptr<LibunwindstackUnwinder>> unwinders, size_t max_jobs_in_flight)
+    : unwinders_{std::move(unwinders)}, max_jobs_in_flight_{max_jobs_in_flight} {
+  CHECK(!unwinders_.empty());
+  CHECK(max_jobs_in_flight_ > 0);
+  worker_threads_.reserve(unwinders_.size());
+  for (const std::unique_ptr<LibunwindstackUnwinder>& unwinder : unwinders_) {
+    CHECK(unwinder != nullptr);
+    worker_threads_.emplace_back(&StackUnwindingWorkerPool::WorkerThread, this, unwinder.get());
+  }
+}
+
+StackUnwindingWorkerPool::~StackUnwindingWorkerPool() {
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  for (std::thread& worker_thread : worker_threads_) {
+    worker_thread.join();
+  }
+}
+
+void StackUnwindingWorkerPool::SubmitJob(StackUnwindingJob job) {
+  absl::MutexLock lock{&mutex_};
+  mutex_.Await(absl::Condition(
+      +[](StackUnwindingWorkerPool* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+        return self->jobs_in_flight_ < self->max_jobs_in_flight_;
+      },
+      this));
+  pending_jobs_.emplace_back(next_sequence_number_to_submit_, std::move(job));
+  ++next_sequence_number_to_submit_;
+  ++jobs_in_flight_;
+}
+
+std::vector<UnwoundStackSample> StackUnwindingWorkerPool::TakeCompletedResultsInOrder() {
+  absl::MutexLock lock{&mutex_};
+  return TakeCompletedResultsInOrderLocked();
+}
+
+std::vector<UnwoundStackSample> StackUnwindingWorkerPool::WaitForAllAndTakeResults() {
+  absl::MutexLock lock{&mutex_};
+  mutex_.Await(absl::Condition(
+      +[](StackUnwindingWorkerPool* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+        return self->jobs_in_flight_ == 0;
+      },
+      this));
+  std::vector<UnwoundStackSample> results = TakeCompletedResultsInOrderLocked();
+  CHECK(completed_results_.empty());
+  return results;
+}
+
+std::vector<UnwoundStackSample> StackUnwindingWorkerPool::TakeCompletedResultsInOrderLocked() {
+  std::vector<UnwoundStackSample> results;
+  while (true) {
+    auto completed_result_it = completed_results_.find(next_sequence_number_to_take_);
+    if (completed_result_it == completed_results_.end()) {
+      break;
+    }
+    results.emplace_back(std::move(completed_result_it->second));
+    completed_results_.erase(completed_result_it);
+    ++next_sequence_number_to_take_;
+  }
+  return results;
+}
+
+void StackUnwindingWorkerPool::WorkerThread(LibunwindstackUnwinder* unwinder) {
+  orbit_base::SetCurrentThreadName("Tracer.Unwind");
+
+  while (true) {
+    uint64_t sequence_number;
+    std::optional<StackUnwindingJob> job;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](StackUnwindingWorkerPool* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+            return !self->pending_jobs_.empty() || self->stop_requested_;
+          },
+          this));
+      if (pending_jobs_.empty()) {
+        CHECK(stop_requested_);
+        return;
+      }
+      sequence_number = pending_jobs_.front().first;
+      job.emplace(std::move(pending_jobs_.front().second));
+      pending_jobs_.pop_front();
+    }
+
+    LibunwindstackResult libunwindstack_result = [&] {
+      ORBIT_SCOPE("Unwind stack sample");
+      return unwinder->Unwind(job->pid, job->maps, job->registers, job->stack_data.get(),
+                              job->stack_size);
+    }();
+    // Release the stack dump before taking the lock, it's no longer needed.
+    job->stack_data.reset();
+
+    absl::MutexLock lock{&mutex_};
+    completed_results_.emplace(
+        sequence_number, UnwoundStackSample{job->pid, job->tid, job->timestamp_ns,
+                                            job->stack_size, std::move(libunwindstack_result)});
+    --jobs_in_flight_;
+  }
+}
+
+}  // namespace orbit_linux_tracing
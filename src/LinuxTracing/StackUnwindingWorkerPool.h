@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_STACK_UNWINDING_WORKER_POOL_H_
+#define LINUX_TRACING_STACK_UNWINDING_WORKER_POOL_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <asm/perf_regs.h>
+#include <sys/types.h>
+#include <unwindstack/Maps.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+#include "SizeClassMemoryPool.h"
+
+namespace orbit_linux_tracing {
+
+// A stack sample to be unwound by StackUnwindingWorkerPool. The stack dump is owned by the job so
+// that the PerfEvent it was taken from can be discarded as soon as the job has been submitted.
+struct StackUnwindingJob {
+  pid_t pid = -1;
+  pid_t tid = -1;
+  uint64_t timestamp_ns = 0;
+  unwindstack::Maps* maps = nullptr;
+  std::array<uint64_t, PERF_REG_X86_64_MAX> registers{};
+  PooledBuffer stack_data;
+  uint64_t stack_size = 0;
+};
+
+struct UnwoundStackSample {
+  pid_t pid;
+  pid_t tid;
+  uint64_t timestamp_ns;
+  uint64_t stack_size;
+  LibunwindstackResult libunwindstack_result;
+};
+
+// StackUnwindingWorkerPool unwinds stack samples with DWARF information on a set of worker
+// threads, one for each of the LibunwindstackUnwinders passed to the constructor, so that each
+// thread has its own unwinder. Results are handed back strictly in the order in which the jobs
+// were submitted: a result is only returned once the results of all previously submitted jobs
+// have been returned. This allows the caller to keep forwarding callstack samples in timestamp
+// order, as guaranteed by PerfEventProcessor.
+// The workers only read from the unwindstack::Maps of the jobs. As the maps are shared with the
+// caller, they must not be modified until WaitForAllAndTakeResults has returned.
+class StackUnwindingWorkerPool {
+ public:
+  // At most max_jobs_in_flight submitted jobs can be waiting to be unwound or being unwound:
+  // SubmitJob blocks until a worker is done with a job when this limit is reached.
+  explicit StackUnwindingWorkerPool(std::vector<std::unique_ptr<LibunwindstackUnwinder>> unwinders,
+                                    size_t max_jobs_in_flight = kDefaultMaxJobsInFlight);
+
+  StackUnwindingWorkerPool(const StackUnwindingWorkerPool&) = delete;
+  StackUnwindingWorkerPool& operator=(const StackUnwindingWorkerPool&) = delete;
+  StackUnwindingWorkerPool(StackUnwindingWorkerPool&&) = delete;
+  StackUnwindingWorkerPool& operator=(StackUnwindingWorkerPool&&) = delete;
+
+  ~StackUnwindingWorkerPool();
+
+  void SubmitJob(StackUnwindingJob job);
+
+  // Returns, in submission order, the results that are ready and that are not preceded by a
+  // result that is not ready yet. Doesn't block.
+  [[nodiscard]] std::vector<UnwoundStackSample> TakeCompletedResultsInOrder();
+
+  // Blocks until all submitted jobs have been unwound and returns all the remaining results, in
+  // submission order.
+  [[nodiscard]] std::vector<UnwoundStackSample> WaitForAllAndTakeResults();
+
+  [[nodiscard]] size_t GetWorkerCount() const { return worker_threads_.size(); }
+
+  static constexpr size_t kDefaultMaxJobsInFlight = 1024;
+
+ private:
+  void WorkerThread(LibunwindstackUnwinder* unwinder);
+  [[nodiscard]] std::vector<UnwoundStackSample> TakeCompletedResultsInOrderLocked()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  std::vector<std::unique_ptr<LibunwindstackUnwinder>> unwinders_;
+  std::vector<std::thread> worker_threads_;
+  size_t max_jobs_in_flight_;
+
+  absl::Mutex mutex_;
+  std::deque<std::pair<uint64_t, StackUnwindingJob>> pending_jobs_ ABSL_GUARDED_BY(mutex_);
+  size_t jobs_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<uint64_t, UnwoundStackSample> completed_results_ ABSL_GUARDED_BY(mutex_);
+  uint64_t next_sequence_number_to_submit_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t next_sequence_number_to_take_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_STACK_UNWINDING_WORKER_POOL_H_
@@ -0,0 +1,138 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+#include "OrbitBase/Logging.h"
+#include "StackUnwindingWorkerPool.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// Returns a single frame whose pc is the first eight bytes of the stack dump. Jobs with an even
+// pid take longer to unwind, so that the workers complete jobs out of submission order.
+class FakeLibunwindstackUnwinder : public LibunwindstackUnwinder {
+ public:
+  explicit FakeLibunwindstackUnwinder(std::atomic<int>* unwind_count)
+      : unwind_count_{unwind_count} {}
+
+  LibunwindstackResult Unwind(pid_t pid, unwindstack::Maps* /*maps*/,
+                              const std::array<uint64_t, PERF_REG_X86_64_MAX>& /*perf_regs*/,
+                              const void* stack_dump, uint64_t stack_dump_size,
+                              bool /*offline_memory_only*/, size_t /*max_frames*/) override {
+    if (pid % 2 == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ++(*unwind_count_);
+
+    unwindstack::FrameData frame;
+    CHECK(stack_dump_size >= sizeof(frame.pc));
+    std::memcpy(&frame.pc, stack_dump, sizeof(frame.pc));
+    return LibunwindstackResult{{frame}};
+  }
+
+ private:
+  std::atomic<int>* unwind_count_;
+};
+
+std::vector<std::unique_ptr<LibunwindstackUnwinder>> CreateFakeUnwinders(
+    size_t count, std::atomic<int>* unwind_count) {
+  std::vector<std::unique_ptr<LibunwindstackUnwinder>> unwinders;
+  for (size_t i = 0; i < count; ++i) {
+    unwinders.emplace_back(std::make_unique<FakeLibunwindstackUnwinder>(unwind_count));
+  }
+  return unwinders;
+}
+
+StackUnwindingJob MakeJob(pid_t pid, uint64_t timestamp_ns, uint64_t pc) {
+  StackUnwindingJob job;
+  job.pid = pid;
+  job.tid = pid + 1;
+  job.timestamp_ns = timestamp_ns;
+  job.stack_size = sizeof(pc);
+  job.stack_data = MakePooledBuffer(job.stack_size);
+  std::memcpy(job.stack_data.get(), &pc, sizeof(pc));
+  return job;
+}
+
+}  // namespace
+
+TEST(StackUnwindingWorkerPool, ResultsAreReturnedInSubmissionOrder) {
+  constexpr int kJobCount = 100;
+  std::atomic<int> unwind_count = 0;
+  StackUnwindingWorkerPool pool{CreateFakeUnwinders(4, &unwind_count)};
+  EXPECT_EQ(pool.GetWorkerCount(), 4);
+
+  std::vector<UnwoundStackSample> results;
+  for (int i = 0; i < kJobCount; ++i) {
+    pool.SubmitJob(MakeJob(i, 1000 + i, 0xADD000 + i));
+    for (UnwoundStackSample& result : pool.TakeCompletedResultsInOrder()) {
+      results.emplace_back(std::move(result));
+    }
+  }
+  for (UnwoundStackSample& result : pool.WaitForAllAndTakeResults()) {
+    results.emplace_back(std::move(result));
+  }
+
+  EXPECT_EQ(unwind_count, kJobCount);
+  ASSERT_EQ(results.size(), kJobCount);
+  for (int i = 0; i < kJobCount; ++i) {
+    EXPECT_EQ(results[i].pid, i);
+    EXPECT_EQ(results[i].tid, i + 1);
+    EXPECT_EQ(results[i].timestamp_ns, 1000 + i);
+    ASSERT_EQ(results[i].libunwindstack_result.frames().size(), 1);
+    EXPECT_EQ(results[i].libunwindstack_result.frames()[0].pc, 0xADD000 + i);
+  }
+}
+
+TEST(StackUnwindingWorkerPool, WaitForAllAndTakeResultsOnEmptyPoolReturnsNothing) {
+  std::atomic<int> unwind_count = 0;
+  StackUnwindingWorkerPool pool{CreateFakeUnwinders(2, &unwind_count)};
+  EXPECT_TRUE(pool.TakeCompletedResultsInOrder().empty());
+  EXPECT_TRUE(pool.WaitForAllAndTakeResults().empty());
+  EXPECT_EQ(unwind_count, 0);
+}
+
+TEST(StackUnwindingWorkerPool, SubmitJobBlocksWhenMaxJobsInFlightIsReached) {
+  constexpr int kJobCount = 20;
+  std::atomic<int> unwind_count = 0;
+  StackUnwindingWorkerPool pool{CreateFakeUnwinders(1, &unwind_count),
+                                /*max_jobs_in_flight=*/1};
+
+  for (int i = 0; i < kJobCount; ++i) {
+    pool.SubmitJob(MakeJob(2 * i, i, i));
+    // With at most one job in flight, all jobs but the last must have been unwound already.
+    EXPECT_GE(unwind_count, i);
+  }
+
+  std::vector<UnwoundStackSample> results = pool.WaitForAllAndTakeResults();
+  ASSERT_EQ(results.size(), kJobCount);
+  for (int i = 0; i < kJobCount; ++i) {
+    EXPECT_EQ(results[i].timestamp_ns, i);
+  }
+}
+
+TEST(StackUnwindingWorkerPool, DestructorWaitsForPendingJobs) {
+  constexpr int kJobCount = 10;
+  std::atomic<int> unwind_count = 0;
+  {
+    StackUnwindingWorkerPool pool{CreateFakeUnwinders(2, &unwind_count)};
+    for (int i = 0; i < kJobCount; ++i) {
+      pool.SubmitJob(MakeJob(2 * i, i, i));
+    }
+  }
+  EXPECT_EQ(unwind_count, kJobCount);
+}
+
+}  // namespace orbit_linux_tracing
@@ -51,7 +51,7 @@ void SwitchesStatesNamesVisitor::Visit(ExitPerfEvent* event) {
 }
 
 bool SwitchesStatesNamesVisitor::TidMatchesPidFilter(pid_t tid) {
-  if (thread_state_pid_filter_ == kPidFilterNoThreadState) {
+  if (thread_state_pid_filter_.empty()) {
     return false;
   }
 
@@ -60,7 +60,7 @@ bool SwitchesStatesNamesVisitor::TidMatchesPidFilter(pid_t tid) {
     return false;
   }
 
-  return tid_to_pid_it->second == thread_state_pid_filter_;
+  return thread_state_pid_filter_.contains(tid_to_pid_it->second);
 }
 
 std::optional<pid_t> SwitchesStatesNamesVisitor::GetPidOfTid(pid_t tid) {
@@ -169,7 +169,8 @@ void SwitchesStatesNamesVisitor::Visit(SchedWakeupPerfEvent* event) {
   }
 
   std::optional<ThreadStateSlice> state_slice =
-      state_manager_.OnSchedWakeup(event->GetTimestamp(), event->GetWokenTid());
+      state_manager_.OnSchedWakeup(event->GetTimestamp(), event->GetWokenTid(),
+                                   event->GetWakerTid(), event->GetWakerPid());
   if (state_slice.has_value()) {
     CHECK(listener_ != nullptr);
     listener_->OnThreadStateSlice(std::move(state_slice.value()));
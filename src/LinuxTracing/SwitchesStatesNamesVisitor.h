@@ -6,12 +6,14 @@
 #define LINUX_TRACING_THREAD_STATE_VISITOR_H_
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
 #include <sys/types.h>
 
 #include <atomic>
 #include <cstdint>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "ContextSwitchManager.h"
@@ -32,8 +34,8 @@ namespace orbit_linux_tracing {
 // and is updated with ForkPerfEvents (and also ExitPerfEvents, see Visit(ExitPerfEvent*)).
 // For thread states, we are able to collect partial slices at the beginning and at the end of the
 // capture, hence the ProcessInitialState and ProcessRemainingOpenStates methods.
-// Also, we only process thread states of the process with pid specified with
-// SetThreadStatePidFilter (so that we can collect thread states only for the process we are
+// Also, we only process thread states of the processes with pids specified with
+// SetThreadStatePidFilter (so that we can collect thread states only for the processes we are
 // profiling). For this we also need the system-wide association between tids and pids.
 class SwitchesStatesNamesVisitor : public PerfEventVisitor {
  public:
@@ -48,7 +50,9 @@ class SwitchesStatesNamesVisitor : public PerfEventVisitor {
   void SetProduceSchedulingSlices(bool produce_scheduling_slices) {
     produce_scheduling_slices_ = produce_scheduling_slices;
   }
-  void SetThreadStatePidFilter(pid_t pid) { thread_state_pid_filter_ = pid; }
+  void SetThreadStatePidFilter(absl::flat_hash_set<pid_t> pids) {
+    thread_state_pid_filter_ = std::move(pids);
+  }
 
   void ProcessInitialTidToPidAssociation(pid_t tid, pid_t pid);
   void Visit(ForkPerfEvent* event) override;
@@ -74,8 +78,8 @@ class SwitchesStatesNamesVisitor : public PerfEventVisitor {
 
   bool TidMatchesPidFilter(pid_t tid);
   std::optional<pid_t> GetPidOfTid(pid_t tid);
-  static constexpr pid_t kPidFilterNoThreadState = -1;
-  pid_t thread_state_pid_filter_ = kPidFilterNoThreadState;
+  // Empty when no thread state is collected.
+  absl::flat_hash_set<pid_t> thread_state_pid_filter_;
   absl::flat_hash_map<pid_t, pid_t> tid_to_pid_association_;
 
   ContextSwitchManager switch_manager_;
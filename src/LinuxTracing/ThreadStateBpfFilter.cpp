@@ -0,0 +1,197 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ThreadStateBpfFilter.h"
+
+#include <absl/strings/str_format.h>
+#include <linux/perf_event.h>
+#include <stddef.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+
+#include "BpfInstructions.h"
+#include "KernelTracepoints.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// The maximum number of threads of the target that can be tracked.
+constexpr uint32_t kMaxTidCount = 1 << 16;
+
+ErrorMessageOr<int> CreateTidsMap() {
+  bpf_attr attr{};
+  attr.map_type = BPF_MAP_TYPE_HASH;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(uint32_t);
+  attr.max_entries = kMaxTidCount;
+  int map_fd = static_cast<int>(Bpf(BPF_MAP_CREATE, &attr));
+  if (map_fd == -1) {
+    return ErrorMessage{absl::StrFormat("Creating eBPF map: %s", SafeStrerror(errno))};
+  }
+  return map_fd;
+}
+
+ErrorMessageOr<int> LoadTracepointProgram(const std::vector<bpf_insn>& instructions,
+                                          const char* name) {
+  static constexpr const char* kLicense = "BSD";
+  bpf_attr attr{};
+  attr.prog_type = BPF_PROG_TYPE_TRACEPOINT;
+  attr.insns = reinterpret_cast<uint64_t>(instructions.data());
+  attr.insn_cnt = instructions.size();
+  attr.license = reinterpret_cast<uint64_t>(kLicense);
+  int program_fd = static_cast<int>(Bpf(BPF_PROG_LOAD, &attr));
+  if (program_fd == -1) {
+    return ErrorMessage{
+        absl::StrFormat("Loading eBPF program for %s: %s", name, SafeStrerror(errno))};
+  }
+  return program_fd;
+}
+
+// The programs receive in r1 a pointer to the raw tracepoint data, the same that PERF_SAMPLE_RAW
+// provides, whose layout is described in KernelTracepoints.h. They return 0 to drop the event.
+
+// Adds the new thread to the map if it's created by the target. Always keeps the event, as
+// thread names are collected for all threads.
+std::vector<bpf_insn> CreateTaskNewtaskProgram(pid_t target_pid, int tids_map_fd) {
+  return {
+      MovRegister(BPF_REG_6, BPF_REG_1),
+      Call(BPF_FUNC_get_current_pid_tgid),
+      RightShiftImmediate(BPF_REG_0, 32),
+      JumpIfNotEqualImmediate(BPF_REG_0, target_pid, 11),
+      LoadWord(BPF_REG_1, BPF_REG_6, offsetof(task_newtask_tracepoint, pid)),
+      StoreWord(BPF_REG_10, -4, BPF_REG_1),
+      StoreImmediateWord(BPF_REG_10, -8, 0),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -4),
+      MovRegister(BPF_REG_3, BPF_REG_10),
+      AddImmediate(BPF_REG_3, -8),
+      LoadMapFd(BPF_REG_1, tids_map_fd),
+      LoadMapFdSecondHalf(),
+      MovImmediate(BPF_REG_4, BPF_ANY),
+      Call(BPF_FUNC_map_update_elem),
+      // The jump above lands here.
+      MovImmediate(BPF_REG_0, 1),
+      Exit(),
+  };
+}
+
+// Keeps the event if the current thread, i.e., the thread being switched out, belongs to the
+// target, or if the thread being switched in is in the map.
+std::vector<bpf_insn> CreateSchedSwitchProgram(pid_t target_pid, int tids_map_fd) {
+  return {
+      MovRegister(BPF_REG_6, BPF_REG_1),
+      Call(BPF_FUNC_get_current_pid_tgid),
+      RightShiftImmediate(BPF_REG_0, 32),
+      JumpIfEqualImmediate(BPF_REG_0, target_pid, 10),
+      LoadWord(BPF_REG_1, BPF_REG_6, offsetof(sched_switch_tracepoint, next_pid)),
+      StoreWord(BPF_REG_10, -4, BPF_REG_1),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -4),
+      LoadMapFd(BPF_REG_1, tids_map_fd),
+      LoadMapFdSecondHalf(),
+      Call(BPF_FUNC_map_lookup_elem),
+      JumpIfNotEqualImmediate(BPF_REG_0, 0, 2),
+      MovImmediate(BPF_REG_0, 0),
+      Exit(),
+      // Both jumps above land here.
+      MovImmediate(BPF_REG_0, 1),
+      Exit(),
+  };
+}
+
+// Keeps the event if the thread being woken up is in the map.
+std::vector<bpf_insn> CreateSchedWakeupProgram(int tids_map_fd) {
+  return {
+      LoadWord(BPF_REG_1, BPF_REG_1, offsetof(sched_wakeup_tracepoint, pid)),
+      StoreWord(BPF_REG_10, -4, BPF_REG_1),
+      MovRegister(BPF_REG_2, BPF_REG_10),
+      AddImmediate(BPF_REG_2, -4),
+      LoadMapFd(BPF_REG_1, tids_map_fd),
+      LoadMapFdSecondHalf(),
+      Call(BPF_FUNC_map_lookup_elem),
+      JumpIfNotEqualImmediate(BPF_REG_0, 0, 2),
+      MovImmediate(BPF_REG_0, 0),
+      Exit(),
+      // The jump above lands here.
+      MovImmediate(BPF_REG_0, 1),
+      Exit(),
+  };
+}
+
+ErrorMessageOr<void> AttachProgram(int tracepoint_fd, int program_fd) {
+  if (ioctl(tracepoint_fd, PERF_EVENT_IOC_SET_BPF, program_fd) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Attaching eBPF program to tracepoint: %s", SafeStrerror(errno))};
+  }
+  return outcome::success();
+}
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<ThreadStateBpfFilter>> ThreadStateBpfFilter::Create(
+    pid_t target_pid) {
+  OUTCOME_TRY(tids_map_fd, CreateTidsMap());
+
+  std::vector<int> program_fds;
+  for (const auto& [instructions, name] :
+       {std::make_pair(CreateTaskNewtaskProgram(target_pid, tids_map_fd), "task:task_newtask"),
+        std::make_pair(CreateSchedSwitchProgram(target_pid, tids_map_fd), "sched:sched_switch"),
+        std::make_pair(CreateSchedWakeupProgram(tids_map_fd), "sched:sched_wakeup")}) {
+    ErrorMessageOr<int> program_fd_or_error = LoadTracepointProgram(instructions, name);
+    if (program_fd_or_error.has_error()) {
+      for (int program_fd : program_fds) {
+        close(program_fd);
+      }
+      close(tids_map_fd);
+      return program_fd_or_error.error();
+    }
+    program_fds.push_back(program_fd_or_error.value());
+  }
+
+  return std::unique_ptr<ThreadStateBpfFilter>(
+      new ThreadStateBpfFilter{tids_map_fd, program_fds[0], program_fds[1], program_fds[2]});
+}
+
+ThreadStateBpfFilter::~ThreadStateBpfFilter() {
+  // The tracepoint file descriptors keep their own reference to the programs.
+  close(sched_wakeup_program_fd_);
+  close(sched_switch_program_fd_);
+  close(task_newtask_program_fd_);
+  close(tids_map_fd_);
+}
+
+ErrorMessageOr<void> ThreadStateBpfFilter::AttachToTaskNewtask(int tracepoint_fd) const {
+  return AttachProgram(tracepoint_fd, task_newtask_program_fd_);
+}
+
+ErrorMessageOr<void> ThreadStateBpfFilter::AttachToSchedSwitch(int tracepoint_fd) const {
+  return AttachProgram(tracepoint_fd, sched_switch_program_fd_);
+}
+
+ErrorMessageOr<void> ThreadStateBpfFilter::AttachToSchedWakeup(int tracepoint_fd) const {
+  return AttachProgram(tracepoint_fd, sched_wakeup_program_fd_);
+}
+
+ErrorMessageOr<void> ThreadStateBpfFilter::AddTid(pid_t tid) const {
+  uint32_t key = tid;
+  uint32_t value = 0;
+  bpf_attr attr{};
+  attr.map_fd = tids_map_fd_;
+  attr.key = reinterpret_cast<uint64_t>(&key);
+  attr.value = reinterpret_cast<uint64_t>(&value);
+  attr.flags = BPF_ANY;
+  if (Bpf(BPF_MAP_UPDATE_ELEM, &attr) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Adding thread %d to eBPF map: %s", tid, SafeStrerror(errno))};
+  }
+  return outcome::success();
+}
+
+}  // namespace orbit_linux_tracing
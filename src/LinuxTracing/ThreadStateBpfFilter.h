@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_THREAD_STATE_BPF_FILTER_H_
+#define LINUX_TRACING_THREAD_STATE_BPF_FILTER_H_
+
+#include <sys/types.h>
+
+#include <memory>
+
+#include "OrbitBase/Result.h"
+
+namespace orbit_linux_tracing {
+
+// ThreadStateBpfFilter drops in the kernel the sched:sched_switch and sched:sched_wakeup events
+// that are irrelevant for the thread states of the threads of a target process, so that they don't
+// even reach the ring buffers. This is done with eBPF programs attached to the tracepoint file
+// descriptors. A sched:sched_switch event is kept if the thread being switched out belongs to the
+// target or if the thread being switched in is a known thread of the target, a sched:sched_wakeup
+// event if the thread being woken up is a known thread of the target.
+// The threads of the target that already exist need to be added with AddTid, while the program
+// attached to task:task_newtask adds the threads that the target creates later. This happens
+// before a new thread can run, hence no event for it is lost.
+// As SchedulingSlices are produced for all threads, this can only be used when only thread states
+// are collected.
+class ThreadStateBpfFilter {
+ public:
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<ThreadStateBpfFilter>> Create(
+      pid_t target_pid);
+
+  ~ThreadStateBpfFilter();
+  ThreadStateBpfFilter(const ThreadStateBpfFilter&) = delete;
+  ThreadStateBpfFilter& operator=(const ThreadStateBpfFilter&) = delete;
+  ThreadStateBpfFilter(ThreadStateBpfFilter&&) = delete;
+  ThreadStateBpfFilter& operator=(ThreadStateBpfFilter&&) = delete;
+
+  // These attach the corresponding program to a file descriptor opened with tracepoint_event_open.
+  [[nodiscard]] ErrorMessageOr<void> AttachToTaskNewtask(int tracepoint_fd) const;
+  [[nodiscard]] ErrorMessageOr<void> AttachToSchedSwitch(int tracepoint_fd) const;
+  [[nodiscard]] ErrorMessageOr<void> AttachToSchedWakeup(int tracepoint_fd) const;
+
+  [[nodiscard]] ErrorMessageOr<void> AddTid(pid_t tid) const;
+
+ private:
+  ThreadStateBpfFilter(int tids_map_fd, int task_newtask_program_fd, int sched_switch_program_fd,
+                       int sched_wakeup_program_fd)
+      : tids_map_fd_{tids_map_fd},
+        task_newtask_program_fd_{task_newtask_program_fd},
+        sched_switch_program_fd_{sched_switch_program_fd},
+        sched_wakeup_program_fd_{sched_wakeup_program_fd} {}
+
+  const int tids_map_fd_;
+  const int task_newtask_program_fd_;
+  const int sched_switch_program_fd_;
+  const int sched_wakeup_program_fd_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_THREAD_STATE_BPF_FILTER_H_
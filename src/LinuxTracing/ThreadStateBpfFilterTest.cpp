@@ -0,0 +1,25 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include "OrbitBase/ThreadUtils.h"
+#include "ThreadStateBpfFilter.h"
+
+namespace orbit_linux_tracing {
+
+TEST(ThreadStateBpfFilter, ProgramsAreAcceptedByTheVerifier) {
+  auto filter_or_error = ThreadStateBpfFilter::Create(getpid());
+  if (filter_or_error.has_error()) {
+    // Loading eBPF programs requires root or CAP_BPF.
+    GTEST_SKIP() << filter_or_error.error().message();
+  }
+  std::unique_ptr<ThreadStateBpfFilter> filter = std::move(filter_or_error.value());
+  EXPECT_FALSE(filter->AddTid(orbit_base::GetCurrentThreadId()).has_error());
+}
+
+}  // namespace orbit_linux_tracing
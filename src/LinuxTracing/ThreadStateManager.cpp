@@ -44,7 +44,8 @@ void ThreadStateManager::OnNewTask(uint64_t timestamp_ns, pid_t tid) {
 }
 
 std::optional<ThreadStateSlice> ThreadStateManager::OnSchedWakeup(uint64_t timestamp_ns,
-                                                                  pid_t tid) {
+                                                                  pid_t tid, pid_t waker_tid,
+                                                                  pid_t waker_pid) {
   static constexpr ThreadStateSlice::ThreadState kNewState = ThreadStateSlice::kRunnable;
 
   auto open_state_it = tid_open_states_.find(tid);
@@ -78,6 +79,9 @@ std::optional<ThreadStateSlice> ThreadStateManager::OnSchedWakeup(uint64_t times
   slice.set_thread_state(open_state.state);
   slice.set_duration_ns(timestamp_ns - open_state.begin_timestamp_ns);
   slice.set_end_timestamp_ns(timestamp_ns);
+  slice.set_wakeup_reason(ThreadStateSlice::kUnblocked);
+  slice.set_wakeup_tid(waker_tid);
+  slice.set_wakeup_pid(waker_pid);
   tid_open_states_.insert_or_assign(tid, OpenState{kNewState, timestamp_ns});
   return slice;
 }
@@ -49,8 +49,10 @@ class ThreadStateManager {
   void OnInitialState(uint64_t timestamp_ns, pid_t tid,
                       orbit_grpc_protos::ThreadStateSlice::ThreadState state);
   void OnNewTask(uint64_t timestamp_ns, pid_t tid);
+  // `waker_tid` and `waker_pid` are the thread that woke up `tid`, which are set in the slice that
+  // this ends.
   [[nodiscard]] std::optional<orbit_grpc_protos::ThreadStateSlice> OnSchedWakeup(
-      uint64_t timestamp_ns, pid_t tid);
+      uint64_t timestamp_ns, pid_t tid, pid_t waker_tid, pid_t waker_pid);
   [[nodiscard]] std::optional<orbit_grpc_protos::ThreadStateSlice> OnSchedSwitchIn(
       uint64_t timestamp_ns, pid_t tid);
   [[nodiscard]] std::optional<orbit_grpc_protos::ThreadStateSlice> OnSchedSwitchOut(
@@ -19,6 +19,8 @@ using orbit_grpc_protos::ThreadStateSlice;
 
 TEST(ThreadStateManager, OneThread) {
   constexpr pid_t kTid = 42;
+  constexpr pid_t kWakerPid = 50;
+  constexpr pid_t kWakerTid = 51;
   ThreadStateManager manager;
   std::optional<ThreadStateSlice> slice;
 
@@ -38,12 +40,15 @@ TEST(ThreadStateManager, OneThread) {
   EXPECT_EQ(slice->duration_ns(), 100);
   EXPECT_EQ(slice->end_timestamp_ns(), 300);
 
-  slice = manager.OnSchedWakeup(400, kTid);
+  slice = manager.OnSchedWakeup(400, kTid, kWakerTid, kWakerPid);
   ASSERT_TRUE(slice.has_value());
   EXPECT_EQ(slice->tid(), kTid);
   EXPECT_EQ(slice->thread_state(), ThreadStateSlice::kInterruptibleSleep);
   EXPECT_EQ(slice->duration_ns(), 100);
   EXPECT_EQ(slice->end_timestamp_ns(), 400);
+  EXPECT_EQ(slice->wakeup_reason(), ThreadStateSlice::kUnblocked);
+  EXPECT_EQ(slice->wakeup_tid(), kWakerTid);
+  EXPECT_EQ(slice->wakeup_pid(), kWakerPid);
 
   slice = manager.OnSchedSwitchIn(500, kTid);
   ASSERT_TRUE(slice.has_value());
@@ -124,7 +129,7 @@ TEST(ThreadStateManager, TwoThreads) {
   EXPECT_EQ(slice->duration_ns(), 100);
   EXPECT_EQ(slice->end_timestamp_ns(), 350);
 
-  slice = manager.OnSchedWakeup(400, kTid1);
+  slice = manager.OnSchedWakeup(400, kTid1, /*waker_tid=*/0, /*waker_pid=*/0);
   ASSERT_TRUE(slice.has_value());
   EXPECT_EQ(slice->tid(), kTid1);
   EXPECT_EQ(slice->thread_state(), ThreadStateSlice::kInterruptibleSleep);
@@ -205,7 +210,7 @@ TEST(ThreadStateManager, StaleInitialStateWithSchedWakeup) {
 
   manager.OnInitialState(150, kTid, ThreadStateSlice::kRunnable);
 
-  slice = manager.OnSchedWakeup(100, kTid);
+  slice = manager.OnSchedWakeup(100, kTid, /*waker_tid=*/0, /*waker_pid=*/0);
   EXPECT_FALSE(slice.has_value());
 
   slice = manager.OnSchedSwitchIn(200, kTid);
@@ -244,7 +249,7 @@ TEST(ThreadStateManager, StaleInitialStateWithSwitchOut) {
   slice = manager.OnSchedSwitchOut(100, kTid, ThreadStateSlice::kInterruptibleSleep);
   EXPECT_FALSE(slice.has_value());
 
-  slice = manager.OnSchedWakeup(200, kTid);
+  slice = manager.OnSchedWakeup(200, kTid, /*waker_tid=*/0, /*waker_pid=*/0);
   ASSERT_TRUE(slice.has_value());
   EXPECT_EQ(slice->tid(), kTid);
   EXPECT_EQ(slice->thread_state(), ThreadStateSlice::kInterruptibleSleep);
@@ -257,7 +262,7 @@ TEST(ThreadStateManager, UnknownInitialStateWithSchedWakeup) {
   ThreadStateManager manager;
   std::optional<ThreadStateSlice> slice;
 
-  slice = manager.OnSchedWakeup(100, kTid);
+  slice = manager.OnSchedWakeup(100, kTid, /*waker_tid=*/0, /*waker_pid=*/0);
   EXPECT_FALSE(slice.has_value());
 
   slice = manager.OnSchedSwitchIn(200, kTid);
@@ -292,7 +297,7 @@ TEST(ThreadStateManager, UnknownInitialStateWithSwitchOut) {
   slice = manager.OnSchedSwitchOut(100, kTid, ThreadStateSlice::kInterruptibleSleep);
   EXPECT_FALSE(slice.has_value());
 
-  slice = manager.OnSchedWakeup(200, kTid);
+  slice = manager.OnSchedWakeup(200, kTid, /*waker_tid=*/0, /*waker_pid=*/0);
   ASSERT_TRUE(slice.has_value());
   EXPECT_EQ(slice->tid(), kTid);
   EXPECT_EQ(slice->thread_state(), ThreadStateSlice::kInterruptibleSleep);
@@ -307,7 +312,7 @@ TEST(ThreadStateManager, NoStateChangeWithSchedWakeup) {
 
   manager.OnInitialState(100, kTid, ThreadStateSlice::kRunnable);
 
-  slice = manager.OnSchedWakeup(150, kTid);
+  slice = manager.OnSchedWakeup(150, kTid, /*waker_tid=*/0, /*waker_pid=*/0);
   EXPECT_FALSE(slice.has_value());
 
   slice = manager.OnSchedSwitchIn(200, kTid);
@@ -0,0 +1,190 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TracepointFormat.h"
+
+#include <absl/strings/match.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_split.h>
+#include <absl/strings/strip.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "OrbitBase/ReadFileToString.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr std::string_view kFieldKey = "field:";
+constexpr std::string_view kOffsetKey = "offset:";
+constexpr std::string_view kSizeKey = "size:";
+constexpr std::string_view kSignedKey = "signed:";
+constexpr std::string_view kCommonFieldPrefix = "common_";
+
+constexpr std::string_view kDataLocDeclaration = "__data_loc";
+
+enum class FieldKind { kNumeric, kDataLoc };
+
+// A field is described by a line like
+//   field:unsigned int nr_sector;	offset:24;	size:4;	signed:0;
+// Returns std::nullopt for fields that are not of `kind`.
+[[nodiscard]] ErrorMessageOr<std::optional<TracepointField>> ParseFieldLine(std::string_view line,
+                                                                            FieldKind kind) {
+  std::string_view declaration;
+  std::optional<uint32_t> offset;
+  std::optional<uint32_t> size;
+  bool is_signed = false;
+  for (std::string_view part : absl::StrSplit(line, ';', absl::SkipWhitespace())) {
+    part = absl::StripAsciiWhitespace(part);
+    uint32_t value = 0;
+    if (absl::ConsumePrefix(&part, kFieldKey)) {
+      declaration = part;
+    } else if (absl::ConsumePrefix(&part, kOffsetKey) && absl::SimpleAtoi(part, &value)) {
+      offset = value;
+    } else if (absl::ConsumePrefix(&part, kSizeKey) && absl::SimpleAtoi(part, &value)) {
+      size = value;
+    } else if (absl::ConsumePrefix(&part, kSignedKey) && absl::SimpleAtoi(part, &value)) {
+      is_signed = value != 0;
+    }
+  }
+  if (declaration.empty() || !offset.has_value() || !size.has_value()) {
+    return ErrorMessage{absl::StrFormat("Unable to parse tracepoint field \"%s\"", line)};
+  }
+
+  const bool is_data_loc = absl::StartsWith(declaration, kDataLocDeclaration);
+  if (kind == FieldKind::kDataLoc) {
+    // The location of a dynamic array is a single 4-byte integer.
+    if (!is_data_loc || size.value() != 4) return std::nullopt;
+  } else {
+    if (is_data_loc || absl::StrContains(declaration, '[')) return std::nullopt;
+    if (size.value() != 1 && size.value() != 2 && size.value() != 4 && size.value() != 8) {
+      return std::nullopt;
+    }
+  }
+  // The name is the last token of the declaration, e.g., "nr_sector" in "unsigned int nr_sector",
+  // "filename" in "const char * filename", or "cmd" in "__data_loc char[] cmd".
+  size_t name_begin = declaration.find_last_of(" *");
+  std::string_view name =
+      name_begin == std::string_view::npos ? declaration : declaration.substr(name_begin + 1);
+  if (name.empty() || absl::StartsWith(name, kCommonFieldPrefix)) {
+    return std::nullopt;
+  }
+
+  return TracepointField{std::string{name}, offset.value(), size.value(), is_signed};
+}
+
+[[nodiscard]] ErrorMessageOr<std::vector<TracepointField>> ParseTracepointFields(
+    std::string_view format, FieldKind kind) {
+  std::vector<TracepointField> fields;
+  bool format_found = false;
+  for (std::string_view line : absl::StrSplit(format, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (line == "format:") {
+      format_found = true;
+      continue;
+    }
+    if (!format_found || !absl::StartsWith(line, kFieldKey)) continue;
+
+    OUTCOME_TRY(field, ParseFieldLine(line, kind));
+    if (field.has_value()) {
+      fields.push_back(std::move(field.value()));
+    }
+  }
+  if (!format_found) {
+    return ErrorMessage{"Tracepoint format doesn't contain a \"format:\" section"};
+  }
+  return fields;
+}
+
+}  // namespace
+
+ErrorMessageOr<std::vector<TracepointField>> ParseTracepointNumericFields(
+    std::string_view format) {
+  return ParseTracepointFields(format, FieldKind::kNumeric);
+}
+
+ErrorMessageOr<std::vector<TracepointField>> ParseTracepointDataLocFields(
+    std::string_view format) {
+  return ParseTracepointFields(format, FieldKind::kDataLoc);
+}
+
+ErrorMessageOr<std::string> ReadTracepointFormat(const std::string& tracepoint_category,
+                                                 const std::string& tracepoint_name) {
+  std::string filename = absl::StrFormat("/sys/kernel/debug/tracing/events/%s/%s/format",
+                                         tracepoint_category, tracepoint_name);
+  return orbit_base::ReadFileToString(filename);
+}
+
+ErrorMessageOr<std::vector<TracepointField>> ReadTracepointNumericFields(
+    const std::string& tracepoint_category, const std::string& tracepoint_name) {
+  OUTCOME_TRY(format, ReadTracepointFormat(tracepoint_category, tracepoint_name));
+  return ParseTracepointNumericFields(format);
+}
+
+std::vector<TracepointField> SelectTracepointFields(
+    const std::vector<TracepointField>& fields,
+    const std::vector<std::string>& selected_field_names) {
+  if (selected_field_names.empty()) {
+    return {fields.begin(), fields.begin() + std::min(fields.size(), kMaxTracepointFieldCount)};
+  }
+
+  std::vector<TracepointField> selected_fields;
+  for (const std::string& selected_field_name : selected_field_names) {
+    auto it = std::find_if(fields.begin(), fields.end(), [&](const TracepointField& field) {
+      return field.name == selected_field_name;
+    });
+    if (it != fields.end()) {
+      selected_fields.push_back(*it);
+    }
+  }
+  return selected_fields;
+}
+
+std::optional<int64_t> DecodeTracepointField(const TracepointField& field, const char* raw_data,
+                                             size_t raw_data_size) {
+  if (static_cast<size_t>(field.offset) + field.size > raw_data_size) return std::nullopt;
+  const char* field_data = raw_data + field.offset;
+  switch (field.size) {
+    case 1: {
+      uint8_t value = 0;
+      memcpy(&value, field_data, sizeof(value));
+      return field.is_signed ? static_cast<int8_t>(value) : value;
+    }
+    case 2: {
+      uint16_t value = 0;
+      memcpy(&value, field_data, sizeof(value));
+      return field.is_signed ? static_cast<int16_t>(value) : value;
+    }
+    case 4: {
+      uint32_t value = 0;
+      memcpy(&value, field_data, sizeof(value));
+      return field.is_signed ? static_cast<int32_t>(value) : static_cast<int64_t>(value);
+    }
+    case 8: {
+      int64_t value = 0;
+      memcpy(&value, field_data, sizeof(value));
+      return value;
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<std::string> DecodeTracepointDataLocString(const TracepointField& field,
+                                                         const char* raw_data,
+                                                         size_t raw_data_size) {
+  std::optional<int64_t> data_loc = DecodeTracepointField(field, raw_data, raw_data_size);
+  if (!data_loc.has_value()) return std::nullopt;
+  const size_t string_offset = data_loc.value() & 0xffff;
+  const size_t string_size = (data_loc.value() >> 16) & 0xffff;
+  if (string_offset + string_size > raw_data_size) return std::nullopt;
+  // The size includes the terminating null character, which we don't rely on being there.
+  std::string_view string{raw_data + string_offset, string_size};
+  return std::string{string.substr(0, string.find('\0'))};
+}
+
+}  // namespace orbit_linux_tracing
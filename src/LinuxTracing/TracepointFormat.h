@@ -0,0 +1,71 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_TRACEPOINT_FORMAT_H_
+#define LINUX_TRACING_TRACEPOINT_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+
+namespace orbit_linux_tracing {
+
+// A field of the raw data of a tracepoint that holds a single integer, as described by
+// /sys/kernel/debug/tracing/events/<category>/<name>/format. The offset is relative to the
+// beginning of the raw data, i.e., of the char[size] of the PERF_SAMPLE_RAW part of the record.
+struct TracepointField {
+  std::string name;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+  bool is_signed = false;
+};
+
+// The maximum number of fields that are decoded and sent for each tracepoint event, so that the
+// events of tracepoints with many fields stay small.
+inline constexpr size_t kMaxTracepointFieldCount = 8;
+
+// Parses the content of a tracepoint's format file and returns the fields holding a single integer
+// of 1, 2, 4 or 8 bytes. The "common_" fields shared by all tracepoints, arrays and dynamic arrays
+// ("__data_loc") are skipped.
+[[nodiscard]] ErrorMessageOr<std::vector<TracepointField>> ParseTracepointNumericFields(
+    std::string_view format);
+
+// Parses the content of a tracepoint's format file and returns the fields that hold the location
+// of a dynamic array ("__data_loc"), e.g., of a string, in the raw data.
+[[nodiscard]] ErrorMessageOr<std::vector<TracepointField>> ParseTracepointDataLocFields(
+    std::string_view format);
+
+// Reads /sys/kernel/debug/tracing/events/<category>/<name>/format.
+[[nodiscard]] ErrorMessageOr<std::string> ReadTracepointFormat(
+    const std::string& tracepoint_category, const std::string& tracepoint_name);
+
+[[nodiscard]] ErrorMessageOr<std::vector<TracepointField>> ReadTracepointNumericFields(
+    const std::string& tracepoint_category, const std::string& tracepoint_name);
+
+// Returns the fields among `fields` that are in `selected_field_names`, in that order. If
+// `selected_field_names` is empty, returns the first kMaxTracepointFieldCount fields instead.
+[[nodiscard]] std::vector<TracepointField> SelectTracepointFields(
+    const std::vector<TracepointField>& fields,
+    const std::vector<std::string>& selected_field_names);
+
+// Returns the value of `field` in `raw_data`, sign-extended if the field is signed, or
+// std::nullopt if the field doesn't fit in `raw_data`.
+[[nodiscard]] std::optional<int64_t> DecodeTracepointField(const TracepointField& field,
+                                                           const char* raw_data,
+                                                           size_t raw_data_size);
+
+// Returns the string whose location in `raw_data` is held by the "__data_loc" field `field`, or
+// std::nullopt if the field or the string don't fit in `raw_data`.
+[[nodiscard]] std::optional<std::string> DecodeTracepointDataLocString(const TracepointField& field,
+                                                                       const char* raw_data,
+                                                                       size_t raw_data_size);
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_TRACEPOINT_FORMAT_H_
@@ -0,0 +1,135 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TracepointFormat.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr const char* kBlockRqIssueFormat =
+    "name: block_rq_issue\n"
+    "ID: 1123\n"
+    "format:\n"
+    "\tfield:unsigned short common_type;\toffset:0;\tsize:2;\tsigned:0;\n"
+    "\tfield:unsigned char common_flags;\toffset:2;\tsize:1;\tsigned:0;\n"
+    "\tfield:unsigned char common_preempt_count;\toffset:3;\tsize:1;\tsigned:0;\n"
+    "\tfield:int common_pid;\toffset:4;\tsize:4;\tsigned:1;\n"
+    "\n"
+    "\tfield:dev_t dev;\toffset:8;\tsize:4;\tsigned:0;\n"
+    "\tfield:sector_t sector;\toffset:16;\tsize:8;\tsigned:0;\n"
+    "\tfield:unsigned int nr_sector;\toffset:24;\tsize:4;\tsigned:0;\n"
+    "\tfield:unsigned int bytes;\toffset:28;\tsize:4;\tsigned:0;\n"
+    "\tfield:char rwbs[8];\toffset:32;\tsize:8;\tsigned:1;\n"
+    "\tfield:char comm[16];\toffset:40;\tsize:16;\tsigned:1;\n"
+    "\tfield:__data_loc char[] cmd;\toffset:56;\tsize:4;\tsigned:1;\n"
+    "\tfield:const char * filename;\toffset:64;\tsize:8;\tsigned:0;\n"
+    "\tfield:short delta;\toffset:72;\tsize:2;\tsigned:1;\n"
+    "\n"
+    "print fmt: \"%d,%d %s %u (%s) %llu + %u [%s]\", ...\n";
+
+}  // namespace
+
+TEST(TracepointFormat, ParseTracepointNumericFieldsSkipsCommonAndArrayFields) {
+  ErrorMessageOr<std::vector<TracepointField>> fields_or_error =
+      ParseTracepointNumericFields(kBlockRqIssueFormat);
+  ASSERT_FALSE(fields_or_error.has_error()) << fields_or_error.error().message();
+  const std::vector<TracepointField>& fields = fields_or_error.value();
+
+  ASSERT_EQ(fields.size(), 6);
+  EXPECT_EQ(fields[0].name, "dev");
+  EXPECT_EQ(fields[1].name, "sector");
+  EXPECT_EQ(fields[1].offset, 16);
+  EXPECT_EQ(fields[1].size, 8);
+  EXPECT_FALSE(fields[1].is_signed);
+  EXPECT_EQ(fields[2].name, "nr_sector");
+  EXPECT_EQ(fields[3].name, "bytes");
+  EXPECT_EQ(fields[4].name, "filename");
+  EXPECT_EQ(fields[5].name, "delta");
+  EXPECT_EQ(fields[5].offset, 72);
+  EXPECT_EQ(fields[5].size, 2);
+  EXPECT_TRUE(fields[5].is_signed);
+}
+
+TEST(TracepointFormat, ParseTracepointDataLocFields) {
+  ErrorMessageOr<std::vector<TracepointField>> fields_or_error =
+      ParseTracepointDataLocFields(kBlockRqIssueFormat);
+  ASSERT_FALSE(fields_or_error.has_error()) << fields_or_error.error().message();
+  const std::vector<TracepointField>& fields = fields_or_error.value();
+
+  ASSERT_EQ(fields.size(), 1);
+  EXPECT_EQ(fields[0].name, "cmd");
+  EXPECT_EQ(fields[0].offset, 56);
+  EXPECT_EQ(fields[0].size, 4);
+}
+
+TEST(TracepointFormat, ParseTracepointNumericFieldsFailsOnInvalidFormat) {
+  EXPECT_TRUE(ParseTracepointNumericFields("name: block_rq_issue\nID: 1123\n").has_error());
+  EXPECT_TRUE(ParseTracepointNumericFields("format:\n\tfield:int value;\toffset:8;\n").has_error());
+}
+
+TEST(TracepointFormat, SelectTracepointFields) {
+  std::vector<TracepointField> fields;
+  for (size_t i = 0; i < kMaxTracepointFieldCount + 2; ++i) {
+    fields.push_back({"field" + std::to_string(i), static_cast<uint32_t>(8 + 4 * i), 4, false});
+  }
+
+  std::vector<TracepointField> selected_fields = SelectTracepointFields(fields, {});
+  ASSERT_EQ(selected_fields.size(), kMaxTracepointFieldCount);
+  EXPECT_EQ(selected_fields[0].name, "field0");
+
+  selected_fields = SelectTracepointFields(fields, {"field9", "missing", "field2"});
+  ASSERT_EQ(selected_fields.size(), 2);
+  EXPECT_EQ(selected_fields[0].name, "field9");
+  EXPECT_EQ(selected_fields[1].name, "field2");
+}
+
+TEST(TracepointFormat, DecodeTracepointField) {
+  std::array<char, 16> raw_data{};
+  const int16_t negative = -3;
+  memcpy(raw_data.data() + 2, &negative, sizeof(negative));
+  const uint32_t large = 0xFFFFFFF0;
+  memcpy(raw_data.data() + 4, &large, sizeof(large));
+  const uint64_t sector = 123456789012;
+  memcpy(raw_data.data() + 8, &sector, sizeof(sector));
+
+  EXPECT_EQ(DecodeTracepointField({"negative", 2, 2, true}, raw_data.data(), raw_data.size()), -3);
+  EXPECT_EQ(DecodeTracepointField({"large", 4, 4, false}, raw_data.data(), raw_data.size()),
+            0xFFFFFFF0);
+  EXPECT_EQ(DecodeTracepointField({"large", 4, 4, true}, raw_data.data(), raw_data.size()), -16);
+  EXPECT_EQ(DecodeTracepointField({"sector", 8, 8, false}, raw_data.data(), raw_data.size()),
+            123456789012);
+  EXPECT_FALSE(
+      DecodeTracepointField({"truncated", 12, 8, false}, raw_data.data(), raw_data.size())
+          .has_value());
+}
+
+TEST(TracepointFormat, DecodeTracepointDataLocString) {
+  std::array<char, 16> raw_data{};
+  // The string "gfx" with its terminating null character is at offset 8.
+  const uint32_t data_loc = (4 << 16) | 8;
+  memcpy(raw_data.data() + 4, &data_loc, sizeof(data_loc));
+  memcpy(raw_data.data() + 8, "gfx", 4);
+  const uint32_t truncated_data_loc = (8 << 16) | 12;
+  memcpy(raw_data.data(), &truncated_data_loc, sizeof(truncated_data_loc));
+
+  EXPECT_EQ(DecodeTracepointDataLocString({"name", 4, 4, true}, raw_data.data(), raw_data.size()),
+            "gfx");
+  EXPECT_FALSE(
+      DecodeTracepointDataLocString({"truncated", 0, 4, true}, raw_data.data(), raw_data.size())
+          .has_value());
+  EXPECT_FALSE(
+      DecodeTracepointDataLocString({"outside", 14, 4, true}, raw_data.data(), raw_data.size())
+          .has_value());
+}
+
+}  // namespace orbit_linux_tracing
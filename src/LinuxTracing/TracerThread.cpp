@@ -9,12 +9,16 @@
 #include <absl/meta/type_traits.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_join.h>
+#include <absl/time/time.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <cinttypes>
+#include <functional>
+#include <iterator>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -23,6 +27,8 @@
 
 #include "Function.h"
 #include "Introspection/Introspection.h"
+#include "KernelSymbols.h"
+#include "LibunwindstackElfCache.h"
 #include "LibunwindstackMaps.h"
 #include "LibunwindstackUnwinder.h"
 #include "LinuxTracing/TracerListener.h"
@@ -32,6 +38,7 @@
 #include "OrbitBase/GetProcessIds.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/SafeStrerror.h"
 #include "OrbitBase/ThreadUtils.h"
 #include "PerfEventOpen.h"
 #include "PerfEventReaders.h"
@@ -42,10 +49,13 @@ namespace orbit_linux_tracing {
 
 using orbit_base::GetAllPids;
 using orbit_base::GetTidsOfProcess;
+using orbit_grpc_protos::CallstackSample;
 using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::InstrumentedFunction;
 using orbit_grpc_protos::ModuleInfo;
 using orbit_grpc_protos::ModulesSnapshot;
+using orbit_grpc_protos::PerfRecordCorpusHeader;
+using RingBufferSize = orbit_grpc_protos::CaptureOptions::RingBufferSize;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadNamesSnapshot;
 
@@ -54,7 +64,36 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
       target_pid_{capture_options.pid()},
       unwinding_method_{capture_options.unwinding_method()},
       trace_thread_state_{capture_options.trace_thread_state()},
-      trace_gpu_driver_{capture_options.trace_gpu_driver()} {
+      trace_gpu_driver_{capture_options.trace_gpu_driver()},
+      ring_buffer_reader_thread_count_{capture_options.ring_buffer_reader_thread_count()},
+      dwarf_unwinding_thread_count_{capture_options.dwarf_unwinding_thread_count()},
+      wait_for_ring_buffer_data_with_epoll_{
+          capture_options.wait_for_ring_buffer_data_with_epoll()},
+      adaptive_sampling_period_{capture_options.adaptive_sampling_period()},
+      modules_without_frame_pointers_{capture_options.modules_without_frame_pointers().begin(),
+                                      capture_options.modules_without_frame_pointers().end()},
+      filter_thread_state_events_with_bpf_{capture_options.filter_thread_state_events_with_bpf()},
+      collect_pmu_counters_{capture_options.collect_pmu_counters()},
+      collect_off_cpu_callstacks_{capture_options.collect_off_cpu_callstacks() &&
+                                  unwinding_method_ == CaptureOptions::kFramePointers},
+      collect_memory_callstacks_{capture_options.collect_memory_callstacks() &&
+                                 unwinding_method_ == CaptureOptions::kFramePointers},
+      collect_kernel_callstacks_{capture_options.collect_kernel_callstacks() &&
+                                 unwinding_method_ == CaptureOptions::kFramePointers},
+      max_uprobes_per_second_per_function_{
+          capture_options.max_uprobes_per_second_per_function()},
+      adaptive_stack_dump_size_{capture_options.adaptive_stack_dump_size() &&
+                                unwinding_method_ == CaptureOptions::kDwarf},
+      collect_service_health_{capture_options.collect_service_health()},
+      perf_record_corpus_file_path_{capture_options.perf_record_corpus_file_path()},
+      pipeline_latency_probe_period_{capture_options.pipeline_latency_probe_period()} {
+  target_pids_.insert(target_pid_);
+  target_pids_.insert(capture_options.additional_pids().begin(),
+                      capture_options.additional_pids().end());
+
+  ring_buffer_sizes_ = RingBufferSizes::Create(capture_options,
+                                               RingBufferFillStatistics::GetOfPreviousCapture());
+
   if (unwinding_method_ != CaptureOptions::kUndefined) {
     uint32_t stack_dump_size = capture_options.stack_dump_size();
     if (stack_dump_size > kMaxStackSampleUserSize || stack_dump_size == 0) {
@@ -77,8 +116,11 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
   for (const InstrumentedFunction& instrumented_function :
        capture_options.instrumented_functions()) {
     uint64_t function_id = instrumented_function.function_id();
-    instrumented_functions_.emplace_back(function_id, instrumented_function.file_path(),
-                                         instrumented_function.file_offset());
+    std::vector<uint32_t> recorded_argument_indices{
+        instrumented_function.recorded_argument_indices().begin(),
+        instrumented_function.recorded_argument_indices().end()};
+    bool record_return_value = instrumented_function.record_return_value();
+    bool aggregate_latency_in_kernel = instrumented_function.aggregate_latency_in_kernel();
 
     // Manual instrumentation.
     if (instrumented_function.function_type() == InstrumentedFunction::kTimerStart) {
@@ -86,6 +128,17 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
     } else if (instrumented_function.function_type() == InstrumentedFunction::kTimerStop) {
       manual_instrumentation_config_.AddTimerStopFunctionId(function_id);
     }
+    if (instrumented_function.function_type() != InstrumentedFunction::kRegular) {
+      // The manual instrumentation API encodes its events in all the arguments.
+      recorded_argument_indices = {0, 1, 2, 3, 4, 5};
+      record_return_value = true;
+      // The calls of the manual instrumentation API need to produce their events.
+      aggregate_latency_in_kernel = false;
+    }
+
+    instrumented_functions_.emplace_back(
+        function_id, instrumented_function.file_path(), instrumented_function.file_offset(),
+        std::move(recorded_argument_indices), record_return_value, aggregate_latency_in_kernel);
   }
 
   for (const orbit_grpc_protos::TracepointInfo& instrumented_tracepoint :
@@ -95,6 +148,10 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
     info.set_category(instrumented_tracepoint.category());
     instrumented_tracepoints_.emplace_back(info);
   }
+
+  if (!perf_record_corpus_file_path_.empty()) {
+    capture_options_ = capture_options;
+  }
 }
 
 namespace {
@@ -111,19 +168,86 @@ void CloseFileDescriptors(const absl::flat_hash_map<int32_t, int>& fds_per_cpu)
 }
 }  // namespace
 
-void TracerThread::InitUprobesEventVisitor() {
+void TracerThread::InitUprobesEventVisitor(const std::string& initial_maps) {
   ORBIT_SCOPE_FUNCTION;
-  maps_ = LibunwindstackMaps::ParseMaps(ReadMaps(target_pid_));
+  // The Elfs loaded during the capture are kept for later maps of the same files, including in
+  // later captures. Build IDs are associated to the initial maps once the modules have been read.
+  maps_ = LibunwindstackMaps::ParseMaps(initial_maps,
+                                        &LibunwindstackElfCache::GetProcessWideCache());
   unwinder_ = LibunwindstackUnwinder::Create();
-  leaf_function_call_manager_ = std::make_unique<LeafFunctionCallManager>(stack_dump_size_);
+  leaf_function_call_manager_ = std::make_unique<LeafFunctionCallManager>(
+      stack_dump_size_, modules_without_frame_pointers_);
   uprobes_unwinding_visitor_ = std::make_unique<UprobesUnwindingVisitor>(
-      listener_, &function_call_manager_, &return_address_manager_, maps_.get(), unwinder_.get(),
+      batching_listener_.get(), &function_call_manager_, &return_address_manager_, maps_.get(),
+      unwinder_.get(),
       leaf_function_call_manager_.get());
   uprobes_unwinding_visitor_->SetUnwindErrorsAndDiscardedSamplesCounters(
       &stats_.unwind_error_count, &stats_.samples_in_uretprobes_count);
+  if (adaptive_stack_dump_size_) {
+    std::vector<uint16_t> stack_dump_sizes{stack_dump_size_};
+    while (stack_dump_sizes.size() < MAX_ADAPTIVE_STACK_DUMP_SIZE_COUNT &&
+           stack_dump_sizes.back() / 2 >= MIN_ADAPTIVE_STACK_DUMP_SIZE) {
+      stack_dump_sizes.push_back(stack_dump_sizes.back() / 2);
+    }
+    stack_dump_size_controller_ =
+        std::make_unique<AdaptiveStackDumpSizeController>(std::move(stack_dump_sizes));
+    uprobes_unwinding_visitor_->SetStackDumpSizeController(stack_dump_size_controller_.get());
+  }
+  if (collect_service_health_) {
+    uprobes_unwinding_visitor_->SetStackSampleLatenciesNs(&stack_sample_latencies_ns_);
+  }
+  if (collect_kernel_callstacks_) {
+    uprobes_unwinding_visitor_->SetKernelSymbols(&KernelSymbols::GetProcessWideSymbols());
+  }
+  if (max_uprobes_per_second_per_function_ != 0) {
+    // Called on the thread processing the deferred events.
+    uprobes_unwinding_visitor_->SetUprobesBudget(
+        max_uprobes_per_second_per_function_,
+        [this](const Function& function) { return DisableUserSpaceProbes(function); });
+  }
+  if (unwinding_method_ == CaptureOptions::kDwarf && dwarf_unwinding_thread_count_ > 0) {
+    std::vector<std::unique_ptr<LibunwindstackUnwinder>> worker_unwinders;
+    worker_unwinders.reserve(dwarf_unwinding_thread_count_);
+    for (uint32_t i = 0; i < dwarf_unwinding_thread_count_; ++i) {
+      worker_unwinders.emplace_back(LibunwindstackUnwinder::Create());
+    }
+    stack_unwinding_worker_pool_ =
+        std::make_unique<StackUnwindingWorkerPool>(std::move(worker_unwinders));
+    uprobes_unwinding_visitor_->SetStackUnwindingWorkerPool(stack_unwinding_worker_pool_.get());
+    LOG("Unwinding stack samples with %u threads", dwarf_unwinding_thread_count_);
+  }
   event_processor_.AddVisitor(uprobes_unwinding_visitor_.get());
 }
 
+void TracerThread::AddMapsOfAdditionalProcess(pid_t pid, const std::string& initial_maps) {
+  ORBIT_SCOPE_FUNCTION;
+  CHECK(uprobes_unwinding_visitor_ != nullptr);
+  std::unique_ptr<LibunwindstackMaps>& maps = maps_of_additional_pids_[pid];
+  maps = LibunwindstackMaps::ParseMaps(initial_maps,
+                                       &LibunwindstackElfCache::GetProcessWideCache());
+  uprobes_unwinding_visitor_->SetMapsOfProcess(pid, maps.get());
+}
+
+LibunwindstackMaps* TracerThread::GetMapsOfProcess(pid_t pid) const {
+  if (auto it = maps_of_additional_pids_.find(pid); it != maps_of_additional_pids_.end()) {
+    return it->second.get();
+  }
+  return maps_.get();
+}
+
+void TracerThread::SendModulesSnapshot(pid_t pid, const std::vector<ModuleInfo>& modules) {
+  if (LibunwindstackMaps* maps = GetMapsOfProcess(pid); maps != nullptr) {
+    for (const ModuleInfo& module : modules) {
+      maps->SetBuildIdOfFile(module.file_path(), module.build_id());
+    }
+  }
+  ModulesSnapshot modules_snapshot;
+  modules_snapshot.set_pid(pid);
+  modules_snapshot.set_timestamp_ns(effective_capture_start_timestamp_ns_);
+  *modules_snapshot.mutable_modules() = {modules.begin(), modules.end()};
+  listener_->OnModulesSnapshot(std::move(modules_snapshot));
+}
+
 bool TracerThread::OpenUprobes(const orbit_linux_tracing::Function& function,
                                const std::vector<int32_t>& cpus,
                                absl::flat_hash_map<int32_t, int>* fds_per_cpu) {
@@ -169,6 +293,7 @@ void TracerThread::AddUprobesFileDescriptors(
     uprobes_uretprobes_ids_to_function_.emplace(stream_id, &function);
     uprobes_ids_.insert(stream_id);
     tracing_fds_.push_back(fd);
+    uprobes_fds_by_function_id_[function.function_id()].push_back(fd);
   }
 }
 
@@ -181,54 +306,182 @@ void TracerThread::AddUretprobesFileDescriptors(
     uprobes_uretprobes_ids_to_function_.emplace(stream_id, &function);
     uretprobes_ids_.insert(stream_id);
     tracing_fds_.push_back(fd);
+    uretprobes_fds_by_function_id_[function.function_id()].push_back(fd);
   }
 }
 
+bool TracerThread::AttachFunctionLatencyBpfAggregator(
+    const orbit_linux_tracing::Function& function,
+    const absl::flat_hash_map<int32_t, int>& uprobes_fds_per_cpu,
+    const absl::flat_hash_map<int32_t, int>& uretprobes_fds_per_cpu) {
+  ORBIT_SCOPE_FUNCTION;
+  const size_t function_index = function_latency_function_ids_.size();
+  for (const auto [cpu, fd] : uretprobes_fds_per_cpu) {
+    if (auto result = function_latency_bpf_aggregator_->AttachToUretprobe(fd, function_index);
+        result.has_error()) {
+      ERROR("%s", result.error().message());
+      return false;
+    }
+  }
+  for (const auto [cpu, fd] : uprobes_fds_per_cpu) {
+    if (auto result = function_latency_bpf_aggregator_->AttachToUprobe(fd); result.has_error()) {
+      ERROR("%s", result.error().message());
+      return false;
+    }
+  }
+
+  // As for the other functions, uretprobes are enabled before uprobes.
+  for (const auto [cpu, fd] : uretprobes_fds_per_cpu) {
+    tracing_fds_.push_back(fd);
+  }
+  for (const auto [cpu, fd] : uprobes_fds_per_cpu) {
+    tracing_fds_.push_back(fd);
+  }
+  function_latency_function_ids_.push_back(function.function_id());
+  return true;
+}
+
+bool TracerThread::DisableUserSpaceProbes(const orbit_linux_tracing::Function& function) {
+  // Disabling only the uprobe or only the uretprobe of a manual instrumentation function would
+  // leave its timers unmatched.
+  if (manual_instrumentation_config_.IsTimerStartFunction(function.function_id()) ||
+      manual_instrumentation_config_.IsTimerStopFunction(function.function_id())) {
+    return false;
+  }
+
+  // As opposed to when enabling them, uprobes are disabled before uretprobes, so that no uprobe
+  // is left without its uretprobe.
+  if (auto it = uprobes_fds_by_function_id_.find(function.function_id());
+      it != uprobes_fds_by_function_id_.end()) {
+    for (int fd : it->second) {
+      perf_event_disable(fd);
+    }
+  }
+  if (auto it = uretprobes_fds_by_function_id_.find(function.function_id());
+      it != uretprobes_fds_by_function_id_.end()) {
+    for (int fd : it->second) {
+      perf_event_disable(fd);
+    }
+  }
+  LOG("Disabled uprobes and uretprobes of %s+%#" PRIx64 " as they exceeded %u per second",
+      function.file_path(), function.file_offset(), max_uprobes_per_second_per_function_);
+  return true;
+}
+
+bool TracerThread::OpenUserSpaceProbesOfFunction(
+    const orbit_linux_tracing::Function& function, const std::vector<int32_t>& cpus,
+    absl::flat_hash_map<int32_t, int>* uprobes_fds_per_cpu,
+    absl::flat_hash_map<int32_t, int>* uretprobes_fds_per_cpu) {
+  bool success;
+  if (manual_instrumentation_config_.IsTimerStartFunction(function.function_id())) {
+    // Only open uprobes for a "timer start" manual instrumentation function.
+    success = OpenUprobes(function, cpus, uprobes_fds_per_cpu);
+  } else if (manual_instrumentation_config_.IsTimerStopFunction(function.function_id())) {
+    // Only open uretprobes for a "timer stop" manual instrumentation function.
+    success = OpenUretprobes(function, cpus, uretprobes_fds_per_cpu);
+  } else {
+    // Open both uprobes and uretprobes for regular functions.
+    success = OpenUprobes(function, cpus, uprobes_fds_per_cpu) &&
+              OpenUretprobes(function, cpus, uretprobes_fds_per_cpu);
+  }
+  if (!success) {
+    CloseFileDescriptors(*uprobes_fds_per_cpu);
+    CloseFileDescriptors(*uretprobes_fds_per_cpu);
+    uprobes_fds_per_cpu->clear();
+    uretprobes_fds_per_cpu->clear();
+  }
+  return success;
+}
+
 bool TracerThread::OpenUserSpaceProbes(const std::vector<int32_t>& cpus) {
   ORBIT_SCOPE_FUNCTION;
-  bool uprobes_event_open_errors = false;
 
-  absl::flat_hash_map<int32_t, std::vector<int>> uprobes_uretpobres_fds_per_cpu;
-  for (const auto& function : instrumented_functions_) {
+  // perf_event_open for uprobes and uretprobes is slow, and there is one file descriptor per
+  // function and per cpu. As the kernel can register probes of different functions concurrently,
+  // open them from several threads. The file descriptors are only added afterwards, in the order of
+  // the functions, so that the result is the same as when opening them sequentially.
+  struct UserSpaceProbesFds {
+    bool success = false;
     absl::flat_hash_map<int32_t, int> uprobes_fds_per_cpu;
     absl::flat_hash_map<int32_t, int> uretprobes_fds_per_cpu;
+  };
+  std::vector<UserSpaceProbesFds> fds_per_function(instrumented_functions_.size());
+  std::atomic<size_t> next_function_index = 0;
+  auto open_user_space_probes_of_remaining_functions = [&] {
+    for (size_t function_index = next_function_index++;
+         function_index < instrumented_functions_.size();
+         function_index = next_function_index++) {
+      UserSpaceProbesFds& fds = fds_per_function[function_index];
+      fds.success =
+          OpenUserSpaceProbesOfFunction(instrumented_functions_[function_index], cpus,
+                                        &fds.uprobes_fds_per_cpu, &fds.uretprobes_fds_per_cpu);
+    }
+  };
+
+  size_t thread_count =
+      std::min<size_t>({std::max(std::thread::hardware_concurrency(), 1u),
+                        MAX_USER_SPACE_PROBES_OPENING_THREAD_COUNT,
+                        instrumented_functions_.size()});
+  std::vector<std::thread> opening_threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    opening_threads.emplace_back([&open_user_space_probes_of_remaining_functions] {
+      orbit_base::SetCurrentThreadName("Tracer.OpenProbes");
+      open_user_space_probes_of_remaining_functions();
+    });
+  }
+  open_user_space_probes_of_remaining_functions();
+  for (std::thread& opening_thread : opening_threads) {
+    opening_thread.join();
+  }
 
-    if (manual_instrumentation_config_.IsTimerStartFunction(function.function_id())) {
-      // Only open uprobes for a "timer start" manual instrumentation function.
-      if (!OpenUprobes(function, cpus, &uprobes_fds_per_cpu)) {
-        CloseFileDescriptors(uprobes_fds_per_cpu);
-        uprobes_event_open_errors = true;
-        continue;
-      }
-    } else if (manual_instrumentation_config_.IsTimerStopFunction(function.function_id())) {
-      // Only open uretprobes for a "timer stop" manual instrumentation
-      // function.
-      if (!OpenUretprobes(function, cpus, &uretprobes_fds_per_cpu)) {
-        CloseFileDescriptors(uretprobes_fds_per_cpu);
-        uprobes_event_open_errors = true;
-        continue;
-      }
+  // If the eBPF programs can't be loaded, the functions to measure in the kernel simply produce
+  // FunctionCalls like the others. This is also the case when more than one process is captured,
+  // as the programs only measure the calls of one process.
+  const auto aggregated_function_count = static_cast<size_t>(std::count_if(
+      instrumented_functions_.begin(), instrumented_functions_.end(),
+      [](const Function& function) { return function.aggregate_latency_in_kernel(); }));
+  if (aggregated_function_count > 0 && target_pids_.size() == 1) {
+    auto aggregator_or_error =
+        FunctionLatencyBpfAggregator::Create(target_pid_, aggregated_function_count);
+    if (aggregator_or_error.has_error()) {
+      ERROR("Creating eBPF programs to measure function calls in the kernel: %s",
+            aggregator_or_error.error().message());
     } else {
-      // Open both uprobes and uretprobes for regular functions.
-      bool success = OpenUprobes(function, cpus, &uprobes_fds_per_cpu) &&
-                     OpenUretprobes(function, cpus, &uretprobes_fds_per_cpu);
-      if (!success) {
-        CloseFileDescriptors(uprobes_fds_per_cpu);
-        CloseFileDescriptors(uretprobes_fds_per_cpu);
+      function_latency_bpf_aggregator_ = std::move(aggregator_or_error.value());
+      LOG("Measuring the calls of %u functions in the kernel", aggregated_function_count);
+    }
+  }
+
+  bool uprobes_event_open_errors = false;
+  absl::flat_hash_map<int32_t, std::vector<int>> uprobes_uretpobres_fds_per_cpu;
+  for (size_t function_index = 0; function_index < instrumented_functions_.size();
+       ++function_index) {
+    const Function& function = instrumented_functions_[function_index];
+    const UserSpaceProbesFds& fds = fds_per_function[function_index];
+    if (!fds.success) {
+      uprobes_event_open_errors = true;
+      continue;
+    }
+
+    if (function.aggregate_latency_in_kernel() && function_latency_bpf_aggregator_ != nullptr) {
+      if (!AttachFunctionLatencyBpfAggregator(function, fds.uprobes_fds_per_cpu,
+                                              fds.uretprobes_fds_per_cpu)) {
+        CloseFileDescriptors(fds.uprobes_fds_per_cpu);
+        CloseFileDescriptors(fds.uretprobes_fds_per_cpu);
         uprobes_event_open_errors = true;
-        continue;
       }
+      continue;
     }
 
     // Uretprobe need to be enabled before uprobes as we support temporarily
     // not having a uprobe associated with a uretprobe but not the opposite.
-    AddUretprobesFileDescriptors(uretprobes_fds_per_cpu, function);
-    AddUprobesFileDescriptors(uprobes_fds_per_cpu, function);
+    AddUretprobesFileDescriptors(fds.uretprobes_fds_per_cpu, function);
+    AddUprobesFileDescriptors(fds.uprobes_fds_per_cpu, function);
 
-    for (const auto& [cpu, fd] : uretprobes_fds_per_cpu) {
+    for (const auto& [cpu, fd] : fds.uretprobes_fds_per_cpu) {
       uprobes_uretpobres_fds_per_cpu[cpu].push_back(fd);
     }
-    for (const auto& [cpu, fd] : uprobes_fds_per_cpu) {
+    for (const auto& [cpu, fd] : fds.uprobes_fds_per_cpu) {
       uprobes_uretpobres_fds_per_cpu[cpu].push_back(fd);
     }
   }
@@ -247,7 +500,10 @@ void TracerThread::OpenUserSpaceProbesRingBuffers(
     // Create a single ring buffer per cpu.
     int ring_buffer_fd = fds[0];
     std::string buffer_name = absl::StrFormat("uprobes_uretprobes_%u", cpu);
-    ring_buffers_.emplace_back(ring_buffer_fd, UPROBES_RING_BUFFER_SIZE_KB, buffer_name);
+    ring_buffers_.emplace_back(ring_buffer_fd,
+                               ring_buffer_sizes_.GetSizeKb(RingBufferSize::kUprobes, cpu),
+                               buffer_name);
+    RememberRingBufferCategoryAndCpu(ring_buffer_fd, RingBufferSize::kUprobes, cpu);
 
     // Redirect subsequent fds to the cpu specific ring buffer created above.
     for (size_t i = 1; i < fds.size(); ++i) {
@@ -263,9 +519,10 @@ bool TracerThread::OpenMmapTask(const std::vector<int32_t>& cpus) {
   for (int32_t cpu : cpus) {
     int mmap_task_fd = mmap_task_event_open(-1, cpu);
     std::string buffer_name = absl::StrFormat("mmap_task_%d", cpu);
-    PerfEventRingBuffer mmap_task_ring_buffer{mmap_task_fd, MMAP_TASK_RING_BUFFER_SIZE_KB,
-                                              buffer_name};
+    PerfEventRingBuffer mmap_task_ring_buffer{
+        mmap_task_fd, ring_buffer_sizes_.GetSizeKb(RingBufferSize::kMmapTask, cpu), buffer_name};
     if (mmap_task_ring_buffer.IsOpen()) {
+      RememberRingBufferCategoryAndCpu(mmap_task_fd, RingBufferSize::kMmapTask, cpu);
       mmap_task_tracing_fds.push_back(mmap_task_fd);
       mmap_task_ring_buffers.push_back(std::move(mmap_task_ring_buffer));
     } else {
@@ -292,7 +549,8 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
     int sampling_fd;
     switch (unwinding_method_) {
       case CaptureOptions::kFramePointers:
-        sampling_fd = callchain_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_);
+        sampling_fd = callchain_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_,
+                                                  collect_kernel_callstacks_);
         break;
       case CaptureOptions::kDwarf:
         sampling_fd = stack_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_);
@@ -305,9 +563,10 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
     }
 
     std::string buffer_name = absl::StrFormat("sampling_%d", cpu);
-    PerfEventRingBuffer sampling_ring_buffer{sampling_fd, SAMPLING_RING_BUFFER_SIZE_KB,
-                                             buffer_name};
+    PerfEventRingBuffer sampling_ring_buffer{
+        sampling_fd, ring_buffer_sizes_.GetSizeKb(RingBufferSize::kSampling, cpu), buffer_name};
     if (sampling_ring_buffer.IsOpen()) {
+      RememberRingBufferCategoryAndCpu(sampling_fd, RingBufferSize::kSampling, cpu);
       sampling_tracing_fds.push_back(sampling_fd);
       sampling_ring_buffers.push_back(std::move(sampling_ring_buffer));
     } else {
@@ -317,7 +576,9 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
     }
   }
 
-  for (int fd : sampling_tracing_fds) {
+  CHECK(sampling_tracing_fds.size() == cpus.size());
+  for (size_t cpu_index = 0; cpu_index < cpus.size(); ++cpu_index) {
+    int fd = sampling_tracing_fds[cpu_index];
     tracing_fds_.push_back(fd);
     uint64_t stream_id = perf_event_get_id(fd);
     if (unwinding_method_ == CaptureOptions::kDwarf) {
@@ -325,18 +586,218 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
     } else if (unwinding_method_ == CaptureOptions::kFramePointers) {
       callchain_sampling_ids_.insert(stream_id);
     }
+    if (adaptive_sampling_period_) {
+      sampling_fds_to_cpu_.emplace(fd, cpus[cpu_index]);
+      sampling_fds_per_cpu_.emplace(cpus[cpu_index], fd);
+    }
+    if (stack_dump_size_controller_ != nullptr) {
+      stack_sampling_fds_per_cpu_by_stack_dump_size_[stack_dump_size_][cpus[cpu_index]] = fd;
+    }
   }
   for (PerfEventRingBuffer& buffer : sampling_ring_buffers) {
     ring_buffers_.emplace_back(std::move(buffer));
   }
+
+  if (stack_dump_size_controller_ != nullptr) {
+    OpenStackSamplingWithSmallerStackDumps(cpus);
+  }
+  return true;
+}
+
+void TracerThread::OpenStackSamplingWithSmallerStackDumps(const std::vector<int32_t>& cpus) {
+  ORBIT_SCOPE_FUNCTION;
+  // Each cpu gets one more file descriptor for each smaller stack dump size. They write to the ring
+  // buffer of the file descriptor with the full stack dump size, and only the one of the current
+  // size is enabled.
+  absl::flat_hash_map<uint16_t, absl::flat_hash_map<int32_t, int>> fds_per_cpu_by_stack_dump_size;
+  const absl::flat_hash_map<int32_t, int>& ring_buffer_fds_per_cpu =
+      stack_sampling_fds_per_cpu_by_stack_dump_size_.at(stack_dump_size_);
+  for (uint16_t stack_dump_size : stack_dump_size_controller_->GetStackDumpSizes()) {
+    if (stack_dump_size == stack_dump_size_) {
+      continue;
+    }
+    for (int32_t cpu : cpus) {
+      int fd = stack_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size);
+      if (fd < 0) {
+        ERROR("Opening sampling with stack dump size %u for cpu %d", stack_dump_size, cpu);
+        for (const auto& [unused_size, fds_per_cpu] : fds_per_cpu_by_stack_dump_size) {
+          CloseFileDescriptors(fds_per_cpu);
+        }
+        LOG("The stack dump size of samples stays %u", stack_dump_size_);
+        stack_sampling_fds_per_cpu_by_stack_dump_size_.clear();
+        stack_dump_size_controller_.reset();
+        uprobes_unwinding_visitor_->SetStackDumpSizeController(nullptr);
+        return;
+      }
+      perf_event_redirect(fd, ring_buffer_fds_per_cpu.at(cpu));
+      fds_per_cpu_by_stack_dump_size[stack_dump_size][cpu] = fd;
+    }
+  }
+
+  for (const auto& [stack_dump_size, fds_per_cpu] : fds_per_cpu_by_stack_dump_size) {
+    for (const auto& [cpu, fd] : fds_per_cpu) {
+      tracing_fds_.push_back(fd);
+      fds_to_leave_disabled_.insert(fd);
+      stack_sampling_ids_.insert(perf_event_get_id(fd));
+    }
+    stack_sampling_fds_per_cpu_by_stack_dump_size_.emplace(stack_dump_size, fds_per_cpu);
+  }
+}
+
+bool TracerThread::OpenPmuCounters(const std::vector<int32_t>& cpus) {
+  ORBIT_SCOPE_FUNCTION;
+  std::vector<int> leader_fds;
+  std::vector<int> counter_fds;
+  std::vector<PerfEventRingBuffer> pmu_counters_ring_buffers;
+  for (int32_t cpu : cpus) {
+    int leader_fd = pmu_counters_sample_event_open(sampling_period_ns_, -1, cpu, &counter_fds);
+    std::string buffer_name = absl::StrFormat("pmu_counters_%d", cpu);
+    PerfEventRingBuffer ring_buffer{
+        leader_fd, ring_buffer_sizes_.GetSizeKb(RingBufferSize::kPmuCounters, cpu), buffer_name};
+    if (ring_buffer.IsOpen()) {
+      RememberRingBufferCategoryAndCpu(leader_fd, RingBufferSize::kPmuCounters, cpu);
+      leader_fds.push_back(leader_fd);
+      pmu_counters_ring_buffers.push_back(std::move(ring_buffer));
+    } else {
+      ERROR("Opening PMU counters for cpu %d", cpu);
+      if (leader_fd != -1) {
+        close(leader_fd);
+      }
+      CloseFileDescriptors(leader_fds);
+      CloseFileDescriptors(counter_fds);
+      return false;
+    }
+  }
+
+  for (int fd : leader_fds) {
+    tracing_fds_.push_back(fd);
+    pmu_counters_sample_ids_.insert(perf_event_get_id(fd));
+  }
+  // The counters don't have a ring buffer, but they need to be closed together with the leaders.
+  tracing_fds_.insert(tracing_fds_.end(), counter_fds.begin(), counter_fds.end());
+  for (PerfEventRingBuffer& buffer : pmu_counters_ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
+  return true;
+}
+
+bool TracerThread::OpenOffCpuCallstacks(const std::vector<int32_t>& cpus) {
+  ORBIT_SCOPE_FUNCTION;
+  std::vector<int> off_cpu_callstack_fds;
+  std::vector<PerfEventRingBuffer> off_cpu_callstack_ring_buffers;
+  for (int32_t cpu : cpus) {
+    int fd = tracepoint_callchain_event_open("sched", "sched_switch", -1, cpu, stack_dump_size_,
+                                             collect_kernel_callstacks_);
+    std::string buffer_name = absl::StrFormat("off_cpu_callstacks_%d", cpu);
+    PerfEventRingBuffer ring_buffer{
+        fd, ring_buffer_sizes_.GetSizeKb(RingBufferSize::kOffCpuCallstacks, cpu), buffer_name};
+    if (ring_buffer.IsOpen()) {
+      RememberRingBufferCategoryAndCpu(fd, RingBufferSize::kOffCpuCallstacks, cpu);
+      off_cpu_callstack_fds.push_back(fd);
+      off_cpu_callstack_ring_buffers.push_back(std::move(ring_buffer));
+    } else {
+      ERROR("Opening off-CPU callstacks for cpu %d", cpu);
+      if (fd != -1) {
+        close(fd);
+      }
+      CloseFileDescriptors(off_cpu_callstack_fds);
+      return false;
+    }
+  }
+
+  // Only keep the switches out of threads that block (TASK_INTERRUPTIBLE or TASK_UNINTERRUPTIBLE),
+  // not of those that are preempted. Without the filter, the time spent runnable is also counted.
+  for (int fd : off_cpu_callstack_fds) {
+    if (!perf_event_set_filter(fd, "prev_state & 3")) {
+      ERROR("Setting filter on sched:sched_switch for off-CPU callstacks: %s",
+            SafeStrerror(errno));
+      break;
+    }
+  }
+
+  for (int fd : off_cpu_callstack_fds) {
+    tracing_fds_.push_back(fd);
+    off_cpu_callstack_ids_.insert(perf_event_get_id(fd));
+  }
+  for (PerfEventRingBuffer& buffer : off_cpu_callstack_ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
+  return true;
+}
+
+bool TracerThread::OpenMemoryCallstacks(const std::vector<int32_t>& cpus) {
+  ORBIT_SCOPE_FUNCTION;
+  // The ring buffer of each cpu is shared by the three events, using PERF_EVENT_IOC_SET_OUTPUT.
+  std::vector<int> page_fault_fds;
+  std::vector<int> mmap_fds;
+  std::vector<int> brk_fds;
+  std::vector<PerfEventRingBuffer> memory_callstack_ring_buffers;
+  bool success = true;
+  for (int32_t cpu : cpus) {
+    int page_fault_fd =
+        page_faults_callchain_sample_event_open(MEMORY_CALLSTACKS_PAGE_FAULTS_PERIOD, -1, cpu,
+                                                stack_dump_size_, collect_kernel_callstacks_);
+    // The kernel frames of the system call tracepoints are always the ones of the system call
+    // entry, so they are not recorded.
+    int mmap_fd = tracepoint_callchain_event_open("syscalls", "sys_enter_mmap", -1, cpu,
+                                                  stack_dump_size_, false);
+    int brk_fd = tracepoint_callchain_event_open("syscalls", "sys_enter_brk", -1, cpu,
+                                                 stack_dump_size_, false);
+    // Keep track of the file descriptors right away, so that they are closed on failure.
+    if (page_fault_fd != -1) page_fault_fds.push_back(page_fault_fd);
+    if (mmap_fd != -1) mmap_fds.push_back(mmap_fd);
+    if (brk_fd != -1) brk_fds.push_back(brk_fd);
+    if (page_fault_fd == -1 || mmap_fd == -1 || brk_fd == -1) {
+      ERROR("Opening memory callstacks for cpu %d", cpu);
+      success = false;
+      break;
+    }
+
+    std::string buffer_name = absl::StrFormat("memory_callstacks_%d", cpu);
+    PerfEventRingBuffer ring_buffer{
+        page_fault_fd, ring_buffer_sizes_.GetSizeKb(RingBufferSize::kMemoryCallstacks, cpu),
+        buffer_name};
+    if (!ring_buffer.IsOpen()) {
+      ERROR("Opening memory callstacks for cpu %d", cpu);
+      success = false;
+      break;
+    }
+    RememberRingBufferCategoryAndCpu(page_fault_fd, RingBufferSize::kMemoryCallstacks, cpu);
+    perf_event_redirect(mmap_fd, page_fault_fd);
+    perf_event_redirect(brk_fd, page_fault_fd);
+    memory_callstack_ring_buffers.push_back(std::move(ring_buffer));
+  }
+
+  if (!success) {
+    CloseFileDescriptors(page_fault_fds);
+    CloseFileDescriptors(mmap_fds);
+    CloseFileDescriptors(brk_fds);
+    return false;
+  }
+
+  for (int fd : page_fault_fds) {
+    tracing_fds_.push_back(fd);
+    page_fault_callstack_ids_.insert(perf_event_get_id(fd));
+  }
+  for (int fd : mmap_fds) {
+    tracing_fds_.push_back(fd);
+    mmap_callstack_ids_.insert(perf_event_get_id(fd));
+  }
+  for (int fd : brk_fds) {
+    tracing_fds_.push_back(fd);
+    brk_callstack_ids_.insert(perf_event_get_id(fd));
+  }
+  for (PerfEventRingBuffer& buffer : memory_callstack_ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
   return true;
 }
 
 static void OpenRingBuffersOrRedirectOnExisting(
     const absl::flat_hash_map<int32_t, int>& fds_per_cpu,
     absl::flat_hash_map<int32_t, int>* ring_buffer_fds_per_cpu,
-    std::vector<PerfEventRingBuffer>* ring_buffers, uint64_t ring_buffer_size_kb,
-    std::string_view buffer_name_prefix) {
+    std::vector<PerfEventRingBuffer>* ring_buffers, const RingBufferSizes& ring_buffer_sizes,
+    RingBufferCategory ring_buffer_category, std::string_view buffer_name_prefix) {
   ORBIT_SCOPE_FUNCTION;
   // Redirect all events on the same cpu to a single ring buffer.
   for (const auto& cpu_and_fd : fds_per_cpu) {
@@ -350,7 +811,9 @@ static void OpenRingBuffersOrRedirectOnExisting(
       // Create a ring buffer for this cpu.
       int ring_buffer_fd = fd;
       std::string buffer_name = absl::StrFormat("%s_%d", buffer_name_prefix, cpu);
-      ring_buffers->emplace_back(ring_buffer_fd, ring_buffer_size_kb, buffer_name);
+      ring_buffers->emplace_back(ring_buffer_fd,
+                                 ring_buffer_sizes.GetSizeKb(ring_buffer_category, cpu),
+                                 buffer_name);
       ring_buffer_fds_per_cpu->emplace(cpu, ring_buffer_fd);
     }
   }
@@ -360,21 +823,26 @@ namespace {
 
 struct TracepointToOpen {
   TracepointToOpen(const char* tracepoint_category, const char* tracepoint_name,
-                   absl::flat_hash_set<uint64_t>* tracepoint_stream_ids)
+                   absl::flat_hash_set<uint64_t>* tracepoint_stream_ids,
+                   std::vector<int>* tracepoint_fds = nullptr)
       : tracepoint_category{tracepoint_category},
         tracepoint_name{tracepoint_name},
-        tracepoint_stream_ids{tracepoint_stream_ids} {}
+        tracepoint_stream_ids{tracepoint_stream_ids},
+        tracepoint_fds{tracepoint_fds} {}
 
   const char* const tracepoint_category;
   const char* const tracepoint_name;
   absl::flat_hash_set<uint64_t>* const tracepoint_stream_ids;
+  // Optional, receives the file descriptors of the tracepoint for all cpus.
+  std::vector<int>* const tracepoint_fds;
 };
 
 }  // namespace
 
 static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     const std::vector<TracepointToOpen>& tracepoints_to_open, const std::vector<int32_t>& cpus,
-    std::vector<int>* tracing_fds, uint64_t ring_buffer_size_kb,
+    std::vector<int>* tracing_fds, const RingBufferSizes& ring_buffer_sizes,
+    RingBufferCategory ring_buffer_category,
     absl::flat_hash_map<int32_t, int>* tracepoint_ring_buffer_fds_per_cpu_for_redirection,
     std::vector<PerfEventRingBuffer>* ring_buffers) {
   ORBIT_SCOPE_FUNCTION;
@@ -411,10 +879,14 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     const size_t tracepoint_index = index_and_tracepoint_fds_per_cpu.first;
     absl::flat_hash_set<uint64_t>* tracepoint_stream_ids =
         tracepoints_to_open[tracepoint_index].tracepoint_stream_ids;
+    std::vector<int>* tracepoint_fds = tracepoints_to_open[tracepoint_index].tracepoint_fds;
 
     for (const auto& cpu_and_fd : index_and_tracepoint_fds_per_cpu.second) {
       tracing_fds->push_back(cpu_and_fd.second);
       tracepoint_stream_ids->insert(perf_event_get_id(cpu_and_fd.second));
+      if (tracepoint_fds != nullptr) {
+        tracepoint_fds->push_back(cpu_and_fd.second);
+      }
     }
   }
 
@@ -428,7 +900,8 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
 
     OpenRingBuffersOrRedirectOnExisting(
         tracepoint_fds_per_cpu, tracepoint_ring_buffer_fds_per_cpu_for_redirection, ring_buffers,
-        ring_buffer_size_kb, absl::StrFormat("%s:%s", tracepoint_category, tracepoint_name));
+        ring_buffer_sizes, ring_buffer_category,
+        absl::StrFormat("%s:%s", tracepoint_category, tracepoint_name));
   }
   return true;
 }
@@ -436,18 +909,26 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
 bool TracerThread::OpenThreadNameTracepoints(const std::vector<int32_t>& cpus) {
   ORBIT_SCOPE_FUNCTION;
   absl::flat_hash_map<int32_t, int> thread_name_tracepoint_ring_buffer_fds_per_cpu;
-  return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
-      {{"task", "task_newtask", &task_newtask_ids_}, {"task", "task_rename", &task_rename_ids_}},
-      cpus, &tracing_fds_, THREAD_NAMES_RING_BUFFER_SIZE_KB,
-      &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+  if (!OpenFileDescriptorsAndRingBuffersForAllTracepoints(
+          {{"task", "task_newtask", &task_newtask_ids_, &task_newtask_fds_},
+           {"task", "task_rename", &task_rename_ids_}},
+          cpus, &tracing_fds_, ring_buffer_sizes_, RingBufferSize::kThreadNames,
+          &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_)) {
+    return false;
+  }
+  RememberRingBufferCategoryAndCpu(thread_name_tracepoint_ring_buffer_fds_per_cpu,
+                                   RingBufferSize::kThreadNames);
+  return true;
 }
 
 void TracerThread::InitSwitchesStatesNamesVisitor() {
   ORBIT_SCOPE_FUNCTION;
-  switches_states_names_visitor_ = std::make_unique<SwitchesStatesNamesVisitor>(listener_);
-  switches_states_names_visitor_->SetProduceSchedulingSlices(trace_context_switches_);
+  switches_states_names_visitor_ =
+      std::make_unique<SwitchesStatesNamesVisitor>(batching_listener_.get());
+  // SchedulingSlices are produced by the RingBufferReaders instead.
+  switches_states_names_visitor_->SetProduceSchedulingSlices(false);
   if (trace_thread_state_) {
-    switches_states_names_visitor_->SetThreadStatePidFilter(target_pid_);
+    switches_states_names_visitor_->SetThreadStatePidFilter(target_pids_);
   }
   switches_states_names_visitor_->SetThreadStateCounter(&stats_.thread_state_count);
   event_processor_.AddVisitor(switches_states_names_visitor_.get());
@@ -456,30 +937,120 @@ void TracerThread::InitSwitchesStatesNamesVisitor() {
 bool TracerThread::OpenContextSwitchAndThreadStateTracepoints(const std::vector<int32_t>& cpus) {
   ORBIT_SCOPE_FUNCTION;
   std::vector<TracepointToOpen> tracepoints_to_open;
-  if (trace_thread_state_ || trace_context_switches_) {
-    tracepoints_to_open.emplace_back("sched", "sched_switch", &sched_switch_ids_);
+  std::vector<int> sched_switch_fds;
+  std::vector<int> sched_wakeup_fds;
+  if (trace_thread_state_ || trace_context_switches_ || collect_off_cpu_callstacks_) {
+    tracepoints_to_open.emplace_back("sched", "sched_switch", &sched_switch_ids_,
+                                     &sched_switch_fds);
   }
   if (trace_thread_state_) {
     // We also need task:task_newtask, but this is already opened by OpenThreadNameTracepoints.
-    tracepoints_to_open.emplace_back("sched", "sched_wakeup", &sched_wakeup_ids_);
+    tracepoints_to_open.emplace_back("sched", "sched_wakeup", &sched_wakeup_ids_,
+                                     &sched_wakeup_fds);
   }
   if (tracepoints_to_open.empty()) {
     return true;
   }
 
   absl::flat_hash_map<int32_t, int> thread_state_tracepoint_ring_buffer_fds_per_cpu;
-  return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
-      tracepoints_to_open, cpus, &tracing_fds_,
-      CONTEXT_SWITCHES_AND_THREAD_STATE_RING_BUFFER_SIZE_KB,
-      &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+  if (!OpenFileDescriptorsAndRingBuffersForAllTracepoints(
+          tracepoints_to_open, cpus, &tracing_fds_, ring_buffer_sizes_,
+          RingBufferSize::kContextSwitchesAndThreadState,
+          &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_)) {
+    return false;
+  }
+  RememberRingBufferCategoryAndCpu(thread_state_tracepoint_ring_buffer_fds_per_cpu,
+                                   RingBufferSize::kContextSwitchesAndThreadState);
+
+  // SchedulingSlices need the context switches of all threads. The filter only knows the threads
+  // of one process.
+  if (filter_thread_state_events_with_bpf_ && trace_thread_state_ && !trace_context_switches_ &&
+      target_pids_.size() == 1) {
+    AttachThreadStateBpfFilter(sched_switch_fds, sched_wakeup_fds);
+  }
+  return true;
+}
+
+void TracerThread::AttachThreadStateBpfFilter(const std::vector<int>& sched_switch_fds,
+                                              const std::vector<int>& sched_wakeup_fds) {
+  ORBIT_SCOPE_FUNCTION;
+  // On any error, the events that haven't been filtered in the kernel are simply filtered by
+  // SwitchesStatesNamesVisitor, as without the filter.
+  auto filter_or_error = ThreadStateBpfFilter::Create(target_pid_);
+  if (filter_or_error.has_error()) {
+    ERROR("Creating eBPF filter for thread state events: %s", filter_or_error.error().message());
+    return;
+  }
+
+  // Without the program that adds the new threads of the target on all cpus, the other programs
+  // would drop events of those threads.
+  for (int fd : task_newtask_fds_) {
+    if (auto result = filter_or_error.value()->AttachToTaskNewtask(fd); result.has_error()) {
+      ERROR("%s", result.error().message());
+      return;
+    }
+  }
+  thread_state_bpf_filter_ = std::move(filter_or_error.value());
+
+  for (int fd : sched_switch_fds) {
+    if (auto result = thread_state_bpf_filter_->AttachToSchedSwitch(fd); result.has_error()) {
+      ERROR("%s", result.error().message());
+    }
+  }
+  for (int fd : sched_wakeup_fds) {
+    if (auto result = thread_state_bpf_filter_->AttachToSchedWakeup(fd); result.has_error()) {
+      ERROR("%s", result.error().message());
+    }
+  }
+  LOG("Filtering sched:sched_switch and sched:sched_wakeup events with eBPF");
 }
 
 void TracerThread::InitGpuTracepointEventVisitor() {
   ORBIT_SCOPE_FUNCTION;
-  gpu_event_visitor_ = std::make_unique<GpuTracepointVisitor>(listener_);
+  gpu_event_visitor_ = std::make_unique<GpuTracepointVisitor>(batching_listener_.get());
   event_processor_.AddVisitor(gpu_event_visitor_.get());
 }
 
+bool TracerThread::ReadDrmSchedTracepointLayouts() {
+  ErrorMessageOr<DrmSchedTracepointLayout> drm_sched_job_layout =
+      ReadDrmSchedTracepointLayout("drm_sched_job");
+  ErrorMessageOr<DrmSchedTracepointLayout> drm_run_job_layout =
+      ReadDrmSchedTracepointLayout("drm_run_job");
+  ErrorMessageOr<DrmSchedTracepointLayout> drm_sched_process_job_layout =
+      ReadDrmSchedTracepointLayout("drm_sched_process_job");
+  for (const ErrorMessageOr<DrmSchedTracepointLayout>* layout :
+       {&drm_sched_job_layout, &drm_run_job_layout, &drm_sched_process_job_layout}) {
+    if (layout->has_error()) {
+      LOG("Reading format of gpu_scheduler tracepoint: %s", layout->error().message());
+      return false;
+    }
+  }
+  drm_sched_job_layout_ = drm_sched_job_layout.value();
+  drm_run_job_layout_ = drm_run_job_layout.value();
+  drm_sched_process_job_layout_ = drm_sched_process_job_layout.value();
+  return true;
+}
+
+bool TracerThread::ReadI915RequestTracepointLayouts() {
+  ErrorMessageOr<I915RequestTracepointLayout> i915_request_add_layout =
+      ReadI915RequestTracepointLayout("i915_request_add");
+  if (i915_request_add_layout.has_error()) {
+    LOG("Reading format of i915 tracepoint: %s", i915_request_add_layout.error().message());
+    return false;
+  }
+  i915_request_add_layout_ = i915_request_add_layout.value();
+
+  // i915_request_in is only available in kernels built with CONFIG_DRM_I915_LOW_LEVEL_TRACEPOINTS.
+  ErrorMessageOr<I915RequestTracepointLayout> i915_request_in_layout =
+      ReadI915RequestTracepointLayout("i915_request_in");
+  if (i915_request_in_layout.has_value()) {
+    i915_request_in_layout_ = i915_request_in_layout.value();
+  } else {
+    i915_request_in_layout_.reset();
+  }
+  return true;
+}
+
 // This method enables events for GPU event tracing. We trace three events that correspond to the
 // following GPU driver events:
 // - A GPU job (command buffer submission) is scheduled by the application. This is tracked by the
@@ -490,17 +1061,69 @@ void TracerThread::InitGpuTracepointEventVisitor() {
 //   signaled and is tracked by the event "dma_fence_signaled".
 // A single job execution thus corresponds to three events, one of each type above, that share the
 // same timeline, context, and seqno.
-// We have to record events system-wide (per CPU) to ensure we record all relevant events.
+// If the amdgpu tracepoints are not available, we fall back to the tracepoints of the generic DRM
+// GPU scheduler ("drm_sched_job", "drm_run_job", "drm_sched_process_job"), used by most drivers,
+// and to the ones of i915 ("i915_request_add", optionally "i915_request_in", and again
+// "dma_fence_signaled"). amdgpu also uses the DRM GPU scheduler, so the two sets are never opened
+// together, as that would report every job twice.
+// We have to record events system-wide (per CPU) to ensure we record all relevant events. All GPU
+// tracepoints share the same ring buffers.
 // This method returns true on success, otherwise false.
 bool TracerThread::OpenGpuTracepoints(const std::vector<int32_t>& cpus) {
   ORBIT_SCOPE_FUNCTION;
   absl::flat_hash_map<int32_t, int> gpu_tracepoint_ring_buffer_fds_per_cpu;
-  return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
-      {{"amdgpu", "amdgpu_cs_ioctl", &amdgpu_cs_ioctl_ids_},
-       {"amdgpu", "amdgpu_sched_run_job", &amdgpu_sched_run_job_ids_},
-       {"dma_fence", "dma_fence_signaled", &dma_fence_signaled_ids_}},
-      cpus, &tracing_fds_, GPU_TRACING_RING_BUFFER_SIZE_KB, &gpu_tracepoint_ring_buffer_fds_per_cpu,
-      &ring_buffers_);
+  if (OpenFileDescriptorsAndRingBuffersForAllTracepoints(
+          {{"amdgpu", "amdgpu_cs_ioctl", &amdgpu_cs_ioctl_ids_},
+           {"amdgpu", "amdgpu_sched_run_job", &amdgpu_sched_run_job_ids_},
+           {"dma_fence", "dma_fence_signaled", &dma_fence_signaled_ids_}},
+          cpus, &tracing_fds_, ring_buffer_sizes_, RingBufferSize::kGpuTracing,
+          &gpu_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_)) {
+    RememberRingBufferCategoryAndCpu(gpu_tracepoint_ring_buffer_fds_per_cpu,
+                                     RingBufferSize::kGpuTracing);
+    return true;
+  }
+
+  bool opened_drm_sched_tracepoints =
+      ReadDrmSchedTracepointLayouts() &&
+      OpenFileDescriptorsAndRingBuffersForAllTracepoints(
+          {{"gpu_scheduler", "drm_sched_job", &drm_sched_job_ids_},
+           {"gpu_scheduler", "drm_run_job", &drm_run_job_ids_},
+           {"gpu_scheduler", "drm_sched_process_job", &drm_sched_process_job_ids_}},
+          cpus, &tracing_fds_, ring_buffer_sizes_, RingBufferSize::kGpuTracing,
+          &gpu_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+
+  bool opened_i915_tracepoints =
+      ReadI915RequestTracepointLayouts() &&
+      OpenFileDescriptorsAndRingBuffersForAllTracepoints(
+          {{"i915", "i915_request_add", &i915_request_add_ids_},
+           {"dma_fence", "dma_fence_signaled", &dma_fence_signaled_ids_}},
+          cpus, &tracing_fds_, ring_buffer_sizes_, RingBufferSize::kGpuTracing,
+          &gpu_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+  if (opened_i915_tracepoints && i915_request_in_layout_.has_value() &&
+      !OpenFileDescriptorsAndRingBuffersForAllTracepoints(
+          {{"i915", "i915_request_in", &i915_request_in_ids_}}, cpus, &tracing_fds_,
+          ring_buffer_sizes_, RingBufferSize::kGpuTracing,
+          &gpu_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_)) {
+    i915_request_in_layout_.reset();
+  }
+  RememberRingBufferCategoryAndCpu(gpu_tracepoint_ring_buffer_fds_per_cpu,
+                                   RingBufferSize::kGpuTracing);
+
+  return opened_drm_sched_tracepoints || opened_i915_tracepoints;
+}
+
+std::vector<TracepointField> TracerThread::GetInstrumentedTracepointFields(
+    const orbit_grpc_protos::TracepointInfo& tracepoint_info) {
+  ErrorMessageOr<std::vector<TracepointField>> fields_or_error =
+      ReadTracepointNumericFields(tracepoint_info.category(), tracepoint_info.name());
+  if (fields_or_error.has_error()) {
+    ERROR("Reading format of tracepoint %s:%s: %s", tracepoint_info.category(),
+          tracepoint_info.name(), fields_or_error.error().message());
+    return {};
+  }
+  return SelectTracepointFields(
+      fields_or_error.value(),
+      {tracepoint_info.field_names().begin(), tracepoint_info.field_names().end()});
 }
 
 bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus) {
@@ -512,23 +1135,46 @@ bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus)
     absl::flat_hash_set<uint64_t> stream_ids;
     tracepoint_event_open_errors |= !OpenFileDescriptorsAndRingBuffersForAllTracepoints(
         {{selected_tracepoint.category().c_str(), selected_tracepoint.name().c_str(), &stream_ids}},
-        cpus, &tracing_fds_, INSTRUMENTED_TRACEPOINTS_RING_BUFFER_SIZE_KB,
+        cpus, &tracing_fds_, ring_buffer_sizes_, RingBufferSize::kInstrumentedTracepoints,
         &tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
 
+    // The format of the tracepoint is only parsed once, not for every event.
+    std::vector<TracepointField> fields = GetInstrumentedTracepointFields(selected_tracepoint);
+    orbit_grpc_protos::TracepointInfo tracepoint_info = selected_tracepoint;
+    tracepoint_info.clear_field_names();
+    for (const TracepointField& field : fields) {
+      tracepoint_info.add_field_names(field.name);
+    }
+
     for (const auto& stream_id : stream_ids) {
-      ids_to_tracepoint_info_.emplace(stream_id, selected_tracepoint);
+      ids_to_tracepoint_info_.emplace(stream_id, tracepoint_info);
+      if (!fields.empty()) {
+        ids_to_tracepoint_fields_.emplace(stream_id, fields);
+      }
     }
   }
+  RememberRingBufferCategoryAndCpu(tracepoint_ring_buffer_fds_per_cpu,
+                                   RingBufferSize::kInstrumentedTracepoints);
 
   return !tracepoint_event_open_errors;
 }
 
 void TracerThread::InitLostAndDiscardedEventVisitor() {
   ORBIT_SCOPE_FUNCTION;
-  lost_and_discarded_event_visitor_ = std::make_unique<LostAndDiscardedEventVisitor>(listener_);
+  lost_and_discarded_event_visitor_ =
+      std::make_unique<LostAndDiscardedEventVisitor>(batching_listener_.get());
   event_processor_.AddVisitor(lost_and_discarded_event_visitor_.get());
 }
 
+void TracerThread::InitPipelineLatencyProbeVisitor() {
+  if (pipeline_latency_probe_period_ == 0) {
+    return;
+  }
+  pipeline_latency_probe_visitor_ =
+      std::make_unique<PipelineLatencyProbeVisitor>(batching_listener_.get());
+  event_processor_.AddVisitor(pipeline_latency_probe_visitor_.get());
+}
+
 static std::vector<ThreadName> RetrieveInitialThreadNamesSystemWide(uint64_t initial_timestamp_ns) {
   std::vector<ThreadName> thread_names;
   for (pid_t pid : GetAllPids()) {
@@ -554,6 +1200,10 @@ void TracerThread::Startup() {
   ORBIT_SCOPE_FUNCTION;
   Reset();
 
+  // The visitors produce their events through batching_listener_, which is flushed after each round
+  // of event processing.
+  batching_listener_ = std::make_unique<BatchingTracerListener>(listener_);
+
   // perf_event_open refers to cores as "CPUs".
 
   // Record context switches from all cores for all processes.
@@ -565,13 +1215,21 @@ void TracerThread::Startup() {
   }
 
   // Record calls to dynamically instrumented functions and sample only on cores
-  // in this process's cgroup's cpuset, as these are the only cores the process
-  // will be scheduled on.
-  std::vector<int32_t> cpuset_cpus = GetCpusetCpus(target_pid_);
-  if (cpuset_cpus.empty()) {
-    ERROR("Could not read cpuset");
-    cpuset_cpus = all_cpus;
+  // in the cgroups' cpusets of the target processes, as these are the only
+  // cores the processes will be scheduled on.
+  std::vector<int32_t> cpuset_cpus;
+  for (pid_t pid : target_pids_) {
+    std::vector<int32_t> cpuset_cpus_of_process = GetCpusetCpus(pid);
+    if (cpuset_cpus_of_process.empty()) {
+      ERROR("Could not read cpuset of process %d", pid);
+      cpuset_cpus = all_cpus;
+      break;
+    }
+    cpuset_cpus.insert(cpuset_cpus.end(), cpuset_cpus_of_process.begin(),
+                       cpuset_cpus_of_process.end());
   }
+  std::sort(cpuset_cpus.begin(), cpuset_cpus.end());
+  cpuset_cpus.erase(std::unique(cpuset_cpus.begin(), cpuset_cpus.end()), cpuset_cpus.end());
 
   // As we open two perf_event_open file descriptors (uprobe and uretprobe) per
   // cpu per instrumented function, increase the maximum number of open files.
@@ -580,6 +1238,7 @@ void TracerThread::Startup() {
   event_processor_.SetDiscardedOutOfOrderCounter(&stats_.discarded_out_of_order_count);
 
   InitLostAndDiscardedEventVisitor();
+  InitPipelineLatencyProbeVisitor();
 
   bool perf_event_open_errors = false;
   std::vector<std::string> perf_event_open_error_details;
@@ -602,13 +1261,44 @@ void TracerThread::Startup() {
   // one of those functions has already been called after the corresponding
   // uprobes file descriptor has been opened by OpenUserSpaceProbes (opening is
   // enough, it doesn't need to have been enabled).
-  InitUprobesEventVisitor();
+  std::string initial_maps = ReadMaps(target_pid_);
+  InitUprobesEventVisitor(initial_maps);
+  std::vector<PerfRecordCorpusHeader::AdditionalProcess> additional_processes;
+  for (pid_t pid : target_pids_) {
+    if (pid == target_pid_) {
+      continue;
+    }
+    PerfRecordCorpusHeader::AdditionalProcess& additional_process =
+        additional_processes.emplace_back();
+    additional_process.set_pid(pid);
+    additional_process.set_initial_maps(ReadMaps(pid));
+    AddMapsOfAdditionalProcess(pid, additional_process.initial_maps());
+  }
 
   if (unwinding_method_ == CaptureOptions::kFramePointers ||
       unwinding_method_ == CaptureOptions::kDwarf) {
     if (bool opened = OpenSampling(cpuset_cpus); !opened) {
       perf_event_open_error_details.emplace_back("sampling");
       perf_event_open_errors = true;
+    } else if (adaptive_sampling_period_) {
+      sampling_period_controller_ =
+          std::make_unique<AdaptiveSamplingPeriodController>(sampling_period_ns_, cpuset_cpus);
+    }
+
+    // Not all machines have the required hardware counters, e.g., virtual machines. As this is
+    // only additional information, failing to open them doesn't count as an error.
+    if (collect_pmu_counters_ && !OpenPmuCounters(cpuset_cpus)) {
+      LOG("There were errors opening PMU counters");
+    }
+
+    if (collect_off_cpu_callstacks_ && !OpenOffCpuCallstacks(cpuset_cpus)) {
+      perf_event_open_error_details.emplace_back("sched:sched_switch callstacks");
+      perf_event_open_errors = true;
+    }
+
+    if (collect_memory_callstacks_ && !OpenMemoryCallstacks(cpuset_cpus)) {
+      perf_event_open_error_details.emplace_back("page fault, mmap and brk callstacks");
+      perf_event_open_errors = true;
     }
   }
 
@@ -618,7 +1308,7 @@ void TracerThread::Startup() {
         "task:task_newtask and task:task_rename tracepoints");
     perf_event_open_errors = true;
   }
-  if (trace_context_switches_ || trace_thread_state_) {
+  if (trace_context_switches_ || trace_thread_state_ || collect_off_cpu_callstacks_) {
     if (bool opened = OpenContextSwitchAndThreadStateTracepoints(all_cpus); !opened) {
       perf_event_open_error_details.emplace_back(
           "sched:sched_switch and sched:sched_wakeup tracepoints");
@@ -652,24 +1342,41 @@ void TracerThread::Startup() {
     listener_->OnErrorsWithPerfEventOpenEvent(std::move(errors_with_perf_event_open_event));
   }
 
+  CreateRingBufferReaders();
+
   // Start recording events.
   for (int fd : tracing_fds_) {
+    if (fds_to_leave_disabled_.contains(fd)) {
+      continue;
+    }
     perf_event_enable(fd);
   }
 
   effective_capture_start_timestamp_ns_ = orbit_base::CaptureTimestampNs();
+  last_sampling_period_update_ns_ = effective_capture_start_timestamp_ns_;
+  last_stack_dump_size_update_ns_ = effective_capture_start_timestamp_ns_;
+  last_service_health_event_ns_ = effective_capture_start_timestamp_ns_;
+  last_function_latency_summary_ns_ = effective_capture_start_timestamp_ns_;
 
-  ModulesSnapshot modules_snapshot;
-  modules_snapshot.set_pid(target_pid_);
-  modules_snapshot.set_timestamp_ns(effective_capture_start_timestamp_ns_);
+  std::vector<ModuleInfo> modules;
   auto modules_or_error = orbit_object_utils::ReadModules(target_pid_);
   if (modules_or_error.has_value()) {
-    const std::vector<ModuleInfo>& modules = modules_or_error.value();
-    *modules_snapshot.mutable_modules() = {modules.begin(), modules.end()};
-    listener_->OnModulesSnapshot(std::move(modules_snapshot));
+    modules = std::move(modules_or_error.value());
+    SendModulesSnapshot(target_pid_, modules);
   } else {
     ERROR("Unable to load modules for %d: %s", target_pid_, modules_or_error.error().message());
   }
+  for (PerfRecordCorpusHeader::AdditionalProcess& additional_process : additional_processes) {
+    auto additional_modules_or_error = orbit_object_utils::ReadModules(additional_process.pid());
+    if (additional_modules_or_error.has_error()) {
+      ERROR("Unable to load modules for %d: %s", additional_process.pid(),
+            additional_modules_or_error.error().message());
+      continue;
+    }
+    SendModulesSnapshot(additional_process.pid(), additional_modules_or_error.value());
+    *additional_process.mutable_modules() = {additional_modules_or_error.value().begin(),
+                                             additional_modules_or_error.value().end()};
+  }
 
   // Get the initial thread names to notify the listener_.
   // All ThreadName events generated by this call will have effective_capture_start_timestamp_ns_ as
@@ -685,28 +1392,145 @@ void TracerThread::Startup() {
 
   listener_->OnThreadNamesSnapshot(std::move(thread_names_snapshot));
 
-  // Get the initial association of tids to pids and pass it to switches_states_names_visitor_.
-  RetrieveInitialTidToPidAssociationSystemWide();
+  // Get the initial association of tids to pids and pass it to switches_states_names_visitor_ and
+  // to the RingBufferReaders.
+  const std::vector<std::pair<pid_t, pid_t>> initial_tid_to_pid_association =
+      RetrieveInitialTidToPidAssociationSystemWide();
+  ProcessInitialTidToPidAssociation(initial_tid_to_pid_association);
+
+  if (thread_state_bpf_filter_ != nullptr) {
+    // The threads that the target creates from now on are added by the filter itself.
+    for (pid_t tid : GetTidsOfProcess(target_pid_)) {
+      if (auto result = thread_state_bpf_filter_->AddTid(tid); result.has_error()) {
+        ERROR("%s", result.error().message());
+      }
+    }
+  }
 
   if (trace_thread_state_) {
     // Get the initial thread states and pass them to switches_states_names_visitor_.
     RetrieveInitialThreadStatesOfTarget();
   }
 
+  if (!perf_record_corpus_file_path_.empty()) {
+    CreatePerfRecordCorpusWriter(std::move(initial_maps), modules, std::move(additional_processes),
+                                 initial_tid_to_pid_association);
+  }
+
   stats_.Reset();
 }
 
+void TracerThread::CreatePerfRecordCorpusWriter(
+    std::string initial_maps, const std::vector<ModuleInfo>& modules,
+    std::vector<PerfRecordCorpusHeader::AdditionalProcess> additional_processes,
+    const std::vector<std::pair<pid_t, pid_t>>& initial_tid_to_pid_association) {
+  ORBIT_SCOPE_FUNCTION;
+  PerfRecordCorpusHeader header;
+  *header.mutable_capture_options() = capture_options_;
+  header.set_effective_capture_start_timestamp_ns(effective_capture_start_timestamp_ns_);
+  header.set_initial_maps(std::move(initial_maps));
+  *header.mutable_modules() = {modules.begin(), modules.end()};
+  *header.mutable_additional_processes() = {std::make_move_iterator(additional_processes.begin()),
+                                            std::make_move_iterator(additional_processes.end())};
+  for (const PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    PerfRecordCorpusHeader::RingBuffer* header_ring_buffer = header.add_ring_buffers();
+    header_ring_buffer->set_name(ring_buffer.GetName());
+    header_ring_buffer->set_file_descriptor(ring_buffer.GetFileDescriptor());
+  }
+
+  absl::flat_hash_map<uint64_t, PerfRecordCorpusHeader::UserSpaceProbesIds*>
+      function_ids_to_user_space_probes_ids;
+  for (const auto& [stream_id, function] : uprobes_uretprobes_ids_to_function_) {
+    PerfRecordCorpusHeader::UserSpaceProbesIds*& user_space_probes_ids =
+        function_ids_to_user_space_probes_ids[function->function_id()];
+    if (user_space_probes_ids == nullptr) {
+      user_space_probes_ids = header.add_user_space_probes_ids();
+      user_space_probes_ids->set_function_id(function->function_id());
+    }
+    if (uprobes_ids_.contains(stream_id)) {
+      user_space_probes_ids->add_uprobes_ids(stream_id);
+    } else if (uretprobes_ids_.contains(stream_id)) {
+      user_space_probes_ids->add_uretprobes_ids(stream_id);
+    }
+  }
+
+  *header.mutable_stack_sampling_ids() = {stack_sampling_ids_.begin(), stack_sampling_ids_.end()};
+  *header.mutable_callchain_sampling_ids() = {callchain_sampling_ids_.begin(),
+                                              callchain_sampling_ids_.end()};
+  *header.mutable_pmu_counters_sample_ids() = {pmu_counters_sample_ids_.begin(),
+                                               pmu_counters_sample_ids_.end()};
+  *header.mutable_off_cpu_callstack_ids() = {off_cpu_callstack_ids_.begin(),
+                                             off_cpu_callstack_ids_.end()};
+  *header.mutable_page_fault_callstack_ids() = {page_fault_callstack_ids_.begin(),
+                                                page_fault_callstack_ids_.end()};
+  *header.mutable_mmap_callstack_ids() = {mmap_callstack_ids_.begin(), mmap_callstack_ids_.end()};
+  *header.mutable_brk_callstack_ids() = {brk_callstack_ids_.begin(), brk_callstack_ids_.end()};
+  *header.mutable_task_newtask_ids() = {task_newtask_ids_.begin(), task_newtask_ids_.end()};
+  *header.mutable_task_rename_ids() = {task_rename_ids_.begin(), task_rename_ids_.end()};
+  *header.mutable_sched_switch_ids() = {sched_switch_ids_.begin(), sched_switch_ids_.end()};
+  *header.mutable_sched_wakeup_ids() = {sched_wakeup_ids_.begin(), sched_wakeup_ids_.end()};
+  *header.mutable_amdgpu_cs_ioctl_ids() = {amdgpu_cs_ioctl_ids_.begin(),
+                                           amdgpu_cs_ioctl_ids_.end()};
+  *header.mutable_amdgpu_sched_run_job_ids() = {amdgpu_sched_run_job_ids_.begin(),
+                                                amdgpu_sched_run_job_ids_.end()};
+  *header.mutable_dma_fence_signaled_ids() = {dma_fence_signaled_ids_.begin(),
+                                              dma_fence_signaled_ids_.end()};
+  *header.mutable_drm_sched_job_ids() = {drm_sched_job_ids_.begin(), drm_sched_job_ids_.end()};
+  *header.mutable_drm_run_job_ids() = {drm_run_job_ids_.begin(), drm_run_job_ids_.end()};
+  *header.mutable_drm_sched_process_job_ids() = {drm_sched_process_job_ids_.begin(),
+                                                 drm_sched_process_job_ids_.end()};
+  *header.mutable_i915_request_add_ids() = {i915_request_add_ids_.begin(),
+                                            i915_request_add_ids_.end()};
+  *header.mutable_i915_request_in_ids() = {i915_request_in_ids_.begin(),
+                                           i915_request_in_ids_.end()};
+  for (const auto& [stream_id, tracepoint_info] : ids_to_tracepoint_info_) {
+    (*header.mutable_ids_to_tracepoint_info())[stream_id] = tracepoint_info;
+  }
+  for (const auto& [tid, pid] : initial_tid_to_pid_association) {
+    (*header.mutable_initial_tid_to_pid())[tid] = pid;
+  }
+
+  auto writer_or_error = PerfRecordCorpusWriter::Create(perf_record_corpus_file_path_, header);
+  if (writer_or_error.has_error()) {
+    ERROR("Creating perf record corpus: %s", writer_or_error.error().message());
+    return;
+  }
+  perf_record_corpus_writer_ = std::move(writer_or_error.value());
+  LOG("Recording perf_event_open records to \"%s\"", perf_record_corpus_file_path_);
+}
+
 void TracerThread::Shutdown() {
   ORBIT_SCOPE_FUNCTION;
   if (trace_thread_state_) {
     switches_states_names_visitor_->ProcessRemainingOpenStates(orbit_base::CaptureTimestampNs());
   }
+  batching_listener_->Flush();
+
+  if (perf_record_corpus_writer_ != nullptr) {
+    if (auto result = perf_record_corpus_writer_->Finish(); result.has_error()) {
+      ERROR("%s", result.error().message());
+    }
+    perf_record_corpus_writer_.reset();
+  }
 
   // Stop recording.
   for (int fd : tracing_fds_) {
     perf_event_disable(fd);
   }
 
+  if (function_latency_bpf_aggregator_ != nullptr) {
+    ProduceFunctionLatencySummary(orbit_base::CaptureTimestampNs());
+  }
+
+  for (const std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+    if (reader->epoll_fd != -1) {
+      close(reader->epoll_fd);
+      reader->epoll_fd = -1;
+    }
+  }
+
+  SaveRingBufferFillStatistics();
+
   // Close the ring buffers.
   {
     ORBIT_SCOPE("ring_buffers_.clear()");
@@ -726,12 +1550,151 @@ void TracerThread::Shutdown() {
   }
 }
 
-void TracerThread::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
+void TracerThread::CreateRingBufferReaders() {
+  // No ring buffer must be added to ring_buffers_ from now on, as the readers keep pointers to
+  // them.
+  size_t reader_count = std::max<size_t>(ring_buffer_reader_thread_count_, 1);
+  reader_count = std::max<size_t>(std::min(reader_count, ring_buffers_.size()), 1);
+
+  ring_buffer_readers_.clear();
+  for (size_t i = 0; i < reader_count; ++i) {
+    ring_buffer_readers_.emplace_back(std::make_unique<RingBufferReader>());
+    ring_buffer_readers_.back()->deferred_events_producer_token =
+        std::make_unique<moodycamel::ProducerToken>(deferred_events_);
+    ring_buffer_readers_.back()->pipeline_latency_probe_period = pipeline_latency_probe_period_;
+  }
+
+  // Ring buffers of the same kind are opened one cpu after the other, so assigning them round-robin
+  // spreads the ring buffers of each kind, and hence the load, evenly across the readers.
+  for (size_t i = 0; i < ring_buffers_.size(); ++i) {
+    ring_buffer_readers_[i % reader_count]->ring_buffers.push_back(&ring_buffers_[i]);
+  }
+  if (collect_service_health_) {
+    for (std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+      reader->record_counts = std::vector<std::atomic<uint64_t>>(reader->ring_buffers.size());
+    }
+  }
+
+  if (!pmu_counters_sample_ids_.empty()) {
+    for (std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+      reader->pmu_counters_visitor = std::make_unique<PmuCountersVisitor>(listener_, target_pids_);
+    }
+  }
+
+  if (reader_count > 1) {
+    LOG("Reading from %u ring buffers with %u threads", ring_buffers_.size(), reader_count);
+  }
+
+  if (!wait_for_ring_buffer_data_with_epoll_) {
+    return;
+  }
+  for (std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+    reader->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reader->epoll_fd == -1) {
+      ERROR("epoll_create1: %s", SafeStrerror(errno));
+      continue;
+    }
+    for (PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.fd = ring_buffer->GetFileDescriptor();
+      if (epoll_ctl(reader->epoll_fd, EPOLL_CTL_ADD, ring_buffer->GetFileDescriptor(), &event) !=
+          0) {
+        ERROR("epoll_ctl: %s", SafeStrerror(errno));
+      }
+    }
+  }
+}
+
+void TracerThread::WaitForRingBufferData(RingBufferReader* reader) {
+  if (reader->epoll_fd == -1) {
+    ORBIT_SCOPE("Sleep");
+    usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
+    return;
+  }
+
+  // We don't need to know which ring buffers are ready, as ReadFromRingBuffersOnce goes through all
+  // of them anyway. On timeout or EINTR, we simply go back to checking the ring buffers.
+  ORBIT_SCOPE("epoll_wait");
+  epoll_event event;
+  if (epoll_wait(reader->epoll_fd, &event, 1, MAX_EPOLL_WAIT_TIME_ON_EMPTY_RING_BUFFERS_MS) == -1 &&
+      errno != EINTR) {
+    ERROR("epoll_wait: %s", SafeStrerror(errno));
+    usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
+  }
+}
+
+bool TracerThread::ReadFromRingBuffersOnce(RingBufferReader* reader,
+                                           const std::atomic<bool>& exit_requested) {
+  bool saw_events = false;
+  // Read and process events from all ring buffers of this reader. In order to ensure that no
+  // buffer is read constantly while others overflow, we schedule the reading using round-robin
+  // like scheduling.
+  for (size_t ring_buffer_index = 0; ring_buffer_index < reader->ring_buffers.size();
+       ++ring_buffer_index) {
+    if (exit_requested) {
+      break;
+    }
+    PerfEventRingBuffer* ring_buffer = reader->ring_buffers[ring_buffer_index];
+
+    // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
+    // TODO: Some event types (e.g., stack samples) have a much longer
+    //  processing time but are less frequent than others (e.g., context
+    //  switches). Take this into account in our scheduling algorithm.
+    int32_t read_from_this_buffer = 0;
+    for (; read_from_this_buffer < ROUND_ROBIN_POLLING_BATCH_SIZE; ++read_from_this_buffer) {
+      if (exit_requested) {
+        break;
+      }
+      if (!ring_buffer->HasNewData()) {
+        break;
+      }
+
+      saw_events = true;
+      ProcessOneRecord(ring_buffer, reader);
+    }
+
+    if (read_from_this_buffer > 0 && !reader->record_counts.empty()) {
+      reader->record_counts[ring_buffer_index].fetch_add(read_from_this_buffer,
+                                                         std::memory_order_relaxed);
+    }
+  }
+
+  if (reader->scheduling_slice_producer.HasSchedulingSlices()) {
+    listener_->OnSchedulingSlices(reader->scheduling_slice_producer.TakeSchedulingSlices());
+  }
+  return saw_events;
+}
+
+void TracerThread::RunAdditionalRingBufferReader(RingBufferReader* reader, size_t reader_index,
+                                                 const std::atomic<bool>& exit_requested) {
+  orbit_base::SetCurrentThreadName(absl::StrFormat("Tracer.Read%u", reader_index).c_str());
+  while (!exit_requested) {
+    ORBIT_SCOPE("RunAdditionalRingBufferReader iteration");
+    if (!ReadFromRingBuffersOnce(reader, exit_requested)) {
+      WaitForRingBufferData(reader);
+    }
+  }
+}
+
+void TracerThread::ProcessOneRecord(PerfEventRingBuffer* ring_buffer, RingBufferReader* reader) {
   uint64_t event_timestamp_ns = 0;
 
   perf_event_header header;
   ring_buffer->ReadHeader(&header);
 
+  if (perf_record_corpus_writer_ != nullptr) {
+    // The index of ring_buffer in ring_buffers_ is also its index in the header of the corpus.
+    const auto ring_buffer_index = static_cast<uint32_t>(ring_buffer - ring_buffers_.data());
+    if (const char* record = ring_buffer->GetRecordAtTailIfContiguous(header); record != nullptr) {
+      perf_record_corpus_writer_->AppendRecord(ring_buffer_index, record);
+    } else {
+      std::vector<char> record_copy(header.size);
+      ring_buffer->ReadRawAtOffset(record_copy.data(), 0, header.size);
+      perf_record_corpus_writer_->AppendRecord(ring_buffer_index, record_copy.data());
+    }
+  }
+
   // perf_event_header::type contains the type of record, e.g.,
   // PERF_RECORD_SAMPLE, PERF_RECORD_MMAP, etc., defined in enum
   // perf_event_type in linux/perf_event.h.
@@ -743,19 +1706,19 @@ void TracerThread::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
       ERROR("Unexpected PERF_RECORD_SWITCH_CPU_WIDE in ring buffer '%s'", ring_buffer->GetName());
       break;
     case PERF_RECORD_FORK:
-      event_timestamp_ns = ProcessForkEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessForkEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_EXIT:
-      event_timestamp_ns = ProcessExitEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessExitEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_MMAP:
-      event_timestamp_ns = ProcessMmapEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessMmapEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_SAMPLE:
-      event_timestamp_ns = ProcessSampleEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessSampleEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_LOST:
-      event_timestamp_ns = ProcessLostEventAndReturnTimestamp(header, ring_buffer);
+      event_timestamp_ns = ProcessLostEventAndReturnTimestamp(header, ring_buffer, reader);
       break;
     case PERF_RECORD_THROTTLE:
     case PERF_RECORD_UNTHROTTLE:
@@ -769,8 +1732,8 @@ void TracerThread::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
   }
 
   if (event_timestamp_ns != 0) {
-    fds_to_last_timestamp_ns_.insert_or_assign(ring_buffer->GetFileDescriptor(),
-                                               event_timestamp_ns);
+    reader->fds_to_last_timestamp_ns.insert_or_assign(ring_buffer->GetFileDescriptor(),
+                                                      event_timestamp_ns);
   }
 }
 
@@ -782,60 +1745,231 @@ void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested)
   bool last_iteration_saw_events = false;
   std::thread deferred_events_thread(&TracerThread::ProcessDeferredEvents, this);
 
+  // The thread executing Run reads from the ring buffers of the first reader, while each of the
+  // other readers, if any, gets its own thread.
+  CHECK(!ring_buffer_readers_.empty());
+  std::vector<std::thread> additional_reader_threads;
+  for (size_t reader_index = 1; reader_index < ring_buffer_readers_.size(); ++reader_index) {
+    additional_reader_threads.emplace_back(&TracerThread::RunAdditionalRingBufferReader, this,
+                                           ring_buffer_readers_[reader_index].get(), reader_index,
+                                           std::cref(*exit_requested));
+  }
+
   while (!(*exit_requested)) {
     ORBIT_SCOPE("TracerThread::Run iteration");
 
+    // This is not only done when the ring buffers are empty, as this is exactly what doesn't
+    // happen when sampling puts too much pressure on them.
+    UpdateSamplingPeriodsIfTimerElapsed();
+    UpdateStackDumpSizeIfTimerElapsed();
+
     if (!last_iteration_saw_events) {
       // Periodically print event statistics.
       PrintStatsIfTimerElapsed();
 
-      // Sleep if there was no new event in the last iteration so that we are
+      // Sleep or wait for new data if there was no new event in the last iteration so that we are
       // not constantly polling. Don't sleep so long that ring buffers overflow.
-      {
-        ORBIT_SCOPE("Sleep");
-        usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
-      }
+      WaitForRingBufferData(ring_buffer_readers_[0].get());
     }
 
-    last_iteration_saw_events = false;
-
-    // Read and process events from all ring buffers. In order to ensure that no
-    // buffer is read constantly while others overflow, we schedule the reading
-    // using round-robin like scheduling.
-    for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
-      if (*exit_requested) {
-        break;
-      }
-
-      // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
-      // TODO: Some event types (e.g., stack samples) have a much longer
-      //  processing time but are less frequent than others (e.g., context
-      //  switches). Take this into account in our scheduling algorithm.
-      for (int32_t read_from_this_buffer = 0;
-           read_from_this_buffer < ROUND_ROBIN_POLLING_BATCH_SIZE; ++read_from_this_buffer) {
-        if (*exit_requested) {
-          break;
-        }
-        if (!ring_buffer.HasNewData()) {
-          break;
-        }
+    last_iteration_saw_events =
+        ReadFromRingBuffersOnce(ring_buffer_readers_[0].get(), *exit_requested);
+  }
 
-        last_iteration_saw_events = true;
-        ProcessOneRecord(&ring_buffer);
-      }
-    }
+  for (std::thread& reader_thread : additional_reader_threads) {
+    reader_thread.join();
   }
 
   // Finish processing all deferred events.
   stop_deferred_thread_ = true;
+  deferred_events_wake_up_.WakeUp();
   deferred_events_thread.join();
   event_processor_.ProcessAllEvents();
+  if (uprobes_unwinding_visitor_ != nullptr) {
+    uprobes_unwinding_visitor_->WaitForAndForwardAllStackSamples();
+  }
+  batching_listener_->Flush();
 
   Shutdown();
 }
 
+void TracerThread::ReplayStartup(const PerfRecordCorpus& corpus) {
+  ORBIT_SCOPE_FUNCTION;
+  Reset();
+  const PerfRecordCorpusHeader& header = corpus.header;
+
+  batching_listener_ = std::make_unique<BatchingTracerListener>(listener_);
+  event_processor_.SetDiscardedOutOfOrderCounter(&stats_.discarded_out_of_order_count);
+  InitLostAndDiscardedEventVisitor();
+  InitPipelineLatencyProbeVisitor();
+
+  absl::flat_hash_map<uint64_t, const Function*> function_ids_to_function;
+  for (const Function& function : instrumented_functions_) {
+    function_ids_to_function.emplace(function.function_id(), &function);
+  }
+  for (const PerfRecordCorpusHeader::UserSpaceProbesIds& user_space_probes_ids :
+       header.user_space_probes_ids()) {
+    auto function_it = function_ids_to_function.find(user_space_probes_ids.function_id());
+    if (function_it == function_ids_to_function.end()) {
+      ERROR("Perf record corpus refers to unknown function id %u",
+            user_space_probes_ids.function_id());
+      continue;
+    }
+    for (uint64_t stream_id : user_space_probes_ids.uprobes_ids()) {
+      uprobes_uretprobes_ids_to_function_.emplace(stream_id, function_it->second);
+      uprobes_ids_.insert(stream_id);
+    }
+    for (uint64_t stream_id : user_space_probes_ids.uretprobes_ids()) {
+      uprobes_uretprobes_ids_to_function_.emplace(stream_id, function_it->second);
+      uretprobes_ids_.insert(stream_id);
+    }
+  }
+  InitUprobesEventVisitor(header.initial_maps());
+  for (const PerfRecordCorpusHeader::AdditionalProcess& additional_process :
+       header.additional_processes()) {
+    AddMapsOfAdditionalProcess(additional_process.pid(), additional_process.initial_maps());
+  }
+
+  stack_sampling_ids_.insert(header.stack_sampling_ids().begin(),
+                             header.stack_sampling_ids().end());
+  callchain_sampling_ids_.insert(header.callchain_sampling_ids().begin(),
+                                 header.callchain_sampling_ids().end());
+  pmu_counters_sample_ids_.insert(header.pmu_counters_sample_ids().begin(),
+                                  header.pmu_counters_sample_ids().end());
+  off_cpu_callstack_ids_.insert(header.off_cpu_callstack_ids().begin(),
+                                header.off_cpu_callstack_ids().end());
+  page_fault_callstack_ids_.insert(header.page_fault_callstack_ids().begin(),
+                                   header.page_fault_callstack_ids().end());
+  mmap_callstack_ids_.insert(header.mmap_callstack_ids().begin(),
+                             header.mmap_callstack_ids().end());
+  brk_callstack_ids_.insert(header.brk_callstack_ids().begin(), header.brk_callstack_ids().end());
+  task_newtask_ids_.insert(header.task_newtask_ids().begin(), header.task_newtask_ids().end());
+  task_rename_ids_.insert(header.task_rename_ids().begin(), header.task_rename_ids().end());
+  sched_switch_ids_.insert(header.sched_switch_ids().begin(), header.sched_switch_ids().end());
+  sched_wakeup_ids_.insert(header.sched_wakeup_ids().begin(), header.sched_wakeup_ids().end());
+  InitSwitchesStatesNamesVisitor();
+
+  amdgpu_cs_ioctl_ids_.insert(header.amdgpu_cs_ioctl_ids().begin(),
+                              header.amdgpu_cs_ioctl_ids().end());
+  amdgpu_sched_run_job_ids_.insert(header.amdgpu_sched_run_job_ids().begin(),
+                                   header.amdgpu_sched_run_job_ids().end());
+  dma_fence_signaled_ids_.insert(header.dma_fence_signaled_ids().begin(),
+                                 header.dma_fence_signaled_ids().end());
+  // As for the instrumented tracepoints, the layouts of the gpu_scheduler and i915 tracepoints are
+  // read from the tracefs of this machine. The events are dropped if the layouts can't be read.
+  if (header.drm_sched_job_ids_size() > 0 && ReadDrmSchedTracepointLayouts()) {
+    drm_sched_job_ids_.insert(header.drm_sched_job_ids().begin(), header.drm_sched_job_ids().end());
+    drm_run_job_ids_.insert(header.drm_run_job_ids().begin(), header.drm_run_job_ids().end());
+    drm_sched_process_job_ids_.insert(header.drm_sched_process_job_ids().begin(),
+                                      header.drm_sched_process_job_ids().end());
+  }
+  if (header.i915_request_add_ids_size() > 0 && ReadI915RequestTracepointLayouts()) {
+    i915_request_add_ids_.insert(header.i915_request_add_ids().begin(),
+                                 header.i915_request_add_ids().end());
+    if (i915_request_in_layout_.has_value()) {
+      i915_request_in_ids_.insert(header.i915_request_in_ids().begin(),
+                                  header.i915_request_in_ids().end());
+    }
+  }
+  if (trace_gpu_driver_ && (!amdgpu_cs_ioctl_ids_.empty() || !drm_sched_job_ids_.empty() ||
+                            !i915_request_add_ids_.empty())) {
+    InitGpuTracepointEventVisitor();
+  }
+  for (const auto& [stream_id, tracepoint_info] : header.ids_to_tracepoint_info()) {
+    ids_to_tracepoint_info_.emplace(stream_id, tracepoint_info);
+    // The offsets of the fields aren't part of the corpus, so they are read from the tracefs of
+    // this machine. The field names recorded in the corpus make sure the same fields are decoded.
+    if (tracepoint_info.field_names_size() == 0) continue;
+    std::vector<TracepointField> fields = GetInstrumentedTracepointFields(tracepoint_info);
+    if (fields.size() != static_cast<size_t>(tracepoint_info.field_names_size())) {
+      ERROR("Fields of tracepoint %s:%s differ from the ones in the corpus",
+            tracepoint_info.category(), tracepoint_info.name());
+      continue;
+    }
+    ids_to_tracepoint_fields_.emplace(stream_id, std::move(fields));
+  }
+
+  CHECK(static_cast<size_t>(header.ring_buffers_size()) == corpus.records_by_ring_buffer.size());
+  ring_buffers_.reserve(header.ring_buffers_size());
+  for (int i = 0; i < header.ring_buffers_size(); ++i) {
+    ring_buffers_.emplace_back(PerfEventRingBuffer::CreateFromRecords(
+        corpus.records_by_ring_buffer[i], header.ring_buffers(i).file_descriptor(),
+        header.ring_buffers(i).name()));
+  }
+  // A single reader, without epoll as there is no file descriptor to wait on, so that replaying is
+  // deterministic.
+  ring_buffer_reader_thread_count_ = 1;
+  wait_for_ring_buffer_data_with_epoll_ = false;
+  CreateRingBufferReaders();
+
+  effective_capture_start_timestamp_ns_ = header.effective_capture_start_timestamp_ns();
+  SendModulesSnapshot(target_pid_, {header.modules().begin(), header.modules().end()});
+  for (const PerfRecordCorpusHeader::AdditionalProcess& additional_process :
+       header.additional_processes()) {
+    SendModulesSnapshot(additional_process.pid(),
+                        {additional_process.modules().begin(), additional_process.modules().end()});
+  }
+
+  // The initial thread names and thread states are not part of the corpus, as they are not needed
+  // to process the records.
+  std::vector<std::pair<pid_t, pid_t>> initial_tid_to_pid_association;
+  for (const auto& [tid, pid] : header.initial_tid_to_pid()) {
+    initial_tid_to_pid_association.emplace_back(tid, pid);
+  }
+  ProcessInitialTidToPidAssociation(initial_tid_to_pid_association);
+
+  stats_.Reset();
+}
+
+uint64_t TracerThread::ComputeReplayedEventsFrontierNs(RingBufferReader* reader) {
+  // Records are in order of timestamp in each ring buffer, so no event older than the last one read
+  // from each ring buffer that still has records can come anymore.
+  uint64_t frontier_ns = std::numeric_limits<uint64_t>::max();
+  for (PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
+    if (!ring_buffer->HasNewData()) {
+      continue;
+    }
+    auto it = reader->fds_to_last_timestamp_ns.find(ring_buffer->GetFileDescriptor());
+    if (it == reader->fds_to_last_timestamp_ns.end()) {
+      return 0;
+    }
+    frontier_ns = std::min(frontier_ns, it->second);
+  }
+  return frontier_ns;
+}
+
+void TracerThread::Replay(const PerfRecordCorpus& corpus) {
+  FAIL_IF(listener_ == nullptr, "No listener set");
+
+  ReplayStartup(corpus);
+
+  CHECK(ring_buffer_readers_.size() == 1);
+  RingBufferReader* reader = ring_buffer_readers_[0].get();
+  const std::atomic<bool> exit_requested = false;
+  while (ReadFromRingBuffersOnce(reader, exit_requested)) {
+    ORBIT_SCOPE("TracerThread::Replay iteration");
+    for (std::unique_ptr<PerfEvent>& event : ConsumeDeferredEvents()) {
+      event_processor_.AddEvent(std::move(event));
+    }
+    event_processor_.ProcessEventsOlderThan(ComputeReplayedEventsFrontierNs(reader));
+    if (uprobes_unwinding_visitor_ != nullptr) {
+      uprobes_unwinding_visitor_->ForwardCompletedStackSamples();
+    }
+    batching_listener_->Flush();
+  }
+
+  event_processor_.ProcessAllEvents();
+  if (uprobes_unwinding_visitor_ != nullptr) {
+    uprobes_unwinding_visitor_->WaitForAndForwardAllStackSamples();
+  }
+  batching_listener_->Flush();
+  ring_buffer_readers_.clear();
+  ring_buffers_.clear();
+}
+
 uint64_t TracerThread::ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
-                                                          PerfEventRingBuffer* ring_buffer) {
+                                                          PerfEventRingBuffer* ring_buffer,
+                                                          RingBufferReader* reader) {
   auto event = make_unique_for_overwrite<ForkPerfEvent>();
   ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
   const uint64_t timestamp_ns = event->GetTimestamp();
@@ -847,13 +1981,14 @@ uint64_t TracerThread::ProcessForkEventAndReturnTimestamp(const perf_event_heade
   // PERF_RECORD_FORK is used by SwitchesStatesNamesVisitor
   // to keep the association between tid and pid.
   event->SetOrderedInFileDescriptor(ring_buffer->GetFileDescriptor());
-  DeferEvent(std::move(event));
+  DeferEvent(std::move(event), reader);
 
   return timestamp_ns;
 }
 
 uint64_t TracerThread::ProcessExitEventAndReturnTimestamp(const perf_event_header& header,
-                                                          PerfEventRingBuffer* ring_buffer) {
+                                                          PerfEventRingBuffer* ring_buffer,
+                                                          RingBufferReader* reader) {
   auto event = make_unique_for_overwrite<ExitPerfEvent>();
   ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
   const uint64_t timestamp_ns = event->GetTimestamp();
@@ -865,17 +2000,18 @@ uint64_t TracerThread::ProcessExitEventAndReturnTimestamp(const perf_event_heade
   // PERF_RECORD_EXIT is also used by SwitchesStatesNamesVisitor
   // to keep the association between tid and pid.
   event->SetOrderedInFileDescriptor(ring_buffer->GetFileDescriptor());
-  DeferEvent(std::move(event));
+  DeferEvent(std::move(event), reader);
 
   return timestamp_ns;
 }
 
 uint64_t TracerThread::ProcessMmapEventAndReturnTimestamp(const perf_event_header& header,
-                                                          PerfEventRingBuffer* ring_buffer) {
+                                                          PerfEventRingBuffer* ring_buffer,
+                                                          RingBufferReader* reader) {
   auto event = ConsumeMmapPerfEvent(ring_buffer, header);
   uint64_t timestamp_ns = event->GetTimestamp();
 
-  if (event->pid() != target_pid_) {
+  if (!target_pids_.contains(event->pid())) {
     return timestamp_ns;
   }
 
@@ -884,13 +2020,14 @@ uint64_t TracerThread::ProcessMmapEventAndReturnTimestamp(const perf_event_heade
   }
 
   event->SetOrderedInFileDescriptor(ring_buffer->GetFileDescriptor());
-  DeferEvent(std::move(event));
+  DeferEvent(std::move(event), reader);
 
   return timestamp_ns;
 }
 
 uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer) {
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader) {
   uint64_t timestamp_ns = ReadSampleRecordTime(ring_buffer);
 
   if (timestamp_ns < effective_capture_start_timestamp_ns_) {
@@ -904,6 +2041,11 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
   bool is_uretprobe = uretprobes_ids_.contains(stream_id);
   bool is_stack_sample = stack_sampling_ids_.contains(stream_id);
   bool is_callchain_sample = callchain_sampling_ids_.contains(stream_id);
+  bool is_pmu_counters_sample = pmu_counters_sample_ids_.contains(stream_id);
+  bool is_off_cpu_callstack = off_cpu_callstack_ids_.contains(stream_id);
+  bool is_page_fault_callstack = page_fault_callstack_ids_.contains(stream_id);
+  bool is_mmap_callstack = mmap_callstack_ids_.contains(stream_id);
+  bool is_brk_callstack = brk_callstack_ids_.contains(stream_id);
   bool is_task_newtask = task_newtask_ids_.contains(stream_id);
   bool is_task_rename = task_rename_ids_.contains(stream_id);
   bool is_sched_switch = sched_switch_ids_.contains(stream_id);
@@ -911,11 +2053,20 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
   bool is_amdgpu_cs_ioctl_event = amdgpu_cs_ioctl_ids_.contains(stream_id);
   bool is_amdgpu_sched_run_job_event = amdgpu_sched_run_job_ids_.contains(stream_id);
   bool is_dma_fence_signaled_event = dma_fence_signaled_ids_.contains(stream_id);
+  bool is_drm_sched_job_event = drm_sched_job_ids_.contains(stream_id);
+  bool is_drm_run_job_event = drm_run_job_ids_.contains(stream_id);
+  bool is_drm_sched_process_job_event = drm_sched_process_job_ids_.contains(stream_id);
+  bool is_i915_request_add_event = i915_request_add_ids_.contains(stream_id);
+  bool is_i915_request_in_event = i915_request_in_ids_.contains(stream_id);
   bool is_user_instrumented_tracepoint = ids_to_tracepoint_info_.contains(stream_id);
 
-  CHECK(is_uprobe + is_uretprobe + is_stack_sample + is_callchain_sample + is_task_newtask +
-            is_task_rename + is_sched_switch + is_sched_wakeup + is_amdgpu_cs_ioctl_event +
+  CHECK(is_uprobe + is_uretprobe + is_stack_sample + is_callchain_sample +
+            is_pmu_counters_sample + is_off_cpu_callstack + is_page_fault_callstack +
+            is_mmap_callstack + is_brk_callstack + is_task_newtask + is_task_rename +
+            is_sched_switch + is_sched_wakeup + is_amdgpu_cs_ioctl_event +
             is_amdgpu_sched_run_job_event + is_dma_fence_signaled_event +
+            is_drm_sched_job_event + is_drm_run_job_event + is_drm_sched_process_job_event +
+            is_i915_request_add_event + is_i915_request_in_event +
             is_user_instrumented_tracepoint <=
         1);
 
@@ -927,13 +2078,13 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
     using perf_event_uprobe = perf_event_sp_ip_arguments_8bytes_sample;
     constexpr size_t kSizeOfUprobes = sizeof(perf_event_uprobe);
     CHECK(header.size == kSizeOfUprobes);
-    if (event->GetPid() != target_pid_) {
+    if (!target_pids_.contains(event->GetPid())) {
       return timestamp_ns;
     }
 
     event->SetFunction(uprobes_uretprobes_ids_to_function_.at(event->GetStreamId()));
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
     ++stats_.uprobes_count;
 
   } else if (is_uretprobe) {
@@ -941,13 +2092,13 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
     constexpr size_t kSizeOfUretprobes = sizeof(perf_event_ax_sample);
     CHECK(header.size == kSizeOfUretprobes);
-    if (event->GetPid() != target_pid_) {
+    if (!target_pids_.contains(event->GetPid())) {
       return timestamp_ns;
     }
 
     event->SetFunction(uprobes_uretprobes_ids_to_function_.at(event->GetStreamId()));
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
     ++stats_.uprobes_count;
 
   } else if (is_stack_sample) {
@@ -967,7 +2118,7 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
       ring_buffer->SkipRecord(header);
       return timestamp_ns;
     }
-    if (pid != target_pid_) {
+    if (!target_pids_.contains(pid)) {
       ring_buffer->SkipRecord(header);
       return timestamp_ns;
     }
@@ -977,46 +2128,99 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
 
     auto event = ConsumeStackSamplePerfEvent(ring_buffer, header);
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
     ++stats_.sample_count;
 
   } else if (is_callchain_sample) {
     pid_t pid = ReadSampleRecordPid(ring_buffer);
-    if (pid != target_pid_) {
+    if (!target_pids_.contains(pid)) {
+      ring_buffer->SkipRecord(header);
+      return timestamp_ns;
+    }
+
+    auto event = ConsumeCallchainSamplePerfEvent(ring_buffer, header);
+    event->SetOrderedInFileDescriptor(fd);
+    DeferEvent(std::move(event), reader);
+    ++stats_.sample_count;
+
+  } else if (is_off_cpu_callstack) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!target_pids_.contains(pid)) {
+      ring_buffer->SkipRecord(header);
+      return timestamp_ns;
+    }
+
+    auto event = ConsumeCallchainSamplePerfEvent(ring_buffer, header);
+    event->SetIsOffCpu(true);
+    event->SetOrderedInFileDescriptor(fd);
+    DeferEvent(std::move(event), reader);
+    ++stats_.sample_count;
+
+  } else if (is_page_fault_callstack || is_mmap_callstack || is_brk_callstack) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!target_pids_.contains(pid)) {
       ring_buffer->SkipRecord(header);
       return timestamp_ns;
     }
 
     auto event = ConsumeCallchainSamplePerfEvent(ring_buffer, header);
+    if (is_page_fault_callstack) {
+      event->SetMemoryEvent(CallstackSample::kPageFault, MEMORY_CALLSTACKS_PAGE_FAULTS_PERIOD);
+    } else if (is_mmap_callstack) {
+      event->SetMemoryEvent(CallstackSample::kMmap, 1);
+    } else {
+      event->SetMemoryEvent(CallstackSample::kBrk, 1);
+    }
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
     ++stats_.sample_count;
 
+  } else if (is_pmu_counters_sample) {
+    if (header.size != sizeof(perf_event_pmu_counters_sample)) {
+      ring_buffer->SkipRecord(header);
+      return timestamp_ns;
+    }
+    // Samples of all processes are needed to know which thread the counters of each cpu refer to,
+    // so these are processed by the reader of the cpu instead of being ordered with other events.
+    PmuCountersSamplePerfEvent event;
+    ring_buffer->ConsumeRecord(header, &event.ring_buffer_record);
+    CHECK(reader->pmu_counters_visitor != nullptr);
+    event.Accept(reader->pmu_counters_visitor.get());
+
   } else if (is_task_newtask) {
     auto event = make_unique_for_overwrite<TaskNewtaskPerfEvent>();
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
     // task:task_newtask is used by SwitchesStatesNamesVisitor
     // for thread names and thread states.
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
   } else if (is_task_rename) {
     auto event = make_unique_for_overwrite<TaskRenamePerfEvent>();
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
     // task:task_newtask is used by SwitchesStatesNamesVisitor for thread names.
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
 
   } else if (is_sched_switch) {
     auto event = make_unique_for_overwrite<SchedSwitchPerfEvent>();
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
-    event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    if (trace_context_switches_) {
+      reader->scheduling_slice_producer.ProcessSchedSwitch(
+          event->GetCpu(), event->GetPrevPidOrMinusOne(), event->GetPrevTid(),
+          event->GetNextTid(), event->GetTimestamp());
+    }
+    // Only thread states and off-CPU callstacks need the context switches in order with the events
+    // of all other cpus.
+    if (trace_thread_state_ || collect_off_cpu_callstacks_) {
+      event->SetOrderedInFileDescriptor(fd);
+      DeferEvent(std::move(event), reader);
+    }
     ++stats_.sched_switch_count;
   } else if (is_sched_wakeup) {
     auto event = make_unique_for_overwrite<SchedWakeupPerfEvent>();
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
     event->SetOrderedInFileDescriptor(fd);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
 
   } else if (is_amdgpu_cs_ioctl_event) {
     auto event =
@@ -1024,13 +2228,13 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
     // Do not filter GPU tracepoint events based on pid as we want to have
     // visibility into all GPU activity across the system.
     event->SetOrderedInFileDescriptor(PerfEvent::kNotOrderedInAnyFileDescriptor);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
     ++stats_.gpu_events_count;
   } else if (is_amdgpu_sched_run_job_event) {
     auto event =
         ConsumeVariableSizeTracepointPerfEvent<AmdgpuSchedRunJobPerfEvent>(ring_buffer, header);
     event->SetOrderedInFileDescriptor(PerfEvent::kNotOrderedInAnyFileDescriptor);
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
     ++stats_.gpu_events_count;
   } else if (is_dma_fence_signaled_event) {
     auto event =
@@ -1038,7 +2242,42 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
     event->SetOrderedInFileDescriptor(PerfEvent::kNotOrderedInAnyFileDescriptor);
     // dma_fence_signaled events can be out of order of timestamp even on the same ring buffer,
     // hence why kNotOrderedInAnyFileDescriptor. To be safe, do the same for the other GPU events.
-    DeferEvent(std::move(event));
+    DeferEvent(std::move(event), reader);
+    ++stats_.gpu_events_count;
+  } else if (is_drm_sched_job_event || is_drm_run_job_event || is_drm_sched_process_job_event) {
+    std::unique_ptr<DrmSchedPerfEvent> event;
+    if (is_drm_sched_job_event) {
+      event = ConsumeDrmSchedPerfEvent<DrmSchedJobPerfEvent>(ring_buffer, header,
+                                                            drm_sched_job_layout_);
+    } else if (is_drm_run_job_event) {
+      event =
+          ConsumeDrmSchedPerfEvent<DrmRunJobPerfEvent>(ring_buffer, header, drm_run_job_layout_);
+    } else {
+      event = ConsumeDrmSchedPerfEvent<DrmSchedProcessJobPerfEvent>(
+          ring_buffer, header, drm_sched_process_job_layout_);
+    }
+    if (event == nullptr) {
+      ERROR("Decoding gpu_scheduler tracepoint");
+      return timestamp_ns;
+    }
+    event->SetOrderedInFileDescriptor(PerfEvent::kNotOrderedInAnyFileDescriptor);
+    DeferEvent(std::move(event), reader);
+    ++stats_.gpu_events_count;
+  } else if (is_i915_request_add_event || is_i915_request_in_event) {
+    std::unique_ptr<I915RequestPerfEvent> event;
+    if (is_i915_request_add_event) {
+      event = ConsumeI915RequestPerfEvent<I915RequestAddPerfEvent>(ring_buffer, header,
+                                                                  i915_request_add_layout_);
+    } else {
+      event = ConsumeI915RequestPerfEvent<I915RequestInPerfEvent>(
+          ring_buffer, header, i915_request_in_layout_.value());
+    }
+    if (event == nullptr) {
+      ERROR("Decoding i915 tracepoint");
+      return timestamp_ns;
+    }
+    event->SetOrderedInFileDescriptor(PerfEvent::kNotOrderedInAnyFileDescriptor);
+    DeferEvent(std::move(event), reader);
     ++stats_.gpu_events_count;
 
   } else if (is_user_instrumented_tracepoint) {
@@ -1048,7 +2287,9 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
       return timestamp_ns;
     }
 
-    auto event = ConsumeGenericTracepointPerfEvent(ring_buffer, header);
+    auto fields_it = ids_to_tracepoint_fields_.find(stream_id);
+    const bool has_fields = fields_it != ids_to_tracepoint_fields_.end();
+    auto event = ConsumeGenericTracepointPerfEvent(ring_buffer, header, has_fields);
 
     orbit_grpc_protos::FullTracepointEvent tracepoint_event;
     tracepoint_event.set_pid(event->GetPid());
@@ -1056,9 +2297,19 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
     tracepoint_event.set_timestamp_ns(event->GetTimestamp());
     tracepoint_event.set_cpu(event->GetCpu());
 
-    orbit_grpc_protos::TracepointInfo* tracepoint = tracepoint_event.mutable_tracepoint_info();
-    tracepoint->set_name(it->second.name());
-    tracepoint->set_category(it->second.category());
+    // The field names are only sent with the first event of each tracepoint, as the TracepointInfo
+    // is interned, so it's cheap to always set them.
+    *tracepoint_event.mutable_tracepoint_info() = it->second;
+
+    if (has_fields) {
+      for (const TracepointField& field : fields_it->second) {
+        // A field that doesn't fit in the raw data is reported as zero, so that the values stay
+        // aligned with the field names.
+        tracepoint_event.add_field_values(
+            DecodeTracepointField(field, event->raw_data.data(), event->raw_data.size())
+                .value_or(0));
+      }
+    }
 
     listener_->OnTracepointEvent(std::move(tracepoint_event));
 
@@ -1071,19 +2322,31 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
 }
 
 uint64_t TracerThread::ProcessLostEventAndReturnTimestamp(const perf_event_header& header,
-                                                          PerfEventRingBuffer* ring_buffer) {
+                                                          PerfEventRingBuffer* ring_buffer,
+                                                          RingBufferReader* reader) {
   auto event = std::make_unique<LostPerfEvent>();
   ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
+  ring_buffer->OnRecordsLost();
   uint64_t timestamp_ns = event->GetTimestamp();
 
   stats_.lost_count += event->GetNumLost();
-  stats_.lost_count_per_buffer[ring_buffer] += event->GetNumLost();
+  {
+    std::lock_guard<std::mutex> lock(stats_.lost_count_per_buffer_mutex);
+    stats_.lost_count_per_buffer[ring_buffer] += event->GetNumLost();
+  }
+
+  if (sampling_period_controller_ != nullptr) {
+    if (auto it = sampling_fds_to_cpu_.find(ring_buffer->GetFileDescriptor());
+        it != sampling_fds_to_cpu_.end()) {
+      sampling_period_controller_->OnLostRecords(it->second, event->GetNumLost());
+    }
+  }
 
   // Fetch the timestamp of the last event that preceded this PERF_RECORD_LOST in this same ring
   // buffer.
   uint64_t fd_previous_timestamp_ns = 0;
-  if (auto it = fds_to_last_timestamp_ns_.find(ring_buffer->GetFileDescriptor());
-      it != fds_to_last_timestamp_ns_.end()) {
+  if (auto it = reader->fds_to_last_timestamp_ns.find(ring_buffer->GetFileDescriptor());
+      it != reader->fds_to_last_timestamp_ns.end()) {
     fd_previous_timestamp_ns = it->second;
   }
   if (fd_previous_timestamp_ns == 0) {
@@ -1094,7 +2357,7 @@ uint64_t TracerThread::ProcessLostEventAndReturnTimestamp(const perf_event_heade
   }
 
   event->SetPreviousTimestamp(fd_previous_timestamp_ns);
-  DeferEvent(std::move(event));
+  DeferEvent(std::move(event), reader);
 
   return timestamp_ns;
 }
@@ -1112,6 +2375,12 @@ uint64_t TracerThread::ProcessThrottleUnthrottleEventAndReturnTimestamp(
     case PERF_RECORD_THROTTLE:
       LOG("PERF_RECORD_THROTTLE in ring buffer '%s' at timestamp %u", ring_buffer->GetName(),
           timestamp_ns);
+      if (sampling_period_controller_ != nullptr) {
+        if (auto it = sampling_fds_to_cpu_.find(ring_buffer->GetFileDescriptor());
+            it != sampling_fds_to_cpu_.end()) {
+          sampling_period_controller_->OnThrottle(it->second);
+        }
+      }
       break;
     case PERF_RECORD_UNTHROTTLE:
       LOG("PERF_RECORD_UNTHROTTLE in ring buffer '%s' at timestamp %u", ring_buffer->GetName(),
@@ -1124,15 +2393,33 @@ uint64_t TracerThread::ProcessThrottleUnthrottleEventAndReturnTimestamp(
   return timestamp_ns;
 }
 
-void TracerThread::DeferEvent(std::unique_ptr<PerfEvent> event) {
-  std::lock_guard<std::mutex> lock(deferred_events_mutex_);
-  deferred_events_.emplace_back(std::move(event));
+void TracerThread::DeferEvent(std::unique_ptr<PerfEvent> event, RingBufferReader* reader) {
+  std::unique_ptr<PipelineLatencyProbePerfEvent> probe;
+  if (reader->pipeline_latency_probe_period != 0 &&
+      ++reader->deferred_event_count % reader->pipeline_latency_probe_period == 0) {
+    // The probe has the timestamp of the event it follows and is ordered in the same file
+    // descriptor, so that PerfEventProcessor processes it right after that event.
+    probe = std::make_unique<PipelineLatencyProbePerfEvent>(event->GetTimestamp(),
+                                                            orbit_base::CaptureTimestampNs());
+    probe->SetOrderedInFileDescriptor(event->GetOrderedInFileDescriptor());
+  }
+
+  deferred_events_.enqueue(*reader->deferred_events_producer_token, std::move(event));
+  if (probe != nullptr) {
+    deferred_events_.enqueue(*reader->deferred_events_producer_token, std::move(probe));
+  }
+  deferred_events_wake_up_.WakeUp();
 }
 
 std::vector<std::unique_ptr<PerfEvent>> TracerThread::ConsumeDeferredEvents() {
-  std::lock_guard<std::mutex> lock(deferred_events_mutex_);
-  std::vector<std::unique_ptr<PerfEvent>> events(std::move(deferred_events_));
-  deferred_events_.clear();
+  // The queue keeps the events of each producer token, hence of each reader, in order. The order
+  // in which the events of different readers are interleaved doesn't matter, as no two readers
+  // share a ring buffer and PerfEventProcessor only assumes events to be in order per ring buffer.
+  std::vector<std::unique_ptr<PerfEvent>> events(deferred_events_.size_approx());
+  if (events.empty()) {
+    return events;
+  }
+  events.resize(deferred_events_.try_dequeue_bulk(events.begin(), events.size()));
   return events;
 }
 
@@ -1145,10 +2432,10 @@ void TracerThread::ProcessDeferredEvents() {
     // deferred events. The last iteration will consume all remaining events.
     should_exit = stop_deferred_thread_;
     std::vector<std::unique_ptr<PerfEvent>> events = ConsumeDeferredEvents();
+    const size_t deferred_event_count = events.size();
     if (events.empty()) {
-      // TODO: use a wait/notify mechanism instead of check/sleep.
       ORBIT_SCOPE("Sleep");
-      usleep(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US);
+      deferred_events_wake_up_.SleepFor(absl::Microseconds(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US));
     } else {
       {
         ORBIT_SCOPE("AddEvents");
@@ -1161,39 +2448,77 @@ void TracerThread::ProcessDeferredEvents() {
         event_processor_.ProcessOldEvents();
       }
     }
+    // Also forward stack samples unwound in the meantime when no new events arrived.
+    if (uprobes_unwinding_visitor_ != nullptr) {
+      uprobes_unwinding_visitor_->ForwardCompletedStackSamples();
+    }
+    if (collect_service_health_) {
+      ProduceServiceHealthEventIfTimerElapsed(deferred_event_count);
+    }
+    if (function_latency_bpf_aggregator_ != nullptr) {
+      ProduceFunctionLatencySummaryIfTimerElapsed();
+    }
+    {
+      ORBIT_SCOPE("Flush batched events");
+      batching_listener_->Flush();
+    }
   }
 }
 
-void TracerThread::RetrieveInitialTidToPidAssociationSystemWide() {
+std::vector<std::pair<pid_t, pid_t>> TracerThread::RetrieveInitialTidToPidAssociationSystemWide() {
+  std::vector<std::pair<pid_t, pid_t>> tid_to_pid_association;
   for (pid_t pid : GetAllPids()) {
     for (pid_t tid : GetTidsOfProcess(pid)) {
-      switches_states_names_visitor_->ProcessInitialTidToPidAssociation(tid, pid);
+      tid_to_pid_association.emplace_back(tid, pid);
+    }
+  }
+  return tid_to_pid_association;
+}
+
+void TracerThread::ProcessInitialTidToPidAssociation(
+    const std::vector<std::pair<pid_t, pid_t>>& tid_to_pid_association) {
+  for (const auto& [tid, pid] : tid_to_pid_association) {
+    switches_states_names_visitor_->ProcessInitialTidToPidAssociation(tid, pid);
+    if (trace_context_switches_) {
+      for (const std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+        reader->scheduling_slice_producer.ProcessInitialTidToPidAssociation(tid, pid);
+      }
     }
   }
 }
 
 void TracerThread::RetrieveInitialThreadStatesOfTarget() {
-  for (pid_t tid : GetTidsOfProcess(target_pid_)) {
-    uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
-    std::optional<char> state = GetThreadState(tid);
-    if (!state.has_value()) {
-      continue;
+  for (pid_t pid : target_pids_) {
+    for (pid_t tid : GetTidsOfProcess(pid)) {
+      uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+      std::optional<char> state = GetThreadState(tid);
+      if (!state.has_value()) {
+        continue;
+      }
+      switches_states_names_visitor_->ProcessInitialState(timestamp_ns, tid, state.value());
     }
-    switches_states_names_visitor_->ProcessInitialState(timestamp_ns, tid, state.value());
   }
 }
 
 void TracerThread::Reset() {
   ORBIT_SCOPE_FUNCTION;
   tracing_fds_.clear();
+  ring_buffer_readers_.clear();
   ring_buffers_.clear();
-  fds_to_last_timestamp_ns_.clear();
+  ring_buffer_categories_and_cpus_by_fd_.clear();
 
   uprobes_uretprobes_ids_to_function_.clear();
   uprobes_ids_.clear();
   uretprobes_ids_.clear();
+  uprobes_fds_by_function_id_.clear();
+  uretprobes_fds_by_function_id_.clear();
   stack_sampling_ids_.clear();
   callchain_sampling_ids_.clear();
+  pmu_counters_sample_ids_.clear();
+  off_cpu_callstack_ids_.clear();
+  page_fault_callstack_ids_.clear();
+  mmap_callstack_ids_.clear();
+  brk_callstack_ids_.clear();
   task_newtask_ids_.clear();
   task_rename_ids_.clear();
   sched_switch_ids_.clear();
@@ -1201,16 +2526,224 @@ void TracerThread::Reset() {
   amdgpu_cs_ioctl_ids_.clear();
   amdgpu_sched_run_job_ids_.clear();
   dma_fence_signaled_ids_.clear();
+  drm_sched_job_ids_.clear();
+  drm_run_job_ids_.clear();
+  drm_sched_process_job_ids_.clear();
+  i915_request_add_ids_.clear();
+  i915_request_in_ids_.clear();
+  i915_request_in_layout_.reset();
   ids_to_tracepoint_info_.clear();
+  ids_to_tracepoint_fields_.clear();
+  task_newtask_fds_.clear();
+  thread_state_bpf_filter_.reset();
+  function_latency_bpf_aggregator_.reset();
+  function_latency_function_ids_.clear();
+  last_function_latency_histograms_.clear();
+  last_function_latency_summary_ns_ = 0;
+  sampling_fds_to_cpu_.clear();
+  sampling_fds_per_cpu_.clear();
+  sampling_period_controller_.reset();
+  last_sampling_period_update_ns_ = 0;
+  fds_to_leave_disabled_.clear();
+  stack_sampling_fds_per_cpu_by_stack_dump_size_.clear();
+  stack_dump_size_controller_.reset();
+  last_stack_dump_size_update_ns_ = 0;
+  last_service_health_event_ns_ = 0;
+  max_deferred_event_count_ = 0;
+  stack_sample_latencies_ns_.clear();
 
   effective_capture_start_timestamp_ns_ = 0;
+  perf_record_corpus_writer_.reset();
 
   stop_deferred_thread_ = false;
-  deferred_events_.clear();
   uprobes_unwinding_visitor_.reset();
+  maps_of_additional_pids_.clear();
+  stack_unwinding_worker_pool_.reset();
   switches_states_names_visitor_.reset();
   gpu_event_visitor_.reset();
+  lost_and_discarded_event_visitor_.reset();
+  pipeline_latency_probe_visitor_.reset();
   event_processor_.ClearVisitors();
+  batching_listener_.reset();
+}
+
+void TracerThread::RememberRingBufferCategoryAndCpu(int ring_buffer_fd,
+                                                    RingBufferCategory category, int32_t cpu) {
+  ring_buffer_categories_and_cpus_by_fd_.insert_or_assign(ring_buffer_fd,
+                                                          std::make_pair(category, cpu));
+}
+
+void TracerThread::RememberRingBufferCategoryAndCpu(
+    const absl::flat_hash_map<int32_t, int>& ring_buffer_fds_per_cpu,
+    RingBufferCategory category) {
+  for (const auto& [cpu, ring_buffer_fd] : ring_buffer_fds_per_cpu) {
+    RememberRingBufferCategoryAndCpu(ring_buffer_fd, category, cpu);
+  }
+}
+
+void TracerThread::SaveRingBufferFillStatistics() {
+  RingBufferFillStatistics fill_statistics;
+  for (const PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    auto it = ring_buffer_categories_and_cpus_by_fd_.find(ring_buffer.GetFileDescriptor());
+    // Ring buffers that replay a perf record corpus have no category.
+    if (it == ring_buffer_categories_and_cpus_by_fd_.end()) continue;
+    const auto& [category, cpu] = it->second;
+    fill_statistics.Add(category, cpu, ring_buffer.GetSizeKb(), ring_buffer.GetMaxUsedBytes());
+  }
+  if (fill_statistics.IsEmpty()) return;
+  RingBufferFillStatistics::SetOfPreviousCapture(std::move(fill_statistics));
+}
+
+void TracerThread::UpdateSamplingPeriodsIfTimerElapsed() {
+  if (sampling_period_controller_ == nullptr) {
+    return;
+  }
+  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  if (last_sampling_period_update_ns_ + SAMPLING_PERIOD_UPDATE_INTERVAL_MS * NS_PER_MILLISECOND >=
+      timestamp_ns) {
+    return;
+  }
+  last_sampling_period_update_ns_ = timestamp_ns;
+
+  for (const AdaptiveSamplingPeriodController::SamplingPeriodChange& change :
+       sampling_period_controller_->UpdateSamplingPeriods()) {
+    auto it = sampling_fds_per_cpu_.find(change.cpu);
+    CHECK(it != sampling_fds_per_cpu_.end());
+    perf_event_set_period(it->second, change.sampling_period_ns);
+    // The file descriptors for the other stack dump sizes of the same cpu sample at the same rate.
+    for (const auto& [stack_dump_size, fds_per_cpu] :
+         stack_sampling_fds_per_cpu_by_stack_dump_size_) {
+      if (auto fd_it = fds_per_cpu.find(change.cpu);
+          fd_it != fds_per_cpu.end() && fd_it->second != it->second) {
+        perf_event_set_period(fd_it->second, change.sampling_period_ns);
+      }
+    }
+    LOG("Sampling period on cpu %d changed to %u ns", change.cpu, change.sampling_period_ns);
+
+    orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event;
+    sampling_period_changed_event.set_timestamp_ns(timestamp_ns);
+    sampling_period_changed_event.set_cpu(change.cpu);
+    sampling_period_changed_event.set_sampling_period_ns(change.sampling_period_ns);
+    listener_->OnSamplingPeriodChangedEvent(std::move(sampling_period_changed_event));
+  }
+}
+
+void TracerThread::UpdateStackDumpSizeIfTimerElapsed() {
+  if (stack_dump_size_controller_ == nullptr) {
+    return;
+  }
+  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  if (last_stack_dump_size_update_ns_ + STACK_DUMP_SIZE_UPDATE_INTERVAL_MS * NS_PER_MILLISECOND >=
+      timestamp_ns) {
+    return;
+  }
+  last_stack_dump_size_update_ns_ = timestamp_ns;
+
+  std::optional<uint16_t> new_stack_dump_size = stack_dump_size_controller_->UpdateStackDumpSize();
+  if (!new_stack_dump_size.has_value()) {
+    return;
+  }
+  // Disable the previous file descriptors before enabling the new ones, so that no cpu ever takes
+  // two samples at once.
+  for (const auto& [stack_dump_size, fds_per_cpu] :
+       stack_sampling_fds_per_cpu_by_stack_dump_size_) {
+    if (stack_dump_size != new_stack_dump_size.value()) {
+      for (const auto& [cpu, fd] : fds_per_cpu) {
+        perf_event_disable(fd);
+      }
+    }
+  }
+  for (const auto& [cpu, fd] :
+       stack_sampling_fds_per_cpu_by_stack_dump_size_.at(new_stack_dump_size.value())) {
+    perf_event_enable(fd);
+  }
+  LOG("Stack dump size of samples changed to %u", new_stack_dump_size.value());
+}
+
+void TracerThread::ProduceServiceHealthEventIfTimerElapsed(size_t deferred_event_count) {
+  max_deferred_event_count_ = std::max(max_deferred_event_count_, deferred_event_count);
+  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  if (last_service_health_event_ns_ + SERVICE_HEALTH_EVENT_INTERVAL_MS * NS_PER_MILLISECOND >=
+      timestamp_ns) {
+    return;
+  }
+
+  orbit_grpc_protos::ServiceHealthEvent service_health_event;
+  service_health_event.set_duration_ns(timestamp_ns - last_service_health_event_ns_);
+  service_health_event.set_end_timestamp_ns(timestamp_ns);
+  last_service_health_event_ns_ = timestamp_ns;
+
+  for (const std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+    for (size_t i = 0; i < reader->record_counts.size(); ++i) {
+      uint64_t record_count = reader->record_counts[i].exchange(0, std::memory_order_relaxed);
+      if (record_count == 0) {
+        continue;
+      }
+      orbit_grpc_protos::ServiceHealthEvent::RingBufferRecordCount* ring_buffer_record_count =
+          service_health_event.add_ring_buffer_record_counts();
+      ring_buffer_record_count->set_ring_buffer_name(reader->ring_buffers[i]->GetName());
+      ring_buffer_record_count->set_record_count(record_count);
+    }
+  }
+
+  service_health_event.set_perf_event_queue_size(event_processor_.GetEventCount());
+  service_health_event.set_max_deferred_event_count(max_deferred_event_count_);
+  max_deferred_event_count_ = 0;
+
+  if (!stack_sample_latencies_ns_.empty()) {
+    auto percentile_ns = [this](size_t percent) {
+      auto nth = stack_sample_latencies_ns_.begin() +
+                 (stack_sample_latencies_ns_.size() - 1) * percent / 100;
+      std::nth_element(stack_sample_latencies_ns_.begin(), nth, stack_sample_latencies_ns_.end());
+      return *nth;
+    };
+    service_health_event.set_stack_sample_latency_p50_ns(percentile_ns(50));
+    service_health_event.set_stack_sample_latency_p90_ns(percentile_ns(90));
+    service_health_event.set_stack_sample_latency_p99_ns(percentile_ns(99));
+    stack_sample_latencies_ns_.clear();
+  }
+
+  batching_listener_->OnServiceHealthEvent(std::move(service_health_event));
+}
+
+void TracerThread::ProduceFunctionLatencySummaryIfTimerElapsed() {
+  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  if (last_function_latency_summary_ns_ +
+          FUNCTION_LATENCY_SUMMARY_INTERVAL_MS * NS_PER_MILLISECOND >=
+      timestamp_ns) {
+    return;
+  }
+  ProduceFunctionLatencySummary(timestamp_ns);
+}
+
+void TracerThread::ProduceFunctionLatencySummary(uint64_t timestamp_ns) {
+  ORBIT_SCOPE_FUNCTION;
+  ErrorMessageOr<std::vector<FunctionLatencyHistogram>> histograms_or_error =
+      function_latency_bpf_aggregator_->ReadHistograms();
+  if (histograms_or_error.has_error()) {
+    ERROR("%s", histograms_or_error.error().message());
+    return;
+  }
+  std::vector<FunctionLatencyHistogram>& histograms = histograms_or_error.value();
+  // The histograms are accumulated since the creation of the eBPF map, where they all start empty.
+  last_function_latency_histograms_.resize(histograms.size());
+
+  orbit_grpc_protos::CaptureStatisticsSummary summary;
+  summary.set_duration_ns(timestamp_ns - last_function_latency_summary_ns_);
+  summary.set_end_timestamp_ns(timestamp_ns);
+  last_function_latency_summary_ns_ = timestamp_ns;
+  for (size_t function_index = 0; function_index < function_latency_function_ids_.size();
+       ++function_index) {
+    orbit_grpc_protos::FunctionCallStatistics statistics = CreateFunctionCallStatistics(
+        function_latency_function_ids_[function_index], histograms[function_index],
+        last_function_latency_histograms_[function_index]);
+    if (statistics.count() == 0) continue;
+    *summary.add_function_call_statistics() = std::move(statistics);
+  }
+  last_function_latency_histograms_ = std::move(histograms);
+
+  if (summary.function_call_statistics().empty()) return;
+  batching_listener_->OnCaptureStatisticsSummary(std::move(summary));
 }
 
 void TracerThread::PrintStatsIfTimerElapsed() {
@@ -1224,21 +2757,28 @@ void TracerThread::PrintStatsIfTimerElapsed() {
       static_cast<double>(timestamp_ns - stats_.event_count_begin_ns) / NS_PER_SECOND;
   CHECK(actual_window_s > 0.0);
 
+  uint64_t sched_switch_count = stats_.sched_switch_count;
+  uint64_t sample_count = stats_.sample_count;
+  uint64_t uprobes_count = stats_.uprobes_count;
+  uint64_t gpu_events_count = stats_.gpu_events_count;
+  uint64_t lost_count = stats_.lost_count;
+
   LOG("Events per second (and total) last %.3f s:", actual_window_s);
-  LOG("  sched switches: %.0f/s (%lu)", stats_.sched_switch_count / actual_window_s,
-      stats_.sched_switch_count);
-  LOG("  samples: %.0f/s (%lu)", stats_.sample_count / actual_window_s, stats_.sample_count);
-  LOG("  u(ret)probes: %.0f/s (%lu)", stats_.uprobes_count / actual_window_s, stats_.uprobes_count);
-  LOG("  gpu events: %.0f/s (%lu)", stats_.gpu_events_count / actual_window_s,
-      stats_.gpu_events_count);
-
-  if (stats_.lost_count_per_buffer.empty()) {
-    LOG("  lost: %.0f/s (%lu)", stats_.lost_count / actual_window_s, stats_.lost_count);
-  } else {
-    LOG("  LOST: %.0f/s (%lu), of which:", stats_.lost_count / actual_window_s, stats_.lost_count);
-    for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
-      LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
-          buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
+  LOG("  sched switches: %.0f/s (%lu)", sched_switch_count / actual_window_s, sched_switch_count);
+  LOG("  samples: %.0f/s (%lu)", sample_count / actual_window_s, sample_count);
+  LOG("  u(ret)probes: %.0f/s (%lu)", uprobes_count / actual_window_s, uprobes_count);
+  LOG("  gpu events: %.0f/s (%lu)", gpu_events_count / actual_window_s, gpu_events_count);
+
+  {
+    std::lock_guard<std::mutex> lock(stats_.lost_count_per_buffer_mutex);
+    if (stats_.lost_count_per_buffer.empty()) {
+      LOG("  lost: %.0f/s (%lu)", lost_count / actual_window_s, lost_count);
+    } else {
+      LOG("  LOST: %.0f/s (%lu), of which:", lost_count / actual_window_s, lost_count);
+      for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
+        LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
+            buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
+      }
     }
   }
 
@@ -1252,16 +2792,26 @@ void TracerThread::PrintStatsIfTimerElapsed() {
 
   uint64_t unwind_error_count = stats_.unwind_error_count;
   LOG("  unwind errors: %.0f/s (%lu) [%.1f%%]", unwind_error_count / actual_window_s,
-      unwind_error_count, 100.0 * unwind_error_count / stats_.sample_count);
+      unwind_error_count, 100.0 * unwind_error_count / sample_count);
   uint64_t discarded_samples_in_uretprobes_count = stats_.samples_in_uretprobes_count;
   LOG("  samples in u(ret)probes: %.0f/s (%lu) [%.1f%%]",
       discarded_samples_in_uretprobes_count / actual_window_s,
       discarded_samples_in_uretprobes_count,
-      100.0 * discarded_samples_in_uretprobes_count / stats_.sample_count);
+      100.0 * discarded_samples_in_uretprobes_count / sample_count);
 
   uint64_t thread_state_count = stats_.thread_state_count;
   LOG("  target's thread states: %.0f/s (%lu)", thread_state_count / actual_window_s,
       thread_state_count);
+
+  // These are totals since the service started, as the cache is shared by all captures.
+  LibunwindstackElfCache::Stats elf_cache_stats =
+      LibunwindstackElfCache::GetProcessWideCache().GetStats();
+  LOG("Elf cache: %lu hits, %lu misses [%.1f%% hit rate], %lu evictions; %lu files (%.1f MB)",
+      elf_cache_stats.hit_count, elf_cache_stats.miss_count,
+      100.0 * elf_cache_stats.hit_count /
+          (elf_cache_stats.hit_count + elf_cache_stats.miss_count),
+      elf_cache_stats.eviction_count, elf_cache_stats.file_count,
+      static_cast<double>(elf_cache_stats.size_bytes) / (1024 * 1024));
   stats_.Reset();
 }
 
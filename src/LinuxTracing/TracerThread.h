@@ -17,22 +17,39 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "AdaptiveSamplingPeriodController.h"
+#include "AdaptiveStackDumpSizeController.h"
+#include "BatchingTracerListener.h"
 #include "ContextSwitchManager.h"
+#include "CpuLocalSchedulingSliceProducer.h"
+#include "DrmGpuTracepoints.h"
 #include "Function.h"
+#include "FunctionLatencyBpfAggregator.h"
 #include "GpuTracepointVisitor.h"
 #include "LinuxTracing/TracerListener.h"
 #include "LinuxTracingUtils.h"
 #include "LostAndDiscardedEventVisitor.h"
 #include "ManualInstrumentationConfig.h"
 #include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadWakeUp.h"
 #include "PerfEvent.h"
 #include "PerfEventProcessor.h"
 #include "PerfEventRingBuffer.h"
+#include "PerfRecordCorpus.h"
+#include "PipelineLatencyProbeVisitor.h"
+#include "PmuCountersVisitor.h"
+#include "RingBufferSizes.h"
+#include "StackUnwindingWorkerPool.h"
 #include "SwitchesStatesNamesVisitor.h"
+#include "ThreadStateBpfFilter.h"
+#include "TracepointFormat.h"
 #include "UprobesUnwindingVisitor.h"
 #include "capture.pb.h"
+#include "concurrentqueue.h"
 
 namespace orbit_linux_tracing {
 
@@ -49,6 +66,14 @@ class TracerThread {
 
   void Run(const std::shared_ptr<std::atomic<bool>>& exit_requested);
 
+  // Processes the records of a perf record corpus as if they were read from the ring buffers during
+  // a capture, and produces the same events to the listener. Nothing is opened with
+  // perf_event_open and no process is inspected: what the TracerThread would have learned while
+  // opening the file descriptors comes from the header of the corpus, which is why this
+  // TracerThread must have been constructed with corpus.header.capture_options(). The records are
+  // read by the calling thread only, so that replaying the same corpus is deterministic.
+  void Replay(const PerfRecordCorpus& corpus);
+
  private:
   static std::optional<uint64_t> ComputeSamplingPeriodNs(double sampling_frequency) {
     double period_ns_dbl = 1'000'000'000 / sampling_frequency;
@@ -59,11 +84,61 @@ class TracerThread {
     return std::nullopt;
   }
 
+  // The ring buffers in ring_buffers_ are partitioned among one or more RingBufferReaders. Each
+  // RingBufferReader is only ever used by a single thread and keeps its own deferred events, so
+  // that the threads reading from the ring buffers don't contend with each other.
+  struct RingBufferReader {
+    std::vector<PerfEventRingBuffer*> ring_buffers;
+    // Only populated when collect_service_health_ is true: the number of records read from each of
+    // ring_buffers since the last ServiceHealthEvent.
+    std::vector<std::atomic<uint64_t>> record_counts;
+    absl::flat_hash_map<int, uint64_t> fds_to_last_timestamp_ns;
+    // Keeps the events that this reader adds to deferred_events_ in order.
+    std::unique_ptr<moodycamel::ProducerToken> deferred_events_producer_token;
+    // Only used when pipeline_latency_probe_period is not zero: a PipelineLatencyProbePerfEvent is
+    // deferred right after every pipeline_latency_probe_period-th deferred event.
+    uint32_t pipeline_latency_probe_period = 0;
+    uint64_t deferred_event_count = 0;
+    // SchedulingSlices are produced as soon as sched:sched_switch events are read, as they only
+    // depend on the events of the same cpu. They are sent at the end of each round of reading.
+    CpuLocalSchedulingSliceProducer scheduling_slice_producer;
+    // Only set when collecting PMU counters. For the same reason, PmuCountersSamples are also
+    // produced directly by the readers.
+    std::unique_ptr<PmuCountersVisitor> pmu_counters_visitor;
+    // Only valid when wait_for_ring_buffer_data_with_epoll_ is true, -1 otherwise.
+    int epoll_fd = -1;
+  };
+
   void Startup();
   void Shutdown();
-  void ProcessOneRecord(PerfEventRingBuffer* ring_buffer);
-  void InitUprobesEventVisitor();
+  void ReplayStartup(const PerfRecordCorpus& corpus);
+  // Returns the timestamp before which no more event can come from the ring buffers of reader that
+  // still have records, while replaying a corpus.
+  [[nodiscard]] static uint64_t ComputeReplayedEventsFrontierNs(RingBufferReader* reader);
+  void CreatePerfRecordCorpusWriter(
+      std::string initial_maps, const std::vector<orbit_grpc_protos::ModuleInfo>& modules,
+      std::vector<orbit_grpc_protos::PerfRecordCorpusHeader::AdditionalProcess>
+          additional_processes,
+      const std::vector<std::pair<pid_t, pid_t>>& initial_tid_to_pid_association);
+  void CreateRingBufferReaders();
+  [[nodiscard]] bool ReadFromRingBuffersOnce(RingBufferReader* reader,
+                                             const std::atomic<bool>& exit_requested);
+  void WaitForRingBufferData(RingBufferReader* reader);
+  void RunAdditionalRingBufferReader(RingBufferReader* reader, size_t reader_index,
+                                     const std::atomic<bool>& exit_requested);
+  void ProcessOneRecord(PerfEventRingBuffer* ring_buffer, RingBufferReader* reader);
+  void InitUprobesEventVisitor(const std::string& initial_maps);
+  // When more than one process is captured, the processes other than target_pid_ have their own
+  // maps. Needs to be called after InitUprobesEventVisitor.
+  void AddMapsOfAdditionalProcess(pid_t pid, const std::string& initial_maps);
+  [[nodiscard]] LibunwindstackMaps* GetMapsOfProcess(pid_t pid) const;
+  void SendModulesSnapshot(pid_t pid, const std::vector<orbit_grpc_protos::ModuleInfo>& modules);
   bool OpenUserSpaceProbes(const std::vector<int32_t>& cpus);
+  // On failure, closes the file descriptors that were opened and clears the maps.
+  bool OpenUserSpaceProbesOfFunction(const orbit_linux_tracing::Function& function,
+                                     const std::vector<int32_t>& cpus,
+                                     absl::flat_hash_map<int32_t, int>* uprobes_fds_per_cpu,
+                                     absl::flat_hash_map<int32_t, int>* uretprobes_fds_per_cpu);
   bool OpenUprobes(const orbit_linux_tracing::Function& function, const std::vector<int32_t>& cpus,
                    absl::flat_hash_map<int32_t, int>* fds_per_cpu);
   bool OpenUretprobes(const orbit_linux_tracing::Function& function,
@@ -71,70 +146,134 @@ class TracerThread {
                       absl::flat_hash_map<int32_t, int>* fds_per_cpu);
   bool OpenMmapTask(const std::vector<int32_t>& cpus);
   bool OpenSampling(const std::vector<int32_t>& cpus);
+  void OpenStackSamplingWithSmallerStackDumps(const std::vector<int32_t>& cpus);
+  bool OpenPmuCounters(const std::vector<int32_t>& cpus);
+  bool OpenOffCpuCallstacks(const std::vector<int32_t>& cpus);
+  bool OpenMemoryCallstacks(const std::vector<int32_t>& cpus);
 
   void AddUprobesFileDescriptors(const absl::flat_hash_map<int32_t, int>& uprobes_fds_per_cpu,
                                  const orbit_linux_tracing::Function& function);
 
   void AddUretprobesFileDescriptors(const absl::flat_hash_map<int32_t, int>& uretprobes_fds_per_cpu,
                                     const orbit_linux_tracing::Function& function);
+  // Attaches function_latency_bpf_aggregator_ to the probes of a function measured in the kernel,
+  // whose file descriptors then don't need a ring buffer. Returns false on error.
+  [[nodiscard]] bool AttachFunctionLatencyBpfAggregator(
+      const orbit_linux_tracing::Function& function,
+      const absl::flat_hash_map<int32_t, int>& uprobes_fds_per_cpu,
+      const absl::flat_hash_map<int32_t, int>& uretprobes_fds_per_cpu);
+  // Returns whether the probes of function have been disabled.
+  bool DisableUserSpaceProbes(const orbit_linux_tracing::Function& function);
   void OpenUserSpaceProbesRingBuffers(
       const absl::flat_hash_map<int32_t, std::vector<int>>& uprobes_uretpobres_fds_per_cpu);
 
   bool OpenThreadNameTracepoints(const std::vector<int32_t>& cpus);
   void InitSwitchesStatesNamesVisitor();
   bool OpenContextSwitchAndThreadStateTracepoints(const std::vector<int32_t>& cpus);
+  void AttachThreadStateBpfFilter(const std::vector<int>& sched_switch_fds,
+                                  const std::vector<int>& sched_wakeup_fds);
 
   void InitGpuTracepointEventVisitor();
   bool OpenGpuTracepoints(const std::vector<int32_t>& cpus);
+  // Read the layouts of the gpu_scheduler and i915 tracepoints from their format files, as they
+  // differ between kernel versions. Return false if a required tracepoint is not available.
+  bool ReadDrmSchedTracepointLayouts();
+  bool ReadI915RequestTracepointLayouts();
 
   bool OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus);
+  // Returns the fields listed in tracepoint_info.field_names(), or the first few numeric fields of
+  // the tracepoint if there are none, with their offsets read from the tracepoint's format file.
+  [[nodiscard]] static std::vector<TracepointField> GetInstrumentedTracepointFields(
+      const orbit_grpc_protos::TracepointInfo& tracepoint_info);
 
   void InitLostAndDiscardedEventVisitor();
+  void InitPipelineLatencyProbeVisitor();
 
   [[nodiscard]] uint64_t ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessExitEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessMmapEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessSampleEventAndReturnTimestamp(const perf_event_header& header,
-                                                              PerfEventRingBuffer* ring_buffer);
+                                                              PerfEventRingBuffer* ring_buffer,
+                                                              RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessLostEventAndReturnTimestamp(const perf_event_header& header,
-                                                            PerfEventRingBuffer* ring_buffer);
+                                                            PerfEventRingBuffer* ring_buffer,
+                                                            RingBufferReader* reader);
   [[nodiscard]] uint64_t ProcessThrottleUnthrottleEventAndReturnTimestamp(
       const perf_event_header& header, PerfEventRingBuffer* ring_buffer);
 
-  void DeferEvent(std::unique_ptr<PerfEvent> event);
+  void DeferEvent(std::unique_ptr<PerfEvent> event, RingBufferReader* reader);
   std::vector<std::unique_ptr<PerfEvent>> ConsumeDeferredEvents();
   void ProcessDeferredEvents();
 
-  void RetrieveInitialTidToPidAssociationSystemWide();
+  [[nodiscard]] static std::vector<std::pair<pid_t, pid_t>>
+  RetrieveInitialTidToPidAssociationSystemWide();
+  void ProcessInitialTidToPidAssociation(
+      const std::vector<std::pair<pid_t, pid_t>>& tid_to_pid_association);
   void RetrieveInitialThreadStatesOfTarget();
 
   void PrintStatsIfTimerElapsed();
+  void UpdateSamplingPeriodsIfTimerElapsed();
+  void UpdateStackDumpSizeIfTimerElapsed();
+  // Called by the thread processing the deferred events, with the number of events it just took
+  // from the RingBufferReaders.
+  void ProduceServiceHealthEventIfTimerElapsed(size_t deferred_event_count);
+  void ProduceFunctionLatencySummaryIfTimerElapsed();
+  // Sends the calls measured in the kernel since the last summary.
+  void ProduceFunctionLatencySummary(uint64_t timestamp_ns);
 
   void Reset();
 
+  // Remember the category and the cpu of ring buffers, to report how full they got at the end of
+  // the capture.
+  void RememberRingBufferCategoryAndCpu(int ring_buffer_fd, RingBufferCategory category,
+                                        int32_t cpu);
+  void RememberRingBufferCategoryAndCpu(
+      const absl::flat_hash_map<int32_t, int>& ring_buffer_fds_per_cpu,
+      RingBufferCategory category);
+  void SaveRingBufferFillStatistics();
+
   // Number of records to read consecutively from a perf_event_open ring buffer
   // before switching to another one.
   static constexpr int32_t ROUND_ROBIN_POLLING_BATCH_SIZE = 5;
 
-  // These values are supposed to be large enough to accommodate enough events
-  // in case TracerThread::Run's thread is not scheduled for a few tens of
-  // milliseconds.
-  static constexpr uint64_t UPROBES_RING_BUFFER_SIZE_KB = 8 * 1024;
-  static constexpr uint64_t MMAP_TASK_RING_BUFFER_SIZE_KB = 64;
-  static constexpr uint64_t SAMPLING_RING_BUFFER_SIZE_KB = 16 * 1024;
-  static constexpr uint64_t THREAD_NAMES_RING_BUFFER_SIZE_KB = 64;
-  static constexpr uint64_t CONTEXT_SWITCHES_AND_THREAD_STATE_RING_BUFFER_SIZE_KB = 2 * 1024;
-  static constexpr uint64_t GPU_TRACING_RING_BUFFER_SIZE_KB = 256;
-  static constexpr uint64_t INSTRUMENTED_TRACEPOINTS_RING_BUFFER_SIZE_KB = 8 * 1024;
+  // Upper bound on the threads used to open the uprobes and uretprobes of instrumented functions.
+  static constexpr size_t MAX_USER_SPACE_PROBES_OPENING_THREAD_COUNT = 8;
 
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_RING_BUFFERS_US = 1000;
+  // The thread processing the deferred events is woken up as soon as events are deferred, but
+  // without new events it still wakes up this often to process the events that have become old
+  // enough and to forward the stack samples unwound in the meantime.
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US = 1000;
+  // When waiting for ring buffer data with epoll, wait at most this long so that data below the
+  // wakeup watermark is also read in a timely manner, and so that exit requests are noticed.
+  static constexpr int MAX_EPOLL_WAIT_TIME_ON_EMPTY_RING_BUFFERS_MS = 10;
+  // With adaptive_sampling_period_, how often the pressure on the sampling ring buffers is
+  // evaluated and the sampling periods are possibly changed.
+  static constexpr uint64_t SAMPLING_PERIOD_UPDATE_INTERVAL_MS = 500;
+  // With adaptive_stack_dump_size_, how often the stack dump size of samples is possibly changed,
+  // and how many sizes, halving from stack_dump_size_ down to a minimum, are available.
+  static constexpr uint64_t STACK_DUMP_SIZE_UPDATE_INTERVAL_MS = 1000;
+  static constexpr size_t MAX_ADAPTIVE_STACK_DUMP_SIZE_COUNT = 4;
+  static constexpr uint16_t MIN_ADAPTIVE_STACK_DUMP_SIZE = 4096;
+  // With collect_memory_callstacks_, a callstack is recorded every this many page faults, as page
+  // faults are much more frequent than mmap and brk calls.
+  static constexpr uint64_t MEMORY_CALLSTACKS_PAGE_FAULTS_PERIOD = 100;
+  // With collect_service_health_, how often a ServiceHealthEvent is sent.
+  static constexpr uint64_t SERVICE_HEALTH_EVENT_INTERVAL_MS = 1000;
+  // How often the durations of the calls measured in the kernel are read and sent.
+  static constexpr uint64_t FUNCTION_LATENCY_SUMMARY_INTERVAL_MS = 1000;
 
   bool trace_context_switches_;
   pid_t target_pid_;
+  // Contains target_pid_ and the additional pids of the CaptureOptions. The events of all these
+  // processes are read from the same ring buffers and are filtered when they are read.
+  absl::flat_hash_set<pid_t> target_pids_;
   uint64_t sampling_period_ns_;
   uint16_t stack_dump_size_;
   orbit_grpc_protos::CaptureOptions::UnwindingMethod unwinding_method_;
@@ -143,18 +282,55 @@ class TracerThread {
   bool trace_thread_state_;
   bool trace_gpu_driver_;
   std::vector<orbit_grpc_protos::TracepointInfo> instrumented_tracepoints_;
+  uint32_t ring_buffer_reader_thread_count_;
+  uint32_t dwarf_unwinding_thread_count_;
+  bool wait_for_ring_buffer_data_with_epoll_;
+  bool adaptive_sampling_period_;
+  absl::flat_hash_set<std::string> modules_without_frame_pointers_;
+  bool filter_thread_state_events_with_bpf_;
+  bool collect_pmu_counters_;
+  bool collect_off_cpu_callstacks_;
+  bool collect_memory_callstacks_;
+  bool collect_kernel_callstacks_;
+  uint64_t max_uprobes_per_second_per_function_;
+  bool adaptive_stack_dump_size_;
+  bool collect_service_health_;
+  std::string perf_record_corpus_file_path_;
+  uint32_t pipeline_latency_probe_period_;
+  // Only set when perf_record_corpus_file_path_ is not empty, as the header of the corpus contains
+  // the CaptureOptions.
+  orbit_grpc_protos::CaptureOptions capture_options_;
 
   TracerListener* listener_ = nullptr;
 
+  // Written to by the threads reading from the ring buffers, each with the producer token of its
+  // RingBufferReader, and read from by the thread processing the deferred events. Declared before
+  // ring_buffer_readers_, as the producer tokens must be destroyed before the queue.
+  moodycamel::ConcurrentQueue<std::unique_ptr<PerfEvent>> deferred_events_;
+  orbit_base::ThreadWakeUp deferred_events_wake_up_;
+
   std::vector<int> tracing_fds_;
   std::vector<PerfEventRingBuffer> ring_buffers_;
-  absl::flat_hash_map<int, uint64_t> fds_to_last_timestamp_ns_;
+  RingBufferSizes ring_buffer_sizes_;
+  absl::flat_hash_map<int, std::pair<RingBufferCategory, int32_t>>
+      ring_buffer_categories_and_cpus_by_fd_;
+  // ring_buffer_readers_[0] is used by the thread executing Run, each of the other readers by an
+  // additional thread.
+  std::vector<std::unique_ptr<RingBufferReader>> ring_buffer_readers_;
 
   absl::flat_hash_map<uint64_t, const Function*> uprobes_uretprobes_ids_to_function_;
   absl::flat_hash_set<uint64_t> uprobes_ids_;
   absl::flat_hash_set<uint64_t> uretprobes_ids_;
+  // Only used to disable the probes of functions that exceed max_uprobes_per_second_per_function_.
+  absl::flat_hash_map<uint64_t, std::vector<int>> uprobes_fds_by_function_id_;
+  absl::flat_hash_map<uint64_t, std::vector<int>> uretprobes_fds_by_function_id_;
   absl::flat_hash_set<uint64_t> stack_sampling_ids_;
   absl::flat_hash_set<uint64_t> callchain_sampling_ids_;
+  absl::flat_hash_set<uint64_t> pmu_counters_sample_ids_;
+  absl::flat_hash_set<uint64_t> off_cpu_callstack_ids_;
+  absl::flat_hash_set<uint64_t> page_fault_callstack_ids_;
+  absl::flat_hash_set<uint64_t> mmap_callstack_ids_;
+  absl::flat_hash_set<uint64_t> brk_callstack_ids_;
   absl::flat_hash_set<uint64_t> task_newtask_ids_;
   absl::flat_hash_set<uint64_t> task_rename_ids_;
   absl::flat_hash_set<uint64_t> sched_switch_ids_;
@@ -162,23 +338,78 @@ class TracerThread {
   absl::flat_hash_set<uint64_t> amdgpu_cs_ioctl_ids_;
   absl::flat_hash_set<uint64_t> amdgpu_sched_run_job_ids_;
   absl::flat_hash_set<uint64_t> dma_fence_signaled_ids_;
+  absl::flat_hash_set<uint64_t> drm_sched_job_ids_;
+  absl::flat_hash_set<uint64_t> drm_run_job_ids_;
+  absl::flat_hash_set<uint64_t> drm_sched_process_job_ids_;
+  absl::flat_hash_set<uint64_t> i915_request_add_ids_;
+  absl::flat_hash_set<uint64_t> i915_request_in_ids_;
+  DrmSchedTracepointLayout drm_sched_job_layout_;
+  DrmSchedTracepointLayout drm_run_job_layout_;
+  DrmSchedTracepointLayout drm_sched_process_job_layout_;
+  I915RequestTracepointLayout i915_request_add_layout_;
+  std::optional<I915RequestTracepointLayout> i915_request_in_layout_;
+  // The TracepointInfos list the names of the fields decoded from the raw data of the events, which
+  // are described by the TracepointFields with the same stream id.
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo> ids_to_tracepoint_info_;
+  absl::flat_hash_map<uint64_t, std::vector<TracepointField>> ids_to_tracepoint_fields_;
+
+  // Only used to attach thread_state_bpf_filter_.
+  std::vector<int> task_newtask_fds_;
+  // Only set when the sched:sched_switch and sched:sched_wakeup events are filtered in the kernel.
+  std::unique_ptr<ThreadStateBpfFilter> thread_state_bpf_filter_;
+
+  // Only set when the calls of some functions are measured in the kernel, see
+  // Function::aggregate_latency_in_kernel. The functions are indexed as in
+  // function_latency_function_ids_. Once the capture has started, only used by the thread
+  // processing the deferred events.
+  std::unique_ptr<FunctionLatencyBpfAggregator> function_latency_bpf_aggregator_;
+  std::vector<uint64_t> function_latency_function_ids_;
+  std::vector<FunctionLatencyHistogram> last_function_latency_histograms_;
+  uint64_t last_function_latency_summary_ns_ = 0;
+
+  // Only populated when adaptive_sampling_period_ is true. Each sampling file descriptor is also
+  // the file descriptor of its own ring buffer.
+  absl::flat_hash_map<int, int32_t> sampling_fds_to_cpu_;
+  absl::flat_hash_map<int32_t, int> sampling_fds_per_cpu_;
+  std::unique_ptr<AdaptiveSamplingPeriodController> sampling_period_controller_;
+  uint64_t last_sampling_period_update_ns_ = 0;
+
+  // Only populated when stack_dump_size_controller_ is set: for each stack dump size, the stack
+  // sampling file descriptor of each cpu. Only those of the current size are enabled.
+  absl::flat_hash_map<uint16_t, absl::flat_hash_map<int32_t, int>>
+      stack_sampling_fds_per_cpu_by_stack_dump_size_;
+  // File descriptors in tracing_fds_ that are not enabled when the capture starts.
+  absl::flat_hash_set<int> fds_to_leave_disabled_;
+  std::unique_ptr<AdaptiveStackDumpSizeController> stack_dump_size_controller_;
+  uint64_t last_stack_dump_size_update_ns_ = 0;
+
+  // Only used when collect_service_health_ is true, by the thread processing the deferred events.
+  uint64_t last_service_health_event_ns_ = 0;
+  size_t max_deferred_event_count_ = 0;
+  std::vector<uint64_t> stack_sample_latencies_ns_;
 
   uint64_t effective_capture_start_timestamp_ns_ = 0;
 
+  // Only set when perf_record_corpus_file_path_ is not empty. Written to by all the threads reading
+  // from the ring buffers.
+  std::unique_ptr<PerfRecordCorpusWriter> perf_record_corpus_writer_;
+
   std::atomic<bool> stop_deferred_thread_ = false;
-  std::vector<std::unique_ptr<PerfEvent>> deferred_events_;
-  std::mutex deferred_events_mutex_;
 
   UprobesFunctionCallManager function_call_manager_;
   UprobesReturnAddressManager return_address_manager_;
   std::unique_ptr<LibunwindstackMaps> maps_;
+  absl::flat_hash_map<pid_t, std::unique_ptr<LibunwindstackMaps>> maps_of_additional_pids_;
   std::unique_ptr<LibunwindstackUnwinder> unwinder_;
+  std::unique_ptr<StackUnwindingWorkerPool> stack_unwinding_worker_pool_;
   std::unique_ptr<LeafFunctionCallManager> leaf_function_call_manager_;
+  std::unique_ptr<BatchingTracerListener> batching_listener_;
   std::unique_ptr<UprobesUnwindingVisitor> uprobes_unwinding_visitor_;
   std::unique_ptr<SwitchesStatesNamesVisitor> switches_states_names_visitor_;
   std::unique_ptr<GpuTracepointVisitor> gpu_event_visitor_;
   std::unique_ptr<LostAndDiscardedEventVisitor> lost_and_discarded_event_visitor_;
+  // Only set when pipeline_latency_probe_period_ is not zero.
+  std::unique_ptr<PipelineLatencyProbeVisitor> pipeline_latency_probe_visitor_;
   PerfEventProcessor event_processor_;
 
   struct EventStats {
@@ -189,20 +420,25 @@ class TracerThread {
       uprobes_count = 0;
       gpu_events_count = 0;
       lost_count = 0;
-      lost_count_per_buffer.clear();
+      {
+        std::lock_guard<std::mutex> lock(lost_count_per_buffer_mutex);
+        lost_count_per_buffer.clear();
+      }
       discarded_out_of_order_count = 0;
       unwind_error_count = 0;
       samples_in_uretprobes_count = 0;
       thread_state_count = 0;
     }
 
+    // The counters are atomic as they can be updated by multiple ring buffer reader threads.
     uint64_t event_count_begin_ns = 0;
-    uint64_t sched_switch_count = 0;
-    uint64_t sample_count = 0;
-    uint64_t uprobes_count = 0;
-    uint64_t gpu_events_count = 0;
-    uint64_t lost_count = 0;
+    std::atomic<uint64_t> sched_switch_count = 0;
+    std::atomic<uint64_t> sample_count = 0;
+    std::atomic<uint64_t> uprobes_count = 0;
+    std::atomic<uint64_t> gpu_events_count = 0;
+    std::atomic<uint64_t> lost_count = 0;
     absl::flat_hash_map<PerfEventRingBuffer*, uint64_t> lost_count_per_buffer{};
+    std::mutex lost_count_per_buffer_mutex;
     std::atomic<uint64_t> discarded_out_of_order_count = 0;
     std::atomic<uint64_t> unwind_error_count = 0;
     std::atomic<uint64_t> samples_in_uretprobes_count = 0;
@@ -6,8 +6,13 @@
 #define LINUX_TRACING_UPROBES_FUNCTION_CALL_MANAGER_H_
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 
+#include <array>
+#include <cstdint>
+#include <optional>
 #include <stack>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "PerfEventRecords.h"
@@ -27,10 +32,32 @@ class UprobesFunctionCallManager {
   UprobesFunctionCallManager(UprobesFunctionCallManager&&) = default;
   UprobesFunctionCallManager& operator=(UprobesFunctionCallManager&&) = default;
 
+  // Records all the integer arguments and the return value, as needed by the manual
+  // instrumentation functions.
   void ProcessUprobes(pid_t tid, uint64_t function_id, uint64_t begin_timestamp,
                       const perf_event_sample_regs_user_sp_ip_arguments& regs) {
+    static const std::vector<uint32_t> kAllArgumentIndices{0, 1, 2, 3, 4, 5};
+    ProcessUprobes(tid, function_id, begin_timestamp, regs, kAllArgumentIndices,
+                   /*record_return_value=*/true);
+  }
+
+  // Only records the arguments with `recorded_argument_indices` (indices into rdi, rsi, rdx, rcx,
+  // r8, r9; invalid ones are ignored) and, on `record_return_value`, the return value, so that the
+  // FunctionCalls of the other functions stay small.
+  void ProcessUprobes(pid_t tid, uint64_t function_id, uint64_t begin_timestamp,
+                      const perf_event_sample_regs_user_sp_ip_arguments& regs,
+                      const std::vector<uint32_t>& recorded_argument_indices,
+                      bool record_return_value) {
     auto& tid_uprobes_stack = tid_uprobes_stacks_[tid];
-    tid_uprobes_stack.emplace(function_id, begin_timestamp, regs);
+    OpenUprobes& open_uprobes =
+        tid_uprobes_stack.emplace(function_id, begin_timestamp, record_return_value);
+    for (uint32_t argument_index : recorded_argument_indices) {
+      std::optional<uint64_t> argument = GetArgument(regs, argument_index);
+      if (!argument.has_value() || open_uprobes.argument_count == open_uprobes.arguments.size()) {
+        continue;
+      }
+      open_uprobes.arguments[open_uprobes.argument_count++] = argument.value();
+    }
   }
 
   std::optional<orbit_grpc_protos::FunctionCall> ProcessUretprobes(pid_t pid, pid_t tid,
@@ -53,13 +80,12 @@ class UprobesFunctionCallManager {
     function_call.set_duration_ns(end_timestamp - tid_uprobe.begin_timestamp);
     function_call.set_end_timestamp_ns(end_timestamp);
     function_call.set_depth(tid_uprobes_stack.size() - 1);
-    function_call.set_return_value(return_value);
-    function_call.add_registers(tid_uprobe.registers.di);
-    function_call.add_registers(tid_uprobe.registers.si);
-    function_call.add_registers(tid_uprobe.registers.dx);
-    function_call.add_registers(tid_uprobe.registers.cx);
-    function_call.add_registers(tid_uprobe.registers.r8);
-    function_call.add_registers(tid_uprobe.registers.r9);
+    if (tid_uprobe.record_return_value) {
+      function_call.set_return_value(return_value);
+    }
+    for (size_t i = 0; i < tid_uprobe.argument_count; ++i) {
+      function_call.add_registers(tid_uprobe.arguments[i]);
+    }
 
     tid_uprobes_stack.pop();
     if (tid_uprobes_stack.empty()) {
@@ -68,14 +94,62 @@ class UprobesFunctionCallManager {
     return function_call;
   }
 
+  // Discards the innermost open uprobes of tid as long as they belong to one of function_ids, which
+  // are no longer instrumented, and not to returning_function_id, the function of a uretprobe that
+  // is about to be processed. The uretprobes of those uprobes will never be recorded. Returns the
+  // number of uprobes discarded.
+  size_t DiscardOpenUprobesOfFunctions(pid_t tid, const absl::flat_hash_set<uint64_t>& function_ids,
+                                       uint64_t returning_function_id) {
+    auto it = tid_uprobes_stacks_.find(tid);
+    if (it == tid_uprobes_stacks_.end()) {
+      return 0;
+    }
+    auto& tid_uprobes_stack = it->second;
+    size_t discarded_count = 0;
+    while (!tid_uprobes_stack.empty() &&
+           tid_uprobes_stack.top().function_id != returning_function_id &&
+           function_ids.contains(tid_uprobes_stack.top().function_id)) {
+      tid_uprobes_stack.pop();
+      ++discarded_count;
+    }
+    if (tid_uprobes_stack.empty()) {
+      tid_uprobes_stacks_.erase(it);
+    }
+    return discarded_count;
+  }
+
  private:
+  [[nodiscard]] static std::optional<uint64_t> GetArgument(
+      const perf_event_sample_regs_user_sp_ip_arguments& regs, uint32_t argument_index) {
+    switch (argument_index) {
+      case 0:
+        return regs.di;
+      case 1:
+        return regs.si;
+      case 2:
+        return regs.dx;
+      case 3:
+        return regs.cx;
+      case 4:
+        return regs.r8;
+      case 5:
+        return regs.r9;
+      default:
+        return std::nullopt;
+    }
+  }
+
   struct OpenUprobes {
-    OpenUprobes(uint64_t function_id, uint64_t begin_timestamp,
-                const perf_event_sample_regs_user_sp_ip_arguments& regs)
-        : function_id{function_id}, begin_timestamp{begin_timestamp}, registers(regs) {}
+    OpenUprobes(uint64_t function_id, uint64_t begin_timestamp, bool record_return_value)
+        : function_id{function_id},
+          begin_timestamp{begin_timestamp},
+          record_return_value{record_return_value} {}
     uint64_t function_id;
     uint64_t begin_timestamp;
-    perf_event_sample_regs_user_sp_ip_arguments registers;
+    bool record_return_value;
+    // The recorded arguments, in the order they were requested.
+    std::array<uint64_t, 6> arguments{};
+    size_t argument_count = 0;
   };
 
   // This map keeps the stack of the dynamically-instrumented functions entered.
@@ -119,6 +119,38 @@ TEST(UprobesFunctionCallManager, TwoUprobesDifferentThreads) {
   EXPECT_EQ(processed_function_call.value().registers_size(), 6);
 }
 
+TEST(UprobesFunctionCallManager, OnlyRequestedArgumentsAndReturnValueAreRecorded) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  std::optional<FunctionCall> processed_function_call;
+  UprobesFunctionCallManager function_call_manager;
+  perf_event_sample_regs_user_sp_ip_arguments registers{};
+  registers.di = 10;
+  registers.si = 11;
+  registers.dx = 12;
+  registers.cx = 13;
+  registers.r8 = 14;
+  registers.r9 = 15;
+
+  function_call_manager.ProcessUprobes(tid, 100, 1, registers, {}, false);
+  function_call_manager.ProcessUprobes(tid, 200, 2, registers, {5, 0, 6}, true);
+
+  processed_function_call = function_call_manager.ProcessUretprobes(pid, tid, 3, 4);
+  ASSERT_TRUE(processed_function_call.has_value());
+  EXPECT_EQ(processed_function_call.value().function_id(), 200);
+  EXPECT_EQ(processed_function_call.value().return_value(), 4);
+  // The invalid index 6 is ignored.
+  ASSERT_EQ(processed_function_call.value().registers_size(), 2);
+  EXPECT_EQ(processed_function_call.value().registers(0), 15);
+  EXPECT_EQ(processed_function_call.value().registers(1), 10);
+
+  processed_function_call = function_call_manager.ProcessUretprobes(pid, tid, 4, 5);
+  ASSERT_TRUE(processed_function_call.has_value());
+  EXPECT_EQ(processed_function_call.value().function_id(), 100);
+  EXPECT_EQ(processed_function_call.value().return_value(), 0);
+  EXPECT_EQ(processed_function_call.value().registers_size(), 0);
+}
+
 TEST(UprobesFunctionCallManager, OnlyUretprobe) {
   constexpr pid_t pid = 41;
   constexpr pid_t tid = 42;
@@ -129,4 +161,32 @@ TEST(UprobesFunctionCallManager, OnlyUretprobe) {
   ASSERT_FALSE(processed_function_call.has_value());
 }
 
+TEST(UprobesFunctionCallManager, DiscardOpenUprobesOfFunctions) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  std::optional<FunctionCall> processed_function_call;
+  UprobesFunctionCallManager function_call_manager;
+  perf_event_sample_regs_user_sp_ip_arguments registers;
+
+  function_call_manager.ProcessUprobes(tid, 100, 1, registers);
+  function_call_manager.ProcessUprobes(tid, 200, 2, registers);
+  function_call_manager.ProcessUprobes(tid, 300, 3, registers);
+  function_call_manager.ProcessUprobes(tid, 200, 4, registers);
+
+  // Only the innermost uprobes of the discarded functions are discarded, up to the first uprobe of
+  // the function that is returning.
+  EXPECT_EQ(function_call_manager.DiscardOpenUprobesOfFunctions(tid, {200, 300}, 200), 0);
+  EXPECT_EQ(function_call_manager.DiscardOpenUprobesOfFunctions(tid, {200}, 100), 1);
+  EXPECT_EQ(function_call_manager.DiscardOpenUprobesOfFunctions(tid, {200}, 100), 0);
+  EXPECT_EQ(function_call_manager.DiscardOpenUprobesOfFunctions(tid, {200, 300}, 100), 2);
+
+  processed_function_call = function_call_manager.ProcessUretprobes(pid, tid, 5, 6);
+  ASSERT_TRUE(processed_function_call.has_value());
+  EXPECT_EQ(processed_function_call.value().function_id(), 100);
+  EXPECT_EQ(processed_function_call.value().duration_ns(), 4);
+  EXPECT_EQ(processed_function_call.value().depth(), 0);
+
+  EXPECT_EQ(function_call_manager.DiscardOpenUprobesOfFunctions(tid, {100}, 200), 0);
+}
+
 }  // namespace orbit_linux_tracing
@@ -10,7 +10,10 @@
 #include <unwindstack/MapInfo.h>
 #include <unwindstack/Maps.h>
 
-#include <stack>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
@@ -31,31 +34,43 @@ class UprobesReturnAddressManager {
   UprobesReturnAddressManager& operator=(UprobesReturnAddressManager&&) = default;
 
   virtual void ProcessUprobes(pid_t tid, uint64_t stack_pointer, uint64_t return_address) {
-    auto& tid_uprobes_stack = tid_uprobes_stacks_[tid];
-    tid_uprobes_stack.emplace_back(stack_pointer, return_address);
+    ShadowStack& shadow_stack = tid_shadow_stacks_[tid];
+    if (shadow_stack.open_uprobes.empty() ||
+        shadow_stack.open_uprobes.back().stack_pointer != stack_pointer) {
+      ++shadow_stack.unique_stack_pointer_count;
+    }
+    shadow_stack.open_uprobes.emplace_back(stack_pointer, return_address);
   }
 
   virtual void PatchSample(pid_t tid, uint64_t stack_pointer, void* stack_data,
                            uint64_t stack_size) {
-    if (!tid_uprobes_stacks_.contains(tid)) {
+    auto shadow_stack_it = tid_shadow_stacks_.find(tid);
+    if (shadow_stack_it == tid_shadow_stacks_.end()) {
       return;
     }
 
-    auto& tid_uprobes_stack = tid_uprobes_stacks_.at(tid);
-    CHECK(!tid_uprobes_stack.empty());
+    const std::vector<OpenUprobes>& open_uprobes = shadow_stack_it->second.open_uprobes;
+    CHECK(!open_uprobes.empty());
+
+    // The stack grows towards lower addresses, so the stack pointers of the open uprobes are
+    // non-increasing from the outermost to the innermost. The open uprobes that are not below the
+    // sampled stack pointer are hence a prefix of the shadow stack, and the ones whose return
+    // address is in the dump are the innermost of those.
+    auto end_it = std::partition_point(open_uprobes.begin(), open_uprobes.end(),
+                                       [stack_pointer](const OpenUprobes& uprobes) {
+                                         return uprobes.stack_pointer >= stack_pointer;
+                                       });
 
     // Apply saved return addresses in reverse order, from the last called
     // function. In case two uretprobes hijacked an address at the same stack
     // pointer (e.g., in case of tail-call optimization), this results in the
     // correct original return address to end up in the patched stack.
-    for (auto it = tid_uprobes_stack.rbegin(); it != tid_uprobes_stack.rend(); it++) {
+    for (auto it = std::make_reverse_iterator(end_it); it != open_uprobes.rend(); it++) {
       const OpenUprobes& uprobes = *it;
-      if (uprobes.stack_pointer < stack_pointer) {
-        continue;
-      }
-      const uint64_t& offset = uprobes.stack_pointer - stack_pointer;
-      if (offset >= stack_size) {
-        continue;
+      const uint64_t offset = uprobes.stack_pointer - stack_pointer;
+      // All the outer uprobes are even further up the stack than the end of the dump.
+      if (offset >= stack_size || stack_size - offset < sizeof(uprobes.return_address)) {
+        break;
       }
 
       memcpy(static_cast<uint8_t*>(stack_data) + offset, &uprobes.return_address,
@@ -75,7 +90,9 @@ class UprobesReturnAddressManager {
     CHECK(callchain != nullptr);
     CHECK(maps != nullptr);
 
-    std::vector<uint64_t> frames_to_patch;
+    // Reused across calls, as this is called for every sample.
+    std::vector<uint64_t>& frames_to_patch = frames_to_patch_;
+    frames_to_patch.clear();
     for (uint64_t i = 0; i < callchain_size; i++) {
       uint64_t ip = callchain[i];
       unwindstack::MapInfo* map_info = maps->Find(ip);
@@ -87,7 +104,8 @@ class UprobesReturnAddressManager {
       frames_to_patch.push_back(i);
     }
 
-    if (!tid_uprobes_stacks_.contains(tid)) {
+    auto shadow_stack_it = tid_shadow_stacks_.find(tid);
+    if (shadow_stack_it == tid_shadow_stacks_.end()) {
       // If there are no uprobes, but the callchain needs to be patched, we need
       // to discard the sample.
       // There are two situations where this may happen:
@@ -100,17 +118,10 @@ class UprobesReturnAddressManager {
       return true;
     }
 
-    auto& tid_uprobes_stack = tid_uprobes_stacks_.at(tid);
+    const std::vector<OpenUprobes>& tid_uprobes_stack = shadow_stack_it->second.open_uprobes;
     CHECK(!tid_uprobes_stack.empty());
 
-    size_t num_unique_uprobes = 0;
-    uint64_t prev_uprobe_stack_pointer = -1;
-    for (const auto& uprobe : tid_uprobes_stack) {
-      if (uprobe.stack_pointer != prev_uprobe_stack_pointer) {
-        num_unique_uprobes++;
-      }
-      prev_uprobe_stack_pointer = uprobe.stack_pointer;
-    }
+    const size_t num_unique_uprobes = shadow_stack_it->second.unique_stack_pointer_count;
 
     // In case we have less uprobes (with correct return address) than frames
     // to be patched, we need to discard this sample.
@@ -148,7 +159,7 @@ class UprobesReturnAddressManager {
     // the correct callstack will only contain the callee.
     // However, there are two uprobe records (with the same stack pointer),
     // where the first one (the caller's) contains the correct return address.
-    prev_uprobe_stack_pointer = -1;
+    uint64_t prev_uprobe_stack_pointer = -1;
     size_t unique_uprobes_so_far = 0;
     for (size_t uprobe_i = 0; uprobe_i < uprobes_size; uprobe_i++) {
       // If the innermost frame does not need to be patched (see above), we are
@@ -174,15 +185,22 @@ class UprobesReturnAddressManager {
   }
 
   virtual void ProcessUretprobes(pid_t tid) {
-    if (!tid_uprobes_stacks_.contains(tid)) {
+    auto shadow_stack_it = tid_shadow_stacks_.find(tid);
+    if (shadow_stack_it == tid_shadow_stacks_.end()) {
       return;
     }
 
-    auto& tid_uprobes_stack = tid_uprobes_stacks_.at(tid);
-    CHECK(!tid_uprobes_stack.empty());
-    tid_uprobes_stack.pop_back();
-    if (tid_uprobes_stack.empty()) {
-      tid_uprobes_stacks_.erase(tid);
+    ShadowStack& shadow_stack = shadow_stack_it->second;
+    std::vector<OpenUprobes>& open_uprobes = shadow_stack.open_uprobes;
+    CHECK(!open_uprobes.empty());
+    const uint64_t popped_stack_pointer = open_uprobes.back().stack_pointer;
+    open_uprobes.pop_back();
+    if (open_uprobes.empty()) {
+      tid_shadow_stacks_.erase(shadow_stack_it);
+      return;
+    }
+    if (open_uprobes.back().stack_pointer != popped_stack_pointer) {
+      --shadow_stack.unique_stack_pointer_count;
     }
   }
 
@@ -194,7 +212,16 @@ class UprobesReturnAddressManager {
     uint64_t return_address;
   };
 
-  absl::flat_hash_map<pid_t, std::vector<OpenUprobes>> tid_uprobes_stacks_{};
+  // The open uprobes of a thread, from the outermost to the innermost.
+  struct ShadowStack {
+    std::vector<OpenUprobes> open_uprobes;
+    // The number of distinct stack pointers in open_uprobes. This is less than its size when
+    // instrumented functions were tail-called, as those share the stack pointer of the caller.
+    size_t unique_stack_pointer_count = 0;
+  };
+
+  absl::flat_hash_map<pid_t, ShadowStack> tid_shadow_stacks_{};
+  std::vector<uint64_t> frames_to_patch_{};
 };
 
 }  // namespace orbit_linux_tracing
@@ -395,9 +395,47 @@ TEST(UprobesReturnAddressManager, TailCallOptimization) {
   test_handler.OnNonUretprobesReturn();
 }
 
+TEST(UprobesReturnAddressManager, OnlyTheUprobesInTheDumpArePatched) {
+  UprobesReturnAddressManager return_address_manager;
+  constexpr pid_t kTid = 42;
+
+  // The stack grows towards lower addresses: A calls B, which calls C, all instrumented.
+  return_address_manager.ProcessUprobes(kTid, 0x1000, 0xA);
+  return_address_manager.ProcessUprobes(kTid, 0x0F00, 0xB);
+  return_address_manager.ProcessUprobes(kTid, 0x0E00, 0xC);
+
+  // The dump covers [0x0E00, 0x0F08): the return addresses of B and C, but not the one of A.
+  std::vector<uint64_t> stack(0x108 / sizeof(uint64_t), 0);
+  return_address_manager.PatchSample(kTid, 0x0E00, stack.data(), stack.size() * sizeof(uint64_t));
+  std::vector<uint64_t> expected_stack(stack.size(), 0);
+  expected_stack.front() = 0xC;
+  expected_stack.back() = 0xB;
+  EXPECT_EQ(stack, expected_stack);
+
+  // The dump starts above the return address of C and ends before the one of A.
+  stack.assign(0x80 / sizeof(uint64_t), 0);
+  return_address_manager.PatchSample(kTid, 0x0E80, stack.data(), stack.size() * sizeof(uint64_t));
+  EXPECT_EQ(stack, std::vector<uint64_t>(stack.size(), 0));
+
+  // The dump ends in the middle of the return address of B.
+  stack.assign(0x108 / sizeof(uint64_t), 0);
+  return_address_manager.PatchSample(kTid, 0x0E00, stack.data(), 0x104);
+  expected_stack.assign(stack.size(), 0);
+  expected_stack.front() = 0xC;
+  EXPECT_EQ(stack, expected_stack);
+
+  // Once C and B have returned, only the return address of A is patched.
+  return_address_manager.ProcessUretprobes(kTid);
+  return_address_manager.ProcessUretprobes(kTid);
+  stack.assign(0x200 / sizeof(uint64_t), 0);
+  return_address_manager.PatchSample(kTid, 0x0F00, stack.data(), stack.size() * sizeof(uint64_t));
+  expected_stack.assign(stack.size(), 0);
+  expected_stack[0x100 / sizeof(uint64_t)] = 0xA;
+  EXPECT_EQ(stack, expected_stack);
+}
+
 //==============================================================================
 // Tests for frame pointer based callchains start here:
-//==============================================================================
 namespace {
 
 const std::string maps_string =
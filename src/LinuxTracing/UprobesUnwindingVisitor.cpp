@@ -4,6 +4,7 @@
 
 #include "UprobesUnwindingVisitor.h"
 
+#include <absl/strings/str_format.h>
 #include <asm/perf_regs.h>
 #include <sys/mman.h>
 #include <unwindstack/MapInfo.h>
@@ -17,6 +18,7 @@
 #include "LeafFunctionCallManager.h"
 #include "ObjectUtils/LinuxMap.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
 #include "OrbitBase/Result.h"
 #include "capture.pb.h"
 #include "module.pb.h"
@@ -27,6 +29,7 @@ using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::FullAddressInfo;
 using orbit_grpc_protos::FullCallstackSample;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::WarningEvent;
 
 static void SendFullAddressInfoToListener(TracerListener* listener,
                                           const unwindstack::FrameData& libunwindstack_frame) {
@@ -60,16 +63,73 @@ static void SendUprobesFullAddressInfoToListener(
   listener->OnAddressInfo(std::move(address_info));
 }
 
+LibunwindstackMaps* UprobesUnwindingVisitor::GetMapsOfProcess(pid_t pid) const {
+  if (auto it = maps_by_pid_.find(pid); it != maps_by_pid_.end()) {
+    return it->second;
+  }
+  return current_maps_;
+}
+
 void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
   CHECK(listener_ != nullptr);
-  CHECK(current_maps_ != nullptr);
+  LibunwindstackMaps* maps = GetMapsOfProcess(event->GetPid());
+  CHECK(maps != nullptr);
 
   return_address_manager_->PatchSample(event->GetTid(), event->GetRegisters()[PERF_REG_X86_SP],
                                        event->GetStackData(), event->GetStackSize());
 
+  if (stack_unwinding_worker_pool_ != nullptr) {
+    // No other visitor needs the stack dump, so we can move it to the job instead of copying it.
+    StackUnwindingJob job;
+    job.pid = event->GetPid();
+    job.tid = event->GetTid();
+    job.timestamp_ns = event->GetTimestamp();
+    job.maps = maps->Get();
+    job.registers = event->GetRegisters();
+    job.stack_data = std::move(event->ring_buffer_record.stack.data);
+    job.stack_size = event->GetStackSize();
+    stack_unwinding_worker_pool_->SubmitJob(std::move(job));
+
+    ForwardCompletedStackSamples();
+    return;
+  }
+
   LibunwindstackResult libunwindstack_result =
-      unwinder_->Unwind(event->GetPid(), current_maps_->Get(), event->GetRegisters(),
-                        event->GetStackData(), event->GetStackSize());
+      unwinder_->Unwind(event->GetPid(), maps->Get(), event->GetRegisters(), event->GetStackData(),
+                        event->GetStackSize());
+  OnStackSampleUnwound(event->GetPid(), event->GetTid(), event->GetTimestamp(),
+                       event->GetStackSize(), libunwindstack_result);
+}
+
+void UprobesUnwindingVisitor::ForwardCompletedStackSamples() {
+  if (stack_unwinding_worker_pool_ == nullptr) {
+    return;
+  }
+  for (const UnwoundStackSample& unwound_sample :
+       stack_unwinding_worker_pool_->TakeCompletedResultsInOrder()) {
+    OnStackSampleUnwound(unwound_sample.pid, unwound_sample.tid, unwound_sample.timestamp_ns,
+                         unwound_sample.stack_size, unwound_sample.libunwindstack_result);
+  }
+}
+
+void UprobesUnwindingVisitor::WaitForAndForwardAllStackSamples() {
+  if (stack_unwinding_worker_pool_ == nullptr) {
+    return;
+  }
+  for (const UnwoundStackSample& unwound_sample :
+       stack_unwinding_worker_pool_->WaitForAllAndTakeResults()) {
+    OnStackSampleUnwound(unwound_sample.pid, unwound_sample.tid, unwound_sample.timestamp_ns,
+                         unwound_sample.stack_size, unwound_sample.libunwindstack_result);
+  }
+}
+
+void UprobesUnwindingVisitor::OnStackSampleUnwound(
+    pid_t pid, pid_t tid, uint64_t timestamp_ns, uint64_t stack_size,
+    const LibunwindstackResult& libunwindstack_result) {
+  if (stack_sample_latencies_ns_ != nullptr) {
+    const uint64_t now_ns = orbit_base::CaptureTimestampNs();
+    stack_sample_latencies_ns_->push_back(now_ns > timestamp_ns ? now_ns - timestamp_ns : 0);
+  }
 
   if (libunwindstack_result.frames().empty()) {
     // Even with unwinding errors this is not expected because we should at least get the program
@@ -79,9 +139,9 @@ void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
   }
 
   FullCallstackSample sample;
-  sample.set_pid(event->GetPid());
-  sample.set_tid(event->GetTid());
-  sample.set_timestamp_ns(event->GetTimestamp());
+  sample.set_pid(pid);
+  sample.set_tid(tid);
+  sample.set_timestamp_ns(timestamp_ns);
 
   Callstack* callstack = sample.mutable_callstack();
 
@@ -122,6 +182,9 @@ void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
     callstack->set_type(Callstack::kDwarfUnwindingError);
     SendFullAddressInfoToListener(listener_, libunwindstack_result.frames().front());
     callstack->add_pcs(libunwindstack_result.frames().front().pc);
+    if (stack_dump_size_controller_ != nullptr) {
+      stack_dump_size_controller_->OnStackSampleUnwound(tid, stack_size, std::nullopt);
+    }
 
   } else {
     callstack->set_type(Callstack::kComplete);
@@ -130,6 +193,12 @@ void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
       SendFullAddressInfoToListener(listener_, libunwindstack_frame);
       callstack->add_pcs(libunwindstack_frame.pc);
     }
+    const uint64_t innermost_sp = libunwindstack_result.frames().front().sp;
+    const uint64_t outermost_sp = libunwindstack_result.frames().back().sp;
+    if (stack_dump_size_controller_ != nullptr && outermost_sp >= innermost_sp) {
+      stack_dump_size_controller_->OnStackSampleUnwound(tid, stack_size,
+                                                        outermost_sp - innermost_sp);
+    }
   }
 
   CHECK(!callstack->pcs().empty());
@@ -138,14 +207,8 @@ void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
 
 void UprobesUnwindingVisitor::Visit(CallchainSamplePerfEvent* event) {
   CHECK(listener_ != nullptr);
-  CHECK(current_maps_ != nullptr);
-
-  // The top of a callchain is always inside the kernel code and we don't expect samples to be only
-  // inside the kernel. Do nothing in case this happens anyway for some reason.
-  if (event->GetCallchainSize() <= 1) {
-    ERROR("Callchain has only %lu frames", event->GetCallchainSize());
-    return;
-  }
+  LibunwindstackMaps* maps = GetMapsOfProcess(event->GetPid());
+  CHECK(maps != nullptr);
 
   FullCallstackSample sample;
   sample.set_pid(event->GetPid());
@@ -154,6 +217,22 @@ void UprobesUnwindingVisitor::Visit(CallchainSamplePerfEvent* event) {
 
   Callstack* callstack = sample.mutable_callstack();
 
+  // The top of a callchain is always inside the kernel code and, without the kernel frames, we
+  // don't expect samples to be only inside the kernel. Do nothing in case this happens anyway for
+  // some reason.
+  if (event->GetCallchainSize() <= 1) {
+    if (event->GetKernelCallchain().empty()) {
+      ERROR("Callchain has only %lu frames", event->GetCallchainSize());
+      return;
+    }
+    // With the kernel frames, the samples of threads that only run kernel code at the time, e.g.,
+    // while exiting, have no user-space frames.
+    callstack->set_type(Callstack::kComplete);
+    AddKernelFrames(*event, callstack);
+    SendOrKeepCallchainSample(*event, std::move(sample));
+    return;
+  }
+
   // Callstacks with only two frames (the first is in the kernel, the second is the sampled address)
   // are unwinding errors.
   // Note that this doesn't exclude samples inside the main function of any thread as the main
@@ -165,12 +244,12 @@ void UprobesUnwindingVisitor::Visit(CallchainSamplePerfEvent* event) {
     }
     callstack->set_type(Callstack::kFramePointerUnwindingError);
     callstack->add_pcs(event->GetCallchain()[1]);
-    listener_->OnCallstackSample(std::move(sample));
+    SendOrKeepCallchainSample(*event, std::move(sample));
     return;
   }
 
   uint64_t top_ip = event->GetCallchain()[1];
-  unwindstack::MapInfo* top_ip_map_info = current_maps_->Find(top_ip);
+  unwindstack::MapInfo* top_ip_map_info = maps->Find(top_ip);
 
   // Some samples can actually fall inside u(ret)probes code. Set their type accordingly, as we
   // don't want to show the unnamed uprobes module in the samples.
@@ -180,7 +259,7 @@ void UprobesUnwindingVisitor::Visit(CallchainSamplePerfEvent* event) {
     }
     callstack->set_type(Callstack::kInUprobes);
     callstack->add_pcs(top_ip);
-    listener_->OnCallstackSample(std::move(sample));
+    SendOrKeepCallchainSample(*event, std::move(sample));
     return;
   }
 
@@ -195,36 +274,52 @@ void UprobesUnwindingVisitor::Visit(CallchainSamplePerfEvent* event) {
   //  prevents us from testing the current implementation, which will have "almost" correct
   //  callstack.
   for (uint64_t frame_index = 1; frame_index < event->GetCallchainSize(); ++frame_index) {
-    unwindstack::MapInfo* map_info = current_maps_->Find(event->GetCallchain()[frame_index]);
+    unwindstack::MapInfo* map_info = maps->Find(event->GetCallchain()[frame_index]);
     if (map_info == nullptr || (map_info->flags & PROT_EXEC) == 0) {
       break;
     }
   }
 
   Callstack::CallstackType leaf_function_patching_status =
-      leaf_function_call_manager_->PatchCallerOfLeafFunction(event, current_maps_, unwinder_);
+      leaf_function_call_manager_->PatchCallerOfLeafFunction(event, maps, unwinder_);
   if (leaf_function_patching_status != Callstack::kComplete) {
     if (unwind_error_counter_ != nullptr) {
       ++(*unwind_error_counter_);
     }
     callstack->set_type(leaf_function_patching_status);
     callstack->add_pcs(top_ip);
-    listener_->OnCallstackSample(std::move(sample));
+    SendOrKeepCallchainSample(*event, std::move(sample));
+    return;
+  }
+
+  // Frames in modules without frame pointers are the only ones for which we need DWARF-based
+  // unwinding, and only on the stack slice that comes with the callchain.
+  Callstack::CallstackType frame_pointer_patching_status =
+      leaf_function_call_manager_->PatchCallersOfFramesInModulesWithoutFramePointers(
+          event, maps, unwinder_);
+  if (frame_pointer_patching_status != Callstack::kComplete) {
+    if (unwind_error_counter_ != nullptr) {
+      ++(*unwind_error_counter_);
+    }
+    callstack->set_type(frame_pointer_patching_status);
+    callstack->add_pcs(top_ip);
+    SendOrKeepCallchainSample(*event, std::move(sample));
     return;
   }
 
   if (!return_address_manager_->PatchCallchain(event->GetTid(), event->GetCallchain(),
-                                               event->GetCallchainSize(), current_maps_)) {
+                                               event->GetCallchainSize(), maps)) {
     if (unwind_error_counter_ != nullptr) {
       ++(*unwind_error_counter_);
     }
     callstack->set_type(Callstack::kUprobesPatchingFailed);
     callstack->add_pcs(top_ip);
-    listener_->OnCallstackSample(std::move(sample));
+    SendOrKeepCallchainSample(*event, std::move(sample));
     return;
   }
 
   callstack->set_type(Callstack::kComplete);
+  AddKernelFrames(*event, callstack);
   // Skip the first frame as the top of a perf_event_open callchain is always
   // inside kernel code.
   callstack->add_pcs(event->GetCallchain()[1]);
@@ -239,12 +334,67 @@ void UprobesUnwindingVisitor::Visit(CallchainSamplePerfEvent* event) {
   }
 
   CHECK(!callstack->pcs().empty());
+  SendOrKeepCallchainSample(*event, std::move(sample));
+}
+
+void UprobesUnwindingVisitor::AddKernelFrames(const CallchainSamplePerfEvent& event,
+                                              Callstack* callstack) {
+  const std::vector<uint64_t>& kernel_callchain = event.GetKernelCallchain();
+  for (size_t frame_index = 0; frame_index < kernel_callchain.size(); ++frame_index) {
+    // Skip the other context markers, e.g., PERF_CONTEXT_GUEST_KERNEL.
+    if (kernel_callchain[frame_index] >= PERF_CONTEXT_MAX) continue;
+    // As for the user-space frames, all addresses but the innermost are return addresses.
+    const uint64_t pc =
+        frame_index == 0 ? kernel_callchain[frame_index] : kernel_callchain[frame_index] - 1;
+    callstack->add_pcs(pc);
+
+    if (kernel_symbols_ == nullptr || !kernel_addresses_with_sent_address_info_.insert(pc).second) {
+      continue;
+    }
+    const KernelSymbols::Symbol* symbol = kernel_symbols_->FindSymbol(pc);
+    if (symbol == nullptr) continue;
+    FullAddressInfo address_info;
+    address_info.set_absolute_address(pc);
+    address_info.set_function_name(symbol->name);
+    address_info.set_offset_in_function(pc - symbol->address);
+    address_info.set_module_name(symbol->module_name);
+    listener_->OnAddressInfo(std::move(address_info));
+  }
+}
+
+void UprobesUnwindingVisitor::SendOrKeepCallchainSample(const CallchainSamplePerfEvent& event,
+                                                        FullCallstackSample sample) {
+  sample.set_memory_event_type(event.GetMemoryEventType());
+  sample.set_memory_event_count(event.GetMemoryEventCount());
+  if (!event.IsOffCpu()) {
+    listener_->OnCallstackSample(std::move(sample));
+    return;
+  }
+  // The time off-CPU is only known when the thread is switched back in.
+  off_cpu_callstack_samples_by_tid_.insert_or_assign(event.GetTid(), std::move(sample));
+}
+
+void UprobesUnwindingVisitor::Visit(SchedSwitchPerfEvent* event) {
+  auto it = off_cpu_callstack_samples_by_tid_.find(event->GetNextTid());
+  if (it == off_cpu_callstack_samples_by_tid_.end()) {
+    return;
+  }
+  FullCallstackSample sample = std::move(it->second);
+  off_cpu_callstack_samples_by_tid_.erase(it);
+  if (event->GetTimestamp() <= sample.timestamp_ns()) {
+    return;
+  }
+  sample.set_off_cpu_duration_ns(event->GetTimestamp() - sample.timestamp_ns());
   listener_->OnCallstackSample(std::move(sample));
 }
 
 void UprobesUnwindingVisitor::Visit(UprobesPerfEvent* event) {
   CHECK(listener_ != nullptr);
 
+  if (max_uprobes_per_second_ != 0) {
+    CountUprobesAgainstBudget(*event);
+  }
+
   // We are seeing that, on thread migration, uprobe events can sometimes be
   // duplicated: the duplicate uprobe event will have the same stack pointer and
   // instruction pointer as the previous uprobe, but different cpu. In that
@@ -277,8 +427,11 @@ void UprobesUnwindingVisitor::Visit(UprobesPerfEvent* event) {
   }
   uprobe_sps_ips_cpus.emplace_back(uprobe_sp, uprobe_ip, uprobe_cpu);
 
-  function_call_manager_->ProcessUprobes(event->GetTid(), event->GetFunction()->function_id(),
-                                         event->GetTimestamp(), event->ring_buffer_record.regs);
+  const Function* function = event->GetFunction();
+  function_call_manager_->ProcessUprobes(event->GetTid(), function->function_id(),
+                                         event->GetTimestamp(), event->ring_buffer_record.regs,
+                                         function->recorded_argument_indices(),
+                                         function->record_return_value());
 
   return_address_manager_->ProcessUprobes(event->GetTid(), event->GetSp(),
                                           event->GetReturnAddress());
@@ -290,6 +443,17 @@ void UprobesUnwindingVisitor::Visit(UretprobesPerfEvent* event) {
   // Duplicate uprobe detection.
   std::vector<std::tuple<uint64_t, uint64_t, uint32_t>>& uprobe_sps_ips_cpus =
       uprobe_sps_ips_cpus_per_thread_[event->GetTid()];
+
+  // The uretprobes of the calls of functions that were disabled while the calls were in progress
+  // are lost. Drop those calls, so that this uretprobe is matched with the right uprobe.
+  if (!disabled_function_ids_.empty()) {
+    size_t discarded_count = function_call_manager_->DiscardOpenUprobesOfFunctions(
+        event->GetTid(), disabled_function_ids_, event->GetFunction()->function_id());
+    for (size_t i = 0; i < discarded_count; ++i) {
+      return_address_manager_->ProcessUretprobes(event->GetTid());
+    }
+  }
+
   if (!uprobe_sps_ips_cpus.empty()) {
     uprobe_sps_ips_cpus.pop_back();
   }
@@ -303,12 +467,53 @@ void UprobesUnwindingVisitor::Visit(UretprobesPerfEvent* event) {
   return_address_manager_->ProcessUretprobes(event->GetTid());
 }
 
+void UprobesUnwindingVisitor::CountUprobesAgainstBudget(const UprobesPerfEvent& event) {
+  const Function* function = event.GetFunction();
+  CHECK(function != nullptr);
+  if (over_budget_function_ids_.contains(function->function_id())) {
+    return;
+  }
+
+  UprobesBudgetWindow& window = uprobes_budget_windows_by_function_id_[function->function_id()];
+  constexpr uint64_t kNsPerSecond = 1'000'000'000;
+  if (window.uprobes_count == 0 ||
+      event.GetTimestamp() - window.begin_timestamp_ns >= kNsPerSecond) {
+    window.begin_timestamp_ns = event.GetTimestamp();
+    window.uprobes_count = 0;
+  }
+  ++window.uprobes_count;
+  if (window.uprobes_count <= max_uprobes_per_second_) {
+    return;
+  }
+
+  over_budget_function_ids_.insert(function->function_id());
+  uprobes_budget_windows_by_function_id_.erase(function->function_id());
+  bool disabled = disable_function_ != nullptr && disable_function_(*function);
+  if (disabled) {
+    disabled_function_ids_.insert(function->function_id());
+  }
+
+  WarningEvent warning_event;
+  warning_event.set_timestamp_ns(event.GetTimestamp());
+  warning_event.set_message(absl::StrFormat(
+      "Function at offset %#x of \"%s\" was called more than %u times in one second%s.",
+      function->file_offset(), function->file_path(), max_uprobes_per_second_,
+      disabled ? ", it is no longer instrumented for the rest of the capture" : ""));
+  listener_->OnWarningEvent(std::move(warning_event));
+}
+
 void UprobesUnwindingVisitor::Visit(MmapPerfEvent* event) {
   CHECK(listener_ != nullptr);
-  CHECK(current_maps_ != nullptr);
+  LibunwindstackMaps* maps = GetMapsOfProcess(event->pid());
+  CHECK(maps != nullptr);
+
+  // The StackUnwindingWorkerPool's workers read the maps concurrently, so all samples that
+  // precede this mmap need to be unwound before the maps can be updated.
+  WaitForAndForwardAllStackSamples();
+  leaf_function_call_manager_->InvalidateLeafFrames(event->pid());
 
   // Obviously the uprobes map cannot be successfully processed by orbit_object_utils::CreateModule,
-  // but it's important that current_maps_ contain it.
+  // but it's important that the maps contain it.
   // For example, UprobesReturnAddressManager::PatchCallchain needs it to check whether a program
   // counter is inside the uprobes map, and UprobesUnwindingVisitor::Visit(StackSamplePerfEvent*)
   // needs it to throw away incorrectly-unwound samples.
@@ -317,8 +522,8 @@ void UprobesUnwindingVisitor::Visit(MmapPerfEvent* event) {
   // if unwindstack::BufferMaps was built by passing the full content of /proc/<pid>/maps to its
   // constructor.
   if (event->filename() == "[uprobes]") {
-    current_maps_->AddAndSort(event->address(), event->address() + event->length(), 0, PROT_EXEC,
-                              event->filename(), INT64_MAX);
+    maps->AddAndSort(event->address(), event->address() + event->length(), 0, PROT_EXEC,
+                     event->filename(), INT64_MAX, /*build_id=*/"");
     return;
   }
 
@@ -333,9 +538,9 @@ void UprobesUnwindingVisitor::Visit(MmapPerfEvent* event) {
   auto& module_info = module_info_or_error.value();
 
   // For flags we assume PROT_READ and PROT_EXEC, MMAP event does not return flags.
-  current_maps_->AddAndSort(module_info.address_start(), module_info.address_end(),
-                            event->page_offset(), PROT_READ | PROT_EXEC, event->filename(),
-                            module_info.load_bias());
+  maps->AddAndSort(module_info.address_start(), module_info.address_end(), event->page_offset(),
+                   PROT_READ | PROT_EXEC, event->filename(), module_info.load_bias(),
+                   module_info.build_id());
 
   orbit_grpc_protos::ModuleUpdateEvent module_update_event;
   module_update_event.set_pid(event->pid());
@@ -6,23 +6,30 @@
 #define LINUX_TRACING_UPROBES_UNWINDING_VISITOR_H_
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
 #include <sys/types.h>
 #include <unwindstack/Maps.h>
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "AdaptiveStackDumpSizeController.h"
+#include "Function.h"
+#include "KernelSymbols.h"
 #include "LeafFunctionCallManager.h"
 #include "LibunwindstackMaps.h"
 #include "LibunwindstackUnwinder.h"
 #include "LinuxTracing/TracerListener.h"
 #include "PerfEvent.h"
 #include "PerfEventVisitor.h"
+#include "capture.pb.h"
+#include "StackUnwindingWorkerPool.h"
 #include "UprobesFunctionCallManager.h"
 #include "UprobesReturnAddressManager.h"
 
@@ -79,26 +86,106 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
     samples_in_uretprobes_counter_ = samples_in_uretprobes_counter;
   }
 
+  // When a StackUnwindingWorkerPool is set, stack samples are unwound asynchronously by the
+  // pool's workers, and the resulting callstacks are forwarded to the listener, in order, from
+  // subsequent calls to Visit, ForwardCompletedStackSamples, or WaitForAndForwardAllStackSamples.
+  void SetStackUnwindingWorkerPool(StackUnwindingWorkerPool* stack_unwinding_worker_pool) {
+    stack_unwinding_worker_pool_ = stack_unwinding_worker_pool;
+  }
+
+  // When an AdaptiveStackDumpSizeController is set, it's told how much of the stack each unwound
+  // stack sample used.
+  void SetStackDumpSizeController(AdaptiveStackDumpSizeController* stack_dump_size_controller) {
+    stack_dump_size_controller_ = stack_dump_size_controller;
+  }
+
+  // When set, the time from when each stack sample was taken to when its callstack is forwarded to
+  // the listener is appended to stack_sample_latencies_ns.
+  void SetStackSampleLatenciesNs(std::vector<uint64_t>* stack_sample_latencies_ns) {
+    stack_sample_latencies_ns_ = stack_sample_latencies_ns;
+  }
+
+  // When max_uprobes_per_second is not zero, a function whose uprobes are hit more than
+  // max_uprobes_per_second times within one second is passed to disable_function, once, and a
+  // WarningEvent is sent. disable_function returns whether the function is no longer instrumented,
+  // in which case its open uprobes whose uretprobes will never come are discarded.
+  void SetUprobesBudget(uint64_t max_uprobes_per_second,
+                        std::function<bool(const Function&)> disable_function) {
+    max_uprobes_per_second_ = max_uprobes_per_second;
+    disable_function_ = std::move(disable_function);
+  }
+
+  // When set, the kernel frames of the callchain samples are symbolized with these symbols, whose
+  // FullAddressInfos are sent once per address.
+  void SetKernelSymbols(const KernelSymbols* kernel_symbols) { kernel_symbols_ = kernel_symbols; }
+
+  // When more than one process is captured, the events of the process with this pid are processed
+  // with these maps. The events of the processes without their own maps use initial_maps.
+  void SetMapsOfProcess(pid_t pid, LibunwindstackMaps* maps) {
+    CHECK(maps != nullptr);
+    maps_by_pid_.insert_or_assign(pid, maps);
+  }
+
+  // Forwards the callstacks of the stack samples that the StackUnwindingWorkerPool has finished
+  // unwinding so far, without blocking.
+  void ForwardCompletedStackSamples();
+  // Blocks until all stack samples submitted to the StackUnwindingWorkerPool are unwound, and
+  // forwards their callstacks.
+  void WaitForAndForwardAllStackSamples();
+
   void Visit(StackSamplePerfEvent* event) override;
   void Visit(CallchainSamplePerfEvent* event) override;
   void Visit(UprobesPerfEvent* event) override;
   void Visit(UretprobesPerfEvent* event) override;
   void Visit(MmapPerfEvent* event) override;
+  // Completes the pending off-CPU callstack of the thread being switched in, if any.
+  void Visit(SchedSwitchPerfEvent* event) override;
 
  private:
+  [[nodiscard]] LibunwindstackMaps* GetMapsOfProcess(pid_t pid) const;
+  void OnStackSampleUnwound(pid_t pid, pid_t tid, uint64_t timestamp_ns, uint64_t stack_size,
+                            const LibunwindstackResult& libunwindstack_result);
+  void CountUprobesAgainstBudget(const UprobesPerfEvent& event);
+  // Adds the kernel frames of the callchain, if any, to the callstack, from the innermost.
+  void AddKernelFrames(const CallchainSamplePerfEvent& event,
+                       orbit_grpc_protos::Callstack* callstack);
+  // Callstacks recorded when the thread blocked are only sent on the next switch in of the thread.
+  void SendOrKeepCallchainSample(const CallchainSamplePerfEvent& event,
+                                 orbit_grpc_protos::FullCallstackSample sample);
+
   TracerListener* listener_;
 
   UprobesFunctionCallManager* function_call_manager_;
   UprobesReturnAddressManager* return_address_manager_;
   LibunwindstackMaps* current_maps_;
+  absl::flat_hash_map<pid_t, LibunwindstackMaps*> maps_by_pid_;
   LibunwindstackUnwinder* unwinder_;
   LeafFunctionCallManager* leaf_function_call_manager_;
 
+  StackUnwindingWorkerPool* stack_unwinding_worker_pool_ = nullptr;
+  AdaptiveStackDumpSizeController* stack_dump_size_controller_ = nullptr;
+  std::vector<uint64_t>* stack_sample_latencies_ns_ = nullptr;
+  const KernelSymbols* kernel_symbols_ = nullptr;
+  absl::flat_hash_set<uint64_t> kernel_addresses_with_sent_address_info_;
+
   std::atomic<uint64_t>* unwind_error_counter_ = nullptr;
   std::atomic<uint64_t>* samples_in_uretprobes_counter_ = nullptr;
 
   absl::flat_hash_map<pid_t, std::vector<std::tuple<uint64_t, uint64_t, uint32_t>>>
       uprobe_sps_ips_cpus_per_thread_{};
+
+  absl::flat_hash_map<pid_t, orbit_grpc_protos::FullCallstackSample>
+      off_cpu_callstack_samples_by_tid_;
+
+  uint64_t max_uprobes_per_second_ = 0;
+  std::function<bool(const Function&)> disable_function_;
+  struct UprobesBudgetWindow {
+    uint64_t begin_timestamp_ns = 0;
+    uint64_t uprobes_count = 0;
+  };
+  absl::flat_hash_map<uint64_t, UprobesBudgetWindow> uprobes_budget_windows_by_function_id_;
+  absl::flat_hash_set<uint64_t> over_budget_function_ids_;
+  absl::flat_hash_set<uint64_t> disabled_function_ids_;
 };
 
 }  // namespace orbit_linux_tracing
@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 #include <sys/mman.h>
 
+#include "KernelSymbols.h"
 #include "LibunwindstackMaps.h"
 #include "LibunwindstackUnwinder.h"
 #include "UprobesUnwindingVisitor.h"
@@ -15,8 +16,10 @@ using ::testing::AllOf;
 using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
 using ::testing::Ge;
+using ::testing::HasSubstr;
 using ::testing::Invoke;
 using ::testing::Lt;
+using ::testing::Mock;
 using ::testing::Property;
 using ::testing::Return;
 using ::testing::SaveArg;
@@ -33,7 +36,10 @@ class MockLibunwindstackMaps : public LibunwindstackMaps {
   MOCK_METHOD(unwindstack::MapInfo*, Find, (uint64_t), (override));
   MOCK_METHOD(unwindstack::Maps*, Get, (), (override));
   MOCK_METHOD(void, AddAndSort,
-              (uint64_t, uint64_t, uint64_t, uint64_t, const std::string&, uint64_t), (override));
+              (uint64_t, uint64_t, uint64_t, uint64_t, const std::string&, uint64_t,
+               const std::string&),
+              (override));
+  MOCK_METHOD(void, SetBuildIdOfFile, (const std::string&, const std::string&), (override));
 };
 
 class MockLibunwindstackUnwinder : public LibunwindstackUnwinder {
@@ -63,6 +69,15 @@ class MockTracerListener : public TracerListener {
   MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
   MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
               (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+  MOCK_METHOD(void, OnSamplingPeriodChangedEvent, (orbit_grpc_protos::SamplingPeriodChangedEvent),
+              (override));
+  MOCK_METHOD(void, OnPmuCountersSample, (orbit_grpc_protos::PmuCountersSample), (override));
+  MOCK_METHOD(void, OnWarningEvent, (orbit_grpc_protos::WarningEvent), (override));
+  MOCK_METHOD(void, OnServiceHealthEvent, (orbit_grpc_protos::ServiceHealthEvent), (override));
+  MOCK_METHOD(void, OnPipelineLatencyProbe, (orbit_grpc_protos::PipelineLatencyProbe),
+              (override));
+  MOCK_METHOD(void, OnCaptureStatisticsSummary, (orbit_grpc_protos::CaptureStatisticsSummary),
+              (override));
 };
 
 class MockUprobesReturnAddressManager : public UprobesReturnAddressManager {
@@ -84,6 +99,27 @@ class MockLeafFunctionCallManager : public LeafFunctionCallManager {
 
 class MockUprobesFunctionCallManager : public UprobesFunctionCallManager {};
 
+UprobesPerfEvent MakeUprobesPerfEvent(pid_t tid, uint64_t timestamp_ns, uint64_t sp,
+                                      const Function* function) {
+  UprobesPerfEvent event{};
+  event.ring_buffer_record.sample_id.pid = tid;
+  event.ring_buffer_record.sample_id.tid = tid;
+  event.ring_buffer_record.sample_id.time = timestamp_ns;
+  event.ring_buffer_record.regs.sp = sp;
+  event.SetFunction(function);
+  return event;
+}
+
+UretprobesPerfEvent MakeUretprobesPerfEvent(pid_t tid, uint64_t timestamp_ns,
+                                            const Function* function) {
+  UretprobesPerfEvent event{};
+  event.ring_buffer_record.sample_id.pid = tid;
+  event.ring_buffer_record.sample_id.tid = tid;
+  event.ring_buffer_record.sample_id.time = timestamp_ns;
+  event.SetFunction(function);
+  return event;
+}
+
 class UprobesUnwindingVisitorTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -241,6 +277,87 @@ TEST_F(UprobesUnwindingVisitorTest,
   EXPECT_EQ(discarded_samples_in_uretprobes_counter, 0);
 }
 
+TEST_F(UprobesUnwindingVisitorTest, VisitStackSampleUsesTheMapsOfItsProcess) {
+  constexpr uint32_t kPid = 10;
+  constexpr uint32_t kOtherPid = 20;
+  constexpr uint64_t kStackSize = 13;
+  MockLibunwindstackMaps other_maps;
+  visitor_->SetMapsOfProcess(kOtherPid, &other_maps);
+
+  StackSamplePerfEvent event{kStackSize};
+  event.ring_buffer_record.sample_id.pid = kOtherPid;
+  event.ring_buffer_record.sample_id.tid = 21;
+  event.ring_buffer_record.sample_id.time = 15;
+
+  EXPECT_CALL(return_address_manager_, PatchSample).Times(2);
+  EXPECT_CALL(maps_, Get).Times(0);
+  EXPECT_CALL(other_maps, Get).Times(1).WillOnce(Return(nullptr));
+  EXPECT_CALL(unwinder_, Unwind(kOtherPid, nullptr, _, _, kStackSize, _, _))
+      .Times(1)
+      .WillOnce(Return(LibunwindstackResult{{kFrame1}}));
+  EXPECT_CALL(listener_, OnAddressInfo).Times(2);
+  EXPECT_CALL(listener_, OnCallstackSample).Times(2);
+
+  visitor_->Visit(&event);
+  testing::Mock::VerifyAndClearExpectations(&maps_);
+  testing::Mock::VerifyAndClearExpectations(&other_maps);
+
+  // The processes without their own maps use the initial maps.
+  event.ring_buffer_record.sample_id.pid = kPid;
+  event.ring_buffer_record.sample_id.tid = 11;
+  EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
+  EXPECT_CALL(other_maps, Get).Times(0);
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, kStackSize, _, _))
+      .Times(1)
+      .WillOnce(Return(LibunwindstackResult{{kFrame1}}));
+
+  visitor_->Visit(&event);
+}
+
+TEST_F(UprobesUnwindingVisitorTest,
+       VisitStackSamplesWithStackUnwindingWorkerPoolSendsCallstacksInOrder) {
+  constexpr uint32_t kPid = 10;
+  constexpr uint64_t kStackSize = 13;
+  constexpr int kSampleCount = 50;
+
+  auto worker_unwinder = std::make_unique<MockLibunwindstackUnwinder>();
+  EXPECT_CALL(*worker_unwinder, Unwind(kPid, nullptr, _, _, kStackSize, _, _))
+      .Times(kSampleCount)
+      .WillRepeatedly(Return(LibunwindstackResult{{kFrame1, kFrame2, kFrame3}}));
+  std::vector<std::unique_ptr<LibunwindstackUnwinder>> worker_unwinders;
+  worker_unwinders.emplace_back(std::move(worker_unwinder));
+  StackUnwindingWorkerPool pool{std::move(worker_unwinders)};
+  visitor_->SetStackUnwindingWorkerPool(&pool);
+
+  EXPECT_CALL(return_address_manager_, PatchSample).Times(kSampleCount);
+  EXPECT_CALL(maps_, Get).Times(kSampleCount).WillRepeatedly(Return(nullptr));
+  EXPECT_CALL(unwinder_, Unwind).Times(0);
+  EXPECT_CALL(listener_, OnAddressInfo).Times(3 * kSampleCount);
+
+  std::vector<uint64_t> actual_timestamps;
+  EXPECT_CALL(listener_, OnCallstackSample)
+      .Times(kSampleCount)
+      .WillRepeatedly(Invoke([&actual_timestamps](orbit_grpc_protos::FullCallstackSample sample) {
+        EXPECT_EQ(sample.callstack().type(), orbit_grpc_protos::Callstack::kComplete);
+        EXPECT_THAT(sample.callstack().pcs(),
+                    ElementsAre(kTargetAddress1, kTargetAddress2, kTargetAddress3));
+        actual_timestamps.push_back(sample.timestamp_ns());
+      }));
+
+  std::vector<uint64_t> expected_timestamps;
+  for (int i = 0; i < kSampleCount; ++i) {
+    StackSamplePerfEvent event{kStackSize};
+    event.ring_buffer_record.sample_id.pid = kPid;
+    event.ring_buffer_record.sample_id.tid = 11;
+    event.ring_buffer_record.sample_id.time = 100 + i;
+    expected_timestamps.push_back(100 + i);
+    visitor_->Visit(&event);
+  }
+  visitor_->WaitForAndForwardAllStackSamples();
+
+  EXPECT_EQ(actual_timestamps, expected_timestamps);
+}
+
 TEST_F(UprobesUnwindingVisitorTest, VisitEmptyStackSampleWithoutUprobesDoesNothing) {
   constexpr uint32_t kPid = 10;
   constexpr uint64_t kStackSize = 13;
@@ -509,6 +626,69 @@ TEST_F(UprobesUnwindingVisitorTest, VisitValidCallchainSampleWithoutUprobesSends
   EXPECT_EQ(discarded_samples_in_uretprobes_counter, 0);
 }
 
+TEST_F(UprobesUnwindingVisitorTest, OffCpuCallchainSampleIsSentWhenThreadIsSwitchedIn) {
+  constexpr uint32_t kPid = 10;
+  constexpr uint32_t kTid = 11;
+  constexpr uint64_t kStackSize = 13;
+  constexpr uint64_t kSwitchOutTimestampNs = 15;
+  constexpr uint64_t kSwitchInTimestampNs = 115;
+
+  std::vector<uint64_t> callchain;
+  callchain.push_back(kKernelAddress);
+  callchain.push_back(kTargetAddress1);
+  callchain.push_back(kTargetAddress2 + 1);
+  callchain.push_back(kTargetAddress3 + 1);
+
+  CallchainSamplePerfEvent event{callchain.size(), kStackSize};
+  event.ring_buffer_record.sample_id = perf_event_sample_id_tid_time_streamid_cpu{
+      .pid = kPid,
+      .tid = kTid,
+      .time = kSwitchOutTimestampNs,
+      .stream_id = 12,
+      .cpu = 0,
+      .res = 0,
+  };
+  event.ips = callchain;
+  event.SetIsOffCpu(true);
+
+  EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
+  EXPECT_CALL(return_address_manager_, PatchCallchain).Times(1).WillOnce(Return(true));
+  EXPECT_CALL(leaf_function_call_manager_, PatchCallerOfLeafFunction)
+      .Times(1)
+      .WillOnce(Return(Callstack::kComplete));
+
+  // Nothing is sent until the thread is switched back in.
+  EXPECT_CALL(listener_, OnCallstackSample).Times(0);
+  visitor_->Visit(&event);
+  Mock::VerifyAndClearExpectations(&listener_);
+
+  SchedSwitchPerfEvent other_thread_switch_in;
+  other_thread_switch_in.ring_buffer_record.sample_id.time = kSwitchOutTimestampNs + 10;
+  other_thread_switch_in.ring_buffer_record.data.next_pid = kTid + 1;
+  EXPECT_CALL(listener_, OnCallstackSample).Times(0);
+  visitor_->Visit(&other_thread_switch_in);
+  Mock::VerifyAndClearExpectations(&listener_);
+
+  SchedSwitchPerfEvent switch_in;
+  switch_in.ring_buffer_record.sample_id.time = kSwitchInTimestampNs;
+  switch_in.ring_buffer_record.data.next_pid = kTid;
+  orbit_grpc_protos::FullCallstackSample actual_callstack_sample;
+  EXPECT_CALL(listener_, OnCallstackSample).Times(1).WillOnce(SaveArg<0>(&actual_callstack_sample));
+  visitor_->Visit(&switch_in);
+  Mock::VerifyAndClearExpectations(&listener_);
+
+  EXPECT_EQ(actual_callstack_sample.tid(), kTid);
+  EXPECT_EQ(actual_callstack_sample.timestamp_ns(), kSwitchOutTimestampNs);
+  EXPECT_EQ(actual_callstack_sample.off_cpu_duration_ns(),
+            kSwitchInTimestampNs - kSwitchOutTimestampNs);
+  EXPECT_THAT(actual_callstack_sample.callstack().pcs(),
+              ElementsAre(kTargetAddress1, kTargetAddress2, kTargetAddress3));
+
+  // The callstack is only sent for the first switch in.
+  EXPECT_CALL(listener_, OnCallstackSample).Times(0);
+  visitor_->Visit(&switch_in);
+}
+
 TEST_F(UprobesUnwindingVisitorTest, VisitSingleFrameCallchainSampleDoesNothing) {
   constexpr uint32_t kPid = 10;
   constexpr uint64_t kStackSize = 13;
@@ -547,6 +727,116 @@ TEST_F(UprobesUnwindingVisitorTest, VisitSingleFrameCallchainSampleDoesNothing)
   EXPECT_EQ(discarded_samples_in_uretprobes_counter, 0);
 }
 
+TEST_F(UprobesUnwindingVisitorTest, VisitCallchainSampleWithKernelFramesSendsThemFirst) {
+  constexpr uint32_t kPid = 10;
+  constexpr uint64_t kStackSize = 13;
+  constexpr uint64_t kKernelFunctionAddress1 = 0xffffffff81002000;
+  constexpr uint64_t kKernelFunctionAddress2 = 0xffffffff81001000;
+
+  std::vector<uint64_t> callchain;
+  callchain.push_back(PERF_CONTEXT_KERNEL);
+  callchain.push_back(kKernelFunctionAddress1 + 0x10);
+  // Increment by one as the return address is the next address.
+  callchain.push_back(kKernelFunctionAddress2 + 0x20 + 1);
+  callchain.push_back(PERF_CONTEXT_USER);
+  callchain.push_back(kTargetAddress1);
+  callchain.push_back(kTargetAddress2 + 1);
+  callchain.push_back(kTargetAddress3 + 1);
+
+  CallchainSamplePerfEvent event{callchain.size(), kStackSize};
+  perf_event_sample_id_tid_time_streamid_cpu sample_id{
+      .pid = kPid,
+      .tid = 11,
+      .time = 15,
+      .stream_id = 12,
+      .cpu = 0,
+      .res = 0,
+  };
+  event.ring_buffer_record.sample_id = sample_id;
+  event.ips = callchain;
+  event.MoveKernelFramesOutOfCallchain();
+  EXPECT_THAT(event.ips,
+              ElementsAre(PERF_CONTEXT_USER, kTargetAddress1, kTargetAddress2 + 1,
+                          kTargetAddress3 + 1));
+  EXPECT_EQ(event.GetCallchainSize(), 4);
+
+  KernelSymbols kernel_symbols = KernelSymbols::Parse(
+      "ffffffff81001000 T do_syscall_64\n"
+      "ffffffff81002000 t __do_sys_futex\n");
+  visitor_->SetKernelSymbols(&kernel_symbols);
+
+  EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
+  EXPECT_CALL(return_address_manager_, PatchCallchain).Times(2).WillRepeatedly(Return(true));
+  EXPECT_CALL(leaf_function_call_manager_, PatchCallerOfLeafFunction)
+      .Times(2)
+      .WillRepeatedly(Return(Callstack::kComplete));
+
+  orbit_grpc_protos::FullCallstackSample actual_callstack_sample;
+  EXPECT_CALL(listener_, OnCallstackSample)
+      .Times(2)
+      .WillRepeatedly(SaveArg<0>(&actual_callstack_sample));
+  std::vector<orbit_grpc_protos::FullAddressInfo> actual_address_infos;
+  EXPECT_CALL(listener_, OnAddressInfo)
+      .Times(2)
+      .WillRepeatedly(Invoke([&actual_address_infos](orbit_grpc_protos::FullAddressInfo info) {
+        actual_address_infos.push_back(std::move(info));
+      }));
+
+  visitor_->Visit(&event);
+  // The FullAddressInfos of the kernel frames are only sent the first time.
+  visitor_->Visit(&event);
+
+  EXPECT_EQ(actual_callstack_sample.callstack().type(), Callstack::kComplete);
+  EXPECT_THAT(actual_callstack_sample.callstack().pcs(),
+              ElementsAre(kKernelFunctionAddress1 + 0x10, kKernelFunctionAddress2 + 0x20,
+                          kTargetAddress1, kTargetAddress2, kTargetAddress3));
+
+  ASSERT_EQ(actual_address_infos.size(), 2);
+  EXPECT_EQ(actual_address_infos[0].absolute_address(), kKernelFunctionAddress1 + 0x10);
+  EXPECT_EQ(actual_address_infos[0].function_name(), "__do_sys_futex");
+  EXPECT_EQ(actual_address_infos[0].offset_in_function(), 0x10);
+  EXPECT_EQ(actual_address_infos[0].module_name(), KernelSymbols::kKernelModuleName);
+  EXPECT_EQ(actual_address_infos[1].absolute_address(), kKernelFunctionAddress2 + 0x20);
+  EXPECT_EQ(actual_address_infos[1].function_name(), "do_syscall_64");
+  EXPECT_EQ(actual_address_infos[1].offset_in_function(), 0x20);
+}
+
+TEST_F(UprobesUnwindingVisitorTest, VisitCallchainSampleWithOnlyKernelFramesSendsThem) {
+  constexpr uint32_t kPid = 10;
+  constexpr uint64_t kStackSize = 13;
+  constexpr uint64_t kKernelFunctionAddress = 0xffffffff81001000;
+
+  std::vector<uint64_t> callchain;
+  callchain.push_back(PERF_CONTEXT_KERNEL);
+  callchain.push_back(kKernelFunctionAddress);
+
+  CallchainSamplePerfEvent event{callchain.size(), kStackSize};
+  perf_event_sample_id_tid_time_streamid_cpu sample_id{
+      .pid = kPid,
+      .tid = 11,
+      .time = 15,
+      .stream_id = 12,
+      .cpu = 0,
+      .res = 0,
+  };
+  event.ring_buffer_record.sample_id = sample_id;
+  event.ips = callchain;
+  event.MoveKernelFramesOutOfCallchain();
+  EXPECT_EQ(event.GetCallchainSize(), 0);
+
+  EXPECT_CALL(return_address_manager_, PatchCallchain).Times(0);
+  EXPECT_CALL(leaf_function_call_manager_, PatchCallerOfLeafFunction).Times(0);
+  orbit_grpc_protos::FullCallstackSample actual_callstack_sample;
+  EXPECT_CALL(listener_, OnCallstackSample).Times(1).WillOnce(SaveArg<0>(&actual_callstack_sample));
+  // Without KernelSymbols, the kernel frames are not symbolized.
+  EXPECT_CALL(listener_, OnAddressInfo).Times(0);
+
+  visitor_->Visit(&event);
+
+  EXPECT_EQ(actual_callstack_sample.callstack().type(), Callstack::kComplete);
+  EXPECT_THAT(actual_callstack_sample.callstack().pcs(), ElementsAre(kKernelFunctionAddress));
+}
+
 TEST_F(UprobesUnwindingVisitorTest, VisitCallchainSampleInsideUprobeCodeSendsInUprobesCallstack) {
   constexpr uint32_t kPid = 10;
   constexpr uint64_t kStackSize = 13;
@@ -816,4 +1106,88 @@ TEST_F(
   EXPECT_EQ(discarded_samples_in_uretprobes_counter, 0);
 }
 
+TEST_F(UprobesUnwindingVisitorTest, FunctionOverUprobesBudgetIsReportedAndDisabledOnce) {
+  constexpr pid_t kTid = 11;
+  constexpr uint64_t kMaxUprobesPerSecond = 2;
+  const Function function{42, "/path/to/binary", 0x1000};
+
+  std::vector<const Function*> disabled_functions;
+  visitor_->SetUprobesBudget(kMaxUprobesPerSecond, [&](const Function& function_to_disable) {
+    disabled_functions.push_back(&function_to_disable);
+    return true;
+  });
+
+  EXPECT_CALL(return_address_manager_, ProcessUprobes).Times(6);
+  EXPECT_CALL(return_address_manager_, ProcessUretprobes).Times(6);
+  EXPECT_CALL(listener_, OnFunctionCall).Times(6);
+
+  orbit_grpc_protos::WarningEvent actual_warning_event;
+  EXPECT_CALL(listener_, OnWarningEvent).Times(1).WillOnce(SaveArg<0>(&actual_warning_event));
+
+  // Two calls in a second are within budget, also when repeated in the next second.
+  uint64_t timestamp_ns = 1'000;
+  for (uint64_t timestamp_offset_ns : {0, 1'000, 1'000'000'000, 1'000'001'000}) {
+    UprobesPerfEvent uprobe =
+        MakeUprobesPerfEvent(kTid, timestamp_ns + timestamp_offset_ns, 0x1000, &function);
+    visitor_->Visit(&uprobe);
+    UretprobesPerfEvent uretprobe =
+        MakeUretprobesPerfEvent(kTid, timestamp_ns + timestamp_offset_ns + 100, &function);
+    visitor_->Visit(&uretprobe);
+  }
+  EXPECT_TRUE(disabled_functions.empty());
+
+  // The third call in the same second exceeds the budget. Later calls are not reported again.
+  timestamp_ns += 1'000'002'000;
+  for (uint64_t timestamp_offset_ns : {0, 1'000}) {
+    UprobesPerfEvent uprobe =
+        MakeUprobesPerfEvent(kTid, timestamp_ns + timestamp_offset_ns, 0x1000, &function);
+    visitor_->Visit(&uprobe);
+    UretprobesPerfEvent uretprobe =
+        MakeUretprobesPerfEvent(kTid, timestamp_ns + timestamp_offset_ns + 100, &function);
+    visitor_->Visit(&uretprobe);
+  }
+
+  EXPECT_THAT(disabled_functions, ElementsAre(&function));
+  EXPECT_EQ(actual_warning_event.timestamp_ns(), timestamp_ns);
+  EXPECT_THAT(actual_warning_event.message(), HasSubstr("/path/to/binary"));
+  EXPECT_THAT(actual_warning_event.message(), HasSubstr("no longer instrumented"));
+}
+
+TEST_F(UprobesUnwindingVisitorTest, OpenCallsOfDisabledFunctionAreDiscardedOnOtherUretprobes) {
+  constexpr pid_t kTid = 11;
+  const Function outer_function{1, "/path/to/binary", 0x1000};
+  const Function disabled_function{2, "/path/to/binary", 0x2000};
+
+  visitor_->SetUprobesBudget(1, [](const Function& /*function*/) { return true; });
+
+  EXPECT_CALL(return_address_manager_, ProcessUprobes).Times(3);
+  // Once for the uretprobe of the first call of disabled_function, once for the discarded call,
+  // and once for the uretprobe of outer_function.
+  EXPECT_CALL(return_address_manager_, ProcessUretprobes).Times(3);
+
+  UprobesPerfEvent outer_uprobe = MakeUprobesPerfEvent(kTid, 100, 0x2000, &outer_function);
+  visitor_->Visit(&outer_uprobe);
+  UprobesPerfEvent first_uprobe = MakeUprobesPerfEvent(kTid, 200, 0x1000, &disabled_function);
+  visitor_->Visit(&first_uprobe);
+  UretprobesPerfEvent first_uretprobe = MakeUretprobesPerfEvent(kTid, 300, &disabled_function);
+  orbit_grpc_protos::FunctionCall actual_function_call;
+  EXPECT_CALL(listener_, OnFunctionCall).Times(1).WillOnce(SaveArg<0>(&actual_function_call));
+  visitor_->Visit(&first_uretprobe);
+  Mock::VerifyAndClearExpectations(&listener_);
+  EXPECT_EQ(actual_function_call.function_id(), disabled_function.function_id());
+
+  // This call exceeds the budget and disables the function, so its uretprobe never comes.
+  UprobesPerfEvent second_uprobe = MakeUprobesPerfEvent(kTid, 400, 0x1000, &disabled_function);
+  EXPECT_CALL(listener_, OnWarningEvent).Times(1);
+  visitor_->Visit(&second_uprobe);
+  Mock::VerifyAndClearExpectations(&listener_);
+
+  UretprobesPerfEvent outer_uretprobe = MakeUretprobesPerfEvent(kTid, 500, &outer_function);
+  EXPECT_CALL(listener_, OnFunctionCall).Times(1).WillOnce(SaveArg<0>(&actual_function_call));
+  visitor_->Visit(&outer_uretprobe);
+  EXPECT_EQ(actual_function_call.function_id(), outer_function.function_id());
+  EXPECT_EQ(actual_function_call.duration_ns(), 400);
+  EXPECT_EQ(actual_function_call.depth(), 0);
+}
+
 }  // namespace orbit_linux_tracing
\ No newline at end of file
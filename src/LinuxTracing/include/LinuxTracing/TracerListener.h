@@ -5,6 +5,9 @@
 #ifndef LINUX_TRACING_TRACER_LISTENER_H_
 #define LINUX_TRACING_TRACER_LISTENER_H_
 
+#include <utility>
+#include <vector>
+
 #include "capture.pb.h"
 
 namespace orbit_linux_tracing {
@@ -31,6 +34,43 @@ class TracerListener {
       orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) = 0;
   virtual void OnOutOfOrderEventsDiscardedEvent(
       orbit_grpc_protos::OutOfOrderEventsDiscardedEvent out_of_order_events_discarded_event) = 0;
+  virtual void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) = 0;
+  virtual void OnPmuCountersSample(orbit_grpc_protos::PmuCountersSample pmu_counters_sample) = 0;
+  virtual void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) = 0;
+  virtual void OnServiceHealthEvent(
+      orbit_grpc_protos::ServiceHealthEvent service_health_event) = 0;
+  virtual void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) = 0;
+  virtual void OnCaptureStatisticsSummary(
+      orbit_grpc_protos::CaptureStatisticsSummary capture_statistics_summary) = 0;
+
+  // Batched variants for the most frequent events, which receive all the events of one type
+  // produced in the same round of processing. By default, they call the methods above for each
+  // event.
+  virtual void OnSchedulingSlices(
+      std::vector<orbit_grpc_protos::SchedulingSlice> scheduling_slices) {
+    for (orbit_grpc_protos::SchedulingSlice& scheduling_slice : scheduling_slices) {
+      OnSchedulingSlice(std::move(scheduling_slice));
+    }
+  }
+  virtual void OnCallstackSamples(
+      std::vector<orbit_grpc_protos::FullCallstackSample> callstack_samples) {
+    for (orbit_grpc_protos::FullCallstackSample& callstack_sample : callstack_samples) {
+      OnCallstackSample(std::move(callstack_sample));
+    }
+  }
+  virtual void OnFunctionCalls(std::vector<orbit_grpc_protos::FunctionCall> function_calls) {
+    for (orbit_grpc_protos::FunctionCall& function_call : function_calls) {
+      OnFunctionCall(std::move(function_call));
+    }
+  }
+  virtual void OnThreadStateSlices(
+      std::vector<orbit_grpc_protos::ThreadStateSlice> thread_state_slices) {
+    for (orbit_grpc_protos::ThreadStateSlice& thread_state_slice : thread_state_slices) {
+      OnThreadStateSlice(std::move(thread_state_slice));
+    }
+  }
 };
 
 }  // namespace orbit_linux_tracing
@@ -309,6 +309,63 @@ class BufferTracerListener : public orbit_linux_tracing::TracerListener {
     }
   }
 
+  void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) override {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    *event.mutable_sampling_period_changed_event() = std::move(sampling_period_changed_event);
+    {
+      absl::MutexLock lock{&events_mutex_};
+      events_.emplace_back(std::move(event));
+    }
+  }
+
+  void OnPmuCountersSample(orbit_grpc_protos::PmuCountersSample pmu_counters_sample) override {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    *event.mutable_pmu_counters_sample() = std::move(pmu_counters_sample);
+    {
+      absl::MutexLock lock{&events_mutex_};
+      events_.emplace_back(std::move(event));
+    }
+  }
+
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) override {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    *event.mutable_warning_event() = std::move(warning_event);
+    {
+      absl::MutexLock lock{&events_mutex_};
+      events_.emplace_back(std::move(event));
+    }
+  }
+
+  void OnServiceHealthEvent(orbit_grpc_protos::ServiceHealthEvent service_health_event) override {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    *event.mutable_service_health_event() = std::move(service_health_event);
+    {
+      absl::MutexLock lock{&events_mutex_};
+      events_.emplace_back(std::move(event));
+    }
+  }
+
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) override {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    *event.mutable_pipeline_latency_probe() = std::move(pipeline_latency_probe);
+    {
+      absl::MutexLock lock{&events_mutex_};
+      events_.emplace_back(std::move(event));
+    }
+  }
+
+  void OnCaptureStatisticsSummary(
+      orbit_grpc_protos::CaptureStatisticsSummary capture_statistics_summary) override {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    *event.mutable_capture_statistics_summary() = std::move(capture_statistics_summary);
+    {
+      absl::MutexLock lock{&events_mutex_};
+      events_.emplace_back(std::move(event));
+    }
+  }
+
   [[nodiscard]] std::vector<orbit_grpc_protos::ProducerCaptureEvent> GetAndClearEvents() {
     absl::MutexLock lock{&events_mutex_};
     std::vector<orbit_grpc_protos::ProducerCaptureEvent> events = std::move(events_);
@@ -508,6 +565,7 @@ void VerifyOrderOfAllEvents(const std::vector<orbit_grpc_protos::ProducerCapture
       case orbit_grpc_protos::ProducerCaptureEvent::kFullAddressInfo:
         // AddressInfos have no timestamp.
         break;
+      case orbit_grpc_protos::ProducerCaptureEvent::kGpuClockCalibration:
       case orbit_grpc_protos::ProducerCaptureEvent::kGpuQueueSubmission:
         UNREACHABLE();
       case orbit_grpc_protos::ProducerCaptureEvent::kModuleUpdateEvent:
@@ -520,6 +578,16 @@ void VerifyOrderOfAllEvents(const std::vector<orbit_grpc_protos::ProducerCapture
       case orbit_grpc_protos::ProducerCaptureEvent::kApiEvent:
         UNREACHABLE();
       case orbit_grpc_protos::ProducerCaptureEvent::kWarningEvent:
+        // max_uprobes_per_second_per_function is never set by these tests.
+        UNREACHABLE();
+      case orbit_grpc_protos::ProducerCaptureEvent::kServiceHealthEvent:
+        // collect_service_health is never set by these tests.
+        UNREACHABLE();
+      case orbit_grpc_protos::ProducerCaptureEvent::kPipelineLatencyProbe:
+        // pipeline_latency_probe_period is never set by these tests.
+        UNREACHABLE();
+      case orbit_grpc_protos::ProducerCaptureEvent::kCaptureStatisticsSummary:
+        // aggregate_latency_in_kernel is never set by these tests.
         UNREACHABLE();
       case orbit_grpc_protos::ProducerCaptureEvent::kClockResolutionEvent:
         UNREACHABLE();
@@ -540,6 +608,12 @@ void VerifyOrderOfAllEvents(const std::vector<orbit_grpc_protos::ProducerCapture
         previous_event_timestamp_ns =
             event.out_of_order_events_discarded_event().end_timestamp_ns();
         break;
+      case orbit_grpc_protos::ProducerCaptureEvent::kSamplingPeriodChangedEvent:
+        // adaptive_sampling_period is never enabled by these tests.
+        UNREACHABLE();
+      case orbit_grpc_protos::ProducerCaptureEvent::kPmuCountersSample:
+        // collect_pmu_counters is never enabled by these tests.
+        UNREACHABLE();
       case orbit_grpc_protos::ProducerCaptureEvent::EVENT_NOT_SET:
         UNREACHABLE();
     }
@@ -7,11 +7,14 @@
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
 
+#include <algorithm>
+#include <memory>
 #include <thread>
 
 #include "MemoryTracingUtils.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "ProcessMemoryPerfSampler.h"
 #include "capture.pb.h"
 
 namespace orbit_memory_tracing {
@@ -109,4 +112,23 @@ std::unique_ptr<MemoryInfoProducer> CreateProcessMemoryInfoProducer(MemoryInfoLi
   return process_memory_info_producer;
 }
 
+std::unique_ptr<MemoryInfoProducer> CreateProcessMemoryInfoProducerUsingPerfEvents(
+    MemoryInfoListener* listener, uint64_t sampling_period_ns, int32_t pid) {
+  // Resync at least every kResyncPeriodNs, but never more often than every sample.
+  constexpr uint64_t kResyncPeriodNs = 100'000'000;
+  auto sampler = std::make_shared<ProcessMemoryPerfSampler>(
+      pid, std::max(sampling_period_ns, kResyncPeriodNs));
+  std::unique_ptr<MemoryInfoProducer> process_memory_info_producer =
+      std::make_unique<MemoryInfoProducer>(
+          sampling_period_ns, pid, [sampler](MemoryInfoListener* listener, int32_t /*pid*/) {
+            ErrorMessageOr<ProcessMemoryUsage> process_memory_usage = sampler->Sample();
+            if (process_memory_usage.has_value()) {
+              listener->OnProcessMemoryUsage(process_memory_usage.value());
+            }
+          });
+  process_memory_info_producer->SetListener(listener);
+  process_memory_info_producer->SetThreadName("ProMemPr::Run");
+  return process_memory_info_producer;
+}
+
 }  // namespace orbit_memory_tracing
\ No newline at end of file
@@ -0,0 +1,191 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProcessMemoryPerfSampler.h"
+
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/strip.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <string>
+
+#include "GrpcProtos/Constants.h"
+#include "MemoryTracingUtils.h"
+#include "OrbitBase/GetProcessIds.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_memory_tracing {
+
+using orbit_grpc_protos::kMissingInfo;
+using orbit_grpc_protos::ProcessMemoryUsage;
+
+namespace {
+
+[[nodiscard]] ErrorMessageOr<uint64_t> GetTracepointId(const char* tracepoint_category,
+                                                       const char* tracepoint_name) {
+  OUTCOME_TRY(file_content, orbit_base::ReadFileToString(absl::StrFormat(
+                                "/sys/kernel/debug/tracing/events/%s/%s/id", tracepoint_category,
+                                tracepoint_name)));
+  uint64_t tracepoint_id = 0;
+  if (!absl::SimpleAtoi(absl::StripAsciiWhitespace(file_content), &tracepoint_id)) {
+    return ErrorMessage(absl::StrFormat("Unable to parse id of tracepoint %s:%s",
+                                        tracepoint_category, tracepoint_name));
+  }
+  return tracepoint_id;
+}
+
+// Opens a counter for the thread `tid` that is inherited by the threads it creates.
+[[nodiscard]] ErrorMessageOr<orbit_base::unique_fd> OpenCounter(uint32_t type, uint64_t config,
+                                                                pid_t tid) {
+  perf_event_attr attr{};
+  attr.size = sizeof(perf_event_attr);
+  attr.type = type;
+  attr.config = config;
+  attr.inherit = 1;
+  int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, tid, /*cpu=*/-1,
+                                    /*group_fd=*/-1, PERF_FLAG_FD_CLOEXEC));
+  if (fd == -1) {
+    return ErrorMessage(absl::StrFormat("Unable to open perf counter for thread %d: %s", tid,
+                                        SafeStrerror(errno)));
+  }
+  return orbit_base::unique_fd{fd};
+}
+
+[[nodiscard]] ErrorMessageOr<uint64_t> SumCounters(const std::vector<orbit_base::unique_fd>& fds) {
+  uint64_t sum = 0;
+  for (const orbit_base::unique_fd& fd : fds) {
+    uint64_t value = 0;
+    if (read(fd.get(), &value, sizeof(value)) != sizeof(value)) {
+      return ErrorMessage(absl::StrFormat("Unable to read perf counter: %s", SafeStrerror(errno)));
+    }
+    sum += value;
+  }
+  return sum;
+}
+
+[[nodiscard]] int64_t AddIfNotMissing(int64_t value, int64_t difference) {
+  if (value == kMissingInfo) return kMissingInfo;
+  return value + difference;
+}
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<ProcessMemoryPerfCounters>> ProcessMemoryPerfCounters::Create(
+    int32_t pid) {
+  OUTCOME_TRY(page_alloc_tracepoint_id, GetTracepointId("kmem", "mm_page_alloc"));
+  OUTCOME_TRY(page_free_tracepoint_id, GetTracepointId("kmem", "mm_page_free"));
+
+  std::vector<pid_t> tids = orbit_base::GetTidsOfProcess(pid);
+  if (tids.empty()) {
+    return ErrorMessage(absl::StrFormat("Unable to list the threads of process %d", pid));
+  }
+
+  std::unique_ptr<ProcessMemoryPerfCounters> counters{new ProcessMemoryPerfCounters()};
+  for (pid_t tid : tids) {
+    OUTCOME_TRY(minor_page_faults_fd,
+                OpenCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN, tid));
+    OUTCOME_TRY(major_page_faults_fd,
+                OpenCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ, tid));
+    OUTCOME_TRY(page_alloc_fd,
+                OpenCounter(PERF_TYPE_TRACEPOINT, page_alloc_tracepoint_id, tid));
+    OUTCOME_TRY(page_free_fd,
+                OpenCounter(PERF_TYPE_TRACEPOINT, page_free_tracepoint_id, tid));
+    counters->minor_page_faults_fds_.push_back(std::move(minor_page_faults_fd));
+    counters->major_page_faults_fds_.push_back(std::move(major_page_faults_fd));
+    counters->page_alloc_fds_.push_back(std::move(page_alloc_fd));
+    counters->page_free_fds_.push_back(std::move(page_free_fd));
+  }
+  return counters;
+}
+
+ErrorMessageOr<ProcessMemoryPerfCounts> ProcessMemoryPerfCounters::Read() const {
+  OUTCOME_TRY(minor_page_faults, SumCounters(minor_page_faults_fds_));
+  OUTCOME_TRY(major_page_faults, SumCounters(major_page_faults_fds_));
+  OUTCOME_TRY(allocated_pages, SumCounters(page_alloc_fds_));
+  OUTCOME_TRY(freed_pages, SumCounters(page_free_fds_));
+  return ProcessMemoryPerfCounts{minor_page_faults, major_page_faults, allocated_pages,
+                                 freed_pages};
+}
+
+void IncrementalProcessMemoryUsage::Resync(const ProcessMemoryUsage& process_memory_usage,
+                                           const ProcessMemoryPerfCounts& counts) {
+  synced_ = true;
+  last_resync_timestamp_ns_ = process_memory_usage.timestamp_ns();
+  last_resync_usage_ = process_memory_usage;
+  last_resync_counts_ = counts;
+}
+
+ProcessMemoryUsage IncrementalProcessMemoryUsage::Get(const ProcessMemoryPerfCounts& counts,
+                                                      uint64_t timestamp_ns) const {
+  ProcessMemoryUsage process_memory_usage = CreateAndInitializeProcessMemoryUsage();
+  process_memory_usage.set_pid(pid_);
+  process_memory_usage.set_timestamp_ns(timestamp_ns);
+  if (!synced_) return process_memory_usage;
+
+  process_memory_usage.set_minflt(
+      AddIfNotMissing(last_resync_usage_.minflt(),
+                      static_cast<int64_t>(counts.minor_page_faults -
+                                           last_resync_counts_.minor_page_faults)));
+  process_memory_usage.set_majflt(
+      AddIfNotMissing(last_resync_usage_.majflt(),
+                      static_cast<int64_t>(counts.major_page_faults -
+                                           last_resync_counts_.major_page_faults)));
+
+  const int64_t allocated_pages =
+      static_cast<int64_t>(counts.allocated_pages - last_resync_counts_.allocated_pages);
+  const int64_t freed_pages =
+      static_cast<int64_t>(counts.freed_pages - last_resync_counts_.freed_pages);
+  if (last_resync_usage_.rss_anon_kb() != kMissingInfo) {
+    const int64_t rss_anon_kb = last_resync_usage_.rss_anon_kb() +
+                                (allocated_pages - freed_pages) *
+                                    static_cast<int64_t>(page_size_kb_);
+    process_memory_usage.set_rss_anon_kb(std::max<int64_t>(rss_anon_kb, 0));
+  }
+  return process_memory_usage;
+}
+
+ProcessMemoryPerfSampler::ProcessMemoryPerfSampler(int32_t pid, uint64_t resync_period_ns)
+    : pid_{pid},
+      resync_period_ns_{resync_period_ns},
+      incremental_usage_{pid, static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) / 1024} {
+  ErrorMessageOr<std::unique_ptr<ProcessMemoryPerfCounters>> counters_or_error =
+      ProcessMemoryPerfCounters::Create(pid);
+  if (counters_or_error.has_error()) {
+    ERROR("Sampling the memory usage of process %d from /proc only: %s", pid,
+          counters_or_error.error().message());
+    return;
+  }
+  counters_ = std::move(counters_or_error.value());
+}
+
+ErrorMessageOr<ProcessMemoryUsage> ProcessMemoryPerfSampler::Sample() {
+  if (counters_ == nullptr) return GetProcessMemoryUsage(pid_);
+
+  const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  ErrorMessageOr<ProcessMemoryPerfCounts> counts_or_error = counters_->Read();
+  if (counts_or_error.has_error()) {
+    ERROR("Sampling the memory usage of process %d from /proc only: %s", pid_,
+          counts_or_error.error().message());
+    counters_.reset();
+    return GetProcessMemoryUsage(pid_);
+  }
+
+  if (!incremental_usage_.IsSynced() ||
+      timestamp_ns - incremental_usage_.last_resync_timestamp_ns() >= resync_period_ns_) {
+    OUTCOME_TRY(process_memory_usage, GetProcessMemoryUsage(pid_));
+    incremental_usage_.Resync(process_memory_usage, counts_or_error.value());
+    return process_memory_usage;
+  }
+  return incremental_usage_.Get(counts_or_error.value(), timestamp_ns);
+}
+
+}  // namespace orbit_memory_tracing
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MEMORY_TRACING_PROCESS_MEMORY_PERF_SAMPLER_H_
+#define MEMORY_TRACING_PROCESS_MEMORY_PERF_SAMPLER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_memory_tracing {
+
+// Cumulative values of the perf counters of a process, since the counters were opened.
+struct ProcessMemoryPerfCounts {
+  uint64_t minor_page_faults = 0;
+  uint64_t major_page_faults = 0;
+  // Number of kmem:mm_page_alloc and kmem:mm_page_free tracepoint hits. Each hit is counted as a
+  // single page, independently of the order of the allocation.
+  uint64_t allocated_pages = 0;
+  uint64_t freed_pages = 0;
+};
+
+// Counts the minor and major page faults, and the page allocations and frees, of all the threads of
+// a process with perf_event_open in counting mode. The counters of the threads that exist when the
+// counters are created are inherited by the threads they create later.
+class ProcessMemoryPerfCounters {
+ public:
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<ProcessMemoryPerfCounters>> Create(
+      int32_t pid);
+
+  [[nodiscard]] ErrorMessageOr<ProcessMemoryPerfCounts> Read() const;
+
+ private:
+  ProcessMemoryPerfCounters() = default;
+
+  std::vector<orbit_base::unique_fd> minor_page_faults_fds_;
+  std::vector<orbit_base::unique_fd> major_page_faults_fds_;
+  std::vector<orbit_base::unique_fd> page_alloc_fds_;
+  std::vector<orbit_base::unique_fd> page_free_fds_;
+};
+
+// Derives a ProcessMemoryUsage from the last absolute ProcessMemoryUsage read from /proc (see
+// `Resync`) and from how much the perf counters of the process have changed since then. The page
+// fault counts are exact, as long as no thread escaped the counters, while the RssAnon value is
+// only an estimate: the page allocations and frees also include, e.g., the page cache, and frees
+// that happen in the context of other processes (e.g., kswapd) are missed. This is why the value
+// needs to be resynced periodically.
+class IncrementalProcessMemoryUsage {
+ public:
+  IncrementalProcessMemoryUsage(int32_t pid, uint64_t page_size_kb)
+      : pid_{pid}, page_size_kb_{page_size_kb} {}
+
+  void Resync(const orbit_grpc_protos::ProcessMemoryUsage& process_memory_usage,
+              const ProcessMemoryPerfCounts& counts);
+  [[nodiscard]] bool IsSynced() const { return synced_; }
+  [[nodiscard]] uint64_t last_resync_timestamp_ns() const { return last_resync_timestamp_ns_; }
+
+  [[nodiscard]] orbit_grpc_protos::ProcessMemoryUsage Get(const ProcessMemoryPerfCounts& counts,
+                                                          uint64_t timestamp_ns) const;
+
+ private:
+  int32_t pid_;
+  uint64_t page_size_kb_;
+  bool synced_ = false;
+  uint64_t last_resync_timestamp_ns_ = 0;
+  orbit_grpc_protos::ProcessMemoryUsage last_resync_usage_;
+  ProcessMemoryPerfCounts last_resync_counts_;
+};
+
+// Samples the ProcessMemoryUsage of a process from its perf counters, and only reads the /proc
+// files of the process on the first sample and then every `resync_period_ns`. Falls back to always
+// reading /proc if the counters can't be opened or read.
+class ProcessMemoryPerfSampler {
+ public:
+  ProcessMemoryPerfSampler(int32_t pid, uint64_t resync_period_ns);
+
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ProcessMemoryUsage> Sample();
+
+ private:
+  int32_t pid_;
+  uint64_t resync_period_ns_;
+  std::unique_ptr<ProcessMemoryPerfCounters> counters_;
+  IncrementalProcessMemoryUsage incremental_usage_;
+};
+
+}  // namespace orbit_memory_tracing
+
+#endif  // MEMORY_TRACING_PROCESS_MEMORY_PERF_SAMPLER_H_
@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "GrpcProtos/Constants.h"
+#include "ProcessMemoryPerfSampler.h"
+
+namespace orbit_memory_tracing {
+
+using orbit_grpc_protos::kMissingInfo;
+using orbit_grpc_protos::ProcessMemoryUsage;
+
+namespace {
+
+constexpr int32_t kPid = 42;
+constexpr uint64_t kPageSizeKb = 4;
+
+[[nodiscard]] ProcessMemoryUsage CreateProcessMemoryUsage(uint64_t timestamp_ns, int64_t minflt,
+                                                          int64_t majflt, int64_t rss_anon_kb) {
+  ProcessMemoryUsage process_memory_usage;
+  process_memory_usage.set_pid(kPid);
+  process_memory_usage.set_timestamp_ns(timestamp_ns);
+  process_memory_usage.set_minflt(minflt);
+  process_memory_usage.set_majflt(majflt);
+  process_memory_usage.set_rss_anon_kb(rss_anon_kb);
+  return process_memory_usage;
+}
+
+}  // namespace
+
+TEST(IncrementalProcessMemoryUsage, IsMissingInfoBeforeFirstResync) {
+  IncrementalProcessMemoryUsage incremental_usage{kPid, kPageSizeKb};
+  EXPECT_FALSE(incremental_usage.IsSynced());
+
+  ProcessMemoryUsage process_memory_usage = incremental_usage.Get({10, 1, 5, 2}, 1000);
+  EXPECT_EQ(process_memory_usage.pid(), kPid);
+  EXPECT_EQ(process_memory_usage.timestamp_ns(), 1000);
+  EXPECT_EQ(process_memory_usage.minflt(), kMissingInfo);
+  EXPECT_EQ(process_memory_usage.majflt(), kMissingInfo);
+  EXPECT_EQ(process_memory_usage.rss_anon_kb(), kMissingInfo);
+}
+
+TEST(IncrementalProcessMemoryUsage, AddsCounterDifferencesToLastResync) {
+  IncrementalProcessMemoryUsage incremental_usage{kPid, kPageSizeKb};
+  incremental_usage.Resync(CreateProcessMemoryUsage(1000, 500, 50, 10000), {10, 1, 100, 20});
+  EXPECT_TRUE(incremental_usage.IsSynced());
+  EXPECT_EQ(incremental_usage.last_resync_timestamp_ns(), 1000);
+
+  ProcessMemoryUsage process_memory_usage = incremental_usage.Get({25, 3, 150, 30}, 2000);
+  EXPECT_EQ(process_memory_usage.pid(), kPid);
+  EXPECT_EQ(process_memory_usage.timestamp_ns(), 2000);
+  EXPECT_EQ(process_memory_usage.minflt(), 515);
+  EXPECT_EQ(process_memory_usage.majflt(), 52);
+  EXPECT_EQ(process_memory_usage.rss_anon_kb(), 10000 + (50 - 10) * 4);
+
+  // More pages freed than allocated.
+  process_memory_usage = incremental_usage.Get({25, 3, 150, 100}, 3000);
+  EXPECT_EQ(process_memory_usage.rss_anon_kb(), 10000 - (80 - 50) * 4);
+
+  // A new resync replaces the base values.
+  incremental_usage.Resync(CreateProcessMemoryUsage(4000, 600, 60, 20000), {40, 4, 200, 100});
+  process_memory_usage = incremental_usage.Get({41, 4, 200, 100}, 5000);
+  EXPECT_EQ(process_memory_usage.minflt(), 601);
+  EXPECT_EQ(process_memory_usage.majflt(), 60);
+  EXPECT_EQ(process_memory_usage.rss_anon_kb(), 20000);
+}
+
+TEST(IncrementalProcessMemoryUsage, RssAnonDoesNotBecomeNegative) {
+  IncrementalProcessMemoryUsage incremental_usage{kPid, kPageSizeKb};
+  incremental_usage.Resync(CreateProcessMemoryUsage(1000, 500, 50, 8), {0, 0, 0, 0});
+
+  ProcessMemoryUsage process_memory_usage = incremental_usage.Get({0, 0, 0, 10}, 2000);
+  EXPECT_EQ(process_memory_usage.rss_anon_kb(), 0);
+}
+
+TEST(IncrementalProcessMemoryUsage, KeepsMissingInfoOfLastResync) {
+  IncrementalProcessMemoryUsage incremental_usage{kPid, kPageSizeKb};
+  incremental_usage.Resync(CreateProcessMemoryUsage(1000, kMissingInfo, 50, kMissingInfo),
+                           {0, 0, 0, 0});
+
+  ProcessMemoryUsage process_memory_usage = incremental_usage.Get({10, 1, 10, 0}, 2000);
+  EXPECT_EQ(process_memory_usage.minflt(), kMissingInfo);
+  EXPECT_EQ(process_memory_usage.majflt(), 51);
+  EXPECT_EQ(process_memory_usage.rss_anon_kb(), kMissingInfo);
+}
+
+}  // namespace orbit_memory_tracing
@@ -57,6 +57,12 @@ std::unique_ptr<MemoryInfoProducer> CreateCGroupMemoryInfoProducer(MemoryInfoLis
 std::unique_ptr<MemoryInfoProducer> CreateProcessMemoryInfoProducer(MemoryInfoListener* listener,
                                                                     uint64_t sampling_period_ns,
                                                                     int32_t pid);
+// Same as above, but the page faults and the RssAnon of the process are derived from perf counters
+// (page faults and kmem:mm_page_alloc/mm_page_free tracepoints) instead of parsing the /proc files
+// of the process at every sample. /proc is only read periodically to resync the absolute values,
+// which allows much shorter sampling periods.
+std::unique_ptr<MemoryInfoProducer> CreateProcessMemoryInfoProducerUsingPerfEvents(
+    MemoryInfoListener* listener, uint64_t sampling_period_ns, int32_t pid);
 
 }  // namespace orbit_memory_tracing
 
@@ -11,8 +11,11 @@
 
 namespace orbit_metrics_uploader {
 
-CaptureMetric::CaptureMetric(MetricsUploader* uploader, const CaptureStartData& start_data)
-    : uploader_(uploader), start_(std::chrono::steady_clock::now()) {
+CaptureMetric::CaptureMetric(MetricsUploader* uploader, const CaptureStartData& start_data,
+                             ClientPerformanceMetrics* performance_metrics)
+    : uploader_(uploader),
+      performance_metrics_(performance_metrics),
+      start_(std::chrono::steady_clock::now()) {
   CHECK(uploader_ != nullptr);
   capture_data_.set_number_of_instrumented_functions(start_data.number_of_instrumented_functions);
   capture_data_.set_number_of_frame_tracks(start_data.number_of_frame_tracks);
@@ -56,7 +59,7 @@ bool CaptureMetric::SendCaptureFailed() {
       std::chrono::steady_clock::now() - start_);
   capture_data_.set_duration_in_milliseconds(duration.count());
   status_code_ = OrbitLogEvent_StatusCode_INTERNAL_ERROR;
-  return uploader_->SendCaptureEvent(capture_data_, status_code_);
+  return SendCaptureEvent();
 }
 
 bool CaptureMetric::SendCaptureCancelled() {
@@ -64,12 +67,20 @@ bool CaptureMetric::SendCaptureCancelled() {
       std::chrono::steady_clock::now() - start_);
   capture_data_.set_duration_in_milliseconds(duration.count());
   status_code_ = OrbitLogEvent_StatusCode_CANCELLED;
-  return uploader_->SendCaptureEvent(capture_data_, status_code_);
+  return SendCaptureEvent();
 }
 
 bool CaptureMetric::SendCaptureSucceeded(std::chrono::milliseconds duration_in_milliseconds) {
   capture_data_.set_duration_in_milliseconds(duration_in_milliseconds.count());
   status_code_ = OrbitLogEvent_StatusCode_SUCCESS;
+  return SendCaptureEvent();
+}
+
+bool CaptureMetric::SendCaptureEvent() {
+  if (performance_metrics_ != nullptr) {
+    *capture_data_.mutable_client_performance_data() =
+        performance_metrics_->TakeClientPerformanceData();
+  }
   return uploader_->SendCaptureEvent(capture_data_, status_code_);
 }
 
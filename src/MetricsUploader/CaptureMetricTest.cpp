@@ -9,6 +9,7 @@
 #include <thread>
 
 #include "MetricsUploader/CaptureMetric.h"
+#include "MetricsUploader/ClientPerformanceMetrics.h"
 #include "MetricsUploader/MetricsUploader.h"
 #include "orbit_log_event.pb.h"
 
@@ -186,4 +187,27 @@ TEST(CaptureMetric, SendCaptureSucceededWithoutCompleteData) {
   EXPECT_TRUE(metric.SendCaptureSucceeded(std::chrono::milliseconds{5}));
 }
 
-}  // namespace orbit_metrics_uploader
\ No newline at end of file
+TEST(CaptureMetric, SendsClientPerformanceData) {
+  MockUploader uploader{};
+  ClientPerformanceMetrics performance_metrics;
+  performance_metrics.AddDuration(ClientOperation::kCaptureWindowFrame,
+                                  std::chrono::microseconds{16'000});
+
+  EXPECT_CALL(uploader, SendCaptureEvent(_, _))
+      .Times(1)
+      .WillOnce([](const OrbitCaptureData& capture_data,
+                   OrbitLogEvent_StatusCode /*status_code*/) -> bool {
+        EXPECT_EQ(capture_data.client_performance_data().capture_window_frame().count(), 1);
+        EXPECT_EQ(capture_data.client_performance_data().capture_window_frame().max_microseconds(),
+                  16'000);
+        return true;
+      });
+
+  CaptureMetric metric{&uploader, kTestStartData, &performance_metrics};
+  EXPECT_TRUE(metric.SendCaptureSucceeded(std::chrono::milliseconds{5}));
+
+  // The statistics sent are not sent again with the next capture.
+  EXPECT_EQ(performance_metrics.TakeClientPerformanceData().capture_window_frame().count(), 0);
+}
+
+}  // namespace orbit_metrics_uploader
@@ -0,0 +1,138 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MetricsUploader/ClientPerformanceMetrics.h"
+
+#ifdef _WIN32
+// clang-format off
+#include <windows.h>
+#include <psapi.h>
+// clang-format on
+#else
+#include <sys/resource.h>
+#endif  // _WIN32
+
+#include <algorithm>
+#include <cmath>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_metrics_uploader {
+
+namespace {
+
+constexpr uint32_t kSubBucketCountLog2 = 3;
+constexpr uint32_t kSubBucketCount = 1u << kSubBucketCountLog2;
+
+[[nodiscard]] uint32_t FloorLog2(uint64_t value) {
+  uint32_t result = 0;
+  for (uint32_t shift = 32; shift > 0; shift /= 2) {
+    if (value >= (uint64_t{1} << shift)) {
+      value >>= shift;
+      result += shift;
+    }
+  }
+  return result;
+}
+
+[[nodiscard]] uint32_t GetBucketIndex(uint64_t value) {
+  if (value < kSubBucketCount) return static_cast<uint32_t>(value);
+  const uint32_t exponent = FloorLog2(value);
+  const auto mantissa = static_cast<uint32_t>(value >> (exponent - kSubBucketCountLog2));
+  return kSubBucketCount * (exponent - kSubBucketCountLog2 + 1) + mantissa - kSubBucketCount;
+}
+
+[[nodiscard]] uint64_t GetBucketLowerBound(uint32_t index) {
+  if (index < kSubBucketCount) return index;
+  const uint32_t exponent = index / kSubBucketCount + kSubBucketCountLog2 - 1;
+  const uint64_t mantissa = kSubBucketCount + index % kSubBucketCount;
+  return mantissa << (exponent - kSubBucketCountLog2);
+}
+
+}  // namespace
+
+void ClientPerformanceMetrics::DurationHistogram::Add(uint64_t duration_us) {
+  const uint32_t index = GetBucketIndex(duration_us);
+  if (bucket_counts_.size() <= index) bucket_counts_.resize(index + 1, 0);
+  ++bucket_counts_[index];
+  ++count_;
+  max_us_ = std::max(max_us_, duration_us);
+}
+
+uint64_t ClientPerformanceMetrics::DurationHistogram::GetPercentile(double percentile) const {
+  CHECK(count_ > 0);
+  // The number of durations that may not exceed the result, at least one.
+  const auto rank = std::max<uint64_t>(
+      static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(count_))), 1);
+
+  uint64_t cumulative_count = 0;
+  for (uint32_t index = 0; index < bucket_counts_.size(); ++index) {
+    cumulative_count += bucket_counts_[index];
+    if (cumulative_count >= rank) {
+      // The upper bound of the bucket, but never more than the actual maximum.
+      return std::min(GetBucketLowerBound(index + 1) - 1, max_us_);
+    }
+  }
+  return max_us_;
+}
+
+OrbitClientPerformanceData::DurationStats ClientPerformanceMetrics::DurationHistogram::GetStats()
+    const {
+  OrbitClientPerformanceData::DurationStats stats;
+  stats.set_count(static_cast<int64_t>(count_));
+  if (count_ == 0) return stats;
+
+  stats.set_p50_microseconds(static_cast<int64_t>(GetPercentile(0.5)));
+  stats.set_p90_microseconds(static_cast<int64_t>(GetPercentile(0.9)));
+  stats.set_p99_microseconds(static_cast<int64_t>(GetPercentile(0.99)));
+  stats.set_max_microseconds(static_cast<int64_t>(max_us_));
+  return stats;
+}
+
+void ClientPerformanceMetrics::AddDuration(ClientOperation operation,
+                                           std::chrono::microseconds duration) {
+  const auto index = static_cast<size_t>(operation);
+  CHECK(index < kClientOperationCount);
+  absl::MutexLock lock{&mutex_};
+  histograms_[index].Add(static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+}
+
+OrbitClientPerformanceData ClientPerformanceMetrics::TakeClientPerformanceData() {
+  std::array<DurationHistogram, kClientOperationCount> histograms;
+  {
+    absl::MutexLock lock{&mutex_};
+    std::swap(histograms, histograms_);
+  }
+
+  OrbitClientPerformanceData data;
+  *data.mutable_capture_load() =
+      histograms[static_cast<size_t>(ClientOperation::kCaptureLoad)].GetStats();
+  *data.mutable_symbol_load() =
+      histograms[static_cast<size_t>(ClientOperation::kSymbolLoad)].GetStats();
+  *data.mutable_capture_window_frame() =
+      histograms[static_cast<size_t>(ClientOperation::kCaptureWindowFrame)].GetStats();
+
+  std::optional<uint64_t> peak_resident_memory_kb = GetPeakResidentMemoryKb();
+  if (peak_resident_memory_kb.has_value()) {
+    data.set_peak_resident_memory_kilobytes(static_cast<int64_t>(peak_resident_memory_kb.value()));
+  }
+  return data;
+}
+
+std::optional<uint64_t> GetPeakResidentMemoryKb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(counters.PeakWorkingSetSize) / 1024;
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return std::nullopt;
+  // ru_maxrss is in kilobytes.
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#endif  // _WIN32
+}
+
+}  // namespace orbit_metrics_uploader
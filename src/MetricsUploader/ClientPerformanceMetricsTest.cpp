@@ -0,0 +1,77 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "MetricsUploader/ClientPerformanceMetrics.h"
+#include "orbit_log_event.pb.h"
+
+namespace orbit_metrics_uploader {
+
+TEST(ClientPerformanceMetrics, EmptyStats) {
+  ClientPerformanceMetrics metrics;
+  const OrbitClientPerformanceData data = metrics.TakeClientPerformanceData();
+  EXPECT_EQ(data.capture_load().count(), 0);
+  EXPECT_EQ(data.capture_load().p50_microseconds(), 0);
+  EXPECT_EQ(data.symbol_load().count(), 0);
+  EXPECT_EQ(data.capture_window_frame().count(), 0);
+}
+
+TEST(ClientPerformanceMetrics, ExactForSmallDurations) {
+  ClientPerformanceMetrics metrics;
+  for (int64_t duration_us = 1; duration_us <= 4; ++duration_us) {
+    metrics.AddDuration(ClientOperation::kSymbolLoad, std::chrono::microseconds{duration_us});
+  }
+
+  const OrbitClientPerformanceData::DurationStats stats =
+      metrics.TakeClientPerformanceData().symbol_load();
+  EXPECT_EQ(stats.count(), 4);
+  EXPECT_EQ(stats.p50_microseconds(), 2);
+  EXPECT_EQ(stats.p90_microseconds(), 4);
+  EXPECT_EQ(stats.p99_microseconds(), 4);
+  EXPECT_EQ(stats.max_microseconds(), 4);
+}
+
+TEST(ClientPerformanceMetrics, PercentilesAreWithinRelativeError) {
+  ClientPerformanceMetrics metrics;
+  // 1ms to 100ms, like the frame times of a capture window.
+  for (int64_t duration_us = 1'000; duration_us <= 100'000; duration_us += 1'000) {
+    metrics.AddDuration(ClientOperation::kCaptureWindowFrame,
+                        std::chrono::microseconds{duration_us});
+  }
+
+  const OrbitClientPerformanceData data = metrics.TakeClientPerformanceData();
+  EXPECT_EQ(data.capture_load().count(), 0);
+  const OrbitClientPerformanceData::DurationStats& stats = data.capture_window_frame();
+  EXPECT_EQ(stats.count(), 100);
+  EXPECT_GE(stats.p50_microseconds(), 50'000);
+  EXPECT_LE(stats.p50_microseconds(), 50'000 * 9 / 8);
+  EXPECT_GE(stats.p90_microseconds(), 90'000);
+  EXPECT_LE(stats.p90_microseconds(), 90'000 * 9 / 8);
+  EXPECT_GE(stats.p99_microseconds(), 99'000);
+  EXPECT_LE(stats.p99_microseconds(), 100'000);
+  EXPECT_EQ(stats.max_microseconds(), 100'000);
+}
+
+TEST(ClientPerformanceMetrics, TakeResetsDurations) {
+  ClientPerformanceMetrics metrics;
+  metrics.AddDuration(ClientOperation::kCaptureLoad, std::chrono::microseconds{42});
+  EXPECT_EQ(metrics.TakeClientPerformanceData().capture_load().count(), 1);
+  EXPECT_EQ(metrics.TakeClientPerformanceData().capture_load().count(), 0);
+}
+
+TEST(ClientPerformanceMetrics, GetPeakResidentMemoryKb) {
+  const std::optional<uint64_t> peak_resident_memory_kb = GetPeakResidentMemoryKb();
+  ASSERT_TRUE(peak_resident_memory_kb.has_value());
+  EXPECT_GT(peak_resident_memory_kb.value(), 0);
+
+  ClientPerformanceMetrics metrics;
+  EXPECT_GT(metrics.TakeClientPerformanceData().peak_resident_memory_kilobytes(), 0);
+}
+
+}  // namespace orbit_metrics_uploader
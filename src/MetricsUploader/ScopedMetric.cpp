@@ -13,20 +13,44 @@ ScopedMetric::ScopedMetric(MetricsUploader* uploader, OrbitLogEvent_LogEventType
       log_event_type_(log_event_type),
       start_(std::chrono::steady_clock::now()) {}
 
+ScopedMetric::ScopedMetric(MetricsUploader* uploader, OrbitLogEvent_LogEventType log_event_type,
+                           ClientPerformanceMetrics* performance_metrics,
+                           ClientOperation operation)
+    : uploader_(uploader),
+      log_event_type_(log_event_type),
+      performance_metrics_(performance_metrics),
+      operation_(operation),
+      start_(std::chrono::steady_clock::now()) {}
+
+ScopedMetric::ScopedMetric(ClientPerformanceMetrics* performance_metrics,
+                           ClientOperation operation)
+    : ScopedMetric(nullptr, OrbitLogEvent_LogEventType_UNKNOWN_EVENT_TYPE, performance_metrics,
+                   operation) {}
+
 ScopedMetric::~ScopedMetric() {
+  const auto duration = std::chrono::steady_clock::now() - start_;
+
+  if (performance_metrics_ != nullptr && status_code_ == OrbitLogEvent_StatusCode_SUCCESS) {
+    performance_metrics_->AddDuration(
+        operation_, std::chrono::duration_cast<std::chrono::microseconds>(duration));
+  }
+
   if (uploader_ == nullptr) return;
 
-  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - start_);
-  uploader_->SendLogEvent(log_event_type_, duration, status_code_);
+  uploader_->SendLogEvent(log_event_type_,
+                          std::chrono::duration_cast<std::chrono::milliseconds>(duration),
+                          status_code_);
 }
 
 ScopedMetric::ScopedMetric(ScopedMetric&& other) noexcept
     : uploader_(other.uploader_),
       log_event_type_(other.log_event_type_),
       status_code_(other.status_code_),
+      performance_metrics_(other.performance_metrics_),
+      operation_(other.operation_),
       start_(other.start_) {
   other.uploader_ = nullptr;
+  other.performance_metrics_ = nullptr;
 }
 
 ScopedMetric& ScopedMetric::operator=(ScopedMetric&& other) noexcept {
@@ -38,6 +62,9 @@ ScopedMetric& ScopedMetric::operator=(ScopedMetric&& other) noexcept {
   other.uploader_ = nullptr;
   log_event_type_ = other.log_event_type_;
   status_code_ = other.status_code_;
+  performance_metrics_ = other.performance_metrics_;
+  other.performance_metrics_ = nullptr;
+  operation_ = other.operation_;
   start_ = other.start_;
 
   return *this;
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <thread>
 
+#include "MetricsUploader/ClientPerformanceMetrics.h"
 #include "MetricsUploader/MetricsUploader.h"
 #include "MetricsUploader/ScopedMetric.h"
 
@@ -90,4 +91,48 @@ TEST(ScopedMetric, MoveAndSleep) {
   }
 }
 
-}  // namespace orbit_metrics_uploader
\ No newline at end of file
+TEST(ScopedMetric, AddsDurationToPerformanceMetrics) {
+  MockUploader uploader{};
+  ClientPerformanceMetrics performance_metrics;
+
+  std::chrono::milliseconds sleep_time{1};
+
+  EXPECT_CALL(uploader, SendLogEvent(OrbitLogEvent_LogEventType_ORBIT_SYMBOL_LOAD, Ge(sleep_time),
+                                     OrbitLogEvent_StatusCode_SUCCESS))
+      .Times(1);
+
+  {
+    ScopedMetric metric{&uploader, OrbitLogEvent_LogEventType_ORBIT_SYMBOL_LOAD,
+                        &performance_metrics, ClientOperation::kSymbolLoad};
+    std::this_thread::sleep_for(sleep_time);
+
+    [metric = std::move(metric)]() {}();
+  }
+  { ScopedMetric metric{&performance_metrics, ClientOperation::kCaptureWindowFrame}; }
+
+  const OrbitClientPerformanceData data = performance_metrics.TakeClientPerformanceData();
+  EXPECT_EQ(data.symbol_load().count(), 1);
+  EXPECT_GE(data.symbol_load().max_microseconds(),
+            std::chrono::duration_cast<std::chrono::microseconds>(sleep_time).count());
+  EXPECT_EQ(data.capture_window_frame().count(), 1);
+  EXPECT_EQ(data.capture_load().count(), 0);
+}
+
+TEST(ScopedMetric, DoesNotAddDurationOfFailureToPerformanceMetrics) {
+  MockUploader uploader{};
+  ClientPerformanceMetrics performance_metrics;
+
+  EXPECT_CALL(uploader, SendLogEvent(OrbitLogEvent_LogEventType_ORBIT_CAPTURE_LOAD_V2, _,
+                                     OrbitLogEvent_StatusCode_INTERNAL_ERROR))
+      .Times(1);
+
+  {
+    ScopedMetric metric{&uploader, OrbitLogEvent_LogEventType_ORBIT_CAPTURE_LOAD_V2,
+                        &performance_metrics, ClientOperation::kCaptureLoad};
+    metric.SetStatusCode(OrbitLogEvent_StatusCode_INTERNAL_ERROR);
+  }
+
+  EXPECT_EQ(performance_metrics.TakeClientPerformanceData().capture_load().count(), 0);
+}
+
+}  // namespace orbit_metrics_uploader
@@ -9,6 +9,7 @@
 
 #include <chrono>
 
+#include "MetricsUploader/ClientPerformanceMetrics.h"
 #include "MetricsUploader/MetricsUploader.h"
 #include "orbit_log_event.pb.h"
 
@@ -47,7 +48,10 @@ struct CaptureCompleteData {
 
 class CaptureMetric {
  public:
-  explicit CaptureMetric(MetricsUploader* uploader, const CaptureStartData& start_data);
+  // If `performance_metrics` is given, the statistics collected by it until the capture event is
+  // sent are sent with it.
+  explicit CaptureMetric(MetricsUploader* uploader, const CaptureStartData& start_data,
+                         ClientPerformanceMetrics* performance_metrics = nullptr);
 
   void SetCaptureCompleteData(const CaptureCompleteData& complete_data);
 
@@ -56,7 +60,10 @@ class CaptureMetric {
   bool SendCaptureSucceeded(std::chrono::milliseconds duration_in_milliseconds);
 
  private:
+  bool SendCaptureEvent();
+
   MetricsUploader* uploader_;
+  ClientPerformanceMetrics* performance_metrics_;
   OrbitCaptureData capture_data_;
   OrbitLogEvent_StatusCode status_code_ = OrbitLogEvent_StatusCode_UNKNOWN_STATUS;
   std::chrono::steady_clock::time_point start_;
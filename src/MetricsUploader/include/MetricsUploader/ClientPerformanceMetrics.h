@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef METRICS_UPLOADER_CLIENT_PERFORMANCE_METRICS_H_
+#define METRICS_UPLOADER_CLIENT_PERFORMANCE_METRICS_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "orbit_log_event.pb.h"
+
+namespace orbit_metrics_uploader {
+
+enum class ClientOperation { kCaptureLoad, kSymbolLoad, kCaptureWindowFrame };
+
+// Aggregates the durations of operations of the client, to send their percentiles with the next
+// ORBIT_CAPTURE_END event (see CaptureMetric). This covers operations that are too frequent to be
+// sent one by one, like the frames of the capture window, and makes the distribution of the others
+// available without processing the single events. The durations are usually added by a
+// ScopedMetric. Thread-safe.
+class ClientPerformanceMetrics {
+ public:
+  void AddDuration(ClientOperation operation, std::chrono::microseconds duration);
+
+  // Returns the statistics of the durations added since the previous call, and the peak resident
+  // memory of the process, if available.
+  [[nodiscard]] OrbitClientPerformanceData TakeClientPerformanceData();
+
+ private:
+  // A histogram with log-linear buckets: values below kSubBucketCount have a bucket each, and every
+  // larger power of two is split into kSubBucketCount buckets of equal width. The memory this takes
+  // thus doesn't depend on the number of durations added, e.g., for days of frames.
+  class DurationHistogram {
+   public:
+    void Add(uint64_t duration_us);
+    [[nodiscard]] OrbitClientPerformanceData::DurationStats GetStats() const;
+
+   private:
+    [[nodiscard]] uint64_t GetPercentile(double percentile) const;
+
+    std::vector<uint64_t> bucket_counts_;
+    uint64_t count_ = 0;
+    uint64_t max_us_ = 0;
+  };
+
+  static constexpr size_t kClientOperationCount = 3;
+
+  absl::Mutex mutex_;
+  std::array<DurationHistogram, kClientOperationCount> histograms_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns the peak resident memory of this process since its start, in kilobytes.
+[[nodiscard]] std::optional<uint64_t> GetPeakResidentMemoryKb();
+
+}  // namespace orbit_metrics_uploader
+
+#endif  // METRICS_UPLOADER_CLIENT_PERFORMANCE_METRICS_H_
@@ -7,14 +7,23 @@
 
 #include <chrono>
 
+#include "MetricsUploader/ClientPerformanceMetrics.h"
 #include "MetricsUploader/MetricsUploader.h"
 #include "orbit_log_event.pb.h"
 
 namespace orbit_metrics_uploader {
 
+// Sends a log event with the time from the construction to the destruction of the ScopedMetric.
+// If `performance_metrics` is given, the duration is also added to it as `operation`, unless the
+// status code is set to something else than SUCCESS.
 class ScopedMetric {
  public:
   explicit ScopedMetric(MetricsUploader* uploader, OrbitLogEvent_LogEventType log_event_type);
+  explicit ScopedMetric(MetricsUploader* uploader, OrbitLogEvent_LogEventType log_event_type,
+                        ClientPerformanceMetrics* performance_metrics, ClientOperation operation);
+  // Only adds the duration to `performance_metrics`, for operations which are too frequent to be
+  // sent as log events one by one.
+  explicit ScopedMetric(ClientPerformanceMetrics* performance_metrics, ClientOperation operation);
   ScopedMetric(const ScopedMetric& other) = delete;
   ScopedMetric& operator=(const ScopedMetric& other) = delete;
   ScopedMetric(ScopedMetric&& other) noexcept;
@@ -27,6 +36,8 @@ class ScopedMetric {
   MetricsUploader* uploader_;
   OrbitLogEvent_LogEventType log_event_type_;
   OrbitLogEvent_StatusCode status_code_ = OrbitLogEvent_StatusCode_SUCCESS;
+  ClientPerformanceMetrics* performance_metrics_ = nullptr;
+  ClientOperation operation_{};
   std::chrono::steady_clock::time_point start_;
 };
 
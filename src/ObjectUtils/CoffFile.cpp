@@ -4,15 +4,22 @@
 
 #include "ObjectUtils/CoffFile.h"
 
+#include <absl/strings/escaping.h>
 #include <absl/strings/str_format.h>
 #include <llvm/DebugInfo/DWARF/DWARFContext.h>
-#include <llvm/Demangle/Demangle.h>
 #include <llvm/Object/Binary.h>
 #include <llvm/Object/COFF.h>
+#include <llvm/Object/CVDebugRecord.h>
 #include <llvm/Object/ObjectFile.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "symbol.pb.h"
 
 namespace orbit_object_utils {
@@ -34,6 +41,7 @@ class CoffFileImpl : public CoffFile {
   [[nodiscard]] uint64_t GetExecutableSegmentOffset() const override;
   [[nodiscard]] bool IsElf() const override;
   [[nodiscard]] bool IsCoff() const override;
+  [[nodiscard]] std::string GetBuildId() const override;
 
  private:
   ErrorMessageOr<uint64_t> GetSectionOffsetForSymbol(const llvm::object::SymbolRef& symbol_ref);
@@ -56,31 +64,77 @@ CoffFileImpl::CoffFileImpl(std::filesystem::path file_path,
   }
 }
 
-static void FillDebugSymbolsFromDWARF(llvm::DWARFContext* dwarf_context,
-                                      ModuleSymbols* module_symbols) {
-  for (const auto& info_section : dwarf_context->compile_units()) {
-    for (uint32_t index = 0; index < info_section->getNumDIEs(); ++index) {
-      llvm::DWARFDie full_die = info_section->getDIEAtIndex(index);
-      // We only want symbols of functions, which are DIEs with isSubprogramDIR()
-      // and not of inlined functions, which are DIEs with isSubroutineDIE().
-      if (full_die.isSubprogramDIE()) {
-        SymbolInfo symbol_info;
-        uint64_t low_pc;
-        uint64_t high_pc;
-        uint64_t unused_section_index;
-        if (!full_die.getLowAndHighPC(low_pc, high_pc, unused_section_index)) {
-          continue;
-        }
-        // The method getName will fallback to ShortName if LinkageName is
-        // not present, so this should never return an empty name.
-        std::string name(full_die.getName(llvm::DINameKind::LinkageName));
-        CHECK(!name.empty());
-        symbol_info.set_name(name);
-        symbol_info.set_demangled_name(llvm::demangle(name));
-        symbol_info.set_address(low_pc);
-        symbol_info.set_size(high_pc - low_pc);
-        *(module_symbols->add_symbol_infos()) = std::move(symbol_info);
+static std::vector<SymbolInfo> GetSymbolInfosOfCompileUnit(llvm::DWARFUnit* compile_unit) {
+  std::vector<SymbolInfo> symbol_infos;
+  for (uint32_t index = 0; index < compile_unit->getNumDIEs(); ++index) {
+    llvm::DWARFDie full_die = compile_unit->getDIEAtIndex(index);
+    // We only want symbols of functions, which are DIEs with isSubprogramDIR()
+    // and not of inlined functions, which are DIEs with isSubroutineDIE().
+    if (full_die.isSubprogramDIE()) {
+      uint64_t low_pc;
+      uint64_t high_pc;
+      uint64_t unused_section_index;
+      if (!full_die.getLowAndHighPC(low_pc, high_pc, unused_section_index)) {
+        continue;
       }
+      // The method getName will fallback to ShortName if LinkageName is
+      // not present, so this should never return an empty name.
+      std::string name(full_die.getName(llvm::DINameKind::LinkageName));
+      CHECK(!name.empty());
+      // Only the mangled name is set: the client demangles the names when it displays them.
+      SymbolInfo& symbol_info = symbol_infos.emplace_back();
+      symbol_info.set_name(std::move(name));
+      symbol_info.set_address(low_pc);
+      symbol_info.set_size(high_pc - low_pc);
+    }
+  }
+  return symbol_infos;
+}
+
+// Extracting the DIEs of the compile units takes most of the time for large binaries, so the
+// compile units are processed by several threads. A
+// DWARFContext extracts DIEs lazily and is not thread-safe, hence each additional thread reads the
+// compile units it takes through its own DWARFContext on the same object file. The symbols are
+// added in the order of the compile units, as if they were processed by a single thread.
+static void FillDebugSymbolsFromDWARF(const llvm::object::ObjectFile& object_file,
+                                      llvm::DWARFContext* dwarf_context,
+                                      ModuleSymbols* module_symbols) {
+  const size_t compile_unit_count = dwarf_context->getNumCompileUnits();
+  std::vector<std::vector<SymbolInfo>> symbol_infos_per_compile_unit(compile_unit_count);
+  std::atomic<size_t> next_compile_unit_index = 0;
+  auto process_remaining_compile_units = [&](llvm::DWARFContext* context) {
+    for (size_t compile_unit_index = next_compile_unit_index++;
+         compile_unit_index < compile_unit_count;
+         compile_unit_index = next_compile_unit_index++) {
+      symbol_infos_per_compile_unit[compile_unit_index] = GetSymbolInfosOfCompileUnit(
+          context->getUnitAtIndex(static_cast<unsigned>(compile_unit_index)));
+    }
+  };
+
+  const size_t thread_count =
+      std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), compile_unit_count);
+  std::vector<std::thread> dwarf_threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    dwarf_threads.emplace_back([&object_file, &process_remaining_compile_units] {
+      orbit_base::SetCurrentThreadName("CoffDwarf");
+      const auto thread_dwarf_context = llvm::DWARFContext::create(object_file);
+      CHECK(thread_dwarf_context != nullptr);
+      process_remaining_compile_units(thread_dwarf_context.get());
+    });
+  }
+  process_remaining_compile_units(dwarf_context);
+  for (std::thread& dwarf_thread : dwarf_threads) {
+    dwarf_thread.join();
+  }
+
+  size_t symbol_count = 0;
+  for (const std::vector<SymbolInfo>& symbol_infos : symbol_infos_per_compile_unit) {
+    symbol_count += symbol_infos.size();
+  }
+  module_symbols->mutable_symbol_infos()->Reserve(static_cast<int>(symbol_count));
+  for (std::vector<SymbolInfo>& symbol_infos : symbol_infos_per_compile_unit) {
+    for (SymbolInfo& symbol_info : symbol_infos) {
+      *(module_symbols->add_symbol_infos()) = std::move(symbol_info);
     }
   }
 }
@@ -94,7 +148,7 @@ ErrorMessageOr<ModuleSymbols> CoffFileImpl::LoadDebugSymbols() {
   ModuleSymbols module_symbols;
   module_symbols.set_symbols_file_path(file_path_.string());
 
-  FillDebugSymbolsFromDWARF(dwarf_context.get(), &module_symbols);
+  FillDebugSymbolsFromDWARF(*owning_binary_.getBinary(), dwarf_context.get(), &module_symbols);
 
   if (module_symbols.symbol_infos_size() == 0) {
     return ErrorMessage(
@@ -121,6 +175,20 @@ uint64_t CoffFileImpl::GetExecutableSegmentOffset() const {
 bool CoffFileImpl::IsElf() const { return false; }
 bool CoffFileImpl::IsCoff() const { return true; }
 
+// The GUID and the age of the CodeView debug record identify the build of a PE file, the same way
+// symbol servers identify the matching PDB file. Files without such a record have no build id.
+std::string CoffFileImpl::GetBuildId() const {
+  const llvm::codeview::DebugInfo* debug_info = nullptr;
+  llvm::StringRef pdb_file_name;
+  if (object_file_->getDebugPDBInfo(debug_info, pdb_file_name) || debug_info == nullptr ||
+      debug_info->Signature.CVSignature != llvm::OMF::Signature::PDB70) {
+    return "";
+  }
+  const std::string guid(reinterpret_cast<const char*>(debug_info->PDB70.Signature),
+                         sizeof(debug_info->PDB70.Signature));
+  return absl::StrFormat("%s-%u", absl::BytesToHexString(guid), debug_info->PDB70.Age);
+}
+
 }  // namespace
 
 ErrorMessageOr<std::unique_ptr<CoffFile>> CreateCoffFile(const std::filesystem::path& file_path) {
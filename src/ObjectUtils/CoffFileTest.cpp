@@ -38,7 +38,7 @@ TEST(CoffFile, LoadDebugSymbols) {
 
   SymbolInfo& symbol_info = symbol_infos[4];
   EXPECT_EQ(symbol_info.name(), "pre_c_init");
-  EXPECT_EQ(symbol_info.demangled_name(), "pre_c_init");
+  EXPECT_EQ(symbol_info.demangled_name(), "");
   uint64_t expected_address =
       0x0 + coff_file->GetExecutableSegmentOffset() + coff_file->GetLoadBias();
   EXPECT_EQ(symbol_info.address(), expected_address);
@@ -46,7 +46,7 @@ TEST(CoffFile, LoadDebugSymbols) {
 
   symbol_info = symbol_infos[5];
   EXPECT_EQ(symbol_info.name(), "PrintHelloWorld");
-  EXPECT_EQ(symbol_info.demangled_name(), "PrintHelloWorld");
+  EXPECT_EQ(symbol_info.demangled_name(), "");
   expected_address = 0x03a0 + coff_file->GetExecutableSegmentOffset() + coff_file->GetLoadBias();
   EXPECT_EQ(symbol_info.address(), expected_address);
   EXPECT_EQ(symbol_info.size(), 0x1b);
@@ -61,6 +61,16 @@ TEST(CoffFile, HasDebugSymbols) {
   EXPECT_TRUE(coff_file_result.value()->HasDebugSymbols());
 }
 
+TEST(CoffFile, GetBuildId) {
+  // libtest.dll was built with MinGW, which doesn't add a CodeView debug record.
+  std::filesystem::path file_path = orbit_base::GetExecutableDir() / "testdata" / "libtest.dll";
+
+  auto coff_file_result = CreateCoffFile(file_path);
+  ASSERT_THAT(coff_file_result, HasNoError());
+
+  EXPECT_EQ(coff_file_result.value()->GetBuildId(), "");
+}
+
 TEST(CoffFile, GetFilePath) {
   std::filesystem::path file_path = orbit_base::GetExecutableDir() / "testdata" / "libtest.dll";
 
@@ -16,7 +16,6 @@
 #include <llvm/DebugInfo/DWARF/DWARFDebugLine.h>
 #include <llvm/DebugInfo/DWARF/DWARFFormValue.h>
 #include <llvm/DebugInfo/Symbolize/Symbolize.h>
-#include <llvm/Demangle/Demangle.h>
 #include <llvm/Object/Binary.h>
 #include <llvm/Object/ELF.h>
 #include <llvm/Object/ELFObjectFile.h>
@@ -29,6 +28,7 @@
 #include <llvm/Support/MathExtras.h>
 #include <llvm/Support/MemoryBuffer.h>
 
+#include <algorithm>
 #include <outcome.hpp>
 #include <type_traits>
 #include <utility>
@@ -48,6 +48,30 @@ using orbit_grpc_protos::LineInfo;
 using orbit_grpc_protos::ModuleSymbols;
 using orbit_grpc_protos::SymbolInfo;
 
+// What LLVM returns for the names it doesn't find in the DWARF information.
+constexpr const char* kInvalidDwarfName = "<invalid>";
+
+// A function of a symbol table. The name points into the ELF file.
+struct FunctionSymbol {
+  llvm::StringRef name;
+  uint64_t address;
+  uint64_t size;
+};
+
+// Adds a SymbolInfo for each of `function_symbols` to `module_symbols`, in the same order. Only
+// the mangled names are set: the client demangles the names when it displays them.
+void AddSymbolInfos(const std::vector<FunctionSymbol>& function_symbols,
+                    ModuleSymbols* module_symbols) {
+  auto* symbol_infos = module_symbols->mutable_symbol_infos();
+  symbol_infos->Reserve(static_cast<int>(function_symbols.size()));
+  for (const FunctionSymbol& function_symbol : function_symbols) {
+    SymbolInfo* symbol_info = symbol_infos->Add();
+    symbol_info->set_name(function_symbol.name.data(), function_symbol.name.size());
+    symbol_info->set_address(function_symbol.address);
+    symbol_info->set_size(function_symbol.size);
+  }
+}
+
 template <typename ElfT>
 class ElfFileImpl : public ElfFile {
  public:
@@ -73,6 +97,8 @@ class ElfFileImpl : public ElfFile {
   [[nodiscard]] std::string GetSoname() const override;
   [[nodiscard]] const std::filesystem::path& GetFilePath() const override;
   [[nodiscard]] ErrorMessageOr<LineInfo> GetLineInfo(uint64_t address) override;
+  [[nodiscard]] ErrorMessageOr<std::vector<LineInfo>> GetInlinedLineInfos(
+      uint64_t address) override;
   [[nodiscard]] ErrorMessageOr<LineInfo> GetDeclarationLocationOfFunction(
       uint64_t address) override;
   [[nodiscard]] std::optional<GnuDebugLinkInfo> GetGnuDebugLinkInfo() const override;
@@ -81,12 +107,14 @@ class ElfFileImpl : public ElfFile {
   ErrorMessageOr<void> InitSections();
   ErrorMessageOr<void> InitProgramHeaders();
   ErrorMessageOr<void> InitDynamicEntries();
-  ErrorMessageOr<SymbolInfo> CreateSymbolInfo(const llvm::object::ELFSymbolRef& symbol_ref);
+  ErrorMessageOr<FunctionSymbol> GetFunctionSymbol(const llvm::object::ELFSymbolRef& symbol_ref);
 
   const std::filesystem::path file_path_;
   llvm::object::OwningBinary<llvm::object::ObjectFile> owning_binary_;
   llvm::object::ELFObjectFile<ElfT>* object_file_;
   llvm::symbolize::LLVMSymbolizer symbolizer_;
+  // Only created when needed, as it keeps what it reads of the DWARF information.
+  std::unique_ptr<llvm::DWARFContext> dwarf_context_;
   std::string build_id_;
   std::string soname_;
   bool has_symtab_section_;
@@ -308,29 +336,24 @@ ErrorMessageOr<void> ElfFileImpl<ElfT>::InitSections() {
 }
 
 template <typename ElfT>
-ErrorMessageOr<SymbolInfo> ElfFileImpl<ElfT>::CreateSymbolInfo(
+ErrorMessageOr<FunctionSymbol> ElfFileImpl<ElfT>::GetFunctionSymbol(
     const llvm::object::ELFSymbolRef& symbol_ref) {
   if ((symbol_ref.getFlags() & llvm::object::BasicSymbolRef::SF_Undefined) != 0) {
     return ErrorMessage("Symbol is defined in another object file (SF_Undefined flag is set).");
   }
-  const std::string name = symbol_ref.getName() ? symbol_ref.getName().get() : "";
+  const llvm::StringRef name = symbol_ref.getName() ? symbol_ref.getName().get() : "";
   // Unknown type - skip and generate a warning.
   if (!symbol_ref.getType()) {
-    LOG("WARNING: Type is not set for symbol \"%s\" in \"%s\", skipping.", name,
+    LOG("WARNING: Type is not set for symbol \"%s\" in \"%s\", skipping.", name.str(),
         file_path_.string());
     return ErrorMessage(absl::StrFormat(R"(Type is not set for symbol "%s" in "%s", skipping.)",
-                                        name, file_path_.string()));
+                                        name.str(), file_path_.string()));
   }
   // Limit list of symbols to functions. Ignore sections and variables.
   if (symbol_ref.getType().get() != llvm::object::SymbolRef::ST_Function) {
     return ErrorMessage("Symbol is not a function.");
   }
-  SymbolInfo symbol_info;
-  symbol_info.set_name(name);
-  symbol_info.set_demangled_name(llvm::demangle(name));
-  symbol_info.set_address(symbol_ref.getValue());
-  symbol_info.set_size(symbol_ref.getSize());
-  return symbol_info;
+  return FunctionSymbol{name, symbol_ref.getValue(), symbol_ref.getSize()};
 }
 
 template <typename ElfT>
@@ -339,22 +362,24 @@ ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadDebugSymbols() {
     return ErrorMessage("ELF file does not have a .symtab section.");
   }
 
-  ModuleSymbols module_symbols;
-  module_symbols.set_load_bias(load_bias_);
-  module_symbols.set_symbols_file_path(file_path_.string());
-
+  std::vector<FunctionSymbol> function_symbols;
   for (const llvm::object::ELFSymbolRef& symbol_ref : object_file_->symbols()) {
-    auto symbol_or_error = CreateSymbolInfo(symbol_ref);
+    auto symbol_or_error = GetFunctionSymbol(symbol_ref);
     if (symbol_or_error.has_value()) {
-      *module_symbols.add_symbol_infos() = std::move(symbol_or_error.value());
+      function_symbols.push_back(symbol_or_error.value());
     }
   }
 
-  if (module_symbols.symbol_infos_size() == 0) {
+  if (function_symbols.empty()) {
     return ErrorMessage(
         "Unable to load symbols from ELF file, not even a single symbol of "
         "type function found.");
   }
+
+  ModuleSymbols module_symbols;
+  module_symbols.set_load_bias(load_bias_);
+  module_symbols.set_symbols_file_path(file_path_.string());
+  AddSymbolInfos(function_symbols, &module_symbols);
   return module_symbols;
 }
 
@@ -364,22 +389,24 @@ ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadSymbolsFromDynsym() {
     return ErrorMessage("ELF file does not have a .dynsym section.");
   }
 
-  ModuleSymbols module_symbols;
-  module_symbols.set_load_bias(load_bias_);
-  module_symbols.set_symbols_file_path(file_path_.string());
-
+  std::vector<FunctionSymbol> function_symbols;
   for (const llvm::object::ELFSymbolRef& symbol_ref : object_file_->getDynamicSymbolIterators()) {
-    auto symbol_or_error = CreateSymbolInfo(symbol_ref);
+    auto symbol_or_error = GetFunctionSymbol(symbol_ref);
     if (symbol_or_error.has_value()) {
-      *module_symbols.add_symbol_infos() = std::move(symbol_or_error.value());
+      function_symbols.push_back(symbol_or_error.value());
     }
   }
 
-  if (module_symbols.symbol_infos_size() == 0) {
+  if (function_symbols.empty()) {
     return ErrorMessage(
         "Unable to load symbols from .dynsym section, not even a single symbol of type function "
         "found.");
   }
+
+  ModuleSymbols module_symbols;
+  module_symbols.set_load_bias(load_bias_);
+  module_symbols.set_symbols_file_path(file_path_.string());
+  AddSymbolInfos(function_symbols, &module_symbols);
   return module_symbols;
 }
 
@@ -465,7 +492,16 @@ const std::filesystem::path& ElfFileImpl<ElfT>::GetFilePath() const {
 
 template <typename ElfT>
 ErrorMessageOr<LineInfo> orbit_object_utils::ElfFileImpl<ElfT>::GetLineInfo(uint64_t address) {
+  OUTCOME_TRY(line_infos, GetInlinedLineInfos(address));
+  return line_infos.back();
+}
+
+template <typename ElfT>
+ErrorMessageOr<std::vector<LineInfo>> orbit_object_utils::ElfFileImpl<ElfT>::GetInlinedLineInfos(
+    uint64_t address) {
   CHECK(has_debug_info_section_);
+  // The symbolizer keeps the DWARF information of the file, and builds its line tables and the map
+  // from addresses to inlined functions on the first lookup.
   auto line_info_or_error = symbolizer_.symbolizeInlinedCode(
       object_file_->getFileName(), {address, llvm::object::SectionedAddress::UndefSection});
   if (!line_info_or_error) {
@@ -485,24 +521,32 @@ ErrorMessageOr<LineInfo> orbit_object_utils::ElfFileImpl<ElfT>::GetLineInfo(uint
   const auto& last_frame = symbolizer_line_info.getFrame(number_of_frames - 1);
 
   // This is what symbolizer returns in case of an error. We convert it to a ErrorMessage here.
-  if (last_frame.FileName == "<invalid>" && last_frame.Line == 0) {
+  if (last_frame.FileName == kInvalidDwarfName && last_frame.Line == 0) {
     return ErrorMessage(absl::StrFormat("Unable to get line info for address=0x%x", address));
   }
 
-  LineInfo line_info;
-  line_info.set_source_file(last_frame.FileName);
-  line_info.set_source_line(last_frame.Line);
-  return line_info;
+  std::vector<LineInfo> line_infos;
+  line_infos.reserve(number_of_frames);
+  for (uint32_t i = 0; i < number_of_frames; ++i) {
+    const auto& frame = symbolizer_line_info.getFrame(i);
+    LineInfo& line_info = line_infos.emplace_back();
+    line_info.set_source_file(frame.FileName);
+    line_info.set_source_line(frame.Line);
+    if (frame.FunctionName != kInvalidDwarfName) line_info.set_function_name(frame.FunctionName);
+  }
+  return line_infos;
 }
 
 template <typename ElfT>
 ErrorMessageOr<LineInfo> orbit_object_utils::ElfFileImpl<ElfT>::GetDeclarationLocationOfFunction(
     uint64_t address) {
-  const auto dwarf_context = llvm::DWARFContext::create(*owning_binary_.getBinary());
-  if (dwarf_context == nullptr) return ErrorMessage{"Could not read DWARF information."};
+  if (dwarf_context_ == nullptr) {
+    dwarf_context_ = llvm::DWARFContext::create(*owning_binary_.getBinary());
+  }
+  if (dwarf_context_ == nullptr) return ErrorMessage{"Could not read DWARF information."};
 
-  const auto offset = dwarf_context->getDebugAranges()->findAddress(address);
-  auto* const compile_unit = dwarf_context->getCompileUnitForOffset(offset);
+  const auto offset = dwarf_context_->getDebugAranges()->findAddress(address);
+  auto* const compile_unit = dwarf_context_->getCompileUnitForOffset(offset);
   if (compile_unit == nullptr) return ErrorMessage{"Invalid address"};
 
   const auto subroutine = compile_unit->getSubroutineForAddress(address);
@@ -513,7 +557,7 @@ ErrorMessageOr<LineInfo> orbit_object_utils::ElfFileImpl<ElfT>::GetDeclarationLo
   if (!decl_file_index) return ErrorMessage{"Could not find source file location"};
 
   const llvm::DWARFDebugLine::LineTable* const line_table =
-      dwarf_context->getLineTableForUnit(compile_unit);
+      dwarf_context_->getLineTableForUnit(compile_unit);
   if (line_table == nullptr) return ErrorMessage{"Line Table was missing in debug information"};
 
   std::string file_path;
@@ -48,13 +48,13 @@ TEST(ElfFile, LoadDebugSymbols) {
 
   SymbolInfo& symbol_info = symbol_infos[0];
   EXPECT_EQ(symbol_info.name(), "deregister_tm_clones");
-  EXPECT_EQ(symbol_info.demangled_name(), "deregister_tm_clones");
+  EXPECT_EQ(symbol_info.demangled_name(), "");
   EXPECT_EQ(symbol_info.address(), 0x1080);
   EXPECT_EQ(symbol_info.size(), 0);
 
   symbol_info = symbol_infos[5];
   EXPECT_EQ(symbol_info.name(), "main");
-  EXPECT_EQ(symbol_info.demangled_name(), "main");
+  EXPECT_EQ(symbol_info.demangled_name(), "");
   EXPECT_EQ(symbol_info.address(), 0x1140);
   EXPECT_EQ(symbol_info.size(), 45);
 }
@@ -92,7 +92,7 @@ TEST(ElfFile, LoadSymbolsFromDynsym) {
 
   SymbolInfo& symbol_info = symbol_infos[7];
   EXPECT_EQ(symbol_info.name(), "UseTestLib");
-  EXPECT_EQ(symbol_info.demangled_name(), "UseTestLib");
+  EXPECT_EQ(symbol_info.demangled_name(), "");
   EXPECT_EQ(symbol_info.address(), 0x2670);
   EXPECT_EQ(symbol_info.size(), 591);
 }
@@ -329,6 +329,38 @@ TEST(ElfFile, LineInfoInlining) {
             "LineInfoTestBinary.cpp");
 }
 
+TEST(ElfFile, InlinedLineInfos) {
+  const std::filesystem::path file_path =
+      orbit_base::GetExecutableDir() / "testdata" / "line_info_test_binary";
+
+  auto program = CreateElfFile(file_path);
+  ASSERT_THAT(program, HasNoError());
+
+  constexpr uint64_t kFirstInstructionOfInlinedPrintHelloWorld = 0x401141;
+  ErrorMessageOr<std::vector<orbit_grpc_protos::LineInfo>> line_infos =
+      program.value()->GetInlinedLineInfos(kFirstInstructionOfInlinedPrintHelloWorld);
+  ASSERT_THAT(line_infos, HasNoError());
+  ASSERT_EQ(line_infos.value().size(), 2);
+
+  const orbit_grpc_protos::LineInfo& inlined_line_info = line_infos.value()[0];
+  EXPECT_EQ(inlined_line_info.function_name(), "PrintHelloWorld()");
+  EXPECT_EQ(inlined_line_info.source_line(), 10);
+  EXPECT_EQ(std::filesystem::path{inlined_line_info.source_file()}.filename().string(),
+            "LineInfoTestBinary.cpp");
+
+  const orbit_grpc_protos::LineInfo& caller_line_info = line_infos.value()[1];
+  EXPECT_EQ(caller_line_info.function_name(), "main");
+  EXPECT_EQ(caller_line_info.source_line(), 13);
+  EXPECT_EQ(std::filesystem::path{caller_line_info.source_file()}.filename().string(),
+            "LineInfoTestBinary.cpp");
+
+  // GetLineInfo returns the location in the function that was not inlined.
+  ErrorMessageOr<orbit_grpc_protos::LineInfo> line_info =
+      program.value()->GetLineInfo(kFirstInstructionOfInlinedPrintHelloWorld);
+  ASSERT_THAT(line_info, HasNoError());
+  EXPECT_EQ(line_info.value().source_line(), 13);
+}
+
 TEST(ElfFile, CompressedDebugInfo) {
   const std::filesystem::path file_path =
       orbit_base::GetExecutableDir() / "testdata" / "line_info_test_binary_compressed";
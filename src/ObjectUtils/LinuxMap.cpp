@@ -14,10 +14,13 @@
 #include <memory>
 #include <outcome.hpp>
 #include <string>
+#include <string_view>
 #include <system_error>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "ObjectUtils/CoffFile.h"
 #include "ObjectUtils/ElfFile.h"
 #include "ObjectUtils/ObjectFile.h"
 #include "OrbitBase/Logging.h"
@@ -26,6 +29,7 @@
 namespace orbit_object_utils {
 
 using orbit_grpc_protos::ModuleInfo;
+using orbit_object_utils::CoffFile;
 using orbit_object_utils::CreateObjectFile;
 using orbit_object_utils::ElfFile;
 using orbit_object_utils::ObjectFile;
@@ -70,10 +74,13 @@ ErrorMessageOr<ModuleInfo> CreateModule(const std::filesystem::path& module_path
     CHECK(elf_file != nullptr);
     module_info.set_build_id(elf_file->GetBuildId());
     module_info.set_soname(elf_file->GetSoname());
+  } else if (object_file_or_error.value()->IsCoff()) {
+    // The build id of a PE file allows caching its symbols like the ones of ELF files.
+    auto* coff_file = dynamic_cast<CoffFile*>((object_file_or_error.value().get()));
+    CHECK(coff_file != nullptr);
+    module_info.set_build_id(coff_file->GetBuildId());
   }
 
-  // All fields we need to set for COFF files are already set, no need to handle COFF
-  // specifically here.
   return module_info;
 }
 
@@ -118,4 +125,26 @@ ErrorMessageOr<std::vector<ModuleInfo>> ParseMaps(std::string_view proc_maps_dat
   return result;
 }
 
+uint64_t ComputeModulesFingerprint(std::string_view proc_maps_data) {
+  // FNV-1a, as the fingerprint needs to be the same across runs of the process.
+  constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325;
+  constexpr uint64_t kFnvPrime = 0x100000001b3;
+  uint64_t fingerprint = kFnvOffsetBasis;
+
+  for (std::string_view line : absl::StrSplit(proc_maps_data, '\n')) {
+    // Same conditions as in ParseMaps.
+    std::vector<std::string_view> tokens = absl::StrSplit(line, ' ', absl::SkipEmpty());
+    if (tokens.size() != 6 || tokens[4] == "0") continue;
+    bool is_executable = tokens[1].size() == 4 && tokens[1][2] == 'x';
+    if (!is_executable) continue;
+
+    for (char c : line) {
+      fingerprint = (fingerprint ^ static_cast<uint8_t>(c)) * kFnvPrime;
+    }
+    fingerprint = (fingerprint ^ static_cast<uint8_t>('\n')) * kFnvPrime;
+  }
+
+  return fingerprint;
+}
+
 }  // namespace orbit_object_utils
\ No newline at end of file
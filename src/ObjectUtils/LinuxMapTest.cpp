@@ -210,3 +210,30 @@ TEST(LinuxMap, ParseMaps) {
     EXPECT_EQ(no_symbols_module_info->load_bias(), 0x400000);
   }
 }
+
+TEST(LinuxMap, ComputeModulesFingerprint) {
+  using orbit_object_utils::ComputeModulesFingerprint;
+
+  constexpr std::string_view kData{
+      "7f6874285000-7f6874288000 r--p 00000000 fe:01 661216                     /path/a\n"
+      "7f6874288000-7f687428c000 r-xp 00003000 fe:01 661216                     /path/a\n"
+      "7f687428e000-7f687428f000 rw-p 00000000 00:00 0\n"};
+  const uint64_t fingerprint = ComputeModulesFingerprint(kData);
+  EXPECT_EQ(ComputeModulesFingerprint(kData), fingerprint);
+
+  // Mappings that ParseMaps ignores don't change the fingerprint.
+  EXPECT_EQ(ComputeModulesFingerprint(absl::StrFormat(
+                "%s7f6874290000-7f6874297000 rw-p 00000000 00:00 0\n"
+                "7f6874297000-7f6874298000 r--p 00000000 fe:01 661217          /path/b\n",
+                kData)),
+            fingerprint);
+
+  // Executable mappings of files do.
+  EXPECT_NE(ComputeModulesFingerprint(absl::StrFormat(
+                "%s7f6874297000-7f6874298000 r-xp 00000000 fe:01 661217          /path/b\n",
+                kData)),
+            fingerprint);
+  EXPECT_NE(
+      ComputeModulesFingerprint("7f6874289000-7f687428c000 r-xp 00003000 fe:01 661216  /path/a\n"),
+      ComputeModulesFingerprint("7f6874288000-7f687428c000 r-xp 00003000 fe:01 661216  /path/a\n"));
+}
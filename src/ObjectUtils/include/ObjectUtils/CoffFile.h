@@ -10,6 +10,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <string>
 
 #include "ObjectUtils/ObjectFile.h"
 #include "OrbitBase/Result.h"
@@ -21,6 +22,10 @@ class CoffFile : public ObjectFile {
  public:
   CoffFile() = default;
   virtual ~CoffFile() = default;
+
+  // Returns the GUID and the age of the CodeView debug record in hex, or an empty string if the
+  // file doesn't have one.
+  [[nodiscard]] virtual std::string GetBuildId() const = 0;
 };
 
 [[nodiscard]] ErrorMessageOr<std::unique_ptr<CoffFile>> CreateCoffFile(
@@ -45,8 +45,17 @@ class ElfFile : public ObjectFile {
   [[nodiscard]] virtual bool Is64Bit() const = 0;
   [[nodiscard]] virtual std::string GetSoname() const = 0;
   [[nodiscard]] virtual std::string GetBuildId() const = 0;
+  // The line tables and the other indexes of the DWARF information that the lookups of source
+  // locations need are built on the first lookup and kept, so the ElfFile should be kept for
+  // successive lookups in the same file.
   [[nodiscard]] virtual ErrorMessageOr<orbit_grpc_protos::LineInfo> GetLineInfo(
       uint64_t address) = 0;
+  // Returns the source locations of `address`, innermost inlined function first: the first one is
+  // the location of `address` itself, each following one is where the function of the previous one
+  // was inlined, and the last one, which is what GetLineInfo returns, is in the function that was
+  // not inlined.
+  [[nodiscard]] virtual ErrorMessageOr<std::vector<orbit_grpc_protos::LineInfo>>
+  GetInlinedLineInfos(uint64_t address) = 0;
   [[nodiscard]] virtual ErrorMessageOr<orbit_grpc_protos::LineInfo>
   GetDeclarationLocationOfFunction(uint64_t address) = 0;
   [[nodiscard]] virtual std::optional<GnuDebugLinkInfo> GetGnuDebugLinkInfo() const = 0;
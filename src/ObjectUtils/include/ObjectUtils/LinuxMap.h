@@ -26,6 +26,11 @@ ErrorMessageOr<std::vector<orbit_grpc_protos::ModuleInfo>> ReadModules(int32_t p
 ErrorMessageOr<std::vector<orbit_grpc_protos::ModuleInfo>> ParseMaps(
     std::string_view proc_maps_data);
 
+// Returns a fingerprint of the mappings in `proc_maps_data` that ParseMaps creates modules from,
+// i.e., the executable mappings of files. It is cheap to compute compared to ParseMaps, and changes
+// to other mappings, like anonymous memory, don't change it.
+[[nodiscard]] uint64_t ComputeModulesFingerprint(std::string_view proc_maps_data);
+
 }  // namespace orbit_object_utils
 
 #endif  // defined(__linux)
@@ -4,6 +4,10 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
+#include <memory>
+#include <string>
+
 #include "OrbitBase/AnyInvocable.h"
 
 namespace orbit_base {
@@ -46,4 +50,41 @@ TEST(AnyInvocable, ShouldBeMovableAndStillCallable) {
   EXPECT_EQ(second(), 42);
 }
 
+TEST(AnyInvocable, ShouldStoreAndCallLambdaLargerThanInlineStorage) {
+  std::array<int, AnyInvocable<int()>::kInlineStorageSize> values{};
+  values.back() = 42;
+  AnyInvocable<int()> first{[values]() { return values.back(); }};
+  EXPECT_EQ(first(), 42);
+
+  auto second = std::move(first);
+  EXPECT_EQ(first, nullptr);  // NOLINT
+  EXPECT_EQ(second(), 42);
+}
+
+TEST(AnyInvocable, ShouldForwardArguments) {
+  AnyInvocable<std::string(std::unique_ptr<int>, const std::string&)> invocable{
+      [](std::unique_ptr<int> value, const std::string& text) {
+        return text + std::to_string(*value);
+      }};
+  EXPECT_EQ(invocable(std::make_unique<int>(42), "answer: "), "answer: 42");
+}
+
+TEST(AnyInvocable, ShouldDestroyFunctionObjectExactlyOnce) {
+  for (bool large : {false, true}) {
+    auto counter = std::make_shared<int>(0);
+    std::array<char, 2 * AnyInvocable<void()>::kInlineStorageSize> payload{};
+    {
+      AnyInvocable<void()> first = large ? AnyInvocable<void()>{[counter, payload]() {}}
+                                         : AnyInvocable<void()>{[counter]() {}};
+      EXPECT_EQ(counter.use_count(), 2);
+      AnyInvocable<void()> second{std::move(first)};
+      EXPECT_EQ(counter.use_count(), 2);
+      AnyInvocable<void()> third{[]() {}};
+      third = std::move(second);
+      EXPECT_EQ(counter.use_count(), 2);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+  }
+}
+
 }  // namespace orbit_base
\ No newline at end of file
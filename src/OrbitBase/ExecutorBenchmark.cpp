@@ -0,0 +1,124 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "OrbitBase/Action.h"
+#include "OrbitBase/AnyInvocable.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/Promise.h"
+#include "OrbitBase/SimpleExecutor.h"
+
+namespace {
+
+constexpr int64_t kTaskCount = 1'000;
+
+// An action allocated with the global allocator, as all actions were before the small object pool.
+template <typename F>
+class GlobalAllocatorAction : public Action {
+ public:
+  explicit GlobalAllocatorAction(F functor) : functor_(std::move(functor)) {}
+  void Execute() override { functor_(); }
+
+ private:
+  F functor_;
+};
+
+void BM_Action_GlobalAllocator(benchmark::State& state) {
+  int counter = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kTaskCount; ++i) {
+      auto functor = [&counter] { ++counter; };
+      std::unique_ptr<Action> action =
+          std::make_unique<GlobalAllocatorAction<decltype(functor)>>(functor);
+      action->Execute();
+    }
+  }
+  benchmark::DoNotOptimize(counter);
+  state.SetItemsProcessed(state.iterations() * kTaskCount);
+}
+
+void BM_Action_SmallObjectPool(benchmark::State& state) {
+  int counter = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kTaskCount; ++i) {
+      std::unique_ptr<Action> action = CreateAction([&counter] { ++counter; });
+      action->Execute();
+    }
+  }
+  benchmark::DoNotOptimize(counter);
+  state.SetItemsProcessed(state.iterations() * kTaskCount);
+}
+
+void BM_AnyInvocable_Inline(benchmark::State& state) {
+  int counter = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kTaskCount; ++i) {
+      orbit_base::AnyInvocable<void()> invocable{[&counter] { ++counter; }};
+      orbit_base::AnyInvocable<void()> moved_invocable{std::move(invocable)};
+      moved_invocable();
+    }
+  }
+  benchmark::DoNotOptimize(counter);
+  state.SetItemsProcessed(state.iterations() * kTaskCount);
+}
+
+void BM_AnyInvocable_Pooled(benchmark::State& state) {
+  int counter = 0;
+  std::array<char, 2 * orbit_base::AnyInvocable<void()>::kInlineStorageSize> payload{};
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kTaskCount; ++i) {
+      orbit_base::AnyInvocable<void()> invocable{[&counter, payload] { counter += payload[0]; }};
+      orbit_base::AnyInvocable<void()> moved_invocable{std::move(invocable)};
+      moved_invocable();
+    }
+  }
+  benchmark::DoNotOptimize(counter);
+  state.SetItemsProcessed(state.iterations() * kTaskCount);
+}
+
+// A promise, its future and one continuation, i.e. the per-task bookkeeping of `Future::Then`.
+void BM_PromiseWithContinuation(benchmark::State& state) {
+  int sum = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kTaskCount; ++i) {
+      orbit_base::Promise<int> promise;
+      orbit_base::Future<int> future = promise.GetFuture();
+      (void)future.RegisterContinuation([&sum](int value) { sum += value; });
+      promise.SetResult(1);
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kTaskCount);
+}
+
+// The full overhead of scheduling a task and a continuation on an executor and running both, like
+// a main thread executor does when its event loop ticks.
+void BM_SimpleExecutor_ScheduleAndThen(benchmark::State& state) {
+  std::shared_ptr<orbit_base::SimpleExecutor> executor = orbit_base::SimpleExecutor::Create();
+  int sum = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kTaskCount; ++i) {
+      orbit_base::Future<int> future = executor->Schedule([] { return 1; });
+      orbit_base::Future<void> continuation_future =
+          future.Then(executor.get(), [&sum](int value) { sum += value; });
+    }
+    executor->ExecuteScheduledTasks();
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kTaskCount);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Action_GlobalAllocator);
+BENCHMARK(BM_Action_SmallObjectPool);
+BENCHMARK(BM_AnyInvocable_Inline);
+BENCHMARK(BM_AnyInvocable_Pooled);
+BENCHMARK(BM_PromiseWithContinuation);
+BENCHMARK(BM_SimpleExecutor_ScheduleAndThen);
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <system_error>
 
 #include "OrbitBase/GetProcessIds.h"
@@ -12,6 +13,7 @@
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
 
 namespace orbit_base {
 
@@ -114,4 +116,22 @@ ErrorMessageOr<pid_t> GetTracerPidOfProcess(pid_t pid) {
   return tracer_pid.value();
 }
 
+ErrorMessageOr<std::vector<pid_t>> GetPidsOfCgroup(std::string_view cgroup_path) {
+  const fs::path cgroup_procs_file_name = fs::path{"/sys/fs/cgroup"} / cgroup_path / "cgroup.procs";
+  OUTCOME_TRY(cgroup_procs_content, orbit_base::ReadFileToString(cgroup_procs_file_name));
+
+  // The file has one pid per line.
+  std::vector<pid_t> pids;
+  for (std::string_view line : absl::StrSplit(cgroup_procs_content, '\n', absl::SkipEmpty())) {
+    pid_t pid;
+    if (!absl::SimpleAtoi(line, &pid)) {
+      return ErrorMessage(
+          absl::StrFormat("Could not extract pid from line \"%s\" of %s", line,
+                          cgroup_procs_file_name.string()));
+    }
+    pids.push_back(pid);
+  }
+  return pids;
+}
+
 }  // namespace orbit_base
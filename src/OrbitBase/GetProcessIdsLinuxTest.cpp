@@ -9,11 +9,18 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 #include "OrbitBase/GetProcessIds.h"
+#include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -74,4 +81,31 @@ TEST(GetProcessIdsLinux, GetTracerPidOfProcess) {
   EXPECT_EQ(pid_or_error.value(), kNoTracerPid);
 }
 
+TEST(GetProcessIdsLinux, GetPidsOfCgroup) {
+  auto cgroup_content_or_error = orbit_base::ReadFileToString("/proc/self/cgroup");
+  ASSERT_FALSE(cgroup_content_or_error.has_error()) << cgroup_content_or_error.error().message();
+
+  // For example "3:cpuset:/" or "3:cpuset:/game".
+  std::optional<std::string> cpuset_cgroup_path;
+  for (std::string_view line : absl::StrSplit(cgroup_content_or_error.value(), '\n')) {
+    std::vector<std::string_view> fields = absl::StrSplit(line, absl::MaxSplits(':', 2));
+    if (fields.size() == 3 && fields[1] == "cpuset") {
+      cpuset_cgroup_path = absl::StrCat("cpuset", fields[2]);
+    }
+  }
+  if (!cpuset_cgroup_path.has_value() ||
+      !std::filesystem::exists(std::filesystem::path{"/sys/fs/cgroup"} /
+                               cpuset_cgroup_path.value() / "cgroup.procs")) {
+    GTEST_SKIP() << "The cpuset cgroup hierarchy is not available";
+  }
+
+  auto pids_or_error = GetPidsOfCgroup(cpuset_cgroup_path.value());
+  ASSERT_FALSE(pids_or_error.has_error()) << pids_or_error.error().message();
+  EXPECT_THAT(pids_or_error.value(), ::testing::Contains(getpid()));
+}
+
+TEST(GetProcessIdsLinux, GetPidsOfCgroupFailsForNonExistentCgroup) {
+  EXPECT_TRUE(GetPidsOfCgroup("cpuset/this_cgroup_does_not_exist").has_error());
+}
+
 }  // namespace orbit_base
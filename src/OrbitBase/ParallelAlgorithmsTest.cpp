@@ -0,0 +1,144 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "OrbitBase/Future.h"
+#include "OrbitBase/ParallelAlgorithms.h"
+#include "OrbitBase/StopSource.h"
+#include "OrbitBase/ThreadPool.h"
+
+namespace orbit_base {
+
+namespace {
+
+class ParallelAlgorithmsTest : public testing::Test {
+ protected:
+  void TearDown() override { thread_pool_->ShutdownAndWait(); }
+
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::Create(4, 4, absl::Seconds(1));
+};
+
+std::vector<uint64_t> CreateRandomValues(size_t count) {
+  std::mt19937_64 random_engine{42};
+  std::vector<uint64_t> values(count);
+  for (uint64_t& value : values) {
+    value = random_engine() % 1000;
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST_F(ParallelAlgorithmsTest, ParallelForVisitsEachIndexOnce) {
+  constexpr size_t kBegin = 3;
+  constexpr size_t kEnd = 100'003;
+  std::vector<std::atomic<int>> visit_counts(kEnd);
+  Future<void> future = ParallelFor(
+      thread_pool_.get(), kBegin, kEnd, [&visit_counts](size_t index) { ++visit_counts[index]; },
+      {/*min_chunk_size=*/16});
+  future.Wait();
+
+  for (size_t index = 0; index < kEnd; ++index) {
+    EXPECT_EQ(visit_counts[index], index < kBegin ? 0 : 1) << index;
+  }
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelForWithEmptyRange) {
+  Future<void> future =
+      ParallelFor(thread_pool_.get(), 5, 5, [](size_t /*index*/) { FAIL(); });
+  EXPECT_TRUE(future.IsFinished());
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelForStopsWhenRequested) {
+  constexpr size_t kIndexCount = 1'000'000;
+  StopSource stop_source;
+  std::atomic<size_t> visited_count = 0;
+  Future<void> future = ParallelFor(
+      thread_pool_.get(), 0, kIndexCount,
+      [&](size_t /*index*/) {
+        if (++visited_count == 100) stop_source.RequestStop();
+      },
+      {/*min_chunk_size=*/1, stop_source.GetStopToken()});
+  future.Wait();
+
+  EXPECT_GE(visited_count, 100);
+  EXPECT_LT(visited_count, kIndexCount);
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelReduceSums) {
+  const std::vector<uint64_t> values = CreateRandomValues(100'000);
+  Future<std::optional<uint64_t>> future = ParallelReduce(
+      thread_pool_.get(), 0, values.size(), uint64_t{0},
+      [&values](size_t index) { return values[index]; }, std::plus<>{}, {/*min_chunk_size=*/64});
+  future.Wait();
+
+  ASSERT_TRUE(future.Get().has_value());
+  uint64_t expected_sum = 0;
+  for (uint64_t value : values) expected_sum += value;
+  EXPECT_EQ(future.Get().value(), expected_sum);
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelReduceWithEmptyRangeReturnsIdentity) {
+  Future<std::optional<uint64_t>> future = ParallelReduce(
+      thread_pool_.get(), 0, 0, uint64_t{7}, [](size_t index) { return index; }, std::plus<>{});
+  ASSERT_TRUE(future.IsFinished());
+  EXPECT_EQ(future.Get(), std::optional<uint64_t>{7});
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelReduceReturnsNulloptWhenStopped) {
+  StopSource stop_source;
+  stop_source.RequestStop();
+  Future<std::optional<uint64_t>> future =
+      ParallelReduce(thread_pool_.get(), 0, 1000, uint64_t{0}, [](size_t index) { return index; },
+                     std::plus<>{}, {/*min_chunk_size=*/1, stop_source.GetStopToken()});
+  future.Wait();
+  EXPECT_EQ(future.Get(), std::nullopt);
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelSortSorts) {
+  for (size_t count : {0, 1, 2, 3, 1000, 100'001}) {
+    std::vector<uint64_t> values = CreateRandomValues(count);
+    std::vector<uint64_t> expected_values = values;
+    std::sort(expected_values.begin(), expected_values.end());
+
+    ParallelSort(thread_pool_.get(), values.begin(), values.end(), std::less<>{},
+                 {/*min_chunk_size=*/1})
+        .Wait();
+    EXPECT_EQ(values, expected_values) << count;
+  }
+}
+
+TEST_F(ParallelAlgorithmsTest, ParallelSortWithComparator) {
+  std::vector<uint64_t> values = CreateRandomValues(10'000);
+  ParallelSort(thread_pool_.get(), values.begin(), values.end(), std::greater<>{},
+               {/*min_chunk_size=*/128})
+      .Wait();
+  EXPECT_TRUE(std::is_sorted(values.begin(), values.end(), std::greater<>{}));
+}
+
+TEST(StopSource, RequestStop) {
+  StopSource stop_source;
+  StopToken stop_token = stop_source.GetStopToken();
+  EXPECT_FALSE(stop_token.IsStopRequested());
+  EXPECT_FALSE(StopToken{}.IsStopRequested());
+
+  StopSource copy = stop_source;
+  copy.RequestStop();
+  EXPECT_TRUE(stop_source.IsStopRequested());
+  EXPECT_TRUE(stop_token.IsStopRequested());
+}
+
+}  // namespace orbit_base
@@ -7,7 +7,86 @@
 #include <algorithm>
 #include <limits>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 namespace orbit_base {
+
+bool IsTscUsableForCaptureTimestamps() {
+#if defined(__x86_64__) || defined(_M_X64)
+  // CPUID leaf 0x80000007 reports the invariant TSC in bit 8 of EDX.
+  constexpr unsigned int kAdvancedPowerManagementLeaf = 0x80000007;
+  constexpr unsigned int kInvariantTscBit = 1u << 8;
+#ifdef _WIN32
+  int registers[4] = {};
+  // Leaf 0x80000000 returns the highest supported extended leaf.
+  __cpuid(registers, 0x80000000);
+  if (static_cast<unsigned int>(registers[0]) < kAdvancedPowerManagementLeaf) return false;
+  __cpuid(registers, kAdvancedPowerManagementLeaf);
+  return (static_cast<unsigned int>(registers[3]) & kInvariantTscBit) != 0;
+#else
+  unsigned int eax = 0;
+  unsigned int ebx = 0;
+  unsigned int ecx = 0;
+  unsigned int edx = 0;
+  if (__get_cpuid(kAdvancedPowerManagementLeaf, &eax, &ebx, &ecx, &edx) == 0) return false;
+  return (edx & kInvariantTscBit) != 0;
+#endif
+#else
+  return false;
+#endif
+}
+
+TscSample SampleTscAndCaptureTimestamp() {
+  constexpr int kAttemptCount = 16;
+  TscSample best_sample;
+  uint64_t best_window_ns = std::numeric_limits<uint64_t>::max();
+  for (int i = 0; i < kAttemptCount; ++i) {
+    const uint64_t before_ns = CaptureTimestampNs();
+    const uint64_t tsc = CaptureTimestampTsc();
+    const uint64_t after_ns = CaptureTimestampNs();
+    if (after_ns - before_ns < best_window_ns) {
+      best_window_ns = after_ns - before_ns;
+      best_sample.timestamp_ns = before_ns + best_window_ns / 2;
+      best_sample.tsc = tsc;
+    }
+  }
+  return best_sample;
+}
+
+static constexpr uint64_t kNsPerSecond = 1'000'000'000;
+
+std::optional<TscCalibration> ComputeTscCalibration(const TscSample& start, const TscSample& end) {
+  if (end.timestamp_ns <= start.timestamp_ns || end.tsc <= start.tsc) return std::nullopt;
+  const uint64_t elapsed_ns = end.timestamp_ns - start.timestamp_ns;
+  const uint64_t elapsed_tsc = end.tsc - start.tsc;
+  // Computed as long double, as elapsed_tsc * kNsPerSecond overflows after a few seconds.
+  const auto tsc_frequency_hz = static_cast<uint64_t>(static_cast<long double>(elapsed_tsc) *
+                                                      kNsPerSecond / elapsed_ns);
+  if (tsc_frequency_hz == 0) return std::nullopt;
+  return TscCalibration{end, tsc_frequency_hz};
+}
+
+uint64_t TscToCaptureTimestampNs(uint64_t tsc, const TscCalibration& calibration) {
+  // Whole seconds and the remainder are converted separately to avoid overflows. The remainder is
+  // smaller than the frequency, so multiplying it by kNsPerSecond doesn't overflow for
+  // frequencies below 18 GHz.
+  const uint64_t frequency = calibration.tsc_frequency_hz;
+  if (tsc >= calibration.reference.tsc) {
+    const uint64_t delta = tsc - calibration.reference.tsc;
+    return calibration.reference.timestamp_ns + delta / frequency * kNsPerSecond +
+           delta % frequency * kNsPerSecond / frequency;
+  }
+  const uint64_t delta = calibration.reference.tsc - tsc;
+  return calibration.reference.timestamp_ns - delta / frequency * kNsPerSecond -
+         delta % frequency * kNsPerSecond / frequency;
+}
+
 uint64_t EstimateClockResolution() {
   uint64_t minimum_resolution_found = std::numeric_limits<uint64_t>::max();
 
@@ -7,6 +7,7 @@
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <thread>
 
 #include "OrbitBase/Profiling.h"
@@ -24,3 +25,48 @@ TEST(Profiling, EstimatedClockResolutionNonNegative) {
   // There's not really any guarantee we have for results of the above call.
   EXPECT_TRUE(resolution >= 0);
 }
+
+TEST(Profiling, TscToCaptureTimestampNs) {
+  orbit_base::TscCalibration calibration{{/*timestamp_ns=*/1'000'000'000, /*tsc=*/3'000'000'000},
+                                         /*tsc_frequency_hz=*/3'000'000'000};
+  EXPECT_EQ(orbit_base::TscToCaptureTimestampNs(3'000'000'000, calibration), 1'000'000'000U);
+  EXPECT_EQ(orbit_base::TscToCaptureTimestampNs(3'000'000'003, calibration), 1'000'000'001U);
+  EXPECT_EQ(orbit_base::TscToCaptureTimestampNs(1'500'000'000, calibration), 500'000'000U);
+  // One hour after the reference, which overflows a naive multiplication by 1'000'000'000.
+  EXPECT_EQ(orbit_base::TscToCaptureTimestampNs(3'000'000'000 + 3600 * 3'000'000'000ULL,
+                                                calibration),
+            1'000'000'000 + 3600 * 1'000'000'000ULL);
+}
+
+TEST(Profiling, ComputeTscCalibration) {
+  std::optional<orbit_base::TscCalibration> calibration = orbit_base::ComputeTscCalibration(
+      {/*timestamp_ns=*/1'000'000'000, /*tsc=*/2'000'000'000},
+      {/*timestamp_ns=*/3'000'000'000, /*tsc=*/6'000'000'000});
+  ASSERT_TRUE(calibration.has_value());
+  EXPECT_EQ(calibration->tsc_frequency_hz, 2'000'000'000U);
+  EXPECT_EQ(calibration->reference.timestamp_ns, 3'000'000'000U);
+  EXPECT_EQ(calibration->reference.tsc, 6'000'000'000U);
+
+  EXPECT_FALSE(orbit_base::ComputeTscCalibration({1'000, 2'000}, {1'000, 3'000}).has_value());
+  EXPECT_FALSE(orbit_base::ComputeTscCalibration({1'000, 2'000}, {2'000, 2'000}).has_value());
+}
+
+TEST(Profiling, CalibratedTscMatchesCaptureTimestampNs) {
+  if (!orbit_base::IsTscUsableForCaptureTimestamps()) {
+    GTEST_SKIP() << "The CPU has no invariant time stamp counter";
+  }
+  orbit_base::TscSample start = orbit_base::SampleTscAndCaptureTimestamp();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::optional<orbit_base::TscCalibration> calibration =
+      orbit_base::ComputeTscCalibration(start, orbit_base::SampleTscAndCaptureTimestamp());
+  ASSERT_TRUE(calibration.has_value());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  const uint64_t before_ns = orbit_base::CaptureTimestampNs();
+  const uint64_t tsc = orbit_base::CaptureTimestampTsc();
+  const uint64_t after_ns = orbit_base::CaptureTimestampNs();
+  constexpr uint64_t kToleranceNs = 100'000;
+  const uint64_t converted_ns = orbit_base::TscToCaptureTimestampNs(tsc, calibration.value());
+  EXPECT_GE(converted_ns + kToleranceNs, before_ns);
+  EXPECT_LE(converted_ns, after_ns + kToleranceNs);
+}
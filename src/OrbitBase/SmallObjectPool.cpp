@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitBase/SmallObjectPool.h"
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace orbit_base {
+
+namespace {
+
+constexpr std::array<size_t, 4> kSizeClasses{32, 64, 128, kMaxSmallObjectSize};
+static_assert(kSizeClasses.back() == kMaxSmallObjectSize);
+
+// Limits how much memory a thread that mostly frees blocks allocated by other threads can hold on
+// to.
+constexpr size_t kMaxCachedBlocksPerSizeClass = 1024;
+
+constexpr size_t kNoSizeClass = kSizeClasses.size();
+
+[[nodiscard]] size_t GetSizeClass(size_t size) {
+  for (size_t size_class = 0; size_class < kSizeClasses.size(); ++size_class) {
+    if (size <= kSizeClasses[size_class]) return size_class;
+  }
+  return kNoSizeClass;
+}
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+class ThreadCache {
+ public:
+  ThreadCache() = default;
+  ThreadCache(const ThreadCache&) = delete;
+  ThreadCache& operator=(const ThreadCache&) = delete;
+  ~ThreadCache();
+
+  [[nodiscard]] void* Allocate(size_t size_class) {
+    FreeBlock* block = free_lists_[size_class];
+    if (block == nullptr) return ::operator new(kSizeClasses[size_class]);
+    free_lists_[size_class] = block->next;
+    --block_counts_[size_class];
+    return block;
+  }
+
+  void Deallocate(void* ptr, size_t size_class) {
+    if (block_counts_[size_class] == kMaxCachedBlocksPerSizeClass) {
+      ::operator delete(ptr);
+      return;
+    }
+    free_lists_[size_class] = new (ptr) FreeBlock{free_lists_[size_class]};
+    ++block_counts_[size_class];
+  }
+
+ private:
+  std::array<FreeBlock*, kSizeClasses.size()> free_lists_{};
+  std::array<size_t, kSizeClasses.size()> block_counts_{};
+};
+
+// Objects can still be freed on a thread after its cache got destroyed, e.g., by the destructors of
+// other thread-local or static objects. Those blocks go back to the global allocator.
+thread_local bool thread_cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  thread_cache_destroyed = true;
+  for (FreeBlock* block : free_lists_) {
+    while (block != nullptr) {
+      FreeBlock* next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+}
+
+[[nodiscard]] ThreadCache* GetThreadCache() {
+  if (thread_cache_destroyed) return nullptr;
+  thread_local ThreadCache thread_cache;
+  return &thread_cache;
+}
+
+}  // namespace
+
+void* AllocateSmallObject(size_t size) {
+  const size_t size_class = GetSizeClass(size);
+  ThreadCache* thread_cache = size_class == kNoSizeClass ? nullptr : GetThreadCache();
+  if (thread_cache == nullptr) {
+    // Blocks of a size class always have the full size of the class, as they might end up in the
+    // free list of another thread.
+    return ::operator new(size_class == kNoSizeClass ? size : kSizeClasses[size_class]);
+  }
+  return thread_cache->Allocate(size_class);
+}
+
+void DeallocateSmallObject(void* ptr, size_t size) noexcept {
+  if (ptr == nullptr) return;
+  const size_t size_class = GetSizeClass(size);
+  ThreadCache* thread_cache = size_class == kNoSizeClass ? nullptr : GetThreadCache();
+  if (thread_cache == nullptr) {
+    ::operator delete(ptr);
+    return;
+  }
+  thread_cache->Deallocate(ptr, size_class);
+}
+
+}  // namespace orbit_base
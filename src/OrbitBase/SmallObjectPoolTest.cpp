@@ -0,0 +1,90 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/Action.h"
+#include "OrbitBase/SmallObjectPool.h"
+
+namespace orbit_base {
+
+TEST(SmallObjectPool, ReusesFreedBlocksOfTheSameSizeClass) {
+  void* first = AllocateSmallObject(40);
+  ASSERT_NE(first, nullptr);
+  DeallocateSmallObject(first, 40);
+
+  void* second = AllocateSmallObject(64);
+  EXPECT_EQ(second, first);
+  DeallocateSmallObject(second, 64);
+}
+
+TEST(SmallObjectPool, BlocksAreUsableAndAligned) {
+  std::vector<std::pair<void*, size_t>> blocks;
+  for (size_t size : {1, 16, 32, 33, 100, 128, 200, 256, 257, 4096}) {
+    void* block = AllocateSmallObject(size);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % __STDCPP_DEFAULT_NEW_ALIGNMENT__, 0);
+    std::memset(block, 0xAB, size);
+    blocks.emplace_back(block, size);
+  }
+  for (const auto& [block, size] : blocks) {
+    DeallocateSmallObject(block, size);
+  }
+}
+
+TEST(SmallObjectPool, BlocksCanBeFreedOnAnotherThread) {
+  constexpr size_t kBlockCount = 10'000;
+  std::vector<void*> blocks(kBlockCount);
+  std::thread allocating_thread{[&blocks] {
+    for (void*& block : blocks) block = AllocateSmallObject(64);
+  }};
+  allocating_thread.join();
+
+  for (void* block : blocks) DeallocateSmallObject(block, 64);
+}
+
+TEST(SmallObjectPool, DeallocateIgnoresNullptr) { DeallocateSmallObject(nullptr, 32); }
+
+TEST(SmallObjectAllocator, WorksWithAllocateShared) {
+  auto value = std::allocate_shared<int>(SmallObjectAllocator<int>{}, 42);
+  EXPECT_EQ(*value, 42);
+  std::weak_ptr<int> weak_value = value;
+  value.reset();
+  EXPECT_TRUE(weak_value.expired());
+}
+
+TEST(SmallObjectAllocator, WorksWithContainers) {
+  std::vector<uint64_t, SmallObjectAllocator<uint64_t>> values;
+  for (uint64_t i = 0; i < 1000; ++i) values.push_back(i);
+  for (uint64_t i = 0; i < 1000; ++i) EXPECT_EQ(values[i], i);
+}
+
+TEST(SmallObjectAllocator, SupportsOverAlignedTypes) {
+  struct alignas(64) OverAligned {
+    int value;
+  };
+  auto value = std::allocate_shared<OverAligned>(SmallObjectAllocator<OverAligned>{});
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(value.get()) % 64, 0);
+}
+
+TEST(SmallObjectPool, ActionsAreAllocatedFromThePool) {
+  int counter = 0;
+  std::unique_ptr<Action> action = CreateAction([&counter] { ++counter; });
+  action->Execute();
+  Action* first_action = action.get();
+  action.reset();
+
+  action = CreateAction([&counter] { counter += 2; });
+  EXPECT_EQ(action.get(), first_action);
+  action->Execute();
+  EXPECT_EQ(counter, 3);
+}
+
+}  // namespace orbit_base
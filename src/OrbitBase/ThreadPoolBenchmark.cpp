@@ -0,0 +1,85 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/blocking_counter.h>
+#include <absl/time/time.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "OrbitBase/ThreadPool.h"
+
+namespace {
+
+constexpr int64_t kActionCount = 100'000;
+// The actions scheduled by each action of BM_*_NestedActions.
+constexpr int64_t kNestedActionCount = 100;
+
+void RunFineGrainedActions(benchmark::State& state, ThreadPool* thread_pool) {
+  for (auto _ : state) {
+    absl::BlockingCounter blocking_counter(kActionCount);
+    for (int64_t i = 0; i < kActionCount; ++i) {
+      thread_pool->Schedule([&blocking_counter] { blocking_counter.DecrementCount(); });
+    }
+    blocking_counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kActionCount);
+}
+
+// Like the post-processing of a capture split into chunks, where each action schedules more.
+void RunNestedActions(benchmark::State& state, ThreadPool* thread_pool) {
+  for (auto _ : state) {
+    absl::BlockingCounter blocking_counter(kActionCount);
+    for (int64_t i = 0; i < kActionCount / kNestedActionCount; ++i) {
+      thread_pool->Schedule([thread_pool, &blocking_counter] {
+        for (int64_t j = 0; j < kNestedActionCount; ++j) {
+          thread_pool->Schedule([&blocking_counter] { blocking_counter.DecrementCount(); });
+        }
+      });
+    }
+    blocking_counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kActionCount);
+}
+
+void BM_ThreadPool_FineGrainedActions(benchmark::State& state) {
+  const auto thread_count = static_cast<size_t>(state.range(0));
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(thread_count, thread_count, absl::Seconds(1));
+  RunFineGrainedActions(state, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+}
+
+void BM_WorkStealingThreadPool_FineGrainedActions(benchmark::State& state) {
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::CreateWorkStealing(static_cast<size_t>(state.range(0)));
+  RunFineGrainedActions(state, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+}
+
+void BM_ThreadPool_NestedActions(benchmark::State& state) {
+  const auto thread_count = static_cast<size_t>(state.range(0));
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(thread_count, thread_count, absl::Seconds(1));
+  RunNestedActions(state, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+}
+
+void BM_WorkStealingThreadPool_NestedActions(benchmark::State& state) {
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::CreateWorkStealing(static_cast<size_t>(state.range(0)));
+  RunNestedActions(state, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+}
+
+}  // namespace
+
+BENCHMARK(BM_ThreadPool_FineGrainedActions)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK(BM_WorkStealingThreadPool_FineGrainedActions)
+    ->RangeMultiplier(2)
+    ->Range(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_ThreadPool_NestedActions)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK(BM_WorkStealingThreadPool_NestedActions)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
@@ -0,0 +1,54 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitBase/ThreadWakeUp.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_base {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "The futex word must be a plain 32-bit integer");
+
+void ThreadWakeUp::SleepFor(absl::Duration timeout) {
+  uint32_t expected = kAwake;
+  if (!state_.compare_exchange_strong(expected, kSleeping)) {
+    // A WakeUp happened since the last SleepFor.
+    state_.store(kAwake);
+    return;
+  }
+  const timespec relative_timeout = absl::ToTimespec(timeout);
+  // The futex call returns immediately if WakeUp has already changed state_.
+  if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAIT_PRIVATE, kSleeping,
+              &relative_timeout, nullptr, 0) != 0 &&
+      errno != EAGAIN && errno != ETIMEDOUT && errno != EINTR) {
+    ERROR("Waiting on futex: %s", SafeStrerror(errno));
+  }
+  // WakeUps up to now are handled by the caller after this returns.
+  state_.store(kAwake);
+}
+
+void ThreadWakeUp::WakeUp() {
+  if (state_.load(std::memory_order_relaxed) == kWakeUpPending) {
+    return;
+  }
+  if (state_.exchange(kWakeUpPending) != kSleeping) {
+    return;
+  }
+  if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr,
+              nullptr, 0) < 0) {
+    ERROR("Waking up futex: %s", SafeStrerror(errno));
+  }
+}
+
+}  // namespace orbit_base
@@ -0,0 +1,49 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "OrbitBase/ThreadWakeUp.h"
+
+namespace orbit_base {
+
+TEST(ThreadWakeUp, SleepsForTimeout) {
+  ThreadWakeUp wake_up;
+  const absl::Time start = absl::Now();
+  wake_up.SleepFor(absl::Milliseconds(20));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(20));
+}
+
+TEST(ThreadWakeUp, WakeUpBeforeSleepForIsNotLost) {
+  ThreadWakeUp wake_up;
+  wake_up.WakeUp();
+  wake_up.WakeUp();
+  absl::Time start = absl::Now();
+  wake_up.SleepFor(absl::Seconds(10));
+  EXPECT_LT(absl::Now() - start, absl::Seconds(5));
+
+  // Only the next SleepFor returns immediately.
+  start = absl::Now();
+  wake_up.SleepFor(absl::Milliseconds(20));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(20));
+}
+
+TEST(ThreadWakeUp, WakeUpEndsSleepEarly) {
+  ThreadWakeUp wake_up;
+  std::thread waker{[&wake_up] {
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    wake_up.WakeUp();
+  }};
+  const absl::Time start = absl::Now();
+  wake_up.SleepFor(absl::Seconds(10));
+  EXPECT_LT(absl::Now() - start, absl::Seconds(5));
+  waker.join();
+}
+
+}  // namespace orbit_base
@@ -0,0 +1,194 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadPool.h"
+
+namespace {
+
+class WorkStealingThreadPoolImpl : public ThreadPool {
+ public:
+  explicit WorkStealingThreadPoolImpl(
+      size_t thread_count, std::function<void(const std::unique_ptr<Action>&)> run_action);
+
+  size_t GetPoolSize() override;
+  size_t GetNumberOfBusyThreads() override;
+  void Shutdown() override;
+  void Wait() override;
+
+ private:
+  // The queue of the actions of one worker thread. Its owner pushes and pops at the back, other
+  // worker threads steal from the front. Aligned to keep the queues in separate cache lines.
+  struct alignas(64) WorkerQueue {
+    absl::Mutex mutex;
+    std::deque<std::unique_ptr<Action>> actions ABSL_GUARDED_BY(mutex);
+  };
+
+  void ScheduleImpl(std::unique_ptr<Action> action) override;
+  std::unique_ptr<Action> PopLocalAction(size_t worker_index);
+  std::unique_ptr<Action> StealAction(size_t worker_index, std::minstd_rand* random_engine);
+  // Blocks until an action was scheduled or the shutdown was initiated. Returns false if the worker
+  // thread needs to exit, i.e., if the shutdown was initiated and no actions are left.
+  bool WaitForActions();
+  void WorkerFunction(size_t worker_index);
+
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+  std::function<void(const std::unique_ptr<Action>&)> run_action_ = nullptr;
+
+  // The number of actions in all queues. Worker threads only sleep when it is zero.
+  std::atomic<size_t> queued_actions_count_ = 0;
+  std::atomic<size_t> next_queue_index_ = 0;
+  std::atomic<size_t> busy_threads_count_ = 0;
+  // Worker threads only wait on `sleep_mutex_` when there is nothing to do, and scheduling only
+  // takes it to wake them up when some of them are sleeping.
+  std::atomic<size_t> sleeping_threads_count_ = 0;
+  std::atomic<bool> shutdown_initiated_ = false;
+  absl::Mutex sleep_mutex_;
+
+  absl::Mutex worker_threads_mutex_;
+  std::vector<std::thread> worker_threads_ ABSL_GUARDED_BY(worker_threads_mutex_);
+};
+
+// The thread pool and the index of the worker thread the current thread is, if any.
+thread_local const WorkStealingThreadPoolImpl* current_thread_pool = nullptr;
+thread_local size_t current_worker_index = 0;
+
+WorkStealingThreadPoolImpl::WorkStealingThreadPoolImpl(
+    size_t thread_count, std::function<void(const std::unique_ptr<Action>&)> run_action)
+    : run_action_(std::move(run_action)) {
+  CHECK(thread_count > 0);
+  worker_queues_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    worker_queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  absl::MutexLock lock(&worker_threads_mutex_);
+  worker_threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    worker_threads_.emplace_back([this, i] { WorkerFunction(i); });
+  }
+}
+
+void WorkStealingThreadPoolImpl::ScheduleImpl(std::unique_ptr<Action> action) {
+  CHECK(!shutdown_initiated_);
+  std::unique_ptr<Action> wrapped_action =
+      run_action_
+          ? CreateAction([this, action = std::move(action)]() mutable { run_action_(action); })
+          : std::move(action);
+
+  const size_t queue_index = current_thread_pool == this
+                                 ? current_worker_index
+                                 : next_queue_index_++ % worker_queues_.size();
+  WorkerQueue& queue = *worker_queues_[queue_index];
+  {
+    absl::MutexLock lock(&queue.mutex);
+    queue.actions.push_back(std::move(wrapped_action));
+  }
+
+  // A worker thread increments `sleeping_threads_count_` before checking `queued_actions_count_`,
+  // so either it sees the new action, or this sees it sleeping and wakes it up by releasing the
+  // mutex, which makes it evaluate its condition again.
+  ++queued_actions_count_;
+  if (sleeping_threads_count_ > 0) {
+    absl::MutexLock lock(&sleep_mutex_);
+  }
+}
+
+std::unique_ptr<Action> WorkStealingThreadPoolImpl::PopLocalAction(size_t worker_index) {
+  WorkerQueue& queue = *worker_queues_[worker_index];
+  absl::MutexLock lock(&queue.mutex);
+  if (queue.actions.empty()) return nullptr;
+  std::unique_ptr<Action> action = std::move(queue.actions.back());
+  queue.actions.pop_back();
+  --queued_actions_count_;
+  return action;
+}
+
+std::unique_ptr<Action> WorkStealingThreadPoolImpl::StealAction(size_t worker_index,
+                                                                std::minstd_rand* random_engine) {
+  const size_t queue_count = worker_queues_.size();
+  const size_t first_victim_index =
+      std::uniform_int_distribution<size_t>{0, queue_count - 1}(*random_engine);
+  for (size_t i = 0; i < queue_count; ++i) {
+    const size_t victim_index = (first_victim_index + i) % queue_count;
+    if (victim_index == worker_index) continue;
+    WorkerQueue& queue = *worker_queues_[victim_index];
+    absl::MutexLock lock(&queue.mutex);
+    if (queue.actions.empty()) continue;
+    std::unique_ptr<Action> action = std::move(queue.actions.front());
+    queue.actions.pop_front();
+    --queued_actions_count_;
+    return action;
+  }
+  return nullptr;
+}
+
+bool WorkStealingThreadPoolImpl::WaitForActions() {
+  ++sleeping_threads_count_;
+  absl::MutexLock lock(&sleep_mutex_);
+  sleep_mutex_.Await(absl::Condition(
+      +[](WorkStealingThreadPoolImpl* self) {
+        return self->queued_actions_count_ > 0 || self->shutdown_initiated_;
+      },
+      this));
+  --sleeping_threads_count_;
+  return queued_actions_count_ > 0;
+}
+
+void WorkStealingThreadPoolImpl::WorkerFunction(size_t worker_index) {
+  current_thread_pool = this;
+  current_worker_index = worker_index;
+  std::minstd_rand random_engine{static_cast<uint32_t>(worker_index + 1)};
+
+  while (true) {
+    std::unique_ptr<Action> action = PopLocalAction(worker_index);
+    if (action == nullptr) action = StealAction(worker_index, &random_engine);
+    if (action == nullptr) {
+      if (!WaitForActions()) break;
+      continue;
+    }
+
+    ++busy_threads_count_;
+    action->Execute();
+    --busy_threads_count_;
+  }
+}
+
+size_t WorkStealingThreadPoolImpl::GetPoolSize() { return worker_queues_.size(); }
+
+size_t WorkStealingThreadPoolImpl::GetNumberOfBusyThreads() { return busy_threads_count_; }
+
+void WorkStealingThreadPoolImpl::Shutdown() {
+  absl::MutexLock lock(&sleep_mutex_);
+  shutdown_initiated_ = true;
+}
+
+void WorkStealingThreadPoolImpl::Wait() {
+  CHECK(shutdown_initiated_);
+  absl::MutexLock lock(&worker_threads_mutex_);
+  for (std::thread& thread : worker_threads_) {
+    thread.join();
+  }
+  worker_threads_.clear();
+}
+
+}  // namespace
+
+std::shared_ptr<ThreadPool> ThreadPool::CreateWorkStealing(
+    size_t thread_count, std::function<void(const std::unique_ptr<Action>&)> run_action) {
+  // The base class `Executor` uses `std::enable_shared_from_this` and requires `ThreadPool` to be
+  // created as a `shared_ptr`.
+  return std::make_shared<WorkStealingThreadPoolImpl>(thread_count, std::move(run_action));
+}
@@ -0,0 +1,203 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/blocking_counter.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/Future.h"
+#include "OrbitBase/ThreadPool.h"
+
+TEST(WorkStealingThreadPool, Smoke) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2);
+  EXPECT_EQ(thread_pool->GetPoolSize(), 2);
+
+  absl::Mutex mutex;
+  bool called = false;
+  {
+    absl::MutexLock lock(&mutex);
+    thread_pool->Schedule([&]() {
+      absl::MutexLock lock(&mutex);
+      called = true;
+    });
+
+    EXPECT_FALSE(called);
+    EXPECT_TRUE(mutex.AwaitWithTimeout(absl::Condition(&called), absl::Milliseconds(100)));
+  }
+
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(WorkStealingThreadPool, QueuedActionsExecutedOnShutdown) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2);
+
+  constexpr size_t kNumberOfActions = 1000;
+  std::atomic<size_t> counter = 0;
+  for (size_t i = 0; i < kNumberOfActions; ++i) {
+    thread_pool->Schedule([&counter]() { ++counter; });
+  }
+
+  thread_pool->ShutdownAndWait();
+  EXPECT_EQ(counter, kNumberOfActions);
+}
+
+TEST(WorkStealingThreadPool, ActionsScheduledFromWorkerThreadsAreStolen) {
+  constexpr size_t kThreadCount = 4;
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(kThreadCount);
+
+  // A single action schedules all others, so they are all in the queue of one worker thread, and
+  // the other worker threads only get them by stealing.
+  constexpr size_t kNumberOfActions = 10000;
+  absl::BlockingCounter blocking_counter(kNumberOfActions);
+  absl::Mutex mutex;
+  std::vector<std::thread::id> thread_ids;
+  thread_pool->Schedule([&]() {
+    for (size_t i = 0; i < kNumberOfActions; ++i) {
+      thread_pool->Schedule([&]() {
+        {
+          absl::MutexLock lock(&mutex);
+          thread_ids.push_back(std::this_thread::get_id());
+        }
+        absl::SleepFor(absl::Microseconds(10));
+        blocking_counter.DecrementCount();
+      });
+    }
+  });
+  blocking_counter.Wait();
+
+  thread_pool->ShutdownAndWait();
+
+  absl::MutexLock lock(&mutex);
+  EXPECT_EQ(thread_ids.size(), kNumberOfActions);
+  std::sort(thread_ids.begin(), thread_ids.end());
+  const auto distinct_thread_count = static_cast<size_t>(
+      std::unique(thread_ids.begin(), thread_ids.end()) - thread_ids.begin());
+  EXPECT_GT(distinct_thread_count, 1);
+  EXPECT_LE(distinct_thread_count, kThreadCount);
+}
+
+TEST(WorkStealingThreadPool, ScheduleFromSeveralThreads) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(3);
+
+  constexpr size_t kNumberOfSchedulingThreads = 4;
+  constexpr size_t kNumberOfActionsPerThread = 1000;
+  std::atomic<size_t> counter = 0;
+  std::vector<std::thread> scheduling_threads;
+  for (size_t i = 0; i < kNumberOfSchedulingThreads; ++i) {
+    scheduling_threads.emplace_back([&]() {
+      for (size_t j = 0; j < kNumberOfActionsPerThread; ++j) {
+        thread_pool->Schedule([&counter]() { ++counter; });
+      }
+    });
+  }
+  for (std::thread& thread : scheduling_threads) {
+    thread.join();
+  }
+
+  thread_pool->ShutdownAndWait();
+  EXPECT_EQ(counter, kNumberOfSchedulingThreads * kNumberOfActionsPerThread);
+}
+
+TEST(WorkStealingThreadPool, CheckGetNumberOfBusyThreads) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2);
+  EXPECT_EQ(thread_pool->GetNumberOfBusyThreads(), 0);
+
+  absl::Mutex mutex;
+  bool can_finish = false;
+  thread_pool->Schedule([&]() {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(&can_finish));
+  });
+  for (int elapsed_ms = 0; thread_pool->GetNumberOfBusyThreads() == 0 && elapsed_ms < 100;
+       ++elapsed_ms) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(thread_pool->GetNumberOfBusyThreads(), 1);
+
+  {
+    absl::MutexLock lock(&mutex);
+    can_finish = true;
+  }
+  thread_pool->ShutdownAndWait();
+  EXPECT_EQ(thread_pool->GetNumberOfBusyThreads(), 0);
+}
+
+TEST(WorkStealingThreadPool, FutureBasic) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2);
+
+  orbit_base::Future<int> future = thread_pool->Schedule([]() { return 42; });
+  EXPECT_TRUE(future.IsValid());
+  for (int elapsed_ms = 0; !future.IsFinished() && elapsed_ms < 100; ++elapsed_ms) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  ASSERT_TRUE(future.IsFinished());
+  EXPECT_EQ(future.Get(), 42);
+
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(WorkStealingThreadPool, WithRunActionParameter) {
+  std::atomic<int> run_before_action_count = 0;
+  std::atomic<int> run_after_action_count = 0;
+  auto run_action = [&run_before_action_count,
+                     &run_after_action_count](const std::unique_ptr<Action>& action) {
+    ++run_before_action_count;
+    action->Execute();
+    ++run_after_action_count;
+  };
+
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2, run_action);
+
+  int run_before_action_count_during_execution = -1;
+  int run_after_action_count_during_execution = -1;
+  thread_pool->Schedule([&]() {
+    run_before_action_count_during_execution = run_before_action_count;
+    run_after_action_count_during_execution = run_after_action_count;
+  });
+
+  thread_pool->ShutdownAndWait();
+
+  EXPECT_EQ(run_before_action_count_during_execution, 1);
+  EXPECT_EQ(run_after_action_count_during_execution, 0);
+  EXPECT_EQ(run_before_action_count, 1);
+  EXPECT_EQ(run_after_action_count, 1);
+}
+
+TEST(WorkStealingThreadPool, InvalidArguments) {
+  EXPECT_DEATH(
+      {
+        auto thread_pool = ThreadPool::CreateWorkStealing(0);
+        thread_pool->ShutdownAndWait();
+      },
+      "");
+}
+
+TEST(WorkStealingThreadPool, NoShutdown) { EXPECT_DEATH(ThreadPool::CreateWorkStealing(2), ""); }
+
+TEST(WorkStealingThreadPool, ScheduleAfterShutdown) {
+  EXPECT_DEATH(
+      {
+        std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2);
+        thread_pool->Shutdown();
+        thread_pool->Schedule([] {});
+      },
+      "");
+}
+
+TEST(WorkStealingThreadPool, WaitWithoutShutdown) {
+  EXPECT_DEATH(
+      {
+        std::shared_ptr<ThreadPool> thread_pool = ThreadPool::CreateWorkStealing(2);
+        thread_pool->Wait();
+      },
+      "");
+}
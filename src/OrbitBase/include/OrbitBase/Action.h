@@ -5,6 +5,14 @@
 #ifndef ORBIT_BASE_ACTION_H_
 #define ORBIT_BASE_ACTION_H_
 
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "OrbitBase/SmallObjectPool.h"
+
 // Actions are executed by MainThreadExecutor
 // The Action is an abstract class which can
 // be executed.
@@ -18,6 +26,9 @@ class Action {
 };
 
 // This class implements an action without parameters.
+//
+// One action is created for every task scheduled on an executor, so its memory comes from the
+// small object pool instead of the global allocator.
 template <typename F>
 class NullaryFunctorAction : public Action {
  public:
@@ -27,6 +38,17 @@ class NullaryFunctorAction : public Action {
 
   void Execute() override { functor_(); }
 
+  static void* operator new(size_t size) { return orbit_base::AllocateSmallObject(size); }
+  static void operator delete(void* ptr, size_t size) {
+    orbit_base::DeallocateSmallObject(ptr, size);
+  }
+  static void* operator new(size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+  }
+  static void operator delete(void* ptr, std::align_val_t alignment) {
+    ::operator delete(ptr, alignment);
+  }
+
  private:
   F functor_;
 };
@@ -9,7 +9,11 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
+
+#include "OrbitBase/SmallObjectPool.h"
 
 namespace orbit_base {
 
@@ -26,47 +30,110 @@ class AnyInvocable;
 // std::cout << invocable(2) << std::endl; // Outputs 48
 template <typename R, typename... Args>
 class AnyInvocable<R(Args...)> {
-  struct Base {
-    constexpr Base() = default;
-    constexpr Base(Base&&) noexcept = default;
-    constexpr Base& operator=(Base&&) noexcept = default;
+ public:
+  // Function objects of up to this size are stored inline, without a heap allocation, as long as
+  // they are nothrow move-constructible. That covers the continuations of Future<T> and most
+  // lambdas capturing a handful of pointers. Larger function objects are allocated from the small
+  // object pool.
+  static constexpr size_t kInlineStorageSize = 6 * sizeof(void*);
 
-    constexpr Base(const Base&) = delete;
-    constexpr Base& operator=(const Base&) = delete;
+ private:
+  using Storage = std::aligned_storage_t<kInlineStorageSize, alignof(std::max_align_t)>;
 
-    virtual R invoke(Args...) = 0;
-    virtual ~Base() = default;
+  template <typename T>
+  static constexpr bool kIsStoredInline = sizeof(T) <= sizeof(Storage) &&
+                                          alignof(T) <= alignof(Storage) &&
+                                          std::is_nothrow_move_constructible_v<T>;
+
+  struct Operations {
+    R (*invoke)(Storage* storage, Args&&... args);
+    // Move-constructs the function object of `from` into `to` and destroys the one of `from`.
+    void (*relocate)(Storage* from, Storage* to) noexcept;
+    void (*destroy)(Storage* storage) noexcept;
   };
 
   template <typename T>
-  class Storage final : public Base {
-    T value_;
+  struct InlineOperations {
+    static T* Get(Storage* storage) { return std::launder(reinterpret_cast<T*>(storage)); }
 
-   public:
-    using Base::Base;
+    static R Invoke(Storage* storage, Args&&... args) {
+      return std::invoke(*Get(storage), std::forward<Args>(args)...);
+    }
+    static void Relocate(Storage* from, Storage* to) noexcept {
+      new (to) T(std::move(*Get(from)));
+      Get(from)->~T();
+    }
+    static void Destroy(Storage* storage) noexcept { Get(storage)->~T(); }
 
-    template <typename... Urgs>
-    constexpr explicit Storage(std::in_place_t, Urgs... args)
-        : value_{std::forward<Urgs>(args)...} {}
+    static constexpr Operations kOperations{&Invoke, &Relocate, &Destroy};
+  };
 
-    constexpr explicit Storage(const T& value) : value_(value) {}
-    constexpr explicit Storage(T&& value) : value_(std::move(value)) {}
+  template <typename T>
+  struct HeapOperations {
+    static T*& Get(Storage* storage) { return *std::launder(reinterpret_cast<T**>(storage)); }
 
-    constexpr R invoke(Args... args) noexcept override {
-      return std::invoke(value_, std::forward<Args>(args)...);
+    static R Invoke(Storage* storage, Args&&... args) {
+      return std::invoke(*Get(storage), std::forward<Args>(args)...);
+    }
+    static void Relocate(Storage* from, Storage* to) noexcept { new (to) T*{Get(from)}; }
+    static void Destroy(Storage* storage) noexcept {
+      SmallObjectAllocator<T> allocator;
+      Get(storage)->~T();
+      allocator.deallocate(Get(storage), 1);
     }
+
+    static constexpr Operations kOperations{&Invoke, &Relocate, &Destroy};
   };
 
-  std::unique_ptr<Base> storage_;
+  Storage storage_;
+  const Operations* operations_ = nullptr;
+
+  void Reset() noexcept {
+    if (operations_ == nullptr) return;
+    operations_->destroy(&storage_);
+    operations_ = nullptr;
+  }
 
  public:
-  template <typename F, typename = std::enable_if<!std::is_same_v<std::decay_t<F>, AnyInvocable>>>
-  constexpr explicit AnyInvocable(F&& func)
-      : storage_{std::make_unique<Storage<std::decay_t<F>>>(std::forward<F>(func))} {}
+  template <typename F,
+            typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, AnyInvocable>>>
+  explicit AnyInvocable(F&& func) {
+    using T = std::decay_t<F>;
+    if constexpr (kIsStoredInline<T>) {
+      new (&storage_) T(std::forward<F>(func));
+      operations_ = &InlineOperations<T>::kOperations;
+    } else {
+      SmallObjectAllocator<T> allocator;
+      T* value = allocator.allocate(1);
+      new (value) T(std::forward<F>(func));
+      new (&storage_) T*{value};
+      operations_ = &HeapOperations<T>::kOperations;
+    }
+  }
+
+  AnyInvocable(AnyInvocable&& other) noexcept : operations_{other.operations_} {
+    if (operations_ == nullptr) return;
+    operations_->relocate(&other.storage_, &storage_);
+    other.operations_ = nullptr;
+  }
+
+  AnyInvocable& operator=(AnyInvocable&& other) noexcept {
+    if (this == &other) return *this;
+    Reset();
+    if (other.operations_ == nullptr) return *this;
+    other.operations_->relocate(&other.storage_, &storage_);
+    operations_ = std::exchange(other.operations_, nullptr);
+    return *this;
+  }
+
+  AnyInvocable(const AnyInvocable&) = delete;
+  AnyInvocable& operator=(const AnyInvocable&) = delete;
+
+  ~AnyInvocable() { Reset(); }
 
-  constexpr explicit operator bool() const noexcept { return storage_ != nullptr; }
+  explicit operator bool() const noexcept { return operations_ != nullptr; }
 
-  constexpr R operator()(Args... args) { return storage_->invoke(std::forward<Args>(args)...); }
+  R operator()(Args... args) { return operations_->invoke(&storage_, std::forward<Args>(args)...); }
 
   friend bool operator==(const AnyInvocable& lhs, std::nullptr_t) {
     return !static_cast<bool>(lhs);
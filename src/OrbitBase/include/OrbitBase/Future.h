@@ -111,20 +111,20 @@ class InternalFuture : public orbit_base_internal::InternalFutureBase<T, Derived
  public:
   // Constructs a completed future
   /* explicit(false) */ InternalFuture(const T& val)
-      : InternalFutureBase<T, Derived>{std::make_shared<SharedState<T>>()} {
+      : InternalFutureBase<T, Derived>{MakeSharedState<T>()} {
     this->shared_state_->result.emplace(val);
   }
 
   // Constructs a completed future
   /* explicit(false) */ InternalFuture(T&& val)
-      : InternalFutureBase<T, Derived>{std::make_shared<SharedState<T>>()} {
+      : InternalFutureBase<T, Derived>{MakeSharedState<T>()} {
     this->shared_state_->result.emplace(std::move(val));
   }
 
   // Constructs a completed future
   template <typename... Args>
   explicit InternalFuture(std::in_place_t, Args&&... args)
-      : InternalFutureBase<T, Derived>{std::make_shared<SharedState<T>>()} {
+      : InternalFutureBase<T, Derived>{MakeSharedState<T>()} {
     this->shared_state_->result.emplace(std::forward<Args>(args)...);
   }
 
@@ -166,7 +166,7 @@ class InternalFuture<void, Derived>
   // Constructs a completed future
   explicit InternalFuture()
       : orbit_base_internal::InternalFutureBase<void, Derived>{
-            std::make_shared<orbit_base_internal::SharedState<void>>()} {
+            orbit_base_internal::MakeSharedState<void>()} {
     this->shared_state_->finished = true;
   }
 
@@ -7,6 +7,7 @@
 
 #include <sys/types.h>
 
+#include <string_view>
 #include <vector>
 
 #include "OrbitBase/Result.h"
@@ -22,6 +23,10 @@ std::vector<pid_t> GetTidsOfProcess(pid_t pid);
 
 // Get the process id of the tracer process or 0 if no tracer is attached.
 ErrorMessageOr<pid_t> GetTracerPidOfProcess(pid_t pid);
+
+// Get the process ids of the processes in the cgroup with this path relative to /sys/fs/cgroup,
+// for example "cpuset/game".
+ErrorMessageOr<std::vector<pid_t>> GetPidsOfCgroup(std::string_view cgroup_path);
 #endif
 
 }  // namespace orbit_base
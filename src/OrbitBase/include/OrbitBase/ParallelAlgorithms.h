@@ -0,0 +1,294 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_PARALLEL_ALGORITHMS_H_
+#define ORBIT_BASE_PARALLEL_ALGORITHMS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Future.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Promise.h"
+#include "OrbitBase/StopSource.h"
+#include "OrbitBase/ThreadPool.h"
+
+namespace orbit_base {
+
+struct ParallelOptions {
+  // The smallest number of indices (or elements) that a task takes at once. Chunks start with a
+  // fraction of the whole range and get smaller as the range is used up, down to this size.
+  size_t min_chunk_size = 1;
+  // Once a stop is requested, no further chunks are started.
+  StopToken stop_token;
+};
+
+}  // namespace orbit_base
+
+namespace orbit_base_internal {
+
+// Hands out the chunks of the range [begin, end) to the tasks of a parallel algorithm. Each chunk
+// is a fraction of the remaining indices, so chunks are large at first, which keeps the overhead
+// low, and small towards the end, which balances the load when the tasks progress unevenly.
+class ChunkDispenser {
+ public:
+  ChunkDispenser(size_t begin, size_t end, size_t min_chunk_size, size_t task_count)
+      : next_(begin), end_(end), min_chunk_size_(std::max<size_t>(min_chunk_size, 1)),
+        task_count_(task_count) {}
+
+  // Returns false when the range is used up.
+  [[nodiscard]] bool ClaimChunk(size_t* chunk_begin, size_t* chunk_end) {
+    size_t begin = next_.load(std::memory_order_relaxed);
+    size_t size;
+    do {
+      if (begin >= end_) return false;
+      const size_t remaining = end_ - begin;
+      size = std::min(remaining, std::max(min_chunk_size_, remaining / (2 * task_count_)));
+    } while (!next_.compare_exchange_weak(begin, begin + size, std::memory_order_relaxed));
+    *chunk_begin = begin;
+    *chunk_end = begin + size;
+    return true;
+  }
+
+ private:
+  std::atomic<size_t> next_;
+  const size_t end_;
+  const size_t min_chunk_size_;
+  const size_t task_count_;
+};
+
+// The number of actions to schedule for `index_count` indices. The thread pool might not have
+// started all its worker threads yet, hence this is at least the number of hardware threads.
+[[nodiscard]] inline size_t GetParallelTaskCount(ThreadPool* thread_pool, size_t index_count,
+                                                 size_t min_chunk_size) {
+  const size_t thread_count =
+      std::max<size_t>({thread_pool->GetPoolSize(), std::thread::hardware_concurrency(), 1});
+  const size_t chunk_size = std::max<size_t>(min_chunk_size, 1);
+  return std::min(thread_count, (index_count + chunk_size - 1) / chunk_size);
+}
+
+// Schedules the tasks of a parallel algorithm on `thread_pool`. Each task calls
+// `run_chunk(chunk_begin, chunk_end, task_index)` for the chunks it claims, and the task that
+// finishes last calls `on_done()`. `on_done` is called right away if the range is empty.
+template <typename RunChunk, typename OnDone>
+void RunChunksInParallel(ThreadPool* thread_pool, size_t begin, size_t end, size_t task_count,
+                         const orbit_base::ParallelOptions& options, RunChunk&& run_chunk,
+                         OnDone&& on_done) {
+  if (begin >= end || task_count == 0) {
+    on_done();
+    return;
+  }
+
+  struct State {
+    State(size_t begin, size_t end, size_t task_count, const orbit_base::ParallelOptions& options,
+          RunChunk&& run_chunk, OnDone&& on_done)
+        : chunk_dispenser(begin, end, options.min_chunk_size, task_count),
+          stop_token(options.stop_token),
+          remaining_task_count(task_count),
+          run_chunk(std::forward<RunChunk>(run_chunk)),
+          on_done(std::forward<OnDone>(on_done)) {}
+
+    ChunkDispenser chunk_dispenser;
+    orbit_base::StopToken stop_token;
+    std::atomic<size_t> remaining_task_count;
+    std::decay_t<RunChunk> run_chunk;
+    std::decay_t<OnDone> on_done;
+  };
+  auto state = std::make_shared<State>(begin, end, task_count, options,
+                                       std::forward<RunChunk>(run_chunk),
+                                       std::forward<OnDone>(on_done));
+
+  for (size_t task_index = 0; task_index < task_count; ++task_index) {
+    (void)thread_pool->Schedule([state, task_index] {
+      size_t chunk_begin;
+      size_t chunk_end;
+      while (!state->stop_token.IsStopRequested() &&
+             state->chunk_dispenser.ClaimChunk(&chunk_begin, &chunk_end)) {
+        state->run_chunk(chunk_begin, chunk_end, task_index);
+      }
+      if (--state->remaining_task_count == 0) {
+        state->on_done();
+      }
+    });
+  }
+}
+
+template <typename RandomIt, typename Compare>
+void MergeSortedRunsInParallel(ThreadPool* thread_pool, RandomIt first,
+                               std::shared_ptr<std::vector<size_t>> run_bounds, Compare comp,
+                               const orbit_base::ParallelOptions& options,
+                               orbit_base::Promise<void> promise) {
+  // `run_bounds` holds the start of each sorted run followed by the end of the last one.
+  const size_t run_count = run_bounds->size() - 1;
+  if (run_count <= 1 || options.stop_token.IsStopRequested()) {
+    promise.MarkFinished();
+    return;
+  }
+
+  const size_t pair_count = run_count / 2;
+  auto merge_pair = [first, run_bounds, comp](size_t chunk_begin, size_t chunk_end,
+                                              size_t /*task_index*/) {
+    for (size_t pair = chunk_begin; pair < chunk_end; ++pair) {
+      const std::vector<size_t>& bounds = *run_bounds;
+      std::inplace_merge(first + bounds[2 * pair], first + bounds[2 * pair + 1],
+                         first + bounds[2 * pair + 2], comp);
+    }
+  };
+  auto merge_next_round = [thread_pool, first, run_bounds, comp, options,
+                           promise = std::move(promise)]() mutable {
+    auto merged_run_bounds = std::make_shared<std::vector<size_t>>();
+    for (size_t i = 0; i < run_bounds->size(); i += 2) {
+      merged_run_bounds->push_back((*run_bounds)[i]);
+    }
+    if (run_bounds->size() % 2 == 0) merged_run_bounds->push_back(run_bounds->back());
+    MergeSortedRunsInParallel(thread_pool, first, std::move(merged_run_bounds), comp, options,
+                              std::move(promise));
+  };
+
+  orbit_base::ParallelOptions merge_options = options;
+  merge_options.min_chunk_size = 1;
+  RunChunksInParallel(thread_pool, 0, pair_count,
+                      GetParallelTaskCount(thread_pool, pair_count, merge_options.min_chunk_size),
+                      merge_options, std::move(merge_pair), std::move(merge_next_round));
+}
+
+}  // namespace orbit_base_internal
+
+namespace orbit_base {
+
+// ParallelFor, ParallelReduce, and ParallelSort split their work into chunks that are processed
+// by actions scheduled on `thread_pool`, and return a future that completes when all of them are
+// done, without blocking the calling thread. As with any call of ThreadPool::Schedule, the thread
+// pool must not be shut down until the future completed, and everything the functions refer to
+// must outlive it.
+//
+// Example:
+// std::vector<uint64_t> sizes = ...;
+// StopSource stop_source;
+// ParallelReduce(thread_pool, 0, sizes.size(), uint64_t{0},
+//                [&sizes](size_t index) { return sizes[index]; }, std::plus<>{},
+//                {/*min_chunk_size=*/1024, stop_source.GetStopToken()})
+//     .Then(main_thread_executor, [](const std::optional<uint64_t>& total_size) { ... });
+
+// Calls `body(index)` for each index in [begin, end). `body` is called concurrently from several
+// threads. If a stop is requested, the remaining indices are skipped.
+template <typename Body>
+[[nodiscard]] Future<void> ParallelFor(ThreadPool* thread_pool, size_t begin, size_t end,
+                                       Body&& body, const ParallelOptions& options = {}) {
+  Promise<void> promise;
+  Future<void> future = promise.GetFuture();
+  const size_t task_count =
+      begin < end
+          ? orbit_base_internal::GetParallelTaskCount(thread_pool, end - begin,
+                                                      options.min_chunk_size)
+          : 0;
+  orbit_base_internal::RunChunksInParallel(
+      thread_pool, begin, end, task_count, options,
+      [body = std::forward<Body>(body)](size_t chunk_begin, size_t chunk_end,
+                                        size_t /*task_index*/) {
+        for (size_t index = chunk_begin; index < chunk_end; ++index) {
+          body(index);
+        }
+      },
+      [promise = std::move(promise)]() mutable { promise.MarkFinished(); });
+  return future;
+}
+
+// Combines `map(index)` for each index in [begin, end) with `reduce`, starting from `identity`.
+// As the indices are combined in no particular order, `reduce` must be associative and
+// commutative, and `identity` its identity element. `map` and `reduce` are called concurrently
+// from several threads. The result is std::nullopt if a stop was requested.
+template <typename T, typename Map, typename Reduce>
+[[nodiscard]] Future<std::optional<T>> ParallelReduce(ThreadPool* thread_pool, size_t begin,
+                                                      size_t end, T identity, Map&& map,
+                                                      Reduce&& reduce,
+                                                      const ParallelOptions& options = {}) {
+  Promise<std::optional<T>> promise;
+  Future<std::optional<T>> future = promise.GetFuture();
+  const size_t task_count =
+      begin < end
+          ? orbit_base_internal::GetParallelTaskCount(thread_pool, end - begin,
+                                                      options.min_chunk_size)
+          : 0;
+
+  // Each task accumulates into its own partial result, which are combined by the last task.
+  auto partial_results = std::make_shared<std::vector<T>>(task_count, identity);
+  auto shared_reduce = std::make_shared<std::decay_t<Reduce>>(std::forward<Reduce>(reduce));
+  orbit_base_internal::RunChunksInParallel(
+      thread_pool, begin, end, task_count, options,
+      [map = std::forward<Map>(map), partial_results, shared_reduce](
+          size_t chunk_begin, size_t chunk_end, size_t task_index) {
+        T& partial_result = (*partial_results)[task_index];
+        for (size_t index = chunk_begin; index < chunk_end; ++index) {
+          partial_result = (*shared_reduce)(std::move(partial_result), map(index));
+        }
+      },
+      [partial_results, shared_reduce, identity = std::move(identity),
+       stop_token = options.stop_token, promise = std::move(promise)]() mutable {
+        if (stop_token.IsStopRequested()) {
+          promise.SetResult(std::nullopt);
+          return;
+        }
+        T result = std::move(identity);
+        for (T& partial_result : *partial_results) {
+          result = (*shared_reduce)(std::move(result), std::move(partial_result));
+        }
+        promise.SetResult(std::move(result));
+      });
+  return future;
+}
+
+// Sorts [first, last) with `comp`, by sorting runs of the range in parallel and then merging
+// pairs of runs in parallel until only one is left. If a stop is requested, the range is left
+// partially sorted.
+template <typename RandomIt, typename Compare = std::less<>>
+[[nodiscard]] Future<void> ParallelSort(ThreadPool* thread_pool, RandomIt first, RandomIt last,
+                                        Compare comp = Compare{},
+                                        const ParallelOptions& options = {}) {
+  Promise<void> promise;
+  Future<void> future = promise.GetFuture();
+  const auto element_count = static_cast<size_t>(std::distance(first, last));
+  const size_t run_count =
+      element_count == 0 ? 0
+                         : orbit_base_internal::GetParallelTaskCount(thread_pool, element_count,
+                                                                     options.min_chunk_size);
+  if (run_count <= 1) {
+    std::sort(first, last, comp);
+    promise.MarkFinished();
+    return future;
+  }
+
+  auto run_bounds = std::make_shared<std::vector<size_t>>();
+  for (size_t run = 0; run <= run_count; ++run) {
+    run_bounds->push_back(element_count * run / run_count);
+  }
+
+  // Each run is sorted as a whole, hence chunks of one run each.
+  ParallelOptions sort_options = options;
+  sort_options.min_chunk_size = 1;
+  orbit_base_internal::RunChunksInParallel(
+      thread_pool, 0, run_count, run_count, sort_options,
+      [first, run_bounds, comp](size_t chunk_begin, size_t chunk_end, size_t /*task_index*/) {
+        for (size_t run = chunk_begin; run < chunk_end; ++run) {
+          std::sort(first + (*run_bounds)[run], first + (*run_bounds)[run + 1], comp);
+        }
+      },
+      [thread_pool, first, run_bounds, comp, options, promise = std::move(promise)]() mutable {
+        orbit_base_internal::MergeSortedRunsInParallel(thread_pool, first, run_bounds, comp,
+                                                       options, std::move(promise));
+      });
+  return future;
+}
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_PARALLEL_ALGORITHMS_H_
@@ -12,6 +12,16 @@
 #include <time.h>
 #endif
 
+#include <optional>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace orbit_base {
 
 // CaptureTimestampNs() provides timestamps to place events on Orbit's main capture timeline.
@@ -39,6 +49,48 @@ constexpr clockid_t kOrbitCaptureClock = CLOCK_MONOTONIC;
 
 #endif
 
+// CaptureTimestampTsc() reads the time stamp counter of the CPU, which is considerably cheaper than
+// CaptureTimestampNs(). It is meant for the hottest instrumentation paths, which send the raw value
+// and leave the conversion to the capture clock to OrbitService, using a TscCalibration. Only use
+// it if IsTscUsableForCaptureTimestamps() returns true. Returns 0 on other architectures.
+[[nodiscard]] inline uint64_t CaptureTimestampTsc() {
+#if defined(__x86_64__) || defined(_M_X64)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Returns true if the CPU has an invariant time stamp counter, i.e., one that increases at a
+// constant rate regardless of frequency scaling and sleep states, such that time stamp counter
+// values can be converted to the capture clock.
+[[nodiscard]] bool IsTscUsableForCaptureTimestamps();
+
+// A time stamp counter value and CaptureTimestampNs() read at (almost) the same time.
+struct TscSample {
+  uint64_t timestamp_ns = 0;
+  uint64_t tsc = 0;
+};
+
+// Reads the time stamp counter and the capture clock a few times and returns the pair that was
+// read within the shortest time.
+[[nodiscard]] TscSample SampleTscAndCaptureTimestamp();
+
+// Relates the time stamp counter to the capture clock.
+struct TscCalibration {
+  TscSample reference;
+  uint64_t tsc_frequency_hz = 0;
+};
+
+// Computes a TscCalibration from two samples, with `end` as the reference. The longer the time
+// between the two samples, the more accurate the frequency. Returns std::nullopt if the samples
+// don't allow to compute a frequency.
+[[nodiscard]] std::optional<TscCalibration> ComputeTscCalibration(const TscSample& start,
+                                                                  const TscSample& end);
+
+// Converts a value of CaptureTimestampTsc() to the time domain of CaptureTimestampNs().
+[[nodiscard]] uint64_t TscToCaptureTimestampNs(uint64_t tsc, const TscCalibration& calibration);
+
 // Estimates the clock resolution for debugging purposes. Should only be used to display this
 // information to the user or log it.
 [[nodiscard]] uint64_t EstimateClockResolution();
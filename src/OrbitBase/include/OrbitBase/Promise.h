@@ -21,7 +21,7 @@ namespace orbit_base_internal {
 template <typename T>
 class PromiseBase {
  public:
-  explicit PromiseBase() : shared_state_{std::make_shared<SharedState<T>>()} {}
+  explicit PromiseBase() : shared_state_{MakeSharedState<T>()} {}
   PromiseBase(const PromiseBase&) = delete;
   PromiseBase& operator=(const PromiseBase&) = delete;
   PromiseBase(PromiseBase&&) = default;
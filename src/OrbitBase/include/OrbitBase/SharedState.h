@@ -5,24 +5,28 @@
 #ifndef ORBIT_BASE_SHARED_STATE_H_
 #define ORBIT_BASE_SHARED_STATE_H_
 
+#include <absl/container/inlined_vector.h>
 #include <absl/synchronization/mutex.h>
 
+#include <memory>
 #include <optional>
 #include <variant>
-#include <vector>
 
 #include "OrbitBase/AnyInvocable.h"
+#include "OrbitBase/SmallObjectPool.h"
 
 namespace orbit_base_internal {
 
 // SharedState<T> is an implementation detail of the Future<T> / Promise<T> facility.
 //
 // Don't use this class outside of Promise<T> / Future<T>!
+//
+// Most futures get at most one continuation, so the first one is stored inline.
 template <typename T>
 struct SharedState {
   absl::Mutex mutex;
   std::optional<T> result;
-  std::vector<orbit_base::AnyInvocable<void(const T&)>> continuations;
+  absl::InlinedVector<orbit_base::AnyInvocable<void(const T&)>, 1> continuations;
 
   [[nodiscard]] bool IsFinished() const { return result.has_value(); }
 };
@@ -31,11 +35,18 @@ template <>
 struct SharedState<void> {
   absl::Mutex mutex;
   bool finished = false;
-  std::vector<orbit_base::AnyInvocable<void()>> continuations;
+  absl::InlinedVector<orbit_base::AnyInvocable<void()>, 1> continuations;
 
   [[nodiscard]] bool IsFinished() const { return finished; }
 };
 
+// A shared state and the control block of its shared_ptr are allocated together from the small
+// object pool, as one is created for every task scheduled on an executor.
+template <typename T>
+[[nodiscard]] std::shared_ptr<SharedState<T>> MakeSharedState() {
+  return std::allocate_shared<SharedState<T>>(orbit_base::SmallObjectAllocator<SharedState<T>>{});
+}
+
 }  // namespace orbit_base_internal
 
 #endif  // ORBIT_BASE_SHARED_STATE_H_
\ No newline at end of file
@@ -0,0 +1,69 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_SMALL_OBJECT_POOL_H_
+#define ORBIT_BASE_SMALL_OBJECT_POOL_H_
+
+#include <cstddef>
+#include <new>
+
+namespace orbit_base {
+
+// The small object pool recycles the memory of small, short-lived objects like the actions,
+// continuations and shared states of futures, which are created for every task scheduled on an
+// executor. Freed blocks are kept in per-thread free lists of a few size classes (up to
+// `kMaxSmallObjectSize` bytes), so that in a steady state neither allocating nor freeing touches
+// the global allocator or any lock. A block may be freed on a different thread than the one that
+// allocated it. Larger requests are forwarded to the global `operator new`.
+//
+// The returned memory is aligned for any type with an alignment of at most
+// `__STDCPP_DEFAULT_NEW_ALIGNMENT__`.
+constexpr size_t kMaxSmallObjectSize = 256;
+
+[[nodiscard]] void* AllocateSmallObject(size_t size);
+// `size` has to be the size that was passed to `AllocateSmallObject`.
+void DeallocateSmallObject(void* ptr, size_t size) noexcept;
+
+// An allocator satisfying the standard Allocator requirements, backed by the small object pool.
+// Use it with `std::allocate_shared` to also pool the control block of a `std::shared_ptr`.
+template <typename T>
+class SmallObjectAllocator {
+ public:
+  using value_type = T;
+
+  SmallObjectAllocator() = default;
+  template <typename U>
+  /* explicit(false) */ SmallObjectAllocator(const SmallObjectAllocator<U>& /*other*/) noexcept {}
+
+  [[nodiscard]] T* allocate(size_t count) {
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+      return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{alignof(T)}));
+    } else {
+      return static_cast<T*>(AllocateSmallObject(count * sizeof(T)));
+    }
+  }
+
+  void deallocate(T* ptr, size_t count) noexcept {
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+      ::operator delete(ptr, std::align_val_t{alignof(T)});
+    } else {
+      DeallocateSmallObject(ptr, count * sizeof(T));
+    }
+  }
+
+  template <typename U>
+  friend bool operator==(const SmallObjectAllocator& /*lhs*/,
+                         const SmallObjectAllocator<U>& /*rhs*/) {
+    return true;
+  }
+  template <typename U>
+  friend bool operator!=(const SmallObjectAllocator& /*lhs*/,
+                         const SmallObjectAllocator<U>& /*rhs*/) {
+    return false;
+  }
+};
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_SMALL_OBJECT_POOL_H_
@@ -0,0 +1,51 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_STOP_SOURCE_H_
+#define ORBIT_BASE_STOP_SOURCE_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace orbit_base {
+
+// A StopToken tells long running work, e.g., the parallel algorithms of ParallelAlgorithms.h,
+// whether the corresponding StopSource requested it to stop, similar to std::stop_token of C++20.
+// A default constructed StopToken never requests a stop.
+class StopToken {
+ public:
+  StopToken() = default;
+
+  [[nodiscard]] bool IsStopRequested() const {
+    return stop_requested_ != nullptr && stop_requested_->load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class StopSource;
+  explicit StopToken(std::shared_ptr<const std::atomic<bool>> stop_requested)
+      : stop_requested_(std::move(stop_requested)) {}
+
+  std::shared_ptr<const std::atomic<bool>> stop_requested_;
+};
+
+// A StopSource requests the work that got one of its StopTokens to stop. Copies of a StopSource
+// share the same state.
+class StopSource {
+ public:
+  StopSource() : stop_requested_(std::make_shared<std::atomic<bool>>(false)) {}
+
+  void RequestStop() { stop_requested_->store(true, std::memory_order_relaxed); }
+  [[nodiscard]] bool IsStopRequested() const {
+    return stop_requested_->load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] StopToken GetStopToken() const { return StopToken{stop_requested_}; }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> stop_requested_;
+};
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_STOP_SOURCE_H_
@@ -69,6 +69,20 @@ class ThreadPool : public orbit_base::Executor {
   static std::shared_ptr<ThreadPool> Create(
       size_t thread_pool_min_size, size_t thread_pool_max_size, absl::Duration thread_ttl,
       std::function<void(const std::unique_ptr<Action>&)> run_action = nullptr);
+
+  // Create a work-stealing ThreadPool with a fixed number of worker threads, for many fine-grained
+  // actions, where a single queue shared by all worker threads would be contended.
+  //
+  // Each worker thread has its own queue. Actions scheduled from a worker thread are put in its
+  // queue, the others are distributed over the queues in turn. A worker thread takes the action it
+  // scheduled last from its own queue, and when its queue is empty it steals the oldest action from
+  // the queue of another worker thread, starting at a random one. Hence, actions are not executed
+  // in the order in which they were scheduled.
+  //
+  // The run_action parameter has the same meaning as for Create.
+  static std::shared_ptr<ThreadPool> CreateWorkStealing(
+      size_t thread_count,
+      std::function<void(const std::unique_ptr<Action>&)> run_action = nullptr);
 };
 
 #endif  // ORBIT_BASE_THREAD_POOL_H_
@@ -0,0 +1,35 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_THREAD_WAKE_UP_H_
+#define ORBIT_BASE_THREAD_WAKE_UP_H_
+
+#include <absl/time/time.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace orbit_base {
+
+// This class allows one thread to sleep for up to a timeout, and other threads to wake it up early.
+// A WakeUp while the thread isn't sleeping makes its next SleepFor return immediately, so that no
+// WakeUp is lost. It's based on a futex: WakeUp only costs an atomic load if there already is a
+// pending WakeUp, and only makes a system call if the thread is actually sleeping. This makes it
+// cheap enough to be called from a fast path.
+class ThreadWakeUp {
+ public:
+  // Must only be called by one thread at a time.
+  void SleepFor(absl::Duration timeout);
+  void WakeUp();
+
+ private:
+  static constexpr uint32_t kAwake = 0;
+  static constexpr uint32_t kSleeping = 1;
+  static constexpr uint32_t kWakeUpPending = 2;
+  std::atomic<uint32_t> state_ = kAwake;
+};
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_THREAD_WAKE_UP_H_
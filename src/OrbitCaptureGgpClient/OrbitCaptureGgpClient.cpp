@@ -20,6 +20,8 @@
 #include "services_ggp.grpc.pb.h"
 #include "services_ggp.pb.h"
 
+using orbit_grpc_protos::SaveFlightRecorderSnapshotRequest;
+using orbit_grpc_protos::SaveFlightRecorderSnapshotResponse;
 using orbit_grpc_protos::ShutdownServiceRequest;
 using orbit_grpc_protos::ShutdownServiceResponse;
 using orbit_grpc_protos::StartCaptureRequest;
@@ -38,6 +40,7 @@ class CaptureClientGgpClient::CaptureClientGgpClientImpl {
 
   [[nodiscard]] ErrorMessageOr<void> StartCapture();
   [[nodiscard]] ErrorMessageOr<void> StopCapture();
+  [[nodiscard]] ErrorMessageOr<void> SaveFlightRecorderSnapshot();
   [[nodiscard]] ErrorMessageOr<void> UpdateSelectedFunctions(
       const std::vector<std::string>& selected_functions);
   void ShutdownService();
@@ -69,6 +72,15 @@ int CaptureClientGgpClient::StopCapture() {
   return 1;
 }
 
+int CaptureClientGgpClient::SaveFlightRecorderSnapshot() {
+  ErrorMessageOr<void> result = pimpl->SaveFlightRecorderSnapshot();
+  if (result.has_error()) {
+    ERROR("Not possible to save flight recorder snapshot: %s", result.error().message());
+    return 0;
+  }
+  return 1;
+}
+
 int CaptureClientGgpClient::UpdateSelectedFunctions(
     const std::vector<std::string>& selected_functions) {
   ErrorMessageOr<void> result = pimpl->UpdateSelectedFunctions(selected_functions);
@@ -132,6 +144,23 @@ ErrorMessageOr<void> CaptureClientGgpClient::CaptureClientGgpClientImpl::StopCap
   return outcome::success();
 }
 
+ErrorMessageOr<void>
+CaptureClientGgpClient::CaptureClientGgpClientImpl::SaveFlightRecorderSnapshot() {
+  SaveFlightRecorderSnapshotRequest request;
+  SaveFlightRecorderSnapshotResponse response;
+  auto context = std::make_unique<ClientContext>();
+
+  Status status =
+      capture_client_ggp_service_->SaveFlightRecorderSnapshot(context.get(), request, &response);
+  if (!status.ok()) {
+    ERROR("gRPC call to SaveFlightRecorderSnapshot failed: %s (error_code=%d)",
+          status.error_message(), status.error_code());
+    return ErrorMessage(status.error_message());
+  }
+  LOG("Flight recorder snapshot requested");
+  return outcome::success();
+}
+
 ErrorMessageOr<void> CaptureClientGgpClient::CaptureClientGgpClientImpl::UpdateSelectedFunctions(
     const std::vector<std::string>& selected_functions) {
   UpdateSelectedFunctionsRequest request;
@@ -18,6 +18,9 @@ class CaptureClientGgpClient {
 
   int StartCapture();
   int StopCapture();
+  // Appends the events of the last flight recorder window to the capture file, if the service
+  // captures in flight recorder mode.
+  int SaveFlightRecorderSnapshot();
   int UpdateSelectedFunctions(const std::vector<std::string>& selected_functions);
   void ShutdownService();
 
@@ -31,7 +31,8 @@ int main(int argc, char** argv) {
   constexpr const int kStartCaptureCommand = 1;
   constexpr const int kStopAndSaveCaptureCommand = 2;
   constexpr const int kUpdateSelectedFunctionsCommand = 3;
-  constexpr const int kShutdownServiceCommand = 4;
+  constexpr const int kSaveFlightRecorderSnapshotCommand = 4;
+  constexpr const int kShutdownServiceCommand = 5;
   bool exit = false;
   while (!exit) {
     int i;
@@ -41,6 +42,7 @@ int main(int argc, char** argv) {
     std::cout << kStartCaptureCommand << " Start capture\n";
     std::cout << kStopAndSaveCaptureCommand << " Stop and save capture\n";
     std::cout << kUpdateSelectedFunctionsCommand << " Hook functions\n";
+    std::cout << kSaveFlightRecorderSnapshotCommand << " Save flight recorder snapshot\n";
     std::cout << kShutdownServiceCommand << " Shutdown service and exit\n";
     std::cout << "\n";
     std::cout << "Introduce your choice (" << kStartCaptureCommand << "-" << kShutdownServiceCommand
@@ -69,6 +71,10 @@ int main(int argc, char** argv) {
         ggp_capture_client.UpdateSelectedFunctions(selected_functions);
         break;
       }
+      case kSaveFlightRecorderSnapshotCommand:
+        LOG("Chosen %d: Save flight recorder snapshot", i);
+        ggp_capture_client.SaveFlightRecorderSnapshot();
+        break;
       case kShutdownServiceCommand:
         LOG("Chosen %d: Shutdown service and exit", i);
         exit = true;
@@ -25,11 +25,14 @@ ABSL_DECLARE_FLAG(int32_t, pid);
 ABSL_DECLARE_FLAG(std::vector<std::string>, functions);
 ABSL_DECLARE_FLAG(std::string, file_name);
 ABSL_DECLARE_FLAG(std::string, file_directory);
+ABSL_DECLARE_FLAG(uint32_t, flight_recorder_window_s);
 
 using grpc::ServerContext;
 using grpc::Status;
 using grpc::StatusCode;
 
+using orbit_grpc_protos::SaveFlightRecorderSnapshotRequest;
+using orbit_grpc_protos::SaveFlightRecorderSnapshotResponse;
 using orbit_grpc_protos::ShutdownServiceRequest;
 using orbit_grpc_protos::ShutdownServiceResponse;
 using orbit_grpc_protos::StartCaptureRequest;
@@ -54,6 +57,8 @@ void CaptureClientGgpServiceImpl::InitClientGgp() {
   client_ggp_options.capture_functions = absl::GetFlag(FLAGS_functions);
   client_ggp_options.capture_file_name = absl::GetFlag(FLAGS_file_name);
   client_ggp_options.capture_file_directory = absl::GetFlag(FLAGS_file_directory);
+  client_ggp_options.flight_recorder_window_ns =
+      absl::GetFlag(FLAGS_flight_recorder_window_s) * uint64_t{1'000'000'000};
 
   client_ggp_ = std::make_unique<ClientGgp>(std::move(client_ggp_options));
   if (!client_ggp_->InitClient()) {
@@ -92,6 +97,19 @@ Status CaptureClientGgpServiceImpl::StopCapture(grpc::ServerContext* /*context*/
   return Status::OK;
 }
 
+Status CaptureClientGgpServiceImpl::SaveFlightRecorderSnapshot(
+    grpc::ServerContext* /*context*/, const SaveFlightRecorderSnapshotRequest* /*request*/,
+    SaveFlightRecorderSnapshotResponse* /*response*/) {
+  LOG("SaveFlightRecorderSnapshot grpc call received");
+  if (!CaptureIsRunning()) {
+    return Status(StatusCode::FAILED_PRECONDITION, "No capture is running");
+  }
+  if (!client_ggp_->RequestFlightRecorderSnapshot()) {
+    return Status(StatusCode::INTERNAL, "Not possible to request the flight recorder snapshot");
+  }
+  return Status::OK;
+}
+
 Status CaptureClientGgpServiceImpl::UpdateSelectedFunctions(
     grpc::ServerContext* /*context*/, const UpdateSelectedFunctionsRequest* request,
     UpdateSelectedFunctionsResponse* /* response */) {
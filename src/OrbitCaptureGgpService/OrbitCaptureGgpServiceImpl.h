@@ -28,6 +28,11 @@ class CaptureClientGgpServiceImpl final
                                          const orbit_grpc_protos::StopCaptureRequest* request,
                                          orbit_grpc_protos::StopCaptureResponse* response) override;
 
+  [[nodiscard]] grpc::Status SaveFlightRecorderSnapshot(
+      grpc::ServerContext* context,
+      const orbit_grpc_protos::SaveFlightRecorderSnapshotRequest* request,
+      orbit_grpc_protos::SaveFlightRecorderSnapshotResponse* response) override;
+
   [[nodiscard]] grpc::Status UpdateSelectedFunctions(
       grpc::ServerContext* context,
       const orbit_grpc_protos::UpdateSelectedFunctionsRequest* request,
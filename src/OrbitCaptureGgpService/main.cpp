@@ -31,6 +31,9 @@ ABSL_FLAG(bool, frame_pointer_unwinding, false, "Use frame pointers for unwindin
 ABSL_FLAG(bool, thread_state, false, "Collect thread states");
 ABSL_FLAG(uint64_t, max_local_marker_depth_per_command_buffer, std::numeric_limits<uint64_t>::max(),
           "Max local marker depth per command buffer");
+ABSL_FLAG(uint32_t, flight_recorder_window_s, 0,
+          "If not 0, captures only keep the events of the last this many seconds, and append them "
+          "to the capture file on SaveFlightRecorderSnapshot and when the capture is stopped");
 
 namespace {
 
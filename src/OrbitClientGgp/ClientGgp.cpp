@@ -29,6 +29,7 @@
 #include "ClientData/UserDefinedCaptureData.h"
 #include "ClientModel/CaptureSerializer.h"
 #include "ClientModel/SamplingDataPostProcessor.h"
+#include "FunctionStatsEventProcessor.h"
 #include "GrpcProtos/Constants.h"
 #include "OrbitBase/Future.h"
 #include "OrbitBase/ImmediateExecutor.h"
@@ -89,7 +90,9 @@ bool ClientGgp::InitClient() {
   if (!InitCapture()) {
     return false;
   }
-  capture_client_ = std::make_unique<CaptureClient>(grpc_channel_);
+  capture_client_ = std::make_unique<CaptureClient>(
+      grpc_channel_, orbit_grpc_protos::CaptureOptions::kNoCompression,
+      /*save_capture_file_on_service=*/false, options_.flight_recorder_window_ns);
 
   return true;
 }
@@ -121,10 +124,7 @@ ErrorMessageOr<void> ClientGgp::RequestStartCapture(ThreadPool* thread_pool) {
 
   LOG("Saving capture to \"%s\"", file_path.string());
 
-  OUTCOME_TRY(event_processor, CaptureEventProcessor::CreateSaveToFileProcessor(
-                                   GenerateFilePath(), [](const ErrorMessage& error) {
-                                     ERROR("%s", error.message());
-                                   }));
+  OUTCOME_TRY(event_processor, CreateCaptureEventProcessor(file_path));
 
   Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> result = capture_client_->Capture(
       thread_pool, target_process_->pid(), module_manager_, selected_functions_,
@@ -138,28 +138,68 @@ ErrorMessageOr<void> ClientGgp::RequestStartCapture(ThreadPool* thread_pool) {
   result.Then(&executor, [](ErrorMessageOr<CaptureListener::CaptureOutcome> result) {
     if (!result.has_value()) {
       ERROR("Capture failed: %s", result.error().message());
+      return;
     }
 
     // We do not send try aborting capture - it cannot be cancelled.
     CHECK(result.value() == CaptureListener::CaptureOutcome::kComplete);
   });
+  capture_result_ = std::move(result);
+  ++capture_index_;
 
   return outcome::success();
 }
 
+ErrorMessageOr<std::unique_ptr<CaptureEventProcessor>> ClientGgp::CreateCaptureEventProcessor(
+    const std::filesystem::path& file_path) {
+  OUTCOME_TRY(save_to_file_processor,
+              CaptureEventProcessor::CreateSaveToFileProcessor(
+                  file_path, [](const ErrorMessage& error) { ERROR("%s", error.message()); }));
+  if (!options_.save_function_stats_summary) return std::move(save_to_file_processor);
+
+  std::filesystem::path summary_file_path = file_path;
+  summary_file_path.replace_extension(".function_stats.csv");
+  std::vector<std::unique_ptr<CaptureEventProcessor>> event_processors;
+  event_processors.push_back(std::move(save_to_file_processor));
+  event_processors.push_back(std::make_unique<FunctionStatsEventProcessor>(
+      std::move(summary_file_path), selected_functions_));
+  return CaptureEventProcessor::CreateCompositeProcessor(std::move(event_processors));
+}
+
 bool ClientGgp::StopCapture() {
   LOG("Request to stop capture");
   return capture_client_->StopCapture();
 }
 
+bool ClientGgp::RequestFlightRecorderSnapshot() {
+  if (!capture_client_->IsFlightRecorderEnabled()) {
+    ERROR("Flight recorder snapshot requested, but the capture is not in flight recorder mode");
+    return false;
+  }
+  return capture_client_->RequestFlightRecorderSnapshot();
+}
+
+ErrorMessageOr<void> ClientGgp::WaitForCaptureToFinish() {
+  if (!capture_result_.has_value()) return outcome::success();
+  capture_result_->Wait();
+  const ErrorMessageOr<CaptureListener::CaptureOutcome>& result = capture_result_->Get();
+  if (result.has_error()) return result.error();
+  return outcome::success();
+}
+
 std::filesystem::path ClientGgp::GenerateFilePath() {
+  // Captures taken in the same second would otherwise get the same generated name.
+  const std::string suffix =
+      options_.capture_count > 1 ? absl::StrFormat("_%u", capture_index_ + 1) : "";
   std::string file_name = options_.capture_file_name;
   if (file_name.empty()) {
     file_name = orbit_client_model::capture_serializer::GenerateCaptureFileName(
-        target_process_->name(), absl::Now());
+        target_process_->name(), absl::Now(), suffix);
   } else {
     // Make sure the file is saved with orbit extension
     orbit_client_model::capture_serializer::IncludeOrbitExtensionInFile(file_name);
+    std::filesystem::path file_name_path{file_name};
+    file_name = file_name_path.stem().string() + suffix + file_name_path.extension().string();
   }
 
   // Add the location where the capture is saved
@@ -256,7 +296,7 @@ void ClientGgp::LoadSelectedFunctions() {
     if (!selected_functions_.empty()) {
       LOG("List of selected functions to hook in the capture:");
       for (auto const& [address, selected_function] : selected_functions_) {
-        LOG("%d %s", address, selected_function.pretty_name());
+        LOG("%d %s", address, orbit_client_data::function_utils::GetDisplayName(selected_function));
       }
     }
   } else {
@@ -280,7 +320,8 @@ void ClientGgp::InformUsedSelectedCaptureFunctions(
 
 std::string ClientGgp::SelectedFunctionMatch(const FunctionInfo& func) {
   for (const std::string& selected_function : options_.capture_functions) {
-    if (func.pretty_name().find(selected_function) != std::string::npos) {
+    if (orbit_client_data::function_utils::GetDisplayName(func).find(selected_function) !=
+        std::string::npos) {
       return selected_function;
     }
   }
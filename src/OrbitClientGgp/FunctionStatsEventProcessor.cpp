@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FunctionStatsEventProcessor.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_replace.h>
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ClientData/FunctionStatsUtils.h"
+#include "ClientData/FunctionUtils.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::FunctionInfo;
+using orbit_client_protos::FunctionStats;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FunctionCallBatch;
+
+namespace {
+
+// Function names, e.g., of templates, can contain commas.
+[[nodiscard]] std::string QuoteForCsv(std::string_view value) {
+  return absl::StrFormat("\"%s\"", absl::StrReplaceAll(value, {{"\"", "\"\""}}));
+}
+
+[[nodiscard]] std::string FormatPercentileForCsv(const FunctionStats& stats, double percentile) {
+  std::optional<uint64_t> percentile_ns =
+      orbit_client_data::GetDurationPercentileNs(stats, percentile);
+  return percentile_ns.has_value() ? std::to_string(percentile_ns.value()) : "";
+}
+
+}  // namespace
+
+void FunctionStatsEventProcessor::ProcessEvent(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kFunctionCall:
+      AddFunctionCall(event.function_call().function_id(), event.function_call().duration_ns());
+      break;
+    case ClientCaptureEvent::kFunctionCallBatch: {
+      const FunctionCallBatch& batch = event.function_call_batch();
+      if (batch.function_id_size() != batch.duration_ns_size()) {
+        ERROR("FunctionCallBatch has columns of different sizes");
+        break;
+      }
+      for (int i = 0; i < batch.function_id_size(); ++i) {
+        AddFunctionCall(batch.function_id(i), batch.duration_ns(i));
+      }
+      break;
+    }
+    case ClientCaptureEvent::kCaptureFinished: {
+      ErrorMessageOr<void> write_result = WriteSummary();
+      if (write_result.has_error()) {
+        ERROR("Unable to write function stats summary: %s", write_result.error().message());
+      } else {
+        LOG("Saved function stats summary to \"%s\"", summary_file_path_.string());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void FunctionStatsEventProcessor::AddFunctionCall(uint64_t function_id, uint64_t duration_ns) {
+  orbit_client_data::AddFunctionCallToStats(duration_ns, &function_id_to_stats_[function_id]);
+}
+
+ErrorMessageOr<void> FunctionStatsEventProcessor::WriteSummary() const {
+  OUTCOME_TRY(fd, orbit_base::OpenFileForWriting(summary_file_path_));
+
+  // Sorted by total time, so that the functions that matter the most come first.
+  std::vector<std::pair<uint64_t, const FunctionStats*>> sorted_stats;
+  sorted_stats.reserve(function_id_to_stats_.size());
+  for (const auto& [function_id, stats] : function_id_to_stats_) {
+    sorted_stats.emplace_back(function_id, &stats);
+  }
+  std::sort(sorted_stats.begin(), sorted_stats.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second->total_time_ns() > rhs.second->total_time_ns();
+  });
+
+  std::string summary =
+      "function,module,count,total_ns,average_ns,min_ns,max_ns,p50_ns,p90_ns,p99_ns\n";
+  for (const auto& [function_id, stats] : sorted_stats) {
+    std::string function_name;
+    std::string module_path;
+    auto function_it = instrumented_functions_.find(function_id);
+    if (function_it != instrumented_functions_.end()) {
+      const FunctionInfo& function = function_it->second;
+      function_name = orbit_client_data::function_utils::GetDisplayName(function);
+      module_path = function.module_path();
+    } else {
+      function_name = absl::StrFormat("function id %u", function_id);
+    }
+    summary.append(absl::StrFormat(
+        "%s,%s,%u,%u,%u,%u,%u,%s,%s,%s\n", QuoteForCsv(function_name), QuoteForCsv(module_path),
+        stats->count(), stats->total_time_ns(), stats->average_time_ns(), stats->min_ns(),
+        stats->max_ns(), FormatPercentileForCsv(*stats, 0.5), FormatPercentileForCsv(*stats, 0.9),
+        FormatPercentileForCsv(*stats, 0.99)));
+  }
+
+  return orbit_base::WriteFully(fd, summary);
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_GGP_FUNCTION_STATS_EVENT_PROCESSOR_H_
+#define ORBIT_CLIENT_GGP_FUNCTION_STATS_EVENT_PROCESSOR_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+#include "CaptureClient/CaptureEventProcessor.h"
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+// Accumulates the FunctionStats of the instrumented functions from the FunctionCall events of a
+// capture and, when the CaptureFinished event arrives, writes them as CSV to `summary_file_path`,
+// one row per function that was called at least once.
+class FunctionStatsEventProcessor : public orbit_capture_client::CaptureEventProcessor {
+ public:
+  explicit FunctionStatsEventProcessor(
+      std::filesystem::path summary_file_path,
+      absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo> instrumented_functions)
+      : summary_file_path_{std::move(summary_file_path)},
+        instrumented_functions_{std::move(instrumented_functions)} {}
+
+  void ProcessEvent(const orbit_grpc_protos::ClientCaptureEvent& event) override;
+
+ private:
+  void AddFunctionCall(uint64_t function_id, uint64_t duration_ns);
+  [[nodiscard]] ErrorMessageOr<void> WriteSummary() const;
+
+  std::filesystem::path summary_file_path_;
+  absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo> instrumented_functions_;
+  absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionStats> function_id_to_stats_;
+};
+
+#endif  // ORBIT_CLIENT_GGP_FUNCTION_STATS_EVENT_PROCESSOR_H_
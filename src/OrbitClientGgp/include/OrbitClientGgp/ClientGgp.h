@@ -10,6 +10,7 @@
 #include <grpcpp/grpcpp.h>
 
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
@@ -17,6 +18,7 @@
 #include <vector>
 
 #include "CaptureClient/CaptureClient.h"
+#include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureClient/CaptureListener.h"
 #include "ClientData/ModuleData.h"
 #include "ClientData/ModuleManager.h"
@@ -25,6 +27,7 @@
 #include "ClientData/UserDefinedCaptureData.h"
 #include "ClientModel/CaptureData.h"
 #include "ClientServices/ProcessClient.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/ThreadPool.h"
@@ -42,12 +45,19 @@ class ClientGgp {
   bool InitClient();
   ErrorMessageOr<void> RequestStartCapture(ThreadPool* thread_pool);
   bool StopCapture();
+  // Only has an effect if the capture runs in flight recorder mode, see
+  // ClientGgpOptions::flight_recorder_window_ns.
+  bool RequestFlightRecorderSnapshot();
+  // Blocks until the capture last requested has been saved, so that the next one can be started.
+  ErrorMessageOr<void> WaitForCaptureToFinish();
   void UpdateCaptureFunctions(std::vector<std::string> capture_functions);
 
   // CaptureListener implementation
 
  private:
   std::filesystem::path GenerateFilePath();
+  ErrorMessageOr<std::unique_ptr<orbit_capture_client::CaptureEventProcessor>>
+  CreateCaptureEventProcessor(const std::filesystem::path& file_path);
 
   ClientGgpOptions options_;
   std::shared_ptr<grpc::Channel> grpc_channel_;
@@ -57,6 +67,10 @@ class ClientGgp {
   orbit_client_data::ModuleData* main_module_ = nullptr;
   std::unique_ptr<orbit_capture_client::CaptureClient> capture_client_;
   std::unique_ptr<orbit_client_services::ProcessClient> process_client_;
+  std::optional<orbit_base::Future<
+      ErrorMessageOr<orbit_capture_client::CaptureListener::CaptureOutcome>>>
+      capture_result_;
+  uint32_t capture_index_ = 0;
 
   ErrorMessageOr<std::unique_ptr<orbit_client_data::ProcessData>> GetOrbitProcessByPid(int32_t pid);
   bool InitCapture();
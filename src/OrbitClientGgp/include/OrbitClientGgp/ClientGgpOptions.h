@@ -5,6 +5,7 @@
 #ifndef ORBIT_CLIENT_GGP_CLIENT_GGP_OPTIONS_H_
 #define ORBIT_CLIENT_GGP_CLIENT_GGP_OPTIONS_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -20,6 +21,13 @@ struct ClientGgpOptions {
   double samples_per_second;
   uint16_t stack_dump_size;
   bool use_framepointer_unwinding;
+  // When more than one capture is taken, the file name of each capture gets its index as suffix.
+  uint32_t capture_count = 1;
+  // Writes a CSV file with the stats of the instrumented functions next to each capture file.
+  bool save_function_stats_summary = false;
+  // If not 0, the capture runs in flight recorder mode: the service only keeps the events of the
+  // last this many nanoseconds, and sends them when a snapshot is requested or the capture stops.
+  uint64_t flight_recorder_window_ns = 0;
 };
 
 #endif  // ORBIT_CLIENT_GGP_CLIENT_GGP_OPTIONS_H_
\ No newline at end of file
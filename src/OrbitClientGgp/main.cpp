@@ -26,6 +26,12 @@
 ABSL_FLAG(uint64_t, grpc_port, 44765, "Grpc service's port");
 ABSL_FLAG(int32_t, pid, 0, "pid to capture");
 ABSL_FLAG(uint32_t, capture_length, 10, "duration of capture in seconds");
+ABSL_FLAG(uint32_t, capture_start_delay, 0, "seconds to wait before starting the first capture");
+ABSL_FLAG(uint32_t, capture_count, 1,
+          "number of captures to take one after the other, each saved to its own file");
+ABSL_FLAG(uint32_t, capture_interval, 0, "seconds to wait between consecutive captures");
+ABSL_FLAG(bool, function_stats_summary, false,
+          "Save a CSV file with the stats of the hooked functions next to each capture file");
 ABSL_FLAG(std::vector<std::string>, functions, {},
           "Comma-separated list of functions to hook to the capture");
 ABSL_FLAG(std::string, file_name, "", "File name used for saving the capture");
@@ -79,6 +85,12 @@ int main(int argc, char** argv) {
   CHECK(stack_dump_size <= 65000);
   options.stack_dump_size = stack_dump_size;
   options.use_framepointer_unwinding = absl::GetFlag(FLAGS_frame_pointer_unwinding);
+  const uint32_t capture_count = absl::GetFlag(FLAGS_capture_count);
+  if (capture_count == 0) {
+    FATAL("The number of captures must be positive; set using -capture_count");
+  }
+  options.capture_count = capture_count;
+  options.save_function_stats_summary = absl::GetFlag(FLAGS_function_stats_summary);
 
   ClientGgp client_ggp(std::move(options));
   if (!client_ggp.InitClient()) {
@@ -88,22 +100,45 @@ int main(int argc, char** argv) {
   // The request is done in a separate thread to avoid blocking main()
   // It is needed to provide a thread pool
   std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(1, 1, absl::Seconds(1));
-  auto start_capture_result = client_ggp.RequestStartCapture(thread_pool.get());
-  if (start_capture_result.has_error()) {
-    thread_pool->ShutdownAndWait();
-    FATAL("Unable to start capture: %s", start_capture_result.error().message());
-  }
 
-  // Captures for the period of time requested
-  uint32_t capture_length = absl::GetFlag(FLAGS_capture_length);
-  LOG("Go to sleep for %d seconds", capture_length);
-  absl::SleepFor(absl::Seconds(capture_length));
-  LOG("Back from sleep");
+  const uint32_t capture_start_delay = absl::GetFlag(FLAGS_capture_start_delay);
+  if (capture_start_delay > 0) {
+    LOG("Wait for %d seconds before starting to capture", capture_start_delay);
+    absl::SleepFor(absl::Seconds(capture_start_delay));
+  }
 
-  // Requests to stop the capture and waits for thread to finish
-  if (!client_ggp.StopCapture()) {
-    thread_pool->ShutdownAndWait();
-    FATAL("Unable to stop the capture; exiting");
+  for (uint32_t capture_index = 0; capture_index < capture_count; ++capture_index) {
+    const uint32_t capture_interval = absl::GetFlag(FLAGS_capture_interval);
+    if (capture_index > 0 && capture_interval > 0) {
+      LOG("Wait for %d seconds before starting the next capture", capture_interval);
+      absl::SleepFor(absl::Seconds(capture_interval));
+    }
+
+    LOG("Starting capture %d of %d", capture_index + 1, capture_count);
+    auto start_capture_result = client_ggp.RequestStartCapture(thread_pool.get());
+    if (start_capture_result.has_error()) {
+      thread_pool->ShutdownAndWait();
+      FATAL("Unable to start capture: %s", start_capture_result.error().message());
+    }
+
+    // Captures for the period of time requested
+    uint32_t capture_length = absl::GetFlag(FLAGS_capture_length);
+    LOG("Go to sleep for %d seconds", capture_length);
+    absl::SleepFor(absl::Seconds(capture_length));
+    LOG("Back from sleep");
+
+    // Requests to stop the capture and waits for thread to finish
+    if (!client_ggp.StopCapture()) {
+      thread_pool->ShutdownAndWait();
+      FATAL("Unable to stop the capture; exiting");
+    }
+
+    // The next capture can only start once this one has been fully received and saved.
+    auto wait_result = client_ggp.WaitForCaptureToFinish();
+    if (wait_result.has_error()) {
+      thread_pool->ShutdownAndWait();
+      FATAL("Capture failed: %s", wait_result.error().message());
+    }
   }
 
   LOG("Shut down the thread and wait for it to finish");
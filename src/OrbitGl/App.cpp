@@ -16,6 +16,7 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cinttypes>
 #include <cstddef>
@@ -35,12 +36,15 @@
 #include "CaptureClient/CaptureListener.h"
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileHelpers.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "CaptureFile/CaptureSectionEventReader.h"
 #include "CaptureFileInfo/Manager.h"
 #include "CaptureWindow.h"
 #include "ClientData/CallstackData.h"
 #include "ClientData/FunctionUtils.h"
 #include "ClientData/ModuleData.h"
 #include "ClientData/ModuleManager.h"
+#include "ClientData/PackedTimerInfo.h"
 #include "ClientData/PostProcessedSamplingData.h"
 #include "ClientData/ProcessData.h"
 #include "ClientData/TextBox.h"
@@ -48,6 +52,7 @@
 #include "ClientData/UserDefinedCaptureData.h"
 #include "ClientModel/CaptureDeserializer.h"
 #include "ClientModel/CaptureSerializer.h"
+#include "ClientModel/CriticalPath.h"
 #include "ClientModel/SamplingDataPostProcessor.h"
 #include "CodeReport/Disassembler.h"
 #include "CodeReport/DisassemblyReport.h"
@@ -68,12 +73,14 @@
 #include "MetricsUploader/ScopedMetric.h"
 #include "ModulesDataView.h"
 #include "ObjectUtils/ElfFile.h"
+#include "OrbitBase/Append.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Future.h"
 #include "OrbitBase/FutureHelpers.h"
 #include "OrbitBase/ImmediateExecutor.h"
 #include "OrbitBase/JoinFutures.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/ThreadConstants.h"
 #include "OrbitBase/UniqueResource.h"
@@ -92,6 +99,19 @@
 ABSL_DECLARE_FLAG(bool, devmode);
 ABSL_DECLARE_FLAG(bool, local);
 ABSL_DECLARE_FLAG(bool, enable_tracepoint_feature);
+ABSL_DECLARE_FLAG(uint32_t, capture_compression);
+ABSL_DECLARE_FLAG(bool, save_capture_on_instance);
+ABSL_DECLARE_FLAG(uint32_t, flight_recorder_window_s);
+ABSL_DECLARE_FLAG(bool, collect_gpu_pipeline_statistics);
+ABSL_DECLARE_FLAG(bool, sample_process_memory_with_perf_events);
+ABSL_DECLARE_FLAG(bool, collect_memory_callstacks);
+ABSL_DECLARE_FLAG(bool, collect_kernel_callstacks);
+ABSL_DECLARE_FLAG(uint32_t, pipeline_latency_probe_period);
+ABSL_DECLARE_FLAG(uint32_t, statistics_summary_interval_s);
+ABSL_DECLARE_FLAG(uint32_t, api_track_value_coalescing_interval_ms);
+ABSL_DECLARE_FLAG(bool, compensate_instrumentation_overhead);
+ABSL_DECLARE_FLAG(bool, compress_saved_captures);
+ABSL_DECLARE_FLAG(uint32_t, symbol_preloading_budget_mb);
 
 using orbit_base::Future;
 
@@ -127,6 +147,7 @@ using orbit_client_services::TracepointServiceClient;
 using orbit_gl::MainWindowInterface;
 
 using orbit_grpc_protos::CaptureFinished;
+using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::CaptureStarted;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_grpc_protos::CrashOrbitServiceRequest_CrashType;
@@ -226,6 +247,31 @@ orbit_metrics_uploader::CaptureStartData CreateCaptureStartData(
   return capture_start_data;
 }
 
+// Bottom-up views with more sampled callstacks than this are built lazily, so that they can be
+// shown immediately. The search in the call tree only finds the nodes that were already expanded.
+constexpr size_t kMaxSampledCallstackCountForEagerBottomUpView = 100'000;
+
+// Debug information files are copied from the remote in parallel over the same connection.
+// More parallel copies don't make the connection faster, and delay the parsing of the first files.
+constexpr size_t kMaxConcurrentRemoteFileCopies = 4;
+
+std::unique_ptr<CallTreeView> CreateBottomUpView(
+    const PostProcessedSamplingData& post_processed_sampling_data, const CaptureData& capture_data,
+    ThreadPool* thread_pool, const std::atomic<bool>* cancelled = nullptr) {
+  size_t sampled_callstack_count = 0;
+  for (const orbit_client_data::ThreadSampleData& thread_sample_data :
+       post_processed_sampling_data.GetThreadSampleData()) {
+    if (thread_sample_data.thread_id == orbit_base::kAllProcessThreadsTid) continue;
+    sampled_callstack_count += thread_sample_data.sampled_callstack_id_to_count.size();
+  }
+  if (sampled_callstack_count > kMaxSampledCallstackCountForEagerBottomUpView) {
+    return CallTreeView::CreateLazyBottomUpViewFromPostProcessedSamplingData(
+        post_processed_sampling_data, capture_data);
+  }
+  return CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+      post_processed_sampling_data, capture_data, thread_pool, cancelled);
+}
+
 }  // namespace
 
 bool DoZoom = false;
@@ -270,6 +316,8 @@ OrbitApp::OrbitApp(orbit_gl::MainWindowInterface* main_window,
 
 OrbitApp::~OrbitApp() {
   AbortCapture();
+  CancelSelectionPostProcessing();
+  CancelTimerQuery();
 
   thread_pool_->ShutdownAndWait();
   core_count_sized_thread_pool_->ShutdownAndWait();
@@ -281,6 +329,13 @@ void OrbitApp::OnCaptureFinished(const CaptureFinished& capture_finished) {
       case orbit_grpc_protos::CaptureFinished::kSuccessful: {
         main_window_->AppendToCaptureLog(MainWindowInterface::CaptureLogSeverity::kInfo,
                                          GetCaptureTime(), "Capture finished.");
+        if (!capture_finished.capture_file_path().empty()) {
+          main_window_->AppendToCaptureLog(
+              MainWindowInterface::CaptureLogSeverity::kInfo, GetCaptureTime(),
+              absl::StrFormat("Capture saved on the instance to \"%s\".",
+                              capture_finished.capture_file_path()));
+          instance_capture_file_path_ = capture_finished.capture_file_path();
+        }
       } break;
       case orbit_grpc_protos::CaptureFinished::kFailed: {
         SendErrorToUi("Capture Failed", capture_finished.error_message());
@@ -322,6 +377,13 @@ void OrbitApp::OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture
         // this task is completely executed.
         capture_data_ = std::make_unique<CaptureData>(
             module_manager_.get(), capture_started, file_path, std::move(frame_track_function_ids));
+        // The live functions show the final statistics right away, while the timers are loaded.
+        if (is_loading_capture_ && loaded_capture_summary_.has_value()) {
+          const auto& function_stats = loaded_capture_summary_->function_stats();
+          capture_data_->SetPrecomputedFunctionStats(
+              absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionStats>{
+                  function_stats.begin(), function_stats.end()});
+        }
         capture_window_->CreateTimeGraph(capture_data_.get());
         TrackManager* track_manager = GetMutableTimeGraph()->GetTrackManager();
         track_manager->SetIsDataFromSavedCapture(is_loading_capture_);
@@ -355,15 +417,36 @@ Future<void> OrbitApp::OnCaptureComplete() {
   }
 
   GetMutableCaptureData().FilterBrokenCallstacks();
-  PostProcessedSamplingData post_processed_sampling_data =
-      orbit_client_model::CreatePostProcessedSamplingData(*GetCaptureData().GetCallstackData(),
-                                                          GetCaptureData());
+  PostProcessedSamplingData post_processed_sampling_data;
+  if (is_loading_capture_ && loaded_capture_summary_.has_value()) {
+    // Spares going through all the callstack events again.
+    absl::flat_hash_map<ThreadID, absl::flat_hash_map<uint64_t, uint32_t>>
+        thread_id_to_callstack_id_to_count;
+    for (const auto& thread_counts : loaded_capture_summary_->thread_callstack_counts()) {
+      absl::flat_hash_map<uint64_t, uint32_t>& callstack_id_to_count =
+          thread_id_to_callstack_id_to_count[thread_counts.tid()];
+      for (const auto& [callstack_id, count] : thread_counts.callstack_id_to_count()) {
+        callstack_id_to_count[callstack_id] = static_cast<uint32_t>(count);
+      }
+    }
+    post_processed_sampling_data =
+        orbit_client_model::CreatePostProcessedSamplingDataFromCallstackCounts(
+            *GetCaptureData().GetCallstackData(), thread_id_to_callstack_id_to_count,
+            GetCaptureData());
+  } else {
+    post_processed_sampling_data = orbit_client_model::CreatePostProcessedSamplingData(
+        *GetCaptureData().GetCallstackData(), GetCaptureData());
+  }
 
   LOG("The capture contains %u intervals with incomplete data",
       GetCaptureData().incomplete_data_intervals().size());
 
+  std::unique_ptr<orbit_gl::FlameGraph> flame_graph =
+      CreateFlameGraph(post_processed_sampling_data, GetCaptureData());
+
   return main_thread_executor_->Schedule(
-      [this, sampling_profiler = std::move(post_processed_sampling_data)]() mutable {
+      [this, sampling_profiler = std::move(post_processed_sampling_data),
+       flame_graph = std::move(flame_graph)]() mutable {
         ORBIT_SCOPE("OnCaptureComplete");
         TrySaveUserDefinedCaptureInfo();
         RefreshFrameTracks();
@@ -374,6 +457,26 @@ Future<void> OrbitApp::OnCaptureComplete() {
                           GetCaptureData().GetCallstackData()->GetUniqueCallstacksCopy());
         SetTopDownView(GetCaptureData());
         SetBottomUpView(GetCaptureData());
+        SetFlameGraph(std::move(flame_graph));
+
+        // The callstacks recorded when threads blocked are shown in the selection views, weighted
+        // by the time spent off-CPU, until samples are selected in the capture window.
+        const CallstackData* off_cpu_callstack_data = GetCaptureData().GetOffCpuCallstackData();
+        if (off_cpu_callstack_data->GetCallstackEventsCount() > 0) {
+          std::vector<CallstackEvent> off_cpu_callstack_events;
+          off_cpu_callstack_data->ForEachCallstackEvent(
+              [&off_cpu_callstack_events](const CallstackEvent& event) {
+                off_cpu_callstack_events.push_back(event);
+              });
+          SelectCallstackEvents(off_cpu_callstack_events, orbit_base::kAllProcessThreadsTid);
+        }
+
+        const CallstackData* memory_callstack_data = GetCaptureData().GetMemoryCallstackData();
+        if (memory_callstack_data->GetCallstackEventsCount() > 0) {
+          SetMemoryHotspotsReport(orbit_client_model::CreatePostProcessedSamplingData(
+                                      *memory_callstack_data, GetCaptureData()),
+                                  memory_callstack_data->GetUniqueCallstacksCopy());
+        }
 
         CHECK(capture_stopped_callback_);
         capture_stopped_callback_();
@@ -413,8 +516,10 @@ void OrbitApp::OnTimer(const TimerInfo& timer_info) {
   }
 
   CaptureData& capture_data = GetMutableCaptureData();
-  uint64_t elapsed_nanos = timer_info.end() - timer_info.start();
-  capture_data.UpdateFunctionStats(timer_info.function_id(), elapsed_nanos);
+  if (!capture_data.has_precomputed_function_stats()) {
+    uint64_t elapsed_nanos = timer_info.end() - timer_info.start();
+    capture_data.UpdateFunctionStats(timer_info.function_id(), elapsed_nanos);
+  }
 
   const InstrumentedFunction& func =
       capture_data.instrumented_functions().at(timer_info.function_id());
@@ -484,14 +589,19 @@ void OrbitApp::UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload(
   }
 }
 
-void OrbitApp::OnModuleUpdate(uint64_t /*timestamp_ns*/, ModuleInfo module_info) {
+void OrbitApp::OnModuleUpdate(int32_t pid, uint64_t /*timestamp_ns*/, ModuleInfo module_info) {
   UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload({module_info});
+  // The modules of the additional processes of the capture are only known to the ModuleManager, so
+  // that they can be symbolized, but they don't belong to the memory map of the target process.
+  if (pid != GetCaptureData().process_id()) return;
   GetMutableCaptureData().mutable_process()->AddOrUpdateModuleInfo(module_info);
   main_thread_executor_->Schedule([this]() { FireRefreshCallbacks(DataViewType::kLiveFunctions); });
 }
 
-void OrbitApp::OnModulesSnapshot(uint64_t /*timestamp_ns*/, std::vector<ModuleInfo> module_infos) {
+void OrbitApp::OnModulesSnapshot(int32_t pid, uint64_t /*timestamp_ns*/,
+                                 std::vector<ModuleInfo> module_infos) {
   UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload(module_infos);
+  if (pid != GetCaptureData().process_id()) return;
   GetMutableCaptureData().mutable_process()->UpdateModuleInfos(module_infos);
   main_thread_executor_->Schedule([this]() { FireRefreshCallbacks(DataViewType::kLiveFunctions); });
 }
@@ -537,6 +647,22 @@ void OrbitApp::OnClockResolutionEvent(
   });
 }
 
+void OrbitApp::OnCaptureStartLatencyEvent(
+    orbit_grpc_protos::CaptureStartLatencyEvent capture_start_latency_event) {
+  main_thread_executor_->Schedule([this, capture_start_latency_event]() {
+    std::vector<std::string> phases;
+    for (const auto& phase : capture_start_latency_event.phases()) {
+      phases.push_back(absl::StrFormat("%s: %.0f ms", phase.name(), phase.duration_ns() / 1e6));
+    }
+    main_window_->AppendToCaptureLog(
+        MainWindowInterface::CaptureLogSeverity::kInfo,
+        GetCaptureTimeAt(capture_start_latency_event.timestamp_ns()),
+        absl::StrFormat("Starting the capture on the instance took %.0f ms (%s).",
+                        capture_start_latency_event.total_duration_ns() / 1e6,
+                        absl::StrJoin(phases, ", ")));
+  });
+}
+
 void OrbitApp::OnErrorsWithPerfEventOpenEvent(
     orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) {
   main_thread_executor_->Schedule([this, errors_with_perf_event_open_event]() {
@@ -616,6 +742,33 @@ void OrbitApp::OnOutOfOrderEventsDiscardedEvent(
   });
 }
 
+void OrbitApp::OnSamplingPeriodChangedEvent(
+    orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) {
+  main_thread_executor_->Schedule([this, sampling_period_changed_event =
+                                             std::move(sampling_period_changed_event)]() {
+    main_window_->AppendToCaptureLog(
+        MainWindowInterface::CaptureLogSeverity::kInfo,
+        GetCaptureTimeAt(sampling_period_changed_event.timestamp_ns()),
+        absl::StrFormat("Sampling rate on CPU %d changed to %.1f samples per second.",
+                        sampling_period_changed_event.cpu(),
+                        1'000'000'000.0 / sampling_period_changed_event.sampling_period_ns()));
+  });
+}
+
+void OrbitApp::OnPipelineLatencyProbe(
+    orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) {
+  // The events that preceded the probe have been added to the capture data by now, as they are
+  // processed in order on this thread.
+  pipeline_latency_stats_.AddProbe(pipeline_latency_probe, orbit_base::CaptureTimestampNs());
+}
+
+void OrbitApp::OnFunctionStats(uint64_t function_id, FunctionStats stats) {
+  CaptureData& capture_data = GetMutableCaptureData();
+  if (!capture_data.has_precomputed_function_stats()) {
+    capture_data.MergeFunctionStats(function_id, stats);
+  }
+}
+
 void OrbitApp::OnValidateFramePointers(std::vector<const ModuleData*> modules_to_validate) {
   thread_pool_->Schedule([modules_to_validate = std::move(modules_to_validate), this] {
     frame_pointer_validator_client_->AnalyzeModules(modules_to_validate);
@@ -634,7 +787,28 @@ void OrbitApp::PostInit(bool is_connected) {
   if (is_connected) {
     CHECK(process_manager_ != nullptr);
 
-    capture_client_ = std::make_unique<CaptureClient>(grpc_channel_);
+    CaptureOptions::CaptureResponseCompression capture_response_compression =
+        CaptureOptions::kNoCompression;
+    if (uint32_t capture_compression = absl::GetFlag(FLAGS_capture_compression);
+        CaptureOptions::CaptureResponseCompression_IsValid(capture_compression)) {
+      capture_response_compression =
+          static_cast<CaptureOptions::CaptureResponseCompression>(capture_compression);
+    } else {
+      ERROR("Invalid capture compression: %u", capture_compression);
+    }
+    const uint64_t flight_recorder_window_ns =
+        absl::GetFlag(FLAGS_flight_recorder_window_s) * uint64_t{1'000'000'000};
+    const uint64_t statistics_summary_interval_ns =
+        absl::GetFlag(FLAGS_statistics_summary_interval_s) * uint64_t{1'000'000'000};
+    capture_client_ = std::make_unique<CaptureClient>(
+        grpc_channel_, capture_response_compression, absl::GetFlag(FLAGS_save_capture_on_instance),
+        flight_recorder_window_ns, absl::GetFlag(FLAGS_collect_gpu_pipeline_statistics),
+        absl::GetFlag(FLAGS_sample_process_memory_with_perf_events),
+        absl::GetFlag(FLAGS_collect_memory_callstacks),
+        absl::GetFlag(FLAGS_collect_kernel_callstacks),
+        absl::GetFlag(FLAGS_pipeline_latency_probe_period), statistics_summary_interval_ns,
+        absl::GetFlag(FLAGS_api_track_value_coalescing_interval_ms),
+        absl::GetFlag(FLAGS_compensate_instrumentation_overhead));
 
     if (GetTargetProcess() != nullptr) {
       UpdateProcessAndModuleList();
@@ -715,6 +889,75 @@ static std::vector<std::filesystem::path> ListRegularFilesWithExtension(
   return files;
 }
 
+// Capture files record the modules of the process right after the start of the capture, so only
+// the first events are read.
+constexpr size_t kMaxCaptureEventsToReadForModules = 1000;
+constexpr size_t kMaxRecentCapturesForSymbolPreloading = 5;
+
+// Returns the paths of the modules in the capture at `file_path`, or nothing if it is a capture of
+// another executable than `executable_path`.
+static std::vector<std::string> ReadModulePathsFromCaptureFile(
+    const std::filesystem::path& file_path, const std::string& executable_path) {
+  auto capture_file_or_error = orbit_capture_file::CaptureFile::OpenForReadWrite(file_path);
+  if (capture_file_or_error.has_error()) {
+    ERROR("Opening capture file \"%s\": %s", file_path.string(),
+          capture_file_or_error.error().message());
+    return {};
+  }
+  std::unique_ptr<orbit_capture_file::ProtoSectionInputStream> input_stream =
+      capture_file_or_error.value()->CreateCaptureSectionInputStream();
+
+  orbit_grpc_protos::ClientCaptureEvent event;
+  for (size_t i = 0; i < kMaxCaptureEventsToReadForModules; ++i) {
+    if (input_stream->ReadMessage(&event).has_error()) break;
+    if (event.has_capture_started() &&
+        event.capture_started().executable_path() != executable_path) {
+      return {};
+    }
+    if (event.has_modules_snapshot()) {
+      std::vector<std::string> module_paths;
+      for (const ModuleInfo& module_info : event.modules_snapshot().modules()) {
+        module_paths.push_back(module_info.file_path());
+      }
+      return module_paths;
+    }
+  }
+  return {};
+}
+
+// Returns the paths of the modules in the presets, the most recently saved presets first, and then
+// in `capture_file_paths`.
+static std::vector<std::string> ListModulePathsToPreload(
+    const std::vector<std::filesystem::path>& capture_file_paths,
+    const std::string& executable_path) {
+  std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> preset_files;
+  for (std::filesystem::path& preset_file_path :
+       ListRegularFilesWithExtension(orbit_paths::CreateOrGetPresetDir(), ".opr")) {
+    std::error_code error;
+    const std::filesystem::file_time_type last_write_time =
+        std::filesystem::last_write_time(preset_file_path, error);
+    if (error) continue;
+    preset_files.emplace_back(last_write_time, std::move(preset_file_path));
+  }
+  std::sort(preset_files.begin(), preset_files.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+
+  std::vector<std::string> module_paths;
+  for (const auto& [unused_last_write_time, preset_file_path] : preset_files) {
+    ErrorMessageOr<PresetFile> preset_file =
+        orbit_preset_file::ReadPresetFromFile(preset_file_path);
+    if (preset_file.has_error()) continue;
+    for (const std::filesystem::path& module_path : preset_file.value().GetModulePaths()) {
+      module_paths.push_back(module_path.string());
+    }
+  }
+  for (const std::filesystem::path& capture_file_path : capture_file_paths) {
+    orbit_base::Append(module_paths,
+                       ReadModulePathsFromCaptureFile(capture_file_path, executable_path));
+  }
+  return module_paths;
+}
+
 void OrbitApp::ListPresets() {
   std::vector<std::filesystem::path> preset_filenames =
       ListRegularFilesWithExtension(orbit_paths::CreateOrGetPresetDir(), ".opr");
@@ -801,7 +1044,7 @@ void OrbitApp::Disassemble(int32_t pid, const FunctionInfo& function) {
         "Error reading memory",
         absl::StrFormat(
             R"(Unable to calculate function "%s" address, likely because the module "%s" is not loaded.)",
-            function.pretty_name(), module->file_path()));
+            orbit_client_data::function_utils::GetDisplayName(function), module->file_path()));
     return;
   }
   thread_pool_->Schedule([this, absolute_address = absolute_address.value(), is_64_bit, pid,
@@ -854,14 +1097,14 @@ void OrbitApp::ShowSourceCode(const orbit_client_protos::FunctionInfo& function)
           main_thread_executor_,
           [this, module,
            function](const std::filesystem::path& local_file_path) -> ErrorMessageOr<void> {
-            const auto elf_file = orbit_object_utils::CreateElfFile(local_file_path);
+            OUTCOME_TRY(elf_file, GetElfFileWithDebugInfo(local_file_path, module->build_id()));
             const auto decl_line_info_or_error =
-                elf_file.value()->GetDeclarationLocationOfFunction(function.address());
+                elf_file->GetDeclarationLocationOfFunction(function.address());
 
             if (decl_line_info_or_error.has_error()) {
               return ErrorMessage{absl::StrFormat(
                   R"(Could not find source code location of function "%s" in module "%s": %s)",
-                  function.pretty_name(), module->file_path(),
+                  orbit_client_data::function_utils::GetDisplayName(function), module->file_path(),
                   decl_line_info_or_error.error().message())};
             }
             const auto& line_info = decl_line_info_or_error.value();
@@ -878,14 +1121,15 @@ void OrbitApp::ShowSourceCode(const orbit_client_protos::FunctionInfo& function)
               if (!absolute_address.has_value()) {
                 return ErrorMessage{absl::StrFormat(
                     R"(Unable calculate function "%s" address in memory, likely because the module "%s" is not loaded)",
-                    function.pretty_name(), module->file_path())};
+                    orbit_client_data::function_utils::GetDisplayName(function),
+                    module->file_path())};
               }
 
               const orbit_client_data::ThreadSampleData* summary = sampling_data.GetSummary();
               if (summary != nullptr) {
                 code_report = std::make_unique<orbit_code_report::SourceCodeReport>(
                     line_info.source_file(), function, absolute_address.value(),
-                    elf_file.value().get(), *summary,
+                    elf_file, *summary,
                     GetCaptureData().GetCallstackData()->GetCallstackEventsCount());
               }
             }
@@ -901,6 +1145,62 @@ void OrbitApp::ShowSourceCode(const orbit_client_protos::FunctionInfo& function)
       });
 }
 
+void OrbitApp::CopySourceLocationsToClipboard(uint64_t absolute_address) {
+  const auto module_in_memory_or_error =
+      GetCaptureData().process()->FindModuleByAddress(absolute_address);
+  if (module_in_memory_or_error.has_error()) {
+    SendErrorToUi("Error copying source location", module_in_memory_or_error.error().message());
+    return;
+  }
+  const orbit_client_data::ModuleInMemory& module_in_memory = module_in_memory_or_error.value();
+  const ModuleData* module = module_manager_->GetModuleByPathAndBuildId(
+      module_in_memory.file_path(), module_in_memory.build_id());
+  if (module == nullptr) {
+    SendErrorToUi("Error copying source location",
+                  absl::StrFormat(R"(Module "%s" not found)", module_in_memory.file_path()));
+    return;
+  }
+  const uint64_t elf_address = absolute_address - module_in_memory.start() +
+                               module->executable_segment_offset() + module->load_bias();
+
+  RetrieveModuleWithDebugInfo(module)
+      .ThenIfSuccess(
+          main_thread_executor_,
+          [this, module,
+           elf_address](const std::filesystem::path& local_file_path) -> ErrorMessageOr<void> {
+            OUTCOME_TRY(elf_file, GetElfFileWithDebugInfo(local_file_path, module->build_id()));
+            OUTCOME_TRY(line_infos, elf_file->GetInlinedLineInfos(elf_address));
+
+            std::string source_locations;
+            for (const orbit_grpc_protos::LineInfo& line_info : line_infos) {
+              absl::StrAppendFormat(
+                  &source_locations, "%s (%s:%u)\n",
+                  line_info.function_name().empty() ? "???" : line_info.function_name(),
+                  line_info.source_file(), line_info.source_line());
+            }
+            SetClipboard(source_locations);
+            return outcome::success();
+          })
+      .Then(main_thread_executor_, [this](const ErrorMessageOr<void>& maybe_error) {
+        if (maybe_error.has_error()) {
+          SendErrorToUi("Error copying source location", maybe_error.error().message());
+        }
+      });
+}
+
+ErrorMessageOr<orbit_object_utils::ElfFile*> OrbitApp::GetElfFileWithDebugInfo(
+    const std::filesystem::path& local_file_path, const std::string& build_id) {
+  auto it = elf_files_with_debug_info_.find(local_file_path.string());
+  // A file found in the symbol cache may have been replaced by another build in the meantime.
+  if (it != elf_files_with_debug_info_.end() && it->second->GetBuildId() == build_id) {
+    return it->second.get();
+  }
+  OUTCOME_TRY(elf_file, orbit_object_utils::CreateElfFile(local_file_path));
+  orbit_object_utils::ElfFile* result = elf_file.get();
+  elf_files_with_debug_info_.insert_or_assign(local_file_path.string(), std::move(elf_file));
+  return result;
+}
+
 Timer GMainTimer;
 
 void OrbitApp::MainTick() {
@@ -932,6 +1232,17 @@ void OrbitApp::SetIntrospectionWindow(IntrospectionWindow* introspection_window)
   introspection_window_ = introspection_window;
 }
 
+void OrbitApp::SetFlameGraphWindow(FlameGraphWindow* flame_graph_window) {
+  CHECK(flame_graph_window_ == nullptr);
+  flame_graph_window_ = flame_graph_window;
+}
+
+void OrbitApp::SetFlameGraphSearchString(const std::string& search_string) {
+  if (flame_graph_window_ != nullptr) {
+    flame_graph_window_->SetSearchString(search_string);
+  }
+}
+
 void OrbitApp::StopIntrospection() {
   if (introspection_window_) {
     introspection_window_->StopIntrospection();
@@ -981,12 +1292,30 @@ void OrbitApp::SetSelectionReport(
   FireRefreshCallbacks();
 }
 
+void OrbitApp::SetMemoryHotspotsReport(
+    PostProcessedSamplingData post_processed_sampling_data,
+    absl::flat_hash_map<uint64_t, std::shared_ptr<CallstackInfo>> unique_callstacks) {
+  CHECK(memory_hotspots_report_callback_);
+  if (memory_hotspots_report_ != nullptr) {
+    memory_hotspots_report_->ClearReport();
+  }
+
+  auto report = std::make_shared<SamplingReport>(this, std::move(post_processed_sampling_data),
+                                                 std::move(unique_callstacks));
+  orbit_data_views::DataView* callstack_data_view = GetOrCreateMemoryHotspotsCallstackDataView();
+
+  memory_hotspots_report_ = report;
+  memory_hotspots_report_callback_(callstack_data_view, report);
+  FireRefreshCallbacks();
+}
+
 void OrbitApp::SetTopDownView(const CaptureData& capture_data) {
   ORBIT_SCOPE_FUNCTION;
   CHECK(top_down_view_callback_);
   std::unique_ptr<CallTreeView> top_down_view =
       CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
-          capture_data.post_processed_sampling_data(), capture_data);
+          capture_data.post_processed_sampling_data(), capture_data,
+          core_count_sized_thread_pool_.get());
   top_down_view_callback_(std::move(top_down_view));
 }
 
@@ -995,27 +1324,32 @@ void OrbitApp::ClearTopDownView() {
   top_down_view_callback_(std::make_unique<CallTreeView>());
 }
 
-void OrbitApp::SetSelectionTopDownView(
-    const PostProcessedSamplingData& selection_post_processed_data,
-    const CaptureData& capture_data) {
-  CHECK(selection_top_down_view_callback_);
-  std::unique_ptr<CallTreeView> selection_top_down_view =
-      CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(selection_post_processed_data,
-                                                                   capture_data);
-  selection_top_down_view_callback_(std::move(selection_top_down_view));
-}
-
 void OrbitApp::ClearSelectionTopDownView() {
   CHECK(selection_top_down_view_callback_);
   selection_top_down_view_callback_(std::make_unique<CallTreeView>());
 }
 
+std::unique_ptr<orbit_gl::FlameGraph> OrbitApp::CreateFlameGraph(
+    const PostProcessedSamplingData& post_processed_sampling_data,
+    const CaptureData& capture_data) {
+  ORBIT_SCOPE_FUNCTION;
+  return std::make_unique<orbit_gl::FlameGraph>(
+      CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+          post_processed_sampling_data, capture_data, core_count_sized_thread_pool_.get()));
+}
+
+void OrbitApp::SetFlameGraph(std::unique_ptr<orbit_gl::FlameGraph> flame_graph) {
+  if (flame_graph_window_ != nullptr) {
+    flame_graph_window_->SetFlameGraph(std::move(flame_graph));
+  }
+}
+
 void OrbitApp::SetBottomUpView(const CaptureData& capture_data) {
   ORBIT_SCOPE_FUNCTION;
   CHECK(bottom_up_view_callback_);
   std::unique_ptr<CallTreeView> bottom_up_view =
-      CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
-          capture_data.post_processed_sampling_data(), capture_data);
+      CreateBottomUpView(capture_data.post_processed_sampling_data(), capture_data,
+                         core_count_sized_thread_pool_.get());
   bottom_up_view_callback_(std::move(bottom_up_view));
 }
 
@@ -1024,21 +1358,112 @@ void OrbitApp::ClearBottomUpView() {
   bottom_up_view_callback_(std::make_unique<CallTreeView>());
 }
 
-void OrbitApp::SetSelectionBottomUpView(
-    const PostProcessedSamplingData& selection_post_processed_data,
-    const CaptureData& capture_data) {
-  CHECK(selection_bottom_up_view_callback_);
-  std::unique_ptr<CallTreeView> selection_bottom_up_view =
-      CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(selection_post_processed_data,
-                                                                    capture_data);
-  selection_bottom_up_view_callback_(std::move(selection_bottom_up_view));
-}
-
 void OrbitApp::ClearSelectionBottomUpView() {
   CHECK(selection_bottom_up_view_callback_);
   selection_bottom_up_view_callback_(std::make_unique<CallTreeView>());
 }
 
+void OrbitApp::SetSelectionTopDownViewVisible(bool visible) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  selection_top_down_view_state_.is_visible = visible;
+  if (visible && selection_top_down_view_state_.needs_build) {
+    ScheduleSelectionCallTreeViewBuild(SelectionCallTreeViewType::kTopDown);
+  }
+}
+
+void OrbitApp::SetSelectionBottomUpViewVisible(bool visible) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  selection_bottom_up_view_state_.is_visible = visible;
+  if (visible && selection_bottom_up_view_state_.needs_build) {
+    ScheduleSelectionCallTreeViewBuild(SelectionCallTreeViewType::kBottomUp);
+  }
+}
+
+std::unique_ptr<CallTreeView> OrbitApp::CreateSelectionCallTreeView(
+    SelectionCallTreeViewType type, const PostProcessedSamplingData& selection_post_processed_data,
+    const std::atomic<bool>* cancelled) {
+  switch (type) {
+    case SelectionCallTreeViewType::kTopDown:
+      return CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+          selection_post_processed_data, GetCaptureData(), core_count_sized_thread_pool_.get(),
+          cancelled);
+    case SelectionCallTreeViewType::kBottomUp:
+      return CreateBottomUpView(selection_post_processed_data, GetCaptureData(),
+                                core_count_sized_thread_pool_.get(), cancelled);
+  }
+  UNREACHABLE();
+}
+
+void OrbitApp::SetSelectionCallTreeView(SelectionCallTreeViewType type,
+                                        std::unique_ptr<CallTreeView> view) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  const bool is_top_down = type == SelectionCallTreeViewType::kTopDown;
+  SelectionCallTreeViewState& state =
+      is_top_down ? selection_top_down_view_state_ : selection_bottom_up_view_state_;
+  if (view != nullptr) {
+    state.needs_build = false;
+    (is_top_down ? selection_top_down_view_callback_ : selection_bottom_up_view_callback_)(
+        std::move(view));
+    return;
+  }
+
+  if (is_top_down) {
+    ClearSelectionTopDownView();
+  } else {
+    ClearSelectionBottomUpView();
+  }
+  state.needs_build = true;
+  // The tab might have been shown while the selection was post-processed.
+  if (state.is_visible) ScheduleSelectionCallTreeViewBuild(type);
+}
+
+void OrbitApp::UpdateSelectionCallTreeViews(
+    std::shared_ptr<const PostProcessedSamplingData> selection_post_processed_data) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  selection_call_tree_data_ = std::move(selection_post_processed_data);
+  for (SelectionCallTreeViewType type :
+       {SelectionCallTreeViewType::kTopDown, SelectionCallTreeViewType::kBottomUp}) {
+    SelectionCallTreeViewState& state = type == SelectionCallTreeViewType::kTopDown
+                                            ? selection_top_down_view_state_
+                                            : selection_bottom_up_view_state_;
+    state.needs_build = true;
+    if (state.is_visible) ScheduleSelectionCallTreeViewBuild(type);
+  }
+}
+
+void OrbitApp::ScheduleSelectionCallTreeViewBuild(SelectionCallTreeViewType type) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(selection_call_tree_data_ != nullptr);
+  (type == SelectionCallTreeViewType::kTopDown ? selection_top_down_view_state_
+                                               : selection_bottom_up_view_state_)
+      .needs_build = false;
+  if (selection_post_processing_cancelled_ == nullptr || *selection_post_processing_cancelled_) {
+    selection_post_processing_cancelled_ = std::make_shared<std::atomic<bool>>(false);
+  }
+
+  selection_call_tree_view_futures_.erase(
+      std::remove_if(selection_call_tree_view_futures_.begin(),
+                     selection_call_tree_view_futures_.end(),
+                     [](const orbit_base::Future<void>& future) { return future.IsFinished(); }),
+      selection_call_tree_view_futures_.end());
+  selection_call_tree_view_futures_.push_back(thread_pool_->Schedule(
+      [this, type, data = selection_call_tree_data_,
+       cancelled = selection_post_processing_cancelled_] {
+        ORBIT_SCOPE("Selection call tree view");
+        std::unique_ptr<CallTreeView> view =
+            CreateSelectionCallTreeView(type, *data, cancelled.get());
+        if (view == nullptr) return;
+
+        main_thread_executor_->Schedule(
+            [this, type, data = std::move(data), cancelled = std::move(cancelled),
+             view = std::move(view)]() mutable {
+              // The view of outdated data is discarded, a build for the new data was scheduled.
+              if (*cancelled || data != selection_call_tree_data_) return;
+              SetSelectionCallTreeView(type, std::move(view));
+            });
+      }));
+}
+
 absl::Duration OrbitApp::GetCaptureTime() const {
   const TimeGraph* time_graph = GetTimeGraph();
   double time = (time_graph == nullptr) ? 0 : time_graph->GetCaptureTimeSpanUs();
@@ -1087,12 +1512,13 @@ ErrorMessageOr<void> OrbitApp::SavePreset(const std::string& filename) {
     // GetSelectedFunctions should not contain orbit functions
     CHECK(!orbit_client_data::function_utils::IsOrbitFunctionFromType(function.orbit_type()));
 
-    (*preset.mutable_modules())[function.module_path()].add_function_names(function.pretty_name());
+    (*preset.mutable_modules())[function.module_path()].add_function_names(
+        orbit_client_data::function_utils::GetDisplayName(function));
   }
 
   for (const auto& function : data_manager_->user_defined_capture_data().frame_track_functions()) {
     (*preset.mutable_modules())[function.module_path()].add_frame_track_function_names(
-        function.pretty_name());
+        orbit_client_data::function_utils::GetDisplayName(function));
   }
 
   std::string filename_with_ext = filename;
@@ -1146,16 +1572,22 @@ static ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCaptureFromNewFormat(
       CaptureEventProcessor::CreateForCaptureListener(listener, capture_file->GetFilePath(),
                                                       frame_track_function_ids);
 
-  auto capture_section_input_stream = capture_file->CreateCaptureSectionInputStream();
+  // The events are read and parsed on the reader's thread while they are processed on this thread.
+  orbit_capture_file::CaptureSectionEventReader capture_section_event_reader{
+      capture_file->CreateCaptureSectionInputStream()};
   while (true) {
-    if (*capture_loading_cancellation_requested) {
-      return CaptureListener::CaptureOutcome::kCancelled;
+    OUTCOME_TRY(events, capture_section_event_reader.ReadEventBatch());
+    if (events.empty()) {
+      return ErrorMessage("Capture section ended without a CaptureFinished event");
     }
-    ClientCaptureEvent event;
-    OUTCOME_TRY(capture_section_input_stream->ReadMessage(&event));
-    capture_event_processor->ProcessEvent(event);
-    if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
-      return CaptureListener::CaptureOutcome::kComplete;
+    for (const ClientCaptureEvent& event : events) {
+      if (*capture_loading_cancellation_requested) {
+        return CaptureListener::CaptureOutcome::kCancelled;
+      }
+      capture_event_processor->ProcessEvent(event);
+      if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+        return CaptureListener::CaptureOutcome::kComplete;
+      }
     }
   }
 }
@@ -1177,12 +1609,27 @@ Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> OrbitApp::LoadCaptureFro
     is_loading_capture_ = true;
     orbit_base::unique_resource scope_exit{&is_loading_capture_,
                                            [](std::atomic<bool>* value) { *value = false; }};
+    orbit_base::unique_resource reset_summary{
+        &loaded_capture_summary_,
+        [](std::optional<orbit_client_protos::CaptureSummary>* summary) { summary->reset(); }};
 
     ScopedMetric metric{metrics_uploader_,
                         capture_file_or_error.has_value()
                             ? orbit_metrics_uploader::OrbitLogEvent::ORBIT_CAPTURE_LOAD_V2
-                            : orbit_metrics_uploader::OrbitLogEvent::ORBIT_CAPTURE_LOAD};
+                            : orbit_metrics_uploader::OrbitLogEvent::ORBIT_CAPTURE_LOAD,
+                        &client_performance_metrics_,
+                        orbit_metrics_uploader::ClientOperation::kCaptureLoad};
     if (capture_file_or_error.has_value()) {
+      // The summary only speeds up loading: the capture is loaded without it if it can't be read.
+      ErrorMessageOr<std::optional<orbit_client_protos::CaptureSummary>> summary_or_error =
+          orbit_capture_file::ReadCaptureSummary(*capture_file_or_error.value());
+      if (summary_or_error.has_error()) {
+        ERROR("Reading capture summary of \"%s\": %s", file_path.string(),
+              summary_or_error.error().message());
+      } else {
+        loaded_capture_summary_ = std::move(summary_or_error.value());
+      }
+
       load_result = LoadCaptureFromNewFormat(this, capture_file_or_error.value().get(),
                                              &capture_loading_cancellation_requested_);
     } else {  // Fall back to old capture format.
@@ -1219,6 +1666,56 @@ Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> OrbitApp::LoadCaptureFro
   return load_future;
 }
 
+void OrbitApp::RetrieveAndLoadCaptureFileFromInstance(const std::string& instance_file_path) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  auto load_capture = [this](const std::filesystem::path& file_path) {
+    (void)LoadCaptureFromFile(file_path).Then(
+        main_thread_executor_, [this](ErrorMessageOr<CaptureOutcome> load_result) {
+          if (load_result.has_error()) {
+            SendErrorToUi("Error loading capture", load_result.error().message());
+          }
+        });
+  };
+  if (secure_copy_callback_ == nullptr) {
+    // The target is local, so the instance is this machine.
+    load_capture(instance_file_path);
+    return;
+  }
+
+  const std::filesystem::path local_file_path =
+      orbit_paths::CreateOrGetCaptureDir() / std::filesystem::path{instance_file_path}.filename();
+  ScopedStatus scoped_status = CreateScopedStatus(
+      absl::StrFormat(R"(Copying capture file "%s" from the instance...)", instance_file_path));
+  // The capture can be large, so it is copied on a background thread.
+  (void)thread_pool_
+      ->Schedule([secure_copy_callback = secure_copy_callback_, instance_file_path,
+                  local_file_path]() {
+        SCOPED_TIMED_LOG("Copying \"%s\"", instance_file_path);
+        return secure_copy_callback(instance_file_path, local_file_path.string());
+      })
+      .Then(main_thread_executor_,
+            [this, load_capture, local_file_path, scoped_status = std::move(scoped_status)](
+                ErrorMessageOr<void> copy_result) {
+              if (copy_result.has_error()) {
+                SendErrorToUi(
+                    "Error copying capture",
+                    absl::StrFormat("Could not copy the capture file from the instance: %s",
+                                    copy_result.error().message()));
+                return;
+              }
+              load_capture(local_file_path);
+            });
+}
+
+orbit_base::Future<ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>>>
+OrbitApp::ListContinuousCaptureFilesOnInstance() {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(capture_client_ != nullptr);
+  return thread_pool_->Schedule([capture_client = capture_client_.get()] {
+    return capture_client->ListContinuousCaptureFiles();
+  });
+}
+
 void OrbitApp::OnLoadCaptureCancelRequested() { capture_loading_cancellation_requested_ = true; }
 
 void OrbitApp::FireRefreshCallbacks(DataViewType type) {
@@ -1259,8 +1756,12 @@ static std::unique_ptr<CaptureEventProcessor> CreateCaptureEventProcessor(
                     process_name, absl::Now(), suffix);
   }
 
+  const orbit_capture_file::CaptureSectionCompression compression =
+      absl::GetFlag(FLAGS_compress_saved_captures)
+          ? orbit_capture_file::CaptureSectionCompression::kCompressedBlocks
+          : orbit_capture_file::CaptureSectionCompression::kNone;
   auto save_to_file_processor_or_error =
-      CaptureEventProcessor::CreateSaveToFileProcessor(file_path, error_handler);
+      CaptureEventProcessor::CreateSaveToFileProcessor(file_path, error_handler, compression);
 
   if (save_to_file_processor_or_error.has_error()) {
     error_handler(ErrorMessage{
@@ -1353,7 +1854,8 @@ void OrbitApp::StartCapture() {
       CreateCaptureStartData(
           selected_functions, user_defined_capture_data.frame_track_functions().size(),
           data_manager_->collect_thread_states(), memory_information_sampling_period_ms_for_metrics,
-          orbit_vulkan_layer_loaded_by_process, max_local_marker_depth_per_command_buffer)};
+          orbit_vulkan_layer_loaded_by_process, max_local_marker_depth_per_command_buffer),
+      &client_performance_metrics_};
 
   metrics_capture_complete_data_ = orbit_metrics_uploader::CaptureCompleteData{};
 
@@ -1400,6 +1902,10 @@ void OrbitApp::StartCapture() {
                   std::chrono::duration_cast<std::chrono::milliseconds>(capture_time_us);
               capture_metric.SetCaptureCompleteData(metrics_capture_complete_data_);
               capture_metric.SendCaptureSucceeded(capture_time_ms);
+              if (instance_capture_file_path_.has_value()) {
+                RetrieveAndLoadCaptureFileFromInstance(instance_capture_file_path_.value());
+                instance_capture_file_path_.reset();
+              }
             });
 
             return;
@@ -1422,6 +1928,13 @@ void OrbitApp::StopCapture() {
   capture_stop_requested_callback_();
 }
 
+void OrbitApp::RequestFlightRecorderSnapshot() {
+  if (capture_client_ == nullptr || !capture_client_->IsFlightRecorderEnabled()) return;
+  if (!capture_client_->RequestFlightRecorderSnapshot()) {
+    SendErrorToUi("Flight recorder", "Could not request the events of the flight recorder.");
+  }
+}
+
 void OrbitApp::AbortCapture() {
   if (capture_client_ == nullptr) return;
 
@@ -1436,12 +1949,19 @@ void OrbitApp::AbortCapture() {
 
 void OrbitApp::ClearCapture() {
   ORBIT_SCOPE_FUNCTION;
+  CancelSelectionPostProcessing();
+  ClearTimerQuery();
+  if (timer_query_data_view_ != nullptr) {
+    timer_query_data_view_->ClearResults();
+    FireRefreshCallbacks(DataViewType::kTimerQueryResults);
+  }
   if (capture_window_ != nullptr) {
     capture_window_->ClearTimeGraph();
   }
   capture_data_.reset();
 
   string_manager_.Clear();
+  pipeline_latency_stats_.Clear();
 
   set_selected_thread_id(orbit_base::kAllProcessThreadsTid);
   SelectTextBox(nullptr);
@@ -1521,7 +2041,7 @@ void OrbitApp::SendErrorToUi(const std::string& title, const std::string& text)
 }
 
 orbit_base::Future<ErrorMessageOr<std::filesystem::path>> OrbitApp::RetrieveModuleFromRemote(
-    const std::string& module_file_path) {
+    const std::string& module_file_path, const std::string& build_id) {
   ScopedStatus scoped_status = CreateScopedStatus(absl::StrFormat(
       "Searching for symbols on remote instance for module \"%s\"...", module_file_path));
 
@@ -1531,31 +2051,98 @@ orbit_base::Future<ErrorMessageOr<std::filesystem::path>> OrbitApp::RetrieveModu
       });
 
   auto download_file =
-      [this, module_file_path, scoped_status = std::move(scoped_status)](
-          ErrorMessageOr<std::string> result) mutable -> ErrorMessageOr<std::filesystem::path> {
-    if (result.has_error()) return result.error();
+      [this, module_file_path, build_id, scoped_status = std::move(scoped_status)](
+          ErrorMessageOr<std::string> result) mutable
+      -> orbit_base::Future<ErrorMessageOr<std::filesystem::path>> {
+    if (result.has_error()) return {result.error()};
 
     const std::string& debug_file_path = result.value();
-    LOG("Found symbols file on the remote: \"%s\" - loading it using scp...", debug_file_path);
+    LOG("Found symbols file on the remote: \"%s\" - copying it...", debug_file_path);
 
-    const std::filesystem::path local_debug_file_path =
+    std::filesystem::path local_debug_file_path =
         symbol_helper_.GenerateCachedFileName(module_file_path);
 
     scoped_status.UpdateMessage(
         absl::StrFormat(R"(Copying debug info file for "%s" from remote: "%s"...)",
                         module_file_path, debug_file_path));
-    SCOPED_TIMED_LOG("Copying \"%s\"", debug_file_path);
-    auto scp_result = secure_copy_callback_(debug_file_path, local_debug_file_path.string());
+    const auto priority_it = module_retrieval_priorities_.find(module_file_path);
+    const uint64_t priority =
+        priority_it != module_retrieval_priorities_.end() ? priority_it->second : 0;
+
+    return CopyDebugInfoFileFromRemote(module_file_path, build_id, local_debug_file_path, priority)
+        .Then(main_thread_executor_,
+              [local_debug_file_path, scoped_status = std::move(scoped_status)](
+                  const ErrorMessageOr<void>& copy_result)
+                  -> ErrorMessageOr<std::filesystem::path> {
+                if (copy_result.has_error()) {
+                  return ErrorMessage{
+                      absl::StrFormat("Could not copy debug info file from the remote: %s",
+                                      copy_result.error().message())};
+                }
+                return local_debug_file_path;
+              });
+  };
 
-    if (scp_result.has_error()) {
-      return ErrorMessage{absl::StrFormat("Could not copy debug info file from the remote: %s",
-                                          scp_result.error().message())};
-    }
+  return orbit_base::UnwrapFuture(
+      check_file_on_remote.Then(main_thread_executor_, std::move(download_file)));
+}
+
+orbit_base::Future<ErrorMessageOr<void>> OrbitApp::CopyDebugInfoFileFromRemote(
+    std::string module_file_path, std::string build_id, std::filesystem::path local_file_path,
+    uint64_t priority) {
+  orbit_base::Promise<ErrorMessageOr<void>> promise;
+  orbit_base::Future<ErrorMessageOr<void>> future = promise.GetFuture();
+  pending_remote_file_copies_.push_back(
+      PendingRemoteFileCopy{priority, std::move(module_file_path), std::move(build_id),
+                            std::move(local_file_path), std::move(promise)});
+  StartPendingRemoteFileCopies();
+  return future;
+}
+
+void OrbitApp::StartPendingRemoteFileCopies() {
+  while (remote_file_copies_in_progress_ < kMaxConcurrentRemoteFileCopies &&
+         !pending_remote_file_copies_.empty()) {
+    // Among copies of the same priority, the one requested first starts first.
+    auto next_copy_it = std::max_element(
+        pending_remote_file_copies_.begin(), pending_remote_file_copies_.end(),
+        [](const PendingRemoteFileCopy& lhs, const PendingRemoteFileCopy& rhs) {
+          return lhs.priority < rhs.priority;
+        });
+    PendingRemoteFileCopy copy = std::move(*next_copy_it);
+    pending_remote_file_copies_.erase(next_copy_it);
+    ++remote_file_copies_in_progress_;
+
+    (void)thread_pool_
+        ->Schedule([process_manager = GetProcessManager(),
+                    module_file_path = std::move(copy.module_file_path),
+                    build_id = std::move(copy.build_id),
+                    local_file_path = std::move(copy.local_file_path)]() {
+          SCOPED_TIMED_LOG("Copying debug info file of \"%s\"", module_file_path);
+          return process_manager->CopyDebugInfoFile(module_file_path, build_id, local_file_path);
+        })
+        .Then(main_thread_executor_, [this, promise = std::move(copy.promise)](
+                                         ErrorMessageOr<void> copy_result) mutable {
+          --remote_file_copies_in_progress_;
+          promise.SetResult(std::move(copy_result));
+          StartPendingRemoteFileCopies();
+        });
+  }
+}
 
-    return local_debug_file_path;
-  };
+absl::flat_hash_map<std::string, uint64_t> OrbitApp::GetSampledAddressCountsPerModulePath() const {
+  absl::flat_hash_map<std::string, uint64_t> counts;
+  if (!HasCaptureData() || !GetCaptureData().has_post_processed_sampling_data()) return counts;
+  const orbit_client_data::ThreadSampleData* summary =
+      GetCaptureData().post_processed_sampling_data().GetSummary();
+  if (summary == nullptr) return counts;
 
-  return check_file_on_remote.Then(main_thread_executor_, std::move(download_file));
+  const orbit_client_data::ProcessData* process = GetCaptureData().process();
+  for (const auto& [address, count] : summary->sampled_address_to_count) {
+    const auto module_in_memory = process->FindModuleByAddress(address);
+    if (module_in_memory.has_error()) continue;
+    counts[module_in_memory.value().file_path()] += count;
+  }
+  return counts;
 }
 
 orbit_base::Future<void> OrbitApp::RetrieveModulesAndLoadSymbols(
@@ -1570,7 +2157,22 @@ orbit_base::Future<void> OrbitApp::RetrieveModulesAndLoadSymbols(
     }
   };
 
-  for (const auto& module : modules) {
+  // The symbols of the modules in the sampled callstacks are needed first, to symbolize the
+  // sampling report.
+  module_retrieval_priorities_ = GetSampledAddressCountsPerModulePath();
+  std::vector<const ModuleData*> sorted_modules(modules.begin(), modules.end());
+  std::stable_sort(sorted_modules.begin(), sorted_modules.end(),
+                   [this](const ModuleData* lhs, const ModuleData* rhs) {
+                     const auto lhs_it = module_retrieval_priorities_.find(lhs->file_path());
+                     const auto rhs_it = module_retrieval_priorities_.find(rhs->file_path());
+                     const uint64_t lhs_priority =
+                         lhs_it != module_retrieval_priorities_.end() ? lhs_it->second : 0;
+                     const uint64_t rhs_priority =
+                         rhs_it != module_retrieval_priorities_.end() ? rhs_it->second : 0;
+                     return lhs_priority > rhs_priority;
+                   });
+
+  for (const auto& module : sorted_modules) {
     futures.emplace_back(
         RetrieveModuleAndLoadSymbols(module).Then(main_thread_executor_, handle_error));
   }
@@ -1585,15 +2187,18 @@ orbit_base::Future<ErrorMessageOr<void>> OrbitApp::RetrieveModuleAndLoadSymbols(
 
 orbit_base::Future<ErrorMessageOr<void>> OrbitApp::RetrieveModuleAndLoadSymbols(
     const std::string& module_path, const std::string& build_id) {
-  ScopedMetric metric(metrics_uploader_,
-                      orbit_metrics_uploader::OrbitLogEvent_LogEventType_ORBIT_SYMBOL_LOAD);
-
   const ModuleData* const module_data = GetModuleByPathAndBuildId(module_path, build_id);
+  // Nothing is loaded in this case, so this must not count as a symbol load in the metrics.
+  if (module_data != nullptr && module_data->is_loaded()) return {outcome::success()};
+
+  ScopedMetric metric(metrics_uploader_,
+                      orbit_metrics_uploader::OrbitLogEvent_LogEventType_ORBIT_SYMBOL_LOAD,
+                      &client_performance_metrics_,
+                      orbit_metrics_uploader::ClientOperation::kSymbolLoad);
   if (module_data == nullptr) {
     metric.SetStatusCode(orbit_metrics_uploader::OrbitLogEvent_StatusCode_INTERNAL_ERROR);
     return {ErrorMessage{absl::StrFormat("Module \"%s\" was not found", module_path)}};
   }
-  if (module_data->is_loaded()) return {outcome::success()};
 
   orbit_base::Future<ErrorMessageOr<void>> load_result = orbit_base::UnwrapFuture(
       RetrieveModule(module_path, build_id)
@@ -1640,7 +2245,7 @@ orbit_base::Future<ErrorMessageOr<std::filesystem::path>> OrbitApp::RetrieveModu
   }
 
   auto final_result =
-      RetrieveModuleFromRemote(module_path)
+      RetrieveModuleFromRemote(module_path, build_id)
           .Then(main_thread_executor_,
                 [this, module_id, local_error_message = local_symbols_path.error().message()](
                     const ErrorMessageOr<std::filesystem::path>& remote_result)
@@ -1764,11 +2369,17 @@ void OrbitApp::AddSymbols(const std::filesystem::path& module_file_path,
   ModuleData* module_data =
       GetMutableModuleByPathAndBuildId(module_file_path.string(), module_build_id);
   module_data->AddSymbols(module_symbols);
+  // The functions are filtered by name with this index once it is built. The maps by name are built
+  // here too, so that applying a preset doesn't demangle all names on the main thread.
+  thread_pool_->Schedule([module_data] {
+    module_data->BuildFunctionNameIndex();
+    module_data->BuildNameMaps();
+  });
 
   const ProcessData* selected_process = GetTargetProcess();
   if (selected_process != nullptr &&
       selected_process->IsModuleLoadedByProcess(module_data->file_path())) {
-    functions_data_view_->AddFunctions(module_data->GetFunctions());
+    functions_data_view_->AddFunctions(module_data->GetFunctions(), module_data);
     LOG("Added loaded function symbols for module \"%s\" to the functions tab",
         module_data->file_path());
   }
@@ -1789,8 +2400,9 @@ orbit_base::Future<ErrorMessageOr<void>> OrbitApp::LoadSymbols(
   auto scoped_status = CreateScopedStatus(absl::StrFormat(
       R"(Loading symbols for "%s" from file "%s"...)", module_file_path, symbols_path.string()));
 
-  auto load_symbols_from_file = thread_pool_->Schedule(
-      [symbols_path]() { return orbit_symbols::SymbolHelper::LoadSymbolsFromFile(symbols_path); });
+  auto load_symbols_from_file = thread_pool_->Schedule([this, symbols_path, module_build_id]() {
+    return symbol_helper_.LoadSymbolsUsingCache(symbols_path, module_build_id);
+  });
 
   auto add_symbols =
       [this, module_id, scoped_status = std::move(scoped_status)](
@@ -1866,22 +2478,39 @@ orbit_base::Future<ErrorMessageOr<void>> OrbitApp::LoadPresetModule(
   CHECK(!modules_data.empty());
   const ModuleData* module_data = modules_data.at(0);
 
+  // Only the functions of this module are kept until the symbols are loaded, rather than a copy of
+  // the whole preset per module, as presets can have thousands of functions.
+  const std::string& preset_module_path = module_data->file_path();
+  const bool is_legacy_file_format = preset_file.IsLegacyFileFormat();
+  std::vector<uint64_t> function_hashes;
+  std::vector<uint64_t> frame_track_function_hashes;
+  std::vector<std::string> function_names;
+  std::vector<std::string> frame_track_function_names;
+  if (is_legacy_file_format) {
+    function_hashes = preset_file.GetSelectedFunctionHashesForModuleLegacy(preset_module_path);
+    frame_track_function_hashes =
+        preset_file.GetFrameTrackFunctionHashesForModuleLegacy(preset_module_path);
+  } else {
+    function_names = preset_file.GetSelectedFunctionNamesForModule(preset_module_path);
+    frame_track_function_names =
+        preset_file.GetFrameTrackFunctionNamesForModule(preset_module_path);
+  }
+
   auto handle_hooks_and_frame_tracks =
-      [this, module_data, preset_file](const ErrorMessageOr<void>& result) -> ErrorMessageOr<void> {
+      [this, module_data, is_legacy_file_format, function_hashes = std::move(function_hashes),
+       frame_track_function_hashes = std::move(frame_track_function_hashes),
+       function_names = std::move(function_names),
+       frame_track_function_names = std::move(frame_track_function_names)](
+          const ErrorMessageOr<void>& result) -> ErrorMessageOr<void> {
     if (result.has_error()) return result.error();
-    const std::string& module_path = module_data->file_path();
-    if (preset_file.IsLegacyFileFormat()) {
-      SelectFunctionsFromHashes(module_data,
-                                preset_file.GetSelectedFunctionHashesForModuleLegacy(module_path));
-      EnableFrameTracksFromHashes(
-          module_data, preset_file.GetFrameTrackFunctionHashesForModuleLegacy(module_path));
-
+    if (is_legacy_file_format) {
+      SelectFunctionsFromHashes(module_data, function_hashes);
+      EnableFrameTracksFromHashes(module_data, frame_track_function_hashes);
       return outcome::success();
     }
 
-    SelectFunctionsByName(module_data, preset_file.GetSelectedFunctionNamesForModule(module_path));
-    EnableFrameTracksByName(module_data,
-                            preset_file.GetFrameTrackFunctionNamesForModule(module_path));
+    SelectFunctionsByName(module_data, function_names);
+    EnableFrameTracksByName(module_data, frame_track_function_names);
     return outcome::success();
   };
 
@@ -1889,56 +2518,73 @@ orbit_base::Future<ErrorMessageOr<void>> OrbitApp::LoadPresetModule(
       .Then(main_thread_executor_, std::move(handle_hooks_and_frame_tracks));
 }
 
-void OrbitApp::SelectFunctionsFromHashes(const ModuleData* module,
-                                         absl::Span<const uint64_t> function_hashes) {
-  for (const auto function_hash : function_hashes) {
-    const orbit_client_protos::FunctionInfo* const function_info =
-        module->FindFunctionFromHash(function_hash);
-    if (function_info == nullptr) {
-      ERROR("Could not find function hash %#x in module \"%s\"", function_hash,
-            module->file_path());
+// Returns the functions of `functions`, the results of the lookups of `keys` in `module`, that were
+// found. The keys not found are logged in a single message, as presets can have thousands of
+// functions.
+template <typename Key, typename FormatKey>
+[[nodiscard]] static std::vector<const orbit_client_protos::FunctionInfo*> GetFoundFunctions(
+    const ModuleData* module, absl::Span<const Key> keys,
+    std::vector<const orbit_client_protos::FunctionInfo*> functions, FormatKey&& format_key) {
+  CHECK(keys.size() == functions.size());
+  std::vector<std::string> keys_not_found;
+  size_t found_count = 0;
+  for (size_t i = 0; i < functions.size(); ++i) {
+    if (functions[i] == nullptr) {
+      keys_not_found.push_back(format_key(keys[i]));
       continue;
     }
-    SelectFunction(*function_info);
+    functions[found_count++] = functions[i];
   }
+  functions.resize(found_count);
+  if (!keys_not_found.empty()) {
+    ERROR("Could not find %u functions in module \"%s\": %s", keys_not_found.size(),
+          module->file_path(), absl::StrJoin(keys_not_found, ", "));
+  }
+  return functions;
+}
+
+[[nodiscard]] static std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsFromHashes(
+    const ModuleData* module, absl::Span<const uint64_t> function_hashes) {
+  return GetFoundFunctions(
+      module, function_hashes, module->FindFunctionsFromHashes(function_hashes),
+      [](uint64_t hash) { return absl::StrFormat("%#x", hash); });
+}
+
+[[nodiscard]] static std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsByName(
+    const ModuleData* module, absl::Span<const std::string> function_names) {
+  return GetFoundFunctions(
+      module, function_names, module->FindFunctionsFromPrettyNames(function_names),
+      [](const std::string& name) { return absl::StrFormat("\"%s\"", name); });
+}
+
+void OrbitApp::SelectFunctionsFromHashes(const ModuleData* module,
+                                         absl::Span<const uint64_t> function_hashes) {
+  std::vector<const orbit_client_protos::FunctionInfo*> functions =
+      FindFunctionsFromHashes(module, function_hashes);
+  data_manager_->SelectFunctions(functions);
+  LOG("Selected %u functions in module \"%s\"", functions.size(), module->file_path());
 }
 
 void OrbitApp::SelectFunctionsByName(const ModuleData* module,
                                      absl::Span<const std::string> function_names) {
-  for (const auto& function_name : function_names) {
-    const orbit_client_protos::FunctionInfo* const function_info =
-        module->FindFunctionFromPrettyName(function_name);
-    if (function_info == nullptr) {
-      ERROR("Could not find function \"%s\" in module \"%s\"", function_name, module->file_path());
-      continue;
-    }
-    SelectFunction(*function_info);
-  }
+  std::vector<const orbit_client_protos::FunctionInfo*> functions =
+      FindFunctionsByName(module, function_names);
+  data_manager_->SelectFunctions(functions);
+  LOG("Selected %u functions in module \"%s\"", functions.size(), module->file_path());
 }
 
 void OrbitApp::EnableFrameTracksFromHashes(const ModuleData* module,
                                            absl::Span<const uint64_t> function_hashes) {
-  for (const auto function_hash : function_hashes) {
-    const orbit_client_protos::FunctionInfo* const function_info =
-        module->FindFunctionFromHash(function_hash);
-    if (function_info == nullptr) {
-      ERROR("Could not find function hash %#x in module \"%s\"", function_hash,
-            module->file_path());
-      continue;
-    }
+  for (const orbit_client_protos::FunctionInfo* function_info :
+       FindFunctionsFromHashes(module, function_hashes)) {
     EnableFrameTrack(*function_info);
   }
 }
 
 void OrbitApp::EnableFrameTracksByName(const ModuleData* module,
                                        absl::Span<const std::string> function_names) {
-  for (const auto& function_name : function_names) {
-    const orbit_client_protos::FunctionInfo* const function_info =
-        module->FindFunctionFromPrettyName(function_name);
-    if (function_info == nullptr) {
-      ERROR("Could not find function \"%s\" in module \"%s\"", function_name, module->file_path());
-      continue;
-    }
+  for (const orbit_client_protos::FunctionInfo* function_info :
+       FindFunctionsByName(module, function_names)) {
     EnableFrameTrack(*function_info);
   }
 }
@@ -2025,6 +2671,7 @@ void OrbitApp::UpdateProcessAndModuleList() {
                        (void)reload_results;
 
                        RefreshUIAfterModuleReload();
+                       PreloadSymbolsOfRecentModules();
                      })
       .Then(main_thread_executor_, [this](const ErrorMessageOr<void>& result) {
         if (result.has_error()) {
@@ -2036,6 +2683,66 @@ void OrbitApp::UpdateProcessAndModuleList() {
       });
 }
 
+void OrbitApp::PreloadSymbolsOfRecentModules() {
+  const uint64_t budget_bytes =
+      uint64_t{absl::GetFlag(FLAGS_symbol_preloading_budget_mb)} * 1024 * 1024;
+  if (budget_bytes == 0 || GetTargetProcess() == nullptr) return;
+
+  std::vector<orbit_capture_file_info::CaptureFileInfo> capture_file_infos =
+      capture_file_info_manager_.GetCaptureFileInfos();
+  std::sort(capture_file_infos.begin(), capture_file_infos.end(),
+            [](const auto& lhs, const auto& rhs) { return rhs.LastUsed() < lhs.LastUsed(); });
+  std::vector<std::filesystem::path> capture_file_paths;
+  for (const orbit_capture_file_info::CaptureFileInfo& capture_file_info : capture_file_infos) {
+    if (capture_file_paths.size() == kMaxRecentCapturesForSymbolPreloading) break;
+    capture_file_paths.emplace_back(capture_file_info.FilePath().toStdString());
+  }
+
+  const ProcessData* process = GetTargetProcess();
+  (void)thread_pool_
+      ->Schedule([capture_file_paths = std::move(capture_file_paths),
+                  executable_path = process->full_path()]() {
+        return ListModulePathsToPreload(capture_file_paths, executable_path);
+      })
+      .Then(main_thread_executor_, [this, process, budget_bytes](
+                                       const std::vector<std::string>& module_paths) {
+        // The user selected another process in the meantime.
+        if (GetTargetProcess() != process) return;
+
+        // The size of the modules stands in for the memory their symbols take.
+        uint64_t preloaded_bytes = 0;
+        absl::flat_hash_set<std::string> visited_module_paths;
+        std::vector<const ModuleData*> modules_to_preload;
+        for (const std::string& module_path : module_paths) {
+          if (!visited_module_paths.insert(module_path).second) continue;
+          auto modules_or_error = GetLoadedModulesByPath(module_path);
+          if (modules_or_error.has_error() || modules_or_error.value().empty()) continue;
+          const ModuleData* module = modules_or_error.value().front();
+          if (module->is_loaded() || preloaded_bytes + module->file_size() > budget_bytes) {
+            continue;
+          }
+          preloaded_bytes += module->file_size();
+          modules_to_preload.push_back(module);
+        }
+        if (modules_to_preload.empty()) return;
+
+        LOG("Preloading the symbols of %u modules from presets and recent captures",
+            modules_to_preload.size());
+        for (const ModuleData* module : modules_to_preload) {
+          // Failures are only logged, as the user didn't ask for these symbols. Loading the module
+          // later, e.g., with a preset, reports them.
+          RetrieveModuleAndLoadSymbols(module).Then(
+              main_thread_executor_,
+              [module_path = module->file_path()](const ErrorMessageOr<void>& result) {
+                if (result.has_error()) {
+                  LOG("Preloading the symbols of \"%s\" failed: %s", module_path,
+                      result.error().message());
+                }
+              });
+        }
+      });
+}
+
 void OrbitApp::RefreshUIAfterModuleReload() {
   modules_data_view_->UpdateModules(GetMutableTargetProcess());
 
@@ -2044,7 +2751,7 @@ void OrbitApp::RefreshUIAfterModuleReload() {
   for (const auto& [file_path, build_id] : module_keys) {
     ModuleData* module = module_manager_->GetMutableModuleByPathAndBuildId(file_path, build_id);
     if (module->is_loaded()) {
-      functions_data_view_->AddFunctions(module->GetFunctions());
+      functions_data_view_->AddFunctions(module->GetFunctions(), module);
     }
   }
 
@@ -2163,8 +2870,8 @@ void OrbitApp::SetMaxLocalMarkerDepthPerCommandBuffer(
 }
 
 void OrbitApp::SelectFunction(const orbit_client_protos::FunctionInfo& func) {
-  LOG("Selected %s (address_=0x%" PRIx64 ", loaded_module_path_=%s)", func.pretty_name(),
-      func.address(), func.module_path());
+  LOG("Selected %s (address_=0x%" PRIx64 ", loaded_module_path_=%s)",
+      orbit_client_data::function_utils::GetDisplayName(func), func.address(), func.module_path());
   data_manager_->SelectFunction(func);
 }
 
@@ -2253,12 +2960,13 @@ const orbit_client_data::TextBox* OrbitApp::selected_text_box() const {
 
 void OrbitApp::SelectTextBox(const orbit_client_data::TextBox* text_box) {
   data_manager_->set_selected_text_box(text_box);
-  const TimerInfo* timer_info = text_box ? &text_box->GetTimerInfo() : nullptr;
+  std::optional<TimerInfo> timer_info;
+  if (text_box != nullptr) timer_info = text_box->GetTimerInfo();
   uint64_t function_id =
-      timer_info ? timer_info->function_id() : orbit_grpc_protos::kInvalidFunctionId;
+      timer_info.has_value() ? timer_info->function_id() : orbit_grpc_protos::kInvalidFunctionId;
   data_manager_->set_highlighted_function_id(function_id);
   CHECK(timer_selected_callback_);
-  timer_selected_callback_(timer_info);
+  timer_selected_callback_(timer_info.has_value() ? &timer_info.value() : nullptr);
   RequestUpdatePrimitives();
 }
 
@@ -2269,10 +2977,9 @@ void OrbitApp::DeselectTextBox() {
 
 uint64_t OrbitApp::GetFunctionIdToHighlight() const {
   const orbit_client_data::TextBox* selected_textbox = selected_text_box();
-  const TimerInfo* selected_timer_info =
-      selected_textbox ? &selected_textbox->GetTimerInfo() : nullptr;
-  uint64_t selected_function_id =
-      selected_timer_info ? selected_timer_info->function_id() : highlighted_function_id();
+  uint64_t selected_function_id = selected_textbox != nullptr
+                                      ? selected_textbox->GetPackedTimerInfo().function_id()
+                                      : highlighted_function_id();
 
   // Highlighting of manually instrumented scopes is not yet supported.
   const InstrumentedFunction* function = GetInstrumentedFunction(selected_function_id);
@@ -2294,18 +3001,170 @@ void OrbitApp::SelectCallstackEvents(const std::vector<CallstackEvent>& selected
   // TODO: this might live on the data_manager
   GetMutableCaptureData().set_selection_callstack_data(std::move(selection_callstack_data));
 
-  // Generate selection report.
+  // Generate selection report. Selecting a long time range can take a while, so this happens in
+  // the background, and is abandoned if the selection changes in the meantime.
+  // Only the top-down and bottom-up views that are visible are built right away, the others when
+  // their tab is shown.
+  CancelSelectionPostProcessing();
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  selection_post_processing_cancelled_ = cancelled;
   bool generate_summary = thread_id == orbit_base::kAllProcessThreadsTid;
-  PostProcessedSamplingData processed_sampling_data =
-      orbit_client_model::CreatePostProcessedSamplingData(
-          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary);
+  selection_call_tree_data_.reset();
+  selection_top_down_view_state_.needs_build = false;
+  selection_bottom_up_view_state_.needs_build = false;
+  const bool build_top_down_view = selection_top_down_view_state_.is_visible;
+  const bool build_bottom_up_view = selection_bottom_up_view_state_.is_visible;
+  selection_post_processing_future_ = thread_pool_->Schedule(
+      [this, selected_callstack_events, generate_summary, build_top_down_view,
+       build_bottom_up_view, cancelled = std::move(cancelled)] {
+        ORBIT_SCOPE("Selection post-processing");
+        std::optional<PostProcessedSamplingData> processed_sampling_data =
+            orbit_client_model::CreatePostProcessedSamplingDataInParallel(
+                selected_callstack_events, *GetCaptureData().GetCallstackData(), GetCaptureData(),
+                core_count_sized_thread_pool_.get(), generate_summary, cancelled.get());
+        if (!processed_sampling_data.has_value()) return;
+        std::unique_ptr<CallTreeView> top_down_view;
+        if (build_top_down_view) {
+          top_down_view = CreateSelectionCallTreeView(SelectionCallTreeViewType::kTopDown,
+                                                      *processed_sampling_data, cancelled.get());
+          if (top_down_view == nullptr) return;
+        }
+        std::unique_ptr<CallTreeView> bottom_up_view;
+        if (build_bottom_up_view) {
+          bottom_up_view = CreateSelectionCallTreeView(SelectionCallTreeViewType::kBottomUp,
+                                                       *processed_sampling_data, cancelled.get());
+          if (bottom_up_view == nullptr) return;
+        }
+        // The selection report takes the post-processed data, so the views that weren't built keep
+        // a copy of it.
+        std::shared_ptr<const PostProcessedSamplingData> call_tree_data;
+        if (!build_top_down_view || !build_bottom_up_view) {
+          call_tree_data =
+              std::make_shared<const PostProcessedSamplingData>(processed_sampling_data.value());
+        }
+        std::unique_ptr<orbit_gl::FlameGraph> flame_graph =
+            CreateFlameGraph(processed_sampling_data.value(), GetCaptureData());
+
+        main_thread_executor_->Schedule(
+            [this, processed_sampling_data = std::move(processed_sampling_data.value()),
+             call_tree_data = std::move(call_tree_data), top_down_view = std::move(top_down_view),
+             bottom_up_view = std::move(bottom_up_view), flame_graph = std::move(flame_graph),
+             generate_summary, cancelled]() mutable {
+              if (*cancelled) return;
+              // Both views and the report are replaced together, so that they never show different
+              // selections.
+              selection_call_tree_data_ = std::move(call_tree_data);
+              SetSelectionCallTreeView(SelectionCallTreeViewType::kTopDown,
+                                       std::move(top_down_view));
+              SetSelectionCallTreeView(SelectionCallTreeViewType::kBottomUp,
+                                       std::move(bottom_up_view));
+              SetFlameGraph(std::move(flame_graph));
+
+              SetSelectionReport(
+                  std::move(processed_sampling_data),
+                  GetCaptureData().GetSelectionCallstackData()->GetUniqueCallstacksCopy(),
+                  generate_summary);
+            });
+      });
+}
+
+void OrbitApp::CancelSelectionPostProcessing() {
+  if (selection_post_processing_cancelled_ != nullptr) {
+    *selection_post_processing_cancelled_ = true;
+  }
+  // The post-processing checks for cancellation regularly. Waiting for it to stop makes sure that
+  // it doesn't access a CaptureData that is about to be cleared.
+  if (selection_post_processing_future_.has_value()) {
+    selection_post_processing_future_->Wait();
+    selection_post_processing_future_.reset();
+  }
+  for (const orbit_base::Future<void>& future : selection_call_tree_view_futures_) {
+    future.Wait();
+  }
+  selection_call_tree_view_futures_.clear();
+}
+
+void OrbitApp::RunTimerQuery(const orbit_client_data::TimerQuery& query) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  ClearTimerQuery();
+  // While capturing or loading a capture, timers are still being added to the time graph.
+  if (IsCapturing() || IsLoadingCapture() || !HasCaptureData() || capture_window_ == nullptr) {
+    return;
+  }
+
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  timer_query_cancelled_ = cancelled;
+  const TimeGraph* time_graph = GetTimeGraph();
+  timer_query_future_ =
+      thread_pool_->Schedule([this, query, time_graph, cancelled = std::move(cancelled)] {
+        ORBIT_SCOPE("Timer query");
+        time_graph->FindLongestTimers(
+            query, cancelled.get(),
+            [this, &cancelled](std::vector<const orbit_client_data::TextBox*> text_boxes,
+                               bool /*is_complete*/) {
+              main_thread_executor_->Schedule(
+                  [this, text_boxes = std::move(text_boxes), cancelled]() mutable {
+                    if (*cancelled) return;
+                    SetTimerQueryResults(std::move(text_boxes));
+                  });
+            });
+      });
+}
+
+void OrbitApp::CancelTimerQuery() {
+  if (timer_query_cancelled_ != nullptr) {
+    *timer_query_cancelled_ = true;
+  }
+  // As for the selection post-processing, the timer chains must not be cleared while the query
+  // goes through them.
+  if (timer_query_future_.has_value()) {
+    timer_query_future_->Wait();
+    timer_query_future_.reset();
+  }
+}
+
+void OrbitApp::ClearTimerQuery() {
+  CancelTimerQuery();
+  if (!data_manager_->highlighted_text_boxes().empty()) {
+    data_manager_->set_highlighted_text_boxes({});
+    RequestUpdatePrimitives();
+  }
+}
+
+void OrbitApp::HighlightCriticalPath(const orbit_client_data::TextBox* text_box) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  ClearTimerQuery();
+  if (text_box == nullptr || IsCapturing() || IsLoadingCapture() || !HasCaptureData() ||
+      capture_window_ == nullptr) {
+    return;
+  }
+
+  const orbit_client_data::PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
+  if (!GetCaptureData().HasThreadStatesForThread(timer_info.thread_id())) {
+    SendErrorToUi("Critical path",
+                  "The critical path needs the thread states, which were not collected for the "
+                  "thread of the selected timer.");
+    return;
+  }
+  const std::vector<orbit_client_model::CriticalPathSegment> segments =
+      orbit_client_model::ComputeCriticalPath(GetCaptureData(), timer_info.thread_id(),
+                                              timer_info.start(), timer_info.end());
+  for (const orbit_client_model::CriticalPathSegment& segment : segments) {
+    LOG("Critical path: thread %d for %.3f us", segment.thread_id,
+        (segment.end_timestamp_ns - segment.begin_timestamp_ns) / 1000.0);
+  }
 
-  SetSelectionTopDownView(processed_sampling_data, GetCaptureData());
-  SetSelectionBottomUpView(processed_sampling_data, GetCaptureData());
+  std::vector<const orbit_client_data::TextBox*> text_boxes =
+      GetTimeGraph()->FindTimersOnCriticalPath(segments);
+  data_manager_->set_highlighted_text_boxes({text_boxes.begin(), text_boxes.end()});
+  RequestUpdatePrimitives();
+}
 
-  SetSelectionReport(std::move(processed_sampling_data),
-                     GetCaptureData().GetSelectionCallstackData()->GetUniqueCallstacksCopy(),
-                     generate_summary);
+void OrbitApp::SetTimerQueryResults(std::vector<const orbit_client_data::TextBox*> text_boxes) {
+  data_manager_->set_highlighted_text_boxes({text_boxes.begin(), text_boxes.end()});
+  timer_query_data_view_->SetResults(text_boxes);
+  FireRefreshCallbacks(DataViewType::kTimerQueryResults);
+  RequestUpdatePrimitives();
 }
 
 void OrbitApp::UpdateAfterSymbolLoading() {
@@ -2323,6 +3182,16 @@ void OrbitApp::UpdateAfterSymbolLoading() {
     GetMutableCaptureData().set_post_processed_sampling_data(post_processed_sampling_data);
     SetTopDownView(capture_data);
     SetBottomUpView(capture_data);
+    if (selection_report_ == nullptr) {
+      SetFlameGraph(CreateFlameGraph(post_processed_sampling_data, capture_data));
+    }
+  }
+
+  if (memory_hotspots_report_ != nullptr) {
+    memory_hotspots_report_->UpdateReport(
+        orbit_client_model::CreatePostProcessedSamplingData(
+            *capture_data.GetMemoryCallstackData(), capture_data),
+        capture_data.GetMemoryCallstackData()->GetUniqueCallstacksCopy());
   }
 
   if (selection_report_ == nullptr) {
@@ -2334,8 +3203,9 @@ void OrbitApp::UpdateAfterSymbolLoading() {
                                                           capture_data,
                                                           selection_report_->has_summary());
 
-  SetSelectionTopDownView(selection_post_processed_sampling_data, capture_data);
-  SetSelectionBottomUpView(selection_post_processed_sampling_data, capture_data);
+  UpdateSelectionCallTreeViews(
+      std::make_shared<const PostProcessedSamplingData>(selection_post_processed_sampling_data));
+  SetFlameGraph(CreateFlameGraph(selection_post_processed_sampling_data, capture_data));
   selection_report_->UpdateReport(
       std::move(selection_post_processed_sampling_data),
       capture_data.GetSelectionCallstackData()->GetUniqueCallstacksCopy());
@@ -2352,6 +3222,13 @@ void OrbitApp::UpdateAfterCaptureCleared() {
   ClearSelectionTopDownView();
   ClearBottomUpView();
   ClearSelectionBottomUpView();
+  selection_call_tree_data_.reset();
+  selection_top_down_view_state_.needs_build = false;
+  selection_bottom_up_view_state_.needs_build = false;
+  if (flame_graph_window_ != nullptr) flame_graph_window_->ClearFlameGraph();
+  if (memory_hotspots_report_ != nullptr) {
+    SetMemoryHotspotsReport(empty_post_processed_sampling_data, empty_unique_callstacks);
+  }
   if (selection_report_ != nullptr) {
     SetSelectionReport(std::move(empty_post_processed_sampling_data), empty_unique_callstacks,
                        false);
@@ -2407,6 +3284,13 @@ orbit_data_views::DataView* OrbitApp::GetOrCreateDataView(DataViewType type) {
       }
       return tracepoints_data_view_.get();
 
+    case DataViewType::kTimerQueryResults:
+      if (!timer_query_data_view_) {
+        timer_query_data_view_ = std::make_unique<TimerQueryDataView>(this);
+        panels_.push_back(timer_query_data_view_.get());
+      }
+      return timer_query_data_view_.get();
+
     case DataViewType::kInvalid:
       FATAL("DataViewType::kInvalid should not be used with the factory.");
   }
@@ -2421,6 +3305,14 @@ orbit_data_views::DataView* OrbitApp::GetOrCreateSelectionCallstackDataView() {
   return selection_callstack_data_view_.get();
 }
 
+orbit_data_views::DataView* OrbitApp::GetOrCreateMemoryHotspotsCallstackDataView() {
+  if (memory_hotspots_callstack_data_view_ == nullptr) {
+    memory_hotspots_callstack_data_view_ = std::make_unique<CallstackDataView>(this);
+    panels_.push_back(memory_hotspots_callstack_data_view_.get());
+  }
+  return memory_hotspots_callstack_data_view_.get();
+}
+
 void OrbitApp::FilterTracks(const std::string& filter) {
   GetMutableTimeGraph()->SetThreadFilter(filter);
 }
@@ -2581,6 +3473,24 @@ void OrbitApp::JumpToTextBoxAndZoom(uint64_t function_id, JumpToTextBoxMode sele
   }
 }
 
+std::vector<orbit_gl::FrameTrackStats::Frame> OrbitApp::GetLongestFrames(
+    uint64_t instrumented_function_id) const {
+  if (capture_window_ == nullptr) return {};
+  const FrameTrack* frame_track =
+      GetTimeGraph()->GetTrackManager()->GetFrameTrack(instrumented_function_id);
+  if (frame_track == nullptr) return {};
+  return frame_track->GetLongestFrames();
+}
+
+void OrbitApp::JumpToLongestFrameAndZoom(uint64_t instrumented_function_id, uint64_t frame_index) {
+  if (capture_window_ == nullptr) return;
+  const FrameTrack* frame_track =
+      GetTimeGraph()->GetTrackManager()->GetFrameTrack(instrumented_function_id);
+  if (frame_track == nullptr) return;
+  const orbit_client_data::TextBox* frame_box = frame_track->FindLongestFrameTextBox(frame_index);
+  if (frame_box != nullptr) GetMutableTimeGraph()->SelectAndZoom(frame_box);
+}
+
 void OrbitApp::RefreshFrameTracks() {
   CHECK(HasCaptureData());
   CHECK(std::this_thread::get_id() == main_thread_id_);
@@ -2608,8 +3518,8 @@ void OrbitApp::AddFrameTrackTimers(uint64_t instrumented_function_id) {
     for (const orbit_client_data::TimerBlock& block : *chain) {
       for (uint64_t i = 0; i < block.size(); ++i) {
         const orbit_client_data::TextBox& box = block[i];
-        if (box.GetTimerInfo().function_id() == instrumented_function_id) {
-          all_start_times.push_back(box.GetTimerInfo().start());
+        if (box.GetPackedTimerInfo().function_id() == instrumented_function_id) {
+          all_start_times.push_back(box.Start());
         }
       }
     }
@@ -2665,7 +3575,8 @@ ErrorMessageOr<void> OrbitApp::ConvertPresetToNewFormatIfNecessary(const PresetF
               module_path.string());
         continue;
       }
-      module_info.add_function_names(function_info->pretty_name());
+      module_info.add_function_names(
+          orbit_client_data::function_utils::GetDisplayName(*function_info));
     }
 
     for (uint64_t function_hash :
@@ -2676,7 +3587,8 @@ ErrorMessageOr<void> OrbitApp::ConvertPresetToNewFormatIfNecessary(const PresetF
               module_path.string());
         continue;
       }
-      module_info.add_frame_track_function_names(function_info->pretty_name());
+      module_info.add_frame_track_function_names(
+          orbit_client_data::function_utils::GetDisplayName(*function_info));
     }
 
     (*new_info.mutable_modules())[module_path.string()] = module_info;
@@ -2759,6 +3671,10 @@ void OrbitApp::CaptureMetricProcessApiTimer(const orbit_client_protos::TimerInfo
       break;
     case orbit_api::kString:
       break;
+    case orbit_api::kFiberSwitchIn:
+      [[fallthrough]];
+    case orbit_api::kFiberSwitchOut:
+      [[fallthrough]];
     case orbit_api::kNone:
       UNREACHABLE();
   }
@@ -35,9 +35,11 @@
 #include "ClientData/CallstackTypes.h"
 #include "ClientData/ModuleData.h"
 #include "ClientData/ModuleManager.h"
+#include "ClientData/PipelineLatencyStats.h"
 #include "ClientData/PostProcessedSamplingData.h"
 #include "ClientData/ProcessData.h"
 #include "ClientData/TextBox.h"
+#include "ClientData/TimerQuery.h"
 #include "ClientData/TracepointCustom.h"
 #include "ClientData/UserDefinedCaptureData.h"
 #include "ClientModel/CaptureData.h"
@@ -52,19 +54,25 @@
 #include "DataViews/FunctionsDataView.h"
 #include "DataViews/PresetLoadState.h"
 #include "DataViews/PresetsDataView.h"
+#include "FlameGraph.h"
+#include "FlameGraphWindow.h"
 #include "FramePointerValidatorClient.h"
 #include "FrameTrackOnlineProcessor.h"
+#include "FrameTrackStats.h"
 #include "GlCanvas.h"
 #include "IntrospectionWindow.h"
 #include "MainThreadExecutor.h"
 #include "MainWindowInterface.h"
 #include "ManualInstrumentationManager.h"
 #include "MetricsUploader/CaptureMetric.h"
+#include "MetricsUploader/ClientPerformanceMetrics.h"
 #include "MetricsUploader/MetricsUploader.h"
 #include "ModulesDataView.h"
 #include "OrbitBase/CrashHandler.h"
 #include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Promise.h"
+#include "ObjectUtils/ElfFile.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/ThreadPool.h"
 #include "SamplingReport.h"
@@ -72,9 +80,11 @@
 #include "StatusListener.h"
 #include "StringManager.h"
 #include "Symbols/SymbolHelper.h"
+#include "TimerQueryDataView.h"
 #include "TracepointsDataView.h"
 #include "capture.pb.h"
 #include "capture_data.pb.h"
+#include "capture_summary.pb.h"
 #include "preset.pb.h"
 #include "services.pb.h"
 #include "symbol.pb.h"
@@ -116,6 +126,9 @@ class OrbitApp final : public DataViewFactory,
 
   void StartCapture();
   void StopCapture();
+  // Only has an effect if the capture runs in flight recorder mode, in which case the service sends
+  // the events of the last flight_recorder_window_s seconds.
+  void RequestFlightRecorderSnapshot();
   void AbortCapture();
   void ClearCapture();
   [[nodiscard]] bool HasCaptureData() const override { return capture_data_ != nullptr; }
@@ -131,12 +144,18 @@ class OrbitApp final : public DataViewFactory,
   [[nodiscard]] bool HasSampleSelection() const {
     return selection_report_ != nullptr && selection_report_->HasSamples();
   }
+  [[nodiscard]] bool HasMemoryHotspots() const {
+    return memory_hotspots_report_ != nullptr && memory_hotspots_report_->HasSamples();
+  }
 
   void ToggleCapture();
   void ListPresets();
   void RefreshCaptureView();
   void Disassemble(int32_t pid, const orbit_client_protos::FunctionInfo& function) override;
   void ShowSourceCode(const orbit_client_protos::FunctionInfo& function) override;
+  // Copies the source location of `absolute_address` to the clipboard, preceded by the locations
+  // in the functions inlined at the address, innermost first.
+  void CopySourceLocationsToClipboard(uint64_t absolute_address);
 
   void OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture_started,
                         std::optional<std::filesystem::path> file_path,
@@ -153,12 +172,15 @@ class OrbitApp final : public DataViewFactory,
   void OnUniqueTracepointInfo(uint64_t key,
                               orbit_grpc_protos::TracepointInfo tracepoint_info) override;
   void OnTracepointEvent(orbit_client_protos::TracepointEventInfo tracepoint_event_info) override;
-  void OnModuleUpdate(uint64_t timestamp_ns, orbit_grpc_protos::ModuleInfo module_info) override;
-  void OnModulesSnapshot(uint64_t timestamp_ns,
+  void OnModuleUpdate(int32_t pid, uint64_t timestamp_ns,
+                      orbit_grpc_protos::ModuleInfo module_info) override;
+  void OnModulesSnapshot(int32_t pid, uint64_t timestamp_ns,
                          std::vector<orbit_grpc_protos::ModuleInfo> module_infos) override;
   void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) override;
   void OnClockResolutionEvent(
       orbit_grpc_protos::ClockResolutionEvent clock_resolution_event) override;
+  void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent capture_start_latency_event) override;
   void OnErrorsWithPerfEventOpenEvent(
       orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) override;
   void OnErrorEnablingOrbitApiEvent(
@@ -167,6 +189,11 @@ class OrbitApp final : public DataViewFactory,
       orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) override;
   void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
                                             out_of_order_events_discarded_event) override;
+  void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) override;
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) override;
+  void OnFunctionStats(uint64_t function_id, orbit_client_protos::FunctionStats stats) override;
 
   void OnValidateFramePointers(
       std::vector<const orbit_client_data::ModuleData*> modules_to_validate);
@@ -180,8 +207,14 @@ class OrbitApp final : public DataViewFactory,
     CHECK(capture_window_ != nullptr);
     return capture_window_->GetTimeGraph();
   }
+  // Only populated when the pipeline_latency_probe_period flag is set.
+  [[nodiscard]] const orbit_client_data::PipelineLatencyStats& GetPipelineLatencyStats() const {
+    return pipeline_latency_stats_;
+  }
   void SetDebugCanvas(GlCanvas* debug_canvas);
   void SetIntrospectionWindow(IntrospectionWindow* canvas);
+  void SetFlameGraphWindow(FlameGraphWindow* flame_graph_window);
+  void SetFlameGraphSearchString(const std::string& search_string);
   void StopIntrospection();
 
   void SetSamplingReport(
@@ -193,19 +226,30 @@ class OrbitApp final : public DataViewFactory,
       absl::flat_hash_map<uint64_t, std::shared_ptr<orbit_client_protos::CallstackInfo>>
           unique_callstacks,
       bool has_summary);
+  // The report of the callstacks recorded on page faults, mmap and brk, weighted by the number of
+  // events each of them stands for.
+  void SetMemoryHotspotsReport(
+      orbit_client_data::PostProcessedSamplingData post_processed_sampling_data,
+      absl::flat_hash_map<uint64_t, std::shared_ptr<orbit_client_protos::CallstackInfo>>
+          unique_callstacks);
   void SetTopDownView(const orbit_client_model::CaptureData& capture_data);
   void ClearTopDownView();
-  void SetSelectionTopDownView(
-      const orbit_client_data::PostProcessedSamplingData& selection_post_processed_data,
-      const orbit_client_model::CaptureData& capture_data);
   void ClearSelectionTopDownView();
+  // The flame graph is built from a top-down view of `post_processed_sampling_data`. As this takes
+  // a while for large captures, it is built on the thread that post-processed the samples.
+  [[nodiscard]] std::unique_ptr<orbit_gl::FlameGraph> CreateFlameGraph(
+      const orbit_client_data::PostProcessedSamplingData& post_processed_sampling_data,
+      const orbit_client_model::CaptureData& capture_data);
+  void SetFlameGraph(std::unique_ptr<orbit_gl::FlameGraph> flame_graph);
 
   void SetBottomUpView(const orbit_client_model::CaptureData& capture_data);
   void ClearBottomUpView();
-  void SetSelectionBottomUpView(
-      const orbit_client_data::PostProcessedSamplingData& selection_post_processed_data,
-      const orbit_client_model::CaptureData& capture_data);
   void ClearSelectionBottomUpView();
+  // The selection top-down and bottom-up views are only built while they are visible, as building
+  // both for each selection takes a while for long selections. A view that is hidden when the
+  // selection changes is built once the main window reports that it is visible.
+  void SetSelectionTopDownViewVisible(bool visible);
+  void SetSelectionBottomUpViewVisible(bool visible);
 
   // This needs to be called from the main thread.
   [[nodiscard]] bool IsCaptureConnected(
@@ -263,6 +307,9 @@ class OrbitApp final : public DataViewFactory,
   void SetSelectionReportCallback(SamplingReportCallback callback) {
     selection_report_callback_ = std::move(callback);
   }
+  void SetMemoryHotspotsReportCallback(SamplingReportCallback callback) {
+    memory_hotspots_report_callback_ = std::move(callback);
+  }
 
   using CallTreeViewCallback = std::function<void(std::unique_ptr<CallTreeView>)>;
   void SetTopDownViewCallback(CallTreeViewCallback callback) {
@@ -329,11 +376,21 @@ class OrbitApp final : public DataViewFactory,
       const orbit_client_data::ModuleData* module);
   orbit_base::Future<ErrorMessageOr<std::filesystem::path>> RetrieveModuleWithDebugInfo(
       const std::string& module_path, const std::string& build_id);
+  // Returns the ElfFile of a module retrieved by `RetrieveModuleWithDebugInfo`. The ElfFile is
+  // kept, as the line tables and the other DWARF indexes are only built on the first lookup. Must
+  // be called on the main thread.
+  ErrorMessageOr<orbit_object_utils::ElfFile*> GetElfFileWithDebugInfo(
+      const std::filesystem::path& local_file_path, const std::string& build_id);
 
   void UpdateProcessAndModuleList();
   orbit_base::Future<std::vector<ErrorMessageOr<void>>> ReloadModules(
       absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos);
   void RefreshUIAfterModuleReload();
+  // Loads, in the background, the symbols of the modules of the target process that are in the
+  // presets or in the recent captures of the same executable, up to the size given by the flag
+  // --symbol_preloading_budget_mb. Loading a preset or starting a capture later doesn't need to
+  // wait for these symbols, or only waits for the loads already in progress.
+  void PreloadSymbolsOfRecentModules();
 
   void UpdateAfterSymbolLoading();
   void UpdateAfterCaptureCleared();
@@ -361,8 +418,12 @@ class OrbitApp final : public DataViewFactory,
   [[nodiscard]] orbit_data_views::DataView* GetOrCreateDataView(
       orbit_data_views::DataViewType type) override;
   [[nodiscard]] orbit_data_views::DataView* GetOrCreateSelectionCallstackDataView();
+  [[nodiscard]] orbit_data_views::DataView* GetOrCreateMemoryHotspotsCallstackDataView();
 
   [[nodiscard]] orbit_gl::StringManager* GetStringManager() { return &string_manager_; }
+  [[nodiscard]] orbit_metrics_uploader::ClientPerformanceMetrics* GetClientPerformanceMetrics() {
+    return &client_performance_metrics_;
+  }
   [[nodiscard]] orbit_client_services::ProcessManager* GetProcessManager() {
     return process_manager_;
   }
@@ -433,6 +494,10 @@ class OrbitApp final : public DataViewFactory,
   void DeselectTextBox();
 
   [[nodiscard]] uint64_t GetFunctionIdToHighlight() const;
+  [[nodiscard]] const absl::flat_hash_set<const orbit_client_data::TextBox*>&
+  highlighted_text_boxes() const {
+    return data_manager_->highlighted_text_boxes();
+  }
 
   void SelectCallstackEvents(
       const std::vector<orbit_client_protos::CallstackEvent>& selected_callstack_events,
@@ -470,6 +535,25 @@ class OrbitApp final : public DataViewFactory,
   enum class JumpToTextBoxMode { kFirst, kLast, kMin, kMax };
   void JumpToTextBoxAndZoom(uint64_t function_id, JumpToTextBoxMode selection_mode);
 
+  // The longest frames, longest first, of the frame track of the function with id
+  // `instrumented_function_id`, if there is one.
+  [[nodiscard]] std::vector<orbit_gl::FrameTrackStats::Frame> GetLongestFrames(
+      uint64_t instrumented_function_id) const;
+  // Selects and zooms to the frame `frame_index`, one of the longest frames (see GetLongestFrames).
+  void JumpToLongestFrameAndZoom(uint64_t instrumented_function_id, uint64_t frame_index);
+
+  // Searches the timers of the capture for the longest ones matching `query` on thread_pool_. The
+  // results are shown, and updated while the search goes on, in the kTimerQueryResults data view,
+  // and highlighted in the time graph. Starting a query cancels the previous one.
+  void RunTimerQuery(const orbit_client_data::TimerQuery& query);
+  // Cancels the current timer query, waits for it to stop, and removes its highlights.
+  void ClearTimerQuery();
+  // Highlights in the time graph the timers on the critical path (see
+  // orbit_client_model::ComputeCriticalPath) of the timer of `text_box`, e.g., of a frame or a
+  // scope, i.e., the work across threads that its thread waited on. Clears the timer query, which
+  // shares the highlights.
+  void HighlightCriticalPath(const orbit_client_data::TextBox* text_box);
+
  private:
   void UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload(
       absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos);
@@ -481,7 +565,17 @@ class OrbitApp final : public DataViewFactory,
       const orbit_preset_file::PresetFile& preset_file);
 
   [[nodiscard]] orbit_base::Future<ErrorMessageOr<std::filesystem::path>> RetrieveModuleFromRemote(
-      const std::string& module_file_path);
+      const std::string& module_file_path, const std::string& build_id);
+  // Copies the debug info file of a module from the remote on a background thread. At most a few
+  // copies run at the same time, and the pending copies with the highest `priority` start first.
+  // Must be called on the main thread.
+  [[nodiscard]] orbit_base::Future<ErrorMessageOr<void>> CopyDebugInfoFileFromRemote(
+      std::string module_file_path, std::string build_id, std::filesystem::path local_file_path,
+      uint64_t priority);
+  void StartPendingRemoteFileCopies();
+  // Returns how many sampled callstack frames, by address, are in each module of the capture.
+  [[nodiscard]] absl::flat_hash_map<std::string, uint64_t> GetSampledAddressCountsPerModulePath()
+      const;
 
   void SelectFunctionsFromHashes(const orbit_client_data::ModuleData* module,
                                  absl::Span<const uint64_t> function_hashes);
@@ -507,10 +601,41 @@ class OrbitApp final : public DataViewFactory,
   void AddFrameTrackTimers(uint64_t instrumented_function_id);
   void RefreshFrameTracks();
   void TrySaveUserDefinedCaptureInfo();
+  // Cancels the post-processing of the previous selection, including the building of its top-down
+  // and bottom-up views, and waits for it to stop.
+  void CancelSelectionPostProcessing();
+  enum class SelectionCallTreeViewType { kTopDown, kBottomUp };
+  [[nodiscard]] std::unique_ptr<CallTreeView> CreateSelectionCallTreeView(
+      SelectionCallTreeViewType type,
+      const orbit_client_data::PostProcessedSamplingData& selection_post_processed_data,
+      const std::atomic<bool>* cancelled);
+  // Shows `view`, built for the current selection, or if it is nullptr, clears the view of `type`
+  // and builds it from selection_call_tree_data_ once it is visible.
+  void SetSelectionCallTreeView(SelectionCallTreeViewType type,
+                                std::unique_ptr<CallTreeView> view);
+  // Replaces the data of the selection top-down and bottom-up views after the current selection
+  // was post-processed again. The views keep showing the previous data until they are rebuilt.
+  void UpdateSelectionCallTreeViews(
+      std::shared_ptr<const orbit_client_data::PostProcessedSamplingData>
+          selection_post_processed_data);
+  // Builds the selection view of `type` from selection_call_tree_data_ on thread_pool_. It is only
+  // shown if neither the selection nor its data changed in the meantime.
+  void ScheduleSelectionCallTreeViewBuild(SelectionCallTreeViewType type);
+  // Cancels the current timer query and waits for it to stop.
+  void CancelTimerQuery();
+  void SetTimerQueryResults(std::vector<const orbit_client_data::TextBox*> text_boxes);
 
   orbit_base::Future<void> OnCaptureFailed(ErrorMessage error_message);
   orbit_base::Future<void> OnCaptureCancelled();
   orbit_base::Future<void> OnCaptureComplete();
+  // Copies the capture file that OrbitService saved on the instance, if the target is remote, and
+  // loads it in place of the capture that was streamed, which only contains a few events.
+  void RetrieveAndLoadCaptureFileFromInstance(const std::string& instance_file_path);
+  // Lists the capture files that the continuous profiling of OrbitService saved on the instance,
+  // oldest first, to be loaded with RetrieveAndLoadCaptureFileFromInstance.
+  [[nodiscard]] orbit_base::Future<
+      ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>>>
+  ListContinuousCaptureFilesOnInstance();
 
   void RequestUpdatePrimitives();
 
@@ -521,6 +646,12 @@ class OrbitApp final : public DataViewFactory,
 
   std::atomic<bool> capture_loading_cancellation_requested_ = false;
   std::atomic<bool> is_loading_capture_{false};
+  // The CaptureSummary section of the capture file being loaded, if it has one. Only set and reset
+  // by the thread loading the capture, which waits for OnCaptureStarted to be handled on the main
+  // thread.
+  std::optional<orbit_client_protos::CaptureSummary> loaded_capture_summary_;
+  // Only accessed from the main thread. Set when the capture was saved on the instance.
+  std::optional<std::string> instance_capture_file_path_;
 
   CaptureStartedCallback capture_started_callback_;
   CaptureStopRequestedCallback capture_stop_requested_callback_;
@@ -534,6 +665,7 @@ class OrbitApp final : public DataViewFactory,
   RefreshCallback refresh_callback_;
   SamplingReportCallback sampling_reports_callback_;
   SamplingReportCallback selection_report_callback_;
+  SamplingReportCallback memory_hotspots_report_callback_;
   CallTreeViewCallback top_down_view_callback_;
   CallTreeViewCallback selection_top_down_view_callback_;
   CallTreeViewCallback bottom_up_view_callback_;
@@ -549,15 +681,38 @@ class OrbitApp final : public DataViewFactory,
   std::unique_ptr<orbit_data_views::FunctionsDataView> functions_data_view_;
   std::unique_ptr<CallstackDataView> callstack_data_view_;
   std::unique_ptr<CallstackDataView> selection_callstack_data_view_;
+  std::unique_ptr<CallstackDataView> memory_hotspots_callstack_data_view_;
   std::unique_ptr<orbit_data_views::PresetsDataView> presets_data_view_;
   std::unique_ptr<TracepointsDataView> tracepoints_data_view_;
+  std::unique_ptr<TimerQueryDataView> timer_query_data_view_;
 
   CaptureWindow* capture_window_ = nullptr;
   IntrospectionWindow* introspection_window_ = nullptr;
+  FlameGraphWindow* flame_graph_window_ = nullptr;
   GlCanvas* debug_canvas_ = nullptr;
 
   std::shared_ptr<SamplingReport> sampling_report_;
   std::shared_ptr<SamplingReport> selection_report_ = nullptr;
+  std::shared_ptr<SamplingReport> memory_hotspots_report_ = nullptr;
+
+  // The selection report is created on thread_pool_, and only shown if no other selection was made
+  // in the meantime.
+  std::optional<orbit_base::Future<void>> selection_post_processing_future_;
+  std::shared_ptr<std::atomic<bool>> selection_post_processing_cancelled_;
+  // The selection top-down and bottom-up views that were hidden when the selection was
+  // post-processed are built from selection_call_tree_data_ once they are visible. These builds are
+  // cancelled together with the post-processing.
+  struct SelectionCallTreeViewState {
+    bool is_visible = false;
+    bool needs_build = false;
+  };
+  SelectionCallTreeViewState selection_top_down_view_state_;
+  SelectionCallTreeViewState selection_bottom_up_view_state_;
+  std::shared_ptr<const orbit_client_data::PostProcessedSamplingData> selection_call_tree_data_;
+  std::vector<orbit_base::Future<void>> selection_call_tree_view_futures_;
+  // Same for the timer query, whose partial results are shown as they come.
+  std::optional<orbit_base::Future<void>> timer_query_future_;
+  std::shared_ptr<std::atomic<bool>> timer_query_cancelled_;
 
   absl::flat_hash_map<std::pair<std::string, std::string>,
                       orbit_base::Future<ErrorMessageOr<std::filesystem::path>>>
@@ -565,6 +720,20 @@ class OrbitApp final : public DataViewFactory,
   absl::flat_hash_map<std::pair<std::string, std::string>, orbit_base::Future<ErrorMessageOr<void>>>
       symbols_currently_loading_;
 
+  struct PendingRemoteFileCopy {
+    uint64_t priority;
+    std::string module_file_path;
+    std::string build_id;
+    std::filesystem::path local_file_path;
+    orbit_base::Promise<ErrorMessageOr<void>> promise;
+  };
+  // Only accessed on the main thread, by `CopyDebugInfoFileFromRemote`.
+  std::vector<PendingRemoteFileCopy> pending_remote_file_copies_;
+  size_t remote_file_copies_in_progress_ = 0;
+  // The modules that appear the most in the sampled callstacks have their debug information copied
+  // first. Updated by `RetrieveModulesAndLoadSymbols`.
+  absl::flat_hash_map<std::string, uint64_t> module_retrieval_priorities_;
+
   orbit_gl::StringManager string_manager_;
   std::shared_ptr<grpc::Channel> grpc_channel_;
 
@@ -574,6 +743,7 @@ class OrbitApp final : public DataViewFactory,
   std::shared_ptr<ThreadPool> thread_pool_;
   std::shared_ptr<ThreadPool> core_count_sized_thread_pool_;
   std::unique_ptr<orbit_capture_client::CaptureClient> capture_client_;
+  orbit_client_data::PipelineLatencyStats pipeline_latency_stats_;
   orbit_client_services::ProcessManager* process_manager_ = nullptr;
   std::unique_ptr<orbit_client_data::ModuleManager> module_manager_;
   std::unique_ptr<DataManager> data_manager_;
@@ -581,6 +751,9 @@ class OrbitApp final : public DataViewFactory,
   std::unique_ptr<ManualInstrumentationManager> manual_instrumentation_manager_;
 
   const orbit_symbols::SymbolHelper symbol_helper_;
+  // Only accessed on the main thread, by `GetElfFileWithDebugInfo`.
+  absl::flat_hash_map<std::string, std::unique_ptr<orbit_object_utils::ElfFile>>
+      elf_files_with_debug_info_;
 
   StatusListener* status_listener_ = nullptr;
 
@@ -602,6 +775,9 @@ class OrbitApp final : public DataViewFactory,
   // the capture thread. After the capture is finished its read by the main thread again. This is
   // similar to how capture_data is used.
   orbit_metrics_uploader::CaptureCompleteData metrics_capture_complete_data_;
+  // Durations of capture loads, symbol loads and frames of the capture window, sent with the next
+  // capture metric.
+  orbit_metrics_uploader::ClientPerformanceMetrics client_performance_metrics_;
 
   orbit_capture_file_info::Manager capture_file_info_manager_{};
 };
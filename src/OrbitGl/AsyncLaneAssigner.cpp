@@ -0,0 +1,51 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AsyncLaneAssigner.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_gl {
+
+uint32_t AsyncLaneAssigner::AssignLane(uint64_t start, uint64_t end) {
+  if (leaf_count_ == 0 || min_end_tree_[0] > start) Grow();
+  CHECK(min_end_tree_[0] <= start);
+
+  size_t node = 0;
+  while (node < leaf_count_ - 1) {
+    const size_t left_child = 2 * node + 1;
+    node = min_end_tree_[left_child] <= start ? left_child : left_child + 1;
+  }
+  const size_t lane = node - (leaf_count_ - 1);
+  SetLaneEnd(lane, end);
+  lane_count_ = std::max(lane_count_, static_cast<uint32_t>(lane + 1));
+  return static_cast<uint32_t>(lane);
+}
+
+void AsyncLaneAssigner::Grow() {
+  const size_t new_leaf_count = std::max<size_t>(2 * leaf_count_, 16);
+  const size_t first_old_leaf = leaf_count_ == 0 ? 0 : leaf_count_ - 1;
+  std::vector<uint64_t> old_leaves(min_end_tree_.begin() + first_old_leaf, min_end_tree_.end());
+  leaf_count_ = new_leaf_count;
+  min_end_tree_.assign(2 * leaf_count_ - 1, 0);
+  std::copy(old_leaves.begin(), old_leaves.end(), min_end_tree_.begin() + (leaf_count_ - 1));
+  for (size_t node = leaf_count_ - 1; node-- > 0;) {
+    min_end_tree_[node] = std::min(min_end_tree_[2 * node + 1], min_end_tree_[2 * node + 2]);
+  }
+}
+
+void AsyncLaneAssigner::SetLaneEnd(size_t lane, uint64_t end) {
+  size_t node = leaf_count_ - 1 + lane;
+  min_end_tree_[node] = end;
+  while (node > 0) {
+    node = (node - 1) / 2;
+    const uint64_t min_end = std::min(min_end_tree_[2 * node + 1], min_end_tree_[2 * node + 2]);
+    if (min_end_tree_[node] == min_end) break;
+    min_end_tree_[node] = min_end;
+  }
+}
+
+}  // namespace orbit_gl
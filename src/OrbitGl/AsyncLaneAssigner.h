@@ -0,0 +1,39 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_ASYNC_LANE_ASSIGNER_H_
+#define ORBIT_GL_ASYNC_LANE_ASSIGNER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace orbit_gl {
+
+// Assigns the spans of an async track to lanes, i.e., depths, so that the spans in a lane don't
+// overlap: each span goes to the first lane whose last span ends before or when it starts, or to a
+// new lane. As spans arrive when they end, they are not ordered by their start, so a lane that was
+// taken by a later span can't be considered free again. The end time of the last span of each lane
+// is therefore kept in a tree of minimums over the lanes, in which the first lane that ends early
+// enough is found in logarithmic time instead of by scanning all the lanes.
+class AsyncLaneAssigner {
+ public:
+  // Returns the lane of the span, the first one being 0.
+  [[nodiscard]] uint32_t AssignLane(uint64_t start, uint64_t end);
+  [[nodiscard]] uint32_t GetLaneCount() const { return lane_count_; }
+
+ private:
+  void Grow();
+  void SetLaneEnd(size_t lane, uint64_t end);
+
+  // A complete binary tree stored by levels, with the leaves, one per lane, starting at
+  // leaf_count_ - 1. Each inner node holds the minimum of its children. Unused lanes end at 0.
+  std::vector<uint64_t> min_end_tree_;
+  size_t leaf_count_ = 0;
+  uint32_t lane_count_ = 0;
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_ASYNC_LANE_ASSIGNER_H_
@@ -0,0 +1,52 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "AsyncLaneAssigner.h"
+
+namespace orbit_gl {
+
+TEST(AsyncLaneAssigner, SpansGoToTheFirstLaneThatEndedBeforeTheyStart) {
+  AsyncLaneAssigner assigner;
+  EXPECT_EQ(assigner.GetLaneCount(), 0);
+  EXPECT_EQ(assigner.AssignLane(0, 10), 0);
+  EXPECT_EQ(assigner.AssignLane(5, 20), 1);
+  EXPECT_EQ(assigner.AssignLane(6, 8), 2);
+  // Touching spans don't overlap.
+  EXPECT_EQ(assigner.AssignLane(10, 30), 0);
+  EXPECT_EQ(assigner.AssignLane(25, 40), 1);
+  EXPECT_EQ(assigner.GetLaneCount(), 3);
+  // A span that starts before the ends of the lanes it would otherwise fit in.
+  EXPECT_EQ(assigner.AssignLane(7, 9), 3);
+  EXPECT_EQ(assigner.AssignLane(9, 12), 2);
+  EXPECT_EQ(assigner.GetLaneCount(), 4);
+}
+
+TEST(AsyncLaneAssigner, AssignsTheSameLanesAsScanningAllLanes) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<uint64_t> start_distribution(0, 100'000);
+  std::uniform_int_distribution<uint64_t> duration_distribution(0, 5'000);
+
+  AsyncLaneAssigner assigner;
+  std::vector<uint64_t> lane_ends;
+  for (size_t i = 0; i < 10'000; ++i) {
+    const uint64_t start = start_distribution(gen);
+    const uint64_t end = start + duration_distribution(gen);
+
+    uint32_t expected_lane = 0;
+    while (expected_lane < lane_ends.size() && lane_ends[expected_lane] > start) ++expected_lane;
+    if (expected_lane == lane_ends.size()) lane_ends.push_back(0);
+    lane_ends[expected_lane] = end;
+
+    ASSERT_EQ(assigner.AssignLane(start, end), expected_lane);
+  }
+  EXPECT_EQ(assigner.GetLaneCount(), lane_ends.size());
+}
+
+}  // namespace orbit_gl
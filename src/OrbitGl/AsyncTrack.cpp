@@ -5,7 +5,6 @@
 #include "AsyncTrack.h"
 
 #include <GteVector.h>
-#include <absl/container/flat_hash_map.h>
 #include <absl/strings/str_format.h>
 #include <absl/time/time.h>
 
@@ -53,7 +52,7 @@ AsyncTrack::AsyncTrack(CaptureViewElement* parent, TimeGraph* time_graph,
   // Orbit.h. Use it to retrieve the module from which the manually instrumented scope originated.
   const InstrumentedFunction* func =
       capture_data_
-          ? capture_data_->GetInstrumentedFunctionById(text_box->GetTimerInfo().function_id())
+          ? capture_data_->GetInstrumentedFunctionById(text_box->GetPackedTimerInfo().function_id())
           : nullptr;
   CHECK(func || timer_info.type() == TimerInfo::kIntrospection ||
         timer_info.type() == TimerInfo::kApiEvent);
@@ -71,8 +70,7 @@ AsyncTrack::AsyncTrack(CaptureViewElement* parent, TimeGraph* time_graph,
       "<b>Module:</b> %s<br/>"
       "<b>Time:</b> %s",
       function_name, module_name,
-      orbit_display_formats::GetDisplayTime(
-          TicksToDuration(text_box->GetTimerInfo().start(), text_box->GetTimerInfo().end())));
+      orbit_display_formats::GetDisplayTime(TicksToDuration(text_box->Start(), text_box->End())));
 }
 
 void AsyncTrack::UpdateBoxHeight() {
@@ -93,9 +91,7 @@ std::vector<std::shared_ptr<orbit_client_data::TimerChain>> AsyncTrack::GetAllSe
 void AsyncTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
   // Find the first row that that can receive the new timeslice with no overlap.
   // If none of the existing rows works, add a new row.
-  uint32_t depth = 0;
-  while (max_span_time_by_depth_[depth] > timer_info.start()) ++depth;
-  max_span_time_by_depth_[depth] = timer_info.end();
+  const uint32_t depth = lane_assigner_.AssignLane(timer_info.start(), timer_info.end());
 
   orbit_client_protos::TimerInfo new_timer_info = timer_info;
   new_timer_info.set_depth(depth);
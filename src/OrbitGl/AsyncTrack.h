@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include "AsyncLaneAssigner.h"
 #include "CallstackThreadBar.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
@@ -18,7 +19,6 @@
 #include "TimerTrack.h"
 #include "Track.h"
 #include "Viewport.h"
-#include "absl/container/flat_hash_map.h"
 #include "capture_data.pb.h"
 
 class OrbitApp;
@@ -45,7 +45,7 @@ class AsyncTrack final : public TimerTrack {
                                     bool is_selected, bool is_highlighted) const override;
 
   // Used for determining what row can receive a new timer with no overlap.
-  absl::flat_hash_map<uint32_t, uint64_t> max_span_time_by_depth_;
+  orbit_gl::AsyncLaneAssigner lane_assigner_;
 };
 
 #endif  // ORBIT_GL_ASYNC_TRACK_H_
@@ -92,7 +92,25 @@ void BasicPagefaultTrack::DrawSingleSeriesEntry(
 
   if (!index_of_series_to_highlight_.has_value()) return;
   if (current_normalized_values[index_of_series_to_highlight_.value()] == 0) return;
+  DrawHighlight(batcher, start_tick, end_tick, z);
+}
+
+void BasicPagefaultTrack::DrawSingleSeriesEnvelope(
+    Batcher* batcher, uint64_t start_tick, uint64_t end_tick,
+    const std::array<float, kBasicPagefaultTrackDimension>& normalized_min_values,
+    const std::array<float, kBasicPagefaultTrackDimension>& normalized_max_values,
+    const std::array<float, kBasicPagefaultTrackDimension>& normalized_last_values, float z) {
+  LineGraphTrack<kBasicPagefaultTrackDimension>::DrawSingleSeriesEnvelope(
+      batcher, start_tick, end_tick, normalized_min_values, normalized_max_values,
+      normalized_last_values, z);
+
+  if (!index_of_series_to_highlight_.has_value()) return;
+  if (normalized_max_values[index_of_series_to_highlight_.value()] == 0) return;
+  DrawHighlight(batcher, start_tick, end_tick, z);
+}
 
+void BasicPagefaultTrack::DrawHighlight(Batcher* batcher, uint64_t start_tick, uint64_t end_tick,
+                                        float z) {
   const Color kHightlightingColor(231, 68, 53, 100);
   float x0 = time_graph_->GetWorldFromTick(start_tick);
   float width = time_graph_->GetWorldFromTick(end_tick) - x0;
@@ -49,6 +49,12 @@ class BasicPagefaultTrack : public LineGraphTrack<kBasicPagefaultTrackDimension>
       const std::array<float, kBasicPagefaultTrackDimension>& current_normalized_values,
       const std::array<float, kBasicPagefaultTrackDimension>& next_normalized_values, float z,
       bool is_last) override;
+  void DrawSingleSeriesEnvelope(
+      Batcher* batcher, uint64_t start_tick, uint64_t end_tick,
+      const std::array<float, kBasicPagefaultTrackDimension>& normalized_min_values,
+      const std::array<float, kBasicPagefaultTrackDimension>& normalized_max_values,
+      const std::array<float, kBasicPagefaultTrackDimension>& normalized_last_values,
+      float z) override;
 
   // Once this is set, if values[index_of_series_to_highlight_] > 0 in the sampling window t, we
   // will draw a colored box in this sampling window to highlight the occurrence of pagefault
@@ -63,6 +69,7 @@ class BasicPagefaultTrack : public LineGraphTrack<kBasicPagefaultTrackDimension>
   [[nodiscard]] Vec2 GetAnnotatedTrackPosition() const override { return pos_; };
   [[nodiscard]] Vec2 GetAnnotatedTrackSize() const override { return size_; };
   [[nodiscard]] uint32_t GetAnnotationFontSize() const override { return GetLegendFontSize(); }
+  void DrawHighlight(Batcher* batcher, uint64_t start_tick, uint64_t end_tick, float z);
 
   Track* parent_;
   std::optional<std::pair<uint64_t, std::array<double, kBasicPagefaultTrackDimension>>>
@@ -6,20 +6,38 @@
 
 #include <GteVector.h>
 #include <GteVector2.h>
+#include <absl/base/casts.h>
 #include <glad/glad.h>
 #include <math.h>
 #include <stddef.h>
 
+#include <array>
+
 #include "ClientData/TextBox.h"
 #include "DisplayFormats/DisplayFormats.h"
 #include "Introspection/Introspection.h"
 #include "OrbitBase/Logging.h"
 
+namespace {
+
+[[nodiscard]] PickingId PickingIdFromColor(const Color& color) {
+  return PickingId::FromPixelValue(
+      absl::bit_cast<uint32_t>(std::array<uint8_t, 4>{color[0], color[1], color[2], color[3]}));
+}
+
+[[nodiscard]] std::optional<PickingUserData> ToOptional(
+    std::unique_ptr<PickingUserData> user_data) {
+  if (user_data == nullptr) return std::nullopt;
+  return std::move(*user_data);
+}
+
+}  // namespace
+
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
                       std::unique_ptr<PickingUserData> user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kLine, user_data_.size(), batcher_id_);
 
-  AddLine(from, to, z, color, picking_color, std::move(user_data));
+  AddLine(from, to, z, color, picking_color, ToOptional(std::move(user_data)));
 }
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
@@ -28,7 +46,7 @@ void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
 
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
 
-  AddLine(from, to, z, color, picking_color, nullptr);
+  AddLine(from, to, z, color, picking_color);
 }
 
 void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
@@ -36,32 +54,44 @@ void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
   AddLine(pos, pos + Vec2(0, size), z, color, std::move(user_data));
 }
 
+void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
+                              PickingUserData user_data) {
+  Color picking_color = PickingId::ToColor(PickingType::kLine, user_data_.size(), batcher_id_);
+  AddLine(pos, pos + Vec2(0, size), z, color, picking_color, std::move(user_data));
+}
+
 void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
                               std::shared_ptr<Pickable> pickable) {
   CHECK(picking_manager_ != nullptr);
 
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
 
-  AddLine(pos, pos + Vec2(0, size), z, color, picking_color, nullptr);
+  AddLine(pos, pos + Vec2(0, size), z, color, picking_color);
 }
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Color& picking_color,
-                      std::unique_ptr<PickingUserData> user_data) {
+                      std::optional<PickingUserData> user_data) {
   Line line;
   line.start_point = Vec3(floorf(from[0]), floorf(from[1]), z);
   line.end_point = Vec3(floorf(to[0]), floorf(to[1]), z);
-  auto& buffer = primitive_buffers_by_layer_[z];
+  user_data_.push_back(std::move(user_data));
 
+  if (recording_ != nullptr) {
+    recording_->lines.push_back({line, color, RecordPickingColor(picking_color)});
+    recording_->user_data.push_back(user_data_.back());
+    if (recording_mode_ == BatcherRecordingMode::kRecordOnly) return;
+  }
+
+  PrimitiveBuffers& buffer = GetPrimitiveBuffers(z);
   buffer.line_buffer.lines_.emplace_back(line);
   buffer.line_buffer.colors_.push_back_n(color, 2);
   buffer.line_buffer.picking_colors_.push_back_n(picking_color, 2);
-  user_data_.push_back(std::move(user_data));
 }
 
 void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors,
                      std::unique_ptr<PickingUserData> user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
-  AddBox(box, colors, picking_color, std::move(user_data));
+  AddBox(box, colors, picking_color, ToOptional(std::move(user_data)));
 }
 
 void Batcher::AddBox(const Box& box, const Color& color,
@@ -71,6 +101,13 @@ void Batcher::AddBox(const Box& box, const Color& color,
   AddBox(box, colors, std::move(user_data));
 }
 
+void Batcher::AddBox(const Box& box, const Color& color, PickingUserData user_data) {
+  Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
+  std::array<Color, 4> colors;
+  colors.fill(color);
+  AddBox(box, colors, picking_color, std::move(user_data));
+}
+
 void Batcher::AddBox(const Box& box, const Color& color, std::shared_ptr<Pickable> pickable) {
   CHECK(picking_manager_ != nullptr);
 
@@ -78,7 +115,7 @@ void Batcher::AddBox(const Box& box, const Color& color, std::shared_ptr<Pickabl
   std::array<Color, 4> colors;
   colors.fill(color);
 
-  AddBox(box, colors, picking_color, nullptr);
+  AddBox(box, colors, picking_color);
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color) {
@@ -100,6 +137,15 @@ void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
   AddBox(box, colors, std::move(user_data));
 }
 
+void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
+                           PickingUserData user_data, ShadingDirection shading_direction) {
+  std::array<Color, 4> colors;
+  GetBoxGradientColors(color, &colors, shading_direction);
+  Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
+  Box box(pos, size, z);
+  AddBox(box, colors, picking_color, std::move(user_data));
+}
+
 static std::vector<Triangle> GetUnitArcTriangles(float angle_0, float angle_1, uint32_t num_sides) {
   std::vector<Triangle> triangles;
   const Vec3 origin(0, 0, 0);
@@ -185,29 +231,37 @@ void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
   GetBoxGradientColors(color, &colors, shading_direction);
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
   Box box(pos, size, z);
-  AddBox(box, colors, picking_color, nullptr);
+  AddBox(box, colors, picking_color);
 }
 
 void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
-                     std::unique_ptr<PickingUserData> user_data) {
+                     std::optional<PickingUserData> user_data) {
   Box rounded_box = box;
   for (size_t v = 0; v < 4; ++v) {
     rounded_box.vertices[v][0] = floorf(rounded_box.vertices[v][0]);
     rounded_box.vertices[v][1] = floorf(rounded_box.vertices[v][1]);
   }
+  user_data_.push_back(std::move(user_data));
+
+  if (recording_ != nullptr) {
+    recording_->boxes.push_back({rounded_box, colors, RecordPickingColor(picking_color)});
+    recording_->user_data.push_back(user_data_.back());
+    if (recording_mode_ == BatcherRecordingMode::kRecordOnly) return;
+  }
+
   float layer_z_value = rounded_box.vertices[0][2];
-  auto& buffer = primitive_buffers_by_layer_[layer_z_value];
+  PrimitiveBuffers& buffer = GetPrimitiveBuffers(layer_z_value);
   buffer.box_buffer.boxes_.emplace_back(rounded_box);
   buffer.box_buffer.colors_.push_back(colors);
   buffer.box_buffer.picking_colors_.push_back_n(picking_color, 4);
-  user_data_.push_back(std::move(user_data));
+  ++buffer.box_buffer.generation_;
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
                           std::unique_ptr<PickingUserData> user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
 
-  AddTriangle(triangle, color, picking_color, std::move(user_data));
+  AddTriangle(triangle, color, picking_color, ToOptional(std::move(user_data)));
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
@@ -216,11 +270,11 @@ void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
 
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
 
-  AddTriangle(triangle, color, picking_color, nullptr);
+  AddTriangle(triangle, color, picking_color);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color, const Color& picking_color,
-                          std::unique_ptr<PickingUserData> user_data) {
+                          std::optional<PickingUserData> user_data) {
   std::array<Color, 3> colors;
   colors.fill(color);
   AddTriangle(triangle, colors, picking_color, std::move(user_data));
@@ -231,30 +285,46 @@ void Batcher::AddShadedTrapezium(const Vec3& top_left, const Vec3& bottom_left,
                                  const Vec3& bottom_right, const Vec3& top_right,
                                  const Color& color, std::unique_ptr<PickingUserData> user_data,
                                  ShadingDirection shading_direction) {
+  CHECK(user_data != nullptr);
+  AddShadedTrapezium(top_left, bottom_left, bottom_right, top_right, color,
+                     std::move(*user_data), shading_direction);
+}
+
+void Batcher::AddShadedTrapezium(const Vec3& top_left, const Vec3& bottom_left,
+                                 const Vec3& bottom_right, const Vec3& top_right,
+                                 const Color& color, PickingUserData user_data,
+                                 ShadingDirection shading_direction) {
   std::array<Color, 4> colors;  // top_left, bottom_left, bottom_right, top_right.
   GetBoxGradientColors(color, &colors, shading_direction);
   Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
   Triangle triangle_1{top_left, bottom_left, top_right};
   std::array<Color, 3> colors_1{colors[0], colors[1], colors[2]};
-  AddTriangle(triangle_1, colors_1, picking_color, std::make_unique<PickingUserData>(*user_data));
+  AddTriangle(triangle_1, colors_1, picking_color, user_data);
   Triangle triangle_2{bottom_left, bottom_right, top_right};
   std::array<Color, 3> colors_2{colors[1], colors[2], colors[3]};
   AddTriangle(triangle_2, colors_2, picking_color, std::move(user_data));
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const std::array<Color, 3>& colors,
-                          const Color& picking_color, std::unique_ptr<PickingUserData> user_data) {
+                          const Color& picking_color, std::optional<PickingUserData> user_data) {
   Triangle rounded_tri = triangle;
   for (auto& vertice : rounded_tri.vertices) {
     vertice[0] = floorf(vertice[0]);
     vertice[1] = floorf(vertice[1]);
   }
+  user_data_.push_back(std::move(user_data));
+
+  if (recording_ != nullptr) {
+    recording_->triangles.push_back({rounded_tri, colors, RecordPickingColor(picking_color)});
+    recording_->user_data.push_back(user_data_.back());
+    if (recording_mode_ == BatcherRecordingMode::kRecordOnly) return;
+  }
+
   float layer_z_value = rounded_tri.vertices[0][2];
-  auto& buffer = primitive_buffers_by_layer_[layer_z_value];
+  PrimitiveBuffers& buffer = GetPrimitiveBuffers(layer_z_value);
   buffer.triangle_buffer.triangles_.emplace_back(rounded_tri);
   buffer.triangle_buffer.colors_.push_back(colors);
   buffer.triangle_buffer.picking_colors_.push_back_n(picking_color, 3);
-  user_data_.push_back(std::move(user_data));
 }
 
 void Batcher::AddCircle(Vec2 position, float radius, float z, Color color) {
@@ -289,7 +359,7 @@ const PickingUserData* Batcher::GetUserData(PickingId id) const {
     case PickingType::kTriangle:
     case PickingType::kLine:
       CHECK(id.element_id < user_data_.size());
-      return user_data_[id.element_id].get();
+      return user_data_[id.element_id].has_value() ? &user_data_[id.element_id].value() : nullptr;
     case PickingType::kPickable:
       return nullptr;
     case PickingType::kCount:
@@ -348,6 +418,15 @@ void Batcher::GetBoxGradientColors(const Color& color, std::array<Color, 4>* col
   }
 }
 
+PrimitiveBuffers& Batcher::GetPrimitiveBuffers(float layer) {
+  if (last_primitive_buffers_ == nullptr || layer != last_layer_) {
+    // Elements of std::map stay where they are, and layers are never removed.
+    last_primitive_buffers_ = &primitive_buffers_by_layer_[layer];
+    last_layer_ = layer;
+  }
+  return *last_primitive_buffers_;
+}
+
 void Batcher::ResetElements() {
   for (auto& [unused_layer, buffer] : primitive_buffers_by_layer_) {
     buffer.Reset();
@@ -359,6 +438,137 @@ void Batcher::StartNewFrame() {
   user_data_.clear();
 }
 
+void Batcher::StartRecording(BatcherRecording* recording, BatcherRecordingMode mode) {
+  CHECK(recording != nullptr);
+  CHECK(recording_ == nullptr);
+  recording->Clear();
+  recording_ = recording;
+  recording_mode_ = mode;
+  recording_user_data_offset_ = user_data_.size();
+  recorded_pickable_indices_.clear();
+}
+
+void Batcher::ContinueRecording(BatcherRecording* recording) {
+  CHECK(recording != nullptr);
+  CHECK(recording_ == nullptr);
+  CHECK(user_data_.size() >= recording->user_data.size());
+  recording_ = recording;
+  recording_mode_ = BatcherRecordingMode::kAddAndRecord;
+  // The user data of the replayed primitives is the last one of the batcher, so new user data
+  // continues the indices of the recording.
+  recording_user_data_offset_ = user_data_.size() - recording->user_data.size();
+  recorded_pickable_indices_.clear();
+}
+
+void Batcher::StopRecording() {
+  CHECK(recording_ != nullptr);
+  recording_ = nullptr;
+}
+
+// Picking colors of user data are stored with the index of the user data in the recording, and
+// picking colors of pickables with the index of the pickable in the recording.
+Color Batcher::RecordPickingColor(const Color& picking_color) {
+  const PickingId id = PickingIdFromColor(picking_color);
+  switch (id.type) {
+    case PickingType::kBox:
+    case PickingType::kTriangle:
+    case PickingType::kLine:
+      CHECK(id.element_id >= recording_user_data_offset_);
+      return PickingId::ToColor(id.type, id.element_id - recording_user_data_offset_, batcher_id_);
+    case PickingType::kPickable: {
+      auto [it, inserted] =
+          recorded_pickable_indices_.try_emplace(id.element_id, recording_->pickables.size());
+      if (inserted) {
+        CHECK(picking_manager_ != nullptr);
+        recording_->pickables.push_back(picking_manager_->GetPickableFromId(id));
+      }
+      return PickingId::ToColor(PickingType::kPickable, it->second, batcher_id_);
+    }
+    case PickingType::kInvalid:
+      return picking_color;
+    case PickingType::kCount:
+      UNREACHABLE();
+  }
+  UNREACHABLE();
+}
+
+Color Batcher::ReplayPickingColor(const Color& recorded_picking_color,
+                                  const std::vector<Color>& pickable_colors,
+                                  uint32_t user_data_offset) const {
+  const PickingId id = PickingIdFromColor(recorded_picking_color);
+  switch (id.type) {
+    case PickingType::kBox:
+    case PickingType::kTriangle:
+    case PickingType::kLine:
+      return PickingId::ToColor(id.type, id.element_id + user_data_offset, batcher_id_);
+    case PickingType::kPickable:
+      CHECK(id.element_id < pickable_colors.size());
+      return pickable_colors[id.element_id];
+    case PickingType::kInvalid:
+      return recorded_picking_color;
+    case PickingType::kCount:
+      UNREACHABLE();
+  }
+  UNREACHABLE();
+}
+
+void BatcherRecording::TranslateX(float offset_x) {
+  for (RecordedLine& line : lines) {
+    line.line.start_point[0] += offset_x;
+    line.line.end_point[0] += offset_x;
+  }
+  for (RecordedBox& box : boxes) {
+    for (Vec3& vertex : box.box.vertices) vertex[0] += offset_x;
+  }
+  for (RecordedTriangle& triangle : triangles) {
+    for (Vec3& vertex : triangle.triangle.vertices) vertex[0] += offset_x;
+  }
+}
+
+void Batcher::Replay(const BatcherRecording& recording) {
+  CHECK(recording_ == nullptr);
+  const uint32_t user_data_offset = user_data_.size();
+
+  // Pickables get new ids whenever the picking manager is reset, so their colors are looked up
+  // again. The ones that don't exist anymore can't be picked.
+  std::vector<Color> pickable_colors;
+  pickable_colors.reserve(recording.pickables.size());
+  for (const std::weak_ptr<Pickable>& weak_pickable : recording.pickables) {
+    std::shared_ptr<Pickable> pickable = weak_pickable.lock();
+    if (pickable == nullptr) {
+      pickable_colors.push_back(PickingId::ToColor(PickingType::kInvalid, 0, batcher_id_));
+      continue;
+    }
+    CHECK(picking_manager_ != nullptr);
+    pickable_colors.push_back(picking_manager_->GetPickableColor(pickable, batcher_id_));
+  }
+
+  for (const BatcherRecording::RecordedLine& line : recording.lines) {
+    LineBuffer& buffer = GetPrimitiveBuffers(line.line.start_point[2]).line_buffer;
+    buffer.lines_.emplace_back(line.line);
+    buffer.colors_.push_back_n(line.color, 2);
+    buffer.picking_colors_.push_back_n(
+        ReplayPickingColor(line.picking_color, pickable_colors, user_data_offset), 2);
+  }
+  for (const BatcherRecording::RecordedBox& box : recording.boxes) {
+    BoxBuffer& buffer = GetPrimitiveBuffers(box.box.vertices[0][2]).box_buffer;
+    buffer.boxes_.emplace_back(box.box);
+    buffer.colors_.push_back(box.colors);
+    buffer.picking_colors_.push_back_n(
+        ReplayPickingColor(box.picking_color, pickable_colors, user_data_offset), 4);
+    ++buffer.generation_;
+  }
+  for (const BatcherRecording::RecordedTriangle& triangle : recording.triangles) {
+    TriangleBuffer& buffer = GetPrimitiveBuffers(triangle.triangle.vertices[0][2]).triangle_buffer;
+    buffer.triangles_.emplace_back(triangle.triangle);
+    buffer.colors_.push_back(triangle.colors);
+    buffer.picking_colors_.push_back_n(
+        ReplayPickingColor(triangle.picking_color, pickable_colors, user_data_offset), 3);
+  }
+
+  user_data_.insert(user_data_.end(), recording.user_data.begin(), recording.user_data.end());
+}
+
 std::vector<float> Batcher::GetLayers() const {
   std::vector<float> layers;
   for (auto& [layer, _] : primitive_buffers_by_layer_) {
@@ -378,12 +588,15 @@ void Batcher::DrawLayer(float layer, bool picking) const {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   }
   glDisable(GL_CULL_FACE);
+  // The instanced boxes are drawn from generic vertex attributes, which can alias the client-side
+  // vertex and color arrays, so they are drawn before those are enabled.
+  const bool boxes_drawn = DrawBoxBufferInstanced(layer, picking);
   glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_COLOR_ARRAY);
   glEnable(GL_TEXTURE_2D);
   glLineWidth(2.0f);
 
-  DrawBoxBuffer(layer, picking);
+  if (!boxes_drawn) DrawBoxBuffer(layer, picking);
   DrawLineBuffer(layer, picking);
   DrawTriangleBuffer(layer, picking);
 
@@ -417,6 +630,11 @@ void Batcher::DrawBoxBuffer(float layer, bool picking) const {
   }
 }
 
+bool Batcher::DrawBoxBufferInstanced(float layer, bool picking) const {
+  return instanced_box_renderer_.Draw(layer, primitive_buffers_by_layer_.at(layer).box_buffer,
+                                      picking);
+}
+
 void Batcher::DrawLineBuffer(float layer, bool picking) const {
   auto& line_buffer = primitive_buffers_by_layer_.at(layer).line_buffer;
   const Block<Line, LineBuffer::NUM_LINES_PER_BLOCK>* line_block = line_buffer.lines_.root();
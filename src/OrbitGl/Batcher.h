@@ -11,7 +11,9 @@
 #include <algorithm>
 #include <array>
 #include <functional>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -21,6 +23,7 @@
 #include "ClientData/TextBox.h"
 #include "CoreMath.h"
 #include "Geometry.h"
+#include "InstancedBoxRenderer.h"
 #include "PickingManager.h"
 
 using TooltipCallback = std::function<std::string(PickingId)>;
@@ -53,12 +56,16 @@ struct BoxBuffer {
     boxes_.Reset();
     colors_.Reset();
     picking_colors_.Reset();
+    ++generation_;
   }
 
   static const int NUM_BOXES_PER_BLOCK = 64 * 1024;
   BlockChain<Box, NUM_BOXES_PER_BLOCK> boxes_;
   BlockChain<Color, 4 * NUM_BOXES_PER_BLOCK> colors_;
   BlockChain<Color, 4 * NUM_BOXES_PER_BLOCK> picking_colors_;
+  // Changes whenever boxes are added or reset, so that copies of the boxes, e.g., on the GPU, can
+  // tell whether they are out of date.
+  uint64_t generation_ = 0;
 };
 
 struct TriangleBuffer {
@@ -86,11 +93,64 @@ struct PrimitiveBuffers {
   TriangleBuffer triangle_buffer;
 };
 
+// The primitives added to a Batcher between Batcher::StartRecording and Batcher::StopRecording,
+// together with copies of their user data, so that they can be added again with Batcher::Replay
+// instead of being generated again. Picking colors are stored relative to the recording, and are
+// translated to the user data and the pickables of the batcher they are replayed into.
+struct BatcherRecording {
+  void Clear() {
+    lines.clear();
+    boxes.clear();
+    triangles.clear();
+    user_data.clear();
+    pickables.clear();
+  }
+
+  // Moves all the recorded primitives horizontally, e.g., when the time range they show scrolled.
+  void TranslateX(float offset_x);
+
+  struct RecordedLine {
+    Line line;
+    Color color;
+    Color picking_color;
+  };
+  struct RecordedBox {
+    Box box;
+    std::array<Color, 4> colors;
+    Color picking_color;
+  };
+  struct RecordedTriangle {
+    Triangle triangle;
+    std::array<Color, 3> colors;
+    Color picking_color;
+  };
+
+  std::vector<RecordedLine> lines;
+  std::vector<RecordedBox> boxes;
+  std::vector<RecordedTriangle> triangles;
+  // One entry per primitive, in the order in which they were added.
+  std::vector<std::optional<PickingUserData>> user_data;
+  std::vector<std::weak_ptr<Pickable>> pickables;
+};
+
+enum class BatcherRecordingMode {
+  // The primitives are added to the batcher and to the recording.
+  kAddAndRecord,
+  // The primitives are only added to the recording, e.g., to replay them into a batcher that is
+  // used on another thread.
+  kRecordOnly
+};
+
 enum class ShadingDirection { kLeftToRight, kRightToLeft, kTopToBottom, kBottomToTop };
 
 /**
 Collects primitives to be rendered at a later point in time.
 
+The user data of a primitive is kept by value. The overloads that take PickingUserData by value
+should be preferred for primitives that are added in large numbers, as, unlike the ones that take
+a std::unique_ptr, they don't need a heap allocation per primitive. Tooltips are only generated,
+from the user data, for the primitive that is hovered.
+
 By calling Batcher::AddXXX, primitives are added to internal CPU buffers, and sorted
 into layers formed by equal z-coordinates. Each layer can then be drawn seperately with
 Batcher::DrawLayer(), or all layers can be drawn at once in their correct order using
@@ -121,6 +181,8 @@ class Batcher {
                std::unique_ptr<PickingUserData> user_data = nullptr);
   void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
                        std::unique_ptr<PickingUserData> user_data = nullptr);
+  void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
+                       PickingUserData user_data);
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color, std::shared_ptr<Pickable> pickable);
   void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
                        std::shared_ptr<Pickable> pickable);
@@ -129,6 +191,7 @@ class Batcher {
               std::unique_ptr<PickingUserData> user_data = nullptr);
   void AddBox(const Box& box, const Color& color,
               std::unique_ptr<PickingUserData> user_data = nullptr);
+  void AddBox(const Box& box, const Color& color, PickingUserData user_data);
   void AddBox(const Box& box, const Color& color, std::shared_ptr<Pickable> pickable);
 
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color);
@@ -137,6 +200,8 @@ class Batcher {
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                     std::unique_ptr<PickingUserData> user_data,
                     ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
+  void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color, PickingUserData user_data,
+                    ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                     std::shared_ptr<Pickable> pickable,
                     ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
@@ -154,6 +219,9 @@ class Batcher {
                           const Vec3& top_right, const Color& color,
                           std::unique_ptr<PickingUserData> user_data = nullptr,
                           ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
+  void AddShadedTrapezium(const Vec3& top_left, const Vec3& bottom_left, const Vec3& bottom_right,
+                          const Vec3& top_right, const Color& color, PickingUserData user_data,
+                          ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
   void AddTriangle(const Triangle& triangle, const Color& color,
                    std::shared_ptr<Pickable> pickable);
 
@@ -165,6 +233,18 @@ class Batcher {
   void ResetElements();
   void StartNewFrame();
 
+  // Until StopRecording is called, the primitives that are added are also added to `recording`,
+  // which is cleared first.
+  void StartRecording(BatcherRecording* recording,
+                      BatcherRecordingMode mode = BatcherRecordingMode::kAddAndRecord);
+  // Like StartRecording, but the primitives are appended to the ones `recording` already has,
+  // which must have been replayed into this batcher right before.
+  void ContinueRecording(BatcherRecording* recording);
+  void StopRecording();
+  // Adds the primitives of `recording` again, as if the calls that were recorded were repeated.
+  void Replay(const BatcherRecording& recording);
+
+  [[nodiscard]] BatcherId GetBatcherId() const { return batcher_id_; }
   [[nodiscard]] PickingManager* GetPickingManager() const { return picking_manager_; }
   void SetPickingManager(PickingManager* picking_manager) { picking_manager_ = picking_manager; }
 
@@ -184,22 +264,46 @@ class Batcher {
                             ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
 
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Color& picking_color,
-               std::unique_ptr<PickingUserData> user_data = nullptr);
+               std::optional<PickingUserData> user_data = std::nullopt);
   void AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              std::optional<PickingUserData> user_data = std::nullopt);
   void AddTriangle(const Triangle& triangle, const Color& color, const Color& picking_color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   std::optional<PickingUserData> user_data = std::nullopt);
   void AddTriangle(const Triangle& triangle, const std::array<Color, 3>& colors,
                    const Color& picking_color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   std::optional<PickingUserData> user_data = std::nullopt);
 
   BatcherId batcher_id_;
   PickingManager* picking_manager_;
-  std::unordered_map<float, PrimitiveBuffers> primitive_buffers_by_layer_;
+  // There are only a few layers, so they are kept in order, which is also the one they are drawn
+  // in, rather than hashed.
+  std::map<float, PrimitiveBuffers> primitive_buffers_by_layer_;
 
-  std::vector<std::unique_ptr<PickingUserData>> user_data_;
+  std::vector<std::optional<PickingUserData>> user_data_;
 
   std::vector<Vec2> circle_points;
+
+ private:
+  [[nodiscard]] Color RecordPickingColor(const Color& picking_color);
+  [[nodiscard]] Color ReplayPickingColor(const Color& recorded_picking_color,
+                                         const std::vector<Color>& pickable_colors,
+                                         uint32_t user_data_offset) const;
+
+  // Consecutive primitives are mostly in the same layer, so its buffers are looked up only once.
+  [[nodiscard]] PrimitiveBuffers& GetPrimitiveBuffers(float layer);
+
+  float last_layer_ = 0.f;
+  PrimitiveBuffers* last_primitive_buffers_ = nullptr;
+
+  BatcherRecording* recording_ = nullptr;
+  BatcherRecordingMode recording_mode_ = BatcherRecordingMode::kAddAndRecord;
+  uint32_t recording_user_data_offset_ = 0;
+  std::unordered_map<uint32_t, uint32_t> recorded_pickable_indices_;
+
+  // Returns false if the boxes need to be drawn from client-side arrays instead.
+  [[nodiscard]] bool DrawBoxBufferInstanced(float layer, bool picking) const;
+
+  mutable InstancedBoxRenderer instanced_box_renderer_;
 };
 
 #endif
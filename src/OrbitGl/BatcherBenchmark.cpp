@@ -0,0 +1,119 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Batcher.h"
+#include "CoreMath.h"
+#include "Geometry.h"
+#include "PickingManager.h"
+#include "PrimitivesCache.h"
+#include "TextRenderer.h"
+
+namespace orbit_gl {
+
+namespace {
+
+class PickableBox : public Pickable {
+ public:
+  void OnPick(int /*x*/, int /*y*/) override {}
+};
+
+const Color kBoxColor(255, 0, 0, 255);
+
+const Vec2 kBoxSize(1, 1);
+
+// The boxes are laid out in rows of the width of a large screen.
+[[nodiscard]] Vec2 GetBoxPos(int64_t index) {
+  return Vec2(static_cast<float>(index % 4000), static_cast<float>(index / 4000));
+}
+
+[[nodiscard]] std::string GetTooltip(PickingId id) { return std::to_string(id.element_id); }
+
+// Adding the boxes of a frame, as tracks do with their timers.
+void BM_AddBoxesWithUserDataByValue(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      batcher.AddShadedBox(GetBoxPos(i), kBoxSize, 0, kBoxColor,
+                           PickingUserData(nullptr, &GetTooltip));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddBoxesWithUserDataByValue)->Arg(1'000)->Arg(100'000);
+
+void BM_AddBoxesWithUserDataInUniquePtr(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      batcher.AddShadedBox(GetBoxPos(i), kBoxSize, 0, kBoxColor,
+                           std::make_unique<PickingUserData>(nullptr, &GetTooltip));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddBoxesWithUserDataInUniquePtr)->Arg(1'000)->Arg(100'000);
+
+void BM_AddBoxesWithPickable(benchmark::State& state) {
+  PickingManager picking_manager;
+  Batcher batcher(BatcherId::kUi, &picking_manager);
+  auto pickable = std::make_shared<PickableBox>();
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    picking_manager.Reset();
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      batcher.AddBox(Box(GetBoxPos(i), kBoxSize, 0), kBoxColor, pickable);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddBoxesWithPickable)->Arg(1'000)->Arg(100'000);
+
+// Adding the boxes of a track whose primitives are cached, e.g., when only scrolling vertically.
+void BM_ReplayCachedBoxes(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  TextRenderer text_renderer;
+  PrimitivesCache cache;
+  PrimitivesCacheKey key;
+  cache.UpdateOrReplay(key, &batcher, &text_renderer, [&] {
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      batcher.AddBox(Box(GetBoxPos(i), kBoxSize, 0), kBoxColor,
+                     PickingUserData(nullptr, &GetTooltip));
+    }
+  });
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    cache.UpdateOrReplay(key, &batcher, &text_renderer, [] {});
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReplayCachedBoxes)->Arg(1'000)->Arg(100'000);
+
+// Finding and generating the tooltip of the box under the mouse, as a picking pass does.
+void BM_GetTooltipOfPickedBox(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    batcher.AddBox(Box(GetBoxPos(i), kBoxSize, 0), kBoxColor,
+                   PickingUserData(nullptr, &GetTooltip));
+  }
+  uint32_t element_id = 0;
+  for (auto _ : state) {
+    const PickingId id = PickingId::Create(PickingType::kBox, element_id);
+    const PickingUserData* user_data = batcher.GetUserData(id);
+    benchmark::DoNotOptimize(user_data->generate_tooltip_(id));
+    element_id = (element_id + 7919) % state.range(0);
+  }
+}
+BENCHMARK(BM_GetTooltipOfPickedBox)->Arg(100'000);
+
+}  // namespace
+
+}  // namespace orbit_gl
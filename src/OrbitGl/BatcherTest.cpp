@@ -167,6 +167,33 @@ TEST(Batcher, PickingSimpleElements) {
   ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], box_custom_data);
 }
 
+TEST(Batcher, PickingElementsWithUserDataByValue) {
+  MockBatcher batcher(BatcherId::kUi);
+
+  std::string line_custom_data = "line custom data";
+  PickingUserData line_user_data;
+  line_user_data.custom_data_ = &line_custom_data;
+
+  std::string triangle_custom_data = "triangle custom data";
+  PickingUserData triangle_user_data;
+  triangle_user_data.custom_data_ = &triangle_custom_data;
+
+  std::string box_custom_data = "box custom data";
+  PickingUserData box_user_data;
+  box_user_data.custom_data_ = &box_custom_data;
+
+  batcher.AddVerticalLine(Vec2(0, 0), 1, 0, Color(255, 255, 255, 255), line_user_data);
+  batcher.AddShadedTrapezium(Vec3(0, 1, 0), Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(1, 1, 0),
+                             Color(0, 255, 0, 255), triangle_user_data);
+  batcher.AddShadedBox(Vec2(0, 0), Vec2(1, 1), 0, Color(255, 0, 0, 255), box_user_data);
+
+  batcher.Draw(true);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnLineColors()[0], line_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnTriangleColors()[0], triangle_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnTriangleColors()[1], triangle_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], box_custom_data);
+}
+
 void ExpectPickableEq(const MockBatcher& batcher, const Color& rendered_color, PickingManager& pm,
                       const std::shared_ptr<const Pickable>& pickable) {
   PickingId id = MockRenderPickingColor(rendered_color);
@@ -237,4 +264,140 @@ TEST(Batcher, MultipleDrawCalls) {
   EXPECT_DEATH((void)batcher.GetUserData(id), "size");
 }
 
-}  // namespace
\ No newline at end of file
+TEST(Batcher, ReplayRecording) {
+  PickingManager pm;
+  MockBatcher batcher(BatcherId::kUi, &pm);
+  std::shared_ptr<PickableMock> pickable = std::make_shared<PickableMock>();
+
+  std::string line_custom_data = "line custom data";
+  auto line_user_data = std::make_unique<PickingUserData>();
+  line_user_data->custom_data_ = &line_custom_data;
+
+  std::string box_custom_data = "box custom data";
+  auto box_user_data = std::make_unique<PickingUserData>();
+  box_user_data->custom_data_ = &box_custom_data;
+
+  BatcherRecording recording;
+  batcher.StartRecording(&recording);
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), std::move(line_user_data));
+  batcher.AddTriangle(Triangle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(1, 0, 0)), Color(0, 255, 0, 255),
+                      pickable);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), std::move(box_user_data));
+  batcher.StopRecording();
+  EXPECT_EQ(recording.lines.size(), 1);
+  EXPECT_EQ(recording.triangles.size(), 1);
+  EXPECT_EQ(recording.boxes.size(), 1);
+
+  batcher.StartNewFrame();
+  pm.Reset();
+  // Replayed primitives need to refer to their user data also when preceded by other primitives.
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(0, 0, 255, 255));
+  batcher.Replay(recording);
+  ExpectDraw(batcher, 2, 1, 1);
+  EXPECT_EQ(batcher.GetDrawnLineColors()[1], Color(255, 255, 255, 255));
+  EXPECT_EQ(batcher.GetDrawnTriangleColors()[0], Color(0, 255, 0, 255));
+  EXPECT_EQ(batcher.GetDrawnBoxColors()[0], Color(255, 0, 0, 255));
+
+  batcher.ResetMockDrawCounts();
+  batcher.Draw(true);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnLineColors()[1], line_custom_data);
+  ExpectPickableEq(batcher, batcher.GetDrawnTriangleColors()[0], pm, pickable);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], box_custom_data);
+}
+
+TEST(Batcher, ReplayRecordingWithDestroyedPickable) {
+  PickingManager pm;
+  MockBatcher batcher(BatcherId::kUi, &pm);
+  std::shared_ptr<PickableMock> pickable = std::make_shared<PickableMock>();
+
+  BatcherRecording recording;
+  batcher.StartRecording(&recording);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), pickable);
+  batcher.StopRecording();
+
+  batcher.StartNewFrame();
+  pm.Reset();
+  pickable.reset();
+  batcher.Replay(recording);
+
+  batcher.ResetMockDrawCounts();
+  batcher.Draw(true);
+  ASSERT_EQ(batcher.GetDrawnBoxColors().size(), 1);
+  EXPECT_EQ(MockRenderPickingColor(batcher.GetDrawnBoxColors()[0]).type, PickingType::kInvalid);
+}
+
+TEST(Batcher, ReplayRecordingOnlyRecording) {
+  PickingManager pm;
+  MockBatcher recording_batcher(BatcherId::kUi, &pm);
+  std::shared_ptr<PickableMock> pickable = std::make_shared<PickableMock>();
+
+  std::string box_custom_data = "box custom data";
+  auto box_user_data = std::make_unique<PickingUserData>();
+  box_user_data->custom_data_ = &box_custom_data;
+
+  BatcherRecording recording;
+  recording_batcher.StartRecording(&recording, BatcherRecordingMode::kRecordOnly);
+  recording_batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), pickable);
+  recording_batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                           std::move(box_user_data));
+  recording_batcher.StopRecording();
+  EXPECT_EQ(recording.lines.size(), 1);
+  EXPECT_EQ(recording.boxes.size(), 1);
+  ExpectDraw(recording_batcher, 0, 0, 0);
+
+  MockBatcher batcher(BatcherId::kUi, &pm);
+  batcher.Replay(recording);
+  ExpectDraw(batcher, 1, 0, 1);
+
+  batcher.ResetMockDrawCounts();
+  batcher.Draw(true);
+  ExpectPickableEq(batcher, batcher.GetDrawnLineColors()[0], pm, pickable);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], box_custom_data);
+}
+
+TEST(Batcher, ContinueRecordingAppendsToReplayedRecording) {
+  PickingManager pm;
+  MockBatcher batcher(BatcherId::kUi, &pm);
+
+  std::string first_box_custom_data = "first box custom data";
+  auto first_box_user_data = std::make_unique<PickingUserData>();
+  first_box_user_data->custom_data_ = &first_box_custom_data;
+  std::string second_box_custom_data = "second box custom data";
+  auto second_box_user_data = std::make_unique<PickingUserData>();
+  second_box_user_data->custom_data_ = &second_box_custom_data;
+
+  BatcherRecording recording;
+  batcher.StartRecording(&recording);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 std::move(first_box_user_data));
+  batcher.StopRecording();
+
+  batcher.StartNewFrame();
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(0, 0, 255, 255));
+  batcher.Replay(recording);
+  batcher.ContinueRecording(&recording);
+  batcher.AddBox(Box(Vec2(2, 0), Vec2(1, 1), 0), Color(0, 255, 0, 255),
+                 std::move(second_box_user_data));
+  batcher.StopRecording();
+  EXPECT_EQ(recording.boxes.size(), 2);
+  ExpectDraw(batcher, 1, 0, 2);
+
+  recording.TranslateX(-2.f);
+  EXPECT_EQ(recording.boxes[0].box.vertices[0][0], -2.f);
+  EXPECT_EQ(recording.boxes[1].box.vertices[0][0], 0.f);
+
+  batcher.StartNewFrame();
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(0, 0, 255, 255));
+  batcher.AddLine(Vec2(0, 1), Vec2(1, 1), 0, Color(0, 0, 255, 255));
+  batcher.Replay(recording);
+  ExpectDraw(batcher, 2, 0, 2);
+  EXPECT_EQ(batcher.GetDrawnBoxColors()[0], Color(255, 0, 0, 255));
+  EXPECT_EQ(batcher.GetDrawnBoxColors()[1], Color(0, 255, 0, 255));
+
+  batcher.ResetMockDrawCounts();
+  batcher.Draw(true);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], first_box_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[1], second_box_custom_data);
+}
+
+}  // namespace
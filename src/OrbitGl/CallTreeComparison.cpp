@@ -0,0 +1,69 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CallTreeComparison.h"
+
+#include <absl/strings/str_format.h>
+
+uint64_t CallTreeComparisonNode::GetBaselineExclusiveSampleCount() const {
+  uint64_t children_sample_count = 0;
+  for (const auto& child : children_) {
+    if (child->type() == Type::kUnwindErrors) continue;
+    children_sample_count += child->baseline_sample_count();
+  }
+  return baseline_sample_count_ - children_sample_count;
+}
+
+uint64_t CallTreeComparisonNode::GetComparisonExclusiveSampleCount() const {
+  uint64_t children_sample_count = 0;
+  for (const auto& child : children_) {
+    if (child->type() == Type::kUnwindErrors) continue;
+    children_sample_count += child->comparison_sample_count();
+  }
+  return comparison_sample_count_ - children_sample_count;
+}
+
+CallTreeComparisonNode* CallTreeComparisonNode::GetOrCreateChild(
+    Type type, const std::string& name, const std::string& module_path,
+    const std::string& module_build_id) {
+  auto [it, inserted] =
+      children_by_type_name_and_module_build_id_.try_emplace({type, name, module_build_id});
+  if (inserted) {
+    it->second = children_
+                     .emplace_back(std::make_unique<CallTreeComparisonNode>(
+                         type, name, module_path, module_build_id, this))
+                     .get();
+  }
+  return it->second;
+}
+
+void CallTreeComparisonNode::AddSubtree(const CallTreeNode& node, bool is_baseline) {
+  (is_baseline ? baseline_sample_count_ : comparison_sample_count_) += node.sample_count();
+
+  for (const CallTreeNode* child : node.children()) {
+    CallTreeComparisonNode* comparison_child;
+    if (auto* function = dynamic_cast<const CallTreeFunction*>(child); function != nullptr) {
+      comparison_child = GetOrCreateChild(Type::kFunction, function->function_name(),
+                                          function->module_path(), function->module_build_id());
+    } else if (auto* thread = dynamic_cast<const CallTreeThread*>(child); thread != nullptr) {
+      // Without a name, the thread id is all there is to match.
+      const std::string thread_name = thread->thread_name().empty()
+                                          ? absl::StrFormat("[%d]", thread->thread_id())
+                                          : thread->thread_name();
+      comparison_child = GetOrCreateChild(Type::kThread, thread_name, "", "");
+    } else {
+      comparison_child = GetOrCreateChild(Type::kUnwindErrors, "", "", "");
+    }
+    comparison_child->AddSubtree(*child, is_baseline);
+  }
+}
+
+std::unique_ptr<CallTreeComparisonNode> CreateCallTreeComparison(
+    const CallTreeView& baseline_view, const CallTreeView& comparison_view) {
+  auto root = std::make_unique<CallTreeComparisonNode>(CallTreeComparisonNode::Type::kRoot, "", "",
+                                                       "", nullptr);
+  root->AddSubtree(baseline_view, /*is_baseline=*/true);
+  root->AddSubtree(comparison_view, /*is_baseline=*/false);
+  return root;
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_CALL_TREE_COMPARISON_H_
+#define ORBIT_GL_CALL_TREE_COMPARISON_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "CallTreeView.h"
+
+// A node of the comparison of two call trees, e.g., of the top-down views of a baseline capture and
+// of another capture of the same program. Thread ids and addresses differ between runs, so threads
+// are matched by name, and functions by function name and module build id.
+class CallTreeComparisonNode {
+ public:
+  enum class Type { kRoot, kThread, kFunction, kUnwindErrors };
+
+  explicit CallTreeComparisonNode(Type type, std::string name, std::string module_path,
+                                  std::string module_build_id,
+                                  const CallTreeComparisonNode* parent)
+      : type_{type},
+        name_{std::move(name)},
+        module_path_{std::move(module_path)},
+        module_build_id_{std::move(module_build_id)},
+        parent_{parent} {}
+
+  [[nodiscard]] Type type() const { return type_; }
+  // The thread name or the function name. Empty for the root and for unwind errors.
+  [[nodiscard]] const std::string& name() const { return name_; }
+  [[nodiscard]] const std::string& module_path() const { return module_path_; }
+  [[nodiscard]] const std::string& module_build_id() const { return module_build_id_; }
+
+  [[nodiscard]] const CallTreeComparisonNode* parent() const { return parent_; }
+  [[nodiscard]] const std::vector<std::unique_ptr<CallTreeComparisonNode>>& children() const {
+    return children_;
+  }
+
+  // Zero if the node is not in that tree.
+  [[nodiscard]] uint64_t baseline_sample_count() const { return baseline_sample_count_; }
+  [[nodiscard]] uint64_t comparison_sample_count() const { return comparison_sample_count_; }
+  [[nodiscard]] uint64_t GetBaselineExclusiveSampleCount() const;
+  [[nodiscard]] uint64_t GetComparisonExclusiveSampleCount() const;
+
+  // The differences between the percentages of the samples of each tree, as the trees usually
+  // don't have the same number of samples.
+  [[nodiscard]] float GetInclusivePercentDelta(uint64_t baseline_total_sample_count,
+                                               uint64_t comparison_total_sample_count) const {
+    return GetPercent(comparison_sample_count_, comparison_total_sample_count) -
+           GetPercent(baseline_sample_count_, baseline_total_sample_count);
+  }
+  [[nodiscard]] float GetExclusivePercentDelta(uint64_t baseline_total_sample_count,
+                                               uint64_t comparison_total_sample_count) const {
+    return GetPercent(GetComparisonExclusiveSampleCount(), comparison_total_sample_count) -
+           GetPercent(GetBaselineExclusiveSampleCount(), baseline_total_sample_count);
+  }
+
+  // Adds the samples of the subtree of `node` to this subtree.
+  void AddSubtree(const CallTreeNode& node, bool is_baseline);
+
+ private:
+  [[nodiscard]] static float GetPercent(uint64_t sample_count, uint64_t total_sample_count) {
+    if (total_sample_count == 0) return 0.f;
+    return 100.0f * sample_count / total_sample_count;
+  }
+
+  [[nodiscard]] CallTreeComparisonNode* GetOrCreateChild(Type type, const std::string& name,
+                                                         const std::string& module_path,
+                                                         const std::string& module_build_id);
+
+  Type type_;
+  std::string name_;
+  std::string module_path_;
+  std::string module_build_id_;
+  const CallTreeComparisonNode* parent_;
+  uint64_t baseline_sample_count_ = 0;
+  uint64_t comparison_sample_count_ = 0;
+  std::vector<std::unique_ptr<CallTreeComparisonNode>> children_;
+  absl::flat_hash_map<std::tuple<Type, std::string, std::string>, CallTreeComparisonNode*>
+      children_by_type_name_and_module_build_id_;
+};
+
+[[nodiscard]] std::unique_ptr<CallTreeComparisonNode> CreateCallTreeComparison(
+    const CallTreeView& baseline_view, const CallTreeView& comparison_view);
+
+#endif  // ORBIT_GL_CALL_TREE_COMPARISON_H_
@@ -0,0 +1,164 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CallTreeComparison.h"
+#include "CallTreeView.h"
+#include "ClientData/PostProcessedSamplingData.h"
+#include "ClientModel/CaptureData.h"
+#include "ClientModel/SamplingDataPostProcessor.h"
+#include "OrbitBase/ThreadConstants.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_model::CaptureData;
+using orbit_client_protos::CallstackInfo;
+
+namespace {
+
+constexpr const char* kThreadName = "thread";
+constexpr const char* kModulePath = "/path/to/module";
+
+// A capture of the program whose functions are at `function_base_address` + 16 * i with the name
+// "function i", and whose only named thread has id `thread_id`.
+class TestCapture {
+ public:
+  explicit TestCapture(uint64_t function_base_address, int32_t thread_id)
+      : capture_data_{nullptr, orbit_grpc_protos::CaptureStarted{}, std::nullopt, {}},
+        function_base_address_{function_base_address},
+        thread_id_{thread_id} {
+    capture_data_.AddOrAssignThreadName(thread_id, kThreadName);
+  }
+
+  // `function_indices` are from the innermost frame to the outermost frame.
+  void AddSamples(const std::vector<uint64_t>& function_indices, uint64_t count,
+                  std::optional<int32_t> thread_id = std::nullopt) {
+    CallstackInfo callstack_info;
+    for (uint64_t function_index : function_indices) {
+      const uint64_t address = function_base_address_ + 16 * function_index;
+      orbit_client_protos::LinuxAddressInfo address_info;
+      address_info.set_absolute_address(address);
+      address_info.set_offset_in_function(0);
+      address_info.set_function_name("function " + std::to_string(function_index));
+      address_info.set_module_path(kModulePath);
+      capture_data_.InsertAddressInfo(address_info);
+      callstack_info.add_frames(address);
+    }
+    callstack_info.set_type(CallstackInfo::kComplete);
+    const uint64_t callstack_id = ++last_callstack_id_;
+    capture_data_.AddUniqueCallstack(callstack_id, std::move(callstack_info));
+
+    for (uint64_t i = 0; i < count; ++i) {
+      orbit_client_protos::CallstackEvent callstack_event;
+      callstack_event.set_callstack_id(callstack_id);
+      callstack_event.set_thread_id(thread_id.value_or(thread_id_));
+      // Callstack events are identified by timestamp.
+      callstack_event.set_time(++last_timestamp_ns_);
+      capture_data_.AddCallstackEvent(std::move(callstack_event));
+    }
+  }
+
+  [[nodiscard]] std::unique_ptr<CallTreeView> CreateTopDownView() const {
+    return CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+        orbit_client_model::CreatePostProcessedSamplingData(*capture_data_.GetCallstackData(),
+                                                            capture_data_),
+        capture_data_);
+  }
+
+ private:
+  CaptureData capture_data_;
+  uint64_t function_base_address_;
+  int32_t thread_id_;
+  uint64_t last_callstack_id_ = 0;
+  uint64_t last_timestamp_ns_ = 0;
+};
+
+[[nodiscard]] const CallTreeComparisonNode* FindChild(const CallTreeComparisonNode& node,
+                                                      const std::string& name) {
+  for (const auto& child : node.children()) {
+    if (child->name() == name) return child.get();
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(CallTreeComparison, MatchesThreadsAndFunctionsByName) {
+  TestCapture baseline{0x1000, 41};
+  baseline.AddSamples({1, 0}, 3);
+  baseline.AddSamples({0}, 1);
+
+  // The other run has different thread ids and addresses.
+  TestCapture comparison{0x5000, 51};
+  comparison.AddSamples({1, 0}, 1);
+  comparison.AddSamples({2, 0}, 2);
+  comparison.AddSamples({0}, 1);
+  // A thread without name is identified by its thread id.
+  comparison.AddSamples({0}, 4, 52);
+
+  std::unique_ptr<CallTreeView> baseline_view = baseline.CreateTopDownView();
+  std::unique_ptr<CallTreeView> comparison_view = comparison.CreateTopDownView();
+  std::unique_ptr<CallTreeComparisonNode> root =
+      CreateCallTreeComparison(*baseline_view, *comparison_view);
+  EXPECT_EQ(root->type(), CallTreeComparisonNode::Type::kRoot);
+  EXPECT_EQ(root->baseline_sample_count(), 4);
+  EXPECT_EQ(root->comparison_sample_count(), 8);
+  // The threads, and the node for all the threads of the process, which has no name here.
+  ASSERT_EQ(root->children().size(), 3);
+
+  const CallTreeComparisonNode* thread = FindChild(*root, kThreadName);
+  ASSERT_NE(thread, nullptr);
+  EXPECT_EQ(thread->type(), CallTreeComparisonNode::Type::kThread);
+  EXPECT_EQ(thread->parent(), root.get());
+  EXPECT_EQ(thread->baseline_sample_count(), 4);
+  EXPECT_EQ(thread->comparison_sample_count(), 4);
+
+  const CallTreeComparisonNode* unnamed_thread = FindChild(*root, "[52]");
+  ASSERT_NE(unnamed_thread, nullptr);
+  EXPECT_EQ(unnamed_thread->baseline_sample_count(), 0);
+  EXPECT_EQ(unnamed_thread->comparison_sample_count(), 4);
+
+  const CallTreeComparisonNode* all_threads =
+      FindChild(*root, absl::StrFormat("[%d]", orbit_base::kAllProcessThreadsTid));
+  ASSERT_NE(all_threads, nullptr);
+  EXPECT_EQ(all_threads->baseline_sample_count(), 4);
+  EXPECT_EQ(all_threads->comparison_sample_count(), 8);
+
+  const CallTreeComparisonNode* function_0 = FindChild(*thread, "function 0");
+  ASSERT_NE(function_0, nullptr);
+  EXPECT_EQ(function_0->type(), CallTreeComparisonNode::Type::kFunction);
+  EXPECT_EQ(function_0->module_path(), kModulePath);
+  EXPECT_EQ(function_0->baseline_sample_count(), 4);
+  EXPECT_EQ(function_0->comparison_sample_count(), 4);
+  EXPECT_EQ(function_0->GetBaselineExclusiveSampleCount(), 1);
+  EXPECT_EQ(function_0->GetComparisonExclusiveSampleCount(), 1);
+  EXPECT_FLOAT_EQ(function_0->GetInclusivePercentDelta(root->baseline_sample_count(),
+                                                       root->comparison_sample_count()),
+                  -50.f);
+  EXPECT_FLOAT_EQ(function_0->GetExclusivePercentDelta(root->baseline_sample_count(),
+                                                       root->comparison_sample_count()),
+                  -12.5f);
+  ASSERT_EQ(function_0->children().size(), 2);
+
+  const CallTreeComparisonNode* function_1 = FindChild(*function_0, "function 1");
+  ASSERT_NE(function_1, nullptr);
+  EXPECT_EQ(function_1->baseline_sample_count(), 3);
+  EXPECT_EQ(function_1->comparison_sample_count(), 1);
+
+  const CallTreeComparisonNode* function_2 = FindChild(*function_0, "function 2");
+  ASSERT_NE(function_2, nullptr);
+  EXPECT_EQ(function_2->baseline_sample_count(), 0);
+  EXPECT_EQ(function_2->comparison_sample_count(), 2);
+  EXPECT_FLOAT_EQ(function_2->GetInclusivePercentDelta(root->baseline_sample_count(),
+                                                       root->comparison_sample_count()),
+                  25.f);
+}
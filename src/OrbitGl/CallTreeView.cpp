@@ -5,15 +5,23 @@
 #include "CallTreeView.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/container/node_hash_map.h>
 #include <absl/meta/type_traits.h>
 #include <absl/strings/str_format.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
+#include <atomic>
 
+#include "ClientData/CallstackPool.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/JoinFutures.h"
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadConstants.h"
 #include "capture_data.pb.h"
 
+using orbit_client_data::CallstackView;
 using orbit_client_data::PostProcessedSamplingData;
 using orbit_client_data::ThreadSampleData;
 
@@ -21,33 +29,23 @@ using orbit_client_model::CaptureData;
 
 using orbit_client_protos::CallstackInfo;
 
-std::vector<const CallTreeNode*> CallTreeNode::children() const {
-  std::vector<const CallTreeNode*> children;
-  for (const auto& tid_and_thread : thread_children_) {
-    children.push_back(&tid_and_thread.second);
-  }
-  for (const auto& address_and_functions : function_children_) {
-    children.push_back(&address_and_functions.second);
-  }
-  if (unwind_errors_child_ != nullptr) {
-    children.push_back(unwind_errors_child_.get());
-  }
-  return children;
-}
+using FunctionInfos = absl::node_hash_map<uint64_t, CallTreeFunctionInfo>;
 
 CallTreeThread* CallTreeNode::GetThreadOrNull(int32_t thread_id) {
   auto thread_it = thread_children_.find(thread_id);
   if (thread_it == thread_children_.end()) {
     return nullptr;
   }
-  return &thread_it->second;
+  return thread_it->second;
 }
 
-CallTreeThread* CallTreeNode::AddAndGetThread(int32_t thread_id, std::string thread_name) {
-  const auto& [it, inserted] = thread_children_.try_emplace(
-      thread_id, CallTreeThread{thread_id, std::move(thread_name), this});
+CallTreeThread* CallTreeNode::AddAndGetThread(int32_t thread_id, std::string thread_name,
+                                              CallTreeNodeArena* arena) {
+  const auto& [it, inserted] = thread_children_.try_emplace(thread_id, nullptr);
   CHECK(inserted);
-  return &it->second;
+  it->second = arena->Create<CallTreeThread>(thread_id, std::move(thread_name), this);
+  children_.push_back(it->second);
+  return it->second;
 }
 
 CallTreeFunction* CallTreeNode::GetFunctionOrNull(uint64_t function_absolute_address) {
@@ -55,102 +53,107 @@ CallTreeFunction* CallTreeNode::GetFunctionOrNull(uint64_t function_absolute_add
   if (function_it == function_children_.end()) {
     return nullptr;
   }
-  return &function_it->second;
+  return function_it->second;
 }
 
 CallTreeFunction* CallTreeNode::AddAndGetFunction(uint64_t function_absolute_address,
-                                                  std::string function_name,
-                                                  std::string module_path,
-                                                  std::string module_build_id) {
-  const auto& [it, inserted] = function_children_.try_emplace(
-      function_absolute_address,
-      CallTreeFunction{function_absolute_address, std::move(function_name), std::move(module_path),
-                       std::move(module_build_id), this});
+                                                  const CallTreeFunctionInfo* function_info,
+                                                  CallTreeNodeArena* arena) {
+  const auto& [it, inserted] = function_children_.try_emplace(function_absolute_address, nullptr);
   CHECK(inserted);
-  return &it->second;
+  it->second = arena->Create<CallTreeFunction>(function_absolute_address, function_info, this);
+  children_.push_back(it->second);
+  return it->second;
 }
 
-CallTreeUnwindErrors* CallTreeNode::GetUnwindErrorsOrNull() { return unwind_errors_child_.get(); }
-
-CallTreeUnwindErrors* CallTreeNode::AddAndGetUnwindErrors() {
+CallTreeUnwindErrors* CallTreeNode::AddAndGetUnwindErrors(CallTreeNodeArena* arena) {
   CHECK(unwind_errors_child_ == nullptr);
-  unwind_errors_child_ = std::make_unique<CallTreeUnwindErrors>(this);
-  return unwind_errors_child_.get();
+  unwind_errors_child_ = arena->Create<CallTreeUnwindErrors>(this);
+  children_.push_back(unwind_errors_child_);
+  return unwind_errors_child_;
 }
 
 uint64_t CallTreeNode::GetExclusiveSampleCount() const {
-  uint64_t children_sample_count = 0;
+  uint64_t children_sample_count = unexpanded_children_sample_count_;
   for (const auto& address_and_function : function_children_) {
-    children_sample_count += address_and_function.second.sample_count();
+    children_sample_count += address_and_function.second->sample_count();
   }
   for (const auto& tid_and_thread : thread_children_) {
-    children_sample_count += tid_and_thread.second.sample_count();
+    children_sample_count += tid_and_thread.second->sample_count();
   }
   return sample_count() - children_sample_count;
 }
 
-[[nodiscard]] static CallTreeFunction* GetOrCreateFunctionNode(CallTreeNode* current_node,
-                                                               uint64_t frame,
-                                                               const std::string& function_name,
-                                                               const std::string& module_path,
-                                                               const std::string& module_build_id) {
-  CallTreeFunction* function_node = current_node->GetFunctionOrNull(frame);
-  if (function_node == nullptr) {
-    std::string formatted_function_name;
-    if (function_name != CaptureData::kUnknownFunctionOrModuleName) {
-      formatted_function_name = function_name;
-    } else {
-      formatted_function_name = absl::StrFormat("[unknown@%#llx]", frame);
+namespace {
+
+// The samples of one callstack in one thread.
+struct CallstackSamples {
+  int32_t thread_id;
+  CallstackView resolved_callstack;
+  uint64_t sample_count;
+};
+
+// A node of the tree and the samples to add below it. The subtrees of different nodes don't share
+// any node, so they can be built in parallel.
+struct SubtreeSamples {
+  CallTreeNode* root;
+  std::vector<CallstackSamples> callstacks;
+  // Estimates the time needed to build the subtree.
+  uint64_t frame_count = 0;
+};
+
+// Stores the function name, module path and module build id of each function that appears in
+// `post_processed_sampling_data`, so that they are only copied once per function instead of once
+// per node, and so that the subtrees can be built in parallel without accessing `capture_data`.
+void AddFunctionInfos(const PostProcessedSamplingData& post_processed_sampling_data,
+                      const CaptureData& capture_data, FunctionInfos* function_infos) {
+  for (const ThreadSampleData& thread_sample_data :
+       post_processed_sampling_data.GetThreadSampleData()) {
+    // These are all the frames of the resolved complete callstacks, and the innermost frames of
+    // the resolved callstacks with unwind errors.
+    for (const auto& [address, unused_count] : thread_sample_data.resolved_address_to_count) {
+      if (function_infos->contains(address)) continue;
+
+      const std::string& function_name = capture_data.GetFunctionNameByAddress(address);
+      std::string formatted_function_name;
+      if (function_name != CaptureData::kUnknownFunctionOrModuleName) {
+        formatted_function_name = function_name;
+      } else {
+        formatted_function_name = absl::StrFormat("[unknown@%#llx]", address);
+      }
+      function_infos->try_emplace(
+          address, CallTreeFunctionInfo{std::move(formatted_function_name),
+                                        capture_data.GetModulePathByAddress(address),
+                                        capture_data.FindModuleBuildIdByAddress(address).value_or(
+                                            "")});
     }
-    function_node = current_node->AddAndGetFunction(frame, std::move(formatted_function_name),
-                                                    module_path, module_build_id);
   }
-  return function_node;
 }
 
-static void AddCallstackToTopDownThread(CallTreeThread* thread_node,
-                                        const CallstackInfo& resolved_callstack,
-                                        uint64_t callstack_sample_count,
-                                        const CaptureData& capture_data) {
-  CallTreeNode* current_thread_or_function = thread_node;
-  for (auto frame_it = resolved_callstack.frames().rbegin();
-       frame_it != resolved_callstack.frames().rend(); ++frame_it) {
-    uint64_t frame = *frame_it;
-    const std::string& function_name = capture_data.GetFunctionNameByAddress(frame);
-    const std::string& module_path = capture_data.GetModulePathByAddress(frame);
-    const std::string module_build_id = capture_data.FindModuleBuildIdByAddress(frame).value_or("");
-
-    CallTreeFunction* function_node = GetOrCreateFunctionNode(
-        current_thread_or_function, frame, function_name, module_path, module_build_id);
-    function_node->IncreaseSampleCount(callstack_sample_count);
-    current_thread_or_function = function_node;
+[[nodiscard]] CallTreeFunction* GetOrCreateFunctionNode(CallTreeNode* current_node, uint64_t frame,
+                                                        const FunctionInfos& function_infos,
+                                                        CallTreeNodeArena* arena) {
+  CallTreeFunction* function_node = current_node->GetFunctionOrNull(frame);
+  if (function_node == nullptr) {
+    auto function_info_it = function_infos.find(frame);
+    CHECK(function_info_it != function_infos.end());
+    function_node = current_node->AddAndGetFunction(frame, &function_info_it->second, arena);
   }
+  return function_node;
 }
 
-static void AddUnwindErrorToTopDownThread(CallTreeThread* thread_node,
-                                          const CallstackInfo& resolved_callstack,
-                                          uint64_t callstack_sample_count,
-                                          const CaptureData& capture_data) {
-  CallTreeUnwindErrors* unwind_errors_node = thread_node->GetUnwindErrorsOrNull();
+[[nodiscard]] CallTreeUnwindErrors* GetOrCreateUnwindErrorsNode(CallTreeNode* current_node,
+                                                                CallTreeNodeArena* arena) {
+  CallTreeUnwindErrors* unwind_errors_node = current_node->GetUnwindErrorsOrNull();
   if (unwind_errors_node == nullptr) {
-    unwind_errors_node = thread_node->AddAndGetUnwindErrors();
+    unwind_errors_node = current_node->AddAndGetUnwindErrors(arena);
   }
-  unwind_errors_node->IncreaseSampleCount(callstack_sample_count);
-
-  CHECK(!resolved_callstack.frames().empty());
-  // Only use the innermost frame for unwind errors.
-  uint64_t frame = resolved_callstack.frames(0);
-  const std::string& function_name = capture_data.GetFunctionNameByAddress(frame);
-  const std::string& module_path = capture_data.GetModulePathByAddress(frame);
-  const std::string module_build_id = capture_data.FindModuleBuildIdByAddress(frame).value_or("");
-  CallTreeFunction* function_node = GetOrCreateFunctionNode(
-      unwind_errors_node, frame, function_name, module_path, module_build_id);
-  function_node->IncreaseSampleCount(callstack_sample_count);
+  return unwind_errors_node;
 }
 
-[[nodiscard]] static CallTreeThread* GetOrCreateThreadNode(
+[[nodiscard]] CallTreeThread* GetOrCreateThreadNode(
     CallTreeNode* current_node, int32_t tid, const std::string& process_name,
-    const absl::flat_hash_map<int32_t, std::string>& thread_names) {
+    const absl::flat_hash_map<int32_t, std::string>& thread_names, CallTreeNodeArena* arena) {
   CallTreeThread* thread_node = current_node->GetThreadOrNull(tid);
   if (thread_node == nullptr) {
     std::string thread_name;
@@ -159,25 +162,133 @@ static void AddUnwindErrorToTopDownThread(CallTreeThread* thread_node,
     } else if (auto thread_name_it = thread_names.find(tid); thread_name_it != thread_names.end()) {
       thread_name = thread_name_it->second;
     }
-    thread_node = current_node->AddAndGetThread(tid, std::move(thread_name));
+    thread_node = current_node->AddAndGetThread(tid, std::move(thread_name), arena);
   }
   return thread_node;
 }
 
+// Calls `add_callstack_to_subtree(root, callstack_samples, arena)` for all the callstacks of all
+// the `subtrees`. Each subtree is built by a single task, which allocates the new nodes in an arena
+// of its own that is appended to `arenas`. The tasks run on `thread_pool`, if any, when there is
+// enough work. The tasks stop early once `cancelled`, if any, is set, leaving the subtrees partial.
+template <typename AddCallstackToSubtree>
+void BuildSubtrees(std::vector<SubtreeSamples> subtrees,
+                   AddCallstackToSubtree&& add_callstack_to_subtree, ThreadPool* thread_pool,
+                   const std::atomic<bool>* cancelled,
+                   std::vector<std::unique_ptr<CallTreeNodeArena>>* arenas) {
+  uint64_t total_frame_count = 0;
+  for (const SubtreeSamples& subtree : subtrees) {
+    total_frame_count += subtree.frame_count;
+  }
+
+  // Below this, scheduling costs more than building on the calling thread.
+  constexpr uint64_t kMinimumNumberOfFramesPerTask = 64 * 1024;
+  constexpr size_t kNumberOfTasksPerThread = 4;
+  size_t number_of_tasks = 1;
+  if (thread_pool != nullptr) {
+    number_of_tasks = std::min<size_t>(
+        {subtrees.size(), kNumberOfTasksPerThread * thread_pool->GetPoolSize(),
+         static_cast<size_t>(total_frame_count / kMinimumNumberOfFramesPerTask)});
+    number_of_tasks = std::max<size_t>(number_of_tasks, 1);
+  }
+
+  // Assign the largest subtrees first, each to the task with the least work so far.
+  std::sort(subtrees.begin(), subtrees.end(),
+            [](const SubtreeSamples& lhs, const SubtreeSamples& rhs) {
+              return lhs.frame_count > rhs.frame_count;
+            });
+  std::vector<std::vector<const SubtreeSamples*>> subtrees_per_task(number_of_tasks);
+  std::vector<uint64_t> frame_count_per_task(number_of_tasks, 0);
+  for (const SubtreeSamples& subtree : subtrees) {
+    const size_t task_index =
+        std::min_element(frame_count_per_task.begin(), frame_count_per_task.end()) -
+        frame_count_per_task.begin();
+    subtrees_per_task[task_index].push_back(&subtree);
+    frame_count_per_task[task_index] += subtree.frame_count;
+  }
+
+  auto build = [&add_callstack_to_subtree, cancelled](
+                   absl::Span<const SubtreeSamples* const> task_subtrees,
+                   CallTreeNodeArena* arena) {
+    for (const SubtreeSamples* subtree : task_subtrees) {
+      for (const CallstackSamples& callstack_samples : subtree->callstacks) {
+        if (cancelled != nullptr && *cancelled) return;
+        add_callstack_to_subtree(subtree->root, callstack_samples, arena);
+      }
+    }
+  };
+
+  const size_t first_arena_index = arenas->size();
+  for (size_t task_index = 0; task_index < number_of_tasks; ++task_index) {
+    arenas->push_back(std::make_unique<CallTreeNodeArena>());
+  }
+
+  if (number_of_tasks == 1) {
+    build(subtrees_per_task[0], (*arenas)[first_arena_index].get());
+    return;
+  }
+
+  std::vector<orbit_base::Future<void>> task_futures;
+  task_futures.reserve(number_of_tasks);
+  for (size_t task_index = 0; task_index < number_of_tasks; ++task_index) {
+    absl::Span<const SubtreeSamples* const> task_subtrees = subtrees_per_task[task_index];
+    CallTreeNodeArena* arena = (*arenas)[first_arena_index + task_index].get();
+    task_futures.emplace_back(
+        thread_pool->Schedule([&build, task_subtrees, arena] { build(task_subtrees, arena); }));
+  }
+  orbit_base::JoinFutures(absl::MakeConstSpan(task_futures)).Wait();
+}
+
+void AddCallstackToTopDownThread(CallTreeNode* thread_node,
+                                 const CallstackSamples& callstack_samples,
+                                 const FunctionInfos& function_infos, CallTreeNodeArena* arena) {
+  const CallstackView& resolved_callstack = callstack_samples.resolved_callstack;
+  CallTreeNode* current_thread_or_function = thread_node;
+  for (auto frame_it = resolved_callstack.frames().rbegin();
+       frame_it != resolved_callstack.frames().rend(); ++frame_it) {
+    CallTreeFunction* function_node =
+        GetOrCreateFunctionNode(current_thread_or_function, *frame_it, function_infos, arena);
+    function_node->IncreaseSampleCount(callstack_samples.sample_count);
+    current_thread_or_function = function_node;
+  }
+}
+
+void AddUnwindErrorToTopDownThread(CallTreeNode* thread_node,
+                                   const CallstackSamples& callstack_samples,
+                                   const FunctionInfos& function_infos, CallTreeNodeArena* arena) {
+  CallTreeUnwindErrors* unwind_errors_node = GetOrCreateUnwindErrorsNode(thread_node, arena);
+  unwind_errors_node->IncreaseSampleCount(callstack_samples.sample_count);
+
+  const CallstackView& resolved_callstack = callstack_samples.resolved_callstack;
+  CHECK(!resolved_callstack.frames().empty());
+  // Only use the innermost frame for unwind errors.
+  CallTreeFunction* function_node = GetOrCreateFunctionNode(
+      unwind_errors_node, resolved_callstack.frames(0), function_infos, arena);
+  function_node->IncreaseSampleCount(callstack_samples.sample_count);
+}
+
+}  // namespace
+
 std::unique_ptr<CallTreeView> CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
-    const PostProcessedSamplingData& post_processed_sampling_data,
-    const CaptureData& capture_data) {
+    const PostProcessedSamplingData& post_processed_sampling_data, const CaptureData& capture_data,
+    ThreadPool* thread_pool, const std::atomic<bool>* cancelled) {
   auto top_down_view = std::make_unique<CallTreeView>();
+  AddFunctionInfos(post_processed_sampling_data, capture_data, &top_down_view->function_infos_);
   const std::string& process_name = capture_data.process_name();
   const absl::flat_hash_map<int32_t, std::string>& thread_names = capture_data.thread_names();
+  CallTreeNodeArena* thread_arena =
+      top_down_view->arenas_.emplace_back(std::make_unique<CallTreeNodeArena>()).get();
 
+  // The subtree of each thread is built separately.
+  absl::flat_hash_map<CallTreeThread*, size_t> thread_node_to_subtree_index;
+  std::vector<SubtreeSamples> subtrees;
   for (const ThreadSampleData& thread_sample_data :
        post_processed_sampling_data.GetThreadSampleData()) {
     const int32_t tid = thread_sample_data.thread_id;
 
     for (const auto& [callstack_id, sample_count] :
          thread_sample_data.sampled_callstack_id_to_count) {
-      const CallstackInfo& resolved_callstack =
+      const CallstackView resolved_callstack =
           post_processed_sampling_data.GetResolvedCallstack(callstack_id);
 
       // Don't count samples from the all-thread case again.
@@ -185,91 +296,228 @@ std::unique_ptr<CallTreeView> CallTreeView::CreateTopDownViewFromPostProcessedSa
         top_down_view->IncreaseSampleCount(sample_count);
       }
 
-      CallTreeThread* thread_node =
-          GetOrCreateThreadNode(top_down_view.get(), tid, process_name, thread_names);
+      CallTreeThread* thread_node = GetOrCreateThreadNode(top_down_view.get(), tid, process_name,
+                                                          thread_names, thread_arena);
       thread_node->IncreaseSampleCount(sample_count);
 
-      if (resolved_callstack.type() == CallstackInfo::kComplete) {
-        AddCallstackToTopDownThread(thread_node, resolved_callstack, sample_count, capture_data);
-      } else {
-        AddUnwindErrorToTopDownThread(thread_node, resolved_callstack, sample_count, capture_data);
-      }
+      const auto& [subtree_index_it, inserted] =
+          thread_node_to_subtree_index.try_emplace(thread_node, subtrees.size());
+      if (inserted) subtrees.push_back(SubtreeSamples{thread_node});
+      SubtreeSamples& subtree = subtrees[subtree_index_it->second];
+      subtree.callstacks.push_back(CallstackSamples{tid, resolved_callstack, sample_count});
+      subtree.frame_count += resolved_callstack.frames().size();
     }
   }
+
+  const FunctionInfos& function_infos = top_down_view->function_infos_;
+  BuildSubtrees(
+      std::move(subtrees),
+      [&function_infos](CallTreeNode* thread_node, const CallstackSamples& callstack_samples,
+                        CallTreeNodeArena* arena) {
+        if (callstack_samples.resolved_callstack.type() == CallstackInfo::kComplete) {
+          AddCallstackToTopDownThread(thread_node, callstack_samples, function_infos, arena);
+        } else {
+          AddUnwindErrorToTopDownThread(thread_node, callstack_samples, function_infos, arena);
+        }
+      },
+      thread_pool, cancelled, &top_down_view->arenas_);
+  if (cancelled != nullptr && *cancelled) return nullptr;
   return top_down_view;
 }
 
-[[nodiscard]] static CallTreeNode* AddReversedCallstackToBottomUpViewAndReturnLastFunction(
-    CallTreeView* bottom_up_view, const CallstackInfo& resolved_callstack,
-    uint64_t callstack_sample_count, const CaptureData& capture_data) {
-  CallTreeNode* current_node = bottom_up_view;
-  for (uint64_t frame : resolved_callstack.frames()) {
-    const std::string& function_name = capture_data.GetFunctionNameByAddress(frame);
-    const std::string& module_path = capture_data.GetModulePathByAddress(frame);
-    const std::string module_build_id = capture_data.FindModuleBuildIdByAddress(frame).value_or("");
-    CallTreeFunction* function_node =
-        GetOrCreateFunctionNode(current_node, frame, function_name, module_path, module_build_id);
-    function_node->IncreaseSampleCount(callstack_sample_count);
-    current_node = function_node;
-  }
-  return current_node;
-}
+std::unique_ptr<CallTreeView> CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+    const PostProcessedSamplingData& post_processed_sampling_data, const CaptureData& capture_data,
+    ThreadPool* thread_pool, const std::atomic<bool>* cancelled) {
+  auto bottom_up_view = std::make_unique<CallTreeView>();
+  AddFunctionInfos(post_processed_sampling_data, capture_data, &bottom_up_view->function_infos_);
+  const FunctionInfos& function_infos = bottom_up_view->function_infos_;
+  CallTreeNodeArena* innermost_function_arena =
+      bottom_up_view->arenas_.emplace_back(std::make_unique<CallTreeNodeArena>()).get();
+
+  // The subtree of each innermost function is built separately.
+  absl::flat_hash_map<CallTreeFunction*, size_t> function_node_to_subtree_index;
+  std::vector<SubtreeSamples> subtrees;
+  for (const ThreadSampleData& thread_sample_data :
+       post_processed_sampling_data.GetThreadSampleData()) {
+    const int32_t tid = thread_sample_data.thread_id;
+    if (tid == orbit_base::kAllProcessThreadsTid) {
+      continue;
+    }
 
-[[nodiscard]] static CallTreeUnwindErrors* AddUnwindErrorToBottomUpViewAndReturnUnwindingErrorsNode(
-    CallTreeView* bottom_up_view, const CallstackInfo& resolved_callstack,
-    uint64_t callstack_sample_count, const CaptureData& capture_data) {
-  CHECK(!resolved_callstack.frames().empty());
-  // Only use the innermost frame for unwind errors.
-  uint64_t frame = resolved_callstack.frames(0);
-  const std::string& function_name = capture_data.GetFunctionNameByAddress(frame);
-  const std::string& module_path = capture_data.GetModulePathByAddress(frame);
-  const std::string module_build_id = capture_data.FindModuleBuildIdByAddress(frame).value_or("");
-  CallTreeFunction* function_node =
-      GetOrCreateFunctionNode(bottom_up_view, frame, function_name, module_path, module_build_id);
-  function_node->IncreaseSampleCount(callstack_sample_count);
-
-  CallTreeUnwindErrors* unwind_errors_node = function_node->GetUnwindErrorsOrNull();
-  if (unwind_errors_node == nullptr) {
-    unwind_errors_node = function_node->AddAndGetUnwindErrors();
+    for (const auto& [callstack_id, sample_count] :
+         thread_sample_data.sampled_callstack_id_to_count) {
+      const CallstackView resolved_callstack =
+          post_processed_sampling_data.GetResolvedCallstack(callstack_id);
+      CHECK(!resolved_callstack.frames().empty());
+
+      bottom_up_view->IncreaseSampleCount(sample_count);
+
+      // For unwind errors, this is also the only frame that is used.
+      CallTreeFunction* innermost_function_node =
+          GetOrCreateFunctionNode(bottom_up_view.get(), resolved_callstack.frames(0),
+                                  function_infos, innermost_function_arena);
+      innermost_function_node->IncreaseSampleCount(sample_count);
+
+      const auto& [subtree_index_it, inserted] =
+          function_node_to_subtree_index.try_emplace(innermost_function_node, subtrees.size());
+      if (inserted) subtrees.push_back(SubtreeSamples{innermost_function_node});
+      SubtreeSamples& subtree = subtrees[subtree_index_it->second];
+      subtree.callstacks.push_back(CallstackSamples{tid, resolved_callstack, sample_count});
+      subtree.frame_count += resolved_callstack.frames().size();
+    }
   }
-  unwind_errors_node->IncreaseSampleCount(callstack_sample_count);
-  return unwind_errors_node;
+
+  const std::string& process_name = capture_data.process_name();
+  const absl::flat_hash_map<int32_t, std::string>& thread_names = capture_data.thread_names();
+  BuildSubtrees(
+      std::move(subtrees),
+      [&function_infos, &process_name, &thread_names](CallTreeNode* innermost_function_node,
+                                                      const CallstackSamples& callstack_samples,
+                                                      CallTreeNodeArena* arena) {
+        const CallstackView& resolved_callstack = callstack_samples.resolved_callstack;
+        CallTreeNode* last_node = innermost_function_node;
+        if (resolved_callstack.type() == CallstackInfo::kComplete) {
+          for (uint64_t frame : resolved_callstack.frames().subspan(1)) {
+            CallTreeFunction* function_node =
+                GetOrCreateFunctionNode(last_node, frame, function_infos, arena);
+            function_node->IncreaseSampleCount(callstack_samples.sample_count);
+            last_node = function_node;
+          }
+        } else {
+          last_node = GetOrCreateUnwindErrorsNode(innermost_function_node, arena);
+          last_node->IncreaseSampleCount(callstack_samples.sample_count);
+        }
+        CallTreeThread* thread_node = GetOrCreateThreadNode(
+            last_node, callstack_samples.thread_id, process_name, thread_names, arena);
+        thread_node->IncreaseSampleCount(callstack_samples.sample_count);
+      },
+      thread_pool, cancelled, &bottom_up_view->arenas_);
+  if (cancelled != nullptr && *cancelled) return nullptr;
+  return bottom_up_view;
 }
 
-std::unique_ptr<CallTreeView> CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+std::unique_ptr<CallTreeView> CallTreeView::CreateLazyBottomUpViewFromPostProcessedSamplingData(
     const PostProcessedSamplingData& post_processed_sampling_data,
     const CaptureData& capture_data) {
   auto bottom_up_view = std::make_unique<CallTreeView>();
-  const std::string& process_name = capture_data.process_name();
+  AddFunctionInfos(post_processed_sampling_data, capture_data, &bottom_up_view->function_infos_);
+  const FunctionInfos& function_infos = bottom_up_view->function_infos_;
+  CallTreeNodeArena* arena =
+      bottom_up_view->arenas_.emplace_back(std::make_unique<CallTreeNodeArena>()).get();
   const absl::flat_hash_map<int32_t, std::string>& thread_names = capture_data.thread_names();
 
+  absl::flat_hash_map<CallTreeNode*, std::vector<size_t>> innermost_function_to_callstack_indices;
   for (const ThreadSampleData& thread_sample_data :
        post_processed_sampling_data.GetThreadSampleData()) {
     const int32_t tid = thread_sample_data.thread_id;
     if (tid == orbit_base::kAllProcessThreadsTid) {
       continue;
     }
+    if (auto thread_name_it = thread_names.find(tid); thread_name_it != thread_names.end()) {
+      bottom_up_view->lazy_thread_names_.try_emplace(tid, thread_name_it->second);
+    }
 
     for (const auto& [callstack_id, sample_count] :
          thread_sample_data.sampled_callstack_id_to_count) {
-      const CallstackInfo& resolved_callstack =
+      const CallstackView resolved_callstack =
           post_processed_sampling_data.GetResolvedCallstack(callstack_id);
+      CHECK(!resolved_callstack.frames().empty());
 
       bottom_up_view->IncreaseSampleCount(sample_count);
 
-      CallTreeNode* last_node;
-      if (resolved_callstack.type() == CallstackInfo::kComplete) {
-        last_node = AddReversedCallstackToBottomUpViewAndReturnLastFunction(
-            bottom_up_view.get(), resolved_callstack, sample_count, capture_data);
-      } else {
-        last_node = AddUnwindErrorToBottomUpViewAndReturnUnwindingErrorsNode(
-            bottom_up_view.get(), resolved_callstack, sample_count, capture_data);
-      }
-      CallTreeThread* thread_node =
-          GetOrCreateThreadNode(last_node, tid, process_name, thread_names);
-      thread_node->IncreaseSampleCount(sample_count);
+      CallTreeFunction* innermost_function_node = GetOrCreateFunctionNode(
+          bottom_up_view.get(), resolved_callstack.frames(0), function_infos, arena);
+      innermost_function_node->IncreaseSampleCount(sample_count);
+
+      // Only the innermost frame is used for unwind errors.
+      const bool is_complete = resolved_callstack.type() == CallstackInfo::kComplete;
+      absl::Span<const uint64_t> frames =
+          is_complete ? resolved_callstack.frames() : resolved_callstack.frames().subspan(0, 1);
+      innermost_function_to_callstack_indices[innermost_function_node].push_back(
+          bottom_up_view->lazy_callstacks_.size());
+      bottom_up_view->lazy_callstacks_.push_back(LazyCallstack{
+          tid, is_complete, sample_count, bottom_up_view->lazy_frames_.size(), frames.size()});
+      bottom_up_view->lazy_frames_.insert(bottom_up_view->lazy_frames_.end(), frames.begin(),
+                                          frames.end());
     }
   }
 
+  for (auto& [innermost_function_node, callstack_indices] :
+       innermost_function_to_callstack_indices) {
+    bottom_up_view->AddUnexpandedNode(innermost_function_node, /*frame_index=*/0,
+                                      std::move(callstack_indices));
+  }
   return bottom_up_view;
 }
+
+void CallTreeView::AddUnexpandedNode(CallTreeNode* node, size_t frame_index,
+                                     std::vector<size_t> callstack_indices) {
+  const bool is_unwind_errors_node = dynamic_cast<CallTreeUnwindErrors*>(node) != nullptr;
+  absl::flat_hash_set<uint64_t> child_function_addresses;
+  absl::flat_hash_set<int32_t> child_thread_ids;
+  bool has_unwind_errors_child = false;
+  uint64_t thread_and_function_children_sample_count = 0;
+  for (size_t callstack_index : callstack_indices) {
+    const LazyCallstack& callstack = lazy_callstacks_[callstack_index];
+    if (!is_unwind_errors_node && !callstack.is_complete) {
+      has_unwind_errors_child = true;
+      continue;
+    }
+    if (!is_unwind_errors_node && frame_index + 1 < callstack.frame_count) {
+      child_function_addresses.insert(lazy_frames_[callstack.frames_begin + frame_index + 1]);
+    } else {
+      child_thread_ids.insert(callstack.thread_id);
+    }
+    thread_and_function_children_sample_count += callstack.sample_count;
+  }
+
+  node->unexpanded_children_sample_count_ = thread_and_function_children_sample_count;
+  const uint64_t child_count = child_function_addresses.size() + child_thread_ids.size() +
+                               (has_unwind_errors_child ? 1 : 0);
+  unexpanded_nodes_.try_emplace(
+      node, UnexpandedNode{frame_index, std::move(callstack_indices), child_count});
+}
+
+uint64_t CallTreeView::GetUnexpandedChildCount(const CallTreeNode* node) const {
+  auto unexpanded_node_it = unexpanded_nodes_.find(node);
+  CHECK(unexpanded_node_it != unexpanded_nodes_.end());
+  return unexpanded_node_it->second.child_count;
+}
+
+void CallTreeView::ExpandChildren(CallTreeNode* node) {
+  auto unexpanded_node_it = unexpanded_nodes_.find(node);
+  CHECK(unexpanded_node_it != unexpanded_nodes_.end());
+  const UnexpandedNode unexpanded_node = std::move(unexpanded_node_it->second);
+  unexpanded_nodes_.erase(unexpanded_node_it);
+  node->unexpanded_children_sample_count_ = 0;
+
+  CallTreeNodeArena* arena = arenas_.front().get();
+  const bool is_unwind_errors_node = dynamic_cast<CallTreeUnwindErrors*>(node) != nullptr;
+  const size_t child_frame_index = unexpanded_node.frame_index + 1;
+  absl::flat_hash_map<CallTreeNode*, std::vector<size_t>> child_to_callstack_indices;
+  for (size_t callstack_index : unexpanded_node.callstack_indices) {
+    const LazyCallstack& callstack = lazy_callstacks_[callstack_index];
+    // Threads are the leaves of bottom-up views.
+    if (is_unwind_errors_node ||
+        (callstack.is_complete && child_frame_index == callstack.frame_count)) {
+      CallTreeThread* thread_node = GetOrCreateThreadNode(
+          node, callstack.thread_id, /*process_name=*/"", lazy_thread_names_, arena);
+      thread_node->IncreaseSampleCount(callstack.sample_count);
+      continue;
+    }
+
+    CallTreeNode* child;
+    if (callstack.is_complete) {
+      child = GetOrCreateFunctionNode(
+          node, lazy_frames_[callstack.frames_begin + child_frame_index], function_infos_, arena);
+    } else {
+      child = GetOrCreateUnwindErrorsNode(node, arena);
+    }
+    child->IncreaseSampleCount(callstack.sample_count);
+    child_to_callstack_indices[child].push_back(callstack_index);
+  }
+
+  for (auto& [child, callstack_indices] : child_to_callstack_indices) {
+    AddUnexpandedNode(child, child_frame_index, std::move(callstack_indices));
+  }
+}
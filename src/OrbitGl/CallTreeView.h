@@ -5,22 +5,38 @@
 #ifndef ORBIT_GL_CALL_TREE_VIEW_H_
 #define ORBIT_GL_CALL_TREE_VIEW_H_
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/node_hash_map.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "ClientData/PostProcessedSamplingData.h"
 #include "ClientModel/CaptureData.h"
+#include "OrbitBase/ThreadPool.h"
 
 class CallTreeThread;
 class CallTreeFunction;
 class CallTreeUnwindErrors;
+class CallTreeNodeArena;
+
+// The name, module path and module build id of a function. These are stored once per function in
+// a CallTreeView and shared by all the CallTreeFunction nodes of that function.
+struct CallTreeFunctionInfo {
+  std::string function_name;
+  std::string module_path;
+  std::string module_build_id;
+};
 
+// The nodes of a call tree are owned by a CallTreeNodeArena, and a node only refers to its parent
+// and its children. Creating a child requires the arena in which the child is allocated.
 class CallTreeNode {
  public:
   explicit CallTreeNode(CallTreeNode* parent) : parent_{parent} {}
@@ -29,27 +45,26 @@ class CallTreeNode {
   // parent(), child_count(), children() are needed by CallTreeViewItemModel.
   [[nodiscard]] const CallTreeNode* parent() const { return parent_; }
 
-  [[nodiscard]] uint64_t child_count() const {
-    return thread_children_.size() + function_children_.size() +
-           (unwind_errors_child_ != nullptr ? 1 : 0);
-  }
+  [[nodiscard]] uint64_t child_count() const { return children_.size(); }
 
-  [[nodiscard]] std::vector<const CallTreeNode*> children() const;
+  // The children in the order in which they were added.
+  [[nodiscard]] const std::vector<const CallTreeNode*>& children() const { return children_; }
 
   [[nodiscard]] CallTreeThread* GetThreadOrNull(int32_t thread_id);
 
-  [[nodiscard]] CallTreeThread* AddAndGetThread(int32_t thread_id, std::string thread_name);
+  [[nodiscard]] CallTreeThread* AddAndGetThread(int32_t thread_id, std::string thread_name,
+                                                CallTreeNodeArena* arena);
 
   [[nodiscard]] CallTreeFunction* GetFunctionOrNull(uint64_t function_absolute_address);
 
+  // `function_info` needs to outlive the new node.
   [[nodiscard]] CallTreeFunction* AddAndGetFunction(uint64_t function_absolute_address,
-                                                    std::string function_name,
-                                                    std::string module_path,
-                                                    std::string module_build_id);
+                                                    const CallTreeFunctionInfo* function_info,
+                                                    CallTreeNodeArena* arena);
 
-  [[nodiscard]] CallTreeUnwindErrors* GetUnwindErrorsOrNull();
+  [[nodiscard]] CallTreeUnwindErrors* GetUnwindErrorsOrNull() { return unwind_errors_child_; }
 
-  [[nodiscard]] CallTreeUnwindErrors* AddAndGetUnwindErrors();
+  [[nodiscard]] CallTreeUnwindErrors* AddAndGetUnwindErrors(CallTreeNodeArena* arena);
 
   [[nodiscard]] uint64_t sample_count() const { return sample_count_; }
 
@@ -74,38 +89,38 @@ class CallTreeNode {
     return 100.0f * GetExclusiveSampleCount() / total_sample_count;
   }
 
- protected:
-  // absl::node_hash_map instead of absl::flat_hash_map as pointer stability is
-  // needed for the CallTreeNode::parent_ field.
-  absl::node_hash_map<int32_t, CallTreeThread> thread_children_;
-  absl::node_hash_map<uint64_t, CallTreeFunction> function_children_;
-  // std::shared_ptr instead of std::unique_ptr because absl::node_hash_map
-  // needs the copy constructor (even for try_emplace).
-  std::shared_ptr<CallTreeUnwindErrors> unwind_errors_child_;
-
  private:
+  friend class CallTreeView;
+
   CallTreeNode* parent_;
   uint64_t sample_count_ = 0;
+  // For nodes of lazily built views whose children have not been created yet, the sample count of
+  // the thread and function children to be created.
+  uint64_t unexpanded_children_sample_count_ = 0;
+  std::vector<const CallTreeNode*> children_;
+  // The children in `children_` by key, to find them while building the tree.
+  absl::flat_hash_map<int32_t, CallTreeThread*> thread_children_;
+  absl::flat_hash_map<uint64_t, CallTreeFunction*> function_children_;
+  CallTreeUnwindErrors* unwind_errors_child_ = nullptr;
 };
 
 class CallTreeFunction : public CallTreeNode {
  public:
-  explicit CallTreeFunction(uint64_t function_absolute_address, std::string function_name,
-                            std::string module_path, std::string module_build_id,
-                            CallTreeNode* parent)
+  explicit CallTreeFunction(uint64_t function_absolute_address,
+                            const CallTreeFunctionInfo* function_info, CallTreeNode* parent)
       : CallTreeNode{parent},
         function_absolute_address_{function_absolute_address},
-        function_name_{std::move(function_name)},
-        module_path_{std::move(module_path)},
-        module_build_id_{std::move(module_build_id)} {}
+        function_info_{function_info} {}
 
   [[nodiscard]] uint64_t function_absolute_address() const { return function_absolute_address_; }
 
-  [[nodiscard]] const std::string& function_name() const { return function_name_; }
+  [[nodiscard]] const std::string& function_name() const { return function_info_->function_name; }
 
-  [[nodiscard]] const std::string& module_path() const { return module_path_; }
+  [[nodiscard]] const std::string& module_path() const { return function_info_->module_path; }
 
-  [[nodiscard]] const std::string& module_build_id() const { return module_build_id_; }
+  [[nodiscard]] const std::string& module_build_id() const {
+    return function_info_->module_build_id;
+  }
 
   [[nodiscard]] std::string GetModuleName() const {
     return std::filesystem::path(module_path()).filename().string();
@@ -113,9 +128,7 @@ class CallTreeFunction : public CallTreeNode {
 
  private:
   uint64_t function_absolute_address_;
-  std::string function_name_;
-  std::string module_path_;
-  std::string module_build_id_;
+  const CallTreeFunctionInfo* function_info_;
 };
 
 class CallTreeThread : public CallTreeNode {
@@ -137,18 +150,116 @@ class CallTreeUnwindErrors : public CallTreeNode {
   explicit CallTreeUnwindErrors(CallTreeNode* parent) : CallTreeNode{parent} {}
 };
 
+// Owns call tree nodes. Nodes are allocated in chunks of growing size, so that a tree with millions
+// of nodes needs few allocations, and never move.
+// Thread-Safety: This class is not thread-safe.
+class CallTreeNodeArena {
+ public:
+  template <typename NodeT, typename... Args>
+  [[nodiscard]] NodeT* Create(Args&&... args) {
+    if constexpr (std::is_same_v<NodeT, CallTreeFunction>) {
+      return functions_.Create(std::forward<Args>(args)...);
+    } else if constexpr (std::is_same_v<NodeT, CallTreeThread>) {
+      return threads_.Create(std::forward<Args>(args)...);
+    } else {
+      static_assert(std::is_same_v<NodeT, CallTreeUnwindErrors>);
+      return unwind_errors_.Create(std::forward<Args>(args)...);
+    }
+  }
+
+ private:
+  template <typename NodeT>
+  class ChunkedStorage {
+   public:
+    template <typename... Args>
+    [[nodiscard]] NodeT* Create(Args&&... args) {
+      if (chunks_.empty() || chunks_.back().size() == chunks_.back().capacity()) {
+        const size_t chunk_size =
+            chunks_.empty() ? kMinChunkSize : std::min(2 * chunks_.back().size(), kMaxChunkSize);
+        chunks_.emplace_back().reserve(chunk_size);
+      }
+      // The chunk has capacity left, so this never reallocates.
+      return &chunks_.back().emplace_back(std::forward<Args>(args)...);
+    }
+
+   private:
+    static constexpr size_t kMinChunkSize = 16;
+    static constexpr size_t kMaxChunkSize = 4096;
+    std::vector<std::vector<NodeT>> chunks_;
+  };
+
+  ChunkedStorage<CallTreeFunction> functions_;
+  ChunkedStorage<CallTreeThread> threads_;
+  ChunkedStorage<CallTreeUnwindErrors> unwind_errors_;
+};
+
 class CallTreeView : public CallTreeNode {
  public:
+  // With a `thread_pool`, the subtrees of the threads (top-down) or of the innermost functions
+  // (bottom-up) are built in parallel. If `cancelled` is set while the view is built, the building
+  // stops early and nullptr is returned.
   [[nodiscard]] static std::unique_ptr<CallTreeView> CreateTopDownViewFromPostProcessedSamplingData(
       const orbit_client_data::PostProcessedSamplingData& post_processed_sampling_data,
-      const orbit_client_model::CaptureData& capture_data);
+      const orbit_client_model::CaptureData& capture_data, ThreadPool* thread_pool = nullptr,
+      const std::atomic<bool>* cancelled = nullptr);
 
   [[nodiscard]] static std::unique_ptr<CallTreeView>
   CreateBottomUpViewFromPostProcessedSamplingData(
+      const orbit_client_data::PostProcessedSamplingData& post_processed_sampling_data,
+      const orbit_client_model::CaptureData& capture_data, ThreadPool* thread_pool = nullptr,
+      const std::atomic<bool>* cancelled = nullptr);
+
+  // Only creates the innermost functions, with their sample counts, and keeps a copy of the sampled
+  // callstacks. The children of any other node are only created by ExpandChildren.
+  [[nodiscard]] static std::unique_ptr<CallTreeView>
+  CreateLazyBottomUpViewFromPostProcessedSamplingData(
       const orbit_client_data::PostProcessedSamplingData& post_processed_sampling_data,
       const orbit_client_model::CaptureData& capture_data);
 
   CallTreeView() : CallTreeNode{nullptr} {}
+
+  // Whether `node` has children that ExpandChildren would create.
+  [[nodiscard]] bool HasUnexpandedChildren(const CallTreeNode* node) const {
+    return unexpanded_nodes_.contains(node);
+  }
+
+  // The number of children that ExpandChildren will create for `node`.
+  [[nodiscard]] uint64_t GetUnexpandedChildCount(const CallTreeNode* node) const;
+
+  // Creates the children of `node`, a node of this view for which HasUnexpandedChildren is true.
+  void ExpandChildren(CallTreeNode* node);
+
+ private:
+  // A sampled callstack of a lazily built view, with its frames in `lazy_frames_`.
+  struct LazyCallstack {
+    int32_t thread_id;
+    bool is_complete;
+    uint64_t sample_count;
+    size_t frames_begin;
+    size_t frame_count;
+  };
+
+  struct UnexpandedNode {
+    // The index in the callstacks of the frame of the node. Unused for unwind errors nodes.
+    size_t frame_index;
+    std::vector<size_t> callstack_indices;
+    uint64_t child_count;
+  };
+
+  void AddUnexpandedNode(CallTreeNode* node, size_t frame_index,
+                         std::vector<size_t> callstack_indices);
+
+  // Stored by resolved function address. absl::node_hash_map instead of absl::flat_hash_map as
+  // CallTreeFunction nodes point to the values.
+  absl::node_hash_map<uint64_t, CallTreeFunctionInfo> function_infos_;
+  // The first arena holds the children of the root, the others the subtrees built by each task.
+  std::vector<std::unique_ptr<CallTreeNodeArena>> arenas_;
+
+  // Only for lazily built views.
+  std::vector<uint64_t> lazy_frames_;
+  std::vector<LazyCallstack> lazy_callstacks_;
+  absl::flat_hash_map<int32_t, std::string> lazy_thread_names_;
+  absl::flat_hash_map<const CallTreeNode*, UnexpandedNode> unexpanded_nodes_;
 };
 
 #endif  // ORBIT_GL_CALL_TREE_VIEW_H_
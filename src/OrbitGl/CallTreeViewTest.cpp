@@ -0,0 +1,394 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CallTreeView.h"
+#include "ClientData/PostProcessedSamplingData.h"
+#include "ClientModel/CaptureData.h"
+#include "ClientModel/SamplingDataPostProcessor.h"
+#include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_data::PostProcessedSamplingData;
+using orbit_client_model::CaptureData;
+using orbit_client_protos::CallstackInfo;
+
+namespace {
+
+constexpr int32_t kThreadId1 = 41;
+constexpr int32_t kThreadId2 = 42;
+constexpr const char* kThreadName1 = "thread 1";
+constexpr const char* kModulePath = "/path/to/module";
+
+// Function i is at address kFunctionAddressBase + 16 * i with the name "function i", except for
+// kUnknownFunctionIndex, which has no address info.
+constexpr uint64_t kFunctionAddressBase = 0x1000;
+constexpr uint64_t kUnknownFunctionIndex = 3;
+
+[[nodiscard]] uint64_t GetFunctionAddress(uint64_t function_index) {
+  return kFunctionAddressBase + 16 * function_index;
+}
+
+class CallTreeViewTest : public testing::Test {
+ protected:
+  CallTreeViewTest()
+      : capture_data_{nullptr, orbit_grpc_protos::CaptureStarted{}, std::nullopt,
+                      absl::flat_hash_set<uint64_t>{}} {
+    capture_data_.AddOrAssignThreadName(kThreadId1, kThreadName1);
+  }
+
+  void AddFunctions(uint64_t function_count) {
+    for (uint64_t function_index = 0; function_index < function_count; ++function_index) {
+      if (function_index == kUnknownFunctionIndex) continue;
+      orbit_client_protos::LinuxAddressInfo address_info;
+      address_info.set_absolute_address(GetFunctionAddress(function_index));
+      address_info.set_offset_in_function(0);
+      address_info.set_function_name(absl::StrFormat("function %u", function_index));
+      address_info.set_module_path(kModulePath);
+      capture_data_.InsertAddressInfo(address_info);
+    }
+  }
+
+  // `function_indices` are from the innermost frame to the outermost frame.
+  void AddCallstack(uint64_t callstack_id, const std::vector<uint64_t>& function_indices,
+                    CallstackInfo::CallstackType type = CallstackInfo::kComplete) {
+    CallstackInfo callstack_info;
+    for (uint64_t function_index : function_indices) {
+      callstack_info.add_frames(GetFunctionAddress(function_index));
+    }
+    callstack_info.set_type(type);
+    capture_data_.AddUniqueCallstack(callstack_id, std::move(callstack_info));
+  }
+
+  void AddSamples(int32_t thread_id, uint64_t callstack_id, uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+      orbit_client_protos::CallstackEvent callstack_event;
+      callstack_event.set_callstack_id(callstack_id);
+      callstack_event.set_thread_id(thread_id);
+      // Callstack events are identified by timestamp.
+      callstack_event.set_time(++last_timestamp_ns_);
+      capture_data_.AddCallstackEvent(std::move(callstack_event));
+    }
+  }
+
+  [[nodiscard]] PostProcessedSamplingData PostProcess() const {
+    return orbit_client_model::CreatePostProcessedSamplingData(*capture_data_.GetCallstackData(),
+                                                               capture_data_);
+  }
+
+  CaptureData capture_data_;
+  uint64_t last_timestamp_ns_ = 0;
+};
+
+[[nodiscard]] const CallTreeFunction* FindFunctionChild(const CallTreeNode& node,
+                                                        uint64_t function_index) {
+  for (const CallTreeNode* child : node.children()) {
+    auto* function = dynamic_cast<const CallTreeFunction*>(child);
+    if (function != nullptr &&
+        function->function_absolute_address() == GetFunctionAddress(function_index)) {
+      return function;
+    }
+  }
+  return nullptr;
+}
+
+[[nodiscard]] const CallTreeThread* FindThreadChild(const CallTreeNode& node, int32_t thread_id) {
+  for (const CallTreeNode* child : node.children()) {
+    auto* thread = dynamic_cast<const CallTreeThread*>(child);
+    if (thread != nullptr && thread->thread_id() == thread_id) return thread;
+  }
+  return nullptr;
+}
+
+[[nodiscard]] const CallTreeUnwindErrors* FindUnwindErrorsChild(const CallTreeNode& node) {
+  for (const CallTreeNode* child : node.children()) {
+    auto* unwind_errors = dynamic_cast<const CallTreeUnwindErrors*>(child);
+    if (unwind_errors != nullptr) return unwind_errors;
+  }
+  return nullptr;
+}
+
+// A description of the subtree of `node` that doesn't depend on the order of the children.
+[[nodiscard]] std::string DescribeSubtree(const CallTreeNode& node) {
+  std::string description;
+  if (auto* function = dynamic_cast<const CallTreeFunction*>(&node); function != nullptr) {
+    description = absl::StrFormat("%s %s %s", function->function_name(), function->module_path(),
+                                  function->module_build_id());
+  } else if (auto* thread = dynamic_cast<const CallTreeThread*>(&node); thread != nullptr) {
+    description = absl::StrFormat("%d %s", thread->thread_id(), thread->thread_name());
+  } else if (dynamic_cast<const CallTreeUnwindErrors*>(&node) != nullptr) {
+    description = "unwind errors";
+  }
+  absl::StrAppendFormat(&description, " %u %u (", node.sample_count(),
+                        node.GetExclusiveSampleCount());
+
+  std::vector<std::string> child_descriptions;
+  for (const CallTreeNode* child : node.children()) {
+    EXPECT_EQ(child->parent(), &node);
+    child_descriptions.push_back(DescribeSubtree(*child));
+  }
+  std::sort(child_descriptions.begin(), child_descriptions.end());
+  for (const std::string& child_description : child_descriptions) {
+    absl::StrAppend(&description, child_description, ", ");
+  }
+  absl::StrAppend(&description, ")");
+  return description;
+}
+
+void ExpandRecursively(CallTreeView* view, CallTreeNode* node) {
+  if (view->HasUnexpandedChildren(node)) {
+    const uint64_t child_count = view->GetUnexpandedChildCount(node);
+    EXPECT_EQ(node->child_count(), 0);
+    view->ExpandChildren(node);
+    EXPECT_EQ(node->child_count(), child_count);
+    EXPECT_FALSE(view->HasUnexpandedChildren(node));
+  }
+  for (const CallTreeNode* child : node->children()) {
+    ExpandRecursively(view, const_cast<CallTreeNode*>(child));
+  }
+}
+
+TEST_F(CallTreeViewTest, EmptyView) {
+  CallTreeView view;
+  EXPECT_EQ(view.child_count(), 0);
+  EXPECT_EQ(view.sample_count(), 0);
+  EXPECT_EQ(view.parent(), nullptr);
+}
+
+TEST_F(CallTreeViewTest, TopDownView) {
+  AddFunctions(4);
+  AddCallstack(1, {2, 1, 0});
+  AddCallstack(2, {1, 0});
+  AddCallstack(3, {kUnknownFunctionIndex, 1}, CallstackInfo::kDwarfUnwindingError);
+  AddSamples(kThreadId1, 1, 3);
+  AddSamples(kThreadId1, 2, 2);
+  AddSamples(kThreadId2, 3, 1);
+
+  std::unique_ptr<CallTreeView> view =
+      CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(PostProcess(), capture_data_);
+  EXPECT_EQ(view->sample_count(), 6);
+
+  const CallTreeThread* thread_1 = FindThreadChild(*view, kThreadId1);
+  ASSERT_NE(thread_1, nullptr);
+  EXPECT_EQ(thread_1->thread_name(), kThreadName1);
+  EXPECT_EQ(thread_1->sample_count(), 5);
+  EXPECT_EQ(thread_1->child_count(), 1);
+
+  const CallTreeFunction* function_0 = FindFunctionChild(*thread_1, 0);
+  ASSERT_NE(function_0, nullptr);
+  EXPECT_EQ(function_0->function_name(), "function 0");
+  EXPECT_EQ(function_0->module_path(), kModulePath);
+  EXPECT_EQ(function_0->GetModuleName(), "module");
+  EXPECT_EQ(function_0->sample_count(), 5);
+  const CallTreeFunction* function_1 = FindFunctionChild(*function_0, 1);
+  ASSERT_NE(function_1, nullptr);
+  EXPECT_EQ(function_1->sample_count(), 5);
+  EXPECT_EQ(function_1->GetExclusiveSampleCount(), 2);
+  const CallTreeFunction* function_2 = FindFunctionChild(*function_1, 2);
+  ASSERT_NE(function_2, nullptr);
+  EXPECT_EQ(function_2->sample_count(), 3);
+  EXPECT_EQ(function_2->child_count(), 0);
+
+  // Only the innermost frame of callstacks with unwind errors is used.
+  const CallTreeThread* thread_2 = FindThreadChild(*view, kThreadId2);
+  ASSERT_NE(thread_2, nullptr);
+  EXPECT_EQ(thread_2->sample_count(), 1);
+  const CallTreeUnwindErrors* unwind_errors = FindUnwindErrorsChild(*thread_2);
+  ASSERT_NE(unwind_errors, nullptr);
+  EXPECT_EQ(unwind_errors->sample_count(), 1);
+  ASSERT_EQ(unwind_errors->child_count(), 1);
+  const CallTreeFunction* unknown_function =
+      FindFunctionChild(*unwind_errors, kUnknownFunctionIndex);
+  ASSERT_NE(unknown_function, nullptr);
+  EXPECT_EQ(unknown_function->function_name(),
+            absl::StrFormat("[unknown@%#llx]", GetFunctionAddress(kUnknownFunctionIndex)));
+
+  // The samples of all threads are also shown in a thread of their own.
+  const CallTreeThread* all_threads = FindThreadChild(*view, orbit_base::kAllProcessThreadsTid);
+  ASSERT_NE(all_threads, nullptr);
+  EXPECT_EQ(all_threads->sample_count(), 6);
+}
+
+TEST_F(CallTreeViewTest, BottomUpView) {
+  AddFunctions(4);
+  AddCallstack(1, {2, 1, 0});
+  AddCallstack(2, {1, 0});
+  AddCallstack(3, {1, 2}, CallstackInfo::kDwarfUnwindingError);
+  AddSamples(kThreadId1, 1, 3);
+  AddSamples(kThreadId1, 2, 2);
+  AddSamples(kThreadId2, 3, 1);
+
+  std::unique_ptr<CallTreeView> view =
+      CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(PostProcess(), capture_data_);
+  EXPECT_EQ(view->sample_count(), 6);
+  EXPECT_EQ(view->child_count(), 2);
+
+  const CallTreeFunction* function_2 = FindFunctionChild(*view, 2);
+  ASSERT_NE(function_2, nullptr);
+  EXPECT_EQ(function_2->sample_count(), 3);
+  const CallTreeFunction* function_2_1 = FindFunctionChild(*function_2, 1);
+  ASSERT_NE(function_2_1, nullptr);
+  const CallTreeFunction* function_2_1_0 = FindFunctionChild(*function_2_1, 0);
+  ASSERT_NE(function_2_1_0, nullptr);
+  const CallTreeThread* thread_node = FindThreadChild(*function_2_1_0, kThreadId1);
+  ASSERT_NE(thread_node, nullptr);
+  EXPECT_EQ(thread_node->sample_count(), 3);
+  EXPECT_EQ(thread_node->child_count(), 0);
+
+  const CallTreeFunction* function_1 = FindFunctionChild(*view, 1);
+  ASSERT_NE(function_1, nullptr);
+  EXPECT_EQ(function_1->sample_count(), 3);
+  EXPECT_EQ(function_1->child_count(), 2);
+  const CallTreeUnwindErrors* unwind_errors = FindUnwindErrorsChild(*function_1);
+  ASSERT_NE(unwind_errors, nullptr);
+  EXPECT_EQ(unwind_errors->sample_count(), 1);
+  thread_node = FindThreadChild(*unwind_errors, kThreadId2);
+  ASSERT_NE(thread_node, nullptr);
+  EXPECT_EQ(thread_node->sample_count(), 1);
+  EXPECT_EQ(FindThreadChild(*view, orbit_base::kAllProcessThreadsTid), nullptr);
+}
+
+TEST_F(CallTreeViewTest, LazyBottomUpViewOnlyCreatesChildrenWhenExpanded) {
+  AddFunctions(4);
+  AddCallstack(1, {2, 1, 0});
+  AddCallstack(2, {2, 0});
+  AddCallstack(3, {2, 1}, CallstackInfo::kDwarfUnwindingError);
+  AddCallstack(4, {2});
+  AddSamples(kThreadId1, 1, 3);
+  AddSamples(kThreadId1, 2, 2);
+  AddSamples(kThreadId2, 3, 1);
+  AddSamples(kThreadId2, 4, 4);
+
+  std::unique_ptr<CallTreeView> view =
+      CallTreeView::CreateLazyBottomUpViewFromPostProcessedSamplingData(PostProcess(),
+                                                                        capture_data_);
+  EXPECT_EQ(view->sample_count(), 10);
+  ASSERT_EQ(view->child_count(), 1);
+  EXPECT_FALSE(view->HasUnexpandedChildren(view.get()));
+
+  // The innermost functions have their counts before they are expanded.
+  auto* function_2 = const_cast<CallTreeFunction*>(FindFunctionChild(*view, 2));
+  ASSERT_NE(function_2, nullptr);
+  EXPECT_EQ(function_2->sample_count(), 10);
+  EXPECT_EQ(function_2->child_count(), 0);
+  ASSERT_TRUE(view->HasUnexpandedChildren(function_2));
+  // Functions 1 and 0, the unwind errors, and thread 2 for callstack 4.
+  EXPECT_EQ(view->GetUnexpandedChildCount(function_2), 4);
+  EXPECT_EQ(function_2->GetExclusiveSampleCount(), 1);
+
+  view->ExpandChildren(function_2);
+  EXPECT_EQ(function_2->child_count(), 4);
+  EXPECT_EQ(function_2->GetExclusiveSampleCount(), 1);
+  const CallTreeFunction* function_2_1 = FindFunctionChild(*function_2, 1);
+  ASSERT_NE(function_2_1, nullptr);
+  EXPECT_EQ(function_2_1->sample_count(), 3);
+  EXPECT_EQ(function_2_1->child_count(), 0);
+  EXPECT_TRUE(view->HasUnexpandedChildren(function_2_1));
+  EXPECT_EQ(view->GetUnexpandedChildCount(function_2_1), 1);
+
+  const CallTreeThread* thread_node = FindThreadChild(*function_2, kThreadId2);
+  ASSERT_NE(thread_node, nullptr);
+  EXPECT_EQ(thread_node->sample_count(), 4);
+  EXPECT_FALSE(view->HasUnexpandedChildren(thread_node));
+
+  const CallTreeUnwindErrors* unwind_errors = FindUnwindErrorsChild(*function_2);
+  ASSERT_NE(unwind_errors, nullptr);
+  EXPECT_EQ(unwind_errors->sample_count(), 1);
+  EXPECT_EQ(view->GetUnexpandedChildCount(unwind_errors), 1);
+}
+
+TEST_F(CallTreeViewTest, BuildingInParallelGivesTheSameTrees) {
+  constexpr uint64_t kFunctionCount = 100;
+  constexpr uint64_t kCallstackCount = 2000;
+  constexpr uint64_t kMaxCallstackDepth = 200;
+  AddFunctions(kFunctionCount);
+  uint64_t seed = 1;
+  auto next_random = [&seed] {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return seed >> 33;
+  };
+  for (uint64_t callstack_id = 1; callstack_id <= kCallstackCount; ++callstack_id) {
+    std::vector<uint64_t> function_indices(1 + next_random() % kMaxCallstackDepth);
+    for (uint64_t& function_index : function_indices) {
+      function_index = next_random() % kFunctionCount;
+    }
+    AddCallstack(callstack_id, function_indices,
+                 callstack_id % 10 == 0 ? CallstackInfo::kFramePointerUnwindingError
+                                        : CallstackInfo::kComplete);
+    AddSamples(callstack_id % 7 == 0 ? kThreadId1 : kThreadId2 + callstack_id % 13, callstack_id,
+               1 + callstack_id % 3);
+  }
+  const PostProcessedSamplingData post_processed_sampling_data = PostProcess();
+
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(/*thread_pool_min_size=*/4, /*thread_pool_max_size=*/4,
+                         /*thread_ttl=*/absl::Seconds(1));
+
+  std::unique_ptr<CallTreeView> top_down_view =
+      CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(post_processed_sampling_data,
+                                                                   capture_data_);
+  std::unique_ptr<CallTreeView> parallel_top_down_view =
+      CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+          post_processed_sampling_data, capture_data_, thread_pool.get());
+  EXPECT_EQ(DescribeSubtree(*parallel_top_down_view), DescribeSubtree(*top_down_view));
+
+  std::unique_ptr<CallTreeView> bottom_up_view =
+      CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(post_processed_sampling_data,
+                                                                    capture_data_);
+  std::unique_ptr<CallTreeView> parallel_bottom_up_view =
+      CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+          post_processed_sampling_data, capture_data_, thread_pool.get());
+  EXPECT_EQ(DescribeSubtree(*parallel_bottom_up_view), DescribeSubtree(*bottom_up_view));
+
+  std::unique_ptr<CallTreeView> lazy_bottom_up_view =
+      CallTreeView::CreateLazyBottomUpViewFromPostProcessedSamplingData(
+          post_processed_sampling_data, capture_data_);
+  ExpandRecursively(lazy_bottom_up_view.get(), lazy_bottom_up_view.get());
+  EXPECT_EQ(DescribeSubtree(*lazy_bottom_up_view), DescribeSubtree(*bottom_up_view));
+
+  thread_pool->ShutdownAndWait();
+}
+
+TEST_F(CallTreeViewTest, CancelledBuildingReturnsNull) {
+  AddFunctions(3);
+  AddCallstack(1, {0, 1, 2}, CallstackInfo::kComplete);
+  AddCallstack(2, {1, 2}, CallstackInfo::kFramePointerUnwindingError);
+  AddSamples(kThreadId1, 1, 3);
+  AddSamples(kThreadId2, 2, 2);
+  const PostProcessedSamplingData post_processed_sampling_data = PostProcess();
+
+  std::atomic<bool> cancelled = false;
+  std::unique_ptr<CallTreeView> top_down_view =
+      CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+          post_processed_sampling_data, capture_data_, /*thread_pool=*/nullptr, &cancelled);
+  ASSERT_NE(top_down_view, nullptr);
+  EXPECT_EQ(top_down_view->sample_count(), 5);
+  std::unique_ptr<CallTreeView> bottom_up_view =
+      CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+          post_processed_sampling_data, capture_data_, /*thread_pool=*/nullptr, &cancelled);
+  ASSERT_NE(bottom_up_view, nullptr);
+  EXPECT_EQ(bottom_up_view->sample_count(), 5);
+
+  cancelled = true;
+  EXPECT_EQ(CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+                post_processed_sampling_data, capture_data_, /*thread_pool=*/nullptr, &cancelled),
+            nullptr);
+  EXPECT_EQ(CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+                post_processed_sampling_data, capture_data_, /*thread_pool=*/nullptr, &cancelled),
+            nullptr);
+}
+
+}  // namespace
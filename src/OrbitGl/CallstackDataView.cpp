@@ -106,6 +106,7 @@ const std::string CallstackDataView::kHighlightedFunctionString = "➜ ";
 const std::string CallstackDataView::kHighlightedFunctionBlankString =
     std::string(kHighlightedFunctionString.size(), ' ');
 const std::string CallstackDataView::kMenuActionSourceCode = "Go to Source code";
+const std::string CallstackDataView::kMenuActionCopySourceLocation = "Copy Source location";
 
 std::vector<std::string> CallstackDataView::GetContextMenu(
     int clicked_index, const std::vector<int>& selected_indices) {
@@ -114,6 +115,7 @@ std::vector<std::string> CallstackDataView::GetContextMenu(
   bool enable_unselect = false;
   bool enable_disassembly = false;
   bool enable_source_code = false;
+  bool enable_copy_source_location = false;
   for (int index : selected_indices) {
     CallstackDataViewFrame frame = GetFrameFromRow(index);
     const FunctionInfo* function = frame.function;
@@ -127,6 +129,8 @@ std::vector<std::string> CallstackDataView::GetContextMenu(
     } else if (module != nullptr && !module->is_loaded()) {
       enable_load = true;
     }
+    // The source location is looked up for a single address at a time.
+    enable_copy_source_location = selected_indices.size() == 1 && module != nullptr;
   }
 
   std::vector<std::string> menu;
@@ -135,6 +139,7 @@ std::vector<std::string> CallstackDataView::GetContextMenu(
   if (enable_unselect) menu.emplace_back(kMenuActionUnselect);
   if (enable_disassembly) menu.emplace_back(kMenuActionDisassembly);
   if (enable_source_code) menu.emplace_back(kMenuActionSourceCode);
+  if (enable_copy_source_location) menu.emplace_back(kMenuActionCopySourceLocation);
   orbit_base::Append(menu, DataView::GetContextMenu(clicked_index, selected_indices));
   return menu;
 }
@@ -178,6 +183,10 @@ void CallstackDataView::OnContextMenu(const std::string& action, int menu_index,
       app_->ShowSourceCode(*GetFrameFromRow(i).function);
     }
 
+  } else if (action == kMenuActionCopySourceLocation) {
+    CHECK(item_indices.size() == 1);
+    app_->CopySourceLocationsToClipboard(GetFrameFromRow(item_indices[0]).address);
+
   } else {
     DataView::OnContextMenu(action, menu_index, item_indices);
   }
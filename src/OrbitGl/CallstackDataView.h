@@ -85,6 +85,7 @@ class CallstackDataView : public orbit_data_views::DataView {
   static const std::string kHighlightedFunctionString;
   static const std::string kHighlightedFunctionBlankString;
   static const std::string kMenuActionSourceCode;
+  static const std::string kMenuActionCopySourceLocation;
 
  private:
   absl::flat_hash_set<uint64_t> functions_to_highlight_;
@@ -107,7 +107,25 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
   const Color kGreyError(160, 160, 160, 255);
   CHECK(capture_data_ != nullptr);
 
-  if (!picking) {
+  // When zoomed out, draw how many samples fall into each pixel instead of each sample.
+  std::vector<uint32_t> sample_counts;
+  const uint64_t ns_per_pixel = GetNsPerPixel();
+  if (ns_per_pixel > 0) {
+    const size_t pixel_count = GetPixelCount(min_tick, max_tick, ns_per_pixel);
+    sample_counts = thread_id_ == orbit_base::kAllProcessThreadsTid
+                        ? capture_data_->GetCallstackData()->GetCallstackEventCountsPerBucket(
+                              min_tick, ns_per_pixel, pixel_count)
+                        : capture_data_->GetCallstackData()->GetCallstackEventOfTidCountsPerBucket(
+                              thread_id_, min_tick, ns_per_pixel, pixel_count);
+  }
+
+  if (HasPixelWithSeveralEvents(sample_counts)) {
+    DrawEventDensity(batcher, min_tick, ns_per_pixel, sample_counts, z, kWhite, picking_mode,
+                     [](uint32_t count) {
+                       return absl::StrFormat(
+                           "<b>%u samples</b><br/><i>Zoom in to see their callstacks</i>", count);
+                     });
+  } else if (!picking) {
     // Sampling Events
     auto action_on_callstack_events = [=](const CallstackEvent& event) {
       const uint64_t time = event.time();
@@ -128,14 +146,6 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
       capture_data_->GetCallstackData()->ForEachCallstackEventOfTidInTimeRange(
           thread_id_, min_tick, max_tick, action_on_callstack_events);
     }
-
-    // Draw selected events
-    std::array<Color, 2> selected_color;
-    selected_color.fill(kGreenSelection);
-    for (const CallstackEvent& event : time_graph_->GetSelectedCallstackEvents(thread_id_)) {
-      Vec2 pos(time_graph_->GetWorldFromTick(event.time()), pos_[1]);
-      batcher->AddVerticalLine(pos, -track_height, z, kGreenSelection);
-    }
   } else {
     // Draw boxes instead of lines to make picking easier, even if this may
     // cause samples to overlap
@@ -147,10 +157,11 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
       CHECK(time >= min_tick && time <= max_tick);
       Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset, pos_[1] - track_height + 1);
       Vec2 size(kPickingBoxWidth, track_height);
-      auto user_data = std::make_unique<PickingUserData>(
-          nullptr,
-          [this, batcher](PickingId id) -> std::string { return GetSampleTooltip(*batcher, id); });
-      user_data->custom_data_ = &event;
+      // The event is only valid during this call, so keep its callstack id instead of a pointer.
+      PickingUserData user_data(
+          nullptr, [this, callstack_id = event.callstack_id()](PickingId /*id*/) -> std::string {
+            return GetSampleTooltip(callstack_id);
+          });
       batcher->AddShadedBox(pos, size, z, kGreenSelection, std::move(user_data));
     };
     if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
@@ -161,6 +172,16 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
           thread_id_, min_tick, max_tick, action_on_callstack_events);
     }
   }
+
+  if (!picking) {
+    // Draw selected events
+    std::array<Color, 2> selected_color;
+    selected_color.fill(kGreenSelection);
+    for (const CallstackEvent& event : time_graph_->GetSelectedCallstackEvents(thread_id_)) {
+      Vec2 pos(time_graph_->GetWorldFromTick(event.time()), pos_[1]);
+      batcher->AddVerticalLine(pos, -track_height, z, kGreenSelection);
+    }
+  }
 }
 
 void CallstackThreadBar::OnRelease() {
@@ -238,19 +259,11 @@ std::string CallstackThreadBar::FormatCallstackForTooltip(const CallstackInfo& c
   return result;
 }
 
-std::string CallstackThreadBar::GetSampleTooltip(const Batcher& batcher, PickingId id) const {
+std::string CallstackThreadBar::GetSampleTooltip(uint64_t callstack_id) const {
   static const std::string unknown_return_text = "Function call information missing";
 
-  const PickingUserData* user_data = batcher.GetUserData(id);
-  if (user_data == nullptr || user_data->custom_data_ == nullptr) {
-    return unknown_return_text;
-  }
-
   CHECK(capture_data_ != nullptr);
   const CallstackData* callstack_data = capture_data_->GetCallstackData();
-  const auto* callstack_event = static_cast<const CallstackEvent*>(user_data->custom_data_);
-
-  uint64_t callstack_id = callstack_event->callstack_id();
   const CallstackInfo* callstack = callstack_data->GetCallstack(callstack_id);
   if (callstack == nullptr) {
     return unknown_return_text;
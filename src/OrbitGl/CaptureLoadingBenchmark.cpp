@@ -0,0 +1,378 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_split.h>
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "CallTreeView.h"
+#include "CaptureClient/CaptureEventProcessor.h"
+#include "CaptureClient/CaptureListener.h"
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureSectionEventReader.h"
+#include "ClientData/ModuleManager.h"
+#include "ClientData/PostProcessedSamplingData.h"
+#include "ClientModel/CaptureData.h"
+#include "ClientModel/SamplingDataPostProcessor.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "SchedulerTrack.h"
+#include "SyntheticCapture.h"
+#include "ThreadTrack.h"
+#include "TimeGraphLayout.h"
+#include "TrackManager.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+// Benchmarks of loading a capture file into a CaptureData and of the post-processing done when the
+// capture is complete, on synthetic captures and on the reference captures listed, separated by
+// colons, in the environment variable ORBIT_BENCHMARK_CAPTURE_FILES.
+
+namespace orbit_gl {
+
+namespace {
+
+using orbit_client_model::CaptureData;
+using orbit_client_protos::TimerInfo;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+// The capture and the timers loaded from a capture file, without the UI of OrbitApp.
+struct LoadedCapture {
+  std::unique_ptr<orbit_client_data::ModuleManager> module_manager;
+  std::unique_ptr<CaptureData> capture_data;
+  absl::flat_hash_map<uint64_t, std::string> strings;
+  std::vector<TimerInfo> timers;
+};
+
+// Fills a LoadedCapture like OrbitApp fills its CaptureData, and keeps the timers that OrbitApp
+// would pass to the TimeGraph, so that creating the tracks can be measured separately.
+class CaptureDataLoadingListener : public orbit_capture_client::CaptureListener {
+ public:
+  explicit CaptureDataLoadingListener(LoadedCapture* loaded_capture)
+      : loaded_capture_{loaded_capture} {}
+
+  void OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture_started,
+                        std::optional<std::filesystem::path> file_path,
+                        absl::flat_hash_set<uint64_t> frame_track_function_ids) override {
+    loaded_capture_->capture_data = std::make_unique<CaptureData>(
+        loaded_capture_->module_manager.get(), capture_started, std::move(file_path),
+        std::move(frame_track_function_ids));
+  }
+  void OnCaptureFinished(const orbit_grpc_protos::CaptureFinished& /*capture_finished*/) override {}
+  void OnTimer(const TimerInfo& timer_info) override {
+    if (timer_info.function_id() != 0) {
+      loaded_capture_->capture_data->UpdateFunctionStats(timer_info.function_id(),
+                                                         timer_info.end() - timer_info.start());
+    }
+    loaded_capture_->timers.push_back(timer_info);
+  }
+  void OnKeyAndString(uint64_t key, std::string str) override {
+    loaded_capture_->strings.try_emplace(key, std::move(str));
+  }
+  void OnUniqueCallstack(uint64_t callstack_id,
+                         orbit_client_protos::CallstackInfo callstack) override {
+    loaded_capture_->capture_data->AddUniqueCallstack(callstack_id, std::move(callstack));
+  }
+  void OnCallstackEvent(orbit_client_protos::CallstackEvent callstack_event) override {
+    loaded_capture_->capture_data->AddCallstackEvent(std::move(callstack_event));
+  }
+  void OnThreadName(int32_t thread_id, std::string thread_name) override {
+    loaded_capture_->capture_data->AddOrAssignThreadName(thread_id, std::move(thread_name));
+  }
+  void OnThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo thread_state_slice) override {
+    loaded_capture_->capture_data->AddThreadStateSlice(std::move(thread_state_slice));
+  }
+  void OnAddressInfo(orbit_client_protos::LinuxAddressInfo address_info) override {
+    loaded_capture_->capture_data->InsertAddressInfo(std::move(address_info));
+  }
+  void OnUniqueTracepointInfo(uint64_t key,
+                              orbit_grpc_protos::TracepointInfo tracepoint_info) override {
+    loaded_capture_->capture_data->AddUniqueTracepointEventInfo(key, std::move(tracepoint_info));
+  }
+  void OnTracepointEvent(orbit_client_protos::TracepointEventInfo tracepoint_event_info) override {
+    CaptureData* capture_data = loaded_capture_->capture_data.get();
+    capture_data->AddTracepointEventAndMapToThreads(
+        tracepoint_event_info.time(), tracepoint_event_info.tracepoint_info_key(),
+        tracepoint_event_info.pid(), tracepoint_event_info.tid(), tracepoint_event_info.cpu(),
+        capture_data->process_id() == tracepoint_event_info.pid());
+  }
+  void OnModuleUpdate(int32_t pid, uint64_t /*timestamp_ns*/,
+                      orbit_grpc_protos::ModuleInfo module_info) override {
+    (void)loaded_capture_->module_manager->AddOrUpdateNotLoadedModules({module_info});
+    if (pid != loaded_capture_->capture_data->process_id()) return;
+    loaded_capture_->capture_data->mutable_process()->AddOrUpdateModuleInfo(module_info);
+  }
+  void OnModulesSnapshot(int32_t pid, uint64_t /*timestamp_ns*/,
+                         std::vector<orbit_grpc_protos::ModuleInfo> module_infos) override {
+    (void)loaded_capture_->module_manager->AddOrUpdateNotLoadedModules(module_infos);
+    if (pid != loaded_capture_->capture_data->process_id()) return;
+    loaded_capture_->capture_data->mutable_process()->UpdateModuleInfos(module_infos);
+  }
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {}
+  void OnClockResolutionEvent(
+      orbit_grpc_protos::ClockResolutionEvent /*clock_resolution_event*/) override {}
+  void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent /*capture_start_latency_event*/) override {}
+  void OnErrorsWithPerfEventOpenEvent(
+      orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/)
+      override {}
+  void OnErrorEnablingOrbitApiEvent(
+      orbit_grpc_protos::ErrorEnablingOrbitApiEvent /*error_enabling_orbit_api_event*/) override {}
+  void OnLostPerfRecordsEvent(
+      orbit_grpc_protos::LostPerfRecordsEvent /*lost_perf_records_event*/) override {}
+  void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
+                                        /*out_of_order_events_discarded_event*/) override {}
+  void OnSamplingPeriodChangedEvent(orbit_grpc_protos::SamplingPeriodChangedEvent
+                                    /*sampling_period_changed_event*/) override {}
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/) override {}
+  void OnFunctionStats(uint64_t /*function_id*/,
+                       orbit_client_protos::FunctionStats /*stats*/) override {}
+
+ private:
+  LoadedCapture* loaded_capture_;
+};
+
+// Loads the capture section as OrbitApp::LoadCaptureFromFile does, followed by the part of
+// OrbitApp::OnCaptureComplete that modifies the CaptureData.
+[[nodiscard]] ErrorMessageOr<std::unique_ptr<LoadedCapture>> LoadCapture(
+    const std::filesystem::path& path) {
+  OUTCOME_TRY(capture_file, orbit_capture_file::CaptureFile::OpenForReadWrite(path));
+  auto loaded_capture = std::make_unique<LoadedCapture>();
+  loaded_capture->module_manager = std::make_unique<orbit_client_data::ModuleManager>();
+  CaptureDataLoadingListener listener{loaded_capture.get()};
+  std::unique_ptr<orbit_capture_client::CaptureEventProcessor> capture_event_processor =
+      orbit_capture_client::CaptureEventProcessor::CreateForCaptureListener(&listener, path, {});
+
+  orbit_capture_file::CaptureSectionEventReader capture_section_event_reader{
+      capture_file->CreateCaptureSectionInputStream()};
+  bool capture_finished = false;
+  while (!capture_finished) {
+    OUTCOME_TRY(events, capture_section_event_reader.ReadEventBatch());
+    if (events.empty()) {
+      return ErrorMessage("Capture section ended without a CaptureFinished event");
+    }
+    for (const ClientCaptureEvent& event : events) {
+      capture_event_processor->ProcessEvent(event);
+      if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+        capture_finished = true;
+        break;
+      }
+    }
+  }
+  if (loaded_capture->capture_data == nullptr) {
+    return ErrorMessage("Capture section doesn't start with a CaptureStarted event");
+  }
+  loaded_capture->capture_data->FilterBrokenCallstacks();
+  return loaded_capture;
+}
+
+[[nodiscard]] std::unique_ptr<LoadedCapture> LoadCaptureOrDie(const std::filesystem::path& path) {
+  ErrorMessageOr<std::unique_ptr<LoadedCapture>> loaded_capture_or_error = LoadCapture(path);
+  FAIL_IF(loaded_capture_or_error.has_error(), "Loading capture \"%s\": %s", path.string(),
+          loaded_capture_or_error.error().message());
+  return std::move(loaded_capture_or_error.value());
+}
+
+// The maximum resident set size of the process so far. It never decreases, so it is the peak of
+// the largest capture benchmarked up to this point, not of the current benchmark alone.
+void SetPeakRssCounter(benchmark::State& state) {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in kilobytes.
+  state.counters["peak_rss_mb"] = static_cast<double>(usage.ru_maxrss) / 1024;
+}
+
+void SetCaptureCounters(benchmark::State& state, const LoadedCapture& loaded_capture) {
+  state.counters["callstack_samples"] =
+      loaded_capture.capture_data->GetCallstackData()->GetCallstackEventsCount();
+  state.counters["timers"] = static_cast<double>(loaded_capture.timers.size());
+  SetPeakRssCounter(state);
+}
+
+void BM_LoadCapture(benchmark::State& state, const std::filesystem::path& path) {
+  std::unique_ptr<LoadedCapture> loaded_capture;
+  for (auto _ : state) {
+    loaded_capture = LoadCaptureOrDie(path);
+    state.PauseTiming();
+    SetCaptureCounters(state, *loaded_capture);
+    loaded_capture.reset();
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(std::filesystem::file_size(path)));
+}
+
+void BM_PostProcessSamplingData(benchmark::State& state, const std::filesystem::path& path) {
+  std::unique_ptr<LoadedCapture> loaded_capture = LoadCaptureOrDie(path);
+  const CaptureData& capture_data = *loaded_capture->capture_data;
+  for (auto _ : state) {
+    orbit_client_data::PostProcessedSamplingData post_processed_sampling_data =
+        orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetCallstackData(),
+                                                            capture_data);
+    benchmark::DoNotOptimize(post_processed_sampling_data);
+  }
+  SetCaptureCounters(state, *loaded_capture);
+}
+
+// Creating the top-down or the bottom-up view, as OrbitApp::SetTopDownView and
+// OrbitApp::SetBottomUpView do on capture completion.
+void BM_CreateCallTreeView(benchmark::State& state, const std::filesystem::path& path,
+                           bool bottom_up) {
+  std::unique_ptr<LoadedCapture> loaded_capture = LoadCaptureOrDie(path);
+  const CaptureData& capture_data = *loaded_capture->capture_data;
+  const orbit_client_data::PostProcessedSamplingData post_processed_sampling_data =
+      orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetCallstackData(),
+                                                          capture_data);
+  for (auto _ : state) {
+    std::unique_ptr<CallTreeView> call_tree_view =
+        bottom_up ? CallTreeView::CreateBottomUpViewFromPostProcessedSamplingData(
+                        post_processed_sampling_data, capture_data)
+                  : CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+                        post_processed_sampling_data, capture_data);
+    benchmark::DoNotOptimize(call_tree_view);
+    state.PauseTiming();
+    call_tree_view.reset();
+    state.ResumeTiming();
+  }
+  SetCaptureCounters(state, *loaded_capture);
+}
+
+// Creating the thread tracks and the scheduler track from the timers, as TimeGraph::ProcessTimer
+// does while the capture loads, and building their ScopeTrees, as OrbitApp::OnCaptureComplete does.
+// The TimeGraph itself requires an OrbitApp, so the TrackManager is used without it, as in
+// TrackManagerTest. The other kinds of tracks are not created.
+void BM_CreateTracks(benchmark::State& state, const std::filesystem::path& path) {
+  std::unique_ptr<LoadedCapture> loaded_capture = LoadCaptureOrDie(path);
+  TimeGraphLayout layout;
+  for (auto _ : state) {
+    auto track_manager = std::make_unique<TrackManager>(nullptr, nullptr, &layout, nullptr,
+                                                        loaded_capture->capture_data.get());
+    track_manager->SetIsDataFromSavedCapture(true);
+    for (const TimerInfo& timer_info : loaded_capture->timers) {
+      switch (timer_info.type()) {
+        case TimerInfo::kNone:
+          track_manager->GetOrCreateThreadTrack(timer_info.thread_id())->AddTimer(timer_info);
+          break;
+        case TimerInfo::kCoreActivity:
+          track_manager->GetOrCreateThreadTrack(timer_info.thread_id());
+          track_manager->GetOrCreateSchedulerTrack()->OnTimer(timer_info);
+          break;
+        default:
+          break;
+      }
+    }
+    for (ThreadTrack* thread_track : track_manager->GetThreadTracks()) {
+      thread_track->OnCaptureComplete();
+    }
+    track_manager->UpdateTracksForRendering();
+    state.PauseTiming();
+    track_manager.reset();
+    state.ResumeTiming();
+  }
+  SetCaptureCounters(state, *loaded_capture);
+}
+
+// The synthetic captures are only generated when a benchmark that uses them runs, and are removed
+// at exit.
+class SyntheticCaptureFile {
+ public:
+  explicit SyntheticCaptureFile(orbit_capture_file_tool::SyntheticCaptureOptions options)
+      : options_{options} {}
+
+  [[nodiscard]] const std::filesystem::path& GetPath() {
+    if (!temporary_file_.has_value()) {
+      auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+      FAIL_IF(temporary_file_or_error.has_error(), "%s", temporary_file_or_error.error().message());
+      temporary_file_.emplace(std::move(temporary_file_or_error.value()));
+      temporary_file_->CloseAndRemove();
+      auto stats_or_error = orbit_capture_file_tool::WriteSyntheticCaptureFile(
+          temporary_file_->file_path(), options_);
+      FAIL_IF(stats_or_error.has_error(), "Generating synthetic capture: %s",
+              stats_or_error.error().message());
+    }
+    return temporary_file_->file_path();
+  }
+
+ private:
+  orbit_capture_file_tool::SyntheticCaptureOptions options_;
+  std::optional<orbit_base::TemporaryFile> temporary_file_;
+};
+
+[[nodiscard]] SyntheticCaptureFile* GetSyntheticCaptureFile(uint64_t duration_ms) {
+  static auto* files = new absl::flat_hash_map<uint64_t, std::unique_ptr<SyntheticCaptureFile>>;
+  std::unique_ptr<SyntheticCaptureFile>& file = (*files)[duration_ms];
+  if (file == nullptr) {
+    orbit_capture_file_tool::SyntheticCaptureOptions options;
+    options.duration_ms = duration_ms;
+    file = std::make_unique<SyntheticCaptureFile>(options);
+  }
+  return file.get();
+}
+
+using CaptureBenchmarkFunction = void (*)(benchmark::State&, const std::filesystem::path&);
+
+void RegisterBenchmarksForCapture(const std::string& capture_name,
+                                  const std::function<std::filesystem::path()>& get_path) {
+  const std::vector<std::pair<std::string, CaptureBenchmarkFunction>> benchmarks = {
+      {"BM_LoadCapture", &BM_LoadCapture},
+      {"BM_PostProcessSamplingData", &BM_PostProcessSamplingData},
+      {"BM_CreateTopDownView",
+       [](benchmark::State& state, const std::filesystem::path& path) {
+         BM_CreateCallTreeView(state, path, /*bottom_up=*/false);
+       }},
+      {"BM_CreateBottomUpView",
+       [](benchmark::State& state, const std::filesystem::path& path) {
+         BM_CreateCallTreeView(state, path, /*bottom_up=*/true);
+       }},
+      {"BM_CreateTracks", &BM_CreateTracks},
+  };
+  for (const auto& [benchmark_name, function] : benchmarks) {
+    benchmark::RegisterBenchmark(
+        absl::StrFormat("%s/%s", benchmark_name, capture_name).c_str(),
+        [function = function, get_path](benchmark::State& state) { function(state, get_path()); })
+        ->Unit(benchmark::kMillisecond);
+  }
+}
+
+// Both synthetic captures use the default options, i.e., 16 threads that are sampled and call
+// instrumented functions, for one second and for 30 seconds. The large one has about 500'000
+// callstack samples and 1'400'000 function calls.
+[[nodiscard]] bool RegisterCaptureLoadingBenchmarks() {
+  for (uint64_t duration_ms : {1'000, 30'000}) {
+    RegisterBenchmarksForCapture(absl::StrFormat("synthetic_%ums", duration_ms), [duration_ms]() {
+      return GetSyntheticCaptureFile(duration_ms)->GetPath();
+    });
+  }
+
+  const char* capture_files = getenv("ORBIT_BENCHMARK_CAPTURE_FILES");
+  if (capture_files != nullptr) {
+    for (std::string_view capture_file : absl::StrSplit(capture_files, ':', absl::SkipEmpty())) {
+      std::filesystem::path path{std::string{capture_file}};
+      RegisterBenchmarksForCapture(path.filename().string(), [path]() { return path; });
+    }
+  }
+  return true;
+}
+
+[[maybe_unused]] const bool kCaptureLoadingBenchmarksRegistered =
+    RegisterCaptureLoadingBenchmarks();
+
+}  // namespace
+
+}  // namespace orbit_gl
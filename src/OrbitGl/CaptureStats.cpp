@@ -4,10 +4,17 @@
 
 #include "CaptureStats.h"
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/str_format.h>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "CaptureWindow.h"
-#include "ClientData/TextBox.h"
+#include "ClientData/CallstackData.h"
+#include "ClientData/CoreUtilizationIndex.h"
+#include "ClientData/ThreadUtilizationIndex.h"
 #include "Introspection/Introspection.h"
 #include "SchedulingStats.h"
 
@@ -23,12 +30,47 @@ ErrorMessageOr<void> CaptureStats::Generate(CaptureWindow* capture_window, uint6
   const orbit_client_model::CaptureData* capture_data = time_graph->GetCaptureData();
   if (capture_data == nullptr) return ErrorMessage("No capture data found");
 
-  std::vector<const orbit_client_data::TextBox*> sched_scopes =
-      scheduler_track->GetScopesInRange(start_ns, end_ns);
+  // The statistics are computed from indexes that are maintained as the capture data is added, so
+  // that they don't need to visit the scheduling slices or the callstack samples in the range.
+  const orbit_client_data::CoreUtilizationIndex& core_utilization_index =
+      scheduler_track->GetCoreUtilizationIndex();
   SchedulingStats::ThreadNameProvider thread_name_provider = [capture_data](int32_t thread_id) {
     return capture_data->GetThreadName(thread_id);
   };
-  SchedulingStats scheduling_stats(sched_scopes, thread_name_provider, start_ns, end_ns);
+  SchedulingStats scheduling_stats(core_utilization_index,
+                                   scheduler_track->GetThreadUtilizationIndex(),
+                                   thread_name_provider, start_ns, end_ns);
   summary_ = scheduling_stats.ToString();
+
+  const uint32_t core_count = core_utilization_index.GetCoreCount();
+  if (core_count > 0) summary_ += "\nTarget process core occupancy: \n";
+  const double time_range_ns = static_cast<double>(end_ns - start_ns);
+  for (uint32_t core = 0; core < core_count; ++core) {
+    const orbit_client_data::CoreUtilization utilization =
+        core_utilization_index.GetCoreUtilization(core, start_ns, end_ns);
+    summary_ += absl::StrFormat(
+        "cpu[%u] : %.2f%%\n", core,
+        100.0 * static_cast<double>(utilization.target_process_time_on_core_ns) / time_range_ns);
+  }
+
+  const orbit_client_data::CallstackData* callstack_data = capture_data->GetCallstackData();
+  if (callstack_data == nullptr) return outcome::success();
+  absl::flat_hash_map<int32_t, uint32_t> sample_counts_by_tid =
+      callstack_data->GetCallstackEventsCountsPerTidInTimeRange(start_ns, end_ns);
+  std::vector<std::pair<int32_t, uint32_t>> sorted_sample_counts(sample_counts_by_tid.begin(),
+                                                                  sample_counts_by_tid.end());
+  std::sort(sorted_sample_counts.begin(), sorted_sample_counts.end(),
+            [](const std::pair<int32_t, uint32_t>& lhs, const std::pair<int32_t, uint32_t>& rhs) {
+              return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+            });
+  uint64_t sample_count = 0;
+  for (const auto& [unused_tid, thread_sample_count] : sorted_sample_counts) {
+    sample_count += thread_sample_count;
+  }
+  if (sample_count > 0) summary_ += absl::StrFormat("\nCallstack samples: %u\n", sample_count);
+  for (const auto& [tid, thread_sample_count] : sorted_sample_counts) {
+    summary_ += absl::StrFormat("   - %s[%i] : %u\n", capture_data->GetThreadName(tid), tid,
+                                thread_sample_count);
+  }
   return outcome::success();
 }
@@ -7,7 +7,9 @@
 #include <list>
 
 #include "CaptureStats.h"
+#include "ClientData/CoreUtilizationIndex.h"
 #include "ClientData/TextBox.h"
+#include "ClientData/ThreadUtilizationIndex.h"
 #include "SchedulerTrack.h"
 #include "SchedulingStats.h"
 
@@ -100,3 +102,57 @@ TEST(SchedulingStats, SchedulingStats) {
     EXPECT_EQ(scheduling_stats.GetProcessStatsSortedByTimeOnCore()[2]->pid, 0);
   }
 }
+
+TEST(SchedulingStats, SchedulingStatsFromIndexesEqualSchedulingStatsFromScopes) {
+  std::list<orbit_client_data::TextBox> scope_buffer;
+  std::vector<const orbit_client_data::TextBox*> scopes;
+  orbit_client_data::CoreUtilizationIndex core_utilization_index;
+  orbit_client_data::ThreadUtilizationIndex thread_utilization_index;
+  auto add_scope = [&](int32_t pid, int32_t tid, int32_t cpu, uint64_t start_ns, uint64_t end_ns) {
+    orbit_client_protos::TimerInfo timer_info;
+    timer_info.set_start(start_ns);
+    timer_info.set_end(end_ns);
+    timer_info.set_thread_id(tid);
+    timer_info.set_process_id(pid);
+    timer_info.set_processor(cpu);
+    scopes.push_back(&scope_buffer.emplace_back(std::move(timer_info)));
+    core_utilization_index.AddSlice(cpu, start_ns, end_ns, /*is_target_process=*/pid == 0);
+    thread_utilization_index.AddSlice(pid, tid, start_ns, end_ns);
+  };
+  SchedulingStats::ThreadNameProvider thread_name_provider = [](int32_t thread_id) {
+    return std::to_string(thread_id);
+  };
+
+  add_scope(/*pid=*/0, /*tid=*/1, /*cpu=*/0, /*start_ns=*/0, /*end_ns=*/10);
+  add_scope(/*pid=*/0, /*tid=*/1, /*cpu=*/1, /*start_ns=*/20, /*end_ns=*/40);
+  add_scope(/*pid=*/0, /*tid=*/2, /*cpu=*/0, /*start_ns=*/10, /*end_ns=*/50);
+  add_scope(/*pid=*/3, /*tid=*/4, /*cpu=*/1, /*start_ns=*/40, /*end_ns=*/100);
+  add_scope(/*pid=*/3, /*tid=*/4, /*cpu=*/2, /*start_ns=*/100, /*end_ns=*/102);
+
+  // As SchedulerTrack::GetScopesInRange, only passes the scopes that intersect the range.
+  constexpr uint64_t kStartNs = 5;
+  constexpr uint64_t kEndNs = 105;
+  std::vector<const orbit_client_data::TextBox*> scopes_in_range;
+  for (const orbit_client_data::TextBox* scope : scopes) {
+    if (scope->GetTimerInfo().end() > kStartNs && scope->GetTimerInfo().start() < kEndNs) {
+      scopes_in_range.push_back(scope);
+    }
+  }
+  SchedulingStats stats_from_scopes(scopes_in_range, thread_name_provider, kStartNs, kEndNs);
+  SchedulingStats stats_from_indexes(core_utilization_index, thread_utilization_index,
+                                     thread_name_provider, kStartNs, kEndNs);
+
+  EXPECT_EQ(stats_from_indexes.GetTimeOnCoreNs(), 127);
+  EXPECT_EQ(stats_from_indexes.GetTimeOnCoreNs(), stats_from_scopes.GetTimeOnCoreNs());
+  EXPECT_EQ(stats_from_indexes.GetTimeOnCoreNsByCore(), stats_from_scopes.GetTimeOnCoreNsByCore());
+  ASSERT_EQ(stats_from_indexes.GetProcessStatsSortedByTimeOnCore().size(), 2);
+  const SchedulingStats::ProcessStats* process_stats =
+      stats_from_indexes.GetProcessStatsSortedByTimeOnCore()[0];
+  EXPECT_EQ(process_stats->pid, 0);
+  EXPECT_EQ(process_stats->time_on_core_ns, 5 + 20 + 40);
+  EXPECT_EQ(process_stats->context_switch_count, 3);
+  ASSERT_EQ(process_stats->thread_stats_sorted_by_time_on_core.size(), 2);
+  EXPECT_EQ(process_stats->thread_stats_sorted_by_time_on_core[0]->tid, 2);
+  EXPECT_EQ(process_stats->thread_stats_sorted_by_time_on_core[1]->context_switch_count, 2);
+  EXPECT_EQ(stats_from_indexes.ToString(), stats_from_scopes.ToString());
+}
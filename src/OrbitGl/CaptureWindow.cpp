@@ -4,6 +4,7 @@
 
 #include "CaptureWindow.h"
 
+#include <absl/strings/str_format.h>
 #include <absl/time/time.h>
 #include <glad/glad.h>
 #include <imgui.h>
@@ -14,12 +15,16 @@
 #include <cstdint>
 #include <functional>
 #include <iterator>
+#include <optional>
 #include <ostream>
+#include <string>
 #include <string_view>
 
 #include "AccessibleTimeGraph.h"
 #include "App.h"
 #include "ClientData/CallstackData.h"
+#include "ClientData/FunctionStatsUtils.h"
+#include "ClientData/PipelineLatencyStats.h"
 #include "ClientData/TextBox.h"
 #include "ClientModel/CaptureData.h"
 #include "CoreMath.h"
@@ -28,6 +33,8 @@
 #include "GlUtils.h"
 #include "ImGuiOrbit.h"
 #include "Introspection/Introspection.h"
+#include "MetricsUploader/ClientPerformanceMetrics.h"
+#include "MetricsUploader/ScopedMetric.h"
 #include "OrbitAccessibility/AccessibleInterface.h"
 #include "OrbitBase/Append.h"
 #include "OrbitBase/Logging.h"
@@ -85,7 +92,9 @@ CaptureWindow::CaptureWindow(OrbitApp* app) : GlCanvas(), app_{app} {
 
   vertical_slider_->SetDragCallback([&](float ratio) {
     this->UpdateVerticalScroll(ratio);
-    RequestUpdatePrimitives();
+    // Scrolling flags the viewport as dirty, which makes Draw rebuild the primitives from the
+    // tracks' caches.
+    RequestRedraw();
   });
 
   vertical_slider_->SetOrthogonalSliderPixelHeight(slider_->GetPixelHeight());
@@ -190,7 +199,7 @@ void CaptureWindow::SelectTextBox(const orbit_client_data::TextBox* text_box) {
   if (text_box == nullptr) return;
 
   app_->SelectTextBox(text_box);
-  app_->set_selected_thread_id(text_box->GetTimerInfo().thread_id());
+  app_->set_selected_thread_id(text_box->GetPackedTimerInfo().thread_id());
 
   const TimerInfo& timer_info = text_box->GetTimerInfo();
 
@@ -203,7 +212,9 @@ void CaptureWindow::SelectTextBox(const orbit_client_data::TextBox* text_box) {
 
 void CaptureWindow::PostRender() {
   if (picking_mode_ != PickingMode::kNone) {
-    RequestUpdatePrimitives();
+    // Replace the primitives of the picking pass with those of a regular one.
+    RequestRedraw();
+    if (time_graph_ != nullptr) time_graph_->RequestPrimitivesRebuild();
   }
 
   GlCanvas::PostRender();
@@ -323,6 +334,12 @@ void CaptureWindow::KeyPressed(unsigned int key_code, bool ctrl, bool shift, boo
     case 'X':
       ToggleRecording();
       break;
+    case 'R':
+      app_->RequestFlightRecorderSnapshot();
+      break;
+    case 'C':
+      app_->HighlightCriticalPath(app_->selected_text_box());
+      break;
     case 18:  // Left
       if (time_graph_ == nullptr) return;
       if (shift) {
@@ -389,6 +406,10 @@ void CaptureWindow::Draw(bool viewport_was_dirty) {
     return;
   }
 
+  orbit_metrics_uploader::ScopedMetric frame_metric{
+      app_->GetClientPerformanceMetrics(),
+      orbit_metrics_uploader::ClientOperation::kCaptureWindowFrame};
+
   if (ShouldAutoZoom()) {
     ZoomAll();
   }
@@ -398,7 +419,7 @@ void CaptureWindow::Draw(bool viewport_was_dirty) {
       time_graph_->SetPos(0, 0);
       time_graph_->SetSize(viewport_.GetWorldExtents()[0], viewport_.GetWorldExtents()[1]);
 
-      time_graph_->RequestUpdate();
+      time_graph_->RequestPrimitivesRebuild();
     }
     uint64_t timegraph_current_mouse_time_ns =
         time_graph_->GetTickFromWorld(viewport_.ScreenToWorldPos(GetMouseScreenPos())[0]);
@@ -667,12 +688,38 @@ void CaptureWindow::RenderImGuiDebugUI() {
       IMGUI_VAR_TO_TEXT(time_graph_->GetTimeWindowUs());
       const CaptureData* capture_data = time_graph_->GetCaptureData();
       if (capture_data != nullptr) {
-        IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->callstack_events_by_tid().size());
+        IMGUI_VAR_TO_TEXT(
+            capture_data->GetCallstackData()->GetCallstackEventsCountsPerTid().size());
         IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->GetCallstackEventsCount());
       }
     }
   }
 
+  if (app_ != nullptr && ImGui::CollapsingHeader("Pipeline Latency")) {
+    using orbit_client_data::PipelineLatencyStats;
+    const PipelineLatencyStats& pipeline_latency_stats = app_->GetPipelineLatencyStats();
+    IMGUI_VAR_TO_TEXT(pipeline_latency_stats.GetProbeCount());
+    auto format_duration = [](std::optional<uint64_t> duration_ns) {
+      return duration_ns.has_value()
+                 ? orbit_display_formats::GetDisplayTime(absl::Nanoseconds(duration_ns.value()))
+                 : std::string{"-"};
+    };
+    for (size_t i = 0; i < PipelineLatencyStats::kStageCount; ++i) {
+      const auto stage = static_cast<PipelineLatencyStats::Stage>(i);
+      const orbit_client_protos::FunctionStats stats =
+          pipeline_latency_stats.GetStageLatencyStats(stage);
+      const std::string text = absl::StrFormat(
+          "%s: %u probes, avg %s, p50 %s, p90 %s, p99 %s, max %s",
+          PipelineLatencyStats::GetStageName(stage), stats.count(),
+          format_duration(stats.average_time_ns()),
+          format_duration(orbit_client_data::GetDurationPercentileNs(stats, 0.5)),
+          format_duration(orbit_client_data::GetDurationPercentileNs(stats, 0.9)),
+          format_duration(orbit_client_data::GetDurationPercentileNs(stats, 0.99)),
+          format_duration(stats.max_ns()));
+      ImGui::TextUnformatted(text.c_str(), text.c_str() + text.size());
+    }
+  }
+
   if (ImGui::CollapsingHeader("Selection Summary")) {
     const std::string& selection_summary = selection_stats_.GetSummary();
 
@@ -715,11 +762,13 @@ void CaptureWindow::RenderHelpUi() {
 const char* CaptureWindow::GetHelpText() const {
   const char* help_message =
       "Start/Stop Capture: 'F5'\n"
+      "Send Flight Recorder Events: 'R'\n"
       "Pan: 'A','D' or \"Left Click + Drag\"\n"
       "Zoom: 'W', 'S', Scroll or \"Ctrl + Right Click + Drag\"\n"
       "Vertical Zoom: \"Ctrl + Scroll\"\n"
       "Select: Left Click\n"
       "Measure: \"Right Click + Drag\"\n"
+      "Highlight Critical Path of Selection: 'C'\n"
       "Toggle Help: Ctrl + 'H'";
   return help_message;
 }
@@ -15,6 +15,23 @@ using orbit_client_data::TracepointInfoSet;
 using orbit_client_protos::FunctionInfo;
 using orbit_grpc_protos::TracepointInfo;
 
+namespace {
+thread_local int scoped_read_access_count = 0;
+}  // namespace
+
+DataManager::ScopedReadAccessFromWorkerThread::ScopedReadAccessFromWorkerThread() {
+  ++scoped_read_access_count;
+}
+
+DataManager::ScopedReadAccessFromWorkerThread::~ScopedReadAccessFromWorkerThread() {
+  CHECK(scoped_read_access_count > 0);
+  --scoped_read_access_count;
+}
+
+bool DataManager::IsReadAllowedOnThisThread() const {
+  return std::this_thread::get_id() == main_thread_id_ || scoped_read_access_count > 0;
+}
+
 void DataManager::SelectFunction(const FunctionInfo& function) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
   if (!selected_functions_.contains(function)) {
@@ -22,6 +39,15 @@ void DataManager::SelectFunction(const FunctionInfo& function) {
   }
 }
 
+void DataManager::SelectFunctions(absl::Span<const FunctionInfo* const> functions) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  selected_functions_.reserve(selected_functions_.size() + functions.size());
+  for (const FunctionInfo* function : functions) {
+    CHECK(function != nullptr);
+    selected_functions_.insert(*function);
+  }
+}
+
 void DataManager::DeselectFunction(const FunctionInfo& function) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
   selected_functions_.erase(function);
@@ -43,22 +69,22 @@ void DataManager::set_selected_thread_id(int32_t thread_id) {
 }
 
 bool DataManager::IsFunctionVisible(uint64_t function_id) const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(IsReadAllowedOnThisThread());
   return visible_function_ids_.contains(function_id);
 }
 
 uint64_t DataManager::highlighted_function_id() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(IsReadAllowedOnThisThread());
   return highlighted_function_id_;
 }
 
 int32_t DataManager::selected_thread_id() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(IsReadAllowedOnThisThread());
   return selected_thread_id_;
 }
 
 const orbit_client_data::TextBox* DataManager::selected_text_box() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(IsReadAllowedOnThisThread());
   return selected_text_box_;
 }
 
@@ -67,18 +93,30 @@ void DataManager::set_selected_text_box(const orbit_client_data::TextBox* text_b
   selected_text_box_ = text_box;
 }
 
+const absl::flat_hash_set<const orbit_client_data::TextBox*>& DataManager::highlighted_text_boxes()
+    const {
+  CHECK(IsReadAllowedOnThisThread());
+  return highlighted_text_boxes_;
+}
+
+void DataManager::set_highlighted_text_boxes(
+    absl::flat_hash_set<const orbit_client_data::TextBox*> text_boxes) {
+  CHECK(std::this_thread::get_id() == main_thread_id_);
+  highlighted_text_boxes_ = std::move(text_boxes);
+}
+
 void DataManager::ClearSelectedFunctions() {
   CHECK(std::this_thread::get_id() == main_thread_id_);
   selected_functions_.clear();
 }
 
 bool DataManager::IsFunctionSelected(const FunctionInfo& function) const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(IsReadAllowedOnThisThread());
   return selected_functions_.contains(function);
 }
 
 std::vector<FunctionInfo> DataManager::GetSelectedFunctions() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  CHECK(IsReadAllowedOnThisThread());
   return std::vector<FunctionInfo>(selected_functions_.begin(), selected_functions_.end());
 }
 
@@ -7,6 +7,7 @@
 
 #include <absl/container/flat_hash_set.h>
 #include <absl/container/node_hash_map.h>
+#include <absl/types/span.h>
 
 #include <cstdint>
 #include <thread>
@@ -30,13 +31,28 @@ class DataManager final {
   explicit DataManager(std::thread::id thread_id = std::this_thread::get_id())
       : main_thread_id_(thread_id) {}
 
+  // While an instance exists on a thread, the selection and visibility getters may also be called
+  // on that thread. This is meant for work that the main thread waits for, so that it can't modify
+  // the data at the same time.
+  class ScopedReadAccessFromWorkerThread {
+   public:
+    ScopedReadAccessFromWorkerThread();
+    ~ScopedReadAccessFromWorkerThread();
+    ScopedReadAccessFromWorkerThread(const ScopedReadAccessFromWorkerThread&) = delete;
+    ScopedReadAccessFromWorkerThread& operator=(const ScopedReadAccessFromWorkerThread&) = delete;
+  };
+
   void SelectFunction(const orbit_client_protos::FunctionInfo& function);
+  // Like SelectFunction for each of `functions`, e.g., for a preset of thousands of functions.
+  void SelectFunctions(absl::Span<const orbit_client_protos::FunctionInfo* const> functions);
   void DeselectFunction(const orbit_client_protos::FunctionInfo& function);
   void ClearSelectedFunctions();
   void set_visible_function_ids(absl::flat_hash_set<uint64_t> visible_function_ids);
   void set_highlighted_function_id(uint64_t highlighted_function_id);
   void set_selected_thread_id(int32_t thread_id);
   void set_selected_text_box(const orbit_client_data::TextBox* text_box);
+  void set_highlighted_text_boxes(
+      absl::flat_hash_set<const orbit_client_data::TextBox*> text_boxes);
 
   [[nodiscard]] bool IsFunctionSelected(const orbit_client_protos::FunctionInfo& function) const;
   [[nodiscard]] std::vector<orbit_client_protos::FunctionInfo> GetSelectedFunctions() const;
@@ -44,6 +60,9 @@ class DataManager final {
   [[nodiscard]] uint64_t highlighted_function_id() const;
   [[nodiscard]] int32_t selected_thread_id() const;
   [[nodiscard]] const orbit_client_data::TextBox* selected_text_box() const;
+  // The timers to highlight on top of those of the highlighted function, e.g., search results.
+  [[nodiscard]] const absl::flat_hash_set<const orbit_client_data::TextBox*>&
+  highlighted_text_boxes() const;
 
   void SelectTracepoint(const orbit_grpc_protos::TracepointInfo& info);
   void DeselectTracepoint(const orbit_grpc_protos::TracepointInfo& info);
@@ -128,6 +147,8 @@ class DataManager final {
   }
 
  private:
+  [[nodiscard]] bool IsReadAllowedOnThisThread() const;
+
   const std::thread::id main_thread_id_;
   orbit_client_data::FunctionInfoSet selected_functions_;
   absl::flat_hash_set<uint64_t> visible_function_ids_;
@@ -137,6 +158,7 @@ class DataManager final {
 
   int32_t selected_thread_id_ = -1;
   const orbit_client_data::TextBox* selected_text_box_ = nullptr;
+  absl::flat_hash_set<const orbit_client_data::TextBox*> highlighted_text_boxes_;
 
   // DataManager needs a copy of this so that we can persist user choices like frame tracks between
   // captures.
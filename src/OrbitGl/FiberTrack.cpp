@@ -0,0 +1,116 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FiberTrack.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+
+#include "App.h"
+#include "Batcher.h"
+#include "DisplayFormats/DisplayFormats.h"
+#include "GlCanvas.h"
+#include "ManualInstrumentationManager.h"
+#include "TextRenderer.h"
+#include "TimeGraph.h"
+#include "TimeGraphLayout.h"
+#include "TriangleToggle.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+FiberTrack::FiberTrack(CaptureViewElement* parent, TimeGraph* time_graph,
+                       orbit_gl::Viewport* viewport, TimeGraphLayout* layout, uint64_t fiber_id,
+                       OrbitApp* app, const orbit_client_model::CaptureData* capture_data,
+                       uint32_t indentation_level)
+    : TimerTrack(parent, time_graph, viewport, layout, app, capture_data, indentation_level),
+      fiber_id_{fiber_id} {
+  std::string name = absl::StrFormat("Fiber %#x", fiber_id);
+  SetName(name);
+  SetLabel(name);
+}
+
+std::string FiberTrack::GetScopeName(const TimerInfo& timer_info) const {
+  // As on thread tracks, the name in the registers is truncated if the full name was interned.
+  if (timer_info.user_data_key() != 0) {
+    std::optional<std::string_view> name =
+        app_->GetStringManager()->Get(timer_info.user_data_key());
+    if (name.has_value()) return std::string{name.value()};
+  }
+  return ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info).name;
+}
+
+std::string FiberTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) const {
+  const orbit_client_data::TextBox* text_box = batcher.GetTextBox(id);
+  if (text_box == nullptr) return "";
+  const TimerInfo& timer_info = text_box->GetTimerInfo();
+
+  return absl::StrFormat(
+      "<b>%s</b><br/>"
+      "<i>Timing measured through manual instrumentation</i>"
+      "<br/><br/>"
+      "<b>Fiber:</b> %#x<br/>"
+      "<b>Ended on thread:</b> %d<br/>"
+      "<b>Time:</b> %s",
+      GetScopeName(timer_info), fiber_id_, timer_info.thread_id(),
+      orbit_display_formats::GetDisplayTime(TicksToDuration(text_box->Start(), text_box->End())));
+}
+
+void FiberTrack::UpdateBoxHeight() {
+  box_height_ = layout_->GetTextBoxHeight();
+  if (collapse_toggle_->IsCollapsed() && depth_ > 0) {
+    box_height_ /= static_cast<float>(depth_);
+  }
+}
+
+void FiberTrack::SetTimesliceText(const TimerInfo& timer_info, float min_x, float z_offset,
+                                  orbit_client_data::TextBox* text_box) {
+  if (text_box->GetText().empty()) {
+    std::string time = orbit_display_formats::GetDisplayTime(
+        absl::Nanoseconds(timer_info.end() - timer_info.start()));
+    text_box->SetElapsedTimeTextLength(time.length());
+    text_box->SetText(absl::StrFormat("%s %s", GetScopeName(timer_info), time));
+  }
+
+  const Color kTextWhite(255, 255, 255, 255);
+  const auto& box_pos = text_box->GetPos();
+  const auto& box_size = text_box->GetSize();
+  float pos_x = std::max(box_pos.first, min_x);
+  float max_size = box_pos.first + box_size.first - pos_x;
+  text_renderer_->AddTextTrailingCharsPrioritized(
+      text_box->GetText().c_str(), pos_x, box_pos.second + layout_->GetTextOffset(),
+      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
+      layout_->CalculateZoomedFontSize(), max_size);
+}
+
+Color FiberTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
+                                bool is_highlighted) const {
+  const Color kSelectionColor(0, 128, 255, 255);
+  if (is_highlighted) {
+    return TimerTrack::kHighlightColor;
+  }
+  if (is_selected) {
+    return kSelectionColor;
+  }
+
+  orbit_api::Event event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
+  Color color;
+  if (event.color != kOrbitColorAuto) {
+    const auto rgba = static_cast<uint32_t>(event.color);
+    color = Color((rgba >> 24) & 0xFF, (rgba >> 16) & 0xFF, (rgba >> 8) & 0xFF, rgba & 0xFF);
+  } else {
+    color = TimeGraph::GetColor(GetScopeName(timer_info));
+  }
+
+  constexpr uint8_t kOddAlpha = 210;
+  if (!(timer_info.depth() & 0x1)) {
+    color[3] = kOddAlpha;
+  }
+
+  return color;
+}
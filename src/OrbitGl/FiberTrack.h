@@ -0,0 +1,48 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_FIBER_TRACK_H_
+#define ORBIT_GL_FIBER_TRACK_H_
+
+#include <cstdint>
+#include <string>
+
+#include "ClientData/TextBox.h"
+#include "CoreMath.h"
+#include "PickingManager.h"
+#include "TimerTrack.h"
+#include "Track.h"
+#include "Viewport.h"
+#include "capture_data.pb.h"
+
+class OrbitApp;
+
+// Displays the scopes of the manual instrumentation API that ran on the fiber or job `fiber_id`
+// (see ORBIT_FIBER_SWITCH_IN in Orbit.h), whichever threads the fiber ran on. Unlike on an
+// AsyncTrack, the scopes keep the depth of their nesting on the fiber.
+class FiberTrack final : public TimerTrack {
+ public:
+  explicit FiberTrack(CaptureViewElement* parent, TimeGraph* time_graph,
+                      orbit_gl::Viewport* viewport, TimeGraphLayout* layout, uint64_t fiber_id,
+                      OrbitApp* app, const orbit_client_model::CaptureData* capture_data,
+                      uint32_t indentation_level = 0);
+
+  [[nodiscard]] Type GetType() const override { return Type::kFiberTrack; };
+  [[nodiscard]] uint64_t GetFiberId() const { return fiber_id_; }
+  [[nodiscard]] std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const override;
+  void UpdateBoxHeight() override;
+
+ protected:
+  void SetTimesliceText(const orbit_client_protos::TimerInfo& timer, float min_x, float z_offset,
+                        orbit_client_data::TextBox* text_box) override;
+  [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer_info,
+                                    bool is_selected, bool is_highlighted) const override;
+
+ private:
+  [[nodiscard]] std::string GetScopeName(const orbit_client_protos::TimerInfo& timer_info) const;
+
+  uint64_t fiber_id_;
+};
+
+#endif  // ORBIT_GL_FIBER_TRACK_H_
@@ -0,0 +1,135 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FlameGraph.h"
+
+#include <absl/strings/ascii.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadConstants.h"
+
+namespace orbit_gl {
+
+namespace {
+[[nodiscard]] std::string GetFrameName(const CallTreeNode& node) {
+  if (auto* function = dynamic_cast<const CallTreeFunction*>(&node); function != nullptr) {
+    return function->function_name();
+  }
+  if (auto* thread = dynamic_cast<const CallTreeThread*>(&node); thread != nullptr) {
+    if (thread->thread_name().empty()) return absl::StrFormat("[%d]", thread->thread_id());
+    return absl::StrFormat("%s [%d]", thread->thread_name(), thread->thread_id());
+  }
+  return "[Unwind errors]";
+}
+
+[[nodiscard]] bool IsAllThreadsNode(const CallTreeNode& node) {
+  auto* thread = dynamic_cast<const CallTreeThread*>(&node);
+  return thread != nullptr && thread->thread_id() == orbit_base::kAllProcessThreadsTid;
+}
+}  // namespace
+
+FlameGraph::FlameGraph(std::unique_ptr<CallTreeView> top_down_view)
+    : top_down_view_{std::move(top_down_view)} {
+  CHECK(top_down_view_ != nullptr);
+  AddFrames(*top_down_view_, 0, 0);
+}
+
+uint64_t FlameGraph::GetTotalSampleCount() const { return top_down_view_->sample_count(); }
+
+void FlameGraph::AddFrames(const CallTreeNode& node, uint32_t depth, uint64_t first_sample) {
+  std::vector<const CallTreeNode*> children = node.children();
+  // The node for all the threads of the process repeats the samples of the thread nodes, so it is
+  // only kept when there are no thread nodes.
+  if (children.size() > 1) {
+    children.erase(std::remove_if(children.begin(), children.end(),
+                                  [](const CallTreeNode* child) {
+                                    return IsAllThreadsNode(*child);
+                                  }),
+                   children.end());
+  }
+  std::stable_sort(children.begin(), children.end(),
+                   [](const CallTreeNode* lhs, const CallTreeNode* rhs) {
+                     return lhs->sample_count() > rhs->sample_count();
+                   });
+
+  for (const CallTreeNode* child : children) {
+    if (child->sample_count() == 0) continue;
+    const size_t frame_index = frames_.size();
+    frames_.push_back(Frame{child, GetFrameName(*child), depth, first_sample,
+                            child->sample_count(), 0});
+    max_depth_ = std::max(max_depth_, depth + 1);
+    AddFrames(*child, depth + 1, first_sample);
+    frames_[frame_index].end_index = frames_.size();
+    first_sample += child->sample_count();
+  }
+}
+
+void FlameGraph::ZoomToFrame(size_t frame_index) {
+  CHECK(frame_index < frames_.size());
+  zoomed_frame_index_ = frame_index;
+}
+
+void FlameGraph::SetSearchString(std::string_view search_string) {
+  std::string lower_search_string{search_string};
+  absl::AsciiStrToLower(&lower_search_string);
+  for (Frame& frame : frames_) {
+    frame.matches_search = !lower_search_string.empty() &&
+                           absl::StrContains(absl::AsciiStrToLower(frame.name),
+                                             lower_search_string);
+  }
+
+  // The samples of a matching frame include the ones of the matching frames in its subtree.
+  matching_sample_count_ = 0;
+  for (size_t i = 0; i < frames_.size();) {
+    if (frames_[i].matches_search) {
+      matching_sample_count_ += frames_[i].sample_count;
+      i = frames_[i].end_index;
+    } else {
+      ++i;
+    }
+  }
+}
+
+void FlameGraph::ForEachVisibleFrame(double min_width_fraction,
+                                     const FrameCallback& callback) const {
+  size_t begin_index = 0;
+  size_t end_index = frames_.size();
+  uint64_t min_sample = 0;
+  uint64_t sample_count = GetTotalSampleCount();
+  if (zoomed_frame_index_.has_value()) {
+    const Frame& zoomed_frame = frames_[zoomed_frame_index_.value()];
+    begin_index = zoomed_frame_index_.value();
+    end_index = zoomed_frame.end_index;
+    min_sample = zoomed_frame.first_sample;
+    sample_count = zoomed_frame.sample_count;
+
+    // The ancestors of the zoomed frame are the frames before it whose subtree contains it.
+    for (size_t i = 0; i < begin_index;) {
+      if (frames_[i].end_index > begin_index) {
+        callback(i, 0., 1.);
+        ++i;
+      } else {
+        i = frames_[i].end_index;
+      }
+    }
+  }
+  if (sample_count == 0) return;
+
+  for (size_t i = begin_index; i < end_index;) {
+    const Frame& frame = frames_[i];
+    const double width = static_cast<double>(frame.sample_count) / sample_count;
+    if (width < min_width_fraction) {
+      i = frame.end_index;
+      continue;
+    }
+    callback(i, static_cast<double>(frame.first_sample - min_sample) / sample_count, width);
+    ++i;
+  }
+}
+
+}  // namespace orbit_gl
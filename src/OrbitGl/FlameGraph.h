@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_FLAME_GRAPH_H_
+#define ORBIT_GL_FLAME_GRAPH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CallTreeView.h"
+
+namespace orbit_gl {
+
+// The frames of a flame graph of the callstacks aggregated in a top-down CallTreeView, which is
+// built from PostProcessedSamplingData like the other views of the samples. A frame is a node of
+// the tree, its width is the node's share of the samples, and its children are stacked on it.
+//
+// The frames are kept in preorder, with the children of a frame sorted by decreasing sample
+// count, so that the frames of a subtree are contiguous and the horizontal position of a frame
+// is the number of samples of the frames left of it.
+//
+// Thread-Safety: This class is not thread-safe. It can be built on any thread and then used on
+// another one.
+class FlameGraph {
+ public:
+  struct Frame {
+    const CallTreeNode* node;
+    std::string name;
+    uint32_t depth;
+    // The number of samples of the frames left of this one with the same depth, i.e., the
+    // position of the frame in samples.
+    uint64_t first_sample;
+    uint64_t sample_count;
+    // One past the index of the last frame of the subtree of this frame.
+    size_t end_index;
+    bool matches_search = false;
+  };
+
+  explicit FlameGraph(std::unique_ptr<CallTreeView> top_down_view);
+
+  [[nodiscard]] const std::vector<Frame>& GetFrames() const { return frames_; }
+  [[nodiscard]] uint64_t GetTotalSampleCount() const;
+  // The number of frames stacked on the longest callstack, including the thread frame.
+  [[nodiscard]] uint32_t GetMaxDepth() const { return max_depth_; }
+
+  // Zooming to a frame stretches it, and its subtree, to the width of the graph. The frames left
+  // and right of it are hidden, its ancestors span the whole width.
+  void ZoomToFrame(size_t frame_index);
+  void ResetZoom() { zoomed_frame_index_.reset(); }
+  [[nodiscard]] std::optional<size_t> GetZoomedFrameIndex() const { return zoomed_frame_index_; }
+
+  // Marks the frames whose name contains `search_string`, ignoring case. An empty string marks no
+  // frame.
+  void SetSearchString(std::string_view search_string);
+  // The number of samples that are in at least one frame that matches the search.
+  [[nodiscard]] uint64_t GetMatchingSampleCount() const { return matching_sample_count_; }
+
+  // Calls `callback` with the index of each frame that is visible with the current zoom, with its
+  // horizontal position and its width as fractions of the width of the graph. Frames narrower than
+  // `min_width_fraction` are skipped together with their subtrees.
+  using FrameCallback = std::function<void(size_t frame_index, double x, double width)>;
+  void ForEachVisibleFrame(double min_width_fraction, const FrameCallback& callback) const;
+
+ private:
+  void AddFrames(const CallTreeNode& node, uint32_t depth, uint64_t first_sample);
+
+  std::unique_ptr<CallTreeView> top_down_view_;
+  std::vector<Frame> frames_;
+  uint32_t max_depth_ = 0;
+  std::optional<size_t> zoomed_frame_index_;
+  uint64_t matching_sample_count_ = 0;
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_FLAME_GRAPH_H_
@@ -0,0 +1,212 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CallTreeView.h"
+#include "ClientData/PostProcessedSamplingData.h"
+#include "ClientModel/CaptureData.h"
+#include "ClientModel/SamplingDataPostProcessor.h"
+#include "FlameGraph.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+using orbit_client_model::CaptureData;
+using orbit_client_protos::CallstackInfo;
+
+namespace orbit_gl {
+
+namespace {
+
+constexpr int32_t kThreadId = 42;
+constexpr uint64_t kFunctionBaseAddress = 0x1000;
+
+class FlameGraphTest : public testing::Test {
+ public:
+  FlameGraphTest() : capture_data_{nullptr, orbit_grpc_protos::CaptureStarted{}, std::nullopt, {}} {
+    capture_data_.AddOrAssignThreadName(kThreadId, "thread");
+  }
+
+ protected:
+  // `function_indices` are from the innermost frame to the outermost frame. Function i is called
+  // "function i".
+  void AddSamples(const std::vector<uint64_t>& function_indices, uint64_t count) {
+    CallstackInfo callstack_info;
+    for (uint64_t function_index : function_indices) {
+      const uint64_t address = kFunctionBaseAddress + 16 * function_index;
+      orbit_client_protos::LinuxAddressInfo address_info;
+      address_info.set_absolute_address(address);
+      address_info.set_offset_in_function(0);
+      address_info.set_function_name("function " + std::to_string(function_index));
+      address_info.set_module_path("/path/to/module");
+      capture_data_.InsertAddressInfo(address_info);
+      callstack_info.add_frames(address);
+    }
+    callstack_info.set_type(CallstackInfo::kComplete);
+    const uint64_t callstack_id = ++last_callstack_id_;
+    capture_data_.AddUniqueCallstack(callstack_id, std::move(callstack_info));
+
+    for (uint64_t i = 0; i < count; ++i) {
+      orbit_client_protos::CallstackEvent callstack_event;
+      callstack_event.set_callstack_id(callstack_id);
+      callstack_event.set_thread_id(kThreadId);
+      callstack_event.set_time(++last_timestamp_ns_);
+      capture_data_.AddCallstackEvent(std::move(callstack_event));
+    }
+  }
+
+  [[nodiscard]] std::unique_ptr<FlameGraph> CreateFlameGraph() const {
+    return std::make_unique<FlameGraph>(
+        CallTreeView::CreateTopDownViewFromPostProcessedSamplingData(
+            orbit_client_model::CreatePostProcessedSamplingData(*capture_data_.GetCallstackData(),
+                                                                capture_data_),
+            capture_data_));
+  }
+
+  // The names of the frames visible with the current zoom, with their position and width.
+  struct VisibleFrame {
+    std::string name;
+    double x;
+    double width;
+  };
+  [[nodiscard]] static std::vector<VisibleFrame> GetVisibleFrames(const FlameGraph& flame_graph,
+                                                                  double min_width_fraction) {
+    std::vector<VisibleFrame> visible_frames;
+    flame_graph.ForEachVisibleFrame(
+        min_width_fraction, [&](size_t frame_index, double x, double width) {
+          visible_frames.push_back({flame_graph.GetFrames()[frame_index].name, x, width});
+        });
+    return visible_frames;
+  }
+
+ private:
+  CaptureData capture_data_;
+  uint64_t last_callstack_id_ = 0;
+  uint64_t last_timestamp_ns_ = 0;
+};
+
+}  // namespace
+
+TEST_F(FlameGraphTest, FramesAreInPreorderWithTheWidestChildrenFirst) {
+  AddSamples({1, 0}, 1);
+  AddSamples({2, 0}, 3);
+  AddSamples({0}, 2);
+  AddSamples({3}, 4);
+  std::unique_ptr<FlameGraph> flame_graph = CreateFlameGraph();
+
+  EXPECT_EQ(flame_graph->GetTotalSampleCount(), 10);
+  EXPECT_EQ(flame_graph->GetMaxDepth(), 3);
+
+  // The node for all the threads of the process is left out in favor of the thread.
+  const std::vector<FlameGraph::Frame>& frames = flame_graph->GetFrames();
+  ASSERT_EQ(frames.size(), 5);
+  EXPECT_EQ(frames[0].name, "thread [42]");
+  EXPECT_EQ(frames[0].depth, 0);
+  EXPECT_EQ(frames[0].sample_count, 10);
+  EXPECT_EQ(frames[0].end_index, 5);
+
+  EXPECT_EQ(frames[1].name, "function 0");
+  EXPECT_EQ(frames[1].depth, 1);
+  EXPECT_EQ(frames[1].first_sample, 0);
+  EXPECT_EQ(frames[1].sample_count, 6);
+  EXPECT_EQ(frames[1].end_index, 4);
+
+  EXPECT_EQ(frames[2].name, "function 2");
+  EXPECT_EQ(frames[2].depth, 2);
+  EXPECT_EQ(frames[2].first_sample, 0);
+  EXPECT_EQ(frames[2].sample_count, 3);
+
+  EXPECT_EQ(frames[3].name, "function 1");
+  EXPECT_EQ(frames[3].first_sample, 3);
+  EXPECT_EQ(frames[3].sample_count, 1);
+
+  EXPECT_EQ(frames[4].name, "function 3");
+  EXPECT_EQ(frames[4].depth, 1);
+  EXPECT_EQ(frames[4].first_sample, 6);
+  EXPECT_EQ(frames[4].end_index, 5);
+}
+
+TEST_F(FlameGraphTest, NarrowFramesAreSkippedWithTheirSubtrees) {
+  AddSamples({1, 0}, 1);
+  AddSamples({2, 0}, 3);
+  AddSamples({3}, 6);
+  std::unique_ptr<FlameGraph> flame_graph = CreateFlameGraph();
+
+  std::vector<VisibleFrame> visible_frames = GetVisibleFrames(*flame_graph, 0.);
+  ASSERT_EQ(visible_frames.size(), 5);
+
+  visible_frames = GetVisibleFrames(*flame_graph, 0.35);
+  ASSERT_EQ(visible_frames.size(), 3);
+  EXPECT_EQ(visible_frames[0].name, "thread [42]");
+  EXPECT_DOUBLE_EQ(visible_frames[0].width, 1.);
+  EXPECT_EQ(visible_frames[1].name, "function 3");
+  EXPECT_DOUBLE_EQ(visible_frames[1].x, 0.);
+  EXPECT_DOUBLE_EQ(visible_frames[1].width, 0.6);
+  EXPECT_EQ(visible_frames[2].name, "function 0");
+  EXPECT_DOUBLE_EQ(visible_frames[2].x, 0.6);
+  EXPECT_DOUBLE_EQ(visible_frames[2].width, 0.4);
+}
+
+TEST_F(FlameGraphTest, ZoomingStretchesTheSubtreeOfTheFrame) {
+  AddSamples({1, 0}, 1);
+  AddSamples({2, 0}, 3);
+  AddSamples({3}, 6);
+  std::unique_ptr<FlameGraph> flame_graph = CreateFlameGraph();
+  const std::vector<FlameGraph::Frame>& frames = flame_graph->GetFrames();
+  ASSERT_EQ(frames.size(), 5);
+  ASSERT_EQ(frames[2].name, "function 0");
+
+  flame_graph->ZoomToFrame(2);
+  EXPECT_EQ(flame_graph->GetZoomedFrameIndex(), 2);
+  std::vector<VisibleFrame> visible_frames = GetVisibleFrames(*flame_graph, 0.);
+  ASSERT_EQ(visible_frames.size(), 4);
+  EXPECT_EQ(visible_frames[0].name, "thread [42]");
+  EXPECT_DOUBLE_EQ(visible_frames[0].x, 0.);
+  EXPECT_DOUBLE_EQ(visible_frames[0].width, 1.);
+  EXPECT_EQ(visible_frames[1].name, "function 0");
+  EXPECT_DOUBLE_EQ(visible_frames[1].width, 1.);
+  EXPECT_EQ(visible_frames[2].name, "function 2");
+  EXPECT_DOUBLE_EQ(visible_frames[2].x, 0.);
+  EXPECT_DOUBLE_EQ(visible_frames[2].width, 0.75);
+  EXPECT_EQ(visible_frames[3].name, "function 1");
+  EXPECT_DOUBLE_EQ(visible_frames[3].x, 0.75);
+  EXPECT_DOUBLE_EQ(visible_frames[3].width, 0.25);
+
+  flame_graph->ResetZoom();
+  EXPECT_EQ(flame_graph->GetZoomedFrameIndex(), std::nullopt);
+  EXPECT_EQ(GetVisibleFrames(*flame_graph, 0.).size(), 5);
+}
+
+TEST_F(FlameGraphTest, SearchIgnoresCaseAndCountsNestedMatchesOnce) {
+  AddSamples({1, 0}, 1);
+  AddSamples({2, 0}, 3);
+  AddSamples({1, 3}, 6);
+  std::unique_ptr<FlameGraph> flame_graph = CreateFlameGraph();
+
+  flame_graph->SetSearchString("FUNCTION 1");
+  uint64_t matching_frame_count = 0;
+  for (const FlameGraph::Frame& frame : flame_graph->GetFrames()) {
+    if (frame.matches_search) ++matching_frame_count;
+  }
+  EXPECT_EQ(matching_frame_count, 2);
+  EXPECT_EQ(flame_graph->GetMatchingSampleCount(), 7);
+
+  // The samples are counted once, although all of their frames match.
+  flame_graph->SetSearchString("function");
+  EXPECT_EQ(flame_graph->GetMatchingSampleCount(), 10);
+
+  flame_graph->SetSearchString("");
+  EXPECT_EQ(flame_graph->GetMatchingSampleCount(), 0);
+  for (const FlameGraph::Frame& frame : flame_graph->GetFrames()) {
+    EXPECT_FALSE(frame.matches_search);
+  }
+}
+
+}  // namespace orbit_gl
@@ -0,0 +1,195 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FlameGraphWindow.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_replace.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "App.h"
+#include "Batcher.h"
+#include "CallTreeView.h"
+#include "Geometry.h"
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Append.h"
+#include "OrbitBase/Logging.h"
+#include "TextRenderer.h"
+#include "TimeGraph.h"
+
+using orbit_gl::FlameGraph;
+
+namespace {
+constexpr float kFrameHeight = 20.f;
+constexpr float kFrameSpacing = 1.f;
+constexpr float kTextOffset = 4.f;
+constexpr uint32_t kFontSize = 14;
+// Frames narrower than this are not drawn, and their names only for frames wider than the
+// minimum text width.
+constexpr float kMinFrameWidth = 1.f;
+constexpr float kMinTextWidth = 20.f;
+const Color kSearchMatchColor(255, 0, 255, 255);
+const Color kTextColor(255, 255, 255, 255);
+
+const std::string kMenuActionResetZoom = "Reset zoom";
+
+[[nodiscard]] std::string EscapeHtml(const std::string& text) {
+  return absl::StrReplaceAll(text, {{"&", "&amp;"}, {"<", "&lt;"}, {">", "&gt;"}});
+}
+}  // namespace
+
+void FlameGraphWindow::SetFlameGraph(std::unique_ptr<FlameGraph> flame_graph) {
+  flame_graph_ = std::move(flame_graph);
+  if (flame_graph_ != nullptr) flame_graph_->SetSearchString(search_string_);
+  viewport_.SetWorldTopLeftY(viewport_.GetWorldMin()[1]);
+  RequestRedraw();
+}
+
+void FlameGraphWindow::SetSearchString(const std::string& search_string) {
+  search_string_ = search_string;
+  if (flame_graph_ != nullptr) flame_graph_->SetSearchString(search_string_);
+  RequestRedraw();
+}
+
+void FlameGraphWindow::MouseMoved(int x, int y, bool /*left*/, bool /*right*/, bool /*middle*/) {
+  // Unlike GlCanvas, this doesn't pan with the left button, which zooms to the frame clicked.
+  mouse_move_pos_screen_ = Vec2i(x, y);
+  ResetHoverTimer();
+  RequestRedraw();
+}
+
+void FlameGraphWindow::MouseWheelMoved(int x, int y, int delta, bool ctrl) {
+  constexpr float kScrolledFrameCount = 3.f;
+  const float scroll = (delta > 0 ? 1.f : -1.f) * kScrolledFrameCount * kFrameHeight;
+  viewport_.SetWorldTopLeftY(viewport_.GetWorldTopLeft()[1] + scroll);
+  GlCanvas::MouseWheelMoved(x, y, delta, ctrl);
+}
+
+std::vector<std::string> FlameGraphWindow::GetContextMenu() {
+  if (flame_graph_ == nullptr || !flame_graph_->GetZoomedFrameIndex().has_value()) return {};
+  return {kMenuActionResetZoom};
+}
+
+void FlameGraphWindow::OnContextMenu(const std::string& action, int /*menu_index*/) {
+  if (action == kMenuActionResetZoom && flame_graph_ != nullptr) {
+    flame_graph_->ResetZoom();
+    RequestRedraw();
+  }
+}
+
+void FlameGraphWindow::Draw(bool /*viewport_was_dirty*/) {
+  ORBIT_SCOPE("FlameGraphWindow::Draw");
+
+  DrawSummary();
+  if (flame_graph_ != nullptr) DrawFrames();
+
+  std::vector<float> all_layers = ui_batcher_.GetLayers();
+  orbit_base::Append(all_layers, text_renderer_.GetLayers());
+  std::sort(all_layers.begin(), all_layers.end());
+  auto it = std::unique(all_layers.begin(), all_layers.end());
+  all_layers.resize(std::distance(all_layers.begin(), it));
+
+  for (float layer : all_layers) {
+    PrepareWorldSpaceViewport();
+    ui_batcher_.DrawLayer(layer, picking_mode_ != PickingMode::kNone);
+
+    PrepareScreenSpaceViewport();
+    // Text needs to be drawn in screen space.
+    if (picking_mode_ == PickingMode::kNone) {
+      text_renderer_.RenderLayer(layer);
+    }
+  }
+}
+
+void FlameGraphWindow::DrawSummary() {
+  std::string summary;
+  if (flame_graph_ == nullptr || flame_graph_->GetTotalSampleCount() == 0) {
+    summary = "No samples";
+  } else {
+    const uint64_t total_sample_count = flame_graph_->GetTotalSampleCount();
+    summary = absl::StrFormat("%u samples", total_sample_count);
+    if (!search_string_.empty()) {
+      const uint64_t matching_sample_count = flame_graph_->GetMatchingSampleCount();
+      summary += absl::StrFormat(", %u (%.2f%%) matching \"%s\"", matching_sample_count,
+                                 100.f * matching_sample_count / total_sample_count,
+                                 search_string_);
+    }
+    if (flame_graph_->GetZoomedFrameIndex().has_value()) {
+      summary += " - right-click to reset the zoom";
+    }
+  }
+
+  const float y = viewport_.GetWorldMin()[1] - kFrameHeight + kTextOffset;
+  text_renderer_.AddText(summary.c_str(), viewport_.GetWorldMin()[0] + kTextOffset, y,
+                         GlCanvas::kZValueTextUi, kTextColor, kFontSize);
+}
+
+void FlameGraphWindow::DrawFrames() {
+  const float graph_width = viewport_.GetVisibleWorldWidth();
+  // The first row is taken by the summary.
+  const float graph_height = (flame_graph_->GetMaxDepth() + 1) * kFrameHeight;
+  viewport_.SetWorldExtents(graph_width, std::max(graph_height, viewport_.GetVisibleWorldHeight()));
+  const Vec2& world_min = viewport_.GetWorldMin();
+
+  const std::vector<FlameGraph::Frame>& frames = flame_graph_->GetFrames();
+  flame_graph_->ForEachVisibleFrame(
+      kMinFrameWidth / graph_width, [&](size_t frame_index, double x, double width) {
+        const FlameGraph::Frame& frame = frames[frame_index];
+        const Vec2 pos(world_min[0] + static_cast<float>(x) * graph_width,
+                       world_min[1] - (frame.depth + 2) * kFrameHeight);
+        const Vec2 size(std::max(static_cast<float>(width) * graph_width - kFrameSpacing,
+                                 kMinFrameWidth),
+                        kFrameHeight - kFrameSpacing);
+        const Color color =
+            frame.matches_search ? kSearchMatchColor : TimeGraph::GetColor(frame.name);
+
+        PickingUserData user_data{nullptr, [this, frame_index](PickingId /*id*/) {
+                                    return GetFrameTooltip(frame_index);
+                                  }};
+        user_data.custom_data_ = &frame;
+        ui_batcher_.AddBox(Box(pos, size, GlCanvas::kZValueBox), color, std::move(user_data));
+
+        if (size[0] >= kMinTextWidth) {
+          text_renderer_.AddText(frame.name.c_str(), pos[0] + kTextOffset, pos[1] + kTextOffset,
+                                 GlCanvas::kZValueTextUi, kTextColor, kFontSize,
+                                 size[0] - 2 * kTextOffset);
+        }
+      });
+}
+
+std::string FlameGraphWindow::GetFrameTooltip(size_t frame_index) const {
+  if (flame_graph_ == nullptr || frame_index >= flame_graph_->GetFrames().size()) return "";
+  const FlameGraph::Frame& frame = flame_graph_->GetFrames()[frame_index];
+  const uint64_t total_sample_count = flame_graph_->GetTotalSampleCount();
+
+  std::string tooltip = absl::StrFormat("<b>%s</b><br/>", EscapeHtml(frame.name));
+  if (auto* function = dynamic_cast<const CallTreeFunction*>(frame.node); function != nullptr) {
+    tooltip += absl::StrFormat("<i>%s</i><br/>", EscapeHtml(function->GetModuleName()));
+  }
+  tooltip += absl::StrFormat("<br/>Inclusive: %.2f%% (%u)<br/>Exclusive: %.2f%% (%u)",
+                             frame.node->GetInclusivePercent(total_sample_count),
+                             frame.node->sample_count(),
+                             frame.node->GetExclusivePercent(total_sample_count),
+                             frame.node->GetExclusiveSampleCount());
+  return tooltip + "<br/><br/><i>Click to zoom to the frame</i>";
+}
+
+void FlameGraphWindow::HandlePickedElement(PickingMode picking_mode, PickingId picking_id,
+                                           int /*x*/, int /*y*/) {
+  if (flame_graph_ == nullptr || picking_id.batcher_id != BatcherId::kUi) return;
+  const PickingUserData* user_data = ui_batcher_.GetUserData(picking_id);
+  if (user_data == nullptr) return;
+
+  if (picking_mode == PickingMode::kClick) {
+    if (user_data->custom_data_ == nullptr) return;
+    const auto* frame = static_cast<const FlameGraph::Frame*>(user_data->custom_data_);
+    flame_graph_->ZoomToFrame(static_cast<size_t>(frame - flame_graph_->GetFrames().data()));
+    RequestRedraw();
+  } else if (picking_mode == PickingMode::kHover) {
+    if (!user_data->generate_tooltip_) return;
+    app_->SendTooltipToUi(user_data->generate_tooltip_(picking_id));
+  }
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_FLAME_GRAPH_WINDOW_H_
+#define ORBIT_GL_FLAME_GRAPH_WINDOW_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FlameGraph.h"
+#include "GlCanvas.h"
+#include "PickingManager.h"
+
+class OrbitApp;
+
+// Draws a FlameGraph with the Batcher and the TextRenderer of the canvas. The graph is drawn top
+// down, below a line that summarizes the samples. Clicking a frame zooms to it, the context menu
+// resets the zoom, and the mouse wheel scrolls deep graphs. The frames whose name contains the
+// search string are highlighted.
+class FlameGraphWindow : public GlCanvas {
+ public:
+  explicit FlameGraphWindow(OrbitApp* app) : app_{app} {}
+
+  // Replacing the flame graph resets the zoom, while the search is applied to the new graph.
+  void SetFlameGraph(std::unique_ptr<orbit_gl::FlameGraph> flame_graph);
+  void ClearFlameGraph() { SetFlameGraph(nullptr); }
+  void SetSearchString(const std::string& search_string);
+
+  void MouseMoved(int x, int y, bool left, bool right, bool middle) override;
+  void MouseWheelMoved(int x, int y, int delta, bool ctrl) override;
+
+  [[nodiscard]] std::vector<std::string> GetContextMenu() override;
+  void OnContextMenu(const std::string& action, int menu_index) override;
+
+ protected:
+  void Draw(bool viewport_was_dirty) override;
+
+ private:
+  void DrawSummary();
+  void DrawFrames();
+  [[nodiscard]] std::string GetFrameTooltip(size_t frame_index) const;
+  void HandlePickedElement(PickingMode picking_mode, PickingId picking_id, int x, int y) override;
+
+  OrbitApp* app_;
+  std::unique_ptr<orbit_gl::FlameGraph> flame_graph_;
+  std::string search_string_;
+};
+
+#endif  // ORBIT_GL_FLAME_GRAPH_WINDOW_H_
@@ -5,10 +5,12 @@
 #include "FrameTrack.h"
 
 #include <GteVector.h>
+#include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
 #include <absl/time/time.h>
 
 #include <algorithm>
+#include <optional>
 #include <utility>
 
 #include "Batcher.h"
@@ -33,7 +35,7 @@ constexpr const float kBoxHeightMultiplier = 3.f;
 }  // namespace
 
 float FrameTrack::GetMaximumScaleFactor() const {
-  if (stats_.average_time_ns() == 0) {
+  if (stats().average_time_ns() == 0) {
     return 0.f;
   }
   // Compute the scale factor in double first as we convert time values in nanoseconds to
@@ -41,7 +43,7 @@ float FrameTrack::GetMaximumScaleFactor() const {
   // represent all integer values up to 2^24 - 1, which given the ns time unit is fairly
   // small (only ~16ms).
   double scale_factor =
-      static_cast<double>(stats_.max_ns()) / static_cast<double>(stats_.average_time_ns());
+      static_cast<double>(stats().max_ns()) / static_cast<double>(stats().average_time_ns());
   scale_factor = std::min(scale_factor, kHeightCapAverageMultipleDouble);
   return static_cast<float>(scale_factor);
 }
@@ -93,11 +95,11 @@ float FrameTrack::GetYFromTimer(const TimerInfo& /*timer_info*/) const {
 
 float FrameTrack::GetTextBoxHeight(const TimerInfo& timer_info) const {
   uint64_t timer_duration_ns = timer_info.end() - timer_info.start();
-  if (stats_.average_time_ns() == 0) {
+  if (stats().average_time_ns() == 0) {
     return 0.f;
   }
   double ratio =
-      static_cast<double>(timer_duration_ns) / static_cast<double>(stats_.average_time_ns());
+      static_cast<double>(timer_duration_ns) / static_cast<double>(stats().average_time_ns());
   ratio = std::min(ratio, kHeightCapAverageMultipleDouble);
   return static_cast<float>(ratio) * GetAverageBoxHeight();
 }
@@ -114,16 +116,16 @@ Color FrameTrack::GetTimerColor(const orbit_client_protos::TimerInfo& timer_info
   // A note on overflows here and below: The times in uint64_t represent durations of events
   // in nanoseconds. This means the maximum duration is ~600 years. That is, multiplying by values
   // in the single digits (and even much higher) as done here does not cause any issues.
-  if (timer_duration_ns >= kHeightCapAverageMultipleUint64 * stats_.average_time_ns()) {
+  if (timer_duration_ns >= kHeightCapAverageMultipleUint64 * stats().average_time_ns()) {
     color = warn_color;
-  } else if (stats_.average_time_ns() > 0) {
+  } else if (stats().average_time_ns() > 0) {
     // We are interpolating colors between min_color and max_color based on how much
     // the duration (timer_duration_ns) differs from the average. This is asymmetric on
     // purpose, as frames that are shorter than the average time are fine and do not need
     // to stand out differently from the average. Durations below lower_bound and
     // durations above upper_bound are drawn with min_color and max_color, respectively.
-    uint64_t lower_bound = 4 * stats_.average_time_ns() / 5;
-    uint64_t upper_bound = 8 * stats_.average_time_ns() / 5;
+    uint64_t lower_bound = 4 * stats().average_time_ns() / 5;
+    uint64_t upper_bound = 8 * stats().average_time_ns() / 5;
 
     timer_duration_ns = std::min(std::max(timer_duration_ns, lower_bound), upper_bound);
     float fraction = static_cast<float>(timer_duration_ns - lower_bound) /
@@ -143,19 +145,29 @@ Color FrameTrack::GetTimerColor(const orbit_client_protos::TimerInfo& timer_info
 }
 
 void FrameTrack::OnTimer(const TimerInfo& timer_info) {
-  uint64_t duration_ns = timer_info.end() - timer_info.start();
-  stats_.set_count(stats_.count() + 1);
-  stats_.set_total_time_ns(stats_.total_time_ns() + duration_ns);
-  stats_.set_average_time_ns(stats_.total_time_ns() / stats_.count());
+  frame_track_stats_.OnFrame({timer_info.start(), timer_info.end(), timer_info.user_data_key()});
+  TimerTrack::OnTimer(timer_info);
+}
 
-  if (duration_ns > stats_.max_ns()) {
-    stats_.set_max_ns(duration_ns);
-  }
-  if (stats_.min_ns() == 0 || duration_ns < stats_.min_ns()) {
-    stats_.set_min_ns(duration_ns);
+const orbit_client_data::TextBox* FrameTrack::FindLongestFrameTextBox(uint64_t frame_index) const {
+  const std::vector<orbit_gl::FrameTrackStats::Frame> longest_frames = GetLongestFrames();
+  auto frame_it = std::find_if(longest_frames.begin(), longest_frames.end(),
+                               [frame_index](const orbit_gl::FrameTrackStats::Frame& frame) {
+                                 return frame.frame_index == frame_index;
+                               });
+  if (frame_it == longest_frames.end()) return nullptr;
+
+  // All frames are at depth zero.
+  std::shared_ptr<orbit_client_data::TimerChain> chain = GetTimers(0);
+  if (chain == nullptr) return nullptr;
+  for (const auto& block : chain->GetBlocksInTimeRange(frame_it->start_ns, frame_it->end_ns)) {
+    if (!block.Intersects(frame_it->start_ns, frame_it->end_ns)) continue;
+    for (uint64_t i = 0; i < block.size(); ++i) {
+      const orbit_client_data::TextBox& box = block[i];
+      if (box.Start() == frame_it->start_ns && box.End() == frame_it->end_ns) return &box;
+    }
   }
-
-  TimerTrack::OnTimer(timer_info);
+  return nullptr;
 }
 
 void FrameTrack::SetTimesliceText(const TimerInfo& timer_info, float min_x, float z_offset,
@@ -182,7 +194,7 @@ void FrameTrack::SetTimesliceText(const TimerInfo& timer_info, float min_x, floa
 
 std::string FrameTrack::GetTooltip() const {
   const std::string& function_name = function_.function_name();
-  return absl::StrFormat(
+  std::string tooltip = absl::StrFormat(
       "<b>Frame track</b><br/>"
       "<i>Shows frame timings based on subsequent callst to %s. "
       "<br/><br/>"
@@ -201,9 +213,30 @@ std::string FrameTrack::GetTooltip() const {
       "<b>Average frame time:</b> %s<br/>",
       function_name, kHeightCapAverageMultipleUint64, function_name,
       orbit_client_data::function_utils::GetLoadedModuleNameByPath(function_.file_path()),
-      stats_.count(), orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats_.max_ns())),
-      orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats_.min_ns())),
-      orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats_.average_time_ns())));
+      stats().count(), orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats().max_ns())),
+      orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats().min_ns())),
+      orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats().average_time_ns())));
+
+  constexpr std::pair<const char*, double> kPercentiles[] = {
+      {"Median", 0.5}, {"90th percentile", 0.9}, {"99th percentile", 0.99}};
+  for (const auto& [label, percentile] : kPercentiles) {
+    std::optional<uint64_t> frame_time_ns = frame_track_stats_.GetFrameTimePercentileNs(percentile);
+    if (!frame_time_ns.has_value()) break;
+    absl::StrAppendFormat(
+        &tooltip, "<b>%s frame time:</b> %s<br/>", label,
+        orbit_display_formats::GetDisplayTime(absl::Nanoseconds(frame_time_ns.value())));
+  }
+
+  const std::vector<orbit_gl::FrameTrackStats::Frame> longest_frames = GetLongestFrames();
+  if (!longest_frames.empty()) {
+    absl::StrAppend(&tooltip, "<br/><b>Longest frames:</b><br/>");
+    for (const orbit_gl::FrameTrackStats::Frame& frame : longest_frames) {
+      absl::StrAppendFormat(
+          &tooltip, "Frame #%u: %s<br/>", frame.frame_index,
+          orbit_display_formats::GetDisplayTime(absl::Nanoseconds(frame.GetDurationNs())));
+    }
+  }
+  return tooltip;
 }
 
 std::string FrameTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) const {
@@ -227,8 +260,7 @@ std::string FrameTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) cons
       function_name, kHeightCapAverageMultipleUint64, function_name,
       orbit_client_data::function_utils::GetLoadedModuleNameByPath(function_.file_path()),
       text_box->GetTimerInfo().user_data_key(),
-      orbit_display_formats::GetDisplayTime(
-          TicksToDuration(text_box->GetTimerInfo().start(), text_box->GetTimerInfo().end())));
+      orbit_display_formats::GetDisplayTime(TicksToDuration(text_box->Start(), text_box->End())));
 }
 
 void FrameTrack::Draw(Batcher& batcher, TextRenderer& text_renderer, uint64_t current_mouse_time_ns,
@@ -245,7 +277,7 @@ void FrameTrack::Draw(Batcher& batcher, TextRenderer& text_renderer, uint64_t cu
   float text_z = GlCanvas::kZValueTrackText + z_offset;
 
   std::string avg_time =
-      orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats_.average_time_ns()));
+      orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats().average_time_ns()));
   std::string label = absl::StrFormat("Avg: %s", avg_time);
   uint32_t font_size = layout_->CalculateZoomedFontSize();
   float string_width = text_renderer.GetStringWidth(label.c_str(), font_size);
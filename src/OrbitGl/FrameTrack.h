@@ -15,6 +15,7 @@
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
 #include "CoreMath.h"
+#include "FrameTrackStats.h"
 #include "PickingManager.h"
 #include "TimerTrack.h"
 #include "Track.h"
@@ -39,6 +40,14 @@ class FrameTrack : public TimerTrack {
       const orbit_client_protos::TimerInfo& timer_info) const override;
   void OnTimer(const orbit_client_protos::TimerInfo& timer_info) override;
 
+  // The longest frames so far, longest first, see FrameTrackStats.
+  [[nodiscard]] std::vector<orbit_gl::FrameTrackStats::Frame> GetLongestFrames() const {
+    return frame_track_stats_.GetLongestFrames();
+  }
+  // Returns the box of the frame with index `frame_index` if it is one of the longest frames.
+  [[nodiscard]] const orbit_client_data::TextBox* FindLongestFrameTextBox(
+      uint64_t frame_index) const;
+
   [[nodiscard]] float GetTextBoxHeight(
       const orbit_client_protos::TimerInfo& timer_info) const override;
   [[nodiscard]] float GetHeaderHeight() const override;
@@ -65,9 +74,12 @@ class FrameTrack : public TimerTrack {
   [[nodiscard]] float GetMaximumScaleFactor() const;
   [[nodiscard]] float GetMaximumBoxHeight() const;
   [[nodiscard]] float GetAverageBoxHeight() const;
+  [[nodiscard]] const orbit_client_protos::FunctionStats& stats() const {
+    return frame_track_stats_.stats();
+  }
 
   orbit_grpc_protos::InstrumentedFunction function_;
-  orbit_client_protos::FunctionStats stats_;
+  orbit_gl::FrameTrackStats frame_track_stats_;
 };
 
 #endif  // ORBIT_GL_FRAME_TRACK_H_
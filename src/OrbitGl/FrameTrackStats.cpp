@@ -0,0 +1,50 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FrameTrackStats.h"
+
+#include <algorithm>
+
+#include "ClientData/FunctionStatsUtils.h"
+
+namespace orbit_gl {
+
+namespace {
+
+// The order of the heap: the "greatest" frame, which ends up at the front, is the shortest, and of
+// the frames of equal duration, the latest.
+[[nodiscard]] bool IsLonger(const FrameTrackStats::Frame& lhs, const FrameTrackStats::Frame& rhs) {
+  if (lhs.GetDurationNs() != rhs.GetDurationNs()) return lhs.GetDurationNs() > rhs.GetDurationNs();
+  return lhs.frame_index < rhs.frame_index;
+}
+
+}  // namespace
+
+void FrameTrackStats::OnFrame(const Frame& frame) {
+  orbit_client_data::AddFunctionCallToStats(frame.GetDurationNs(), &stats_);
+
+  if (num_longest_frames_ == 0) return;
+  if (longest_frames_heap_.size() < num_longest_frames_) {
+    longest_frames_heap_.push_back(frame);
+    std::push_heap(longest_frames_heap_.begin(), longest_frames_heap_.end(), IsLonger);
+    return;
+  }
+  if (!IsLonger(frame, longest_frames_heap_.front())) return;
+  std::pop_heap(longest_frames_heap_.begin(), longest_frames_heap_.end(), IsLonger);
+  longest_frames_heap_.back() = frame;
+  std::push_heap(longest_frames_heap_.begin(), longest_frames_heap_.end(), IsLonger);
+}
+
+std::optional<uint64_t> FrameTrackStats::GetFrameTimePercentileNs(double percentile) const {
+  if (stats_.count() == 0) return std::nullopt;
+  return orbit_client_data::GetDurationPercentileNs(stats_, percentile);
+}
+
+std::vector<FrameTrackStats::Frame> FrameTrackStats::GetLongestFrames() const {
+  std::vector<Frame> longest_frames = longest_frames_heap_;
+  std::sort(longest_frames.begin(), longest_frames.end(), IsLonger);
+  return longest_frames;
+}
+
+}  // namespace orbit_gl
@@ -0,0 +1,57 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_FRAME_TRACK_STATS_H_
+#define ORBIT_GL_FRAME_TRACK_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "capture_data.pb.h"
+
+namespace orbit_gl {
+
+// The distribution of the frame times of a frame track, updated frame by frame as the frames
+// arrive, so that the statistics never require going through all the frames again: a histogram of
+// the frame times, from which percentiles are estimated, and the longest frames (the "hitches").
+class FrameTrackStats {
+ public:
+  struct Frame {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t frame_index;
+    [[nodiscard]] uint64_t GetDurationNs() const { return end_ns - start_ns; }
+  };
+
+  static constexpr size_t kDefaultNumLongestFrames = 10;
+
+  explicit FrameTrackStats(size_t num_longest_frames = kDefaultNumLongestFrames)
+      : num_longest_frames_{num_longest_frames} {}
+
+  void OnFrame(const Frame& frame);
+
+  [[nodiscard]] const orbit_client_protos::FunctionStats& stats() const { return stats_; }
+  [[nodiscard]] uint64_t count() const { return stats_.count(); }
+
+  // Returns an estimate of the frame time that `percentile` (in [0, 1]) of the frames don't
+  // exceed, or std::nullopt if there are no frames yet.
+  [[nodiscard]] std::optional<uint64_t> GetFrameTimePercentileNs(double percentile) const;
+
+  // Returns the longest frames so far, longest first. Frames of equal duration are ordered by frame
+  // index.
+  [[nodiscard]] std::vector<Frame> GetLongestFrames() const;
+
+ private:
+  size_t num_longest_frames_;
+  orbit_client_protos::FunctionStats stats_;
+  // A min-heap of the longest frames so far, so that the shortest of them, the one to replace when
+  // a longer frame arrives, is at the front.
+  std::vector<Frame> longest_frames_heap_;
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_FRAME_TRACK_STATS_H_
@@ -0,0 +1,56 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "FrameTrackStats.h"
+
+namespace orbit_gl {
+
+TEST(FrameTrackStats, ComputesStatsIncrementally) {
+  FrameTrackStats frame_track_stats;
+  EXPECT_EQ(frame_track_stats.count(), 0);
+  EXPECT_FALSE(frame_track_stats.GetFrameTimePercentileNs(0.5).has_value());
+  EXPECT_TRUE(frame_track_stats.GetLongestFrames().empty());
+
+  uint64_t start_ns = 0;
+  for (uint64_t frame_index = 0; frame_index < 100; ++frame_index) {
+    const uint64_t duration_ns = frame_index == 42 ? 50'000'000 : 16'000'000;
+    frame_track_stats.OnFrame({start_ns, start_ns + duration_ns, frame_index});
+    start_ns += duration_ns;
+  }
+
+  EXPECT_EQ(frame_track_stats.count(), 100);
+  EXPECT_EQ(frame_track_stats.stats().min_ns(), 16'000'000);
+  EXPECT_EQ(frame_track_stats.stats().max_ns(), 50'000'000);
+  std::optional<uint64_t> median_ns = frame_track_stats.GetFrameTimePercentileNs(0.5);
+  ASSERT_TRUE(median_ns.has_value());
+  EXPECT_EQ(median_ns.value(), 16'000'000);
+  EXPECT_EQ(frame_track_stats.GetFrameTimePercentileNs(1.0), 50'000'000);
+}
+
+TEST(FrameTrackStats, KeepsTheLongestFramesLongestFirst) {
+  FrameTrackStats frame_track_stats{3};
+  const std::vector<uint64_t> durations_ns = {5, 1, 9, 3, 9, 7, 2};
+  uint64_t start_ns = 0;
+  for (uint64_t frame_index = 0; frame_index < durations_ns.size(); ++frame_index) {
+    frame_track_stats.OnFrame({start_ns, start_ns + durations_ns[frame_index], frame_index});
+    start_ns += durations_ns[frame_index];
+  }
+
+  std::vector<FrameTrackStats::Frame> longest_frames = frame_track_stats.GetLongestFrames();
+  ASSERT_EQ(longest_frames.size(), 3);
+  // Frames of equal duration are ordered by frame index.
+  EXPECT_EQ(longest_frames[0].frame_index, 2);
+  EXPECT_EQ(longest_frames[1].frame_index, 4);
+  EXPECT_EQ(longest_frames[2].frame_index, 5);
+  EXPECT_EQ(longest_frames[2].GetDurationNs(), 7);
+  EXPECT_EQ(longest_frames[2].start_ns, 27);
+}
+
+}  // namespace orbit_gl
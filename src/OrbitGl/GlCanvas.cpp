@@ -12,6 +12,7 @@
 #include "AccessibleInterfaceProvider.h"
 #include "App.h"
 #include "CaptureWindow.h"
+#include "FlameGraphWindow.h"
 #include "GlUtils.h"
 #include "ImGuiOrbit.h"
 #include "Introspection/Introspection.h"
@@ -98,6 +99,11 @@ std::unique_ptr<GlCanvas> GlCanvas::Create(CanvasType canvas_type, OrbitApp* app
       app->SetIntrospectionWindow(introspection_window.get());
       return introspection_window;
     }
+    case CanvasType::kFlameGraphWindow: {
+      auto flame_graph_window = std::make_unique<FlameGraphWindow>(app);
+      app->SetFlameGraphWindow(flame_graph_window.get());
+      return flame_graph_window;
+    }
     case CanvasType::kDebug:
       return std::make_unique<GlCanvas>();
     default:
@@ -278,6 +284,14 @@ void GlCanvas::Render(int width, int height) {
   PrepareGlState();
   PrepareWorldSpaceViewport();
 
+  // Only the pixel under the mouse is read from a picking pass, see Pick, so neither clearing nor
+  // rasterizing needs to touch any other pixel. CleanupGlState disables the scissor test again.
+  if (picking_mode_ != PickingMode::kNone) {
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(mouse_move_pos_screen_[0], viewport_.GetScreenHeight() - mouse_move_pos_screen_[1],
+              1, 1);
+  }
+
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   glBindTexture(GL_TEXTURE_2D, 0);
@@ -36,7 +36,7 @@ class GlCanvas : public orbit_gl::AccessibleInterfaceProvider {
   explicit GlCanvas();
   virtual ~GlCanvas();
 
-  enum class CanvasType { kCaptureWindow, kIntrospectionWindow, kDebug };
+  enum class CanvasType { kCaptureWindow, kIntrospectionWindow, kFlameGraphWindow, kDebug };
   static std::unique_ptr<GlCanvas> Create(CanvasType canvas_type, OrbitApp* app);
 
   void Resize(int width, int height);
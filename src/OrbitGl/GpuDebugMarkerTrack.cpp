@@ -11,6 +11,7 @@
 
 #include "App.h"
 #include "Batcher.h"
+#include "CaptureClient/CaptureEventProcessor.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
 #include "DisplayFormats/DisplayFormats.h"
@@ -23,8 +24,47 @@
 #include "TriangleToggle.h"
 #include "absl/strings/str_format.h"
 
+using orbit_capture_client::CaptureEventProcessor;
 using orbit_client_protos::TimerInfo;
 
+namespace {
+
+[[nodiscard]] std::string GetPipelineStatisticsTooltip(const TimerInfo& timer_info) {
+  using EncodingIndex = CaptureEventProcessor::GpuPipelineStatisticsEncodingIndex;
+  if (timer_info.registers_size() != static_cast<int>(EncodingIndex::kEnd)) {
+    return "";
+  }
+  auto get_register = [&timer_info](EncodingIndex index) {
+    return timer_info.registers(static_cast<size_t>(index));
+  };
+  return absl::StrFormat(
+      "<br/><br/><b>Pipeline statistics:</b><br/>"
+      "Input assembly vertices: %u<br/>"
+      "Input assembly primitives: %u<br/>"
+      "Vertex shader invocations: %u<br/>"
+      "Geometry shader invocations: %u<br/>"
+      "Geometry shader primitives: %u<br/>"
+      "Clipping invocations: %u<br/>"
+      "Clipping primitives: %u<br/>"
+      "Fragment shader invocations: %u<br/>"
+      "Tessellation control shader patches: %u<br/>"
+      "Tessellation evaluation shader invocations: %u<br/>"
+      "Compute shader invocations: %u",
+      get_register(EncodingIndex::kInputAssemblyVertices),
+      get_register(EncodingIndex::kInputAssemblyPrimitives),
+      get_register(EncodingIndex::kVertexShaderInvocations),
+      get_register(EncodingIndex::kGeometryShaderInvocations),
+      get_register(EncodingIndex::kGeometryShaderPrimitives),
+      get_register(EncodingIndex::kClippingInvocations),
+      get_register(EncodingIndex::kClippingPrimitives),
+      get_register(EncodingIndex::kFragmentShaderInvocations),
+      get_register(EncodingIndex::kTessellationControlShaderPatches),
+      get_register(EncodingIndex::kTessellationEvaluationShaderInvocations),
+      get_register(EncodingIndex::kComputeShaderInvocations));
+}
+
+}  // namespace
+
 GpuDebugMarkerTrack::GpuDebugMarkerTrack(CaptureViewElement* parent, TimeGraph* time_graph,
                                          orbit_gl::Viewport* viewport, TimeGraphLayout* layout,
                                          OrbitApp* app,
@@ -64,7 +104,7 @@ Color GpuDebugMarkerTrack::GetTimerColor(const TimerInfo& timer_info, bool is_se
                  static_cast<uint8_t>(timer_info.color().blue()),
                  static_cast<uint8_t>(timer_info.color().alpha()));
   }
-  std::string marker_text = string_manager_->Get(timer_info.user_data_key()).value_or("");
+  std::string marker_text{string_manager_->Get(timer_info.user_data_key()).value_or("")};
   return TimeGraph::GetColor(marker_text);
 }
 
@@ -101,7 +141,7 @@ std::string GpuDebugMarkerTrack::GetBoxTooltip(const Batcher& batcher, PickingId
   const TimerInfo& timer_info = text_box->GetTimerInfo();
   CHECK(timer_info.type() == TimerInfo::kGpuDebugMarker);
 
-  std::string marker_text = string_manager_->Get(timer_info.user_data_key()).value_or("");
+  std::string_view marker_text = string_manager_->Get(timer_info.user_data_key()).value_or("");
   return absl::StrFormat(
       "<b>Vulkan Debug Marker</b><br/>"
       "<i>At the marker's begin and end `vkCmdWriteTimestamp`s have been "
@@ -112,11 +152,12 @@ std::string GpuDebugMarkerTrack::GetBoxTooltip(const Batcher& batcher, PickingId
       "<b>Marker text:</b> %s<br/>"
       "<b>Submitted from process:</b> %s [%d]<br/>"
       "<b>Submitted from thread:</b> %s [%d]<br/>"
-      "<b>Time:</b> %s",
+      "<b>Time:</b> %s%s",
       marker_text, capture_data_->GetThreadName(timer_info.process_id()), timer_info.process_id(),
       capture_data_->GetThreadName(timer_info.thread_id()), timer_info.thread_id(),
       orbit_display_formats::GetDisplayTime(TicksToDuration(timer_info.start(), timer_info.end()))
-          .c_str());
+          .c_str(),
+      GetPipelineStatisticsTooltip(timer_info));
 }
 
 float GpuDebugMarkerTrack::GetYFromTimer(const TimerInfo& timer_info) const {
@@ -99,7 +99,7 @@ Color GpuSubmissionTrack::GetTimerColor(const TimerInfo& timer_info, bool is_sel
   // We disambiguate the different types of GPU activity based on the
   // string that is displayed on their timeslice.
   float coeff = 1.0f;
-  std::string gpu_stage = string_manager_->Get(timer_info.user_data_key()).value_or("");
+  std::string_view gpu_stage = string_manager_->Get(timer_info.user_data_key()).value_or("");
   if (gpu_stage == kSwQueueString) {
     coeff = 0.5f;
   } else if (gpu_stage == kHwQueueString) {
@@ -153,7 +153,7 @@ float GpuSubmissionTrack::GetYFromTimer(const TimerInfo& timer_info) const {
 // When track or its parent is collapsed, only draw "hardware execution" timers.
 bool GpuSubmissionTrack::TimerFilter(const TimerInfo& timer_info) const {
   if (ShouldShowCollapsed()) {
-    std::string gpu_stage = string_manager_->Get(timer_info.user_data_key()).value_or("");
+    std::string_view gpu_stage = string_manager_->Get(timer_info.user_data_key()).value_or("");
     return gpu_stage == kHwExecutionString;
   }
   return true;
@@ -221,11 +221,11 @@ const orbit_client_data::TextBox* GpuSubmissionTrack::GetRight(
 
 std::string GpuSubmissionTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) const {
   const orbit_client_data::TextBox* text_box = batcher.GetTextBox(id);
-  if ((text_box == nullptr) || text_box->GetTimerInfo().type() == TimerInfo::kCoreActivity) {
+  if ((text_box == nullptr) || text_box->GetPackedTimerInfo().type() == TimerInfo::kCoreActivity) {
     return "";
   }
 
-  std::string gpu_stage =
+  std::string_view gpu_stage =
       string_manager_->Get(text_box->GetTimerInfo().user_data_key()).value_or("");
   if (gpu_stage == kSwQueueString) {
     return GetSwQueueTooltip(text_box->GetTimerInfo());
@@ -9,9 +9,12 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
+#include <string_view>
 
 #include "App.h"
 #include "Batcher.h"
+#include "ClientData/PackedTimerInfo.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
 #include "ClientModel/CaptureData.h"
@@ -23,6 +26,7 @@
 #include "TriangleToggle.h"
 #include "Viewport.h"
 
+using orbit_client_data::PackedTimerInfo;
 using orbit_client_protos::TimerInfo;
 
 namespace orbit_gl {
@@ -62,8 +66,9 @@ GpuTrack::GpuTrack(CaptureViewElement* parent, TimeGraph* time_graph, orbit_gl::
                                                           capture_data, indentation_level + 1)} {
   timeline_hash_ = timeline_hash;
 
-  std::string timeline =
-      app->GetStringManager()->Get(timeline_hash).value_or(std::to_string(timeline_hash));
+  std::optional<std::string_view> timeline_name = app->GetStringManager()->Get(timeline_hash);
+  std::string timeline = timeline_name.has_value() ? std::string{timeline_name.value()}
+                                                   : std::to_string(timeline_hash);
   std::string label = orbit_gl::MapGpuTimelineToTrackLabel(timeline);
   SetName(timeline);
   SetLabel(label);
@@ -217,7 +222,7 @@ std::string GpuTrack::GetTooltip() const {
 
 const orbit_client_data::TextBox* GpuTrack::GetLeft(
     const orbit_client_data::TextBox* textbox) const {
-  const TimerInfo& timer_info = textbox->GetTimerInfo();
+  const PackedTimerInfo& timer_info = textbox->GetPackedTimerInfo();
   switch (timer_info.type()) {
     case TimerInfo::kGpuActivity:
       [[fallthrough]];
@@ -232,7 +237,7 @@ const orbit_client_data::TextBox* GpuTrack::GetLeft(
 
 const orbit_client_data::TextBox* GpuTrack::GetRight(
     const orbit_client_data::TextBox* textbox) const {
-  const TimerInfo& timer_info = textbox->GetTimerInfo();
+  const PackedTimerInfo& timer_info = textbox->GetPackedTimerInfo();
   switch (timer_info.type()) {
     case TimerInfo::kGpuActivity:
       [[fallthrough]];
@@ -246,7 +251,7 @@ const orbit_client_data::TextBox* GpuTrack::GetRight(
 }
 
 const orbit_client_data::TextBox* GpuTrack::GetUp(const orbit_client_data::TextBox* textbox) const {
-  const TimerInfo& timer_info = textbox->GetTimerInfo();
+  const PackedTimerInfo& timer_info = textbox->GetPackedTimerInfo();
   switch (timer_info.type()) {
     case TimerInfo::kGpuActivity:
       [[fallthrough]];
@@ -261,7 +266,7 @@ const orbit_client_data::TextBox* GpuTrack::GetUp(const orbit_client_data::TextB
 
 const orbit_client_data::TextBox* GpuTrack::GetDown(
     const orbit_client_data::TextBox* textbox) const {
-  const TimerInfo& timer_info = textbox->GetTimerInfo();
+  const PackedTimerInfo& timer_info = textbox->GetPackedTimerInfo();
   switch (timer_info.type()) {
     case TimerInfo::kGpuActivity:
       [[fallthrough]];
@@ -7,11 +7,13 @@
 #include <GteVector.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
 #include <cstdint>
 #include <iterator>
 #include <numeric>
+#include <optional>
 
 #include "Geometry.h"
 #include "GlCanvas.h"
@@ -255,6 +257,30 @@ void GraphTrack<Dimension>::DrawLegend(Batcher& batcher, TextRenderer& text_rend
 template <size_t Dimension>
 void GraphTrack<Dimension>::DrawSeries(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                        float z) {
+  // With more entries than pixels, each pixel shows the highest values of the entries it covers.
+  std::optional<absl::Span<const typename MultivariateTimeSeries<Dimension>::Envelope>> envelopes =
+      series_.GetEnvelopesInTimeRange(min_tick, max_tick, viewport_->GetScreenWidth());
+  if (envelopes.has_value()) {
+    double min = GetGraphMinValue();
+    double inverse_value_range = GetInverseOfGraphValueRange();
+    for (size_t i = 0; i < envelopes->size(); ++i) {
+      const auto& envelope = (*envelopes)[i];
+      std::array<float, Dimension> normalized_cumulative_values;
+      std::transform(envelope.max_cumulative_values.begin(), envelope.max_cumulative_values.end(),
+                     normalized_cumulative_values.begin(),
+                     [min, inverse_value_range](double value) {
+                       return static_cast<float>((value - min) * inverse_value_range);
+                     });
+      uint64_t start_time = std::max(envelope.start_time_ns, min_tick);
+      uint64_t end_time =
+          i + 1 < envelopes->size() ? (*envelopes)[i + 1].start_time_ns : envelope.end_time_ns;
+      end_time = std::min(end_time, max_tick);
+      if (start_time >= end_time) continue;
+      DrawSingleSeriesEntry(batcher, start_time, end_time, normalized_cumulative_values, z);
+    }
+    return;
+  }
+
   auto entries_affected_range_result = series_.GetEntriesAffectedByTimeRange(min_tick, max_tick);
   if (!entries_affected_range_result.has_value()) return;
 
@@ -0,0 +1,226 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "InstancedBoxRenderer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <string>
+
+#include "Batcher.h"
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+
+namespace {
+
+// The locations of the vertex attributes, bound before linking the program.
+enum AttributeLocation : GLuint {
+  kCorner = 0,
+  kPosition,
+  kSize,
+  kColor0,
+  kColor1,
+  kColor2,
+  kColor3,
+  kPickingColor,
+  kAttributeCount
+};
+
+// The corners of the quad in the order of Box::vertices, so that corner `i` takes color `i`.
+constexpr float kCorners[] = {0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f, 0.f};
+
+// GLSL 1.20 and the fixed-function matrices, so that the boxes are transformed like the lines and
+// triangles that are still drawn from client-side arrays.
+const GLchar* const kVertexShader =
+    "#version 120\n"
+    "attribute vec2 corner;\n"
+    "attribute vec3 position;\n"
+    "attribute vec2 size;\n"
+    "attribute vec4 color0;\n"
+    "attribute vec4 color1;\n"
+    "attribute vec4 color2;\n"
+    "attribute vec4 color3;\n"
+    "attribute vec4 picking_color;\n"
+    "uniform bool picking;\n"
+    "varying vec4 frag_color;\n"
+    "void main() {\n"
+    "  gl_Position =\n"
+    "      gl_ModelViewProjectionMatrix * vec4(position.xy + corner * size, position.z, 1.0);\n"
+    "  if (picking) {\n"
+    "    frag_color = picking_color;\n"
+    "  } else if (corner.x < 0.5) {\n"
+    "    frag_color = corner.y < 0.5 ? color0 : color1;\n"
+    "  } else {\n"
+    "    frag_color = corner.y < 0.5 ? color3 : color2;\n"
+    "  }\n"
+    "}\n";
+
+const GLchar* const kFragmentShader =
+    "#version 120\n"
+    "varying vec4 frag_color;\n"
+    "void main() {\n"
+    "  gl_FragColor = frag_color;\n"
+    "}\n";
+
+[[nodiscard]] GLuint CompileShader(GLenum type, const GLchar* source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status == GL_TRUE) return shader;
+
+  GLint log_length = 0;
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+  std::string log(std::max(log_length, 1), '\0');
+  glGetShaderInfoLog(shader, log_length, nullptr, log.data());
+  ERROR("Compiling box shader: %s", log);
+  glDeleteShader(shader);
+  return 0;
+}
+
+}  // namespace
+
+InstancedBoxRenderer::~InstancedBoxRenderer() {
+  if (state_ != State::kReady) return;
+  for (auto& [unused_layer, layer_buffer] : layer_buffers_) {
+    glDeleteBuffers(1, &layer_buffer.id);
+  }
+  glDeleteBuffers(1, &corner_buffer_);
+  glDeleteProgram(program_);
+}
+
+bool InstancedBoxRenderer::Initialize() {
+  // Instanced arrays are core since OpenGL 3.3.
+  if (!GLAD_GL_VERSION_3_3) return false;
+
+  GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, kVertexShader);
+  GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, kFragmentShader);
+  if (vertex_shader == 0 || fragment_shader == 0) {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return false;
+  }
+
+  program_ = glCreateProgram();
+  glAttachShader(program_, vertex_shader);
+  glAttachShader(program_, fragment_shader);
+  glBindAttribLocation(program_, kCorner, "corner");
+  glBindAttribLocation(program_, kPosition, "position");
+  glBindAttribLocation(program_, kSize, "size");
+  glBindAttribLocation(program_, kColor0, "color0");
+  glBindAttribLocation(program_, kColor1, "color1");
+  glBindAttribLocation(program_, kColor2, "color2");
+  glBindAttribLocation(program_, kColor3, "color3");
+  glBindAttribLocation(program_, kPickingColor, "picking_color");
+  glLinkProgram(program_);
+  // The shaders are only flagged for deletion, they are deleted with the program.
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program_, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    ERROR("Linking box shader program");
+    glDeleteProgram(program_);
+    return false;
+  }
+  picking_uniform_location_ = glGetUniformLocation(program_, "picking");
+
+  glGenBuffers(1, &corner_buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER, corner_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kCorners), kCorners, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+void InstancedBoxRenderer::Upload(const BoxBuffer& box_buffer, LayerBuffer* layer_buffer) {
+  ORBIT_SCOPE_FUNCTION;
+  staging_instances_.clear();
+  staging_instances_.reserve(box_buffer.boxes_.size());
+
+  // A block of colors holds the four colors of each box of the block of boxes at the same position.
+  const auto* box_block = box_buffer.boxes_.root();
+  const auto* color_block = box_buffer.colors_.root();
+  const auto* picking_color_block = box_buffer.picking_colors_.root();
+  while (box_block != nullptr) {
+    for (uint32_t i = 0; i < box_block->size(); ++i) {
+      const Box& box = box_block->data()[i];
+      BoxInstance& instance = staging_instances_.emplace_back();
+      instance.position[0] = box.vertices[0][0];
+      instance.position[1] = box.vertices[0][1];
+      instance.position[2] = box.vertices[0][2];
+      instance.size[0] = box.vertices[2][0] - box.vertices[0][0];
+      instance.size[1] = box.vertices[2][1] - box.vertices[0][1];
+      std::copy_n(color_block->data() + 4 * i, 4, instance.colors);
+      instance.picking_color = picking_color_block->data()[4 * i];
+    }
+    box_block = box_block->next();
+    color_block = color_block->next();
+    picking_color_block = picking_color_block->next();
+  }
+
+  if (layer_buffer->id == 0) glGenBuffers(1, &layer_buffer->id);
+  glBindBuffer(GL_ARRAY_BUFFER, layer_buffer->id);
+  const size_t size = staging_instances_.size() * sizeof(BoxInstance);
+  if (size > layer_buffer->capacity) {
+    // Grow geometrically, so that the buffer is only reallocated a few times.
+    layer_buffer->capacity = std::max(size, 2 * layer_buffer->capacity);
+    glBufferData(GL_ARRAY_BUFFER, layer_buffer->capacity, nullptr, GL_DYNAMIC_DRAW);
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, staging_instances_.data());
+  layer_buffer->instance_count = static_cast<uint32_t>(staging_instances_.size());
+  layer_buffer->uploaded_generation = box_buffer.generation_;
+}
+
+bool InstancedBoxRenderer::Draw(float layer, const BoxBuffer& box_buffer, bool picking) {
+  if (state_ == State::kUninitialized) {
+    state_ = Initialize() ? State::kReady : State::kUnsupported;
+  }
+  if (state_ != State::kReady) return false;
+
+  LayerBuffer& layer_buffer = layer_buffers_[layer];
+  if (layer_buffer.uploaded_generation != box_buffer.generation_) {
+    Upload(box_buffer, &layer_buffer);
+  }
+  if (layer_buffer.instance_count == 0) return true;
+
+  glUseProgram(program_);
+  glUniform1i(picking_uniform_location_, picking ? 1 : 0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, corner_buffer_);
+  glEnableVertexAttribArray(kCorner);
+  glVertexAttribPointer(kCorner, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+  glBindBuffer(GL_ARRAY_BUFFER, layer_buffer.id);
+  const auto set_instance_attribute = [](GLuint location, GLint size, GLenum type,
+                                         GLboolean normalized, size_t offset) {
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, size, type, normalized, sizeof(BoxInstance),
+                          reinterpret_cast<const void*>(offset));  // NOLINT
+    glVertexAttribDivisor(location, 1);
+  };
+  set_instance_attribute(kPosition, 3, GL_FLOAT, GL_FALSE, offsetof(BoxInstance, position));
+  set_instance_attribute(kSize, 2, GL_FLOAT, GL_FALSE, offsetof(BoxInstance, size));
+  for (GLuint i = 0; i < 4; ++i) {
+    set_instance_attribute(kColor0 + i, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                           offsetof(BoxInstance, colors) + i * sizeof(Color));
+  }
+  set_instance_attribute(kPickingColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                         offsetof(BoxInstance, picking_color));
+
+  glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, layer_buffer.instance_count);
+
+  // Other renderers, e.g., the one of ImGui, use the same generic attributes without divisors, and
+  // the client-side arrays of Batcher need no buffer to be bound.
+  for (GLuint location = 0; location < kAttributeCount; ++location) {
+    glVertexAttribDivisor(location, 0);
+    glDisableVertexAttribArray(location);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUseProgram(0);
+  return true;
+}
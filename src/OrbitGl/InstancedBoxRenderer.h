@@ -0,0 +1,67 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_INSTANCED_BOX_RENDERER_H_
+#define ORBIT_GL_INSTANCED_BOX_RENDERER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "CoreMath.h"
+
+struct BoxBuffer;
+
+// Draws the boxes of the BoxBuffers of a Batcher with a shader, as instances of a single quad, from
+// vertex buffers that live on the GPU. One instance holds the position, size, colors and picking
+// color of a box, a fifth of the data of its four vertices, and is only uploaded again when the
+// boxes of its layer changed, e.g., not for the picking pass or for redraws while hovering.
+//
+// All boxes are assumed to be axis-aligned, as the ones created by Batcher are.
+//
+// Needs the OpenGL context of the Batcher to be current for all calls, including the destructor.
+class InstancedBoxRenderer {
+ public:
+  InstancedBoxRenderer() = default;
+  ~InstancedBoxRenderer();
+  InstancedBoxRenderer(const InstancedBoxRenderer&) = delete;
+  InstancedBoxRenderer& operator=(const InstancedBoxRenderer&) = delete;
+
+  // Returns false, without drawing anything, if the OpenGL context doesn't support instanced
+  // drawing or the shaders could not be built. The caller then needs to draw the boxes itself.
+  [[nodiscard]] bool Draw(float layer, const BoxBuffer& box_buffer, bool picking);
+
+ private:
+  struct BoxInstance {
+    float position[3];
+    float size[2];
+    Color colors[4];
+    Color picking_color;
+  };
+  static_assert(sizeof(Color) == 4);
+
+  struct LayerBuffer {
+    uint32_t id = 0;
+    size_t capacity = 0;
+    uint32_t instance_count = 0;
+    std::optional<uint64_t> uploaded_generation;
+  };
+
+  enum class State { kUninitialized, kReady, kUnsupported };
+
+  [[nodiscard]] bool Initialize();
+  void Upload(const BoxBuffer& box_buffer, LayerBuffer* layer_buffer);
+
+  State state_ = State::kUninitialized;
+  uint32_t program_ = 0;
+  uint32_t corner_buffer_ = 0;
+  int32_t picking_uniform_location_ = -1;
+  std::unordered_map<float, LayerBuffer> layer_buffers_;
+  std::vector<BoxInstance> staging_instances_;
+};
+
+#endif  // ORBIT_GL_INSTANCED_BOX_RENDERER_H_
@@ -5,10 +5,12 @@
 #include "LineGraphTrack.h"
 
 #include <GteVector.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
 #include <cstdint>
 #include <iterator>
+#include <optional>
 
 #include "Geometry.h"
 #include "TextRenderer.h"
@@ -47,15 +49,36 @@ float LineGraphTrack<Dimension>::GetLabelYFromValues(
 template <size_t Dimension>
 void LineGraphTrack<Dimension>::DrawSeries(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                            float z) {
+  double min = this->GetGraphMinValue();
+  double inverse_value_range = this->GetInverseOfGraphValueRange();
+
+  // With more entries than pixels, each pixel shows the range of values of the entries it covers.
+  std::optional<absl::Span<const typename MultivariateTimeSeries<Dimension>::Envelope>> envelopes =
+      this->series_.GetEnvelopesInTimeRange(min_tick, max_tick,
+                                            this->viewport_->GetScreenWidth());
+  if (envelopes.has_value()) {
+    for (size_t i = 0; i < envelopes->size(); ++i) {
+      const auto& envelope = (*envelopes)[i];
+      uint64_t start_time = std::max(envelope.start_time_ns, min_tick);
+      // The last values hold until the next entry, or until the end of the time range.
+      uint64_t end_time = i + 1 < envelopes->size() ? (*envelopes)[i + 1].start_time_ns : max_tick;
+      end_time = std::min(end_time, max_tick);
+      if (start_time >= end_time) continue;
+      DrawSingleSeriesEnvelope(batcher, start_time, end_time,
+                               GetNormalizedValues(envelope.min_values, min, inverse_value_range),
+                               GetNormalizedValues(envelope.max_values, min, inverse_value_range),
+                               GetNormalizedValues(envelope.last_values, min, inverse_value_range),
+                               z);
+    }
+    return;
+  }
+
   auto entries_affected_range_result =
       this->series_.GetEntriesAffectedByTimeRange(min_tick, max_tick);
   if (!entries_affected_range_result.has_value()) return;
 
   typename MultivariateTimeSeries<Dimension>::Range& entries{entries_affected_range_result.value()};
 
-  double min = this->GetGraphMinValue();
-  double inverse_value_range = this->GetInverseOfGraphValueRange();
-
   auto current_iterator = entries.start_inclusive;
   uint64_t current_time = current_iterator->first;
   std::array<float, Dimension> current_normalized_values =
@@ -111,6 +134,26 @@ void LineGraphTrack<Dimension>::DrawSingleSeriesEntry(
   }
 }
 
+template <size_t Dimension>
+void LineGraphTrack<Dimension>::DrawSingleSeriesEnvelope(
+    Batcher* batcher, uint64_t start_tick, uint64_t end_tick,
+    const std::array<float, Dimension>& normalized_min_values,
+    const std::array<float, Dimension>& normalized_max_values,
+    const std::array<float, Dimension>& normalized_last_values, float z) {
+  float x0 = this->time_graph_->GetWorldFromTick(start_tick);
+  float x1 = this->time_graph_->GetWorldFromTick(end_tick);
+  float content_height = this->GetGraphContentHeight();
+  float base_y = this->GetGraphContentBaseY();
+
+  for (size_t i = Dimension; i-- > 0;) {
+    float y_min = base_y + normalized_min_values[i] * content_height;
+    float y_max = base_y + normalized_max_values[i] * content_height;
+    float y_last = base_y + normalized_last_values[i] * content_height;
+    batcher->AddLine(Vec2(x0, y_min), Vec2(x0, y_max), z, this->GetColor(i));
+    batcher->AddLine(Vec2(x0, y_last), Vec2(x1, y_last), z, this->GetColor(i));
+  }
+}
+
 template class LineGraphTrack<1>;
 template class LineGraphTrack<2>;
 template class LineGraphTrack<3>;
@@ -34,6 +34,13 @@ class LineGraphTrack : public GraphTrack<Dimension> {
                                      const std::array<float, Dimension>& current_normalized_values,
                                      const std::array<float, Dimension>& next_normalized_values,
                                      float z, bool is_last);
+  // Draws the values of the entries of an envelope (see MultivariateTimeSeries::Envelope) between
+  // its start time, `start_tick`, and the start of the next envelope, `end_tick`.
+  virtual void DrawSingleSeriesEnvelope(Batcher* batcher, uint64_t start_tick, uint64_t end_tick,
+                                        const std::array<float, Dimension>& normalized_min_values,
+                                        const std::array<float, Dimension>& normalized_max_values,
+                                        const std::array<float, Dimension>& normalized_last_values,
+                                        float z);
 };
 
 }  // namespace orbit_gl
@@ -7,6 +7,8 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/flags/flag.h>
+#include <absl/strings/match.h>
+#include <absl/strings/numbers.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
 #include <absl/time/time.h>
@@ -15,14 +17,18 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
+#include <utility>
 
 #include "App.h"
+#include "ClientData/FunctionStatsUtils.h"
 #include "ClientData/FunctionUtils.h"
 #include "ClientModel/CaptureData.h"
 #include "CompareAscendingOrDescending.h"
 #include "DataViews/DataViewType.h"
 #include "DataViews/FunctionsDataView.h"
 #include "DisplayFormats/DisplayFormats.h"
+#include "FrameTrackStats.h"
 #include "GrpcProtos/Constants.h"
 #include "LiveFunctionsController.h"
 #include "OrbitBase/Append.h"
@@ -58,6 +64,9 @@ const std::vector<orbit_data_views::DataView::Column>& LiveFunctionsDataView::Ge
     columns[kColumnTimeAvg] = {"Avg", .075f, SortingOrder::kDescending};
     columns[kColumnTimeMin] = {"Min", .075f, SortingOrder::kDescending};
     columns[kColumnTimeMax] = {"Max", .075f, SortingOrder::kDescending};
+    columns[kColumnTimeP50] = {"P50", .075f, SortingOrder::kDescending};
+    columns[kColumnTimeP95] = {"P95", .075f, SortingOrder::kDescending};
+    columns[kColumnTimeP99] = {"P99", .075f, SortingOrder::kDescending};
     columns[kColumnModule] = {"Module", .1f, SortingOrder::kAscending};
     columns[kColumnAddress] = {"Address", .0f, SortingOrder::kAscending};
     return columns;
@@ -92,6 +101,14 @@ std::string LiveFunctionsDataView::GetValue(int row, int column) {
       return orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats.min_ns()));
     case kColumnTimeMax:
       return orbit_display_formats::GetDisplayTime(absl::Nanoseconds(stats.max_ns()));
+    case kColumnTimeP50:
+    case kColumnTimeP95:
+    case kColumnTimeP99: {
+      std::optional<uint64_t> percentile_ns =
+          orbit_client_data::GetDurationPercentileNs(stats, GetPercentileOfColumn(column));
+      if (!percentile_ns.has_value()) return "";
+      return orbit_display_formats::GetDisplayTime(absl::Nanoseconds(percentile_ns.value()));
+    }
     case kColumnModule:
       return function.module_path();
     case kColumnAddress:
@@ -125,6 +142,19 @@ void LiveFunctionsDataView::OnSelect(const std::vector<int>& rows) {
   UpdateSelectedFunctionId();
 }
 
+double LiveFunctionsDataView::GetPercentileOfColumn(int column) {
+  switch (column) {
+    case kColumnTimeP50:
+      return 0.5;
+    case kColumnTimeP95:
+      return 0.95;
+    case kColumnTimeP99:
+      return 0.99;
+    default:
+      UNREACHABLE();
+  }
+}
+
 #define ORBIT_FUNC_SORT(Member)                                                                   \
   [&](uint64_t a, uint64_t b) {                                                                   \
     return orbit_gl::CompareAscendingOrDescending(functions.at(a).Member, functions.at(b).Member, \
@@ -174,6 +204,25 @@ void LiveFunctionsDataView::DoSort() {
     case kColumnTimeMax:
       sorter = ORBIT_STAT_SORT(max_ns());
       break;
+    case kColumnTimeP50:
+    case kColumnTimeP95:
+    case kColumnTimeP99: {
+      // Computing a percentile walks the histogram, so do it once per function and not per
+      // comparison. Functions without histogram sort as if their percentile was zero.
+      const double percentile = GetPercentileOfColumn(sorting_column_);
+      absl::flat_hash_map<uint64_t, uint64_t> percentile_ns_by_function_id;
+      for (uint64_t function_id : indices_) {
+        percentile_ns_by_function_id[function_id] =
+            orbit_client_data::GetDurationPercentileNs(
+                app_->GetCaptureData().GetFunctionStatsOrDefault(function_id), percentile)
+                .value_or(0);
+      }
+      sorter = [percentiles = std::move(percentile_ns_by_function_id), ascending](uint64_t a,
+                                                                                    uint64_t b) {
+        return orbit_gl::CompareAscendingOrDescending(percentiles.at(a), percentiles.at(b),
+                                                      ascending);
+      };
+    } break;
     case kColumnModule:
       sorter = ORBIT_CUSTOM_FUNC_SORT(orbit_client_data::function_utils::GetLoadedModuleName);
       break;
@@ -200,6 +249,8 @@ const std::string LiveFunctionsDataView::kMenuActionIterate = "Add iterator(s)";
 const std::string LiveFunctionsDataView::kMenuActionEnableFrameTrack = "Enable frame track(s)";
 const std::string LiveFunctionsDataView::kMenuActionDisableFrameTrack = "Disable frame track(s)";
 const std::string LiveFunctionsDataView::kMenuActionSourceCode = "Go to Source code";
+const std::string LiveFunctionsDataView::kMenuActionJumpToFrameHitchPrefix =
+    "Jump to frame hitch: frame #";
 
 std::vector<std::string> LiveFunctionsDataView::GetContextMenu(
     int clicked_index, const std::vector<int>& selected_indices) {
@@ -261,6 +312,12 @@ std::vector<std::string> LiveFunctionsDataView::GetContextMenu(
       menu.insert(menu.end(), {kMenuActionJumpToFirst, kMenuActionJumpToLast, kMenuActionJumpToMin,
                                kMenuActionJumpToMax});
     }
+    for (const orbit_gl::FrameTrackStats::Frame& frame :
+         app_->GetLongestFrames(instrumented_function_id)) {
+      menu.emplace_back(absl::StrFormat(
+          "%s%u (%s)", kMenuActionJumpToFrameHitchPrefix, frame.frame_index,
+          orbit_display_formats::GetDisplayTime(absl::Nanoseconds(frame.GetDurationNs()))));
+    }
   }
   orbit_base::Append(menu, DataView::GetContextMenu(clicked_index, selected_indices));
   return menu;
@@ -307,6 +364,14 @@ void LiveFunctionsDataView::OnContextMenu(const std::string& action, int menu_in
     CHECK(item_indices.size() == 1);
     uint64_t function_id = GetInstrumentedFunctionId(item_indices[0]);
     app_->JumpToTextBoxAndZoom(function_id, OrbitApp::JumpToTextBoxMode::kMax);
+  } else if (absl::StartsWith(action, kMenuActionJumpToFrameHitchPrefix)) {
+    CHECK(item_indices.size() == 1);
+    const size_t frame_index_begin = kMenuActionJumpToFrameHitchPrefix.size();
+    const std::string frame_index_text =
+        action.substr(frame_index_begin, action.find(' ', frame_index_begin) - frame_index_begin);
+    uint64_t frame_index = 0;
+    CHECK(absl::SimpleAtoi(frame_index_text, &frame_index));
+    app_->JumpToLongestFrameAndZoom(GetInstrumentedFunctionId(item_indices[0]), frame_index);
   } else if (action == kMenuActionIterate) {
     for (int i : item_indices) {
       uint64_t instrumented_function_id = GetInstrumentedFunctionId(i);
@@ -408,7 +473,8 @@ void LiveFunctionsDataView::OnDataChanged() {
       return;
     }
 
-    if (orbit_client_data::function_utils::IsOrbitFunctionFromName(function_info->pretty_name())) {
+    if (orbit_client_data::function_utils::IsOrbitFunctionFromName(
+            orbit_client_data::function_utils::GetDisplayName(*function_info))) {
       continue;
     }
 
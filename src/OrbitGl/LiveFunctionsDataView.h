@@ -44,7 +44,7 @@ class LiveFunctionsDataView : public orbit_data_views::DataView {
   void OnTimer() override;
   void OnRefresh(const std::vector<int>& visible_selected_indices,
                  const RefreshMode& mode) override;
-  [[nodiscard]] bool ResetOnRefresh() const override { return false; }
+  [[nodiscard]] bool RestoreSelectionOnRefresh() const override { return false; }
   std::optional<int> GetRowFromFunctionId(uint64_t function_id);
 
  protected:
@@ -70,6 +70,9 @@ class LiveFunctionsDataView : public orbit_data_views::DataView {
     kColumnTimeAvg,
     kColumnTimeMin,
     kColumnTimeMax,
+    kColumnTimeP50,
+    kColumnTimeP95,
+    kColumnTimeP99,
     kColumnModule,
     kColumnAddress,
     kNumColumns
@@ -86,8 +89,14 @@ class LiveFunctionsDataView : public orbit_data_views::DataView {
   static const std::string kMenuActionIterate;
   static const std::string kMenuActionEnableFrameTrack;
   static const std::string kMenuActionDisableFrameTrack;
+  // Followed by the frame index and the frame time, one entry per frame hitch, i.e., per frame of
+  // the longest frames of the frame track of the function.
+  static const std::string kMenuActionJumpToFrameHitchPrefix;
 
  private:
+  // The percentile, in [0, 1], that one of the percentile columns shows.
+  [[nodiscard]] static double GetPercentileOfColumn(int column);
+
   orbit_metrics_uploader::MetricsUploader* metrics_uploader_;
 
   // TODO(b/185090791): This is temporary and will be removed once this data view has been ported
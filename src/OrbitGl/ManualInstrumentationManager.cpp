@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/meta/type_traits.h>
+#include <absl/strings/str_cat.h>
 #include <absl/synchronization/mutex.h>
 #include <stddef.h>
 
@@ -75,7 +76,7 @@ void ManualInstrumentationManager::ProcessStringEvent(const orbit_api::Event& ev
   const uint64_t event_id = event.data;
   auto result = string_manager_.Get(event_id);
   if (result.has_value()) {
-    string_manager_.AddOrReplace(event_id, result.value() + event.name);
+    string_manager_.AddOrReplace(event_id, absl::StrCat(result.value(), event.name));
   } else {
     string_manager_.AddOrReplace(event_id, event.name);
   }
@@ -31,7 +31,7 @@ class ManualInstrumentationManager {
   void ProcessAsyncTimer(const orbit_client_protos::TimerInfo& timer_info);
   void ProcessStringEvent(const orbit_api::Event& event);
   [[nodiscard]] std::string GetString(uint32_t id) const {
-    return string_manager_.Get(id).value_or("");
+    return std::string{string_manager_.Get(id).value_or("")};
   }
   [[nodiscard]] static orbit_api::Event ApiEventFromTimerInfo(
       const orbit_client_protos::TimerInfo& timer_info);
@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <cstdint>
 #include <functional>
+#include <map>
+#include <memory>
 
 #include "App.h"
 #include "ClientData/ProcessData.h"
@@ -203,10 +205,10 @@ void ModulesDataView::DoFilter() {
 void ModulesDataView::UpdateModules(const ProcessData* process) {
   start_address_to_module_.clear();
   start_address_to_module_in_memory_.clear();
-  auto memory_map = process->GetMemoryMapCopy();
-  indices_.resize(memory_map.size());
+  std::shared_ptr<const std::map<uint64_t, ModuleInMemory>> memory_map = process->GetMemoryMap();
+  indices_.resize(memory_map->size());
   size_t index = 0;
-  for (const auto& [start_address, module_in_memory] : memory_map) {
+  for (const auto& [start_address, module_in_memory] : *memory_map) {
     ModuleData* module = app_->GetMutableModuleByPathAndBuildId(module_in_memory.file_path(),
                                                                 module_in_memory.build_id());
     start_address_to_module_.insert_or_assign(start_address, module);
@@ -5,10 +5,16 @@
 #ifndef ORBIT_GL_MULTIVARIATE_TIME_SERIES_H_
 #define ORBIT_GL_MULTIVARIATE_TIME_SERIES_H_
 
+#include <absl/types/span.h>
+
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <map>
+#include <numeric>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 
@@ -35,6 +41,13 @@ class MultivariateTimeSeries {
   [[nodiscard]] std::string GetValueUnit() const { return value_unit_; }
 
   void AddValues(uint64_t timestamp_ns, const std::array<double, Dimension>& values) {
+    // Values are usually added in time order, which only extends the envelopes. Otherwise, they
+    // are rebuilt the next time they are needed.
+    if (!envelopes_outdated_ && (IsEmpty() || timestamp_ns > EndTimeInNs())) {
+      AddToEnvelopes(timestamp_ns, values);
+    } else {
+      envelopes_outdated_ = true;
+    }
     time_to_series_values_[timestamp_ns] = values;
     for (double value : values) {
       UpdateMinAndMax(value);
@@ -96,18 +109,110 @@ class MultivariateTimeSeries {
     return Range{first_iterator, last_iterator};
   }
 
+  // The minimum and maximum values of consecutive entries, to draw series with many more entries
+  // than pixels without going through all of them.
+  struct Envelope {
+    uint64_t start_time_ns;
+    uint64_t end_time_ns;
+    std::array<double, Dimension> min_values;
+    std::array<double, Dimension> max_values;
+    // The maximum of the sums of the values of the first i + 1 series, for stacked graphs.
+    std::array<double, Dimension> max_cumulative_values;
+    // The values of the entry at `end_time_ns`.
+    std::array<double, Dimension> last_values;
+  };
+  // Each envelope of level 0 covers this many entries, and each envelope of level `i + 1` this
+  // many envelopes of level `i`.
+  static constexpr size_t kEnvelopeFanOut = 8;
+
+  // Returns the envelopes overlapping [min_time, max_time], in time order, from the coarsest level
+  // that still has at least `min_envelope_count` of them in this time range, e.g., the number of
+  // pixels the time range is drawn on. Returns std::nullopt if even level 0 has fewer, in which
+  // case there are no more than `kEnvelopeFanOut * min_envelope_count` entries in the time range.
+  [[nodiscard]] std::optional<absl::Span<const Envelope>> GetEnvelopesInTimeRange(
+      uint64_t min_time, uint64_t max_time, size_t min_envelope_count) const {
+    if (envelopes_outdated_) RebuildEnvelopes();
+    for (size_t level = envelope_levels_.size(); level-- > 0;) {
+      const std::vector<Envelope>& envelopes = envelope_levels_[level];
+      auto begin = std::partition_point(
+          envelopes.begin(), envelopes.end(),
+          [min_time](const Envelope& envelope) { return envelope.end_time_ns < min_time; });
+      auto end = std::partition_point(
+          begin, envelopes.end(),
+          [max_time](const Envelope& envelope) { return envelope.start_time_ns <= max_time; });
+      if (static_cast<size_t>(end - begin) >= min_envelope_count && begin != end) {
+        return absl::MakeConstSpan(&*begin, end - begin);
+      }
+    }
+    return std::nullopt;
+  }
+
  private:
   void UpdateMinAndMax(double value) {
     max_ = std::max(max_, value);
     min_ = std::min(min_, value);
   }
 
+  [[nodiscard]] static Envelope CreateEnvelope(uint64_t timestamp_ns,
+                                               const std::array<double, Dimension>& values) {
+    std::array<double, Dimension> cumulative_values;
+    std::partial_sum(values.begin(), values.end(), cumulative_values.begin());
+    return Envelope{timestamp_ns, timestamp_ns, values, values, cumulative_values, values};
+  }
+
+  static void MergeIntoEnvelope(const Envelope& later_envelope, Envelope* envelope) {
+    envelope->end_time_ns = later_envelope.end_time_ns;
+    for (size_t i = 0; i < Dimension; ++i) {
+      envelope->min_values[i] = std::min(envelope->min_values[i], later_envelope.min_values[i]);
+      envelope->max_values[i] = std::max(envelope->max_values[i], later_envelope.max_values[i]);
+      envelope->max_cumulative_values[i] =
+          std::max(envelope->max_cumulative_values[i], later_envelope.max_cumulative_values[i]);
+    }
+    envelope->last_values = later_envelope.last_values;
+  }
+
+  // Adds an entry later than all the others to the envelopes of all levels. A level is added when
+  // the level below gets its second envelope, so that the top level always has a single one.
+  void AddToEnvelopes(uint64_t timestamp_ns, const std::array<double, Dimension>& values) const {
+    const Envelope entry_envelope = CreateEnvelope(timestamp_ns, values);
+    size_t entries_per_envelope = 1;
+    for (size_t level = 0;; ++level) {
+      if (level == envelope_levels_.size()) {
+        if (level > 0 && envelope_entry_count_ < entries_per_envelope) break;
+        envelope_levels_.emplace_back();
+        if (level > 0) envelope_levels_[level].push_back(envelope_levels_[level - 1].front());
+      }
+      entries_per_envelope *= kEnvelopeFanOut;
+      std::vector<Envelope>& envelopes = envelope_levels_[level];
+      if (envelope_entry_count_ % entries_per_envelope == 0) {
+        envelopes.push_back(entry_envelope);
+      } else {
+        MergeIntoEnvelope(entry_envelope, &envelopes.back());
+      }
+    }
+    ++envelope_entry_count_;
+  }
+
+  void RebuildEnvelopes() const {
+    envelope_levels_.clear();
+    envelope_entry_count_ = 0;
+    for (const auto& [timestamp_ns, values] : time_to_series_values_) {
+      AddToEnvelopes(timestamp_ns, values);
+    }
+    envelopes_outdated_ = false;
+  }
+
   std::array<std::string, Dimension> series_names_;
   std::map<uint64_t, std::array<double, Dimension>> time_to_series_values_;
   double min_ = std::numeric_limits<double>::max();
   double max_ = std::numeric_limits<double>::lowest();
   std::optional<uint8_t> value_decimal_digits_ = std::nullopt;
   std::string value_unit_;
+
+  // The envelopes are built lazily after values were added out of order, hence mutable.
+  mutable std::vector<std::vector<Envelope>> envelope_levels_;
+  mutable size_t envelope_entry_count_ = 0;
+  mutable bool envelopes_outdated_ = false;
 };
 
 #endif  // ORBIT_GL_MULTIVARIATE_TIME_SERIES_H_
@@ -133,4 +133,65 @@ TEST(MultivariateTimeSeries, GetEntriesAffectedByTimeRange) {
   }
 }
 
+TEST(MultivariateTimeSeries, GetEnvelopesInTimeRange) {
+  MultivariateTimeSeries<2> series = MultivariateTimeSeries<2>({"Series A", "Series B"});
+  constexpr uint64_t kEntryCount = 1000;
+  for (uint64_t i = 0; i < kEntryCount; ++i) {
+    series.AddValues(i * 10, {static_cast<double>(i % 100), 1.0});
+  }
+
+  // Few envelopes are needed: the coarsest level has a single envelope for all the entries.
+  auto coarsest = series.GetEnvelopesInTimeRange(0, kEntryCount * 10, 1);
+  ASSERT_TRUE(coarsest.has_value());
+  ASSERT_EQ(coarsest->size(), 1);
+  EXPECT_EQ(coarsest->front().start_time_ns, 0);
+  EXPECT_EQ(coarsest->front().end_time_ns, (kEntryCount - 1) * 10);
+  EXPECT_EQ(coarsest->front().min_values[0], 0);
+  EXPECT_EQ(coarsest->front().max_values[0], 99);
+  EXPECT_EQ(coarsest->front().max_cumulative_values[1], 100);
+  EXPECT_EQ(coarsest->front().last_values[0], 99);
+
+  // Level 0 covers kEnvelopeFanOut entries per envelope.
+  constexpr size_t kFanOut = MultivariateTimeSeries<2>::kEnvelopeFanOut;
+  auto finest = series.GetEnvelopesInTimeRange(0, kEntryCount * 10, kEntryCount / kFanOut);
+  ASSERT_TRUE(finest.has_value());
+  ASSERT_EQ(finest->size(), kEntryCount / kFanOut);
+  EXPECT_EQ((*finest)[1].start_time_ns, kFanOut * 10);
+  EXPECT_EQ((*finest)[1].end_time_ns, (2 * kFanOut - 1) * 10);
+  EXPECT_EQ((*finest)[1].min_values[0], kFanOut);
+  EXPECT_EQ((*finest)[1].max_values[0], 2 * kFanOut - 1);
+
+  // Only the envelopes overlapping the time range are returned.
+  auto partial = series.GetEnvelopesInTimeRange(kFanOut * 10 + 5, 3 * kFanOut * 10 - 5, 2);
+  ASSERT_TRUE(partial.has_value());
+  ASSERT_EQ(partial->size(), 2);
+  EXPECT_EQ((*partial)[0].start_time_ns, kFanOut * 10);
+
+  // Level 0 doesn't have as many envelopes, so the entries are to be drawn one by one.
+  EXPECT_FALSE(series.GetEnvelopesInTimeRange(0, kEntryCount * 10, kEntryCount).has_value());
+}
+
+TEST(MultivariateTimeSeries, GetEnvelopesInTimeRangeAfterAddingValuesOutOfOrder) {
+  MultivariateTimeSeries<1> series = MultivariateTimeSeries<1>({"Series A"});
+  constexpr size_t kFanOut = MultivariateTimeSeries<1>::kEnvelopeFanOut;
+  for (uint64_t i = 0; i < 2 * kFanOut; ++i) {
+    series.AddValues(1000 - i, {static_cast<double>(i)});
+  }
+
+  auto envelopes = series.GetEnvelopesInTimeRange(0, 1000, 2);
+  ASSERT_TRUE(envelopes.has_value());
+  ASSERT_EQ(envelopes->size(), 2);
+  EXPECT_EQ((*envelopes)[0].start_time_ns, 1000 - 2 * kFanOut + 1);
+  EXPECT_EQ((*envelopes)[0].max_values[0], 2 * kFanOut - 1);
+  EXPECT_EQ((*envelopes)[0].last_values[0], kFanOut);
+  EXPECT_EQ((*envelopes)[1].end_time_ns, 1000);
+  EXPECT_EQ((*envelopes)[1].last_values[0], 0);
+
+  // Overwriting a value is taken into account, too.
+  series.AddValues(1000, {-1.0});
+  envelopes = series.GetEnvelopesInTimeRange(0, 1000, 2);
+  ASSERT_TRUE(envelopes.has_value());
+  EXPECT_EQ((*envelopes)[1].min_values[0], -1.0);
+}
+
 }  // namespace orbit_gl
\ No newline at end of file
@@ -0,0 +1,72 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PmuCountersTrack.h"
+
+#include <absl/strings/str_format.h>
+
+#include "CaptureClient/CaptureEventProcessor.h"
+
+namespace orbit_gl {
+
+namespace {
+
+using orbit_capture_client::CaptureEventProcessor;
+
+const std::array<std::string, kPmuCountersTrackDimension> kSeriesName = {
+    "Instructions per cycle", "LLC misses per 1000 instructions",
+    "Branch misses per 1000 instructions"};
+
+}  // namespace
+
+PmuCountersTrack::PmuCountersTrack(CaptureViewElement* parent, TimeGraph* time_graph,
+                                   orbit_gl::Viewport* viewport, TimeGraphLayout* layout,
+                                   int32_t thread_id,
+                                   const orbit_client_model::CaptureData* capture_data)
+    : LineGraphTrack<kPmuCountersTrackDimension>(
+          parent, time_graph, viewport, layout,
+          absl::StrFormat("PMU Counters [%d]", thread_id), kSeriesName, capture_data) {
+  thread_id_ = thread_id;
+
+  constexpr uint8_t kTrackValueDecimalDigits = 2;
+  SetNumberOfDecimalDigits(kTrackValueDecimalDigits);
+
+  // Colors are selected from https://convertingcolors.com/list/avery.html.
+  const std::array<Color, kPmuCountersTrackDimension> kPmuCountersTrackColors{
+      Color(87, 166, 74, 255),  // green
+      Color(231, 68, 53, 255),  // red
+      Color(246, 196, 0, 255)   // orange
+  };
+  SetSeriesColors(kPmuCountersTrackColors);
+}
+
+std::string PmuCountersTrack::GetTooltip() const {
+  return absl::StrFormat(
+      "Shows the instructions per cycle, and the last-level cache misses and branch misses per "
+      "1000 instructions of thread %d, measured in user space between consecutive samples.",
+      thread_id_);
+}
+
+void PmuCountersTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
+  auto get_register = [&timer_info](CaptureEventProcessor::PmuCountersEncodingIndex index) {
+    return static_cast<double>(timer_info.registers(static_cast<size_t>(index)));
+  };
+  double cycles = get_register(CaptureEventProcessor::PmuCountersEncodingIndex::kCycles);
+  double instructions =
+      get_register(CaptureEventProcessor::PmuCountersEncodingIndex::kInstructions);
+  double llc_misses = get_register(CaptureEventProcessor::PmuCountersEncodingIndex::kLlcMisses);
+  double branch_misses =
+      get_register(CaptureEventProcessor::PmuCountersEncodingIndex::kBranchMisses);
+  // The thread hasn't executed any code in user space in this interval.
+  if (cycles == 0 || instructions == 0) return;
+
+  constexpr double kKiloInstructions = 1000.0;
+  AddValues(timer_info.start(), {instructions / cycles,
+                                 llc_misses * kKiloInstructions / instructions,
+                                 branch_misses * kKiloInstructions / instructions});
+
+  LineGraphTrack<kPmuCountersTrackDimension>::OnTimer(timer_info);
+}
+
+}  // namespace orbit_gl
@@ -0,0 +1,43 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_PMU_COUNTERS_TRACK_H_
+#define ORBIT_GL_PMU_COUNTERS_TRACK_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "LineGraphTrack.h"
+#include "Viewport.h"
+#include "capture_data.pb.h"
+
+namespace orbit_gl {
+
+constexpr size_t kPmuCountersTrackDimension = 3;
+
+// This track displays the rates derived from the hardware performance counters of a thread: the
+// instructions retired per cycle, and the last-level cache misses and branch misses per thousand
+// instructions.
+class PmuCountersTrack final : public LineGraphTrack<kPmuCountersTrackDimension> {
+ public:
+  explicit PmuCountersTrack(CaptureViewElement* parent, TimeGraph* time_graph,
+                            orbit_gl::Viewport* viewport, TimeGraphLayout* layout,
+                            int32_t thread_id,
+                            const orbit_client_model::CaptureData* capture_data);
+
+  [[nodiscard]] std::string GetTooltip() const override;
+
+  void OnTimer(const orbit_client_protos::TimerInfo& timer_info) override;
+
+  enum class SeriesIndex {
+    kInstructionsPerCycle = 0,
+    kLlcMissesPerKiloInstructions = 1,
+    kBranchMissesPerKiloInstructions = 2
+  };
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_PMU_COUNTERS_TRACK_H_
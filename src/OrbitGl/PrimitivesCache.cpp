@@ -0,0 +1,133 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PrimitivesCache.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_gl {
+
+void PrimitivesCache::UpdateOrReplay(const PrimitivesCacheKey& key, Batcher* batcher,
+                                     TextRenderer* text_renderer,
+                                     const std::function<void()>& update_primitives,
+                                     uint64_t data_max_tick) {
+  CHECK(batcher != nullptr);
+  CHECK(text_renderer != nullptr);
+
+  if (IsValid(key)) {
+    Replay(batcher, text_renderer);
+    return;
+  }
+
+  batcher->StartRecording(&batcher_recording_);
+  text_renderer->StartRecording(&text_renderer_recording_);
+  update_primitives();
+  text_renderer->StopRecording();
+  batcher->StopRecording();
+  key_ = key;
+  generated_min_tick_ = key.min_tick;
+  data_max_tick_ = data_max_tick;
+}
+
+bool PrimitivesCache::IsValidExceptForDataVersion(const PrimitivesCacheKey& key) const {
+  if (!key_.has_value()) return false;
+  PrimitivesCacheKey key_with_recorded_data_version = key;
+  key_with_recorded_data_version.data_version = key_->data_version;
+  key_with_recorded_data_version.track_data_version = key_->track_data_version;
+  return key_with_recorded_data_version == key_.value();
+}
+
+void PrimitivesCache::Record(const PrimitivesCacheKey& key, Batcher* recording_batcher,
+                             const std::function<void()>& update_primitives,
+                             uint64_t data_max_tick) {
+  CHECK(recording_batcher != nullptr);
+
+  recording_batcher->StartRecording(&batcher_recording_, BatcherRecordingMode::kRecordOnly);
+  TextRenderer::StartRecordingOnlyOnThisThread(&text_renderer_recording_);
+  update_primitives();
+  TextRenderer::StopRecordingOnlyOnThisThread();
+  recording_batcher->StopRecording();
+  key_ = key;
+  generated_min_tick_ = key.min_tick;
+  data_max_tick_ = data_max_tick;
+}
+
+void PrimitivesCache::Replay(Batcher* batcher, TextRenderer* text_renderer) const {
+  CHECK(batcher != nullptr);
+  CHECK(text_renderer != nullptr);
+  CHECK(key_.has_value());
+
+  batcher->Replay(batcher_recording_);
+  text_renderer->Replay(text_renderer_recording_);
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> PrimitivesCache::GetTimeRangeToAppend(
+    const PrimitivesCacheKey& key,
+    const std::optional<std::pair<uint64_t, uint64_t>>& new_data_time_range) const {
+  if (!key_.has_value()) return std::nullopt;
+  const PrimitivesCacheKey& recorded_key = key_.value();
+
+  PrimitivesCacheKey key_with_recorded_time_range = key;
+  key_with_recorded_time_range.track_data_version = recorded_key.track_data_version;
+  key_with_recorded_time_range.min_tick = recorded_key.min_tick;
+  key_with_recorded_time_range.max_tick = recorded_key.max_tick;
+  if (key_with_recorded_time_range != recorded_key) return std::nullopt;
+
+  if (key.min_tick < recorded_key.min_tick || key.max_tick <= key.min_tick ||
+      recorded_key.max_tick <= recorded_key.min_tick || key.world_width <= 0.f) {
+    return std::nullopt;
+  }
+  // The widths may only differ by less than a pixel over the whole screen, so that the recorded
+  // primitives only need to be moved.
+  const uint64_t width = key.max_tick - key.min_tick;
+  const uint64_t recorded_width = recorded_key.max_tick - recorded_key.min_tick;
+  const uint64_t width_difference =
+      width > recorded_width ? width - recorded_width : recorded_width - width;
+  if (width_difference * std::max(key.screen_width, 1) >= width) return std::nullopt;
+  // The primitives that moved out of the visible time range are kept until they are generated
+  // again, which bounds them to about twice the visible ones.
+  if (key.min_tick - generated_min_tick_ > width) return std::nullopt;
+
+  // No data of the track may be missing from the recorded time range, and only new data after the
+  // recorded one can be appended without drawing any of the recorded data again.
+  if (data_max_tick_ > recorded_key.max_tick) return std::nullopt;
+  uint64_t min_tick_to_append = recorded_key.max_tick;
+  if (new_data_time_range.has_value()) {
+    if (new_data_time_range->first < data_max_tick_) return std::nullopt;
+    min_tick_to_append = std::min(min_tick_to_append, new_data_time_range->first);
+  }
+  min_tick_to_append = std::max(min_tick_to_append, key.min_tick);
+  return std::make_pair(min_tick_to_append, std::max(min_tick_to_append, key.max_tick));
+}
+
+void PrimitivesCache::TranslateAndAppend(const PrimitivesCacheKey& key, Batcher* batcher,
+                                         TextRenderer* text_renderer,
+                                         const std::function<void()>& append_primitives,
+                                         uint64_t data_max_tick) {
+  CHECK(batcher != nullptr);
+  CHECK(text_renderer != nullptr);
+  CHECK(key_.has_value());
+
+  if (key.min_tick != key_->min_tick) {
+    const double ticks_per_world_unit =
+        static_cast<double>(key.max_tick - key.min_tick) / key.world_width;
+    const auto offset_x = static_cast<float>(
+        -static_cast<double>(key.min_tick - key_->min_tick) / ticks_per_world_unit);
+    batcher_recording_.TranslateX(offset_x);
+    text_renderer_recording_.TranslateX(offset_x);
+  }
+  Replay(batcher, text_renderer);
+
+  batcher->ContinueRecording(&batcher_recording_);
+  text_renderer->ContinueRecording(&text_renderer_recording_);
+  append_primitives();
+  text_renderer->StopRecording();
+  batcher->StopRecording();
+  key_ = key;
+  data_max_tick_ = data_max_tick;
+}
+
+}  // namespace orbit_gl
@@ -0,0 +1,124 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_PRIMITIVES_CACHE_H_
+#define ORBIT_GL_PRIMITIVES_CACHE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "Batcher.h"
+#include "CoreMath.h"
+#include "OrbitBase/Logging.h"
+#include "PickingManager.h"
+#include "TextRenderer.h"
+
+namespace orbit_gl {
+
+// What the primitives of a track depend on: the part of the capture that is visible, how it maps to
+// the screen, where the track is, and, through `data_version`, everything else, i.e., the data and
+// the state whose changes are signaled with TimeGraph::RequestUpdate. Data that is only added to
+// the track itself, see Track::OnNewDataInTimeRange, changes `track_data_version` instead.
+struct PrimitivesCacheKey {
+  uint64_t data_version = 0;
+  uint64_t track_data_version = 0;
+  uint64_t min_tick = 0;
+  uint64_t max_tick = 0;
+  float world_start_x = 0.f;
+  float world_width = 0.f;
+  int screen_width = 0;
+  Vec2 pos;
+  Vec2 size;
+  float height = 0.f;
+  PickingMode picking_mode = PickingMode::kNone;
+  float z_offset = 0.f;
+
+  friend bool operator==(const PrimitivesCacheKey& lhs, const PrimitivesCacheKey& rhs) {
+    return lhs.data_version == rhs.data_version &&
+           lhs.track_data_version == rhs.track_data_version && lhs.min_tick == rhs.min_tick &&
+           lhs.max_tick == rhs.max_tick && lhs.world_start_x == rhs.world_start_x &&
+           lhs.world_width == rhs.world_width && lhs.screen_width == rhs.screen_width &&
+           lhs.pos == rhs.pos && lhs.size == rhs.size && lhs.height == rhs.height &&
+           lhs.picking_mode == rhs.picking_mode && lhs.z_offset == rhs.z_offset;
+  }
+  friend bool operator!=(const PrimitivesCacheKey& lhs, const PrimitivesCacheKey& rhs) {
+    return !(lhs == rhs);
+  }
+};
+
+// Remembers the primitives and texts that were generated for a key, so that they can be added to
+// the batcher and the text renderer again, instead of being generated again, while the key stays
+// the same. This makes redrawing cheap for tracks that e.g. are only scrolled vertically.
+//
+// During a live capture, the visible time range follows the end of the capture and data keeps being
+// added at the end. The primitives can then be kept as well, moved with the time range, and only
+// completed with the ones of the new data, see GetTimeRangeToAppend and TranslateAndAppend.
+class PrimitivesCache {
+ public:
+  // Adds the primitives and texts that were recorded for `key`, or, if the last ones were recorded
+  // for a different key, calls `update_primitives` to add them, and records them.
+  // `data_max_tick` is the end of the data of the track when the primitives are generated, which is
+  // needed to append to them later, see GetTimeRangeToAppend.
+  void UpdateOrReplay(const PrimitivesCacheKey& key, Batcher* batcher,
+                      TextRenderer* text_renderer, const std::function<void()>& update_primitives,
+                      uint64_t data_max_tick = kUnknownDataMaxTick);
+
+  // The following allow generating the primitives on another thread than the one that uses the
+  // batcher and the text renderer: `Record` calls `update_primitives`, which is expected to add the
+  // primitives to `recording_batcher` and the texts to any text renderer of the calling thread,
+  // and only records them, for `Replay` to add them later.
+  [[nodiscard]] bool IsValid(const PrimitivesCacheKey& key) const {
+    return key_.has_value() && key_.value() == key;
+  }
+  // Primitives that were recorded for a key that only differs from `key` in the data versions are
+  // outdated, but still drawn at the right place, so they can be replayed until new ones are
+  // recorded, e.g., when there is no time left to generate them in this frame.
+  [[nodiscard]] bool IsValidExceptForDataVersion(const PrimitivesCacheKey& key) const;
+  [[nodiscard]] uint64_t GetRecordedDataVersion() const {
+    CHECK(key_.has_value());
+    return key_->data_version;
+  }
+  void Record(const PrimitivesCacheKey& key, Batcher* recording_batcher,
+              const std::function<void()>& update_primitives,
+              uint64_t data_max_tick = kUnknownDataMaxTick);
+  void Replay(Batcher* batcher, TextRenderer* text_renderer) const;
+
+  // If the recorded primitives can be made valid for `key` by moving them horizontally and adding
+  // the ones of a time range, returns that time range, which can be empty. This is the case when
+  // the key only differs in the track data version and in the visible time range, which moved
+  // forward without changing its width, by less than its width since the primitives were last
+  // generated, and when the recorded primitives already include all the data of the track up to the
+  // end of their time range. `new_data_time_range` is the time range of the data added to the track
+  // since then, see Track::TakeNewDataTimeRange, which must all be after that data.
+  [[nodiscard]] std::optional<std::pair<uint64_t, uint64_t>> GetTimeRangeToAppend(
+      const PrimitivesCacheKey& key,
+      const std::optional<std::pair<uint64_t, uint64_t>>& new_data_time_range) const;
+  // Moves the recorded primitives to the visible time range of `key`, replays them, and calls
+  // `append_primitives` to add and record the ones returned by GetTimeRangeToAppend.
+  void TranslateAndAppend(const PrimitivesCacheKey& key, Batcher* batcher,
+                          TextRenderer* text_renderer,
+                          const std::function<void()>& append_primitives,
+                          uint64_t data_max_tick = kUnknownDataMaxTick);
+
+  // Forgets the recorded primitives, so that they are generated again.
+  void Invalidate() { key_.reset(); }
+
+  static constexpr uint64_t kUnknownDataMaxTick = std::numeric_limits<uint64_t>::max();
+
+ private:
+  std::optional<PrimitivesCacheKey> key_;
+  // The start of the visible time range when the primitives were last generated, not appended to.
+  uint64_t generated_min_tick_ = 0;
+  uint64_t data_max_tick_ = kUnknownDataMaxTick;
+  BatcherRecording batcher_recording_;
+  TextRendererRecording text_renderer_recording_;
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_PRIMITIVES_CACHE_H_
@@ -0,0 +1,201 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "Batcher.h"
+#include "CoreMath.h"
+#include "Geometry.h"
+#include "PickingManager.h"
+#include "PrimitivesCache.h"
+#include "TextRenderer.h"
+
+namespace orbit_gl {
+
+namespace {
+
+class PrimitivesCacheTest : public testing::Test {
+ protected:
+  void UpdateOrReplay(const PrimitivesCacheKey& key) {
+    cache_.UpdateOrReplay(key, &batcher_, &text_renderer_, [this] {
+      ++update_count_;
+      batcher_.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255));
+    });
+  }
+
+  // Each primitive in the batcher has an entry in its user data.
+  [[nodiscard]] size_t GetPrimitiveCount() const { return batcher_.GetUserDataSize(); }
+
+  class TestBatcher : public Batcher {
+   public:
+    TestBatcher() : Batcher(BatcherId::kUi) {}
+    [[nodiscard]] size_t GetUserDataSize() const { return user_data_.size(); }
+  };
+
+  TestBatcher batcher_;
+  TextRenderer text_renderer_;
+  PrimitivesCache cache_;
+  int update_count_ = 0;
+};
+
+TEST_F(PrimitivesCacheTest, ReplaysForSameKey) {
+  PrimitivesCacheKey key;
+  key.min_tick = 10;
+  key.max_tick = 20;
+
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 1);
+  EXPECT_EQ(GetPrimitiveCount(), 1);
+
+  batcher_.StartNewFrame();
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 1);
+  EXPECT_EQ(GetPrimitiveCount(), 1);
+}
+
+TEST_F(PrimitivesCacheTest, UpdatesForDifferentKey) {
+  PrimitivesCacheKey key;
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 1);
+
+  key.data_version = 1;
+  batcher_.StartNewFrame();
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 2);
+
+  key.pos = Vec2(0, -100);
+  batcher_.StartNewFrame();
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 3);
+
+  key.picking_mode = PickingMode::kHover;
+  batcher_.StartNewFrame();
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 4);
+  EXPECT_EQ(GetPrimitiveCount(), 1);
+}
+
+TEST_F(PrimitivesCacheTest, IsValidExceptForDataVersionOnlyIgnoresDataVersion) {
+  PrimitivesCacheKey key;
+  EXPECT_FALSE(cache_.IsValidExceptForDataVersion(key));
+  UpdateOrReplay(key);
+  EXPECT_TRUE(cache_.IsValidExceptForDataVersion(key));
+
+  key.data_version = 1;
+  EXPECT_FALSE(cache_.IsValid(key));
+  EXPECT_TRUE(cache_.IsValidExceptForDataVersion(key));
+  EXPECT_EQ(cache_.GetRecordedDataVersion(), 0);
+
+  key.pos = Vec2(0, -100);
+  EXPECT_FALSE(cache_.IsValidExceptForDataVersion(key));
+}
+
+TEST_F(PrimitivesCacheTest, ReplaysWhatWasRecordedOnAnotherThread) {
+  PrimitivesCacheKey key;
+  EXPECT_FALSE(cache_.IsValid(key));
+
+  std::thread recording_thread([this, &key] {
+    TestBatcher recording_batcher;
+    cache_.Record(key, &recording_batcher, [&recording_batcher] {
+      recording_batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255));
+      recording_batcher.AddBox(Box(Vec2(1, 0), Vec2(1, 1), 0), Color(0, 255, 0, 255));
+    });
+  });
+  recording_thread.join();
+  EXPECT_TRUE(cache_.IsValid(key));
+  EXPECT_EQ(GetPrimitiveCount(), 0);
+
+  cache_.Replay(&batcher_, &text_renderer_);
+  EXPECT_EQ(GetPrimitiveCount(), 2);
+
+  batcher_.StartNewFrame();
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 0);
+  EXPECT_EQ(GetPrimitiveCount(), 2);
+}
+
+PrimitivesCacheKey MakeLiveCaptureKey(uint64_t min_tick) {
+  PrimitivesCacheKey key;
+  key.min_tick = min_tick;
+  key.max_tick = min_tick + 100;
+  key.world_width = 100.f;
+  key.screen_width = 1000;
+  key.pos = Vec2(0, 0);
+  key.size = Vec2(100, 10);
+  return key;
+}
+
+TEST_F(PrimitivesCacheTest, GetTimeRangeToAppendAfterTimeRangeMovedForward) {
+  PrimitivesCacheKey key = MakeLiveCaptureKey(0);
+  EXPECT_FALSE(cache_.GetTimeRangeToAppend(key, std::nullopt).has_value());
+  cache_.UpdateOrReplay(key, &batcher_, &text_renderer_, [] {}, /*data_max_tick=*/90);
+
+  key = MakeLiveCaptureKey(20);
+  key.track_data_version = 1;
+  std::optional<std::pair<uint64_t, uint64_t>> time_range =
+      cache_.GetTimeRangeToAppend(key, std::make_pair<uint64_t, uint64_t>(95, 110));
+  ASSERT_TRUE(time_range.has_value());
+  EXPECT_EQ(time_range->first, 95);
+  EXPECT_EQ(time_range->second, 120);
+
+  time_range = cache_.GetTimeRangeToAppend(key, std::nullopt);
+  ASSERT_TRUE(time_range.has_value());
+  EXPECT_EQ(time_range->first, 100);
+  EXPECT_EQ(time_range->second, 120);
+}
+
+TEST_F(PrimitivesCacheTest, GetTimeRangeToAppendRequiresAllNewDataAfterTheRecordedOne) {
+  PrimitivesCacheKey key = MakeLiveCaptureKey(0);
+  cache_.UpdateOrReplay(key, &batcher_, &text_renderer_, [] {}, /*data_max_tick=*/90);
+
+  key = MakeLiveCaptureKey(20);
+  EXPECT_FALSE(
+      cache_.GetTimeRangeToAppend(key, std::make_pair<uint64_t, uint64_t>(80, 110)).has_value());
+
+  key = MakeLiveCaptureKey(20);
+  key.max_tick = 130;
+  EXPECT_FALSE(cache_.GetTimeRangeToAppend(key, std::nullopt).has_value());
+
+  key = MakeLiveCaptureKey(20);
+  key.pos = Vec2(0, -100);
+  EXPECT_FALSE(cache_.GetTimeRangeToAppend(key, std::nullopt).has_value());
+
+  key = MakeLiveCaptureKey(150);
+  EXPECT_FALSE(cache_.GetTimeRangeToAppend(key, std::nullopt).has_value());
+
+  // The data of the track could end after the recorded time range, which then misses some of it.
+  cache_.Invalidate();
+  cache_.UpdateOrReplay(MakeLiveCaptureKey(0), &batcher_, &text_renderer_, [] {},
+                        /*data_max_tick=*/110);
+  EXPECT_FALSE(cache_.GetTimeRangeToAppend(MakeLiveCaptureKey(20), std::nullopt).has_value());
+}
+
+TEST_F(PrimitivesCacheTest, TranslateAndAppendKeepsTheRecordedPrimitives) {
+  PrimitivesCacheKey key = MakeLiveCaptureKey(0);
+  cache_.UpdateOrReplay(key, &batcher_, &text_renderer_, [this] {
+    ++update_count_;
+    batcher_.AddBox(Box(Vec2(50, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255));
+  }, /*data_max_tick=*/90);
+
+  key = MakeLiveCaptureKey(20);
+  ASSERT_TRUE(cache_.GetTimeRangeToAppend(key, std::nullopt).has_value());
+  batcher_.StartNewFrame();
+  cache_.TranslateAndAppend(key, &batcher_, &text_renderer_, [this] {
+    batcher_.AddBox(Box(Vec2(90, 0), Vec2(1, 1), 0), Color(0, 255, 0, 255));
+  }, /*data_max_tick=*/110);
+  EXPECT_EQ(update_count_, 1);
+  EXPECT_EQ(GetPrimitiveCount(), 2);
+  EXPECT_TRUE(cache_.IsValid(key));
+
+  batcher_.StartNewFrame();
+  UpdateOrReplay(key);
+  EXPECT_EQ(update_count_, 1);
+  EXPECT_EQ(GetPrimitiveCount(), 2);
+}
+
+}  // namespace
+
+}  // namespace orbit_gl
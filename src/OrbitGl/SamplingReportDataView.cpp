@@ -13,7 +13,6 @@
 
 #include <algorithm>
 #include <cstdint>
-#include <filesystem>
 #include <functional>
 #include <memory>
 #include <outcome.hpp>
@@ -36,7 +35,9 @@
 using orbit_client_data::ModuleData;
 using orbit_client_data::ProcessData;
 using orbit_client_data::SampledFunction;
+using orbit_client_data::SampledModule;
 using orbit_client_data::ThreadID;
+using orbit_client_data::ThreadSampleData;
 using orbit_client_model::CaptureData;
 using orbit_client_protos::FunctionInfo;
 
@@ -62,6 +63,7 @@ const std::vector<orbit_data_views::DataView::Column>& SamplingReportDataView::G
 }
 
 std::string SamplingReportDataView::GetValue(int row, int column) {
+  if (group_by_module_) return GetModuleValue(row, column);
   const SampledFunction& func = GetSampledFunction(row);
 
   switch (column) {
@@ -76,7 +78,7 @@ std::string SamplingReportDataView::GetValue(int row, int column) {
     case kColumnInclusive:
       return absl::StrFormat("%.2f%% (%u)", func.inclusive_percent, func.inclusive);
     case kColumnModuleName:
-      return std::filesystem::path(func.module_path).filename().string();
+      return func.module_name;
     case kColumnAddress:
       return absl::StrFormat("%#llx", func.absolute_address);
     case kColumnUnwindErrors:
@@ -88,9 +90,47 @@ std::string SamplingReportDataView::GetValue(int row, int column) {
   }
 }
 
+// A module row shows the module name in the "Name" column and the full path in the "Module" one.
+std::string SamplingReportDataView::GetModuleValue(int row, int column) const {
+  const SampledModule& module = GetSampledModule(row);
+
+  switch (column) {
+    case kColumnFunctionName:
+      return module.module_name;
+    case kColumnExclusive:
+      return absl::StrFormat("%.2f%% (%u)", module.exclusive_percent, module.exclusive);
+    case kColumnInclusive:
+      return absl::StrFormat("%.2f%% (%u)", module.inclusive_percent, module.inclusive);
+    case kColumnModuleName:
+      return module.module_path;
+    case kColumnUnwindErrors:
+      return (module.unwind_errors > 0) ? absl::StrFormat("%.2f%% (%d)",
+                                                          module.unwind_errors_percent,
+                                                          module.unwind_errors)
+                                        : "";
+    default:
+      return "";
+  }
+}
+
 // For columns with two values, a percentage and a raw number, only copy the percentage, so that it
 // can be interpreted as a number by a spreadsheet.
 std::string SamplingReportDataView::GetValueForCopy(int row, int column) {
+  if (group_by_module_) {
+    const SampledModule& module = GetSampledModule(row);
+    switch (column) {
+      case kColumnExclusive:
+        return absl::StrFormat("%.2f%%", module.exclusive_percent);
+      case kColumnInclusive:
+        return absl::StrFormat("%.2f%%", module.inclusive_percent);
+      case kColumnUnwindErrors:
+        return (module.unwind_errors > 0) ? absl::StrFormat("%.2f%%", module.unwind_errors_percent)
+                                          : "";
+      default:
+        return GetModuleValue(row, column);
+    }
+  }
+
   const SampledFunction& func = GetSampledFunction(row);
   switch (column) {
     case kColumnExclusive:
@@ -116,14 +156,64 @@ std::string SamplingReportDataView::GetValueForCopy(int row, int column) {
                                                   ascending);                             \
   }
 
-#define ORBIT_MODULE_NAME_FUNC_SORT                                             \
-  [&](int a, int b) {                                                           \
-    return orbit_gl::CompareAscendingOrDescending(                              \
-        std::filesystem::path(functions[a].module_path).filename(),             \
-        std::filesystem::path(functions[b].module_path).filename(), ascending); \
+#define ORBIT_MODULE_SORT(Member)                                                       \
+  [&](int a, int b) {                                                                   \
+    return orbit_gl::CompareAscendingOrDescending(modules[a].Member, modules[b].Member, \
+                                                  ascending);                           \
   }
 
+void SamplingReportDataView::DoSortModules() {
+  bool ascending = sorting_orders_[sorting_column_] == SortingOrder::kAscending;
+  std::function<bool(int a, int b)> sorter = nullptr;
+
+  const std::vector<SampledModule>& modules = modules_;
+
+  switch (sorting_column_) {
+    case kColumnFunctionName:
+      sorter = ORBIT_MODULE_SORT(module_name);
+      break;
+    case kColumnExclusive:
+      sorter = ORBIT_MODULE_SORT(exclusive);
+      break;
+    case kColumnInclusive:
+      sorter = ORBIT_MODULE_SORT(inclusive);
+      break;
+    case kColumnModuleName:
+      sorter = ORBIT_MODULE_SORT(module_path);
+      break;
+    case kColumnUnwindErrors:
+      sorter = ORBIT_MODULE_SORT(unwind_errors);
+      break;
+    default:
+      break;
+  }
+
+  if (!sorter) {
+    return;
+  }
+
+  // `SampledModule::module_path` is unique and qualifies for total ordering.
+  const auto combined_sorter = [&](const auto& ind_left, const auto& ind_right) {
+    if (sorter(ind_left, ind_right)) {
+      return true;
+    }
+
+    if (sorter(ind_right, ind_left)) {
+      return false;
+    }
+
+    return modules[ind_left].module_path < modules[ind_right].module_path;
+  };
+
+  std::sort(indices_.begin(), indices_.end(), combined_sorter);
+}
+
 void SamplingReportDataView::DoSort() {
+  if (group_by_module_) {
+    DoSortModules();
+    return;
+  }
+
   bool ascending = sorting_orders_[sorting_column_] == SortingOrder::kAscending;
   std::function<bool(int a, int b)> sorter = nullptr;
 
@@ -143,7 +233,7 @@ void SamplingReportDataView::DoSort() {
       sorter = ORBIT_PROC_SORT(inclusive);
       break;
     case kColumnModuleName:
-      sorter = ORBIT_MODULE_NAME_FUNC_SORT;
+      sorter = ORBIT_PROC_SORT(module_name);
       break;
     case kColumnAddress:
       sorter = ORBIT_PROC_SORT(absolute_address);
@@ -227,9 +317,17 @@ const std::string SamplingReportDataView::kMenuActionUnselect = "Unhook";
 const std::string SamplingReportDataView::kMenuActionLoadSymbols = "Load Symbols";
 const std::string SamplingReportDataView::kMenuActionDisassembly = "Go to Disassembly";
 const std::string SamplingReportDataView::kMenuActionSourceCode = "Go to Source code";
+const std::string SamplingReportDataView::kMenuActionGroupByModule = "Group by Module";
+const std::string SamplingReportDataView::kMenuActionUngroupModules = "Show Functions";
 
 std::vector<std::string> SamplingReportDataView::GetContextMenu(
     int clicked_index, const std::vector<int>& selected_indices) {
+  if (group_by_module_) {
+    std::vector<std::string> menu{kMenuActionUngroupModules};
+    orbit_base::Append(menu, DataView::GetContextMenu(clicked_index, selected_indices));
+    return menu;
+  }
+
   bool enable_select = false;
   bool enable_unselect = false;
   bool enable_disassembly = false;
@@ -263,6 +361,7 @@ std::vector<std::string> SamplingReportDataView::GetContextMenu(
   if (enable_load) menu.emplace_back(kMenuActionLoadSymbols);
   if (enable_disassembly) menu.emplace_back(kMenuActionDisassembly);
   if (enable_source_code) menu.emplace_back(kMenuActionSourceCode);
+  menu.emplace_back(kMenuActionGroupByModule);
   orbit_base::Append(menu, DataView::GetContextMenu(clicked_index, selected_indices));
   return menu;
 }
@@ -296,6 +395,10 @@ void SamplingReportDataView::OnContextMenu(const std::string& action, int menu_i
     for (const FunctionInfo* function : GetFunctionsFromIndices(item_indices)) {
       app_->ShowSourceCode(*function);
     }
+  } else if (action == kMenuActionGroupByModule) {
+    SetGroupByModule(true);
+  } else if (action == kMenuActionUngroupModules) {
+    SetGroupByModule(false);
   } else {
     DataView::OnContextMenu(action, menu_index, item_indices);
   }
@@ -304,6 +407,15 @@ void SamplingReportDataView::OnContextMenu(const std::string& action, int menu_i
 void SamplingReportDataView::UpdateSelectedIndicesAndFunctionIds(
     const std::vector<int>& selected_indices) {
   selected_indices_.clear();
+  if (group_by_module_) {
+    selected_module_paths_.clear();
+    for (int row : selected_indices) {
+      selected_indices_.insert(indices_[row]);
+      selected_module_paths_.insert(GetSampledModule(row).module_path);
+    }
+    return;
+  }
+
   selected_function_ids_.clear();
   for (int row : selected_indices) {
     selected_indices_.insert(indices_[row]);
@@ -313,6 +425,15 @@ void SamplingReportDataView::UpdateSelectedIndicesAndFunctionIds(
 
 void SamplingReportDataView::RestoreSelectedIndicesAfterFunctionsChanged() {
   selected_indices_.clear();
+  if (group_by_module_) {
+    for (size_t row = 0; row < modules_.size(); ++row) {
+      if (selected_module_paths_.contains(modules_[row].module_path)) {
+        selected_indices_.insert(static_cast<int>(row));
+      }
+    }
+    return;
+  }
+
   for (size_t row = 0; row < functions_.size(); ++row) {
     if (selected_function_ids_.contains(functions_[row].absolute_address)) {
       selected_indices_.insert(static_cast<int>(row));
@@ -323,8 +444,20 @@ void SamplingReportDataView::RestoreSelectedIndicesAfterFunctionsChanged() {
 void SamplingReportDataView::UpdateVisibleSelectedAddressesAndTid(
     const std::vector<int>& visible_selected_indices) {
   absl::flat_hash_set<uint64_t> addresses;
-  for (int index : visible_selected_indices) {
-    addresses.insert(GetSampledFunction(index).absolute_address);
+  if (group_by_module_) {
+    absl::flat_hash_set<std::string> module_paths;
+    for (int index : visible_selected_indices) {
+      module_paths.insert(GetSampledModule(index).module_path);
+    }
+    for (const SampledFunction& function : functions_) {
+      if (module_paths.contains(function.module_path)) {
+        addresses.insert(function.absolute_address);
+      }
+    }
+  } else {
+    for (int index : visible_selected_indices) {
+      addresses.insert(GetSampledFunction(index).absolute_address);
+    }
   }
   sampling_report_->OnSelectAddresses(addresses, tid_);
 }
@@ -347,17 +480,31 @@ void SamplingReportDataView::LinkDataView(orbit_data_views::DataView* data_view)
   }
 }
 
-void SamplingReportDataView::SetSampledFunctions(const std::vector<SampledFunction>& functions) {
-  functions_ = functions;
+void SamplingReportDataView::SetSampleData(const ThreadSampleData& thread_sample_data) {
+  functions_ = thread_sample_data.sampled_functions;
+  modules_ = thread_sample_data.sampled_modules;
   RestoreSelectedIndicesAfterFunctionsChanged();
+  ResetIndices();
+  OnDataChanged();
+}
 
-  size_t num_functions = functions_.size();
-  indices_.resize(num_functions);
-  for (size_t i = 0; i < num_functions; ++i) {
-    indices_[i] = i;
+void SamplingReportDataView::SetGroupByModule(bool group_by_module) {
+  if (group_by_module_ == group_by_module) return;
+  group_by_module_ = group_by_module;
+  RestoreSelectedIndicesAfterFunctionsChanged();
+  ResetIndices();
+  OnDataChanged();
+  if (sampling_report_ != nullptr) {
+    UpdateVisibleSelectedAddressesAndTid(GetVisibleSelectedIndices());
   }
+}
 
-  OnDataChanged();
+void SamplingReportDataView::ResetIndices() {
+  size_t num_rows = group_by_module_ ? modules_.size() : functions_.size();
+  indices_.resize(num_rows);
+  for (size_t i = 0; i < num_rows; ++i) {
+    indices_[i] = i;
+  }
 }
 
 void SamplingReportDataView::SetThreadID(ThreadID tid) {
@@ -369,7 +516,37 @@ void SamplingReportDataView::SetThreadID(ThreadID tid) {
   }
 }
 
+void SamplingReportDataView::DoFilterModules() {
+  std::vector<uint64_t> indices;
+
+  std::vector<std::string> tokens = absl::StrSplit(absl::AsciiStrToLower(filter_), ' ');
+
+  for (size_t i = 0; i < modules_.size(); ++i) {
+    std::string module_name = absl::AsciiStrToLower(modules_[i].module_name);
+
+    bool match = true;
+
+    for (std::string& filter_token : tokens) {
+      if (module_name.find(filter_token) == std::string::npos) {
+        match = false;
+        break;
+      }
+    }
+
+    if (match) {
+      indices.push_back(i);
+    }
+  }
+
+  indices_ = std::move(indices);
+}
+
 void SamplingReportDataView::DoFilter() {
+  if (group_by_module_) {
+    DoFilterModules();
+    return;
+  }
+
   std::vector<uint64_t> indices;
 
   std::vector<std::string> tokens = absl::StrSplit(absl::AsciiStrToLower(filter_), ' ');
@@ -377,8 +554,7 @@ void SamplingReportDataView::DoFilter() {
   for (size_t i = 0; i < functions_.size(); ++i) {
     SampledFunction& func = functions_[i];
     std::string name = absl::AsciiStrToLower(func.name);
-    std::string module_name =
-        absl::AsciiStrToLower(std::filesystem::path(func.module_path).filename().string());
+    std::string module_name = absl::AsciiStrToLower(func.module_name);
 
     bool match = true;
 
@@ -405,3 +581,7 @@ const SampledFunction& SamplingReportDataView::GetSampledFunction(unsigned int r
 SampledFunction& SamplingReportDataView::GetSampledFunction(unsigned int row) {
   return functions_[indices_[row]];
 }
+
+const SampledModule& SamplingReportDataView::GetSampledModule(unsigned int row) const {
+  return modules_[indices_[row]];
+}
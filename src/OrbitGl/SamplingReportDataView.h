@@ -41,7 +41,11 @@ class SamplingReportDataView : public orbit_data_views::DataView {
   void SetSamplingReport(class SamplingReport* sampling_report) {
     sampling_report_ = sampling_report;
   }
-  void SetSampledFunctions(const std::vector<orbit_client_data::SampledFunction>& functions);
+  void SetSampleData(const orbit_client_data::ThreadSampleData& thread_sample_data);
+  // Shows one row per module instead of one per function. Selecting a module selects the callstacks
+  // of all its sampled functions.
+  void SetGroupByModule(bool group_by_module);
+  [[nodiscard]] bool IsGroupedByModule() const { return group_by_module_; }
   void SetThreadID(orbit_client_data::ThreadID tid);
   orbit_client_data::ThreadID GetThreadID() const { return tid_; }
 
@@ -50,21 +54,31 @@ class SamplingReportDataView : public orbit_data_views::DataView {
   void DoFilter() override;
   const orbit_client_data::SampledFunction& GetSampledFunction(unsigned int row) const;
   orbit_client_data::SampledFunction& GetSampledFunction(unsigned int row);
+  [[nodiscard]] const orbit_client_data::SampledModule& GetSampledModule(unsigned int row) const;
   absl::flat_hash_set<const orbit_client_protos::FunctionInfo*> GetFunctionsFromIndices(
       const std::vector<int>& indices);
   [[nodiscard]] absl::flat_hash_set<std::pair<std::string, std::string>>
   GetModulePathsAndBuildIdsFromIndices(const std::vector<int>& indices) const;
 
  private:
+  [[nodiscard]] std::string GetModuleValue(int row, int column) const;
+  void DoSortModules();
+  void DoFilterModules();
+  void ResetIndices();
   void UpdateSelectedIndicesAndFunctionIds(const std::vector<int>& selected_indices);
   void RestoreSelectedIndicesAfterFunctionsChanged();
   // The callstack view will be updated according to the visible selected addresses and thread id.
   void UpdateVisibleSelectedAddressesAndTid(const std::vector<int>& visible_selected_indices);
 
   std::vector<orbit_client_data::SampledFunction> functions_;
+  std::vector<orbit_client_data::SampledModule> modules_;
+  // When true, the rows are the elements of modules_ instead of those of functions_.
+  bool group_by_module_ = false;
   // We need to keep user's selected function ids such that if functions_ changes, the
-  // selected_indices_ can be updated according to the selected function ids.
+  // selected_indices_ can be updated according to the selected function ids. The same holds for
+  // selected module paths and modules_.
   absl::flat_hash_set<uint64_t> selected_function_ids_;
+  absl::flat_hash_set<std::string> selected_module_paths_;
   orbit_client_data::ThreadID tid_ = -1;
   std::string name_;
   CallstackDataView* callstack_data_view_;
@@ -86,6 +100,8 @@ class SamplingReportDataView : public orbit_data_views::DataView {
   static const std::string kMenuActionLoadSymbols;
   static const std::string kMenuActionDisassembly;
   static const std::string kMenuActionSourceCode;
+  static const std::string kMenuActionGroupByModule;
+  static const std::string kMenuActionUngroupModules;
 
   // TODO(b/185090791): This is temporary and will be removed once this data view has been ported
   // and move to orbit_data_views.
@@ -8,19 +8,27 @@
 #include <absl/strings/str_format.h>
 #include <stdint.h>
 
+#include <vector>
+
 #include "App.h"
 #include "Batcher.h"
+#include "ClientData/CoreUtilizationIndex.h"
 #include "ClientData/TextBox.h"
+#include "ClientData/ThreadUtilizationIndex.h"
 #include "ClientModel/CaptureData.h"
+#include "Geometry.h"
+#include "GlCanvas.h"
 #include "OrbitBase/Logging.h"
 #include "TimeGraph.h"
 #include "TimeGraphLayout.h"
 #include "Viewport.h"
 
+using orbit_client_data::CoreUtilization;
 using orbit_client_protos::TimerInfo;
 
 const Color kInactiveColor(100, 100, 100, 255);
 const Color kSelectionColor(0, 128, 255, 255);
+const Color kTargetProcessUtilizationColor(255, 160, 0, 255);
 
 SchedulerTrack::SchedulerTrack(CaptureViewElement* parent, TimeGraph* time_graph,
                                orbit_gl::Viewport* viewport, TimeGraphLayout* layout, OrbitApp* app,
@@ -39,6 +47,89 @@ void SchedulerTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
     num_cores_ = timer_info.processor() + 1;
     SetLabel(absl::StrFormat("Scheduler (%u cores)", num_cores_));
   }
+
+  CHECK(capture_data_ != nullptr);
+  const int32_t capture_process_id = capture_data_->process_id();
+  core_utilization_index_.AddSlice(
+      timer_info.processor(), timer_info.start(), timer_info.end(),
+      capture_process_id == 0 || capture_process_id == timer_info.process_id());
+  thread_utilization_index_.AddSlice(timer_info.process_id(), timer_info.thread_id(),
+                                     timer_info.start(), timer_info.end());
+}
+
+void SchedulerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                                      PickingMode picking_mode, float z_offset) {
+  const int screen_width = viewport_->GetScreenWidth();
+  const uint64_t ns_per_pixel =
+      screen_width > 0
+          ? static_cast<uint64_t>(1000 * time_graph_->GetTimeWindowUs()) / screen_width
+          : 0;
+  if (ns_per_pixel == 0 || !ShouldDrawUtilizationHeatmap(min_tick, max_tick, ns_per_pixel)) {
+    TimerTrack::UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
+    return;
+  }
+  UpdateBoxHeight();
+  DrawUtilizationHeatmap(batcher, min_tick, max_tick, ns_per_pixel, z_offset);
+}
+
+bool SchedulerTrack::ShouldDrawUtilizationHeatmap(uint64_t min_tick, uint64_t max_tick,
+                                                  uint64_t ns_per_pixel) const {
+  constexpr uint64_t kMinPixelsPerSlice = 2;
+  const uint64_t pixel_count = (max_tick - min_tick) / ns_per_pixel + 1;
+  uint64_t slice_count = 0;
+  for (uint32_t core = 0; core < num_cores_; ++core) {
+    slice_count += core_utilization_index_.GetSliceCount(core, min_tick, max_tick);
+  }
+  return slice_count * kMinPixelsPerSlice > num_cores_ * pixel_count;
+}
+
+void SchedulerTrack::DrawUtilizationHeatmap(Batcher* batcher, uint64_t min_tick,
+                                            uint64_t max_tick, uint64_t ns_per_pixel,
+                                            float z_offset) {
+  // Each pixel of each core is drawn more opaque the more the core was busy, and the more orange
+  // the larger the share of the target process in that time.
+  constexpr float kMinAlpha = 32.f;
+  const float z = GlCanvas::kZValueBox + z_offset;
+  const size_t pixel_count = (max_tick - min_tick) / ns_per_pixel + 1;
+  for (uint32_t core = 0; core < num_cores_; ++core) {
+    const float y = GetYFromCore(core);
+    const std::vector<CoreUtilization> utilization_per_pixel =
+        core_utilization_index_.GetCoreUtilizationPerBucket(core, min_tick, ns_per_pixel,
+                                                            pixel_count);
+    for (size_t i = 0; i < pixel_count; ++i) {
+      const CoreUtilization& utilization = utilization_per_pixel[i];
+      if (utilization.time_on_core_ns == 0) continue;
+      const float busy_ratio =
+          static_cast<float>(utilization.time_on_core_ns) / static_cast<float>(ns_per_pixel);
+      const float target_process_ratio =
+          static_cast<float>(utilization.target_process_time_on_core_ns) /
+          static_cast<float>(utilization.time_on_core_ns);
+      Color color;
+      for (int component = 0; component < 3; ++component) {
+        color[component] = static_cast<unsigned char>(
+            kInactiveColor[component] * (1.f - target_process_ratio) +
+            kTargetProcessUtilizationColor[component] * target_process_ratio);
+      }
+      color[3] = static_cast<unsigned char>(kMinAlpha + (255.f - kMinAlpha) * busy_ratio);
+
+      const uint64_t pixel_min_tick = min_tick + i * ns_per_pixel;
+      const float x0 = time_graph_->GetWorldFromTick(pixel_min_tick);
+      const float x1 = time_graph_->GetWorldFromTick(pixel_min_tick + ns_per_pixel);
+      Box box(Vec2(x0, y), Vec2(x1 - x0, box_height_), z);
+      batcher->AddBox(box, color,
+                      PickingUserData(nullptr, [core, busy_ratio, target_process_ratio](
+                                                   PickingId /*id*/) {
+                        return absl::StrFormat(
+                            "<b>CPU Core utilization</b><br/>"
+                            "<br/>"
+                            "<b>Core:</b> %u<br/>"
+                            "<b>Utilization:</b> %.1f%%<br/>"
+                            "<b>Target process:</b> %.1f%% of it<br/>"
+                            "<br/><i>Zoom in to see the threads</i>",
+                            core, 100.f * busy_ratio, 100.f * target_process_ratio);
+                      }));
+    }
+  }
 }
 
 float SchedulerTrack::GetHeight() const {
@@ -72,9 +163,13 @@ Color SchedulerTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selecte
 }
 
 float SchedulerTrack::GetYFromTimer(const TimerInfo& timer_info) const {
-  uint32_t num_gaps = timer_info.depth();
+  return GetYFromCore(timer_info.depth());
+}
+
+float SchedulerTrack::GetYFromCore(uint32_t core) const {
+  uint32_t num_gaps = core;
   return pos_[1] - GetHeaderHeight() -
-         (layout_->GetTextCoresHeight() * static_cast<float>(timer_info.depth() + 1)) -
+         (layout_->GetTextCoresHeight() * static_cast<float>(core + 1)) -
          num_gaps * layout_->GetSpaceBetweenCores();
 }
 
@@ -97,9 +192,9 @@ std::string SchedulerTrack::GetBoxTooltip(const Batcher& batcher, PickingId id)
       "<b>Core:</b> %d<br/>"
       "<b>Process:</b> %s [%d]<br/>"
       "<b>Thread:</b> %s [%d]<br/>",
-      text_box->GetTimerInfo().processor(),
-      capture_data_->GetThreadName(text_box->GetTimerInfo().process_id()),
-      text_box->GetTimerInfo().process_id(),
-      capture_data_->GetThreadName(text_box->GetTimerInfo().thread_id()),
-      text_box->GetTimerInfo().thread_id());
+      text_box->GetPackedTimerInfo().processor(),
+      capture_data_->GetThreadName(text_box->GetPackedTimerInfo().process_id()),
+      text_box->GetPackedTimerInfo().process_id(),
+      capture_data_->GetThreadName(text_box->GetPackedTimerInfo().thread_id()),
+      text_box->GetPackedTimerInfo().thread_id());
 }
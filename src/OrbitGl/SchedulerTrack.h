@@ -5,9 +5,13 @@
 #ifndef ORBIT_GL_SCHEDULER_TRACK_H_
 #define ORBIT_GL_SCHEDULER_TRACK_H_
 
+#include <stdint.h>
+
 #include <string>
 
 #include "CallstackThreadBar.h"
+#include "ClientData/CoreUtilizationIndex.h"
+#include "ClientData/ThreadUtilizationIndex.h"
 #include "CoreMath.h"
 #include "PickingManager.h"
 #include "TimerTrack.h"
@@ -25,6 +29,8 @@ class SchedulerTrack final : public TimerTrack {
                           uint32_t indentation_level = 0);
   ~SchedulerTrack() override = default;
   void OnTimer(const orbit_client_protos::TimerInfo& timer_info) override;
+  void UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                        PickingMode picking_mode, float z_offset = 0) override;
 
   [[nodiscard]] Type GetType() const override { return Type::kSchedulerTrack; }
   [[nodiscard]] std::string GetTooltip() const override;
@@ -38,6 +44,13 @@ class SchedulerTrack final : public TimerTrack {
 
   [[nodiscard]] Color GetTrackBackgroundColor() const override { return color_; }
 
+  [[nodiscard]] const orbit_client_data::CoreUtilizationIndex& GetCoreUtilizationIndex() const {
+    return core_utilization_index_;
+  }
+  [[nodiscard]] const orbit_client_data::ThreadUtilizationIndex& GetThreadUtilizationIndex() const {
+    return thread_utilization_index_;
+  }
+
  protected:
   [[nodiscard]] bool IsTimerActive(const orbit_client_protos::TimerInfo& timer_info) const override;
   [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer_info,
@@ -45,7 +58,17 @@ class SchedulerTrack final : public TimerTrack {
   [[nodiscard]] std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const override;
 
  private:
+  [[nodiscard]] float GetYFromCore(uint32_t core) const;
+  // Whether the slices in [min_tick, max_tick] are so many that on average they are narrower than
+  // a few pixels, in which case the utilization heatmap is drawn instead of the slices.
+  [[nodiscard]] bool ShouldDrawUtilizationHeatmap(uint64_t min_tick, uint64_t max_tick,
+                                                  uint64_t ns_per_pixel) const;
+  void DrawUtilizationHeatmap(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                              uint64_t ns_per_pixel, float z_offset);
+
   uint32_t num_cores_;
+  orbit_client_data::CoreUtilizationIndex core_utilization_index_;
+  orbit_client_data::ThreadUtilizationIndex thread_utilization_index_;
 };
 
 #endif  // ORBIT_GL_SCHEDULER_TRACK_H_
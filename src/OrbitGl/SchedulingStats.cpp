@@ -31,11 +31,49 @@ SchedulingStats::SchedulingStats(
 
     ProcessStats& process_stats = process_stats_by_pid_[timer_info.process_id()];
     process_stats.time_on_core_ns += timer_duration_ns;
+    ++process_stats.context_switch_count;
 
     ThreadStats& thread_stats = process_stats.thread_stats_by_tid[timer_info.thread_id()];
     thread_stats.time_on_core_ns += timer_duration_ns;
+    ++thread_stats.context_switch_count;
   }
 
+  SortProcessAndThreadStats(thread_name_provider);
+}
+
+SchedulingStats::SchedulingStats(
+    const orbit_client_data::CoreUtilizationIndex& core_utilization_index,
+    const orbit_client_data::ThreadUtilizationIndex& thread_utilization_index,
+    const ThreadNameProvider& thread_name_provider, uint64_t start_ns, uint64_t end_ns) {
+  time_range_ms_ = static_cast<double>(end_ns - start_ns) * kNsToMs;
+
+  const uint32_t core_count = core_utilization_index.GetCoreCount();
+  for (uint32_t core = 0; core < core_count; ++core) {
+    if (core_utilization_index.GetSliceCount(core, start_ns, end_ns) == 0) continue;
+    const uint64_t core_time_on_core_ns =
+        core_utilization_index.GetCoreUtilization(core, start_ns, end_ns).time_on_core_ns;
+    time_on_core_ns_ += core_time_on_core_ns;
+    time_on_core_ns_by_core_[core] = core_time_on_core_ns;
+  }
+
+  for (const auto& [tid, pid] : thread_utilization_index.GetProcessIdsByThreadId()) {
+    const orbit_client_data::ThreadUtilization utilization =
+        thread_utilization_index.GetThreadUtilization(tid, start_ns, end_ns);
+    if (utilization.slice_count == 0) continue;
+
+    ProcessStats& process_stats = process_stats_by_pid_[pid];
+    process_stats.time_on_core_ns += utilization.time_on_core_ns;
+    process_stats.context_switch_count += utilization.slice_count;
+
+    ThreadStats& thread_stats = process_stats.thread_stats_by_tid[tid];
+    thread_stats.time_on_core_ns = utilization.time_on_core_ns;
+    thread_stats.context_switch_count = utilization.slice_count;
+  }
+
+  SortProcessAndThreadStats(thread_name_provider);
+}
+
+void SchedulingStats::SortProcessAndThreadStats(const ThreadNameProvider& thread_name_provider) {
   // Iterate on every process and thread to finalize stats.
   for (auto& [pid, process_stats] : process_stats_by_pid_) {
     process_stats.process_name = thread_name_provider(pid);
@@ -76,15 +114,17 @@ std::string SchedulingStats::ToString() const {
   if (time_range_ms_ > 0) summary += absl::StrFormat("\nSelection time: %.6f ms\n", time_range_ms_);
   for (ProcessStats* p_stats : process_stats_sorted_by_time_on_core_) {
     double p_time_on_core_ms = NsToMs(p_stats->time_on_core_ns);
-    summary += absl::StrFormat("  %s[%i] spent %.6f ms on core (%.2f%%)\n", p_stats->process_name,
-                               p_stats->pid, p_time_on_core_ms,
-                               100.0 * p_time_on_core_ms / time_range_ms_);
+    summary += absl::StrFormat(
+        "  %s[%i] spent %.6f ms on core (%.2f%%) in %u slices\n", p_stats->process_name,
+        p_stats->pid, p_time_on_core_ms, 100.0 * p_time_on_core_ms / time_range_ms_,
+        p_stats->context_switch_count);
 
     for (ThreadStats* t_stats : p_stats->thread_stats_sorted_by_time_on_core) {
       double t_time_on_core_ms = NsToMs(t_stats->time_on_core_ns);
-      summary += absl::StrFormat("   - %s[%i] spent %.6f ms on core (%.2f%%)\n",
+      summary += absl::StrFormat("   - %s[%i] spent %.6f ms on core (%.2f%%) in %u slices\n",
                                  t_stats->thread_name, t_stats->tid, t_time_on_core_ms,
-                                 100.0 * t_time_on_core_ms / time_range_ms_);
+                                 100.0 * t_time_on_core_ms / time_range_ms_,
+                                 t_stats->context_switch_count);
     }
   }
 
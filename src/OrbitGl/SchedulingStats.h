@@ -10,7 +10,9 @@
 #include <string>
 #include <vector>
 
+#include "ClientData/CoreUtilizationIndex.h"
 #include "ClientData/TextBox.h"
+#include "ClientData/ThreadUtilizationIndex.h"
 
 class CaptureData;
 class SchedulerTrack;
@@ -28,12 +30,20 @@ class SchedulingStats {
   SchedulingStats(const std::vector<const orbit_client_data::TextBox*>& scheduling_scopes,
                   const ThreadNameProvider& thread_name_provider, uint64_t start_ns,
                   uint64_t end_ns);
+  // Computes the same statistics from the prefix sums of the indexes, in time proportional to the
+  // number of cores and threads instead of to the number of scheduling slices in the time range.
+  SchedulingStats(const orbit_client_data::CoreUtilizationIndex& core_utilization_index,
+                  const orbit_client_data::ThreadUtilizationIndex& thread_utilization_index,
+                  const ThreadNameProvider& thread_name_provider, uint64_t start_ns,
+                  uint64_t end_ns);
 
   [[nodiscard]] std::string ToString() const;
 
   struct ThreadStats {
     int32_t tid = -1;
     uint64_t time_on_core_ns = 0;
+    // The number of times the thread was scheduled in, i.e., of its slices in the time range.
+    uint64_t context_switch_count = 0;
     std::string thread_name;
   };
 
@@ -42,6 +52,7 @@ class SchedulingStats {
     std::vector<ThreadStats*> thread_stats_sorted_by_time_on_core;
     int32_t pid = -1;
     uint64_t time_on_core_ns = 0;
+    uint64_t context_switch_count = 0;
     std::string process_name;
   };
 
@@ -70,6 +81,8 @@ class SchedulingStats {
   }
 
  private:
+  void SortProcessAndThreadStats(const ThreadNameProvider& thread_name_provider);
+
   double time_range_ms_ = 0;
   uint64_t time_on_core_ns_ = 0;
   std::map<int32_t, uint64_t> time_on_core_ns_by_core_;
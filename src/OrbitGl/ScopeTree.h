@@ -5,6 +5,7 @@
 #ifndef ORBIT_GL_SCOPE_TREE_H_
 #define ORBIT_GL_SCOPE_TREE_H_
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <vector>
@@ -20,6 +21,8 @@
 // goal is to be able to generate the scope tree with different streams of scope data that can
 // arrive out of order. The underlying scope type needs to define the "uint64_t Start()" and
 // "uint64_t End()" methods. Note that ScopeTree is not thread safe in its current implementation.
+// When all the scopes are known upfront, e.g. when a capture is loaded, InsertAll builds the same
+// tree in linear time after sorting, instead of searching the tree for every scope.
 
 template <typename ScopeT>
 class ScopeNode {
@@ -37,6 +40,7 @@ class ScopeNode {
   [[nodiscard]] ScopeNode* GetLastChildBeforeOrAtTime(uint64_t time) const;
   [[nodiscard]] std::vector<ScopeNode*> GetChildrenInRange(uint64_t start, uint64_t end) const;
   [[nodiscard]] const absl::btree_map<uint64_t, ScopeNode*>& GetChildrenByStartTime() const {
+    if (children_by_start_time_ == nullptr) return GetNoChildren();
     return *children_by_start_time_;
   }
 
@@ -50,6 +54,19 @@ class ScopeNode {
   ScopeT* GetScope() { return scope_; }
 
  private:
+  template <typename T>
+  friend class ScopeTree;
+
+  [[nodiscard]] static const absl::btree_map<uint64_t, ScopeNode*>& GetNoChildren() {
+    static const absl::btree_map<uint64_t, ScopeNode*> kNoChildren;
+    return kNoChildren;
+  }
+  [[nodiscard]] absl::btree_map<uint64_t, ScopeNode*>& GetOrCreateChildrenByStartTime() {
+    if (children_by_start_time_ == nullptr) {
+      children_by_start_time_ = std::make_unique<absl::btree_map<uint64_t, ScopeNode<ScopeT>*>>();
+    }
+    return *children_by_start_time_;
+  }
   [[nodiscard]] ScopeNode* FindDeepestParentForNode(const ScopeNode* node);
   static void ToString(const ScopeNode* node, std::string* str, uint32_t depth = 0);
   static void FindHeight(const ScopeNode* node, uint32_t* height, uint32_t current_height = 0);
@@ -62,8 +79,8 @@ class ScopeNode {
 
   // We use std::unique_ptr to work around an issue with absl::btree_map which complains about not
   // knowing the size of ScopeT, which is not needed since ScopeNode only stores a ScopeTree*.
-  std::unique_ptr<absl::btree_map<uint64_t, ScopeNode<ScopeT>*>> children_by_start_time_ =
-      std::make_unique<absl::btree_map<uint64_t, ScopeNode<ScopeT>*>>();
+  // The map is only allocated for nodes that have children, as most nodes are leaves.
+  std::unique_ptr<absl::btree_map<uint64_t, ScopeNode<ScopeT>*>> children_by_start_time_;
 };
 
 template <typename ScopeT>
@@ -71,6 +88,10 @@ class ScopeTree {
  public:
   ScopeTree();
   void Insert(ScopeT* scope);
+  // Inserts all of `scopes` at once. If the tree is empty, this sorts them and nests them with a
+  // stack of the enclosing scopes, which results in the same tree as inserting them one by one in
+  // the order of their start times.
+  void InsertAll(std::vector<ScopeT*> scopes);
   void Print() const { LOG("%s", ToString()); }
   std::string ToString() const;
 
@@ -117,6 +138,46 @@ void ScopeTree<ScopeT>::Insert(ScopeT* scope) {
   UpdateDepthInSubtree(new_node, new_node->Depth());
 }
 
+template <typename ScopeT>
+void ScopeTree<ScopeT>::InsertAll(std::vector<ScopeT*> scopes) {
+  ORBIT_SCOPE_FUNCTION;
+  if (Size() > 1) {
+    for (ScopeT* scope : scopes) {
+      Insert(scope);
+    }
+    return;
+  }
+
+  // Enclosing scopes come before the scopes they enclose.
+  const auto is_before = [](const ScopeT* lhs, const ScopeT* rhs) {
+    if (lhs->Start() != rhs->Start()) return lhs->Start() < rhs->Start();
+    return lhs->End() > rhs->End();
+  };
+  if (!std::is_sorted(scopes.begin(), scopes.end(), is_before)) {
+    std::stable_sort(scopes.begin(), scopes.end(), is_before);
+  }
+
+  // The stack is the path from the root to the last inserted node, which is the path that Insert
+  // would search for the parent. As the start times only increase and the children of a node are
+  // enclosed by it, the parent is the deepest node on that path that ends after the new scope, and
+  // none of the existing nodes can be enclosed by the new scope. So nodes are only ever appended
+  // to the maps.
+  std::vector<ScopeNodeT*> enclosing_nodes{root_};
+  for (ScopeT* scope : scopes) {
+    ScopeNodeT* node = CreateNode(scope);
+    while (enclosing_nodes.size() > 1 && enclosing_nodes.back()->End() < node->End()) {
+      enclosing_nodes.pop_back();
+    }
+    ScopeNodeT* parent_node = enclosing_nodes.back();
+    auto& siblings = parent_node->GetOrCreateChildrenByStartTime();
+    siblings.emplace_hint(siblings.end(), node->Start(), node);
+    node->SetDepth(parent_node->Depth() + 1);
+    auto& nodes_at_depth = ordered_nodes_by_depth_[node->Depth()];
+    nodes_at_depth.emplace_hint(nodes_at_depth.end(), node->Start(), node);
+    enclosing_nodes.push_back(node);
+  }
+}
+
 template <typename ScopeT>
 void ScopeTree<ScopeT>::UpdateDepthInSubtree(ScopeNodeT* node, uint32_t new_depth) {
   uint32_t previous_depth = node->Depth();
@@ -216,7 +277,7 @@ void ScopeNode<ScopeT>::GetAllNodesInSubtree(const ScopeNode* node,
 template <typename ScopeT>
 ScopeNode<ScopeT>* ScopeNode<ScopeT>::GetLastChildBeforeOrAtTime(uint64_t time) const {
   // Get first child before or exactly at "time".
-  if (children_by_start_time_->empty()) return nullptr;
+  if (children_by_start_time_ == nullptr || children_by_start_time_->empty()) return nullptr;
   auto next_node_it = children_by_start_time_->upper_bound(time);
   if (next_node_it == children_by_start_time_->begin()) return nullptr;
   return (--next_node_it)->second;
@@ -239,7 +300,7 @@ template <typename ScopeT>
 std::vector<ScopeNode<ScopeT>*> ScopeNode<ScopeT>::GetChildrenInRange(uint64_t start,
                                                                       uint64_t end) const {
   // Get children that are enclosed by start and end inclusively.
-  if (children_by_start_time_->empty()) return {};
+  if (children_by_start_time_ == nullptr || children_by_start_time_->empty()) return {};
   std::vector<ScopeNode*> nodes;
   for (auto node_it = children_by_start_time_->lower_bound(start);
        node_it != children_by_start_time_->end(); ++node_it) {
@@ -265,11 +326,11 @@ void ScopeNode<ScopeT>::Insert(ScopeNode<ScopeT>* node) {
   // Migrate current children of the parent that are encompassed by the new node to the new node.
   for (ScopeNode* encompassed_node : parent_node->GetChildrenInRange(node->Start(), node->End())) {
     parent_node->children_by_start_time_->erase(encompassed_node->Start());
-    node->children_by_start_time_->emplace(encompassed_node->Start(), encompassed_node);
+    node->GetOrCreateChildrenByStartTime().emplace(encompassed_node->Start(), encompassed_node);
   }
 
   // Add new node as child of parent_node.
-  parent_node->children_by_start_time_->emplace(node->Start(), node);
+  parent_node->GetOrCreateChildrenByStartTime().emplace(node->Start(), node);
 }
 
 #endif  // ORBIT_GL_SCOPE_TREE_H_
@@ -181,4 +181,54 @@ TEST(ScopeTree, OutOfOrderScopes) {
   }
 }
 
+TEST(ScopeTree, InsertAllBuildsTheSameTreeAsInsert) {
+  constexpr size_t kMaxNumNodes = 1024;
+  constexpr size_t kMaxDepth = 16;
+  constexpr size_t kNumSiblingsPerDepth = 4;
+  std::vector<TestScope*> test_scopes;
+  CreateNestedTestScopes(kMaxNumNodes, kMaxDepth, kNumSiblingsPerDepth, &test_scopes);
+  // Overlapping scopes, after all the others.
+  const uint64_t start = GetFakeTimeStamp();
+  test_scopes.push_back(CreateScope(start, start + 4));
+  test_scopes.push_back(CreateScope(start + 2, start + 7));
+  test_scopes.push_back(CreateScope(start + 1, start + 3));
+
+  ScopeTree<TestScope> reference_tree;
+  std::vector<TestScope*> sorted_scopes = test_scopes;
+  std::stable_sort(sorted_scopes.begin(), sorted_scopes.end(),
+                   [](const TestScope* lhs, const TestScope* rhs) {
+                     if (lhs->start != rhs->start) return lhs->start < rhs->start;
+                     return lhs->end > rhs->end;
+                   });
+  for (TestScope* scope : sorted_scopes) {
+    reference_tree.Insert(scope);
+  }
+
+  std::mt19937 gen(42);
+  std::shuffle(test_scopes.begin(), test_scopes.end(), gen);
+  ScopeTree<TestScope> tree;
+  tree.InsertAll(test_scopes);
+  ValidateTree(tree);
+  EXPECT_EQ(tree.Size(), reference_tree.Size());
+  EXPECT_EQ(tree.Height(), reference_tree.Height());
+  EXPECT_EQ(tree.ToString(), reference_tree.ToString());
+}
+
+TEST(ScopeTree, InsertAllWithSameTimestamps) {
+  ScopeTree<TestScope> tree;
+  tree.InsertAll({CreateScope(1, 10), CreateScope(1, 10), CreateScope(1, 100)});
+  EXPECT_EQ(tree.Height(), 3);
+  EXPECT_EQ(tree.Size(), 4);
+  ValidateTree(tree);
+}
+
+TEST(ScopeTree, InsertAllIntoNonEmptyTree) {
+  ScopeTree<TestScope> tree;
+  tree.Insert(CreateScope(1, 9));
+  tree.InsertAll({CreateScope(0, 10), CreateScope(2, 4)});
+  EXPECT_EQ(tree.Size(), 4);
+  EXPECT_EQ(tree.Height(), 3);
+  ValidateTree(tree);
+}
+
 }  // namespace
@@ -0,0 +1,81 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ServiceHealthTrack.h"
+
+#include <absl/strings/str_format.h>
+
+#include "CaptureClient/CaptureEventProcessor.h"
+
+namespace orbit_gl {
+
+namespace {
+
+using orbit_capture_client::CaptureEventProcessor;
+
+const std::array<std::string, kServiceHealthTrackDimension> kSeriesName = {
+    "Records read (thousands per second)", "Queued events (thousands)",
+    "Stack sample latency p99 (ms)", "Sent (MB per second)"};
+
+}  // namespace
+
+ServiceHealthTrack::ServiceHealthTrack(CaptureViewElement* parent, TimeGraph* time_graph,
+                                       orbit_gl::Viewport* viewport, TimeGraphLayout* layout,
+                                       const orbit_client_model::CaptureData* capture_data)
+    : LineGraphTrack<kServiceHealthTrackDimension>(parent, time_graph, viewport, layout,
+                                                   "Service health", kSeriesName, capture_data) {
+  constexpr uint8_t kTrackValueDecimalDigits = 2;
+  SetNumberOfDecimalDigits(kTrackValueDecimalDigits);
+
+  // Colors are selected from https://convertingcolors.com/list/avery.html.
+  const std::array<Color, kServiceHealthTrackDimension> kServiceHealthTrackColors{
+      Color(87, 166, 74, 255),   // green
+      Color(246, 196, 0, 255),   // orange
+      Color(231, 68, 53, 255),   // red
+      Color(60, 146, 241, 255),  // blue
+  };
+  SetSeriesColors(kServiceHealthTrackColors);
+}
+
+std::string ServiceHealthTrack::GetTooltip() const {
+  return "Shows how well the service keeps up with the events it collects: the records read per "
+         "second from the perf_event_open ring buffers, the events waiting to be processed in "
+         "order, the 99th percentile of the time from taking a stack sample to sending its "
+         "callstack, and the bandwidth used to send the capture.";
+}
+
+void ServiceHealthTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
+  auto get_register = [&timer_info](CaptureEventProcessor::ServiceHealthEncodingIndex index) {
+    return timer_info.registers(static_cast<size_t>(index));
+  };
+  const double duration_s = static_cast<double>(timer_info.end() - timer_info.start()) / 1e9;
+  if (duration_s <= 0) return;
+
+  const uint64_t total_bytes_sent =
+      get_register(CaptureEventProcessor::ServiceHealthEncodingIndex::kTotalBytesSent);
+  const uint64_t bytes_sent = total_bytes_sent >= previous_total_bytes_sent_
+                                  ? total_bytes_sent - previous_total_bytes_sent_
+                                  : 0;
+  previous_total_bytes_sent_ = total_bytes_sent;
+
+  constexpr double kThousand = 1000.0;
+  constexpr double kNsPerMs = 1'000'000.0;
+  constexpr double kBytesPerMegabyte = 1024.0 * 1024.0;
+  AddValues(
+      timer_info.start(),
+      {static_cast<double>(
+           get_register(CaptureEventProcessor::ServiceHealthEncodingIndex::kRecordCount)) /
+           kThousand / duration_s,
+       static_cast<double>(get_register(
+           CaptureEventProcessor::ServiceHealthEncodingIndex::kPerfEventQueueSize)) /
+           kThousand,
+       static_cast<double>(get_register(
+           CaptureEventProcessor::ServiceHealthEncodingIndex::kStackSampleLatencyP99Ns)) /
+           kNsPerMs,
+       static_cast<double>(bytes_sent) / kBytesPerMegabyte / duration_s});
+
+  LineGraphTrack<kServiceHealthTrackDimension>::OnTimer(timer_info);
+}
+
+}  // namespace orbit_gl
@@ -0,0 +1,46 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_SERVICE_HEALTH_TRACK_H_
+#define ORBIT_GL_SERVICE_HEALTH_TRACK_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "LineGraphTrack.h"
+#include "Viewport.h"
+#include "capture_data.pb.h"
+
+namespace orbit_gl {
+
+constexpr size_t kServiceHealthTrackDimension = 4;
+
+// This track displays how well the service keeps up with the perf_event_open events: the records
+// read per second from the ring buffers, the events waiting to be processed in order, the 99th
+// percentile of the latency of stack samples, and the bandwidth used to send the capture.
+class ServiceHealthTrack final : public LineGraphTrack<kServiceHealthTrackDimension> {
+ public:
+  explicit ServiceHealthTrack(CaptureViewElement* parent, TimeGraph* time_graph,
+                              orbit_gl::Viewport* viewport, TimeGraphLayout* layout,
+                              const orbit_client_model::CaptureData* capture_data);
+
+  [[nodiscard]] std::string GetTooltip() const override;
+
+  void OnTimer(const orbit_client_protos::TimerInfo& timer_info) override;
+
+  enum class SeriesIndex {
+    kThousandRecordsReadPerSecond = 0,
+    kThousandQueuedEvents = 1,
+    kStackSampleLatencyP99Ms = 2,
+    kMegabytesSentPerSecond = 3
+  };
+
+ private:
+  uint64_t previous_total_bytes_sent_ = 0;
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_SERVICE_HEALTH_TRACK_H_
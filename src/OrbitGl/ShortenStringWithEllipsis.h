@@ -33,7 +33,11 @@ inline std::string ShortenStringWithEllipsis(std::string_view text, size_t max_l
   }
 
   const size_t r = l + chars_to_cut;
-  return std::string(text.substr(0, l)) + "..." + std::string(text.substr(r));
+  // Builds the result in place, as this is called for each visible label.
+  std::string result;
+  result.reserve(max_len);
+  result.append(text.substr(0, l)).append("...").append(text.substr(r));
+  return result;
 }
 
 }  // namespace orbit_gl
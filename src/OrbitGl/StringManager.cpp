@@ -4,18 +4,25 @@
 
 #include "StringManager.h"
 
-#include <absl/container/flat_hash_map.h>
-#include <absl/strings/string_view.h>
-#include <absl/synchronization/mutex.h>
+#include <absl/hash/hash.h>
+
+#include <algorithm>
+#include <cstring>
 
 #include "OrbitBase/Logging.h"
 
 namespace orbit_gl {
 
+namespace {
+
+constexpr size_t kArenaBlockSize = 64 * 1024;
+constexpr size_t kMinTableCapacity = 64;
+
+}  // namespace
+
 // TODO(b/181207737): Make this assert that it is not present and rename to "Add".
 bool StringManager::AddIfNotPresent(uint64_t key, std::string_view str) {
-  absl::MutexLock lock{&mutex_};
-  bool inserted = key_to_string_.emplace(key, str).second;
+  bool inserted = Insert(key, str, /*replace=*/false);
   if (!inserted) {
     ERROR("String collision for key: %u and string: %s", key, str);
   }
@@ -23,28 +30,96 @@ bool StringManager::AddIfNotPresent(uint64_t key, std::string_view str) {
 }
 
 bool StringManager::AddOrReplace(uint64_t key, std::string_view str) {
-  absl::MutexLock lock{&mutex_};
-  bool inserted = key_to_string_.insert_or_assign(key, str).second;
-  return inserted;
+  return Insert(key, str, /*replace=*/true);
 }
 
-std::optional<std::string> StringManager::Get(uint64_t key) const {
+std::optional<std::string_view> StringManager::Get(uint64_t key) const {
+  const Table* table = table_.load(std::memory_order_acquire);
+  if (table == nullptr) return std::nullopt;
+  const Entry* entry = FindSlot(*table, key).load(std::memory_order_acquire);
+  if (entry == nullptr) return std::nullopt;
+  return entry->str;
+}
+
+bool StringManager::Contains(uint64_t key) const { return Get(key).has_value(); }
+
+void StringManager::Clear() {
   absl::MutexLock lock{&mutex_};
-  auto it = key_to_string_.find(key);
-  if (it != key_to_string_.end()) {
-    return it->second;
+  table_.store(nullptr, std::memory_order_release);
+  tables_.clear();
+  entries_.clear();
+  arena_blocks_.clear();
+  arena_position_ = nullptr;
+  arena_bytes_left_ = 0;
+  size_ = 0;
+}
+
+std::atomic<const StringManager::Entry*>& StringManager::FindSlot(const Table& table,
+                                                                   uint64_t key) {
+  // The table is never more than half full, so the probing always ends at an empty slot.
+  for (size_t index = absl::Hash<uint64_t>{}(key) & table.mask;; index = (index + 1) & table.mask) {
+    std::atomic<const Entry*>& slot = table.slots[index];
+    const Entry* entry = slot.load(std::memory_order_acquire);
+    if (entry == nullptr || entry->key == key) return slot;
   }
-  return std::nullopt;
 }
 
-bool StringManager::Contains(uint64_t key) const {
+bool StringManager::Insert(uint64_t key, std::string_view str, bool replace) {
   absl::MutexLock lock{&mutex_};
-  return key_to_string_.contains(key);
+  if (tables_.empty()) {
+    tables_.push_back(std::make_unique<Table>(kMinTableCapacity));
+    table_.store(tables_.back().get(), std::memory_order_release);
+  }
+
+  std::atomic<const Entry*>& slot = FindSlot(*tables_.back(), key);
+  const bool present = slot.load(std::memory_order_relaxed) != nullptr;
+  if (present && !replace) return false;
+
+  // Entries are immutable once published: replacing a string publishes a new entry in the same
+  // slot, so that readers see either the old or the new string but never a mix.
+  const Entry& entry = entries_.emplace_back(Entry{key, CopyToArena(str)});
+  slot.store(&entry, std::memory_order_release);
+  if (present) return false;
+
+  ++size_;
+  if (2 * size_ > tables_.back()->mask + 1) Grow();
+  return true;
 }
 
-void StringManager::Clear() {
-  absl::MutexLock lock{&mutex_};
-  key_to_string_.clear();
+std::string_view StringManager::CopyToArena(std::string_view str) {
+  if (str.empty()) return {};
+  if (str.size() > arena_bytes_left_) {
+    // Long strings get a block of their own, so that the rest of the current block can still be
+    // used.
+    if (str.size() > kArenaBlockSize / 4) {
+      arena_blocks_.push_back(std::make_unique<char[]>(str.size()));
+      std::memcpy(arena_blocks_.back().get(), str.data(), str.size());
+      return {arena_blocks_.back().get(), str.size()};
+    }
+    arena_blocks_.push_back(std::make_unique<char[]>(kArenaBlockSize));
+    arena_position_ = arena_blocks_.back().get();
+    arena_bytes_left_ = kArenaBlockSize;
+  }
+
+  std::memcpy(arena_position_, str.data(), str.size());
+  std::string_view copy{arena_position_, str.size()};
+  arena_position_ += str.size();
+  arena_bytes_left_ -= str.size();
+  return copy;
+}
+
+void StringManager::Grow() {
+  const Table& old_table = *tables_.back();
+  auto new_table = std::make_unique<Table>(2 * (old_table.mask + 1));
+  for (size_t index = 0; index <= old_table.mask; ++index) {
+    const Entry* entry = old_table.slots[index].load(std::memory_order_relaxed);
+    if (entry == nullptr) continue;
+    FindSlot(*new_table, entry->key).store(entry, std::memory_order_relaxed);
+  }
+
+  // Readers can still be probing the old table, so it's only freed by Clear.
+  table_.store(new_table.get(), std::memory_order_release);
+  tables_.push_back(std::move(new_table));
 }
 
 }  // namespace orbit_gl
@@ -5,34 +5,83 @@
 #ifndef ORBIT_GL_STRING_MANAGER_H_
 #define ORBIT_GL_STRING_MANAGER_H_
 
-#include <absl/container/flat_hash_map.h>
 #include <absl/synchronization/mutex.h>
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <optional>
-#include <string>
 #include <string_view>
+#include <vector>
 
 namespace orbit_gl {
 
-// This class is a thread-safe wrapper around `absl::flat_hash_map<uint64_t, std::string>`.
+// A map from uint64_t keys to strings, e.g., from the keys that interned strings are sent with,
+// that is mostly read, e.g., to label every timer that is drawn, while it is written to from the
+// capture thread.
+//
+// The strings are copied into an append-only arena and never move, so Get returns a view of the
+// stored string instead of a copy. The map itself is an open-addressing hash table of pointers to
+// immutable entries: a writer publishes an entry with a single release store, while a reader only
+// needs acquire loads. When the table grows, a larger copy is published and the old one is kept
+// alive, so that concurrent readers can finish their lookup in it.
+//
+// Thread-Safety: AddIfNotPresent, AddOrReplace, Get and Contains can be called concurrently.
+// Writers are serialized by a mutex that readers never take. Clear invalidates all the views
+// returned by Get and must not be called concurrently with the other methods.
 class StringManager {
  public:
   StringManager() = default;
+  StringManager(const StringManager&) = delete;
+  StringManager& operator=(const StringManager&) = delete;
 
   // Returns true if insertion took place.
   bool AddIfNotPresent(uint64_t key, std::string_view str);
-  // Returns true if a new insertion took place, false if the value was replaced.
+  // Returns true if a new insertion took place, false if the value was replaced. A view of the
+  // replaced value returned by Get stays valid.
   bool AddOrReplace(uint64_t key, std::string_view str);
 
-  [[nodiscard]] std::optional<std::string> Get(uint64_t key) const;
+  // The returned view is valid until Clear is called.
+  [[nodiscard]] std::optional<std::string_view> Get(uint64_t key) const;
   [[nodiscard]] bool Contains(uint64_t key) const;
 
   void Clear();
 
  private:
-  absl::flat_hash_map<uint64_t, std::string> key_to_string_;
-  mutable absl::Mutex mutex_;
+  struct Entry {
+    uint64_t key;
+    std::string_view str;
+  };
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : slots{std::make_unique<std::atomic<const Entry*>[]>(capacity)}, mask{capacity - 1} {}
+    std::unique_ptr<std::atomic<const Entry*>[]> slots;
+    size_t mask;
+  };
+
+  // Returns the slot that holds the entry with `key` or, if there is none, the empty slot where it
+  // would be inserted.
+  [[nodiscard]] static std::atomic<const Entry*>& FindSlot(const Table& table, uint64_t key);
+
+  // Returns false if an entry with `key` already exists and `replace` is false.
+  [[nodiscard]] bool Insert(uint64_t key, std::string_view str, bool replace);
+  [[nodiscard]] std::string_view CopyToArena(std::string_view str)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void Grow() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<char[]>> arena_blocks_ ABSL_GUARDED_BY(mutex_);
+  char* arena_position_ ABSL_GUARDED_BY(mutex_) = nullptr;
+  size_t arena_bytes_left_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::deque<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // The tables that were published, the last one being the current one.
+  std::vector<std::unique_ptr<Table>> tables_ ABSL_GUARDED_BY(mutex_);
+  size_t size_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  std::atomic<const Table*> table_{nullptr};
 };
 
 }  // namespace orbit_gl
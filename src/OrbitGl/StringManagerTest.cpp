@@ -2,8 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/strings/str_cat.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
 #include "StringManager.h"
 
 namespace orbit_gl {
@@ -56,4 +64,60 @@ TEST(StringManager, Clear) {
   EXPECT_FALSE(string_manager.Contains(1));
 }
 
+TEST(StringManager, ViewsStayValidWhenReplacedOrGrowing) {
+  StringManager string_manager;
+  string_manager.AddIfNotPresent(0, "test1");
+  std::string_view view = string_manager.Get(0).value();
+  string_manager.AddOrReplace(0, "test2");
+
+  constexpr uint64_t kStringCount = 10'000;
+  for (uint64_t key = 1; key <= kStringCount; ++key) {
+    EXPECT_TRUE(string_manager.AddIfNotPresent(key, absl::StrCat("string", key)));
+  }
+
+  EXPECT_EQ(view, "test1");
+  EXPECT_EQ("test2", string_manager.Get(0).value_or("no value"));
+  for (uint64_t key = 1; key <= kStringCount; ++key) {
+    EXPECT_EQ(absl::StrCat("string", key), string_manager.Get(key).value_or("no value"));
+  }
+  EXPECT_FALSE(string_manager.Contains(kStringCount + 1));
+}
+
+TEST(StringManager, EmptyAndLongStrings) {
+  StringManager string_manager;
+  const std::string long_string(1'000'000, 'a');
+  string_manager.AddIfNotPresent(0, "");
+  string_manager.AddIfNotPresent(1, long_string);
+  string_manager.AddIfNotPresent(2, "test");
+
+  EXPECT_TRUE(string_manager.Contains(0));
+  EXPECT_EQ("", string_manager.Get(0).value_or("no value"));
+  EXPECT_EQ(long_string, string_manager.Get(1).value_or("no value"));
+  EXPECT_EQ("test", string_manager.Get(2).value_or("no value"));
+}
+
+TEST(StringManager, GetWhileAdding) {
+  StringManager string_manager;
+  constexpr uint64_t kStringCount = 100'000;
+  std::atomic<uint64_t> added_count = 0;
+
+  std::thread writer{[&string_manager, &added_count] {
+    for (uint64_t key = 0; key < kStringCount; ++key) {
+      string_manager.AddIfNotPresent(key, absl::StrCat("string", key));
+      added_count.store(key + 1, std::memory_order_release);
+    }
+  }};
+
+  uint64_t checked_count = 0;
+  while (checked_count < kStringCount) {
+    const uint64_t count = added_count.load(std::memory_order_acquire);
+    for (; checked_count < count; ++checked_count) {
+      std::optional<std::string_view> str = string_manager.Get(checked_count);
+      ASSERT_TRUE(str.has_value());
+      EXPECT_EQ(str.value(), absl::StrCat("string", checked_count));
+    }
+  }
+  writer.join();
+}
+
 }  // namespace orbit_gl
@@ -33,6 +33,11 @@ struct vertex_t {
 
 bool TextRenderer::draw_outline_ = false;
 
+namespace {
+// Set by TextRenderer::StartRecordingOnlyOnThisThread.
+thread_local TextRendererRecording* recording_only_on_this_thread = nullptr;
+}  // namespace
+
 TextRenderer::TextRenderer()
     : texture_atlas_(nullptr),
       texture_atlas_changed_(false),
@@ -126,6 +131,35 @@ ftgl::texture_glyph_t* TextRenderer::MaybeLoadAndGetGlyph(ftgl::texture_font_t*
   return texture_font_get_glyph(font, character);
 }
 
+const std::vector<TextRenderer::CachedGlyph>& TextRenderer::GetGlyphs(ftgl::texture_font_t* font,
+                                                                     absl::string_view text) {
+  // Most texts are drawn again in the next frame, but e.g. the ones of timers change when zooming,
+  // so the cache is dropped when it has grown too large instead of tracking which texts are used.
+  constexpr size_t kMaxNumberOfCachedTexts = 16 * 1024;
+
+  auto font_it = glyphs_by_text_by_font_.find(font);
+  if (font_it != glyphs_by_text_by_font_.end()) {
+    auto text_it = font_it->second.find(text);
+    if (text_it != font_it->second.end()) return text_it->second;
+  }
+
+  if (number_of_cached_texts_ >= kMaxNumberOfCachedTexts) {
+    glyphs_by_text_by_font_.clear();
+    number_of_cached_texts_ = 0;
+  }
+
+  std::vector<CachedGlyph> glyphs(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text.data() + i);
+    glyphs[i].glyph = glyph;
+    if (glyph != nullptr && i > 0) {
+      glyphs[i].kerning = texture_glyph_get_kerning(glyph, text.data() + i - 1);
+    }
+  }
+  ++number_of_cached_texts_;
+  return glyphs_by_text_by_font_[font].emplace(std::string(text), std::move(glyphs)).first->second;
+}
+
 void TextRenderer::RenderLayer(float layer) {
   ORBIT_SCOPE_FUNCTION;
   if (vertex_buffers_by_layer_.count(layer) == 0) return;
@@ -225,17 +259,18 @@ void TextRenderer::AddTextInternal(ftgl::texture_font_t* font, const char* text,
   constexpr std::array<GLuint, 6> kIndices = {0, 1, 2, 0, 2, 3};
   ftgl::vec2 initial_pen = *pen;
 
-  for (size_t i = 0; i < strlen(text); ++i) {
+  ftgl::vertex_buffer_t* vertex_buffer = nullptr;
+  const std::vector<CachedGlyph>& glyphs = GetGlyphs(font, text);
+  for (size_t i = 0; i < glyphs.size(); ++i) {
     if (text[i] == '\n') {
       pen->x = initial_pen.x;
       pen->y -= font->height;
       continue;
     }
 
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+    const ftgl::texture_glyph_t* glyph = glyphs[i].glyph;
     if (glyph != nullptr) {
-      float kerning = (i == 0) ? 0.0f : texture_glyph_get_kerning(glyph, text + i - 1);
-      pen->x += kerning;
+      pen->x += glyphs[i].kerning;
 
       float x0 = floorf(pen->x + glyph->offset_x);
       float y0 = floorf(pen->y + glyph->offset_y);
@@ -262,10 +297,14 @@ void TextRenderer::AddTextInternal(ftgl::texture_font_t* font, const char* text,
       if (str_width > max_width) {
         break;
       }
-      if (!vertex_buffers_by_layer_.count(z)) {
-        vertex_buffers_by_layer_[z] = ftgl::vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
+      if (vertex_buffer == nullptr) {
+        ftgl::vertex_buffer_t*& layer_buffer = vertex_buffers_by_layer_[z];
+        if (layer_buffer == nullptr) {
+          layer_buffer = ftgl::vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
+        }
+        vertex_buffer = layer_buffer;
       }
-      vertex_buffer_push_back(vertex_buffers_by_layer_.at(z), vertices, 4, kIndices.data(), 6);
+      vertex_buffer_push_back(vertex_buffer, vertices, 4, kIndices.data(), 6);
       pen->x += glyph->advance_x;
     }
   }
@@ -285,6 +324,24 @@ void TextRenderer::AddText(const char* text, float x, float y, float z, const Co
                            uint32_t font_size, float max_size, bool right_justified,
                            Vec2* out_text_pos, Vec2* out_text_size) {
   if (!font_size) return;
+  if (recording_only_on_this_thread != nullptr) {
+    // The layout is only known once the recording is replayed.
+    CHECK(out_text_pos == nullptr && out_text_size == nullptr);
+    recording_only_on_this_thread->texts.push_back(
+        {text, x, y, z, color, font_size, max_size, right_justified});
+    return;
+  }
+  if (recording_ != nullptr) {
+    recording_->texts.push_back({text, x, y, z, color, font_size, max_size, right_justified});
+  }
+  LayOutText(text, x, y, z, color, font_size, max_size, right_justified, out_text_pos,
+             out_text_size);
+}
+
+void TextRenderer::LayOutText(const char* text, float x, float y, float z, const Color& color,
+                              uint32_t font_size, float max_size, bool right_justified,
+                              Vec2* out_text_pos, Vec2* out_text_size) {
+  if (!font_size) return;
   ToScreenSpace(x, y, pen_.x, pen_.y);
 
   if (right_justified) {
@@ -314,6 +371,25 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
                                                     const Color& color,
                                                     size_t trailing_chars_length,
                                                     uint32_t font_size, float max_size) {
+  // Which characters fit depends on the layout, so the call is recorded rather than its text.
+  if (recording_only_on_this_thread != nullptr) {
+    recording_only_on_this_thread->texts.push_back({text, x, y, z, color, font_size, max_size,
+                                                    /*right_justified=*/false,
+                                                    trailing_chars_length});
+    return 0.f;
+  }
+  if (recording_ != nullptr) {
+    recording_->texts.push_back({text, x, y, z, color, font_size, max_size,
+                                 /*right_justified=*/false, trailing_chars_length});
+  }
+  return LayOutTextTrailingCharsPrioritized(text, x, y, z, color, trailing_chars_length, font_size,
+                                            max_size);
+}
+
+float TextRenderer::LayOutTextTrailingCharsPrioritized(const char* text, float x, float y, float z,
+                                                       const Color& color,
+                                                       size_t trailing_chars_length,
+                                                       uint32_t font_size, float max_size) {
   if (!initialized_) {
     Init();
   }
@@ -324,17 +400,13 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
   int min_x = INT_MAX;
   int max_x = -INT_MAX;
 
-  const size_t text_length = strlen(text);
-  ftgl::texture_font_t* font = GetFont(font_size);
+  const std::vector<CachedGlyph>& glyphs = GetGlyphs(GetFont(font_size), text);
+  const size_t text_length = glyphs.size();
   size_t i;
   for (i = 0; i < text_length; ++i) {
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+    const ftgl::texture_glyph_t* glyph = glyphs[i].glyph;
     if (glyph != nullptr) {
-      float kerning = 0.0f;
-      if (i > 0) {
-        kerning = texture_glyph_get_kerning(glyph, text + i - 1);
-      }
-      temp_pen_x += kerning;
+      temp_pen_x += glyphs[i].kerning;
       int x0 = static_cast<int>(temp_pen_x + glyph->offset_x);
       int x1 = static_cast<int>(x0 + glyph->width);
 
@@ -364,7 +436,7 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
                            (fitting_chars_count > (trailing_chars_length + kEllipsisBufferSize));
 
   if (!use_ellipsis_text) {
-    AddText(text, x, y, z, color, font_size, max_size);
+    LayOutText(text, x, y, z, color, font_size, max_size);
     return GetStringWidth(text, font_size);
   }
 
@@ -376,7 +448,7 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
   auto time_position = text_length - trailing_chars_length;
   modified_text.append(&text[time_position], trailing_chars_length);
 
-  AddText(modified_text.c_str(), x, y, z, color, font_size, max_size);
+  LayOutText(modified_text.c_str(), x, y, z, color, font_size, max_size);
   return GetStringWidth(modified_text.c_str(), font_size);
 }
 
@@ -391,17 +463,11 @@ float TextRenderer::GetStringHeight(const char* text, uint32_t font_size) {
 int TextRenderer::GetStringWidthScreenSpace(const char* text, uint32_t font_size) {
   float string_width = 0;
 
-  std::size_t len = strlen(text);
-  for (std::size_t i = 0; i < len; ++i) {
-    ftgl::texture_font_t* font = GetFont(font_size);
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+  const std::vector<CachedGlyph>& glyphs = GetGlyphs(GetFont(font_size), text);
+  for (std::size_t i = 0; i < glyphs.size(); ++i) {
+    const ftgl::texture_glyph_t* glyph = glyphs[i].glyph;
     if (glyph != nullptr) {
-      float kerning = 0.0f;
-      if (i > 0) {
-        kerning = texture_glyph_get_kerning(glyph, text + i - 1);
-      }
-
-      string_width += kerning;
+      string_width += glyphs[i].kerning;
       string_width += glyph->advance_x;
     }
 
@@ -414,9 +480,9 @@ int TextRenderer::GetStringWidthScreenSpace(const char* text, uint32_t font_size
 
 int TextRenderer::GetStringHeightScreenSpace(const char* text, uint32_t font_size) {
   int max_height = 0.f;
-  ftgl::texture_font_t* font = GetFont(font_size);
-  for (std::size_t i = 0; i < strlen(text); ++i) {
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+  const std::vector<CachedGlyph>& glyphs = GetGlyphs(GetFont(font_size), text);
+  for (std::size_t i = 0; i < glyphs.size(); ++i) {
+    const ftgl::texture_glyph_t* glyph = glyphs[i].glyph;
     if (glyph != nullptr) {
       max_height = std::max(max_height, glyph->offset_y);
     }
@@ -449,6 +515,50 @@ float TextRenderer::ToScreenSpace(float width) {
   return (width / viewport_->GetVisibleWorldWidth()) * viewport_->GetScreenWidth();
 }
 
+void TextRenderer::StartRecording(TextRendererRecording* recording) {
+  CHECK(recording != nullptr);
+  CHECK(recording_ == nullptr);
+  recording->texts.clear();
+  recording_ = recording;
+}
+
+void TextRenderer::ContinueRecording(TextRendererRecording* recording) {
+  CHECK(recording != nullptr);
+  CHECK(recording_ == nullptr);
+  recording_ = recording;
+}
+
+void TextRenderer::StopRecording() {
+  CHECK(recording_ != nullptr);
+  recording_ = nullptr;
+}
+
+void TextRenderer::StartRecordingOnlyOnThisThread(TextRendererRecording* recording) {
+  CHECK(recording != nullptr);
+  CHECK(recording_only_on_this_thread == nullptr);
+  recording->texts.clear();
+  recording_only_on_this_thread = recording;
+}
+
+void TextRenderer::StopRecordingOnlyOnThisThread() {
+  CHECK(recording_only_on_this_thread != nullptr);
+  recording_only_on_this_thread = nullptr;
+}
+
+void TextRenderer::Replay(const TextRendererRecording& recording) {
+  CHECK(recording_ == nullptr);
+  for (const TextRendererRecording::RecordedText& text : recording.texts) {
+    if (text.trailing_chars_length.has_value()) {
+      LayOutTextTrailingCharsPrioritized(text.text.c_str(), text.x, text.y, text.z, text.color,
+                                         text.trailing_chars_length.value(), text.font_size,
+                                         text.max_size);
+    } else {
+      LayOutText(text.text.c_str(), text.x, text.y, text.z, text.color, text.font_size,
+                 text.max_size, text.right_justified);
+    }
+  }
+}
+
 void TextRenderer::Clear() {
   pen_.x = 0.f;
   pen_.y = 0.f;
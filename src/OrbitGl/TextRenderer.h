@@ -6,6 +6,8 @@
 #define ORBIT_GL_TEXT_RENDERER_H_
 
 #include <GteVector.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/string_view.h>
 #include <freetype-gl/mat4.h>
 #include <freetype-gl/texture-atlas.h>
 #include <freetype-gl/texture-font.h>
@@ -15,7 +17,8 @@
 #include <stdint.h>
 
 #include <map>
-#include <unordered_map>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "Batcher.h"
@@ -28,6 +31,30 @@ struct vertex_buffer_t;
 struct texture_font_t;
 }  // namespace ftgl
 
+// The texts added to a TextRenderer between TextRenderer::StartRecording and
+// TextRenderer::StopRecording. Positions are in world coordinates, so replaying the texts lays
+// them out again for the current viewport.
+struct TextRendererRecording {
+  struct RecordedText {
+    std::string text;
+    float x;
+    float y;
+    float z;
+    Color color;
+    uint32_t font_size;
+    float max_size;
+    bool right_justified;
+    // Set for texts added with TextRenderer::AddTextTrailingCharsPrioritized.
+    std::optional<size_t> trailing_chars_length;
+  };
+
+  std::vector<RecordedText> texts;
+
+  void TranslateX(float offset_x) {
+    for (RecordedText& text : texts) text.x += offset_x;
+  }
+};
+
 class TextRenderer {
  public:
   explicit TextRenderer();
@@ -49,6 +76,21 @@ class TextRenderer {
                                         const Color& color, size_t trailing_chars_length,
                                         uint32_t font_size, float max_size);
 
+  // Until StopRecording is called, the texts that are added are also added to `recording`, which
+  // is cleared first.
+  void StartRecording(TextRendererRecording* recording);
+  // Like StartRecording, but the texts are appended to the ones `recording` already has.
+  void ContinueRecording(TextRendererRecording* recording);
+  void StopRecording();
+  void Replay(const TextRendererRecording& recording);
+
+  // Until StopRecordingOnlyOnThisThread is called, the texts that are added to any TextRenderer on
+  // the calling thread are only added to `recording`, which is cleared first, and laid out when
+  // it is replayed. This allows generating texts on threads other than the one that renders them.
+  // Meanwhile, AddTextTrailingCharsPrioritized returns 0, and AddText can't return the layout.
+  static void StartRecordingOnlyOnThisThread(TextRendererRecording* recording);
+  static void StopRecordingOnlyOnThisThread();
+
   [[nodiscard]] float GetStringWidth(const char* text, uint32_t font_size);
   [[nodiscard]] float GetStringHeight(const char* text, uint32_t font_size);
 
@@ -59,6 +101,13 @@ class TextRenderer {
                        ftgl::vec2* pen, float max_size = -1.f, float z = -0.01f,
                        ftgl::vec2* out_text_pos = nullptr, ftgl::vec2* out_text_size = nullptr);
 
+  void LayOutText(const char* text, float x, float y, float z, const Color& color,
+                  uint32_t font_size, float max_size = -1.f, bool right_justified = false,
+                  Vec2* out_text_pos = nullptr, Vec2* out_text_size = nullptr);
+  float LayOutTextTrailingCharsPrioritized(const char* text, float x, float y, float z,
+                                           const Color& color, size_t trailing_chars_length,
+                                           uint32_t font_size, float max_size);
+
   void ToScreenSpace(float x, float y, float& o_x, float& o_y);
   [[nodiscard]] float ToScreenSpace(float width);
   [[nodiscard]] int GetStringWidthScreenSpace(const char* text, uint32_t font_size);
@@ -67,6 +116,16 @@ class TextRenderer {
   [[nodiscard]] ftgl::texture_glyph_t* MaybeLoadAndGetGlyph(ftgl::texture_font_t* self,
                                                             const char* character);
 
+  // The glyph, if any, of each byte of a text, and its kerning with the previous byte.
+  struct CachedGlyph {
+    const ftgl::texture_glyph_t* glyph = nullptr;
+    float kerning = 0.f;
+  };
+  // Looking up glyphs and kernings in freetype-gl is slow, and the same texts are drawn every
+  // frame, so the results are cached.
+  [[nodiscard]] const std::vector<CachedGlyph>& GetGlyphs(ftgl::texture_font_t* font,
+                                                          absl::string_view text);
+
   void DrawOutline(Batcher* batcher, ftgl::vertex_buffer_t* buffer);
 
  private:
@@ -75,8 +134,12 @@ class TextRenderer {
   // texture data. Only freetype-gl's texture_font_load_glyph modifies the texture atlas,
   // so we need to set this to true when and only when we call that function.
   bool texture_atlas_changed_;
-  std::unordered_map<float, ftgl::vertex_buffer_t*> vertex_buffers_by_layer_;
+  std::map<float, ftgl::vertex_buffer_t*> vertex_buffers_by_layer_;
   std::map<uint32_t, ftgl::texture_font_t*> fonts_by_size_;
+  absl::flat_hash_map<const ftgl::texture_font_t*,
+                      absl::flat_hash_map<std::string, std::vector<CachedGlyph>>>
+      glyphs_by_text_by_font_;
+  size_t number_of_cached_texts_ = 0;
   orbit_gl::Viewport* viewport_;
   GLuint shader_;
   ftgl::mat4 model_;
@@ -84,6 +147,7 @@ class TextRenderer {
   ftgl::mat4 projection_;
   ftgl::vec2 pen_;
   bool initialized_;
+  TextRendererRecording* recording_ = nullptr;
   static bool draw_outline_;
 };
 
@@ -4,8 +4,13 @@
 
 #include "ThreadBar.h"
 
+#include <algorithm>
+
 #include "AccessibleThreadBar.h"
+#include "Geometry.h"
+#include "TimeGraph.h"
 #include "Track.h"
+#include "Viewport.h"
 
 namespace orbit_gl {
 
@@ -13,4 +18,47 @@ std::unique_ptr<orbit_accessibility::AccessibleInterface> ThreadBar::CreateAcces
   return std::make_unique<AccessibleThreadBar>(this);
 }
 
+uint64_t ThreadBar::GetNsPerPixel() const {
+  const int screen_width = viewport_->GetScreenWidth();
+  if (screen_width <= 0) return 0;
+  return static_cast<uint64_t>(1000 * time_graph_->GetTimeWindowUs()) / screen_width;
+}
+
+bool ThreadBar::HasPixelWithSeveralEvents(const std::vector<uint32_t>& counts) {
+  return std::any_of(counts.begin(), counts.end(), [](uint32_t count) { return count > 1; });
+}
+
+void ThreadBar::DrawEventDensity(Batcher* batcher, uint64_t min_tick, uint64_t ns_per_pixel,
+                                 const std::vector<uint32_t>& counts, float z, const Color& color,
+                                 PickingMode picking_mode,
+                                 const std::function<std::string(uint32_t)>& get_tooltip) {
+  const auto max_count_it = std::max_element(counts.begin(), counts.end());
+  if (max_count_it == counts.end() || *max_count_it == 0) return;
+  const uint32_t max_count = *max_count_it;
+
+  // Pixels with a single event stay visible.
+  constexpr uint32_t kMinAlpha = 64;
+  const uint32_t max_alpha = std::max<uint32_t>(color[3], kMinAlpha);
+  const float track_height = layout_->GetEventTrackHeight();
+  for (size_t i = 0; i < counts.size(); ++i) {
+    const uint32_t count = counts[i];
+    if (count == 0) continue;
+    const uint64_t pixel_min_tick = min_tick + i * ns_per_pixel;
+    const float x0 = time_graph_->GetWorldFromTick(pixel_min_tick);
+    const float x1 = time_graph_->GetWorldFromTick(pixel_min_tick + ns_per_pixel);
+    Color pixel_color = color;
+    pixel_color[3] = static_cast<unsigned char>(
+        kMinAlpha + (max_alpha - kMinAlpha) * static_cast<uint64_t>(count) / max_count);
+    Box box(Vec2(x0, pos_[1] - track_height + 1), Vec2(x1 - x0, track_height), z);
+    if (picking_mode == PickingMode::kNone) {
+      batcher->AddBox(box, pixel_color);
+    } else {
+      batcher->AddBox(box, pixel_color,
+                      PickingUserData(nullptr, [get_tooltip, count](PickingId /*id*/) {
+                        return get_tooltip(count);
+                      }));
+    }
+  }
+}
+
 }  // namespace orbit_gl
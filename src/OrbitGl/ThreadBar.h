@@ -5,12 +5,20 @@
 #ifndef ORBIT_GL_THREAD_BAR_H_
 #define ORBIT_GL_THREAD_BAR_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "Batcher.h"
 #include "CaptureViewElement.h"
 #include "ClientModel/CaptureData.h"
+#include "CoreMath.h"
+#include "PickingManager.h"
 #include "TimeGraphLayout.h"
 
 class OrbitApp;
@@ -38,6 +46,24 @@ class ThreadBar : public CaptureViewElement, public std::enable_shared_from_this
   [[nodiscard]] std::unique_ptr<orbit_accessibility::AccessibleInterface>
   CreateAccessibleInterface() override;
 
+  // When zoomed out so far that several events fall into the same pixel, the bars draw their
+  // events as a strip with one box per pixel, more opaque the more events the pixel has, instead of
+  // one primitive per event. Returns 0 if the time window is too short to be split into pixels, in
+  // which case the events are always drawn individually.
+  [[nodiscard]] uint64_t GetNsPerPixel() const;
+  [[nodiscard]] static size_t GetPixelCount(uint64_t min_tick, uint64_t max_tick,
+                                            uint64_t ns_per_pixel) {
+    return (max_tick - min_tick) / ns_per_pixel + 1;
+  }
+  [[nodiscard]] static bool HasPixelWithSeveralEvents(const std::vector<uint32_t>& counts);
+  // Draws the strip of `counts`, where counts[i] is the number of events in
+  // [min_tick + i * ns_per_pixel, min_tick + (i + 1) * ns_per_pixel). When picking, the tooltip of
+  // a box is `get_tooltip` of its count.
+  void DrawEventDensity(Batcher* batcher, uint64_t min_tick, uint64_t ns_per_pixel,
+                        const std::vector<uint32_t>& counts, float z, const Color& color,
+                        PickingMode picking_mode,
+                        const std::function<std::string(uint32_t)>& get_tooltip);
+
   orbit_client_data::ThreadID thread_id_ = -1;
   OrbitApp* app_;
   const orbit_client_model::CaptureData* capture_data_;
@@ -192,10 +192,10 @@ void ThreadStateBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint6
 
         const Color color = GetThreadStateColor(slice.thread_state());
 
-        auto user_data = std::make_unique<PickingUserData>(nullptr, [&, batcher](PickingId id) {
+        PickingUserData user_data(nullptr, [this, batcher](PickingId id) {
           return GetThreadStateSliceTooltip(batcher, id);
         });
-        user_data->custom_data_ = &slice;
+        user_data.custom_data_ = &slice;
 
         if (slice.end_timestamp_ns() - slice.begin_timestamp_ns() > pixel_delta_ns) {
           Box box(pos, size, GlCanvas::kZValueEvent + z_offset);
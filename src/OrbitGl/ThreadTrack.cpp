@@ -12,10 +12,15 @@
 #include <algorithm>
 #include <atomic>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "App.h"
 #include "Batcher.h"
 #include "ClientData/FunctionUtils.h"
+#include "ClientData/PackedTimerInfo.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
 #include "ClientModel/CaptureData.h"
@@ -32,11 +37,25 @@
 #include "TriangleToggle.h"
 #include "Viewport.h"
 
+using orbit_client_data::PackedTimerInfo;
 using orbit_client_model::CaptureData;
 using orbit_client_protos::FunctionInfo;
 using orbit_client_protos::TimerInfo;
 using orbit_grpc_protos::InstrumentedFunction;
 
+// The events of the manual instrumentation API that liborbit sends with interned names carry the
+// key of the full name in user_data_key, while the name encoded in the registers is truncated.
+static std::string GetManualInstrumentationName(OrbitApp* app, const TimerInfo& timer_info) {
+  if (timer_info.type() == TimerInfo::kApiEvent && timer_info.user_data_key() != 0) {
+    std::optional<std::string_view> name =
+        app->GetStringManager()->Get(timer_info.user_data_key());
+    if (name.has_value()) {
+      return std::string{name.value()};
+    }
+  }
+  return ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info).name;
+}
+
 ThreadTrack::ThreadTrack(CaptureViewElement* parent, TimeGraph* time_graph,
                          orbit_gl::Viewport* viewport, TimeGraphLayout* layout, int32_t thread_id,
                          OrbitApp* app, const CaptureData* capture_data,
@@ -86,7 +105,7 @@ void ThreadTrack::InitializeNameAndLabel(int32_t thread_id) {
 
 const orbit_client_data::TextBox* ThreadTrack::GetLeft(
     const orbit_client_data::TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
   if (timer_info.thread_id() == thread_id_) {
     std::shared_ptr<orbit_client_data::TimerChain> timers = GetTimers(timer_info.depth());
     if (timers) return timers->GetElementBefore(text_box);
@@ -96,7 +115,7 @@ const orbit_client_data::TextBox* ThreadTrack::GetLeft(
 
 const orbit_client_data::TextBox* ThreadTrack::GetRight(
     const orbit_client_data::TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
   if (timer_info.thread_id() == thread_id_) {
     std::shared_ptr<orbit_client_data::TimerChain> timers = GetTimers(timer_info.depth());
     if (timers) return timers->GetElementAfter(text_box);
@@ -106,7 +125,7 @@ const orbit_client_data::TextBox* ThreadTrack::GetRight(
 
 std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) const {
   const orbit_client_data::TextBox* text_box = batcher.GetTextBox(id);
-  if (!text_box || text_box->GetTimerInfo().type() == TimerInfo::kCoreActivity) {
+  if (!text_box || text_box->GetPackedTimerInfo().type() == TimerInfo::kCoreActivity) {
     return "";
   }
 
@@ -129,8 +148,7 @@ std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) con
   }
 
   if (is_manual) {
-    auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
-    function_name = api_event.name;
+    function_name = GetManualInstrumentationName(app_, timer_info);
   } else {
     function_name = func->function_name();
   }
@@ -147,8 +165,7 @@ std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) con
       "<b>Module:</b> %s<br/>"
       "<b>Time:</b> %s",
       function_name, is_manual ? "manual" : "dynamic", module_name,
-      orbit_display_formats::GetDisplayTime(
-          TicksToDuration(text_box->GetTimerInfo().start(), text_box->GetTimerInfo().end())));
+      orbit_display_formats::GetDisplayTime(TicksToDuration(text_box->Start(), text_box->End())));
 }
 
 bool ThreadTrack::IsTimerActive(const TimerInfo& timer_info) const {
@@ -357,10 +374,9 @@ void ThreadTrack::SetTimesliceText(const TimerInfo& timer_info, float min_x, flo
       std::string text = absl::StrFormat("%s %s", api_event.name, time.c_str());
       text_box->SetText(text);
     } else if (timer_info.type() == TimerInfo::kApiEvent) {
-      auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
+      std::string name = GetManualInstrumentationName(app_, timer_info);
       std::string extra_info = GetExtraInfo(timer_info);
-      std::string text =
-          absl::StrFormat("%s %s %s", api_event.name, extra_info.c_str(), time.c_str());
+      std::string text = absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
       text_box->SetText(text);
     } else {
       ERROR(
@@ -433,7 +449,9 @@ float ThreadTrack::GetYFromDepth(uint32_t depth) const {
          box_height_ * static_cast<float>(depth + 1);
 }
 
-void ThreadTrack::OnTimer(const TimerInfo& timer_info) {
+void ThreadTrack::OnTimer(const TimerInfo& timer_info) { AddTimer(timer_info); }
+
+const orbit_client_data::TextBox* ThreadTrack::AddTimer(const TimerInfo& timer_info) {
   UpdateDepth(timer_info.depth() + 1);
 
   if (process_id_ == -1) {
@@ -457,29 +475,33 @@ void ThreadTrack::OnTimer(const TimerInfo& timer_info) {
     absl::MutexLock lock(&scope_tree_mutex_);
     scope_tree_.Insert(&text_box);
   }
+  return &text_box;
 }
 
 void ThreadTrack::OnCaptureComplete() {
   if (scope_tree_update_type_ != ScopeTreeUpdateType::kOnCaptureComplete) {
     return;
   }
-  // Build ScopeTree from timer chains.
+  // Build ScopeTree from timer chains, all at once.
+  std::vector<orbit_client_data::TextBox*> text_boxes;
+  text_boxes.reserve(num_timers_);
   std::vector<std::shared_ptr<orbit_client_data::TimerChain>> timer_chains = GetAllChains();
   for (const auto& timer_chain : timer_chains) {
-    if (timer_chain == nullptr) return;
-    absl::MutexLock lock(&scope_tree_mutex_);
+    if (timer_chain == nullptr) continue;
     for (auto& block : *timer_chain) {
       for (size_t k = 0; k < block.size(); ++k) {
-        scope_tree_.Insert(&block[k]);
+        text_boxes.push_back(&block[k]);
       }
     }
   }
+  absl::MutexLock lock(&scope_tree_mutex_);
+  scope_tree_.InsertAll(std::move(text_boxes));
 }
 
 static inline void ResizeTextBox(const internal::DrawData& draw_data, const TimeGraph* time_graph,
                                  float world_pos_y, float world_size_y,
                                  orbit_client_data::TextBox* text_box) {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
   double start_us = time_graph->GetUsFromTick(timer_info.start());
   double end_us = time_graph->GetUsFromTick(timer_info.end());
   double elapsed_us = end_us - start_us;
@@ -511,7 +533,8 @@ void ThreadTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
 
   const internal::DrawData draw_data = GetDrawData(
       min_tick, max_tick, z_offset, batcher, time_graph_, viewport_,
-      collapse_toggle_->IsCollapsed(), app_->selected_text_box(), app_->GetFunctionIdToHighlight());
+      collapse_toggle_->IsCollapsed(), app_->selected_text_box(), app_->GetFunctionIdToHighlight(),
+      &app_->highlighted_text_boxes());
 
   absl::MutexLock lock(&scope_tree_mutex_);
 
@@ -529,7 +552,7 @@ void ThreadTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
       ++visible_timer_count_;
 
       Color color = GetTimerColor(text_box, draw_data);
-      std::unique_ptr<PickingUserData> user_data = CreatePickingUserData(*batcher, text_box);
+      PickingUserData user_data = CreatePickingUserData(*batcher, text_box);
 
       ResizeTextBox(draw_data, time_graph_, world_timer_y, box_height_, &text_box);
       const auto& pos = text_box.GetPos();
@@ -47,7 +47,11 @@ class ThreadTrack final : public TimerTrack {
             PickingMode picking_mode, float z_offset = 0) override;
   void UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                         PickingMode picking_mode, float z_offset = 0) override;
+  // The timers of a thread are added as they end, so they mostly come after the ones drawn before.
+  [[nodiscard]] bool CanAppendPrimitivesOfNewData() const override { return true; }
   void OnTimer(const orbit_client_protos::TimerInfo& timer_info) override;
+  // Same as OnTimer, but returns the text box of the timer, whose address doesn't change.
+  const orbit_client_data::TextBox* AddTimer(const orbit_client_protos::TimerInfo& timer_info);
   [[nodiscard]] float GetYFromDepth(uint32_t depth) const override;
 
   void OnPick(int x, int y) override;
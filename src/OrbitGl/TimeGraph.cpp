@@ -8,6 +8,8 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/flags/declare.h>
 #include <absl/flags/flag.h>
+#include <absl/strings/ascii.h>
+#include <absl/strings/match.h>
 #include <absl/strings/str_format.h>
 #include <absl/time/time.h>
 #include <stddef.h>
@@ -21,8 +23,10 @@
 #include "CGroupAndProcessMemoryTrack.h"
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "ClientData/FunctionUtils.h"
+#include "ClientData/PackedTimerInfo.h"
 #include "ClientData/TextBox.h"
 #include "DisplayFormats/DisplayFormats.h"
+#include "FiberTrack.h"
 #include "FrameTrack.h"
 #include "Geometry.h"
 #include "GlCanvas.h"
@@ -46,6 +50,7 @@
 ABSL_DECLARE_FLAG(bool, enable_warning_threshold);
 
 using orbit_capture_client::CaptureEventProcessor;
+using orbit_client_data::PackedTimerInfo;
 using orbit_client_model::CaptureData;
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::FunctionInfo;
@@ -101,7 +106,9 @@ void TimeGraph::ZoomAll() {
   min_time_us_ = max_time_us_ - (kNumHistorySeconds * 1000 * 1000);
   if (min_time_us_ < 0) min_time_us_ = 0;
 
-  RequestUpdate();
+  // The cached primitives of the tracks already depend on the visible time range. While capturing,
+  // this is called every frame, and the data didn't necessarily change.
+  RequestPrimitivesRebuild();
 }
 
 void TimeGraph::Zoom(uint64_t min, uint64_t max) {
@@ -267,12 +274,17 @@ void TimeGraph::ProcessTimer(const TimerInfo& timer_info, const InstrumentedFunc
     orbit_type = orbit_client_data::function_utils::GetOrbitTypeByName(function->function_name());
   }
 
-  if (function != nullptr &&
+  const bool is_orbit_function_timer =
+      function != nullptr &&
       orbit_client_data::function_utils::IsOrbitFunctionFromType(orbit_type) &&
-      timer_info.type() == TimerInfo::kNone) {
+      timer_info.type() == TimerInfo::kNone;
+  if (is_orbit_function_timer) {
     ProcessOrbitFunctionTimer(orbit_type, timer_info);
   }
 
+  // Most timers only add data to their own track.
+  Track* track_with_new_data = nullptr;
+
   // TODO(b/175869409): Change the way to create and get the tracks. Move this part to TrackManager.
   switch (timer_info.type()) {
     // All GPU timers are handled equally here.
@@ -282,6 +294,7 @@ void TimeGraph::ProcessTimer(const TimerInfo& timer_info, const InstrumentedFunc
       uint64_t timeline_hash = timer_info.timeline_hash();
       GpuTrack* track = track_manager_->GetOrCreateGpuTrack(timeline_hash);
       track->OnTimer(timer_info);
+      track_with_new_data = track;
       break;
     }
     case TimerInfo::kFrame: {
@@ -290,6 +303,7 @@ void TimeGraph::ProcessTimer(const TimerInfo& timer_info, const InstrumentedFunc
       }
       FrameTrack* track = track_manager_->GetOrCreateFrameTrack(*function);
       track->OnTimer(timer_info);
+      track_with_new_data = track;
       break;
     }
     case TimerInfo::kIntrospection: {
@@ -302,6 +316,7 @@ void TimeGraph::ProcessTimer(const TimerInfo& timer_info, const InstrumentedFunc
       track_manager_->GetOrCreateThreadTrack(timer_info.thread_id());
       SchedulerTrack* scheduler_track = track_manager_->GetOrCreateSchedulerTrack();
       scheduler_track->OnTimer(timer_info);
+      track_with_new_data = scheduler_track;
       break;
     }
     case TimerInfo::kSystemMemoryUsage: {
@@ -316,9 +331,25 @@ void TimeGraph::ProcessTimer(const TimerInfo& timer_info, const InstrumentedFunc
       ProcessPagefaultTrackingTimer(timer_info);
       break;
     }
+    case TimerInfo::kPmuCounters: {
+      // The track is sorted relative to the thread track, which needs to exist.
+      track_manager_->GetOrCreateThreadTrack(timer_info.thread_id());
+      orbit_gl::PmuCountersTrack* track =
+          track_manager_->GetOrCreatePmuCountersTrack(timer_info.thread_id());
+      track->OnTimer(timer_info);
+      track_with_new_data = track;
+      break;
+    }
+    case TimerInfo::kServiceHealth: {
+      orbit_gl::ServiceHealthTrack* track = track_manager_->GetOrCreateServiceHealthTrack();
+      track->OnTimer(timer_info);
+      track_with_new_data = track;
+      break;
+    }
     case TimerInfo::kNone: {
       ThreadTrack* track = track_manager_->GetOrCreateThreadTrack(timer_info.thread_id());
-      track->OnTimer(timer_info);
+      function_timer_index_.Add(track->AddTimer(timer_info));
+      track_with_new_data = track;
       break;
     }
     case TimerInfo::kApiEvent: {
@@ -329,7 +360,13 @@ void TimeGraph::ProcessTimer(const TimerInfo& timer_info, const InstrumentedFunc
       UNREACHABLE();
   }
 
-  RequestUpdate();
+  // Then only that track needs to update its primitives, possibly only for the new timer.
+  if (track_with_new_data != nullptr && !is_orbit_function_timer) {
+    track_with_new_data->OnNewDataInTimeRange(timer_info.start(), timer_info.end());
+    RequestPrimitivesRebuild();
+  } else {
+    RequestUpdate();
+  }
 }
 
 void TimeGraph::ProcessOrbitFunctionTimer(FunctionInfo::OrbitType type,
@@ -352,6 +389,11 @@ void TimeGraph::ProcessApiEventTimer(const TimerInfo& timer_info) {
   switch (api_event.type) {
     case orbit_api::kScopeStart:
     case orbit_api::kScopeStop: {
+      if (timer_info.fiber_id() != 0) {
+        FiberTrack* track = track_manager_->GetOrCreateFiberTrack(timer_info.fiber_id());
+        track->OnTimer(timer_info);
+        break;
+      }
       ThreadTrack* track = track_manager_->GetOrCreateThreadTrack(timer_info.thread_id());
       track->OnTimer(timer_info);
       break;
@@ -370,6 +412,9 @@ void TimeGraph::ProcessApiEventTimer(const TimerInfo& timer_info) {
     case orbit_api::kString:
       ProcessValueTrackingTimer(timer_info);
       break;
+    // The ApiEventProcessor doesn't create timers for fiber switches.
+    case orbit_api::kFiberSwitchIn:
+    case orbit_api::kFiberSwitchOut:
     case orbit_api::kNone:
       UNREACHABLE();
   }
@@ -459,7 +504,7 @@ void TimeGraph::ProcessSystemMemoryTrackingTimer(const TimerInfo& timer_info) {
 void TimeGraph::ProcessCGroupAndProcessMemoryTrackingTimer(const TimerInfo& timer_info) {
   uint64_t cgroup_name_hash = timer_info.registers(static_cast<size_t>(
       CaptureEventProcessor::CGroupAndProcessMemoryUsageEncodingIndex::kCGroupNameHash));
-  std::string cgroup_name = app_->GetStringManager()->Get(cgroup_name_hash).value_or("");
+  std::string cgroup_name{app_->GetStringManager()->Get(cgroup_name_hash).value_or("")};
   if (cgroup_name.empty()) return;
 
   CGroupAndProcessMemoryTrack* track = track_manager_->GetCGroupAndProcessMemoryTrack();
@@ -472,7 +517,7 @@ void TimeGraph::ProcessCGroupAndProcessMemoryTrackingTimer(const TimerInfo& time
 void TimeGraph::ProcessPagefaultTrackingTimer(const orbit_client_protos::TimerInfo& timer_info) {
   uint64_t cgroup_name_hash = timer_info.registers(
       static_cast<size_t>(CaptureEventProcessor::PagefaultEncodingIndex::kCGroupNameHash));
-  std::string cgroup_name = app_->GetStringManager()->Get(cgroup_name_hash).value_or("");
+  std::string cgroup_name{app_->GetStringManager()->Get(cgroup_name_hash).value_or("")};
   if (cgroup_name.empty()) return;
 
   orbit_gl::PagefaultTrack* track = track_manager_->GetPagefaultTrack();
@@ -498,6 +543,23 @@ TimeGraph::GetAllThreadTrackTimerChains() const {
   return chains;
 }
 
+std::vector<const orbit_client_data::TextBox*> TimeGraph::FindTimersOnCriticalPath(
+    const std::vector<orbit_client_model::CriticalPathSegment>& segments) const {
+  absl::flat_hash_map<int32_t, const ThreadTrack*> thread_tracks_by_thread_id;
+  for (const ThreadTrack* track : track_manager_->GetThreadTracks()) {
+    thread_tracks_by_thread_id.emplace(track->GetThreadId(), track);
+  }
+
+  std::vector<const orbit_client_data::TextBox*> text_boxes;
+  for (const orbit_client_model::CriticalPathSegment& segment : segments) {
+    auto track_it = thread_tracks_by_thread_id.find(segment.thread_id);
+    if (track_it == thread_tracks_by_thread_id.end()) continue;
+    orbit_base::Append(text_boxes, track_it->second->GetScopesInRange(segment.begin_timestamp_ns,
+                                                                      segment.end_timestamp_ns));
+  }
+  return text_boxes;
+}
+
 float TimeGraph::GetWorldFromTick(uint64_t time) const {
   if (time_window_us_ > 0) {
     double start = TicksToMicroseconds(capture_min_timestamp_, time) - min_time_us_;
@@ -541,55 +603,57 @@ void TimeGraph::SelectAndMakeVisible(const orbit_client_data::TextBox* text_box)
 
 const orbit_client_data::TextBox* TimeGraph::FindPreviousFunctionCall(
     uint64_t function_id, uint64_t current_time, std::optional<int32_t> thread_id) const {
-  const orbit_client_data::TextBox* previous_box = nullptr;
-  uint64_t previous_box_time = std::numeric_limits<uint64_t>::lowest();
-  std::vector<std::shared_ptr<orbit_client_data::TimerChain>> chains =
-      GetAllThreadTrackTimerChains();
-  for (auto& chain : chains) {
-    if (!chain) continue;
-    for (const auto& block : *chain) {
-      if (!block.Intersects(previous_box_time, current_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const orbit_client_data::TextBox& box = block[i];
-        auto box_time = box.GetTimerInfo().end();
-        if ((box.GetTimerInfo().function_id() == function_id) &&
-            (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
-            (box_time < current_time) && (previous_box_time < box_time)) {
-          previous_box = &box;
-          previous_box_time = box_time;
-        }
-      }
-    }
-  }
-  return previous_box;
+  return function_timer_index_.FindPrevious(function_id, current_time, thread_id);
 }
 
 const orbit_client_data::TextBox* TimeGraph::FindNextFunctionCall(
     uint64_t function_id, uint64_t current_time, std::optional<int32_t> thread_id) const {
-  const orbit_client_data::TextBox* next_box = nullptr;
-  uint64_t next_box_time = std::numeric_limits<uint64_t>::max();
-  std::vector<std::shared_ptr<orbit_client_data::TimerChain>> chains =
-      GetAllThreadTrackTimerChains();
-  for (auto& chain : chains) {
-    if (!chain) continue;
-    for (const auto& block : *chain) {
-      if (!block.Intersects(current_time, next_box_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const orbit_client_data::TextBox& box = block[i];
-        auto box_time = box.GetTimerInfo().end();
-        if ((box.GetTimerInfo().function_id() == function_id) &&
-            (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
-            (box_time > current_time) && (next_box_time > box_time)) {
-          next_box = &box;
-          next_box_time = box_time;
-        }
+  return function_timer_index_.FindNext(function_id, current_time, thread_id);
+}
+
+void TimeGraph::FindLongestTimers(
+    const orbit_client_data::TimerQuery& query, const std::atomic<bool>* cancelled,
+    const std::function<void(std::vector<const orbit_client_data::TextBox*>, bool is_complete)>&
+        on_results) const {
+  orbit_client_data::TimerQueryResults results{query.min_duration_ns, query.max_result_count};
+
+  if (!query.name_tokens.empty()) {
+    for (const auto& [function_id, function] : capture_data_->instrumented_functions()) {
+      if (*cancelled) return;
+      const std::string name = absl::AsciiStrToLower(function.function_name());
+      const bool matches = std::all_of(
+          query.name_tokens.begin(), query.name_tokens.end(),
+          [&name](const std::string& token) { return absl::StrContains(name, token); });
+      if (!matches) continue;
+      for (const orbit_client_data::TextBox* text_box : function_timer_index_.GetLongestCalls(
+               function_id, query.min_duration_ns, query.max_result_count)) {
+        results.Add(text_box);
       }
     }
+    on_results(results.GetLongestFirst(), /*is_complete=*/true);
+    return;
   }
-  return next_box;
+
+  for (const Track* track : track_manager_->GetAllTracks()) {
+    if (track->GetType() == Track::Type::kFrameTrack) continue;
+    const uint64_t previous_added_count = results.added_count();
+    for (const std::shared_ptr<orbit_client_data::TimerChain>& chain : track->GetAllChains()) {
+      if (chain != nullptr) results.AddTimersOf(chain.get(), cancelled);
+    }
+    if (*cancelled) return;
+    if (results.added_count() != previous_added_count) {
+      on_results(results.GetLongestFirst(), /*is_complete=*/false);
+    }
+  }
+  on_results(results.GetLongestFirst(), /*is_complete=*/true);
 }
 
 void TimeGraph::RequestUpdate() {
+  if (track_manager_ != nullptr) track_manager_->InvalidateTrackPrimitiveCaches();
+  RequestPrimitivesRebuild();
+}
+
+void TimeGraph::RequestPrimitivesRebuild() {
   update_primitives_requested_ = true;
   RequestRedraw();
 }
@@ -615,7 +679,9 @@ void TimeGraph::UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*min_tick*/, ui
   uint64_t max_tick = GetTickFromUs(max_time_us_);
 
   track_manager_->UpdateTracksForRendering();
-  track_manager_->UpdateTrackPrimitives(&batcher_, min_tick, max_tick, picking_mode);
+  track_manager_->UpdateTrackPrimitives(&batcher_, &text_renderer_static_, min_tick, max_tick,
+                                        picking_mode);
+  track_manager_->SpillTimersOutsideTimeRangeIfOverBudget(min_tick, max_tick);
 
   update_primitives_requested_ = false;
 }
@@ -646,8 +712,11 @@ void TimeGraph::SelectCallstacks(float world_start, float world_end, int32_t thr
   RequestUpdate();
 }
 
-const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) {
-  return selected_callstack_events_per_thread_[tid];
+const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) const {
+  // Tracks call this while generating their primitives in parallel, so it must not insert.
+  static const std::vector<CallstackEvent> kNoEvents;
+  auto it = selected_callstack_events_per_thread_.find(tid);
+  return it != selected_callstack_events_per_thread_.end() ? it->second : kNoEvents;
 }
 
 void TimeGraph::Draw(Batcher& batcher, TextRenderer& text_renderer, uint64_t current_mouse_time_ns,
@@ -664,6 +733,8 @@ void TimeGraph::Draw(Batcher& batcher, TextRenderer& text_renderer, uint64_t cur
   DrawOverlay(batcher, text_renderer, picking_mode);
 
   redraw_requested_ = false;
+  // The tracks that didn't fit into the time budget of this frame are updated in the next ones.
+  if (track_manager_->HasOutdatedTrackPrimitives()) RequestPrimitivesRebuild();
 }
 
 namespace {
@@ -733,7 +804,7 @@ void TimeGraph::DrawOverlay(Batcher& batcher, TextRenderer& text_renderer,
   std::sort(boxes.begin(), boxes.end(),
             [](const std::pair<uint64_t, const orbit_client_data::TextBox*>& box_a,
                const std::pair<uint64_t, const orbit_client_data::TextBox*>& box_b) -> bool {
-              return box_a.second->GetTimerInfo().start() < box_b.second->GetTimerInfo().start();
+              return box_a.second->Start() < box_b.second->Start();
             });
 
   // We will need the world x coordinates for the timers multiple times, so
@@ -751,7 +822,7 @@ void TimeGraph::DrawOverlay(Batcher& batcher, TextRenderer& text_renderer,
 
   // Draw lines for iterators.
   for (const auto& box : boxes) {
-    const TimerInfo& timer_info = box.second->GetTimerInfo();
+    const PackedTimerInfo& timer_info = box.second->GetPackedTimerInfo();
 
     double start_us = GetUsFromTick(timer_info.start());
     double normalized_start = start_us * inv_time_window;
@@ -890,7 +961,7 @@ void TimeGraph::DrawIncompleteDataIntervals(Batcher& batcher, PickingMode pickin
 
 void TimeGraph::DrawTracks(Batcher& batcher, TextRenderer& text_renderer,
                            uint64_t current_mouse_time_ns, PickingMode picking_mode) {
-  for (auto& track : track_manager_->GetVisibleTracks()) {
+  for (Track* track : track_manager_->GetTracksInViewport()) {
     float z_offset = 0;
     if (track->IsPinned()) {
       z_offset = GlCanvas::kZOffsetPinnedTrack;
@@ -918,9 +989,9 @@ void TimeGraph::JumpToNeighborBox(const orbit_client_data::TextBox* from,
   if (from == nullptr) {
     return;
   }
-  auto function_id = from->GetTimerInfo().function_id();
-  auto current_time = from->GetTimerInfo().end();
-  auto thread_id = from->GetTimerInfo().thread_id();
+  auto function_id = from->GetPackedTimerInfo().function_id();
+  auto current_time = from->End();
+  auto thread_id = from->GetPackedTimerInfo().thread_id();
   if (jump_direction == JumpDirection::kPrevious) {
     switch (jump_scope) {
       case JumpScope::kSameDepth:
@@ -1010,30 +1081,10 @@ const orbit_client_data::TextBox* TimeGraph::FindDown(const orbit_client_data::T
 
 std::pair<const orbit_client_data::TextBox*, const orbit_client_data::TextBox*>
 TimeGraph::GetMinMaxTextBoxForFunction(uint64_t function_id) const {
-  const orbit_client_data::TextBox* min_box = nullptr;
-  const orbit_client_data::TextBox* max_box = nullptr;
-  std::vector<std::shared_ptr<orbit_client_data::TimerChain>> chains =
-      GetAllThreadTrackTimerChains();
-  for (auto& chain : chains) {
-    if (!chain) continue;
-    for (auto& block : *chain) {
-      for (size_t i = 0; i < block.size(); i++) {
-        const orbit_client_data::TextBox& box = block[i];
-        if (box.GetTimerInfo().function_id() != function_id) continue;
-
-        uint64_t elapsed_nanos = box.GetTimerInfo().end() - box.GetTimerInfo().start();
-        if (min_box == nullptr ||
-            elapsed_nanos < (min_box->GetTimerInfo().end() - min_box->GetTimerInfo().start())) {
-          min_box = &box;
-        }
-        if (max_box == nullptr ||
-            elapsed_nanos > (max_box->GetTimerInfo().end() - max_box->GetTimerInfo().start())) {
-          max_box = &box;
-        }
-      }
-    }
-  }
-  return std::make_pair(min_box, max_box);
+  const size_t count = function_timer_index_.GetCount(function_id);
+  if (count == 0) return std::make_pair(nullptr, nullptr);
+  return std::make_pair(function_timer_index_.FindNthLongest(function_id, count - 1),
+                        function_timer_index_.FindNthLongest(function_id, 0));
 }
 
 void TimeGraph::DrawText(float layer) {
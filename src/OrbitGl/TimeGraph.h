@@ -7,7 +7,9 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -19,9 +21,12 @@
 #include "Batcher.h"
 #include "CallstackThreadBar.h"
 #include "CaptureViewElement.h"
+#include "ClientData/FunctionTimerIndex.h"
 #include "ClientData/TextBox.h"
+#include "ClientData/TimerQuery.h"
 #include "ClientData/TimerChain.h"
 #include "ClientModel/CaptureData.h"
+#include "ClientModel/CriticalPath.h"
 #include "CoreMath.h"
 #include "ManualInstrumentationManager.h"
 #include "OrbitAccessibility/AccessibleInterface.h"
@@ -56,10 +61,15 @@ class TimeGraph : public orbit_gl::CaptureViewElement {
   void DrawText(float layer);
 
   void RequestUpdate() override;
+  // Unlike RequestUpdate, keeps the primitives that the tracks have cached. Use this when only the
+  // viewport or the picking mode changed, as the cached primitives are only reused if they were
+  // generated for the current ones.
+  void RequestPrimitivesRebuild();
   void UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*min_tick*/, uint64_t /*max_tick*/,
                         PickingMode /*picking_mode*/, float /*z_offset*/ = 0) override;
   void SelectCallstacks(float world_start, float world_end, int32_t thread_id);
-  const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(int32_t tid);
+  [[nodiscard]] const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(
+      int32_t tid) const;
 
   void ProcessTimer(const orbit_client_protos::TimerInfo& timer_info,
                     const orbit_grpc_protos::InstrumentedFunction* function);
@@ -68,6 +78,7 @@ class TimeGraph : public orbit_gl::CaptureViewElement {
     return capture_data_;
   }
   [[nodiscard]] TrackManager* GetTrackManager() { return track_manager_.get(); }
+  [[nodiscard]] const TrackManager* GetTrackManager() const { return track_manager_.get(); }
 
   [[nodiscard]] float GetTextBoxHeight() const { return layout_.GetTextBoxHeight(); }
   [[nodiscard]] float GetWorldFromTick(uint64_t time) const;
@@ -141,6 +152,26 @@ class TimeGraph : public orbit_gl::CaptureViewElement {
   [[nodiscard]] const orbit_client_data::TextBox* FindDown(const orbit_client_data::TextBox* from);
   [[nodiscard]] std::pair<const orbit_client_data::TextBox*, const orbit_client_data::TextBox*>
   GetMinMaxTextBoxForFunction(uint64_t function_id) const;
+  // Returns the `n`-th longest call of the function, starting from zero, or nullptr if there are
+  // not that many calls.
+  // Runs `query` over the timers of all the tracks except for the frame tracks, which only show
+  // other timers differently, and reports the results so far (longest first) to `on_results` each
+  // time more of the tracks have been searched: with `is_complete` true at the end, and not at all
+  // once `cancelled` is true. Queries with name tokens only match the calls of the instrumented
+  // functions whose name contains all of them, which the function timer index provides directly.
+  // Can be called on any thread, as long as no timers are added at the same time.
+  void FindLongestTimers(const orbit_client_data::TimerQuery& query,
+                         const std::atomic<bool>* cancelled,
+                         const std::function<void(std::vector<const orbit_client_data::TextBox*>,
+                                                  bool is_complete)>& on_results) const;
+  // Returns the timers of the thread tracks that overlap the segments of a critical path, i.e., the
+  // work on it. Must be called on the main thread.
+  [[nodiscard]] std::vector<const orbit_client_data::TextBox*> FindTimersOnCriticalPath(
+      const std::vector<orbit_client_model::CriticalPathSegment>& segments) const;
+  [[nodiscard]] const orbit_client_data::TextBox* FindNthLongestFunctionCall(uint64_t function_id,
+                                                                             size_t n) const {
+    return function_timer_index_.FindNthLongest(function_id, n);
+  }
 
   [[nodiscard]] static Color GetColor(uint32_t id) {
     constexpr unsigned char kAlpha = 255;
@@ -231,6 +262,8 @@ class TimeGraph : public orbit_gl::CaptureViewElement {
   Batcher batcher_;
 
   std::unique_ptr<TrackManager> track_manager_;
+  // The timers of the thread tracks, by function.
+  orbit_client_data::FunctionTimerIndex function_timer_index_;
 
   absl::flat_hash_map<int32_t, std::vector<orbit_client_protos::CallstackEvent>>
       selected_callstack_events_per_thread_;
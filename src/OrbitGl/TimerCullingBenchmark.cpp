@@ -0,0 +1,116 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "ClientData/CallstackData.h"
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "ClientModel/CaptureData.h"
+#include "OrbitBase/Logging.h"
+#include "TrackTestData.h"
+#include "capture_data.pb.h"
+
+namespace orbit_gl {
+
+namespace {
+
+constexpr uint64_t kTimerPeriodNs = 1'000;
+constexpr int32_t kThreadId = TrackTestData::kThreadId;
+
+// One chain of `timer_count` timers of a synthetic capture, as a timer track holds for each depth.
+[[nodiscard]] std::unique_ptr<orbit_client_data::TimerChain> CreateTimerChain(
+    uint64_t timer_count, uint64_t period_ns = kTimerPeriodNs) {
+  auto chain = std::make_unique<orbit_client_data::TimerChain>();
+  for (const orbit_client_protos::TimerInfo& timer :
+       TrackTestData::GenerateTimers(kThreadId, timer_count, /*depth=*/1, period_ns)) {
+    chain->emplace_back(timer);
+  }
+  return chain;
+}
+
+// Going through the timers of a chain that are in the visible time range, which covers the
+// percentage state.range(1) of the capture, as TimerTrack::UpdatePrimitives does.
+void BM_VisitTimersInTimeRange(benchmark::State& state) {
+  const uint64_t timer_count = state.range(0);
+  std::unique_ptr<orbit_client_data::TimerChain> chain = CreateTimerChain(timer_count);
+  const uint64_t capture_duration_ns = timer_count * kTimerPeriodNs;
+  const uint64_t min_tick = capture_duration_ns / 4;
+  const uint64_t max_tick = min_tick + capture_duration_ns * state.range(1) / 100;
+
+  for (auto _ : state) {
+    uint64_t visible_timer_count = 0;
+    for (orbit_client_data::TimerBlock& block : chain->GetBlocksInTimeRange(min_tick, max_tick)) {
+      if (!block.Intersects(min_tick, max_tick)) continue;
+      for (size_t k = block.FindNextTimerIntersecting(0, min_tick, max_tick,
+                                                      std::numeric_limits<uint64_t>::max(), 0);
+           k < block.size();
+           k = block.FindNextTimerIntersecting(k + 1, min_tick, max_tick,
+                                               std::numeric_limits<uint64_t>::max(), 0)) {
+        ++visible_timer_count;
+      }
+    }
+    benchmark::DoNotOptimize(visible_timer_count);
+  }
+  state.SetItemsProcessed(state.iterations() * timer_count * state.range(1) / 100);
+}
+BENCHMARK(BM_VisitTimersInTimeRange)
+    ->Args({100'000, 1})
+    ->Args({100'000, 50})
+    ->Args({1'000'000, 1})
+    ->Args({1'000'000, 50});
+
+// Merging the timers of a chain into buckets when zoomed out to the whole capture on a screen that
+// is state.range(1) pixels wide. The timers are long enough for the buckets to be used.
+void BM_GetTimerBucketsInTimeRange(benchmark::State& state) {
+  constexpr uint64_t kLongTimerPeriodNs = 100'000;
+  const uint64_t timer_count = state.range(0);
+  std::unique_ptr<orbit_client_data::TimerChain> chain =
+      CreateTimerChain(timer_count, kLongTimerPeriodNs);
+  const uint64_t capture_duration_ns = timer_count * kLongTimerPeriodNs;
+  const uint64_t ns_per_pixel = capture_duration_ns / state.range(1);
+
+  for (auto _ : state) {
+    std::optional<std::vector<orbit_client_data::TimerBucket>> buckets =
+        chain->GetTimerBucketsInTimeRange(0, capture_duration_ns, ns_per_pixel);
+    CHECK(buckets.has_value());
+    benchmark::DoNotOptimize(buckets);
+  }
+}
+BENCHMARK(BM_GetTimerBucketsInTimeRange)->Args({100'000, 2'000})->Args({1'000'000, 2'000});
+
+// Going through the callstack samples of a thread in the visible time range, as
+// CallstackThreadBar::UpdatePrimitives does.
+void BM_VisitCallstackEventsInTimeRange(benchmark::State& state) {
+  const uint64_t callstack_event_count = state.range(0);
+  std::unique_ptr<orbit_client_model::CaptureData> capture_data =
+      TrackTestData::GenerateTestCaptureData();
+  TrackTestData::AddCallstackEvents(capture_data.get(), kThreadId, callstack_event_count,
+                                    kTimerPeriodNs);
+  const uint64_t capture_duration_ns = callstack_event_count * kTimerPeriodNs;
+  const uint64_t min_tick = capture_duration_ns / 4;
+  const uint64_t max_tick = min_tick + capture_duration_ns / 10;
+
+  for (auto _ : state) {
+    uint64_t visible_event_count = 0;
+    capture_data->GetCallstackData()->ForEachCallstackEventOfTidInTimeRange(
+        kThreadId, min_tick, max_tick,
+        [&visible_event_count](const orbit_client_protos::CallstackEvent& /*event*/) {
+          ++visible_event_count;
+        });
+    benchmark::DoNotOptimize(visible_event_count);
+  }
+  state.SetItemsProcessed(state.iterations() * callstack_event_count / 10);
+}
+BENCHMARK(BM_VisitCallstackEventsInTimeRange)->Arg(100'000)->Arg(1'000'000);
+
+}  // namespace
+
+}  // namespace orbit_gl
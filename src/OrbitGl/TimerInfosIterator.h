@@ -10,6 +10,7 @@
 #include <memory>
 #include <vector>
 
+#include "ClientData/PackedTimerInfo.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
 #include "capture_data.pb.h"
@@ -32,12 +33,12 @@ class TimerInfosIterator {
 
   TimerInfosIterator& operator++();
 
-  const orbit_client_protos::TimerInfo& operator*() const {
-    return (*blocks_it_)[timer_index_].GetTimerInfo();
+  const orbit_client_data::PackedTimerInfo& operator*() const {
+    return (*blocks_it_)[timer_index_].GetPackedTimerInfo();
   }
 
-  const orbit_client_protos::TimerInfo* operator->() const {
-    return &(*blocks_it_)[timer_index_].GetTimerInfo();
+  const orbit_client_data::PackedTimerInfo* operator->() const {
+    return &(*blocks_it_)[timer_index_].GetPackedTimerInfo();
   }
 
   bool operator==(const TimerInfosIterator& other) const {
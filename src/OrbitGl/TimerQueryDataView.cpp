@@ -0,0 +1,181 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TimerQueryDataView.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "App.h"
+#include "ClientData/TimerQuery.h"
+#include "CompareAscendingOrDescending.h"
+#include "DataViews/DataViewType.h"
+#include "DisplayFormats/DisplayFormats.h"
+#include "OrbitBase/Append.h"
+#include "OrbitBase/Logging.h"
+#include "TimeGraph.h"
+#include "capture_data.pb.h"
+
+using orbit_client_data::TextBox;
+using orbit_client_protos::TimerInfo;
+
+namespace {
+static const std::string kMenuActionJumpToTimer = "Jump to timer";
+}  // namespace
+
+TimerQueryDataView::TimerQueryDataView(OrbitApp* app)
+    : orbit_data_views::DataView(orbit_data_views::DataViewType::kTimerQueryResults, app),
+      app_{app} {
+  InitSortingOrders();
+}
+
+const std::vector<orbit_data_views::DataView::Column>& TimerQueryDataView::GetColumns() {
+  static const std::vector<Column>& columns = [] {
+    std::vector<Column> columns;
+    columns.resize(kNumColumns);
+    columns[kColumnName] = {"Name", .4f, SortingOrder::kAscending};
+    columns[kColumnThread] = {"Thread", .2f, SortingOrder::kAscending};
+    columns[kColumnStart] = {"Start", .0f, SortingOrder::kAscending};
+    columns[kColumnDuration] = {"Duration", .0f, SortingOrder::kDescending};
+    return columns;
+  }();
+  return columns;
+}
+
+std::string TimerQueryDataView::GetValue(int row, int column) {
+  const Row& result = GetRow(row);
+
+  switch (column) {
+    case kColumnName:
+      return result.name;
+    case kColumnThread:
+      return result.thread_name;
+    case kColumnStart:
+      return orbit_display_formats::GetDisplayTime(
+          absl::Nanoseconds(result.text_box->Start() - capture_min_ns_));
+    case kColumnDuration:
+      return orbit_display_formats::GetDisplayTime(absl::Nanoseconds(result.text_box->Duration()));
+    default:
+      return "";
+  }
+}
+
+#define ORBIT_PROC_SORT(Member)                                                     \
+  [&](int a, int b) {                                                               \
+    return orbit_gl::CompareAscendingOrDescending(rows_[a].Member, rows_[b].Member, \
+                                                  ascending);                       \
+  }
+
+void TimerQueryDataView::DoSort() {
+  bool ascending = sorting_orders_[sorting_column_] == SortingOrder::kAscending;
+  std::function<bool(int a, int b)> sorter = nullptr;
+
+  switch (sorting_column_) {
+    case kColumnName:
+      sorter = ORBIT_PROC_SORT(name);
+      break;
+    case kColumnThread:
+      sorter = ORBIT_PROC_SORT(thread_name);
+      break;
+    case kColumnStart:
+      sorter = ORBIT_PROC_SORT(text_box->Start());
+      break;
+    case kColumnDuration:
+      sorter = ORBIT_PROC_SORT(text_box->Duration());
+      break;
+    default:
+      break;
+  }
+
+  if (sorter) {
+    std::stable_sort(indices_.begin(), indices_.end(), sorter);
+  }
+}
+
+// The filter is the query: the data view shows all the results of the query, so filtering only
+// (re)starts the query when its text changed.
+void TimerQueryDataView::DoFilter() {
+  if (filter_ != query_text_) {
+    query_text_ = filter_;
+    ErrorMessageOr<orbit_client_data::TimerQuery> query =
+        orbit_client_data::ParseTimerQuery(query_text_);
+    if (query.has_value() && !query_text_.empty()) {
+      app_->RunTimerQuery(query.value());
+    } else {
+      if (query.has_error()) ERROR("Parsing timer query: %s", query.error().message());
+      app_->ClearTimerQuery();
+      rows_.clear();
+    }
+  }
+
+  indices_.resize(rows_.size());
+  for (size_t i = 0; i < indices_.size(); ++i) {
+    indices_[i] = i;
+  }
+}
+
+void TimerQueryDataView::SetResults(const std::vector<const TextBox*>& text_boxes) {
+  const orbit_client_model::CaptureData& capture_data = app_->GetCaptureData();
+  capture_min_ns_ = app_->GetTimeGraph()->GetCaptureMin();
+
+  rows_.clear();
+  rows_.reserve(text_boxes.size());
+  for (const TextBox* text_box : text_boxes) {
+    const orbit_client_data::PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
+    std::string name;
+    const orbit_grpc_protos::InstrumentedFunction* function =
+        app_->GetInstrumentedFunction(timer_info.function_id());
+    if (function != nullptr) {
+      name = function->function_name();
+    } else if (!text_box->GetText().empty()) {
+      name = text_box->GetText();
+    } else {
+      name = absl::StrFormat("[%s]", TimerInfo::Type_Name(timer_info.type()));
+    }
+    rows_.push_back(
+        {text_box, std::move(name), capture_data.GetThreadName(timer_info.thread_id())});
+  }
+
+  indices_.resize(rows_.size());
+  for (size_t i = 0; i < indices_.size(); ++i) {
+    indices_[i] = i;
+  }
+  OnSort(sorting_column_, {});
+}
+
+void TimerQueryDataView::ClearResults() {
+  rows_.clear();
+  indices_.clear();
+  query_text_.clear();
+}
+
+std::vector<std::string> TimerQueryDataView::GetContextMenu(
+    int clicked_index, const std::vector<int>& selected_indices) {
+  std::vector<std::string> menu;
+  if (selected_indices.size() == 1) menu.emplace_back(kMenuActionJumpToTimer);
+
+  orbit_base::Append(menu, DataView::GetContextMenu(clicked_index, selected_indices));
+  return menu;
+}
+
+void TimerQueryDataView::OnContextMenu(const std::string& action, int menu_index,
+                                       const std::vector<int>& item_indices) {
+  if (action == kMenuActionJumpToTimer) {
+    CHECK(item_indices.size() == 1);
+    JumpToTimer(GetRow(item_indices[0]).text_box);
+  } else {
+    DataView::OnContextMenu(action, menu_index, item_indices);
+  }
+}
+
+void TimerQueryDataView::OnDoubleClicked(int index) { JumpToTimer(GetRow(index).text_box); }
+
+void TimerQueryDataView::JumpToTimer(const TextBox* text_box) {
+  app_->GetMutableTimeGraph()->SelectAndZoom(text_box);
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_TIMER_QUERY_DATA_VIEW_H_
+#define ORBIT_GL_TIMER_QUERY_DATA_VIEW_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "DataViews/DataView.h"
+
+class OrbitApp;
+
+// Shows the results of a search for the longest timers of the capture. The query is the filter of
+// the data view, e.g., ">5ms top 100 render": it is run in the background by OrbitApp, which
+// passes the results, as they come, to SetResults.
+class TimerQueryDataView : public orbit_data_views::DataView {
+ public:
+  explicit TimerQueryDataView(OrbitApp* app);
+
+  const std::vector<Column>& GetColumns() override;
+  int GetDefaultSortingColumn() override { return kColumnDuration; }
+  std::vector<std::string> GetContextMenu(int clicked_index,
+                                          const std::vector<int>& selected_indices) override;
+  std::string GetValue(int row, int column) override;
+  std::string GetLabel() override {
+    return "Search timers: [>DURATION] [top COUNT] [NAME...], e.g., \">5ms top 100 render\"";
+  }
+
+  void OnContextMenu(const std::string& action, int menu_index,
+                     const std::vector<int>& item_indices) override;
+  void OnDoubleClicked(int index) override;
+
+  void SetResults(const std::vector<const orbit_client_data::TextBox*>& text_boxes);
+  void ClearResults();
+
+ private:
+  void DoSort() override;
+  void DoFilter() override;
+
+  struct Row {
+    const orbit_client_data::TextBox* text_box;
+    std::string name;
+    std::string thread_name;
+  };
+
+  [[nodiscard]] const Row& GetRow(uint32_t row) const { return rows_.at(indices_[row]); }
+  void JumpToTimer(const orbit_client_data::TextBox* text_box);
+
+  enum ColumnIndex { kColumnName, kColumnThread, kColumnStart, kColumnDuration, kNumColumns };
+
+  std::vector<Row> rows_;
+  std::string query_text_;
+  uint64_t capture_min_ns_ = 0;
+
+  // TODO(b/185090791): This is temporary and will be removed once this data view has been ported
+  // and move to orbit_data_views.
+  OrbitApp* app_ = nullptr;
+};
+
+#endif  // ORBIT_GL_TIMER_QUERY_DATA_VIEW_H_
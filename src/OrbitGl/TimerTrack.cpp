@@ -11,10 +11,13 @@
 
 #include <algorithm>
 #include <limits>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include "App.h"
 #include "Batcher.h"
+#include "ClientData/PackedTimerInfo.h"
 #include "ClientData/TextBox.h"
 #include "GlCanvas.h"
 #include "TimeGraph.h"
@@ -24,6 +27,7 @@
 #include "absl/flags/flag.h"
 #include "absl/strings/str_format.h"
 
+using orbit_client_data::PackedTimerInfo;
 using orbit_client_protos::TimerInfo;
 
 ABSL_DECLARE_FLAG(bool, show_return_values);
@@ -99,13 +103,16 @@ bool TimerTrack::DrawTimer(const orbit_client_data::TextBox* prev_text_box,
   CHECK(min_ignore != nullptr);
   CHECK(max_ignore != nullptr);
   if (current_text_box == nullptr) return false;
-  const TimerInfo& current_timer_info = current_text_box->GetTimerInfo();
-  if (draw_data.min_tick > current_timer_info.end() ||
-      draw_data.max_tick < current_timer_info.start()) {
+  const PackedTimerInfo& current_packed_timer_info = current_text_box->GetPackedTimerInfo();
+  if (draw_data.min_tick > current_packed_timer_info.end() ||
+      draw_data.max_tick < current_packed_timer_info.start()) {
     return false;
   }
-  if (current_timer_info.start() >= *min_ignore && current_timer_info.end() <= *max_ignore)
+  if (current_packed_timer_info.start() >= *min_ignore &&
+      current_packed_timer_info.end() <= *max_ignore)
     return false;
+  // Only reassemble the full TimerInfo for the timers that are actually drawn.
+  const TimerInfo current_timer_info = current_text_box->GetTimerInfo();
   if (!TimerFilter(current_timer_info)) return false;
 
   UpdateDepth(current_timer_info.depth() + 1);
@@ -120,7 +127,7 @@ bool TimerTrack::DrawTimer(const orbit_client_data::TextBox* prev_text_box,
   // Check if the previous timer overlaps with the current one, and if so draw the overlap
   // as triangles rather than as overlapping rectangles.
   if (prev_text_box != nullptr) {
-    const TimerInfo& prev_timer_info = prev_text_box->GetTimerInfo();
+    const PackedTimerInfo& prev_timer_info = prev_text_box->GetPackedTimerInfo();
     // TODO(b/179985943): Turn this back into a check.
     if (prev_timer_info.start() < current_timer_info.start()) {
       // Note, that for timers that are completely inside the previous one, we will keep drawing
@@ -139,7 +146,7 @@ bool TimerTrack::DrawTimer(const orbit_client_data::TextBox* prev_text_box,
   // Check if the next timer overlaps with the current one, and if so draw the overlap
   // as triangles rather than as overlapping rectangles.
   if (next_text_box != nullptr) {
-    const TimerInfo& next_timer_info = next_text_box->GetTimerInfo();
+    const PackedTimerInfo& next_timer_info = next_text_box->GetPackedTimerInfo();
     // TODO(b/179985943): Turn this back into a check.
     if (current_timer_info.start() < next_timer_info.start()) {
       // Note, that for timers that are completely inside the next one, we will keep drawing
@@ -183,6 +190,7 @@ bool TimerTrack::DrawTimer(const orbit_client_data::TextBox* prev_text_box,
   bool is_selected = current_text_box == draw_data.selected_textbox;
   bool is_highlighted = !is_selected && function_id != orbit_grpc_protos::kInvalidFunctionId &&
                         function_id == draw_data.highlighted_function_id;
+  is_highlighted |= !is_selected && draw_data.highlighted_text_boxes->contains(current_text_box);
 
   Color color = GetTimerColor(current_timer_info, is_selected, is_highlighted);
 
@@ -212,8 +220,7 @@ bool TimerTrack::DrawTimer(const orbit_client_data::TextBox* prev_text_box,
                                           CreatePickingUserData(*batcher, *current_text_box));
   } else {
     Batcher* batcher = draw_data.batcher;
-    auto user_data = std::make_unique<PickingUserData>(
-        current_text_box, [&, batcher](PickingId id) { return this->GetBoxTooltip(*batcher, id); });
+    PickingUserData user_data = CreatePickingUserData(*batcher, *current_text_box);
 
     WorldXInfo world_x_info = ToWorldX(start_us, end_us, draw_data.inv_time_window,
                                        draw_data.world_start_x, draw_data.world_width);
@@ -238,6 +245,47 @@ bool TimerTrack::DrawTimer(const orbit_client_data::TextBox* prev_text_box,
   return true;
 }
 
+bool TimerTrack::DrawTimerBucket(const internal::DrawData& draw_data,
+                                 const orbit_client_data::TimerBucket& bucket,
+                                 uint64_t* min_ignore, uint64_t* max_ignore) {
+  // A single timer is drawn as usual, e.g., with its text if it is wide enough.
+  if (bucket.timer_count == 1) {
+    return DrawTimer(nullptr, nullptr, draw_data, bucket.first_text_box, min_ignore, max_ignore);
+  }
+
+  // The merged timers all have the type of the first one, so they are drawn at the same height.
+  const TimerInfo timer_info = bucket.first_text_box->GetTimerInfo();
+  if (!TimerFilter(timer_info)) return false;
+  UpdateDepth(timer_info.depth() + 1);
+
+  double start_us = time_graph_->GetUsFromTick(bucket.min_start);
+  double end_us = time_graph_->GetUsFromTick(bucket.max_end);
+  float world_timer_y = GetYFromTimer(timer_info);
+  float box_height = GetTextBoxHeight(timer_info);
+
+  uint64_t function_id = timer_info.function_id();
+  bool is_selected = bucket.first_text_box == draw_data.selected_textbox;
+  bool is_highlighted = !is_selected && function_id != orbit_grpc_protos::kInvalidFunctionId &&
+                        function_id == draw_data.highlighted_function_id;
+  Color color = GetTimerColor(timer_info, is_selected, is_highlighted);
+
+  WorldXInfo world_x_info = ToWorldX(start_us, end_us, draw_data.inv_time_window,
+                                     draw_data.world_start_x, draw_data.world_width);
+  Batcher* batcher = draw_data.batcher;
+  bool is_visible_width =
+      (end_us - start_us) * draw_data.inv_time_window * draw_data.viewport->GetScreenWidth() > 1;
+  if (is_visible_width) {
+    batcher->AddShadedBox(Vec2(world_x_info.world_x_start, world_timer_y),
+                          Vec2(world_x_info.world_x_width, box_height), draw_data.z, color,
+                          CreatePickingUserData(*batcher, *bucket.first_text_box));
+  } else {
+    batcher->AddVerticalLine(Vec2(world_x_info.world_x_start, world_timer_y), box_height,
+                             draw_data.z, color,
+                             CreatePickingUserData(*batcher, *bucket.first_text_box));
+  }
+  return true;
+}
+
 void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                   PickingMode /*picking_mode*/, float z_offset) {
   UpdateBoxHeight();
@@ -262,6 +310,7 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
   std::vector<std::shared_ptr<orbit_client_data::TimerChain>> chains_by_depth = GetTimers();
   draw_data.selected_textbox = app_->selected_text_box();
   draw_data.highlighted_function_id = app_->GetFunctionIdToHighlight();
+  draw_data.highlighted_text_boxes = &app_->highlighted_text_boxes();
 
   // We minimize overdraw when drawing lines for small events by discarding
   // events that would just draw over an already drawn line. When zoomed in
@@ -273,6 +322,22 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
 
   for (auto& chain : chains_by_depth) {
     if (!chain) continue;
+
+    // When zoomed out far enough, draw the timers merged per pixel (or less), which takes time
+    // proportional to the number of pixels instead of to the number of timers.
+    std::optional<std::vector<orbit_client_data::TimerBucket>> timer_buckets =
+        chain->GetTimerBucketsInTimeRange(min_tick, max_tick, draw_data.ns_per_pixel);
+    if (timer_buckets.has_value()) {
+      uint64_t min_ignore = std::numeric_limits<uint64_t>::max();
+      uint64_t max_ignore = std::numeric_limits<uint64_t>::min();
+      for (const orbit_client_data::TimerBucket& bucket : timer_buckets.value()) {
+        if (DrawTimerBucket(draw_data, bucket, &min_ignore, &max_ignore)) {
+          ++visible_timer_count_;
+        }
+      }
+      continue;
+    }
+
     // In order to draw overlaps correctly, we need for every text box to be drawn (current),
     // its previous and next text box. In order to avoid looking ahead for the next text (which is
     // error-prone), we are doing just one traversal of the text boxes, while keeping track of the
@@ -287,7 +352,7 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
     // would miss drawing events that should be drawn.
     uint64_t min_ignore = std::numeric_limits<uint64_t>::max();
     uint64_t max_ignore = std::numeric_limits<uint64_t>::min();
-    for (orbit_client_data::TimerBlock& block : *chain) {
+    for (orbit_client_data::TimerBlock& block : chain->GetBlocksInTimeRange(min_tick, max_tick)) {
       if (!block.Intersects(min_tick, max_tick)) continue;
 
       for (size_t k = 0; k < block.size(); ++k) {
@@ -302,6 +367,20 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
 
         prev_text_box = current_text_box;
         current_text_box = next_text_box;
+
+        // The following timers that are outside of the visible time range, or covered by the last
+        // line that was drawn, would not be drawn in the next iterations, so these are skipped at
+        // once: the first timer after them, or the last one of the block, becomes "current", and
+        // its predecessor "prev".
+        const size_t last_index = block.size() - 1;
+        const size_t next_index = std::min(
+            block.FindNextTimerIntersecting(k, min_tick, max_tick, min_ignore, max_ignore),
+            last_index);
+        if (next_index > k) {
+          k = next_index;
+          prev_text_box = &block[k - 1];
+          current_text_box = &block[k];
+        }
       }
     }
 
@@ -367,7 +446,7 @@ const orbit_client_data::TextBox* TimerTrack::GetFirstAfterTime(uint64_t time,
   for (orbit_client_data::TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
     for (size_t k = 0; k < it->size(); ++k) {
       const orbit_client_data::TextBox& text_box = (*it)[k];
-      if (text_box.GetTimerInfo().start() > time) {
+      if (text_box.Start() > time) {
         return &text_box;
       }
     }
@@ -386,7 +465,7 @@ const orbit_client_data::TextBox* TimerTrack::GetFirstBeforeTime(uint64_t time,
   for (orbit_client_data::TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
     for (size_t k = 0; k < it->size(); ++k) {
       const orbit_client_data::TextBox& box = (*it)[k];
-      if (box.GetTimerInfo().start() > time) {
+      if (box.Start() > time) {
         return text_box;
       }
       text_box = &box;
@@ -405,13 +484,13 @@ std::shared_ptr<orbit_client_data::TimerChain> TimerTrack::GetTimers(uint32_t de
 
 const orbit_client_data::TextBox* TimerTrack::GetUp(
     const orbit_client_data::TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
   return GetFirstBeforeTime(timer_info.start(), timer_info.depth() - 1);
 }
 
 const orbit_client_data::TextBox* TimerTrack::GetDown(
     const orbit_client_data::TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const PackedTimerInfo& timer_info = text_box->GetPackedTimerInfo();
   return GetFirstAfterTime(timer_info.start(), timer_info.depth() + 1);
 }
 
@@ -428,11 +507,11 @@ std::vector<const orbit_client_data::TextBox*> TimerTrack::GetScopesInRange(uint
   std::vector<const orbit_client_data::TextBox*> result;
   for (auto chain : GetAllChains()) {
     if (chain == nullptr) continue;
-    for (const auto& block : *chain) {
+    for (const auto& block : chain->GetBlocksInTimeRange(start_ns, end_ns)) {
       if (!block.Intersects(start_ns, end_ns)) continue;
       for (uint64_t i = 0; i < block.size(); ++i) {
         const orbit_client_data::TextBox& box = block[i];
-        if (box.GetTimerInfo().start() <= end_ns && box.GetTimerInfo().end() > start_ns) {
+        if (box.Start() <= end_ns && box.End() > start_ns) {
           result.push_back(&box);
         }
       }
@@ -454,11 +533,11 @@ std::string TimerTrack::GetBoxTooltip(const Batcher& /*batcher*/, PickingId /*id
 
 float TimerTrack::GetHeaderHeight() const { return layout_->GetTrackTabHeight(); }
 
-internal::DrawData TimerTrack::GetDrawData(uint64_t min_tick, uint64_t max_tick, float z_offset,
-                                           Batcher* batcher, TimeGraph* time_graph,
-                                           orbit_gl::Viewport* viewport, bool is_collapsed,
-                                           const orbit_client_data::TextBox* selected_textbox,
-                                           uint64_t highlighted_function_id) {
+internal::DrawData TimerTrack::GetDrawData(
+    uint64_t min_tick, uint64_t max_tick, float z_offset, Batcher* batcher, TimeGraph* time_graph,
+    orbit_gl::Viewport* viewport, bool is_collapsed,
+    const orbit_client_data::TextBox* selected_textbox, uint64_t highlighted_function_id,
+    const absl::flat_hash_set<const orbit_client_data::TextBox*>* highlighted_text_boxes) {
   internal::DrawData draw_data;
   draw_data.min_tick = min_tick;
   draw_data.max_tick = max_tick;
@@ -472,6 +551,7 @@ internal::DrawData TimerTrack::GetDrawData(uint64_t min_tick, uint64_t max_tick,
   draw_data.z = GlCanvas::kZValueBox + z_offset;
   draw_data.selected_textbox = selected_textbox;
   draw_data.highlighted_function_id = highlighted_function_id;
+  draw_data.highlighted_text_boxes = highlighted_text_boxes;
 
   uint64_t time_window_ns = static_cast<uint64_t>(1000 * time_graph->GetTimeWindowUs());
   draw_data.ns_per_pixel = time_window_ns / viewport->GetScreenWidth();
@@ -5,6 +5,7 @@
 #ifndef ORBIT_GL_TIMER_TRACK_H_
 #define ORBIT_GL_TIMER_TRACK_H_
 
+#include <absl/container/flat_hash_set.h>
 #include <stdint.h>
 
 #include <atomic>
@@ -19,6 +20,7 @@
 #include "ClientData/CallstackTypes.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
+#include "ClientData/TimerPyramid.h"
 #include "CoreMath.h"
 #include "PickingManager.h"
 #include "TextRenderer.h"
@@ -40,6 +42,7 @@ struct DrawData {
   Batcher* batcher;
   orbit_gl::Viewport* viewport;
   const orbit_client_data::TextBox* selected_textbox;
+  const absl::flat_hash_set<const orbit_client_data::TextBox*>* highlighted_text_boxes;
   double inv_time_window;
   float world_start_x;
   float world_width;
@@ -133,6 +136,11 @@ class TimerTrack : public Track {
                                const internal::DrawData& draw_data,
                                orbit_client_data::TextBox* current_text_box, uint64_t* min_ignore,
                                uint64_t* max_ignore);
+  // Draws the timers merged in `bucket` as one box or line, see
+  // TimerChain::GetTimerBucketsInTimeRange.
+  [[nodiscard]] bool DrawTimerBucket(const internal::DrawData& draw_data,
+                                     const orbit_client_data::TimerBucket& bucket,
+                                     uint64_t* min_ignore, uint64_t* max_ignore);
 
   void UpdateDepth(uint32_t depth) {
     if (depth > depth_) depth_ = depth;
@@ -145,7 +153,8 @@ class TimerTrack : public Track {
   [[nodiscard]] static internal::DrawData GetDrawData(
       uint64_t min_tick, uint64_t max_tick, float z_offset, Batcher* batcher, TimeGraph* time_graph,
       orbit_gl::Viewport* viewport, bool is_collapsed,
-      const orbit_client_data::TextBox* selected_textbox, uint64_t highlighted_function_id);
+      const orbit_client_data::TextBox* selected_textbox, uint64_t highlighted_function_id,
+      const absl::flat_hash_set<const orbit_client_data::TextBox*>* highlighted_text_boxes);
 
   TextRenderer* text_renderer_ = nullptr;
   uint32_t depth_ = 0;
@@ -153,9 +162,10 @@ class TimerTrack : public Track {
   int visible_timer_count_ = 0;
 
   [[nodiscard]] virtual std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const;
-  [[nodiscard]] std::unique_ptr<PickingUserData> CreatePickingUserData(
-      const Batcher& batcher, const orbit_client_data::TextBox& text_box) {
-    return std::make_unique<PickingUserData>(
+  // The user data is added by value, and the callback fits into it without a heap allocation.
+  [[nodiscard]] PickingUserData CreatePickingUserData(const Batcher& batcher,
+                                                      const orbit_client_data::TextBox& text_box) {
+    return PickingUserData(
         &text_box, [this, &batcher](PickingId id) { return this->GetBoxTooltip(batcher, id); });
   }
 
@@ -7,8 +7,11 @@
 #include <GteVector.h>
 #include <absl/strings/str_format.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "App.h"
 #include "Batcher.h"
@@ -67,7 +70,25 @@ void TracepointThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick,
 
   CHECK(capture_data_ != nullptr);
 
-  if (!picking) {
+  // When zoomed out, draw how many events fall into each pixel instead of each event. Beyond
+  // kMaxCountPerPixel events, pixels are drawn the same, so their other events aren't counted.
+  constexpr uint32_t kMaxCountPerPixel = 32;
+  std::vector<uint32_t> event_counts;
+  const uint64_t ns_per_pixel = GetNsPerPixel();
+  if (ns_per_pixel > 0) {
+    event_counts = capture_data_->GetTracepointData()->GetTracepointEventCountsOfThreadPerBucket(
+        thread_id_, min_tick, ns_per_pixel, GetPixelCount(min_tick, max_tick, ns_per_pixel),
+        kMaxCountPerPixel);
+  }
+
+  if (HasPixelWithSeveralEvents(event_counts)) {
+    DrawEventDensity(batcher, min_tick, ns_per_pixel, event_counts, z, kWhite, picking_mode,
+                     [](uint32_t count) {
+                       return absl::StrFormat(
+                           "<b>%s%u tracepoint events</b><br/><i>Zoom in to see them</i>",
+                           count >= kMaxCountPerPixel ? "At least " : "", count);
+                     });
+  } else if (!picking) {
     capture_data_->ForEachTracepointEventOfThreadInTimeRange(
         thread_id_, min_tick, max_tick,
         [&](const orbit_client_protos::TracepointEventInfo& tracepoint) {
@@ -97,11 +118,10 @@ void TracepointThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick,
           Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset,
                    pos_[1] - track_height + 1);
           Vec2 size(kPickingBoxWidth, track_height);
-          auto user_data =
-              std::make_unique<PickingUserData>(nullptr, [&, batcher](PickingId id) -> std::string {
-                return GetTracepointTooltip(batcher, id);
-              });
-          user_data->custom_data_ = &tracepoint;
+          PickingUserData user_data(nullptr, [this, batcher](PickingId id) -> std::string {
+            return GetTracepointTooltip(batcher, id);
+          });
+          user_data.custom_data_ = &tracepoint;
           batcher->AddShadedBox(pos, size, z, kWhite, std::move(user_data));
         });
   }
@@ -121,6 +141,14 @@ std::string TracepointThreadBar::GetTracepointTooltip(Batcher* batcher, PickingI
   orbit_grpc_protos::TracepointInfo tracepoint_info =
       capture_data_->GetTracepointInfo(tracepoint_info_key);
 
+  std::string fields;
+  const int field_count =
+      std::min(tracepoint_info.field_names_size(), tracepoint_event_info->field_values_size());
+  for (int i = 0; i < field_count; ++i) {
+    absl::StrAppendFormat(&fields, "<b>%s:</b> %d<br/>", tracepoint_info.field_names(i),
+                          tracepoint_event_info->field_values(i));
+  }
+
   if (thread_id_ == orbit_base::kAllThreadsOfAllProcessesTid) {
     return absl::StrFormat(
         "<b>%s : %s</b><br/>"
@@ -128,17 +156,20 @@ std::string TracepointThreadBar::GetTracepointTooltip(Batcher* batcher, PickingI
         "<br/>"
         "<b>Core:</b> %d<br/>"
         "<b>Process:</b> %s [%d]<br/>"
-        "<b>Thread:</b> %s [%d]<br/>",
+        "<b>Thread:</b> %s [%d]<br/>"
+        "%s",
         tracepoint_info.category(), tracepoint_info.name(), tracepoint_event_info->cpu(),
         capture_data_->GetThreadName(tracepoint_event_info->pid()), tracepoint_event_info->pid(),
-        capture_data_->GetThreadName(tracepoint_event_info->tid()), tracepoint_event_info->tid());
+        capture_data_->GetThreadName(tracepoint_event_info->tid()), tracepoint_event_info->tid(),
+        fields);
   } else {
     return absl::StrFormat(
         "<b>%s : %s</b><br/>"
         "<i>Tracepoint event</i><br/>"
         "<br/>"
-        "<b>Core:</b> %d<br/>",
-        tracepoint_info.category(), tracepoint_info.name(), tracepoint_event_info->cpu());
+        "<b>Core:</b> %d<br/>"
+        "%s",
+        tracepoint_info.category(), tracepoint_info.name(), tracepoint_event_info->cpu(), fields);
   }
 }
 
@@ -7,6 +7,7 @@
 #include <math.h>
 #include <stddef.h>
 
+#include <algorithm>
 #include <limits>
 
 #include "AccessibleTrack.h"
@@ -218,9 +219,7 @@ void Track::UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*t_min*/, uint64_t
 void Track::SetPinned(bool value) { pinned_ = value; }
 
 Color Track::GetTrackBackgroundColor() const {
-  int32_t capture_process_id = capture_data_->process_id();
-
-  if (process_id_ != -1 && process_id_ != capture_process_id) {
+  if (process_id_ != -1 && !capture_data_->IsCapturedProcess(process_id_)) {
     const Color kExternalProcessColor(30, 30, 40, 255);
     return kExternalProcessColor;
   }
@@ -230,6 +229,24 @@ Color Track::GetTrackBackgroundColor() const {
 
 void Track::OnCollapseToggle(bool /*is_collapsed*/) { RequestUpdate(); }
 
+void Track::OnNewDataInTimeRange(uint64_t min_tick, uint64_t max_tick) {
+  absl::MutexLock lock(&new_data_mutex_);
+  if (new_data_time_range_.has_value()) {
+    new_data_time_range_->first = std::min(new_data_time_range_->first, min_tick);
+    new_data_time_range_->second = std::max(new_data_time_range_->second, max_tick);
+  } else {
+    new_data_time_range_.emplace(min_tick, max_tick);
+  }
+  ++data_version_;
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> Track::TakeNewDataTimeRange() {
+  absl::MutexLock lock(&new_data_mutex_);
+  std::optional<std::pair<uint64_t, uint64_t>> new_data_time_range = new_data_time_range_;
+  new_data_time_range_.reset();
+  return new_data_time_range;
+}
+
 void Track::OnDrag(int x, int y) {
   CaptureViewElement::OnDrag(x, y);
 
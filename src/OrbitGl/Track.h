@@ -7,12 +7,17 @@
 
 #include <ClientModel/CaptureData.h>
 #include <GteVector.h>
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
 #include <algorithm>
 #include <atomic>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Batcher.h"
@@ -22,6 +27,7 @@
 #include "ClientData/TimerChain.h"
 #include "CoreMath.h"
 #include "OrbitBase/Profiling.h"
+#include "PrimitivesCache.h"
 #include "TextRenderer.h"
 #include "TimeGraphLayout.h"
 #include "TriangleToggle.h"
@@ -39,6 +45,7 @@ class Track : public orbit_gl::CaptureViewElement, public std::enable_shared_fro
     kGraphTrack,
     kSchedulerTrack,
     kAsyncTrack,
+    kFiberTrack,
     kMemoryTrack,
     kPagefaultTrack,
     kUnknown,
@@ -47,7 +54,7 @@ class Track : public orbit_gl::CaptureViewElement, public std::enable_shared_fro
   static constexpr std::initializer_list<Type> kAllTrackTypes = {
       Type::kTimerTrack,  Type::kThreadTrack,    Type::kFrameTrack,     Type::kVariableTrack,
       Type::kGpuTrack,    Type::kGraphTrack,     Type::kSchedulerTrack, Type::kAsyncTrack,
-      Type::kMemoryTrack, Type::kPagefaultTrack, Type::kUnknown};
+      Type::kFiberTrack,  Type::kMemoryTrack,    Type::kPagefaultTrack, Type::kUnknown};
 
   explicit Track(CaptureViewElement* parent, TimeGraph* time_graph, orbit_gl::Viewport* viewport,
                  TimeGraphLayout* layout, const orbit_client_model::CaptureData* capture_data,
@@ -105,6 +112,7 @@ class Track : public orbit_gl::CaptureViewElement, public std::enable_shared_fro
   TriangleToggle* GetTriangleToggle() const { return collapse_toggle_.get(); }
   [[nodiscard]] int32_t GetProcessId() const { return process_id_; }
   void SetProcessId(uint32_t pid) { process_id_ = pid; }
+  [[nodiscard]] int32_t GetThreadId() const { return thread_id_; }
   [[nodiscard]] virtual bool IsEmpty() const = 0;
 
   [[nodiscard]] virtual bool IsTrackSelected() const { return false; }
@@ -115,6 +123,24 @@ class Track : public orbit_gl::CaptureViewElement, public std::enable_shared_fro
   [[nodiscard]] virtual int GetVisiblePrimitiveCount() const { return 0; }
   [[nodiscard]] virtual uint32_t GetIndent() const { return indentation_level_; }
 
+  // Picking passes and regular passes alternate, so their primitives are cached separately.
+  [[nodiscard]] orbit_gl::PrimitivesCache& GetPrimitivesCache(PickingMode picking_mode) {
+    return picking_mode == PickingMode::kNone ? primitives_cache_ : picking_primitives_cache_;
+  }
+
+  // To be called, instead of TimeGraph::RequestUpdate, when data in [min_tick, max_tick] was only
+  // added to this track, e.g., timers during a live capture, so that only this track updates its
+  // primitives. This can be called from any thread.
+  void OnNewDataInTimeRange(uint64_t min_tick, uint64_t max_tick);
+  [[nodiscard]] uint64_t GetDataVersion() const { return data_version_; }
+  // Returns the time range of the data added since the last call, if any.
+  std::optional<std::pair<uint64_t, uint64_t>> TakeNewDataTimeRange();
+  // Whether UpdatePrimitives, for a time range in which the track only has data that was added
+  // after the primitives for the data before it were generated, only adds primitives for the data
+  // in that time range, so that they can be appended to the ones of the data before, see
+  // PrimitivesCache::TranslateAndAppend.
+  [[nodiscard]] virtual bool CanAppendPrimitivesOfNewData() const { return false; }
+
  protected:
   // Returns the y-position of the triangle.
   float DrawCollapsingTriangle(Batcher& batcher, TextRenderer& text_renderer,
@@ -147,6 +173,13 @@ class Track : public orbit_gl::CaptureViewElement, public std::enable_shared_fro
 
  private:
   const uint32_t indentation_level_;
+  orbit_gl::PrimitivesCache primitives_cache_;
+  orbit_gl::PrimitivesCache picking_primitives_cache_;
+
+  std::atomic<uint64_t> data_version_ = 0;
+  absl::Mutex new_data_mutex_;
+  std::optional<std::pair<uint64_t, uint64_t>> new_data_time_range_
+      ABSL_GUARDED_BY(new_data_mutex_);
 };
 
 #endif
\ No newline at end of file
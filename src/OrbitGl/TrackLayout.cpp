@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TrackLayout.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_gl {
+
+void TrackLayout::SetTrackCount(size_t track_count) {
+  if (track_count == extents_.size()) return;
+  InvalidateOffsetsFrom(std::min(track_count, extents_.size()));
+  extents_.resize(track_count, 0.f);
+  offsets_.resize(track_count + 1, offsets_.back());
+}
+
+void TrackLayout::SetTrackExtent(size_t index, float extent) {
+  CHECK(index < extents_.size());
+  CHECK(extent >= 0.f);
+  if (extents_[index] == extent) return;
+  extents_[index] = extent;
+  // The offset of the track itself doesn't change, only the ones of the tracks below.
+  InvalidateOffsetsFrom(index + 1);
+}
+
+void TrackLayout::InvalidateOffsetsFrom(size_t index) {
+  first_outdated_offset_index_ = std::min(first_outdated_offset_index_, index);
+}
+
+size_t TrackLayout::UpdateOffsets() {
+  // The offset of the first track is always 0.
+  const size_t first_updated_index = std::max<size_t>(first_outdated_offset_index_, 1);
+  for (size_t i = first_updated_index; i < offsets_.size(); ++i) {
+    offsets_[i] = offsets_[i - 1] + extents_[i - 1];
+  }
+  const size_t first_changed_index = std::min(first_outdated_offset_index_, extents_.size());
+  first_outdated_offset_index_ = offsets_.size();
+  return first_changed_index;
+}
+
+float TrackLayout::GetTrackOffset(size_t index) const {
+  CHECK(index < extents_.size());
+  CHECK(index < first_outdated_offset_index_);
+  return offsets_[index];
+}
+
+std::pair<size_t, size_t> TrackLayout::FindTracksInRange(float min_offset,
+                                                         float max_offset) const {
+  CHECK(first_outdated_offset_index_ == offsets_.size());
+  // The track `i` covers the offsets [offsets_[i], offsets_[i + 1]].
+  auto first = std::lower_bound(offsets_.begin() + 1, offsets_.end(), min_offset);
+  auto last = std::upper_bound(offsets_.begin(), offsets_.end() - 1, max_offset);
+  size_t first_index = first - (offsets_.begin() + 1);
+  size_t last_index = last - offsets_.begin();
+  return {first_index, std::max(first_index, last_index)};
+}
+
+}  // namespace orbit_gl
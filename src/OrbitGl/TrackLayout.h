@@ -0,0 +1,52 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_TRACK_LAYOUT_H_
+#define ORBIT_GL_TRACK_LAYOUT_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace orbit_gl {
+
+// The vertical layout of a list of tracks shown one below the other, as the offsets of the tops of
+// the tracks from the top of the first one. The offsets are the prefix sums of the extents of the
+// tracks, i.e., their heights plus the space below them.
+//
+// The offsets are only recomputed from the first track whose extent changed, and the tracks in a
+// range of offsets, e.g., the ones on the screen, are found by binary search. This keeps the
+// layout cheap for thousands of tracks, of which only a few are on the screen.
+class TrackLayout {
+ public:
+  [[nodiscard]] size_t GetTrackCount() const { return extents_.size(); }
+
+  // Changing the number of tracks keeps the extents of the first tracks.
+  void SetTrackCount(size_t track_count);
+  void SetTrackExtent(size_t index, float extent);
+  // For the offsets to be updated from track `index` even if no extent changed, e.g., when the
+  // order of the tracks changed.
+  void InvalidateOffsetsFrom(size_t index);
+
+  // Updates the offsets after extents changed, and returns the index of the first track whose
+  // offset may have changed, or GetTrackCount() if none did.
+  size_t UpdateOffsets();
+
+  [[nodiscard]] float GetTrackOffset(size_t index) const;
+  [[nodiscard]] float GetTotalExtent() const { return offsets_.back(); }
+  // Returns the range [first, last) of the indices of the tracks overlapping the range of offsets
+  // [min_offset, max_offset]. Requires the offsets to be up to date.
+  [[nodiscard]] std::pair<size_t, size_t> FindTracksInRange(float min_offset,
+                                                            float max_offset) const;
+
+ private:
+  std::vector<float> extents_;
+  // offsets_[i] is the offset of the track `i`, and offsets_.back() the total extent.
+  std::vector<float> offsets_ = {0.f};
+  size_t first_outdated_offset_index_ = 0;
+};
+
+}  // namespace orbit_gl
+
+#endif  // ORBIT_GL_TRACK_LAYOUT_H_
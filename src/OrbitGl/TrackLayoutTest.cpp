@@ -0,0 +1,72 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <utility>
+
+#include "TrackLayout.h"
+
+namespace orbit_gl {
+
+TEST(TrackLayout, OffsetsAreUpdatedFromTheFirstChangedTrack) {
+  TrackLayout layout;
+  EXPECT_EQ(layout.UpdateOffsets(), 0);
+  EXPECT_EQ(layout.GetTotalExtent(), 0.f);
+
+  layout.SetTrackCount(4);
+  for (size_t i = 0; i < 4; ++i) {
+    layout.SetTrackExtent(i, 10.f);
+  }
+  EXPECT_EQ(layout.UpdateOffsets(), 0);
+  EXPECT_EQ(layout.GetTrackOffset(0), 0.f);
+  EXPECT_EQ(layout.GetTrackOffset(3), 30.f);
+  EXPECT_EQ(layout.GetTotalExtent(), 40.f);
+
+  // Nothing changed.
+  layout.SetTrackExtent(1, 10.f);
+  EXPECT_EQ(layout.UpdateOffsets(), 4);
+
+  // Only the tracks below the one whose extent changed move.
+  layout.SetTrackExtent(1, 15.f);
+  EXPECT_EQ(layout.UpdateOffsets(), 2);
+  EXPECT_EQ(layout.GetTrackOffset(1), 10.f);
+  EXPECT_EQ(layout.GetTrackOffset(2), 25.f);
+  EXPECT_EQ(layout.GetTotalExtent(), 45.f);
+
+  layout.InvalidateOffsetsFrom(3);
+  EXPECT_EQ(layout.UpdateOffsets(), 3);
+
+  // Removing tracks keeps the others.
+  layout.SetTrackCount(2);
+  EXPECT_EQ(layout.UpdateOffsets(), 2);
+  EXPECT_EQ(layout.GetTotalExtent(), 25.f);
+
+  // Added tracks are empty until their extents are set.
+  layout.SetTrackCount(3);
+  EXPECT_EQ(layout.UpdateOffsets(), 2);
+  EXPECT_EQ(layout.GetTotalExtent(), 25.f);
+}
+
+TEST(TrackLayout, FindTracksInRange) {
+  TrackLayout layout;
+  layout.SetTrackCount(5);
+  for (size_t i = 0; i < 5; ++i) {
+    layout.SetTrackExtent(i, 10.f);
+  }
+  (void)layout.UpdateOffsets();
+
+  EXPECT_EQ(layout.FindTracksInRange(-100.f, 100.f), (std::pair<size_t, size_t>{0, 5}));
+  EXPECT_EQ(layout.FindTracksInRange(12.f, 28.f), (std::pair<size_t, size_t>{1, 3}));
+  EXPECT_EQ(layout.FindTracksInRange(10.f, 20.f), (std::pair<size_t, size_t>{0, 3}));
+  EXPECT_EQ(layout.FindTracksInRange(15.f, 15.f), (std::pair<size_t, size_t>{1, 2}));
+
+  // No track is in the range.
+  auto [first_below, last_below] = layout.FindTracksInRange(60.f, 100.f);
+  EXPECT_EQ(first_below, last_below);
+  auto [first_above, last_above] = layout.FindTracksInRange(-20.f, -10.f);
+  EXPECT_EQ(first_above, last_above);
+}
+
+}  // namespace orbit_gl
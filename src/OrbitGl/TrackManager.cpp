@@ -12,12 +12,15 @@
 #include <absl/strings/match.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <stdlib.h>
 
 #include <algorithm>
 #include <cstdint>
 #include <optional>
 #include <string_view>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -26,8 +29,11 @@
 #include "ClientData/CallstackData.h"
 #include "ClientModel/CaptureData.h"
 #include "CoreMath.h"
+#include "DataManager.h"
 #include "GlCanvas.h"
 #include "OrbitBase/Append.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/JoinFutures.h"
 #include "OrbitBase/ThreadConstants.h"
 #include "TimeGraph.h"
 #include "TimeGraphLayout.h"
@@ -36,10 +42,32 @@
 using orbit_client_data::CallstackData;
 using orbit_gl::CGroupAndProcessMemoryTrack;
 using orbit_gl::PagefaultTrack;
+using orbit_gl::PmuCountersTrack;
+using orbit_gl::ServiceHealthTrack;
 using orbit_gl::SystemMemoryTrack;
 using orbit_gl::VariableTrack;
 
 ABSL_DECLARE_FLAG(bool, enable_tracepoint_feature);
+ABSL_DECLARE_FLAG(uint32_t, timer_memory_budget_mb);
+
+namespace {
+
+// How long the tracks can take to generate their primitives in a frame, leaving the rest of the
+// time of a frame at 30 fps for drawing them.
+constexpr absl::Duration kTrackPrimitivesTimeBudget = absl::Milliseconds(15);
+constexpr absl::Duration kMinTimeBetweenTimerSpills = absl::Seconds(1);
+
+// The data added to a track until its primitives are generated is drawn with them, so only the
+// data added after can be appended to them, and only if it doesn't come before the returned end of
+// the data of the track.
+[[nodiscard]] uint64_t TakeNewDataAndGetDataMaxTick(Track* track, PickingMode picking_mode) {
+  // Only the primitives for drawing are appended to.
+  if (picking_mode != PickingMode::kNone) return orbit_gl::PrimitivesCache::kUnknownDataMaxTick;
+  track->TakeNewDataTimeRange();
+  return track->GetMaxTime();
+}
+
+}  // namespace
 
 TrackManager::TrackManager(TimeGraph* time_graph, orbit_gl::Viewport* viewport,
                            TimeGraphLayout* layout, OrbitApp* app,
@@ -52,8 +80,16 @@ TrackManager::TrackManager(TimeGraph* time_graph, orbit_gl::Viewport* viewport,
   for (auto& type : Track::kAllTrackTypes) {
     track_type_visibility_[type] = true;
   }
+
+  // std::thread::hardware_concurrency may return 0 on unsupported platforms.
+  const size_t max_number_of_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  thread_pool_ = ThreadPool::Create(/*thread_pool_min_size=*/1,
+                                    /*thread_pool_max_size=*/max_number_of_threads,
+                                    /*thread_ttl=*/absl::Seconds(1));
 }
 
+TrackManager::~TrackManager() { thread_pool_->ShutdownAndWait(); }
+
 std::vector<Track*> TrackManager::GetAllTracks() const {
   std::vector<Track*> tracks;
   for (const auto& track : all_tracks_) {
@@ -79,6 +115,13 @@ std::vector<FrameTrack*> TrackManager::GetFrameTracks() const {
   return tracks;
 }
 
+FrameTrack* TrackManager::GetFrameTrack(uint64_t function_id) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  auto track_it = frame_tracks_.find(function_id);
+  if (track_it == frame_tracks_.end()) return nullptr;
+  return track_it->second.get();
+}
+
 void TrackManager::SortTracks() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   // Gather all tracks regardless of the process in sorted order
@@ -112,11 +155,21 @@ void TrackManager::SortTracks() {
     all_processes_sorted_tracks.push_back(pagefault_track_.get());
   }
 
+  // Service health track.
+  if (service_health_track_ != nullptr && !service_health_track_->IsEmpty()) {
+    all_processes_sorted_tracks.push_back(service_health_track_.get());
+  }
+
   // Async tracks.
   for (const auto& async_track : async_tracks_) {
     all_processes_sorted_tracks.push_back(async_track.second.get());
   }
 
+  // Fiber tracks.
+  for (const auto& [unused_fiber_id, fiber_track] : fiber_tracks_) {
+    all_processes_sorted_tracks.push_back(fiber_track.get());
+  }
+
   // Tracepoint tracks.
   if (absl::GetFlag(FLAGS_enable_tracepoint_feature)) {
     if (app_ != nullptr && app_->HasCaptureData()) {
@@ -142,22 +195,26 @@ void TrackManager::SortTracks() {
     if (!thread_track->IsEmpty()) {
       all_processes_sorted_tracks.push_back(thread_track);
     }
+    // The PMU counters of a thread are shown right below its thread track.
+    if (auto it = pmu_counters_tracks_.find(thread_track->GetThreadId());
+        it != pmu_counters_tracks_.end() && !it->second->IsEmpty()) {
+      all_processes_sorted_tracks.push_back(it->second.get());
+    }
   }
 
-  // Separate "capture_pid" tracks from tracks that originate from other processes.
-  int32_t capture_pid = capture_data_->process_id();
+  // Separate tracks of the captured processes from tracks that originate from other processes.
   std::vector<Track*> capture_pid_tracks;
   std::vector<Track*> external_pid_tracks;
   for (auto& track : all_processes_sorted_tracks) {
     int32_t pid = track->GetProcessId();
-    if (pid != -1 && pid != capture_pid) {
+    if (pid != -1 && !capture_data_->IsCapturedProcess(pid)) {
       external_pid_tracks.push_back(track);
     } else {
       capture_pid_tracks.push_back(track);
     }
   }
 
-  // Clear before repopulating.
+  std::vector<Track*> previous_sorted_tracks = std::move(sorted_tracks_);
   sorted_tracks_.clear();
 
   // Scheduler track.
@@ -172,7 +229,8 @@ void TrackManager::SortTracks() {
   last_thread_reorder_.Restart();
 
   sorting_invalidated_ = false;
-  visible_track_list_needs_update_ = true;
+  // During a capture, the tracks are sorted every second, but their order rarely changes.
+  if (sorted_tracks_ != previous_sorted_tracks) visible_track_list_needs_update_ = true;
 }
 
 void TrackManager::SetFilter(const std::string& filter) {
@@ -181,6 +239,7 @@ void TrackManager::SetFilter(const std::string& filter) {
 }
 
 void TrackManager::UpdateVisibleTrackList() {
+  std::vector<Track*> previous_visible_tracks = std::move(visible_tracks_);
   visible_tracks_.clear();
 
   auto track_should_be_shown = [this](const Track* track) {
@@ -190,24 +249,30 @@ void TrackManager::UpdateVisibleTrackList() {
   if (filter_.empty()) {
     std::copy_if(sorted_tracks_.begin(), sorted_tracks_.end(), std::back_inserter(visible_tracks_),
                  track_should_be_shown);
-    return;
-  }
-
-  std::vector<std::string> filters = absl::StrSplit(filter_, ' ', absl::SkipWhitespace());
-  for (const auto& track : sorted_tracks_) {
-    if (!track_should_be_shown(track)) {
-      continue;
-    }
+  } else {
+    std::vector<std::string> filters = absl::StrSplit(filter_, ' ', absl::SkipWhitespace());
+    for (const auto& track : sorted_tracks_) {
+      if (!track_should_be_shown(track)) {
+        continue;
+      }
 
-    std::string lower_case_label = absl::AsciiStrToLower(track->GetLabel());
-    for (auto& filter : filters) {
-      if (absl::StrContains(lower_case_label, filter)) {
-        visible_tracks_.push_back(track);
-        break;
+      std::string lower_case_label = absl::AsciiStrToLower(track->GetLabel());
+      for (auto& filter : filters) {
+        if (absl::StrContains(lower_case_label, filter)) {
+          visible_tracks_.push_back(track);
+          break;
+        }
       }
     }
+    visible_track_list_needs_update_ = false;
   }
-  visible_track_list_needs_update_ = false;
+
+  // The layout of the tracks only needs to be updated from the first track that changed.
+  auto first_difference = std::mismatch(visible_tracks_.begin(), visible_tracks_.end(),
+                                        previous_visible_tracks.begin(),
+                                        previous_visible_tracks.end())
+                              .first;
+  track_layout_.InvalidateOffsetsFrom(first_difference - visible_tracks_.begin());
 }
 
 std::vector<ThreadTrack*> TrackManager::GetSortedThreadTracks() {
@@ -224,10 +289,18 @@ std::vector<ThreadTrack*> TrackManager::GetSortedThreadTracks() {
     num_events_by_track[track.get()] = num_events;
   }
 
-  // Tracks with instrumented timers appear first, ordered by descending order of timers.
-  // The remaining tracks appear after, ordered by descending order of callstack events.
+  // The threads of the target process appear first, followed by the threads of each additional
+  // process of the capture, grouped by process. Within a process, tracks with instrumented timers
+  // appear first, ordered by descending order of timers. The remaining tracks appear after, ordered
+  // by descending order of callstack events.
+  const int32_t capture_pid = capture_data_->process_id();
+  auto process_rank = [capture_pid](const ThreadTrack* track) {
+    int32_t pid = track->GetProcessId();
+    return (pid == -1 || pid == capture_pid) ? 0 : pid;
+  };
   std::sort(sorted_tracks.begin(), sorted_tracks.end(),
-            [&num_events_by_track](ThreadTrack* a, ThreadTrack* b) {
+            [&num_events_by_track, &process_rank](ThreadTrack* a, ThreadTrack* b) {
+              if (process_rank(a) != process_rank(b)) return process_rank(a) < process_rank(b);
               return std::make_tuple(a->GetNumTimers(), num_events_by_track[a]) >
                      std::make_tuple(b->GetNumTimers(), num_events_by_track[b]);
             });
@@ -269,6 +342,8 @@ void TrackManager::UpdateMovingTrackPositionInVisibleTracks() {
     if (moving_track_current_position == moving_track_previous_position) {
       return;
     }
+    track_layout_.InvalidateOffsetsFrom(
+        std::min(moving_track_current_position, moving_track_previous_position));
     sorted_tracks_.erase(std::find(sorted_tracks_.begin(), sorted_tracks_.end(), moving_track));
     if (moving_track_current_position > moving_track_previous_position) {
       // In this case we will insert the moving_track right after the one who is before in the
@@ -298,26 +373,239 @@ int TrackManager::FindMovingTrackIndex() {
   return -1;
 }
 
-void TrackManager::UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+void TrackManager::UpdateTrackPrimitives(Batcher* batcher, TextRenderer* text_renderer,
+                                         uint64_t min_tick, uint64_t max_tick,
                                          PickingMode picking_mode) {
   // Make sure track tab fits in the viewport.
-  float current_y = -layout_->GetSchedulerTrackOffset();
+  const float tracks_top_y = -layout_->GetSchedulerTrackOffset();
+
+  // Only the tracks below the first one whose height changed move, so the others keep their
+  // positions, which don't depend on the vertical scrolling.
+  track_layout_.SetTrackCount(visible_tracks_.size());
+  for (size_t i = 0; i < visible_tracks_.size(); ++i) {
+    track_layout_.SetTrackExtent(
+        i, visible_tracks_[i]->GetHeight() + layout_->GetSpaceBetweenTracks());
+  }
+  const size_t first_moved_track_index = track_layout_.UpdateOffsets();
+  for (size_t i = first_moved_track_index; i < visible_tracks_.size(); ++i) {
+    Track* track = visible_tracks_[i];
+    if (!track->IsMoving()) {
+      track->SetPos(track->GetPos()[0], tracks_top_y - track_layout_.GetTrackOffset(i));
+    }
+  }
 
-  // Draw tracks
-  for (auto& track : visible_tracks_) {
-    const float z_offset = track->IsMoving() ? GlCanvas::kZOffsetMovingTrack : 0.f;
+  const float world_top = viewport_->GetWorldTopLeft()[1];
+  const float world_bottom = world_top - viewport_->GetVisibleWorldHeight();
+
+  // Only the tracks on the screen, and the one being moved, are drawn.
+  const auto [first_track_on_screen, last_track_on_screen] =
+      track_layout_.FindTracksInRange(tracks_top_y - world_top, tracks_top_y - world_bottom);
+  // A track that was moved and dropped goes back to its place in the layout.
+  for (size_t i = first_track_on_screen; i < last_track_on_screen; ++i) {
+    Track* track = visible_tracks_[i];
     if (!track->IsMoving()) {
-      track->SetPos(track->GetPos()[0], current_y);
+      track->SetPos(track->GetPos()[0], tracks_top_y - track_layout_.GetTrackOffset(i));
+    }
+  }
+  tracks_in_viewport_.assign(visible_tracks_.begin() + first_track_on_screen,
+                             visible_tracks_.begin() + last_track_on_screen);
+  const int moving_track_index = FindMovingTrackIndex();
+  if (moving_track_index != -1) {
+    const auto index = static_cast<size_t>(moving_track_index);
+    if (index < first_track_on_screen) {
+      tracks_in_viewport_.insert(tracks_in_viewport_.begin(), visible_tracks_[index]);
+    } else if (index >= last_track_on_screen) {
+      tracks_in_viewport_.push_back(visible_tracks_[index]);
     }
-    track->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
-    current_y -= (track->GetHeight() + layout_->GetSpaceBetweenTracks());
   }
 
-  // TODO: This margin should be treated in a different way (http://b/192070555).
-  current_y -= layout_->GetBottomMargin();
+  // The primitives don't depend on the vertical scrolling, so when only that changes, all tracks
+  // can reuse their cached primitives.
+  orbit_gl::PrimitivesCacheKey cache_key;
+  cache_key.data_version = primitives_data_version_;
+  cache_key.min_tick = min_tick;
+  cache_key.max_tick = max_tick;
+  cache_key.world_start_x = viewport_->GetWorldTopLeft()[0];
+  cache_key.world_width = viewport_->GetVisibleWorldWidth();
+  cache_key.screen_width = viewport_->GetScreenWidth();
+  cache_key.picking_mode = picking_mode;
+
+  std::vector<orbit_gl::PrimitivesCacheKey> cache_keys;
+  cache_keys.reserve(tracks_in_viewport_.size());
+  std::vector<size_t> outdated_track_indices;
+  // Outdated tracks whose cached primitives are still drawn at the right place, as only the data
+  // changed.
+  std::vector<size_t> deferrable_track_indices;
+  std::vector<bool> is_track_on_screen;
+  is_track_on_screen.reserve(tracks_in_viewport_.size());
+  // Tracks whose cached primitives only need the ones of new data appended, e.g., when following
+  // the end of a live capture. That is cheap, so they are updated on this thread.
+  std::vector<bool> is_track_appended_to(tracks_in_viewport_.size(), false);
+  for (size_t i = 0; i < tracks_in_viewport_.size(); ++i) {
+    Track* track = tracks_in_viewport_[i];
+    const float z_offset = track->IsMoving() ? GlCanvas::kZOffsetMovingTrack : 0.f;
+    cache_key.track_data_version = track->GetDataVersion();
+    cache_key.pos = track->GetPos();
+    cache_key.size = track->GetSize();
+    cache_key.height = track->GetHeight();
+    cache_key.z_offset = z_offset;
+    cache_keys.push_back(cache_key);
+    is_track_on_screen.push_back(cache_key.pos[1] >= world_bottom &&
+                                 cache_key.pos[1] - cache_key.height <= world_top);
+    const orbit_gl::PrimitivesCache& cache = track->GetPrimitivesCache(picking_mode);
+    // Picking needs all the primitives to be generated for the current time range.
+    if (!cache.IsValid(cache_key) && picking_mode == PickingMode::kNone &&
+        track->CanAppendPrimitivesOfNewData() &&
+        cache.GetTimeRangeToAppend(cache_key, std::nullopt).has_value()) {
+      is_track_appended_to[i] = true;
+      continue;
+    }
+    if (!cache.IsValid(cache_key)) {
+      // Picking needs the current primitives, so only drawing falls back to outdated ones.
+      if (picking_mode == PickingMode::kNone && cache.IsValidExceptForDataVersion(cache_key)) {
+        deferrable_track_indices.push_back(i);
+      } else {
+        outdated_track_indices.push_back(i);
+      }
+    }
+  }
+
+  // The tracks on the screen come first, and among those the ones whose primitives are the oldest,
+  // so that all tracks get updated over the next frames. The tracks that have to be updated come
+  // before all of them.
+  std::stable_sort(deferrable_track_indices.begin(), deferrable_track_indices.end(),
+                   [this, &is_track_on_screen, picking_mode](size_t lhs, size_t rhs) {
+                     if (is_track_on_screen[lhs] != is_track_on_screen[rhs]) {
+                       return static_cast<bool>(is_track_on_screen[lhs]);
+                     }
+                     return tracks_in_viewport_[lhs]->GetPrimitivesCache(picking_mode)
+                                .GetRecordedDataVersion() <
+                            tracks_in_viewport_[rhs]->GetPrimitivesCache(picking_mode)
+                                .GetRecordedDataVersion();
+                   });
+  const size_t first_deferrable_track_index = outdated_track_indices.size();
+  orbit_base::Append(outdated_track_indices, deferrable_track_indices);
+
+  // When more than one track needs new primitives, they are generated in parallel, each into its
+  // own cache. The caches are then replayed in the order of the tracks, so that the primitives end
+  // up in the batcher in the same order as when they are generated on this thread.
+  // Once the time budget of the frame is used up, the tracks that can be deferred keep their
+  // outdated primitives, except for the first one, so that every frame makes progress.
+  if (outdated_track_indices.size() > 1) {
+    const absl::Time deadline = absl::Now() + kTrackPrimitivesTimeBudget;
+    std::vector<orbit_base::Future<void>> task_futures;
+    task_futures.reserve(outdated_track_indices.size());
+    for (size_t index = 0; index < outdated_track_indices.size(); ++index) {
+      Track* track = tracks_in_viewport_[outdated_track_indices[index]];
+      const orbit_gl::PrimitivesCacheKey* track_cache_key =
+          &cache_keys[outdated_track_indices[index]];
+      const bool can_be_deferred = index > first_deferrable_track_index;
+      task_futures.emplace_back(thread_pool_->Schedule([batcher, track, track_cache_key, min_tick,
+                                                        max_tick, picking_mode, can_be_deferred,
+                                                        deadline] {
+        if (can_be_deferred && absl::Now() > deadline) return;
+        // This thread waits for the task, so it can't change the selection meanwhile.
+        DataManager::ScopedReadAccessFromWorkerThread read_access;
+        Batcher recording_batcher(batcher->GetBatcherId(), batcher->GetPickingManager());
+        const uint64_t data_max_tick = TakeNewDataAndGetDataMaxTick(track, picking_mode);
+        track->GetPrimitivesCache(picking_mode)
+            .Record(
+                *track_cache_key, &recording_batcher,
+                [&] {
+                  track->UpdatePrimitives(&recording_batcher, min_tick, max_tick, picking_mode,
+                                          track_cache_key->z_offset);
+                },
+                data_max_tick);
+      }));
+    }
+    orbit_base::JoinFutures(absl::MakeConstSpan(task_futures)).Wait();
+  }
+
+  // Draw tracks
+  has_outdated_track_primitives_ = false;
+  for (size_t i = 0; i < tracks_in_viewport_.size(); ++i) {
+    Track* track = tracks_in_viewport_[i];
+    orbit_gl::PrimitivesCache& cache = track->GetPrimitivesCache(picking_mode);
+    if (outdated_track_indices.size() > 1 && !is_track_appended_to[i] &&
+        !cache.IsValid(cache_keys[i]) && cache.IsValidExceptForDataVersion(cache_keys[i]) &&
+        picking_mode == PickingMode::kNone) {
+      cache.Replay(batcher, text_renderer);
+      has_outdated_track_primitives_ = true;
+      continue;
+    }
+    if (is_track_appended_to[i]) {
+      std::optional<std::pair<uint64_t, uint64_t>> new_data_time_range =
+          track->TakeNewDataTimeRange();
+      const uint64_t data_max_tick = track->GetMaxTime();
+      std::optional<std::pair<uint64_t, uint64_t>> time_range_to_append =
+          cache.GetTimeRangeToAppend(cache_keys[i], new_data_time_range);
+      if (time_range_to_append.has_value()) {
+        const auto [min_tick_to_append, max_tick_to_append] = time_range_to_append.value();
+        cache.TranslateAndAppend(
+            cache_keys[i], batcher, text_renderer,
+            [&] {
+              if (min_tick_to_append >= max_tick_to_append) return;
+              track->UpdatePrimitives(batcher, min_tick_to_append, max_tick_to_append,
+                                      picking_mode, cache_keys[i].z_offset);
+            },
+            data_max_tick);
+        continue;
+      }
+      // Some of the new data comes before data that was already drawn.
+      cache.Invalidate();
+      cache.UpdateOrReplay(
+          cache_keys[i], batcher, text_renderer,
+          [&] {
+            track->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode,
+                                    cache_keys[i].z_offset);
+          },
+          data_max_tick);
+      continue;
+    }
+    const uint64_t data_max_tick = cache.IsValid(cache_keys[i])
+                                       ? orbit_gl::PrimitivesCache::kUnknownDataMaxTick
+                                       : TakeNewDataAndGetDataMaxTick(track, picking_mode);
+    cache.UpdateOrReplay(
+        cache_keys[i], batcher, text_renderer,
+        [&] {
+          track->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode,
+                                  cache_keys[i].z_offset);
+        },
+        data_max_tick);
+  }
 
   // Tracks are drawn from 0 (top) to negative y-coordinates.
-  tracks_total_height_ = std::abs(current_y);
+  // TODO: This margin should be treated in a different way (http://b/192070555).
+  tracks_total_height_ =
+      -tracks_top_y + track_layout_.GetTotalExtent() + layout_->GetBottomMargin();
+}
+
+void TrackManager::SpillTimersOutsideTimeRangeIfOverBudget(uint64_t min_tick, uint64_t max_tick) {
+  const uint64_t budget_bytes =
+      static_cast<uint64_t>(absl::GetFlag(FLAGS_timer_memory_budget_mb)) * 1024 * 1024;
+  if (budget_bytes == 0) return;
+  if (orbit_client_data::TimerChain::GetBlockAllocator().allocated_bytes() <= budget_bytes) {
+    return;
+  }
+  if (spill_future_.has_value() && !spill_future_->IsFinished()) return;
+  const absl::Time now = absl::Now();
+  if (now - last_spill_time_ < kMinTimeBetweenTimerSpills) return;
+  last_spill_time_ = now;
+
+  // The chains are shared with the tracks, so they outlive the task even if the tracks are
+  // removed meanwhile.
+  std::vector<std::shared_ptr<orbit_client_data::TimerChain>> chains;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    for (const auto& track : all_tracks_) {
+      orbit_base::Append(chains, track->GetAllChains());
+    }
+  }
+  spill_future_ = thread_pool_->Schedule([chains = std::move(chains), min_tick, max_tick] {
+    for (const auto& chain : chains) {
+      chain->SpillBlocksOutsideTimeRange(min_tick, max_tick);
+    }
+  });
 }
 
 void TrackManager::UpdateTracksForRendering() {
@@ -369,6 +657,7 @@ void TrackManager::RemoveFrameTrack(uint64_t function_id) {
 
 void TrackManager::SetTrackTypeVisibility(Track::Type type, bool value) {
   track_type_visibility_[type] = value;
+  visible_track_list_needs_update_ = true;
   if (time_graph_ != nullptr) {
     time_graph_->RequestUpdate();
   }
@@ -407,8 +696,9 @@ ThreadTrack* TrackManager::GetOrCreateThreadTrack(int32_t tid) {
 
 GpuTrack* TrackManager::GetOrCreateGpuTrack(uint64_t timeline_hash) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  std::string timeline =
-      app_->GetStringManager()->Get(timeline_hash).value_or(std::to_string(timeline_hash));
+  std::optional<std::string_view> timeline_name = app_->GetStringManager()->Get(timeline_hash);
+  std::string timeline = timeline_name.has_value() ? std::string{timeline_name.value()}
+                                                   : std::to_string(timeline_hash);
   std::shared_ptr<GpuTrack> track = gpu_tracks_[timeline];
   if (track == nullptr) {
     track = std::make_shared<GpuTrack>(time_graph_, time_graph_, viewport_, layout_, timeline_hash,
@@ -444,6 +734,19 @@ AsyncTrack* TrackManager::GetOrCreateAsyncTrack(const std::string& name) {
   return track.get();
 }
 
+FiberTrack* TrackManager::GetOrCreateFiberTrack(uint64_t fiber_id) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::shared_ptr<FiberTrack> track = fiber_tracks_[fiber_id];
+  if (track == nullptr) {
+    track = std::make_shared<FiberTrack>(time_graph_, time_graph_, viewport_, layout_, fiber_id,
+                                         app_, capture_data_);
+    AddTrack(track);
+    fiber_tracks_[fiber_id] = track;
+  }
+
+  return track.get();
+}
+
 FrameTrack* TrackManager::GetOrCreateFrameTrack(
     const orbit_grpc_protos::InstrumentedFunction& function) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
@@ -499,6 +802,29 @@ PagefaultTrack* TrackManager::CreateAndGetPagefaultTrack(const std::string& cgro
   return GetPagefaultTrack();
 }
 
+PmuCountersTrack* TrackManager::GetOrCreatePmuCountersTrack(int32_t tid) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::shared_ptr<PmuCountersTrack> track = pmu_counters_tracks_[tid];
+  if (track == nullptr) {
+    track = std::make_shared<PmuCountersTrack>(time_graph_, time_graph_, viewport_, layout_, tid,
+                                               capture_data_);
+    track->SetProcessId(capture_data_->process_id());
+    AddTrack(track);
+    pmu_counters_tracks_[tid] = track;
+  }
+  return track.get();
+}
+
+ServiceHealthTrack* TrackManager::GetOrCreateServiceHealthTrack() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (service_health_track_ == nullptr) {
+    service_health_track_ = std::make_shared<ServiceHealthTrack>(time_graph_, time_graph_,
+                                                                 viewport_, layout_, capture_data_);
+    AddTrack(service_health_track_);
+  }
+  return service_health_track_.get();
+}
+
 uint32_t TrackManager::GetNumTimers() const {
   uint32_t num_timers = 0;
   std::lock_guard<std::recursive_mutex> lock(mutex_);
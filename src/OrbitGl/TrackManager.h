@@ -6,28 +6,36 @@
 #define ORBIT_GL_TRACK_MANAGER_H_
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/time/time.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "AsyncTrack.h"
 #include "CGroupAndProcessMemoryTrack.h"
+#include "FiberTrack.h"
 #include "FrameTrack.h"
 #include "GpuTrack.h"
 #include "GraphTrack.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/ThreadPool.h"
 #include "PagefaultTrack.h"
 #include "PickingManager.h"
+#include "PmuCountersTrack.h"
 #include "SchedulerTrack.h"
+#include "ServiceHealthTrack.h"
 #include "StringManager.h"
 #include "SystemMemoryTrack.h"
 #include "ThreadTrack.h"
 #include "Timer.h"
 #include "Track.h"
+#include "TrackLayout.h"
 #include "VariableTrack.h"
 #include "Viewport.h"
 #include "capture_data.pb.h"
@@ -42,19 +50,42 @@ class TrackManager {
   explicit TrackManager(TimeGraph* time_graph, orbit_gl::Viewport* viewport,
                         TimeGraphLayout* layout, OrbitApp* app,
                         const orbit_client_model::CaptureData* capture_data);
+  ~TrackManager();
 
   [[nodiscard]] std::vector<Track*> GetAllTracks() const;
   [[nodiscard]] std::vector<Track*> GetVisibleTracks() const { return visible_tracks_; }
+  // The visible tracks on the screen as of the last call to UpdateTrackPrimitives, plus the track
+  // being moved, if any. Only these tracks are drawn.
+  [[nodiscard]] const std::vector<Track*>& GetTracksInViewport() const {
+    return tracks_in_viewport_;
+  }
   [[nodiscard]] std::vector<ThreadTrack*> GetThreadTracks() const;
   [[nodiscard]] std::vector<FrameTrack*> GetFrameTracks() const;
+  // Returns nullptr if there is no frame track for the function with id `function_id`.
+  [[nodiscard]] FrameTrack* GetFrameTrack(uint64_t function_id) const;
 
   void RequestTrackSorting() { sorting_invalidated_ = true; };
   void SetFilter(const std::string& filter);
 
   void UpdateTracksForRendering();
-  void UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
-                             PickingMode picking_mode);
+  // Tracks add the primitives they cached if they were generated for the same visible time range,
+  // viewport, and position of the track, and if the cached primitives haven't been invalidated
+  // since. When drawing, tracks whose cached primitives were only invalidated by changes of the
+  // data add them anyway once the time budget of the frame is used up, see
+  // HasOutdatedTrackPrimitives.
+  void UpdateTrackPrimitives(Batcher* batcher, TextRenderer* text_renderer, uint64_t min_tick,
+                             uint64_t max_tick, PickingMode picking_mode);
+  // Whether some tracks added outdated primitives in the last call to UpdateTrackPrimitives, so
+  // that the primitives need to be updated again in the next frame.
+  [[nodiscard]] bool HasOutdatedTrackPrimitives() const { return has_outdated_track_primitives_; }
+  // To be called whenever the data or the state that the primitives of the tracks depend on
+  // changes, so that all tracks generate their primitives again.
+  void InvalidateTrackPrimitiveCaches() { ++primitives_data_version_; }
   [[nodiscard]] float GetTracksTotalHeight() const { return tracks_total_height_; }
+  // When the timers take more memory than --timer_memory_budget_mb, moves the blocks of timers
+  // that are entirely outside of [min_tick, max_tick] to their temporary file, in the background
+  // and at most once per second.
+  void SpillTimersOutsideTimeRangeIfOverBudget(uint64_t min_tick, uint64_t max_tick);
 
   [[nodiscard]] uint32_t GetNumTimers() const;
   [[nodiscard]] std::pair<uint64_t, uint64_t> GetTracksMinMaxTimestamps() const;
@@ -64,6 +95,7 @@ class TrackManager {
   GpuTrack* GetOrCreateGpuTrack(uint64_t timeline_hash);
   orbit_gl::VariableTrack* GetOrCreateVariableTrack(const std::string& name);
   AsyncTrack* GetOrCreateAsyncTrack(const std::string& name);
+  FiberTrack* GetOrCreateFiberTrack(uint64_t fiber_id);
   FrameTrack* GetOrCreateFrameTrack(const orbit_grpc_protos::InstrumentedFunction& function);
   [[nodiscard]] orbit_gl::SystemMemoryTrack* GetSystemMemoryTrack() const {
     return system_memory_track_.get();
@@ -77,6 +109,8 @@ class TrackManager {
   orbit_gl::PagefaultTrack* GetPagefaultTrack() const { return pagefault_track_.get(); }
   orbit_gl::PagefaultTrack* CreateAndGetPagefaultTrack(const std::string& cgroup_name,
                                                        uint64_t memory_sampling_period_ms);
+  orbit_gl::PmuCountersTrack* GetOrCreatePmuCountersTrack(int32_t tid);
+  orbit_gl::ServiceHealthTrack* GetOrCreateServiceHealthTrack();
 
   [[nodiscard]] bool GetIsDataFromSavedCapture() const { return data_from_saved_capture_; }
   void SetIsDataFromSavedCapture(bool value) { data_from_saved_capture_ = value; }
@@ -101,7 +135,9 @@ class TrackManager {
 
   std::vector<std::shared_ptr<Track>> all_tracks_;
   absl::flat_hash_map<int32_t, std::shared_ptr<ThreadTrack>> thread_tracks_;
+  absl::flat_hash_map<int32_t, std::shared_ptr<orbit_gl::PmuCountersTrack>> pmu_counters_tracks_;
   std::map<std::string, std::shared_ptr<AsyncTrack>> async_tracks_;
+  std::map<uint64_t, std::shared_ptr<FiberTrack>> fiber_tracks_;
   std::map<std::string, std::shared_ptr<orbit_gl::VariableTrack>> variable_tracks_;
   // Mapping from timeline to GPU tracks. Timeline name is used for stable ordering. In particular
   // we want the marker tracks next to their queue track. E.g. "gfx" and "gfx_markers" should appear
@@ -113,6 +149,7 @@ class TrackManager {
   std::shared_ptr<orbit_gl::SystemMemoryTrack> system_memory_track_;
   std::shared_ptr<orbit_gl::CGroupAndProcessMemoryTrack> cgroup_and_process_memory_track_;
   std::shared_ptr<orbit_gl::PagefaultTrack> pagefault_track_;
+  std::shared_ptr<orbit_gl::ServiceHealthTrack> service_health_track_;
 
   TimeGraph* time_graph_;
   orbit_gl::Viewport* viewport_;
@@ -125,14 +162,24 @@ class TrackManager {
 
   std::string filter_;
   std::vector<Track*> visible_tracks_;
+  // The positions of the visible tracks.
+  orbit_gl::TrackLayout track_layout_;
+  std::vector<Track*> tracks_in_viewport_;
 
   float tracks_total_height_ = 0.0f;
+  uint64_t primitives_data_version_ = 0;
+  bool has_outdated_track_primitives_ = false;
   const orbit_client_model::CaptureData* capture_data_ = nullptr;
 
   OrbitApp* app_ = nullptr;
 
   bool data_from_saved_capture_ = false;
   absl::flat_hash_map<Track::Type, bool> track_type_visibility_;
+
+  // Generates the primitives of the tracks in parallel.
+  std::shared_ptr<ThreadPool> thread_pool_;
+  std::optional<orbit_base::Future<void>> spill_future_;
+  absl::Time last_spill_time_;
 };
 
 #endif  // ORBIT_GL_TRACK_MANAGER_H_
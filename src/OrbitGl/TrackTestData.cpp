@@ -4,6 +4,10 @@
 
 #include "TrackTestData.h"
 
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
 namespace orbit_gl {
 
 std::unique_ptr<orbit_client_model::CaptureData> TrackTestData::GenerateTestCaptureData() {
@@ -37,4 +41,36 @@ std::unique_ptr<orbit_client_model::CaptureData> TrackTestData::GenerateTestCapt
   return capture_data;
 }
 
+std::vector<orbit_client_protos::TimerInfo> TrackTestData::GenerateTimers(
+    int32_t thread_id, uint64_t timer_count_per_depth, uint32_t depth, uint64_t period_ns) {
+  CHECK(period_ns > 2 * depth);
+  std::vector<orbit_client_protos::TimerInfo> timers;
+  timers.reserve(timer_count_per_depth * depth);
+  for (uint32_t current_depth = 0; current_depth < depth; ++current_depth) {
+    for (uint64_t i = 0; i < timer_count_per_depth; ++i) {
+      orbit_client_protos::TimerInfo& timer = timers.emplace_back();
+      timer.set_start(i * period_ns + current_depth);
+      timer.set_end((i + 1) * period_ns - current_depth - 1);
+      timer.set_thread_id(thread_id);
+      timer.set_process_id(thread_id);
+      timer.set_depth(current_depth);
+      timer.set_function_id(current_depth + 1);
+      timer.set_type(orbit_client_protos::TimerInfo::kNone);
+    }
+  }
+  return timers;
+}
+
+void TrackTestData::AddCallstackEvents(orbit_client_model::CaptureData* capture_data,
+                                       int32_t thread_id, uint64_t count, uint64_t period_ns) {
+  CHECK(capture_data != nullptr);
+  for (uint64_t i = 0; i < count; ++i) {
+    orbit_client_protos::CallstackEvent callstack_event;
+    callstack_event.set_time(i * period_ns);
+    callstack_event.set_callstack_id(kCallstackId);
+    callstack_event.set_thread_id(thread_id);
+    capture_data->AddCallstackEvent(std::move(callstack_event));
+  }
+}
+
 }  // namespace orbit_gl
\ No newline at end of file
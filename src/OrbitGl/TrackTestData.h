@@ -7,8 +7,10 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "ClientModel/CaptureData.h"
+#include "capture_data.pb.h"
 
 namespace orbit_gl {
 
@@ -25,6 +27,20 @@ struct TrackTestData {
   static constexpr const char* kTimerOnlyThreadName = "timer only thread";
 
   static std::unique_ptr<orbit_client_model::CaptureData> GenerateTestCaptureData();
+
+  // The following generate synthetic captures of configurable size, e.g., for benchmarks.
+
+  // Returns `timer_count_per_depth` consecutive timers of `thread_id` for each depth below
+  // `depth`, every timer being nested in the one above it. The timers at depth 0 start every
+  // `period_ns` nanoseconds, and each level is 1 ns shorter on both sides than the one above.
+  static std::vector<orbit_client_protos::TimerInfo> GenerateTimers(int32_t thread_id,
+                                                                    uint64_t timer_count_per_depth,
+                                                                    uint32_t depth,
+                                                                    uint64_t period_ns);
+  // Adds `count` callstack events of `thread_id` with the callstack kCallstackId, one every
+  // `period_ns` nanoseconds, to a capture generated by GenerateTestCaptureData.
+  static void AddCallstackEvents(orbit_client_model::CaptureData* capture_data, int32_t thread_id,
+                                 uint64_t count, uint64_t period_ns);
 };
 
 }  // namespace orbit_gl
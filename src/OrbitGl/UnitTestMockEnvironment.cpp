@@ -18,3 +18,34 @@ ABSL_FLAG(bool, enable_frame_pointer_validator, false, "Enable validation of fra
 ABSL_FLAG(bool, show_return_values, false, "Show return values on time slices");
 ABSL_FLAG(bool, enable_tracepoint_feature, false,
           "Enable the setting of the panel of kernel tracepoints");
+ABSL_FLAG(uint32_t, capture_compression, 0,
+          "How much OrbitService compresses the capture data it sends: 0 (none), 1 (low), "
+          "2 (medium), or 3 (high)");
+ABSL_FLAG(bool, save_capture_on_instance, false,
+          "Save captures on the instance instead of streaming them, and copy them when done");
+ABSL_FLAG(uint32_t, flight_recorder_window_s, 0,
+          "If not 0, captures only keep the events of the last this many seconds on the instance, "
+          "and send them when 'R' is pressed or the capture is stopped");
+ABSL_FLAG(bool, collect_gpu_pipeline_statistics, false,
+          "Collect the GPU pipeline statistics (e.g., shader invocations) of Vulkan debug markers");
+ABSL_FLAG(bool, sample_process_memory_with_perf_events, false,
+          "Derive the memory usage of the target process from perf counters, reading /proc only "
+          "to resync, which allows memory sampling periods as short as 1 ms");
+ABSL_FLAG(bool, collect_memory_callstacks, false,
+          "Record callstacks on page faults and on mmap and brk calls, shown in the Memory "
+          "Hotspots tab (requires frame pointer unwinding)");
+ABSL_FLAG(bool, collect_kernel_callstacks, false,
+          "Also record the kernel frames of the sampled callstacks and the samples in the "
+          "kernel, e.g., in system calls and page faults (requires frame pointer unwinding)");
+ABSL_FLAG(uint32_t, pipeline_latency_probe_period, 0,
+          "If not 0, follow one in this many perf_event_open records through the capture "
+          "pipeline, and show the latency of each stage in the debug UI of the capture window");
+ABSL_FLAG(uint32_t, statistics_summary_interval_s, 0,
+          "If not 0, captures only send the statistics of the instrumented functions and the "
+          "sampled callstacks, aggregated on the instance over intervals of this many seconds");
+ABSL_FLAG(bool, compensate_instrumentation_overhead, false,
+          "Subtract the overhead of user space instrumentation, measured in the target process, "
+          "from the durations of the instrumented functions and of their instrumented callers");
+ABSL_FLAG(bool, compress_saved_captures, false,
+          "Save captures with a compressed capture section (capture file format version 2), "
+          "which older versions of Orbit can't open");
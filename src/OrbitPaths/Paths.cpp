@@ -55,6 +55,10 @@ static std::filesystem::path CreateAndGetConfigPath() {
 
 std::filesystem::path GetSymbolsFilePath() { return CreateAndGetConfigPath() / "SymbolPaths.txt"; }
 
+std::filesystem::path GetPerformanceTrendIndexFilePath() {
+  return CreateOrGetCacheDir() / "performance_trends.index";
+}
+
 std::filesystem::path CreateOrGetCacheDir() {
   std::filesystem::path cache_dir = CreateOrGetOrbitAppDataDir() / "cache";
   CreateDirectoryOrDie(cache_dir);
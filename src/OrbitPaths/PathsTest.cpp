@@ -24,7 +24,7 @@ TEST(Path, AllAutoCreatedDirsExist) {
 }
 
 TEST(Paths, AllDirsOfFilesExist) {
-  auto test_fns = {GetLogFilePath};
+  auto test_fns = {GetLogFilePath, GetPerformanceTrendIndexFilePath};
 
   for (auto fn : test_fns) {
     std::filesystem::path path = fn().parent_path();
@@ -18,6 +18,7 @@ namespace orbit_paths {
 [[nodiscard]] std::filesystem::path CreateOrGetOrbitUserDataDir();
 [[nodiscard]] std::filesystem::path CreateOrGetLogDir();
 [[nodiscard]] std::filesystem::path GetLogFilePath();
+[[nodiscard]] std::filesystem::path GetPerformanceTrendIndexFilePath();
 
 [[nodiscard]] std::filesystem::path GetPresetDirPriorTo1_66();
 [[nodiscard]] std::filesystem::path GetCaptureDirPriorTo1_66();
@@ -357,3 +357,26 @@ int CallTreeViewItemModel::rowCount(const QModelIndex& parent) const {
 }
 
 int CallTreeViewItemModel::columnCount(const QModelIndex& /*parent*/) const { return kColumnCount; }
+
+bool CallTreeViewItemModel::hasChildren(const QModelIndex& parent) const {
+  return rowCount(parent) > 0 || canFetchMore(parent);
+}
+
+bool CallTreeViewItemModel::canFetchMore(const QModelIndex& parent) const {
+  if (!parent.isValid() || parent.column() > 0) {
+    return false;
+  }
+  auto* item = static_cast<CallTreeNode*>(parent.internalPointer());
+  return call_tree_view_->HasUnexpandedChildren(item);
+}
+
+void CallTreeViewItemModel::fetchMore(const QModelIndex& parent) {
+  if (!canFetchMore(parent)) {
+    return;
+  }
+  auto* item = static_cast<CallTreeNode*>(parent.internalPointer());
+  const int child_count = static_cast<int>(call_tree_view_->GetUnexpandedChildCount(item));
+  beginInsertRows(parent, 0, child_count - 1);
+  call_tree_view_->ExpandChildren(item);
+  endInsertRows();
+}
@@ -29,6 +29,10 @@ class CallTreeViewItemModel : public QAbstractItemModel {
   QModelIndex parent(const QModelIndex& index) const override;
   int rowCount(const QModelIndex& parent) const override;
   int columnCount(const QModelIndex& parent) const override;
+  // The children of the nodes of lazily built views are created when the nodes are expanded.
+  bool hasChildren(const QModelIndex& parent) const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
 
   enum Columns {
     kThreadOrFunction = 0,
@@ -83,6 +83,35 @@ TEST(CallTreeViewItemModel, AbstractItemModelTesterFilledModel) {
   QAbstractItemModelTester(&model, QAbstractItemModelTester::FailureReportingMode::Warning);
 }
 
+TEST(CallTreeViewItemModel, FetchMoreExpandsLazyBottomUpView) {
+  orbit_qt_utils::AssertNoQtLogWarnings message_handler{};
+
+  std::unique_ptr<orbit_client_model::CaptureData> capture_data = GenerateTestCaptureData();
+  orbit_client_data::PostProcessedSamplingData sampling_data =
+      orbit_client_model::CreatePostProcessedSamplingData(*capture_data->GetCallstackData(),
+                                                          *capture_data);
+
+  auto call_tree_view = CallTreeView::CreateLazyBottomUpViewFromPostProcessedSamplingData(
+      sampling_data, *capture_data);
+  CallTreeViewItemModel model{std::move(call_tree_view)};
+  QAbstractItemModelTester(&model, QAbstractItemModelTester::FailureReportingMode::Warning);
+
+  // The function and, below it, the thread.
+  ASSERT_EQ(model.rowCount({}), 1);
+  QModelIndex function_index = model.index(0, 0, {});
+  EXPECT_TRUE(model.hasChildren(function_index));
+  if (model.canFetchMore(function_index)) {
+    EXPECT_EQ(model.rowCount(function_index), 0);
+    model.fetchMore(function_index);
+  }
+  EXPECT_FALSE(model.canFetchMore(function_index));
+  ASSERT_EQ(model.rowCount(function_index), 1);
+  QModelIndex thread_index = model.index(0, 0, function_index);
+  EXPECT_EQ(model.data(thread_index, Qt::DisplayRole).toString(),
+            QString{"%1 [%2]"}.arg(kThreadName).arg(kThreadId));
+  EXPECT_FALSE(model.hasChildren(thread_index));
+}
+
 TEST(CallTreeViewItemModel, SummaryItem) {
   std::unique_ptr<orbit_client_model::CaptureData> capture_data = GenerateTestCaptureData();
 
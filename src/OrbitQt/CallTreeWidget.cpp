@@ -319,6 +319,10 @@ static void ExpandRecursively(QTreeView* tree_view, const QModelIndex& index) {
   if (!index.isValid()) {
     return;
   }
+  // Create the children of lazily built views before visiting them.
+  if (tree_view->model()->canFetchMore(index)) {
+    tree_view->model()->fetchMore(index);
+  }
   for (int i = 0; i < index.model()->rowCount(index); ++i) {
     const QModelIndex& child = index.child(i, 0);
     ExpandRecursively(tree_view, child);
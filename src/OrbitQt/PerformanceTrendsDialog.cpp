@@ -0,0 +1,362 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerformanceTrendsDialog.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/time/time.h>
+
+#include <QBrush>
+#include <QColor>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPalette>
+#include <QPen>
+#include <QPointF>
+#include <QPolygonF>
+#include <QProgressDialog>
+#include <QPushButton>
+#include <QSplitter>
+#include <QString>
+#include <QStringList>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+#include <QVariant>
+#include <Qt>
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "DisplayFormats/DisplayFormats.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitPaths/Paths.h"
+
+using orbit_client_model::FunctionPerformanceTrend;
+using orbit_client_model::PerformanceTrendPoint;
+
+namespace orbit_qt {
+
+namespace {
+
+constexpr const char* kCaptureFileExtension = ".orbit";
+// Beyond this, the errors of indexing are only counted.
+constexpr size_t kMaxReportedErrorCount = 10;
+
+enum Column {
+  kColumnFunction,
+  kColumnModule,
+  kColumnCaptures,
+  kColumnP50,
+  kColumnP95,
+  kColumnP50Change,
+  kColumnP95Change,
+  kColumnCount
+};
+
+const QColor kP50Color{66, 133, 244};
+const QColor kP95Color{244, 160, 0};
+
+[[nodiscard]] QString GetDisplayDuration(std::optional<uint64_t> duration_ns) {
+  if (!duration_ns.has_value()) return "-";
+  return QString::fromStdString(orbit_display_formats::GetDisplayTime(
+      absl::Nanoseconds(static_cast<int64_t>(duration_ns.value()))));
+}
+
+[[nodiscard]] QString GetDisplayChange(std::optional<double> change) {
+  if (!change.has_value()) return "-";
+  return QString::fromStdString(absl::StrFormat("%+.1f%%", change.value() * 100));
+}
+
+}  // namespace
+
+PerformanceTrendPlotWidget::PerformanceTrendPlotWidget(QWidget* parent) : QWidget(parent) {
+  setMinimumHeight(200);
+}
+
+void PerformanceTrendPlotWidget::SetTrend(const FunctionPerformanceTrend* trend) {
+  trend_ = trend;
+  update();
+}
+
+void PerformanceTrendPlotWidget::paintEvent(QPaintEvent* /*event*/) {
+  QPainter painter{this};
+  painter.setRenderHint(QPainter::Antialiasing);
+  if (trend_ == nullptr || trend_->points.empty()) {
+    painter.drawText(rect(), Qt::AlignCenter, "Select a function to plot its trend");
+    return;
+  }
+
+  const int text_height = painter.fontMetrics().height();
+  const int axis_label_width = painter.fontMetrics().horizontalAdvance("000.000 ms") + 8;
+  const QRectF plot_rect =
+      QRectF{rect()}.adjusted(axis_label_width, 2 * text_height, -10, -text_height);
+  if (plot_rect.width() <= 0 || plot_rect.height() <= 0) return;
+
+  const std::vector<PerformanceTrendPoint>& points = trend_->points;
+  uint64_t max_duration_ns = 0;
+  for (const PerformanceTrendPoint& point : points) {
+    max_duration_ns =
+        std::max({max_duration_ns, point.p50_ns.value_or(0), point.p95_ns.value_or(0)});
+  }
+  if (max_duration_ns == 0) max_duration_ns = 1;
+
+  auto get_x = [&plot_rect, &points](size_t index) {
+    if (points.size() == 1) return plot_rect.center().x();
+    return plot_rect.left() +
+           plot_rect.width() * static_cast<double>(index) / static_cast<double>(points.size() - 1);
+  };
+  auto get_y = [&plot_rect, max_duration_ns](uint64_t duration_ns) {
+    return plot_rect.bottom() - plot_rect.height() * static_cast<double>(duration_ns) /
+                                    static_cast<double>(max_duration_ns);
+  };
+
+  painter.setPen(palette().color(QPalette::Text));
+  painter.drawLine(plot_rect.bottomLeft(), plot_rect.bottomRight());
+  painter.drawLine(plot_rect.bottomLeft(), plot_rect.topLeft());
+  painter.drawText(QRectF{0, plot_rect.top() - text_height / 2.0, plot_rect.left() - 4,
+                          static_cast<double>(text_height)},
+                   Qt::AlignRight | Qt::AlignVCenter, GetDisplayDuration(max_duration_ns));
+  painter.drawText(QRectF{0, plot_rect.bottom() - text_height / 2.0, plot_rect.left() - 4,
+                          static_cast<double>(text_height)},
+                   Qt::AlignRight | Qt::AlignVCenter, "0");
+  painter.drawText(QRectF{plot_rect.left(), plot_rect.bottom(), plot_rect.width(),
+                          static_cast<double>(text_height)},
+                   Qt::AlignCenter,
+                   QString("%1 captures, oldest first; dashed lines are new builds")
+                       .arg(points.size()));
+
+  QPen build_change_pen{Qt::gray};
+  build_change_pen.setStyle(Qt::DashLine);
+  painter.setPen(build_change_pen);
+  for (size_t i = 1; i < points.size(); ++i) {
+    if (points[i].module_build_id == points[i - 1].module_build_id) continue;
+    const double x = (get_x(i - 1) + get_x(i)) / 2;
+    painter.drawLine(QPointF{x, plot_rect.top()}, QPointF{x, plot_rect.bottom()});
+  }
+
+  auto draw_percentile = [&](std::optional<uint64_t> PerformanceTrendPoint::*percentile_ns,
+                             const QColor& color) {
+    QPolygonF polyline;
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (!(points[i].*percentile_ns).has_value()) continue;
+      polyline << QPointF{get_x(i), get_y((points[i].*percentile_ns).value())};
+    }
+    painter.setPen(QPen{color, 2});
+    painter.drawPolyline(polyline);
+    painter.setBrush(color);
+    for (const QPointF& point : polyline) painter.drawEllipse(point, 3, 3);
+    painter.setBrush(Qt::NoBrush);
+  };
+  draw_percentile(&PerformanceTrendPoint::p50_ns, kP50Color);
+  draw_percentile(&PerformanceTrendPoint::p95_ns, kP95Color);
+
+  const QRectF legend_rect{plot_rect.left(), 0, plot_rect.width(), 1.5 * text_height};
+  painter.setPen(kP95Color);
+  painter.drawText(legend_rect, Qt::AlignRight | Qt::AlignVCenter, "p95");
+  painter.setPen(kP50Color);
+  const int p95_legend_width = painter.fontMetrics().horizontalAdvance("p95  ");
+  painter.drawText(legend_rect.adjusted(0, 0, -p95_legend_width, 0),
+                   Qt::AlignRight | Qt::AlignVCenter, "p50");
+  painter.setPen(palette().color(QPalette::Text));
+  painter.drawText(legend_rect, Qt::AlignLeft | Qt::AlignVCenter,
+                   QString::fromStdString(trend_->function_name));
+}
+
+PerformanceTrendsDialog::PerformanceTrendsDialog(std::filesystem::path index_file_path,
+                                                 QWidget* parent)
+    : QDialog(parent),
+      index_file_path_{std::move(index_file_path)},
+      summary_label_{new QLabel{this}},
+      functions_tree_{new QTreeWidget{this}},
+      plot_widget_{new PerformanceTrendPlotWidget{this}} {
+  setWindowTitle("Performance Trends");
+  resize(1000, 700);
+
+  auto* add_files_button = new QPushButton{"Add Capture Files...", this};
+  auto* add_directory_button = new QPushButton{"Add Capture Directory...", this};
+  QObject::connect(add_files_button, &QPushButton::clicked, this,
+                   &PerformanceTrendsDialog::AddCaptureFiles);
+  QObject::connect(add_directory_button, &QPushButton::clicked, this,
+                   &PerformanceTrendsDialog::AddCaptureDirectory);
+  auto* top_layout = new QHBoxLayout;
+  top_layout->addWidget(summary_label_, 1);
+  top_layout->addWidget(add_files_button);
+  top_layout->addWidget(add_directory_button);
+
+  functions_tree_->setColumnCount(kColumnCount);
+  functions_tree_->setHeaderLabels(
+      {"Function", "Module", "Captures", "Last p50", "Last p95", "p50 change", "p95 change"});
+  functions_tree_->setRootIsDecorated(false);
+  functions_tree_->header()->setSectionResizeMode(kColumnFunction, QHeaderView::Stretch);
+  functions_tree_->header()->setStretchLastSection(false);
+  QObject::connect(functions_tree_, &QTreeWidget::currentItemChanged, this,
+                   &PerformanceTrendsDialog::OnCurrentFunctionChanged);
+
+  auto* splitter = new QSplitter{Qt::Vertical, this};
+  splitter->addWidget(functions_tree_);
+  splitter->addWidget(plot_widget_);
+
+  auto* button_box = new QDialogButtonBox{QDialogButtonBox::Close, this};
+  QObject::connect(button_box, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  auto* layout = new QVBoxLayout{this};
+  layout->addLayout(top_layout);
+  layout->addWidget(splitter, 1);
+  layout->addWidget(button_box);
+
+  ErrorMessageOr<orbit_client_protos::PerformanceTrendIndex> index_or_error =
+      orbit_client_model::LoadPerformanceTrendIndex(index_file_path_);
+  if (index_or_error.has_error()) {
+    ERROR("Loading performance trend index: %s", index_or_error.error().message());
+    QMessageBox::warning(parent, "Unable to load performance trend index",
+                         QString::fromStdString(index_or_error.error().message()));
+  } else {
+    index_ = std::move(index_or_error.value());
+  }
+  UpdateTrends();
+}
+
+void PerformanceTrendsDialog::AddCaptureFiles() {
+  const QStringList file_names = QFileDialog::getOpenFileNames(
+      this, "Add capture files",
+      QString::fromStdString(orbit_paths::CreateOrGetCaptureDir().string()), "*.orbit");
+  std::vector<std::filesystem::path> file_paths;
+  for (const QString& file_name : file_names) {
+    file_paths.emplace_back(file_name.toStdString());
+  }
+  IndexCaptureFiles(file_paths);
+}
+
+void PerformanceTrendsDialog::AddCaptureDirectory() {
+  const QString directory = QFileDialog::getExistingDirectory(
+      this, "Add capture files of directory",
+      QString::fromStdString(orbit_paths::CreateOrGetCaptureDir().string()));
+  if (directory.isEmpty()) return;
+
+  ErrorMessageOr<std::vector<std::filesystem::path>> file_paths_or_error =
+      orbit_base::ListFilesInDirectory(directory.toStdString());
+  if (file_paths_or_error.has_error()) {
+    QMessageBox::warning(this, "Unable to list capture files",
+                         QString::fromStdString(file_paths_or_error.error().message()));
+    return;
+  }
+  std::vector<std::filesystem::path> file_paths;
+  for (std::filesystem::path& file_path : file_paths_or_error.value()) {
+    if (file_path.extension() == kCaptureFileExtension) file_paths.push_back(std::move(file_path));
+  }
+  std::sort(file_paths.begin(), file_paths.end());
+  IndexCaptureFiles(file_paths);
+}
+
+void PerformanceTrendsDialog::IndexCaptureFiles(
+    const std::vector<std::filesystem::path>& file_paths) {
+  if (file_paths.empty()) return;
+
+  QProgressDialog progress_dialog{"Indexing capture files...", "Cancel", 0,
+                                  static_cast<int>(file_paths.size()), this};
+  progress_dialog.setWindowModality(Qt::WindowModal);
+  progress_dialog.setMinimumDuration(500);
+
+  bool index_changed = false;
+  std::vector<std::string> errors;
+  size_t error_count = 0;
+  for (size_t i = 0; i < file_paths.size(); ++i) {
+    progress_dialog.setValue(static_cast<int>(i));
+    if (progress_dialog.wasCanceled()) break;
+
+    ErrorMessageOr<bool> added_or_error =
+        orbit_client_model::AddCaptureFileToPerformanceTrendIndex(file_paths[i], &index_);
+    if (added_or_error.has_error()) {
+      ERROR("Indexing capture file: %s", added_or_error.error().message());
+      ++error_count;
+      if (errors.size() < kMaxReportedErrorCount) {
+        errors.push_back(added_or_error.error().message());
+      }
+      continue;
+    }
+    index_changed |= added_or_error.value();
+  }
+  progress_dialog.setValue(static_cast<int>(file_paths.size()));
+
+  if (index_changed) {
+    if (ErrorMessageOr<void> result =
+            orbit_client_model::SavePerformanceTrendIndex(index_, index_file_path_);
+        result.has_error()) {
+      ERROR("Saving performance trend index: %s", result.error().message());
+      QMessageBox::warning(this, "Unable to save performance trend index",
+                           QString::fromStdString(result.error().message()));
+    }
+    UpdateTrends();
+  }
+
+  if (error_count > 0) {
+    std::string message = absl::StrJoin(errors, "\n");
+    if (error_count > errors.size()) {
+      absl::StrAppendFormat(&message, "\n... and %u more", error_count - errors.size());
+    }
+    QMessageBox::warning(this,
+                         QString("Unable to index %1 of %2 capture files")
+                             .arg(error_count)
+                             .arg(file_paths.size()),
+                         QString::fromStdString(message));
+  }
+}
+
+void PerformanceTrendsDialog::UpdateTrends() {
+  plot_widget_->SetTrend(nullptr);
+  functions_tree_->clear();
+  trends_ = orbit_client_model::ComputeFunctionPerformanceTrends(index_);
+
+  size_t regression_count = 0;
+  for (size_t i = 0; i < trends_.size(); ++i) {
+    const FunctionPerformanceTrend& trend = trends_[i];
+    const PerformanceTrendPoint& last_point = trend.points.back();
+    auto* item = new QTreeWidgetItem{functions_tree_};
+    item->setText(kColumnFunction, QString::fromStdString(trend.function_name));
+    item->setText(kColumnModule, QString::fromStdString(
+                                     std::filesystem::path{trend.module_path}.filename().string()));
+    item->setToolTip(kColumnModule, QString::fromStdString(trend.module_path));
+    item->setText(kColumnCaptures, QString::number(trend.points.size()));
+    item->setText(kColumnP50, GetDisplayDuration(last_point.p50_ns));
+    item->setText(kColumnP95, GetDisplayDuration(last_point.p95_ns));
+    item->setText(kColumnP50Change, GetDisplayChange(trend.p50_change));
+    item->setText(kColumnP95Change, GetDisplayChange(trend.p95_change));
+    item->setData(kColumnFunction, Qt::UserRole, QVariant::fromValue(static_cast<qulonglong>(i)));
+    if (trend.is_regression) {
+      ++regression_count;
+      for (int column = 0; column < kColumnCount; ++column) {
+        item->setForeground(column, QBrush{Qt::red});
+      }
+    }
+  }
+
+  summary_label_->setText(QString("%1 capture files, %2 functions, %3 regressions in the most "
+                                  "recent capture")
+                              .arg(index_.captures_size())
+                              .arg(trends_.size())
+                              .arg(regression_count));
+  if (functions_tree_->topLevelItemCount() > 0) {
+    functions_tree_->setCurrentItem(functions_tree_->topLevelItem(0));
+  }
+}
+
+void PerformanceTrendsDialog::OnCurrentFunctionChanged() {
+  QTreeWidgetItem* item = functions_tree_->currentItem();
+  if (item == nullptr) {
+    plot_widget_->SetTrend(nullptr);
+    return;
+  }
+  const size_t index = item->data(kColumnFunction, Qt::UserRole).toULongLong();
+  CHECK(index < trends_.size());
+  plot_widget_->SetTrend(&trends_[index]);
+}
+
+}  // namespace orbit_qt
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_QT_PERFORMANCE_TRENDS_DIALOG_H_
+#define ORBIT_QT_PERFORMANCE_TRENDS_DIALOG_H_
+
+#include <QDialog>
+#include <QLabel>
+#include <QObject>
+#include <QPaintEvent>
+#include <QTreeWidget>
+#include <QWidget>
+#include <filesystem>
+#include <vector>
+
+#include "ClientModel/PerformanceTrends.h"
+#include "performance_trend_index.pb.h"
+
+namespace orbit_qt {
+
+// Plots the median and the 95th percentile of the durations of a function over captures, oldest
+// on the left, with a vertical line where the build of the module changes.
+class PerformanceTrendPlotWidget : public QWidget {
+ public:
+  explicit PerformanceTrendPlotWidget(QWidget* parent = nullptr);
+
+  void SetTrend(const orbit_client_model::FunctionPerformanceTrend* trend);
+
+ protected:
+  void paintEvent(QPaintEvent* event) override;
+
+ private:
+  const orbit_client_model::FunctionPerformanceTrend* trend_ = nullptr;
+};
+
+// Shows the trends of the instrumented functions across the capture files of the local
+// PerformanceTrendIndex, with the regressions of the most recent capture first. Capture files are
+// added to the index from this dialog, which saves the index on every change.
+class PerformanceTrendsDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit PerformanceTrendsDialog(std::filesystem::path index_file_path,
+                                   QWidget* parent = nullptr);
+
+ private:
+  void AddCaptureFiles();
+  void AddCaptureDirectory();
+  void IndexCaptureFiles(const std::vector<std::filesystem::path>& file_paths);
+  void UpdateTrends();
+  void OnCurrentFunctionChanged();
+
+  const std::filesystem::path index_file_path_;
+  orbit_client_protos::PerformanceTrendIndex index_;
+  std::vector<orbit_client_model::FunctionPerformanceTrend> trends_;
+
+  QLabel* summary_label_;
+  QTreeWidget* functions_tree_;
+  PerformanceTrendPlotWidget* plot_widget_;
+};
+
+}  // namespace orbit_qt
+
+#endif  // ORBIT_QT_PERFORMANCE_TRENDS_DIALOG_H_
@@ -133,6 +133,8 @@ QString TrackTypeItemModel::GetTrackTypeDisplayName(Track::Type track_type) cons
       return "Variables (Manual Instrumentation)";
     case Track::Type::kAsyncTrack:
       [[fallthrough]];
+    case Track::Type::kFiberTrack:
+      [[fallthrough]];
     case Track::Type::kGraphTrack:
       [[fallthrough]];
     case Track::Type::kTimerTrack:
@@ -17,6 +17,7 @@
 #include <utility>
 
 #include "App.h"
+#include "ClientData/FunctionUtils.h"
 #include "DataViews/DataView.h"
 #include "LiveFunctionsDataView.h"
 #include "MetricsUploader/MetricsUploader.h"
@@ -115,7 +116,7 @@ void OrbitLiveFunctions::AddIterator(size_t id, const FunctionInfo* function) {
       this->all_events_iterator_->DisableButtons();
     }
   });
-  iterator_ui->SetFunctionName(function->pretty_name());
+  iterator_ui->SetFunctionName(orbit_client_data::function_utils::GetDisplayName(*function));
 
   iterator_ui->SetMinMaxTime(live_functions_->GetCaptureMin(), live_functions_->GetCaptureMax());
   iterator_ui->SetCurrentTime(live_functions_->GetStartTime(id));
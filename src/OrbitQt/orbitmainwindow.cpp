@@ -24,6 +24,7 @@
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QIODevice>
+#include <QInputDialog>
 #include <QLabel>
 #include <QLineEdit>
 #include <QList>
@@ -91,6 +92,7 @@
 #include "OrbitGgp/Instance.h"
 #include "OrbitPaths/Paths.h"
 #include "OrbitVersion/OrbitVersion.h"
+#include "PerformanceTrendsDialog.h"
 #include "QtUtils/MainThreadExecutorImpl.h"
 #include "SamplingReport.h"
 #include "SessionSetup/Connections.h"
@@ -269,6 +271,11 @@ void OrbitMainWindow::SetupMainWindow() {
     this->OnNewSelectionReport(callstack_data_view, report);
   });
 
+  app_->SetMemoryHotspotsReportCallback([this](orbit_data_views::DataView* callstack_data_view,
+                                               const std::shared_ptr<SamplingReport>& report) {
+    this->OnNewMemoryHotspotsReport(callstack_data_view, report);
+  });
+
   app_->SetTopDownViewCallback([this](std::unique_ptr<CallTreeView> top_down_view) {
     this->OnNewTopDownView(std::move(top_down_view));
   });
@@ -302,6 +309,9 @@ void OrbitMainWindow::SetupMainWindow() {
   app_->SetClipboardCallback([this](const std::string& text) { this->OnSetClipboard(text); });
 
   ui->CaptureGLWidget->Initialize(GlCanvas::CanvasType::kCaptureWindow, this, app_.get());
+  ui->flameGraphWidget->Initialize(GlCanvas::CanvasType::kFlameGraphWindow, this, app_.get());
+  connect(ui->flameGraphSearchLineEdit, &QLineEdit::textChanged, this,
+          [this](const QString& text) { app_->SetFlameGraphSearchString(text.toStdString()); });
 
   app_->SetTimerSelectedCallback([this](const orbit_client_protos::TimerInfo* timer_info) {
     OnTimerSelectionChanged(timer_info);
@@ -322,6 +332,10 @@ void OrbitMainWindow::SetupMainWindow() {
     ui->RightTabWidget->removeTab(ui->RightTabWidget->indexOf(ui->tracepointsTab));
   }
 
+  ui->TimerQueryList->Initialize(
+      data_view_factory->GetOrCreateDataView(DataViewType::kTimerQueryResults),
+      SelectionType::kExtended, FontType::kDefault);
+
   if (!absl::GetFlag(FLAGS_devmode)) {
     ui->menuDebug->menuAction()->setVisible(false);
   }
@@ -351,6 +365,11 @@ void OrbitMainWindow::SetupMainWindow() {
 
   ui->MainTabWidget->tabBar()->installEventFilter(this);
   ui->RightTabWidget->tabBar()->installEventFilter(this);
+  for (QTabWidget* tab_widget : {ui->MainTabWidget, ui->RightTabWidget}) {
+    connect(tab_widget, &QTabWidget::currentChanged, this,
+            [this] { UpdateSelectionCallTreeViewsVisibility(); });
+  }
+  UpdateSelectionCallTreeViewsVisibility();
 
   SetupAccessibleNamesForAutomation();
 
@@ -574,8 +593,10 @@ void OrbitMainWindow::UpdateCaptureStateDependentWidgets() {
   set_tab_enabled(ui->topDownTab, has_data && !is_capturing);
   set_tab_enabled(ui->bottomUpTab, has_data && !is_capturing);
   set_tab_enabled(ui->selectionSamplingTab, has_selection);
+  set_tab_enabled(ui->memoryHotspotsTab, has_data && !is_capturing && app_->HasMemoryHotspots());
   set_tab_enabled(ui->selectionTopDownTab, has_selection);
   set_tab_enabled(ui->selectionBottomUpTab, has_selection);
+  set_tab_enabled(ui->flameGraphTab, has_data);
 
   ui->actionToggle_Capture->setEnabled(
       capture_state == CaptureClient::State::kStarted ||
@@ -583,6 +604,7 @@ void OrbitMainWindow::UpdateCaptureStateDependentWidgets() {
   ui->actionToggle_Capture->setIcon(is_capturing ? icon_stop_capture_ : icon_start_capture_);
   ui->actionCaptureOptions->setEnabled(!is_capturing);
   ui->actionOpen_Capture->setEnabled(!is_capturing);
+  ui->actionOpen_Continuous_Capture->setEnabled(!is_capturing && is_connected_);
   ui->actionOpen_Preset->setEnabled(!is_capturing && is_connected_);
   ui->actionSave_Preset_As->setEnabled(!is_capturing);
   ui->actionConfigureTracks->setEnabled(has_data);
@@ -631,6 +653,7 @@ void OrbitMainWindow::UpdateProcessConnectionStateDependentWidgets() {
   ui->actionToggle_Capture->setEnabled(
       capture_state == CaptureClient::State::kStarted ||
       (capture_state == CaptureClient::State::kStopped && is_target_process_running));
+  ui->actionOpen_Continuous_Capture->setEnabled(!is_capturing && is_connected_);
   ui->actionOpen_Preset->setEnabled(!is_capturing && is_connected_);
 
   UpdateCaptureToolbarIconOpacity();
@@ -697,23 +720,38 @@ QTabWidget* OrbitMainWindow::FindParentTabWidget(const QWidget* widget) const {
   return nullptr;
 }
 
+void OrbitMainWindow::UpdateSelectionCallTreeViewsVisibility() {
+  auto is_current_tab = [this](const QWidget* tab) {
+    const QTabWidget* tab_widget = FindParentTabWidget(tab);
+    return tab_widget != nullptr && tab_widget->currentWidget() == tab;
+  };
+  app_->SetSelectionTopDownViewVisible(is_current_tab(ui->selectionTopDownTab));
+  app_->SetSelectionBottomUpViewVisible(is_current_tab(ui->selectionBottomUpTab));
+}
+
 OrbitMainWindow::~OrbitMainWindow() {
   DeinitTutorials();
+  // The tab widgets outlive app_, and change their current tab while their tabs are destroyed.
+  ui->MainTabWidget->disconnect(this);
+  ui->RightTabWidget->disconnect(this);
 
   ui->selectionBottomUpWidget->Deinitialize();
   ui->bottomUpWidget->Deinitialize();
   ui->selectionTopDownWidget->Deinitialize();
   ui->topDownWidget->Deinitialize();
   ui->TracepointsList->Deinitialize();
+  ui->TimerQueryList->Deinitialize();
   ui->liveFunctions->Deinitialize();
 
   ui->samplingReport->Deinitialize();
   ui->selectionReport->Deinitialize();
+  ui->memoryHotspotsReport->Deinitialize();
 
   if (absl::GetFlag(FLAGS_devmode)) {
     ui->debugOpenGLWidget->Deinitialize(this);
   }
 
+  ui->flameGraphWidget->Deinitialize(this);
   ui->CaptureGLWidget->Deinitialize(this);
   ui->PresetsList->Deinitialize();
   ui->FunctionsList->Deinitialize();
@@ -751,11 +789,16 @@ void OrbitMainWindow::UpdatePanel(DataViewType type) {
     case DataViewType::kPresets:
       ui->PresetsList->Refresh();
       break;
+    case DataViewType::kTimerQueryResults:
+      ui->TimerQueryList->Refresh();
+      break;
     case DataViewType::kSampling:
       ui->samplingReport->RefreshCallstackView();
       ui->samplingReport->RefreshTabs();
       ui->selectionReport->RefreshCallstackView();
       ui->selectionReport->RefreshTabs();
+      ui->memoryHotspotsReport->RefreshCallstackView();
+      ui->memoryHotspotsReport->RefreshTabs();
       break;
     default:
       break;
@@ -799,6 +842,19 @@ void OrbitMainWindow::OnNewSelectionReport(orbit_data_views::DataView* callstack
   UpdateCaptureStateDependentWidgets();
 }
 
+void OrbitMainWindow::OnNewMemoryHotspotsReport(
+    orbit_data_views::DataView* callstack_data_view,
+    const std::shared_ptr<SamplingReport>& sampling_report) {
+  ui->memoryHotspotsGridLayout->removeWidget(ui->memoryHotspotsReport);
+  delete ui->memoryHotspotsReport;
+
+  ui->memoryHotspotsReport = new OrbitSamplingReport(ui->memoryHotspotsTab);
+  ui->memoryHotspotsReport->Initialize(callstack_data_view, sampling_report);
+  ui->memoryHotspotsGridLayout->addWidget(ui->memoryHotspotsReport, 0, 0, 1, 1);
+
+  UpdateCaptureStateDependentWidgets();
+}
+
 void OrbitMainWindow::OnNewTopDownView(std::unique_ptr<CallTreeView> top_down_view) {
   ui->topDownWidget->SetTopDownView(std::move(top_down_view));
 }
@@ -1103,6 +1159,11 @@ void OrbitMainWindow::on_actionIntrospection_triggered() {
   introspection_widget_->show();
 }
 
+void OrbitMainWindow::on_actionPerformanceTrends_triggered() {
+  orbit_qt::PerformanceTrendsDialog dialog{orbit_paths::GetPerformanceTrendIndexFilePath(), this};
+  dialog.exec();
+}
+
 void OrbitMainWindow::RestoreDefaultTabLayout() {
   for (auto& widget_and_layout : default_tab_layout_) {
     QTabWidget* tab_widget = widget_and_layout.first;
@@ -1144,6 +1205,44 @@ void OrbitMainWindow::on_actionOpen_Capture_triggered() {
   QProcess::startDetached(orbit_executable, arguments << file << command_line_flags_);
 }
 
+void OrbitMainWindow::on_actionOpen_Continuous_Capture_triggered() {
+  app_->ListContinuousCaptureFilesOnInstance().Then(
+      main_thread_executor_.get(),
+      [this](ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>> files_or_error) {
+        if (files_or_error.has_error()) {
+          QMessageBox::critical(this, "Error listing continuous captures",
+                                QString::fromStdString(files_or_error.error().message()));
+          return;
+        }
+        if (files_or_error.value().empty()) {
+          QMessageBox::information(this, "No continuous captures",
+                                   "OrbitService has not saved any continuous capture on the "
+                                   "instance. Start it with --continuous_profiling_pid or "
+                                   "--continuous_profiling_process_name.");
+          return;
+        }
+
+        // Most recent first.
+        const std::vector<orbit_grpc_protos::ContinuousCaptureFile>& files =
+            files_or_error.value();
+        std::vector<std::string> file_paths;
+        QStringList items;
+        for (auto it = files.rbegin(); it != files.rend(); ++it) {
+          file_paths.push_back(it->path());
+          items << QString::fromStdString(
+              absl::StrFormat("%s (%s)", it->path(),
+                              orbit_display_formats::GetDisplaySize(it->size_bytes())));
+        }
+        bool ok = false;
+        const QString item = QInputDialog::getItem(this, "Open Continuous Capture from Instance",
+                                                   "Capture file:", items, 0, false, &ok);
+        if (!ok) return;
+        const int index = items.indexOf(item);
+        CHECK(index >= 0);
+        app_->RetrieveAndLoadCaptureFileFromInstance(file_paths[index]);
+      });
+}
+
 void OrbitMainWindow::OpenCapture(const std::string& filepath) {
   auto* loading_capture_dialog =
       new QProgressDialog("Waiting for the capture to be loaded...", nullptr, 0, 0, this, Qt::Tool);
@@ -78,6 +78,8 @@ class OrbitMainWindow final : public QMainWindow, public orbit_gl::MainWindowInt
                            const std::shared_ptr<class SamplingReport>& sampling_report);
   void OnNewSelectionReport(orbit_data_views::DataView* callstack_data_view,
                             const std::shared_ptr<class SamplingReport>& sampling_report);
+  void OnNewMemoryHotspotsReport(orbit_data_views::DataView* callstack_data_view,
+                                 const std::shared_ptr<class SamplingReport>& sampling_report);
 
   void OnNewTopDownView(std::unique_ptr<CallTreeView> top_down_view);
   void OnNewSelectionTopDownView(std::unique_ptr<CallTreeView> selection_top_down_view);
@@ -138,9 +140,11 @@ class OrbitMainWindow final : public QMainWindow, public orbit_gl::MainWindowInt
 
   void on_actionToggle_Capture_triggered();
   void on_actionOpen_Capture_triggered();
+  void on_actionOpen_Continuous_Capture_triggered();
   void on_actionCaptureOptions_triggered();
   void on_actionHelp_toggled(bool checked);
   void on_actionIntrospection_triggered();
+  void on_actionPerformanceTrends_triggered();
 
   void on_actionCheckFalse_triggered();
   void on_actionStackOverflow_triggered();
@@ -170,6 +174,9 @@ class OrbitMainWindow final : public QMainWindow, public orbit_gl::MainWindowInt
   void ClearCaptureFilters();
 
   void UpdateActiveTabsAfterSelection(bool selection_has_samples);
+  // Tells the app whether the selection top-down and bottom-up tabs are the current tabs of their
+  // tab widgets, as these views are only built while they are visible.
+  void UpdateSelectionCallTreeViewsVisibility();
 
   QTabWidget* FindParentTabWidget(const QWidget* widget) const;
 
@@ -5,13 +5,18 @@
 #include "orbittablemodel.h"
 
 #include <QColor>
+#include <QList>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 OrbitTableModel::OrbitTableModel(orbit_data_views::DataView* data_view, QObject* parent,
                                  QFlags<Qt::AlignmentFlag> text_alignment)
-    : QAbstractTableModel(parent), data_view_(data_view), text_alignment_(text_alignment) {}
+    : QAbstractTableModel(parent), data_view_(data_view), text_alignment_(text_alignment) {
+  // The views start with the current rows, so only later changes need to be reported to them.
+  (void)data_view_->TakeRowChanges();
+}
 
 OrbitTableModel::OrbitTableModel(QObject* parent)
     : QAbstractTableModel(parent),
@@ -101,4 +106,47 @@ void OrbitTableModel::OnFilter(const QString& filter) {
   data_view_->OnFilter(filter.toStdString());
 }
 
+void OrbitTableModel::SetDataView(orbit_data_views::DataView* model) {
+  data_view_ = model;
+  (void)data_view_->TakeRowChanges();
+}
+
 void OrbitTableModel::OnRowsSelected(const std::vector<int>& rows) { data_view_->OnSelect(rows); }
+
+void OrbitTableModel::UpdateRows() {
+  const orbit_data_views::DataView::RowChanges changes = data_view_->TakeRowChanges();
+  const int num_rows = rowCount();
+  const int num_columns = columnCount();
+  const int previous_num_rows = static_cast<int>(changes.previous_num_rows);
+
+  if (changes.only_appended) {
+    if (num_rows > previous_num_rows) {
+      beginInsertRows(QModelIndex(), previous_num_rows, num_rows - 1);
+      endInsertRows();
+    }
+    // The views only repaint the cells of this range that are visible.
+    if (previous_num_rows > 0 && num_columns > 0) {
+      emit dataChanged(index(0, 0), index(previous_num_rows - 1, num_columns - 1));
+    }
+    return;
+  }
+
+  // Rows were moved or removed: move the persistent indices, e.g., the selection, with their
+  // elements.
+  emit layoutAboutToBeChanged();
+  const QModelIndexList from = persistentIndexList();
+  QModelIndexList to;
+  to.reserve(from.size());
+  for (const QModelIndex& persistent_index : from) {
+    const int previous_row = persistent_index.row();
+    std::optional<int> row;
+    if (previous_row >= 0 && previous_row < static_cast<int>(changes.previous_row_to_row.size())) {
+      row = changes.previous_row_to_row[previous_row];
+    }
+    to.push_back(row.has_value() && row.value() < num_rows
+                     ? index(row.value(), persistent_index.column())
+                     : QModelIndex());
+  }
+  changePersistentIndexList(from, to);
+  emit layoutChanged();
+}
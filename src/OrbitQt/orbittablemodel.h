@@ -39,13 +39,17 @@ class OrbitTableModel : public QAbstractTableModel {
   }
   QModelIndex CreateIndex(int row, int column) { return createIndex(row, column); }
   orbit_data_views::DataView* GetDataView() { return data_view_; }
-  void SetDataView(orbit_data_views::DataView* model) { data_view_ = model; }
+  void SetDataView(orbit_data_views::DataView* model);
   bool IsSortingAllowed() { return GetDataView()->IsSortingAllowed(); }
   std::pair<int, Qt::SortOrder> GetDefaultSortingColumnAndOrder();
 
   void OnTimer();
   void OnFilter(const QString& filter);
   void OnRowsSelected(const std::vector<int>& rows);
+  // Notifies the views of the rows that were inserted, moved or removed in the DataView since the
+  // last call, and that the values of the others might have changed. Unlike a model reset, this
+  // keeps the selection, the current index and the scroll position of the views.
+  void UpdateRows();
 
  protected:
   orbit_data_views::DataView* data_view_;
@@ -122,8 +122,13 @@ void OrbitTreeView::OnFilter(const QString& filter) {
     return;
   }
 
-  model_->OnFilter(filter);
-  Refresh(RefreshMode::kOnFilter);
+  // Filtering can take a while for big views, so the view is refreshed once the result of the last
+  // filter is available.
+  model_->GetDataView()
+      ->OnFilterAsync(filter.toStdString(), main_thread_executor_.get())
+      .Then(main_thread_executor_.get(), [this](bool is_filter_applied) {
+        if (is_filter_applied && model_ != nullptr) Refresh(RefreshMode::kOnFilter);
+      });
 }
 
 void OrbitTreeView::OnTimer() {
@@ -138,13 +143,11 @@ void OrbitTreeView::Refresh(RefreshMode refresh_mode) {
     return;
   }
 
-  if (model_->GetDataView()->ResetOnRefresh()) {
-    reset();
-  } else {
-    model_->layoutAboutToBeChanged();
-    model_->layoutChanged();
-    // Skip the following re-selection unless the refresh is caused by filtering or sorting.
-    if (refresh_mode == RefreshMode::kOther) return;
+  model_->UpdateRows();
+  // Skip the following re-selection unless the data view needs it on every refresh or the refresh
+  // is caused by filtering or sorting.
+  if (!model_->GetDataView()->RestoreSelectionOnRefresh() && refresh_mode == RefreshMode::kOther) {
+    return;
   }
 
   // Re-select previous selection
@@ -24,6 +24,8 @@
 #include <vector>
 
 #include "DataViews/DataView.h"
+#include "MainThreadExecutor.h"
+#include "QtUtils/MainThreadExecutorImpl.h"
 #include "orbitglwidget.h"
 #include "orbittablemodel.h"
 #include "types.h"
@@ -67,6 +69,10 @@ class OrbitTreeView : public QTreeView {
  private:
   std::unique_ptr<OrbitTableModel> model_;
   std::unique_ptr<QTimer> timer_;
+  // Runs the continuations of the filtering, which happens in the background. As these are dropped
+  // together with the executor, they can refer to the view.
+  std::shared_ptr<MainThreadExecutor> main_thread_executor_ =
+      orbit_qt_utils::MainThreadExecutorImpl::Create();
   std::vector<OrbitTreeView*> links_;
   bool auto_resize_;
   bool is_internal_refresh_ = false;
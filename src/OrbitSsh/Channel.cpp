@@ -70,6 +70,14 @@ outcome::result<std::string> Channel::ReadStdOut(int buffer_size) {
   return outcome::success(std::move(buffer));
 }
 
+outcome::result<int> Channel::ReadStdOut(char* buffer, int buffer_size) {
+  const int rc = libssh2_channel_read(raw_channel_ptr_.get(), buffer, buffer_size);
+
+  if (rc < 0) return static_cast<Error>(rc);
+
+  return outcome::success(rc);
+}
+
 outcome::result<std::string> Channel::ReadStdErr(int buffer_size) {
   std::string buffer(buffer_size, '\0');
   const int rc = libssh2_channel_read_stderr(raw_channel_ptr_.get(), buffer.data(), buffer.size());
@@ -133,6 +141,16 @@ outcome::result<void> Channel::WaitClosed() {
   return outcome::success();
 }
 
+outcome::result<void> Channel::IncreaseReceiveWindow(uint32_t window_size_increase) {
+  // force = 1 sends the adjustment right away instead of waiting for the window to run low.
+  const int rc = libssh2_channel_receive_window_adjust2(raw_channel_ptr_.get(),
+                                                        window_size_increase, 1, nullptr);
+
+  if (rc < 0) return static_cast<Error>(rc);
+
+  return outcome::success();
+}
+
 int Channel::GetExitStatus() { return libssh2_channel_get_exit_status(raw_channel_ptr_.get()); }
 
 bool Channel::GetRemoteEOF() { return libssh2_channel_eof(raw_channel_ptr_.get()) == 1; }
@@ -35,7 +35,13 @@ outcome::result<SftpFile> SftpFile::Open(Session* session, Sftp* sftp, std::stri
 
 outcome::result<std::string> SftpFile::Read(size_t max_length_in_bytes) {
   std::string buffer(max_length_in_bytes, '\0');
-  const auto result = libssh2_sftp_read(file_ptr_.get(), buffer.data(), buffer.size());
+  OUTCOME_TRY(bytes_read, Read(buffer.data(), buffer.size()));
+  buffer.resize(bytes_read);
+  return buffer;
+}
+
+outcome::result<size_t> SftpFile::Read(char* buffer, size_t buffer_size) {
+  const auto result = libssh2_sftp_read(file_ptr_.get(), buffer, buffer_size);
 
   if (result < 0) {
     if (result != LIBSSH2_ERROR_EAGAIN) {
@@ -45,8 +51,7 @@ outcome::result<std::string> SftpFile::Read(size_t max_length_in_bytes) {
     return static_cast<Error>(result);
   }
 
-  buffer.resize(result);
-  return buffer;
+  return outcome::success(static_cast<size_t>(result));
 }
 
 outcome::result<void> SftpFile::Close() {
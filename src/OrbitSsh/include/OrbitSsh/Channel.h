@@ -6,6 +6,7 @@
 #define ORBIT_SSH_CHANNEL_H_
 
 #include <libssh2.h>
+#include <stdint.h>
 
 #include <memory>
 #include <optional>
@@ -29,6 +30,9 @@ class Channel {
   static outcome::result<Channel> OpenChannel(Session* session_ptr);
 
   outcome::result<std::string> ReadStdOut(int buffer_size = 0x400);
+  // Reads at most buffer_size bytes into buffer and returns the number of bytes read. Unlike the
+  // overload above, this doesn't allocate, so a caller reading in a loop can reuse its buffer.
+  outcome::result<int> ReadStdOut(char* buffer, int buffer_size);
   outcome::result<std::string> ReadStdErr(int buffer_size = 0x400);
   outcome::result<void> WriteBlocking(std::string_view text);
   outcome::result<int> Write(std::string_view text);
@@ -37,6 +41,9 @@ class Channel {
   outcome::result<void> WaitRemoteEOF();
   outcome::result<void> Close();
   outcome::result<void> WaitClosed();
+  // Lets the remote side send window_size_increase more bytes before it has to wait for us to
+  // read them, on top of the window that libssh2 grants when opening the channel.
+  outcome::result<void> IncreaseReceiveWindow(uint32_t window_size_increase);
 
   int GetExitStatus();
   bool GetRemoteEOF();
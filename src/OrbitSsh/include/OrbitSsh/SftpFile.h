@@ -41,6 +41,9 @@ class SftpFile {
                                         FxfFlags flags, int64_t mode);
 
   outcome::result<std::string> Read(size_t max_length_in_bytes);
+  // Reads into a caller-provided buffer, which can be reused across calls, and returns the number
+  // of bytes read. 0 means end of file.
+  outcome::result<size_t> Read(char* buffer, size_t buffer_size);
   outcome::result<void> Close();
   outcome::result<size_t> Write(std::string_view data);
 
@@ -268,6 +268,10 @@ TEST(OrbitSshQtTests, CopyToLocalTest) {
                      channel.Stop();
                    });
 
+  uint64_t last_progress_bytes_copied = 0;
+  QObject::connect(&sftp_copy_to_local, &orbit_ssh_qt::SftpCopyToLocalOperation::progressed, &loop,
+                   [&](uint64_t bytes_copied) { last_progress_bytes_copied = bytes_copied; });
+
   QTimer::singleShot(std::chrono::seconds{5}, &loop, [&]() {
     loop.quit();
     FAIL() << "Timeout occurred. The whole integration test should be done in 5 "
@@ -276,6 +280,10 @@ TEST(OrbitSshQtTests, CopyToLocalTest) {
   });
 
   loop.exec();
+
+  EXPECT_GT(sftp_copy_to_local.GetBytesCopied(), 0u);
+  EXPECT_EQ(last_progress_bytes_copied, sftp_copy_to_local.GetBytesCopied());
+  EXPECT_EQ(std::filesystem::file_size(file_name), sftp_copy_to_local.GetBytesCopied());
 }
 
 int main(int argc, char* argv[]) {
@@ -39,6 +39,14 @@ static void deleteByEventLoop(P* parent, std::optional<T>* opt) {
 }
 
 namespace orbit_ssh_qt {
+namespace {
+constexpr size_t kReadChunkSize = 1024 * 1024;
+// The receive window that libssh2 grants by default (LIBSSH2_CHANNEL_WINDOW_DEFAULT) limits the
+// throughput of the tunnel to the window size per round trip, far below the bandwidth of the link
+// for remote instances. Capture data mostly flows from the remote side to us.
+constexpr uint32_t kReceiveWindowIncrease = 14 * 1024 * 1024;
+}  // namespace
+
 Tunnel::Tunnel(Session* session, std::string remote_host, uint16_t remote_port, QObject* parent)
     : StateMachineHelper(parent),
       session_(session),
@@ -88,6 +96,11 @@ outcome::result<void> Tunnel::startup() {
       ABSL_FALLTHROUGH_INTENDED;
     }
     case State::kChannelInitialized: {
+      OUTCOME_TRY(channel_->IncreaseReceiveWindow(kReceiveWindowIncrease));
+      SetState(State::kReceiveWindowIncreased);
+      ABSL_FALLTHROUGH_INTENDED;
+    }
+    case State::kReceiveWindowIncreased: {
       local_server_.emplace(this);
       const auto result = local_server_->listen(QHostAddress{QHostAddress::LocalHost});
 
@@ -128,6 +141,7 @@ outcome::result<void> Tunnel::shutdown() {
     case State::kInitial:
     case State::kNoChannel:
     case State::kChannelInitialized:
+    case State::kReceiveWindowIncreased:
     case State::kStarted:
     case State::kServerListening:
       UNREACHABLE();
@@ -169,9 +183,10 @@ outcome::result<void> Tunnel::shutdown() {
 
 outcome::result<void> Tunnel::readFromChannel() {
   ORBIT_SCOPE_FUNCTION;
+  read_chunk_.resize(kReadChunkSize);
   while (true) {
-    const size_t kChunkSize = 1024 * 1024;
-    const auto result = channel_->ReadStdOut(kChunkSize);
+    const auto result =
+        channel_->ReadStdOut(read_chunk_.data(), static_cast<int>(read_chunk_.size()));
 
     if (!result && !orbit_ssh::ShouldITryAgain(result)) {
       return outcome::failure(result.error());
@@ -179,12 +194,12 @@ outcome::result<void> Tunnel::readFromChannel() {
       // That's the EAGAIN case
       HandleEagain();
       break;
-    } else if (result && result.value().empty()) {
+    } else if (result && result.value() == 0) {
       // Empty result means remote socket was closed.
       return Error::kRemoteSocketClosed;
     } else if (result) {
-      ORBIT_UINT64("readFromChannel bytes read", result.value().size());
-      read_buffer_.append(result.value());
+      ORBIT_UINT64("readFromChannel bytes read", result.value());
+      read_buffer_.append(read_chunk_.data(), result.value());
     }
   }
 
@@ -204,13 +219,23 @@ outcome::result<void> Tunnel::readFromChannel() {
 
 outcome::result<void> Tunnel::writeToChannel() {
   ORBIT_SCOPE_FUNCTION;
-  if (!write_buffer_.empty()) {
-    const std::string_view buffer_view{write_buffer_.data(), write_buffer_.size()};
-    OUTCOME_TRY(bytes_written, channel_->Write(buffer_view));
-    CHECK(static_cast<size_t>(bytes_written) <= write_buffer_.size());
-    write_buffer_.erase(write_buffer_.begin(), write_buffer_.begin() + bytes_written);
-    ORBIT_UINT64("writeToChannel bytes written", bytes_written);
+  // libssh2 writes at most one SSH packet per call, so keep writing until the buffer is empty or
+  // the channel can't take more for now, in which case the caller retries on the next data event.
+  size_t total_bytes_written = 0;
+  while (total_bytes_written < write_buffer_.size()) {
+    const std::string_view buffer_view{write_buffer_.data() + total_bytes_written,
+                                       write_buffer_.size() - total_bytes_written};
+    const auto result = channel_->Write(buffer_view);
+    if (!result || result.value() == 0) {
+      write_buffer_.erase(0, total_bytes_written);
+      if (!result) return result.error();
+      return outcome::success();
+    }
+    CHECK(static_cast<size_t>(result.value()) <= buffer_view.size());
+    total_bytes_written += result.value();
+    ORBIT_UINT64("writeToChannel bytes written", result.value());
   }
+  write_buffer_.clear();
   return outcome::success();
 }
 
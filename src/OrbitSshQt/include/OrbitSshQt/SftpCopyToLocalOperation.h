@@ -9,10 +9,12 @@
 #include <QObject>
 #include <QPointer>
 #include <QString>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <outcome.hpp>
 #include <system_error>
+#include <vector>
 
 #include "OrbitSsh/SftpFile.h"
 #include "OrbitSshQt/ScopedConnection.h"
@@ -52,8 +54,13 @@ class SftpCopyToLocalOperation
 
   void CopyFileToLocal(std::filesystem::path source, std::filesystem::path destination);
 
+  [[nodiscard]] uint64_t GetBytesCopied() const { return bytes_copied_; }
+
  signals:
   void started();
+  // Emitted whenever data was written to the local file, with the total number of bytes copied so
+  // far.
+  void progressed(uint64_t bytes_copied);
   void stopped();
   void aboutToShutdown();
   void errorOccurred(std::error_code);
@@ -67,6 +74,8 @@ class SftpCopyToLocalOperation
   QPointer<SftpChannel> channel_;
   std::optional<orbit_ssh::SftpFile> sftp_file_;
   QFile local_file_;
+  std::vector<char> read_buffer_;
+  uint64_t bytes_copied_ = 0;
 
   std::filesystem::path source_;
   std::filesystem::path destination_;
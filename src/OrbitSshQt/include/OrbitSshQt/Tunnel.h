@@ -17,6 +17,7 @@
 #include <outcome.hpp>
 #include <string>
 #include <system_error>
+#include <vector>
 
 #include "OrbitSsh/Channel.h"
 #include "OrbitSshQt/Error.h"
@@ -30,6 +31,7 @@ enum class TunnelState {
   kInitial,
   kNoChannel,
   kChannelInitialized,
+  kReceiveWindowIncreased,
   kStarted,
   kServerListening,
   kShutdown,
@@ -95,6 +97,9 @@ class Tunnel : public StateMachineHelper<Tunnel, details::TunnelState> {
   QPointer<QTcpSocket> local_socket_;
   std::string write_buffer_;
   std::string read_buffer_;
+  // Reused by every read from the channel, which only append the bytes actually read to
+  // read_buffer_.
+  std::vector<char> read_chunk_;
 
   std::optional<ScopedConnection> data_event_connection_;
   std::optional<ScopedConnection> about_to_shutdown_connection_;
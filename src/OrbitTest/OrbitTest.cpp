@@ -131,7 +131,7 @@ static void ExecuteTask(uint32_t id) {
 void OrbitTest::OutputOrbitApiState() {
   while (!m_ExitRequested) {
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-    LOG("g_orbit_api_v0.enabled = %u", g_orbit_api_v0.enabled);
+    LOG("g_orbit_api_v1.enabled = %u", g_orbit_api_v1.enabled);
   }
 }
 
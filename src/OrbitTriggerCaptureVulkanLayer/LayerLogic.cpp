@@ -21,6 +21,8 @@
 namespace {
 constexpr const int kCaptureClientResultSuccess = 1;
 constexpr uint16_t kGrpcPort = 44767;
+// The capture service might not accept calls yet on the first frames.
+constexpr std::chrono::seconds kFlightRecorderCaptureStartRetryInterval{1};
 }  // namespace
 
 void LayerLogic::StartOrbitCaptureService() {
@@ -78,6 +80,9 @@ void LayerLogic::Destroy() {
     data_initialized_ = false;
     orbit_capture_running_ = false;
     skip_logic_call_ = true;
+    last_capture_start_attempt_time_.reset();
+    snapshot_count_ = 0;
+    last_snapshot_time_.reset();
   }
 }
 
@@ -94,9 +99,11 @@ void LayerLogic::ProcessQueuePresentKHR() {
     return;
   }
 
-  if (!orbit_capture_running_) {
-    auto frame_time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
-        current_time - last_frame_time_);
+  auto frame_time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+      current_time - last_frame_time_);
+  if (layer_options_.GetFlightRecorderWindowSeconds() > 0) {
+    ProcessFrameTimeInFlightRecorderMode(current_time, frame_time.count());
+  } else if (!orbit_capture_running_) {
     if (std::isgreater(frame_time.count(), layer_options_.GetFrameTimeThresholdMilliseconds())) {
       LOG("Time frame is %fms and exceeds the %fms threshold; starting capture", frame_time.count(),
           layer_options_.GetFrameTimeThresholdMilliseconds());
@@ -116,6 +123,44 @@ void LayerLogic::ProcessQueuePresentKHR() {
   last_frame_time_ = current_time;
 }
 
+void LayerLogic::ProcessFrameTimeInFlightRecorderMode(
+    std::chrono::steady_clock::time_point current_time, double frame_time_ms) {
+  // The capture runs from the first frame to the end of the session; it is stopped, and its last
+  // window saved, when the service shuts down.
+  if (!orbit_capture_running_) {
+    if (last_capture_start_attempt_time_.has_value() &&
+        current_time - last_capture_start_attempt_time_.value() <
+            kFlightRecorderCaptureStartRetryInterval) {
+      return;
+    }
+    LOG("Starting capture in flight recorder mode with a window of %ds",
+        layer_options_.GetFlightRecorderWindowSeconds());
+    last_capture_start_attempt_time_ = current_time;
+    RunCapture();
+    // Starting the capture makes this frame longer, so we skip the check on the next call
+    skip_logic_call_ = true;
+    return;
+  }
+
+  if (!std::isgreater(frame_time_ms, layer_options_.GetFrameTimeThresholdMilliseconds())) return;
+  if (snapshot_count_ >= layer_options_.GetMaxSnapshotCount()) return;
+  if (last_snapshot_time_.has_value() &&
+      current_time - last_snapshot_time_.value() <
+          std::chrono::seconds(layer_options_.GetSnapshotCooldownSeconds())) {
+    return;
+  }
+
+  LOG("Time frame is %fms and exceeds the %fms threshold; saving flight recorder snapshot %d of "
+      "at most %d",
+      frame_time_ms, layer_options_.GetFrameTimeThresholdMilliseconds(), snapshot_count_ + 1,
+      layer_options_.GetMaxSnapshotCount());
+  // The cooldown also applies to failed requests, so that the service is not asked every frame.
+  last_snapshot_time_ = current_time;
+  if (ggp_capture_client_->SaveFlightRecorderSnapshot() == kCaptureClientResultSuccess) {
+    ++snapshot_count_;
+  }
+}
+
 void LayerLogic::RunCapture() {
   int capture_started = ggp_capture_client_->StartCapture();
   if (capture_started == kCaptureClientResultSuccess) {
@@ -6,7 +6,9 @@
 #define ORBIT_TRIGGER_CAPTURE_VULKAN_LAYER_LAYER_LOGIC_H_
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "LayerOptions.h"
@@ -16,6 +18,9 @@
 // Contains the logic of the OrbitTriggerCaptureVulkanLayer to run Orbit captures automatically when
 // the time per frame is higher than a certain threshold. It also instantiates the classes and
 // variables needed for this so the layer itself is transparent to it.
+// In flight recorder mode, a single capture runs for the whole session and a long frame saves a
+// snapshot of the last seconds instead, at most every snapshot cooldown and up to a maximum number
+// of snapshots, so that rare hitches are caught without recording everything.
 class LayerLogic {
  public:
   LayerLogic() : data_initialized_{false}, orbit_capture_running_{false}, skip_logic_call_{true} {}
@@ -32,8 +37,13 @@ class LayerLogic {
   std::chrono::steady_clock::time_point last_frame_time_;
   std::chrono::steady_clock::time_point capture_started_time_;
   LayerOptions layer_options_;
+  std::optional<std::chrono::steady_clock::time_point> last_capture_start_attempt_time_;
+  uint32_t snapshot_count_ = 0;
+  std::optional<std::chrono::steady_clock::time_point> last_snapshot_time_;
 
   void StartOrbitCaptureService();
+  void ProcessFrameTimeInFlightRecorderMode(std::chrono::steady_clock::time_point current_time,
+                                            double frame_time_ms);
   void RunCapture();
   void StopCapture();
 };
@@ -28,6 +28,8 @@ constexpr char const* kOrbitCaptureService = "/mnt/developer/OrbitCaptureGgpServ
 constexpr char const* kLogDirectory = "/var/game/";
 constexpr double kFrameTimeThresholdMillisecondsDefault = 1000.0 / 60.0;
 constexpr uint32_t kCaptureLengthSecondsDefault = 10;
+constexpr uint32_t kSnapshotCooldownSecondsDefault = 30;
+constexpr uint32_t kMaxSnapshotCountDefault = 10;
 }  // namespace
 
 void LayerOptions::Init() {
@@ -69,6 +71,25 @@ uint32_t LayerOptions::GetCaptureLengthSeconds() {
   return kCaptureLengthSecondsDefault;
 }
 
+uint32_t LayerOptions::GetFlightRecorderWindowSeconds() {
+  return layer_config_.layer_options().flight_recorder_window_s();
+}
+
+uint32_t LayerOptions::GetSnapshotCooldownSeconds() {
+  if (layer_config_.has_layer_options() &&
+      layer_config_.layer_options().snapshot_cooldown_s() > 0) {
+    return layer_config_.layer_options().snapshot_cooldown_s();
+  }
+  return kSnapshotCooldownSecondsDefault;
+}
+
+uint32_t LayerOptions::GetMaxSnapshotCount() {
+  if (layer_config_.has_layer_options() && layer_config_.layer_options().max_snapshot_count() > 0) {
+    return layer_config_.layer_options().max_snapshot_count();
+  }
+  return kMaxSnapshotCountDefault;
+}
+
 std::vector<std::string> LayerOptions::BuildOrbitCaptureServiceArgv(const std::string& game_pid) {
   std::vector<std::string> argv;
 
@@ -118,5 +139,10 @@ std::vector<std::string> LayerOptions::BuildOrbitCaptureServiceArgv(const std::s
     argv.push_back(sampling_rate_str);
   }
 
+  if (GetFlightRecorderWindowSeconds() > 0) {
+    argv.push_back("-flight_recorder_window_s");
+    argv.push_back(absl::StrFormat("%u", GetFlightRecorderWindowSeconds()));
+  }
+
   return argv;
 }
@@ -18,6 +18,10 @@ class LayerOptions {
   void Init();
   double GetFrameTimeThresholdMilliseconds();
   uint32_t GetCaptureLengthSeconds();
+  // 0 when the captures don't run in flight recorder mode.
+  uint32_t GetFlightRecorderWindowSeconds();
+  uint32_t GetSnapshotCooldownSeconds();
+  uint32_t GetMaxSnapshotCount();
   std::vector<std::string> BuildOrbitCaptureServiceArgv(const std::string&);
 
  private:
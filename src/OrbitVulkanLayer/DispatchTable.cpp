@@ -4,8 +4,17 @@
 
 #include "DispatchTable.h"
 
+#include <utility>
+
 namespace orbit_vulkan_layer {
 
+DispatchTable::DispatchTable() {
+  auto empty_entries = std::make_unique<Entries>();
+  published_entries_.store(empty_entries.get(), std::memory_order_release);
+  absl::MutexLock lock(&mutex_);
+  all_entries_.push_back(std::move(empty_entries));
+}
+
 void DispatchTable::CreateInstanceDispatchTable(
     VkInstance instance, PFN_vkGetInstanceProcAddr next_get_instance_proc_addr_function) {
   VkLayerInstanceDispatchTable dispatch_table;
@@ -35,45 +44,29 @@ void DispatchTable::CreateInstanceDispatchTable(
   dispatch_table.DebugReportMessageEXT = absl::bit_cast<PFN_vkDebugReportMessageEXT>(
       next_get_instance_proc_addr_function(instance, "vkDebugReportMessageEXT"));
 
+  InstanceEntry entry;
+  entry.dispatch_table = dispatch_table;
+  entry.supports_debug_utils_extension = dispatch_table.CreateDebugUtilsMessengerEXT != nullptr &&
+                                         dispatch_table.DestroyDebugUtilsMessengerEXT != nullptr &&
+                                         dispatch_table.SubmitDebugUtilsMessageEXT != nullptr;
+  entry.supports_debug_report_extension = dispatch_table.CreateDebugReportCallbackEXT != nullptr &&
+                                          dispatch_table.DestroyDebugReportCallbackEXT != nullptr &&
+                                          dispatch_table.DebugReportMessageEXT != nullptr;
+  entry.instance = instance;
+
   void* key = GetDispatchTableKey(instance);
-  {
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(!instance_dispatch_table_.contains(key));
-    instance_dispatch_table_[key] = dispatch_table;
-
-    CHECK(!instance_supports_debug_utils_extension_.contains(key));
-    instance_supports_debug_utils_extension_[key] =
-        dispatch_table.CreateDebugUtilsMessengerEXT != nullptr &&
-        dispatch_table.DestroyDebugUtilsMessengerEXT != nullptr &&
-        dispatch_table.SubmitDebugUtilsMessageEXT != nullptr;
-
-    CHECK(!instance_supports_debug_report_extension_.contains(key));
-    instance_supports_debug_report_extension_[key] =
-        dispatch_table.CreateDebugReportCallbackEXT != nullptr &&
-        dispatch_table.DestroyDebugReportCallbackEXT != nullptr &&
-        dispatch_table.DebugReportMessageEXT != nullptr;
-
-    CHECK(!instance_dispatchable_object_to_instance_.contains(key));
-    instance_dispatchable_object_to_instance_[key] = instance;
-  }
+  PublishModifiedEntries([key, &entry](Entries* entries) {
+    CHECK(!entries->instance_entries.contains(key));
+    entries->instance_entries.emplace(key, entry);
+  });
 }
 
 void DispatchTable::RemoveInstanceDispatchTable(VkInstance instance) {
   void* key = GetDispatchTableKey(instance);
-  {
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(instance_dispatch_table_.contains(key));
-    instance_dispatch_table_.erase(key);
-
-    CHECK(instance_supports_debug_utils_extension_.contains(key));
-    instance_supports_debug_utils_extension_.erase(key);
-
-    CHECK(instance_supports_debug_report_extension_.contains(key));
-    instance_supports_debug_report_extension_.erase(key);
-
-    CHECK(instance_dispatchable_object_to_instance_.contains(key));
-    instance_dispatchable_object_to_instance_.erase(key);
-  }
+  PublishModifiedEntries([key](Entries* entries) {
+    CHECK(entries->instance_entries.contains(key));
+    entries->instance_entries.erase(key);
+  });
 }
 
 void DispatchTable::CreateDeviceDispatchTable(
@@ -118,10 +111,19 @@ void DispatchTable::CreateDeviceDispatchTable(
 
   dispatch_table.CmdWriteTimestamp = absl::bit_cast<PFN_vkCmdWriteTimestamp>(
       next_get_device_proc_addr_function(device, "vkCmdWriteTimestamp"));
+  dispatch_table.CmdExecuteCommands = absl::bit_cast<PFN_vkCmdExecuteCommands>(
+      next_get_device_proc_addr_function(device, "vkCmdExecuteCommands"));
+  dispatch_table.CmdBeginQuery = absl::bit_cast<PFN_vkCmdBeginQuery>(
+      next_get_device_proc_addr_function(device, "vkCmdBeginQuery"));
+  dispatch_table.CmdEndQuery = absl::bit_cast<PFN_vkCmdEndQuery>(
+      next_get_device_proc_addr_function(device, "vkCmdEndQuery"));
 
   dispatch_table.GetQueryPoolResults = absl::bit_cast<PFN_vkGetQueryPoolResults>(
       next_get_device_proc_addr_function(device, "vkGetQueryPoolResults"));
 
+  dispatch_table.GetCalibratedTimestampsEXT = absl::bit_cast<PFN_vkGetCalibratedTimestampsEXT>(
+      next_get_device_proc_addr_function(device, "vkGetCalibratedTimestampsEXT"));
+
   dispatch_table.CmdBeginDebugUtilsLabelEXT = absl::bit_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(
       next_get_device_proc_addr_function(device, "vkCmdBeginDebugUtilsLabelEXT"));
   dispatch_table.CmdEndDebugUtilsLabelEXT = absl::bit_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(
@@ -152,47 +154,46 @@ void DispatchTable::CreateDeviceDispatchTable(
   dispatch_table.CmdDebugMarkerInsertEXT = absl::bit_cast<PFN_vkCmdDebugMarkerInsertEXT>(
       next_get_device_proc_addr_function(device, "vkCmdDebugMarkerInsertEXT"));
 
+  DeviceEntry entry;
+  entry.dispatch_table = dispatch_table;
+  entry.supports_debug_utils_extension = dispatch_table.CmdBeginDebugUtilsLabelEXT != nullptr &&
+                                         dispatch_table.CmdEndDebugUtilsLabelEXT != nullptr &&
+                                         dispatch_table.SetDebugUtilsObjectNameEXT != nullptr &&
+                                         dispatch_table.SetDebugUtilsObjectTagEXT != nullptr &&
+                                         dispatch_table.QueueBeginDebugUtilsLabelEXT != nullptr &&
+                                         dispatch_table.QueueEndDebugUtilsLabelEXT != nullptr &&
+                                         dispatch_table.QueueInsertDebugUtilsLabelEXT != nullptr &&
+                                         dispatch_table.CmdInsertDebugUtilsLabelEXT != nullptr;
+  entry.supports_debug_marker_extension = dispatch_table.CmdDebugMarkerBeginEXT != nullptr &&
+                                          dispatch_table.CmdDebugMarkerEndEXT != nullptr &&
+                                          dispatch_table.DebugMarkerSetObjectTagEXT != nullptr &&
+                                          dispatch_table.DebugMarkerSetObjectNameEXT != nullptr &&
+                                          dispatch_table.CmdDebugMarkerInsertEXT != nullptr;
+  entry.supports_calibrated_timestamps_extension =
+      dispatch_table.GetCalibratedTimestampsEXT != nullptr;
+
   void* key = GetDispatchTableKey(device);
-  {
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(!device_dispatch_table_.contains(key));
-    device_dispatch_table_[key] = dispatch_table;
-
-    CHECK(!device_supports_debug_utils_extension_.contains(key));
-    device_supports_debug_utils_extension_[key] =
-        dispatch_table.CmdBeginDebugUtilsLabelEXT != nullptr &&
-        dispatch_table.CmdEndDebugUtilsLabelEXT != nullptr &&
-        dispatch_table.SetDebugUtilsObjectNameEXT != nullptr &&
-        dispatch_table.SetDebugUtilsObjectTagEXT != nullptr &&
-        dispatch_table.QueueBeginDebugUtilsLabelEXT != nullptr &&
-        dispatch_table.QueueEndDebugUtilsLabelEXT != nullptr &&
-        dispatch_table.QueueInsertDebugUtilsLabelEXT != nullptr &&
-        dispatch_table.CmdInsertDebugUtilsLabelEXT != nullptr;
-
-    CHECK(!device_supports_debug_marker_extension_.contains(key));
-    device_supports_debug_marker_extension_[key] =
-        dispatch_table.CmdDebugMarkerBeginEXT != nullptr &&
-        dispatch_table.CmdDebugMarkerEndEXT != nullptr &&
-        dispatch_table.DebugMarkerSetObjectTagEXT != nullptr &&
-        dispatch_table.DebugMarkerSetObjectNameEXT != nullptr &&
-        dispatch_table.CmdDebugMarkerInsertEXT != nullptr;
-  }
+  PublishModifiedEntries([key, &entry](Entries* entries) {
+    CHECK(!entries->device_entries.contains(key));
+    entries->device_entries.emplace(key, entry);
+  });
 }
 
 void DispatchTable::RemoveDeviceDispatchTable(VkDevice device) {
   void* key = GetDispatchTableKey(device);
-  {
-    absl::WriterMutexLock lock(&mutex_);
-
-    CHECK(device_dispatch_table_.contains(key));
-    device_dispatch_table_.erase(key);
-
-    CHECK(device_supports_debug_utils_extension_.contains(key));
-    device_supports_debug_utils_extension_.erase(key);
+  PublishModifiedEntries([key](Entries* entries) {
+    CHECK(entries->device_entries.contains(key));
+    entries->device_entries.erase(key);
+  });
+}
 
-    CHECK(device_supports_debug_marker_extension_.contains(key));
-    device_supports_debug_marker_extension_.erase(key);
-  }
+void DispatchTable::PublishModifiedEntries(const std::function<void(Entries*)>& modify) {
+  absl::MutexLock lock(&mutex_);
+  auto modified_entries =
+      std::make_unique<Entries>(*published_entries_.load(std::memory_order_relaxed));
+  modify(modified_entries.get());
+  published_entries_.store(modified_entries.get(), std::memory_order_release);
+  all_entries_.push_back(std::move(modified_entries));
 }
 
 }  // namespace orbit_vulkan_layer
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include "DispatchTable.h"
 
 namespace orbit_vulkan_layer {
@@ -109,6 +111,48 @@ TEST(DispatchTable, CanReinitializeDeviceAfterRemove) {
   dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
 }
 
+TEST(DispatchTable, LookupsAreNotAffectedByCreatingAndRemovingOtherDevices) {
+  // The key of a device is the first pointer in it, so the two devices need different ones.
+  int some_dispatch_table = 0;
+  int other_dispatch_table = 0;
+  void* some_device_memory = &some_dispatch_table;
+  void* other_device_memory = &other_dispatch_table;
+  auto device = absl::bit_cast<VkDevice>(&some_device_memory);
+  auto other_device = absl::bit_cast<VkDevice>(&other_device_memory);
+
+  PFN_vkGetDeviceProcAddr next_get_device_proc_addr_function =
+      +[](VkDevice /*device*/, const char* name) -> PFN_vkVoidFunction {
+    if (strcmp(name, "vkResetCommandPool") == 0) {
+      PFN_vkResetCommandPool function =
+          +[](VkDevice /*device*/, VkCommandPool /*command_pool*/,
+              VkCommandPoolResetFlags /*flags*/) -> VkResult { return VK_SUCCESS; };
+      return absl::bit_cast<PFN_vkVoidFunction>(function);
+    }
+    return nullptr;
+  };
+
+  DispatchTable dispatch_table = {};
+  dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
+
+  constexpr int kIterations = 1000;
+  std::thread other_device_thread([&] {
+    for (int i = 0; i < kIterations; ++i) {
+      dispatch_table.CreateDeviceDispatchTable(other_device, next_get_device_proc_addr_function);
+      dispatch_table.RemoveDeviceDispatchTable(other_device);
+    }
+  });
+
+  VkCommandPool command_pool = {};
+  int successful_call_count = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    if (dispatch_table.ResetCommandPool(device)(device, command_pool, 0) == VK_SUCCESS) {
+      ++successful_call_count;
+    }
+  }
+  other_device_thread.join();
+  EXPECT_EQ(successful_call_count, kIterations);
+}
+
 TEST(DispatchTable, NoDeviceExtensionAvailable) {
   VkLayerDispatchTable some_dispatch_table = {};
   auto device = absl::bit_cast<VkDevice>(&some_dispatch_table);
@@ -119,6 +163,7 @@ TEST(DispatchTable, NoDeviceExtensionAvailable) {
   dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
   EXPECT_FALSE(dispatch_table.IsDebugUtilsExtensionSupported(device));
   EXPECT_FALSE(dispatch_table.IsDebugMarkerExtensionSupported(device));
+  EXPECT_FALSE(dispatch_table.IsCalibratedTimestampsExtensionSupported(device));
 }
 
 TEST(DispatchTable, NoInstanceExtensionAvailable) {
@@ -296,6 +341,26 @@ TEST(DispatchTable, CanSupportDebugMarkerExtension) {
   EXPECT_TRUE(dispatch_table.IsDebugMarkerExtensionSupported(device));
 }
 
+TEST(DispatchTable, CanSupportCalibratedTimestampsExtension) {
+  VkLayerDispatchTable some_dispatch_table = {};
+  auto device = absl::bit_cast<VkDevice>(&some_dispatch_table);
+  PFN_vkGetDeviceProcAddr next_get_device_proc_addr_function =
+      +[](VkDevice /*instance*/, const char* name) -> PFN_vkVoidFunction {
+    if (strcmp(name, "vkGetCalibratedTimestampsEXT") == 0) {
+      PFN_vkGetCalibratedTimestampsEXT function =
+          +[](VkDevice /*device*/, uint32_t /*timestamp_count*/,
+              const VkCalibratedTimestampInfoEXT* /*timestamp_infos*/, uint64_t* /*timestamps*/,
+              uint64_t* /*max_deviation*/) -> VkResult { return VK_SUCCESS; };
+      return absl::bit_cast<PFN_vkVoidFunction>(function);
+    }
+    return nullptr;
+  };
+
+  DispatchTable dispatch_table = {};
+  dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
+  EXPECT_TRUE(dispatch_table.IsCalibratedTimestampsExtensionSupported(device));
+}
+
 TEST(DispatchTable, CanCallEnumerateDeviceExtensionProperties) {
   VkLayerInstanceDispatchTable some_dispatch_table = {};
   auto instance = absl::bit_cast<VkInstance>(&some_dispatch_table);
@@ -750,6 +815,88 @@ TEST(DispatchTable, CanCallCmdWriteTimestamp) {
   was_called = false;
 }
 
+TEST(DispatchTable, CanCallCmdExecuteCommands) {
+  VkLayerDispatchTable some_dispatch_table = {};
+  auto device = absl::bit_cast<VkDevice>(&some_dispatch_table);
+
+  static bool was_called = false;
+
+  PFN_vkGetDeviceProcAddr next_get_device_proc_addr_function =
+      +[](VkDevice /*device*/, const char* name) -> PFN_vkVoidFunction {
+    if (strcmp(name, "vkCmdExecuteCommands") == 0) {
+      PFN_vkCmdExecuteCommands function =
+          +[](VkCommandBuffer /*command_buffer*/, uint32_t /*command_buffer_count*/,
+              const VkCommandBuffer* /*command_buffers*/) { was_called = true; };
+      return absl::bit_cast<PFN_vkVoidFunction>(function);
+    }
+    return nullptr;
+  };
+
+  DispatchTable dispatch_table = {};
+  dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
+
+  VkCommandBuffer command_buffer = {};
+  VkCommandBuffer secondary_command_buffer = {};
+  dispatch_table.CmdExecuteCommands(device)(command_buffer, 1, &secondary_command_buffer);
+  EXPECT_TRUE(was_called);
+  was_called = false;
+}
+
+TEST(DispatchTable, CanCallCmdBeginQuery) {
+  VkLayerDispatchTable some_dispatch_table = {};
+  auto device = absl::bit_cast<VkDevice>(&some_dispatch_table);
+
+  static bool was_called = false;
+
+  PFN_vkGetDeviceProcAddr next_get_device_proc_addr_function =
+      +[](VkDevice /*device*/, const char* name) -> PFN_vkVoidFunction {
+    if (strcmp(name, "vkCmdBeginQuery") == 0) {
+      PFN_vkCmdBeginQuery function =
+          +[](VkCommandBuffer /*command_buffer*/, VkQueryPool /*query_pool*/, uint32_t /*query*/,
+              VkQueryControlFlags /*flags*/) { was_called = true; };
+      return absl::bit_cast<PFN_vkVoidFunction>(function);
+    }
+    return nullptr;
+  };
+
+  DispatchTable dispatch_table = {};
+  dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
+
+  VkCommandBuffer command_buffer = {};
+  VkQueryPool query_pool = {};
+  dispatch_table.CmdBeginQuery(device)(command_buffer, query_pool, 0, 0);
+  EXPECT_TRUE(was_called);
+  was_called = false;
+}
+
+TEST(DispatchTable, CanCallCmdEndQuery) {
+  VkLayerDispatchTable some_dispatch_table = {};
+  auto device = absl::bit_cast<VkDevice>(&some_dispatch_table);
+
+  static bool was_called = false;
+
+  PFN_vkGetDeviceProcAddr next_get_device_proc_addr_function =
+      +[](VkDevice /*device*/, const char* name) -> PFN_vkVoidFunction {
+    if (strcmp(name, "vkCmdEndQuery") == 0) {
+      PFN_vkCmdEndQuery function =
+          +[](VkCommandBuffer /*command_buffer*/, VkQueryPool /*query_pool*/, uint32_t /*query*/) {
+            was_called = true;
+          };
+      return absl::bit_cast<PFN_vkVoidFunction>(function);
+    }
+    return nullptr;
+  };
+
+  DispatchTable dispatch_table = {};
+  dispatch_table.CreateDeviceDispatchTable(device, next_get_device_proc_addr_function);
+
+  VkCommandBuffer command_buffer = {};
+  VkQueryPool query_pool = {};
+  dispatch_table.CmdEndQuery(device)(command_buffer, query_pool, 0);
+  EXPECT_TRUE(was_called);
+  was_called = false;
+}
+
 TEST(DispatchTable, CanCallCmdBeginDebugUtilsLabelEXT) {
   VkLayerDispatchTable some_dispatch_table = {};
   auto device = absl::bit_cast<VkDevice>(&some_dispatch_table);
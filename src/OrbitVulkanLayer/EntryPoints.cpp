@@ -109,6 +109,12 @@ VKAPI_ATTR VkResult VKAPI_CALL OrbitResetCommandBuffer(VkCommandBuffer command_b
   return controller.OnResetCommandBuffer(command_buffer, flags);
 }
 
+VKAPI_ATTR void VKAPI_CALL OrbitCmdExecuteCommands(VkCommandBuffer command_buffer,
+                                                   uint32_t command_buffer_count,
+                                                   const VkCommandBuffer* command_buffers) {
+  controller.OnCmdExecuteCommands(command_buffer, command_buffer_count, command_buffers);
+}
+
 VKAPI_ATTR void VKAPI_CALL OrbitGetDeviceQueue(VkDevice device, uint32_t queue_family_index,
                                                uint32_t queue_index, VkQueue* pQueue) {
   controller.OnGetDeviceQueue(device, queue_family_index, queue_index, pQueue);
@@ -295,6 +301,7 @@ OrbitGetDeviceProcAddr(VkDevice device, const char* name) {
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(BeginCommandBuffer);
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(EndCommandBuffer);
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(ResetCommandBuffer);
+  RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(CmdExecuteCommands);
 
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(QueueSubmit);
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(QueuePresentKHR);
@@ -352,6 +359,7 @@ OrbitGetInstanceProcAddr(VkInstance instance, const char* name) {
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(BeginCommandBuffer);
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(EndCommandBuffer);
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(ResetCommandBuffer);
+  RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(CmdExecuteCommands);
 
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(QueueSubmit);
   RETURN_ORBIT_FUNCTION_IF_MATCHES_VK_FUNCTION(QueuePresentKHR);
@@ -10,7 +10,12 @@
 #include <absl/synchronization/mutex.h>
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <queue>
 #include <stack>
 
@@ -29,20 +34,55 @@ namespace orbit_vulkan_layer {
  * timestamp commands (`VkCmdWriteTimestamp`). The same is done for debug marker begins and ends.
  * All that data will be gathered together at a queue submission (`VkQueueSubmit`).
  *
- * Upon every `VkQueuePresentKHR` it will check if the last timestamp of a certain submission is
- * already available, and if so, it will assume that all timestamps are available and it will send
- * the results over to the `VulkanLayerProducer`.
+ * Upon every `VkQueuePresentKHR` it reads back the timestamps of all pending submissions at once,
+ * and sends the submissions whose timestamps are all available over to the `VulkanLayerProducer`.
+ * If the device supports `VK_EXT_calibrated_timestamps`, it also periodically sends a correlation
+ * of the GPU and the CPU clock, such that the client can convert GPU timestamps to CPU time without
+ * accumulating drift.
+ * If requested in the capture options and a pool for pipeline statistics queries is given, it also
+ * wraps debug markers into pipeline statistics queries (`vkCmdBeginQuery`/`vkCmdEndQuery`). As
+ * queries of the same type can't be nested and can't span multiple command buffers, only the
+ * outermost marker that begins and ends in the same command buffer gets statistics.
+ *
+ * Secondary command buffers don't get timestamps of their own, as they only execute as part of a
+ * primary command buffer. Their debug markers are added to the markers of the primary command
+ * buffer on `vkCmdExecuteCommands`, such that they are matched and timed like the markers of the
+ * primary command buffer. The timestamp slots of a secondary command buffer are baked into it, so
+ * if it gets executed more than once per recording, only its first execution gets timestamps.
+ * A command buffer that is submitted again without being reset (e.g. one that is recorded once
+ * and submitted every frame, or one that is used with `VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE`)
+ * gets timestamps for every submission whose previous execution has already been read: the slots
+ * baked into the command buffer are then reset and read again for the new execution.
  *
  * See also `DispatchTable` (for vulkan dispatch), `TimerQueryPool` (to manage the timestamp slots),
  * and `DeviceManager` (to retrieve device properties).
  *
- * Thread-Safety: This class is internally synchronized (using read/write locks), and can be
- * safely accessed from different threads. This is needed, as in Vulkan submits and command buffer
- * modifications can happen from multiple threads.
+ * Thread-Safety: This class is internally synchronized, and can be safely accessed from different
+ * threads. This is needed, as in Vulkan submits and command buffer modifications can happen from
+ * multiple threads. As the application already has to synchronize the recording into a command
+ * buffer, the state of each command buffer has its own lock, and recording into different command
+ * buffers on different threads does not contend on a lock shared by the whole tracker.
  */
 template <class DispatchTable, class DeviceManager, class TimerQueryPool>
 class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
  public:
+  // The statistics the pool passed as `pipeline_statistics_query_pool` needs to be created for. The
+  // results of a query contain the values in the order of the bits.
+  static constexpr VkQueryPipelineStatisticFlags kPipelineStatisticFlags =
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+  static constexpr size_t kNumPipelineStatistics = 11;
+  using PipelineStatistics = std::array<uint64_t, kNumPipelineStatistics>;
+
   // On a submission (vkQueueSubmit), all pointers to command buffers become invalid/can be reused
   // for a the next submission. The struct `QueueSubmission` gathers information (like timestamps
   // and timer slots) about a concrete submission and their corresponding command buffers and debug
@@ -106,13 +146,16 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // Identifies a particular debug marker region that has been submitted via `vkQueueSubmit`.
   // Note that we only store the state into `QueueSubmission`, if at that time we have a value for
   // the end_info. Beside the information about the begin/end, it also stores the label name, color
-  // and the depth of the marker.
+  // and the depth of the marker, and the slot of the pipeline statistics query around the marker if
+  // there is one. `pipeline_statistics` is set when that query was read.
   struct SubmittedMarkerSlice {
     std::optional<SubmittedMarker> begin_info;
     SubmittedMarker end_info;
     std::string label_name;
     Color color;
     size_t depth;
+    std::optional<uint32_t> pipeline_statistics_slot_index = std::nullopt;
+    std::optional<PipelineStatistics> pipeline_statistics = std::nullopt;
   };
 
   // A single submission (VkQueueSubmit) can contain multiple `SubmitInfo`s. We keep this structure.
@@ -131,11 +174,16 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     uint32_t num_begin_markers = 0;
   };
 
+  // `pipeline_statistics_query_pool` is optional. If given, it needs to be a pool for
+  // `VK_QUERY_TYPE_PIPELINE_STATISTICS` queries of `kPipelineStatisticFlags`, and statistics are
+  // only collected for the devices it was initialized for.
   explicit SubmissionTracker(DispatchTable* dispatch_table, TimerQueryPool* timer_query_pool,
                              DeviceManager* device_manager,
-                             uint32_t max_local_marker_depth_per_command_buffer)
+                             uint32_t max_local_marker_depth_per_command_buffer,
+                             TimerQueryPool* pipeline_statistics_query_pool = nullptr)
       : dispatch_table_(dispatch_table),
         timer_query_pool_(timer_query_pool),
+        pipeline_statistics_query_pool_(pipeline_statistics_query_pool),
         device_manager_(device_manager),
         max_local_marker_depth_per_command_buffer_(max_local_marker_depth_per_command_buffer) {
     CHECK(dispatch_table_ != nullptr);
@@ -166,8 +214,9 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   }
 
   void TrackCommandBuffers(VkDevice device, VkCommandPool pool,
-                           const VkCommandBuffer* command_buffers, uint32_t count) {
-    absl::WriterMutexLock lock(&mutex_);
+                           const VkCommandBuffer* command_buffers, uint32_t count,
+                           VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) {
+    absl::WriterMutexLock lock(&command_buffers_mutex_);
     auto associated_cbs_it = pool_to_command_buffers_.find(pool);
     if (associated_cbs_it == pool_to_command_buffers_.end()) {
       associated_cbs_it = pool_to_command_buffers_.try_emplace(pool).first;
@@ -175,13 +224,15 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     for (uint32_t i = 0; i < count; ++i) {
       VkCommandBuffer cb = command_buffers[i];
       associated_cbs_it->second.insert(cb);
-      command_buffer_to_device_[cb] = device;
+      command_buffers_.insert_or_assign(
+          cb, std::make_unique<TrackedCommandBuffer>(
+                  device, level == VK_COMMAND_BUFFER_LEVEL_SECONDARY));
     }
   }
 
   void UntrackCommandBuffers(VkDevice device, VkCommandPool pool,
                              const VkCommandBuffer* command_buffers, uint32_t count) {
-    absl::WriterMutexLock lock(&mutex_);
+    absl::WriterMutexLock lock(&command_buffers_mutex_);
     CHECK(pool_to_command_buffers_.contains(pool));
     absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
         pool_to_command_buffers_.at(pool);
@@ -189,23 +240,23 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       VkCommandBuffer command_buffer = command_buffers[i];
       associated_command_buffers.erase(command_buffer);
 
+      auto tracked_it = command_buffers_.find(command_buffer);
+      CHECK(tracked_it != command_buffers_.end());
+      TrackedCommandBuffer* tracked = tracked_it->second.get();
+      CHECK(tracked->device == device);
+
       // vkFreeCommandBuffers (and thus this method) can be also called on command bufers in
       // "recording" or executable state and has similar effect as vkResetCommandBuffer has.
-      // In `OnCaptureFinished`, we reset all the timer slots left in `command_buffer_to_state_`.
-      // If we would not reset them here and clear the state, we would try to reset those command
-      // buffers there. However, the mapping to the device (which is needed) would be missing.
-      if (command_buffer_to_state_.contains(command_buffer)) {
-        // Note: This will "rollback" the slot indices (rather then actually resetting them on the
-        // Gpu). This is fine, as we remove the command buffer state right after submission. Thus,
-        // There can not be a value in the respective slot.
-        ResetCommandBufferUnsafe(command_buffer);
-
-        command_buffer_to_state_.erase(command_buffer);
+      // In `OnCaptureFinished`, we reset all the timer slots left in the tracked command buffers.
+      // If we would not reset them here, they would be lost together with the command buffer.
+      // Note: This will "rollback" the slot indices (rather then actually resetting them on the
+      // Gpu). This is fine, as we remove the command buffer state right after submission. Thus,
+      // There can not be a value in the respective slot.
+      {
+        absl::MutexLock command_buffer_lock(&tracked->mutex);
+        ResetCommandBufferUnsafe(tracked);
       }
-
-      CHECK(command_buffer_to_device_.contains(command_buffer));
-      CHECK(command_buffer_to_device_.at(command_buffer) == device);
-      command_buffer_to_device_.erase(command_buffer);
+      command_buffers_.erase(tracked_it);
     }
     if (associated_command_buffers.empty()) {
       pool_to_command_buffers_.erase(pool);
@@ -213,7 +264,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   }
 
   void MarkCommandBufferBegin(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
+    TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked->mutex);
     // Even when we are not capturing we create state for this command buffer to allow the
     // debug marker tracking. In order to compute the correct depth of a debug marker and being able
     // to match an "end" marker with the corresponding "begin" marker, we maintain a stack of all
@@ -222,34 +274,37 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     // state here that allows us to store the debug markers into it and maintain that stack on
     // submission. We will not write timestamps in this case and thus don't store any information
     // other than the debug markers then.
-    {
-      if (command_buffer_to_state_.contains(command_buffer)) {
-        // We end up in this case, if we have used the command buffer before and want to write new
-        // commands to it without resetting the command buffer. Per specification,
-        // "vkBeginCommandBuffer" does also reset the command buffer, in addition to putting it
-        // into the executable state.
-        ResetCommandBufferUnsafe(command_buffer);
-      }
-      command_buffer_to_state_[command_buffer] = {};
-    }
-    if (!is_capturing_) {
+    // We end up resetting here, if we have used the command buffer before and want to write new
+    // commands to it without resetting the command buffer. Per specification,
+    // "vkBeginCommandBuffer" does also reset the command buffer, in addition to putting it into the
+    // executable state.
+    ResetCommandBufferUnsafe(tracked);
+    tracked->state.emplace();
+    // The begin and end of a secondary command buffer is covered by the primary command buffer it
+    // executes in.
+    if (!is_capturing_ || tracked->is_secondary) {
       return;
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      command_buffer_to_state_.at(command_buffer).command_buffer_begin_slot_index =
-          std::make_optional(slot_index);
+    if (RecordTimestamp(tracked, command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
+      tracked->state->command_buffer_begin_slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkCommandBufferEnd(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    if (!is_capturing_) {
+    TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked->mutex);
+    // A query needs to be ended in the command buffer it began in, even if the capture has finished
+    // in the meantime. We will not read the results of a query that is ended here, as it doesn't
+    // match an "end" marker.
+    if (tracked->state.has_value()) {
+      EndPipelineStatisticsQueryIfActive(tracked, command_buffer);
+    }
+    if (!is_capturing_ || tracked->is_secondary) {
       return;
     }
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    if (!tracked->state.has_value()) {
       ERROR_ONCE(
           "Calling vkEndCommandBuffer on a command buffer that is in the initial state "
           "(i.e. either freshly allocated or reset with vkResetCommandBuffer).");
@@ -257,69 +312,67 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index)) {
-      // MarkCommandBufferBegin/End are called from within the same submit, and as the
-      // `MarkCommandBufferBegin` will always insert the state, we can assume that it is there.
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& command_buffer_state = command_buffer_to_state_.at(command_buffer);
-      command_buffer_state.command_buffer_end_slot_index = std::make_optional(slot_index);
+    if (RecordTimestamp(tracked, command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        &slot_index)) {
+      tracked->state->command_buffer_end_slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkDebugMarkerBegin(VkCommandBuffer command_buffer, const char* text, Color color) {
-    absl::WriterMutexLock lock(&mutex_);
     // It is ensured by the Vulkan spec. that `text` must not be nullptr.
     CHECK(text != nullptr);
-    bool marker_depth_exceeds_maximum;
-    {
-      if (!command_buffer_to_state_.contains(command_buffer)) {
-        ERROR_ONCE(
-            "Calling vkCmdDebugMarkerBeginEXT/vkCmdBeginDebugUtilsLabelEXT on a command buffer "
-            "that is in the initial state (i.e. either freshly allocated or reset with "
-            "vkResetCommandBuffer).");
-        return;
-      }
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-      ++state.local_marker_stack_size;
-      marker_depth_exceeds_maximum =
-          state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
-      Marker marker{.type = MarkerType::kDebugMarkerBegin,
-                    .label_name = std::string(text),
-                    .color = color,
-                    .cut_off = marker_depth_exceeds_maximum};
-      state.markers.emplace_back(std::move(marker));
+    TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked->mutex);
+    if (!tracked->state.has_value()) {
+      ERROR_ONCE(
+          "Calling vkCmdDebugMarkerBeginEXT/vkCmdBeginDebugUtilsLabelEXT on a command buffer "
+          "that is in the initial state (i.e. either freshly allocated or reset with "
+          "vkResetCommandBuffer).");
+      return;
     }
+    CommandBufferState& state = tracked->state.value();
+    ++state.local_marker_stack_size;
+    const bool marker_depth_exceeds_maximum =
+        state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
+    Marker marker{.type = MarkerType::kDebugMarkerBegin,
+                  .label_name = std::string(text),
+                  .color = color,
+                  .cut_off = marker_depth_exceeds_maximum};
+    state.markers.emplace_back(std::move(marker));
 
     if (!is_capturing_ || marker_depth_exceeds_maximum) {
       return;
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    if (RecordTimestamp(tracked, command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
       state.markers.back().slot_index = std::make_optional(slot_index);
+      BeginPipelineStatisticsQueryIfNecessary(tracked, command_buffer);
     }
   }
 
   void MarkDebugMarkerEnd(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    bool marker_depth_exceeds_maximum;
-
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked->mutex);
+    if (!tracked->state.has_value()) {
       ERROR_ONCE(
           "Calling vkCmdDebugMarkerEndEXT/vkCmdEndDebugUtilsLabelEXT on a command buffer "
           "that is in the initial state (i.e. either freshly allocated or reset with "
           "vkResetCommandBuffer).");
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-    marker_depth_exceeds_maximum =
+    CommandBufferState& state = tracked->state.value();
+    const bool marker_depth_exceeds_maximum =
         state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
     Marker marker{.type = MarkerType::kDebugMarkerEnd, .cut_off = marker_depth_exceeds_maximum};
     state.markers.emplace_back(std::move(marker));
+    // This ends the marker that began the active pipeline statistics query (if any). As for the
+    // command buffer end, this needs to happen even if the capture has finished in the meantime.
+    if (state.active_pipeline_statistics_slot_index.has_value() &&
+        state.active_pipeline_statistics_marker_depth == state.local_marker_stack_size) {
+      EndPipelineStatisticsQueryIfActive(tracked, command_buffer);
+      state.markers.back().ends_pipeline_statistics_query = true;
+    }
     // We might see more "ends" than "begins", as the "begins" can be on a different command
     // buffer.
     if (state.local_marker_stack_size > 0) {
@@ -331,13 +384,68 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index)) {
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    if (RecordTimestamp(tracked, command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        &slot_index)) {
       state.markers.back().slot_index = std::make_optional(slot_index);
     }
   }
 
+  // Adds the debug markers recorded into the secondary command buffers to the markers of the
+  // primary `command_buffer` they get executed in, such that they are ordered correctly on
+  // submission of the primary command buffer. This needs to be called before the driver call of
+  // `vkCmdExecuteCommands`, as it also ends the active pipeline statistics query of the primary
+  // command buffer: the secondary command buffers were not recorded to inherit it.
+  // The timestamp slots of the markers stay owned by the secondary command buffers, and only the
+  // first execution of a secondary command buffer carries them, as further executions would write
+  // into the same slots.
+  void MarkExecuteCommands(VkCommandBuffer command_buffer, uint32_t secondary_command_buffer_count,
+                           const VkCommandBuffer* secondary_command_buffers) {
+    // Look up all command buffers first, as `command_buffers_mutex_` must not be taken while
+    // holding the mutex of a `TrackedCommandBuffer`.
+    TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+    std::vector<TrackedCommandBuffer*> tracked_secondaries;
+    tracked_secondaries.reserve(secondary_command_buffer_count);
+    for (uint32_t i = 0; i < secondary_command_buffer_count; ++i) {
+      tracked_secondaries.push_back(GetTrackedCommandBuffer(secondary_command_buffers[i]));
+    }
+
+    absl::MutexLock lock(&tracked->mutex);
+    if (!tracked->state.has_value()) {
+      ERROR_ONCE(
+          "Calling vkCmdExecuteCommands on a command buffer that is in the initial state "
+          "(i.e. either freshly allocated or reset with vkResetCommandBuffer).");
+      return;
+    }
+    CommandBufferState& state = tracked->state.value();
+    EndPipelineStatisticsQueryIfActive(tracked, command_buffer);
+
+    // The mutex of a secondary command buffer is always taken after the one of the primary.
+    for (TrackedCommandBuffer* tracked_secondary : tracked_secondaries) {
+      absl::MutexLock secondary_lock(&tracked_secondary->mutex);
+      if (!tracked_secondary->state.has_value()) {
+        ERROR_ONCE(
+            "Calling vkCmdExecuteCommands with a secondary command buffer that is in the initial "
+            "state (i.e. either freshly allocated or reset with vkResetCommandBuffer).");
+        continue;
+      }
+      CommandBufferState& secondary_state = tracked_secondary->state.value();
+      const bool carries_slots = !secondary_state.has_lent_slots;
+      secondary_state.has_lent_slots = true;
+      state.executed_secondary_command_buffers.push_back(
+          {.tracked = tracked_secondary, .carries_slots = carries_slots});
+      for (const Marker& marker : secondary_state.markers) {
+        Marker executed_marker = marker;
+        executed_marker.is_owned_by_secondary_command_buffer = true;
+        if (!carries_slots) {
+          executed_marker.slot_index.reset();
+          executed_marker.pipeline_statistics_slot_index.reset();
+          executed_marker.ends_pipeline_statistics_query = false;
+        }
+        state.markers.emplace_back(std::move(executed_marker));
+      }
+    }
+  }
+
   // After command buffers are submitted into a queue, they can be reused for further operations.
   // Thus, our identification via the pointers becomes invalid. We will use the vkQueueSubmit
   // to make our data persistent until we have processed the results of the execution of these
@@ -349,7 +457,6 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // This allows us to map submissions from the Vulkan layer to the driver submissions.
   [[nodiscard]] std::optional<QueueSubmission> PersistCommandBuffersOnSubmit(
       VkQueue queue, uint32_t submit_count, const VkSubmitInfo* submits) {
-    absl::WriterMutexLock lock(&mutex_);
     if (!is_capturing_) {
       // `OnCaptureFinished` has already been called and has taken care of resetting slots.
       return std::nullopt;
@@ -375,7 +482,9 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       for (uint32_t command_buffer_index = 0; command_buffer_index < submit_info.commandBufferCount;
            ++command_buffer_index) {
         VkCommandBuffer command_buffer = submit_info.pCommandBuffers[command_buffer_index];
-        PersistSingleCommandBufferOnSubmit(device, command_buffer, &queue_submission,
+        TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+        absl::MutexLock command_buffer_lock(&tracked->mutex);
+        PersistSingleCommandBufferOnSubmit(&device, tracked, &queue_submission,
                                            &submitted_submit_info, &query_slots_not_needed_to_read);
       }
     }
@@ -406,7 +515,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   void PersistDebugMarkersOnSubmit(VkQueue queue, uint32_t submit_count,
                                    const VkSubmitInfo* submits,
                                    std::optional<QueueSubmission> queue_submission_optional) {
-    absl::WriterMutexLock lock(&mutex_);
+    absl::MutexLock lock(&submissions_mutex_);
     if (!queue_to_markers_.contains(queue)) {
       queue_to_markers_[queue] = {};
     }
@@ -422,24 +531,31 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     std::vector<uint32_t> marker_slots_not_needed_to_read;
+    std::vector<uint32_t> pipeline_statistics_slots_not_needed_to_read;
     VkDevice device = VK_NULL_HANDLE;
     for (uint32_t submit_index = 0; submit_index < submit_count; ++submit_index) {
       VkSubmitInfo submit_info = submits[submit_index];
       for (uint32_t command_buffer_index = 0; command_buffer_index < submit_info.commandBufferCount;
            ++command_buffer_index) {
         VkCommandBuffer command_buffer = submit_info.pCommandBuffers[command_buffer_index];
+        TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
         if (device == VK_NULL_HANDLE) {
-          CHECK(command_buffer_to_device_.contains(command_buffer));
-          device = command_buffer_to_device_.at(command_buffer);
+          device = tracked->device;
         }
+        absl::MutexLock command_buffer_lock(&tracked->mutex);
         PersistDebugMarkersOfASingleCommandBufferOnSubmit(
-            command_buffer, &queue_submission_optional, &markers, &marker_slots_not_needed_to_read);
+            tracked, &queue_submission_optional, &markers, &marker_slots_not_needed_to_read,
+            &pipeline_statistics_slots_not_needed_to_read);
       }
     }
 
     if (!marker_slots_not_needed_to_read.empty()) {
       timer_query_pool_->MarkQuerySlotsDoneReading(device, marker_slots_not_needed_to_read);
     }
+    if (!pipeline_statistics_slots_not_needed_to_read.empty()) {
+      pipeline_statistics_query_pool_->MarkQuerySlotsDoneReading(
+          device, pipeline_statistics_slots_not_needed_to_read);
+    }
 
     if (!queue_submission_optional.has_value()) {
       return;
@@ -467,9 +583,11 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // "end", that got completed in this submission.
   // See also `WriteMetaInfo`, `WriteCommandBufferTimings` and `WriteDebugMarkers`.
   // This method also resets all the timer slots that have been read.
+  // The timestamps of all pending submissions are read with as few `vkGetQueryPoolResults` calls as
+  // possible (one per range of consecutive slots), see `ReadGpuTimestampsNs`.
   // It is assumed to be called periodically, e.g. on `vkQueuePresentKHR`.
   void CompleteSubmits(VkDevice device) {
-    absl::WriterMutexLock lock(&mutex_);
+    absl::MutexLock lock(&submissions_mutex_);
     VkQueryPool query_pool = timer_query_pool_->GetQueryPool(device);
 
     if (queue_to_submission_priority_queue_.empty()) {
@@ -480,7 +598,35 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     const float timestamp_period =
         device_manager_->GetPhysicalDeviceProperties(physical_device).limits.timestampPeriod;
 
+    CalibrateGpuClockIfNecessary(device, timestamp_period);
+
+    std::vector<uint32_t> slot_indices_to_read;
+    std::vector<uint32_t> pipeline_statistics_slot_indices_to_read;
+    for (auto& [unused_queue, submissions] : queue_to_submission_priority_queue_) {
+      std::vector<QueueSubmission> pending_submissions;
+      while (!submissions.empty()) {
+        pending_submissions.push_back(submissions.top());
+        submissions.pop();
+      }
+      for (QueueSubmission& pending_submission : pending_submissions) {
+        AppendSlotIndicesToRead(pending_submission, &slot_indices_to_read,
+                                &pipeline_statistics_slot_indices_to_read);
+        submissions.emplace(std::move(pending_submission));
+      }
+    }
+    std::sort(slot_indices_to_read.begin(), slot_indices_to_read.end());
+    slot_indices_to_read.erase(
+        std::unique(slot_indices_to_read.begin(), slot_indices_to_read.end()),
+        slot_indices_to_read.end());
+    const absl::flat_hash_map<uint32_t, uint64_t> slot_index_to_timestamp_ns =
+        ReadGpuTimestampsNs(device, query_pool, slot_indices_to_read, timestamp_period);
+    std::sort(pipeline_statistics_slot_indices_to_read.begin(),
+              pipeline_statistics_slot_indices_to_read.end());
+    const absl::flat_hash_map<uint32_t, PipelineStatistics> slot_index_to_pipeline_statistics =
+        ReadPipelineStatistics(device, pipeline_statistics_slot_indices_to_read);
+
     std::vector<uint32_t> query_slots_done_reading = {};
+    std::vector<uint32_t> pipeline_statistics_slots_done_reading = {};
     std::vector<QueueSubmission> submissions_to_send = {};
 
     // The submits of a specific queue in `submissions_queue_` are sorted by "pre submission CPU"
@@ -491,15 +637,19 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
         QueueSubmission completed_submission = submissions.top();
         submissions.pop();
         bool command_buffer_queries_succeeded = QueryCommandBufferTimestamps(
-            &completed_submission, &query_slots_done_reading, device, query_pool, timestamp_period);
+            &completed_submission, &query_slots_done_reading, slot_index_to_timestamp_ns);
 
         // We only need to read the debug marker timestamps, if querying the command buffers
         // succeeded.
         bool marker_queries_succeeded = false;
         if (command_buffer_queries_succeeded) {
-          marker_queries_succeeded =
-              QueryDebugMarkerTimestamps(&completed_submission, &query_slots_done_reading, device,
-                                         query_pool, timestamp_period);
+          marker_queries_succeeded = QueryDebugMarkerTimestamps(
+              &completed_submission, &query_slots_done_reading, slot_index_to_timestamp_ns);
+        }
+        if (marker_queries_succeeded) {
+          marker_queries_succeeded = QueryDebugMarkerPipelineStatistics(
+              &completed_submission, &pipeline_statistics_slots_done_reading,
+              slot_index_to_pipeline_statistics);
         }
 
         if (command_buffer_queries_succeeded && marker_queries_succeeded) {
@@ -530,48 +680,64 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     if (!query_slots_done_reading.empty()) {
       timer_query_pool_->MarkQuerySlotsDoneReading(device, query_slots_done_reading);
     }
+    if (!pipeline_statistics_slots_done_reading.empty()) {
+      pipeline_statistics_query_pool_->MarkQuerySlotsDoneReading(
+          device, pipeline_statistics_slots_done_reading);
+    }
   }
 
   void ResetCommandBuffer(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    ResetCommandBufferUnsafe(command_buffer);
+    TrackedCommandBuffer* tracked = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked->mutex);
+    ResetCommandBufferUnsafe(tracked);
   }
 
   void ResetCommandPool(VkCommandPool command_pool) {
-    absl::flat_hash_set<VkCommandBuffer> command_buffers;
-    {
-      absl::ReaderMutexLock lock(&mutex_);
-      if (!pool_to_command_buffers_.contains(command_pool)) {
-        return;
-      }
-      CHECK(pool_to_command_buffers_.contains(command_pool));
-      command_buffers = pool_to_command_buffers_.at(command_pool);
+    absl::ReaderMutexLock lock(&command_buffers_mutex_);
+    auto associated_cbs_it = pool_to_command_buffers_.find(command_pool);
+    if (associated_cbs_it == pool_to_command_buffers_.end()) {
+      return;
     }
-    for (const auto& command_buffer : command_buffers) {
-      ResetCommandBuffer(command_buffer);
+    for (VkCommandBuffer command_buffer : associated_cbs_it->second) {
+      CHECK(command_buffers_.contains(command_buffer));
+      TrackedCommandBuffer* tracked = command_buffers_.at(command_buffer).get();
+      absl::MutexLock command_buffer_lock(&tracked->mutex);
+      ResetCommandBufferUnsafe(tracked);
     }
   }
 
   void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
-    absl::WriterMutexLock lock(&mutex_);
     SetMaxLocalMarkerDepthPerCommandBuffer(
         capture_options.max_local_marker_depth_per_command_buffer());
+    collect_pipeline_statistics_ = capture_options.collect_gpu_pipeline_statistics();
+    {
+      // Calibrate the clocks at the beginning of each capture.
+      absl::MutexLock lock(&submissions_mutex_);
+      device_to_last_gpu_clock_calibration_ns_.clear();
+    }
     is_capturing_ = true;
   }
 
   void OnCaptureStop() override {}
 
   void OnCaptureFinished() override {
-    absl::WriterMutexLock lock(&mutex_);
+    // Command buffers that are recorded from now on won't get any timestamps, so after resetting
+    // the slots of each command buffer below, no new slots can appear.
+    is_capturing_ = false;
+
+    absl::ReaderMutexLock lock(&command_buffers_mutex_);
     std::vector<uint32_t> slots_not_needed_to_read_anymore;
+    std::vector<uint32_t> pipeline_statistics_slots_not_needed_to_read_anymore;
 
     VkDevice device = VK_NULL_HANDLE;
 
-    for (auto& [command_buffer, command_buffer_state] : command_buffer_to_state_) {
+    for (auto& [unused_command_buffer, tracked] : command_buffers_) {
+      absl::MutexLock command_buffer_lock(&tracked->mutex);
+      if (!tracked->state.has_value()) continue;
+      CommandBufferState& command_buffer_state = tracked->state.value();
       if (command_buffer_state.pre_submission_cpu_timestamp.has_value()) continue;
       if (device == VK_NULL_HANDLE) {
-        CHECK(command_buffer_to_device_.contains(command_buffer));
-        device = command_buffer_to_device_.at(command_buffer);
+        device = tracked->device;
       }
       if (command_buffer_state.command_buffer_begin_slot_index.has_value()) {
         slots_not_needed_to_read_anymore.push_back(
@@ -586,28 +752,50 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       }
 
       for (Marker& marker : command_buffer_state.markers) {
+        // The slots of markers executed from a secondary command buffer are taken care of together
+        // with the other slots of that command buffer.
+        if (marker.is_owned_by_secondary_command_buffer) {
+          marker.slot_index.reset();
+          marker.pipeline_statistics_slot_index.reset();
+          continue;
+        }
         if (marker.slot_index.has_value()) {
           slots_not_needed_to_read_anymore.push_back(marker.slot_index.value());
           marker.slot_index.reset();
         }
+        if (marker.pipeline_statistics_slot_index.has_value()) {
+          pipeline_statistics_slots_not_needed_to_read_anymore.push_back(
+              marker.pipeline_statistics_slot_index.value());
+          marker.pipeline_statistics_slot_index.reset();
+        }
       }
     }
     if (!slots_not_needed_to_read_anymore.empty()) {
       timer_query_pool_->MarkQuerySlotsDoneReading(device, slots_not_needed_to_read_anymore);
     }
-
-    is_capturing_ = false;
+    if (!pipeline_statistics_slots_not_needed_to_read_anymore.empty()) {
+      pipeline_statistics_query_pool_->MarkQuerySlotsDoneReading(
+          device, pipeline_statistics_slots_not_needed_to_read_anymore);
+    }
   }
 
  private:
   enum class MarkerType { kDebugMarkerBegin = 0, kDebugMarkerEnd };
 
+  // For a "begin", `pipeline_statistics_slot_index` is the slot of the pipeline statistics query
+  // that was begun together with the marker. An "end" that ended that query has
+  // `ends_pipeline_statistics_query` set. `is_owned_by_secondary_command_buffer` is set for the
+  // markers that a primary command buffer got from a secondary command buffer executed in it, whose
+  // slots are reset together with the secondary command buffer.
   struct Marker {
     MarkerType type;
     std::optional<uint32_t> slot_index;
     std::optional<std::string> label_name;
     std::optional<Color> color;
     bool cut_off;
+    std::optional<uint32_t> pipeline_statistics_slot_index = std::nullopt;
+    bool ends_pipeline_statistics_query = false;
+    bool is_owned_by_secondary_command_buffer = false;
   };
 
   // We have a stack of all markers of a queue that gets updated upon a submission (VkQueueSubmit).
@@ -626,28 +814,70 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     Color color;
     size_t depth;
     bool depth_exceeds_maximum;
+    std::optional<uint32_t> pipeline_statistics_slot_index;
   };
 
   struct QueueMarkerState {
     std::stack<MarkerState> marker_stack;
   };
 
+  struct TrackedCommandBuffer;
+
+  // `carries_slots` is set for the execution in the primary command buffer that got the slots of
+  // the markers of the secondary command buffer.
+  struct ExecutedSecondaryCommandBuffer {
+    TrackedCommandBuffer* tracked;
+    bool carries_slots;
+  };
+
   struct CommandBufferState {
     std::optional<uint32_t> command_buffer_begin_slot_index;
     std::optional<uint32_t> command_buffer_end_slot_index;
+    // The time of the last submission whose timestamps are read. For a secondary command buffer,
+    // this is the submission of the primary command buffer it was executed in.
     std::optional<uint64_t> pre_submission_cpu_timestamp;
     std::vector<Marker> markers;
     uint32_t local_marker_stack_size;
+    // The slot of the pipeline statistics query that was begun and not ended yet in this command
+    // buffer, and the `local_marker_stack_size` right after the "begin" marker of the query.
+    std::optional<uint32_t> active_pipeline_statistics_slot_index;
+    uint32_t active_pipeline_statistics_marker_depth;
+    // The secondary command buffers executed in this (primary) command buffer. By the Vulkan spec,
+    // they can't be freed or reset while this command buffer can still be submitted.
+    std::vector<ExecutedSecondaryCommandBuffer> executed_secondary_command_buffers;
+    // Set for a secondary command buffer once the slots of its markers were handed to a primary
+    // command buffer, and once that primary command buffer was submitted.
+    bool has_lent_slots = false;
+    bool lent_slots_were_submitted = false;
   };
 
-  bool RecordTimestamp(VkCommandBuffer command_buffer, VkPipelineStageFlagBits pipeline_stage_flags,
-                       uint32_t* slot_index) {
-    mutex_.AssertReaderHeld();
-    VkDevice device;
-    {
-      CHECK(command_buffer_to_device_.contains(command_buffer));
-      device = command_buffer_to_device_.at(command_buffer);
-    }
+  // Everything we know about a command buffer allocated from a tracked pool. By the Vulkan spec,
+  // the recording into a command buffer and its submission are externally synchronized by the
+  // application, so `mutex` is only contended by `OnCaptureFinished`.
+  struct TrackedCommandBuffer {
+    explicit TrackedCommandBuffer(VkDevice device, bool is_secondary)
+        : device(device), is_secondary(is_secondary) {}
+
+    const VkDevice device;
+    const bool is_secondary;
+    absl::Mutex mutex;
+    // Empty while the command buffer is in the initial state.
+    std::optional<CommandBufferState> state ABSL_GUARDED_BY(mutex);
+  };
+
+  // The returned pointer stays valid until the command buffer gets freed, which the application
+  // must not do while the command buffer is in use.
+  [[nodiscard]] TrackedCommandBuffer* GetTrackedCommandBuffer(VkCommandBuffer command_buffer) {
+    absl::ReaderMutexLock lock(&command_buffers_mutex_);
+    auto tracked_it = command_buffers_.find(command_buffer);
+    CHECK(tracked_it != command_buffers_.end());
+    return tracked_it->second.get();
+  }
+
+  bool RecordTimestamp(TrackedCommandBuffer* tracked, VkCommandBuffer command_buffer,
+                       VkPipelineStageFlagBits pipeline_stage_flags, uint32_t* slot_index) {
+    tracked->mutex.AssertHeld();
+    VkDevice device = tracked->device;
 
     VkQueryPool query_pool = timer_query_pool_->GetQueryPool(device);
 
@@ -662,20 +892,209 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return true;
   }
 
-  std::optional<uint64_t> QueryGpuTimestampNs(VkDevice device, VkQueryPool query_pool,
-                                              uint32_t slot_index, float timestamp_period) {
-    static constexpr VkDeviceSize kResultStride = sizeof(uint64_t);
+  // Begins a pipeline statistics query together with the "begin" marker that was just recorded, if
+  // requested and if no query is active in the command buffer yet.
+  void BeginPipelineStatisticsQueryIfNecessary(TrackedCommandBuffer* tracked,
+                                               VkCommandBuffer command_buffer) {
+    tracked->mutex.AssertHeld();
+    CommandBufferState& state = tracked->state.value();
+    VkDevice device = tracked->device;
+    if (!collect_pipeline_statistics_ || pipeline_statistics_query_pool_ == nullptr ||
+        state.active_pipeline_statistics_slot_index.has_value() ||
+        !pipeline_statistics_query_pool_->IsInitialized(device)) {
+      return;
+    }
+
+    uint32_t slot_index;
+    if (!pipeline_statistics_query_pool_->NextReadyQuerySlot(device, &slot_index)) {
+      return;
+    }
+    dispatch_table_->CmdBeginQuery(command_buffer)(
+        command_buffer, pipeline_statistics_query_pool_->GetQueryPool(device), slot_index, 0);
+    state.markers.back().pipeline_statistics_slot_index = slot_index;
+    state.active_pipeline_statistics_slot_index = slot_index;
+    state.active_pipeline_statistics_marker_depth = state.local_marker_stack_size;
+  }
 
-    uint64_t timestamp = 0;
-    VkResult result_status = dispatch_table_->GetQueryPoolResults(device)(
-        device, query_pool, slot_index, 1, sizeof(timestamp), &timestamp, kResultStride,
-        VK_QUERY_RESULT_64_BIT);
+  void EndPipelineStatisticsQueryIfActive(TrackedCommandBuffer* tracked,
+                                          VkCommandBuffer command_buffer) {
+    tracked->mutex.AssertHeld();
+    CommandBufferState& state = tracked->state.value();
+    if (!state.active_pipeline_statistics_slot_index.has_value()) {
+      return;
+    }
+    dispatch_table_->CmdEndQuery(command_buffer)(
+        command_buffer, pipeline_statistics_query_pool_->GetQueryPool(tracked->device),
+        state.active_pipeline_statistics_slot_index.value());
+    state.active_pipeline_statistics_slot_index.reset();
+  }
 
-    if (result_status != VK_SUCCESS) {
+  // Calls `consumer` with the slot index and the `values_per_query` values of each available query
+  // in the slots `sorted_slot_indices`. The results are read with one `vkGetQueryPoolResults` call
+  // per range of consecutive slots.
+  template <typename Consumer>
+  void ReadAvailableQueryResults(VkDevice device, VkQueryPool query_pool,
+                                 const std::vector<uint32_t>& sorted_slot_indices,
+                                 size_t values_per_query, Consumer&& consumer) {
+    // With `VK_QUERY_RESULT_WITH_AVAILABILITY_BIT` the values of every query are followed by its
+    // availability.
+    const size_t result_size = values_per_query + 1;
+    const VkDeviceSize result_stride = result_size * sizeof(uint64_t);
+
+    std::vector<uint64_t> results;
+    size_t range_begin = 0;
+    while (range_begin < sorted_slot_indices.size()) {
+      size_t range_end = range_begin + 1;
+      while (range_end < sorted_slot_indices.size() &&
+             sorted_slot_indices[range_end] == sorted_slot_indices[range_end - 1] + 1) {
+        ++range_end;
+      }
+      const uint32_t first_slot_index = sorted_slot_indices[range_begin];
+      const auto slot_count = static_cast<uint32_t>(range_end - range_begin);
+      range_begin = range_end;
+
+      results.assign(result_size * slot_count, 0);
+      VkResult result_status = dispatch_table_->GetQueryPoolResults(device)(
+          device, query_pool, first_slot_index, slot_count, results.size() * sizeof(uint64_t),
+          results.data(), result_stride,
+          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+      // `VK_NOT_READY` means that some of the results are not available yet, but the available
+      // ones are still written.
+      if (result_status != VK_SUCCESS && result_status != VK_NOT_READY) {
+        continue;
+      }
+      for (uint32_t i = 0; i < slot_count; ++i) {
+        const uint64_t* result = results.data() + result_size * i;
+        if (result[values_per_query] == 0) continue;
+        consumer(first_slot_index + i, result);
+      }
+    }
+  }
+
+  // Reads the timestamps in the slots `sorted_slot_indices`. Timestamps that are not available yet
+  // are missing in the returned map.
+  absl::flat_hash_map<uint32_t, uint64_t> ReadGpuTimestampsNs(
+      VkDevice device, VkQueryPool query_pool, const std::vector<uint32_t>& sorted_slot_indices,
+      float timestamp_period) {
+    absl::flat_hash_map<uint32_t, uint64_t> slot_index_to_timestamp_ns;
+    ReadAvailableQueryResults(
+        device, query_pool, sorted_slot_indices, 1,
+        [&slot_index_to_timestamp_ns, timestamp_period](uint32_t slot_index,
+                                                        const uint64_t* values) {
+          slot_index_to_timestamp_ns.emplace(
+              slot_index, static_cast<uint64_t>(static_cast<double>(values[0]) * timestamp_period));
+        });
+    return slot_index_to_timestamp_ns;
+  }
+
+  // Reads the pipeline statistics in the slots `sorted_slot_indices`. Statistics that are not
+  // available yet are missing in the returned map.
+  absl::flat_hash_map<uint32_t, PipelineStatistics> ReadPipelineStatistics(
+      VkDevice device, const std::vector<uint32_t>& sorted_slot_indices) {
+    absl::flat_hash_map<uint32_t, PipelineStatistics> slot_index_to_pipeline_statistics;
+    if (sorted_slot_indices.empty()) {
+      return slot_index_to_pipeline_statistics;
+    }
+    ReadAvailableQueryResults(
+        device, pipeline_statistics_query_pool_->GetQueryPool(device), sorted_slot_indices,
+        kNumPipelineStatistics,
+        [&slot_index_to_pipeline_statistics](uint32_t slot_index, const uint64_t* values) {
+          PipelineStatistics pipeline_statistics;
+          std::copy(values, values + kNumPipelineStatistics, pipeline_statistics.begin());
+          slot_index_to_pipeline_statistics.emplace(slot_index, pipeline_statistics);
+        });
+    return slot_index_to_pipeline_statistics;
+  }
+
+  [[nodiscard]] static std::optional<uint64_t> GetGpuTimestampNs(
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_index_to_timestamp_ns,
+      uint32_t slot_index) {
+    auto timestamp_it = slot_index_to_timestamp_ns.find(slot_index);
+    if (timestamp_it == slot_index_to_timestamp_ns.end()) {
       return std::nullopt;
     }
+    return timestamp_it->second;
+  }
 
-    return static_cast<uint64_t>(static_cast<double>(timestamp) * timestamp_period);
+  // Appends the slot indices of the timestamps and of the pipeline statistics of `submission` that
+  // were not read yet.
+  static void AppendSlotIndicesToRead(const QueueSubmission& submission,
+                                      std::vector<uint32_t>* slot_indices,
+                                      std::vector<uint32_t>* pipeline_statistics_slot_indices) {
+    for (const auto& submit_info : submission.submit_infos) {
+      for (const auto& command_buffer : submit_info.command_buffers) {
+        if (!command_buffer.end_timestamp.has_value() &&
+            command_buffer.command_buffer_end_slot_index.has_value()) {
+          slot_indices->push_back(command_buffer.command_buffer_end_slot_index.value());
+        }
+        if (!command_buffer.begin_timestamp.has_value() &&
+            command_buffer.command_buffer_begin_slot_index.has_value()) {
+          slot_indices->push_back(command_buffer.command_buffer_begin_slot_index.value());
+        }
+      }
+    }
+    for (const auto& marker_slice : submission.completed_markers) {
+      if (!marker_slice.end_info.timestamp.has_value()) {
+        slot_indices->push_back(marker_slice.end_info.slot_index);
+      }
+      if (marker_slice.begin_info.has_value() && !marker_slice.begin_info->timestamp.has_value()) {
+        slot_indices->push_back(marker_slice.begin_info->slot_index);
+      }
+      if (marker_slice.pipeline_statistics_slot_index.has_value() &&
+          !marker_slice.pipeline_statistics.has_value()) {
+        pipeline_statistics_slot_indices->push_back(
+            marker_slice.pipeline_statistics_slot_index.value());
+      }
+    }
+  }
+
+  // Sends a `GpuClockCalibration` if the last one for `device` is older than
+  // `kGpuClockCalibrationIntervalNs`. Does nothing if the device doesn't support calibrated
+  // timestamps (or if calibrating failed before), in which case the client falls back to aligning
+  // each submission with its `GpuJob`.
+  void CalibrateGpuClockIfNecessary(VkDevice device, float timestamp_period) {
+    submissions_mutex_.AssertHeld();
+    if (!is_capturing_ || vulkan_layer_producer_ == nullptr ||
+        !dispatch_table_->IsCalibratedTimestampsExtensionSupported(device) ||
+        devices_failing_gpu_clock_calibration_.contains(device)) {
+      return;
+    }
+
+    const uint64_t now_ns = orbit_base::CaptureTimestampNs();
+    auto last_calibration_it = device_to_last_gpu_clock_calibration_ns_.find(device);
+    if (last_calibration_it != device_to_last_gpu_clock_calibration_ns_.end() &&
+        now_ns - last_calibration_it->second < kGpuClockCalibrationIntervalNs) {
+      return;
+    }
+
+    // `orbit_base::CaptureTimestampNs` is based on `CLOCK_MONOTONIC`.
+    const std::array<VkCalibratedTimestampInfoEXT, 2> timestamp_infos{
+        VkCalibratedTimestampInfoEXT{.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+                                     .pNext = nullptr,
+                                     .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT},
+        VkCalibratedTimestampInfoEXT{.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+                                     .pNext = nullptr,
+                                     .timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT}};
+    std::array<uint64_t, 2> timestamps{};
+    uint64_t max_deviation_ns = 0;
+    VkResult result_status = dispatch_table_->GetCalibratedTimestampsEXT(device)(
+        device, timestamp_infos.size(), timestamp_infos.data(), timestamps.data(),
+        &max_deviation_ns);
+    if (result_status != VK_SUCCESS) {
+      ERROR("Calibrating the GPU clock failed, GPU timestamps will be less precise");
+      devices_failing_gpu_clock_calibration_.insert(device);
+      return;
+    }
+    device_to_last_gpu_clock_calibration_ns_.insert_or_assign(device, now_ns);
+
+    orbit_grpc_protos::ProducerCaptureEvent capture_event;
+    orbit_grpc_protos::GpuClockCalibration* calibration =
+        capture_event.mutable_gpu_clock_calibration();
+    calibration->set_gpu_timestamp_ns(
+        static_cast<uint64_t>(static_cast<double>(timestamps[0]) * timestamp_period));
+    calibration->set_cpu_timestamp_ns(timestamps[1]);
+    calibration->set_max_deviation_ns(max_deviation_ns);
+    vulkan_layer_producer_->EnqueueCaptureEvent(std::move(capture_event));
   }
 
   static void WriteMetaInfo(const SubmissionMetaInformation& meta_info,
@@ -686,17 +1105,16 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     target_proto->set_post_submission_cpu_timestamp(meta_info.post_submission_cpu_timestamp);
   }
 
-  [[nodiscard]] bool QuerySingleCommandBufferTimestamps(SubmittedCommandBuffer* command_buffer,
-                                                        std::vector<uint32_t>* query_slots_to_reset,
-                                                        VkDevice device, VkQueryPool query_pool,
-                                                        float timestamp_period) {
+  [[nodiscard]] static bool QuerySingleCommandBufferTimestamps(
+      SubmittedCommandBuffer* command_buffer, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_index_to_timestamp_ns) {
     CHECK(command_buffer != nullptr);
 
     if (!command_buffer->end_timestamp.has_value()) {
       CHECK(command_buffer->command_buffer_end_slot_index.has_value());
       uint32_t slot_index = command_buffer->command_buffer_end_slot_index.value();
       std::optional<uint64_t> end_timestamp =
-          QueryGpuTimestampNs(device, query_pool, slot_index, timestamp_period);
+          GetGpuTimestampNs(slot_index_to_timestamp_ns, slot_index);
       if (end_timestamp.has_value()) {
         command_buffer->end_timestamp = end_timestamp;
         query_slots_to_reset->push_back(slot_index);
@@ -714,7 +1132,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     if (!command_buffer->begin_timestamp.has_value()) {
       uint32_t slot_index = command_buffer->command_buffer_begin_slot_index.value();
       std::optional<uint64_t> begin_timestamp =
-          QueryGpuTimestampNs(device, query_pool, slot_index, timestamp_period);
+          GetGpuTimestampNs(slot_index_to_timestamp_ns, slot_index);
       if (begin_timestamp.has_value()) {
         command_buffer->begin_timestamp = begin_timestamp;
         query_slots_to_reset->push_back(slot_index);
@@ -726,29 +1144,27 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return true;
   }
 
-  [[nodiscard]] bool QueryCommandBufferTimestamps(QueueSubmission* completed_submission,
-                                                  std::vector<uint32_t>* query_slots_to_reset,
-                                                  VkDevice device, VkQueryPool query_pool,
-                                                  float timestamp_period) {
+  [[nodiscard]] static bool QueryCommandBufferTimestamps(
+      QueueSubmission* completed_submission, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_index_to_timestamp_ns) {
     for (auto& completed_submit : completed_submission->submit_infos) {
       for (auto& completed_command_buffer : completed_submit.command_buffers) {
         bool queries_succeeded = QuerySingleCommandBufferTimestamps(
-            &completed_command_buffer, query_slots_to_reset, device, query_pool, timestamp_period);
+            &completed_command_buffer, query_slots_to_reset, slot_index_to_timestamp_ns);
         if (!queries_succeeded) return false;
       }
     }
     return true;
   }
 
-  [[nodiscard]] bool QuerySingleDebugMarkerTimestamps(SubmittedMarkerSlice* marker_slice,
-                                                      std::vector<uint32_t>* query_slots_to_reset,
-                                                      VkDevice device, VkQueryPool query_pool,
-                                                      float timestamp_period) {
+  [[nodiscard]] static bool QuerySingleDebugMarkerTimestamps(
+      SubmittedMarkerSlice* marker_slice, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_index_to_timestamp_ns) {
     CHECK(marker_slice != nullptr);
 
     if (!marker_slice->end_info.timestamp.has_value()) {
-      std::optional<uint64_t> end_timestamp = QueryGpuTimestampNs(
-          device, query_pool, marker_slice->end_info.slot_index, timestamp_period);
+      std::optional<uint64_t> end_timestamp =
+          GetGpuTimestampNs(slot_index_to_timestamp_ns, marker_slice->end_info.slot_index);
       if (end_timestamp.has_value()) {
         marker_slice->end_info.timestamp = end_timestamp;
         query_slots_to_reset->push_back(marker_slice->end_info.slot_index);
@@ -762,8 +1178,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     if (!marker_slice->begin_info->timestamp.has_value()) {
-      std::optional<uint64_t> begin_timestamp = QueryGpuTimestampNs(
-          device, query_pool, marker_slice->begin_info->slot_index, timestamp_period);
+      std::optional<uint64_t> begin_timestamp =
+          GetGpuTimestampNs(slot_index_to_timestamp_ns, marker_slice->begin_info->slot_index);
       if (begin_timestamp.has_value()) {
         marker_slice->begin_info->timestamp = begin_timestamp;
         query_slots_to_reset->push_back(marker_slice->begin_info->slot_index);
@@ -774,18 +1190,51 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return true;
   }
 
-  [[nodiscard]] bool QueryDebugMarkerTimestamps(QueueSubmission* completed_submission,
-                                                std::vector<uint32_t>* query_slots_to_reset,
-                                                VkDevice device, VkQueryPool query_pool,
-                                                float timestamp_period) {
+  [[nodiscard]] static bool QueryDebugMarkerTimestamps(
+      QueueSubmission* completed_submission, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_index_to_timestamp_ns) {
     for (auto& marker_slice : completed_submission->completed_markers) {
-      bool queries_succeeded = QuerySingleDebugMarkerTimestamps(
-          &marker_slice, query_slots_to_reset, device, query_pool, timestamp_period);
+      bool queries_succeeded = QuerySingleDebugMarkerTimestamps(&marker_slice, query_slots_to_reset,
+                                                                slot_index_to_timestamp_ns);
       if (!queries_succeeded) return false;
     }
     return true;
   }
 
+  [[nodiscard]] static bool QueryDebugMarkerPipelineStatistics(
+      QueueSubmission* completed_submission, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, PipelineStatistics>& slot_index_to_pipeline_statistics) {
+    for (auto& marker_slice : completed_submission->completed_markers) {
+      if (!marker_slice.pipeline_statistics_slot_index.has_value() ||
+          marker_slice.pipeline_statistics.has_value()) {
+        continue;
+      }
+      const uint32_t slot_index = marker_slice.pipeline_statistics_slot_index.value();
+      auto pipeline_statistics_it = slot_index_to_pipeline_statistics.find(slot_index);
+      if (pipeline_statistics_it == slot_index_to_pipeline_statistics.end()) {
+        return false;
+      }
+      marker_slice.pipeline_statistics = pipeline_statistics_it->second;
+      query_slots_to_reset->push_back(slot_index);
+    }
+    return true;
+  }
+
+  static void WritePipelineStatistics(const PipelineStatistics& pipeline_statistics,
+                                      orbit_grpc_protos::GpuPipelineStatistics* target_proto) {
+    target_proto->set_input_assembly_vertices(pipeline_statistics[0]);
+    target_proto->set_input_assembly_primitives(pipeline_statistics[1]);
+    target_proto->set_vertex_shader_invocations(pipeline_statistics[2]);
+    target_proto->set_geometry_shader_invocations(pipeline_statistics[3]);
+    target_proto->set_geometry_shader_primitives(pipeline_statistics[4]);
+    target_proto->set_clipping_invocations(pipeline_statistics[5]);
+    target_proto->set_clipping_primitives(pipeline_statistics[6]);
+    target_proto->set_fragment_shader_invocations(pipeline_statistics[7]);
+    target_proto->set_tessellation_control_shader_patches(pipeline_statistics[8]);
+    target_proto->set_tessellation_evaluation_shader_invocations(pipeline_statistics[9]);
+    target_proto->set_compute_shader_invocations(pipeline_statistics[10]);
+  }
+
   [[nodiscard]] bool WriteCommandBufferTimings(
       const QueueSubmission& completed_submission,
       orbit_grpc_protos::GpuQueueSubmission* submission_proto) {
@@ -846,6 +1295,10 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       }
       marker_proto->set_depth(marker_state.depth);
       marker_proto->set_end_gpu_timestamp_ns(end_timestamp);
+      if (marker_state.pipeline_statistics.has_value()) {
+        WritePipelineStatistics(marker_state.pipeline_statistics.value(),
+                                marker_proto->mutable_pipeline_statistics());
+      }
 
       // If we haven't captured the begin marker, we'll leave the optional begin_marker empty.
       if (!marker_state.begin_info.has_value()) {
@@ -864,16 +1317,14 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return has_at_least_one_timestamp;
   }
 
-  // This method does not acquire a lock and MUST NOT be called without holding the `mutex_`.
-  void ResetCommandBufferUnsafe(VkCommandBuffer command_buffer) {
-    mutex_.AssertHeld();
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+  // This method does not acquire a lock and MUST NOT be called without holding `tracked->mutex`.
+  void ResetCommandBufferUnsafe(TrackedCommandBuffer* tracked) {
+    tracked->mutex.AssertHeld();
+    if (!tracked->state.has_value()) {
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-    CHECK(command_buffer_to_device_.contains(command_buffer));
-    VkDevice device = command_buffer_to_device_.at(command_buffer);
+    const CommandBufferState& state = tracked->state.value();
+    VkDevice device = tracked->device;
     std::vector<uint32_t> query_slots_to_reset{};
     if (state.command_buffer_begin_slot_index.has_value()) {
       query_slots_to_reset.push_back(state.command_buffer_begin_slot_index.value());
@@ -881,52 +1332,149 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     if (state.command_buffer_end_slot_index.has_value()) {
       query_slots_to_reset.push_back(state.command_buffer_end_slot_index.value());
     }
+    std::vector<uint32_t> pipeline_statistics_query_slots_to_reset{};
     for (const Marker& marker : state.markers) {
+      if (marker.is_owned_by_secondary_command_buffer) continue;
       if (marker.slot_index.has_value()) {
         query_slots_to_reset.push_back(marker.slot_index.value());
       }
+      if (marker.pipeline_statistics_slot_index.has_value()) {
+        pipeline_statistics_query_slots_to_reset.push_back(
+            marker.pipeline_statistics_slot_index.value());
+      }
+    }
+    // The slots of a secondary command buffer that were lent to a primary command buffer that was
+    // never submitted are written by the GPU when the secondary command buffer gets executed
+    // through another primary command buffer, but they are never read.
+    if (state.pre_submission_cpu_timestamp.has_value() && state.has_lent_slots &&
+        !state.lent_slots_were_submitted) {
+      timer_query_pool_->MarkQuerySlotsDoneReading(device, query_slots_to_reset);
+      if (!pipeline_statistics_query_slots_to_reset.empty()) {
+        pipeline_statistics_query_pool_->MarkQuerySlotsDoneReading(
+            device, pipeline_statistics_query_slots_to_reset);
+      }
     }
     if (state.pre_submission_cpu_timestamp.has_value()) {
       timer_query_pool_->MarkQuerySlotsForReset(device, query_slots_to_reset);
     } else {
       timer_query_pool_->RollbackPendingQuerySlots(device, query_slots_to_reset);
     }
+    if (!pipeline_statistics_query_slots_to_reset.empty()) {
+      if (state.pre_submission_cpu_timestamp.has_value()) {
+        pipeline_statistics_query_pool_->MarkQuerySlotsForReset(
+            device, pipeline_statistics_query_slots_to_reset);
+      } else {
+        pipeline_statistics_query_pool_->RollbackPendingQuerySlots(
+            device, pipeline_statistics_query_slots_to_reset);
+      }
+    }
 
-    command_buffer_to_state_.erase(command_buffer);
+    tracked->state.reset();
+  }
+
+  // Collects the slots baked into the command buffer, including the ones of the markers executed
+  // from secondary command buffers.
+  static void CollectBakedSlots(const CommandBufferState& state,
+                                std::vector<uint32_t>* slot_indices,
+                                std::vector<uint32_t>* pipeline_statistics_slot_indices) {
+    if (state.command_buffer_begin_slot_index.has_value()) {
+      slot_indices->push_back(state.command_buffer_begin_slot_index.value());
+    }
+    if (state.command_buffer_end_slot_index.has_value()) {
+      slot_indices->push_back(state.command_buffer_end_slot_index.value());
+    }
+    for (const Marker& marker : state.markers) {
+      if (marker.slot_index.has_value()) {
+        slot_indices->push_back(marker.slot_index.value());
+      }
+      if (marker.pipeline_statistics_slot_index.has_value()) {
+        pipeline_statistics_slot_indices->push_back(marker.pipeline_statistics_slot_index.value());
+      }
+    }
   }
 
-  void PersistSingleCommandBufferOnSubmit(VkDevice device, VkCommandBuffer command_buffer,
+  // A command buffer that gets submitted again without being reset still has the slots of its
+  // previous execution baked into it. If all of them were read already (which is always the case
+  // once the previous execution has finished, unless the command buffer is used with
+  // `VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE` or its timestamps were not processed yet), the
+  // slots are reset and handed to the new execution. Otherwise, the results of the executions
+  // could not be told apart, and the new execution does not get any timestamps.
+  [[nodiscard]] bool ReuseSlotsOfPreviousExecution(TrackedCommandBuffer* tracked) {
+    tracked->mutex.AssertHeld();
+    VkDevice device = tracked->device;
+    std::vector<uint32_t> slot_indices;
+    std::vector<uint32_t> pipeline_statistics_slot_indices;
+    CollectBakedSlots(tracked->state.value(), &slot_indices, &pipeline_statistics_slot_indices);
+    // Once done reading, the slots can only change their state again through this command buffer,
+    // whose mutex we are holding.
+    if (!slot_indices.empty() &&
+        !timer_query_pool_->AreQuerySlotsDoneReading(device, slot_indices)) {
+      return false;
+    }
+    if (!pipeline_statistics_slot_indices.empty() &&
+        !pipeline_statistics_query_pool_->AreQuerySlotsDoneReading(
+            device, pipeline_statistics_slot_indices)) {
+      return false;
+    }
+    if (!slot_indices.empty()) {
+      timer_query_pool_->ReuseQuerySlotsDoneReading(device, slot_indices);
+    }
+    if (!pipeline_statistics_slot_indices.empty()) {
+      pipeline_statistics_query_pool_->ReuseQuerySlotsDoneReading(
+          device, pipeline_statistics_slot_indices);
+    }
+    return true;
+  }
+
+  void PersistSingleCommandBufferOnSubmit(VkDevice* device, TrackedCommandBuffer* tracked,
                                           QueueSubmission* queue_submission,
                                           SubmitInfo* submitted_submit_info,
                                           std::vector<uint32_t>* query_slots_not_needed_to_read) {
-    mutex_.AssertHeld();
+    tracked->mutex.AssertHeld();
+    CHECK(device != nullptr);
     CHECK(queue_submission != nullptr);
     CHECK(submitted_submit_info != nullptr);
     CHECK(query_slots_not_needed_to_read != nullptr);
 
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    if (!tracked->state.has_value()) {
       ERROR_ONCE(
           "Calling vkQueueSubmit on a command buffer that is in the initial state (i.e. "
           "either freshly allocated or reset with vkResetCommandBuffer).");
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-    bool has_been_submitted_before = state.pre_submission_cpu_timestamp.has_value();
+    CommandBufferState& state = tracked->state.value();
+
+    // If this command buffer was already submitted before (without reset afterwards), its slots
+    // are only unique to this submission if they can be reused, see
+    // `ReuseSlotsOfPreviousExecution`. If they can't, we don't read any slot for this submission.
+    // Note, that the slots will eventually be reset on a "vkResetCommandBuffer" call.
+    if (state.pre_submission_cpu_timestamp.has_value() && !ReuseSlotsOfPreviousExecution(tracked)) {
+      return;
+    }
 
-    // Mark that this command buffer in the current state was already submitted. If the command
-    // buffer is being submitted again, without a "vkResetCommandBuffer" call, the same slot
-    // indices will be used again, so that we can not distinguish the results for the different
-    // submissions anymore. Thus, this field will be used to ensure to not try to read such a
-    // slot. Calling "vkResetCommandBuffer" (or "vkBeginCommandBuffer"), will reset this field.
+    // Mark that this command buffer in the current state was submitted, and that the slots of this
+    // submission are the ones to read. The debug markers are matched to the submission with this
+    // timestamp. Calling "vkResetCommandBuffer" (or "vkBeginCommandBuffer"), will reset this field.
     // Note that we are using an std::optional with the submission time to protect us against an
     // "OnCaptureFinished" call, right between pre and post submission, which would try to reset
     // the slots.
     state.pre_submission_cpu_timestamp =
         queue_submission->meta_information.pre_submission_cpu_timestamp;
+    // The slots of the secondary command buffers became baked into a submission as well.
+    for (const ExecutedSecondaryCommandBuffer& executed_secondary :
+         state.executed_secondary_command_buffers) {
+      absl::MutexLock secondary_lock(&executed_secondary.tracked->mutex);
+      if (!executed_secondary.tracked->state.has_value()) continue;
+      CommandBufferState& secondary_state = executed_secondary.tracked->state.value();
+      secondary_state.pre_submission_cpu_timestamp =
+          queue_submission->meta_information.pre_submission_cpu_timestamp;
+      if (executed_secondary.carries_slots) {
+        secondary_state.lent_slots_were_submitted = true;
+      }
+    }
 
-    if (device == VK_NULL_HANDLE) {
-      device = command_buffer_to_device_.at(command_buffer);
+    if (*device == VK_NULL_HANDLE) {
+      *device = tracked->device;
     }
 
     // If we haven't recorded neither the end nor the begin of a command buffer, we have no
@@ -934,41 +1482,37 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     if (!state.command_buffer_end_slot_index.has_value()) {
       if (state.command_buffer_begin_slot_index.has_value()) {
         // We need to discard the begin slot when we only have a begin slot. This can happen
-        // if we run out of query slots.
+        // if we run out of query slots. The slot stays baked into the command buffer, so it is
+        // kept in the state to be reset together with the command buffer.
         query_slots_not_needed_to_read->push_back(state.command_buffer_begin_slot_index.value());
-        state.command_buffer_begin_slot_index.reset();
       }
       return;
     }
 
-    // If this command buffer was already submitted before (without reset afterwards), its slot
-    // indices are not unique anymore and can't be used by us. Note, that the slots will be
-    // marked as "done with reading" when the first submission of this command buffer is done
-    // and will eventually be reset on a "vkResetCommandBuffer" call.
-    if (!has_been_submitted_before) {
-      SubmittedCommandBuffer submitted_command_buffer{
-          .command_buffer_begin_slot_index = state.command_buffer_begin_slot_index,
-          .command_buffer_end_slot_index = state.command_buffer_end_slot_index.value()};
-      submitted_submit_info->command_buffers.emplace_back(submitted_command_buffer);
-    }
+    SubmittedCommandBuffer submitted_command_buffer{
+        .command_buffer_begin_slot_index = state.command_buffer_begin_slot_index,
+        .command_buffer_end_slot_index = state.command_buffer_end_slot_index.value()};
+    submitted_submit_info->command_buffers.emplace_back(submitted_command_buffer);
   }
 
   void PersistDebugMarkersOfASingleCommandBufferOnSubmit(
-      VkCommandBuffer command_buffer, std::optional<QueueSubmission>* queue_submission_optional,
-      QueueMarkerState* markers, std::vector<uint32_t>* marker_slots_not_needed_to_read) {
-    mutex_.AssertHeld();
+      TrackedCommandBuffer* tracked, std::optional<QueueSubmission>* queue_submission_optional,
+      QueueMarkerState* markers, std::vector<uint32_t>* marker_slots_not_needed_to_read,
+      std::vector<uint32_t>* pipeline_statistics_slots_not_needed_to_read) {
+    submissions_mutex_.AssertHeld();
+    tracked->mutex.AssertHeld();
     CHECK(queue_submission_optional != nullptr);
     CHECK(markers != nullptr);
     CHECK(marker_slots_not_needed_to_read != nullptr);
+    CHECK(pipeline_statistics_slots_not_needed_to_read != nullptr);
 
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    if (!tracked->state.has_value()) {
       ERROR_ONCE(
           "Calling vkQueueSubmit on a command buffer that is in the initial state (i.e. "
           "either freshly allocated or reset with vkResetCommandBuffer).");
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    const CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    const CommandBufferState& state = tracked->state.value();
 
     for (const Marker& marker : state.markers) {
       std::optional<SubmittedMarker> submitted_marker = std::nullopt;
@@ -983,16 +1527,22 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
       switch (marker.type) {
         case MarkerType::kDebugMarkerBegin: {
-          if (queue_submission_optional->has_value() && marker.slot_index.has_value()) {
+          if (submitted_marker.has_value()) {
             ++queue_submission_optional->value().num_begin_markers;
           }
           CHECK(marker.label_name.has_value());
           CHECK(marker.color.has_value());
+          // Like for the timestamp, the slot of the pipeline statistics query is only read for the
+          // submissions that get the slots of the command buffer.
           MarkerState marker_state{.begin_info = submitted_marker,
                                    .label_name = marker.label_name.value(),
                                    .color = marker.color.value(),
                                    .depth = markers->marker_stack.size(),
-                                   .depth_exceeds_maximum = marker.cut_off};
+                                   .depth_exceeds_maximum = marker.cut_off,
+                                   .pipeline_statistics_slot_index =
+                                       submitted_marker.has_value()
+                                           ? marker.pipeline_statistics_slot_index
+                                           : std::nullopt};
           markers->marker_stack.push(std::move(marker_state));
           break;
         }
@@ -1001,29 +1551,45 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
           MarkerState marker_state = markers->marker_stack.top();
           markers->marker_stack.pop();
 
-          // If there is a begin marker slot from a previous submission, this is our chance to
-          // state that we will not read the slot anymore. We can reset is as soon as the
-          // command buffer itself gets reset.
-          if (marker_state.begin_info.has_value() && !queue_submission_optional->has_value()) {
+          const bool is_marker_slice_completed =
+              submitted_marker.has_value() && !marker_state.depth_exceeds_maximum;
+
+          // If there is a begin marker slot from a previous submission, but the end marker is not
+          // read in this submission, this is our chance to state that we will not read the slot
+          // anymore. We can reset is as soon as the command buffer itself gets reset.
+          if (marker_state.begin_info.has_value() && !is_marker_slice_completed) {
             marker_slots_not_needed_to_read->push_back(marker_state.begin_info->slot_index);
           }
 
           // If the begin marker was discarded for exceeding the maximum depth, but the end
           // marker was not (as it is in a different submission), we will not read the slot in
           // "CompleteSubmits". We can reset is as soon as the command buffer itself gets reset.
-          if (marker_state.depth_exceeds_maximum && marker.slot_index.has_value()) {
+          if (marker_state.depth_exceeds_maximum && submitted_marker.has_value()) {
             marker_slots_not_needed_to_read->push_back(marker.slot_index.value());
           }
 
-          if (queue_submission_optional->has_value() && marker.slot_index.has_value() &&
-              !marker_state.depth_exceeds_maximum) {
+          // The pipeline statistics are only read if the query was ended by this "end" marker
+          // (and not by the end of the command buffer).
+          std::optional<uint32_t> pipeline_statistics_slot_index = std::nullopt;
+          if (marker_state.pipeline_statistics_slot_index.has_value()) {
+            if (is_marker_slice_completed && marker.ends_pipeline_statistics_query) {
+              pipeline_statistics_slot_index = marker_state.pipeline_statistics_slot_index;
+            } else {
+              pipeline_statistics_slots_not_needed_to_read->push_back(
+                  marker_state.pipeline_statistics_slot_index.value());
+            }
+          }
+
+          if (is_marker_slice_completed) {
             CHECK(submitted_marker.has_value());
             queue_submission_optional->value().completed_markers.emplace_back(
                 SubmittedMarkerSlice{.begin_info = marker_state.begin_info,
                                      .end_info = submitted_marker.value(),
                                      .label_name = std::move(marker_state.label_name),
                                      .color = marker_state.color,
-                                     .depth = marker_state.depth});
+                                     .depth = marker_state.depth,
+                                     .pipeline_statistics_slot_index =
+                                         pipeline_statistics_slot_index});
           }
 
           break;
@@ -1032,11 +1598,17 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
   }
 
-  absl::Mutex mutex_;
-  absl::flat_hash_map<VkCommandPool, absl::flat_hash_set<VkCommandBuffer>> pool_to_command_buffers_;
-  absl::flat_hash_map<VkCommandBuffer, VkDevice> command_buffer_to_device_;
+  // Only taken for writing when command buffers are allocated or freed. Must be taken after
+  // `submissions_mutex_` and before the mutex of any `TrackedCommandBuffer`.
+  absl::Mutex command_buffers_mutex_;
+  absl::flat_hash_map<VkCommandPool, absl::flat_hash_set<VkCommandBuffer>> pool_to_command_buffers_
+      ABSL_GUARDED_BY(command_buffers_mutex_);
+  // The `TrackedCommandBuffer`s are heap allocated, such that they don't move on a rehash while
+  // they are used without holding `command_buffers_mutex_`.
+  absl::flat_hash_map<VkCommandBuffer, std::unique_ptr<TrackedCommandBuffer>> command_buffers_
+      ABSL_GUARDED_BY(command_buffers_mutex_);
 
-  absl::flat_hash_map<VkCommandBuffer, CommandBufferState> command_buffer_to_state_;
+  absl::Mutex submissions_mutex_;
 
   static constexpr auto kPreSubmissionCpuTimestampComparator =
       [](const QueueSubmission& lhs, const QueueSubmission& rhs) -> bool {
@@ -1046,26 +1618,41 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   absl::flat_hash_map<VkQueue,
                       std::priority_queue<QueueSubmission, std::vector<QueueSubmission>,
                                           std::function<bool(QueueSubmission, QueueSubmission)>>>
-      queue_to_submission_priority_queue_;
+      queue_to_submission_priority_queue_ ABSL_GUARDED_BY(submissions_mutex_);
 
-  absl::flat_hash_map<VkQueue, QueueMarkerState> queue_to_markers_;
+  absl::flat_hash_map<VkQueue, QueueMarkerState> queue_to_markers_
+      ABSL_GUARDED_BY(submissions_mutex_);
+
+  static constexpr uint64_t kGpuClockCalibrationIntervalNs = 1'000'000'000;
+  absl::flat_hash_map<VkDevice, uint64_t> device_to_last_gpu_clock_calibration_ns_
+      ABSL_GUARDED_BY(submissions_mutex_);
+  absl::flat_hash_set<VkDevice> devices_failing_gpu_clock_calibration_
+      ABSL_GUARDED_BY(submissions_mutex_);
 
   DispatchTable* dispatch_table_;
   TimerQueryPool* timer_query_pool_;
+  // Might be nullptr, in which case no pipeline statistics are collected.
+  TimerQueryPool* pipeline_statistics_query_pool_;
   DeviceManager* device_manager_;
 
   // We use std::numeric_limits<uint32_t>::max() to disable filtering of markers and 0 to discard
   // all debug markers.
-  uint32_t max_local_marker_depth_per_command_buffer_ = std::numeric_limits<uint32_t>::max();
+  std::atomic<uint32_t> max_local_marker_depth_per_command_buffer_ =
+      std::numeric_limits<uint32_t>::max();
   VulkanLayerProducer* vulkan_layer_producer_ = nullptr;
 
+  // Set from the capture options in OnCaptureStart.
+  std::atomic<bool> collect_pipeline_statistics_ = false;
+
   // This boolean is precisely true between a call to OnCaptureStart and OnCaptureFinished. In
   // particular, OnCaptureFinished changes command buffer state and resets query slots, and we
   // must ensure state remains consistent with respect to calls to marking begins and ends of
   // command buffers and debug markers. A consistent state allows proper cleanup of query slots
   // either in OnCaptureFinished or when completing submits. Note that calling
   // vulkan_layer_producer_->IsCapturing() is not a correct replacement for checking this boolean.
-  bool is_capturing_ = false;
+  // It is only read while holding the mutex of the command buffer concerned, and only cleared
+  // before OnCaptureFinished resets the slots of all command buffers.
+  std::atomic<bool> is_capturing_ = false;
 };
 
 }  // namespace orbit_vulkan_layer
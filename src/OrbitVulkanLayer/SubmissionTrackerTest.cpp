@@ -7,11 +7,14 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <optional>
+#include <thread>
 
 #include "OrbitBase/ThreadUtils.h"
 #include "SubmissionTracker.h"
 #include "VulkanLayerProducer.h"
 
+using ::testing::DoAll;
 using ::testing::ElementsAre;
 using ::testing::Invoke;
 using ::testing::Return;
@@ -24,6 +27,10 @@ class MockDispatchTable {
  public:
   MOCK_METHOD(PFN_vkGetQueryPoolResults, GetQueryPoolResults, (VkDevice), ());
   MOCK_METHOD(PFN_vkCmdWriteTimestamp, CmdWriteTimestamp, (VkCommandBuffer), ());
+  MOCK_METHOD(bool, IsCalibratedTimestampsExtensionSupported, (VkDevice), ());
+  MOCK_METHOD(PFN_vkGetCalibratedTimestampsEXT, GetCalibratedTimestampsEXT, (VkDevice), ());
+  MOCK_METHOD(PFN_vkCmdBeginQuery, CmdBeginQuery, (VkCommandBuffer), ());
+  MOCK_METHOD(PFN_vkCmdEndQuery, CmdEndQuery, (VkCommandBuffer), ());
 };
 
 PFN_vkCmdWriteTimestamp dummy_write_timestamp_function =
@@ -32,9 +39,12 @@ PFN_vkCmdWriteTimestamp dummy_write_timestamp_function =
 
 class MockTimerQueryPool {
  public:
+  MOCK_METHOD(bool, IsInitialized, (VkDevice), ());
   MOCK_METHOD(VkQueryPool, GetQueryPool, (VkDevice), ());
   MOCK_METHOD(void, MarkQuerySlotsForReset, (VkDevice, const std::vector<uint32_t>&), ());
   MOCK_METHOD(void, MarkQuerySlotsDoneReading, (VkDevice, const std::vector<uint32_t>&), ());
+  MOCK_METHOD(bool, AreQuerySlotsDoneReading, (VkDevice, const std::vector<uint32_t>&), ());
+  MOCK_METHOD(void, ReuseQuerySlotsDoneReading, (VkDevice, const std::vector<uint32_t>&), ());
   MOCK_METHOD(void, RollbackPendingQuerySlots, (VkDevice, const std::vector<uint32_t>&), ());
   MOCK_METHOD(bool, NextReadyQuerySlot, (VkDevice, uint32_t*), ());
   MOCK_METHOD(void, PrintStats, (), ());
@@ -59,12 +69,14 @@ class MockVulkanLayerProducer : public VulkanLayerProducer {
   MOCK_METHOD(void, SetCaptureStatusListener, (CaptureStatusListener*), (override));
 
   void StartCapture(
-      uint64_t max_local_marker_depth_per_command_buffer = std::numeric_limits<uint64_t>::max()) {
+      uint64_t max_local_marker_depth_per_command_buffer = std::numeric_limits<uint64_t>::max(),
+      bool collect_gpu_pipeline_statistics = false) {
     is_capturing_ = true;
     ASSERT_NE(listener_, nullptr);
     orbit_grpc_protos::CaptureOptions capture_options{};
     capture_options.set_max_local_marker_depth_per_command_buffer(
         max_local_marker_depth_per_command_buffer);
+    capture_options.set_collect_gpu_pipeline_statistics(collect_gpu_pipeline_statistics);
     listener_->OnCaptureStart(capture_options);
   }
 
@@ -113,6 +125,8 @@ class SubmissionTrackerTest : public ::testing::Test {
 
     EXPECT_CALL(dispatch_table_, CmdWriteTimestamp)
         .WillRepeatedly(Return(dummy_write_timestamp_function));
+    EXPECT_CALL(dispatch_table_, IsCalibratedTimestampsExtensionSupported)
+        .WillRepeatedly(Return(false));
   }
 
   void TearDown() override {
@@ -123,12 +137,13 @@ class SubmissionTrackerTest : public ::testing::Test {
 
   MockDispatchTable dispatch_table_;
   MockTimerQueryPool timer_query_pool_;
+  MockTimerQueryPool pipeline_statistics_query_pool_;
   MockDeviceManager device_manager_;
   std::unique_ptr<MockVulkanLayerProducer> producer_;
   SubmissionTracker<MockDispatchTable, MockDeviceManager, MockTimerQueryPool> tracker_ =
       SubmissionTracker<MockDispatchTable, MockDeviceManager, MockTimerQueryPool>(
           &dispatch_table_, &timer_query_pool_, &device_manager_,
-          std::numeric_limits<uint32_t>::max());
+          std::numeric_limits<uint32_t>::max(), &pipeline_statistics_query_pool_);
 
   VkDevice device_ = {};
   VkCommandPool command_pool_ = {};
@@ -193,40 +208,69 @@ class SubmissionTrackerTest : public ::testing::Test {
   static constexpr uint64_t kTimestamp6 = 16;
   static constexpr uint64_t kTimestamp7 = 17;
 
+  // Writes the timestamps kTimestamp1 to kTimestamp7 for the slots kSlotIndex1 to kSlotIndex7,
+  // each followed by its availability.
+  static VkResult MockGetQueryPoolResults(uint32_t first_query, uint32_t query_count, void* data,
+                                          VkDeviceSize stride, VkQueryResultFlags flags,
+                                          std::optional<uint32_t> unavailable_slot_index) {
+    EXPECT_NE((flags & VK_QUERY_RESULT_64_BIT), 0);
+    EXPECT_NE((flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT), 0);
+    EXPECT_EQ(stride, 2 * sizeof(uint64_t));
+    auto* results = absl::bit_cast<uint64_t*>(data);
+    VkResult result = VK_SUCCESS;
+    for (uint32_t i = 0; i < query_count; ++i) {
+      uint32_t slot_index = first_query + i;
+      CHECK(slot_index >= kSlotIndex1 && slot_index <= kSlotIndex7);
+      if (slot_index == unavailable_slot_index) {
+        results[2 * i + 1] = 0;
+        result = VK_NOT_READY;
+        continue;
+      }
+      results[2 * i] = kTimestamp1 + (slot_index - kSlotIndex1);
+      results[2 * i + 1] = 1;
+    }
+    return result;
+  }
+
   const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_all_ready_ =
       +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
-          uint32_t query_count, size_t /*dataSize*/, void* data, VkDeviceSize /*stride*/,
+          uint32_t query_count, size_t /*dataSize*/, void* data, VkDeviceSize stride,
           VkQueryResultFlags flags) -> VkResult {
-    EXPECT_EQ(query_count, 1);
-    EXPECT_NE((flags & VK_QUERY_RESULT_64_BIT), 0);
-    switch (first_query) {
-      case kSlotIndex1:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp1;
-        break;
-      case kSlotIndex2:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp2;
-        break;
-      case kSlotIndex3:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp3;
-        break;
-      case kSlotIndex4:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp4;
-        break;
-      case kSlotIndex5:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp5;
-        break;
-      case kSlotIndex6:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp6;
-        break;
-      case kSlotIndex7:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp7;
-        break;
-      default:
-        UNREACHABLE();
+    return MockGetQueryPoolResults(first_query, query_count, data, stride, flags, std::nullopt);
+  };
+
+  static constexpr size_t kNumPipelineStatistics =
+      SubmissionTracker<MockDispatchTable, MockDeviceManager,
+                        MockTimerQueryPool>::kNumPipelineStatistics;
+
+  // Writes the value `100 * slot_index + i` for the i-th pipeline statistic of each query.
+  // Timestamp queries (with their smaller stride) are answered by `MockGetQueryPoolResults`.
+  const PFN_vkGetQueryPoolResults
+      mock_get_query_pool_results_function_with_pipeline_statistics_all_ready_ =
+          +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
+              uint32_t query_count, size_t /*dataSize*/, void* data, VkDeviceSize stride,
+              VkQueryResultFlags flags) -> VkResult {
+    if (stride != (kNumPipelineStatistics + 1) * sizeof(uint64_t)) {
+      return MockGetQueryPoolResults(first_query, query_count, data, stride, flags, std::nullopt);
+    }
+    auto* results = absl::bit_cast<uint64_t*>(data);
+    for (uint32_t i = 0; i < query_count; ++i) {
+      uint64_t* result = results + (kNumPipelineStatistics + 1) * i;
+      for (size_t statistic = 0; statistic < kNumPipelineStatistics; ++statistic) {
+        result[statistic] = 100 * (first_query + i) + statistic;
+      }
+      result[kNumPipelineStatistics] = 1;
     }
     return VK_SUCCESS;
   };
 
+  const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_slot_3_not_ready_ =
+      +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
+          uint32_t query_count, size_t /*dataSize*/, void* data, VkDeviceSize stride,
+          VkQueryResultFlags flags) -> VkResult {
+    return MockGetQueryPoolResults(first_query, query_count, data, stride, flags, kSlotIndex3);
+  };
+
   const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_not_ready_ =
       +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t /*first_query*/,
           uint32_t /*query_count*/, size_t /*dataSize*/, void* /*data*/, VkDeviceSize /*stride*/,
@@ -577,13 +621,11 @@ TEST_F(SubmissionTrackerTest, WillRetryCompletingSubmissionsWhenTimestampQueryFa
   // second attempt.
 
   ExpectFourNextReadyQuerySlotCalls();
+  // All slots are consecutive and are read with a single call. The first read completes the first
+  // submission, but the "begin" timestamp of the second submission is not available, so that we
+  // retry on the second call.
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
-      // The first two calls should succeed to complete the first submission.
-      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_))
-      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_))
-      // Fail on the second submission so that we retry on the second call.
-      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_))
-      .WillOnce(Return(mock_get_query_pool_results_function_not_ready_))
+      .WillOnce(Return(mock_get_query_pool_results_function_slot_3_not_ready_))
       .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
 
   std::vector<uint32_t> actual_slots_done_reading1;
@@ -649,9 +691,8 @@ TEST_F(SubmissionTrackerTest, WillRetryCompletingSubmissionsWhenTimestampQueryFa
 
   EXPECT_THAT(actual_slots_done_reading1,
               UnorderedElementsAre(kSlotIndex1, kSlotIndex2, kSlotIndex4));
-  // We failed on the 4th GetQuerySlots call above, which belongs to the "begin" timestamp of the
-  // second command buffer (note that the order of calls when querying for timestamps is to query
-  // for the end timestamp first). Therefore, this must be kSlotIndex3.
+  // The "end" timestamp of the second command buffer (kSlotIndex4) was already read on the first
+  // call, so only the "begin" timestamp (kSlotIndex3) remains to be read on the second one.
   EXPECT_THAT(actual_slots_done_reading2, UnorderedElementsAre(kSlotIndex3));
 
   ExpectSingleCommandBufferSubmissionEq(actual_capture_events[0], pre_submit_times[0],
@@ -660,6 +701,96 @@ TEST_F(SubmissionTrackerTest, WillRetryCompletingSubmissionsWhenTimestampQueryFa
                                         post_submit_times[1], tid, pid, kTimestamp3, kTimestamp4);
 }
 
+TEST_F(SubmissionTrackerTest, ReadsTimestampsOfAllPendingSubmissionsWithASingleCall) {
+  ExpectFourNextReadyQuerySlotCalls();
+  // The four slots are consecutive, so one call is enough to read the timestamps of both
+  // submissions.
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .Times(1)
+      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_));
+  std::vector<uint32_t> actual_slots_done_reading;
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading)
+      .Times(1)
+      .WillOnce(SaveArg<1>(&actual_slots_done_reading));
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent).Times(2).WillRepeatedly(Return(true));
+
+  producer_->StartCapture();
+  std::array<VkCommandBuffer, 2> command_buffers{absl::bit_cast<VkCommandBuffer>(1L),
+                                                 absl::bit_cast<VkCommandBuffer>(2L)};
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffers[0], 2);
+  for (VkCommandBuffer& command_buffer : command_buffers) {
+    tracker_.MarkCommandBufferBegin(command_buffer);
+    tracker_.MarkCommandBufferEnd(command_buffer);
+    VkSubmitInfo submit_info{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .pNext = nullptr,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &command_buffer};
+    std::optional<QueueSubmission> queue_submission_optional =
+        tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info);
+    tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info, queue_submission_optional);
+  }
+  tracker_.CompleteSubmits(device_);
+
+  EXPECT_THAT(actual_slots_done_reading,
+              UnorderedElementsAre(kSlotIndex1, kSlotIndex2, kSlotIndex3, kSlotIndex4));
+}
+
+TEST_F(SubmissionTrackerTest, WillSendGpuClockCalibrationWhenCalibratedTimestampsAreSupported) {
+  ExpectTwoNextReadyQuerySlotCalls();
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading).Times(1);
+  EXPECT_CALL(dispatch_table_, IsCalibratedTimestampsExtensionSupported)
+      .WillRepeatedly(Return(true));
+  static constexpr uint64_t kGpuTimestamp = 1000;
+  static constexpr uint64_t kCpuTimestamp = 2000;
+  static constexpr uint64_t kMaxDeviation = 3;
+  PFN_vkGetCalibratedTimestampsEXT mock_get_calibrated_timestamps_function =
+      +[](VkDevice /*device*/, uint32_t timestamp_count,
+          const VkCalibratedTimestampInfoEXT* timestamp_infos, uint64_t* timestamps,
+          uint64_t* max_deviation) -> VkResult {
+    EXPECT_EQ(timestamp_count, 2);
+    EXPECT_EQ(timestamp_infos[0].timeDomain, VK_TIME_DOMAIN_DEVICE_EXT);
+    EXPECT_EQ(timestamp_infos[1].timeDomain, VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT);
+    timestamps[0] = kGpuTimestamp;
+    timestamps[1] = kCpuTimestamp;
+    *max_deviation = kMaxDeviation;
+    return VK_SUCCESS;
+  };
+  // The calibration is only repeated after a while, so the second present won't calibrate again.
+  EXPECT_CALL(dispatch_table_, GetCalibratedTimestampsEXT)
+      .Times(1)
+      .WillOnce(Return(mock_get_calibrated_timestamps_function));
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> actual_capture_events;
+  auto mock_enqueue_capture_event =
+      [&actual_capture_events](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+        actual_capture_events.push_back(std::move(capture_event));
+        return true;
+      };
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent)
+      .Times(2)
+      .WillRepeatedly(Invoke(mock_enqueue_capture_event));
+
+  producer_->StartCapture();
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  std::optional<QueueSubmission> queue_submission_optional =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+  tracker_.CompleteSubmits(device_);
+  tracker_.CompleteSubmits(device_);
+
+  ASSERT_EQ(actual_capture_events.size(), 2);
+  ASSERT_TRUE(actual_capture_events[0].has_gpu_clock_calibration());
+  const orbit_grpc_protos::GpuClockCalibration& actual_calibration =
+      actual_capture_events[0].gpu_clock_calibration();
+  EXPECT_EQ(actual_calibration.gpu_timestamp_ns(), kGpuTimestamp);
+  EXPECT_EQ(actual_calibration.cpu_timestamp_ns(), kCpuTimestamp);
+  EXPECT_EQ(actual_calibration.max_deviation_ns(), kMaxDeviation);
+  EXPECT_TRUE(actual_capture_events[1].has_gpu_queue_submission());
+}
+
 TEST_F(SubmissionTrackerTest, StopCaptureBeforeSubmissionWillResetTheSlots) {
   ExpectTwoNextReadyQuerySlotCalls();
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults).Times(0);
@@ -893,41 +1024,73 @@ TEST_F(SubmissionTrackerTest, WillResetProperlyWhenStartStopAndStartACaptureWith
   EXPECT_THAT(actual_slots_done_reading, UnorderedElementsAre(kSlotIndex1));
 }
 
-TEST_F(SubmissionTrackerTest, ReusingCommandBufferWithoutResetInvalidatesSlot) {
+TEST_F(SubmissionTrackerTest, ResubmittingCommandBufferWithoutResetReusesReadSlots) {
   ExpectTwoNextReadyQuerySlotCalls();
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
       .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
   std::vector<uint32_t> actual_slots_marked_done_reading;
   EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading)
+      .Times(2)
+      .WillRepeatedly(SaveArg<1>(&actual_slots_marked_done_reading));
+  std::vector<uint32_t> actual_slots_checked_done_reading;
+  EXPECT_CALL(timer_query_pool_, AreQuerySlotsDoneReading)
       .Times(1)
-      .WillOnce(SaveArg<1>(&actual_slots_marked_done_reading));
-  orbit_grpc_protos::ProducerCaptureEvent actual_capture_event;
+      .WillOnce(DoAll(SaveArg<1>(&actual_slots_checked_done_reading), Return(true)));
+  std::vector<uint32_t> actual_slots_reused;
+  EXPECT_CALL(timer_query_pool_, ReuseQuerySlotsDoneReading)
+      .Times(1)
+      .WillOnce(SaveArg<1>(&actual_slots_reused));
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> actual_capture_events;
   auto mock_enqueue_capture_event =
-      [&actual_capture_event](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
-        actual_capture_event = std::move(capture_event);
+      [&actual_capture_events](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+        actual_capture_events.emplace_back(std::move(capture_event));
         return true;
       };
   EXPECT_CALL(*producer_, EnqueueCaptureEvent)
-      .Times(1)
-      .WillOnce(Invoke(mock_enqueue_capture_event));
+      .Times(2)
+      .WillRepeatedly(Invoke(mock_enqueue_capture_event));
   producer_->StartCapture();
   tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
   tracker_.MarkCommandBufferBegin(command_buffer_);
   tracker_.MarkCommandBufferEnd(command_buffer_);
   pid_t tid = orbit_base::GetCurrentThreadId();
   pid_t pid = orbit_base::GetCurrentProcessId();
-  uint64_t pre_submit_time = orbit_base::CaptureTimestampNs();
+  std::array<uint64_t, 2> pre_submit_times{};
+  std::array<uint64_t, 2> post_submit_times{};
+  for (size_t i = 0; i < 2; ++i) {
+    pre_submit_times[i] = orbit_base::CaptureTimestampNs();
+    std::optional<QueueSubmission> queue_submission_optional =
+        tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+    tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+    post_submit_times[i] = orbit_base::CaptureTimestampNs();
+    tracker_.CompleteSubmits(device_);
+    EXPECT_THAT(actual_slots_marked_done_reading, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
+  }
+
+  EXPECT_THAT(actual_slots_checked_done_reading, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
+  EXPECT_THAT(actual_slots_reused, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
+  ASSERT_EQ(actual_capture_events.size(), 2);
+  ExpectSingleCommandBufferSubmissionEq(actual_capture_events[0], pre_submit_times[0],
+                                        post_submit_times[0], tid, pid, kTimestamp1, kTimestamp2);
+  ExpectSingleCommandBufferSubmissionEq(actual_capture_events[1], pre_submit_times[1],
+                                        post_submit_times[1], tid, pid, kTimestamp1, kTimestamp2);
+}
+
+TEST_F(SubmissionTrackerTest, ResubmittingCommandBufferWithoutResetWontReuseUnreadSlots) {
+  ExpectTwoNextReadyQuerySlotCalls();
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading).Times(1);
+  EXPECT_CALL(timer_query_pool_, AreQuerySlotsDoneReading).Times(1).WillOnce(Return(false));
+  EXPECT_CALL(timer_query_pool_, ReuseQuerySlotsDoneReading).Times(0);
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent).Times(1);
+  producer_->StartCapture();
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
   std::optional<QueueSubmission> queue_submission_optional =
       tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
   tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
-  uint64_t post_submit_time = orbit_base::CaptureTimestampNs();
-  tracker_.CompleteSubmits(device_);
-
-  ExpectSingleCommandBufferSubmissionEq(actual_capture_event, pre_submit_time, post_submit_time,
-                                        tid, pid, kTimestamp1, kTimestamp2);
-
-  EXPECT_THAT(actual_slots_marked_done_reading, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
-
   queue_submission_optional = tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
   tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
   tracker_.CompleteSubmits(device_);
@@ -1073,6 +1236,69 @@ TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerTimestampsForACompleteSubmis
                            pid);
 }
 
+TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerOfAnExecutedSecondaryCommandBuffer) {
+  ExpectFourNextReadyQuerySlotCalls();
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
+  std::vector<uint32_t> actual_slots_done_reading;
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading)
+      .Times(1)
+      .WillOnce(SaveArg<1>(&actual_slots_done_reading));
+  orbit_grpc_protos::ProducerCaptureEvent actual_capture_event;
+  auto mock_enqueue_capture_event =
+      [&actual_capture_event](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+        actual_capture_event = std::move(capture_event);
+        return true;
+      };
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent)
+      .Times(1)
+      .WillOnce(Invoke(mock_enqueue_capture_event));
+  constexpr uint64_t expected_text_key = 111;
+  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey)
+      .Times(1)
+      .WillOnce(Return(expected_text_key));
+  Color expected_color{1.f, 0.8f, 0.6f, 0.4f};
+
+  // Distinguishes the handle from the primary command buffer, which is the null handle.
+  VkCommandBuffer secondary_command_buffer = absl::bit_cast<VkCommandBuffer>(1L);
+  producer_->StartCapture();
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.TrackCommandBuffers(device_, command_pool_, &secondary_command_buffer, 1,
+                               VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  tracker_.MarkCommandBufferBegin(secondary_command_buffer);
+  tracker_.MarkDebugMarkerBegin(secondary_command_buffer, "Text", expected_color);
+  tracker_.MarkDebugMarkerEnd(secondary_command_buffer);
+  tracker_.MarkCommandBufferEnd(secondary_command_buffer);
+
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkExecuteCommands(command_buffer_, 1, &secondary_command_buffer);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  pid_t tid = orbit_base::GetCurrentThreadId();
+  pid_t pid = orbit_base::GetCurrentProcessId();
+  uint64_t pre_submit_time = orbit_base::CaptureTimestampNs();
+  std::optional<QueueSubmission> queue_submission_optional =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+  uint64_t post_submit_time = orbit_base::CaptureTimestampNs();
+  tracker_.CompleteSubmits(device_);
+
+  // The secondary command buffer doesn't write timestamps at its begin and end, so the primary one
+  // gets kSlotIndex1 and kSlotIndex4, and the debug marker kSlotIndex2 and kSlotIndex3.
+  EXPECT_THAT(actual_slots_done_reading,
+              UnorderedElementsAre(kSlotIndex1, kSlotIndex2, kSlotIndex3, kSlotIndex4));
+  ExpectSingleCommandBufferSubmissionEq(actual_capture_event, pre_submit_time, post_submit_time,
+                                        tid, pid, kTimestamp1, kTimestamp4);
+  const orbit_grpc_protos::GpuQueueSubmission& actual_queue_submission =
+      actual_capture_event.gpu_queue_submission();
+  EXPECT_EQ(actual_queue_submission.num_begin_markers(), 1);
+  ASSERT_EQ(actual_queue_submission.completed_markers_size(), 1);
+  const orbit_grpc_protos::GpuDebugMarker& actual_debug_marker =
+      actual_queue_submission.completed_markers(0);
+  ExpectDebugMarkerEndEq(actual_debug_marker, kTimestamp3, expected_text_key, expected_color, 0);
+  ExpectDebugMarkerBeginEq(actual_debug_marker, kTimestamp2, pre_submit_time, post_submit_time, tid,
+                           pid);
+}
+
 TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerEndEvenWhenBeginNotCaptured) {
   ExpectTwoNextReadyQuerySlotCalls();
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
@@ -1282,6 +1508,142 @@ TEST_F(SubmissionTrackerTest,
                            post_submit_time, tid, pid);
 }
 
+TEST_F(SubmissionTrackerTest, CollectsPipelineStatisticsOfTheOutermostDebugMarker) {
+  ExpectSixNextReadyQuerySlotCalls();
+  EXPECT_CALL(pipeline_statistics_query_pool_, IsInitialized).WillRepeatedly(Return(true));
+  EXPECT_CALL(pipeline_statistics_query_pool_, GetQueryPool).WillRepeatedly(Return(query_pool_));
+  EXPECT_CALL(pipeline_statistics_query_pool_, NextReadyQuerySlot)
+      .Times(1)
+      .WillOnce(Invoke(MockNextReadyQuerySlot1));
+  static uint32_t begun_query = 0;
+  static uint32_t ended_query = 0;
+  PFN_vkCmdBeginQuery mock_begin_query_function =
+      +[](VkCommandBuffer /*command_buffer*/, VkQueryPool /*query_pool*/, uint32_t query,
+          VkQueryControlFlags /*flags*/) { begun_query = query; };
+  PFN_vkCmdEndQuery mock_end_query_function =
+      +[](VkCommandBuffer /*command_buffer*/, VkQueryPool /*query_pool*/, uint32_t query) {
+        ended_query = query;
+      };
+  EXPECT_CALL(dispatch_table_, CmdBeginQuery).Times(1).WillOnce(Return(mock_begin_query_function));
+  EXPECT_CALL(dispatch_table_, CmdEndQuery).Times(1).WillOnce(Return(mock_end_query_function));
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .WillRepeatedly(
+          Return(mock_get_query_pool_results_function_with_pipeline_statistics_all_ready_));
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading).Times(1);
+  std::vector<uint32_t> actual_pipeline_statistics_slots_done_reading;
+  EXPECT_CALL(pipeline_statistics_query_pool_, MarkQuerySlotsDoneReading)
+      .Times(1)
+      .WillOnce(SaveArg<1>(&actual_pipeline_statistics_slots_done_reading));
+  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey).Times(2);
+  orbit_grpc_protos::ProducerCaptureEvent actual_capture_event;
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent)
+      .Times(1)
+      .WillOnce(Invoke([&actual_capture_event](orbit_grpc_protos::ProducerCaptureEvent&& event) {
+        actual_capture_event = std::move(event);
+        return true;
+      }));
+
+  producer_->StartCapture(std::numeric_limits<uint64_t>::max(),
+                          /*collect_gpu_pipeline_statistics=*/true);
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkDebugMarkerBegin(command_buffer_, "Outer", {});
+  // Queries can't be nested, so the inner marker doesn't get statistics.
+  tracker_.MarkDebugMarkerBegin(command_buffer_, "Inner", {});
+  tracker_.MarkDebugMarkerEnd(command_buffer_);
+  EXPECT_EQ(ended_query, 0);
+  tracker_.MarkDebugMarkerEnd(command_buffer_);
+  EXPECT_EQ(begun_query, kSlotIndex1);
+  EXPECT_EQ(ended_query, kSlotIndex1);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  std::optional<QueueSubmission> queue_submission_optional =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+  tracker_.CompleteSubmits(device_);
+
+  EXPECT_THAT(actual_pipeline_statistics_slots_done_reading, ElementsAre(kSlotIndex1));
+  ASSERT_TRUE(actual_capture_event.has_gpu_queue_submission());
+  const orbit_grpc_protos::GpuQueueSubmission& actual_queue_submission =
+      actual_capture_event.gpu_queue_submission();
+  ASSERT_EQ(actual_queue_submission.completed_markers_size(), 2);
+  const orbit_grpc_protos::GpuDebugMarker& actual_debug_marker_inner =
+      actual_queue_submission.completed_markers(0);
+  const orbit_grpc_protos::GpuDebugMarker& actual_debug_marker_outer =
+      actual_queue_submission.completed_markers(1);
+  EXPECT_FALSE(actual_debug_marker_inner.has_pipeline_statistics());
+  ASSERT_TRUE(actual_debug_marker_outer.has_pipeline_statistics());
+  const orbit_grpc_protos::GpuPipelineStatistics& actual_pipeline_statistics =
+      actual_debug_marker_outer.pipeline_statistics();
+  EXPECT_EQ(actual_pipeline_statistics.input_assembly_vertices(), 100 * kSlotIndex1);
+  EXPECT_EQ(actual_pipeline_statistics.vertex_shader_invocations(), 100 * kSlotIndex1 + 2);
+  EXPECT_EQ(actual_pipeline_statistics.fragment_shader_invocations(), 100 * kSlotIndex1 + 7);
+  EXPECT_EQ(actual_pipeline_statistics.compute_shader_invocations(), 100 * kSlotIndex1 + 10);
+}
+
+TEST_F(SubmissionTrackerTest, EndsPipelineStatisticsQueryAtCommandBufferEndWithoutReadingIt) {
+  ExpectSixNextReadyQuerySlotCalls();
+  EXPECT_CALL(pipeline_statistics_query_pool_, IsInitialized).WillRepeatedly(Return(true));
+  EXPECT_CALL(pipeline_statistics_query_pool_, GetQueryPool).WillRepeatedly(Return(query_pool_));
+  EXPECT_CALL(pipeline_statistics_query_pool_, NextReadyQuerySlot)
+      .Times(1)
+      .WillOnce(Invoke(MockNextReadyQuerySlot1));
+  PFN_vkCmdBeginQuery dummy_begin_query_function =
+      +[](VkCommandBuffer /*command_buffer*/, VkQueryPool /*query_pool*/, uint32_t /*query*/,
+          VkQueryControlFlags /*flags*/) {};
+  PFN_vkCmdEndQuery dummy_end_query_function =
+      +[](VkCommandBuffer /*command_buffer*/, VkQueryPool /*query_pool*/, uint32_t /*query*/) {};
+  EXPECT_CALL(dispatch_table_, CmdBeginQuery)
+      .Times(1)
+      .WillOnce(Return(dummy_begin_query_function));
+  // The query is ended by the end of the first command buffer.
+  EXPECT_CALL(dispatch_table_, CmdEndQuery).Times(1).WillOnce(Return(dummy_end_query_function));
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .WillRepeatedly(
+          Return(mock_get_query_pool_results_function_with_pipeline_statistics_all_ready_));
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsDoneReading).Times(2);
+  std::vector<uint32_t> actual_pipeline_statistics_slots_not_read;
+  EXPECT_CALL(pipeline_statistics_query_pool_, MarkQuerySlotsDoneReading)
+      .Times(1)
+      .WillOnce(SaveArg<1>(&actual_pipeline_statistics_slots_not_read));
+  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey).Times(1);
+  orbit_grpc_protos::ProducerCaptureEvent actual_capture_event;
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent)
+      .Times(2)
+      .WillRepeatedly(
+          Invoke([&actual_capture_event](orbit_grpc_protos::ProducerCaptureEvent&& event) {
+            actual_capture_event = std::move(event);
+            return true;
+          }));
+
+  producer_->StartCapture(std::numeric_limits<uint64_t>::max(),
+                          /*collect_gpu_pipeline_statistics=*/true);
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkDebugMarkerBegin(command_buffer_, "Marker", {});
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  std::optional<QueueSubmission> queue_submission_optional =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+  tracker_.CompleteSubmits(device_);
+  EXPECT_TRUE(actual_pipeline_statistics_slots_not_read.empty());
+
+  EXPECT_CALL(timer_query_pool_, MarkQuerySlotsForReset).Times(1);
+  EXPECT_CALL(pipeline_statistics_query_pool_, MarkQuerySlotsForReset).Times(1);
+  tracker_.ResetCommandBuffer(command_buffer_);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkDebugMarkerEnd(command_buffer_);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  queue_submission_optional = tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+  tracker_.CompleteSubmits(device_);
+
+  EXPECT_THAT(actual_pipeline_statistics_slots_not_read, ElementsAre(kSlotIndex1));
+  ASSERT_TRUE(actual_capture_event.has_gpu_queue_submission());
+  ASSERT_EQ(actual_capture_event.gpu_queue_submission().completed_markers_size(), 1);
+  EXPECT_FALSE(
+      actual_capture_event.gpu_queue_submission().completed_markers(0).has_pipeline_statistics());
+}
+
 TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerAcrossTwoSubmissions) {
   ExpectSixNextReadyQuerySlotCalls();
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
@@ -1863,4 +2225,35 @@ TEST_F(SubmissionTrackerTest, WillWriteTimestampEvenWhenCommandBufferIsNotInInit
 
   EXPECT_THAT(actual_slots_to_reset, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
 }
+
+TEST_F(SubmissionTrackerTest, CanRecordCommandBuffersConcurrently) {
+  constexpr uint32_t kIterations = 1000;
+  // Each iteration writes four timestamps into each command buffer, which get rolled back on reset.
+  EXPECT_CALL(timer_query_pool_, NextReadyQuerySlot)
+      .Times(2 * 4 * kIterations)
+      .WillRepeatedly(Invoke(MockNextReadyQuerySlot1));
+  EXPECT_CALL(timer_query_pool_, RollbackPendingQuerySlots).Times(2 * kIterations);
+
+  producer_->StartCapture();
+  std::array<VkCommandBuffer, 2> command_buffers{absl::bit_cast<VkCommandBuffer>(1L),
+                                                 absl::bit_cast<VkCommandBuffer>(2L)};
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffers[0], 2);
+
+  auto record = [this](VkCommandBuffer command_buffer) {
+    for (uint32_t i = 0; i < kIterations; ++i) {
+      tracker_.MarkCommandBufferBegin(command_buffer);
+      tracker_.MarkDebugMarkerBegin(command_buffer, "Marker", {});
+      tracker_.MarkDebugMarkerEnd(command_buffer);
+      tracker_.MarkCommandBufferEnd(command_buffer);
+      tracker_.ResetCommandBuffer(command_buffer);
+    }
+  };
+  std::thread first_thread{record, command_buffers[0]};
+  std::thread second_thread{record, command_buffers[1]};
+  first_thread.join();
+  second_thread.join();
+
+  tracker_.UntrackCommandBuffers(device_, command_pool_, &command_buffers[0], 2);
+}
+
 }  // namespace orbit_vulkan_layer
@@ -6,12 +6,14 @@
 #define ORBIT_VULKAN_LAYER_TIMER_QUERY_POOL_H_
 
 #include <absl/container/flat_hash_map.h>
-#include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
 #include <vulkan/vulkan.h>
 
-#include <fstream>
-#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
@@ -52,24 +54,39 @@ namespace orbit_vulkan_layer {
 // MarkQuerySlotDoneReading                   MarkQuerySlotForReset
 //
 //
-// Thread-Safety: This class is internally synchronized (using read/write locks) and can be safely
-// accessed from different threads.
+// A slot that is done reading, but still baked into a command buffer that gets submitted again
+// without being reset, can be handed to the new execution of the command buffer with
+// `ReuseQuerySlotsDoneReading`. This resets the content of the slot on Vulkan and moves it back to
+// `kQueryPendingOnGpu`, such that it gets read again for that execution.
+//
+// The same slot management is used for pipeline statistics queries, by passing
+// `VK_QUERY_TYPE_PIPELINE_STATISTICS` and the statistics to collect to the constructor.
+//
+// Thread-Safety: This class is internally synchronized and can be safely accessed from different
+// threads. The state of the slots is only changed with atomic operations and the free slots are
+// kept in a lock-free stack, so retrieving and resetting slots does not take any lock besides a
+// read lock for looking up the pool of the device.
 template <class DispatchTable>
 class TimerQueryPool {
  public:
-  explicit TimerQueryPool(DispatchTable* dispatch_table, uint32_t num_timer_query_slots)
-      : dispatch_table_(dispatch_table), num_timer_query_slots_(num_timer_query_slots) {}
+  explicit TimerQueryPool(DispatchTable* dispatch_table, uint32_t num_timer_query_slots,
+                          VkQueryType query_type = VK_QUERY_TYPE_TIMESTAMP,
+                          VkQueryPipelineStatisticFlags pipeline_statistics = 0)
+      : dispatch_table_(dispatch_table),
+        num_timer_query_slots_(num_timer_query_slots),
+        query_type_(query_type),
+        pipeline_statistics_(pipeline_statistics) {}
 
-  // Creates and resets a vulkan `VkQueryPool`, ready to use for timestamp queries.
+  // Creates and resets a vulkan `VkQueryPool`, ready to use for queries of the pool's type.
   void InitializeTimerQueryPool(VkDevice device) {
     VkQueryPool query_pool;
 
     VkQueryPoolCreateInfo create_info = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
                                          .pNext = nullptr,
                                          .flags = 0,
-                                         .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                                         .queryType = query_type_,
                                          .queryCount = num_timer_query_slots_,
-                                         .pipelineStatistics = 0};
+                                         .pipelineStatistics = pipeline_statistics_};
 
     VkResult result =
         dispatch_table_->CreateQueryPool(device)(device, &create_info, nullptr, &query_pool);
@@ -80,36 +97,35 @@ class TimerQueryPool {
     {
       absl::WriterMutexLock lock(&mutex_);
       CHECK(!device_to_query_pool_.contains(device));
-      device_to_query_pool_[device] = query_pool;
-      std::vector<SlotState> slots{num_timer_query_slots_};
-      std::fill(slots.begin(), slots.end(), SlotState::kReadyForQueryIssue);
-      device_to_query_slots_[device] = slots;
-      std::vector<uint32_t> free_slots(num_timer_query_slots_);
       // At the beginning all slot indices in [0, num_timer_query_slots) are free.
-      std::iota(free_slots.begin(), free_slots.end(), 0);
-      device_to_free_slots_[device] = free_slots;
+      device_to_query_pool_.emplace(
+          device, std::make_unique<DeviceQueryPool>(query_pool, num_timer_query_slots_));
     }
   }
 
   // Destroys the VkQueryPool for the given device
   void DestroyTimerQueryPool(VkDevice device) {
     absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_pool_.contains(device));
-    VkQueryPool query_pool = device_to_query_pool_.at(device);
-    device_to_query_slots_.erase(device);
-    device_to_free_slots_.erase(device);
+    auto query_pool_it = device_to_query_pool_.find(device);
+    CHECK(query_pool_it != device_to_query_pool_.end());
+    VkQueryPool query_pool = query_pool_it->second->query_pool;
 
     dispatch_table_->DestroyQueryPool(device)(device, query_pool, nullptr);
 
-    device_to_query_pool_.erase(device);
+    device_to_query_pool_.erase(query_pool_it);
+  }
+
+  // Returns whether `InitializeTimerQueryPool` was called for the device (and the pool was not
+  // destroyed since).
+  [[nodiscard]] bool IsInitialized(VkDevice device) {
+    absl::ReaderMutexLock lock(&mutex_);
+    return device_to_query_pool_.contains(device);
   }
 
   // Retrieves the query pool for a given device. Note that the pool must be initialized using
   // `InitializeTimerQueryPool` before.
   [[nodiscard]] VkQueryPool GetQueryPool(VkDevice device) {
-    absl::ReaderMutexLock lock(&mutex_);
-    CHECK(device_to_query_pool_.contains(device));
-    return device_to_query_pool_.at(device);
+    return GetDeviceQueryPool(device)->query_pool;
   }
 
   // Returns a free query slot from the device's pool if one still exists. It returns `false` if all
@@ -119,18 +135,15 @@ class TimerQueryPool {
   // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
   // See also `ResetQuerySlots` to make occupied slots available again.
   [[nodiscard]] bool NextReadyQuerySlot(VkDevice device, uint32_t* allocated_index) {
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_free_slots_.contains(device));
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    if (free_slots.empty()) {
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
+    if (!device_query_pool->free_slots.Pop(allocated_index)) {
       return false;
     }
-    *allocated_index = free_slots.back();
-    free_slots.pop_back();
 
-    CHECK(device_to_query_slots_.at(device)[*allocated_index] == SlotState::kReadyForQueryIssue);
-    device_to_query_slots_.at(device)[*allocated_index] = SlotState::kQueryPendingOnGpu;
+    SlotState expected_state = SlotState::kReadyForQueryIssue;
+    const bool was_ready = device_query_pool->slot_states[*allocated_index].compare_exchange_strong(
+        expected_state, SlotState::kQueryPendingOnGpu);
+    CHECK(was_ready);
     return true;
   }
 
@@ -149,24 +162,7 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    for (uint32_t slot_index : slot_indices) {
-      CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      if (current_state == SlotState::kQueryPendingOnGpu) {
-        slot_states[slot_index] = SlotState::kDoneReading;
-        continue;
-      }
-      CHECK(current_state == SlotState::kResetRequested);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-      VkQueryPool query_pool = device_to_query_pool_.at(device);
-      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_index, 1);
-    }
+    AdvanceQuerySlots(device, slot_indices, SlotState::kDoneReading, SlotState::kResetRequested);
   }
 
   // Marks that the underlying slots are not used by any command buffer anymore
@@ -184,23 +180,41 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
+    AdvanceQuerySlots(device, slot_indices, SlotState::kResetRequested, SlotState::kDoneReading);
+  }
+
+  // Returns whether all the given slots are in the `kDoneReading` state, i.e. were read (or will
+  // not be read) but are still baked into a command buffer that was not reset yet.
+  //
+  // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
+  [[nodiscard]] bool AreQuerySlotsDoneReading(VkDevice device,
+                                              const std::vector<uint32_t>& slot_indices) {
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
+    return std::all_of(slot_indices.begin(), slot_indices.end(), [&](uint32_t slot_index) {
+      CHECK(slot_index < num_timer_query_slots_);
+      return device_query_pool->slot_states[slot_index].load() == SlotState::kDoneReading;
+    });
+  }
+
+  // Resets the content of the given slots on Vulkan and makes them pending on the GPU again, for
+  // another execution of the command buffer they are baked into. The slots need to be read (or
+  // marked done reading) again afterwards.
+  //
+  // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
+  // Further, the given slots must be in the `kDoneReading` state, see `AreQuerySlotsDoneReading`.
+  void ReuseQuerySlotsDoneReading(VkDevice device, const std::vector<uint32_t>& slot_indices) {
+    if (slot_indices.empty()) {
+      return;
+    }
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
+    ResetQuerySlotsOnVulkan(device, device_query_pool->query_pool, slot_indices);
     for (uint32_t slot_index : slot_indices) {
       CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      if (current_state == SlotState::kQueryPendingOnGpu) {
-        slot_states[slot_index] = SlotState::kResetRequested;
-        continue;
-      }
-      CHECK(current_state == SlotState::kDoneReading);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-      VkQueryPool query_pool = device_to_query_pool_.at(device);
-      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_index, 1);
+      SlotState expected_state = SlotState::kDoneReading;
+      const bool was_done_reading =
+          device_query_pool->slot_states[slot_index].compare_exchange_strong(
+              expected_state, SlotState::kQueryPendingOnGpu);
+      CHECK(was_done_reading);
     }
   }
 
@@ -216,17 +230,14 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
     for (uint32_t slot_index : slot_indices) {
       CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      CHECK(current_state == SlotState::kQueryPendingOnGpu);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
+      SlotState expected_state = SlotState::kQueryPendingOnGpu;
+      const bool was_pending = device_query_pool->slot_states[slot_index].compare_exchange_strong(
+          expected_state, SlotState::kReadyForQueryIssue);
+      CHECK(was_pending);
+      device_query_pool->free_slots.Push(slot_index);
     }
   }
 
@@ -238,14 +249,127 @@ class TimerQueryPool {
     kResetRequested = 3
   };
 
+  // A lock-free stack of slot indices (in the `kReadyForQueryIssue` state). The index on top of the
+  // stack is packed together with a counter that is incremented on every change, such that popping
+  // a slot never succeeds based on an outdated successor when the same slot was popped and pushed
+  // again in the meantime (the ABA problem).
+  class FreeSlotStack {
+   public:
+    explicit FreeSlotStack(uint32_t num_slots) : next_slots_(num_slots) {
+      for (uint32_t slot_index = 0; slot_index < num_slots; ++slot_index) {
+        Push(slot_index);
+      }
+    }
+
+    void Push(uint32_t slot_index) {
+      uint64_t top = top_.load(std::memory_order_relaxed);
+      do {
+        next_slots_[slot_index].store(SlotIndex(top), std::memory_order_relaxed);
+      } while (!top_.compare_exchange_weak(top, Pack(slot_index, Counter(top) + 1),
+                                           std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    [[nodiscard]] bool Pop(uint32_t* slot_index) {
+      uint64_t top = top_.load(std::memory_order_acquire);
+      do {
+        if (SlotIndex(top) == kNoSlot) {
+          return false;
+        }
+        *slot_index = SlotIndex(top);
+      } while (!top_.compare_exchange_weak(
+          top, Pack(next_slots_[*slot_index].load(std::memory_order_relaxed), Counter(top) + 1),
+          std::memory_order_acquire, std::memory_order_acquire));
+      return true;
+    }
+
+   private:
+    static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+
+    [[nodiscard]] static uint64_t Pack(uint32_t slot_index, uint32_t counter) {
+      return (static_cast<uint64_t>(counter) << 32) | slot_index;
+    }
+    [[nodiscard]] static uint32_t SlotIndex(uint64_t top) { return static_cast<uint32_t>(top); }
+    [[nodiscard]] static uint32_t Counter(uint64_t top) { return static_cast<uint32_t>(top >> 32); }
+
+    std::atomic<uint64_t> top_ = Pack(kNoSlot, 0);
+    std::vector<std::atomic<uint32_t>> next_slots_;
+  };
+
+  struct DeviceQueryPool {
+    DeviceQueryPool(VkQueryPool query_pool, uint32_t num_slots)
+        : query_pool(query_pool), slot_states(num_slots), free_slots(num_slots) {
+      for (std::atomic<SlotState>& slot_state : slot_states) {
+        slot_state.store(SlotState::kReadyForQueryIssue, std::memory_order_relaxed);
+      }
+    }
+
+    const VkQueryPool query_pool;
+    std::vector<std::atomic<SlotState>> slot_states;
+    FreeSlotStack free_slots;
+  };
+
+  // The returned pool stays valid until `DestroyTimerQueryPool` is called for the device.
+  [[nodiscard]] DeviceQueryPool* GetDeviceQueryPool(VkDevice device) {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto query_pool_it = device_to_query_pool_.find(device);
+    CHECK(query_pool_it != device_to_query_pool_.end());
+    return query_pool_it->second.get();
+  }
+
+  // Moves the given slots from `kQueryPendingOnGpu` to `pending_state`, or, if they are already in
+  // `other_pending_state`, resets them and makes them ready again. The slots are reset on Vulkan
+  // with one call per range of consecutive slot indices, before they are made ready.
+  void AdvanceQuerySlots(VkDevice device, const std::vector<uint32_t>& slot_indices,
+                         SlotState pending_state, SlotState other_pending_state) {
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
+    std::vector<uint32_t> slots_to_reset;
+    for (uint32_t slot_index : slot_indices) {
+      CHECK(slot_index < num_timer_query_slots_);
+      std::atomic<SlotState>& slot_state = device_query_pool->slot_states[slot_index];
+      SlotState current_state = SlotState::kQueryPendingOnGpu;
+      if (slot_state.compare_exchange_strong(current_state, pending_state)) {
+        continue;
+      }
+      CHECK(current_state == other_pending_state);
+      slots_to_reset.push_back(slot_index);
+    }
+    if (slots_to_reset.empty()) {
+      return;
+    }
+
+    ResetQuerySlotsOnVulkan(device, device_query_pool->query_pool, slots_to_reset);
+
+    for (uint32_t slot_index : slots_to_reset) {
+      device_query_pool->slot_states[slot_index].store(SlotState::kReadyForQueryIssue);
+      device_query_pool->free_slots.Push(slot_index);
+    }
+  }
+
+  // Resets the given slots on Vulkan with one call per range of consecutive slot indices.
+  void ResetQuerySlotsOnVulkan(VkDevice device, VkQueryPool query_pool,
+                               std::vector<uint32_t> slot_indices) {
+    std::sort(slot_indices.begin(), slot_indices.end());
+    for (size_t range_begin = 0; range_begin < slot_indices.size();) {
+      size_t range_end = range_begin + 1;
+      while (range_end < slot_indices.size() &&
+             slot_indices[range_end] == slot_indices[range_end - 1] + 1) {
+        ++range_end;
+      }
+      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_indices[range_begin],
+                                                 range_end - range_begin);
+      range_begin = range_end;
+    }
+  }
+
   DispatchTable* dispatch_table_;
   const uint32_t num_timer_query_slots_;
+  const VkQueryType query_type_;
+  const VkQueryPipelineStatisticFlags pipeline_statistics_;
 
+  // Only taken for writing when a pool gets initialized or destroyed.
   absl::Mutex mutex_;
-
-  absl::flat_hash_map<VkDevice, VkQueryPool> device_to_query_pool_;
-  absl::flat_hash_map<VkDevice, std::vector<SlotState>> device_to_query_slots_;
-  absl::flat_hash_map<VkDevice, std::vector<uint32_t>> device_to_free_slots_;
+  absl::flat_hash_map<VkDevice, std::unique_ptr<DeviceQueryPool>> device_to_query_pool_
+      ABSL_GUARDED_BY(mutex_);
 };
 }  // namespace orbit_vulkan_layer
 
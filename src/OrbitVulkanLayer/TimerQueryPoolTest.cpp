@@ -6,6 +6,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 #include "TimerQueryPool.h"
 
 using ::testing::Return;
@@ -82,6 +85,38 @@ TEST(TimerQueryPool, InitializationWillCreateAndResetAPool) {
   query_pool.InitializeTimerQueryPool(device);
 }
 
+TEST(TimerQueryPool, InitializationCanCreateAPipelineStatisticsPool) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 4;
+  static constexpr VkQueryPipelineStatisticFlags kPipelineStatistics =
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+  TimerQueryPool<MockDispatchTable> query_pool(
+      &dispatch_table, kNumSlots, VK_QUERY_TYPE_PIPELINE_STATISTICS, kPipelineStatistics);
+  VkDevice device = {};
+
+  PFN_vkCreateQueryPool mock_create_query_pool_function =
+      +[](VkDevice /*device*/, const VkQueryPoolCreateInfo* create_info,
+          const VkAllocationCallbacks* /*allocator*/, VkQueryPool* query_pool_out) -> VkResult {
+    EXPECT_EQ(create_info->queryType, VK_QUERY_TYPE_PIPELINE_STATISTICS);
+    EXPECT_EQ(create_info->queryCount, kNumSlots);
+    EXPECT_EQ(create_info->pipelineStatistics, kPipelineStatistics);
+
+    *query_pool_out = {};
+    return VK_SUCCESS;
+  };
+
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .Times(1)
+      .WillOnce(Return(mock_create_query_pool_function));
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillRepeatedly(Return(dummy_reset_query_pool_function));
+
+  EXPECT_FALSE(query_pool.IsInitialized(device));
+  query_pool.InitializeTimerQueryPool(device);
+  EXPECT_TRUE(query_pool.IsInitialized(device));
+}
+
 TEST(TimerQueryPool, DestroyPoolForDeviceWillCallDestroyQueryPool) {
   MockDispatchTable dispatch_table;
 
@@ -107,6 +142,7 @@ TEST(TimerQueryPool, DestroyPoolForDeviceWillCallDestroyQueryPool) {
   query_pool.InitializeTimerQueryPool(device);
   query_pool.DestroyTimerQueryPool(device);
   EXPECT_TRUE(was_called);
+  EXPECT_FALSE(query_pool.IsInitialized(device));
 }
 
 TEST(TimerQueryPool, QueryPoolCanBeRetrievedAfterInitialization) {
@@ -419,4 +455,121 @@ TEST(TimerQueryPool, CanRepeatadlyRetrieveAndResetSlots) {
   }
 }
 
+
+TEST(TimerQueryPool, ResettingConsecutiveSlotsResetsThemWithASingleCall) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 4;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlots);
+  VkDevice device = {};
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .WillRepeatedly(Return(dummy_create_query_pool_function));
+
+  static std::vector<std::pair<uint32_t, uint32_t>> actual_resets;
+  PFN_vkResetQueryPoolEXT mock_reset_query_pool_function =
+      +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t first_query,
+          uint32_t query_count) { actual_resets.emplace_back(first_query, query_count); };
+
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .Times(2)
+      .WillOnce(Return(dummy_reset_query_pool_function))
+      .WillOnce(Return(mock_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+  std::vector<uint32_t> slots;
+  for (uint32_t i = 0; i < kNumSlots; ++i) {
+    uint32_t slot;
+    ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+    slots.push_back(slot);
+  }
+
+  query_pool.MarkQuerySlotsDoneReading(device, slots);
+  query_pool.MarkQuerySlotsForReset(device, slots);
+
+  EXPECT_EQ(actual_resets, (std::vector<std::pair<uint32_t, uint32_t>>{{0, kNumSlots}}));
+  actual_resets.clear();
+}
+
+TEST(TimerQueryPool, CanReuseSlotsDoneReadingForAnotherExecution) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 2;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlots);
+  VkDevice device = {};
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .WillRepeatedly(Return(dummy_create_query_pool_function));
+
+  static std::vector<std::pair<uint32_t, uint32_t>> actual_resets;
+  PFN_vkResetQueryPoolEXT mock_reset_query_pool_function =
+      +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t first_query,
+          uint32_t query_count) { actual_resets.emplace_back(first_query, query_count); };
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillOnce(Return(dummy_reset_query_pool_function))
+      .WillRepeatedly(Return(mock_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+  std::vector<uint32_t> slots(kNumSlots);
+  ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slots[0]));
+  ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slots[1]));
+  EXPECT_FALSE(query_pool.AreQuerySlotsDoneReading(device, slots));
+
+  query_pool.MarkQuerySlotsDoneReading(device, {slots[0]});
+  EXPECT_FALSE(query_pool.AreQuerySlotsDoneReading(device, slots));
+  query_pool.MarkQuerySlotsDoneReading(device, {slots[1]});
+  EXPECT_TRUE(query_pool.AreQuerySlotsDoneReading(device, slots));
+
+  query_pool.ReuseQuerySlotsDoneReading(device, slots);
+  EXPECT_EQ(actual_resets, (std::vector<std::pair<uint32_t, uint32_t>>{{0, kNumSlots}}));
+  actual_resets.clear();
+  EXPECT_FALSE(query_pool.AreQuerySlotsDoneReading(device, slots));
+  EXPECT_DEATH({ query_pool.ReuseQuerySlotsDoneReading(device, slots); }, "");
+
+  // The reused slots are pending on the GPU again and only become ready once read and reset.
+  uint32_t slot;
+  EXPECT_FALSE(query_pool.NextReadyQuerySlot(device, &slot));
+  query_pool.MarkQuerySlotsDoneReading(device, slots);
+  query_pool.MarkQuerySlotsForReset(device, slots);
+  EXPECT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+  actual_resets.clear();
+}
+
+TEST(TimerQueryPool, CanConcurrentlyRetrieveAndResetSlots) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 16;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlots);
+  VkDevice device = {};
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .WillRepeatedly(Return(dummy_create_query_pool_function));
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillRepeatedly(Return(dummy_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+
+  // Each thread holds at most two slots at a time, so none of them can run out of slots.
+  auto retrieve_and_reset_slots = [&query_pool, device]() {
+    for (int i = 0; i < 2000; ++i) {
+      std::vector<uint32_t> slots(2);
+      EXPECT_TRUE(query_pool.NextReadyQuerySlot(device, &slots[0]));
+      EXPECT_TRUE(query_pool.NextReadyQuerySlot(device, &slots[1]));
+      if (i % 2 == 0) {
+        query_pool.MarkQuerySlotsForReset(device, slots);
+        query_pool.MarkQuerySlotsDoneReading(device, slots);
+      } else {
+        query_pool.RollbackPendingQuerySlots(device, slots);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back(retrieve_and_reset_slots);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // All slots are ready again.
+  for (uint32_t i = 0; i < kNumSlots; ++i) {
+    uint32_t slot;
+    EXPECT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+  }
+}
+
 }  // namespace orbit_vulkan_layer
@@ -50,8 +50,12 @@ class VulkanLayerController {
   VulkanLayerController()
       : device_manager_(&dispatch_table_),
         timer_query_pool_(&dispatch_table_, kNumTimerQuerySlots),
+        pipeline_statistics_query_pool_(&dispatch_table_, kNumPipelineStatisticsQuerySlots,
+                                        VK_QUERY_TYPE_PIPELINE_STATISTICS,
+                                        SubmissionTracker::kPipelineStatisticFlags),
         submission_tracker_(&dispatch_table_, &timer_query_pool_, &device_manager_,
-                            std::numeric_limits<uint32_t>::max()) {}
+                            std::numeric_limits<uint32_t>::max(),
+                            &pipeline_statistics_query_pool_) {}
 
   ~VulkanLayerController() { CloseVulkanLayerProducerIfNecessary(); }
 
@@ -158,9 +162,15 @@ class VulkanLayerController {
         create_info->ppEnabledExtensionNames + create_info->enabledExtensionCount);
 
     // Add our required extension (if not already present), to the extensions requested by the game.
-    AddRequiredDeviceExtensionNameIfMissing(
-        create_info, physical_device, next_get_instance_proc_addr_function,
-        VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME, &all_extension_names);
+    AddDeviceExtensionNameIfMissing(create_info, physical_device,
+                                    next_get_instance_proc_addr_function,
+                                    VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME,
+                                    /*required=*/true, &all_extension_names);
+    // Calibrated timestamps are only used to correlate the GPU and the CPU clock more precisely.
+    AddDeviceExtensionNameIfMissing(create_info, physical_device,
+                                    next_get_instance_proc_addr_function,
+                                    VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME,
+                                    /*required=*/false, &all_extension_names);
 
     // Expose the c-strings (but ensure, the std::strings stay in memory!).
     std::vector<const char*> all_extension_names_cstr{};
@@ -174,6 +184,13 @@ class VulkanLayerController {
     create_info_modified.enabledExtensionCount = all_extension_names_cstr.size();
     create_info_modified.ppEnabledExtensionNames = all_extension_names_cstr.data();
 
+    // Pipeline statistics are only collected if requested for a capture, but the feature needs to
+    // be enabled when creating the device.
+    VkPhysicalDeviceFeatures enabled_features{};
+    const bool pipeline_statistics_query_enabled = EnablePipelineStatisticsQueryFeatureIfSupported(
+        physical_device, next_get_instance_proc_addr_function, &create_info_modified,
+        &enabled_features);
+
     // Need to call vkCreateInstance down the chain to actually create the
     // instance, as we need it to be alive in the create instance dispatch table.
     auto create_device_function = absl::bit_cast<PFN_vkCreateDevice>(
@@ -188,6 +205,9 @@ class VulkanLayerController {
 
       device_manager_.TrackLogicalDevice(physical_device, *device);
       timer_query_pool_.InitializeTimerQueryPool(*device);
+      if (pipeline_statistics_query_enabled) {
+        pipeline_statistics_query_pool_.InitializeTimerQueryPool(*device);
+      }
     }
 
     return result;
@@ -217,6 +237,9 @@ class VulkanLayerController {
     CHECK(destroy_device_function != nullptr);
     device_manager_.UntrackLogicalDevice(device);
     timer_query_pool_.DestroyTimerQueryPool(device);
+    if (pipeline_statistics_query_pool_.IsInitialized(device)) {
+      pipeline_statistics_query_pool_.DestroyTimerQueryPool(device);
+    }
     dispatch_table_.RemoveDeviceDispatchTable(device);
 
     destroy_device_function(device, allocator);
@@ -242,7 +265,8 @@ class VulkanLayerController {
     if (result == VK_SUCCESS) {
       VkCommandPool pool = allocate_info->commandPool;
       const uint32_t command_buffer_count = allocate_info->commandBufferCount;
-      submission_tracker_.TrackCommandBuffers(device, pool, command_buffers, command_buffer_count);
+      submission_tracker_.TrackCommandBuffers(device, pool, command_buffers, command_buffer_count,
+                                              allocate_info->level);
     }
 
     return result;
@@ -279,6 +303,13 @@ class VulkanLayerController {
     return dispatch_table_.ResetCommandBuffer(command_buffer)(command_buffer, flags);
   }
 
+  void OnCmdExecuteCommands(VkCommandBuffer command_buffer, uint32_t command_buffer_count,
+                            const VkCommandBuffer* command_buffers) {
+    submission_tracker_.MarkExecuteCommands(command_buffer, command_buffer_count, command_buffers);
+    dispatch_table_.CmdExecuteCommands(command_buffer)(command_buffer, command_buffer_count,
+                                                       command_buffers);
+  }
+
   void OnGetDeviceQueue(VkDevice device, uint32_t queue_family_index, uint32_t queue_index,
                         VkQueue* queue) {
     dispatch_table_.GetDeviceQueue(device)(device, queue_family_index, queue_index, queue);
@@ -616,6 +647,10 @@ class VulkanLayerController {
 
   [[nodiscard]] const TimerQueryPool* timer_query_pool() const { return &timer_query_pool_; }
 
+  [[nodiscard]] const TimerQueryPool* pipeline_statistics_query_pool() const {
+    return &pipeline_statistics_query_pool_;
+  }
+
   [[nodiscard]] const QueueManager* queue_manager() const { return &queue_manager_; }
 
   [[nodiscard]] const VulkanWrapper* vulkan_wrapper() const { return &vulkan_wrapper_; }
@@ -643,12 +678,14 @@ class VulkanLayerController {
     }
   }
 
+  // Adds `extension_name` to `output` if it is not enabled in `create_info` yet. Fails if the
+  // extension is not supported, unless it is not `required`, in which case it is just not added.
   template <typename CreateInfoT>
-  void AddRequiredExtensionNameIfMissing(
-      const CreateInfoT* create_info,
-      const std::function<VkResult(uint32_t*, VkExtensionProperties*)>&
-          enumerate_extension_properties_function,
-      const char* extension_name, std::vector<std::string>* output) {
+  void AddExtensionNameIfMissing(const CreateInfoT* create_info,
+                                 const std::function<VkResult(uint32_t*, VkExtensionProperties*)>&
+                                     enumerate_extension_properties_function,
+                                 const char* extension_name, bool required,
+                                 std::vector<std::string>* output) {
     bool extension_already_enabled = false;
 
     for (uint32_t i = 0; i < create_info->enabledExtensionCount; ++i) {
@@ -676,16 +713,18 @@ class VulkanLayerController {
         }
       }
 
-      FAIL_IF(!extension_supported,
+      FAIL_IF(required && !extension_supported,
               "Orbit's Vulkan layer requires the %s extension to be supported.", extension_name);
-      output->emplace_back(extension_name);
+      if (extension_supported) {
+        output->emplace_back(extension_name);
+      }
     }
   }
 
-  void AddRequiredDeviceExtensionNameIfMissing(
+  void AddDeviceExtensionNameIfMissing(
       const VkDeviceCreateInfo* create_info, VkPhysicalDevice physical_device,
       PFN_vkGetInstanceProcAddr next_get_instance_proc_addr_function, const char* extension_name,
-      std::vector<std::string>* output) {
+      bool required, std::vector<std::string>* output) {
     auto raw_enumerate_device_extension_properties_function =
         // Pass a valid instance, as following the spec. we are not allowed to use nullptr here.
         absl::bit_cast<PFN_vkEnumerateDeviceExtensionProperties>(
@@ -697,8 +736,46 @@ class VulkanLayerController {
       return raw_enumerate_device_extension_properties_function(physical_device, nullptr, count,
                                                                 properties);
     };
-    AddRequiredExtensionNameIfMissing(create_info, enumerate_device_extension_properties,
-                                      extension_name, output);
+    AddExtensionNameIfMissing(create_info, enumerate_device_extension_properties, extension_name,
+                              required, output);
+  }
+
+  // Enables the `pipelineStatisticsQuery` feature in `create_info` if the physical device supports
+  // it, and returns whether the feature will be enabled on the device. `enabled_features` needs to
+  // stay alive until the device is created. If the features are given with a
+  // `VkPhysicalDeviceFeatures2` in the `pNext` chain (which we must not modify), the feature is
+  // only enabled if the game enabled it itself.
+  [[nodiscard]] bool EnablePipelineStatisticsQueryFeatureIfSupported(
+      VkPhysicalDevice physical_device,
+      PFN_vkGetInstanceProcAddr next_get_instance_proc_addr_function,
+      VkDeviceCreateInfo* create_info, VkPhysicalDeviceFeatures* enabled_features) {
+    auto get_physical_device_features_function = absl::bit_cast<PFN_vkGetPhysicalDeviceFeatures>(
+        next_get_instance_proc_addr_function(dispatch_table_.GetInstance(physical_device),
+                                             "vkGetPhysicalDeviceFeatures"));
+    if (get_physical_device_features_function == nullptr) {
+      return false;
+    }
+    VkPhysicalDeviceFeatures supported_features{};
+    get_physical_device_features_function(physical_device, &supported_features);
+    if (supported_features.pipelineStatisticsQuery != VK_TRUE) {
+      return false;
+    }
+
+    if (create_info->pEnabledFeatures == nullptr) {
+      auto* next = absl::bit_cast<const VkBaseInStructure*>(create_info->pNext);
+      while (next != nullptr && next->sType != VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2) {
+        next = next->pNext;
+      }
+      if (next != nullptr) {
+        return absl::bit_cast<const VkPhysicalDeviceFeatures2*>(next)
+                   ->features.pipelineStatisticsQuery == VK_TRUE;
+      }
+    } else {
+      *enabled_features = *create_info->pEnabledFeatures;
+    }
+    enabled_features->pipelineStatisticsQuery = VK_TRUE;
+    create_info->pEnabledFeatures = enabled_features;
+    return true;
   }
 
   void AddRequiredInstanceExtensionNameIfMissing(const VkInstanceCreateInfo* create_info,
@@ -709,8 +786,8 @@ class VulkanLayerController {
         [this](uint32_t* count, VkExtensionProperties* properties) -> VkResult {
       return vulkan_wrapper_.CallVkEnumerateInstanceExtensionProperties(nullptr, count, properties);
     };
-    AddRequiredExtensionNameIfMissing(create_info, enumerate_instance_extension_properties,
-                                      extension_name, output);
+    AddExtensionNameIfMissing(create_info, enumerate_instance_extension_properties, extension_name,
+                              /*required=*/true, output);
   }
 
   std::unique_ptr<VulkanLayerProducer> vulkan_layer_producer_ = nullptr;
@@ -719,12 +796,15 @@ class VulkanLayerController {
   DispatchTable dispatch_table_;
   DeviceManager device_manager_;
   TimerQueryPool timer_query_pool_;
+  TimerQueryPool pipeline_statistics_query_pool_;
   SubmissionTracker submission_tracker_;
   QueueManager queue_manager_;
   VulkanWrapper vulkan_wrapper_;
 
   // The number of timer query slots is chosen arbitrary such that it is large enough.
   static constexpr uint32_t kNumTimerQuerySlots = 131072;
+  // At most one pipeline statistics query is active per command buffer, so fewer slots suffice.
+  static constexpr uint32_t kNumPipelineStatisticsQuerySlots = 4096;
 };
 
 }  // namespace orbit_vulkan_layer
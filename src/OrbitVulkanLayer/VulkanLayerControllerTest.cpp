@@ -9,6 +9,7 @@
 #include "VulkanLayerController.h"
 #include "VulkanLayerProducer.h"
 
+using ::testing::_;
 using ::testing::A;
 using ::testing::AllOf;
 using ::testing::Const;
@@ -43,6 +44,7 @@ class MockDispatchTable {
   MOCK_METHOD(PFN_vkBeginCommandBuffer, BeginCommandBuffer, (VkCommandBuffer));
   MOCK_METHOD(PFN_vkEndCommandBuffer, EndCommandBuffer, (VkCommandBuffer));
   MOCK_METHOD(PFN_vkResetCommandBuffer, ResetCommandBuffer, (VkCommandBuffer));
+  MOCK_METHOD(PFN_vkCmdExecuteCommands, CmdExecuteCommands, (VkCommandBuffer));
   MOCK_METHOD(PFN_vkGetDeviceQueue, GetDeviceQueue, (VkDevice));
   MOCK_METHOD(PFN_vkGetDeviceQueue2, GetDeviceQueue2, (VkDevice));
   MOCK_METHOD(PFN_vkQueueSubmit, QueueSubmit, (VkQueue));
@@ -91,9 +93,12 @@ class MockQueueManager {
 
 class MockTimerQueryPool {
  public:
-  explicit MockTimerQueryPool(MockDispatchTable* /*dispatch_table*/, uint32_t /*num_slots*/) {}
+  explicit MockTimerQueryPool(MockDispatchTable* /*dispatch_table*/, uint32_t /*num_slots*/,
+                              VkQueryType /*query_type*/ = VK_QUERY_TYPE_TIMESTAMP,
+                              VkQueryPipelineStatisticFlags /*pipeline_statistics*/ = 0) {}
   MOCK_METHOD(void, InitializeTimerQueryPool, (VkDevice));
   MOCK_METHOD(void, DestroyTimerQueryPool, (VkDevice));
+  MOCK_METHOD(bool, IsInitialized, (VkDevice));
 };
 
 struct Color {
@@ -107,18 +112,23 @@ class MockSubmissionTracker {
  public:
   struct QueueSubmission {};
 
+  static constexpr VkQueryPipelineStatisticFlags kPipelineStatisticFlags =
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT;
+
   explicit MockSubmissionTracker(MockDispatchTable* /*dispatch_table*/,
                                  MockTimerQueryPool* /*timer_query_pool*/,
-                                 MockDeviceManager* /*device_manager*/, uint32_t /*max_depth*/) {}
+                                 MockDeviceManager* /*device_manager*/, uint32_t /*max_depth*/,
+                                 MockTimerQueryPool* /*pipeline_statistics_query_pool*/) {}
   MOCK_METHOD(void, SetVulkanLayerProducer, (VulkanLayerProducer*));
   MOCK_METHOD(void, ResetCommandPool, (VkCommandPool));
   MOCK_METHOD(void, TrackCommandBuffers,
-              (VkDevice, VkCommandPool, const VkCommandBuffer*, uint32_t));
+              (VkDevice, VkCommandPool, const VkCommandBuffer*, uint32_t, VkCommandBufferLevel));
   MOCK_METHOD(void, UntrackCommandBuffers,
               (VkDevice, VkCommandPool, const VkCommandBuffer*, uint32_t));
   MOCK_METHOD(void, MarkCommandBufferBegin, (VkCommandBuffer));
   MOCK_METHOD(void, MarkCommandBufferEnd, (VkCommandBuffer));
   MOCK_METHOD(void, ResetCommandBuffer, (VkCommandBuffer));
+  MOCK_METHOD(void, MarkExecuteCommands, (VkCommandBuffer, uint32_t, const VkCommandBuffer*));
   MOCK_METHOD(std::optional<QueueSubmission>, PersistCommandBuffersOnSubmit,
               (VkQueue, uint32_t, const VkSubmitInfo* submits));
   MOCK_METHOD(void, PersistDebugMarkersOnSubmit,
@@ -687,6 +697,85 @@ TEST_F(VulkanLayerControllerTest,
   EXPECT_EQ(result, VK_SUCCESS);
 }
 
+TEST_F(VulkanLayerControllerTest, WillEnablePipelineStatisticsQueryOnCreateDeviceIfSupported) {
+  const MockDispatchTable* dispatch_table = controller_.dispatch_table();
+  EXPECT_CALL(*dispatch_table, CreateDeviceDispatchTable).Times(1);
+  const MockDeviceManager* device_manager = controller_.device_manager();
+  EXPECT_CALL(*device_manager, TrackLogicalDevice).Times(1);
+  const MockTimerQueryPool* timer_query_pool = controller_.timer_query_pool();
+  EXPECT_CALL(*timer_query_pool, InitializeTimerQueryPool).Times(1);
+  const MockTimerQueryPool* pipeline_statistics_query_pool =
+      controller_.pipeline_statistics_query_pool();
+  EXPECT_CALL(*pipeline_statistics_query_pool, InitializeTimerQueryPool).Times(1);
+
+  static constexpr PFN_vkCreateDevice kMockDriverCreateDevice =
+      +[](VkPhysicalDevice /*physical_device*/, const VkDeviceCreateInfo* create_info,
+          const VkAllocationCallbacks* /*allocator*/, VkDevice* /*instance*/) {
+        EXPECT_NE(create_info->pEnabledFeatures, nullptr);
+        EXPECT_EQ(create_info->pEnabledFeatures->pipelineStatisticsQuery, VK_TRUE);
+        // The features the game enabled are kept.
+        EXPECT_EQ(create_info->pEnabledFeatures->geometryShader, VK_TRUE);
+        return VK_SUCCESS;
+      };
+  static constexpr PFN_vkEnumerateDeviceExtensionProperties
+      kFakeEnumerateDeviceExtensionProperties =
+          +[](VkPhysicalDevice /*physical_device*/, const char* /*layer_name*/,
+              uint32_t* property_count, VkExtensionProperties* properties) -> VkResult {
+    CHECK(property_count != nullptr);
+    if (properties == nullptr) {
+      *property_count = 1;
+      return VK_SUCCESS;
+    }
+    VkExtensionProperties p{VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME,
+                            VK_EXT_HOST_QUERY_RESET_SPEC_VERSION};
+    *properties = p;
+    return VK_SUCCESS;
+  };
+  static constexpr PFN_vkGetPhysicalDeviceFeatures kFakeGetPhysicalDeviceFeatures =
+      +[](VkPhysicalDevice /*physical_device*/, VkPhysicalDeviceFeatures* features) {
+        *features = {};
+        features->pipelineStatisticsQuery = VK_TRUE;
+        features->geometryShader = VK_TRUE;
+      };
+
+  PFN_vkGetDeviceProcAddr fake_get_device_proc_addr =
+      +[](VkDevice /*device*/, const char * /*name*/) -> PFN_vkVoidFunction { return nullptr; };
+
+  PFN_vkGetInstanceProcAddr fake_get_instance_proc_addr =
+      +[](VkInstance /*instance*/, const char* name) -> PFN_vkVoidFunction {
+    if (strcmp(name, "vkCreateDevice") == 0) {
+      return absl::bit_cast<PFN_vkVoidFunction>(kMockDriverCreateDevice);
+    }
+    if (strcmp(name, "vkEnumerateDeviceExtensionProperties") == 0) {
+      return absl::bit_cast<PFN_vkVoidFunction>(kFakeEnumerateDeviceExtensionProperties);
+    }
+    if (strcmp(name, "vkGetPhysicalDeviceFeatures") == 0) {
+      return absl::bit_cast<PFN_vkVoidFunction>(kFakeGetPhysicalDeviceFeatures);
+    }
+    return nullptr;
+  };
+
+  VkLayerDeviceLink layer_link_1 = {.pfnNextGetInstanceProcAddr = fake_get_instance_proc_addr,
+                                    .pfnNextGetDeviceProcAddr = fake_get_device_proc_addr};
+  VkLayerDeviceCreateInfo layer_create_info{.sType = VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO,
+                                            .function = VK_LAYER_LINK_INFO};
+  layer_create_info.u.pLayerInfo = &layer_link_1;
+  VkPhysicalDeviceFeatures requested_features{};
+  requested_features.geometryShader = VK_TRUE;
+  VkDeviceCreateInfo create_info{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                 .pNext = &layer_create_info,
+                                 .enabledExtensionCount = 0,
+                                 .ppEnabledExtensionNames = nullptr,
+                                 .pEnabledFeatures = &requested_features};
+  VkDevice created_device;
+  VkPhysicalDevice physical_device = {};
+  VkResult result =
+      controller_.OnCreateDevice(physical_device, &create_info, nullptr, &created_device);
+  EXPECT_EQ(result, VK_SUCCESS);
+  // The game's create info is not modified.
+  EXPECT_EQ(requested_features.pipelineStatisticsQuery, VK_FALSE);
+}
+
 TEST_F(VulkanLayerControllerTest, CallInDispatchTableOnGetInstanceProcAddr) {
   const MockDispatchTable* dispatch_table = controller_.dispatch_table();
   static constexpr PFN_vkVoidFunction kExpectedFunction = +[]() {};
@@ -722,6 +811,10 @@ TEST_F(VulkanLayerControllerTest, WillCleanUpOnDestroyDevice) {
   EXPECT_CALL(*device_manager, UntrackLogicalDevice).Times(1);
   const MockTimerQueryPool* query_pool = controller_.timer_query_pool();
   EXPECT_CALL(*query_pool, DestroyTimerQueryPool).Times(1);
+  const MockTimerQueryPool* pipeline_statistics_query_pool =
+      controller_.pipeline_statistics_query_pool();
+  EXPECT_CALL(*pipeline_statistics_query_pool, IsInitialized).WillOnce(Return(true));
+  EXPECT_CALL(*pipeline_statistics_query_pool, DestroyTimerQueryPool).Times(1);
 
   VkDevice device = {};
 
@@ -759,7 +852,9 @@ TEST_F(VulkanLayerControllerTest, ForwardsOnAllocateCommandBuffersToSubmissionTr
       .WillOnce(Return(fake_allocate_command_buffers));
 
   const MockSubmissionTracker* submission_tracker = controller_.submission_tracker();
-  EXPECT_CALL(*submission_tracker, TrackCommandBuffers).Times(1);
+  EXPECT_CALL(*submission_tracker,
+              TrackCommandBuffers(_, _, _, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY))
+      .Times(1);
   VkDevice device = {};
   VkCommandPool command_pool = {};
   VkCommandBuffer command_buffer;
@@ -767,6 +862,7 @@ TEST_F(VulkanLayerControllerTest, ForwardsOnAllocateCommandBuffersToSubmissionTr
   VkCommandBufferAllocateInfo allocate_info{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
                                             .pNext = nullptr,
                                             .commandPool = command_pool,
+                                            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
                                             .commandBufferCount = 1};
 
   VkResult result = controller_.OnAllocateCommandBuffers(device, &allocate_info, &command_buffer);
@@ -838,6 +934,22 @@ TEST_F(VulkanLayerControllerTest, ForwardsOnResetCommandBufferToSubmissionTracke
   EXPECT_EQ(result, VK_SUCCESS);
 }
 
+TEST_F(VulkanLayerControllerTest, ForwardsOnCmdExecuteCommandsToSubmissionTracker) {
+  PFN_vkCmdExecuteCommands fake_cmd_execute_commands =
+      +[](VkCommandBuffer /*command_buffer*/, uint32_t /*command_buffer_count*/,
+          const VkCommandBuffer* /*command_buffers*/) {};
+  const MockDispatchTable* dispatch_table = controller_.dispatch_table();
+  EXPECT_CALL(*dispatch_table, CmdExecuteCommands)
+      .Times(1)
+      .WillOnce(Return(fake_cmd_execute_commands));
+
+  const MockSubmissionTracker* submission_tracker = controller_.submission_tracker();
+  EXPECT_CALL(*submission_tracker, MarkExecuteCommands).Times(1);
+  VkCommandBuffer command_buffer = {};
+  VkCommandBuffer secondary_command_buffer = {};
+  controller_.OnCmdExecuteCommands(command_buffer, 1, &secondary_command_buffer);
+}
+
 TEST_F(VulkanLayerControllerTest, ForwardsOnGetDeviceQueueToQueueManager) {
   PFN_vkGetDeviceQueue fake_get_device_queue =
       +[](VkDevice /*device*/, uint32_t /*queue_family_index*/, uint32_t /*queue_index*/,
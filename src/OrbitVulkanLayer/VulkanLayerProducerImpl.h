@@ -9,6 +9,7 @@
 #include <google/protobuf/arena.h>
 
 #include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "ProducerSideChannel/ProducerSideChannel.h"
 #include "VulkanLayerProducer.h"
 
 namespace orbit_vulkan_layer {
@@ -19,6 +20,8 @@ namespace orbit_vulkan_layer {
 class VulkanLayerProducerImpl : public VulkanLayerProducer {
  public:
   void BringUp(const std::shared_ptr<grpc::Channel>& channel) override {
+    lock_free_producer_.EnableSharedMemoryTransport(
+        orbit_producer_side_channel::kProducerSideSharedMemoryBufferCapacityBytes);
     return lock_free_producer_.BuildAndStart(channel);
   }
 
@@ -0,0 +1,226 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+#include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <system_error>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_producer_side_channel {
+
+namespace {
+
+constexpr const char* kMemoryFileName = "orbit_producer_side_buffer";
+constexpr uint64_t kMagic = 0x4f52424954534852;  // "ORBITSHR"
+constexpr uint64_t kMessageHeaderSize = sizeof(uint64_t);
+// Written instead of a message size when the next message didn't fit before the end of the
+// buffer, and was written at the beginning instead.
+constexpr uint64_t kWrapAroundMarker = std::numeric_limits<uint64_t>::max();
+
+[[nodiscard]] constexpr uint64_t RoundUpToMultipleOf8(uint64_t value) {
+  return (value + 7) & ~uint64_t{7};
+}
+
+}  // namespace
+
+// The indices only ever increase: the offset in the data is the index modulo the capacity, and the
+// difference between write_index and read_index is the number of bytes in use. They are on
+// separate cache lines as they are written by different processes.
+struct SharedMemoryRingBuffer::Header {
+  std::atomic<uint64_t> magic;
+  alignas(64) std::atomic<uint64_t> write_index;
+  alignas(64) std::atomic<uint64_t> read_index;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Atomics in shared memory must be lock-free to work across processes");
+
+SharedMemoryRingBuffer::SharedMemoryRingBuffer(orbit_base::unique_fd fd, void* mapping,
+                                               uint64_t mapping_size)
+    : fd_{std::move(fd)},
+      mapping_{mapping},
+      mapping_size_{mapping_size},
+      header_{static_cast<Header*>(mapping)},
+      data_{static_cast<char*>(mapping) + sizeof(Header)},
+      capacity_{mapping_size - sizeof(Header)} {}
+
+SharedMemoryRingBuffer::~SharedMemoryRingBuffer() {
+  if (munmap(mapping_, mapping_size_) != 0) {
+    ERROR("Unmapping shared memory ring buffer: %s", SafeStrerror(errno));
+  }
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> SharedMemoryRingBuffer::Create(
+    uint64_t capacity_bytes) {
+  CHECK(capacity_bytes > 0);
+  const uint64_t mapping_size = sizeof(Header) + RoundUpToMultipleOf8(capacity_bytes);
+
+  orbit_base::unique_fd fd{memfd_create(kMemoryFileName, MFD_CLOEXEC)};
+  if (!fd.valid()) {
+    return ErrorMessage{absl::StrFormat("Unable to create memory file: %s", SafeStrerror(errno))};
+  }
+  if (ftruncate(fd.get(), static_cast<off_t>(mapping_size)) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to resize memory file: %s", SafeStrerror(errno))};
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("Unable to map memory file: %s", SafeStrerror(errno))};
+  }
+
+  // The file is zero-initialized, but the atomics still need to be constructed.
+  Header* header = new (mapping) Header{};
+  header->magic.store(kMagic, std::memory_order_release);
+  return std::unique_ptr<SharedMemoryRingBuffer>{
+      new SharedMemoryRingBuffer{std::move(fd), mapping, mapping_size}};
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> SharedMemoryRingBuffer::Open(
+    const std::filesystem::path& path) {
+  orbit_base::unique_fd fd{open(path.c_str(), O_RDWR | O_CLOEXEC)};
+  if (!fd.valid()) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to open \"%s\": %s", path.string(), SafeStrerror(errno))};
+  }
+  // Derive the capacity from the size of the file and not from the content of the header, so that
+  // the producer can't make the consumer access memory outside of the mapping.
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to stat \"%s\": %s", path.string(), SafeStrerror(errno))};
+  }
+  const auto mapping_size = static_cast<uint64_t>(file_stat.st_size);
+  if (mapping_size <= sizeof(Header) || mapping_size % 8 != 0) {
+    return ErrorMessage{absl::StrFormat("\"%s\" is not a shared memory ring buffer: size %u",
+                                        path.string(), mapping_size)};
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to map \"%s\": %s", path.string(), SafeStrerror(errno))};
+  }
+
+  std::unique_ptr<SharedMemoryRingBuffer> buffer{
+      new SharedMemoryRingBuffer{orbit_base::unique_fd{}, mapping, mapping_size}};
+  if (buffer->header_->magic.load(std::memory_order_acquire) != kMagic) {
+    return ErrorMessage{
+        absl::StrFormat("\"%s\" is not a shared memory ring buffer: wrong magic", path.string())};
+  }
+  return buffer;
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> SharedMemoryRingBuffer::OpenFromProcess(
+    pid_t pid, int fd) {
+  const std::filesystem::path path = absl::StrFormat("/proc/%d/fd/%d", pid, fd);
+  // Only map memory files created by Create, and not any other file the process might have open.
+  std::error_code error;
+  const std::filesystem::path target = std::filesystem::read_symlink(path, error);
+  if (error) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to read link \"%s\": %s", path.string(), error.message())};
+  }
+  if (!absl::StartsWith(target.string(), absl::StrCat("/memfd:", kMemoryFileName))) {
+    return ErrorMessage{absl::StrFormat("\"%s\" is not a shared memory ring buffer but \"%s\"",
+                                        path.string(), target.string())};
+  }
+  return Open(path);
+}
+
+uint64_t SharedMemoryRingBuffer::GetMaxMessageSize() const {
+  return capacity_ - kMessageHeaderSize;
+}
+
+bool SharedMemoryRingBuffer::TryWrite(uint64_t size, absl::FunctionRef<void(char* data)> write) {
+  if (size > GetMaxMessageSize()) {
+    return false;
+  }
+  const uint64_t message_size = kMessageHeaderSize + RoundUpToMultipleOf8(size);
+
+  // Only this thread writes write_index.
+  uint64_t write_index = header_->write_index.load(std::memory_order_relaxed);
+  const uint64_t read_index = header_->read_index.load(std::memory_order_acquire);
+  uint64_t offset = write_index % capacity_;
+  const uint64_t padding = offset + message_size > capacity_ ? capacity_ - offset : 0;
+  const uint64_t free_size = capacity_ - (write_index - read_index);
+  if (padding + message_size > free_size) {
+    return false;
+  }
+
+  if (padding > 0) {
+    std::memcpy(data_ + offset, &kWrapAroundMarker, sizeof(kWrapAroundMarker));
+    write_index += padding;
+    offset = 0;
+  }
+  std::memcpy(data_ + offset, &size, sizeof(size));
+  write(data_ + offset + kMessageHeaderSize);
+  // Publish the message only once it has been completely written.
+  header_->write_index.store(write_index + message_size, std::memory_order_release);
+  return true;
+}
+
+bool SharedMemoryRingBuffer::TryRead(
+    absl::FunctionRef<void(const char* data, uint64_t size)> read) {
+  if (corrupted_) {
+    return false;
+  }
+  // Only this thread writes read_index.
+  uint64_t read_index = header_->read_index.load(std::memory_order_relaxed);
+  const uint64_t write_index = header_->write_index.load(std::memory_order_acquire);
+  if (write_index - read_index > capacity_) {
+    ERROR("Shared memory ring buffer is corrupted: %u bytes in use", write_index - read_index);
+    corrupted_ = true;
+    return false;
+  }
+
+  while (read_index != write_index) {
+    const uint64_t available_size = write_index - read_index;
+    const uint64_t offset = read_index % capacity_;
+    uint64_t size = 0;
+    std::memcpy(&size, data_ + offset, sizeof(size));
+
+    if (size == kWrapAroundMarker) {
+      if (capacity_ - offset > available_size) {
+        ERROR("Shared memory ring buffer is corrupted: wrap-around past the written data");
+        corrupted_ = true;
+        return false;
+      }
+      read_index += capacity_ - offset;
+      header_->read_index.store(read_index, std::memory_order_release);
+      continue;
+    }
+
+    if (size > GetMaxMessageSize()) {
+      ERROR("Shared memory ring buffer is corrupted: message of %u bytes", size);
+      corrupted_ = true;
+      return false;
+    }
+    const uint64_t message_size = kMessageHeaderSize + RoundUpToMultipleOf8(size);
+    if (message_size > available_size || offset + message_size > capacity_) {
+      ERROR("Shared memory ring buffer is corrupted: message of %u bytes", size);
+      corrupted_ = true;
+      return false;
+    }
+    read(data_ + offset + kMessageHeaderSize, size);
+    // Only free the room once the message has been completely read.
+    header_->read_index.store(read_index + message_size, std::memory_order_release);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace orbit_producer_side_channel
@@ -0,0 +1,129 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Result.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+namespace orbit_producer_side_channel {
+
+namespace {
+
+[[nodiscard]] bool TryWriteString(SharedMemoryRingBuffer* buffer, const std::string& message) {
+  return buffer->TryWrite(message.size(), [&message](char* data) {
+    std::memcpy(data, message.data(), message.size());
+  });
+}
+
+[[nodiscard]] std::optional<std::string> TryReadString(SharedMemoryRingBuffer* buffer) {
+  std::string message;
+  if (!buffer->TryRead(
+          [&message](const char* data, uint64_t size) { message.assign(data, size); })) {
+    return std::nullopt;
+  }
+  return message;
+}
+
+[[nodiscard]] std::unique_ptr<SharedMemoryRingBuffer> CreateBuffer(uint64_t capacity) {
+  auto buffer_or_error = SharedMemoryRingBuffer::Create(capacity);
+  CHECK(buffer_or_error.has_value());
+  return std::move(buffer_or_error.value());
+}
+
+}  // namespace
+
+TEST(SharedMemoryRingBuffer, ReadsMessagesInOrder) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBuffer(1024);
+  EXPECT_FALSE(TryReadString(buffer.get()).has_value());
+
+  ASSERT_TRUE(TryWriteString(buffer.get(), "first"));
+  ASSERT_TRUE(TryWriteString(buffer.get(), ""));
+  ASSERT_TRUE(TryWriteString(buffer.get(), "third message"));
+
+  EXPECT_EQ(TryReadString(buffer.get()), "first");
+  EXPECT_EQ(TryReadString(buffer.get()), "");
+  EXPECT_EQ(TryReadString(buffer.get()), "third message");
+  EXPECT_FALSE(TryReadString(buffer.get()).has_value());
+}
+
+TEST(SharedMemoryRingBuffer, RejectsMessagesThatDontFit) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBuffer(64);
+  EXPECT_FALSE(TryWriteString(buffer.get(), std::string(buffer->GetMaxMessageSize() + 1, 'a')));
+
+  // Each message takes 8 bytes of header and 24 bytes of data.
+  ASSERT_TRUE(TryWriteString(buffer.get(), std::string(24, 'a')));
+  ASSERT_TRUE(TryWriteString(buffer.get(), std::string(24, 'b')));
+  EXPECT_FALSE(TryWriteString(buffer.get(), "c"));
+
+  EXPECT_EQ(TryReadString(buffer.get()), std::string(24, 'a'));
+  EXPECT_TRUE(TryWriteString(buffer.get(), "c"));
+}
+
+TEST(SharedMemoryRingBuffer, WrapsAround) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBuffer(64);
+  for (int i = 0; i < 100; ++i) {
+    // 40 bytes per message, so that most messages don't fit before the end of the buffer.
+    std::string message = absl::StrFormat("%032d", i);
+    ASSERT_TRUE(TryWriteString(buffer.get(), message));
+    EXPECT_EQ(TryReadString(buffer.get()), message);
+  }
+}
+
+TEST(SharedMemoryRingBuffer, IsSharedWithOpenedBuffer) {
+  std::unique_ptr<SharedMemoryRingBuffer> producer_buffer = CreateBuffer(1024);
+  auto consumer_buffer_or_error =
+      SharedMemoryRingBuffer::OpenFromProcess(getpid(), producer_buffer->fd());
+  ASSERT_TRUE(consumer_buffer_or_error.has_value()) << consumer_buffer_or_error.error().message();
+  std::unique_ptr<SharedMemoryRingBuffer> consumer_buffer =
+      std::move(consumer_buffer_or_error.value());
+  EXPECT_EQ(consumer_buffer->capacity(), producer_buffer->capacity());
+
+  ASSERT_TRUE(TryWriteString(producer_buffer.get(), "message"));
+  EXPECT_EQ(TryReadString(consumer_buffer.get()), "message");
+  EXPECT_FALSE(TryReadString(producer_buffer.get()).has_value());
+}
+
+TEST(SharedMemoryRingBuffer, OpenFailsForOtherFiles) {
+  EXPECT_TRUE(SharedMemoryRingBuffer::Open("/proc/self/cmdline").has_error());
+  EXPECT_TRUE(SharedMemoryRingBuffer::Open("/does/not/exist").has_error());
+  // File descriptor 0 is standard input, not a memory file.
+  EXPECT_TRUE(SharedMemoryRingBuffer::OpenFromProcess(getpid(), 0).has_error());
+}
+
+TEST(SharedMemoryRingBuffer, ProducerAndConsumerThreads) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBuffer(256);
+  constexpr uint64_t kMessageCount = 100'000;
+
+  std::thread producer{[&buffer] {
+    for (uint64_t i = 0; i < kMessageCount; ++i) {
+      std::string message(i % 50, static_cast<char>('a' + i % 26));
+      while (!TryWriteString(buffer.get(), message)) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  for (uint64_t i = 0; i < kMessageCount; ++i) {
+    std::optional<std::string> message;
+    while (!(message = TryReadString(buffer.get())).has_value()) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(message.value(), std::string(i % 50, static_cast<char>('a' + i % 26)));
+  }
+  producer.join();
+  EXPECT_FALSE(TryReadString(buffer.get()).has_value());
+}
+
+}  // namespace orbit_producer_side_channel
@@ -8,6 +8,7 @@
 #include <absl/strings/str_format.h>
 #include <grpcpp/grpcpp.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -17,6 +18,10 @@ namespace orbit_producer_side_channel {
 // between producers of CaptureEvents and OrbitService.
 constexpr std::string_view kProducerSideUnixDomainSocketPath = "/tmp/orbit-producer-side-socket";
 
+// This is the capacity of the SharedMemoryRingBuffer that producers of many CaptureEvents offer to
+// OrbitService, so that the events don't need to go through the socket.
+constexpr uint64_t kProducerSideSharedMemoryBufferCapacityBytes = 16 * 1024 * 1024;
+
 // This function returns a gRPC channel that uses a Unix domain socket,
 // by default the one specified by kProducerSideUnixDomainSocketPath.
 inline std::shared_ptr<grpc::Channel> CreateProducerSideChannel(
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
+#define ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <absl/functional/function_ref.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_producer_side_channel {
+
+// A single-producer single-consumer ring buffer of variable-size messages in memory shared between
+// two processes, which lets producers of CaptureEvents pass them to OrbitService without copying
+// them through a socket.
+// The producer creates the buffer in an anonymous memory file, which the consumer, running as root,
+// maps through /proc/<pid>/fd/<fd>. The memory is released when both processes have unmapped it.
+// TryWrite must only ever be called from one thread at a time, and so must TryRead.
+// The consumer doesn't trust the content of the buffer beyond the individual messages: a corrupted
+// buffer only causes TryRead to fail.
+class SharedMemoryRingBuffer {
+ public:
+  ~SharedMemoryRingBuffer();
+  SharedMemoryRingBuffer(const SharedMemoryRingBuffer&) = delete;
+  SharedMemoryRingBuffer& operator=(const SharedMemoryRingBuffer&) = delete;
+
+  // Creates a buffer that can hold capacity_bytes of messages, including a header of 8 bytes each.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> Create(
+      uint64_t capacity_bytes);
+  // Maps the buffer created by another process, or by this process for path /proc/self/fd/<fd>.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> Open(
+      const std::filesystem::path& path);
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> OpenFromProcess(
+      pid_t pid, int fd);
+
+  // Only valid for the buffer returned by Create.
+  [[nodiscard]] int fd() const { return fd_.get(); }
+  [[nodiscard]] uint64_t capacity() const { return capacity_; }
+
+  // Reserves size bytes for a message and passes them to write, which must fill them. Returns false
+  // without calling write if there currently isn't room for the message. Messages larger than
+  // GetMaxMessageSize never fit.
+  [[nodiscard]] bool TryWrite(uint64_t size, absl::FunctionRef<void(char* data)> write);
+  // Passes the oldest message to read and then frees its room. The pointer is only valid during the
+  // call. Returns false if there is no message, or if the buffer is corrupted, which is logged once
+  // and makes all further calls fail.
+  [[nodiscard]] bool TryRead(absl::FunctionRef<void(const char* data, uint64_t size)> read);
+
+  [[nodiscard]] uint64_t GetMaxMessageSize() const;
+
+ private:
+  struct Header;
+
+  SharedMemoryRingBuffer(orbit_base::unique_fd fd, void* mapping, uint64_t mapping_size);
+
+  orbit_base::unique_fd fd_;
+  void* mapping_;
+  uint64_t mapping_size_;
+  Header* header_;
+  char* data_;
+  uint64_t capacity_;
+  bool corrupted_ = false;
+};
+
+}  // namespace orbit_producer_side_channel
+
+#endif  // ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
@@ -5,17 +5,28 @@
 #ifndef ORBIT_SERVICE_CAPTURE_EVENT_BUFFER_H_
 #define ORBIT_SERVICE_CAPTURE_EVENT_BUFFER_H_
 
+#include <utility>
+#include <vector>
+
 #include "capture.pb.h"
 
 namespace orbit_service {
 
 // Interface used to buffer CaptureEvents so that multiple CaptureEvents
 // can be processed at the same time (e.g., grouped into fewer bigger CaptureResponses).
-// AddEvent is to be assumed thread safe.
+// AddEvent and AddEvents are to be assumed thread safe.
 class CaptureEventBuffer {
  public:
   virtual ~CaptureEventBuffer() = default;
   virtual void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) = 0;
+
+  // Adds multiple CaptureEvents at once, which implementations can use to avoid synchronizing
+  // for each CaptureEvent.
+  virtual void AddEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) {
+    for (orbit_grpc_protos::ClientCaptureEvent& event : events) {
+      AddEvent(std::move(event));
+    }
+  }
 };
 
 }  // namespace orbit_service
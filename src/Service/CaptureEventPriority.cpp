@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureEventPriority.h"
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+CaptureEventPriority GetCaptureEventPriority(ClientCaptureEvent::EventCase event_case) {
+  switch (event_case) {
+    case ClientCaptureEvent::kIntrospectionScope:
+    case ClientCaptureEvent::kMemoryUsageEvent:
+    case ClientCaptureEvent::kPmuCountersSample:
+    case ClientCaptureEvent::kSchedulingSlice:
+    case ClientCaptureEvent::kSchedulingSliceBatch:
+    case ClientCaptureEvent::kThreadStateSlice:
+    case ClientCaptureEvent::kTracepointEvent:
+      return CaptureEventPriority::kLow;
+    case ClientCaptureEvent::kCallstackSample:
+    case ClientCaptureEvent::kCallstackSampleBatch:
+      return CaptureEventPriority::kMedium;
+    case ClientCaptureEvent::kAddressInfo:
+    case ClientCaptureEvent::kApiEvent:
+    case ClientCaptureEvent::kCompactApiEvent:
+    case ClientCaptureEvent::kFunctionCall:
+    case ClientCaptureEvent::kFunctionCallBatch:
+    case ClientCaptureEvent::kGpuJob:
+    case ClientCaptureEvent::kGpuQueueSubmission:
+    case ClientCaptureEvent::kPipelineLatencyProbe:
+    case ClientCaptureEvent::kServiceHealthEvent:
+    case ClientCaptureEvent::kThreadName:
+      return CaptureEventPriority::kHigh;
+    case ClientCaptureEvent::kCaptureFinished:
+    case ClientCaptureEvent::kCaptureStartLatencyEvent:
+    case ClientCaptureEvent::kCaptureStarted:
+    case ClientCaptureEvent::kCaptureStatisticsSummary:
+    case ClientCaptureEvent::kClockResolutionEvent:
+    case ClientCaptureEvent::kErrorEnablingOrbitApiEvent:
+    case ClientCaptureEvent::kErrorsWithPerfEventOpenEvent:
+    case ClientCaptureEvent::kGpuClockCalibration:
+    case ClientCaptureEvent::kInternedCallstack:
+    case ClientCaptureEvent::kInternedString:
+    case ClientCaptureEvent::kInternedTracepointInfo:
+    case ClientCaptureEvent::kLostPerfRecordsEvent:
+    case ClientCaptureEvent::kModulesSnapshot:
+    case ClientCaptureEvent::kModuleUpdateEvent:
+    case ClientCaptureEvent::kOutOfOrderEventsDiscardedEvent:
+    case ClientCaptureEvent::kSamplingPeriodChangedEvent:
+    case ClientCaptureEvent::kThreadNamesSnapshot:
+    case ClientCaptureEvent::kWarningEvent:
+    case ClientCaptureEvent::EVENT_NOT_SET:
+      return CaptureEventPriority::kEssential;
+  }
+  UNREACHABLE();
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,23 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CAPTURE_EVENT_PRIORITY_H_
+#define ORBIT_SERVICE_CAPTURE_EVENT_PRIORITY_H_
+
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// How much a ClientCaptureEvent matters for the capture to be usable, for the CaptureEventBuffers
+// that can't keep all events to decide which ones to give up first. kEssential events are never
+// given up, as other events refer to them or the capture can't be interpreted without them, and
+// they are rare.
+enum class CaptureEventPriority { kLow, kMedium, kHigh, kEssential };
+
+[[nodiscard]] CaptureEventPriority GetCaptureEventPriority(
+    orbit_grpc_protos::ClientCaptureEvent::EventCase event_case);
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_CAPTURE_EVENT_PRIORITY_H_
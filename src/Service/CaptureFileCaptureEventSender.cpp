@@ -0,0 +1,67 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureFileCaptureEventSender.h"
+
+#include <utility>
+
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+CaptureFileCaptureEventSender::CaptureFileCaptureEventSender(
+    std::unique_ptr<orbit_capture_file::CaptureFileOutputStream> output_stream,
+    CaptureEventSender* client_event_sender)
+    : output_stream_{std::move(output_stream)}, client_event_sender_{client_event_sender} {
+  CHECK(output_stream_ != nullptr);
+  CHECK(client_event_sender_ != nullptr);
+}
+
+bool CaptureFileCaptureEventSender::IsForwardedToClient(ClientCaptureEvent::EventCase event_case) {
+  switch (event_case) {
+    case ClientCaptureEvent::kCaptureStartLatencyEvent:
+    case ClientCaptureEvent::kCaptureStarted:
+    case ClientCaptureEvent::kErrorEnablingOrbitApiEvent:
+    case ClientCaptureEvent::kErrorsWithPerfEventOpenEvent:
+    case ClientCaptureEvent::kWarningEvent:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void CaptureFileCaptureEventSender::SendEvents(std::vector<ClientCaptureEvent>&& events) {
+  ORBIT_SCOPE_FUNCTION;
+  std::vector<ClientCaptureEvent> events_for_client;
+  for (ClientCaptureEvent& event : events) {
+    if (!write_error_.has_value()) {
+      ErrorMessageOr<void> result = output_stream_->WriteCaptureEvent(event);
+      if (result.has_error()) {
+        ERROR("Writing capture file: %s", result.error().message());
+        write_error_ = result.error();
+      }
+    }
+    if (IsForwardedToClient(event.event_case())) {
+      events_for_client.emplace_back(std::move(event));
+    }
+  }
+  if (!events_for_client.empty()) {
+    client_event_sender_->SendEvents(std::move(events_for_client));
+  }
+}
+
+ErrorMessageOr<void> CaptureFileCaptureEventSender::Finish(
+    const ClientCaptureEvent& capture_finished_event) {
+  CHECK(capture_finished_event.event_case() == ClientCaptureEvent::kCaptureFinished);
+  if (write_error_.has_value()) {
+    return write_error_.value();
+  }
+  OUTCOME_TRY(output_stream_->WriteCaptureEvent(capture_finished_event));
+  return output_stream_->Close();
+}
+
+}  // namespace orbit_service
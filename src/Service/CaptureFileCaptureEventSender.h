@@ -0,0 +1,50 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CAPTURE_FILE_CAPTURE_EVENT_SENDER_H_
+#define ORBIT_SERVICE_CAPTURE_FILE_CAPTURE_EVENT_SENDER_H_
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// This CaptureEventSender writes the events to a capture file on the machine the service runs on,
+// so that neither the network nor the client are on the critical path of long captures. The few
+// events that the client needs to show the state of the ongoing capture (CaptureStarted, warnings
+// and errors) are also passed to client_event_sender.
+// Like for the other CaptureEventSenders, SendEvents is expected to always be called from the same
+// thread.
+class CaptureFileCaptureEventSender final : public CaptureEventSender {
+ public:
+  CaptureFileCaptureEventSender(
+      std::unique_ptr<orbit_capture_file::CaptureFileOutputStream> output_stream,
+      CaptureEventSender* client_event_sender);
+
+  void SendEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) override;
+
+  // Writes capture_finished_event, which is expected to be the last event, and closes the file.
+  // Returns the first error that occurred while writing the file, in which case the file has been
+  // deleted.
+  [[nodiscard]] ErrorMessageOr<void> Finish(
+      const orbit_grpc_protos::ClientCaptureEvent& capture_finished_event);
+
+  [[nodiscard]] static bool IsForwardedToClient(
+      orbit_grpc_protos::ClientCaptureEvent::EventCase event_case);
+
+ private:
+  std::unique_ptr<orbit_capture_file::CaptureFileOutputStream> output_stream_;
+  CaptureEventSender* client_event_sender_;
+  std::optional<ErrorMessage> write_error_;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_CAPTURE_FILE_CAPTURE_EVENT_SENDER_H_
@@ -0,0 +1,92 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "CaptureFileCaptureEventSender.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+class FakeCaptureEventSender final : public CaptureEventSender {
+ public:
+  void SendEvents(std::vector<ClientCaptureEvent>&& events) override {
+    for (ClientCaptureEvent& event : events) {
+      sent_events_.emplace_back(std::move(event));
+    }
+  }
+
+  [[nodiscard]] const std::vector<ClientCaptureEvent>& GetSentEvents() const {
+    return sent_events_;
+  }
+
+ private:
+  std::vector<ClientCaptureEvent> sent_events_;
+};
+
+}  // namespace
+
+TEST(CaptureFileCaptureEventSender, WritesAllEventsAndForwardsFewToClient) {
+  ErrorMessageOr<orbit_base::TemporaryFile> temporary_file_or_error =
+      orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  temporary_file.CloseAndRemove();
+
+  auto output_stream_or_error =
+      orbit_capture_file::CaptureFileOutputStream::Create(temporary_file.file_path());
+  ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+
+  FakeCaptureEventSender client_event_sender;
+  CaptureFileCaptureEventSender sender{std::move(output_stream_or_error.value()),
+                                       &client_event_sender};
+
+  std::vector<ClientCaptureEvent> events(4);
+  events[0].mutable_capture_started()->set_process_id(42);
+  events[1].mutable_scheduling_slice()->set_tid(42);
+  events[2].mutable_warning_event()->set_message("warning");
+  events[3].mutable_function_call()->set_tid(42);
+  sender.SendEvents(std::move(events));
+
+  ClientCaptureEvent capture_finished;
+  capture_finished.mutable_capture_finished();
+  ASSERT_FALSE(sender.Finish(capture_finished).has_error());
+
+  const std::vector<ClientCaptureEvent>& sent_events = client_event_sender.GetSentEvents();
+  ASSERT_EQ(sent_events.size(), 2);
+  EXPECT_EQ(sent_events[0].event_case(), ClientCaptureEvent::kCaptureStarted);
+  EXPECT_EQ(sent_events[1].event_case(), ClientCaptureEvent::kWarningEvent);
+
+  auto capture_file_or_error =
+      orbit_capture_file::CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  std::unique_ptr<orbit_capture_file::ProtoSectionInputStream> input_stream =
+      capture_file_or_error.value()->CreateCaptureSectionInputStream();
+  std::vector<ClientCaptureEvent::EventCase> written_event_cases;
+  for (int i = 0; i < 5; ++i) {
+    ClientCaptureEvent event;
+    ASSERT_FALSE(input_stream->ReadMessage(&event).has_error());
+    written_event_cases.push_back(event.event_case());
+  }
+  EXPECT_EQ(written_event_cases,
+            (std::vector<ClientCaptureEvent::EventCase>{
+                ClientCaptureEvent::kCaptureStarted, ClientCaptureEvent::kSchedulingSlice,
+                ClientCaptureEvent::kWarningEvent, ClientCaptureEvent::kFunctionCall,
+                ClientCaptureEvent::kCaptureFinished}));
+}
+
+}  // namespace orbit_service
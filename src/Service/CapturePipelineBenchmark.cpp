@@ -0,0 +1,362 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_set.h>
+#include <benchmark/benchmark.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureClient/CaptureEventProcessor.h"
+#include "CaptureClient/CaptureListener.h"
+#include "CaptureEventSender.h"
+#include "ColumnarEventBatches.h"
+#include "LinuxTracingHandler.h"
+#include "OrbitBase/Profiling.h"
+#include "ProducerEventProcessor.h"
+#include "SenderThreadCaptureEventBuffer.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+#include "services.pb.h"
+
+// This benchmark drives the capture pipeline of OrbitService with synthetic events, without a
+// target process nor a connection to a client:
+// LinuxTracingHandler -> ProducerEventProcessor -> SenderThreadCaptureEventBuffer ->
+// CaptureEventSender -> CaptureEventProcessor of the client.
+// The events are passed to LinuxTracingHandler from several threads, like the threads of the
+// Tracer do. The CaptureEventSender packs them into CaptureResponses and serializes them like the
+// gRPC sender, then parses them back and feeds them to the CaptureEventProcessor of the client.
+//
+// Besides events/s and bytes/s, each benchmark reports:
+// - produce_cpu_ns/event: CPU time of the producer threads, i.e., of LinuxTracingHandler,
+//   ProducerEventProcessor and of adding the events to SenderThreadCaptureEventBuffer;
+// - send_cpu_ns/event: CPU time spent packing and serializing the CaptureResponses;
+// - client_cpu_ns/event: CPU time spent parsing the CaptureResponses and processing the events on
+//   the client side;
+// - latency_mean_us and latency_max_us: time from the creation of an event to the moment the
+//   client delivers it to its CaptureListener.
+
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::LinuxAddressInfo;
+using orbit_client_protos::TimerInfo;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FullCallstackSample;
+using orbit_grpc_protos::FullGpuJob;
+using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::SchedulingSlice;
+
+namespace orbit_service {
+
+namespace {
+
+constexpr int64_t kEventCount = 200'000;
+// Like BatchingTracerListener, LinuxTracingHandler receives the most frequent events in batches.
+constexpr size_t kBatchSize = 256;
+constexpr int32_t kPid = 42;
+constexpr uint64_t kDistinctCallstackCount = 64;
+constexpr uint64_t kCallstackDepth = 24;
+
+[[nodiscard]] uint64_t GetThreadCpuTimeNs() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// The relative frequencies of the synthetic events.
+struct EventMix {
+  int64_t callstack_samples;
+  int64_t function_calls;
+  int64_t scheduling_slices;
+  int64_t gpu_jobs;
+};
+
+// Measures the latency of the events that reach the client as timers and callstack events. All
+// timestamps of the synthetic events are the time of their creation.
+class LatencyMeasuringCaptureListener : public orbit_capture_client::CaptureListener {
+ public:
+  [[nodiscard]] uint64_t GetEventCount() const { return event_count_; }
+  [[nodiscard]] uint64_t GetTotalLatencyNs() const { return total_latency_ns_; }
+  [[nodiscard]] uint64_t GetMaxLatencyNs() const { return max_latency_ns_; }
+
+ private:
+  void RecordLatency(uint64_t event_timestamp_ns) {
+    const uint64_t latency_ns = orbit_base::CaptureTimestampNs() - event_timestamp_ns;
+    ++event_count_;
+    total_latency_ns_ += latency_ns;
+    max_latency_ns_ = std::max(max_latency_ns_, latency_ns);
+  }
+
+  void OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& /*capture_started*/,
+                        std::optional<std::filesystem::path> /*file_path*/,
+                        absl::flat_hash_set<uint64_t> /*frame_track_function_ids*/) override {}
+  void OnCaptureFinished(const orbit_grpc_protos::CaptureFinished& /*capture_finished*/) override {}
+  void OnTimer(const TimerInfo& timer_info) override { RecordLatency(timer_info.end()); }
+  void OnKeyAndString(uint64_t /*key*/, std::string /*str*/) override {}
+  void OnUniqueCallstack(uint64_t /*callstack_id*/, CallstackInfo /*callstack*/) override {}
+  void OnCallstackEvent(CallstackEvent callstack_event) override {
+    RecordLatency(callstack_event.time());
+  }
+  void OnThreadName(int32_t /*thread_id*/, std::string /*thread_name*/) override {}
+  void OnThreadStateSlice(
+      orbit_client_protos::ThreadStateSliceInfo /*thread_state_slice*/) override {}
+  void OnAddressInfo(LinuxAddressInfo /*address_info*/) override {}
+  void OnUniqueTracepointInfo(uint64_t /*key*/,
+                              orbit_grpc_protos::TracepointInfo /*tracepoint_info*/) override {}
+  void OnTracepointEvent(
+      orbit_client_protos::TracepointEventInfo /*tracepoint_event_info*/) override {}
+  void OnModuleUpdate(int32_t /*pid*/, uint64_t /*timestamp_ns*/,
+                      orbit_grpc_protos::ModuleInfo /*module_info*/) override {}
+  void OnModulesSnapshot(int32_t /*pid*/, uint64_t /*timestamp_ns*/,
+                         std::vector<orbit_grpc_protos::ModuleInfo> /*module_infos*/) override {}
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent /*warning_event*/) override {}
+  void OnClockResolutionEvent(
+      orbit_grpc_protos::ClockResolutionEvent /*clock_resolution_event*/) override {}
+  void OnCaptureStartLatencyEvent(
+      orbit_grpc_protos::CaptureStartLatencyEvent /*capture_start_latency_event*/) override {}
+  void OnErrorsWithPerfEventOpenEvent(
+      orbit_grpc_protos::ErrorsWithPerfEventOpenEvent /*errors_with_perf_event_open_event*/)
+      override {}
+  void OnErrorEnablingOrbitApiEvent(
+      orbit_grpc_protos::ErrorEnablingOrbitApiEvent /*error_enabling_orbit_api_event*/) override {}
+  void OnLostPerfRecordsEvent(
+      orbit_grpc_protos::LostPerfRecordsEvent /*lost_perf_records_event*/) override {}
+  void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
+                                        /*out_of_order_events_discarded_event*/) override {}
+  void OnSamplingPeriodChangedEvent(orbit_grpc_protos::SamplingPeriodChangedEvent
+                                    /*sampling_period_changed_event*/) override {}
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe /*pipeline_latency_probe*/) override {}
+
+  uint64_t event_count_ = 0;
+  uint64_t total_latency_ns_ = 0;
+  uint64_t max_latency_ns_ = 0;
+};
+
+// Stands in for the gRPC connection between OrbitService and the client. SendEvents is only called
+// by the sender thread of SenderThreadCaptureEventBuffer.
+class LoopbackCaptureEventSender final : public CaptureEventSender {
+ public:
+  LoopbackCaptureEventSender(orbit_capture_client::CaptureListener* capture_listener,
+                             bool send_columnar_event_batches)
+      : client_event_processor_{orbit_capture_client::CaptureEventProcessor::
+                                    CreateForCaptureListener(capture_listener, std::nullopt, {})},
+        send_columnar_event_batches_{send_columnar_event_batches} {}
+
+  void SendEvents(std::vector<ClientCaptureEvent>&& events) override {
+    if (events.empty()) return;
+    const uint64_t send_start_cpu_ns = GetThreadCpuTimeNs();
+    if (send_columnar_event_batches_) {
+      events = PackIntoColumnarEventBatches(std::move(events));
+    }
+
+    // Same packing as GrpcCaptureEventSender.
+    constexpr int kMaxEventsPerResponse = 10'000;
+    std::vector<std::string> serialized_responses;
+    orbit_grpc_protos::CaptureResponse response;
+    for (ClientCaptureEvent& event : events) {
+      if (response.capture_events_size() == kMaxEventsPerResponse) {
+        serialized_responses.emplace_back(response.SerializeAsString());
+        response.clear_capture_events();
+      }
+      response.mutable_capture_events()->Add(std::move(event));
+    }
+    serialized_responses.emplace_back(response.SerializeAsString());
+    const uint64_t client_start_cpu_ns = GetThreadCpuTimeNs();
+
+    for (const std::string& serialized_response : serialized_responses) {
+      bytes_sent_ += serialized_response.size();
+      orbit_grpc_protos::CaptureResponse received_response;
+      received_response.ParseFromString(serialized_response);
+      for (const ClientCaptureEvent& event : received_response.capture_events()) {
+        client_event_processor_->ProcessEvent(event);
+      }
+    }
+    const uint64_t client_end_cpu_ns = GetThreadCpuTimeNs();
+
+    send_cpu_ns_ += client_start_cpu_ns - send_start_cpu_ns;
+    client_cpu_ns_ += client_end_cpu_ns - client_start_cpu_ns;
+  }
+
+  [[nodiscard]] uint64_t GetBytesSent() const { return bytes_sent_; }
+  [[nodiscard]] uint64_t GetSendCpuNs() const { return send_cpu_ns_; }
+  [[nodiscard]] uint64_t GetClientCpuNs() const { return client_cpu_ns_; }
+
+ private:
+  std::unique_ptr<orbit_capture_client::CaptureEventProcessor> client_event_processor_;
+  const bool send_columnar_event_batches_;
+  uint64_t bytes_sent_ = 0;
+  uint64_t send_cpu_ns_ = 0;
+  uint64_t client_cpu_ns_ = 0;
+};
+
+// Emulates one thread of the Tracer. The kind of each event is picked in a fixed round-robin order
+// that respects the EventMix.
+void ProduceEvents(LinuxTracingHandler* linux_tracing_handler, const EventMix& mix,
+                   int32_t producer_index, int64_t event_count) {
+  const int32_t tid = kPid + 1 + producer_index;
+  const int64_t mix_total =
+      mix.callstack_samples + mix.function_calls + mix.scheduling_slices + mix.gpu_jobs;
+
+  std::vector<FullCallstackSample> callstack_samples;
+  std::vector<FunctionCall> function_calls;
+  std::vector<SchedulingSlice> scheduling_slices;
+  auto flush_batches = [&] {
+    if (!callstack_samples.empty()) {
+      linux_tracing_handler->OnCallstackSamples(std::move(callstack_samples));
+      callstack_samples.clear();
+    }
+    if (!function_calls.empty()) {
+      linux_tracing_handler->OnFunctionCalls(std::move(function_calls));
+      function_calls.clear();
+    }
+    if (!scheduling_slices.empty()) {
+      linux_tracing_handler->OnSchedulingSlices(std::move(scheduling_slices));
+      scheduling_slices.clear();
+    }
+  };
+
+  for (int64_t i = 0; i < event_count; ++i) {
+    const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+    int64_t slot = i % mix_total;
+    if (slot < mix.callstack_samples) {
+      FullCallstackSample& sample = callstack_samples.emplace_back();
+      sample.set_pid(kPid);
+      sample.set_tid(tid);
+      sample.set_timestamp_ns(timestamp_ns);
+      const uint64_t callstack_index = static_cast<uint64_t>(i) % kDistinctCallstackCount;
+      for (uint64_t depth = 0; depth < kCallstackDepth; ++depth) {
+        sample.mutable_callstack()->add_pcs(0x10000 + callstack_index * 0x100 + depth * 0x10);
+      }
+      if (callstack_samples.size() == kBatchSize) flush_batches();
+      continue;
+    }
+    slot -= mix.callstack_samples;
+    if (slot < mix.function_calls) {
+      FunctionCall& function_call = function_calls.emplace_back();
+      function_call.set_pid(kPid);
+      function_call.set_tid(tid);
+      function_call.set_function_id(static_cast<uint64_t>(i) % 100 + 1);
+      function_call.set_duration_ns(1000);
+      function_call.set_end_timestamp_ns(timestamp_ns);
+      function_call.set_depth(static_cast<int32_t>(i % 8));
+      if (function_calls.size() == kBatchSize) flush_batches();
+      continue;
+    }
+    slot -= mix.function_calls;
+    if (slot < mix.scheduling_slices) {
+      SchedulingSlice& scheduling_slice = scheduling_slices.emplace_back();
+      scheduling_slice.set_pid(kPid);
+      scheduling_slice.set_tid(tid);
+      scheduling_slice.set_core(producer_index);
+      scheduling_slice.set_duration_ns(1000);
+      scheduling_slice.set_out_timestamp_ns(timestamp_ns);
+      if (scheduling_slices.size() == kBatchSize) flush_batches();
+      continue;
+    }
+    FullGpuJob gpu_job;
+    gpu_job.set_pid(kPid);
+    gpu_job.set_tid(tid);
+    gpu_job.set_context(1);
+    gpu_job.set_seqno(static_cast<uint32_t>(i));
+    gpu_job.set_amdgpu_cs_ioctl_time_ns(timestamp_ns);
+    gpu_job.set_amdgpu_sched_run_job_time_ns(timestamp_ns);
+    gpu_job.set_gpu_hardware_start_time_ns(timestamp_ns);
+    gpu_job.set_dma_fence_signaled_time_ns(timestamp_ns);
+    gpu_job.set_timeline("gfx");
+    linux_tracing_handler->OnGpuJob(std::move(gpu_job));
+  }
+  flush_batches();
+}
+
+// The arguments of the benchmark are the four weights of the EventMix, the number of producer
+// threads and whether the sender packs events into columnar batches.
+void BM_CapturePipeline(benchmark::State& state) {
+  const EventMix mix{state.range(0), state.range(1), state.range(2), state.range(3)};
+  const auto producer_count = static_cast<int32_t>(state.range(4));
+  const bool send_columnar_event_batches = state.range(5) != 0;
+
+  uint64_t bytes_sent = 0;
+  std::atomic<uint64_t> produce_cpu_ns = 0;
+  uint64_t send_cpu_ns = 0;
+  uint64_t client_cpu_ns = 0;
+  uint64_t latency_event_count = 0;
+  uint64_t total_latency_ns = 0;
+  uint64_t max_latency_ns = 0;
+
+  for (auto _ : state) {
+    LatencyMeasuringCaptureListener capture_listener;
+    LoopbackCaptureEventSender capture_event_sender{&capture_listener,
+                                                    send_columnar_event_batches};
+    SenderThreadCaptureEventBuffer capture_event_buffer{&capture_event_sender};
+    std::unique_ptr<ProducerEventProcessor> producer_event_processor =
+        ProducerEventProcessor::Create(&capture_event_buffer);
+    LinuxTracingHandler linux_tracing_handler{producer_event_processor.get()};
+
+    std::vector<std::thread> producers;
+    for (int32_t producer_index = 0; producer_index < producer_count; ++producer_index) {
+      producers.emplace_back([&, producer_index] {
+        const uint64_t start_cpu_ns = GetThreadCpuTimeNs();
+        ProduceEvents(&linux_tracing_handler, mix, producer_index, kEventCount / producer_count);
+        produce_cpu_ns += GetThreadCpuTimeNs() - start_cpu_ns;
+      });
+    }
+    for (std::thread& producer : producers) {
+      producer.join();
+    }
+    capture_event_buffer.StopAndWait();
+
+    bytes_sent += capture_event_sender.GetBytesSent();
+    send_cpu_ns += capture_event_sender.GetSendCpuNs();
+    client_cpu_ns += capture_event_sender.GetClientCpuNs();
+    latency_event_count += capture_listener.GetEventCount();
+    total_latency_ns += capture_listener.GetTotalLatencyNs();
+    max_latency_ns = std::max(max_latency_ns, capture_listener.GetMaxLatencyNs());
+  }
+
+  const int64_t total_event_count =
+      state.iterations() * (kEventCount / producer_count) * producer_count;
+  state.SetItemsProcessed(total_event_count);
+  state.SetBytesProcessed(static_cast<int64_t>(bytes_sent));
+  const auto per_event = [total_event_count](uint64_t value) {
+    return static_cast<double>(value) / static_cast<double>(total_event_count);
+  };
+  state.counters["produce_cpu_ns/event"] = per_event(produce_cpu_ns);
+  state.counters["send_cpu_ns/event"] = per_event(send_cpu_ns);
+  state.counters["client_cpu_ns/event"] = per_event(client_cpu_ns);
+  if (latency_event_count > 0) {
+    state.counters["latency_mean_us"] =
+        static_cast<double>(total_latency_ns) / static_cast<double>(latency_event_count) / 1000.0;
+  }
+  state.counters["latency_max_us"] = static_cast<double>(max_latency_ns) / 1000.0;
+}
+
+void CapturePipelineArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"samples", "calls", "slices", "gpu_jobs", "producers", "columnar"});
+  // Each kind of event alone, then a mix resembling a capture with dynamic instrumentation.
+  const std::vector<std::vector<int64_t>> mixes{
+      {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {4, 10, 5, 1}};
+  for (const std::vector<int64_t>& mix : mixes) {
+    for (int64_t producer_count : {1, 4}) {
+      for (int64_t columnar : {0, 1}) {
+        benchmark->Args({mix[0], mix[1], mix[2], mix[3], producer_count, columnar});
+      }
+    }
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_CapturePipeline)->Apply(CapturePipelineArguments)->UseRealTime();
+
+}  // namespace orbit_service
@@ -5,13 +5,23 @@
 #include "CaptureServiceImpl.h"
 
 #include <absl/container/flat_hash_set.h>
-#include <absl/synchronization/mutex.h>
+#include <absl/flags/declare.h>
+#include <absl/flags/flag.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
 #include <absl/time/time.h>
 #include <pthread.h>
 #include <stdint.h>
 
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -19,17 +29,30 @@
 #include "ApiLoader/EnableInTracee.h"
 #include "CaptureEventBuffer.h"
 #include "CaptureEventSender.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "CaptureFileCaptureEventSender.h"
+#include "ColumnarEventBatches.h"
+#include "ContinuousProfiler.h"
+#include "FlightRecorderCaptureEventBuffer.h"
 #include "GrpcProtos/Constants.h"
 #include "Introspection/Introspection.h"
 #include "LinuxTracingHandler.h"
+#include "LockFreeCaptureEventBuffer.h"
 #include "MemoryInfoHandler.h"
 #include "ObjectUtils/ElfFile.h"
 #include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/GetProcessIds.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "ProducerEventProcessor.h"
+#include "SenderThreadCaptureEventBuffer.h"
+#include "StatisticsCaptureEventBuffer.h"
 #include "capture.pb.h"
 
+ABSL_DECLARE_FLAG(uint64_t, max_capture_event_buffer_mb);
+ABSL_DECLARE_FLAG(std::string, capture_event_buffer_overflow_policy);
+
 namespace orbit_service {
 
 using orbit_grpc_protos::CaptureFinished;
@@ -43,76 +66,12 @@ namespace {
 
 using orbit_grpc_protos::ClientCaptureEvent;
 
-class SenderThreadCaptureEventBuffer final : public CaptureEventBuffer {
- public:
-  explicit SenderThreadCaptureEventBuffer(CaptureEventSender* event_sender)
-      : capture_event_sender_{event_sender} {
-    CHECK(capture_event_sender_ != nullptr);
-    sender_thread_ = std::thread{[this] { SenderThread(); }};
-  }
-
-  void AddEvent(ClientCaptureEvent&& event) override {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    if (stop_requested_) {
-      return;
-    }
-    event_buffer_.emplace_back(std::move(event));
-  }
-
-  void StopAndWait() {
-    CHECK(sender_thread_.joinable());
-    {
-      // Protect stop_requested_ with event_buffer_mutex_ so that we can use stop_requested_
-      // in Conditions for Await/LockWhen (specifically, in SenderThread).
-      absl::MutexLock lock{&event_buffer_mutex_};
-      stop_requested_ = true;
-    }
-    sender_thread_.join();
-  }
-
-  ~SenderThreadCaptureEventBuffer() override { CHECK(!sender_thread_.joinable()); }
-
- private:
-  void SenderThread() {
-    pthread_setname_np(pthread_self(), "SenderThread");
-    constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
-    // This should be lower than kMaxEventsPerResponse in GrpcCaptureEventSender::SendEvents
-    // as a few more events are likely to arrive after the condition becomes true.
-    constexpr uint64_t kSendEventCountInterval = 5000;
-
-    bool stopped = false;
-    while (!stopped) {
-      ORBIT_SCOPE("SenderThread iteration");
-      event_buffer_mutex_.LockWhenWithTimeout(absl::Condition(
-                                                  +[](SenderThreadCaptureEventBuffer* self) {
-                                                    return self->event_buffer_.size() >=
-                                                               kSendEventCountInterval ||
-                                                           self->stop_requested_;
-                                                  },
-                                                  this),
-                                              kSendTimeInterval);
-      if (stop_requested_) {
-        stopped = true;
-      }
-      std::vector<ClientCaptureEvent> buffered_events = std::move(event_buffer_);
-      event_buffer_.clear();
-      event_buffer_mutex_.Unlock();
-      capture_event_sender_->SendEvents(std::move(buffered_events));
-    }
-  }
-
-  std::vector<ClientCaptureEvent> event_buffer_;
-  absl::Mutex event_buffer_mutex_;
-  CaptureEventSender* capture_event_sender_;
-  std::thread sender_thread_;
-  bool stop_requested_ = false;
-};
-
 class GrpcCaptureEventSender final : public CaptureEventSender {
  public:
   explicit GrpcCaptureEventSender(
-      grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer)
-      : reader_writer_{reader_writer} {
+      grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer,
+      bool send_columnar_event_batches)
+      : reader_writer_{reader_writer}, send_columnar_event_batches_{send_columnar_event_batches} {
     CHECK(reader_writer_ != nullptr);
   }
 
@@ -134,6 +93,11 @@ class GrpcCaptureEventSender final : public CaptureEventSender {
     if (events.empty()) {
       return;
     }
+    // The statistics are about the events as produced, not about the batches they are packed into.
+    const uint64_t event_count = events.size();
+    if (send_columnar_event_batches_) {
+      events = PackIntoColumnarEventBatches(std::move(events));
+    }
 
     constexpr uint64_t kMaxEventsPerResponse = 10'000;
     uint64_t number_of_bytes_sent = 0;
@@ -147,6 +111,14 @@ class GrpcCaptureEventSender final : public CaptureEventSender {
         reader_writer_->Write(response);
         response.clear_capture_events();
       }
+      // Only the sender knows how much was sent, so it completes the ServiceHealthEvents.
+      if (event.event_case() == ClientCaptureEvent::kServiceHealthEvent) {
+        event.mutable_service_health_event()->set_total_bytes_sent(total_number_of_bytes_sent_ +
+                                                                   number_of_bytes_sent);
+      } else if (event.event_case() == ClientCaptureEvent::kPipelineLatencyProbe) {
+        event.mutable_pipeline_latency_probe()->set_sent_timestamp_ns(
+            orbit_base::CaptureTimestampNs());
+      }
       response.mutable_capture_events()->Add(std::move(event));
     }
     number_of_bytes_sent += response.ByteSizeLong();
@@ -154,20 +126,28 @@ class GrpcCaptureEventSender final : public CaptureEventSender {
 
     // Ensure we can divide by 0.f safely.
     static_assert(std::numeric_limits<float>::is_iec559);
-    float average_bytes = static_cast<float>(number_of_bytes_sent) / events.size();
+    float average_bytes = static_cast<float>(number_of_bytes_sent) / event_count;
 
     ORBIT_FLOAT("Average bytes per CaptureEvent", average_bytes);
-    total_number_of_events_sent_ += events.size();
+    total_number_of_events_sent_ += event_count;
     total_number_of_bytes_sent_ += number_of_bytes_sent;
   }
 
  private:
   grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer_;
+  const bool send_columnar_event_batches_;
 
   uint64_t total_number_of_events_sent_ = 0;
   uint64_t total_number_of_bytes_sent_ = 0;
 };
 
+// For the captures without a client, which are only saved to a file on the service: drops the
+// events that CaptureFileCaptureEventSender forwards to the client.
+class NullCaptureEventSender final : public CaptureEventSender {
+ public:
+  void SendEvents(std::vector<ClientCaptureEvent>&& /*events*/) override {}
+};
+
 }  // namespace
 
 // LinuxTracingHandler::Stop is blocking, until all perf_event_open events have been processed
@@ -202,6 +182,53 @@ static void StopInternalProducersAndCaptureStartStopListenersInParallel(
   }
 }
 
+// LinuxTracingHandler::Start, MemoryInfoHandler::Start and
+// CaptureStartStopListener::OnCaptureStartRequested don't depend on each other, and each of them
+// can take a while, e.g., to set up the perf_event_open file descriptors of the memory sampling.
+// Hence why, as for stopping, these methods are called in parallel on different threads.
+// Returns the name and the duration of each of these phases.
+static std::vector<std::pair<std::string, uint64_t>>
+StartInternalProducersAndCaptureStartStopListenersInParallel(
+    const CaptureOptions& linux_tracing_capture_options, const CaptureOptions& capture_options,
+    LinuxTracingHandler* tracing_handler, MemoryInfoHandler* memory_info_handler,
+    absl::flat_hash_set<CaptureStartStopListener*>* capture_start_stop_listeners,
+    ProducerEventProcessor* producer_event_processor) {
+  // The vector is not resized while the threads run, so each thread can write its own element.
+  std::vector<std::pair<std::string, uint64_t>> phase_durations_ns;
+  phase_durations_ns.reserve(2 + capture_start_stop_listeners->size());
+  std::vector<std::thread> start_threads;
+
+  auto start_in_thread = [&phase_durations_ns, &start_threads](std::string phase_name,
+                                                               std::function<void()> start) {
+    phase_durations_ns.emplace_back(std::move(phase_name), 0);
+    start_threads.emplace_back(
+        [start = std::move(start), duration_ns = &phase_durations_ns.back().second] {
+          const uint64_t start_timestamp_ns = orbit_base::CaptureTimestampNs();
+          start();
+          *duration_ns = orbit_base::CaptureTimestampNs() - start_timestamp_ns;
+        });
+  };
+
+  start_in_thread("Starting perf_event_open tracing",
+                  [tracing_handler, &linux_tracing_capture_options] {
+                    tracing_handler->Start(linux_tracing_capture_options);
+                  });
+  start_in_thread("Starting memory sampling", [memory_info_handler, &capture_options] {
+    memory_info_handler->Start(capture_options);
+  });
+  for (CaptureStartStopListener* listener : *capture_start_stop_listeners) {
+    start_in_thread("Notifying capture event producers",
+                    [listener, &capture_options, producer_event_processor] {
+                      listener->OnCaptureStartRequested(capture_options, producer_event_processor);
+                    });
+  }
+
+  for (std::thread& start_thread : start_threads) {
+    start_thread.join();
+  }
+  return phase_durations_ns;
+}
+
 static ProducerCaptureEvent CreateCaptureStartedEvent(const CaptureOptions& capture_options,
                                                       uint64_t capture_start_timestamp_ns) {
   ProducerCaptureEvent event;
@@ -243,6 +270,34 @@ static ProducerCaptureEvent CreateClockResolutionEvent(uint64_t timestamp_ns,
   return event;
 }
 
+static ProducerCaptureEvent CreateTscCalibrationEvent(
+    const orbit_base::TscCalibration& calibration) {
+  ProducerCaptureEvent event;
+  orbit_grpc_protos::TscCalibration* tsc_calibration = event.mutable_tsc_calibration();
+  tsc_calibration->set_timestamp_ns(calibration.reference.timestamp_ns);
+  tsc_calibration->set_reference_tsc(calibration.reference.tsc);
+  tsc_calibration->set_tsc_frequency_hz(calibration.tsc_frequency_hz);
+  return event;
+}
+
+static ProducerCaptureEvent CreateCaptureStartLatencyEvent(
+    uint64_t capture_request_received_timestamp_ns, uint64_t timestamp_ns,
+    const std::vector<std::pair<std::string, uint64_t>>& phase_durations_ns) {
+  ProducerCaptureEvent event;
+  orbit_grpc_protos::CaptureStartLatencyEvent* capture_start_latency_event =
+      event.mutable_capture_start_latency_event();
+  capture_start_latency_event->set_timestamp_ns(timestamp_ns);
+  capture_start_latency_event->set_total_duration_ns(timestamp_ns -
+                                                     capture_request_received_timestamp_ns);
+  for (const auto& [name, duration_ns] : phase_durations_ns) {
+    orbit_grpc_protos::CaptureStartLatencyEvent::Phase* phase =
+        capture_start_latency_event->add_phases();
+    phase->set_name(name);
+    phase->set_duration_ns(duration_ns);
+  }
+  return event;
+}
+
 static ProducerCaptureEvent CreateErrorEnablingOrbitApiEvent(uint64_t timestamp_ns,
                                                              std::string message) {
   ProducerCaptureEvent event;
@@ -261,6 +316,58 @@ static ProducerCaptureEvent CreateWarningEvent(uint64_t timestamp_ns, std::strin
   return event;
 }
 
+// Adds the processes of the cgroup of capture_options that are not captured yet to its
+// additional_pids. OrbitService itself is never captured.
+static ErrorMessageOr<void> AddPidsOfCgroupToAdditionalPids(CaptureOptions* capture_options) {
+  OUTCOME_TRY(cgroup_pids, orbit_base::GetPidsOfCgroup(capture_options->cgroup_path()));
+  absl::flat_hash_set<int32_t> captured_pids{capture_options->additional_pids().begin(),
+                                             capture_options->additional_pids().end()};
+  captured_pids.insert(capture_options->pid());
+  captured_pids.insert(orbit_base::GetCurrentProcessId());
+  for (pid_t pid : cgroup_pids) {
+    if (captured_pids.insert(pid).second) {
+      capture_options->add_additional_pids(pid);
+    }
+  }
+  return outcome::success();
+}
+
+static grpc_compression_level GrpcCompressionLevelFromCaptureResponseCompression(
+    CaptureOptions::CaptureResponseCompression capture_response_compression) {
+  switch (capture_response_compression) {
+    case CaptureOptions::kNoCompression:
+      return GRPC_COMPRESS_LEVEL_NONE;
+    case CaptureOptions::kLowCompression:
+      return GRPC_COMPRESS_LEVEL_LOW;
+    case CaptureOptions::kMediumCompression:
+      return GRPC_COMPRESS_LEVEL_MED;
+    case CaptureOptions::kHighCompression:
+      return GRPC_COMPRESS_LEVEL_HIGH;
+    default:
+      ERROR("Unknown CaptureResponseCompression: %d", capture_response_compression);
+      return GRPC_COMPRESS_LEVEL_NONE;
+  }
+}
+
+// The directory survives reboots, as captures saved on the service can last for hours.
+static std::filesystem::path GenerateServiceSideCaptureFilePath(int32_t pid) {
+  static const std::filesystem::path kServiceSideCaptureDirectory{"/var/tmp/orbit_captures"};
+  return kServiceSideCaptureDirectory /
+         absl::StrFormat("%d_%s.orbit", pid,
+                         absl::FormatTime("%Y_%m_%d_%H_%M_%S", absl::Now(), absl::LocalTimeZone()));
+}
+
+static ErrorMessageOr<std::unique_ptr<orbit_capture_file::CaptureFileOutputStream>>
+CreateServiceSideCaptureFile(const std::filesystem::path& capture_file_path) {
+  std::error_code error;
+  std::filesystem::create_directories(capture_file_path.parent_path(), error);
+  if (error) {
+    return ErrorMessage{absl::StrFormat("Unable to create directory \"%s\": %s",
+                                        capture_file_path.parent_path().string(), error.message())};
+  }
+  return orbit_capture_file::CaptureFileOutputStream::Create(capture_file_path);
+}
+
 static ClientCaptureEvent CreateCaptureFinishedEvent() {
   ClientCaptureEvent event;
   CaptureFinished* capture_finished = event.mutable_capture_finished();
@@ -268,39 +375,118 @@ static ClientCaptureEvent CreateCaptureFinishedEvent() {
   return event;
 }
 
-grpc::Status CaptureServiceImpl::Capture(
-    grpc::ServerContext* /*context*/,
-    grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer) {
-  pthread_setname_np(pthread_self(), "CSImpl::Capture");
-  if (is_capturing) {
-    ERROR("Cannot start capture because another capture is already in progress");
-    return grpc::Status(grpc::StatusCode::ALREADY_EXISTS,
-                        "Cannot start capture because another capture is already in progress.");
+ClientCaptureEvent CaptureServiceImpl::RunCapture(
+    CaptureOptions capture_options, uint64_t capture_request_received_timestamp_ns,
+    CaptureEventSender* client_event_sender, const std::filesystem::path& capture_file_path,
+    const std::function<void(FlightRecorderCaptureEventBuffer*)>& wait_for_stop_request) {
+  // The name and the duration of each phase of starting the capture.
+  std::vector<std::pair<std::string, uint64_t>> capture_start_phase_durations_ns;
+  auto add_capture_start_phase = [&capture_start_phase_durations_ns](std::string name,
+                                                                     uint64_t start_timestamp_ns) {
+    capture_start_phase_durations_ns.emplace_back(
+        std::move(name), orbit_base::CaptureTimestampNs() - start_timestamp_ns);
+  };
+
+  // The processes of the cgroup are resolved once, so that all producers and the client capture
+  // the same processes.
+  std::optional<std::string> error_resolving_cgroup;
+  if (!capture_options.cgroup_path().empty()) {
+    if (auto result = AddPidsOfCgroupToAdditionalPids(&capture_options); result.has_error()) {
+      ERROR("Getting the processes of cgroup \"%s\": %s", capture_options.cgroup_path(),
+            result.error().message());
+      error_resolving_cgroup = absl::StrFormat(
+          "Could not capture the processes of cgroup \"%s\": %s", capture_options.cgroup_path(),
+          result.error().message());
+    }
   }
-  is_capturing = true;
 
-  GrpcCaptureEventSender capture_event_sender{reader_writer};
-  SenderThreadCaptureEventBuffer capture_event_buffer{&capture_event_sender};
+  CaptureEventSender* capture_event_sender = client_event_sender;
+  std::unique_ptr<CaptureFileCaptureEventSender> capture_file_capture_event_sender;
+  std::optional<std::string> error_saving_capture_file;
+  if (!capture_file_path.empty()) {
+    ErrorMessageOr<std::unique_ptr<orbit_capture_file::CaptureFileOutputStream>>
+        output_stream_or_error = CreateServiceSideCaptureFile(capture_file_path);
+    if (output_stream_or_error.has_value()) {
+      LOG("Saving the capture to \"%s\"", capture_file_path.string());
+      capture_file_capture_event_sender = std::make_unique<CaptureFileCaptureEventSender>(
+          std::move(output_stream_or_error.value()), client_event_sender);
+      capture_event_sender = capture_file_capture_event_sender.get();
+    } else {
+      ERROR("Creating capture file: %s", output_stream_or_error.error().message());
+      error_saving_capture_file = absl::StrFormat(
+          "Could not save the capture on the instance, streaming it to the client instead: %s",
+          output_stream_or_error.error().message());
+    }
+  }
+  // Only one of the three is created.
+  std::unique_ptr<FlightRecorderCaptureEventBuffer> flight_recorder_capture_event_buffer;
+  std::unique_ptr<SenderThreadCaptureEventBuffer> sender_thread_capture_event_buffer;
+  std::unique_ptr<LockFreeCaptureEventBuffer> lock_free_capture_event_buffer;
+  CaptureEventBuffer* capture_event_buffer;
+  if (capture_options.flight_recorder_window_ns() > 0) {
+    LOG("Capturing in flight recorder mode with a window of %.3f s",
+        capture_options.flight_recorder_window_ns() / 1e9);
+    flight_recorder_capture_event_buffer = std::make_unique<FlightRecorderCaptureEventBuffer>(
+        capture_event_sender, capture_options.flight_recorder_window_ns());
+    capture_event_buffer = flight_recorder_capture_event_buffer.get();
+  } else if (capture_options.use_lock_free_capture_event_buffer()) {
+    lock_free_capture_event_buffer =
+        std::make_unique<LockFreeCaptureEventBuffer>(capture_event_sender);
+    capture_event_buffer = lock_free_capture_event_buffer.get();
+  } else {
+    std::optional<CaptureEventBufferOverflowPolicy> overflow_policy =
+        ParseCaptureEventBufferOverflowPolicy(
+            absl::GetFlag(FLAGS_capture_event_buffer_overflow_policy));
+    if (!overflow_policy.has_value()) {
+      ERROR("Unknown capture event buffer overflow policy \"%s\", dropping events instead",
+            absl::GetFlag(FLAGS_capture_event_buffer_overflow_policy));
+      overflow_policy = CaptureEventBufferOverflowPolicy::kDropLowPriorityEvents;
+    }
+    sender_thread_capture_event_buffer = std::make_unique<SenderThreadCaptureEventBuffer>(
+        capture_event_sender, absl::GetFlag(FLAGS_max_capture_event_buffer_mb) * 1024 * 1024,
+        overflow_policy.value());
+    capture_event_buffer = sender_thread_capture_event_buffer.get();
+  }
+  std::unique_ptr<StatisticsCaptureEventBuffer> statistics_capture_event_buffer;
+  if (capture_options.statistics_summary_interval_ns() > 0) {
+    LOG("Capturing in statistics only mode with summaries every %.3f s",
+        capture_options.statistics_summary_interval_ns() / 1e9);
+    statistics_capture_event_buffer = std::make_unique<StatisticsCaptureEventBuffer>(
+        capture_event_buffer, capture_options.statistics_summary_interval_ns());
+    capture_event_buffer = statistics_capture_event_buffer.get();
+  }
   std::unique_ptr<ProducerEventProcessor> producer_event_processor =
-      ProducerEventProcessor::Create(&capture_event_buffer);
+      ProducerEventProcessor::Create(capture_event_buffer);
   LinuxTracingHandler tracing_handler{producer_event_processor.get()};
   MemoryInfoHandler memory_info_handler{producer_event_processor.get()};
 
-  CaptureRequest request;
-  reader_writer->Read(&request);
-  LOG("Read CaptureRequest from Capture's gRPC stream: starting capture");
-
-  const CaptureOptions& capture_options = request.capture_options();
+  add_capture_start_phase("Setting up the capture event buffer",
+                          capture_request_received_timestamp_ns);
+
+  // Calibrating the time stamp counter can wait for enough time to have passed since the service
+  // started, so it happens in parallel with enabling the Orbit API and instrumenting functions.
+  std::optional<orbit_base::TscCalibration> tsc_calibration;
+  uint64_t tsc_calibration_duration_ns = 0;
+  std::thread tsc_calibration_thread;
+  if (capture_options.use_tsc_for_api_timestamps()) {
+    tsc_calibration_thread = std::thread([this, &tsc_calibration, &tsc_calibration_duration_ns] {
+      const uint64_t start_timestamp_ns = orbit_base::CaptureTimestampNs();
+      tsc_calibration = CalibrateTsc();
+      tsc_calibration_duration_ns = orbit_base::CaptureTimestampNs() - start_timestamp_ns;
+    });
+  }
 
   // Enable Orbit API in tracee.
   std::optional<std::string> error_enabling_orbit_api;
   if (capture_options.enable_api()) {
+    const uint64_t start_timestamp_ns = orbit_base::CaptureTimestampNs();
     auto result = orbit_api_loader::EnableApiInTracee(capture_options);
     if (result.has_error()) {
       ERROR("Enabling Orbit Api: %s", result.error().message());
       error_enabling_orbit_api =
           absl::StrFormat("Could not enable Orbit API: %s", result.error().message());
     }
+    add_capture_start_phase("Enabling the Orbit API", start_timestamp_ns);
   }
 
   uint64_t capture_start_timestamp_ns = orbit_base::CaptureTimestampNs();
@@ -319,19 +505,81 @@ grpc::Status CaptureServiceImpl::Capture(
                                          std::move(error_enabling_orbit_api.value())));
   }
 
-  tracing_handler.Start(capture_options);
+  if (error_saving_capture_file.has_value()) {
+    producer_event_processor->ProcessEvent(
+        orbit_grpc_protos::kRootProducerId,
+        CreateWarningEvent(capture_start_timestamp_ns,
+                           std::move(error_saving_capture_file.value())));
+  }
+
+  if (error_resolving_cgroup.has_value()) {
+    producer_event_processor->ProcessEvent(
+        orbit_grpc_protos::kRootProducerId,
+        CreateWarningEvent(capture_start_timestamp_ns, std::move(error_resolving_cgroup.value())));
+  }
+
+  // Instrument functions in user space instead of with uprobes where possible. The functions
+  // instrumented this way are removed from the options passed to LinuxTracing.
+  CaptureOptions linux_tracing_capture_options = capture_options;
+  if (capture_options.enable_user_space_instrumentation()) {
+    const uint64_t start_timestamp_ns = orbit_base::CaptureTimestampNs();
+    auto result_or_error = instrumentation_manager_->InstrumentProcess(capture_options);
+    add_capture_start_phase("Instrumenting functions in user space", start_timestamp_ns);
+    if (result_or_error.has_error()) {
+      ERROR("Instrumenting process: %s", result_or_error.error().message());
+      producer_event_processor->ProcessEvent(
+          orbit_grpc_protos::kRootProducerId,
+          CreateWarningEvent(
+              capture_start_timestamp_ns,
+              absl::StrFormat(
+                  "Could not instrument functions in user space, using uprobes instead: %s",
+                  result_or_error.error().message())));
+    } else {
+      const absl::flat_hash_set<uint64_t>& instrumented_function_ids = result_or_error.value();
+      LOG("Instrumented %u functions in user space", instrumented_function_ids.size());
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::InstrumentedFunction>*
+          instrumented_functions = linux_tracing_capture_options.mutable_instrumented_functions();
+      instrumented_functions->erase(
+          std::remove_if(instrumented_functions->begin(), instrumented_functions->end(),
+                         [&instrumented_function_ids](
+                             const orbit_grpc_protos::InstrumentedFunction& function) {
+                           return instrumented_function_ids.contains(function.function_id());
+                         }),
+          instrumented_functions->end());
+    }
+  }
 
-  memory_info_handler.Start(request.capture_options());
-  for (CaptureStartStopListener* listener : capture_start_stop_listeners_) {
-    listener->OnCaptureStartRequested(request.capture_options(), producer_event_processor.get());
+  // This needs to be processed before the producers start sending events, as the events of the
+  // Orbit API are converted with it.
+  if (tsc_calibration_thread.joinable()) {
+    tsc_calibration_thread.join();
+    capture_start_phase_durations_ns.emplace_back("Calibrating the time stamp counter",
+                                                  tsc_calibration_duration_ns);
+    if (tsc_calibration.has_value()) {
+      LOG("Time stamp counter frequency: %u Hz", tsc_calibration->tsc_frequency_hz);
+      producer_event_processor->ProcessEvent(orbit_grpc_protos::kRootProducerId,
+                                             CreateTscCalibrationEvent(tsc_calibration.value()));
+    } else {
+      ERROR("Calibrating the time stamp counter");
+    }
   }
 
-  // The client asks for the capture to be stopped by calling WritesDone.
-  // At that point, this call to Read will return false.
-  // In the meantime, it blocks if no message is received.
-  while (reader_writer->Read(&request)) {
+  for (auto& phase_duration_ns : StartInternalProducersAndCaptureStartStopListenersInParallel(
+           linux_tracing_capture_options, capture_options, &tracing_handler,
+           &memory_info_handler, &capture_start_stop_listeners_, producer_event_processor.get())) {
+    capture_start_phase_durations_ns.push_back(std::move(phase_duration_ns));
   }
-  LOG("Client finished writing on Capture's gRPC stream: stopping capture");
+
+  const uint64_t capture_start_finished_timestamp_ns = orbit_base::CaptureTimestampNs();
+  LOG("Starting the capture took %.0f ms",
+      (capture_start_finished_timestamp_ns - capture_request_received_timestamp_ns) / 1e6);
+  producer_event_processor->ProcessEvent(
+      orbit_grpc_protos::kRootProducerId,
+      CreateCaptureStartLatencyEvent(capture_request_received_timestamp_ns,
+                                     capture_start_finished_timestamp_ns,
+                                     capture_start_phase_durations_ns));
+
+  wait_for_stop_request(flight_recorder_capture_event_buffer.get());
 
   // Disable Orbit API in tracee.
   if (capture_options.enable_api()) {
@@ -346,14 +594,191 @@ grpc::Status CaptureServiceImpl::Capture(
     }
   }
 
+  if (capture_options.enable_user_space_instrumentation()) {
+    auto result = instrumentation_manager_->UninstrumentProcess(capture_options.pid());
+    if (result.has_error()) {
+      ERROR("Uninstrumenting process: %s", result.error().message());
+      producer_event_processor->ProcessEvent(
+          orbit_grpc_protos::kRootProducerId,
+          CreateWarningEvent(orbit_base::CaptureTimestampNs(),
+                             absl::StrFormat("Could not uninstrument functions in user space: %s",
+                                             result.error().message())));
+    }
+  }
+
   StopInternalProducersAndCaptureStartStopListenersInParallel(
       &tracing_handler, &memory_info_handler, &capture_start_stop_listeners_);
 
-  capture_event_buffer.AddEvent(CreateCaptureFinishedEvent());
+  if (statistics_capture_event_buffer != nullptr) {
+    statistics_capture_event_buffer->StopAndSendSummary();
+  }
+  if (flight_recorder_capture_event_buffer != nullptr) {
+    flight_recorder_capture_event_buffer->StopAndSendSnapshot();
+  } else if (lock_free_capture_event_buffer != nullptr) {
+    lock_free_capture_event_buffer->StopAndWait();
+  } else {
+    sender_thread_capture_event_buffer->StopAndWait();
+  }
+  // The sender thread has exited, so the CaptureFinished event can be sent directly. This also
+  // guarantees that it is the last event, as LockFreeCaptureEventBuffer only preserves the order of
+  // the events added by the same thread.
+  ClientCaptureEvent capture_finished_event = CreateCaptureFinishedEvent();
+  if (capture_file_capture_event_sender != nullptr) {
+    CaptureFinished* capture_finished = capture_finished_event.mutable_capture_finished();
+    ErrorMessageOr<void> result = capture_file_capture_event_sender->Finish(capture_finished_event);
+    if (result.has_error()) {
+      ERROR("Saving capture file: %s", result.error().message());
+      capture_finished->set_status(CaptureFinished::kFailed);
+      capture_finished->set_error_message(absl::StrFormat(
+          "Could not save the capture on the instance: %s", result.error().message()));
+    } else {
+      LOG("Saved the capture to \"%s\"", capture_file_path.string());
+      capture_finished->set_capture_file_path(capture_file_path.string());
+    }
+  }
+  return capture_finished_event;
+}
+
+grpc::Status CaptureServiceImpl::Capture(
+    grpc::ServerContext* context,
+    grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer) {
+  pthread_setname_np(pthread_self(), "CSImpl::Capture");
+  {
+    absl::MutexLock lock{&capture_state_mutex_};
+    if (capture_state_ == CaptureState::kServiceCapture && !is_client_waiting_for_capture_) {
+      LOG("Stopping the capture on the service to start the capture requested by the client");
+      is_client_waiting_for_capture_ = true;
+      // Stopping a capture only takes a few seconds.
+      constexpr absl::Duration kMaxWaitForCaptureOnService = absl::Seconds(30);
+      capture_state_mutex_.AwaitWithTimeout(
+          absl::Condition(
+              +[](CaptureState* capture_state) { return *capture_state == CaptureState::kIdle; },
+              &capture_state_),
+          kMaxWaitForCaptureOnService);
+      is_client_waiting_for_capture_ = false;
+    }
+    if (capture_state_ != CaptureState::kIdle) {
+      ERROR("Cannot start capture because another capture is already in progress");
+      return grpc::Status(grpc::StatusCode::ALREADY_EXISTS,
+                          "Cannot start capture because another capture is already in progress.");
+    }
+    capture_state_ = CaptureState::kClientCapture;
+  }
+
+  CaptureRequest request;
+  reader_writer->Read(&request);
+  LOG("Read CaptureRequest from Capture's gRPC stream: starting capture");
+  const uint64_t capture_request_received_timestamp_ns = orbit_base::CaptureTimestampNs();
+  const CaptureOptions& capture_options = request.capture_options();
+
+  // Nothing has been written to the stream yet, so the compression still applies to all the
+  // CaptureResponses. gRPC picks the algorithm for the level among those the client accepts.
+  if (capture_options.capture_response_compression() != CaptureOptions::kNoCompression) {
+    context->set_compression_level(GrpcCompressionLevelFromCaptureResponseCompression(
+        capture_options.capture_response_compression()));
+  }
 
-  capture_event_buffer.StopAndWait();
+  GrpcCaptureEventSender grpc_capture_event_sender{
+      reader_writer, capture_options.send_columnar_event_batches()};
+  std::filesystem::path capture_file_path;
+  if (capture_options.save_capture_file_on_service()) {
+    capture_file_path = GenerateServiceSideCaptureFilePath(capture_options.pid());
+  }
+  std::vector<ClientCaptureEvent> capture_finished_events;
+  capture_finished_events.emplace_back(RunCapture(
+      capture_options, capture_request_received_timestamp_ns, &grpc_capture_event_sender,
+      capture_file_path,
+      [reader_writer](FlightRecorderCaptureEventBuffer* flight_recorder_capture_event_buffer) {
+        // The client asks for the capture to be stopped by calling WritesDone.
+        // At that point, this call to Read will return false.
+        // In the meantime, it blocks if no message is received. The only other message the client
+        // sends asks for a snapshot of the flight recorder's window.
+        CaptureRequest request;
+        while (reader_writer->Read(&request)) {
+          if (!request.send_flight_recorder_snapshot()) continue;
+          if (flight_recorder_capture_event_buffer == nullptr) {
+            ERROR(
+                "Flight recorder snapshot requested, but the capture is not in flight recorder "
+                "mode");
+            continue;
+          }
+          LOG("Sending flight recorder snapshot");
+          flight_recorder_capture_event_buffer->SendSnapshot();
+        }
+        LOG("Client finished writing on Capture's gRPC stream: stopping capture");
+      }));
+  grpc_capture_event_sender.SendEvents(std::move(capture_finished_events));
   LOG("Finished handling gRPC call to Capture: all capture data has been sent");
-  is_capturing = false;
+  {
+    absl::MutexLock lock{&capture_state_mutex_};
+    capture_state_ = CaptureState::kIdle;
+  }
+  return grpc::Status::OK;
+}
+
+ErrorMessageOr<void> CaptureServiceImpl::CaptureToFileOnService(
+    const CaptureOptions& capture_options, const std::filesystem::path& capture_file_path,
+    const std::function<bool()>& is_stop_requested) {
+  {
+    absl::MutexLock lock{&capture_state_mutex_};
+    if (capture_state_ != CaptureState::kIdle || is_client_waiting_for_capture_) {
+      return ErrorMessage{"Cannot start capture because another capture is already in progress"};
+    }
+    capture_state_ = CaptureState::kServiceCapture;
+  }
+
+  const uint64_t capture_request_received_timestamp_ns = orbit_base::CaptureTimestampNs();
+  NullCaptureEventSender null_capture_event_sender;
+  const ClientCaptureEvent capture_finished_event = RunCapture(
+      capture_options, capture_request_received_timestamp_ns, &null_capture_event_sender,
+      capture_file_path,
+      [this, &is_stop_requested](
+          FlightRecorderCaptureEventBuffer* /*flight_recorder_capture_event_buffer*/) {
+        constexpr absl::Duration kStopRequestCheckInterval = absl::Seconds(1);
+        while (!is_stop_requested()) {
+          absl::MutexLock lock{&capture_state_mutex_};
+          if (capture_state_mutex_.AwaitWithTimeout(
+                  absl::Condition(&is_client_waiting_for_capture_), kStopRequestCheckInterval)) {
+            return;
+          }
+        }
+      });
+  {
+    absl::MutexLock lock{&capture_state_mutex_};
+    capture_state_ = CaptureState::kIdle;
+  }
+
+  const CaptureFinished& capture_finished = capture_finished_event.capture_finished();
+  if (capture_finished.status() != CaptureFinished::kSuccessful) {
+    return ErrorMessage{capture_finished.error_message()};
+  }
+  if (capture_finished.capture_file_path().empty()) {
+    return ErrorMessage{
+        absl::StrFormat("Could not create capture file \"%s\"", capture_file_path.string())};
+  }
+  return outcome::success();
+}
+
+grpc::Status CaptureServiceImpl::GetCaptureTimestamp(
+    grpc::ServerContext* /*context*/,
+    const orbit_grpc_protos::GetCaptureTimestampRequest* /*request*/,
+    orbit_grpc_protos::GetCaptureTimestampResponse* response) {
+  response->set_timestamp_ns(orbit_base::CaptureTimestampNs());
+  return grpc::Status::OK;
+}
+
+grpc::Status CaptureServiceImpl::ListContinuousCaptureFiles(
+    grpc::ServerContext* /*context*/,
+    const orbit_grpc_protos::ListContinuousCaptureFilesRequest* /*request*/,
+    orbit_grpc_protos::ListContinuousCaptureFilesResponse* response) {
+  ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>> files_or_error =
+      orbit_service::ListContinuousCaptureFiles(kContinuousCaptureDirectory);
+  if (files_or_error.has_error()) {
+    return grpc::Status(grpc::StatusCode::NOT_FOUND, files_or_error.error().message());
+  }
+  for (orbit_grpc_protos::ContinuousCaptureFile& file : files_or_error.value()) {
+    *response->add_files() = std::move(file);
+  }
   return grpc::Status::OK;
 }
 
@@ -367,6 +792,21 @@ void CaptureServiceImpl::RemoveCaptureStartStopListener(CaptureStartStopListener
   CHECK(was_removed);
 }
 
+std::optional<orbit_base::TscCalibration> CaptureServiceImpl::CalibrateTsc() const {
+  if (!tsc_calibration_start_sample_.has_value()) return std::nullopt;
+
+  // Make sure the samples are far enough apart for an accurate frequency, even if the capture is
+  // started right after the service.
+  constexpr uint64_t kMinCalibrationIntervalNs = 100'000'000;
+  const uint64_t elapsed_ns =
+      orbit_base::CaptureTimestampNs() - tsc_calibration_start_sample_->timestamp_ns;
+  if (elapsed_ns < kMinCalibrationIntervalNs) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(kMinCalibrationIntervalNs - elapsed_ns));
+  }
+  return orbit_base::ComputeTscCalibration(tsc_calibration_start_sample_.value(),
+                                           orbit_base::SampleTscAndCaptureTimestamp());
+}
+
 void CaptureServiceImpl::EstimateAndLogClockResolution() {
   // We expect the value to be small, ~35 nanoseconds.
   clock_resolution_ns_ = orbit_base::EstimateClockResolution();
@@ -5,13 +5,22 @@
 #ifndef ORBIT_SERVICE_CAPTURE_SERVICE_IMPL_H_
 #define ORBIT_SERVICE_CAPTURE_SERVICE_IMPL_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <grpcpp/grpcpp.h>
 
-#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 
+#include "CaptureEventSender.h"
 #include "CaptureStartStopListener.h"
+#include "FlightRecorderCaptureEventBuffer.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
+#include "OrbitBase/Result.h"
+#include "UserSpaceInstrumentation/InstrumentProcess.h"
 #include "absl/container/flat_hash_set.h"
 #include "services.grpc.pb.h"
 #include "services.pb.h"
@@ -23,6 +32,12 @@ class CaptureServiceImpl final : public orbit_grpc_protos::CaptureService::Servi
   CaptureServiceImpl() {
     // We want to estimate clock resolution once, not at the beginning of every capture.
     EstimateAndLogClockResolution();
+    // The time stamp counter is calibrated against the capture clock over the whole time between
+    // this sample and the start of a capture, which gives a much more accurate frequency than a
+    // short measurement at capture start.
+    if (orbit_base::IsTscUsableForCaptureTimestamps()) {
+      tsc_calibration_start_sample_ = orbit_base::SampleTscAndCaptureTimestamp();
+    }
   }
 
   grpc::Status Capture(
@@ -30,15 +45,54 @@ class CaptureServiceImpl final : public orbit_grpc_protos::CaptureService::Servi
       grpc::ServerReaderWriter<orbit_grpc_protos::CaptureResponse,
                                orbit_grpc_protos::CaptureRequest>* reader_writer) override;
 
+  grpc::Status GetCaptureTimestamp(
+      grpc::ServerContext* context, const orbit_grpc_protos::GetCaptureTimestampRequest* request,
+      orbit_grpc_protos::GetCaptureTimestampResponse* response) override;
+
+  grpc::Status ListContinuousCaptureFiles(
+      grpc::ServerContext* context,
+      const orbit_grpc_protos::ListContinuousCaptureFilesRequest* request,
+      orbit_grpc_protos::ListContinuousCaptureFilesResponse* response) override;
+
+  // Runs a capture without a client that is only saved to `capture_file_path`, e.g., for
+  // continuous profiling, until `is_stop_requested` returns true, which is checked every second, or
+  // until a client requests a capture, which takes precedence. Fails if another capture is in
+  // progress or if the capture file could not be saved.
+  [[nodiscard]] ErrorMessageOr<void> CaptureToFileOnService(
+      const orbit_grpc_protos::CaptureOptions& capture_options,
+      const std::filesystem::path& capture_file_path,
+      const std::function<bool()>& is_stop_requested);
+
   void AddCaptureStartStopListener(CaptureStartStopListener* listener);
   void RemoveCaptureStartStopListener(CaptureStartStopListener* listener);
 
  private:
-  std::atomic<bool> is_capturing = false;
+  // Runs a capture with `capture_options`, whose events are sent to `client_event_sender`, or saved
+  // to `capture_file_path` if not empty (see CaptureFileCaptureEventSender). The capture is stopped
+  // when `wait_for_stop_request` returns, which receives the buffer of the flight recorder, if any.
+  // Returns the CaptureFinished event, which is left to send to the client.
+  [[nodiscard]] orbit_grpc_protos::ClientCaptureEvent RunCapture(
+      orbit_grpc_protos::CaptureOptions capture_options,
+      uint64_t capture_request_received_timestamp_ns, CaptureEventSender* client_event_sender,
+      const std::filesystem::path& capture_file_path,
+      const std::function<void(FlightRecorderCaptureEventBuffer*)>& wait_for_stop_request);
+
+  enum class CaptureState { kIdle, kClientCapture, kServiceCapture };
+  absl::Mutex capture_state_mutex_;
+  CaptureState capture_state_ ABSL_GUARDED_BY(capture_state_mutex_) = CaptureState::kIdle;
+  // Set while a client waits for a capture started with CaptureToFileOnService to stop.
+  bool is_client_waiting_for_capture_ ABSL_GUARDED_BY(capture_state_mutex_) = false;
+
   absl::flat_hash_set<CaptureStartStopListener*> capture_start_stop_listeners_;
+  // Keeps the processes prepared for user space instrumentation across captures.
+  std::unique_ptr<orbit_user_space_instrumentation::InstrumentationManager>
+      instrumentation_manager_ = orbit_user_space_instrumentation::InstrumentationManager::Create();
 
   uint64_t clock_resolution_ns_ = 0;
   void EstimateAndLogClockResolution();
+
+  std::optional<orbit_base::TscSample> tsc_calibration_start_sample_;
+  [[nodiscard]] std::optional<orbit_base::TscCalibration> CalibrateTsc() const;
 };
 
 }  // namespace orbit_service
@@ -0,0 +1,125 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ColumnarEventBatches.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "Introspection/Introspection.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CallstackSampleBatch;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::FunctionCallBatch;
+using orbit_grpc_protos::SchedulingSlice;
+using orbit_grpc_protos::SchedulingSliceBatch;
+
+namespace {
+
+// The difference wraps around like the signed difference, and decoders undo it by adding it back
+// as unsigned.
+[[nodiscard]] int64_t ComputeTimestampDelta(uint64_t timestamp_ns,
+                                            uint64_t* previous_timestamp_ns) {
+  int64_t delta = static_cast<int64_t>(timestamp_ns - *previous_timestamp_ns);
+  *previous_timestamp_ns = timestamp_ns;
+  return delta;
+}
+
+void AppendToBatch(const SchedulingSlice& scheduling_slice, SchedulingSliceBatch* batch,
+                   uint64_t* previous_timestamp_ns) {
+  batch->add_pid(scheduling_slice.pid());
+  batch->add_tid(scheduling_slice.tid());
+  batch->add_core(scheduling_slice.core());
+  batch->add_duration_ns(scheduling_slice.duration_ns());
+  batch->add_out_timestamp_ns_delta(
+      ComputeTimestampDelta(scheduling_slice.out_timestamp_ns(), previous_timestamp_ns));
+}
+
+void AppendToBatch(const FunctionCall& function_call, FunctionCallBatch* batch,
+                   uint64_t* previous_timestamp_ns) {
+  batch->add_pid(function_call.pid());
+  batch->add_tid(function_call.tid());
+  batch->add_function_id(function_call.function_id());
+  batch->add_duration_ns(function_call.duration_ns());
+  batch->add_end_timestamp_ns_delta(
+      ComputeTimestampDelta(function_call.end_timestamp_ns(), previous_timestamp_ns));
+  batch->add_depth(function_call.depth());
+  batch->add_return_value(function_call.return_value());
+}
+
+void AppendToBatch(const CallstackSample& callstack_sample, CallstackSampleBatch* batch,
+                   uint64_t* previous_timestamp_ns) {
+  batch->add_pid(callstack_sample.pid());
+  batch->add_tid(callstack_sample.tid());
+  batch->add_callstack_id(callstack_sample.callstack_id());
+  batch->add_timestamp_ns_delta(
+      ComputeTimestampDelta(callstack_sample.timestamp_ns(), previous_timestamp_ns));
+  batch->add_off_cpu_duration_ns(callstack_sample.off_cpu_duration_ns());
+}
+
+}  // namespace
+
+std::vector<ClientCaptureEvent> PackIntoColumnarEventBatches(
+    std::vector<ClientCaptureEvent>&& events) {
+  ORBIT_SCOPE_FUNCTION;
+  std::vector<ClientCaptureEvent> packed_events;
+  packed_events.reserve(events.size());
+
+  ClientCaptureEvent scheduling_slice_batch_event;
+  SchedulingSliceBatch* scheduling_slice_batch =
+      scheduling_slice_batch_event.mutable_scheduling_slice_batch();
+  uint64_t previous_scheduling_slice_timestamp_ns = 0;
+  ClientCaptureEvent function_call_batch_event;
+  FunctionCallBatch* function_call_batch = function_call_batch_event.mutable_function_call_batch();
+  uint64_t previous_function_call_timestamp_ns = 0;
+  ClientCaptureEvent callstack_sample_batch_event;
+  CallstackSampleBatch* callstack_sample_batch =
+      callstack_sample_batch_event.mutable_callstack_sample_batch();
+  uint64_t previous_callstack_sample_timestamp_ns = 0;
+
+  for (ClientCaptureEvent& event : events) {
+    switch (event.event_case()) {
+      case ClientCaptureEvent::kSchedulingSlice:
+        AppendToBatch(event.scheduling_slice(), scheduling_slice_batch,
+                      &previous_scheduling_slice_timestamp_ns);
+        break;
+      case ClientCaptureEvent::kFunctionCall:
+        if (event.function_call().registers_size() > 0) {
+          packed_events.emplace_back(std::move(event));
+        } else {
+          AppendToBatch(event.function_call(), function_call_batch,
+                        &previous_function_call_timestamp_ns);
+        }
+        break;
+      case ClientCaptureEvent::kCallstackSample:
+        // CallstackSampleBatch has no columns for the memory events, which are rare anyway.
+        if (event.callstack_sample().memory_event_type() != CallstackSample::kNoMemoryEvent) {
+          packed_events.emplace_back(std::move(event));
+        } else {
+          AppendToBatch(event.callstack_sample(), callstack_sample_batch,
+                        &previous_callstack_sample_timestamp_ns);
+        }
+        break;
+      default:
+        packed_events.emplace_back(std::move(event));
+    }
+  }
+
+  if (scheduling_slice_batch->pid_size() > 0) {
+    packed_events.emplace_back(std::move(scheduling_slice_batch_event));
+  }
+  if (function_call_batch->pid_size() > 0) {
+    packed_events.emplace_back(std::move(function_call_batch_event));
+  }
+  if (callstack_sample_batch->pid_size() > 0) {
+    packed_events.emplace_back(std::move(callstack_sample_batch_event));
+  }
+  return packed_events;
+}
+
+}  // namespace orbit_service
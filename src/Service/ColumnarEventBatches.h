@@ -0,0 +1,23 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_COLUMNAR_EVENT_BATCHES_H_
+#define ORBIT_SERVICE_COLUMNAR_EVENT_BATCHES_H_
+
+#include <vector>
+
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// Replaces the SchedulingSlices, CallstackSamples and FunctionCalls without registers in events
+// with one SchedulingSliceBatch, CallstackSampleBatch and FunctionCallBatch, which are appended
+// after the other events. This way, the events the batched ones refer to (e.g.,
+// InternedCallstacks) are still received first.
+[[nodiscard]] std::vector<orbit_grpc_protos::ClientCaptureEvent> PackIntoColumnarEventBatches(
+    std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events);
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_COLUMNAR_EVENT_BATCHES_H_
@@ -0,0 +1,131 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ColumnarEventBatches.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+ClientCaptureEvent CreateSchedulingSlice(int32_t tid, uint64_t out_timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_pid(42);
+  event.mutable_scheduling_slice()->set_tid(tid);
+  event.mutable_scheduling_slice()->set_core(3);
+  event.mutable_scheduling_slice()->set_duration_ns(1000);
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(out_timestamp_ns);
+  return event;
+}
+
+ClientCaptureEvent CreateFunctionCall(uint64_t end_timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_function_call()->set_pid(42);
+  event.mutable_function_call()->set_tid(43);
+  event.mutable_function_call()->set_function_id(1);
+  event.mutable_function_call()->set_duration_ns(100);
+  event.mutable_function_call()->set_end_timestamp_ns(end_timestamp_ns);
+  event.mutable_function_call()->set_depth(2);
+  event.mutable_function_call()->set_return_value(7);
+  return event;
+}
+
+ClientCaptureEvent CreateCallstackSample(uint64_t timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_callstack_sample()->set_pid(42);
+  event.mutable_callstack_sample()->set_tid(43);
+  event.mutable_callstack_sample()->set_callstack_id(5);
+  event.mutable_callstack_sample()->set_timestamp_ns(timestamp_ns);
+  return event;
+}
+
+ClientCaptureEvent CreateInternedCallstack() {
+  ClientCaptureEvent event;
+  event.mutable_interned_callstack()->set_key(5);
+  return event;
+}
+
+}  // namespace
+
+TEST(ColumnarEventBatches, PacksEventsIntoBatchesAfterOtherEvents) {
+  std::vector<ClientCaptureEvent> events;
+  events.emplace_back(CreateSchedulingSlice(1, 1'000'000));
+  events.emplace_back(CreateInternedCallstack());
+  events.emplace_back(CreateCallstackSample(1'000'100));
+  events.emplace_back(CreateFunctionCall(1'000'200));
+  ClientCaptureEvent function_call_with_registers = CreateFunctionCall(1'000'300);
+  function_call_with_registers.mutable_function_call()->add_registers(1);
+  events.emplace_back(function_call_with_registers);
+  ClientCaptureEvent page_fault_callstack_sample = CreateCallstackSample(1'000'400);
+  page_fault_callstack_sample.mutable_callstack_sample()->set_memory_event_type(
+      orbit_grpc_protos::CallstackSample::kPageFault);
+  page_fault_callstack_sample.mutable_callstack_sample()->set_memory_event_count(100);
+  events.emplace_back(page_fault_callstack_sample);
+  events.emplace_back(CreateSchedulingSlice(2, 1'000'500));
+  // Out of order.
+  events.emplace_back(CreateSchedulingSlice(3, 999'000));
+
+  std::vector<ClientCaptureEvent> packed_events = PackIntoColumnarEventBatches(std::move(events));
+
+  ASSERT_EQ(packed_events.size(), 6);
+  EXPECT_EQ(packed_events[0].event_case(), ClientCaptureEvent::kInternedCallstack);
+  EXPECT_EQ(packed_events[1].event_case(), ClientCaptureEvent::kFunctionCall);
+  EXPECT_EQ(packed_events[1].function_call().registers_size(), 1);
+  ASSERT_EQ(packed_events[2].event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(packed_events[2].callstack_sample().memory_event_type(),
+            orbit_grpc_protos::CallstackSample::kPageFault);
+  EXPECT_EQ(packed_events[2].callstack_sample().memory_event_count(), 100);
+
+  ASSERT_EQ(packed_events[3].event_case(), ClientCaptureEvent::kSchedulingSliceBatch);
+  const orbit_grpc_protos::SchedulingSliceBatch& scheduling_slices =
+      packed_events[3].scheduling_slice_batch();
+  EXPECT_THAT(scheduling_slices.tid(), testing::ElementsAre(1, 2, 3));
+  EXPECT_THAT(scheduling_slices.pid(), testing::ElementsAre(42, 42, 42));
+  EXPECT_THAT(scheduling_slices.core(), testing::ElementsAre(3, 3, 3));
+  EXPECT_THAT(scheduling_slices.duration_ns(), testing::ElementsAre(1000, 1000, 1000));
+  EXPECT_THAT(scheduling_slices.out_timestamp_ns_delta(),
+              testing::ElementsAre(1'000'000, 500, -1'500));
+
+  ASSERT_EQ(packed_events[4].event_case(), ClientCaptureEvent::kFunctionCallBatch);
+  const orbit_grpc_protos::FunctionCallBatch& function_calls =
+      packed_events[4].function_call_batch();
+  EXPECT_THAT(function_calls.end_timestamp_ns_delta(), testing::ElementsAre(1'000'200));
+  EXPECT_THAT(function_calls.function_id(), testing::ElementsAre(1));
+  EXPECT_THAT(function_calls.duration_ns(), testing::ElementsAre(100));
+  EXPECT_THAT(function_calls.depth(), testing::ElementsAre(2));
+  EXPECT_THAT(function_calls.return_value(), testing::ElementsAre(7));
+
+  ASSERT_EQ(packed_events[5].event_case(), ClientCaptureEvent::kCallstackSampleBatch);
+  const orbit_grpc_protos::CallstackSampleBatch& callstack_samples =
+      packed_events[5].callstack_sample_batch();
+  EXPECT_THAT(callstack_samples.timestamp_ns_delta(), testing::ElementsAre(1'000'100));
+  EXPECT_THAT(callstack_samples.callstack_id(), testing::ElementsAre(5));
+  EXPECT_THAT(callstack_samples.off_cpu_duration_ns(), testing::ElementsAre(0));
+}
+
+TEST(ColumnarEventBatches, BatchIsSmallerThanIndividualEvents) {
+  constexpr uint64_t kEventCount = 1000;
+  std::vector<ClientCaptureEvent> events;
+  uint64_t individual_size_bytes = 0;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    events.emplace_back(
+        CreateSchedulingSlice(static_cast<int32_t>(i % 16), 1'600'000'000'000'000'000 + i * 5000));
+    individual_size_bytes += events.back().ByteSizeLong();
+  }
+
+  std::vector<ClientCaptureEvent> packed_events = PackIntoColumnarEventBatches(std::move(events));
+
+  ASSERT_EQ(packed_events.size(), 1);
+  EXPECT_LT(packed_events[0].ByteSizeLong(), individual_size_bytes / 2);
+}
+
+}  // namespace orbit_service
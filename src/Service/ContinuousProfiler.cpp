@@ -0,0 +1,216 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ContinuousProfiler.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "CaptureServiceImpl.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "ProcessList.h"
+#include "process.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CaptureOptions;
+using orbit_grpc_protos::ContinuousCaptureFile;
+
+namespace {
+
+constexpr const char* kCaptureFileExtension = ".orbit";
+// Capture files are written with this suffix and renamed when complete, so that clients never load
+// a file that is still being written.
+constexpr const char* kIncompleteCaptureFileSuffix = ".part";
+
+[[nodiscard]] bool IsProcessRunning(int32_t pid) {
+  std::error_code error;
+  return std::filesystem::exists(absl::StrFormat("/proc/%d", pid), error);
+}
+
+}  // namespace
+
+CaptureOptions CreateContinuousCaptureOptions(const ContinuousProfilingOptions& options,
+                                              int32_t pid) {
+  CaptureOptions capture_options;
+  capture_options.set_pid(pid);
+  capture_options.set_samples_per_second(options.samples_per_second);
+  capture_options.set_unwinding_method(CaptureOptions::kFramePointers);
+  // With frame pointers, the stack is only needed to fix the caller of leaf functions.
+  constexpr uint32_t kStackDumpSize = 512;
+  capture_options.set_stack_dump_size(kStackDumpSize);
+  capture_options.set_wait_for_ring_buffer_data_with_epoll(true);
+  capture_options.set_statistics_summary_interval_ns(
+      absl::ToInt64Nanoseconds(options.statistics_summary_interval));
+  return capture_options;
+}
+
+std::filesystem::path GenerateContinuousCaptureFilePath(const std::filesystem::path& directory,
+                                                        int32_t pid, absl::Time start_time) {
+  return directory / absl::StrFormat("%s_%d%s",
+                                     absl::FormatTime("%Y_%m_%d_%H_%M_%S", start_time,
+                                                      absl::UTCTimeZone()),
+                                     pid, kCaptureFileExtension);
+}
+
+ErrorMessageOr<std::vector<ContinuousCaptureFile>> ListContinuousCaptureFiles(
+    const std::filesystem::path& directory) {
+  OUTCOME_TRY(paths, orbit_base::ListFilesInDirectory(directory));
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<ContinuousCaptureFile> files;
+  for (const std::filesystem::path& path : paths) {
+    if (path.extension() != kCaptureFileExtension) continue;
+    std::error_code error;
+    const uintmax_t size_bytes = std::filesystem::file_size(path, error);
+    // The file can have been deleted in the meantime.
+    if (error) continue;
+    ContinuousCaptureFile& file = files.emplace_back();
+    file.set_path(path.string());
+    file.set_size_bytes(size_bytes);
+  }
+  return files;
+}
+
+ErrorMessageOr<void> EnforceContinuousCaptureRetention(const std::filesystem::path& directory,
+                                                       uint64_t max_file_count,
+                                                       uint64_t max_total_size_bytes) {
+  OUTCOME_TRY(paths, orbit_base::ListFilesInDirectory(directory));
+  for (const std::filesystem::path& path : paths) {
+    if (path.extension() != kIncompleteCaptureFileSuffix) continue;
+    LOG("Deleting incomplete capture file \"%s\"", path.string());
+    OUTCOME_TRY(orbit_base::RemoveFile(path));
+  }
+
+  OUTCOME_TRY(files, ListContinuousCaptureFiles(directory));
+  uint64_t total_size_bytes = 0;
+  for (const ContinuousCaptureFile& file : files) {
+    total_size_bytes += file.size_bytes();
+  }
+  uint64_t file_count = files.size();
+  for (const ContinuousCaptureFile& file : files) {
+    if (file_count <= max_file_count && total_size_bytes <= max_total_size_bytes) break;
+    LOG("Deleting capture file \"%s\" of continuous profiling", file.path());
+    OUTCOME_TRY(orbit_base::RemoveFile(file.path()));
+    --file_count;
+    total_size_bytes -= file.size_bytes();
+  }
+  return outcome::success();
+}
+
+ContinuousProfiler::ContinuousProfiler(CaptureServiceImpl* capture_service,
+                                       ContinuousProfilingOptions options)
+    : capture_service_{capture_service}, options_{std::move(options)} {
+  CHECK(capture_service_ != nullptr);
+  CHECK(options_.pid != 0 || !options_.process_name.empty());
+}
+
+void ContinuousProfiler::Start() {
+  CHECK(!thread_.joinable());
+  thread_ = std::thread{&ContinuousProfiler::Run, this};
+}
+
+void ContinuousProfiler::Stop() {
+  if (!thread_.joinable()) return;
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  thread_.join();
+}
+
+bool ContinuousProfiler::WaitForStopRequest(absl::Duration timeout) {
+  absl::MutexLock lock{&mutex_};
+  return mutex_.AwaitWithTimeout(absl::Condition(&stop_requested_), timeout);
+}
+
+std::optional<int32_t> ContinuousProfiler::FindProcessToProfile() const {
+  if (options_.pid != 0) {
+    if (!IsProcessRunning(options_.pid)) return std::nullopt;
+    return options_.pid;
+  }
+
+  ProcessList process_list;
+  if (ErrorMessageOr<void> result = process_list.Refresh(); result.has_error()) {
+    ERROR("Listing processes for continuous profiling: %s", result.error().message());
+    return std::nullopt;
+  }
+  std::optional<int32_t> pid;
+  for (const orbit_grpc_protos::ProcessInfo& process : process_list.GetProcesses()) {
+    if (process.name() != options_.process_name) continue;
+    // The oldest of several processes with the name is the most likely to be the main one.
+    if (!pid.has_value() || process.pid() < pid.value()) pid = process.pid();
+  }
+  return pid;
+}
+
+ErrorMessageOr<void> ContinuousProfiler::CaptureFile(int32_t pid) {
+  const absl::Time start_time = absl::Now();
+  const std::filesystem::path capture_file_path =
+      GenerateContinuousCaptureFilePath(kContinuousCaptureDirectory, pid, start_time);
+  std::filesystem::path incomplete_capture_file_path = capture_file_path;
+  incomplete_capture_file_path += kIncompleteCaptureFileSuffix;
+
+  LOG("Continuous profiling of process %d to \"%s\"", pid, capture_file_path.string());
+  const absl::Time end_time = start_time + options_.file_duration;
+  OUTCOME_TRY(capture_service_->CaptureToFileOnService(
+      CreateContinuousCaptureOptions(options_, pid), incomplete_capture_file_path,
+      [this, pid, end_time] {
+        if (absl::Now() >= end_time || !IsProcessRunning(pid)) return true;
+        absl::MutexLock lock{&mutex_};
+        return stop_requested_;
+      }));
+  OUTCOME_TRY(orbit_base::MoveFile(incomplete_capture_file_path, capture_file_path));
+  return outcome::success();
+}
+
+void ContinuousProfiler::Run() {
+  orbit_base::SetCurrentThreadName("ContinuousProf");
+  // How long to wait before looking for the process again, or after a failed capture, e.g.,
+  // because a client is capturing.
+  constexpr absl::Duration kRetryInterval = absl::Seconds(10);
+
+  if (ErrorMessageOr<bool> result = orbit_base::CreateDirectory(kContinuousCaptureDirectory);
+      result.has_error()) {
+    ERROR("Creating directory \"%s\" for continuous profiling: %s",
+          kContinuousCaptureDirectory.string(), result.error().message());
+    return;
+  }
+
+  bool is_waiting_for_process = false;
+  while (true) {
+    if (ErrorMessageOr<void> result = EnforceContinuousCaptureRetention(
+            kContinuousCaptureDirectory, options_.max_file_count, options_.max_total_size_bytes);
+        result.has_error()) {
+      ERROR("Enforcing the retention of continuous profiling: %s", result.error().message());
+    }
+
+    std::optional<int32_t> pid = FindProcessToProfile();
+    if (!pid.has_value()) {
+      if (!is_waiting_for_process) {
+        LOG("Continuous profiling is waiting for the process to profile");
+        is_waiting_for_process = true;
+      }
+      if (WaitForStopRequest(kRetryInterval)) return;
+      continue;
+    }
+    is_waiting_for_process = false;
+
+    if (ErrorMessageOr<void> result = CaptureFile(pid.value()); result.has_error()) {
+      ERROR("Continuous profiling: %s", result.error().message());
+      if (WaitForStopRequest(kRetryInterval)) return;
+      continue;
+    }
+    if (WaitForStopRequest(absl::ZeroDuration())) return;
+  }
+}
+
+}  // namespace orbit_service
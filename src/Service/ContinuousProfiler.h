@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CONTINUOUS_PROFILER_H_
+#define ORBIT_SERVICE_CONTINUOUS_PROFILER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
+#include <stdint.h>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+#include "services.pb.h"
+
+namespace orbit_service {
+
+class CaptureServiceImpl;
+
+// The capture files of continuous profiling go to a directory of their own, so that the retention
+// limits never delete the captures saved on the service by clients.
+inline const std::filesystem::path kContinuousCaptureDirectory{
+    "/var/tmp/orbit_captures/continuous"};
+
+struct ContinuousProfilingOptions {
+  // The process to profile: the one with `pid` if not 0, otherwise the first one whose name is
+  // `process_name`. The process is waited for when there is none, e.g., after it exited.
+  int32_t pid = 0;
+  std::string process_name;
+  double samples_per_second = 19;
+  // How long each capture file covers.
+  absl::Duration file_duration = absl::Hours(1);
+  // The interval of the statistics summaries the capture files contain instead of the individual
+  // samples (see CaptureOptions::statistics_summary_interval_ns), or zero to keep all samples.
+  absl::Duration statistics_summary_interval = absl::Minutes(1);
+  // The oldest capture files are deleted beyond any of these limits.
+  uint64_t max_file_count = 168;
+  uint64_t max_total_size_bytes = 1024ULL * 1024 * 1024;
+};
+
+// The capture options of one capture file of continuous profiling of `pid`: sampling with frame
+// pointers at a low rate, and nothing that needs to modify the process or to trace every event,
+// such as instrumentation, the Orbit API, context switches or thread states.
+[[nodiscard]] orbit_grpc_protos::CaptureOptions CreateContinuousCaptureOptions(
+    const ContinuousProfilingOptions& options, int32_t pid);
+
+// The file names start with the time in UTC, so that they sort chronologically.
+[[nodiscard]] std::filesystem::path GenerateContinuousCaptureFilePath(
+    const std::filesystem::path& directory, int32_t pid, absl::Time start_time);
+
+// Returns the complete capture files in `directory`, oldest first.
+[[nodiscard]] ErrorMessageOr<std::vector<orbit_grpc_protos::ContinuousCaptureFile>>
+ListContinuousCaptureFiles(const std::filesystem::path& directory);
+
+// Deletes the oldest capture files in `directory` until there are at most `max_file_count` of
+// them, taking at most `max_total_size_bytes` in total. Also deletes the incomplete files left by
+// a previous run of the service that exited during a capture.
+[[nodiscard]] ErrorMessageOr<void> EnforceContinuousCaptureRetention(
+    const std::filesystem::path& directory, uint64_t max_file_count,
+    uint64_t max_total_size_bytes);
+
+// Profiles a process without a client, on a thread of its own between Start and Stop, in a capture
+// file per ContinuousProfilingOptions::file_duration. The captures requested by clients take
+// precedence: the current file is then finished early, and the next one starts after the capture
+// of the client. The CPU usage is bounded by the low sampling rate, and the memory usage by the
+// statistics summaries and by the --max_capture_event_buffer_mb of the service.
+class ContinuousProfiler {
+ public:
+  ContinuousProfiler(CaptureServiceImpl* capture_service, ContinuousProfilingOptions options);
+  ~ContinuousProfiler() { Stop(); }
+
+  ContinuousProfiler(const ContinuousProfiler&) = delete;
+  ContinuousProfiler& operator=(const ContinuousProfiler&) = delete;
+
+  void Start();
+  // Finishes the current capture file and waits for the thread to exit.
+  void Stop();
+
+ private:
+  void Run();
+  // Waits up to `timeout` and returns whether Stop was called.
+  [[nodiscard]] bool WaitForStopRequest(absl::Duration timeout);
+  [[nodiscard]] std::optional<int32_t> FindProcessToProfile() const;
+  [[nodiscard]] ErrorMessageOr<void> CaptureFile(int32_t pid);
+
+  CaptureServiceImpl* capture_service_;
+  const ContinuousProfilingOptions options_;
+  std::thread thread_;
+
+  absl::Mutex mutex_;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_CONTINUOUS_PROFILER_H_
@@ -0,0 +1,152 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "ContinuousProfiler.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Result.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/WriteStringToFile.h"
+#include "capture.pb.h"
+#include "services.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CaptureOptions;
+using orbit_grpc_protos::ContinuousCaptureFile;
+
+namespace {
+
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    ErrorMessageOr<orbit_base::TemporaryFile> temporary_file_or_error =
+        orbit_base::TemporaryFile::Create();
+    CHECK(temporary_file_or_error.has_value());
+    // The path of the temporary file is unique, and free once the file is removed.
+    path_ = temporary_file_or_error.value().file_path();
+    temporary_file_or_error.value().CloseAndRemove();
+    std::filesystem::create_directory(path_);
+  }
+  ~TemporaryDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+  }
+
+  [[nodiscard]] const std::filesystem::path& path() const { return path_; }
+
+ private:
+  std::filesystem::path path_;
+};
+
+void WriteFileOfSize(const std::filesystem::path& path, size_t size) {
+  ErrorMessageOr<void> result = orbit_base::WriteStringToFile(path, std::string(size, 'x'));
+  ASSERT_FALSE(result.has_error()) << result.error().message();
+}
+
+[[nodiscard]] std::vector<std::string> ListFileNames(const std::filesystem::path& directory) {
+  ErrorMessageOr<std::vector<ContinuousCaptureFile>> files_or_error =
+      ListContinuousCaptureFiles(directory);
+  CHECK(files_or_error.has_value());
+  std::vector<std::string> file_names;
+  for (const ContinuousCaptureFile& file : files_or_error.value()) {
+    file_names.push_back(std::filesystem::path{file.path()}.filename().string());
+  }
+  return file_names;
+}
+
+}  // namespace
+
+TEST(ContinuousProfiler, CreateContinuousCaptureOptionsOnlySamples) {
+  ContinuousProfilingOptions options;
+  options.samples_per_second = 19;
+  options.statistics_summary_interval = absl::Seconds(30);
+
+  CaptureOptions capture_options = CreateContinuousCaptureOptions(options, 42);
+  EXPECT_EQ(capture_options.pid(), 42);
+  EXPECT_EQ(capture_options.samples_per_second(), 19);
+  EXPECT_EQ(capture_options.unwinding_method(), CaptureOptions::kFramePointers);
+  EXPECT_EQ(capture_options.statistics_summary_interval_ns(), 30'000'000'000);
+  EXPECT_TRUE(capture_options.instrumented_functions().empty());
+  EXPECT_FALSE(capture_options.enable_api());
+  EXPECT_FALSE(capture_options.enable_user_space_instrumentation());
+  EXPECT_FALSE(capture_options.trace_context_switches());
+  EXPECT_FALSE(capture_options.trace_thread_state());
+}
+
+TEST(ContinuousProfiler, GenerateContinuousCaptureFilePathSortsChronologically) {
+  const absl::Time time =
+      absl::FromCivil(absl::CivilSecond(2021, 9, 30, 23, 5, 1), absl::UTCTimeZone());
+  EXPECT_EQ(GenerateContinuousCaptureFilePath("/dir", 42, time),
+            std::filesystem::path{"/dir/2021_09_30_23_05_01_42.orbit"});
+  EXPECT_LT(GenerateContinuousCaptureFilePath("/dir", 42, time),
+            GenerateContinuousCaptureFilePath("/dir", 7, time + absl::Hours(1)));
+}
+
+TEST(ContinuousProfiler, ListContinuousCaptureFilesOldestFirst) {
+  TemporaryDirectory directory;
+  WriteFileOfSize(directory.path() / "2021_09_30_23_00_00_42.orbit", 3);
+  WriteFileOfSize(directory.path() / "2021_09_30_21_00_00_42.orbit", 1);
+  WriteFileOfSize(directory.path() / "2021_09_30_22_00_00_42.orbit", 2);
+  WriteFileOfSize(directory.path() / "2021_09_30_23_30_00_42.orbit.part", 4);
+
+  ErrorMessageOr<std::vector<ContinuousCaptureFile>> files_or_error =
+      ListContinuousCaptureFiles(directory.path());
+  ASSERT_TRUE(files_or_error.has_value()) << files_or_error.error().message();
+  const std::vector<ContinuousCaptureFile>& files = files_or_error.value();
+  ASSERT_EQ(files.size(), 3);
+  EXPECT_EQ(files[0].path(), (directory.path() / "2021_09_30_21_00_00_42.orbit").string());
+  EXPECT_EQ(files[0].size_bytes(), 1);
+  EXPECT_EQ(files[1].path(), (directory.path() / "2021_09_30_22_00_00_42.orbit").string());
+  EXPECT_EQ(files[1].size_bytes(), 2);
+  EXPECT_EQ(files[2].path(), (directory.path() / "2021_09_30_23_00_00_42.orbit").string());
+  EXPECT_EQ(files[2].size_bytes(), 3);
+}
+
+TEST(ContinuousProfiler, ListContinuousCaptureFilesFailsWithoutDirectory) {
+  TemporaryDirectory directory;
+  EXPECT_TRUE(ListContinuousCaptureFiles(directory.path() / "missing").has_error());
+}
+
+TEST(ContinuousProfiler, EnforceContinuousCaptureRetentionDeletesOldestFiles) {
+  TemporaryDirectory directory;
+  WriteFileOfSize(directory.path() / "2021_09_30_21_00_00_42.orbit", 10);
+  WriteFileOfSize(directory.path() / "2021_09_30_22_00_00_42.orbit", 10);
+  WriteFileOfSize(directory.path() / "2021_09_30_23_00_00_42.orbit", 10);
+  WriteFileOfSize(directory.path() / "2021_10_01_00_00_00_42.orbit", 10);
+
+  ASSERT_FALSE(EnforceContinuousCaptureRetention(directory.path(), 3, 1000).has_error());
+  EXPECT_THAT(ListFileNames(directory.path()),
+              testing::ElementsAre("2021_09_30_22_00_00_42.orbit", "2021_09_30_23_00_00_42.orbit",
+                                   "2021_10_01_00_00_00_42.orbit"));
+
+  ASSERT_FALSE(EnforceContinuousCaptureRetention(directory.path(), 3, 25).has_error());
+  EXPECT_THAT(ListFileNames(directory.path()),
+              testing::ElementsAre("2021_09_30_23_00_00_42.orbit", "2021_10_01_00_00_00_42.orbit"));
+
+  ASSERT_FALSE(EnforceContinuousCaptureRetention(directory.path(), 3, 25).has_error());
+  EXPECT_EQ(ListFileNames(directory.path()).size(), 2);
+}
+
+TEST(ContinuousProfiler, EnforceContinuousCaptureRetentionDeletesIncompleteFiles) {
+  TemporaryDirectory directory;
+  WriteFileOfSize(directory.path() / "2021_09_30_21_00_00_42.orbit", 10);
+  WriteFileOfSize(directory.path() / "2021_09_30_22_00_00_42.orbit.part", 10);
+
+  ASSERT_FALSE(EnforceContinuousCaptureRetention(directory.path(), 3, 1000).has_error());
+  EXPECT_FALSE(std::filesystem::exists(directory.path() / "2021_09_30_22_00_00_42.orbit.part"));
+  EXPECT_THAT(ListFileNames(directory.path()),
+              testing::ElementsAre("2021_09_30_21_00_00_42.orbit"));
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FlightRecorderCaptureEventBuffer.h"
+
+#include <utility>
+
+#include "CaptureEventPriority.h"
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+FlightRecorderCaptureEventBuffer::FlightRecorderCaptureEventBuffer(CaptureEventSender* event_sender,
+                                                                   uint64_t window_ns)
+    : capture_event_sender_{event_sender}, window_ns_{window_ns} {
+  CHECK(capture_event_sender_ != nullptr);
+  CHECK(window_ns_ > 0);
+}
+
+void FlightRecorderCaptureEventBuffer::AddEvent(ClientCaptureEvent&& event) {
+  const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  absl::MutexLock lock{&mutex_};
+  if (stop_requested_) {
+    return;
+  }
+  AddEventLocked(std::move(event), timestamp_ns);
+  EvictEventsOlderThan(timestamp_ns);
+}
+
+void FlightRecorderCaptureEventBuffer::AddEvents(std::vector<ClientCaptureEvent>&& events) {
+  const uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  absl::MutexLock lock{&mutex_};
+  if (stop_requested_) {
+    return;
+  }
+  for (ClientCaptureEvent& event : events) {
+    AddEventLocked(std::move(event), timestamp_ns);
+  }
+  EvictEventsOlderThan(timestamp_ns);
+}
+
+void FlightRecorderCaptureEventBuffer::AddEventLocked(ClientCaptureEvent&& event,
+                                                      uint64_t timestamp_ns) {
+  window_events_.push_back(RetainedEvent{timestamp_ns, std::move(event)});
+}
+
+void FlightRecorderCaptureEventBuffer::EvictEventsOlderThan(uint64_t timestamp_ns) {
+  if (timestamp_ns < window_ns_) {
+    return;
+  }
+  const uint64_t window_start_ns = timestamp_ns - window_ns_;
+  while (!window_events_.empty() && window_events_.front().timestamp_ns < window_start_ns) {
+    ClientCaptureEvent& event = window_events_.front().event;
+    if (GetCaptureEventPriority(event.event_case()) == CaptureEventPriority::kEssential) {
+      essential_events_.emplace_back(std::move(event));
+    } else {
+      ++evicted_event_count_;
+    }
+    window_events_.pop_front();
+  }
+}
+
+std::vector<ClientCaptureEvent> FlightRecorderCaptureEventBuffer::TakeRetainedEvents() {
+  std::vector<ClientCaptureEvent> events = std::move(essential_events_);
+  essential_events_.clear();
+  events.reserve(events.size() + window_events_.size());
+  for (RetainedEvent& retained_event : window_events_) {
+    events.emplace_back(std::move(retained_event.event));
+  }
+  window_events_.clear();
+  if (evicted_event_count_ > 0) {
+    LOG("Flight recorder discarded %u events that were older than its window",
+        evicted_event_count_);
+    evicted_event_count_ = 0;
+  }
+  return events;
+}
+
+void FlightRecorderCaptureEventBuffer::SendSnapshot() {
+  ORBIT_SCOPE_FUNCTION;
+  std::vector<ClientCaptureEvent> events;
+  {
+    absl::MutexLock lock{&mutex_};
+    events = TakeRetainedEvents();
+  }
+  // Don't hold the mutex while sending, as that can take a while and producers would be blocked.
+  if (!events.empty()) {
+    capture_event_sender_->SendEvents(std::move(events));
+  }
+}
+
+void FlightRecorderCaptureEventBuffer::StopAndSendSnapshot() {
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  SendSnapshot();
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_FLIGHT_RECORDER_CAPTURE_EVENT_BUFFER_H_
+#define ORBIT_SERVICE_FLIGHT_RECORDER_CAPTURE_EVENT_BUFFER_H_
+
+#include <absl/synchronization/mutex.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "CaptureEventSender.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// This CaptureEventBuffer doesn't send the events as they arrive, but only keeps the events added
+// in the last window_ns nanoseconds, so that a capture can run indefinitely at bounded memory.
+// Older events are discarded, except for the kEssential ones (see CaptureEventPriority), as the
+// events in the window might refer to them. SendSnapshot passes the retained events to the
+// CaptureEventSender.
+// The window is measured on the time the events are added to the buffer, not on their timestamps,
+// so that events with a duration, or that producers batch, don't need special treatment.
+class FlightRecorderCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  FlightRecorderCaptureEventBuffer(CaptureEventSender* event_sender, uint64_t window_ns);
+
+  void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
+  void AddEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) override;
+
+  // Sends the essential events retained since the last snapshot, followed by the events of the
+  // current window, and clears the buffer, so that consecutive snapshots never overlap.
+  void SendSnapshot();
+
+  // Sends a last snapshot. Events added from now on are dropped.
+  void StopAndSendSnapshot();
+
+ private:
+  struct RetainedEvent {
+    uint64_t timestamp_ns;
+    orbit_grpc_protos::ClientCaptureEvent event;
+  };
+
+  void AddEventLocked(orbit_grpc_protos::ClientCaptureEvent&& event, uint64_t timestamp_ns)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void EvictEventsOlderThan(uint64_t timestamp_ns) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] std::vector<orbit_grpc_protos::ClientCaptureEvent> TakeRetainedEvents()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  CaptureEventSender* capture_event_sender_;
+  const uint64_t window_ns_;
+
+  absl::Mutex mutex_;
+  std::deque<RetainedEvent> window_events_ ABSL_GUARDED_BY(mutex_);
+  std::vector<orbit_grpc_protos::ClientCaptureEvent> essential_events_ ABSL_GUARDED_BY(mutex_);
+  uint64_t evicted_event_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_FLIGHT_RECORDER_CAPTURE_EVENT_BUFFER_H_
@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "FlightRecorderCaptureEventBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+class FakeCaptureEventSender final : public CaptureEventSender {
+ public:
+  void SendEvents(std::vector<ClientCaptureEvent>&& events) override {
+    for (ClientCaptureEvent& event : events) {
+      sent_events_.emplace_back(std::move(event));
+    }
+  }
+
+  [[nodiscard]] std::vector<ClientCaptureEvent> TakeSentEvents() {
+    std::vector<ClientCaptureEvent> sent_events = std::move(sent_events_);
+    sent_events_.clear();
+    return sent_events;
+  }
+
+ private:
+  std::vector<ClientCaptureEvent> sent_events_;
+};
+
+ClientCaptureEvent CreateSchedulingSlice(uint64_t tid) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_tid(tid);
+  return event;
+}
+
+ClientCaptureEvent CreateInternedString(uint64_t key) {
+  ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(key);
+  return event;
+}
+
+constexpr std::chrono::milliseconds kWindow{200};
+
+}  // namespace
+
+TEST(FlightRecorderCaptureEventBuffer, SendsNothingUntilSnapshot) {
+  FakeCaptureEventSender sender;
+  FlightRecorderCaptureEventBuffer buffer{&sender, std::chrono::nanoseconds{kWindow}.count()};
+  buffer.AddEvent(CreateSchedulingSlice(1));
+  EXPECT_TRUE(sender.TakeSentEvents().empty());
+
+  buffer.SendSnapshot();
+  std::vector<ClientCaptureEvent> sent_events = sender.TakeSentEvents();
+  ASSERT_EQ(sent_events.size(), 1);
+  EXPECT_EQ(sent_events[0].scheduling_slice().tid(), 1);
+}
+
+TEST(FlightRecorderCaptureEventBuffer, EvictsOldEventsButKeepsEssentialOnes) {
+  FakeCaptureEventSender sender;
+  FlightRecorderCaptureEventBuffer buffer{&sender, std::chrono::nanoseconds{kWindow}.count()};
+  buffer.AddEvents({CreateInternedString(1), CreateSchedulingSlice(1)});
+  std::this_thread::sleep_for(2 * kWindow);
+  buffer.AddEvents({CreateSchedulingSlice(2), CreateInternedString(2)});
+
+  buffer.StopAndSendSnapshot();
+  std::vector<ClientCaptureEvent> sent_events = sender.TakeSentEvents();
+  ASSERT_EQ(sent_events.size(), 3);
+  EXPECT_EQ(sent_events[0].interned_string().key(), 1);
+  EXPECT_EQ(sent_events[1].scheduling_slice().tid(), 2);
+  EXPECT_EQ(sent_events[2].interned_string().key(), 2);
+}
+
+TEST(FlightRecorderCaptureEventBuffer, SnapshotsDontOverlap) {
+  FakeCaptureEventSender sender;
+  FlightRecorderCaptureEventBuffer buffer{&sender, std::chrono::nanoseconds{kWindow}.count()};
+  buffer.AddEvent(CreateSchedulingSlice(1));
+  buffer.SendSnapshot();
+  EXPECT_EQ(sender.TakeSentEvents().size(), 1);
+
+  buffer.AddEvent(CreateSchedulingSlice(2));
+  buffer.SendSnapshot();
+  std::vector<ClientCaptureEvent> sent_events = sender.TakeSentEvents();
+  ASSERT_EQ(sent_events.size(), 1);
+  EXPECT_EQ(sent_events[0].scheduling_slice().tid(), 2);
+}
+
+TEST(FlightRecorderCaptureEventBuffer, DropsEventsAfterStop) {
+  FakeCaptureEventSender sender;
+  FlightRecorderCaptureEventBuffer buffer{&sender, std::chrono::nanoseconds{kWindow}.count()};
+  buffer.StopAndSendSnapshot();
+  buffer.AddEvent(CreateSchedulingSlice(1));
+  buffer.SendSnapshot();
+  EXPECT_TRUE(sender.TakeSentEvents().empty());
+}
+
+}  // namespace orbit_service
@@ -9,6 +9,8 @@
 #include <memory>
 #include <optional>
 #include <outcome.hpp>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "FramePointerValidator/FramePointerValidator.h"
@@ -37,19 +39,62 @@ grpc::Status FramePointerValidatorServiceImpl::ValidateFramePointers(
   }
 
   bool is_64_bit = elf_file_result.value()->Is64Bit();
+  const std::string build_id = elf_file_result.value()->GetBuildId();
 
-  std::vector<CodeBlock> function_infos(request->functions().begin(), request->functions().end());
+  // Functions are identified by offset and size.
+  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, bool> function_has_frame_pointers;
+  std::vector<CodeBlock> function_infos;
+  {
+    absl::MutexLock lock{&mutex_};
+    // Without a build id, a different file at the same path can't be told apart.
+    const auto cached_functions_it = build_id.empty()
+                                         ? build_id_to_validated_functions_.end()
+                                         : build_id_to_validated_functions_.find(build_id);
+    for (const CodeBlock& function : request->functions()) {
+      const std::pair<uint64_t, uint64_t> key{function.offset(), function.size()};
+      if (cached_functions_it != build_id_to_validated_functions_.end()) {
+        const auto cached_function_it = cached_functions_it->second.find(key);
+        if (cached_function_it != cached_functions_it->second.end()) {
+          function_has_frame_pointers.emplace(key, cached_function_it->second);
+          continue;
+        }
+      }
+      function_infos.push_back(function);
+    }
+  }
+
+  if (!function_infos.empty()) {
+    std::optional<std::vector<CodeBlock>> functions =
+        FramePointerValidator::GetFpoFunctions(function_infos, request->module_path(), is_64_bit);
+
+    if (!functions.has_value()) {
+      return grpc::Status(
+          grpc::StatusCode::INTERNAL,
+          absl::StrFormat("Unable to verify functions of module %s", request->module_path()));
+    }
 
-  std::optional<std::vector<CodeBlock>> functions =
-      FramePointerValidator::GetFpoFunctions(function_infos, request->module_path(), is_64_bit);
+    absl::flat_hash_map<std::pair<uint64_t, uint64_t>, bool> validated_functions;
+    for (const CodeBlock& function : function_infos) {
+      validated_functions.insert_or_assign({function.offset(), function.size()}, true);
+    }
+    for (const CodeBlock& function : functions.value()) {
+      validated_functions.insert_or_assign({function.offset(), function.size()}, false);
+    }
+    function_has_frame_pointers.insert(validated_functions.begin(), validated_functions.end());
 
-  if (!functions.has_value()) {
-    return grpc::Status(
-        grpc::StatusCode::INTERNAL,
-        absl::StrFormat("Unable to verify functions of module %s", request->module_path()));
+    if (!build_id.empty()) {
+      absl::MutexLock lock{&mutex_};
+      if (!build_id_to_validated_functions_.contains(build_id) &&
+          build_id_to_validated_functions_.size() >= kMaxCachedModules) {
+        build_id_to_validated_functions_.clear();
+      }
+      build_id_to_validated_functions_[build_id].insert(validated_functions.begin(),
+                                                        validated_functions.end());
+    }
   }
 
-  for (const auto& function : functions.value()) {
+  for (const CodeBlock& function : request->functions()) {
+    if (function_has_frame_pointers.at({function.offset(), function.size()})) continue;
     CodeBlock* added_function = response->add_functions_without_frame_pointer();
     added_function->set_offset(function.offset());
     added_function->set_size(function.size());
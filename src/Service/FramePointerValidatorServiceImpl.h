@@ -5,8 +5,15 @@
 #ifndef ORBIT_CORE_FRAME_POINTER_VALIDATOR_SERVICE_H_
 #define ORBIT_CORE_FRAME_POINTER_VALIDATOR_SERVICE_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
 #include <grpcpp/grpcpp.h>
 
+#include <cstdint>
+#include <string>
+#include <utility>
+
 #include "services.grpc.pb.h"
 #include "services.pb.h"
 
@@ -22,6 +29,17 @@ class FramePointerValidatorServiceImpl final
   [[nodiscard]] grpc::Status ValidateFramePointers(
       grpc::ServerContext* context, const orbit_grpc_protos::ValidateFramePointersRequest* request,
       orbit_grpc_protos::ValidateFramePointersResponse* response) override;
+
+ private:
+  // The results are cached by build id, so that validating the same module again only validates
+  // the functions that weren't requested before. The cache is cleared when it holds this many
+  // modules.
+  static constexpr size_t kMaxCachedModules = 32;
+
+  absl::Mutex mutex_;
+  // For each build id, whether each function, by offset and size, has frame pointers.
+  absl::flat_hash_map<std::string, absl::flat_hash_map<std::pair<uint64_t, uint64_t>, bool>>
+      build_id_to_validated_functions_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace orbit_service
@@ -8,6 +8,7 @@
 #include <unistd.h>
 
 #include <utility>
+#include <vector>
 
 #include "GrpcProtos/Constants.h"
 #include "OrbitBase/Logging.h"
@@ -30,17 +31,18 @@ using orbit_grpc_protos::kLinuxTracingProducerId;
 void LinuxTracingHandler::Start(CaptureOptions capture_options) {
   CHECK(tracer_ == nullptr);
   bool enable_introspection = capture_options.enable_introspection();
+  uint32_t introspection_sampling_period = capture_options.introspection_sampling_period();
 
   tracer_ = std::make_unique<orbit_linux_tracing::Tracer>(std::move(capture_options));
   tracer_->SetListener(this);
   tracer_->Start();
 
   if (enable_introspection) {
-    SetupIntrospection();
+    SetupIntrospection(introspection_sampling_period);
   }
 }
 
-void LinuxTracingHandler::SetupIntrospection() {
+void LinuxTracingHandler::SetupIntrospection(uint32_t sampling_period) {
   orbit_tracing_listener_ = std::make_unique<orbit_introspection::TracingListener>(
       [this](const orbit_introspection::TracingScope& scope) {
         IntrospectionScope introspection_scope;
@@ -57,7 +59,8 @@ void LinuxTracingHandler::SetupIntrospection() {
         introspection_scope.add_registers(scope.encoded_event.args[4]);
         introspection_scope.add_registers(scope.encoded_event.args[5]);
         OnIntrospectionScope(introspection_scope);
-      });
+      },
+      sampling_period);
 }
 
 void LinuxTracingHandler::Stop() {
@@ -163,4 +166,77 @@ void LinuxTracingHandler::OnOutOfOrderEventsDiscardedEvent(
   producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
 }
 
+void LinuxTracingHandler::OnSamplingPeriodChangedEvent(
+    orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) {
+  orbit_grpc_protos::ProducerCaptureEvent event;
+  *event.mutable_sampling_period_changed_event() = std::move(sampling_period_changed_event);
+  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+}
+
+void LinuxTracingHandler::OnPmuCountersSample(
+    orbit_grpc_protos::PmuCountersSample pmu_counters_sample) {
+  orbit_grpc_protos::ProducerCaptureEvent event;
+  *event.mutable_pmu_counters_sample() = std::move(pmu_counters_sample);
+  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+}
+
+void LinuxTracingHandler::OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) {
+  orbit_grpc_protos::ProducerCaptureEvent event;
+  *event.mutable_warning_event() = std::move(warning_event);
+  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+}
+
+void LinuxTracingHandler::OnServiceHealthEvent(
+    orbit_grpc_protos::ServiceHealthEvent service_health_event) {
+  orbit_grpc_protos::ProducerCaptureEvent event;
+  *event.mutable_service_health_event() = std::move(service_health_event);
+  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+}
+
+void LinuxTracingHandler::OnPipelineLatencyProbe(
+    orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) {
+  orbit_grpc_protos::ProducerCaptureEvent event;
+  *event.mutable_pipeline_latency_probe() = std::move(pipeline_latency_probe);
+  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+}
+
+void LinuxTracingHandler::OnCaptureStatisticsSummary(
+    orbit_grpc_protos::CaptureStatisticsSummary capture_statistics_summary) {
+  orbit_grpc_protos::ProducerCaptureEvent event;
+  *event.mutable_capture_statistics_summary() = std::move(capture_statistics_summary);
+  producer_event_processor_->ProcessEvent(kLinuxTracingProducerId, std::move(event));
+}
+
+void LinuxTracingHandler::OnSchedulingSlices(std::vector<SchedulingSlice> scheduling_slices) {
+  std::vector<ProducerCaptureEvent> events(scheduling_slices.size());
+  for (size_t i = 0; i < scheduling_slices.size(); ++i) {
+    *events[i].mutable_scheduling_slice() = std::move(scheduling_slices[i]);
+  }
+  producer_event_processor_->ProcessEvents(kLinuxTracingProducerId, std::move(events));
+}
+
+void LinuxTracingHandler::OnCallstackSamples(std::vector<FullCallstackSample> callstack_samples) {
+  std::vector<ProducerCaptureEvent> events(callstack_samples.size());
+  for (size_t i = 0; i < callstack_samples.size(); ++i) {
+    *events[i].mutable_full_callstack_sample() = std::move(callstack_samples[i]);
+  }
+  producer_event_processor_->ProcessEvents(kLinuxTracingProducerId, std::move(events));
+}
+
+void LinuxTracingHandler::OnFunctionCalls(std::vector<FunctionCall> function_calls) {
+  std::vector<ProducerCaptureEvent> events(function_calls.size());
+  for (size_t i = 0; i < function_calls.size(); ++i) {
+    *events[i].mutable_function_call() = std::move(function_calls[i]);
+  }
+  producer_event_processor_->ProcessEvents(kLinuxTracingProducerId, std::move(events));
+}
+
+void LinuxTracingHandler::OnThreadStateSlices(std::vector<ThreadStateSlice> thread_state_slices) {
+  std::vector<ProducerCaptureEvent> events(thread_state_slices.size());
+  for (size_t i = 0; i < thread_state_slices.size(); ++i) {
+    *events[i].mutable_thread_state_slice() = std::move(thread_state_slices[i]);
+  }
+  producer_event_processor_->ProcessEvents(kLinuxTracingProducerId, std::move(events));
+}
+
 }  // namespace orbit_service
@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Introspection/Introspection.h"
 #include "LinuxTracing/Tracer.h"
@@ -54,6 +55,24 @@ class LinuxTracingHandler : public orbit_linux_tracing::TracerListener {
       orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) override;
   void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
                                             out_of_order_events_discarded_event) override;
+  void OnSamplingPeriodChangedEvent(
+      orbit_grpc_protos::SamplingPeriodChangedEvent sampling_period_changed_event) override;
+  void OnPmuCountersSample(orbit_grpc_protos::PmuCountersSample pmu_counters_sample) override;
+  void OnWarningEvent(orbit_grpc_protos::WarningEvent warning_event) override;
+  void OnServiceHealthEvent(
+      orbit_grpc_protos::ServiceHealthEvent service_health_event) override;
+  void OnPipelineLatencyProbe(
+      orbit_grpc_protos::PipelineLatencyProbe pipeline_latency_probe) override;
+  void OnCaptureStatisticsSummary(
+      orbit_grpc_protos::CaptureStatisticsSummary capture_statistics_summary) override;
+
+  void OnSchedulingSlices(
+      std::vector<orbit_grpc_protos::SchedulingSlice> scheduling_slices) override;
+  void OnCallstackSamples(
+      std::vector<orbit_grpc_protos::FullCallstackSample> callstack_samples) override;
+  void OnFunctionCalls(std::vector<orbit_grpc_protos::FunctionCall> function_calls) override;
+  void OnThreadStateSlices(
+      std::vector<orbit_grpc_protos::ThreadStateSlice> thread_state_slices) override;
 
  private:
   ProducerEventProcessor* producer_event_processor_;
@@ -62,7 +81,7 @@ class LinuxTracingHandler : public orbit_linux_tracing::TracerListener {
   // Manual instrumentation tracing listener.
   std::unique_ptr<orbit_introspection::TracingListener> orbit_tracing_listener_;
 
-  void SetupIntrospection();
+  void SetupIntrospection(uint32_t sampling_period);
 };
 
 }  // namespace orbit_service
@@ -0,0 +1,76 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "LockFreeCaptureEventBuffer.h"
+
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+LockFreeCaptureEventBuffer::LockFreeCaptureEventBuffer(CaptureEventSender* event_sender)
+    : capture_event_sender_{event_sender} {
+  CHECK(capture_event_sender_ != nullptr);
+  sender_thread_ = std::thread{[this] { SenderThread(); }};
+}
+
+LockFreeCaptureEventBuffer::~LockFreeCaptureEventBuffer() { CHECK(!sender_thread_.joinable()); }
+
+void LockFreeCaptureEventBuffer::AddEvent(ClientCaptureEvent&& event) {
+  if (stop_requested_) {
+    return;
+  }
+  event_queue_.enqueue(std::move(event));
+}
+
+void LockFreeCaptureEventBuffer::AddEvents(std::vector<ClientCaptureEvent>&& events) {
+  if (stop_requested_) {
+    return;
+  }
+  event_queue_.enqueue_bulk(std::make_move_iterator(events.begin()), events.size());
+}
+
+void LockFreeCaptureEventBuffer::StopAndWait() {
+  CHECK(sender_thread_.joinable());
+  stop_requested_ = true;
+  sender_thread_.join();
+}
+
+void LockFreeCaptureEventBuffer::SenderThread() {
+  orbit_base::SetCurrentThreadName("SenderThread");
+  constexpr std::chrono::milliseconds kSendTimeInterval{20};
+  // This should be lower than kMaxEventsPerResponse in GrpcCaptureEventSender::SendEvents.
+  constexpr size_t kMaxEventCountPerSend = 5000;
+
+  bool stopped = false;
+  while (!stopped) {
+    ORBIT_SCOPE("SenderThread iteration");
+    // Once the stop has been requested, this last iteration sends all the remaining events.
+    stopped = stop_requested_;
+
+    size_t dequeued_event_count = 0;
+    do {
+      if (event_queue_.size_approx() == 0) {
+        break;
+      }
+      std::vector<ClientCaptureEvent> events(kMaxEventCountPerSend);
+      dequeued_event_count = event_queue_.try_dequeue_bulk(events.begin(), kMaxEventCountPerSend);
+      events.resize(dequeued_event_count);
+      capture_event_sender_->SendEvents(std::move(events));
+    } while (dequeued_event_count == kMaxEventCountPerSend);
+
+    if (!stopped) {
+      std::this_thread::sleep_for(kSendTimeInterval);
+    }
+  }
+}
+
+}  // namespace orbit_service
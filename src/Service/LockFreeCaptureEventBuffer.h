@@ -0,0 +1,49 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_LOCK_FREE_CAPTURE_EVENT_BUFFER_H_
+#define ORBIT_SERVICE_LOCK_FREE_CAPTURE_EVENT_BUFFER_H_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "CaptureEventSender.h"
+#include "capture.pb.h"
+#include "concurrentqueue.h"
+
+namespace orbit_service {
+
+// This CaptureEventBuffer stores the events in a lock-free queue, which internally keeps a separate
+// sub-queue for each producing thread, so that the threads adding events never contend on a mutex,
+// neither with each other nor with the thread that sends the events. The sending thread
+// periodically takes the events from the queue in batches and passes them to the
+// CaptureEventSender.
+// The events added by the same thread are sent in the order they were added, but there is no
+// ordering among events added by different threads.
+class LockFreeCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  explicit LockFreeCaptureEventBuffer(CaptureEventSender* event_sender);
+  ~LockFreeCaptureEventBuffer() override;
+
+  void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
+  void AddEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) override;
+
+  // Sends the remaining events and stops the sending thread. Events added from now on are dropped,
+  // as are events added concurrently with this call.
+  void StopAndWait();
+
+ private:
+  void SenderThread();
+
+  moodycamel::ConcurrentQueue<orbit_grpc_protos::ClientCaptureEvent> event_queue_;
+  CaptureEventSender* capture_event_sender_;
+  std::thread sender_thread_;
+  std::atomic<bool> stop_requested_ = false;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_LOCK_FREE_CAPTURE_EVENT_BUFFER_H_
@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "LockFreeCaptureEventBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+class FakeCaptureEventSender final : public CaptureEventSender {
+ public:
+  void SendEvents(std::vector<ClientCaptureEvent>&& events) override {
+    absl::MutexLock lock{&mutex_};
+    for (ClientCaptureEvent& event : events) {
+      sent_events_.emplace_back(std::move(event));
+    }
+  }
+
+  [[nodiscard]] std::vector<ClientCaptureEvent> GetSentEvents() {
+    absl::MutexLock lock{&mutex_};
+    return sent_events_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<ClientCaptureEvent> sent_events_;
+};
+
+// The tid identifies the producing thread and the timestamp the order in which it added the event.
+ClientCaptureEvent CreateEvent(int32_t tid, uint64_t timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_tid(tid);
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(timestamp_ns);
+  return event;
+}
+
+}  // namespace
+
+TEST(LockFreeCaptureEventBuffer, SendsAllEventsOfEachThreadInOrder) {
+  FakeCaptureEventSender sender;
+  LockFreeCaptureEventBuffer buffer{&sender};
+
+  constexpr int32_t kThreadCount = 4;
+  constexpr uint64_t kEventCountPerThread = 20'000;
+  std::vector<std::thread> threads;
+  for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+    threads.emplace_back([&buffer, tid] {
+      for (uint64_t timestamp_ns = 0; timestamp_ns < kEventCountPerThread;) {
+        if (timestamp_ns % 2 == 0) {
+          buffer.AddEvent(CreateEvent(tid, timestamp_ns++));
+        } else {
+          std::vector<ClientCaptureEvent> events;
+          for (int i = 0; i < 3 && timestamp_ns < kEventCountPerThread; ++i) {
+            events.emplace_back(CreateEvent(tid, timestamp_ns++));
+          }
+          buffer.AddEvents(std::move(events));
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  buffer.StopAndWait();
+
+  std::vector<ClientCaptureEvent> sent_events = sender.GetSentEvents();
+  ASSERT_EQ(sent_events.size(), kThreadCount * kEventCountPerThread);
+  std::vector<uint64_t> next_timestamp_ns_per_thread(kThreadCount, 0);
+  for (const ClientCaptureEvent& event : sent_events) {
+    const int32_t tid = event.scheduling_slice().tid();
+    ASSERT_GE(tid, 0);
+    ASSERT_LT(tid, kThreadCount);
+    EXPECT_EQ(event.scheduling_slice().out_timestamp_ns(), next_timestamp_ns_per_thread[tid]++);
+  }
+}
+
+TEST(LockFreeCaptureEventBuffer, DropsEventsAfterStop) {
+  FakeCaptureEventSender sender;
+  LockFreeCaptureEventBuffer buffer{&sender};
+  buffer.AddEvent(CreateEvent(1, 1));
+  buffer.StopAndWait();
+
+  buffer.AddEvent(CreateEvent(1, 2));
+  std::vector<ClientCaptureEvent> events;
+  events.emplace_back(CreateEvent(1, 3));
+  buffer.AddEvents(std::move(events));
+
+  std::vector<ClientCaptureEvent> sent_events = sender.GetSentEvents();
+  ASSERT_EQ(sent_events.size(), 1);
+  EXPECT_EQ(sent_events[0].scheduling_slice().out_timestamp_ns(), 1);
+}
+
+}  // namespace orbit_service
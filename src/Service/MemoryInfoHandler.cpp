@@ -29,8 +29,14 @@ void MemoryInfoHandler::Start(orbit_grpc_protos::CaptureOptions capture_options)
   cgroup_memory_info_producer_->Start();
 
   CHECK(process_memory_info_producer_ == nullptr);
-  process_memory_info_producer_ = orbit_memory_tracing::CreateProcessMemoryInfoProducer(
-      this, capture_options.memory_sampling_period_ns(), capture_options.pid());
+  if (capture_options.sample_process_memory_with_perf_events()) {
+    process_memory_info_producer_ =
+        orbit_memory_tracing::CreateProcessMemoryInfoProducerUsingPerfEvents(
+            this, capture_options.memory_sampling_period_ns(), capture_options.pid());
+  } else {
+    process_memory_info_producer_ = orbit_memory_tracing::CreateProcessMemoryInfoProducer(
+        this, capture_options.memory_sampling_period_ns(), capture_options.pid());
+  }
   process_memory_info_producer_->Start();
 }
 
@@ -9,10 +9,12 @@
 #include <grpcpp/security/server_credentials.h>
 #include <grpcpp/server_impl.h>
 
+#include <memory>
 #include <string>
 #include <utility>
 
 #include "CaptureServiceImpl.h"
+#include "ContinuousProfiler.h"
 #include "CrashServiceImpl.h"
 #include "FramePointerValidatorServiceImpl.h"
 #include "ProcessServiceImpl.h"
@@ -41,8 +43,12 @@ class OrbitGrpcServerImpl final : public OrbitGrpcServer {
   void AddCaptureStartStopListener(CaptureStartStopListener* listener) override;
   void RemoveCaptureStartStopListener(CaptureStartStopListener* listener) override;
 
+  void StartContinuousProfiling(ContinuousProfilingOptions options) override;
+  void StopContinuousProfiling() override;
+
  private:
   CaptureServiceImpl capture_service_;
+  std::unique_ptr<ContinuousProfiler> continuous_profiler_;
   ProcessServiceImpl process_service_;
   TracepointServiceImpl tracepoint_service_;
   FramePointerValidatorServiceImpl frame_pointer_validator_service_;
@@ -82,6 +88,15 @@ void OrbitGrpcServerImpl::RemoveCaptureStartStopListener(CaptureStartStopListene
   capture_service_.RemoveCaptureStartStopListener(listener);
 }
 
+void OrbitGrpcServerImpl::StartContinuousProfiling(ContinuousProfilingOptions options) {
+  CHECK(continuous_profiler_ == nullptr);
+  continuous_profiler_ =
+      std::make_unique<ContinuousProfiler>(&capture_service_, std::move(options));
+  continuous_profiler_->Start();
+}
+
+void OrbitGrpcServerImpl::StopContinuousProfiling() { continuous_profiler_.reset(); }
+
 }  // namespace
 
 std::unique_ptr<OrbitGrpcServer> OrbitGrpcServer::Create(std::string_view server_address) {
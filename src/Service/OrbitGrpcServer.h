@@ -10,6 +10,7 @@
 #include <string_view>
 
 #include "CaptureStartStopListener.h"
+#include "ContinuousProfiler.h"
 
 namespace orbit_service {
 
@@ -31,6 +32,10 @@ class OrbitGrpcServer {
   virtual void AddCaptureStartStopListener(CaptureStartStopListener* listener) = 0;
   virtual void RemoveCaptureStartStopListener(CaptureStartStopListener* listener) = 0;
 
+  // Profiles a process without a client until StopContinuousProfiling (see ContinuousProfiler).
+  virtual void StartContinuousProfiling(ContinuousProfilingOptions options) = 0;
+  virtual void StopContinuousProfiling() = 0;
+
   // Creates a server listening specified address and registers all
   // necessary services.
   [[nodiscard]] static std::unique_ptr<OrbitGrpcServer> Create(std::string_view server_address);
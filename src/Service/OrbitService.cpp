@@ -161,6 +161,10 @@ void OrbitService::Run(std::atomic<bool>* exit_requested) {
   }
   grpc_server->AddCaptureStartStopListener(producer_side_server.get());
 
+  if (continuous_profiling_options_.has_value()) {
+    grpc_server->StartContinuousProfiling(continuous_profiling_options_.value());
+  }
+
   // Make stdin non-blocking.
   fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
 
@@ -168,7 +172,7 @@ void OrbitService::Run(std::atomic<bool>* exit_requested) {
   while (!(*exit_requested)) {
     std::string stdin_data = ReadStdIn();
     // If ssh sends EOF, end main loop.
-    if (feof(stdin) != 0) break;
+    if (feof(stdin) != 0 && !continuous_profiling_options_.has_value()) break;
 
     if (IsSshWatchdogActive() || absl::StrContains(stdin_data, kStartWatchdogPassphrase)) {
       if (!stdin_data.empty()) {
@@ -183,6 +187,8 @@ void OrbitService::Run(std::atomic<bool>* exit_requested) {
     std::this_thread::sleep_for(std::chrono::seconds{1});
   }
 
+  // The continuous profiling can be in a capture, which needs the producer-side server.
+  grpc_server->StopContinuousProfiling();
   producer_side_server->ShutdownAndWait();
   grpc_server->RemoveCaptureStartStopListener(producer_side_server.get());
 
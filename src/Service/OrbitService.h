@@ -14,13 +14,17 @@
 #include <string_view>
 #include <utility>
 
+#include "ContinuousProfiler.h"
 #include "capture.pb.h"
 
 namespace orbit_service {
 
 class OrbitService {
  public:
-  explicit OrbitService(uint16_t grpc_port) : grpc_port_{grpc_port} {}
+  explicit OrbitService(uint16_t grpc_port,
+                        std::optional<ContinuousProfilingOptions> continuous_profiling_options)
+      : grpc_port_{grpc_port},
+        continuous_profiling_options_{std::move(continuous_profiling_options)} {}
 
   void Run(std::atomic<bool>* exit_requested);
 
@@ -28,6 +32,8 @@ class OrbitService {
   [[nodiscard]] bool IsSshWatchdogActive() { return last_stdin_message_ != std::nullopt; }
 
   uint16_t grpc_port_;
+  // Without a client, the service keeps running when stdin is closed, e.g., as a daemon.
+  std::optional<ContinuousProfilingOptions> continuous_profiling_options_;
 
   std::optional<std::chrono::time_point<std::chrono::steady_clock>> last_stdin_message_ =
       std::nullopt;
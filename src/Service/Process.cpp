@@ -46,6 +46,11 @@ void Process::UpdateCpuUsage(utils::Jiffies process_cpu_time, utils::TotalCpuTim
 }
 
 ErrorMessageOr<Process> Process::FromPid(pid_t pid) {
+  return FromPid(pid, utils::GetCumulativeTotalCpuTime());
+}
+
+ErrorMessageOr<Process> Process::FromPid(pid_t pid,
+                                         const std::optional<utils::TotalCpuTime>& total_cpu_time) {
   const auto path = std::filesystem::path{"/proc"} / std::to_string(pid);
 
   if (!std::filesystem::is_directory(path)) {
@@ -70,10 +75,13 @@ ErrorMessageOr<Process> Process::FromPid(pid_t pid) {
   process.set_pid(pid);
   process.set_name(name);
 
-  const auto total_cpu_time = utils::GetCumulativeTotalCpuTime();
-  const auto cpu_time = utils::GetCumulativeCpuTimeFromProcess(process.pid());
-  if (cpu_time && total_cpu_time) {
-    process.UpdateCpuUsage(cpu_time.value(), total_cpu_time.value());
+  const auto cpu_time_and_start_time =
+      utils::GetCumulativeCpuTimeAndStartTimeFromProcess(process.pid());
+  if (cpu_time_and_start_time.has_value()) {
+    process.start_time_ = cpu_time_and_start_time->start_time;
+  }
+  if (cpu_time_and_start_time && total_cpu_time) {
+    process.UpdateCpuUsage(cpu_time_and_start_time->cpu_time, total_cpu_time.value());
   } else {
     LOG("Could not update the CPU usage of process %d", process.pid());
   }
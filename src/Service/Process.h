@@ -7,6 +7,9 @@
 
 #include <sys/types.h>
 
+#include <cstdint>
+#include <optional>
+
 #include "OrbitBase/Result.h"
 #include "ServiceUtils.h"
 #include "process.pb.h"
@@ -22,8 +25,15 @@ class Process : public orbit_grpc_protos::ProcessInfo {
   // Creates a `Process` by reading details from the `/proc` filesystem.
   // This might fail due to a non existing pid or due to permission problems.
   static ErrorMessageOr<Process> FromPid(pid_t pid);
+  // Same as above, but with the total CPU time already read, as it is the same for all processes.
+  static ErrorMessageOr<Process> FromPid(pid_t pid,
+                                         const std::optional<utils::TotalCpuTime>& total_cpu_time);
+
+  // See utils::ProcessCpuTimeAndStartTime::start_time. 0 if it couldn't be read.
+  [[nodiscard]] uint64_t GetStartTime() const { return start_time_; }
 
  private:
+  uint64_t start_time_ = 0;
   utils::Jiffies previous_process_cpu_time_ = {};
   utils::Jiffies previous_total_cpu_time_ = {};
 };
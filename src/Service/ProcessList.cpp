@@ -6,6 +6,8 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/strings/numbers.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <stdint.h>
 
 #include <filesystem>
@@ -17,8 +19,15 @@
 
 namespace orbit_service {
 
+ProcessList::ProcessList() : id_{static_cast<uint64_t>(absl::ToUnixNanos(absl::Now()))} {}
+
 ErrorMessageOr<void> ProcessList::Refresh() {
   absl::flat_hash_map<pid_t, Process> updated_processes{};
+  absl::flat_hash_map<pid_t, uint64_t> updated_pid_to_last_changed_generation{};
+  const uint64_t generation = generation_ + 1;
+
+  // This is the same for all processes, so it's only read once.
+  const std::optional<utils::TotalCpuTime> total_cpu_time = utils::GetCumulativeTotalCpuTime();
 
   // TODO(b/161423785): This for loop should be refactored. For example, when
   //  parts are in a separate function, OUTCOME_TRY could be used to simplify
@@ -52,23 +61,33 @@ ErrorMessageOr<void> ProcessList::Refresh() {
     const auto iter = processes_.find(pid);
 
     if (iter != processes_.end()) {
-      auto process = processes_.extract(iter);
-
-      const auto total_cpu_time = utils::GetCumulativeTotalCpuTime();
-      const auto cpu_time = utils::GetCumulativeCpuTimeFromProcess(process.key());
-      if (cpu_time && total_cpu_time) {
-        process.mapped().UpdateCpuUsage(cpu_time.value(), total_cpu_time.value());
-      } else {
-        // We don't fail in this case. This could be a permission problem which might occur when not
-        // running as root.
-        ERROR("Could not update the CPU usage of process %d", process.key());
+      const auto cpu_time_and_start_time = utils::GetCumulativeCpuTimeAndStartTimeFromProcess(pid);
+      // A different start time means that the pid was reused by a new process, which is read
+      // from scratch below.
+      if (cpu_time_and_start_time.has_value() &&
+          cpu_time_and_start_time->start_time == iter->second.GetStartTime()) {
+        auto process = processes_.extract(iter);
+
+        const double previous_cpu_usage = process.mapped().cpu_usage();
+        if (total_cpu_time.has_value()) {
+          process.mapped().UpdateCpuUsage(cpu_time_and_start_time->cpu_time,
+                                          total_cpu_time.value());
+        } else {
+          // We don't fail in this case. This could be a permission problem which might occur when
+          // not running as root.
+          ERROR("Could not update the CPU usage of process %d", process.key());
+        }
+
+        updated_pid_to_last_changed_generation.emplace(
+            pid, process.mapped().cpu_usage() != previous_cpu_usage
+                     ? generation
+                     : pid_to_last_changed_generation_[pid]);
+        updated_processes.insert(std::move(process));
+        continue;
       }
-
-      updated_processes.insert(std::move(process));
-      continue;
     }
 
-    auto process_or_error = Process::FromPid(pid);
+    auto process_or_error = Process::FromPid(pid, total_cpu_time);
 
     if (process_or_error.has_error()) {
       // We don't fail in this case. This could be a permission problem which is restricted to a
@@ -79,9 +98,26 @@ ErrorMessageOr<void> ProcessList::Refresh() {
     }
 
     updated_processes.emplace(pid, std::move(process_or_error.value()));
+    updated_pid_to_last_changed_generation.emplace(pid, generation);
   }
 
+  // What is left in processes_ has exited, unless its pid was reused.
+  for (const auto& [pid, unused_process] : processes_) {
+    if (!updated_processes.contains(pid)) {
+      generation_and_removed_pid_.emplace_back(generation, pid);
+    }
+  }
+  generation_and_removed_pid_.erase(
+      generation_and_removed_pid_.begin(),
+      std::find_if(generation_and_removed_pid_.begin(), generation_and_removed_pid_.end(),
+                   [generation](const std::pair<uint64_t, pid_t>& generation_and_removed_pid) {
+                     return generation - generation_and_removed_pid.first <
+                            kMaxGenerationsOfChanges;
+                   }));
+
   processes_ = std::move(updated_processes);
+  pid_to_last_changed_generation_ = std::move(updated_pid_to_last_changed_generation);
+  generation_ = generation;
 
   if (processes_.empty()) {
     return ErrorMessage{
@@ -91,4 +127,30 @@ ErrorMessageOr<void> ProcessList::Refresh() {
   return outcome::success();
 }
 
+bool ProcessList::HasChangesSince(uint64_t id, uint64_t generation) const {
+  return id == id_ && generation > 0 && generation <= generation_ &&
+         generation_ - generation <= kMaxGenerationsOfChanges;
+}
+
+std::vector<orbit_grpc_protos::ProcessInfo> ProcessList::GetProcessesChangedSince(
+    uint64_t generation) const {
+  std::vector<orbit_grpc_protos::ProcessInfo> processes;
+  for (const auto& [pid, process] : processes_) {
+    const auto last_changed_generation_it = pid_to_last_changed_generation_.find(pid);
+    CHECK(last_changed_generation_it != pid_to_last_changed_generation_.end());
+    if (last_changed_generation_it->second > generation) {
+      processes.push_back(static_cast<orbit_grpc_protos::ProcessInfo>(process));
+    }
+  }
+  return processes;
+}
+
+std::vector<pid_t> ProcessList::GetPidsRemovedSince(uint64_t generation) const {
+  std::vector<pid_t> pids;
+  for (const auto& [removed_generation, pid] : generation_and_removed_pid_) {
+    if (removed_generation > generation) pids.push_back(pid);
+  }
+  return pids;
+}
+
 }  // namespace orbit_service
@@ -8,6 +8,7 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <optional>
 #include <outcome.hpp>
@@ -21,8 +22,19 @@
 
 namespace orbit_service {
 
+// Keeps the list of processes running on the system up to date with Refresh. Processes that are
+// still running since the previous Refresh are identified by pid and start time, and only their
+// CPU usage is updated; everything else (command line, path, build id, ...) is only read once.
+//
+// Every Refresh increments the generation of the list, and the changes since a previous generation
+// can be retrieved, so that clients polling the list don't have to receive it whole every time.
 class ProcessList {
  public:
+  // Changes are kept for this many generations. Older generations require the whole list.
+  static constexpr uint64_t kMaxGenerationsOfChanges = 64;
+
+  ProcessList();
+
   [[nodiscard]] ErrorMessageOr<void> Refresh();
   [[nodiscard]] std::vector<orbit_grpc_protos::ProcessInfo> GetProcesses() const {
     std::vector<orbit_grpc_protos::ProcessInfo> processes;
@@ -43,8 +55,25 @@ class ProcessList {
     return &it->second;
   }
 
+  // Identifies this list across restarts of the service, which start again from generation 0.
+  [[nodiscard]] uint64_t GetId() const { return id_; }
+  [[nodiscard]] uint64_t GetGeneration() const { return generation_; }
+
+  // Whether GetProcessesChangedSince and GetPidsRemovedSince can be called for `generation` of the
+  // list with `id`.
+  [[nodiscard]] bool HasChangesSince(uint64_t id, uint64_t generation) const;
+  // The processes that were added or whose information changed after `generation`.
+  [[nodiscard]] std::vector<orbit_grpc_protos::ProcessInfo> GetProcessesChangedSince(
+      uint64_t generation) const;
+  [[nodiscard]] std::vector<pid_t> GetPidsRemovedSince(uint64_t generation) const;
+
  private:
+  uint64_t id_;
+  uint64_t generation_ = 0;
   absl::flat_hash_map<pid_t, Process> processes_;
+  absl::flat_hash_map<pid_t, uint64_t> pid_to_last_changed_generation_;
+  // Ordered by generation.
+  std::vector<std::pair<uint64_t, pid_t>> generation_and_removed_pid_;
 };
 
 }  // namespace orbit_service
@@ -3,17 +3,22 @@
 // found in the LICENSE file.
 //
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <memory>
 #include <optional>
 #include <outcome.hpp>
+#include <vector>
 
 #include "OrbitBase/Result.h"
 #include "ProcessList.h"
 #include "ServiceUtils.h"
 #include "gtest/gtest.h"
+#include "process.pb.h"
 
 namespace orbit_service {
 
@@ -41,4 +46,62 @@ TEST(ProcessList, ProcessList) {
   EXPECT_TRUE(process2.has_value());
 }
 
+TEST(ProcessList, ChangesSinceGeneration) {
+  ProcessList process_list;
+  EXPECT_EQ(process_list.GetGeneration(), 0u);
+  EXPECT_FALSE(process_list.HasChangesSince(process_list.GetId(), 0));
+
+  ASSERT_TRUE(process_list.Refresh().has_value());
+  const uint64_t first_generation = process_list.GetGeneration();
+  EXPECT_EQ(first_generation, 1u);
+  EXPECT_TRUE(process_list.HasChangesSince(process_list.GetId(), first_generation));
+  EXPECT_FALSE(process_list.HasChangesSince(process_list.GetId() + 1, first_generation));
+  EXPECT_FALSE(process_list.HasChangesSince(process_list.GetId(), first_generation + 1));
+  // Everything was added in the first generation.
+  EXPECT_EQ(process_list.GetProcessesChangedSince(0).size(), process_list.GetProcesses().size());
+
+  const pid_t child_pid = fork();
+  ASSERT_NE(child_pid, -1);
+  if (child_pid == 0) {
+    pause();
+    _exit(0);
+  }
+
+  ASSERT_TRUE(process_list.Refresh().has_value());
+  const uint64_t second_generation = process_list.GetGeneration();
+  ASSERT_TRUE(process_list.GetProcessByPid(child_pid).has_value());
+  std::vector<pid_t> changed_pids;
+  for (const orbit_grpc_protos::ProcessInfo& process :
+       process_list.GetProcessesChangedSince(first_generation)) {
+    changed_pids.push_back(process.pid());
+  }
+  EXPECT_THAT(changed_pids, testing::Contains(child_pid));
+  EXPECT_THAT(process_list.GetPidsRemovedSince(first_generation),
+              testing::Not(testing::Contains(child_pid)));
+
+  kill(child_pid, SIGKILL);
+  waitpid(child_pid, nullptr, 0);
+
+  ASSERT_TRUE(process_list.Refresh().has_value());
+  EXPECT_FALSE(process_list.GetProcessByPid(child_pid).has_value());
+  EXPECT_THAT(process_list.GetPidsRemovedSince(second_generation), testing::Contains(child_pid));
+  EXPECT_THAT(process_list.GetPidsRemovedSince(first_generation), testing::Contains(child_pid));
+  EXPECT_THAT(process_list.GetPidsRemovedSince(process_list.GetGeneration()), testing::IsEmpty());
+  EXPECT_TRUE(process_list.GetProcessesChangedSince(process_list.GetGeneration()).empty());
+}
+
+TEST(ProcessList, ChangesAreOnlyKeptForALimitedNumberOfGenerations) {
+  ProcessList process_list;
+  ASSERT_TRUE(process_list.Refresh().has_value());
+  const uint64_t first_generation = process_list.GetGeneration();
+
+  for (uint64_t i = 0; i < ProcessList::kMaxGenerationsOfChanges; ++i) {
+    ASSERT_TRUE(process_list.Refresh().has_value());
+  }
+  EXPECT_TRUE(process_list.HasChangesSince(process_list.GetId(), first_generation));
+
+  ASSERT_TRUE(process_list.Refresh().has_value());
+  EXPECT_FALSE(process_list.HasChangesSince(process_list.GetId(), first_generation));
+}
+
 }  // namespace orbit_service
@@ -6,6 +6,7 @@
 
 #include <absl/strings/str_format.h>
 #include <stdint.h>
+#include <zlib.h>
 
 #include <algorithm>
 #include <filesystem>
@@ -15,7 +16,9 @@
 #include <vector>
 
 #include "ObjectUtils/LinuxMap.h"
+#include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
 #include "ServiceUtils.h"
 #include "module.pb.h"
@@ -24,9 +27,12 @@
 namespace orbit_service {
 
 using grpc::ServerContext;
+using grpc::ServerWriter;
 using grpc::Status;
 using grpc::StatusCode;
 
+using orbit_grpc_protos::GetDebugInfoFileContentsRequest;
+using orbit_grpc_protos::GetDebugInfoFileContentsResponse;
 using orbit_grpc_protos::GetDebugInfoFileRequest;
 using orbit_grpc_protos::GetDebugInfoFileResponse;
 using orbit_grpc_protos::GetModuleListRequest;
@@ -37,23 +43,37 @@ using orbit_grpc_protos::GetProcessMemoryRequest;
 using orbit_grpc_protos::GetProcessMemoryResponse;
 using orbit_grpc_protos::ProcessInfo;
 
-Status ProcessServiceImpl::GetProcessList(ServerContext*, const GetProcessListRequest*,
+Status ProcessServiceImpl::GetProcessList(ServerContext*, const GetProcessListRequest* request,
                                           GetProcessListResponse* response) {
-  {
-    absl::MutexLock lock(&mutex_);
+  absl::MutexLock lock(&mutex_);
 
-    const auto refresh_result = process_list_.Refresh();
-    if (refresh_result.has_error()) {
-      return Status(StatusCode::INTERNAL, refresh_result.error().message());
+  const auto refresh_result = process_list_.Refresh();
+  if (refresh_result.has_error()) {
+    return Status(StatusCode::INTERNAL, refresh_result.error().message());
+  }
+
+  response->set_process_list_id(process_list_.GetId());
+  response->set_process_list_generation(process_list_.GetGeneration());
+
+  if (process_list_.HasChangesSince(request->known_process_list_id(),
+                                    request->known_process_list_generation())) {
+    response->set_contains_only_changes(true);
+    for (const auto& process_info :
+         process_list_.GetProcessesChangedSince(request->known_process_list_generation())) {
+      *(response->add_processes()) = process_info;
     }
+    for (pid_t pid : process_list_.GetPidsRemovedSince(request->known_process_list_generation())) {
+      response->add_removed_pids(pid);
+    }
+    return Status::OK;
   }
 
-  const std::vector<ProcessInfo>& processes = process_list_.GetProcesses();
+  const std::vector<ProcessInfo> processes = process_list_.GetProcesses();
   if (processes.empty()) {
     return Status(StatusCode::NOT_FOUND, "Error while getting processes.");
   }
 
-  for (const auto& process_info : process_list_.GetProcesses()) {
+  for (const auto& process_info : processes) {
     *(response->add_processes()) = process_info;
   }
 
@@ -66,7 +86,24 @@ Status ProcessServiceImpl::GetModuleList(ServerContext* /*context*/,
   int32_t pid = request->process_id();
   LOG("Sending modules for process %d", pid);
 
-  const auto module_infos = orbit_object_utils::ReadModules(pid);
+  const auto proc_maps_data =
+      orbit_base::ReadFileToString(std::filesystem::path{absl::StrFormat("/proc/%d/maps", pid)});
+  if (proc_maps_data.has_error()) {
+    return Status(StatusCode::NOT_FOUND, proc_maps_data.error().message());
+  }
+
+  // Creating the modules opens each of their files, which is slow for processes with hundreds of
+  // modules. When the client already has the current modules, we don't need to.
+  const uint64_t modules_fingerprint =
+      orbit_object_utils::ComputeModulesFingerprint(proc_maps_data.value());
+  response->set_modules_fingerprint(modules_fingerprint);
+  if (request->known_modules_fingerprint() != 0 &&
+      request->known_modules_fingerprint() == modules_fingerprint) {
+    response->set_modules_unchanged(true);
+    return Status::OK;
+  }
+
+  const auto module_infos = orbit_object_utils::ParseMaps(proc_maps_data.value());
   if (module_infos.has_error()) {
     return Status(StatusCode::NOT_FOUND, module_infos.error().message());
   }
@@ -108,4 +145,74 @@ Status ProcessServiceImpl::GetDebugInfoFile(ServerContext*, const GetDebugInfoFi
   return Status::OK;
 }
 
+Status ProcessServiceImpl::GetDebugInfoFileContents(
+    ServerContext* context, const GetDebugInfoFileContentsRequest* request,
+    ServerWriter<GetDebugInfoFileContentsResponse>* writer) {
+  const auto symbols_path = utils::FindSymbolsFilePath(request->module_path());
+  if (symbols_path.has_error()) {
+    return Status(StatusCode::NOT_FOUND, symbols_path.error().message());
+  }
+
+  std::error_code error;
+  const uint64_t file_size = std::filesystem::file_size(symbols_path.value(), error);
+  if (error) {
+    return Status(StatusCode::INTERNAL,
+                  absl::StrFormat("Unable to get the size of \"%s\": %s",
+                                  symbols_path.value().string(), error.message()));
+  }
+  if (request->offset() > file_size) {
+    return Status(StatusCode::OUT_OF_RANGE,
+                  absl::StrFormat("Offset %u is past the end of \"%s\", of size %u",
+                                  request->offset(), symbols_path.value().string(), file_size));
+  }
+
+  auto fd_or_error = orbit_base::OpenFileForReading(symbols_path.value());
+  if (fd_or_error.has_error()) {
+    return Status(StatusCode::INTERNAL, fd_or_error.error().message());
+  }
+
+  std::string chunk(kDebugInfoFileChunkSize, '\0');
+  std::string compressed_chunk(compressBound(kDebugInfoFileChunkSize), '\0');
+  GetDebugInfoFileContentsResponse response;
+  response.set_file_size(file_size);
+  for (uint64_t offset = request->offset(); offset < file_size;) {
+    if (context->IsCancelled()) {
+      return Status(StatusCode::CANCELLED, "The transfer of the debug info file was cancelled");
+    }
+
+    auto size_or_error = orbit_base::ReadFullyAtOffset(fd_or_error.value(), chunk.data(),
+                                                       chunk.size(), static_cast<off_t>(offset));
+    if (size_or_error.has_error()) {
+      return Status(StatusCode::INTERNAL, size_or_error.error().message());
+    }
+    const size_t size = size_or_error.value();
+    if (size == 0) {
+      return Status(StatusCode::INTERNAL,
+                    absl::StrFormat("\"%s\" was truncated during the transfer",
+                                    symbols_path.value().string()));
+    }
+
+    response.set_offset(offset);
+    // Debug information usually compresses to a third of its size, which matters on slow links.
+    uLongf compressed_size = compressed_chunk.size();
+    if (compress2(reinterpret_cast<Bytef*>(compressed_chunk.data()), &compressed_size,
+                  reinterpret_cast<const Bytef*>(chunk.data()), size,
+                  Z_DEFAULT_COMPRESSION) == Z_OK &&
+        compressed_size < size) {
+      response.set_uncompressed_size(size);
+      response.set_data(compressed_chunk.data(), compressed_size);
+    } else {
+      response.set_uncompressed_size(0);
+      response.set_data(chunk.data(), size);
+    }
+
+    if (!writer->Write(response)) {
+      return Status(StatusCode::CANCELLED, "The client stopped receiving the debug info file");
+    }
+    offset += size;
+  }
+
+  return Status::OK;
+}
+
 }  // namespace orbit_service
\ No newline at end of file
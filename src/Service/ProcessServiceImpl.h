@@ -36,11 +36,17 @@ class ProcessServiceImpl final : public orbit_grpc_protos::ProcessService::Servi
       grpc::ServerContext* context, const orbit_grpc_protos::GetDebugInfoFileRequest* request,
       orbit_grpc_protos::GetDebugInfoFileResponse* response) override;
 
+  [[nodiscard]] grpc::Status GetDebugInfoFileContents(
+      grpc::ServerContext* context,
+      const orbit_grpc_protos::GetDebugInfoFileContentsRequest* request,
+      grpc::ServerWriter<orbit_grpc_protos::GetDebugInfoFileContentsResponse>* writer) override;
+
  private:
   absl::Mutex mutex_;
   ProcessList process_list_;
 
   static constexpr size_t kMaxGetProcessMemoryResponseSize = 8 * 1024 * 1024;
+  static constexpr size_t kDebugInfoFileChunkSize = 1024 * 1024;
 };
 
 }  // namespace orbit_service
@@ -5,8 +5,18 @@
 #include "ProducerEventProcessor.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/hash/hash.h>
+#include <absl/synchronization/mutex.h>
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
 #include "capture.pb.h"
 
 namespace orbit_service {
@@ -17,9 +27,12 @@ using orbit_grpc_protos::AddressInfo;
 using orbit_grpc_protos::ApiEvent;
 using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CaptureStartLatencyEvent;
 using orbit_grpc_protos::CaptureStarted;
+using orbit_grpc_protos::CaptureStatisticsSummary;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_grpc_protos::ClockResolutionEvent;
+using orbit_grpc_protos::CompactApiEvent;
 using orbit_grpc_protos::ErrorEnablingOrbitApiEvent;
 using orbit_grpc_protos::ErrorsWithPerfEventOpenEvent;
 using orbit_grpc_protos::FullAddressInfo;
@@ -27,6 +40,7 @@ using orbit_grpc_protos::FullCallstackSample;
 using orbit_grpc_protos::FullGpuJob;
 using orbit_grpc_protos::FullTracepointEvent;
 using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::GpuClockCalibration;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuJob;
 using orbit_grpc_protos::GpuQueueSubmission;
@@ -39,14 +53,37 @@ using orbit_grpc_protos::MemoryUsageEvent;
 using orbit_grpc_protos::ModulesSnapshot;
 using orbit_grpc_protos::ModuleUpdateEvent;
 using orbit_grpc_protos::OutOfOrderEventsDiscardedEvent;
+using orbit_grpc_protos::PipelineLatencyProbe;
+using orbit_grpc_protos::PmuCountersSample;
 using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_grpc_protos::SamplingPeriodChangedEvent;
 using orbit_grpc_protos::SchedulingSlice;
+using orbit_grpc_protos::ServiceHealthEvent;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadNamesSnapshot;
 using orbit_grpc_protos::ThreadStateSlice;
 using orbit_grpc_protos::TracepointEvent;
+using orbit_grpc_protos::TscCalibration;
 using orbit_grpc_protos::WarningEvent;
 
+// Collects ClientCaptureEvents so that they can be added to the actual CaptureEventBuffer all at
+// once. Not thread safe, as it's only used locally.
+class VectorCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  void AddEvent(ClientCaptureEvent&& event) override { events_.emplace_back(std::move(event)); }
+
+  void Reserve(size_t size) { events_.reserve(size); }
+  [[nodiscard]] std::vector<ClientCaptureEvent> TakeEvents() { return std::move(events_); }
+
+ private:
+  std::vector<ClientCaptureEvent> events_;
+};
+
+// Assigns unique ids to entries, and can be used concurrently by multiple producers. To reduce
+// contention, the entries are distributed among kShardCount shards, each with its own mutex,
+// according to their hash. The hash is computed only once per call and is also reused for the
+// lookup in the shard. Looking up existing entries, by far the most frequent case, only takes the
+// mutex of the shard in shared mode.
 template <typename T>
 class InternPool final {
  public:
@@ -55,22 +92,63 @@ class InternPool final {
   // Return pair of <id, assigned>, where assigned is true if the entry was assigned a new id
   // and false if returning id for already existing entry.
   std::pair<uint64_t, bool> GetOrAssignId(const T& entry) {
-    absl::MutexLock lock(&entry_to_id_mutex_);
-    auto it = entry_to_id_.find(entry);
-    if (it != entry_to_id_.end()) {
-      return std::make_pair(it->second, false);
+    const size_t hash = absl::Hash<T>{}(entry);
+    // The hash table of the shard uses the low bits of the hash, so use the high bits here.
+    Shard& shard = shards_[hash >> (std::numeric_limits<size_t>::digits - kShardCountLog2)];
+    {
+      absl::ReaderMutexLock lock(&shard.mutex);
+      auto it = shard.entry_to_id.find(EntryView{&entry, hash});
+      if (it != shard.entry_to_id.end()) {
+        return std::make_pair(it->second, false);
+      }
     }
 
-    uint64_t new_id = id_counter_++;
-    auto [unused_it, inserted] = entry_to_id_.insert_or_assign(entry, new_id);
-    CHECK(inserted);
-    return std::make_pair(new_id, true);
+    absl::WriterMutexLock lock(&shard.mutex);
+    // Another thread might have added the same entry in the meantime.
+    auto [it, inserted] = shard.entry_to_id.try_emplace(HashedEntry{entry, hash}, 0);
+    if (!inserted) {
+      return std::make_pair(it->second, false);
+    }
+    it->second = id_counter_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_pair(it->second, true);
   }
 
  private:
-  uint64_t id_counter_ = 1;  // 0 is reserved for invalid_id
-  absl::flat_hash_map<T, uint64_t> entry_to_id_;
-  absl::Mutex entry_to_id_mutex_;
+  static constexpr size_t kShardCountLog2 = 4;
+  static constexpr size_t kShardCount = 1 << kShardCountLog2;
+
+  struct HashedEntry {
+    T entry;
+    size_t hash;
+  };
+  struct EntryView {
+    const T* entry;
+    size_t hash;
+  };
+  // Transparent, so that looking up an entry neither copies it nor computes its hash again.
+  struct HashedEntryHash {
+    using is_transparent = void;
+    size_t operator()(const HashedEntry& hashed_entry) const { return hashed_entry.hash; }
+    size_t operator()(const EntryView& entry_view) const { return entry_view.hash; }
+  };
+  struct HashedEntryEq {
+    using is_transparent = void;
+    static const T& Get(const HashedEntry& hashed_entry) { return hashed_entry.entry; }
+    static const T& Get(const EntryView& entry_view) { return *entry_view.entry; }
+    template <typename Lhs, typename Rhs>
+    bool operator()(const Lhs& lhs, const Rhs& rhs) const {
+      return Get(lhs) == Get(rhs);
+    }
+  };
+
+  struct Shard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<HashedEntry, uint64_t, HashedEntryHash, HashedEntryEq> entry_to_id
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  std::atomic<uint64_t> id_counter_{1};  // 0 is reserved for invalid_id
+  std::array<Shard, kShardCount> shards_;
 };
 
 class ProducerEventProcessorImpl : public ProducerEventProcessor {
@@ -80,45 +158,86 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
       : capture_event_buffer_{capture_event_buffer} {}
 
   void ProcessEvent(uint64_t producer_id, ProducerCaptureEvent event) override;
+  void ProcessEvents(uint64_t producer_id, std::vector<ProducerCaptureEvent> events) override;
 
  private:
-  void ProcessCaptureStartedAndTransferOwnership(CaptureStarted* capture_started);
-  void ProcessFullAddressInfo(FullAddressInfo* full_address_info);
-  void ProcessFullCallstackSample(FullCallstackSample* full_callstack_sample);
-  void ProcessFunctionCallAndTransferOwnership(FunctionCall* function_call);
-  void ProcessFullGpuJob(FullGpuJob* full_gpu_job_event);
+  // All the Process* functions add the resulting ClientCaptureEvents to output, which is either
+  // capture_event_buffer_ or, for ProcessEvents, a VectorCaptureEventBuffer that collects the
+  // ClientCaptureEvents of the whole batch.
+  void ProcessEventInto(uint64_t producer_id, ProducerCaptureEvent* event,
+                        CaptureEventBuffer* output);
+  void ProcessCaptureStartedAndTransferOwnership(CaptureStarted* capture_started,
+                                                 CaptureEventBuffer* output);
+  void ProcessFullAddressInfo(FullAddressInfo* full_address_info, CaptureEventBuffer* output);
+  void ProcessFullCallstackSample(FullCallstackSample* full_callstack_sample,
+                                  CaptureEventBuffer* output);
+  void ProcessFunctionCallAndTransferOwnership(FunctionCall* function_call,
+                                               CaptureEventBuffer* output);
+  void ProcessFullGpuJob(FullGpuJob* full_gpu_job_event, CaptureEventBuffer* output);
   void ProcessGpuQueueSubmissionAndTransferOwnership(uint64_t producer_id,
-                                                     GpuQueueSubmission* gpu_queue_submission);
+                                                     GpuQueueSubmission* gpu_queue_submission,
+                                                     CaptureEventBuffer* output);
+  void ProcessGpuClockCalibrationAndTransferOwnership(GpuClockCalibration* gpu_clock_calibration,
+                                                      CaptureEventBuffer* output);
   // ProcessInterned* functions remap producer intern_ids to the id space used in the client.
   // They keep track of these mappings in producer_interned_callstack_id_to_client_callstack_id_
   // and producer_interned_string_id_to_client_string_id_.
-  void ProcessInternedCallstack(uint64_t producer_id, InternedCallstack* interned_callstack);
+  void ProcessInternedCallstack(uint64_t producer_id, InternedCallstack* interned_callstack,
+                                CaptureEventBuffer* output);
   void ProcessCallstackSampleAndTransferOwnership(uint64_t producer_id,
-                                                  CallstackSample* callstack_sample);
-  void ProcessInternedString(uint64_t producer_id, InternedString* interned_string);
-  void ProcessIntrospectionScopeAndTransferOwnership(IntrospectionScope* introspection_scope);
-  void ProcessModuleUpdateEventAndTransferOwnership(ModuleUpdateEvent* module_update_event);
-  void ProcessModulesSnapshotAndTransferOwnership(ModulesSnapshot* modules_snapshot);
-  void ProcessSchedulingSliceAndTransferOwnership(SchedulingSlice* scheduling_slice);
-  void ProcessThreadNameAndTransferOwnership(ThreadName* thread_name);
-  void ProcessThreadNamesSnapshotAndTransferOwnership(ThreadNamesSnapshot* thread_names_snapshot);
-  void ProcessThreadStateSliceAndTransferOwnership(ThreadStateSlice* thread_state_slice);
-  void ProcessFullTracepointEvent(FullTracepointEvent* full_tracepoint_event);
-  void ProcessMemoryUsageEventAndTransferOwnership(MemoryUsageEvent* memory_usage_event);
-  void ProcessApiEventAndTransferOwnership(ApiEvent* api_event);
-  void ProcessWarningEventAndTransferOwnership(WarningEvent* warning_event);
-  void ProcessClockResolutionEventAndTransferOwnership(
-      ClockResolutionEvent* clock_resolution_event);
+                                                  CallstackSample* callstack_sample,
+                                                  CaptureEventBuffer* output);
+  void ProcessInternedString(uint64_t producer_id, InternedString* interned_string,
+                             CaptureEventBuffer* output);
+  void ProcessIntrospectionScopeAndTransferOwnership(IntrospectionScope* introspection_scope,
+                                                     CaptureEventBuffer* output);
+  void ProcessModuleUpdateEventAndTransferOwnership(ModuleUpdateEvent* module_update_event,
+                                                    CaptureEventBuffer* output);
+  void ProcessModulesSnapshotAndTransferOwnership(ModulesSnapshot* modules_snapshot,
+                                                  CaptureEventBuffer* output);
+  void ProcessSchedulingSliceAndTransferOwnership(SchedulingSlice* scheduling_slice,
+                                                  CaptureEventBuffer* output);
+  void ProcessThreadNameAndTransferOwnership(ThreadName* thread_name, CaptureEventBuffer* output);
+  void ProcessThreadNamesSnapshotAndTransferOwnership(ThreadNamesSnapshot* thread_names_snapshot,
+                                                      CaptureEventBuffer* output);
+  void ProcessThreadStateSliceAndTransferOwnership(ThreadStateSlice* thread_state_slice,
+                                                   CaptureEventBuffer* output);
+  void ProcessFullTracepointEvent(FullTracepointEvent* full_tracepoint_event,
+                                  CaptureEventBuffer* output);
+  void ProcessMemoryUsageEventAndTransferOwnership(MemoryUsageEvent* memory_usage_event,
+                                                   CaptureEventBuffer* output);
+  void ProcessApiEventAndTransferOwnership(ApiEvent* api_event, CaptureEventBuffer* output);
+  void ProcessCompactApiEventAndTransferOwnership(uint64_t producer_id,
+                                                  CompactApiEvent* compact_api_event,
+                                                  CaptureEventBuffer* output);
+  void ProcessWarningEventAndTransferOwnership(WarningEvent* warning_event,
+                                               CaptureEventBuffer* output);
+  void ProcessServiceHealthEventAndTransferOwnership(ServiceHealthEvent* service_health_event,
+                                                     CaptureEventBuffer* output);
+  void ProcessPipelineLatencyProbeAndTransferOwnership(PipelineLatencyProbe* pipeline_latency_probe,
+                                                       CaptureEventBuffer* output);
+  void ProcessCaptureStatisticsSummaryAndTransferOwnership(
+      CaptureStatisticsSummary* capture_statistics_summary, CaptureEventBuffer* output);
+  void ProcessClockResolutionEventAndTransferOwnership(ClockResolutionEvent* clock_resolution_event,
+                                                       CaptureEventBuffer* output);
+  void ProcessCaptureStartLatencyEventAndTransferOwnership(
+      CaptureStartLatencyEvent* capture_start_latency_event, CaptureEventBuffer* output);
   void ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-      ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event);
+      ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event, CaptureEventBuffer* output);
   void ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-      ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event);
+      ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event, CaptureEventBuffer* output);
   void ProcessLostPerfRecordsEventAndTransferOwnership(
-      LostPerfRecordsEvent* lost_perf_records_event);
+      LostPerfRecordsEvent* lost_perf_records_event, CaptureEventBuffer* output);
   void ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-      OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event);
+      OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event,
+      CaptureEventBuffer* output);
+  void ProcessSamplingPeriodChangedEventAndTransferOwnership(
+      SamplingPeriodChangedEvent* sampling_period_changed_event, CaptureEventBuffer* output);
+  void ProcessPmuCountersSampleAndTransferOwnership(PmuCountersSample* pmu_counters_sample,
+                                                    CaptureEventBuffer* output);
+  void ProcessTscCalibration(const TscCalibration& tsc_calibration);
 
-  void SendInternedStringEvent(uint64_t key, std::string value);
+  void SendInternedStringEvent(uint64_t key, std::string value, CaptureEventBuffer* output);
 
   CaptureEventBuffer* capture_event_buffer_;
 
@@ -134,19 +253,25 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
   // <producer_id, producer_string_id> -> client_string_id
   absl::flat_hash_map<std::pair<uint64_t, uint64_t>, uint64_t>
       producer_interned_string_id_to_client_string_id_;
+
+  // Converts the CompactApiEvent.timestamp_tsc to timestamps of the capture clock. This is set
+  // before any producer is notified of the start of the capture, so it is not modified while
+  // events are processed.
+  std::optional<orbit_base::TscCalibration> tsc_calibration_;
 };
 
-void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_address_info) {
+void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_address_info,
+                                                        CaptureEventBuffer* output) {
   auto [function_name_key, function_key_assigned] =
       string_pool_.GetOrAssignId(full_address_info->function_name());
   if (function_key_assigned) {
-    SendInternedStringEvent(function_name_key, full_address_info->function_name());
+    SendInternedStringEvent(function_name_key, full_address_info->function_name(), output);
   }
 
   auto [module_name_key, module_key_assigned] =
       string_pool_.GetOrAssignId(full_address_info->module_name());
   if (module_key_assigned) {
-    SendInternedStringEvent(module_name_key, full_address_info->module_name());
+    SendInternedStringEvent(module_name_key, full_address_info->module_name(), output);
   }
 
   ClientCaptureEvent event;
@@ -156,20 +281,21 @@ void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_ad
   interned_address_info->set_function_name_key(function_name_key);
   interned_address_info->set_module_name_key(module_name_key);
 
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessFunctionCallAndTransferOwnership(
-    FunctionCall* function_call) {
+    FunctionCall* function_call, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_function_call(function_call);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
-void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_event) {
+void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_event,
+                                                   CaptureEventBuffer* output) {
   auto [timeline_key, assigned] = string_pool_.GetOrAssignId(full_gpu_job_event->timeline());
   if (assigned) {
-    SendInternedStringEvent(timeline_key, full_gpu_job_event->timeline());
+    SendInternedStringEvent(timeline_key, full_gpu_job_event->timeline(), output);
   }
 
   ClientCaptureEvent event;
@@ -185,11 +311,11 @@ void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_even
   gpu_job_event->set_gpu_hardware_start_time_ns(full_gpu_job_event->gpu_hardware_start_time_ns());
   gpu_job_event->set_dma_fence_signaled_time_ns(full_gpu_job_event->dma_fence_signaled_time_ns());
   gpu_job_event->set_timeline_key(timeline_key);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
-    uint64_t producer_id, GpuQueueSubmission* gpu_queue_submission) {
+    uint64_t producer_id, GpuQueueSubmission* gpu_queue_submission, CaptureEventBuffer* output) {
   // Translate debug marker keys
   for (GpuDebugMarker& mutable_marker : *gpu_queue_submission->mutable_completed_markers()) {
     auto it = producer_interned_string_id_to_client_string_id_.find(
@@ -200,11 +326,18 @@ void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
 
   ClientCaptureEvent event;
   event.set_allocated_gpu_queue_submission(gpu_queue_submission);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessGpuClockCalibrationAndTransferOwnership(
+    GpuClockCalibration* gpu_clock_calibration, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_gpu_clock_calibration(gpu_clock_calibration);
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessFullCallstackSample(
-    FullCallstackSample* full_callstack_sample) {
+    FullCallstackSample* full_callstack_sample, CaptureEventBuffer* output) {
   const Callstack& callstack = full_callstack_sample->callstack();
   std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
       {callstack.pcs().begin(), callstack.pcs().end()}, callstack.type()};
@@ -215,7 +348,7 @@ void ProducerEventProcessorImpl::ProcessFullCallstackSample(
     interned_callstack_event.mutable_interned_callstack()->set_key(callstack_id);
     interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
         full_callstack_sample->release_callstack());
-    capture_event_buffer_->AddEvent(std::move(interned_callstack_event));
+    output->AddEvent(std::move(interned_callstack_event));
   }
 
   ClientCaptureEvent callstack_sample_event;
@@ -223,12 +356,16 @@ void ProducerEventProcessorImpl::ProcessFullCallstackSample(
   callstack_sample->set_pid(full_callstack_sample->pid());
   callstack_sample->set_tid(full_callstack_sample->tid());
   callstack_sample->set_timestamp_ns(full_callstack_sample->timestamp_ns());
+  callstack_sample->set_off_cpu_duration_ns(full_callstack_sample->off_cpu_duration_ns());
+  callstack_sample->set_memory_event_type(full_callstack_sample->memory_event_type());
+  callstack_sample->set_memory_event_count(full_callstack_sample->memory_event_count());
   callstack_sample->set_callstack_id(callstack_id);
-  capture_event_buffer_->AddEvent(std::move(callstack_sample_event));
+  output->AddEvent(std::move(callstack_sample_event));
 }
 
 void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
-                                                          InternedCallstack* interned_callstack) {
+                                                          InternedCallstack* interned_callstack,
+                                                          CaptureEventBuffer* output) {
   // TODO(b/180235290): replace with error message
   CHECK(!producer_interned_callstack_id_to_client_callstack_id_.contains(
       {producer_id, interned_callstack->key()}));
@@ -249,11 +386,11 @@ void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
   interned_callstack->set_key(interned_callstack_id);
   ClientCaptureEvent event;
   *event.mutable_interned_callstack() = std::move(*interned_callstack);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
-    uint64_t producer_id, CallstackSample* callstack_sample) {
+    uint64_t producer_id, CallstackSample* callstack_sample, CaptureEventBuffer* output) {
   // translate producer id to client id
   auto it = producer_interned_callstack_id_to_client_callstack_id_.find(
       {producer_id, callstack_sample->callstack_id()});
@@ -263,11 +400,12 @@ void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
 
   ClientCaptureEvent event;
   event.set_allocated_callstack_sample(callstack_sample);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
-                                                       InternedString* interned_string) {
+                                                       InternedString* interned_string,
+                                                       CaptureEventBuffer* output) {
   // TODO(b/180235290): replace with error message
   CHECK(!producer_interned_string_id_to_client_string_id_.contains(
       {producer_id, interned_string->key()}));
@@ -284,66 +422,67 @@ void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
 
   ClientCaptureEvent event;
   *event.mutable_interned_string() = std::move(*interned_string);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessIntrospectionScopeAndTransferOwnership(
-    IntrospectionScope* introspection_scope) {
+    IntrospectionScope* introspection_scope, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_introspection_scope(introspection_scope);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessModuleUpdateEventAndTransferOwnership(
-    orbit_grpc_protos::ModuleUpdateEvent* module_update_event) {
+    orbit_grpc_protos::ModuleUpdateEvent* module_update_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_module_update_event(module_update_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessModulesSnapshotAndTransferOwnership(
-    ModulesSnapshot* modules_snapshot) {
+    ModulesSnapshot* modules_snapshot, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_modules_snapshot(modules_snapshot);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessCaptureStartedAndTransferOwnership(
-    CaptureStarted* capture_started) {
+    CaptureStarted* capture_started, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_capture_started(capture_started);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessSchedulingSliceAndTransferOwnership(
-    SchedulingSlice* scheduling_slice) {
+    SchedulingSlice* scheduling_slice, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_scheduling_slice(scheduling_slice);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
-void ProducerEventProcessorImpl::ProcessThreadNameAndTransferOwnership(ThreadName* thread_name) {
+void ProducerEventProcessorImpl::ProcessThreadNameAndTransferOwnership(ThreadName* thread_name,
+                                                                       CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_thread_name(thread_name);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessThreadNamesSnapshotAndTransferOwnership(
-    ThreadNamesSnapshot* thread_names_snapshot) {
+    ThreadNamesSnapshot* thread_names_snapshot, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_thread_names_snapshot(thread_names_snapshot);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessThreadStateSliceAndTransferOwnership(
-    ThreadStateSlice* thread_state_slice) {
+    ThreadStateSlice* thread_state_slice, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_thread_state_slice(thread_state_slice);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
-    FullTracepointEvent* full_tracepoint_event) {
+    FullTracepointEvent* full_tracepoint_event, CaptureEventBuffer* output) {
   auto [tracepoint_key, assigned] =
       tracepoint_pool_.GetOrAssignId({full_tracepoint_event->tracepoint_info().category(),
                                       full_tracepoint_event->tracepoint_info().name()});
@@ -353,7 +492,7 @@ void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
     interned_tracepoint_info->set_key(tracepoint_key);
     interned_tracepoint_info->set_allocated_intern(
         full_tracepoint_event->release_tracepoint_info());
-    capture_event_buffer_->AddEvent(std::move(event));
+    output->AddEvent(std::move(event));
   }
 
   ClientCaptureEvent event;
@@ -363,156 +502,296 @@ void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
   tracepoint_event->set_timestamp_ns(full_tracepoint_event->timestamp_ns());
   tracepoint_event->set_cpu(full_tracepoint_event->cpu());
   tracepoint_event->set_tracepoint_info_key(tracepoint_key);
-  capture_event_buffer_->AddEvent(std::move(event));
+  *tracepoint_event->mutable_field_values() =
+      std::move(*full_tracepoint_event->mutable_field_values());
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessMemoryUsageEventAndTransferOwnership(
-    MemoryUsageEvent* memory_usage_event) {
+    MemoryUsageEvent* memory_usage_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_memory_usage_event(memory_usage_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
-void ProducerEventProcessorImpl::ProcessApiEventAndTransferOwnership(ApiEvent* api_event) {
+void ProducerEventProcessorImpl::ProcessApiEventAndTransferOwnership(ApiEvent* api_event,
+                                                                     CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_api_event(api_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessCompactApiEventAndTransferOwnership(
+    uint64_t producer_id, CompactApiEvent* compact_api_event, CaptureEventBuffer* output) {
+  if (compact_api_event->name_key() != 0) {
+    auto it = producer_interned_string_id_to_client_string_id_.find(
+        {producer_id, compact_api_event->name_key()});
+    CHECK(it != producer_interned_string_id_to_client_string_id_.end());
+    compact_api_event->set_name_key(it->second);
+  }
+
+  if (compact_api_event->timestamp_tsc() != 0) {
+    if (!tsc_calibration_.has_value()) {
+      ERROR("Discarding CompactApiEvent with time stamp counter value but no TscCalibration");
+      delete compact_api_event;
+      return;
+    }
+    compact_api_event->set_timestamp_ns(
+        orbit_base::TscToCaptureTimestampNs(compact_api_event->timestamp_tsc(), *tsc_calibration_));
+    compact_api_event->clear_timestamp_tsc();
+    if (compact_api_event->coalesced_count() != 0) {
+      compact_api_event->set_coalesced_min_timestamp_ns(orbit_base::TscToCaptureTimestampNs(
+          compact_api_event->coalesced_min_timestamp_ns(), *tsc_calibration_));
+      compact_api_event->set_coalesced_max_timestamp_ns(orbit_base::TscToCaptureTimestampNs(
+          compact_api_event->coalesced_max_timestamp_ns(), *tsc_calibration_));
+    }
+  }
+
+  ClientCaptureEvent event;
+  event.set_allocated_compact_api_event(compact_api_event);
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessWarningEventAndTransferOwnership(
-    WarningEvent* warning_event) {
+    WarningEvent* warning_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_warning_event(warning_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessServiceHealthEventAndTransferOwnership(
+    ServiceHealthEvent* service_health_event, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_service_health_event(service_health_event);
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessPipelineLatencyProbeAndTransferOwnership(
+    PipelineLatencyProbe* pipeline_latency_probe, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_pipeline_latency_probe(pipeline_latency_probe);
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessCaptureStatisticsSummaryAndTransferOwnership(
+    CaptureStatisticsSummary* capture_statistics_summary, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_capture_statistics_summary(capture_statistics_summary);
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-    ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event) {
+    ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_error_enabling_orbit_api_event(error_enabling_orbit_api_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessClockResolutionEventAndTransferOwnership(
-    ClockResolutionEvent* clock_resolution_event) {
+    ClockResolutionEvent* clock_resolution_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_clock_resolution_event(clock_resolution_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessCaptureStartLatencyEventAndTransferOwnership(
+    CaptureStartLatencyEvent* capture_start_latency_event, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_capture_start_latency_event(capture_start_latency_event);
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-    ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event) {
+    ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_errors_with_perf_event_open_event(errors_with_perf_event_open_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessLostPerfRecordsEventAndTransferOwnership(
-    LostPerfRecordsEvent* lost_perf_records_event) {
+    LostPerfRecordsEvent* lost_perf_records_event, CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_lost_perf_records_event(lost_perf_records_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-    OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event) {
+    OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event,
+    CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   event.set_allocated_out_of_order_events_discarded_event(out_of_order_events_discarded_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessSamplingPeriodChangedEventAndTransferOwnership(
+    SamplingPeriodChangedEvent* sampling_period_changed_event, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_sampling_period_changed_event(sampling_period_changed_event);
+  output->AddEvent(std::move(event));
+}
+
+void ProducerEventProcessorImpl::ProcessPmuCountersSampleAndTransferOwnership(
+    PmuCountersSample* pmu_counters_sample, CaptureEventBuffer* output) {
+  ClientCaptureEvent event;
+  event.set_allocated_pmu_counters_sample(pmu_counters_sample);
+  output->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCaptureEvent event) {
-  switch (event.event_case()) {
+  ProcessEventInto(producer_id, &event, capture_event_buffer_);
+}
+
+void ProducerEventProcessorImpl::ProcessEvents(uint64_t producer_id,
+                                               std::vector<ProducerCaptureEvent> events) {
+  VectorCaptureEventBuffer output;
+  output.Reserve(events.size());
+  for (ProducerCaptureEvent& event : events) {
+    ProcessEventInto(producer_id, &event, &output);
+  }
+  capture_event_buffer_->AddEvents(output.TakeEvents());
+}
+
+void ProducerEventProcessorImpl::ProcessEventInto(uint64_t producer_id, ProducerCaptureEvent* event,
+                                                  CaptureEventBuffer* output) {
+  switch (event->event_case()) {
     case ProducerCaptureEvent::kCaptureStarted:
-      ProcessCaptureStartedAndTransferOwnership(event.release_capture_started());
+      ProcessCaptureStartedAndTransferOwnership(event->release_capture_started(), output);
       break;
     case ProducerCaptureEvent::kInternedCallstack:
-      ProcessInternedCallstack(producer_id, event.mutable_interned_callstack());
+      ProcessInternedCallstack(producer_id, event->mutable_interned_callstack(), output);
       break;
     case ProducerCaptureEvent::kSchedulingSlice:
-      ProcessSchedulingSliceAndTransferOwnership(event.release_scheduling_slice());
+      ProcessSchedulingSliceAndTransferOwnership(event->release_scheduling_slice(), output);
       break;
     case ProducerCaptureEvent::kCallstackSample:
-      ProcessCallstackSampleAndTransferOwnership(producer_id, event.release_callstack_sample());
+      ProcessCallstackSampleAndTransferOwnership(producer_id, event->release_callstack_sample(),
+                                                 output);
       break;
     case ProducerCaptureEvent::kFullCallstackSample:
-      ProcessFullCallstackSample(event.mutable_full_callstack_sample());
+      ProcessFullCallstackSample(event->mutable_full_callstack_sample(), output);
       break;
     case ProducerCaptureEvent::kFullTracepointEvent:
-      ProcessFullTracepointEvent(event.mutable_full_tracepoint_event());
+      ProcessFullTracepointEvent(event->mutable_full_tracepoint_event(), output);
       break;
     case ProducerCaptureEvent::kFunctionCall:
-      ProcessFunctionCallAndTransferOwnership(event.release_function_call());
+      ProcessFunctionCallAndTransferOwnership(event->release_function_call(), output);
       break;
     case ProducerCaptureEvent::kInternedString:
-      ProcessInternedString(producer_id, event.mutable_interned_string());
+      ProcessInternedString(producer_id, event->mutable_interned_string(), output);
       break;
     case ProducerCaptureEvent::kFullGpuJob:
-      ProcessFullGpuJob(event.mutable_full_gpu_job());
+      ProcessFullGpuJob(event->mutable_full_gpu_job(), output);
       break;
     case ProducerCaptureEvent::kGpuQueueSubmission:
       ProcessGpuQueueSubmissionAndTransferOwnership(producer_id,
-                                                    event.release_gpu_queue_submission());
+                                                    event->release_gpu_queue_submission(), output);
+      break;
+    case ProducerCaptureEvent::kGpuClockCalibration:
+      ProcessGpuClockCalibrationAndTransferOwnership(event->release_gpu_clock_calibration(),
+                                                     output);
       break;
     case ProducerCaptureEvent::kThreadName:
-      ProcessThreadNameAndTransferOwnership(event.release_thread_name());
+      ProcessThreadNameAndTransferOwnership(event->release_thread_name(), output);
       break;
     case ProducerCaptureEvent::kThreadNamesSnapshot:
-      ProcessThreadNamesSnapshotAndTransferOwnership(event.release_thread_names_snapshot());
+      ProcessThreadNamesSnapshotAndTransferOwnership(event->release_thread_names_snapshot(),
+                                                     output);
       break;
     case ProducerCaptureEvent::kThreadStateSlice:
-      ProcessThreadStateSliceAndTransferOwnership(event.release_thread_state_slice());
+      ProcessThreadStateSliceAndTransferOwnership(event->release_thread_state_slice(), output);
       break;
     case ProducerCaptureEvent::kFullAddressInfo:
-      ProcessFullAddressInfo(event.mutable_full_address_info());
+      ProcessFullAddressInfo(event->mutable_full_address_info(), output);
       break;
     case ProducerCaptureEvent::kIntrospectionScope:
-      ProcessIntrospectionScopeAndTransferOwnership(event.release_introspection_scope());
+      ProcessIntrospectionScopeAndTransferOwnership(event->release_introspection_scope(), output);
       break;
     case ProducerCaptureEvent::kModuleUpdateEvent:
-      ProcessModuleUpdateEventAndTransferOwnership(event.release_module_update_event());
+      ProcessModuleUpdateEventAndTransferOwnership(event->release_module_update_event(), output);
       break;
     case ProducerCaptureEvent::kModulesSnapshot:
-      ProcessModulesSnapshotAndTransferOwnership(event.release_modules_snapshot());
+      ProcessModulesSnapshotAndTransferOwnership(event->release_modules_snapshot(), output);
       break;
     case ProducerCaptureEvent::kMemoryUsageEvent:
-      ProcessMemoryUsageEventAndTransferOwnership(event.release_memory_usage_event());
+      ProcessMemoryUsageEventAndTransferOwnership(event->release_memory_usage_event(), output);
       break;
     case ProducerCaptureEvent::kApiEvent:
-      ProcessApiEventAndTransferOwnership(event.release_api_event());
+      ProcessApiEventAndTransferOwnership(event->release_api_event(), output);
+      break;
+    case ProducerCaptureEvent::kCompactApiEvent:
+      ProcessCompactApiEventAndTransferOwnership(producer_id, event->release_compact_api_event(),
+                                                 output);
       break;
     case ProducerCaptureEvent::kWarningEvent:
-      ProcessWarningEventAndTransferOwnership(event.release_warning_event());
+      ProcessWarningEventAndTransferOwnership(event->release_warning_event(), output);
+      break;
+    case ProducerCaptureEvent::kServiceHealthEvent:
+      ProcessServiceHealthEventAndTransferOwnership(event->release_service_health_event(), output);
+      break;
+    case ProducerCaptureEvent::kPipelineLatencyProbe:
+      ProcessPipelineLatencyProbeAndTransferOwnership(event->release_pipeline_latency_probe(),
+                                                      output);
+      break;
+    case ProducerCaptureEvent::kCaptureStatisticsSummary:
+      ProcessCaptureStatisticsSummaryAndTransferOwnership(
+          event->release_capture_statistics_summary(), output);
       break;
     case ProducerCaptureEvent::kClockResolutionEvent:
-      ProcessClockResolutionEventAndTransferOwnership(event.release_clock_resolution_event());
+      ProcessClockResolutionEventAndTransferOwnership(event->release_clock_resolution_event(),
+                                                      output);
+      break;
+    case ProducerCaptureEvent::kCaptureStartLatencyEvent:
+      ProcessCaptureStartLatencyEventAndTransferOwnership(
+          event->release_capture_start_latency_event(), output);
       break;
     case ProducerCaptureEvent::kErrorsWithPerfEventOpenEvent:
       ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-          event.release_errors_with_perf_event_open_event());
+          event->release_errors_with_perf_event_open_event(), output);
       break;
     case ProducerCaptureEvent::kErrorEnablingOrbitApiEvent:
       ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-          event.release_error_enabling_orbit_api_event());
+          event->release_error_enabling_orbit_api_event(), output);
       break;
     case ProducerCaptureEvent::kLostPerfRecordsEvent:
-      ProcessLostPerfRecordsEventAndTransferOwnership(event.release_lost_perf_records_event());
+      ProcessLostPerfRecordsEventAndTransferOwnership(event->release_lost_perf_records_event(),
+                                                      output);
       break;
     case ProducerCaptureEvent::kOutOfOrderEventsDiscardedEvent:
       ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-          event.release_out_of_order_events_discarded_event());
+          event->release_out_of_order_events_discarded_event(), output);
+      break;
+    case ProducerCaptureEvent::kSamplingPeriodChangedEvent:
+      ProcessSamplingPeriodChangedEventAndTransferOwnership(
+          event->release_sampling_period_changed_event(), output);
+      break;
+    case ProducerCaptureEvent::kPmuCountersSample:
+      ProcessPmuCountersSampleAndTransferOwnership(event->release_pmu_counters_sample(), output);
+      break;
+    case ProducerCaptureEvent::kTscCalibration:
+      ProcessTscCalibration(event->tsc_calibration());
       break;
     case ProducerCaptureEvent::EVENT_NOT_SET:
       UNREACHABLE();
   }
 }
 
-void ProducerEventProcessorImpl::SendInternedStringEvent(uint64_t key, std::string value) {
+void ProducerEventProcessorImpl::ProcessTscCalibration(const TscCalibration& tsc_calibration) {
+  if (tsc_calibration.tsc_frequency_hz() == 0) {
+    ERROR("TscCalibration with a frequency of zero");
+    return;
+  }
+  tsc_calibration_ = orbit_base::TscCalibration{
+      {tsc_calibration.timestamp_ns(), tsc_calibration.reference_tsc()},
+      tsc_calibration.tsc_frequency_hz()};
+}
+
+void ProducerEventProcessorImpl::SendInternedStringEvent(uint64_t key, std::string value,
+                                                         CaptureEventBuffer* output) {
   ClientCaptureEvent event;
   InternedString* interned_string = event.mutable_interned_string();
   interned_string->set_key(key);
   interned_string->set_intern(std::move(value));
-  capture_event_buffer_->AddEvent(std::move(event));
+  output->AddEvent(std::move(event));
 }
 
 }  // namespace
@@ -7,6 +7,10 @@
 
 #include <stdint.h>
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "CaptureEventBuffer.h"
 #include "capture.pb.h"
 
@@ -23,6 +27,15 @@ class ProducerEventProcessor {
   virtual void ProcessEvent(uint64_t producer_id,
                             orbit_grpc_protos::ProducerCaptureEvent event) = 0;
 
+  // Processes multiple events from the same producer, in order. The resulting ClientCaptureEvents
+  // are added to the CaptureEventBuffer with a single call to CaptureEventBuffer::AddEvents.
+  virtual void ProcessEvents(uint64_t producer_id,
+                             std::vector<orbit_grpc_protos::ProducerCaptureEvent> events) {
+    for (orbit_grpc_protos::ProducerCaptureEvent& event : events) {
+      ProcessEvent(producer_id, std::move(event));
+    }
+  }
+
   static std::unique_ptr<ProducerEventProcessor> Create(CaptureEventBuffer* capture_event_buffer);
 };
 
@@ -3,10 +3,16 @@
 // found in the LICENSE file.
 
 #include <GrpcProtos/Constants.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "ProducerEventProcessor.h"
 #include "capture.pb.h"
 
@@ -19,9 +25,11 @@ using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
 using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::CaptureStarted;
+using orbit_grpc_protos::CaptureStartLatencyEvent;
 using orbit_grpc_protos::CGroupMemoryUsage;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_grpc_protos::ClockResolutionEvent;
+using orbit_grpc_protos::CompactApiEvent;
 using orbit_grpc_protos::ErrorEnablingOrbitApiEvent;
 using orbit_grpc_protos::ErrorsWithPerfEventOpenEvent;
 using orbit_grpc_protos::FullAddressInfo;
@@ -45,14 +53,19 @@ using orbit_grpc_protos::ModuleInfo;
 using orbit_grpc_protos::ModulesSnapshot;
 using orbit_grpc_protos::ModuleUpdateEvent;
 using orbit_grpc_protos::OutOfOrderEventsDiscardedEvent;
+using orbit_grpc_protos::PipelineLatencyProbe;
+using orbit_grpc_protos::PmuCountersSample;
 using orbit_grpc_protos::ProcessMemoryUsage;
 using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_grpc_protos::SamplingPeriodChangedEvent;
 using orbit_grpc_protos::SchedulingSlice;
+using orbit_grpc_protos::ServiceHealthEvent;
 using orbit_grpc_protos::SystemMemoryUsage;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadNamesSnapshot;
 using orbit_grpc_protos::ThreadStateSlice;
 using orbit_grpc_protos::TracepointEvent;
+using orbit_grpc_protos::TscCalibration;
 using orbit_grpc_protos::WarningEvent;
 
 using ::testing::SaveArg;
@@ -60,6 +73,35 @@ using ::testing::SaveArg;
 class MockCaptureEventBuffer : public CaptureEventBuffer {
  public:
   MOCK_METHOD(void, AddEvent, (orbit_grpc_protos::ClientCaptureEvent && /*event*/), (override));
+  MOCK_METHOD(void, AddEvents, (std::vector<orbit_grpc_protos::ClientCaptureEvent> && /*events*/),
+              (override));
+};
+
+// Thread safe, unlike the mock, to use ProducerEventProcessor from multiple threads.
+class CountingCaptureEventBuffer : public CaptureEventBuffer {
+ public:
+  void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override {
+    absl::MutexLock lock{&mutex_};
+    if (event.event_case() == ClientCaptureEvent::kInternedCallstack) {
+      interned_callstack_keys_.push_back(event.interned_callstack().key());
+    } else if (event.event_case() == ClientCaptureEvent::kCallstackSample) {
+      ++callstack_sample_count_;
+    }
+  }
+
+  [[nodiscard]] std::vector<uint64_t> GetInternedCallstackKeys() const {
+    absl::MutexLock lock{&mutex_};
+    return interned_callstack_keys_;
+  }
+  [[nodiscard]] uint64_t GetCallstackSampleCount() const {
+    absl::MutexLock lock{&mutex_};
+    return callstack_sample_count_;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::vector<uint64_t> interned_callstack_keys_ ABSL_GUARDED_BY(mutex_);
+  uint64_t callstack_sample_count_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 
 constexpr uint64_t kDefaultProducerId = 31;
@@ -517,6 +559,9 @@ TEST(ProducerEventProcessor, FullCallstackSampleDifferentCallstacks) {
   full_callstack_sample2->set_pid(kPid2);
   full_callstack_sample2->set_tid(kTid2);
   full_callstack_sample2->set_timestamp_ns(kTimestampNs2);
+  full_callstack_sample2->set_off_cpu_duration_ns(kDurationNs1);
+  full_callstack_sample2->set_memory_event_type(CallstackSample::kMmap);
+  full_callstack_sample2->set_memory_event_count(1);
   Callstack* callstack2 = full_callstack_sample2->mutable_callstack();
   callstack2->add_pcs(5);
   callstack2->add_pcs(6);
@@ -565,12 +610,18 @@ TEST(ProducerEventProcessor, FullCallstackSampleDifferentCallstacks) {
   EXPECT_EQ(callstack_sample1.pid(), kPid1);
   EXPECT_EQ(callstack_sample1.tid(), kTid1);
   EXPECT_EQ(callstack_sample1.timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(callstack_sample1.off_cpu_duration_ns(), 0);
+  EXPECT_EQ(callstack_sample1.memory_event_type(), CallstackSample::kNoMemoryEvent);
+  EXPECT_EQ(callstack_sample1.memory_event_count(), 0);
   EXPECT_EQ(callstack_sample1.callstack_id(), interned_callstack1.key());
 
   const CallstackSample& callstack_sample2 = callstack_sample_event2.callstack_sample();
   EXPECT_EQ(callstack_sample2.pid(), kPid2);
   EXPECT_EQ(callstack_sample2.tid(), kTid2);
   EXPECT_EQ(callstack_sample2.timestamp_ns(), kTimestampNs2);
+  EXPECT_EQ(callstack_sample2.off_cpu_duration_ns(), kDurationNs1);
+  EXPECT_EQ(callstack_sample2.memory_event_type(), CallstackSample::kMmap);
+  EXPECT_EQ(callstack_sample2.memory_event_count(), 1);
   EXPECT_EQ(callstack_sample2.callstack_id(), interned_callstack2.key());
 }
 
@@ -729,6 +780,8 @@ TEST(ProducerEventProcessor, FullTracepointEventsDifferentTracepoints) {
   full_tracepoint_event1->set_timestamp_ns(kTimestampNs1);
   full_tracepoint_event1->mutable_tracepoint_info()->set_category("category1");
   full_tracepoint_event1->mutable_tracepoint_info()->set_name("name1");
+  full_tracepoint_event1->mutable_tracepoint_info()->add_field_names("bytes");
+  full_tracepoint_event1->add_field_values(4096);
 
   ProducerCaptureEvent event2;
   FullTracepointEvent* full_tracepoint_event2 = event2.mutable_full_tracepoint_event();
@@ -764,6 +817,8 @@ TEST(ProducerEventProcessor, FullTracepointEventsDifferentTracepoints) {
   EXPECT_NE(interned_tracepoint_info1.key(), orbit_grpc_protos::kInvalidInternId);
   ASSERT_EQ(interned_tracepoint_info1.intern().name(), "name1");
   EXPECT_EQ(interned_tracepoint_info1.intern().category(), "category1");
+  ASSERT_EQ(interned_tracepoint_info1.intern().field_names_size(), 1);
+  EXPECT_EQ(interned_tracepoint_info1.intern().field_names(0), "bytes");
 
   const InternedTracepointInfo& interned_tracepoint_info2 =
       interned_tracepoint_info_event2.interned_tracepoint_info();
@@ -776,12 +831,15 @@ TEST(ProducerEventProcessor, FullTracepointEventsDifferentTracepoints) {
   EXPECT_EQ(tracepoint_event1.tid(), kTid1);
   EXPECT_EQ(tracepoint_event1.timestamp_ns(), kTimestampNs1);
   EXPECT_EQ(tracepoint_event1.tracepoint_info_key(), interned_tracepoint_info1.key());
+  ASSERT_EQ(tracepoint_event1.field_values_size(), 1);
+  EXPECT_EQ(tracepoint_event1.field_values(0), 4096);
 
   const TracepointEvent& tracepoint_event2 = client_tracepoint_event2.tracepoint_event();
   EXPECT_EQ(tracepoint_event2.pid(), kPid2);
   EXPECT_EQ(tracepoint_event2.tid(), kTid2);
   EXPECT_EQ(tracepoint_event2.timestamp_ns(), kTimestampNs2);
   EXPECT_EQ(tracepoint_event2.tracepoint_info_key(), interned_tracepoint_info2.key());
+  EXPECT_EQ(tracepoint_event2.field_values_size(), 0);
 }
 
 TEST(ProducerEventProcessor, FullTracepointEventsSameTracepoint) {
@@ -1665,6 +1723,78 @@ TEST(ProducerEventProcessor, WarningEvent) {
   EXPECT_EQ(actual_warning_event.message(), kMessage);
 }
 
+TEST(ProducerEventProcessor, ServiceHealthEvent) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent producer_capture_event;
+  ServiceHealthEvent* service_health_event = producer_capture_event.mutable_service_health_event();
+  service_health_event->set_duration_ns(kDurationNs1);
+  service_health_event->set_end_timestamp_ns(kTimestampNs1);
+  ServiceHealthEvent::RingBufferRecordCount* ring_buffer_record_count =
+      service_health_event->add_ring_buffer_record_counts();
+  ring_buffer_record_count->set_ring_buffer_name("sampling_0");
+  ring_buffer_record_count->set_record_count(42);
+  service_health_event->set_perf_event_queue_size(1000);
+  service_health_event->set_max_deferred_event_count(100);
+  service_health_event->set_stack_sample_latency_p99_ns(kDurationNs2);
+
+  ClientCaptureEvent client_capture_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_capture_event));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, producer_capture_event);
+
+  ASSERT_EQ(client_capture_event.event_case(), ClientCaptureEvent::kServiceHealthEvent);
+  EXPECT_EQ(client_capture_event.service_health_event().SerializeAsString(),
+            producer_capture_event.service_health_event().SerializeAsString());
+}
+
+TEST(ProducerEventProcessor, PipelineLatencyProbe) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent producer_capture_event;
+  PipelineLatencyProbe* pipeline_latency_probe =
+      producer_capture_event.mutable_pipeline_latency_probe();
+  pipeline_latency_probe->set_record_timestamp_ns(kTimestampNs1);
+  pipeline_latency_probe->set_ring_buffer_read_timestamp_ns(kTimestampNs1 + 10);
+  pipeline_latency_probe->set_processed_timestamp_ns(kTimestampNs1 + 20);
+
+  ClientCaptureEvent client_capture_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_capture_event));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, producer_capture_event);
+
+  ASSERT_EQ(client_capture_event.event_case(), ClientCaptureEvent::kPipelineLatencyProbe);
+  EXPECT_EQ(client_capture_event.pipeline_latency_probe().SerializeAsString(),
+            producer_capture_event.pipeline_latency_probe().SerializeAsString());
+}
+
+TEST(ProducerEventProcessor, CaptureStatisticsSummary) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent producer_capture_event;
+  orbit_grpc_protos::CaptureStatisticsSummary* capture_statistics_summary =
+      producer_capture_event.mutable_capture_statistics_summary();
+  capture_statistics_summary->set_duration_ns(1000);
+  capture_statistics_summary->set_end_timestamp_ns(kTimestampNs1);
+  orbit_grpc_protos::FunctionCallStatistics* function_call_statistics =
+      capture_statistics_summary->add_function_call_statistics();
+  function_call_statistics->set_function_id(kFunctionId1);
+  function_call_statistics->set_count(3);
+  function_call_statistics->add_duration_log2_histogram(3);
+
+  ClientCaptureEvent client_capture_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_capture_event));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, producer_capture_event);
+
+  ASSERT_EQ(client_capture_event.event_case(), ClientCaptureEvent::kCaptureStatisticsSummary);
+  EXPECT_EQ(client_capture_event.capture_statistics_summary().SerializeAsString(),
+            producer_capture_event.capture_statistics_summary().SerializeAsString());
+}
+
 TEST(ProducerEventProcessor, ClockResolutionEvent) {
   MockCaptureEventBuffer buffer;
   auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
@@ -1688,6 +1818,29 @@ TEST(ProducerEventProcessor, ClockResolutionEvent) {
   EXPECT_EQ(actual_clock_resolution_event.clock_resolution_ns(), kClockResolutionNs);
 }
 
+TEST(ProducerEventProcessor, CaptureStartLatencyEvent) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent producer_capture_event;
+  CaptureStartLatencyEvent* capture_start_latency_event =
+      producer_capture_event.mutable_capture_start_latency_event();
+  capture_start_latency_event->set_timestamp_ns(kTimestampNs1);
+  capture_start_latency_event->set_total_duration_ns(300);
+  CaptureStartLatencyEvent::Phase* phase = capture_start_latency_event->add_phases();
+  phase->set_name("phase");
+  phase->set_duration_ns(200);
+
+  ClientCaptureEvent client_capture_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_capture_event));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, producer_capture_event);
+
+  ASSERT_EQ(client_capture_event.event_case(), ClientCaptureEvent::kCaptureStartLatencyEvent);
+  EXPECT_EQ(client_capture_event.capture_start_latency_event().SerializeAsString(),
+            producer_capture_event.capture_start_latency_event().SerializeAsString());
+}
+
 TEST(ProducerEventProcessor, ErrorsWithPerfEventOpenEvent) {
   MockCaptureEventBuffer buffer;
   auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
@@ -1738,6 +1891,142 @@ TEST(ProducerEventProcessor, ErrorEnablingOrbitApiEvent) {
   EXPECT_EQ(actual_error_enabling_orbit_api_event.message(), kMessage);
 }
 
+TEST(ProducerEventProcessor, CompactApiEventNameKeysAreRemapped) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ClientCaptureEvent client_interned_string_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_interned_string_event));
+  producer_event_processor->ProcessEvent(kDefaultProducerId,
+                                         CreateInternedStringEvent(kKey1, "name"));
+  ASSERT_EQ(client_interned_string_event.event_case(), ClientCaptureEvent::kInternedString);
+
+  ProducerCaptureEvent start_event;
+  CompactApiEvent* compact_start_event = start_event.mutable_compact_api_event();
+  compact_start_event->set_pid(kPid1);
+  compact_start_event->set_tid(kTid1);
+  compact_start_event->set_timestamp_ns(kTimestampNs1);
+  compact_start_event->set_type(1);
+  compact_start_event->set_name_key(kKey1);
+  compact_start_event->set_color(kSeqNo1);
+
+  ProducerCaptureEvent stop_event;
+  CompactApiEvent* compact_stop_event = stop_event.mutable_compact_api_event();
+  compact_stop_event->set_pid(kPid1);
+  compact_stop_event->set_tid(kTid1);
+  compact_stop_event->set_timestamp_ns(kTimestampNs2);
+  compact_stop_event->set_type(2);
+
+  ClientCaptureEvent client_start_event;
+  ClientCaptureEvent client_stop_event;
+  EXPECT_CALL(buffer, AddEvent)
+      .Times(2)
+      .WillOnce(SaveArg<0>(&client_start_event))
+      .WillOnce(SaveArg<0>(&client_stop_event));
+  producer_event_processor->ProcessEvent(kDefaultProducerId, start_event);
+  producer_event_processor->ProcessEvent(kDefaultProducerId, stop_event);
+
+  ASSERT_EQ(client_start_event.event_case(), ClientCaptureEvent::kCompactApiEvent);
+  const CompactApiEvent& actual_start_event = client_start_event.compact_api_event();
+  EXPECT_EQ(actual_start_event.pid(), kPid1);
+  EXPECT_EQ(actual_start_event.tid(), kTid1);
+  EXPECT_EQ(actual_start_event.timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(actual_start_event.type(), 1);
+  EXPECT_EQ(actual_start_event.name_key(), client_interned_string_event.interned_string().key());
+  EXPECT_EQ(actual_start_event.color(), kSeqNo1);
+
+  ASSERT_EQ(client_stop_event.event_case(), ClientCaptureEvent::kCompactApiEvent);
+  const CompactApiEvent& actual_stop_event = client_stop_event.compact_api_event();
+  EXPECT_EQ(actual_stop_event.timestamp_ns(), kTimestampNs2);
+  EXPECT_EQ(actual_stop_event.type(), 2);
+  EXPECT_EQ(actual_stop_event.name_key(), orbit_grpc_protos::kInvalidInternId);
+}
+
+TEST(ProducerEventProcessor, CompactApiEventTscTimestampsAreConverted) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent calibration_event;
+  TscCalibration* tsc_calibration = calibration_event.mutable_tsc_calibration();
+  tsc_calibration->set_timestamp_ns(1'000'000'000);
+  tsc_calibration->set_reference_tsc(4'000'000'000);
+  tsc_calibration->set_tsc_frequency_hz(2'000'000'000);
+  // The calibration is only used by the service and not forwarded.
+  EXPECT_CALL(buffer, AddEvent).Times(0);
+  producer_event_processor->ProcessEvent(orbit_grpc_protos::kRootProducerId, calibration_event);
+  ::testing::Mock::VerifyAndClearExpectations(&buffer);
+
+  ProducerCaptureEvent api_event;
+  CompactApiEvent* compact_api_event = api_event.mutable_compact_api_event();
+  compact_api_event->set_pid(kPid1);
+  compact_api_event->set_tid(kTid1);
+  compact_api_event->set_timestamp_tsc(5'000'000'000);
+  compact_api_event->set_type(2);
+
+  ClientCaptureEvent client_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_event));
+  producer_event_processor->ProcessEvent(kDefaultProducerId, api_event);
+
+  ASSERT_EQ(client_event.event_case(), ClientCaptureEvent::kCompactApiEvent);
+  const CompactApiEvent& actual_event = client_event.compact_api_event();
+  EXPECT_EQ(actual_event.timestamp_ns(), 1'500'000'000);
+  EXPECT_EQ(actual_event.timestamp_tsc(), 0);
+  EXPECT_EQ(actual_event.pid(), kPid1);
+  EXPECT_EQ(actual_event.type(), 2);
+}
+
+TEST(ProducerEventProcessor, CoalescedCompactApiEventTscTimestampsAreConverted) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent calibration_event;
+  TscCalibration* tsc_calibration = calibration_event.mutable_tsc_calibration();
+  tsc_calibration->set_timestamp_ns(1'000'000'000);
+  tsc_calibration->set_reference_tsc(4'000'000'000);
+  tsc_calibration->set_tsc_frequency_hz(2'000'000'000);
+  // The calibration is only used by the service and not forwarded.
+  EXPECT_CALL(buffer, AddEvent).Times(0);
+  producer_event_processor->ProcessEvent(orbit_grpc_protos::kRootProducerId, calibration_event);
+  ::testing::Mock::VerifyAndClearExpectations(&buffer);
+
+  ProducerCaptureEvent api_event;
+  CompactApiEvent* compact_api_event = api_event.mutable_compact_api_event();
+  compact_api_event->set_pid(kPid1);
+  compact_api_event->set_tid(kTid1);
+  compact_api_event->set_timestamp_tsc(5'000'000'000);
+  // orbit_api::kTrackInt.
+  compact_api_event->set_type(5);
+  compact_api_event->set_coalesced_count(3);
+  compact_api_event->set_coalesced_min_timestamp_ns(4'000'000'000);
+  compact_api_event->set_coalesced_max_timestamp_ns(4'500'000'000);
+
+  ClientCaptureEvent client_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_event));
+  producer_event_processor->ProcessEvent(kDefaultProducerId, api_event);
+
+  ASSERT_EQ(client_event.event_case(), ClientCaptureEvent::kCompactApiEvent);
+  const CompactApiEvent& actual_event = client_event.compact_api_event();
+  EXPECT_EQ(actual_event.timestamp_ns(), 1'500'000'000);
+  EXPECT_EQ(actual_event.timestamp_tsc(), 0);
+  EXPECT_EQ(actual_event.pid(), kPid1);
+  EXPECT_EQ(actual_event.coalesced_count(), 3);
+  EXPECT_EQ(actual_event.coalesced_min_timestamp_ns(), 1'000'000'000);
+  EXPECT_EQ(actual_event.coalesced_max_timestamp_ns(), 1'250'000'000);
+}
+
+TEST(ProducerEventProcessor, CompactApiEventWithTscTimestampButNoCalibrationIsDiscarded) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent api_event;
+  CompactApiEvent* compact_api_event = api_event.mutable_compact_api_event();
+  compact_api_event->set_timestamp_tsc(5'000'000'000);
+  compact_api_event->set_type(2);
+
+  EXPECT_CALL(buffer, AddEvent).Times(0);
+  producer_event_processor->ProcessEvent(kDefaultProducerId, api_event);
+}
+
 TEST(ProducerEventProcessor, LostPerfRecordsEvent) {
   MockCaptureEventBuffer buffer;
   auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
@@ -1782,4 +2071,137 @@ TEST(ProducerEventProcessor, OutOfOrderEventsDiscardedEvent) {
   EXPECT_EQ(actual_out_of_order_events_discarded_event.end_timestamp_ns(), kTimestampNs1);
 }
 
-}  // namespace orbit_service
\ No newline at end of file
+TEST(ProducerEventProcessor, SamplingPeriodChangedEvent) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  constexpr uint64_t kSamplingPeriodNs = 2'000'000;
+  ProducerCaptureEvent producer_capture_event;
+  SamplingPeriodChangedEvent* sampling_period_changed_event =
+      producer_capture_event.mutable_sampling_period_changed_event();
+  sampling_period_changed_event->set_timestamp_ns(kTimestampNs1);
+  sampling_period_changed_event->set_cpu(kCore1);
+  sampling_period_changed_event->set_sampling_period_ns(kSamplingPeriodNs);
+
+  ClientCaptureEvent client_capture_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_capture_event));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, producer_capture_event);
+
+  ASSERT_EQ(client_capture_event.event_case(), ClientCaptureEvent::kSamplingPeriodChangedEvent);
+  const SamplingPeriodChangedEvent& actual_sampling_period_changed_event =
+      client_capture_event.sampling_period_changed_event();
+  EXPECT_EQ(actual_sampling_period_changed_event.timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(actual_sampling_period_changed_event.cpu(), kCore1);
+  EXPECT_EQ(actual_sampling_period_changed_event.sampling_period_ns(), kSamplingPeriodNs);
+}
+
+TEST(ProducerEventProcessor, PmuCountersSample) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent producer_capture_event;
+  PmuCountersSample* pmu_counters_sample = producer_capture_event.mutable_pmu_counters_sample();
+  pmu_counters_sample->set_pid(kPid1);
+  pmu_counters_sample->set_tid(kTid1);
+  pmu_counters_sample->set_duration_ns(kDurationNs1);
+  pmu_counters_sample->set_end_timestamp_ns(kTimestampNs1);
+  pmu_counters_sample->set_cycles(1000);
+  pmu_counters_sample->set_instructions(2000);
+  pmu_counters_sample->set_llc_misses(3);
+  pmu_counters_sample->set_branch_misses(4);
+
+  ClientCaptureEvent client_capture_event;
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&client_capture_event));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, producer_capture_event);
+
+  ASSERT_EQ(client_capture_event.event_case(), ClientCaptureEvent::kPmuCountersSample);
+  const PmuCountersSample& actual_pmu_counters_sample = client_capture_event.pmu_counters_sample();
+  EXPECT_EQ(actual_pmu_counters_sample.pid(), kPid1);
+  EXPECT_EQ(actual_pmu_counters_sample.tid(), kTid1);
+  EXPECT_EQ(actual_pmu_counters_sample.duration_ns(), kDurationNs1);
+  EXPECT_EQ(actual_pmu_counters_sample.end_timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(actual_pmu_counters_sample.cycles(), 1000);
+  EXPECT_EQ(actual_pmu_counters_sample.instructions(), 2000);
+  EXPECT_EQ(actual_pmu_counters_sample.llc_misses(), 3);
+  EXPECT_EQ(actual_pmu_counters_sample.branch_misses(), 4);
+}
+
+TEST(ProducerEventProcessor, ProcessEventsAddsAllClientCaptureEventsAtOnce) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  std::vector<ProducerCaptureEvent> events(3);
+  for (size_t i = 0; i < 2; ++i) {
+    FullCallstackSample* full_callstack_sample = events[i].mutable_full_callstack_sample();
+    full_callstack_sample->set_pid(kPid1);
+    full_callstack_sample->set_tid(kTid1);
+    full_callstack_sample->set_timestamp_ns(kTimestampNs1 + i);
+    Callstack* callstack = full_callstack_sample->mutable_callstack();
+    callstack->add_pcs(1);
+    callstack->add_pcs(2);
+    callstack->set_type(Callstack::kComplete);
+  }
+  SchedulingSlice* scheduling_slice = events[2].mutable_scheduling_slice();
+  scheduling_slice->set_pid(kPid1);
+  scheduling_slice->set_out_timestamp_ns(kTimestampNs2);
+
+  std::vector<ClientCaptureEvent> client_capture_events;
+  EXPECT_CALL(buffer, AddEvent).Times(0);
+  EXPECT_CALL(buffer, AddEvents).Times(1).WillOnce(SaveArg<0>(&client_capture_events));
+
+  producer_event_processor->ProcessEvents(kDefaultProducerId, std::move(events));
+
+  ASSERT_EQ(client_capture_events.size(), 4);
+  ASSERT_EQ(client_capture_events[0].event_case(), ClientCaptureEvent::kInternedCallstack);
+  const uint64_t callstack_id = client_capture_events[0].interned_callstack().key();
+  ASSERT_EQ(client_capture_events[1].event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(client_capture_events[1].callstack_sample().callstack_id(), callstack_id);
+  EXPECT_EQ(client_capture_events[1].callstack_sample().timestamp_ns(), kTimestampNs1);
+  ASSERT_EQ(client_capture_events[2].event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(client_capture_events[2].callstack_sample().callstack_id(), callstack_id);
+  EXPECT_EQ(client_capture_events[2].callstack_sample().timestamp_ns(), kTimestampNs1 + 1);
+  ASSERT_EQ(client_capture_events[3].event_case(), ClientCaptureEvent::kSchedulingSlice);
+  EXPECT_EQ(client_capture_events[3].scheduling_slice().out_timestamp_ns(), kTimestampNs2);
+}
+
+TEST(ProducerEventProcessor, FullCallstackSamplesFromMultipleThreadsAreInternedOnce) {
+  CountingCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  constexpr size_t kThreadCount = 4;
+  constexpr size_t kDistinctCallstackCount = 50;
+  constexpr size_t kRepetitionCount = 20;
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&producer_event_processor] {
+      for (size_t repetition = 0; repetition < kRepetitionCount; ++repetition) {
+        for (size_t callstack_index = 0; callstack_index < kDistinctCallstackCount;
+             ++callstack_index) {
+          ProducerCaptureEvent event;
+          FullCallstackSample* full_callstack_sample = event.mutable_full_callstack_sample();
+          full_callstack_sample->set_pid(kPid1);
+          Callstack* callstack = full_callstack_sample->mutable_callstack();
+          callstack->add_pcs(1);
+          callstack->add_pcs(callstack_index);
+          callstack->set_type(Callstack::kComplete);
+          producer_event_processor->ProcessEvent(kDefaultProducerId, std::move(event));
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<uint64_t> keys = buffer.GetInternedCallstackKeys();
+  EXPECT_EQ(keys.size(), kDistinctCallstackCount);
+  absl::flat_hash_set<uint64_t> unique_keys{keys.begin(), keys.end()};
+  EXPECT_EQ(unique_keys.size(), kDistinctCallstackCount);
+  EXPECT_FALSE(unique_keys.contains(orbit_grpc_protos::kInvalidInternId));
+  EXPECT_EQ(buffer.GetCallstackSampleCount(),
+            kThreadCount * kDistinctCallstackCount * kRepetitionCount);
+}
+
+}  // namespace orbit_service
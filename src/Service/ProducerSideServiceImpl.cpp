@@ -7,6 +7,7 @@
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
 
+#include <chrono>
 #include <thread>
 #include <utility>
 
@@ -17,6 +18,8 @@
 namespace orbit_service {
 
 using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
 
 void ProducerSideServiceImpl::OnCaptureStartRequested(
     orbit_grpc_protos::CaptureOptions capture_options,
@@ -108,6 +111,9 @@ grpc::Status ProducerSideServiceImpl::ReceiveCommandsAndSendEvents(
 
   std::atomic<bool> receive_events_thread_exited = false;
 
+  // Only used if the producer offers a SharedMemoryRingBuffer.
+  ProducerSharedMemoryBuffer shared_memory_buffer;
+
   // This thread is responsible for writing on stream, and specifically for
   // sending StartCaptureCommands and StopCaptureCommands to the connected producer.
   std::thread send_commands_thread{&ProducerSideServiceImpl::SendCommandsThread,
@@ -115,7 +121,8 @@ grpc::Status ProducerSideServiceImpl::ReceiveCommandsAndSendEvents(
                                    context,
                                    stream,
                                    &all_events_sent_received,
-                                   &receive_events_thread_exited};
+                                   &receive_events_thread_exited,
+                                   &shared_memory_buffer};
 
   // This thread is responsible for reading from stream, and specifically for
   // receiving ProducerCaptureEvents and AllEventsSent messages.
@@ -124,9 +131,15 @@ grpc::Status ProducerSideServiceImpl::ReceiveCommandsAndSendEvents(
                                     context,
                                     stream,
                                     producer_id_counter_++,
-                                    &all_events_sent_received};
+                                    &all_events_sent_received,
+                                    &shared_memory_buffer};
   receive_events_thread.join();
 
+  if (shared_memory_buffer.read_thread.joinable()) {
+    shared_memory_buffer.read_thread_exit_requested = true;
+    shared_memory_buffer.read_thread.join();
+  }
+
   // When receive_events_thread exits because stream->Read(&request) fails,
   // it means that the producer has disconnected: ask send_commands_thread to exit, too.
   receive_events_thread_exited = true;
@@ -193,11 +206,29 @@ static bool SendCaptureFinishedCommand(
   return true;
 }
 
+static bool SendSharedMemoryBufferAcceptedCommand(
+    grpc::ServerContext* context,
+    grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
+                             orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream) {
+  orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse command;
+  command.mutable_shared_memory_buffer_accepted_command();
+  if (!stream->Write(command)) {
+    ERROR("Sending SharedMemoryBufferAcceptedCommand to CaptureEventProducer");
+    LOG("Terminating call to ReceiveCommandsAndSendEvents as Write failed");
+    // Cause Read in ReceiveEventsThread to also fail if for some reason it hasn't already.
+    context->TryCancel();
+    return false;
+  }
+  LOG("Sent SharedMemoryBufferAcceptedCommand to CaptureEventProducer");
+  return true;
+}
+
 void ProducerSideServiceImpl::SendCommandsThread(
     grpc::ServerContext* context,
     grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-    bool* all_events_sent_received, std::atomic<bool>* receive_events_thread_exited) {
+    bool* all_events_sent_received, std::atomic<bool>* receive_events_thread_exited,
+    ProducerSharedMemoryBuffer* shared_memory_buffer) {
   // As a result of initializing prev_capture_status to kCaptureFinished,
   // an initial StartCaptureCommand is sent
   // if service_state_.capture_status is actually CaptureStatus::kCaptureStarted,
@@ -216,6 +247,14 @@ void ProducerSideServiceImpl::SendCommandsThread(
       return;
     }
 
+    // As this is only checked once per iteration, the command can be delayed by up to
+    // kCheckExitSendCommandsThreadInterval. The producer only starts using the buffer with the next
+    // capture anyway.
+    if (shared_memory_buffer->accepted_command_pending.exchange(false) &&
+        !SendSharedMemoryBufferAcceptedCommand(context, stream)) {
+      return;
+    }
+
     CaptureStatus curr_capture_status;
     std::optional<orbit_grpc_protos::CaptureOptions> curr_capture_options;
     {
@@ -228,7 +267,8 @@ void ProducerSideServiceImpl::SendCommandsThread(
         // Wait for service_state_.capture_status to change or for service_state->exit_requested
         // (the next iteration will handle the change).
         // Use a timeout to periodically check (in the next iteration)
-        // for *terminate_send_commands_thread, set by ReceiveCommandsAndSendEvents.
+        // for *terminate_send_commands_thread, set by ReceiveCommandsAndSendEvents,
+        // and for shared_memory_buffer->accepted_command_pending.
         static constexpr absl::Duration kCheckExitSendCommandsThreadInterval = absl::Seconds(1);
 
         // The three cases in this switch are almost identical, except
@@ -353,7 +393,8 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
     grpc::ServerContext* /*context*/,
     grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-    uint64_t producer_id, bool* all_events_sent_received) {
+    uint64_t producer_id, bool* all_events_sent_received,
+    ProducerSharedMemoryBuffer* shared_memory_buffer) {
   orbit_base::SetCurrentThreadName("PSSI::RcvEvents");
 
   orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
@@ -367,22 +408,15 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
 
     switch (request.event_case()) {
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kBufferedCaptureEvents: {
-        // We use ReaderMutexLock because the mutex guards the value of producer_event_processor_,
-        // it does not guard calls to ProcessEvent nor the internal state of the object implementing
-        // the interface. The interface implementation is by itself thread-safe.
-        absl::ReaderMutexLock lock{&producer_event_processor_mutex_};
-        // producer_event_processor_ can be nullptr if a producer sends events while not capturing.
-        // Don't log an error in such a case as it could easily spam the logs.
-        if (producer_event_processor_ != nullptr) {
-          for (ProducerCaptureEvent& event :
-               *request.mutable_buffered_capture_events()->mutable_capture_events()) {
-            producer_event_processor_->ProcessEvent(producer_id, std::move(event));
-          }
-        }
+        ProcessBufferedCaptureEvents(producer_id, request.mutable_buffered_capture_events());
       } break;
 
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent: {
         LOG("Received AllEventsSent from CaptureEventProducer");
+        // The producer writes AllEventsSent to the stream after all events to the buffer.
+        if (shared_memory_buffer->read_thread.joinable()) {
+          ReadAllFromSharedMemoryBuffer(producer_id, shared_memory_buffer);
+        }
         absl::MutexLock lock{&service_state_mutex_};
         switch (service_state_.capture_status) {
           case CaptureStatus::kCaptureStarted: {
@@ -409,6 +443,12 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
         }
       } break;
 
+      case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryBufferCreated: {
+        LOG("Received SharedMemoryBufferCreated from CaptureEventProducer");
+        OpenSharedMemoryBuffer(request.shared_memory_buffer_created(), producer_id,
+                               shared_memory_buffer);
+      } break;
+
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::EVENT_NOT_SET: {
         ERROR("CaptureEventProducer sent EVENT_NOT_SET");
       } break;
@@ -428,4 +468,78 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
   }
 }
 
+void ProducerSideServiceImpl::ProcessBufferedCaptureEvents(
+    uint64_t producer_id,
+    ReceiveCommandsAndSendEventsRequest::BufferedCaptureEvents* buffered_capture_events) {
+  // We use ReaderMutexLock because the mutex guards the value of producer_event_processor_,
+  // it does not guard calls to ProcessEvent nor the internal state of the object implementing
+  // the interface. The interface implementation is by itself thread-safe.
+  absl::ReaderMutexLock lock{&producer_event_processor_mutex_};
+  // producer_event_processor_ can be nullptr if a producer sends events while not capturing.
+  // Don't log an error in such a case as it could easily spam the logs.
+  if (producer_event_processor_ != nullptr) {
+    for (ProducerCaptureEvent& event : *buffered_capture_events->mutable_capture_events()) {
+      producer_event_processor_->ProcessEvent(producer_id, std::move(event));
+    }
+  }
+}
+
+void ProducerSideServiceImpl::OpenSharedMemoryBuffer(
+    const ReceiveCommandsAndSendEventsRequest::SharedMemoryBufferCreated&
+        shared_memory_buffer_created,
+    uint64_t producer_id, ProducerSharedMemoryBuffer* shared_memory_buffer) {
+  if (shared_memory_buffer->read_thread.joinable()) {
+    ERROR("CaptureEventProducer sent SharedMemoryBufferCreated more than once");
+    return;
+  }
+
+  ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> buffer_or_error =
+      SharedMemoryRingBuffer::OpenFromProcess(shared_memory_buffer_created.pid(),
+                                              shared_memory_buffer_created.fd());
+  if (buffer_or_error.has_error()) {
+    // The producer keeps sending its CaptureEvents through the stream.
+    ERROR("Opening shared memory buffer of CaptureEventProducer: %s",
+          buffer_or_error.error().message());
+    return;
+  }
+  {
+    absl::MutexLock lock{&shared_memory_buffer->read_mutex};
+    shared_memory_buffer->buffer = std::move(buffer_or_error.value());
+  }
+  shared_memory_buffer->read_thread =
+      std::thread{&ProducerSideServiceImpl::ReadSharedMemoryBufferThread, this, producer_id,
+                  shared_memory_buffer};
+  shared_memory_buffer->accepted_command_pending = true;
+}
+
+void ProducerSideServiceImpl::ReadSharedMemoryBufferThread(
+    uint64_t producer_id, ProducerSharedMemoryBuffer* shared_memory_buffer) {
+  orbit_base::SetCurrentThreadName("PSSI::RcvShm");
+  static constexpr std::chrono::milliseconds kEmptyBufferSleep{1};
+  while (!shared_memory_buffer->read_thread_exit_requested) {
+    if (ReadAllFromSharedMemoryBuffer(producer_id, shared_memory_buffer) == 0) {
+      std::this_thread::sleep_for(kEmptyBufferSleep);
+    }
+  }
+}
+
+uint64_t ProducerSideServiceImpl::ReadAllFromSharedMemoryBuffer(
+    uint64_t producer_id, ProducerSharedMemoryBuffer* shared_memory_buffer) {
+  absl::MutexLock lock{&shared_memory_buffer->read_mutex};
+  CHECK(shared_memory_buffer->buffer != nullptr);
+  uint64_t message_count = 0;
+  ReceiveCommandsAndSendEventsRequest request;
+  while (shared_memory_buffer->buffer->TryRead([&](const char* data, uint64_t size) {
+    if (!request.ParseFromArray(data, static_cast<int>(size)) ||
+        request.event_case() != ReceiveCommandsAndSendEventsRequest::kBufferedCaptureEvents) {
+      ERROR("CaptureEventProducer wrote an invalid message to the shared memory buffer");
+      return;
+    }
+    ProcessBufferedCaptureEvents(producer_id, request.mutable_buffered_capture_events());
+  })) {
+    ++message_count;
+  }
+  return message_count;
+}
+
 }  // namespace orbit_service
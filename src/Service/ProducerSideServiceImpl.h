@@ -11,11 +11,14 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <memory>
+#include <thread>
 
 #include "CaptureEventBuffer.h"
 #include "CaptureStartStopListener.h"
 #include "GrpcProtos/Constants.h"
 #include "ProducerEventProcessor.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "capture.pb.h"
 #include "producer_side_services.grpc.pb.h"
 #include "producer_side_services.pb.h"
@@ -30,6 +33,8 @@ namespace orbit_service {
 // As OnCaptureStopRequested waits for the remaining CaptureEvents, SetMaxWaitForAllCaptureEventsMs
 // allows to specify a timeout for that method.
 // OnExitRequest disconnects all producers, preparing this service for shutdown.
+// Producers on the same machine can offer a SharedMemoryRingBuffer, from which a dedicated thread
+// per producer then reads the CaptureEvents instead of receiving them through the stream.
 class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideService::Service,
                                       public CaptureStartStopListener {
  public:
@@ -63,17 +68,48 @@ class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideServ
       override;
 
  private:
+  // The SharedMemoryRingBuffer offered by a producer, only ever set by ReceiveEventsThread.
+  struct ProducerSharedMemoryBuffer {
+    // Guards the reads from buffer, done by ReadSharedMemoryBufferThread and, to receive all
+    // events before AllEventsSent, by ReceiveEventsThread.
+    absl::Mutex read_mutex;
+    std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> buffer
+        ABSL_GUARDED_BY(read_mutex);
+    std::thread read_thread;
+    std::atomic<bool> read_thread_exit_requested = false;
+    // Set by ReceiveEventsThread, so that SendCommandsThread sends the
+    // SharedMemoryBufferAcceptedCommand.
+    std::atomic<bool> accepted_command_pending = false;
+  };
+
   void SendCommandsThread(
       grpc::ServerContext* context,
       grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-      bool* all_events_sent_received, std::atomic<bool>* receive_events_thread_exited);
+      bool* all_events_sent_received, std::atomic<bool>* receive_events_thread_exited,
+      ProducerSharedMemoryBuffer* shared_memory_buffer);
 
   void ReceiveEventsThread(
       grpc::ServerContext* context,
       grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-      uint64_t producer_id, bool* all_events_sent_received);
+      uint64_t producer_id, bool* all_events_sent_received,
+      ProducerSharedMemoryBuffer* shared_memory_buffer);
+
+  void OpenSharedMemoryBuffer(
+      const orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::SharedMemoryBufferCreated&
+          shared_memory_buffer_created,
+      uint64_t producer_id, ProducerSharedMemoryBuffer* shared_memory_buffer);
+  void ReadSharedMemoryBufferThread(uint64_t producer_id,
+                                    ProducerSharedMemoryBuffer* shared_memory_buffer);
+  // Returns the number of messages read.
+  uint64_t ReadAllFromSharedMemoryBuffer(uint64_t producer_id,
+                                         ProducerSharedMemoryBuffer* shared_memory_buffer);
+
+  void ProcessBufferedCaptureEvents(
+      uint64_t producer_id,
+      orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::BufferedCaptureEvents*
+          buffered_capture_events);
 
  private:
   absl::flat_hash_set<grpc::ServerContext*> server_contexts_;
@@ -8,14 +8,19 @@
 #include <grpcpp/support/channel_arguments.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <thread>
 
 #include "CaptureEventBuffer.h"
+#include "OrbitBase/Result.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "ProducerSideServiceImpl.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
@@ -57,6 +62,10 @@ class FakeProducer {
           case orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::kCaptureFinishedCommand:
             OnCaptureFinishedCommandReceived();
             break;
+          case orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::
+              kSharedMemoryBufferAcceptedCommand:
+            OnSharedMemoryBufferAcceptedCommandReceived();
+            break;
           case orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::COMMAND_NOT_SET:
             break;
         }
@@ -75,6 +84,15 @@ class FakeProducer {
     EXPECT_TRUE(written);
   }
 
+  void SendSharedMemoryBufferCreated(int32_t pid, int32_t fd) {
+    ASSERT_NE(stream_, nullptr);
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
+    request.mutable_shared_memory_buffer_created()->set_pid(pid);
+    request.mutable_shared_memory_buffer_created()->set_fd(fd);
+    bool written = stream_->Write(request);
+    EXPECT_TRUE(written);
+  }
+
   void SendAllEventsSent() {
     ASSERT_NE(stream_, nullptr);
     orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
@@ -99,6 +117,7 @@ class FakeProducer {
   MOCK_METHOD(void, OnStartCaptureCommandReceived, (const orbit_grpc_protos::CaptureOptions&), ());
   MOCK_METHOD(void, OnStopCaptureCommandReceived, (), ());
   MOCK_METHOD(void, OnCaptureFinishedCommandReceived, (), ());
+  MOCK_METHOD(void, OnSharedMemoryBufferAcceptedCommandReceived, (), ());
 
  private:
   std::unique_ptr<grpc::ClientContext> context_;
@@ -208,6 +227,56 @@ TEST_F(ProducerSideServiceImplTest, OneCapture) {
                           2 * kSendAllEventsDelayMs);
 }
 
+TEST_F(ProducerSideServiceImplTest, OneCaptureThroughSharedMemoryBuffer) {
+  auto buffer_or_error = orbit_producer_side_channel::SharedMemoryRingBuffer::Create(4096);
+  ASSERT_TRUE(buffer_or_error.has_value()) << buffer_or_error.error().message();
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> buffer =
+      std::move(buffer_or_error.value());
+
+  // SendCommandsThread checks for the command to send at least once per second.
+  std::atomic<bool> accepted = false;
+  EXPECT_CALL(*fake_producer_, OnSharedMemoryBufferAcceptedCommandReceived).WillOnce([&accepted] {
+    accepted = true;
+  });
+  fake_producer_->SendSharedMemoryBufferCreated(getpid(), buffer->fd());
+  for (int i = 0; i < 150 && !accepted; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  ASSERT_TRUE(accepted);
+
+  MockProducerEventProcessor mock_processor;
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived(CaptureOptionsEq(kFakeCaptureOptions)))
+      .Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(6);
+  orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
+  for (int32_t i = 0; i < 3; ++i) {
+    request.mutable_buffered_capture_events()->mutable_capture_events()->Add();
+  }
+  std::string serialized_request = request.SerializeAsString();
+  for (int32_t i = 0; i < 2; ++i) {
+    EXPECT_TRUE(buffer->TryWrite(serialized_request.size(), [&serialized_request](char* data) {
+      serialized_request.copy(data, serialized_request.size());
+    }));
+  }
+
+  // The events in the buffer are processed before the AllEventsSent that follows them.
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived).WillByDefault([this] {
+    fake_producer_->SendAllEventsSent();
+  });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+}
+
 TEST_F(ProducerSideServiceImplTest, TwoCaptures) {
   MockProducerEventProcessor mock_processor;
 
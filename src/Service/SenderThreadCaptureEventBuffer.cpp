@@ -0,0 +1,248 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SenderThreadCaptureEventBuffer.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <pthread.h>
+
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+std::optional<CaptureEventBufferOverflowPolicy> ParseCaptureEventBufferOverflowPolicy(
+    std::string_view policy) {
+  if (policy == "drop") {
+    return CaptureEventBufferOverflowPolicy::kDropLowPriorityEvents;
+  }
+  if (policy == "throttle") {
+    return CaptureEventBufferOverflowPolicy::kThrottleProducers;
+  }
+  return std::nullopt;
+}
+
+SenderThreadCaptureEventBuffer::SenderThreadCaptureEventBuffer(
+    CaptureEventSender* event_sender, uint64_t max_size_bytes,
+    CaptureEventBufferOverflowPolicy overflow_policy)
+    : capture_event_sender_{event_sender},
+      max_size_bytes_{max_size_bytes},
+      overflow_policy_{overflow_policy} {
+  CHECK(capture_event_sender_ != nullptr);
+  sender_thread_ = std::thread{[this] { SenderThread(); }};
+}
+
+SenderThreadCaptureEventBuffer::~SenderThreadCaptureEventBuffer() {
+  CHECK(!sender_thread_.joinable());
+}
+
+bool SenderThreadCaptureEventBuffer::IsBelowLimitForPriority(uint64_t event_size_bytes,
+                                                             CaptureEventPriority priority) const {
+  uint64_t limit_bytes = 0;
+  switch (priority) {
+    case CaptureEventPriority::kLow:
+      limit_bytes = max_size_bytes_ / 2;
+      break;
+    case CaptureEventPriority::kMedium:
+      limit_bytes = max_size_bytes_ / 4 * 3;
+      break;
+    case CaptureEventPriority::kHigh:
+      limit_bytes = max_size_bytes_;
+      break;
+    case CaptureEventPriority::kEssential:
+      return true;
+  }
+  return event_buffer_size_bytes_ + sending_size_bytes_ + event_size_bytes <= limit_bytes;
+}
+
+void SenderThreadCaptureEventBuffer::WaitForRoom(uint64_t size_bytes) {
+  // An empty buffer always has room, even for events that exceed the limit by themselves.
+  auto has_room = [this, size_bytes]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(event_buffer_mutex_) {
+    const uint64_t buffered_size_bytes = event_buffer_size_bytes_ + sending_size_bytes_;
+    return stop_requested_ || buffered_size_bytes == 0 ||
+           buffered_size_bytes + size_bytes <= max_size_bytes_;
+  };
+  if (has_room()) {
+    return;
+  }
+  ORBIT_SCOPE("Throttled by SenderThreadCaptureEventBuffer");
+  const absl::Time wait_begin = absl::Now();
+  event_buffer_mutex_.Await(absl::Condition(&has_room));
+  throttled_duration_ += absl::Now() - wait_begin;
+}
+
+void SenderThreadCaptureEventBuffer::AddEvent(ClientCaptureEvent&& event) {
+  if (max_size_bytes_ == 0) {
+    absl::MutexLock lock{&event_buffer_mutex_};
+    if (stop_requested_) {
+      return;
+    }
+    event_buffer_.emplace_back(std::move(event));
+    return;
+  }
+
+  const uint64_t event_size_bytes = event.ByteSizeLong();
+  absl::MutexLock lock{&event_buffer_mutex_};
+  if (overflow_policy_ == CaptureEventBufferOverflowPolicy::kThrottleProducers) {
+    WaitForRoom(event_size_bytes);
+  }
+  if (stop_requested_) {
+    return;
+  }
+  if (overflow_policy_ == CaptureEventBufferOverflowPolicy::kDropLowPriorityEvents &&
+      !IsBelowLimitForPriority(event_size_bytes, GetCaptureEventPriority(event.event_case()))) {
+    ++dropped_event_counts_[event.event_case()];
+    return;
+  }
+  event_buffer_.emplace_back(std::move(event));
+  event_buffer_size_bytes_ += event_size_bytes;
+}
+
+void SenderThreadCaptureEventBuffer::AddEvents(std::vector<ClientCaptureEvent>&& events) {
+  if (max_size_bytes_ == 0) {
+    absl::MutexLock lock{&event_buffer_mutex_};
+    if (stop_requested_) {
+      return;
+    }
+    event_buffer_.insert(event_buffer_.end(), std::make_move_iterator(events.begin()),
+                         std::make_move_iterator(events.end()));
+    return;
+  }
+
+  std::vector<uint64_t> event_sizes_bytes;
+  event_sizes_bytes.reserve(events.size());
+  uint64_t events_size_bytes = 0;
+  for (const ClientCaptureEvent& event : events) {
+    event_sizes_bytes.push_back(event.ByteSizeLong());
+    events_size_bytes += event_sizes_bytes.back();
+  }
+
+  absl::MutexLock lock{&event_buffer_mutex_};
+  if (overflow_policy_ == CaptureEventBufferOverflowPolicy::kThrottleProducers) {
+    WaitForRoom(events_size_bytes);
+    if (stop_requested_) {
+      return;
+    }
+    event_buffer_.insert(event_buffer_.end(), std::make_move_iterator(events.begin()),
+                         std::make_move_iterator(events.end()));
+    event_buffer_size_bytes_ += events_size_bytes;
+    return;
+  }
+
+  if (stop_requested_) {
+    return;
+  }
+  for (size_t i = 0; i < events.size(); ++i) {
+    ClientCaptureEvent::EventCase event_case = events[i].event_case();
+    if (!IsBelowLimitForPriority(event_sizes_bytes[i], GetCaptureEventPriority(event_case))) {
+      ++dropped_event_counts_[event_case];
+      continue;
+    }
+    event_buffer_.emplace_back(std::move(events[i]));
+    event_buffer_size_bytes_ += event_sizes_bytes[i];
+  }
+}
+
+void SenderThreadCaptureEventBuffer::StopAndWait() {
+  CHECK(sender_thread_.joinable());
+  {
+    // Protect stop_requested_ with event_buffer_mutex_ so that we can use stop_requested_
+    // in Conditions for Await/LockWhen (specifically, in SenderThread and WaitForRoom).
+    absl::MutexLock lock{&event_buffer_mutex_};
+    stop_requested_ = true;
+  }
+  sender_thread_.join();
+}
+
+std::optional<ClientCaptureEvent> SenderThreadCaptureEventBuffer::CreateOverflowWarningEvent() {
+  std::vector<std::string> messages;
+  if (!dropped_event_counts_.empty()) {
+    std::vector<std::string> dropped_events;
+    for (const auto& [event_case, count] : dropped_event_counts_) {
+      const google::protobuf::FieldDescriptor* field =
+          ClientCaptureEvent::descriptor()->FindFieldByNumber(static_cast<int>(event_case));
+      dropped_events.emplace_back(
+          absl::StrFormat("%u %s", count, field != nullptr ? field->name() : "unknown"));
+    }
+    messages.emplace_back(
+        absl::StrFormat("OrbitService dropped %s events", absl::StrJoin(dropped_events, ", ")));
+    dropped_event_counts_.clear();
+  }
+  if (throttled_duration_ > absl::ZeroDuration()) {
+    messages.emplace_back(absl::StrFormat("OrbitService delayed the producers of events by %.3f s",
+                                          absl::ToDoubleSeconds(throttled_duration_)));
+    throttled_duration_ = absl::ZeroDuration();
+  }
+  if (messages.empty()) {
+    return std::nullopt;
+  }
+
+  const std::string message = absl::StrFormat(
+      "%s because its buffer of events to send to the client reached its size limit of %u bytes.",
+      absl::StrJoin(messages, " and "), max_size_bytes_);
+  ERROR("%s", message);
+  ClientCaptureEvent event;
+  orbit_grpc_protos::WarningEvent* warning_event = event.mutable_warning_event();
+  warning_event->set_timestamp_ns(orbit_base::CaptureTimestampNs());
+  warning_event->set_message(message);
+  return event;
+}
+
+void SenderThreadCaptureEventBuffer::SenderThread() {
+  pthread_setname_np(pthread_self(), "SenderThread");
+  constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
+  // This should be lower than kMaxEventsPerResponse in GrpcCaptureEventSender::SendEvents
+  // as a few more events are likely to arrive after the condition becomes true.
+  constexpr uint64_t kSendEventCountInterval = 5000;
+  constexpr absl::Duration kOverflowWarningInterval = absl::Seconds(1);
+
+  absl::Time last_overflow_warning_time = absl::Now();
+  bool stopped = false;
+  while (!stopped) {
+    ORBIT_SCOPE("SenderThread iteration");
+    event_buffer_mutex_.LockWhenWithTimeout(
+        absl::Condition(
+            +[](SenderThreadCaptureEventBuffer* self)
+                 ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->event_buffer_mutex_) {
+                   return self->event_buffer_.size() >= kSendEventCountInterval ||
+                          self->stop_requested_;
+                 },
+            this),
+        kSendTimeInterval);
+    if (stop_requested_) {
+      stopped = true;
+    }
+    std::vector<ClientCaptureEvent> buffered_events = std::move(event_buffer_);
+    event_buffer_.clear();
+    // The events still take memory until they have been sent.
+    sending_size_bytes_ = event_buffer_size_bytes_;
+    event_buffer_size_bytes_ = 0;
+    if (const absl::Time now = absl::Now();
+        stopped || now - last_overflow_warning_time >= kOverflowWarningInterval) {
+      std::optional<ClientCaptureEvent> warning_event = CreateOverflowWarningEvent();
+      if (warning_event.has_value()) {
+        buffered_events.emplace_back(std::move(warning_event.value()));
+        last_overflow_warning_time = now;
+      }
+    }
+    event_buffer_mutex_.Unlock();
+
+    capture_event_sender_->SendEvents(std::move(buffered_events));
+
+    if (max_size_bytes_ != 0) {
+      absl::MutexLock lock{&event_buffer_mutex_};
+      sending_size_bytes_ = 0;
+    }
+  }
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
+#define ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
+
+#include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "CaptureEventPriority.h"
+#include "CaptureEventSender.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// What SenderThreadCaptureEventBuffer does with new events when its memory limit is reached.
+enum class CaptureEventBufferOverflowPolicy {
+  // Events of each CaptureEventPriority can only fill the buffer up to a fraction of the limit, so
+  // that as the buffer fills, lower-priority events are dropped first. kEssential events are never
+  // dropped.
+  kDropLowPriorityEvents,
+  // AddEvent and AddEvents block until enough events have been sent.
+  kThrottleProducers,
+};
+
+// Parses "drop" or "throttle".
+[[nodiscard]] std::optional<CaptureEventBufferOverflowPolicy> ParseCaptureEventBufferOverflowPolicy(
+    std::string_view policy);
+
+// This CaptureEventBuffer stores the events in a vector protected by a mutex, which a dedicated
+// thread periodically empties and passes to the CaptureEventSender.
+// If max_size_bytes is not zero, it bounds the serialized size of the events that have been added
+// but not completely sent yet, so that a slow client can't make the service run out of memory.
+// The overflow_policy decides what happens to events that would exceed the limit. The events that
+// are dropped and the time producers are throttled for are reported with WarningEvents.
+class SenderThreadCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  explicit SenderThreadCaptureEventBuffer(
+      CaptureEventSender* event_sender, uint64_t max_size_bytes = 0,
+      CaptureEventBufferOverflowPolicy overflow_policy =
+          CaptureEventBufferOverflowPolicy::kDropLowPriorityEvents);
+  ~SenderThreadCaptureEventBuffer() override;
+
+  void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
+  void AddEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) override;
+
+  // Sends the remaining events and stops the sending thread. Events added from now on are dropped.
+  void StopAndWait();
+
+ private:
+  void SenderThread();
+  [[nodiscard]] bool IsBelowLimitForPriority(uint64_t event_size_bytes,
+                                             CaptureEventPriority priority) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(event_buffer_mutex_);
+  void WaitForRoom(uint64_t size_bytes) ABSL_EXCLUSIVE_LOCKS_REQUIRED(event_buffer_mutex_);
+  [[nodiscard]] std::optional<orbit_grpc_protos::ClientCaptureEvent> CreateOverflowWarningEvent()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(event_buffer_mutex_);
+
+  CaptureEventSender* capture_event_sender_;
+  const uint64_t max_size_bytes_;
+  const CaptureEventBufferOverflowPolicy overflow_policy_;
+  std::thread sender_thread_;
+
+  absl::Mutex event_buffer_mutex_;
+  std::vector<orbit_grpc_protos::ClientCaptureEvent> event_buffer_
+      ABSL_GUARDED_BY(event_buffer_mutex_);
+  bool stop_requested_ ABSL_GUARDED_BY(event_buffer_mutex_) = false;
+  // Only tracked if max_size_bytes_ is not zero.
+  uint64_t event_buffer_size_bytes_ ABSL_GUARDED_BY(event_buffer_mutex_) = 0;
+  uint64_t sending_size_bytes_ ABSL_GUARDED_BY(event_buffer_mutex_) = 0;
+  // Since the last WarningEvent.
+  std::map<orbit_grpc_protos::ClientCaptureEvent::EventCase, uint64_t> dropped_event_counts_
+      ABSL_GUARDED_BY(event_buffer_mutex_);
+  absl::Duration throttled_duration_ ABSL_GUARDED_BY(event_buffer_mutex_);
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
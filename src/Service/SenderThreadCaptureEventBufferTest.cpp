@@ -0,0 +1,181 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/synchronization/mutex.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "SenderThreadCaptureEventBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+// Simulates a slow client: SendEvents doesn't return until Unblock is called.
+class BlockingFakeCaptureEventSender final : public CaptureEventSender {
+ public:
+  void SendEvents(std::vector<ClientCaptureEvent>&& events) override {
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(+[](bool* blocked) { return !*blocked; }, &blocked_));
+    for (ClientCaptureEvent& event : events) {
+      sent_events_.emplace_back(std::move(event));
+    }
+  }
+
+  void Unblock() {
+    absl::MutexLock lock{&mutex_};
+    blocked_ = false;
+  }
+
+  [[nodiscard]] std::vector<ClientCaptureEvent> GetSentEvents() {
+    absl::MutexLock lock{&mutex_};
+    return sent_events_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  bool blocked_ ABSL_GUARDED_BY(mutex_) = true;
+  std::vector<ClientCaptureEvent> sent_events_ ABSL_GUARDED_BY(mutex_);
+};
+
+// The events of each type have the same size, so that the limits can be expressed in events.
+ClientCaptureEvent CreateSchedulingSlice() {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_tid(42);
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(1'000'000);
+  return event;
+}
+
+ClientCaptureEvent CreateFunctionCall() {
+  ClientCaptureEvent event;
+  event.mutable_function_call()->set_tid(42);
+  event.mutable_function_call()->set_function_id(1);
+  event.mutable_function_call()->set_end_timestamp_ns(1'000'000);
+  return event;
+}
+
+ClientCaptureEvent CreateInternedString() {
+  ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(1);
+  event.mutable_interned_string()->set_intern("string");
+  return event;
+}
+
+uint64_t CountEvents(const std::vector<ClientCaptureEvent>& events,
+                     ClientCaptureEvent::EventCase event_case) {
+  return std::count_if(events.begin(), events.end(), [event_case](const ClientCaptureEvent& event) {
+    return event.event_case() == event_case;
+  });
+}
+
+}  // namespace
+
+TEST(SenderThreadCaptureEventBuffer, ParseCaptureEventBufferOverflowPolicy) {
+  EXPECT_EQ(ParseCaptureEventBufferOverflowPolicy("drop"),
+            CaptureEventBufferOverflowPolicy::kDropLowPriorityEvents);
+  EXPECT_EQ(ParseCaptureEventBufferOverflowPolicy("throttle"),
+            CaptureEventBufferOverflowPolicy::kThrottleProducers);
+  EXPECT_FALSE(ParseCaptureEventBufferOverflowPolicy("spill").has_value());
+}
+
+TEST(SenderThreadCaptureEventBuffer, SendsAllEventsWithoutLimit) {
+  BlockingFakeCaptureEventSender sender;
+  SenderThreadCaptureEventBuffer buffer{&sender};
+  for (int i = 0; i < 1000; ++i) {
+    buffer.AddEvent(CreateSchedulingSlice());
+  }
+  sender.Unblock();
+  buffer.StopAndWait();
+
+  std::vector<ClientCaptureEvent> sent_events = sender.GetSentEvents();
+  EXPECT_EQ(sent_events.size(), 1000);
+  EXPECT_EQ(CountEvents(sent_events, ClientCaptureEvent::kWarningEvent), 0);
+}
+
+TEST(SenderThreadCaptureEventBuffer, DropsLowPriorityEventsFirst) {
+  const uint64_t scheduling_slice_size = CreateSchedulingSlice().ByteSizeLong();
+  const uint64_t function_call_size = CreateFunctionCall().ByteSizeLong();
+  const uint64_t max_size_bytes = 100 * scheduling_slice_size;
+
+  BlockingFakeCaptureEventSender sender;
+  SenderThreadCaptureEventBuffer buffer{&sender, max_size_bytes,
+                                        CaptureEventBufferOverflowPolicy::kDropLowPriorityEvents};
+
+  // Scheduling slices can only fill half of the buffer.
+  for (int i = 0; i < 100; ++i) {
+    buffer.AddEvent(CreateSchedulingSlice());
+  }
+  // Function calls can fill the rest.
+  std::vector<ClientCaptureEvent> function_calls;
+  for (int i = 0; i < 100; ++i) {
+    function_calls.emplace_back(CreateFunctionCall());
+  }
+  buffer.AddEvents(std::move(function_calls));
+  // Essential events are never dropped.
+  for (int i = 0; i < 10; ++i) {
+    buffer.AddEvent(CreateInternedString());
+  }
+
+  sender.Unblock();
+  buffer.StopAndWait();
+
+  std::vector<ClientCaptureEvent> sent_events = sender.GetSentEvents();
+  EXPECT_EQ(CountEvents(sent_events, ClientCaptureEvent::kSchedulingSlice), 50);
+  const uint64_t expected_function_call_count =
+      (max_size_bytes - 50 * scheduling_slice_size) / function_call_size;
+  EXPECT_EQ(CountEvents(sent_events, ClientCaptureEvent::kFunctionCall),
+            expected_function_call_count);
+  EXPECT_EQ(CountEvents(sent_events, ClientCaptureEvent::kInternedString), 10);
+
+  ASSERT_EQ(CountEvents(sent_events, ClientCaptureEvent::kWarningEvent), 1);
+  const std::string& message = sent_events.back().warning_event().message();
+  EXPECT_THAT(message, testing::HasSubstr("50 scheduling_slice"));
+  const uint64_t dropped_function_call_count = 100 - expected_function_call_count;
+  EXPECT_THAT(message,
+              testing::HasSubstr(absl::StrFormat("%u function_call", dropped_function_call_count)));
+}
+
+TEST(SenderThreadCaptureEventBuffer, ThrottlesProducersUntilEventsAreSent) {
+  BlockingFakeCaptureEventSender sender;
+  SenderThreadCaptureEventBuffer buffer{&sender, 10 * CreateSchedulingSlice().ByteSizeLong(),
+                                        CaptureEventBufferOverflowPolicy::kThrottleProducers};
+
+  constexpr int kEventCount = 30;
+  std::atomic<bool> producer_done = false;
+  std::thread producer{[&buffer, &producer_done] {
+    for (int i = 0; i < kEventCount; ++i) {
+      buffer.AddEvent(CreateSchedulingSlice());
+    }
+    producer_done = true;
+  }};
+
+  // Nothing can be sent, so the producer can't add more than ten events.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(producer_done);
+
+  sender.Unblock();
+  producer.join();
+  buffer.StopAndWait();
+
+  std::vector<ClientCaptureEvent> sent_events = sender.GetSentEvents();
+  EXPECT_EQ(CountEvents(sent_events, ClientCaptureEvent::kSchedulingSlice), kEventCount);
+  ASSERT_EQ(CountEvents(sent_events, ClientCaptureEvent::kWarningEvent), 1);
+  EXPECT_THAT(sent_events.back().warning_event().message(),
+              testing::HasSubstr("delayed the producers"));
+}
+
+}  // namespace orbit_service
@@ -11,9 +11,12 @@
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_join.h>
 #include <absl/strings/str_split.h>
+#include <sched.h>
+#include <sys/resource.h>
 #include <sys/uio.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <filesystem>
 #include <iosfwd>
 #include <map>
@@ -32,6 +35,7 @@
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/SafeStrerror.h"
 #include "absl/strings/str_format.h"
 #include "module.pb.h"
 
@@ -109,6 +113,14 @@ ErrorMessageOr<std::vector<orbit_grpc_protos::TracepointInfo>> ReadTracepoints()
 }
 
 std::optional<Jiffies> GetCumulativeCpuTimeFromProcess(pid_t pid) noexcept {
+  std::optional<ProcessCpuTimeAndStartTime> cpu_time_and_start_time =
+      GetCumulativeCpuTimeAndStartTimeFromProcess(pid);
+  if (!cpu_time_and_start_time.has_value()) return std::nullopt;
+  return cpu_time_and_start_time->cpu_time;
+}
+
+std::optional<ProcessCpuTimeAndStartTime> GetCumulativeCpuTimeAndStartTimeFromProcess(
+    pid_t pid) noexcept {
   const auto stat = std::filesystem::path{"/proc"} / std::to_string(pid) / "stat";
 
   // /proc/[pid]/stat looks like so (example - all in one line):
@@ -117,7 +129,8 @@ std::optional<Jiffies> GetCumulativeCpuTimeFromProcess(pid_t pid) noexcept {
   // 0 0 0 0 0 94702955928880 94702955930112 94702967197696 140735167083224 140735167083235
   // 140735167083235 140735167086569 0
   //
-  // This code reads field 13 (user time) and 14 (kernel time) to determine the process's cpu usage.
+  // This code reads field 13 (user time) and 14 (kernel time) to determine the process's cpu usage,
+  // and field 21 for the start time.
   // Older kernels might have less fields than in the example. Over time fields had been added to
   // the end, but field indexes stayed stable.
 
@@ -159,8 +172,10 @@ std::optional<Jiffies> GetCumulativeCpuTimeFromProcess(pid_t pid) noexcept {
   constexpr size_t kUtimeIndexExclPidComm = kUtimeIndex - kCommIndex - 1;
   constexpr size_t kStimeIndex = 14;
   constexpr size_t kStimeIndexExclPidComm = kStimeIndex - kCommIndex - 1;
+  constexpr size_t kStartTimeIndex = 21;
+  constexpr size_t kStartTimeIndexExclPidComm = kStartTimeIndex - kCommIndex - 1;
 
-  if (fields_excl_pid_comm.size() <= std::max(kUtimeIndex, kStimeIndex)) {
+  if (fields_excl_pid_comm.size() <= std::max({kUtimeIndex, kStimeIndex, kStartTimeIndex})) {
     return std::nullopt;
   }
 
@@ -174,7 +189,12 @@ std::optional<Jiffies> GetCumulativeCpuTimeFromProcess(pid_t pid) noexcept {
     return std::nullopt;
   }
 
-  return Jiffies{utime + stime};
+  uint64_t start_time{};
+  if (!absl::SimpleAtoi(fields_excl_pid_comm[kStartTimeIndexExclPidComm], &start_time)) {
+    return std::nullopt;
+  }
+
+  return ProcessCpuTimeAndStartTime{Jiffies{utime + stime}, start_time};
 }
 
 std::optional<TotalCpuTime> GetCumulativeTotalCpuTime() noexcept {
@@ -420,4 +440,48 @@ bool ReadProcessMemory(int32_t pid, uintptr_t address, void* buffer, uint64_t si
   return *num_bytes_read == size;
 }
 
+ErrorMessageOr<std::vector<int>> ParseCpuList(std::string_view cpu_list) {
+  std::vector<int> cpus;
+  for (std::string_view range : absl::StrSplit(cpu_list, ',', absl::SkipWhitespace())) {
+    std::vector<std::string_view> bounds = absl::StrSplit(range, '-');
+    int first = 0;
+    int last = 0;
+    if (bounds.size() > 2 || !absl::SimpleAtoi(bounds.front(), &first) ||
+        !absl::SimpleAtoi(bounds.back(), &last)) {
+      return ErrorMessage(absl::StrFormat("Invalid CPU range \"%s\"", range));
+    }
+    if (first < 0 || last < first || last >= CPU_SETSIZE) {
+      return ErrorMessage(absl::StrFormat("Invalid CPU range \"%s\"", range));
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    return ErrorMessage(absl::StrFormat("No CPU in \"%s\"", cpu_list));
+  }
+  return cpus;
+}
+
+ErrorMessageOr<void> ConstrainCurrentThreadAndFutureThreads(const std::vector<int>& cpus,
+                                                            std::optional<int> nice) {
+  if (!cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+      return ErrorMessage(
+          absl::StrFormat("Unable to set the CPU affinity: %s", SafeStrerror(errno)));
+    }
+  }
+  // With PRIO_PROCESS and 0, setpriority applies to the calling thread only on Linux.
+  if (nice.has_value() && setpriority(PRIO_PROCESS, 0, nice.value()) != 0) {
+    return ErrorMessage(absl::StrFormat("Unable to set the nice value to %d: %s", nice.value(),
+                                        SafeStrerror(errno)));
+  }
+  return outcome::success();
+}
+
 }  // namespace orbit_service::utils
@@ -15,6 +15,7 @@
 #include <optional>
 #include <outcome.hpp>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -40,8 +41,18 @@ struct TotalCpuTime {
   size_t cpus;
 };
 
+struct ProcessCpuTimeAndStartTime {
+  Jiffies cpu_time;
+  // The time the process started after system boot, in clock ticks. Together with the pid, this
+  // identifies a process, as pids are reused.
+  uint64_t start_time;
+};
+
 std::optional<TotalCpuTime> GetCumulativeTotalCpuTime() noexcept;
 std::optional<Jiffies> GetCumulativeCpuTimeFromProcess(pid_t pid) noexcept;
+// Like GetCumulativeCpuTimeFromProcess, but also returns the start time, read from the same file.
+std::optional<ProcessCpuTimeAndStartTime> GetCumulativeCpuTimeAndStartTimeFromProcess(
+    pid_t pid) noexcept;
 
 ErrorMessageOr<std::filesystem::path> FindSymbolsFilePath(
     const std::filesystem::path& module_path,
@@ -51,6 +62,16 @@ ErrorMessageOr<std::filesystem::path> FindSymbolsFilePath(
         "/srv/game/assets/debug_symbols/"}) noexcept;
 bool ReadProcessMemory(int32_t pid, uintptr_t address, void* buffer, uint64_t size,
                        uint64_t* num_bytes_read) noexcept;
+
+// Parses a list of CPUs in the format of cpuset.cpus, for example "0-2,7,12-14".
+ErrorMessageOr<std::vector<int>> ParseCpuList(std::string_view cpu_list);
+
+// Restricts the calling thread to `cpus`, if not empty, and sets its nice value to `nice`, if
+// present. Threads inherit both from the thread that creates them, so calling this before the
+// service starts any thread applies to all the threads of the service, and to the processes it
+// spawns, while leaving the profiled processes alone.
+ErrorMessageOr<void> ConstrainCurrentThreadAndFutureThreads(const std::vector<int>& cpus,
+                                                            std::optional<int> nice);
 }  // namespace orbit_service::utils
 
 #endif  // ORBIT_SERVICE_SERVICE_UTILS_H_
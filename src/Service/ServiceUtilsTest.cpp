@@ -4,6 +4,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sched.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -14,6 +15,7 @@
 #include <optional>
 #include <outcome.hpp>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "OrbitBase/ExecutablePath.h"
@@ -61,6 +63,23 @@ TEST(ServiceUtils, GetCumulativeCpuTimeFromProcess) {
   ASSERT_TRUE(jiffies2->value <= total_cpu_time->jiffies.value);
 }
 
+TEST(ServiceUtils, GetCumulativeCpuTimeAndStartTimeFromProcess) {
+  const auto& cpu_time_and_start_time1 = GetCumulativeCpuTimeAndStartTimeFromProcess(getpid());
+  ASSERT_TRUE(cpu_time_and_start_time1.has_value());
+
+  const auto& cpu_time_and_start_time2 = GetCumulativeCpuTimeAndStartTimeFromProcess(getpid());
+  ASSERT_TRUE(cpu_time_and_start_time2.has_value());
+
+  EXPECT_GE(cpu_time_and_start_time2->cpu_time.value, cpu_time_and_start_time1->cpu_time.value);
+  EXPECT_EQ(cpu_time_and_start_time2->start_time, cpu_time_and_start_time1->start_time);
+
+  // The parent process started no later than us.
+  const auto& parent_cpu_time_and_start_time =
+      GetCumulativeCpuTimeAndStartTimeFromProcess(getppid());
+  ASSERT_TRUE(parent_cpu_time_and_start_time.has_value());
+  EXPECT_LE(parent_cpu_time_and_start_time->start_time, cpu_time_and_start_time1->start_time);
+}
+
 TEST(ServiceUtils, FindSymbolsFilePath) {
   const auto executable_path = orbit_base::GetExecutableDir();
   const Path test_path = executable_path / "testdata";
@@ -170,4 +189,32 @@ TEST(ServiceUtils, NamesTracepoints) {
   }
 }
 
+TEST(ServiceUtils, ParseCpuList) {
+  ErrorMessageOr<std::vector<int>> cpus = ParseCpuList("0-2,7,12-14");
+  ASSERT_FALSE(cpus.has_error()) << cpus.error().message();
+  EXPECT_THAT(cpus.value(), testing::ElementsAre(0, 1, 2, 7, 12, 13, 14));
+
+  cpus = ParseCpuList("3");
+  ASSERT_FALSE(cpus.has_error()) << cpus.error().message();
+  EXPECT_THAT(cpus.value(), testing::ElementsAre(3));
+
+  EXPECT_TRUE(ParseCpuList("").has_error());
+  EXPECT_TRUE(ParseCpuList("a").has_error());
+  EXPECT_TRUE(ParseCpuList("3-1").has_error());
+  EXPECT_TRUE(ParseCpuList("1-2-3").has_error());
+  EXPECT_TRUE(ParseCpuList("-1").has_error());
+}
+
+TEST(ServiceUtils, ConstrainCurrentThreadAndFutureThreads) {
+  // Runs in a separate thread, so that the test doesn't change the affinity of the test runner.
+  std::thread thread([] {
+    ErrorMessageOr<void> result = ConstrainCurrentThreadAndFutureThreads({0}, std::nullopt);
+    ASSERT_FALSE(result.has_error()) << result.error().message();
+    std::thread child([] { EXPECT_EQ(sched_getcpu(), 0); });
+    child.join();
+    EXPECT_EQ(sched_getcpu(), 0);
+  });
+  thread.join();
+}
+
 }  // namespace orbit_service::utils
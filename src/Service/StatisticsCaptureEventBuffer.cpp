@@ -0,0 +1,143 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "StatisticsCaptureEventBuffer.h"
+
+#include <absl/time/time.h>
+#include <pthread.h>
+
+#include <utility>
+
+#include "ClientData/FunctionStatsUtils.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+
+namespace orbit_service {
+
+using orbit_client_protos::FunctionStats;
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CaptureStatisticsSummary;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FunctionCall;
+
+StatisticsCaptureEventBuffer::StatisticsCaptureEventBuffer(CaptureEventBuffer* next_buffer,
+                                                           uint64_t summary_interval_ns)
+    : next_buffer_{next_buffer},
+      summary_interval_ns_{summary_interval_ns},
+      summary_begin_timestamp_ns_{orbit_base::CaptureTimestampNs()} {
+  CHECK(next_buffer_ != nullptr);
+  CHECK(summary_interval_ns_ > 0);
+  summary_thread_ = std::thread{[this] { SummaryThread(); }};
+}
+
+StatisticsCaptureEventBuffer::~StatisticsCaptureEventBuffer() {
+  CHECK(!summary_thread_.joinable());
+}
+
+void StatisticsCaptureEventBuffer::AddEvent(ClientCaptureEvent&& event) {
+  {
+    absl::MutexLock lock{&mutex_};
+    if (!stop_requested_ && !AggregateOrKeepEvent(event)) {
+      return;
+    }
+  }
+  next_buffer_->AddEvent(std::move(event));
+}
+
+void StatisticsCaptureEventBuffer::AddEvents(std::vector<ClientCaptureEvent>&& events) {
+  std::vector<ClientCaptureEvent> kept_events;
+  {
+    absl::MutexLock lock{&mutex_};
+    if (stop_requested_) {
+      kept_events = std::move(events);
+    } else {
+      for (ClientCaptureEvent& event : events) {
+        if (AggregateOrKeepEvent(event)) {
+          kept_events.emplace_back(std::move(event));
+        }
+      }
+    }
+  }
+  if (!kept_events.empty()) {
+    next_buffer_->AddEvents(std::move(kept_events));
+  }
+}
+
+bool StatisticsCaptureEventBuffer::AggregateOrKeepEvent(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kFunctionCall: {
+      const FunctionCall& function_call = event.function_call();
+      orbit_client_data::AddFunctionCallToStats(function_call.duration_ns(),
+                                                &function_stats_[function_call.function_id()]);
+      return false;
+    }
+    case ClientCaptureEvent::kCallstackSample: {
+      const CallstackSample& callstack_sample = event.callstack_sample();
+      // Off-CPU and memory callstacks are not samples of where the time is spent.
+      if (callstack_sample.off_cpu_duration_ns() != 0 ||
+          callstack_sample.memory_event_type() != CallstackSample::kNoMemoryEvent) {
+        return true;
+      }
+      ++callstack_sample_counts_[{callstack_sample.pid(), callstack_sample.tid(),
+                                  callstack_sample.callstack_id()}];
+      return false;
+    }
+    default:
+      return true;
+  }
+}
+
+ClientCaptureEvent StatisticsCaptureEventBuffer::TakeSummary(uint64_t end_timestamp_ns) {
+  ClientCaptureEvent event;
+  CaptureStatisticsSummary* summary = event.mutable_capture_statistics_summary();
+  summary->set_duration_ns(end_timestamp_ns - summary_begin_timestamp_ns_);
+  summary->set_end_timestamp_ns(end_timestamp_ns);
+  for (const auto& [function_id, stats] : function_stats_) {
+    orbit_grpc_protos::FunctionCallStatistics* function_call_statistics =
+        summary->add_function_call_statistics();
+    function_call_statistics->set_function_id(function_id);
+    function_call_statistics->set_count(stats.count());
+    function_call_statistics->set_total_time_ns(stats.total_time_ns());
+    function_call_statistics->set_min_ns(stats.min_ns());
+    function_call_statistics->set_max_ns(stats.max_ns());
+    *function_call_statistics->mutable_duration_histogram() = stats.duration_histogram();
+  }
+  for (const auto& [key, count] : callstack_sample_counts_) {
+    const auto& [pid, tid, callstack_id] = key;
+    orbit_grpc_protos::CallstackSampleCount* callstack_sample_count =
+        summary->add_callstack_sample_counts();
+    callstack_sample_count->set_pid(pid);
+    callstack_sample_count->set_tid(tid);
+    callstack_sample_count->set_callstack_id(callstack_id);
+    callstack_sample_count->set_count(count);
+  }
+  function_stats_.clear();
+  callstack_sample_counts_.clear();
+  summary_begin_timestamp_ns_ = end_timestamp_ns;
+  return event;
+}
+
+void StatisticsCaptureEventBuffer::SummaryThread() {
+  pthread_setname_np(pthread_self(), "SummaryThread");
+  const absl::Duration summary_interval = absl::Nanoseconds(summary_interval_ns_);
+  bool stopped = false;
+  while (!stopped) {
+    mutex_.LockWhenWithTimeout(absl::Condition(&stop_requested_), summary_interval);
+    stopped = stop_requested_;
+    ClientCaptureEvent summary_event = TakeSummary(orbit_base::CaptureTimestampNs());
+    mutex_.Unlock();
+    next_buffer_->AddEvent(std::move(summary_event));
+  }
+}
+
+void StatisticsCaptureEventBuffer::StopAndSendSummary() {
+  CHECK(summary_thread_.joinable());
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  summary_thread_.join();
+}
+
+}  // namespace orbit_service
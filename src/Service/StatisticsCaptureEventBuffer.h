@@ -0,0 +1,64 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_STATISTICS_CAPTURE_EVENT_BUFFER_H_
+#define ORBIT_SERVICE_STATISTICS_CAPTURE_EVENT_BUFFER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstdint>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "capture.pb.h"
+#include "capture_data.pb.h"
+
+namespace orbit_service {
+
+// This CaptureEventBuffer aggregates the FunctionCalls and the CallstackSamples instead of passing
+// them on to the next CaptureEventBuffer, and passes on a CaptureStatisticsSummary of the calls and
+// samples added in the last summary_interval_ns nanoseconds every summary_interval_ns nanoseconds.
+// All other events are passed on as they are, in particular the InternedCallstacks that the
+// summaries refer to.
+class StatisticsCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  StatisticsCaptureEventBuffer(CaptureEventBuffer* next_buffer, uint64_t summary_interval_ns);
+  ~StatisticsCaptureEventBuffer() override;
+
+  void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
+  void AddEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) override;
+
+  // Passes on a last summary and stops the summary thread. Events added from now on are passed on
+  // as they are.
+  void StopAndSendSummary();
+
+ private:
+  // Returns false if the event was aggregated, and true if it still needs to be passed on.
+  [[nodiscard]] bool AggregateOrKeepEvent(const orbit_grpc_protos::ClientCaptureEvent& event)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] orbit_grpc_protos::ClientCaptureEvent TakeSummary(uint64_t end_timestamp_ns)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void SummaryThread();
+
+  CaptureEventBuffer* next_buffer_;
+  const uint64_t summary_interval_ns_;
+  std::thread summary_thread_;
+
+  absl::Mutex mutex_;
+  // By function_id.
+  absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionStats> function_stats_
+      ABSL_GUARDED_BY(mutex_);
+  // By pid, tid and callstack_id.
+  absl::flat_hash_map<std::tuple<int32_t, int32_t, uint64_t>, uint64_t> callstack_sample_counts_
+      ABSL_GUARDED_BY(mutex_);
+  uint64_t summary_begin_timestamp_ns_ ABSL_GUARDED_BY(mutex_);
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_STATISTICS_CAPTURE_EVENT_BUFFER_H_
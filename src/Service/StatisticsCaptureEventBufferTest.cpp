@@ -0,0 +1,149 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "StatisticsCaptureEventBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CaptureStatisticsSummary;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+class FakeCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  void AddEvent(ClientCaptureEvent&& event) override {
+    absl::MutexLock lock{&mutex_};
+    events_.emplace_back(std::move(event));
+  }
+
+  [[nodiscard]] std::vector<ClientCaptureEvent> TakeEvents() {
+    absl::MutexLock lock{&mutex_};
+    std::vector<ClientCaptureEvent> events = std::move(events_);
+    events_.clear();
+    return events;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<ClientCaptureEvent> events_ ABSL_GUARDED_BY(mutex_);
+};
+
+ClientCaptureEvent CreateFunctionCall(uint64_t function_id, uint64_t duration_ns) {
+  ClientCaptureEvent event;
+  event.mutable_function_call()->set_function_id(function_id);
+  event.mutable_function_call()->set_duration_ns(duration_ns);
+  return event;
+}
+
+ClientCaptureEvent CreateCallstackSample(int32_t tid, uint64_t callstack_id) {
+  ClientCaptureEvent event;
+  event.mutable_callstack_sample()->set_pid(1);
+  event.mutable_callstack_sample()->set_tid(tid);
+  event.mutable_callstack_sample()->set_callstack_id(callstack_id);
+  return event;
+}
+
+ClientCaptureEvent CreateInternedCallstack(uint64_t key) {
+  ClientCaptureEvent event;
+  event.mutable_interned_callstack()->set_key(key);
+  return event;
+}
+
+// A summary interval long enough for the only summary to be the one sent when stopping.
+constexpr uint64_t kLongSummaryIntervalNs = 3'600'000'000'000;
+
+}  // namespace
+
+TEST(StatisticsCaptureEventBuffer, AggregatesFunctionCallsAndCallstackSamples) {
+  FakeCaptureEventBuffer next_buffer;
+  StatisticsCaptureEventBuffer buffer{&next_buffer, kLongSummaryIntervalNs};
+  buffer.AddEvents({CreateInternedCallstack(7), CreateFunctionCall(1, 100),
+                    CreateFunctionCall(1, 300), CreateFunctionCall(2, 50)});
+  buffer.AddEvent(CreateCallstackSample(10, 7));
+  buffer.AddEvent(CreateCallstackSample(10, 7));
+  buffer.AddEvent(CreateCallstackSample(11, 7));
+
+  std::vector<ClientCaptureEvent> events = next_buffer.TakeEvents();
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].interned_callstack().key(), 7);
+
+  buffer.StopAndSendSummary();
+  events = next_buffer.TakeEvents();
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].event_case(), ClientCaptureEvent::kCaptureStatisticsSummary);
+  const CaptureStatisticsSummary& summary = events[0].capture_statistics_summary();
+  EXPECT_GT(summary.end_timestamp_ns(), 0);
+
+  ASSERT_EQ(summary.function_call_statistics_size(), 2);
+  for (const auto& function_call_statistics : summary.function_call_statistics()) {
+    if (function_call_statistics.function_id() == 1) {
+      EXPECT_EQ(function_call_statistics.count(), 2);
+      EXPECT_EQ(function_call_statistics.total_time_ns(), 400);
+      EXPECT_EQ(function_call_statistics.min_ns(), 100);
+      EXPECT_EQ(function_call_statistics.max_ns(), 300);
+      EXPECT_FALSE(function_call_statistics.duration_histogram().empty());
+    } else {
+      EXPECT_EQ(function_call_statistics.function_id(), 2);
+      EXPECT_EQ(function_call_statistics.count(), 1);
+    }
+  }
+
+  ASSERT_EQ(summary.callstack_sample_counts_size(), 2);
+  for (const auto& callstack_sample_count : summary.callstack_sample_counts()) {
+    EXPECT_EQ(callstack_sample_count.callstack_id(), 7);
+    EXPECT_EQ(callstack_sample_count.count(), callstack_sample_count.tid() == 10 ? 2 : 1);
+  }
+}
+
+TEST(StatisticsCaptureEventBuffer, PassesOnOffCpuCallstacks) {
+  FakeCaptureEventBuffer next_buffer;
+  StatisticsCaptureEventBuffer buffer{&next_buffer, kLongSummaryIntervalNs};
+  ClientCaptureEvent off_cpu_callstack = CreateCallstackSample(10, 7);
+  off_cpu_callstack.mutable_callstack_sample()->set_off_cpu_duration_ns(1000);
+  buffer.AddEvent(std::move(off_cpu_callstack));
+
+  std::vector<ClientCaptureEvent> events = next_buffer.TakeEvents();
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].callstack_sample().off_cpu_duration_ns(), 1000);
+  buffer.StopAndSendSummary();
+}
+
+TEST(StatisticsCaptureEventBuffer, SendsSummariesPeriodically) {
+  constexpr std::chrono::milliseconds kSummaryInterval{50};
+  FakeCaptureEventBuffer next_buffer;
+  StatisticsCaptureEventBuffer buffer{&next_buffer,
+                                      std::chrono::nanoseconds{kSummaryInterval}.count()};
+  buffer.AddEvent(CreateFunctionCall(1, 100));
+  std::this_thread::sleep_for(3 * kSummaryInterval);
+  buffer.AddEvent(CreateFunctionCall(1, 100));
+  buffer.StopAndSendSummary();
+
+  std::vector<ClientCaptureEvent> events = next_buffer.TakeEvents();
+  ASSERT_GE(events.size(), 3);
+  uint64_t call_count = 0;
+  uint64_t previous_end_timestamp_ns = 0;
+  for (const ClientCaptureEvent& event : events) {
+    ASSERT_EQ(event.event_case(), ClientCaptureEvent::kCaptureStatisticsSummary);
+    const CaptureStatisticsSummary& summary = event.capture_statistics_summary();
+    EXPECT_GT(summary.end_timestamp_ns(), previous_end_timestamp_ns);
+    previous_end_timestamp_ns = summary.end_timestamp_ns();
+    for (const auto& function_call_statistics : summary.function_call_statistics()) {
+      call_count += function_call_statistics.count();
+    }
+  }
+  EXPECT_EQ(call_count, 2);
+}
+
+}  // namespace orbit_service
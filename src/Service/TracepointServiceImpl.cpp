@@ -4,7 +4,12 @@
 
 #include "TracepointServiceImpl.h"
 
+#include <absl/strings/ascii.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
+
 #include <outcome.hpp>
+#include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
@@ -15,18 +20,39 @@
 
 namespace orbit_service {
 
+using orbit_grpc_protos::TracepointInfo;
+
 grpc::Status TracepointServiceImpl::GetTracepointList(grpc::ServerContext*,
-                                                      const GetTracepointListRequest*,
+                                                      const GetTracepointListRequest* request,
                                                       GetTracepointListResponse* response) {
   LOG("Sending tracepoints");
 
-  const auto tracepoint_infos = utils::ReadTracepoints();
-  if (tracepoint_infos.has_error()) {
-    return grpc::Status(grpc::StatusCode::NOT_FOUND, tracepoint_infos.error().message());
+  absl::MutexLock lock{&mutex_};
+  const auto now = std::chrono::steady_clock::now();
+  if (!cached_tracepoint_infos_.has_value() ||
+      now - cached_tracepoint_infos_time_ > kTracepointListTimeToLive) {
+    auto tracepoint_infos = utils::ReadTracepoints();
+    if (tracepoint_infos.has_error()) {
+      cached_tracepoint_infos_.reset();
+      return grpc::Status(grpc::StatusCode::NOT_FOUND, tracepoint_infos.error().message());
+    }
+    cached_tracepoint_infos_ = std::move(tracepoint_infos.value());
+    cached_tracepoint_infos_time_ = now;
   }
 
-  *response->mutable_tracepoints() = {tracepoint_infos.value().begin(),
-                                      tracepoint_infos.value().end()};
+  const std::string filter = absl::AsciiStrToLower(request->filter());
+  if (filter.empty()) {
+    *response->mutable_tracepoints() = {cached_tracepoint_infos_->begin(),
+                                        cached_tracepoint_infos_->end()};
+    return grpc::Status::OK;
+  }
+
+  for (const TracepointInfo& tracepoint_info : cached_tracepoint_infos_.value()) {
+    const std::string full_name = absl::AsciiStrToLower(
+        absl::StrCat(tracepoint_info.category(), ":", tracepoint_info.name()));
+    if (!absl::StrContains(full_name, filter)) continue;
+    *response->add_tracepoints() = tracepoint_info;
+  }
 
   return grpc::Status::OK;
 }
@@ -5,13 +5,19 @@
 #ifndef ORBIT_TRACEPOINTSERVICEIMPL_H
 #define ORBIT_TRACEPOINTSERVICEIMPL_H
 
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <grpcpp/grpcpp.h>
 
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "services.grpc.pb.h"
 #include "services.pb.h"
+#include "tracepoint.pb.h"
 
 namespace orbit_service {
 
@@ -24,6 +30,16 @@ class TracepointServiceImpl final : public TracepointService::Service {
   [[nodiscard]] grpc::Status GetTracepointList(grpc::ServerContext* context,
                                                const GetTracepointListRequest* request,
                                                GetTracepointListResponse* response) override;
+
+ private:
+  // Enumerating tracefs takes long, as there are thousands of tracepoints, so the list is cached.
+  // Loading a kernel module can add tracepoints, hence the list is enumerated again after a while.
+  static constexpr std::chrono::seconds kTracepointListTimeToLive{30};
+
+  absl::Mutex mutex_;
+  std::optional<std::vector<orbit_grpc_protos::TracepointInfo>> cached_tracepoint_infos_
+      ABSL_GUARDED_BY(mutex_);
+  std::chrono::steady_clock::time_point cached_tracepoint_infos_time_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace orbit_service
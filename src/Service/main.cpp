@@ -7,20 +7,69 @@
 #include <atomic>
 #include <csignal>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "ContinuousProfiler.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Result.h"
 #include "OrbitService.h"
 #include "OrbitVersion/OrbitVersion.h"
+#include "ServiceUtils.h"
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
 #include "absl/flags/usage_config.h"
+#include "absl/time/time.h"
 
 ABSL_FLAG(uint64_t, grpc_port, 44765, "gRPC server port");
 
 ABSL_FLAG(bool, devmode, false, "Enable developer mode");
 
+ABSL_FLAG(uint64_t, max_capture_event_buffer_mb, 0,
+          "Maximum size in MB of the capture data waiting to be sent to the client, 0 for no limit "
+          "(not applied with the lock-free event buffer)");
+
+ABSL_FLAG(std::string, capture_event_buffer_overflow_policy, "drop",
+          "What to do with new capture data when max_capture_event_buffer_mb is reached: \"drop\" "
+          "(lowest-priority events first) or \"throttle\" (block the producers of the events)");
+
+ABSL_FLAG(std::string, service_cpus, "",
+          "Run all the threads of the service on these CPUs, in the format of cpuset.cpus (e.g. "
+          "\"0-1,6\"), to keep them away from the CPUs of the profiled process; all CPUs if empty");
+
+ABSL_FLAG(int32_t, service_nice, 0,
+          "Nice value of all the threads of the service, e.g. 19 so that they only run when the "
+          "profiled process doesn't need the CPU; unchanged if 0");
+
+ABSL_FLAG(int32_t, continuous_profiling_pid, 0,
+          "Profile the process with this pid continuously without a client, by sampling at a low "
+          "rate into rolling capture files in /var/tmp/orbit_captures/continuous, which clients "
+          "can load; disabled if 0");
+
+ABSL_FLAG(std::string, continuous_profiling_process_name, "",
+          "Profile the process with this name continuously, and wait for it if it is not running "
+          "(see --continuous_profiling_pid); disabled if empty");
+
+ABSL_FLAG(double, continuous_profiling_samples_per_second, 19,
+          "Sampling rate of continuous profiling");
+
+ABSL_FLAG(uint64_t, continuous_profiling_file_duration_minutes, 60,
+          "Duration of the capture covered by each capture file of continuous profiling");
+
+ABSL_FLAG(uint64_t, continuous_profiling_summary_interval_seconds, 60,
+          "Interval of the statistics summaries that continuous profiling saves instead of the "
+          "individual samples, 0 to save all samples");
+
+ABSL_FLAG(uint64_t, continuous_profiling_max_files, 168,
+          "Maximum number of capture files of continuous profiling, the oldest are deleted");
+
+ABSL_FLAG(uint64_t, continuous_profiling_max_total_mb, 1024,
+          "Maximum total size in MB of the capture files of continuous profiling, the oldest are "
+          "deleted");
+
 namespace {
 std::atomic<bool> exit_requested;
 
@@ -46,6 +95,53 @@ std::string GetLogFilePath() {
   return log_file_path;
 }
 
+// The threads of the service are all created after this, so they inherit the CPU affinity and the
+// nice value of the main thread.
+void ConstrainServiceThreads() {
+  std::vector<int> cpus;
+  const std::string cpu_list = absl::GetFlag(FLAGS_service_cpus);
+  if (!cpu_list.empty()) {
+    ErrorMessageOr<std::vector<int>> cpus_or_error = orbit_service::utils::ParseCpuList(cpu_list);
+    if (cpus_or_error.has_error()) {
+      FATAL("--service_cpus: %s", cpus_or_error.error().message());
+    }
+    cpus = std::move(cpus_or_error.value());
+  }
+  std::optional<int> nice;
+  if (absl::GetFlag(FLAGS_service_nice) != 0) nice = absl::GetFlag(FLAGS_service_nice);
+  if (cpus.empty() && !nice.has_value()) return;
+
+  ErrorMessageOr<void> result =
+      orbit_service::utils::ConstrainCurrentThreadAndFutureThreads(cpus, nice);
+  if (result.has_error()) {
+    ERROR("Constraining the threads of the service: %s", result.error().message());
+    return;
+  }
+  LOG("Running the threads of the service on CPUs \"%s\" with nice value %d",
+      cpu_list.empty() ? "all" : cpu_list, absl::GetFlag(FLAGS_service_nice));
+}
+
+std::optional<orbit_service::ContinuousProfilingOptions> GetContinuousProfilingOptions() {
+  orbit_service::ContinuousProfilingOptions options;
+  options.pid = absl::GetFlag(FLAGS_continuous_profiling_pid);
+  options.process_name = absl::GetFlag(FLAGS_continuous_profiling_process_name);
+  if (options.pid == 0 && options.process_name.empty()) return std::nullopt;
+
+  options.samples_per_second = absl::GetFlag(FLAGS_continuous_profiling_samples_per_second);
+  options.file_duration =
+      absl::Minutes(absl::GetFlag(FLAGS_continuous_profiling_file_duration_minutes));
+  options.statistics_summary_interval =
+      absl::Seconds(absl::GetFlag(FLAGS_continuous_profiling_summary_interval_seconds));
+  options.max_file_count = absl::GetFlag(FLAGS_continuous_profiling_max_files);
+  options.max_total_size_bytes =
+      absl::GetFlag(FLAGS_continuous_profiling_max_total_mb) * 1024 * 1024;
+  if (options.samples_per_second <= 0 || options.file_duration <= absl::ZeroDuration()) {
+    FATAL("--continuous_profiling_samples_per_second and "
+          "--continuous_profiling_file_duration_minutes must be positive");
+  }
+  return options;
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -56,10 +152,11 @@ int main(int argc, char** argv) {
   absl::ParseCommandLine(argc, argv);
 
   InstallSigintHandler();
+  ConstrainServiceThreads();
 
   uint16_t grpc_port = absl::GetFlag(FLAGS_grpc_port);
 
   exit_requested = false;
-  orbit_service::OrbitService service{grpc_port};
+  orbit_service::OrbitService service{grpc_port, GetContinuousProfilingOptions()};
   service.Run(&exit_requested);
 }
@@ -13,6 +13,7 @@
 #include <QEventLoop>
 #include <QMetaObject>
 #include <Qt>
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <system_error>
@@ -323,6 +324,7 @@ ErrorMessageOr<void> ServiceDeployManager::CopyFileToLocalImpl(std::string_view
                                            &orbit_ssh_qt::SftpCopyToLocalOperation::errorOccurred);
   auto cancel_handler = ConnectCancelHandler(&loop, this);
 
+  const auto copy_begin = std::chrono::steady_clock::now();
   operation.CopyFileToLocal(source, destination);
 
   auto result = loop.exec();
@@ -330,6 +332,11 @@ ErrorMessageOr<void> ServiceDeployManager::CopyFileToLocalImpl(std::string_view
     return ErrorMessage(absl::StrFormat(R"(Error copying remote "%s" to "%s": %s)", source,
                                         destination, result.error().message()));
   }
+  const std::chrono::duration<double> copy_duration = std::chrono::steady_clock::now() - copy_begin;
+  constexpr double kBytesPerMiB = 1024.0 * 1024.0;
+  LOG("Copied %u bytes of remote \"%s\" in %.3f s (%.1f MiB/s)", operation.GetBytesCopied(),
+      source, copy_duration.count(),
+      operation.GetBytesCopied() / kBytesPerMiB / std::max(copy_duration.count(), 1e-9));
 
   auto sftp_channel_stop_result = StopSftpChannel(sftp_channel.value().get());
 
@@ -0,0 +1,201 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SymbolCacheFile.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/WriteStringToFile.h"
+
+#if defined(__linux)
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "OrbitBase/SafeStrerror.h"
+#else
+#include "OrbitBase/ReadFileToString.h"
+#endif
+
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+
+namespace orbit_symbols_internal {
+
+namespace {
+
+struct Header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t build_id_size;
+  uint64_t load_bias;
+  uint64_t symbol_count;
+  uint64_t string_table_size;
+};
+static_assert(sizeof(Header) == 40);
+
+struct SymbolRecord {
+  uint64_t address;
+  uint64_t size;
+  uint32_t name_offset;
+  uint32_t name_size;
+  uint32_t demangled_name_offset;
+  uint32_t demangled_name_size;
+};
+static_assert(sizeof(SymbolRecord) == 32);
+
+// `contents` is the whole file. The records are read in place, as the header and the records are
+// multiples of 8 bytes and the file is mapped at the start of a page.
+ErrorMessageOr<ModuleSymbols> ParseSymbolCacheFile(std::string_view contents,
+                                                   std::string_view build_id) {
+  if (contents.size() < sizeof(Header)) {
+    return ErrorMessage("The symbol cache file is truncated.");
+  }
+  Header header;
+  std::memcpy(&header, contents.data(), sizeof(header));
+  if (header.magic != kSymbolCacheFileMagic) {
+    return ErrorMessage("The file is not a symbol cache file.");
+  }
+  if (header.version != kSymbolCacheFileVersion) {
+    return ErrorMessage(absl::StrFormat("Unsupported version of the symbol cache file: %u",
+                                        header.version));
+  }
+
+  const size_t max_symbol_count = (contents.size() - sizeof(Header)) / sizeof(SymbolRecord);
+  if (header.symbol_count > max_symbol_count ||
+      contents.size() != sizeof(Header) + header.symbol_count * sizeof(SymbolRecord) +
+                             header.string_table_size) {
+    return ErrorMessage("The size of the symbol cache file doesn't match its header.");
+  }
+  const char* records_start = contents.data() + sizeof(Header);
+  const std::string_view string_table =
+      contents.substr(sizeof(Header) + header.symbol_count * sizeof(SymbolRecord));
+
+  if (header.build_id_size > string_table.size() ||
+      string_table.substr(0, header.build_id_size) != build_id) {
+    return ErrorMessage("The symbol cache file holds the symbols of another build.");
+  }
+
+  auto get_string = [&string_table](uint32_t offset,
+                                    uint32_t size) -> ErrorMessageOr<std::string_view> {
+    if (offset > string_table.size() || size > string_table.size() - offset) {
+      return ErrorMessage("A symbol name is outside of the string table of the symbol cache file.");
+    }
+    return string_table.substr(offset, size);
+  };
+
+  ModuleSymbols module_symbols;
+  module_symbols.set_load_bias(header.load_bias);
+  module_symbols.mutable_symbol_infos()->Reserve(static_cast<int>(header.symbol_count));
+  for (size_t i = 0; i < header.symbol_count; ++i) {
+    const auto* record = reinterpret_cast<const SymbolRecord*>(records_start) + i;
+    OUTCOME_TRY(name, get_string(record->name_offset, record->name_size));
+    OUTCOME_TRY(demangled_name,
+                get_string(record->demangled_name_offset, record->demangled_name_size));
+    SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
+    symbol_info->set_name(name.data(), name.size());
+    symbol_info->set_demangled_name(demangled_name.data(), demangled_name.size());
+    symbol_info->set_address(record->address);
+    symbol_info->set_size(record->size);
+  }
+  return module_symbols;
+}
+
+}  // namespace
+
+ErrorMessageOr<void> WriteSymbolCacheFile(const std::filesystem::path& file_path,
+                                          std::string_view build_id,
+                                          const ModuleSymbols& module_symbols) {
+  std::vector<const SymbolInfo*> symbol_infos;
+  symbol_infos.reserve(module_symbols.symbol_infos_size());
+  for (const SymbolInfo& symbol_info : module_symbols.symbol_infos()) {
+    symbol_infos.push_back(&symbol_info);
+  }
+  std::stable_sort(symbol_infos.begin(), symbol_infos.end(),
+                   [](const SymbolInfo* lhs, const SymbolInfo* rhs) {
+                     return lhs->address() < rhs->address();
+                   });
+
+  std::string string_table{build_id};
+  std::vector<SymbolRecord> records;
+  records.reserve(symbol_infos.size());
+  for (const SymbolInfo* symbol_info : symbol_infos) {
+    SymbolRecord& record = records.emplace_back();
+    record.address = symbol_info->address();
+    record.size = symbol_info->size();
+    record.name_offset = static_cast<uint32_t>(string_table.size());
+    record.name_size = static_cast<uint32_t>(symbol_info->name().size());
+    string_table.append(symbol_info->name());
+    // The names of C functions are not mangled, so the demangled name is often the same.
+    if (symbol_info->demangled_name() == symbol_info->name()) {
+      record.demangled_name_offset = record.name_offset;
+      record.demangled_name_size = record.name_size;
+    } else {
+      record.demangled_name_offset = static_cast<uint32_t>(string_table.size());
+      record.demangled_name_size = static_cast<uint32_t>(symbol_info->demangled_name().size());
+      string_table.append(symbol_info->demangled_name());
+    }
+  }
+  if (string_table.size() > std::numeric_limits<uint32_t>::max()) {
+    return ErrorMessage("The symbol names are too large for a symbol cache file.");
+  }
+
+  Header header{};
+  header.magic = kSymbolCacheFileMagic;
+  header.version = kSymbolCacheFileVersion;
+  header.build_id_size = static_cast<uint32_t>(build_id.size());
+  header.load_bias = module_symbols.load_bias();
+  header.symbol_count = records.size();
+  header.string_table_size = string_table.size();
+
+  std::string contents;
+  contents.reserve(sizeof(header) + records.size() * sizeof(SymbolRecord) + string_table.size());
+  contents.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  contents.append(reinterpret_cast<const char*>(records.data()),
+                  records.size() * sizeof(SymbolRecord));
+  contents.append(string_table);
+
+  std::filesystem::path temporary_file_path = file_path;
+  temporary_file_path += ".tmp";
+  OUTCOME_TRY(orbit_base::WriteStringToFile(temporary_file_path, contents));
+  return orbit_base::MoveFile(temporary_file_path, file_path);
+}
+
+ErrorMessageOr<ModuleSymbols> ReadSymbolCacheFile(const std::filesystem::path& file_path,
+                                                  std::string_view build_id) {
+#if defined(__linux)
+  OUTCOME_TRY(fd, orbit_base::OpenFileForReading(file_path));
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) != 0) {
+    return ErrorMessage(absl::StrFormat("Unable to stat \"%s\": %s", file_path.string(),
+                                        SafeStrerror(errno)));
+  }
+  const auto file_size = static_cast<size_t>(file_stat.st_size);
+  if (file_size == 0) return ErrorMessage("The symbol cache file is empty.");
+
+  void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage(absl::StrFormat("Unable to map \"%s\": %s", file_path.string(),
+                                        SafeStrerror(errno)));
+  }
+  const std::string_view contents{static_cast<const char*>(mapping), file_size};
+  ErrorMessageOr<ModuleSymbols> module_symbols = ParseSymbolCacheFile(contents, build_id);
+  if (munmap(mapping, file_size) != 0) {
+    ERROR("Unmapping \"%s\": %s", file_path.string(), SafeStrerror(errno));
+  }
+  return module_symbols;
+#else
+  OUTCOME_TRY(contents, orbit_base::ReadFileToString(file_path));
+  return ParseSymbolCacheFile(contents, build_id);
+#endif
+}
+
+}  // namespace orbit_symbols_internal
@@ -0,0 +1,40 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYMBOLS_SYMBOL_CACHE_FILE_H_
+#define SYMBOLS_SYMBOL_CACHE_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "OrbitBase/Result.h"
+#include "symbol.pb.h"
+
+namespace orbit_symbols_internal {
+
+// A symbol cache file holds the symbols loaded from the debug file of one build, so that the
+// following sessions don't need to parse the debug file again. It consists of:
+// - a header with the magic number, the version of the format, the load bias and the counts;
+// - the symbols sorted by address, as fixed size records of the address and size of the function
+//   and of the offsets and sizes of its names in the string table;
+// - the string table, which starts with the build id the symbols were loaded for.
+// All the integers are in the byte order of the machine, which is checked with the magic number.
+// The file is mapped into memory for reading.
+constexpr uint64_t kSymbolCacheFileMagic = 0x4d59'5354'4942'524f;  // "ORBITSYM" in little endian.
+constexpr uint32_t kSymbolCacheFileVersion = 1;
+
+// Writes the file atomically: the symbols are first written to a temporary file next to
+// `file_path`, which is then moved to `file_path`.
+[[nodiscard]] ErrorMessageOr<void> WriteSymbolCacheFile(
+    const std::filesystem::path& file_path, std::string_view build_id,
+    const orbit_grpc_protos::ModuleSymbols& module_symbols);
+
+// Fails if the file is not a valid symbol cache file or if it holds the symbols of another build.
+[[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> ReadSymbolCacheFile(
+    const std::filesystem::path& file_path, std::string_view build_id);
+
+}  // namespace orbit_symbols_internal
+
+#endif  // SYMBOLS_SYMBOL_CACHE_FILE_H_
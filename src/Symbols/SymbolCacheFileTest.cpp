@@ -0,0 +1,121 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+#include "OrbitBase/WriteStringToFile.h"
+#include "SymbolCacheFile.h"
+#include "symbol.pb.h"
+
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+using orbit_symbols_internal::ReadSymbolCacheFile;
+using orbit_symbols_internal::WriteSymbolCacheFile;
+
+namespace {
+
+constexpr const char* kBuildId = "b5413574bbacec6eacb3b89b1012d0e2cd92ec6b";
+
+void AddSymbol(ModuleSymbols* module_symbols, std::string name, std::string demangled_name,
+               uint64_t address, uint64_t size) {
+  SymbolInfo* symbol_info = module_symbols->add_symbol_infos();
+  symbol_info->set_name(std::move(name));
+  symbol_info->set_demangled_name(std::move(demangled_name));
+  symbol_info->set_address(address);
+  symbol_info->set_size(size);
+}
+
+ModuleSymbols CreateModuleSymbols() {
+  ModuleSymbols module_symbols;
+  module_symbols.set_load_bias(0x400000);
+  AddSymbol(&module_symbols, "_Z3foov", "foo()", 0x2000, 0x10);
+  AddSymbol(&module_symbols, "main", "main", 0x1000, 0x40);
+  AddSymbol(&module_symbols, "", "", 0x3000, 0);
+  return module_symbols;
+}
+
+}  // namespace
+
+TEST(SymbolCacheFile, WriteAndRead) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, orbit_base::HasNoError());
+  const std::filesystem::path& file_path = temporary_file_or_error.value().file_path();
+
+  ASSERT_THAT(WriteSymbolCacheFile(file_path, kBuildId, CreateModuleSymbols()),
+              orbit_base::HasNoError());
+  ErrorMessageOr<ModuleSymbols> module_symbols = ReadSymbolCacheFile(file_path, kBuildId);
+  ASSERT_THAT(module_symbols, orbit_base::HasNoError());
+
+  // The symbols are sorted by address.
+  EXPECT_EQ(module_symbols.value().load_bias(), 0x400000);
+  ASSERT_EQ(module_symbols.value().symbol_infos_size(), 3);
+  const SymbolInfo& main_symbol = module_symbols.value().symbol_infos(0);
+  EXPECT_EQ(main_symbol.name(), "main");
+  EXPECT_EQ(main_symbol.demangled_name(), "main");
+  EXPECT_EQ(main_symbol.address(), 0x1000);
+  EXPECT_EQ(main_symbol.size(), 0x40);
+  const SymbolInfo& foo_symbol = module_symbols.value().symbol_infos(1);
+  EXPECT_EQ(foo_symbol.name(), "_Z3foov");
+  EXPECT_EQ(foo_symbol.demangled_name(), "foo()");
+  EXPECT_EQ(foo_symbol.address(), 0x2000);
+  EXPECT_EQ(foo_symbol.size(), 0x10);
+  EXPECT_EQ(module_symbols.value().symbol_infos(2).name(), "");
+  EXPECT_EQ(module_symbols.value().symbol_infos(2).address(), 0x3000);
+}
+
+TEST(SymbolCacheFile, WriteAndReadWithoutSymbols) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, orbit_base::HasNoError());
+  const std::filesystem::path& file_path = temporary_file_or_error.value().file_path();
+
+  ASSERT_THAT(WriteSymbolCacheFile(file_path, "", ModuleSymbols{}), orbit_base::HasNoError());
+  ErrorMessageOr<ModuleSymbols> module_symbols = ReadSymbolCacheFile(file_path, "");
+  ASSERT_THAT(module_symbols, orbit_base::HasNoError());
+  EXPECT_EQ(module_symbols.value().symbol_infos_size(), 0);
+}
+
+TEST(SymbolCacheFile, OtherBuildId) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, orbit_base::HasNoError());
+  const std::filesystem::path& file_path = temporary_file_or_error.value().file_path();
+
+  ASSERT_THAT(WriteSymbolCacheFile(file_path, kBuildId, CreateModuleSymbols()),
+              orbit_base::HasNoError());
+  EXPECT_THAT(ReadSymbolCacheFile(file_path, "b5413574"),
+              orbit_base::HasError("symbols of another build"));
+}
+
+TEST(SymbolCacheFile, InvalidFiles) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, orbit_base::HasNoError());
+  const std::filesystem::path& file_path = temporary_file_or_error.value().file_path();
+
+  EXPECT_THAT(ReadSymbolCacheFile(file_path, kBuildId), orbit_base::HasError("empty"));
+
+  ASSERT_THAT(orbit_base::WriteStringToFile(file_path, "not a symbol cache file"),
+              orbit_base::HasNoError());
+  EXPECT_THAT(ReadSymbolCacheFile(file_path, kBuildId), orbit_base::HasError("truncated"));
+
+  ASSERT_THAT(orbit_base::WriteStringToFile(file_path, std::string(64, 'x')),
+              orbit_base::HasNoError());
+  EXPECT_THAT(ReadSymbolCacheFile(file_path, kBuildId),
+              orbit_base::HasError("not a symbol cache file"));
+
+  // A file that was only partially written.
+  ASSERT_THAT(WriteSymbolCacheFile(file_path, kBuildId, CreateModuleSymbols()),
+              orbit_base::HasNoError());
+  ErrorMessageOr<std::string> contents = orbit_base::ReadFileToString(file_path);
+  ASSERT_THAT(contents, orbit_base::HasNoError());
+  const std::string truncated_contents = contents.value().substr(0, contents.value().size() - 1);
+  ASSERT_THAT(orbit_base::WriteStringToFile(file_path, truncated_contents),
+              orbit_base::HasNoError());
+  EXPECT_THAT(ReadSymbolCacheFile(file_path, kBuildId),
+              orbit_base::HasError("doesn't match its header"));
+}
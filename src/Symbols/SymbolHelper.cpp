@@ -24,11 +24,13 @@
 #include "ObjectUtils/ElfFile.h"
 #include "ObjectUtils/ObjectFile.h"
 #include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/WriteStringToFile.h"
 #include "OrbitPaths/Paths.h"
+#include "SymbolCacheFile.h"
 
 using orbit_grpc_protos::ModuleSymbols;
 
@@ -258,11 +260,45 @@ ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsFromFile(const fs::path&
   return object_file_or_error.value()->LoadDebugSymbols();
 }
 
+ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsUsingCache(
+    const fs::path& symbols_path, const std::string& build_id) const {
+  if (build_id.empty()) return LoadSymbolsFromFile(symbols_path);
+
+  const fs::path symbol_cache_file_path = GenerateSymbolCacheFileName(build_id);
+  OUTCOME_TRY(symbol_cache_file_exists, orbit_base::FileExists(symbol_cache_file_path));
+  if (symbol_cache_file_exists) {
+    ORBIT_SCOPE("ReadSymbolCacheFile");
+    SCOPED_TIMED_LOG("Loading symbols from symbol cache file: %s", symbol_cache_file_path.string());
+    ErrorMessageOr<ModuleSymbols> module_symbols =
+        orbit_symbols_internal::ReadSymbolCacheFile(symbol_cache_file_path, build_id);
+    if (module_symbols.has_value()) {
+      module_symbols.value().set_symbols_file_path(symbols_path.string());
+      return module_symbols;
+    }
+    // The symbol cache file is rewritten below.
+    ERROR("Loading symbols from \"%s\": %s", symbol_cache_file_path.string(),
+          module_symbols.error().message());
+  }
+
+  OUTCOME_TRY(module_symbols, LoadSymbolsFromFile(symbols_path));
+  ErrorMessageOr<void> write_result = orbit_symbols_internal::WriteSymbolCacheFile(
+      symbol_cache_file_path, build_id, module_symbols);
+  if (write_result.has_error()) {
+    ERROR("Writing symbol cache file \"%s\": %s", symbol_cache_file_path.string(),
+          write_result.error().message());
+  }
+  return module_symbols;
+}
+
 fs::path SymbolHelper::GenerateCachedFileName(const fs::path& file_path) const {
   auto file_name = absl::StrReplaceAll(file_path.string(), {{"/", "_"}});
   return cache_directory_ / file_name;
 }
 
+fs::path SymbolHelper::GenerateSymbolCacheFileName(std::string_view build_id) const {
+  return cache_directory_ / absl::StrFormat("%s.symbols", build_id);
+}
+
 [[nodiscard]] bool SymbolHelper::IsMatchingDebugInfoFile(
     const std::filesystem::path& debuginfo_file_path, uint32_t checksum) {
   std::error_code error;
@@ -17,6 +17,7 @@
 #include "OrbitBase/Result.h"
 #include "OrbitBase/TemporaryFile.h"
 #include "OrbitBase/TestUtils.h"
+#include "OrbitBase/WriteStringToFile.h"
 #include "OrbitPaths/Paths.h"
 #include "Symbols/SymbolHelper.h"
 #include "symbol.pb.h"
@@ -222,6 +223,47 @@ TEST(SymbolHelper, LoadFromFile) {
   }
 }
 
+TEST(SymbolHelper, LoadSymbolsUsingCache) {
+  const fs::path cache_directory = fs::temp_directory_path() / "orbit_symbol_helper_test_cache";
+  fs::remove_all(cache_directory);
+  ASSERT_THAT(orbit_base::CreateDirectory(cache_directory), orbit_base::HasNoError());
+  SymbolHelper symbol_helper{{}, cache_directory, {}};
+  const fs::path file_path = testdata_directory / "no_symbols_elf.debug";
+  const std::string build_id = "b5413574bbacec6eacb3b89b1012d0e2cd92ec6b";
+
+  // The first load writes the symbol cache file, the second one reads it.
+  const auto result_from_file = symbol_helper.LoadSymbolsUsingCache(file_path, build_id);
+  ASSERT_THAT(result_from_file, orbit_base::HasNoError());
+  const fs::path symbol_cache_file_path = symbol_helper.GenerateSymbolCacheFileName(build_id);
+  EXPECT_TRUE(fs::exists(symbol_cache_file_path));
+
+  const auto result_from_cache = symbol_helper.LoadSymbolsUsingCache(file_path, build_id);
+  ASSERT_THAT(result_from_cache, orbit_base::HasNoError());
+  const ModuleSymbols& symbols_from_file = result_from_file.value();
+  const ModuleSymbols& symbols_from_cache = result_from_cache.value();
+  EXPECT_EQ(symbols_from_cache.symbols_file_path(), file_path);
+  EXPECT_EQ(symbols_from_cache.load_bias(), symbols_from_file.load_bias());
+  ASSERT_EQ(symbols_from_cache.symbol_infos_size(), symbols_from_file.symbol_infos_size());
+  for (const auto& symbol_info : symbols_from_file.symbol_infos()) {
+    EXPECT_THAT(symbols_from_cache.symbol_infos(),
+                testing::Contains(testing::AllOf(
+                    testing::Property(&orbit_grpc_protos::SymbolInfo::name, symbol_info.name()),
+                    testing::Property(&orbit_grpc_protos::SymbolInfo::address,
+                                      symbol_info.address()))));
+  }
+
+  // A corrupted symbol cache file is replaced.
+  ASSERT_THAT(orbit_base::WriteStringToFile(symbol_cache_file_path, "corrupted"),
+              orbit_base::HasNoError());
+  const auto result_after_corruption = symbol_helper.LoadSymbolsUsingCache(file_path, build_id);
+  ASSERT_THAT(result_after_corruption, orbit_base::HasNoError());
+  EXPECT_EQ(result_after_corruption.value().symbol_infos_size(),
+            symbols_from_file.symbol_infos_size());
+  EXPECT_THAT(symbol_helper.LoadSymbolsUsingCache(file_path, build_id), orbit_base::HasNoError());
+
+  fs::remove_all(cache_directory);
+}
+
 TEST(SymbolHelper, GenerateCachedFileName) {
   SymbolHelper symbol_helper{{}, orbit_paths::CreateOrGetCacheDir(), {}};
   const std::filesystem::path file_path = "/var/data/filename.elf";
@@ -36,10 +36,16 @@ class SymbolHelper {
                                                             const std::string& build_id) const;
   [[nodiscard]] static ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbolsFromFile(
       const fs::path& file_path);
+  // Loads the symbols of the build `build_id` from its symbol cache file if there is one, so that
+  // the symbols file `symbols_path` doesn't need to be parsed again. Otherwise loads them from
+  // `symbols_path` and writes the symbol cache file for the next sessions.
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbolsUsingCache(
+      const fs::path& symbols_path, const std::string& build_id) const;
   [[nodiscard]] static ErrorMessageOr<void> VerifySymbolsFile(const fs::path& symbols_path,
                                                               const std::string& build_id);
 
   [[nodiscard]] fs::path GenerateCachedFileName(const fs::path& file_path) const;
+  [[nodiscard]] fs::path GenerateSymbolCacheFileName(std::string_view build_id) const;
 
   [[nodiscard]] static bool IsMatchingDebugInfoFile(const fs::path& file_path, uint32_t checksum);
   [[nodiscard]] ErrorMessageOr<fs::path> FindDebugInfoFileLocally(std::string_view filename,
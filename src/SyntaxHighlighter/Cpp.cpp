@@ -74,8 +74,6 @@ const QRegularExpression kNoEndStringRegex{"([^\\\\\"]|\\\\.)*\\\\$"};
 }  // namespace CppRegex
 }  // namespace
 
-Cpp::Cpp() : QSyntaxHighlighter{static_cast<QObject*>(nullptr)} {}
-
 CppHighlighterState HighlightBlockCpp(
     const QString& code, int previous_block_state,
     std::function<void(int, int, const QTextCharFormat&)> set_format) {
@@ -134,10 +132,8 @@ CppHighlighterState HighlightBlockCpp(
   return next_block_state;
 }
 
-void Cpp::highlightBlock(const QString& code) {
-  setCurrentBlockState(HighlightBlockCpp(
-      code, previousBlockState(), [this](int start, int count, const QTextCharFormat& format) {
-        setFormat(start, count, format);
-      }));
+int Cpp::HighlightBlock(const QTextBlock& block, int previous_block_state,
+                        const SetFormatFunction& set_format) const {
+  return HighlightBlockCpp(block.text(), previous_block_state, set_format);
 }
 }  // namespace orbit_syntax_highlighter
@@ -216,20 +216,18 @@ const QRegularExpression kPlatformRegex{"^Platform:.*$"};
 }  // namespace AssemblyRegex
 }  // namespace
 
-X86Assembly::X86Assembly() : QSyntaxHighlighter{static_cast<QObject*>(nullptr)} {}
-
-void X86Assembly::highlightBlock(const QString& code) {
+int X86Assembly::HighlightBlock(const QTextBlock& block, int /*previous_block_state*/,
+                                const SetFormatFunction& set_format) const {
   const HighlightingMetadata* const highlighting_metadata =
-      dynamic_cast<const HighlightingMetadata*>(currentBlock().userData());
+      dynamic_cast<const HighlightingMetadata*>(block.userData());
   if (highlighting_metadata == nullptr || highlighting_metadata->IsMainContentLine()) {
-    HighlightBlockAssembly(code, [this](int start, int count, const QTextCharFormat& format) {
-      setFormat(start, count, format);
-    });
+    HighlightBlockAssembly(block.text(), set_format);
   } else {  // Metadata::LineType::kAnnotatingLine
-    HighlightAnnotatingBlock(code, [this](int start, int count, const QTextCharFormat& format) {
-      setFormat(start, count, format);
-    });
+    HighlightAnnotatingBlock(block.text(), set_format);
   }
+
+  // Assembly has no constructs spanning multiple lines.
+  return 0;
 }
 
 // Highlight every character with the same default_color
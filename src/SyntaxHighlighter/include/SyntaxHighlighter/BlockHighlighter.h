@@ -0,0 +1,38 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYNTAX_HIGHLIGHTER_BLOCK_HIGHLIGHTER_H_
+#define SYNTAX_HIGHLIGHTER_BLOCK_HIGHLIGHTER_H_
+
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <functional>
+
+namespace orbit_syntax_highlighter {
+
+/*
+  A BlockHighlighter computes the formats of a single block (line) of a document. In contrast to
+  QSyntaxHighlighter it doesn't attach to a document and highlight all of it on its own, so the
+  caller decides which blocks get highlighted when, e.g. only the visible ones of a large document
+  (see orbit_code_viewer::IncrementalHighlighter).
+
+  Like with QSyntaxHighlighter, a later call of `set_format` paints over the formats set by earlier
+  calls for the same characters.
+*/
+class BlockHighlighter {
+ public:
+  using SetFormatFunction = std::function<void(int start, int count, const QTextCharFormat&)>;
+
+  virtual ~BlockHighlighter() = default;
+
+  // Highlights `block` given the state the previous block ended in, which is -1 for the first
+  // block, and returns the state `block` ends in, which is never -1. States are how highlighters
+  // carry constructs like multi-line comments from one block to the next.
+  [[nodiscard]] virtual int HighlightBlock(const QTextBlock& block, int previous_block_state,
+                                           const SetFormatFunction& set_format) const = 0;
+};
+
+}  // namespace orbit_syntax_highlighter
+
+#endif  // SYNTAX_HIGHLIGHTER_BLOCK_HIGHLIGHTER_H_
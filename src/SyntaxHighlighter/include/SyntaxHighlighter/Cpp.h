@@ -6,23 +6,24 @@
 #define SYNTAX_HIGHLIGHTER_CPP_H_
 
 #include <QRegularExpression>
-#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <functional>
+
+#include "SyntaxHighlighter/BlockHighlighter.h"
 
 namespace orbit_syntax_highlighter {
 
 //  This a syntax highlighter for C++.
-//  It derives from QSyntaxHighlighter, so check out QSyntaxHighlighter's
-//  documentation on how to use it. There are no additional settings or
-//  APIs.
+//  It is a BlockHighlighter, so check out BlockHighlighter's documentation
+//  on how to use it. There are no additional settings or APIs.
 
 enum CppHighlighterState { kInitialState, kOpenCommentState, kOpenStringState };
 
-class Cpp : public QSyntaxHighlighter {
-  Q_OBJECT
-  void highlightBlock(const QString& code) override;
-
+class Cpp : public BlockHighlighter {
  public:
-  explicit Cpp();
+  [[nodiscard]] int HighlightBlock(const QTextBlock& block, int previous_block_state,
+                                   const SetFormatFunction& set_format) const override;
 };
 
 CppHighlighterState HighlightBlockCpp(
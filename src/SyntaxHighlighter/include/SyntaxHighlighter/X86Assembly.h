@@ -8,24 +8,24 @@
 #include <absl/container/flat_hash_map.h>
 #include <qregularexpression.h>
 
-#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <functional>
+
+#include "SyntaxHighlighter/BlockHighlighter.h"
 
 namespace orbit_syntax_highlighter {
 
 /*
   This a syntax highlighter for x86 and x86_64 assembly (Intel syntax).
 
-  It derives from QSyntaxHighlighter, so check out QSyntaxHighlighter's
-  documentation on how to use it. There are no additional settings or
-  APIs.
+  It is a BlockHighlighter, so check out BlockHighlighter's documentation
+  on how to use it. There are no additional settings or APIs.
 */
-class X86Assembly : public QSyntaxHighlighter {
-  Q_OBJECT
-
-  void highlightBlock(const QString& code) override;
-
+class X86Assembly : public BlockHighlighter {
  public:
-  explicit X86Assembly();
+  [[nodiscard]] int HighlightBlock(const QTextBlock& block, int previous_block_state,
+                                   const SetFormatFunction& set_format) const override;
 };
 
 void HighlightBlockAssembly(
@@ -8,8 +8,11 @@
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
+#include <limits.h>
 #include <sys/ptrace.h>
+#include <sys/uio.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <string>
@@ -53,6 +56,68 @@ using orbit_base::ReadFileToString;
   return outcome::success();
 }
 
+[[nodiscard]] ErrorMessageOr<std::vector<std::vector<uint8_t>>> ReadTraceesMemory(
+    pid_t pid, const std::vector<AddressRange>& ranges) {
+  std::vector<std::vector<uint8_t>> result(ranges.size());
+  std::vector<iovec> local_iovecs(ranges.size());
+  std::vector<iovec> remote_iovecs(ranges.size());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    CHECK(ranges[i].end > ranges[i].start);
+    result[i].resize(ranges[i].end - ranges[i].start);
+    local_iovecs[i].iov_base = result[i].data();
+    local_iovecs[i].iov_len = result[i].size();
+    remote_iovecs[i].iov_base = absl::bit_cast<void*>(ranges[i].start);
+    remote_iovecs[i].iov_len = result[i].size();
+  }
+
+  // process_vm_readv accepts at most IOV_MAX ranges at a time.
+  for (size_t first = 0; first < ranges.size(); first += IOV_MAX) {
+    const size_t count = std::min<size_t>(IOV_MAX, ranges.size() - first);
+    size_t expected_size = 0;
+    for (size_t i = first; i < first + count; ++i) {
+      expected_size += result[i].size();
+    }
+    const ssize_t read_size = process_vm_readv(pid, &local_iovecs[first], count,
+                                               &remote_iovecs[first], count, /*flags=*/0);
+    if (read_size == -1) {
+      return ErrorMessage(absl::StrFormat("Failed to read memory of process %d: %s", pid,
+                                          SafeStrerror(errno)));
+    }
+    // A partial read means that one of the ranges is (partially) not mapped.
+    if (static_cast<size_t>(read_size) < expected_size) {
+      return ErrorMessage(absl::StrFormat(
+          "Failed to read %u bytes from memory of process %d. Only got %d bytes.", expected_size,
+          pid, read_size));
+    }
+  }
+
+  return result;
+}
+
+[[nodiscard]] ErrorMessageOr<void> WriteTraceesMemory(
+    pid_t pid, const std::vector<TraceesMemoryWrite>& writes) {
+  if (writes.empty()) return outcome::success();
+
+  OUTCOME_TRY(fd, orbit_base::OpenFileForWriting(absl::StrFormat("/proc/%d/mem", pid)));
+
+  uint64_t merged_start_address = writes[0].start_address;
+  std::vector<uint8_t> merged_bytes;
+  for (const TraceesMemoryWrite& write : writes) {
+    CHECK(!write.bytes.empty());
+    if (write.start_address != merged_start_address + merged_bytes.size()) {
+      OUTCOME_TRY(WriteFullyAtOffset(fd, merged_bytes.data(), merged_bytes.size(),
+                                     merged_start_address));
+      merged_start_address = write.start_address;
+      merged_bytes.clear();
+    }
+    merged_bytes.insert(merged_bytes.end(), write.bytes.begin(), write.bytes.end());
+  }
+  OUTCOME_TRY(
+      WriteFullyAtOffset(fd, merged_bytes.data(), merged_bytes.size(), merged_start_address));
+
+  return outcome::success();
+}
+
 [[nodiscard]] ErrorMessageOr<AddressRange> GetFirstExecutableMemoryRegion(
     pid_t pid, uint64_t exclude_address) {
   OUTCOME_TRY(maps, ReadFileToString(absl::StrFormat("/proc/%d/maps", pid)));
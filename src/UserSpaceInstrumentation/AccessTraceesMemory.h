@@ -26,6 +26,26 @@ namespace orbit_user_space_instrumentation {
 [[nodiscard]] ErrorMessageOr<void> WriteTraceesMemory(pid_t pid, uint64_t start_address,
                                                       const std::vector<uint8_t>& bytes);
 
+// Reads the memory of all the `ranges` from process `pid`, in as few system calls as possible
+// (process_vm_readv). The result contains the bytes of each range, in the order of `ranges`.
+// Unlike the other functions here, this doesn't require being attached to the process, only the
+// permission to attach to it.
+[[nodiscard]] ErrorMessageOr<std::vector<std::vector<uint8_t>>> ReadTraceesMemory(
+    pid_t pid, const std::vector<AddressRange>& ranges);
+
+// A write of `bytes` into the memory of a tracee starting from `start_address`.
+struct TraceesMemoryWrite {
+  uint64_t start_address;
+  std::vector<uint8_t> bytes;
+};
+
+// Performs all the `writes` into the memory of process `pid` in their order. The memory file of the
+// process is only opened once and consecutive writes to adjacent memory are merged. Unlike
+// process_vm_writev, this can also write to memory that is not writable, like the code of the
+// process. Assumes we are already attached to the tracee `pid` e.g. using `AttachAndStopProcess`.
+[[nodiscard]] ErrorMessageOr<void> WriteTraceesMemory(
+    pid_t pid, const std::vector<TraceesMemoryWrite>& writes);
+
 // Returns the address range of the first executable memory region. In every case I encountered this
 // was the second line in the `maps` file corresponding to the code of the process we look at.
 // However we don't really care. So keeping it general and just searching for an executable region
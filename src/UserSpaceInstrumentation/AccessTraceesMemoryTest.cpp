@@ -204,4 +204,66 @@ TEST(AccessTraceesMemoryTest, ReadWriteRestore) {
   waitpid(pid, NULL, 0);
 }
 
+TEST(AccessTraceesMemoryTest, BatchedReadWriteRestore) {
+  pid_t pid = fork();
+  CHECK(pid != -1);
+  if (pid == 0) {
+    // Child just runs an endless loop.
+    while (true) {
+    }
+  }
+
+  // Stop the child process using our tooling.
+  CHECK(!AttachAndStopProcess(pid).has_error());
+
+  auto memory_region_or_error = GetFirstExecutableMemoryRegion(pid);
+  CHECK(memory_region_or_error.has_value());
+  const uint64_t address = memory_region_or_error.value().start;
+
+  // Two adjacent ranges, which are merged into a single write, and one separate range. The
+  // executable memory is not writable, which process_vm_writev would refuse.
+  constexpr uint64_t kRangeSize = 64;
+  const std::vector<AddressRange> ranges = {{address, address + kRangeSize},
+                                            {address + kRangeSize, address + 2 * kRangeSize},
+                                            {address + 4 * kRangeSize, address + 5 * kRangeSize}};
+  auto backup = ReadTraceesMemory(pid, ranges);
+  ASSERT_TRUE(backup.has_value());
+  ASSERT_EQ(backup.value().size(), ranges.size());
+
+  std::mt19937 engine{std::random_device()()};
+  std::uniform_int_distribution<uint8_t> distribution{0x00, 0xff};
+  std::vector<TraceesMemoryWrite> writes;
+  for (const AddressRange& range : ranges) {
+    std::vector<uint8_t> new_data(kRangeSize);
+    std::generate(std::begin(new_data), std::end(new_data),
+                  [&distribution, &engine]() { return distribution(engine); });
+    writes.push_back({range.start, std::move(new_data)});
+  }
+  ASSERT_FALSE(WriteTraceesMemory(pid, writes).has_error());
+
+  auto read_back_or_error = ReadTraceesMemory(pid, ranges);
+  ASSERT_TRUE(read_back_or_error.has_value());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    EXPECT_EQ(writes[i].bytes, read_back_or_error.value()[i]);
+    // The batched read agrees with the single one.
+    auto single_read_or_error = ReadTraceesMemory(pid, ranges[i].start, kRangeSize);
+    ASSERT_TRUE(single_read_or_error.has_value());
+    EXPECT_EQ(writes[i].bytes, single_read_or_error.value());
+  }
+
+  // Read from bad address.
+  EXPECT_THAT(ReadTraceesMemory(pid, std::vector<AddressRange>{{0, kRangeSize}}),
+              HasError("Failed to read"));
+
+  // Restore, detach and end child.
+  std::vector<TraceesMemoryWrite> restore_writes;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    restore_writes.push_back({ranges[i].start, backup.value()[i]});
+  }
+  CHECK(WriteTraceesMemory(pid, restore_writes).has_value());
+  CHECK(!DetachAndContinueProcess(pid).has_error());
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+}
+
 }  // namespace orbit_user_space_instrumentation
\ No newline at end of file
@@ -0,0 +1,547 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "UserSpaceInstrumentation/InstrumentProcess.h"
+
+#include <absl/base/casts.h>
+#include <absl/strings/str_format.h>
+#include <capstone/capstone.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AccessTraceesMemory.h"
+#include "AddressRange.h"
+#include "AllocateInTracee.h"
+#include "ObjectUtils/LinuxMap.h"
+#include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/Future.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitBase/UniqueResource.h"
+#include "Trampoline.h"
+#include "TrampolineCache.h"
+#include "UserSpaceInstrumentation/Attach.h"
+#include "UserSpaceInstrumentation/ExecuteInProcess.h"
+#include "UserSpaceInstrumentation/InjectLibraryInTracee.h"
+#include "module.pb.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+using orbit_grpc_protos::CaptureOptions;
+using orbit_grpc_protos::InstrumentedFunction;
+using orbit_grpc_protos::ModuleInfo;
+
+// Number of bytes at the beginning of a function that are backed up (and that the trampoline can
+// relocate). The jump into the trampoline overwrites at most this many bytes.
+constexpr uint64_t kMaxFunctionPrologueBackupSize = 20;
+
+constexpr const char* kEntryPayloadFunctionName = "EntryPayload";
+constexpr const char* kExitPayloadFunctionName = "ExitPayload";
+constexpr const char* kMeasureInstrumentationOverheadFunctionName =
+    "MeasureInstrumentationOverhead";
+
+ErrorMessageOr<std::filesystem::path> GetLibraryPath() {
+  // When packaged, liborbituserspaceinstrumentation.so is found alongside OrbitService. In
+  // development, it is found in "../lib", relative to OrbitService.
+  constexpr const char* kLibName = "liborbituserspaceinstrumentation.so";
+  const std::filesystem::path exe_dir = orbit_base::GetExecutableDir();
+  std::vector<std::filesystem::path> potential_paths = {exe_dir / kLibName,
+                                                        exe_dir / "../lib" / kLibName};
+  for (const auto& path : potential_paths) {
+    if (std::filesystem::exists(path)) {
+      return path;
+    }
+  }
+  return ErrorMessage(absl::StrFormat("%s not found on system.", kLibName));
+}
+
+ErrorMessageOr<absl::flat_hash_map<std::string, ModuleInfo>> GetModulesByPathForPid(pid_t pid) {
+  OUTCOME_TRY(module_infos, orbit_object_utils::ReadModules(pid));
+  absl::flat_hash_map<std::string, ModuleInfo> result;
+  for (ModuleInfo& module_info : module_infos) {
+    result.emplace(module_info.file_path(), std::move(module_info));
+  }
+  return result;
+}
+
+[[nodiscard]] bool ProcessExists(pid_t pid) {
+  return std::filesystem::exists(absl::StrFormat("/proc/%d", pid));
+}
+
+// An entry of `RelocatePrologues`.
+struct PrologueToRelocate {
+  uint64_t function_address;
+  const std::vector<uint8_t>* function;
+};
+
+// Number of prologues a task of `RelocatePrologues` relocates. Opening a disassembler is cheap, but
+// not free, and scheduling a task per function would mostly measure the thread pool.
+constexpr size_t kProloguesPerRelocationTask = 256;
+
+// Disassembles and relocates the `prologues` on `thread_pool`, which is where most of the time of
+// instrumenting thousands of functions is spent. A capstone handle can't be used concurrently, so
+// each task opens its own.
+[[nodiscard]] std::vector<ErrorMessageOr<RelocatedPrologue>> RelocatePrologues(
+    const std::vector<PrologueToRelocate>& prologues, ThreadPool* thread_pool) {
+  std::vector<std::optional<ErrorMessageOr<RelocatedPrologue>>> results(prologues.size());
+  std::vector<orbit_base::Future<void>> futures;
+  for (size_t begin = 0; begin < prologues.size(); begin += kProloguesPerRelocationTask) {
+    const size_t end = std::min(begin + kProloguesPerRelocationTask, prologues.size());
+    futures.push_back(thread_pool->Schedule([&prologues, &results, begin, end]() {
+      csh capstone_handle = 0;
+      if (cs_open(CS_ARCH_X86, CS_MODE_64, &capstone_handle) != CS_ERR_OK) {
+        for (size_t i = begin; i < end; ++i) {
+          results[i] = ErrorMessage("Failed to open capstone disassembler.");
+        }
+        return;
+      }
+      cs_option(capstone_handle, CS_OPT_DETAIL, CS_OPT_ON);
+      for (size_t i = begin; i < end; ++i) {
+        // The relocated prologue doesn't depend on the address of the trampoline. The trampolines
+        // are only allocated once the process is stopped, and `CreateTrampoline` checks that the
+        // relocated code can reach its targets from there.
+        results[i] = RelocatePrologue(prologues[i].function_address, *prologues[i].function,
+                                      prologues[i].function_address, capstone_handle);
+      }
+      cs_close(&capstone_handle);
+    }));
+  }
+  for (const orbit_base::Future<void>& future : futures) {
+    future.Wait();
+  }
+
+  std::vector<ErrorMessageOr<RelocatedPrologue>> relocated_prologues;
+  relocated_prologues.reserve(results.size());
+  for (std::optional<ErrorMessageOr<RelocatedPrologue>>& result : results) {
+    CHECK(result.has_value());
+    relocated_prologues.push_back(std::move(result.value()));
+  }
+  return relocated_prologues;
+}
+
+}  // namespace
+
+// Holds the state of a process prepared for user space instrumentation: the payload functions in
+// the injected library, the return trampoline and the trampolines of all the functions that were
+// ever instrumented. Trampolines are never freed since there might still be return addresses
+// pointing into the return trampoline on the stacks, or threads executing code in a trampoline.
+// Instrumenting happens in two steps: `PrepareFunctions` does the expensive work while the process
+// keeps running, and `InstrumentFunctions` only allocates and writes memory. All methods except
+// `PrepareFunctions` assume that we are attached to the process.
+class InstrumentedProcess {
+ public:
+  InstrumentedProcess(pid_t pid, TrampolineCache* trampoline_cache)
+      : pid_(pid), trampoline_cache_(trampoline_cache) {}
+
+  struct FunctionToInstrument {
+    uint64_t function_id;
+    uint64_t address;
+    std::string build_id;
+    uint64_t file_offset;
+    AddressRange module_range;
+    uint64_t module_function_count;
+    // Only set for functions that don't have a trampoline yet.
+    std::optional<RelocatedPrologue> prologue;
+    bool is_prologue_from_cache = false;
+    std::vector<uint8_t> function_backup;
+  };
+
+  // Finds the functions of `capture_options` in the modules of the process, and reads and
+  // relocates the prologues of the functions without trampoline. Relocation runs on
+  // `thread_pool`. This doesn't require being attached to the process: the code of the functions
+  // is not expected to change until they are instrumented.
+  [[nodiscard]] ErrorMessageOr<std::vector<FunctionToInstrument>> PrepareFunctions(
+      const CaptureOptions& capture_options, ThreadPool* thread_pool);
+
+  // Instruments the `functions` returned by `PrepareFunctions` and returns the ids of the functions
+  // that were instrumented. The library is injected into the process the first time.
+  [[nodiscard]] ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentFunctions(
+      std::vector<FunctionToInstrument> functions);
+
+  [[nodiscard]] ErrorMessageOr<void> UninstrumentFunctions();
+
+  // Measures the overhead of the payloads in the process, see MeasureInstrumentationOverhead in
+  // OrbitUserSpaceInstrumentation.h, and returns it in nanoseconds. Requires the library to be
+  // injected.
+  [[nodiscard]] ErrorMessageOr<uint64_t> MeasureInstrumentationOverhead();
+
+ private:
+  struct Trampoline {
+    uint64_t address;
+    uint64_t address_after_prologue;
+    std::vector<uint8_t> function_backup;
+  };
+
+  // Loads liborbituserspaceinstrumentation.so into the process and creates the return trampoline,
+  // unless this already happened for an earlier capture.
+  [[nodiscard]] ErrorMessageOr<void> InjectLibraryIfNeeded();
+
+  // Returns the address of free memory for a trampoline close to the module `module_range`.
+  // Memory is allocated in blocks that fit the trampolines of `expected_trampolines` functions.
+  [[nodiscard]] ErrorMessageOr<uint64_t> GetTrampolineMemory(const AddressRange& module_range,
+                                                             uint64_t expected_trampolines);
+
+  // Creates the trampolines of the `functions` with a relocated prologue. The writes of the
+  // trampolines into the tracee are appended to `writes`; the trampolines are only added to
+  // `trampolines_by_function_address_` once these writes succeeded, hence they are returned in
+  // `new_trampolines`. Functions that can't be instrumented are remembered in
+  // `addresses_of_functions_not_instrumentable_`.
+  [[nodiscard]] ErrorMessageOr<void> CreateTrampolines(
+      std::vector<FunctionToInstrument>& functions,
+      absl::flat_hash_map<uint64_t, Trampoline>& new_trampolines,
+      absl::flat_hash_map<uint64_t, uint64_t>& new_relocation_map,
+      std::vector<TraceesMemoryWrite>& writes);
+
+  pid_t pid_;
+  TrampolineCache* trampoline_cache_;
+  bool is_library_injected_ = false;
+  uint64_t entry_payload_function_address_ = 0;
+  uint64_t return_trampoline_address_ = 0;
+  void* measure_instrumentation_overhead_function_address_ = nullptr;
+
+  struct TrampolineMemory {
+    uint64_t next_free_address;
+    uint64_t end_address;
+  };
+  absl::flat_hash_map<AddressRange, TrampolineMemory> trampoline_memory_by_module_;
+
+  absl::flat_hash_map<uint64_t, Trampoline> trampolines_by_function_address_;
+  absl::flat_hash_set<uint64_t> addresses_of_functions_not_instrumentable_;
+  // Addresses of the functions that are currently overwritten with a jump to their trampoline.
+  absl::flat_hash_set<uint64_t> addresses_of_instrumented_functions_;
+  // Maps the addresses of the instructions relocated into a trampoline to their new addresses.
+  absl::flat_hash_map<uint64_t, uint64_t> relocation_map_;
+};
+
+ErrorMessageOr<void> InstrumentedProcess::InjectLibraryIfNeeded() {
+  if (is_library_injected_) return outcome::success();
+
+  OUTCOME_TRY(library_path, GetLibraryPath());
+  OUTCOME_TRY(library_handle, DlopenInTracee(pid_, library_path, RTLD_NOW));
+  OUTCOME_TRY(entry_payload_function_address,
+              DlsymInTracee(pid_, library_handle, kEntryPayloadFunctionName));
+  OUTCOME_TRY(exit_payload_function_address,
+              DlsymInTracee(pid_, library_handle, kExitPayloadFunctionName));
+  OUTCOME_TRY(measure_instrumentation_overhead_function_address,
+              DlsymInTracee(pid_, library_handle, kMeasureInstrumentationOverheadFunctionName));
+
+  OUTCOME_TRY(return_trampoline_address, AllocateInTracee(pid_, 0, GetReturnTrampolineSize()));
+  OUTCOME_TRY(CreateReturnTrampoline(pid_, absl::bit_cast<uint64_t>(exit_payload_function_address),
+                                     return_trampoline_address));
+
+  entry_payload_function_address_ = absl::bit_cast<uint64_t>(entry_payload_function_address);
+  return_trampoline_address_ = return_trampoline_address;
+  measure_instrumentation_overhead_function_address_ =
+      measure_instrumentation_overhead_function_address;
+  is_library_injected_ = true;
+  return outcome::success();
+}
+
+ErrorMessageOr<uint64_t> InstrumentedProcess::GetTrampolineMemory(const AddressRange& module_range,
+                                                                  uint64_t expected_trampolines) {
+  const uint64_t trampoline_size = GetMaxTrampolineSize();
+  auto memory_it = trampoline_memory_by_module_.find(module_range);
+  if (memory_it == trampoline_memory_by_module_.end() ||
+      memory_it->second.end_address - memory_it->second.next_free_address < trampoline_size) {
+    // The previous block (if any) is leaked on purpose, compare the comment on the class.
+    const uint64_t size = std::max<uint64_t>(expected_trampolines, 1) * trampoline_size;
+    OUTCOME_TRY(address, AllocateMemoryForTrampolines(pid_, module_range, size));
+    memory_it = trampoline_memory_by_module_.insert_or_assign(module_range,
+                                                              TrampolineMemory{address,
+                                                                               address + size})
+                    .first;
+  }
+  const uint64_t result = memory_it->second.next_free_address;
+  memory_it->second.next_free_address += trampoline_size;
+  return result;
+}
+
+ErrorMessageOr<std::vector<InstrumentedProcess::FunctionToInstrument>>
+InstrumentedProcess::PrepareFunctions(const CaptureOptions& capture_options,
+                                      ThreadPool* thread_pool) {
+  OUTCOME_TRY(modules_by_path, GetModulesByPathForPid(pid_));
+
+  // Count the functions per module to allocate the memory for their trampolines in one go.
+  absl::flat_hash_map<std::string, uint64_t> function_count_by_module_path;
+  for (const InstrumentedFunction& function : capture_options.instrumented_functions()) {
+    ++function_count_by_module_path[function.file_path()];
+  }
+
+  // Plan everything up front, such that all the memory of the tracee is written at once.
+  std::vector<FunctionToInstrument> functions;
+  std::vector<AddressRange> prologue_ranges;
+  std::vector<size_t> indices_of_functions_without_trampoline;
+  for (const InstrumentedFunction& function : capture_options.instrumented_functions()) {
+    // Dynamic instrumentation and the manual instrumentation API don't mix: the timer functions
+    // keep being instrumented with uprobes.
+    if (function.function_type() != InstrumentedFunction::kRegular) continue;
+
+    auto module_it = modules_by_path.find(function.file_path());
+    if (module_it == modules_by_path.end()) {
+      ERROR("Could not find module \"%s\" for user space instrumentation.", function.file_path());
+      continue;
+    }
+    const ModuleInfo& module_info = module_it->second;
+    if (module_info.build_id() != function.file_build_id()) {
+      ERROR("Build-id mismatch for \"%s\" for user space instrumentation.", function.file_path());
+      continue;
+    }
+
+    const uint64_t function_address = module_info.address_start() + function.file_offset() -
+                                      module_info.executable_segment_offset();
+    if (addresses_of_functions_not_instrumentable_.contains(function_address)) continue;
+    const bool has_trampoline = trampolines_by_function_address_.contains(function_address);
+    const uint64_t backup_size = std::min(function.function_size(), kMaxFunctionPrologueBackupSize);
+    if (!has_trampoline && backup_size == 0) continue;
+
+    FunctionToInstrument& function_to_instrument = functions.emplace_back();
+    function_to_instrument.function_id = function.function_id();
+    function_to_instrument.address = function_address;
+    function_to_instrument.build_id = function.file_build_id();
+    function_to_instrument.file_offset = function.file_offset();
+    function_to_instrument.module_range =
+        AddressRange{module_info.address_start(), module_info.address_end()};
+    function_to_instrument.module_function_count =
+        function_count_by_module_path[function.file_path()];
+    if (!has_trampoline) {
+      indices_of_functions_without_trampoline.push_back(functions.size() - 1);
+      prologue_ranges.emplace_back(function_address, function_address + backup_size);
+    }
+  }
+  if (indices_of_functions_without_trampoline.empty()) return functions;
+
+  // Read the beginning of all the functions at once.
+  OUTCOME_TRY(function_backups, ReadTraceesMemory(pid_, prologue_ranges));
+
+  // Disassembling and relocating the prologue is only needed the first time a function is ever
+  // instrumented.
+  std::vector<PrologueToRelocate> prologues_to_relocate;
+  std::vector<size_t> indices_of_prologues_to_relocate;
+  for (size_t i = 0; i < indices_of_functions_without_trampoline.size(); ++i) {
+    FunctionToInstrument& function = functions[indices_of_functions_without_trampoline[i]];
+    function.function_backup = std::move(function_backups[i]);
+    const RelocatedPrologue* cached_prologue =
+        trampoline_cache_->Get(function.build_id, function.file_offset, function.function_backup);
+    if (cached_prologue != nullptr) {
+      function.prologue = *cached_prologue;
+      function.is_prologue_from_cache = true;
+      continue;
+    }
+    prologues_to_relocate.push_back({function.address, &function.function_backup});
+    indices_of_prologues_to_relocate.push_back(indices_of_functions_without_trampoline[i]);
+  }
+
+  std::vector<ErrorMessageOr<RelocatedPrologue>> relocated_prologues =
+      RelocatePrologues(prologues_to_relocate, thread_pool);
+  for (size_t i = 0; i < relocated_prologues.size(); ++i) {
+    FunctionToInstrument& function = functions[indices_of_prologues_to_relocate[i]];
+    if (relocated_prologues[i].has_error()) {
+      LOG("Unable to relocate prologue of function at %#x: %s", function.address,
+          relocated_prologues[i].error().message());
+      addresses_of_functions_not_instrumentable_.insert(function.address);
+      continue;
+    }
+    function.prologue = std::move(relocated_prologues[i].value());
+  }
+  return functions;
+}
+
+ErrorMessageOr<void> InstrumentedProcess::CreateTrampolines(
+    std::vector<FunctionToInstrument>& functions,
+    absl::flat_hash_map<uint64_t, Trampoline>& new_trampolines,
+    absl::flat_hash_map<uint64_t, uint64_t>& new_relocation_map,
+    std::vector<TraceesMemoryWrite>& writes) {
+  for (FunctionToInstrument& function : functions) {
+    if (!function.prologue.has_value()) continue;
+    OUTCOME_TRY(trampoline_address,
+                GetTrampolineMemory(function.module_range, function.module_function_count));
+
+    ErrorMessageOr<uint64_t> address_after_prologue_or_error =
+        CreateTrampoline(function.address, function.prologue.value(), trampoline_address,
+                         entry_payload_function_address_, return_trampoline_address_,
+                         new_relocation_map, writes);
+    if (address_after_prologue_or_error.has_error()) {
+      // The memory reserved for the trampoline is simply not used.
+      LOG("Unable to create trampoline for function at %#x: %s", function.address,
+          address_after_prologue_or_error.error().message());
+      addresses_of_functions_not_instrumentable_.insert(function.address);
+      continue;
+    }
+
+    if (!function.is_prologue_from_cache) {
+      trampoline_cache_->Put(function.build_id, function.file_offset, function.function_backup,
+                             std::move(function.prologue.value()));
+    }
+
+    Trampoline& trampoline = new_trampolines[function.address];
+    trampoline.address = trampoline_address;
+    trampoline.address_after_prologue = address_after_prologue_or_error.value();
+    trampoline.function_backup = std::move(function.function_backup);
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentedProcess::InstrumentFunctions(
+    std::vector<FunctionToInstrument> functions) {
+  OUTCOME_TRY(InjectLibraryIfNeeded());
+
+  // The trampolines are written first, and as they are adjacent, mostly in a single write per
+  // module.
+  absl::flat_hash_map<uint64_t, Trampoline> new_trampolines;
+  absl::flat_hash_map<uint64_t, uint64_t> new_relocation_map;
+  std::vector<TraceesMemoryWrite> writes;
+  OUTCOME_TRY(CreateTrampolines(functions, new_trampolines, new_relocation_map, writes));
+
+  absl::flat_hash_set<uint64_t> instrumented_function_ids;
+  std::vector<uint64_t> addresses_of_newly_instrumented_functions;
+  for (const FunctionToInstrument& function : functions) {
+    auto trampoline_it = trampolines_by_function_address_.find(function.address);
+    if (trampoline_it == trampolines_by_function_address_.end()) {
+      trampoline_it = new_trampolines.find(function.address);
+      if (trampoline_it == new_trampolines.end()) continue;
+    }
+    const Trampoline* trampoline = &trampoline_it->second;
+
+    // The function id changes between captures, so the jump into the trampoline is written anew
+    // every time, even if the function is still instrumented.
+    OUTCOME_TRY(InstrumentFunction(function.address, function.function_id,
+                                   trampoline->address_after_prologue, trampoline->address,
+                                   writes));
+    addresses_of_newly_instrumented_functions.push_back(function.address);
+    instrumented_function_ids.insert(function.function_id);
+  }
+
+  OUTCOME_TRY(WriteTraceesMemory(pid_, writes));
+
+  trampolines_by_function_address_.merge(new_trampolines);
+  relocation_map_.merge(new_relocation_map);
+  addresses_of_instrumented_functions_.insert(addresses_of_newly_instrumented_functions.begin(),
+                                              addresses_of_newly_instrumented_functions.end());
+
+  // No thread may be left in the middle of an overwritten prologue when the process continues.
+  MoveInstructionPointersOutOfOverwrittenCode(pid_, relocation_map_);
+
+  return instrumented_function_ids;
+}
+
+ErrorMessageOr<void> InstrumentedProcess::UninstrumentFunctions() {
+  // Threads that are executing the relocated prologue in a trampoline jump back to an instruction
+  // boundary of the original code, hence restoring the function is safe at any point.
+  std::vector<TraceesMemoryWrite> writes;
+  for (uint64_t function_address : addresses_of_instrumented_functions_) {
+    auto trampoline_it = trampolines_by_function_address_.find(function_address);
+    CHECK(trampoline_it != trampolines_by_function_address_.end());
+    writes.push_back({function_address, trampoline_it->second.function_backup});
+  }
+  OUTCOME_TRY(WriteTraceesMemory(pid_, writes));
+  addresses_of_instrumented_functions_.clear();
+  return outcome::success();
+}
+
+ErrorMessageOr<uint64_t> InstrumentedProcess::MeasureInstrumentationOverhead() {
+  CHECK(is_library_injected_);
+  return ExecuteInProcess(pid_, measure_instrumentation_overhead_function_address_);
+}
+
+InstrumentationManager::~InstrumentationManager() { thread_pool_->ShutdownAndWait(); }
+
+InstrumentationManager::InstrumentationManager(std::filesystem::path trampoline_cache_directory)
+    : trampoline_cache_(std::make_unique<TrampolineCache>(std::move(trampoline_cache_directory))),
+      thread_pool_(ThreadPool::Create(1, std::max(std::thread::hardware_concurrency(), 1u),
+                                      absl::Seconds(1))) {}
+
+std::unique_ptr<InstrumentationManager> InstrumentationManager::Create(
+    std::filesystem::path trampoline_cache_directory) {
+  return std::unique_ptr<InstrumentationManager>(
+      new InstrumentationManager(std::move(trampoline_cache_directory)));
+}
+
+ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentationManager::InstrumentProcess(
+    const CaptureOptions& capture_options) {
+  SCOPED_TIMED_LOG("Instrumenting functions in user space");
+
+  // Forget the processes that have ended in the meantime.
+  for (auto it = process_map_.begin(); it != process_map_.end();) {
+    if (!ProcessExists(it->first)) {
+      process_map_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  ErrorMessageOr<absl::flat_hash_set<uint64_t>> result =
+      PrepareAndInstrumentProcess(capture_options);
+
+  // The process is running again at this point.
+  ErrorMessageOr<void> save_result = trampoline_cache_->Save();
+  if (save_result.has_error()) {
+    ERROR("Saving trampoline cache: %s", save_result.error().message());
+  }
+  return result;
+}
+
+ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentationManager::PrepareAndInstrumentProcess(
+    const CaptureOptions& capture_options) {
+  const pid_t pid = capture_options.pid();
+  auto process_it = process_map_.find(pid);
+  if (process_it == process_map_.end()) {
+    auto process = std::make_unique<InstrumentedProcess>(pid, trampoline_cache_.get());
+    process_it = process_map_.emplace(pid, std::move(process)).first;
+  }
+  InstrumentedProcess* process = process_it->second.get();
+
+  // The process keeps running while the prologues are relocated, and is only stopped to write the
+  // trampolines and the jumps into them.
+  OUTCOME_TRY(functions, process->PrepareFunctions(capture_options, thread_pool_.get()));
+
+  OUTCOME_TRY(AttachAndStopProcess(pid));
+  // Make sure we resume the target process, even on early-outs.
+  orbit_base::unique_resource scope_exit{pid, [](pid_t pid) {
+                                           if (DetachAndContinueProcess(pid).has_error()) {
+                                             ERROR("Detaching from %i", pid);
+                                           }
+                                         }};
+  OUTCOME_TRY(instrumented_function_ids, process->InstrumentFunctions(std::move(functions)));
+
+  // Measured for every capture, as the overhead depends on the load of the machine.
+  if (capture_options.compensate_instrumentation_overhead()) {
+    ErrorMessageOr<uint64_t> overhead_ns_or_error = process->MeasureInstrumentationOverhead();
+    if (overhead_ns_or_error.has_error()) {
+      ERROR("Measuring instrumentation overhead: %s", overhead_ns_or_error.error().message());
+    } else {
+      LOG("Instrumentation overhead: %u ns per call", overhead_ns_or_error.value());
+    }
+  }
+  return instrumented_function_ids;
+}
+
+ErrorMessageOr<void> InstrumentationManager::UninstrumentProcess(pid_t pid) {
+  auto process_it = process_map_.find(pid);
+  if (process_it == process_map_.end()) {
+    return outcome::success();
+  }
+  if (!ProcessExists(pid)) {
+    process_map_.erase(process_it);
+    return outcome::success();
+  }
+
+  OUTCOME_TRY(AttachAndStopProcess(pid));
+  orbit_base::unique_resource scope_exit{pid, [](pid_t pid) {
+                                           if (DetachAndContinueProcess(pid).has_error()) {
+                                             ERROR("Detaching from %i", pid);
+                                           }
+                                         }};
+  return process_it->second->UninstrumentFunctions();
+}
+
+}  // namespace orbit_user_space_instrumentation
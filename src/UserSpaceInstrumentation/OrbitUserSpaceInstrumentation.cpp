@@ -0,0 +1,279 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitUserSpaceInstrumentation.h"
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/ProducerSideChannel.h"
+#include "capture.pb.h"
+
+namespace {
+
+// Number of integer parameter registers in the System V calling convention: rdi, rsi, rdx, rcx, r8,
+// r9.
+constexpr size_t kIntegerArgumentCount = 6;
+
+struct OpenFunctionCall {
+  OpenFunctionCall(uint64_t return_address, uint64_t function_id, uint64_t entry_timestamp_ns)
+      : return_address(return_address),
+        function_id(function_id),
+        entry_timestamp_ns(entry_timestamp_ns) {}
+  uint64_t return_address;
+  uint64_t function_id;
+  uint64_t entry_timestamp_ns;
+  std::array<uint64_t, kIntegerArgumentCount> arguments;
+  // The instrumentation overhead of the calls of instrumented functions nested in this one, which
+  // is part of its measured duration.
+  uint64_t nested_overhead_ns = 0;
+};
+
+// The calls of instrumented functions a thread is currently in, innermost last.
+thread_local std::vector<OpenFunctionCall> open_function_calls;
+
+// Set while a payload enqueues an event, so that instrumented functions called from there (e.g.,
+// malloc) don't recursively enqueue events.
+thread_local bool is_in_payload = false;
+
+// The overhead of the payloads measured by MeasureInstrumentationOverhead: the time a call of an
+// instrumented function takes longer for its caller, and the part of it that is included in the
+// duration measured for the call itself.
+std::atomic<uint64_t> call_overhead_ns = 0;
+std::atomic<uint64_t> self_overhead_ns = 0;
+// From CaptureOptions::compensate_instrumentation_overhead of the current capture.
+std::atomic<bool> compensate_overhead = false;
+
+struct FunctionCall {
+  FunctionCall() = default;
+  FunctionCall(pid_t pid, pid_t tid, uint64_t function_id, uint64_t duration_ns,
+               uint64_t end_timestamp_ns, int32_t depth,
+               const std::array<uint64_t, kIntegerArgumentCount>& arguments, uint64_t return_value)
+      : pid(pid),
+        tid(tid),
+        function_id(function_id),
+        duration_ns(duration_ns),
+        end_timestamp_ns(end_timestamp_ns),
+        depth(depth),
+        arguments(arguments),
+        return_value(return_value) {}
+  pid_t pid;
+  pid_t tid;
+  uint64_t function_id;
+  uint64_t duration_ns;
+  uint64_t end_timestamp_ns;
+  int32_t depth;
+  std::array<uint64_t, kIntegerArgumentCount> arguments;
+  uint64_t return_value;
+};
+
+class FunctionCallProducer
+    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<FunctionCall> {
+ public:
+  FunctionCallProducer() {
+    EnableSharedMemoryTransport(
+        orbit_producer_side_channel::kProducerSideSharedMemoryBufferCapacityBytes);
+    BuildAndStart(orbit_producer_side_channel::CreateProducerSideChannel());
+  }
+
+  ~FunctionCallProducer() { ShutdownAndWait(); }
+
+ protected:
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
+    {
+      absl::MutexLock lock{&recorded_values_mutex_};
+      recorded_values_by_function_id_.clear();
+      for (const orbit_grpc_protos::InstrumentedFunction& function :
+           capture_options.instrumented_functions()) {
+        RecordedValues recorded_values;
+        for (uint32_t argument_index : function.recorded_argument_indices()) {
+          if (argument_index < kIntegerArgumentCount) {
+            recorded_values.argument_indices.push_back(argument_index);
+          }
+        }
+        recorded_values.record_return_value = function.record_return_value();
+        if (recorded_values.argument_indices.empty() && !recorded_values.record_return_value) {
+          continue;
+        }
+        recorded_values_by_function_id_.emplace(function.function_id(),
+                                                std::move(recorded_values));
+      }
+    }
+    compensate_overhead = capture_options.compensate_instrumentation_overhead();
+    LockFreeBufferCaptureEventProducer::OnCaptureStart(std::move(capture_options));
+  }
+
+  [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      FunctionCall&& raw_event, google::protobuf::Arena* arena) override {
+    absl::MutexLock lock{&recorded_values_mutex_};
+    return TranslateFunctionCall(raw_event, arena);
+  }
+
+  void TranslateIntermediateEvents(
+      FunctionCall* raw_events, size_t raw_event_count, google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    // Lock once per request rather than once per event.
+    absl::MutexLock lock{&recorded_values_mutex_};
+    for (size_t i = 0; i < raw_event_count; ++i) {
+      capture_events->AddAllocated(TranslateFunctionCall(raw_events[i], arena));
+    }
+  }
+
+ private:
+  // The arguments and the return value are only sent for the functions that requested them, so that
+  // the other function calls stay small and can be batched by OrbitService.
+  [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateFunctionCall(
+      const FunctionCall& raw_event, google::protobuf::Arena* arena)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(recorded_values_mutex_) {
+    auto* capture_event =
+        google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+    orbit_grpc_protos::FunctionCall* function_call = capture_event->mutable_function_call();
+    function_call->set_pid(raw_event.pid);
+    function_call->set_tid(raw_event.tid);
+    function_call->set_function_id(raw_event.function_id);
+    function_call->set_duration_ns(raw_event.duration_ns);
+    function_call->set_end_timestamp_ns(raw_event.end_timestamp_ns);
+    function_call->set_depth(raw_event.depth);
+
+    auto recorded_values_it = recorded_values_by_function_id_.find(raw_event.function_id);
+    if (recorded_values_it != recorded_values_by_function_id_.end()) {
+      const RecordedValues& recorded_values = recorded_values_it->second;
+      for (uint32_t argument_index : recorded_values.argument_indices) {
+        function_call->add_registers(raw_event.arguments[argument_index]);
+      }
+      if (recorded_values.record_return_value) {
+        function_call->set_return_value(raw_event.return_value);
+      }
+    }
+    return capture_event;
+  }
+
+  struct RecordedValues {
+    std::vector<uint32_t> argument_indices;
+    bool record_return_value = false;
+  };
+  absl::Mutex recorded_values_mutex_;
+  absl::flat_hash_map<uint64_t, RecordedValues> recorded_values_by_function_id_
+      ABSL_GUARDED_BY(recorded_values_mutex_);
+};
+
+// The producer is created on the first function exit, rather than when the library is injected,
+// as the tracee is stopped at that point.
+FunctionCallProducer& GetFunctionCallProducer() {
+  static FunctionCallProducer producer;
+  return producer;
+}
+
+void PushOpenFunctionCall(std::vector<OpenFunctionCall>* calls, uint64_t return_address,
+                          uint64_t function_id, const uint64_t* integer_registers) {
+  OpenFunctionCall& open_function_call =
+      calls->emplace_back(return_address, function_id, orbit_base::CaptureTimestampNs());
+  // The trampoline pushed the registers in the opposite order of the arguments.
+  for (size_t i = 0; i < kIntegerArgumentCount; ++i) {
+    open_function_call.arguments[i] = integer_registers[kIntegerArgumentCount - 1 - i];
+  }
+}
+
+// Pops the innermost open call and returns it, with its duration in `duration_ns`. If
+// `compensate`, the instrumentation overhead is subtracted from the duration, and added to the
+// nested overhead of the caller. The end of the call is kept, so the call starts later.
+OpenFunctionCall PopOpenFunctionCall(std::vector<OpenFunctionCall>* calls,
+                                     uint64_t exit_timestamp_ns, bool compensate,
+                                     uint64_t* duration_ns) {
+  CHECK(!calls->empty());
+  const OpenFunctionCall open_function_call = calls->back();
+  calls->pop_back();
+
+  *duration_ns = exit_timestamp_ns - open_function_call.entry_timestamp_ns;
+  if (compensate) {
+    const uint64_t overhead_ns = open_function_call.nested_overhead_ns +
+                                 self_overhead_ns.load(std::memory_order_relaxed);
+    *duration_ns = *duration_ns > overhead_ns ? *duration_ns - overhead_ns : 0;
+    if (!calls->empty()) {
+      calls->back().nested_overhead_ns +=
+          open_function_call.nested_overhead_ns + call_overhead_ns.load(std::memory_order_relaxed);
+    }
+  }
+  return open_function_call;
+}
+
+}  // namespace
+
+void EntryPayload(uint64_t return_address, uint64_t function_id,
+                  const uint64_t* integer_registers) {
+  PushOpenFunctionCall(&open_function_calls, return_address, function_id, integer_registers);
+}
+
+uint64_t ExitPayload(uint64_t return_value) {
+  const uint64_t exit_timestamp_ns = orbit_base::CaptureTimestampNs();
+  uint64_t duration_ns = 0;
+  const OpenFunctionCall open_function_call =
+      PopOpenFunctionCall(&open_function_calls, exit_timestamp_ns,
+                          compensate_overhead.load(std::memory_order_relaxed), &duration_ns);
+
+  if (!is_in_payload) {
+    is_in_payload = true;
+    FunctionCallProducer& producer = GetFunctionCallProducer();
+    if (producer.IsCapturing()) {
+      static const pid_t pid = orbit_base::GetCurrentProcessId();
+      thread_local const pid_t tid = orbit_base::GetCurrentThreadId();
+      // As in liborbit, each thread enqueues into its own sub-queue.
+      thread_local moodycamel::ProducerToken producer_token = producer.CreateProducerToken();
+      producer.EnqueueIntermediateEvent(
+          &producer_token,
+          FunctionCall(pid, tid, open_function_call.function_id, duration_ns, exit_timestamp_ns,
+                       static_cast<int32_t>(open_function_calls.size()),
+                       open_function_call.arguments, return_value));
+    }
+    is_in_payload = false;
+  }
+
+  return open_function_call.return_address;
+}
+
+uint64_t MeasureInstrumentationOverhead() {
+  // The minimum over several batches of calls filters out the batches that were interrupted.
+  constexpr int kBatchCount = 20;
+  constexpr int kCallsPerBatch = 100;
+
+  // This runs on a thread of the tracee that was stopped at any point, possibly in a payload, so
+  // the open calls of the thread must not be touched.
+  std::vector<OpenFunctionCall> calls;
+  calls.reserve(1);
+  const std::array<uint64_t, kIntegerArgumentCount> integer_registers{};
+  uint64_t min_batch_duration_ns = std::numeric_limits<uint64_t>::max();
+  uint64_t min_duration_ns = std::numeric_limits<uint64_t>::max();
+  for (int batch = 0; batch < kBatchCount; ++batch) {
+    const uint64_t batch_start_timestamp_ns = orbit_base::CaptureTimestampNs();
+    for (int call = 0; call < kCallsPerBatch; ++call) {
+      PushOpenFunctionCall(&calls, 0, 0, integer_registers.data());
+      uint64_t duration_ns = 0;
+      PopOpenFunctionCall(&calls, orbit_base::CaptureTimestampNs(), /*compensate=*/false,
+                          &duration_ns);
+      min_duration_ns = std::min(min_duration_ns, duration_ns);
+    }
+    const uint64_t batch_duration_ns = orbit_base::CaptureTimestampNs() - batch_start_timestamp_ns;
+    min_batch_duration_ns = std::min(min_batch_duration_ns, batch_duration_ns);
+  }
+
+  const uint64_t measured_call_overhead_ns = min_batch_duration_ns / kCallsPerBatch;
+  call_overhead_ns = measured_call_overhead_ns;
+  self_overhead_ns = std::min(min_duration_ns, measured_call_overhead_ns);
+  return measured_call_overhead_ns;
+}
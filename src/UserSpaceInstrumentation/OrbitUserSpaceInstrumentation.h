@@ -0,0 +1,33 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_ORBIT_USER_SPACE_INSTRUMENTATION_H_
+#define USER_SPACE_INSTRUMENTATION_ORBIT_USER_SPACE_INSTRUMENTATION_H_
+
+#include <cstdint>
+
+// liborbituserspaceinstrumentation.so is injected into the target process by
+// InstrumentationManager. The trampolines of the instrumented functions call the payloads below,
+// which measure the function calls and send them to OrbitService as FunctionCall events, through
+// the shared memory buffer of a CaptureEventProducer.
+
+// Payload called on entry of an instrumented function. Records the return address of the function
+// (to return to it in `ExitPayload`), `function_id`, the current timestamp and the integer
+// arguments. `integer_registers` points to the values of r9, r8, rcx, rdx, rsi, rdi at the entry.
+extern "C" void EntryPayload(uint64_t return_address, uint64_t function_id,
+                             const uint64_t* integer_registers);
+
+// Payload called on exit of an instrumented function with its integer `return_value` (rax).
+// Enqueues the FunctionCall and returns the actual return address of the function such that the
+// execution can be continued there.
+extern "C" uint64_t ExitPayload(uint64_t return_value);
+
+// Measures the overhead of the payloads on a call of an instrumented function, and returns it in
+// nanoseconds. Called by InstrumentationManager through ExecuteInProcess when the functions are
+// instrumented for a capture with CaptureOptions::compensate_instrumentation_overhead, which the
+// payloads then subtract from the durations of the FunctionCalls. This covers the payloads, not the
+// few instructions of the trampolines nor the enqueuing of the FunctionCalls.
+extern "C" uint64_t MeasureInstrumentationOverhead();
+
+#endif  // USER_SPACE_INSTRUMENTATION_ORBIT_USER_SPACE_INSTRUMENTATION_H_
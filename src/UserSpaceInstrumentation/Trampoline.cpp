@@ -187,18 +187,21 @@ void AppendBackupCode(MachineCode& trampoline) {
   }
 }
 
-// Call the entry payload function with the return address and the id of the instrumented function
-// as parameters. Then overwrite the return address with `return_trampoline_address`.
+// Call the entry payload function with the return address, the id of the instrumented function and
+// the address of the backed up integer parameter registers as parameters. Then overwrite the return
+// address with `return_trampoline_address`.
 void AppendCallToEntryPayloadAndOverwriteReturnAddress(uint64_t entry_payload_function_address,
                                                        uint64_t return_trampoline_address,
                                                        MachineCode& trampoline) {
   // At this point rax is the rsp after pushing the general purpose registers, so adding 0x40 gets
-  // us the location of the return address (see above in `AppendBackupCode`).
+  // us the location of the return address (see above in `AppendBackupCode`). Below the return
+  // address are the backups of rdi, rsi, rdx, rcx, r8, r9, so the backup of r9 is at rax - 0x30.
 
   // add rax, 0x40                                   48 83 c0 40
   // push rax                                        50
   // mov rdi, (rax)                                  48 8b 38
   // mov rsi, function_id                            48 be function_id
+  // lea rdx, -0x30(rax)                             48 8d 50 d0
   // mov rax, entry_payload_function_address         48 b8 addr
   // call rax                                        ff d0
   // pop rax                                         58
@@ -214,6 +217,7 @@ void AppendCallToEntryPayloadAndOverwriteReturnAddress(uint64_t entry_payload_fu
   // The value of function id will be overwritten by every call to `InstrumentFunction`. This is
   // just a placeholder.
   trampoline.AppendImmediate64(0xDEADBEEFDEADBEEF)
+      .AppendBytes({0x48, 0x8d, 0x50, 0xd0})
       .AppendBytes({0x48, 0xb8})
       .AppendImmediate64(entry_payload_function_address)
       .AppendBytes({0xff, 0xd0})
@@ -294,64 +298,50 @@ void AppendRestoreCode(MachineCode& trampoline) {
       .AppendBytes({0x5f});
 }
 
-// Relocates instructions beginning at `function_address` into the trampoline until `kSizeOfJmp`
-// bytes at the beginning of the function are cleared.
-// Returns a mapping from old instruction start addresses in the function to new addresses in the
-// trampoline. The map is meant to be used to move instruction pointers inside the overwritten areas
-// into the correct positions in the trampoline. Therefore only the instructions after the first one
-// are included (function_address will contain a valid instruction - the jump into the trampoline -
-// when we are done).
+// Appends the code of `prologue` relocated for the function at `function_address` to `trampoline`
+// beginning at `trampoline_address`: the fixups of `prologue` are resolved for these addresses.
+// Inserts a mapping from old instruction start addresses in the function to new addresses in the
+// trampoline into `relocation_map`. The map is meant to be used to move instruction pointers inside
+// the overwritten areas into the correct positions in the trampoline.
+// Returns the address of the first instruction in the function that was not relocated.
 [[nodiscard]] ErrorMessageOr<uint64_t> AppendRelocatedPrologueCode(
-    uint64_t function_address, const std::vector<uint8_t>& function, uint64_t trampoline_address,
-    csh capstone_handle, absl::flat_hash_map<uint64_t, uint64_t>& global_relocation_map,
-    MachineCode& trampoline) {
-  cs_insn* instruction = cs_malloc(capstone_handle);
-  FAIL_IF(instruction == nullptr, "Failed to allocate memory for capstone disassembler.");
-  orbit_base::unique_resource scope_exit{instruction,
-                                         [](cs_insn* instruction) { cs_free(instruction, 1); }};
-  std::vector<uint8_t> trampoline_code;
-  const uint8_t* code_pointer = function.data();
-  size_t code_size = function.size();
-  uint64_t disassemble_address = function_address;
-  std::vector<size_t> relocateable_addresses;
-  absl::flat_hash_map<uint64_t, uint64_t> relocation_map;
-  while ((disassemble_address - function_address < kSizeOfJmp) &&
-         cs_disasm_iter(capstone_handle, &code_pointer, &code_size, &disassemble_address,
-                        instruction)) {
-    const uint64_t original_instruction_address = disassemble_address - instruction->size;
-    const uint64_t relocated_instruction_address =
-        trampoline_address + trampoline.GetResultAsVector().size() + trampoline_code.size();
-    relocation_map.insert_or_assign(original_instruction_address, relocated_instruction_address);
-    OUTCOME_TRY(relocated_instruction,
-                RelocateInstruction(instruction, original_instruction_address,
-                                    relocated_instruction_address));
-    if (relocated_instruction.position_of_absolute_address.has_value()) {
-      const size_t offset = relocated_instruction.position_of_absolute_address.value();
-      const size_t instruction_address = trampoline_code.size();
-      relocateable_addresses.push_back(instruction_address + offset);
+    uint64_t function_address, const RelocatedPrologue& prologue, uint64_t trampoline_address,
+    absl::flat_hash_map<uint64_t, uint64_t>& relocation_map, MachineCode& trampoline) {
+  const uint64_t relocated_code_address =
+      trampoline_address + trampoline.GetResultAsVector().size();
+  std::vector<uint8_t> code = prologue.code;
+  for (const RelocatedPrologue::Fixup& fixup : prologue.fixups) {
+    switch (fixup.type) {
+      case RelocatedPrologue::FixupType::kRipRelativeDisplacement: {
+        const int64_t displacement =
+            fixup.value + static_cast<int64_t>(function_address - relocated_code_address);
+        if (displacement < std::numeric_limits<int32_t>::min() ||
+            displacement > std::numeric_limits<int32_t>::max()) {
+          return ErrorMessage(absl::StrFormat(
+              "While trying to relocate an instruction with rip relative addressing the target was "
+              "out of range from the trampoline. function address: %#x, trampoline address: %#x",
+              function_address, trampoline_address));
+        }
+        *absl::bit_cast<int32_t*>(code.data() + fixup.position) =
+            static_cast<int32_t>(displacement);
+        break;
+      }
+      case RelocatedPrologue::FixupType::kAddressInFunction:
+        *absl::bit_cast<uint64_t*>(code.data() + fixup.position) = function_address + fixup.value;
+        break;
+      case RelocatedPrologue::FixupType::kAddressInRelocatedCode:
+        *absl::bit_cast<uint64_t*>(code.data() + fixup.position) =
+            relocated_code_address + fixup.value;
+        break;
     }
-    trampoline_code.insert(trampoline_code.end(), relocated_instruction.code.begin(),
-                           relocated_instruction.code.end());
-  }
-
-  if (disassemble_address - function_address < kSizeOfJmp) {
-    return ErrorMessage(
-        absl::StrFormat("Unable to disassemble enough of the function to instrument it. Code: %s",
-                        BytesAsString(function)));
   }
 
-  // Relocate addresses encoded in the trampoline.
-  for (size_t pos : relocateable_addresses) {
-    const uint64_t address_in_trampoline = *absl::bit_cast<uint64_t*>(trampoline_code.data() + pos);
-    auto it = relocation_map.find(address_in_trampoline);
-    if (it != relocation_map.end()) {
-      *absl::bit_cast<uint64_t*>(trampoline_code.data() + pos) = it->second;
-    }
+  for (const auto& [offset_in_function, offset_in_code] : prologue.relocated_instruction_offsets) {
+    relocation_map.insert_or_assign(function_address + offset_in_function,
+                                    relocated_code_address + offset_in_code);
   }
-
-  trampoline.AppendBytes(trampoline_code);
-  global_relocation_map.insert(relocation_map.begin(), relocation_map.end());
-  return disassemble_address;
+  trampoline.AppendBytes(code);
+  return function_address + prologue.size_of_relocated_function_code;
 }
 
 [[nodiscard]] ErrorMessageOr<void> AppendJumpBackCode(uint64_t address_after_prologue,
@@ -374,6 +364,19 @@ void AppendRestoreCode(MachineCode& trampoline) {
   return outcome::success();
 }
 
+// Offset of the relocated prologue in every trampoline. Constant like `GetMaxTrampolineSize`.
+[[nodiscard]] uint64_t GetOffsetOfRelocatedPrologueInTrampoline() {
+  static const uint64_t offset = []() -> uint64_t {
+    MachineCode unused_code;
+    AppendBackupCode(unused_code);
+    AppendCallToEntryPayloadAndOverwriteReturnAddress(/*entry_payload_function_address=*/0,
+                                                      /*return_trampoline_address=*/0, unused_code);
+    AppendRestoreCode(unused_code);
+    return unused_code.GetResultAsVector().size();
+  }();
+  return offset;
+}
+
 // First backup all the (potential) return values - compare section "3.2.3 Parameter Passing" in
 // "System V Application Binary Interface"
 // https://refspecs.linuxfoundation.org/elf/x86_64-abi-0.99.pdf. Then call the exit payload, restore
@@ -416,12 +419,15 @@ void AppendCallToExitPayloadAndJumpToReturnAddress(uint64_t exit_payload_functio
       .AppendBytes({0x48, 0x83, 0xec, 0x10})
       .AppendBytes({0x66, 0x0f, 0x7f, 0x0c, 0x24});
 
-  // Note that rsp is 32 byte aligned now - we can just do the call. Call the exit payload and move
-  // the return address (which is returned by the exit payload) to rdi.
+  // Note that rsp is 32 byte aligned now - we can just do the call. Call the exit payload with the
+  // integer return value (the backup of rax, above the two 10 byte backups of st(0), st(1) and the
+  // backup of rdx) and move the return address (which is returned by the exit payload) to rdi.
+  // mov rdi, 0x1c(rax)                              48 8b 78 1c
   // mov rax, exit_payload_function_address          48 b8 addr
   // call rax                                        ff d0
   // mov rdi, rax                                    48 89 c7
-  return_trampoline.AppendBytes({0x48, 0xb8})
+  return_trampoline.AppendBytes({0x48, 0x8b, 0x78, 0x1c})
+      .AppendBytes({0x48, 0xb8})
       .AppendImmediate64(exit_payload_function_address)
       .AppendBytes({0xff, 0xd0})
       .AppendBytes({0x48, 0x89, 0xc7});
@@ -651,6 +657,7 @@ ErrorMessageOr<RelocatedInstruction> RelocateInstruction(cs_insn* instruction, u
     memcpy(result.code.data(), instruction->bytes, instruction->size);
     *absl::bit_cast<int32_t*>(result.code.data() + instruction->detail->x86.encoding.disp_offset) =
         new_displacement_or_error.value();
+    result.position_of_rip_relative_displacement = instruction->detail->x86.encoding.disp_offset;
   } else if (instruction->detail->x86.opcode[0] == 0xeb ||
              instruction->detail->x86.opcode[0] == 0xe9) {
     // This handles unconditional jump to relative immediate parameter (32 bit or 8 bit).
@@ -747,6 +754,76 @@ ErrorMessageOr<RelocatedInstruction> RelocateInstruction(cs_insn* instruction, u
   return result;
 }
 
+ErrorMessageOr<RelocatedPrologue> RelocatePrologue(uint64_t function_address,
+                                                   const std::vector<uint8_t>& function,
+                                                   uint64_t trampoline_address,
+                                                   csh capstone_handle) {
+  cs_insn* instruction = cs_malloc(capstone_handle);
+  FAIL_IF(instruction == nullptr, "Failed to allocate memory for capstone disassembler.");
+  orbit_base::unique_resource scope_exit{instruction,
+                                         [](cs_insn* instruction) { cs_free(instruction, 1); }};
+  const uint64_t relocated_code_address =
+      trampoline_address + GetOffsetOfRelocatedPrologueInTrampoline();
+  RelocatedPrologue result;
+  const uint8_t* code_pointer = function.data();
+  size_t code_size = function.size();
+  uint64_t disassemble_address = function_address;
+  std::vector<size_t> relocateable_addresses;
+  absl::flat_hash_map<uint64_t, uint64_t> relocation_map;
+  while ((disassemble_address - function_address < kSizeOfJmp) &&
+         cs_disasm_iter(capstone_handle, &code_pointer, &code_size, &disassemble_address,
+                        instruction)) {
+    const uint64_t original_instruction_address = disassemble_address - instruction->size;
+    const uint64_t relocated_instruction_address = relocated_code_address + result.code.size();
+    relocation_map.insert_or_assign(original_instruction_address, relocated_instruction_address);
+    result.relocated_instruction_offsets.emplace_back(
+        original_instruction_address - function_address, result.code.size());
+    OUTCOME_TRY(relocated_instruction,
+                RelocateInstruction(instruction, original_instruction_address,
+                                    relocated_instruction_address));
+    if (relocated_instruction.position_of_absolute_address.has_value()) {
+      relocateable_addresses.push_back(result.code.size() +
+                                       relocated_instruction.position_of_absolute_address.value());
+    }
+    if (relocated_instruction.position_of_rip_relative_displacement.has_value()) {
+      // The displacement only depends on the distance between the function and the trampoline.
+      const size_t position_in_instruction =
+          relocated_instruction.position_of_rip_relative_displacement.value();
+      const int32_t displacement = *absl::bit_cast<int32_t*>(relocated_instruction.code.data() +
+                                                             position_in_instruction);
+      const size_t position = result.code.size() + position_in_instruction;
+      result.fixups.push_back(
+          {RelocatedPrologue::FixupType::kRipRelativeDisplacement, position,
+           displacement + static_cast<int64_t>(relocated_code_address - function_address)});
+    }
+    result.code.insert(result.code.end(), relocated_instruction.code.begin(),
+                       relocated_instruction.code.end());
+  }
+
+  if (disassemble_address - function_address < kSizeOfJmp) {
+    return ErrorMessage(
+        absl::StrFormat("Unable to disassemble enough of the function to instrument it. Code: %s",
+                        BytesAsString(function)));
+  }
+  result.size_of_relocated_function_code = disassemble_address - function_address;
+
+  // Absolute addresses encoded in the relocated code either point into the relocated prologue
+  // itself (jumps between relocated instructions) or somewhere into the original code.
+  for (size_t pos : relocateable_addresses) {
+    const uint64_t address = *absl::bit_cast<uint64_t*>(result.code.data() + pos);
+    auto it = relocation_map.find(address);
+    if (it != relocation_map.end()) {
+      result.fixups.push_back({RelocatedPrologue::FixupType::kAddressInRelocatedCode, pos,
+                               static_cast<int64_t>(it->second - relocated_code_address)});
+    } else {
+      result.fixups.push_back({RelocatedPrologue::FixupType::kAddressInFunction, pos,
+                               static_cast<int64_t>(address - function_address)});
+    }
+  }
+
+  return result;
+}
+
 uint64_t GetMaxTrampolineSize() {
   // The maximum size of a trampoline is constant. So the calculation can be cached on first call.
   static const uint64_t trampoline_size = []() -> uint64_t {
@@ -774,6 +851,27 @@ ErrorMessageOr<uint64_t> CreateTrampoline(pid_t pid, uint64_t function_address,
                                           uint64_t entry_payload_function_address,
                                           uint64_t return_trampoline_address, csh capstone_handle,
                                           absl::flat_hash_map<uint64_t, uint64_t>& relocation_map) {
+  OUTCOME_TRY(prologue,
+              RelocatePrologue(function_address, function, trampoline_address, capstone_handle));
+  std::vector<TraceesMemoryWrite> writes;
+  OUTCOME_TRY(address_after_prologue,
+              CreateTrampoline(function_address, prologue, trampoline_address,
+                               entry_payload_function_address, return_trampoline_address,
+                               relocation_map, writes));
+
+  // Copy trampoline into tracee.
+  OUTCOME_TRY(WriteTraceesMemory(pid, writes));
+
+  return address_after_prologue;
+}
+
+ErrorMessageOr<uint64_t> CreateTrampoline(uint64_t function_address,
+                                          const RelocatedPrologue& prologue,
+                                          uint64_t trampoline_address,
+                                          uint64_t entry_payload_function_address,
+                                          uint64_t return_trampoline_address,
+                                          absl::flat_hash_map<uint64_t, uint64_t>& relocation_map,
+                                          std::vector<TraceesMemoryWrite>& writes) {
   MachineCode trampoline;
   // Add code to backup register state, execute the payload and restore the register state.
   AppendBackupCode(trampoline);
@@ -782,19 +880,19 @@ ErrorMessageOr<uint64_t> CreateTrampoline(pid_t pid, uint64_t function_address,
   AppendRestoreCode(trampoline);
 
   // Relocate prologue into trampoline.
+  CHECK(trampoline.GetResultAsVector().size() == GetOffsetOfRelocatedPrologueInTrampoline());
   OUTCOME_TRY(address_after_prologue,
-              AppendRelocatedPrologueCode(function_address, function, trampoline_address,
-                                          capstone_handle, relocation_map, trampoline));
+              AppendRelocatedPrologueCode(function_address, prologue, trampoline_address,
+                                          relocation_map, trampoline));
 
   // Add code for jump from trampoline back into function.
   OUTCOME_TRY(AppendJumpBackCode(address_after_prologue, trampoline_address, trampoline));
 
-  // Copy trampoline into tracee.
-  auto write_result_or_error =
-      WriteTraceesMemory(pid, trampoline_address, trampoline.GetResultAsVector());
-  if (write_result_or_error.has_error()) {
-    return write_result_or_error.error();
-  }
+  // Fill the rest of the space reserved for the trampoline with 'int3's.
+  std::vector<uint8_t> trampoline_bytes = trampoline.GetResultAsVector();
+  CHECK(trampoline_bytes.size() <= GetMaxTrampolineSize());
+  trampoline_bytes.resize(GetMaxTrampolineSize(), 0xcc);
+  writes.push_back({trampoline_address, std::move(trampoline_bytes)});
 
   return address_after_prologue;
 }
@@ -827,6 +925,17 @@ ErrorMessageOr<void> CreateReturnTrampoline(pid_t pid, uint64_t exit_payload_fun
 ErrorMessageOr<void> InstrumentFunction(pid_t pid, uint64_t function_address, uint64_t function_id,
                                         uint64_t address_after_prologue,
                                         uint64_t trampoline_address) {
+  std::vector<TraceesMemoryWrite> writes;
+  OUTCOME_TRY(InstrumentFunction(function_address, function_id, address_after_prologue,
+                                 trampoline_address, writes));
+  OUTCOME_TRY(WriteTraceesMemory(pid, writes));
+  return outcome::success();
+}
+
+ErrorMessageOr<void> InstrumentFunction(uint64_t function_address, uint64_t function_id,
+                                        uint64_t address_after_prologue,
+                                        uint64_t trampoline_address,
+                                        std::vector<TraceesMemoryWrite>& writes) {
   MachineCode jump;
   jump.AppendBytes({0xe9});
   ErrorMessageOr<int32_t> offset_or_error =
@@ -845,13 +954,14 @@ ErrorMessageOr<void> InstrumentFunction(pid_t pid, uint64_t function_address, ui
   while (jump.GetResultAsVector().size() < address_after_prologue - function_address) {
     jump.AppendBytes({0x90});
   }
-  OUTCOME_TRY(WriteTraceesMemory(pid, function_address, jump.GetResultAsVector()));
 
-  // Patch the trampoline to hand over the current function_id to the entry payload.
+  // Patch the trampoline to hand over the current function_id to the entry payload. This goes first
+  // such that the function id is in place before the jump into the trampoline.
   MachineCode function_id_as_bytes;
   function_id_as_bytes.AppendImmediate64(function_id);
-  OUTCOME_TRY(WriteTraceesMemory(pid, trampoline_address + kOffsetOfFunctionIdInCallToEntryPayload,
-                                 function_id_as_bytes.GetResultAsVector()));
+  writes.push_back({trampoline_address + kOffsetOfFunctionIdInCallToEntryPayload,
+                    function_id_as_bytes.GetResultAsVector()});
+  writes.push_back({function_address, jump.GetResultAsVector()});
 
   return outcome::success();
 }
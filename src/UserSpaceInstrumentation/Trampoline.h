@@ -12,8 +12,10 @@
 
 #include <cstdint>
 #include <optional>
+#include <utility>
 #include <vector>
 
+#include "AccessTraceesMemory.h"
 #include "AddressRange.h"
 #include "OrbitBase/Result.h"
 
@@ -94,6 +96,11 @@ struct RelocatedInstruction {
   // needs to be recorded and handled later. In this case the `position_of_absolute_address` below
   // would be 8.
   std::optional<size_t> position_of_absolute_address = std::nullopt;
+
+  // For instructions using instruction pointer relative addressing this is the position of the 32
+  // bit displacement in `code`. The displacement depends on the distance between the old and the
+  // new address of the instruction.
+  std::optional<size_t> position_of_rip_relative_displacement = std::nullopt;
 };
 
 // Relocate `instruction` from `old_address` to `new_address`.
@@ -110,13 +117,51 @@ struct RelocatedInstruction {
                                                                        uint64_t old_address,
                                                                        uint64_t new_address);
 
+// The beginning of a function relocated into a trampoline, in a form that does not depend on the
+// address of the function nor on the address of the trampoline: the values in `code` that depend on
+// them are described by `fixups` and only resolved by `CreateTrampoline`. This allows caching the
+// result of the disassembly across processes (compare `TrampolineCache`).
+struct RelocatedPrologue {
+  enum class FixupType {
+    // 32 bit displacement; `value` plus the address of the function minus the address of the
+    // relocated code.
+    kRipRelativeDisplacement,
+    // 64 bit absolute address; `value` plus the address of the function.
+    kAddressInFunction,
+    // 64 bit absolute address; `value` plus the address of the relocated code.
+    kAddressInRelocatedCode,
+  };
+  struct Fixup {
+    FixupType type;
+    size_t position;
+    int64_t value;
+  };
+
+  // Number of bytes at the beginning of the function that were relocated.
+  uint64_t size_of_relocated_function_code = 0;
+  std::vector<uint8_t> code;
+  std::vector<Fixup> fixups;
+  // For each relocated instruction, its offset in the function and its offset in `code`.
+  std::vector<std::pair<uint64_t, uint64_t>> relocated_instruction_offsets;
+};
+
+// Disassembles the beginning of the function at `function_address` and relocates the instructions
+// that are overwritten by the jump into the trampoline. `function` and `capstone_handle` are as in
+// `CreateTrampoline` below. `trampoline_address` is only used to check that the relocated code can
+// reach the memory the function refers to; the result can be used for other trampolines, and for
+// the same function loaded at another address, as long as `CreateTrampoline` succeeds.
+[[nodiscard]] ErrorMessageOr<RelocatedPrologue> RelocatePrologue(
+    uint64_t function_address, const std::vector<uint8_t>& function, uint64_t trampoline_address,
+    csh capstone_handle);
+
 // Strictly speaking the max tempoline size is a compile time constant, but we prefer to compute it
 // here since this captures every change to the code constructing the trampoline.
 [[nodiscard]] uint64_t GetMaxTrampolineSize();
 
 // Creates a trampoline for the function at `function_address`. The trampoline is built at
 // `trampoline_address`. The trampoline will call `entry_payload_function_address` with
-// `return_address` and a function id as a parameter. The function id is written into the
+// `return_address`, a function id and a pointer to the values of the integer parameter registers
+// (r9, r8, rcx, rdx, rsi, rdi in that order) as parameters. The function id is written into the
 // trampoline by `InstrumentFunction`. This is necessary since the function id is not stable across
 // multiple profiling runs.
 // `function` contains the beginning of the function (kMaxFunctionPrologueBackupSize bytes or less
@@ -134,13 +179,24 @@ struct RelocatedInstruction {
     uint64_t return_trampoline_address, csh capstone_handle,
     absl::flat_hash_map<uint64_t, uint64_t>& relocation_map);
 
+// Same as `CreateTrampoline` above, but for a `prologue` already relocated with `RelocatePrologue`,
+// and instead of writing the trampoline into the tracee, the write is appended to `writes`, such
+// that many trampolines can be written at once. The write covers the whole `GetMaxTrampolineSize()`
+// bytes, so that writes of adjacent trampolines merge.
+[[nodiscard]] ErrorMessageOr<uint64_t> CreateTrampoline(
+    uint64_t function_address, const RelocatedPrologue& prologue, uint64_t trampoline_address,
+    uint64_t entry_payload_function_address, uint64_t return_trampoline_address,
+    absl::flat_hash_map<uint64_t, uint64_t>& relocation_map,
+    std::vector<TraceesMemoryWrite>& writes);
+
 // As above with `GetMaxTrampolineSize` this is a compile time constant, but we prefer to compute it
 // here since this captures every change to the code constructing the return trampoline.
 [[nodiscard]] uint64_t GetReturnTrampolineSize();
 
 // Creates a "return trampoline" i.e. a bit of code that is used as a target for overwritten return
-// addresses. It calls the function `exit_payload_function_address` and jumps to the return value of
-// that function. The return trampoline is constructed at address `return_trampoline_address`.
+// addresses. It calls the function `exit_payload_function_address` with the integer return value
+// of the instrumented function (rax) and jumps to the return value of that function. The return
+// trampoline is constructed at address `return_trampoline_address`.
 // Unlike what is done in `CreateTrampoline` we don't need an individual trampoline for each
 // function we instrument. The different functions are disambiguated by the order in which the
 // function exit appears (and it is the responsibility of the payload functions to keep track of
@@ -159,6 +215,13 @@ struct RelocatedInstruction {
                                                       uint64_t address_of_instruction_after_jump,
                                                       uint64_t trampoline_address);
 
+// Same as `InstrumentFunction` above, but the writes into the tracee are appended to `writes`.
+[[nodiscard]] ErrorMessageOr<void> InstrumentFunction(uint64_t function_address,
+                                                      uint64_t function_id,
+                                                      uint64_t address_of_instruction_after_jump,
+                                                      uint64_t trampoline_address,
+                                                      std::vector<TraceesMemoryWrite>& writes);
+
 // Move every instruction pointer that was in the middle of an overwritten function prologue to
 // the corresponding place in the trampoline.
 void MoveInstructionPointersOutOfOverwrittenCode(
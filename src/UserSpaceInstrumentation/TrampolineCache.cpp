@@ -0,0 +1,204 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TrampolineCache.h"
+
+#include <absl/strings/ascii.h>
+#include <absl/strings/str_format.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/WriteStringToFile.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+// Needs to be incremented whenever the relocation of instructions or the file format changes.
+constexpr std::string_view kFileHeader = "OrbitTrampolineCache v1\n";
+
+template <typename T>
+void AppendValue(T value, std::string& data) {
+  data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendBytes(const std::vector<uint8_t>& bytes, std::string& data) {
+  AppendValue<uint64_t>(bytes.size(), data);
+  data.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+// Reads the values appended with the functions above. All reads fail once the end of the data was
+// reached.
+class Reader {
+ public:
+  explicit Reader(std::string_view data) : data_(data) {}
+
+  template <typename T>
+  [[nodiscard]] bool ReadValue(T* value) {
+    if (data_.size() < sizeof(T)) return false;
+    std::memcpy(value, data_.data(), sizeof(T));
+    data_.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  [[nodiscard]] bool ReadBytes(std::vector<uint8_t>* bytes) {
+    uint64_t size = 0;
+    if (!ReadValue(&size) || data_.size() < size) return false;
+    bytes->assign(data_.begin(), data_.begin() + size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  [[nodiscard]] bool IsAtEnd() const { return data_.empty(); }
+
+ private:
+  std::string_view data_;
+};
+
+[[nodiscard]] bool IsValidBuildId(const std::string& build_id) {
+  if (build_id.empty()) return false;
+  for (char c : build_id) {
+    if (!absl::ascii_isxdigit(c)) return false;
+  }
+  return true;
+}
+
+[[nodiscard]] bool ReadEntry(Reader& reader, uint64_t* file_offset, std::vector<uint8_t>* function,
+                             RelocatedPrologue* prologue) {
+  uint64_t fixup_count = 0;
+  if (!reader.ReadValue(file_offset) || !reader.ReadBytes(function) ||
+      !reader.ReadValue(&prologue->size_of_relocated_function_code) ||
+      !reader.ReadBytes(&prologue->code) || !reader.ReadValue(&fixup_count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < fixup_count; ++i) {
+    uint8_t type = 0;
+    uint64_t position = 0;
+    int64_t value = 0;
+    if (!reader.ReadValue(&type) || !reader.ReadValue(&position) || !reader.ReadValue(&value)) {
+      return false;
+    }
+    const auto fixup_type = static_cast<RelocatedPrologue::FixupType>(type);
+    const size_t fixup_size =
+        fixup_type == RelocatedPrologue::FixupType::kRipRelativeDisplacement ? sizeof(int32_t)
+                                                                             : sizeof(uint64_t);
+    if (type > static_cast<uint8_t>(RelocatedPrologue::FixupType::kAddressInRelocatedCode) ||
+        position + fixup_size > prologue->code.size()) {
+      return false;
+    }
+    prologue->fixups.push_back({fixup_type, position, value});
+  }
+  uint64_t offset_count = 0;
+  if (!reader.ReadValue(&offset_count)) return false;
+  for (uint64_t i = 0; i < offset_count; ++i) {
+    uint64_t offset_in_function = 0;
+    uint64_t offset_in_code = 0;
+    if (!reader.ReadValue(&offset_in_function) || !reader.ReadValue(&offset_in_code)) {
+      return false;
+    }
+    prologue->relocated_instruction_offsets.emplace_back(offset_in_function, offset_in_code);
+  }
+  return true;
+}
+
+void AppendEntry(uint64_t file_offset, const std::vector<uint8_t>& function,
+                 const RelocatedPrologue& prologue, std::string& data) {
+  AppendValue(file_offset, data);
+  AppendBytes(function, data);
+  AppendValue(prologue.size_of_relocated_function_code, data);
+  AppendBytes(prologue.code, data);
+  AppendValue<uint64_t>(prologue.fixups.size(), data);
+  for (const RelocatedPrologue::Fixup& fixup : prologue.fixups) {
+    AppendValue(static_cast<uint8_t>(fixup.type), data);
+    AppendValue<uint64_t>(fixup.position, data);
+    AppendValue(fixup.value, data);
+  }
+  AppendValue<uint64_t>(prologue.relocated_instruction_offsets.size(), data);
+  for (const auto& [offset_in_function, offset_in_code] : prologue.relocated_instruction_offsets) {
+    AppendValue(offset_in_function, data);
+    AppendValue(offset_in_code, data);
+  }
+}
+
+}  // namespace
+
+TrampolineCache::Module* TrampolineCache::GetModule(const std::string& build_id) {
+  if (!IsValidBuildId(build_id)) return nullptr;
+  auto [module_it, inserted] = modules_.try_emplace(build_id);
+  Module& module = module_it->second;
+  if (!inserted) return &module;
+
+  ErrorMessageOr<std::string> data_or_error = orbit_base::ReadFileToString(directory_ / build_id);
+  // A missing file just means that nothing was cached for the module yet.
+  if (data_or_error.has_error()) return &module;
+  std::string_view data = data_or_error.value();
+  if (data.substr(0, kFileHeader.size()) != kFileHeader) {
+    LOG("Ignoring trampoline cache for build id %s with unknown format", build_id);
+    return &module;
+  }
+  Reader reader{data.substr(kFileHeader.size())};
+  while (!reader.IsAtEnd()) {
+    uint64_t file_offset = 0;
+    Entry entry;
+    if (!ReadEntry(reader, &file_offset, &entry.function, &entry.prologue)) {
+      ERROR("Trampoline cache for build id %s is corrupted", build_id);
+      module.entries.clear();
+      // Rewrite the file with the entries added later.
+      module.modified = true;
+      break;
+    }
+    module.entries.insert_or_assign(file_offset, std::move(entry));
+  }
+  return &module;
+}
+
+const RelocatedPrologue* TrampolineCache::Get(const std::string& build_id, uint64_t file_offset,
+                                              const std::vector<uint8_t>& function) {
+  Module* module = GetModule(build_id);
+  if (module == nullptr) return nullptr;
+  auto entry_it = module->entries.find(file_offset);
+  if (entry_it == module->entries.end() || entry_it->second.function != function) return nullptr;
+  return &entry_it->second.prologue;
+}
+
+void TrampolineCache::Put(const std::string& build_id, uint64_t file_offset,
+                          std::vector<uint8_t> function, RelocatedPrologue prologue) {
+  Module* module = GetModule(build_id);
+  if (module == nullptr) return;
+  module->entries.insert_or_assign(file_offset, Entry{std::move(function), std::move(prologue)});
+  module->modified = true;
+}
+
+ErrorMessageOr<void> TrampolineCache::Save() {
+  bool directory_created = false;
+  for (auto& [build_id, module] : modules_) {
+    if (!module.modified) continue;
+    if (!directory_created) {
+      OUTCOME_TRY(orbit_base::CreateDirectory(directory_));
+      directory_created = true;
+    }
+
+    std::string data{kFileHeader};
+    for (const auto& [file_offset, entry] : module.entries) {
+      AppendEntry(file_offset, entry.function, entry.prologue, data);
+    }
+    // Write to a temporary file first, so that other instances of OrbitService never read a
+    // partially written file.
+    const std::filesystem::path path = directory_ / build_id;
+    const std::filesystem::path temporary_path =
+        directory_ / absl::StrFormat("%s.%d.tmp", build_id, getpid());
+    OUTCOME_TRY(orbit_base::WriteStringToFile(temporary_path, data));
+    OUTCOME_TRY(orbit_base::MoveFile(temporary_path, path));
+    module.modified = false;
+  }
+  return outcome::success();
+}
+
+}  // namespace orbit_user_space_instrumentation
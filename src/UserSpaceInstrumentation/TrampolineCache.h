@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_TRAMPOLINE_CACHE_H_
+#define USER_SPACE_INSTRUMENTATION_TRAMPOLINE_CACHE_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "Trampoline.h"
+
+namespace orbit_user_space_instrumentation {
+
+// Caches the relocated prologues of functions (compare `RelocatePrologue`) on disk, such that the
+// prologues don't need to be disassembled again when the same binaries are instrumented in later
+// captures, even in other processes. There is one file per module in `directory`, named after the
+// build id of the module. The entries are keyed by the offset of the function in the module file.
+// An entry is only used if the beginning of the function still consists of the same bytes, so a
+// module that was modified in memory is simply disassembled again.
+class TrampolineCache {
+ public:
+  explicit TrampolineCache(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+  // Returns the relocated prologue of the function at `file_offset` in the module with `build_id`
+  // if it was cached for the same `function` bytes, and nullptr otherwise. Modules without build id
+  // are never cached.
+  [[nodiscard]] const RelocatedPrologue* Get(const std::string& build_id, uint64_t file_offset,
+                                             const std::vector<uint8_t>& function);
+
+  void Put(const std::string& build_id, uint64_t file_offset, std::vector<uint8_t> function,
+           RelocatedPrologue prologue);
+
+  // Writes the modules with entries added by `Put` to disk.
+  [[nodiscard]] ErrorMessageOr<void> Save();
+
+ private:
+  struct Entry {
+    std::vector<uint8_t> function;
+    RelocatedPrologue prologue;
+  };
+  struct Module {
+    absl::flat_hash_map<uint64_t, Entry> entries;
+    bool modified = false;
+  };
+
+  // Returns nullptr for invalid build ids. Loads the module from disk the first time.
+  [[nodiscard]] Module* GetModule(const std::string& build_id);
+
+  std::filesystem::path directory_;
+  absl::flat_hash_map<std::string, Module> modules_;
+};
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_TRAMPOLINE_CACHE_H_
@@ -0,0 +1,127 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/WriteStringToFile.h"
+#include "Trampoline.h"
+#include "TrampolineCache.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+constexpr const char* kBuildId = "0123456789abcdef";
+
+[[nodiscard]] std::filesystem::path CreateCacheDirectoryPath() {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  CHECK(temporary_file_or_error.has_value());
+  return temporary_file_or_error.value().file_path().string() + "_trampoline_cache";
+}
+
+[[nodiscard]] RelocatedPrologue CreateRelocatedPrologue() {
+  RelocatedPrologue prologue;
+  prologue.size_of_relocated_function_code = 7;
+  prologue.code = {0x48, 0x8b, 0x05, 0x00, 0x00, 0x00, 0x00, 0xff, 0x25, 0x00, 0x00, 0x00, 0x00,
+                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  prologue.fixups = {{RelocatedPrologue::FixupType::kRipRelativeDisplacement, 3, -0x1234},
+                     {RelocatedPrologue::FixupType::kAddressInFunction, 13, 0x42}};
+  prologue.relocated_instruction_offsets = {{0, 0}, {4, 7}};
+  return prologue;
+}
+
+void ExpectEqual(const RelocatedPrologue& actual, const RelocatedPrologue& expected) {
+  EXPECT_EQ(actual.size_of_relocated_function_code, expected.size_of_relocated_function_code);
+  EXPECT_EQ(actual.code, expected.code);
+  ASSERT_EQ(actual.fixups.size(), expected.fixups.size());
+  for (size_t i = 0; i < actual.fixups.size(); ++i) {
+    EXPECT_EQ(actual.fixups[i].type, expected.fixups[i].type);
+    EXPECT_EQ(actual.fixups[i].position, expected.fixups[i].position);
+    EXPECT_EQ(actual.fixups[i].value, expected.fixups[i].value);
+  }
+  EXPECT_EQ(actual.relocated_instruction_offsets, expected.relocated_instruction_offsets);
+}
+
+}  // namespace
+
+TEST(TrampolineCacheTest, EntriesAreReadBackFromDisk) {
+  const std::filesystem::path directory = CreateCacheDirectoryPath();
+  const std::vector<uint8_t> function = {0x48, 0x8b, 0x05, 0x11, 0x22, 0x33, 0x00, 0x90};
+  const RelocatedPrologue prologue = CreateRelocatedPrologue();
+
+  {
+    TrampolineCache cache{directory};
+    EXPECT_EQ(cache.Get(kBuildId, 0x1000, function), nullptr);
+    cache.Put(kBuildId, 0x1000, function, prologue);
+    const RelocatedPrologue* cached_prologue = cache.Get(kBuildId, 0x1000, function);
+    ASSERT_NE(cached_prologue, nullptr);
+    ExpectEqual(*cached_prologue, prologue);
+    ASSERT_FALSE(cache.Save().has_error());
+  }
+
+  TrampolineCache cache{directory};
+  const RelocatedPrologue* cached_prologue = cache.Get(kBuildId, 0x1000, function);
+  ASSERT_NE(cached_prologue, nullptr);
+  ExpectEqual(*cached_prologue, prologue);
+
+  // Other offsets, build ids or code are not found.
+  EXPECT_EQ(cache.Get(kBuildId, 0x2000, function), nullptr);
+  EXPECT_EQ(cache.Get("abcdef", 0x1000, function), nullptr);
+  std::vector<uint8_t> modified_function = function;
+  modified_function[0] = 0xe9;
+  EXPECT_EQ(cache.Get(kBuildId, 0x1000, modified_function), nullptr);
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(TrampolineCacheTest, ModulesWithoutValidBuildIdAreNotCached) {
+  const std::filesystem::path directory = CreateCacheDirectoryPath();
+  const std::vector<uint8_t> function = {0x55, 0x48, 0x89, 0xe5, 0x90};
+
+  TrampolineCache cache{directory};
+  cache.Put("", 0x1000, function, CreateRelocatedPrologue());
+  EXPECT_EQ(cache.Get("", 0x1000, function), nullptr);
+  cache.Put("../abc", 0x1000, function, CreateRelocatedPrologue());
+  EXPECT_EQ(cache.Get("../abc", 0x1000, function), nullptr);
+
+  ASSERT_FALSE(cache.Save().has_error());
+  EXPECT_FALSE(std::filesystem::exists(directory));
+}
+
+TEST(TrampolineCacheTest, InvalidFilesAreIgnored) {
+  const std::filesystem::path directory = CreateCacheDirectoryPath();
+  const std::vector<uint8_t> function = {0x55, 0x48, 0x89, 0xe5, 0x90};
+  std::filesystem::create_directories(directory);
+
+  ASSERT_FALSE(orbit_base::WriteStringToFile(directory / kBuildId, "unknown format").has_error());
+  {
+    TrampolineCache cache{directory};
+    EXPECT_EQ(cache.Get(kBuildId, 0x1000, function), nullptr);
+  }
+
+  ASSERT_FALSE(orbit_base::WriteStringToFile(directory / kBuildId,
+                                             std::string{"OrbitTrampolineCache v1\n"} + "short")
+                   .has_error());
+  {
+    TrampolineCache cache{directory};
+    EXPECT_EQ(cache.Get(kBuildId, 0x1000, function), nullptr);
+    // The corrupted file is overwritten.
+    cache.Put(kBuildId, 0x1000, function, CreateRelocatedPrologue());
+    ASSERT_FALSE(cache.Save().has_error());
+  }
+
+  TrampolineCache cache{directory};
+  EXPECT_NE(cache.Get(kBuildId, 0x1000, function), nullptr);
+
+  std::filesystem::remove_all(directory);
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -539,6 +539,72 @@ TEST_F(RelocateInstructionTest, TrivialTranslation) {
   EXPECT_FALSE(result.value().position_of_absolute_address.has_value());
 }
 
+TEST(TrampolineTest, RelocatedPrologueIsIndependentOfAddresses) {
+  csh capstone_handle = 0;
+  CHECK(cs_open(CS_ARCH_X86, CS_MODE_64, &capstone_handle) == CS_ERR_OK);
+  CHECK(cs_option(capstone_handle, CS_OPT_DETAIL, CS_OPT_ON) == CS_ERR_OK);
+
+  MachineCode code;
+  // je +0 (into the relocated code)
+  // jne +0x20 (into the original function)
+  // add qword ptr [rip + 0x1234], 1
+  code.AppendBytes({0x74, 0x00})
+      .AppendBytes({0x75, 0x20})
+      .AppendBytes({0x48, 0x83, 0x05})
+      .AppendImmediate32(0x1234)
+      .AppendBytes({0x01});
+  const std::vector<uint8_t>& function = code.GetResultAsVector();
+
+  constexpr uint64_t kFunctionAddress1 = 0x0100000000;
+  constexpr uint64_t kTrampolineAddress1 = 0x0110000000;
+  constexpr uint64_t kFunctionAddress2 = 0x7f0000001000;
+  constexpr uint64_t kTrampolineAddress2 = 0x7eff80000000;
+  constexpr uint64_t kEntryPayloadAddress = 0x1234567890;
+  constexpr uint64_t kReturnTrampolineAddress = 0x2345678901;
+
+  ErrorMessageOr<RelocatedPrologue> prologue1_or_error =
+      RelocatePrologue(kFunctionAddress1, function, kTrampolineAddress1, capstone_handle);
+  ASSERT_THAT(prologue1_or_error, HasValue());
+  EXPECT_EQ(prologue1_or_error.value().size_of_relocated_function_code, function.size());
+  EXPECT_EQ(prologue1_or_error.value().fixups.size(), 3);
+  ErrorMessageOr<RelocatedPrologue> prologue2_or_error =
+      RelocatePrologue(kFunctionAddress2, function, kTrampolineAddress2, capstone_handle);
+  ASSERT_THAT(prologue2_or_error, HasValue());
+
+  // Creating the trampoline for the second pair of addresses gives the same result, no matter at
+  // which addresses the prologue was relocated.
+  absl::flat_hash_map<uint64_t, uint64_t> relocation_map1;
+  std::vector<TraceesMemoryWrite> writes1;
+  ErrorMessageOr<uint64_t> result1 = CreateTrampoline(
+      kFunctionAddress2, prologue1_or_error.value(), kTrampolineAddress2, kEntryPayloadAddress,
+      kReturnTrampolineAddress, relocation_map1, writes1);
+  ASSERT_THAT(result1, HasValue());
+  absl::flat_hash_map<uint64_t, uint64_t> relocation_map2;
+  std::vector<TraceesMemoryWrite> writes2;
+  ErrorMessageOr<uint64_t> result2 = CreateTrampoline(
+      kFunctionAddress2, prologue2_or_error.value(), kTrampolineAddress2, kEntryPayloadAddress,
+      kReturnTrampolineAddress, relocation_map2, writes2);
+  ASSERT_THAT(result2, HasValue());
+
+  EXPECT_EQ(result1.value(), kFunctionAddress2 + function.size());
+  EXPECT_EQ(result1.value(), result2.value());
+  EXPECT_EQ(relocation_map1, relocation_map2);
+  ASSERT_EQ(writes1.size(), 1);
+  ASSERT_EQ(writes2.size(), 1);
+  EXPECT_EQ(writes1[0].start_address, kTrampolineAddress2);
+  EXPECT_EQ(writes1[0].bytes, writes2[0].bytes);
+
+  // The rip relative displacement can't reach the target from a trampoline too far away.
+  absl::flat_hash_map<uint64_t, uint64_t> relocation_map3;
+  std::vector<TraceesMemoryWrite> writes3;
+  EXPECT_THAT(CreateTrampoline(kFunctionAddress2, prologue1_or_error.value(), kTrampolineAddress1,
+                               kEntryPayloadAddress, kReturnTrampolineAddress, relocation_map3,
+                               writes3),
+              HasError("out of range"));
+
+  cs_close(&capstone_handle);
+}
+
 class InstrumentFunctionTest : public testing::Test {
  protected:
   void SetUp() override {
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_INSTRUMENT_PROCESS_H_
+#define USER_SPACE_INSTRUMENTATION_INSTRUMENT_PROCESS_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
+#include "capture.pb.h"
+
+namespace orbit_user_space_instrumentation {
+
+class InstrumentedProcess;
+class TrampolineCache;
+
+// Instruments functions in user space, as a replacement for uprobes: the beginning of each function
+// is overwritten with a jump to a trampoline that calls into liborbituserspaceinstrumentation.so,
+// which is injected into the process. The library measures the function calls and sends them to
+// OrbitService as FunctionCall events.
+// A process stays prepared for instrumentation (the library and the trampolines are kept) after
+// its functions have been uninstrumented, so that subsequent captures are faster to start. The
+// disassembled prologues of the functions are cached in `trampoline_cache_directory` across
+// processes (and instances of OrbitService), as the same binaries are instrumented again and again.
+// The process is only stopped while the trampolines and the jumps into them are written; finding
+// and relocating the prologues happens before, on a thread pool.
+class InstrumentationManager {
+ public:
+  InstrumentationManager(const InstrumentationManager&) = delete;
+  InstrumentationManager& operator=(const InstrumentationManager&) = delete;
+  ~InstrumentationManager();
+
+  [[nodiscard]] static std::unique_ptr<InstrumentationManager> Create(
+      std::filesystem::path trampoline_cache_directory = kDefaultTrampolineCacheDirectory);
+
+  static constexpr const char* kDefaultTrampolineCacheDirectory =
+      "/var/tmp/orbit_trampoline_cache";
+
+  // Instruments the functions in `capture_options.instrumented_functions()` in the process
+  // `capture_options.pid()`, and returns the ids of the functions that were instrumented. The other
+  // functions (e.g., functions with a prologue that can't be relocated, or the functions of the
+  // manual instrumentation API) need to be instrumented with uprobes.
+  [[nodiscard]] ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentProcess(
+      const orbit_grpc_protos::CaptureOptions& capture_options);
+
+  // Restores the original code of the functions instrumented in the process `pid`.
+  [[nodiscard]] ErrorMessageOr<void> UninstrumentProcess(pid_t pid);
+
+ private:
+  explicit InstrumentationManager(std::filesystem::path trampoline_cache_directory);
+
+  [[nodiscard]] ErrorMessageOr<absl::flat_hash_set<uint64_t>> PrepareAndInstrumentProcess(
+      const orbit_grpc_protos::CaptureOptions& capture_options);
+
+  std::unique_ptr<TrampolineCache> trampoline_cache_;
+  absl::flat_hash_map<pid_t, std::unique_ptr<InstrumentedProcess>> process_map_;
+  // Relocates the prologues of the functions in parallel.
+  std::shared_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_INSTRUMENT_PROCESS_H_
@@ -0,0 +1,324 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "VulkanLayerOverheadBenchmark.h"
+
+#include <absl/strings/str_format.h>
+#include <stdlib.h>
+#include <string.h>
+#include <volk.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+#define CHECK_VK_SUCCESS(call) CHECK((call) == VK_SUCCESS)
+
+namespace orbit_vulkan_tutorial {
+
+namespace {
+
+// As in src/OrbitVulkanLayer/resources/VkLayer_Orbit_implicit.json.
+constexpr const char* kOrbitLayerName = "ORBIT_VK_LAYER";
+constexpr const char* kDisableOrbitLayerEnvironmentVariable = "DISABLE_ORBIT_VULKAN_LAYER";
+
+[[nodiscard]] uint64_t NanosecondsSince(std::chrono::steady_clock::time_point begin) {
+  const std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - begin;
+  return duration.count();
+}
+
+[[nodiscard]] bool IsInstanceLayerAvailable(const char* layer_name) {
+  uint32_t layer_count = 0;
+  CHECK_VK_SUCCESS(vkEnumerateInstanceLayerProperties(&layer_count, nullptr));
+  std::vector<VkLayerProperties> layers(layer_count);
+  CHECK_VK_SUCCESS(vkEnumerateInstanceLayerProperties(&layer_count, layers.data()));
+
+  for (const VkLayerProperties& layer : layers) {
+    if (strcmp(layer.layerName, layer_name) == 0) return true;
+  }
+  return false;
+}
+
+// Returns whether `layer_name`, or the implementation and the implicit layers if it is nullptr,
+// provide the instance extension `extension_name`.
+[[nodiscard]] bool IsInstanceExtensionAvailable(const char* layer_name,
+                                                const char* extension_name) {
+  uint32_t extension_count = 0;
+  CHECK_VK_SUCCESS(vkEnumerateInstanceExtensionProperties(layer_name, &extension_count, nullptr));
+  std::vector<VkExtensionProperties> extensions(extension_count);
+  CHECK_VK_SUCCESS(
+      vkEnumerateInstanceExtensionProperties(layer_name, &extension_count, extensions.data()));
+
+  for (const VkExtensionProperties& extension : extensions) {
+    if (strcmp(extension.extensionName, extension_name) == 0) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+VulkanLayerOverheadBenchmark::Result VulkanLayerOverheadBenchmark::Run() {
+  CHECK(options_.thread_count > 0);
+  CHECK(options_.frame_count > 0);
+  debug_marker_names_.clear();
+  for (uint32_t marker = 0; marker < options_.debug_markers_per_command_buffer; ++marker) {
+    debug_marker_names_.push_back(absl::StrFormat("Marker %u", marker));
+  }
+
+  // The loader reads the environment variable when the instance is created.
+  if (options_.enable_orbit_layer) {
+    unsetenv(kDisableOrbitLayerEnvironmentVariable);
+  } else {
+    setenv(kDisableOrbitLayerEnvironmentVariable, "1", /*overwrite=*/1);
+  }
+
+  // To simplify our dependencies, we don't link to Vulkan, but we use volk instead, like
+  // OffscreenRenderingVulkanTutorial does.
+  CHECK_VK_SUCCESS(volkInitialize());
+  CreateInstance();
+  volkLoadInstance(instance_);
+  PickPhysicalDeviceAndQueueFamily();
+  CreateLogicalDevice();
+  CreateCommandBuffers();
+
+  uint64_t debug_markers_ns = 0;
+  uint64_t command_buffer_recording_ns = 0;
+  uint64_t queue_submit_ns = 0;
+  uint64_t frames_ns = 0;
+  std::vector<VkCommandBuffer> all_command_buffers;
+  for (uint32_t frame = 0; frame < options_.frame_count; ++frame) {
+    for (VkCommandPool command_pool : command_pools_) {
+      CHECK_VK_SUCCESS(vkResetCommandPool(device_, command_pool, 0));
+    }
+
+    const auto frame_begin = std::chrono::steady_clock::now();
+    std::vector<ThreadTimes> thread_times(options_.thread_count);
+    std::vector<std::thread> threads;
+    threads.reserve(options_.thread_count);
+    for (uint32_t thread_index = 0; thread_index < options_.thread_count; ++thread_index) {
+      threads.emplace_back([this, thread_index, times = &thread_times[thread_index]] {
+        RecordCommandBuffers(thread_index, times);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    all_command_buffers.clear();
+    for (const std::vector<VkCommandBuffer>& command_buffers : command_buffers_by_thread_) {
+      all_command_buffers.insert(all_command_buffers.end(), command_buffers.begin(),
+                                 command_buffers.end());
+    }
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = static_cast<uint32_t>(all_command_buffers.size()),
+        .pCommandBuffers = all_command_buffers.data(),
+    };
+    const auto submit_begin = std::chrono::steady_clock::now();
+    CHECK_VK_SUCCESS(vkQueueSubmit(queue_, 1, &submit_info, fence_));
+    queue_submit_ns += NanosecondsSince(submit_begin);
+    CHECK_VK_SUCCESS(vkWaitForFences(device_, 1, &fence_, VK_TRUE, UINT64_MAX));
+    frames_ns += NanosecondsSince(frame_begin);
+    CHECK_VK_SUCCESS(vkResetFences(device_, 1, &fence_));
+
+    for (const ThreadTimes& times : thread_times) {
+      debug_markers_ns += times.debug_markers_ns;
+      command_buffer_recording_ns += times.command_buffer_recording_ns;
+    }
+  }
+
+  CleanUp();
+
+  const double command_buffer_count = static_cast<double>(options_.frame_count) *
+                                      options_.thread_count * options_.command_buffers_per_thread;
+  Result result;
+  if (is_debug_utils_extension_enabled_ && options_.debug_markers_per_command_buffer > 0) {
+    result.ns_per_debug_marker =
+        debug_markers_ns / (command_buffer_count * options_.debug_markers_per_command_buffer);
+  }
+  result.ns_per_command_buffer_recording = command_buffer_recording_ns / command_buffer_count;
+  result.ns_per_queue_submit = static_cast<double>(queue_submit_ns) / options_.frame_count;
+  result.ns_per_frame = static_cast<double>(frames_ns) / options_.frame_count;
+  return result;
+}
+
+void VulkanLayerOverheadBenchmark::CreateInstance() {
+  VkApplicationInfo app_info{
+      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+      .pApplicationName = "VulkanLayerOverheadBenchmark",
+      .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+      .pEngineName = "",
+      .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+      .apiVersion = VK_API_VERSION_1_1,
+  };
+
+  std::vector<const char*> layer_names;
+  if (options_.enable_orbit_layer) {
+    FAIL_IF(!IsInstanceLayerAvailable(kOrbitLayerName), "The Orbit Vulkan layer is not installed");
+    layer_names.push_back(kOrbitLayerName);
+  }
+
+  // Like the applications that use debug markers, only enable the extension if it is available.
+  is_debug_utils_extension_enabled_ =
+      IsInstanceExtensionAvailable(nullptr, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) ||
+      (options_.enable_orbit_layer &&
+       IsInstanceExtensionAvailable(kOrbitLayerName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME));
+  std::vector<const char*> extension_names;
+  if (is_debug_utils_extension_enabled_) {
+    extension_names.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+  } else {
+    LOG("%s is not available, no debug markers are recorded", VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+  }
+
+  VkInstanceCreateInfo create_info{
+      .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+      .pApplicationInfo = &app_info,
+      .enabledLayerCount = static_cast<uint32_t>(layer_names.size()),
+      .ppEnabledLayerNames = layer_names.data(),
+      .enabledExtensionCount = static_cast<uint32_t>(extension_names.size()),
+      .ppEnabledExtensionNames = extension_names.data(),
+  };
+
+  CHECK_VK_SUCCESS(vkCreateInstance(&create_info, nullptr, &instance_));
+}
+
+void VulkanLayerOverheadBenchmark::PickPhysicalDeviceAndQueueFamily() {
+  uint32_t physical_device_count = 0;
+  CHECK_VK_SUCCESS(vkEnumeratePhysicalDevices(instance_, &physical_device_count, nullptr));
+  CHECK(physical_device_count > 0);
+  std::vector<VkPhysicalDevice> physical_devices(physical_device_count);
+  CHECK_VK_SUCCESS(
+      vkEnumeratePhysicalDevices(instance_, &physical_device_count, physical_devices.data()));
+
+  for (const VkPhysicalDevice& physical_device : physical_devices) {
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count,
+                                             queue_families.data());
+
+    for (uint32_t queue_family_index = 0; queue_family_index < queue_family_count;
+         ++queue_family_index) {
+      if ((queue_families[queue_family_index].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0u) {
+        physical_device_ = physical_device;
+        queue_family_index_ = queue_family_index;
+        return;
+      }
+    }
+  }
+
+  FATAL("No physical device with a graphics queue");
+}
+
+void VulkanLayerOverheadBenchmark::CreateLogicalDevice() {
+  constexpr float kQueuePriority = 1.0f;
+  VkDeviceQueueCreateInfo queue_create_info{
+      .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+      .queueFamilyIndex = queue_family_index_,
+      .queueCount = 1,
+      .pQueuePriorities = &kQueuePriority,
+  };
+
+  VkPhysicalDeviceFeatures device_features{};
+  VkDeviceCreateInfo create_info{
+      .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+      .queueCreateInfoCount = 1,
+      .pQueueCreateInfos = &queue_create_info,
+      .enabledLayerCount = 0,
+      .ppEnabledLayerNames = nullptr,
+      .enabledExtensionCount = 0,
+      .ppEnabledExtensionNames = nullptr,
+      .pEnabledFeatures = &device_features,
+  };
+
+  CHECK_VK_SUCCESS(vkCreateDevice(physical_device_, &create_info, nullptr, &device_));
+  vkGetDeviceQueue(device_, queue_family_index_, 0, &queue_);
+
+  VkFenceCreateInfo fence_create_info{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+  CHECK_VK_SUCCESS(vkCreateFence(device_, &fence_create_info, nullptr, &fence_));
+}
+
+void VulkanLayerOverheadBenchmark::CreateCommandBuffers() {
+  command_pools_.resize(options_.thread_count);
+  command_buffers_by_thread_.resize(options_.thread_count);
+  for (uint32_t thread_index = 0; thread_index < options_.thread_count; ++thread_index) {
+    VkCommandPoolCreateInfo pool_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queue_family_index_,
+    };
+    CHECK_VK_SUCCESS(
+        vkCreateCommandPool(device_, &pool_info, nullptr, &command_pools_[thread_index]));
+
+    std::vector<VkCommandBuffer>& command_buffers = command_buffers_by_thread_[thread_index];
+    command_buffers.resize(options_.command_buffers_per_thread);
+    if (command_buffers.empty()) continue;
+    VkCommandBufferAllocateInfo alloc_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = command_pools_[thread_index],
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = static_cast<uint32_t>(command_buffers.size()),
+    };
+    CHECK_VK_SUCCESS(vkAllocateCommandBuffers(device_, &alloc_info, command_buffers.data()));
+  }
+}
+
+void VulkanLayerOverheadBenchmark::RecordCommandBuffers(uint32_t thread_index,
+                                                        ThreadTimes* times) {
+  VkCommandBufferBeginInfo begin_info{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  VkDebugUtilsLabelEXT label{
+      .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+      .pLabelName = nullptr,
+      .color = {1.0f, 0.5f, 0.0f, 1.0f},
+  };
+
+  for (VkCommandBuffer command_buffer : command_buffers_by_thread_[thread_index]) {
+    const auto recording_begin = std::chrono::steady_clock::now();
+    CHECK_VK_SUCCESS(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    if (is_debug_utils_extension_enabled_ && !debug_marker_names_.empty()) {
+      // The first marker encloses the others, so that the layer also tracks nested markers.
+      const auto debug_markers_begin = std::chrono::steady_clock::now();
+      label.pLabelName = debug_marker_names_[0].c_str();
+      vkCmdBeginDebugUtilsLabelEXT(command_buffer, &label);
+      for (size_t marker = 1; marker < debug_marker_names_.size(); ++marker) {
+        label.pLabelName = debug_marker_names_[marker].c_str();
+        vkCmdBeginDebugUtilsLabelEXT(command_buffer, &label);
+        vkCmdEndDebugUtilsLabelEXT(command_buffer);
+      }
+      vkCmdEndDebugUtilsLabelEXT(command_buffer);
+      times->debug_markers_ns += NanosecondsSince(debug_markers_begin);
+    }
+
+    CHECK_VK_SUCCESS(vkEndCommandBuffer(command_buffer));
+    times->command_buffer_recording_ns += NanosecondsSince(recording_begin);
+  }
+}
+
+void VulkanLayerOverheadBenchmark::CleanUp() {
+  CHECK_VK_SUCCESS(vkDeviceWaitIdle(device_));
+  vkDestroyFence(device_, fence_, nullptr);
+  // Command buffers are freed with their command pool.
+  for (VkCommandPool command_pool : command_pools_) {
+    vkDestroyCommandPool(device_, command_pool, nullptr);
+  }
+  command_pools_.clear();
+  command_buffers_by_thread_.clear();
+  vkDestroyDevice(device_, nullptr);
+  vkDestroyInstance(instance_, nullptr);
+  fence_ = VK_NULL_HANDLE;
+  queue_ = VK_NULL_HANDLE;
+  device_ = VK_NULL_HANDLE;
+  physical_device_ = VK_NULL_HANDLE;
+  instance_ = VK_NULL_HANDLE;
+}
+
+}  // namespace orbit_vulkan_tutorial
@@ -0,0 +1,80 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef VULKAN_TUTORIAL_VULKAN_LAYER_OVERHEAD_BENCHMARK_H_
+#define VULKAN_TUTORIAL_VULKAN_LAYER_OVERHEAD_BENCHMARK_H_
+
+#include <volk.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace orbit_vulkan_tutorial {
+
+// Measures the CPU time that the calls the Orbit Vulkan layer intercepts take, so that the overhead
+// the layer adds to each call and each frame can be compared between runs with and without the
+// layer, and with and without a capture in progress. Each frame, `thread_count` threads each record
+// `command_buffers_per_thread` command buffers containing `debug_markers_per_command_buffer` debug
+// markers (VK_EXT_debug_utils labels), and all command buffers are then submitted at once.
+// Nothing is drawn, so that the time measured is spent in the loader, the layer and the driver.
+class VulkanLayerOverheadBenchmark {
+ public:
+  struct Options {
+    uint32_t thread_count = 4;
+    uint32_t command_buffers_per_thread = 16;
+    uint32_t debug_markers_per_command_buffer = 32;
+    uint32_t frame_count = 100;
+    // Whether the Orbit layer is explicitly enabled for the instance. Otherwise, the implicit layer
+    // is disabled as this process creates the instance.
+    bool enable_orbit_layer = false;
+  };
+
+  // Average CPU time per call, or per frame, in nanoseconds. The time of the debug markers is
+  // empty if neither the layer nor the driver implement VK_EXT_debug_utils.
+  struct Result {
+    std::optional<double> ns_per_debug_marker;
+    double ns_per_command_buffer_recording = 0;
+    double ns_per_queue_submit = 0;
+    double ns_per_frame = 0;
+  };
+
+  explicit VulkanLayerOverheadBenchmark(const Options& options) : options_{options} {}
+
+  // Creates the instance and the device, renders `frame_count` frames, and destroys both again.
+  [[nodiscard]] Result Run();
+
+ private:
+  struct ThreadTimes {
+    uint64_t debug_markers_ns = 0;
+    uint64_t command_buffer_recording_ns = 0;
+  };
+
+  void CreateInstance();
+  void PickPhysicalDeviceAndQueueFamily();
+  void CreateLogicalDevice();
+  void CreateCommandBuffers();
+  void RecordCommandBuffers(uint32_t thread_index, ThreadTimes* times);
+  void CleanUp();
+
+  Options options_;
+  bool is_debug_utils_extension_enabled_ = false;
+  // Created up front, so that formatting them isn't measured.
+  std::vector<std::string> debug_marker_names_;
+
+  VkInstance instance_ = VK_NULL_HANDLE;
+  VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
+  uint32_t queue_family_index_ = 0;
+  VkDevice device_ = VK_NULL_HANDLE;
+  VkQueue queue_ = VK_NULL_HANDLE;
+  VkFence fence_ = VK_NULL_HANDLE;
+  // Command pools are externally synchronized, so each thread records from its own.
+  std::vector<VkCommandPool> command_pools_;
+  std::vector<std::vector<VkCommandBuffer>> command_buffers_by_thread_;
+};
+
+}  // namespace orbit_vulkan_tutorial
+
+#endif  // VULKAN_TUTORIAL_VULKAN_LAYER_OVERHEAD_BENCHMARK_H_
@@ -0,0 +1,132 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_format.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "VulkanLayerOverheadBenchmark.h"
+
+ABSL_FLAG(uint32_t, threads, 4, "Number of threads recording command buffers in each frame");
+ABSL_FLAG(uint32_t, command_buffers_per_thread, 16,
+          "Number of command buffers each thread records in each frame");
+ABSL_FLAG(uint32_t, debug_markers_per_command_buffer, 32,
+          "Number of debug markers in each command buffer");
+ABSL_FLAG(uint32_t, frames, 100, "Number of frames rendered by each repetition");
+ABSL_FLAG(uint32_t, repetitions, 5,
+          "How many times to run the benchmark. Start or stop a capture with Orbit between "
+          "repetitions to compare the overhead of the layer while capturing and while not");
+ABSL_FLAG(bool, with_orbit_layer, true, "Run the benchmark with the Orbit Vulkan layer enabled");
+ABSL_FLAG(bool, without_orbit_layer, true,
+          "Run the benchmark with the Orbit Vulkan layer disabled, as the baseline");
+
+namespace {
+
+using orbit_vulkan_tutorial::VulkanLayerOverheadBenchmark;
+
+[[nodiscard]] std::string FormatNanoseconds(std::optional<double> nanoseconds) {
+  if (!nanoseconds.has_value()) return "n/a";
+  return absl::StrFormat("%.1f ns", nanoseconds.value());
+}
+
+void LogResult(const std::string& label, const VulkanLayerOverheadBenchmark::Result& result) {
+  LOG("%s: %s per debug marker, %s per command buffer, %s per vkQueueSubmit, %s per frame", label,
+      FormatNanoseconds(result.ns_per_debug_marker),
+      FormatNanoseconds(result.ns_per_command_buffer_recording),
+      FormatNanoseconds(result.ns_per_queue_submit), FormatNanoseconds(result.ns_per_frame));
+}
+
+[[nodiscard]] VulkanLayerOverheadBenchmark::Result Average(
+    const std::vector<VulkanLayerOverheadBenchmark::Result>& results) {
+  VulkanLayerOverheadBenchmark::Result average;
+  for (const VulkanLayerOverheadBenchmark::Result& result : results) {
+    if (result.ns_per_debug_marker.has_value()) {
+      average.ns_per_debug_marker =
+          average.ns_per_debug_marker.value_or(0) + result.ns_per_debug_marker.value();
+    }
+    average.ns_per_command_buffer_recording += result.ns_per_command_buffer_recording;
+    average.ns_per_queue_submit += result.ns_per_queue_submit;
+    average.ns_per_frame += result.ns_per_frame;
+  }
+  const auto count = static_cast<double>(results.size());
+  if (average.ns_per_debug_marker.has_value()) average.ns_per_debug_marker.value() /= count;
+  average.ns_per_command_buffer_recording /= count;
+  average.ns_per_queue_submit /= count;
+  average.ns_per_frame /= count;
+  return average;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Measures the CPU time spent in the Vulkan calls that the Orbit Vulkan layer intercepts, "
+      "with and without the layer, and reports the overhead the layer adds per call and per frame");
+  absl::ParseCommandLine(argc, argv);
+
+  VulkanLayerOverheadBenchmark::Options options;
+  options.thread_count = absl::GetFlag(FLAGS_threads);
+  options.command_buffers_per_thread = absl::GetFlag(FLAGS_command_buffers_per_thread);
+  options.debug_markers_per_command_buffer = absl::GetFlag(FLAGS_debug_markers_per_command_buffer);
+  options.frame_count = absl::GetFlag(FLAGS_frames);
+  FAIL_IF(options.thread_count == 0, "The number of threads must be positive");
+  FAIL_IF(options.frame_count == 0, "The number of frames must be positive");
+  const uint32_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  FAIL_IF(repetitions == 0, "The number of repetitions must be positive");
+  const bool with_orbit_layer = absl::GetFlag(FLAGS_with_orbit_layer);
+  const bool without_orbit_layer = absl::GetFlag(FLAGS_without_orbit_layer);
+  FAIL_IF(!with_orbit_layer && !without_orbit_layer,
+          "At least one of --with_orbit_layer and --without_orbit_layer is required");
+
+  std::vector<VulkanLayerOverheadBenchmark::Result> results_with_layer;
+  std::vector<VulkanLayerOverheadBenchmark::Result> results_without_layer;
+  for (uint32_t repetition = 0; repetition < repetitions; ++repetition) {
+    if (without_orbit_layer) {
+      options.enable_orbit_layer = false;
+      results_without_layer.push_back(VulkanLayerOverheadBenchmark{options}.Run());
+      LogResult(absl::StrFormat("Repetition %u without layer", repetition),
+                results_without_layer.back());
+    }
+    if (with_orbit_layer) {
+      options.enable_orbit_layer = true;
+      results_with_layer.push_back(VulkanLayerOverheadBenchmark{options}.Run());
+      LogResult(absl::StrFormat("Repetition %u with layer", repetition),
+                results_with_layer.back());
+    }
+  }
+
+  std::optional<VulkanLayerOverheadBenchmark::Result> average_without_layer;
+  std::optional<VulkanLayerOverheadBenchmark::Result> average_with_layer;
+  if (without_orbit_layer) {
+    average_without_layer = Average(results_without_layer);
+    LogResult("Average without layer", average_without_layer.value());
+  }
+  if (with_orbit_layer) {
+    average_with_layer = Average(results_with_layer);
+    LogResult("Average with layer", average_with_layer.value());
+  }
+  if (!average_without_layer.has_value() || !average_with_layer.has_value()) return 0;
+
+  VulkanLayerOverheadBenchmark::Result overhead;
+  // Without the layer, the driver might not implement debug markers, in which case the whole time
+  // spent in them is overhead.
+  if (average_with_layer->ns_per_debug_marker.has_value()) {
+    overhead.ns_per_debug_marker = average_with_layer->ns_per_debug_marker.value() -
+                                   average_without_layer->ns_per_debug_marker.value_or(0);
+  }
+  overhead.ns_per_command_buffer_recording = average_with_layer->ns_per_command_buffer_recording -
+                                             average_without_layer->ns_per_command_buffer_recording;
+  overhead.ns_per_queue_submit =
+      average_with_layer->ns_per_queue_submit - average_without_layer->ns_per_queue_submit;
+  overhead.ns_per_frame = average_with_layer->ns_per_frame - average_without_layer->ns_per_frame;
+  LogResult("Overhead of the layer", overhead);
+  return 0;
+}